@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include "ofdm/ofdm_demodulator.h"
+
+// Last synchronisation of each tuned block so returning to an ensemble doesn't acquire from scratch
+// Entries are keyed by device serial and block label since the frequency error depends on the tuner
+// File = one line per entry with tab separated fields
+//        [serial] [label] [coarse_freq_offset] [fine_freq_offset] [signal_l1_average]
+// NOTE: This can be accessed from any thread
+class App_Acquisition_Cache
+{
+private:
+    using Key = std::pair<std::string, std::string>;
+    const std::string m_filename;
+    std::mutex m_mutex;
+    std::map<Key, OFDM_Demod_Acquisition> m_entries;
+public:
+    // An empty filename keeps the cache in memory only
+    explicit App_Acquisition_Cache(std::string filename=""): m_filename(std::move(filename)) {
+        Load();
+    }
+    std::optional<OFDM_Demod_Acquisition> Get(const std::string& serial, const std::string& label) {
+        auto lock = std::scoped_lock(m_mutex);
+        auto res = m_entries.find({ serial, label });
+        if (res == m_entries.end()) return std::nullopt;
+        return res->second;
+    }
+    // Written to disk straight away since retuning is rare
+    void Set(const std::string& serial, const std::string& label, const OFDM_Demod_Acquisition& acquisition) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_entries[{ serial, label }] = acquisition;
+        Save();
+    }
+    // Store the acquisition of the signal being left and seed the demodulator for the new one
+    void Retune(OFDM_Demod& demod, const std::string& serial, const std::string& old_label, const std::string& new_label) {
+        const auto acquisition = demod.GetAcquisition();
+        if (acquisition.has_value() && !old_label.empty()) {
+            Set(serial, old_label, acquisition.value());
+        }
+        demod.SetAcquisitionSeed(Get(serial, new_label));
+    }
+private:
+    void Load() {
+        if (m_filename.empty()) return;
+        FILE* fp = fopen(m_filename.c_str(), "r");
+        if (fp == nullptr) return;
+        char serial[256];
+        char label[256];
+        OFDM_Demod_Acquisition acquisition;
+        while (true) {
+            const int total_read = fscanf(
+                fp, " %255[^\t\n]\t%255[^\t\n]\t%f\t%f\t%f",
+                serial, label,
+                &acquisition.coarse_freq_offset, &acquisition.fine_freq_offset, &acquisition.signal_l1_average
+            );
+            if (total_read != 5) break;
+            m_entries[{ serial, label }] = acquisition;
+        }
+        fclose(fp);
+    }
+    void Save() {
+        if (m_filename.empty()) return;
+        FILE* fp = fopen(m_filename.c_str(), "w");
+        if (fp == nullptr) {
+            fprintf(stderr, "Failed to open acquisition cache '%s' for writing\n", m_filename.c_str());
+            return;
+        }
+        for (const auto& [key, acquisition]: m_entries) {
+            fprintf(
+                fp, "%s\t%s\t%.9g\t%.9g\t%.9g\n",
+                key.first.c_str(), key.second.c_str(),
+                acquisition.coarse_freq_offset, acquisition.fine_freq_offset, acquisition.signal_l1_average
+            );
+        }
+        fclose(fp);
+    }
+};
@@ -0,0 +1,451 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "basic_radio/basic_radio.h"
+#include "dab/constants/dab_parameters.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "../audio/ring_buffer.h"
+#include "./app_io_buffers.h"
+#include "./app_ofdm_blocks.h"
+
+// Pipelines of stages that are stepped by a small pool of threads instead of each stage having its own thread
+// A stage does a bounded amount of work each step (e.g. one block) and never blocks on its neighbours
+// When its input is empty or its output is full it returns WAIT and the channel wakes it once that changes
+// This gives the same backpressure as the blocking InputBuffer/OutputBuffer chains but many pipelines
+// can share a few threads, e.g. decoding dozens of recordings at once
+// NOTE: A stage can still block inside its own work (a blocking file read or a radio waiting on its pool)
+//       so the executor should have a few more threads than the number of stages expected to block at once
+
+enum class Async_Stage_Status {
+    // more work is available so step again after the other ready stages
+    PROGRESS,
+    // waiting for a channel to wake the stage
+    WAIT,
+    // never stepped again
+    FINISHED,
+};
+
+class Async_Executor;
+
+class Async_Stage
+{
+private:
+    friend class Async_Executor;
+    enum class State: uint8_t { NEW, IDLE, QUEUED, RUNNING, RUNNING_WOKEN, FINISHED };
+    std::atomic<State> m_state{State::NEW};
+    Async_Executor* m_executor = nullptr;
+public:
+    virtual ~Async_Stage() {}
+    // Only one thread steps a stage at a time
+    virtual Async_Stage_Status step() = 0;
+    // Can be called from any thread. A stage woken while it is stepping is stepped again afterwards
+    // so a wake between a stage finding its channel empty and returning WAIT isn't lost
+    inline void wake();
+    bool is_finished() const { return m_state.load(std::memory_order_acquire) == State::FINISHED; }
+};
+
+class Async_Executor
+{
+private:
+    std::vector<std::shared_ptr<Async_Stage>> m_stages;
+    std::deque<Async_Stage*> m_ready;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_ready;
+    std::condition_variable m_cv_done;
+    size_t m_total_unfinished = 0;
+    bool m_is_stopped = false;
+    std::vector<std::thread> m_threads;
+public:
+    // total_threads=0 uses one thread per core
+    explicit Async_Executor(size_t total_threads=0) {
+        if (total_threads == 0) total_threads = size_t(std::thread::hardware_concurrency());
+        if (total_threads == 0) total_threads = 1;
+        for (size_t i = 0; i < total_threads; i++) {
+            m_threads.emplace_back([this]() { run_worker(); });
+        }
+    }
+    ~Async_Executor() {
+        stop();
+    }
+    Async_Executor(Async_Executor&) = delete;
+    Async_Executor(Async_Executor&&) = delete;
+    Async_Executor& operator=(Async_Executor&) = delete;
+    Async_Executor& operator=(Async_Executor&&) = delete;
+    size_t get_total_threads() const { return m_threads.size(); }
+    // The stage is stepped straight away and kept alive until the executor is destroyed
+    // NOTE: Connect the channels of a stage before adding it
+    void add_stage(std::shared_ptr<Async_Stage> stage) {
+        assert(stage->m_state.load() == Async_Stage::State::NEW);
+        stage->m_executor = this;
+        stage->m_state.store(Async_Stage::State::QUEUED, std::memory_order_release);
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_total_unfinished++;
+            m_stages.push_back(stage);
+        }
+        push_ready(stage.get());
+    }
+    // Blocks until every stage has finished
+    void wait_done() {
+        auto lock = std::unique_lock(m_mutex);
+        m_cv_done.wait(lock, [this]() { return m_total_unfinished == 0; });
+    }
+    bool is_done() {
+        auto lock = std::unique_lock(m_mutex);
+        return m_total_unfinished == 0;
+    }
+    // Stages that haven't finished are abandoned after their current step
+    void stop() {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_is_stopped = true;
+        }
+        m_cv_ready.notify_all();
+        for (auto& thread: m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+private:
+    friend class Async_Stage;
+    void push_ready(Async_Stage* stage) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_ready.push_back(stage);
+        }
+        m_cv_ready.notify_one();
+    }
+    void run_worker() {
+        using State = Async_Stage::State;
+        while (true) {
+            Async_Stage* stage = nullptr;
+            {
+                auto lock = std::unique_lock(m_mutex);
+                m_cv_ready.wait(lock, [this]() { return m_is_stopped || !m_ready.empty(); });
+                if (m_is_stopped) return;
+                stage = m_ready.front();
+                m_ready.pop_front();
+            }
+            stage->m_state.store(State::RUNNING, std::memory_order_release);
+            const auto status = stage->step();
+            if (status == Async_Stage_Status::FINISHED) {
+                stage->m_state.store(State::FINISHED, std::memory_order_release);
+                {
+                    auto lock = std::unique_lock(m_mutex);
+                    m_total_unfinished--;
+                }
+                m_cv_done.notify_all();
+                continue;
+            }
+            if (status == Async_Stage_Status::WAIT) {
+                State expected = State::RUNNING;
+                if (stage->m_state.compare_exchange_strong(expected, State::IDLE, std::memory_order_acq_rel)) continue;
+                // woken while stepping
+            }
+            // round robin with the other ready stages so a busy pipeline doesn't starve the others
+            stage->m_state.store(State::QUEUED, std::memory_order_release);
+            push_ready(stage);
+        }
+    }
+};
+
+inline void Async_Stage::wake() {
+    State state = m_state.load(std::memory_order_acquire);
+    while (true) {
+        if (state == State::IDLE) {
+            if (m_state.compare_exchange_weak(state, State::QUEUED, std::memory_order_acq_rel)) {
+                m_executor->push_ready(this);
+                return;
+            }
+        } else if (state == State::RUNNING) {
+            if (m_state.compare_exchange_weak(state, State::RUNNING_WOKEN, std::memory_order_acq_rel)) return;
+        } else {
+            // already queued, about to be stepped again, finished or not added yet
+            return;
+        }
+    }
+}
+
+// Bounded single producer single consumer channel between two stages
+// Reads and writes never block and wake the stage on the other side when they make progress
+template <typename T>
+class Async_Channel
+{
+private:
+    RingBuffer<T> m_ring_buffer;
+    std::mutex m_mutex;
+    bool m_is_closed = false;
+    Async_Stage* m_writer = nullptr;
+    Async_Stage* m_reader = nullptr;
+public:
+    explicit Async_Channel(const size_t length): m_ring_buffer(length) {}
+    Async_Channel(Async_Channel&) = delete;
+    Async_Channel(Async_Channel&&) = delete;
+    Async_Channel& operator=(Async_Channel&) = delete;
+    Async_Channel& operator=(Async_Channel&&) = delete;
+    // NOTE: Call this before either stage is added to the executor
+    void set_writer(Async_Stage* writer) { m_writer = writer; }
+    void set_reader(Async_Stage* reader) { m_reader = reader; }
+    size_t get_size() const { return m_ring_buffer.get_size(); }
+    // Writes as much as fits
+    size_t write(tcb::span<const T> src) {
+        size_t length = 0;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            length = m_ring_buffer.write(src);
+        }
+        if ((length > 0) && (m_reader != nullptr)) m_reader->wake();
+        return length;
+    }
+    // Reads as much as is available
+    size_t read(tcb::span<T> dest) {
+        size_t length = 0;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            length = m_ring_buffer.read(dest);
+        }
+        if ((length > 0) && (m_writer != nullptr)) m_writer->wake();
+        return length;
+    }
+    // Reads nothing unless all of dest is available, e.g. a whole frame of soft bits
+    bool read_exact(tcb::span<T> dest) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            if (m_ring_buffer.get_total_used() < dest.size()) return false;
+            m_ring_buffer.read(dest);
+        }
+        if (m_writer != nullptr) m_writer->wake();
+        return true;
+    }
+    // Writer: no more data will be written
+    void close() {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_is_closed = true;
+        }
+        if (m_reader != nullptr) m_reader->wake();
+    }
+    // Reader: the channel is closed and everything written was read
+    bool is_finished() {
+        auto lock = std::unique_lock(m_mutex);
+        return m_is_closed && m_ring_buffer.is_empty();
+    }
+};
+
+// Output of a stage that didn't fit in its channel yet
+template <typename T>
+class Async_Pending_Output
+{
+private:
+    std::vector<T> m_data;
+    size_t m_offset = 0;
+public:
+    bool is_empty() const { return m_offset == m_data.size(); }
+    // Storage for length more items which are appended after any still pending
+    tcb::span<T> append(const size_t length) {
+        if (is_empty()) {
+            m_data.clear();
+            m_offset = 0;
+        }
+        const size_t start = m_data.size();
+        m_data.resize(start+length);
+        return tcb::span(m_data).subspan(start, length);
+    }
+    void append(tcb::span<const T> src) {
+        auto dest = append(src.size());
+        std::copy(src.begin(), src.end(), dest.begin());
+    }
+    // Removes unused items from the end of the last append
+    void trim(const size_t unused) {
+        assert(unused <= m_data.size()-m_offset);
+        m_data.resize(m_data.size()-unused);
+    }
+    // Returns true once everything pending was written
+    bool flush(Async_Channel<T>& channel) {
+        if (is_empty()) return true;
+        m_offset += channel.write(tcb::span<const T>(m_data).subspan(m_offset));
+        return is_empty();
+    }
+};
+
+// Reads blocks from an InputBuffer into a channel until the input ends
+// NOTE: The read blocks the executor thread so this suits files rather than live devices
+template <typename T>
+class Async_Input_Stage: public Async_Stage
+{
+private:
+    std::shared_ptr<InputBuffer<T>> m_input;
+    std::shared_ptr<Async_Channel<T>> m_output;
+    const size_t m_block_size;
+    Async_Pending_Output<T> m_pending;
+    bool m_is_input_done = false;
+public:
+    Async_Input_Stage(std::shared_ptr<InputBuffer<T>> input, std::shared_ptr<Async_Channel<T>> output, const size_t block_size)
+    : m_input(input), m_output(output), m_block_size(block_size)
+    {
+        m_output->set_writer(this);
+    }
+    Async_Stage_Status step() override {
+        if (!m_pending.flush(*m_output)) return Async_Stage_Status::WAIT;
+        if (m_is_input_done) {
+            m_output->close();
+            return Async_Stage_Status::FINISHED;
+        }
+        const size_t length = m_input->read(m_pending.append(m_block_size));
+        m_pending.trim(m_block_size-length);
+        if (length < m_block_size) m_is_input_done = true;
+        m_pending.flush(*m_output);
+        return Async_Stage_Status::PROGRESS;
+    }
+};
+
+// Converts raw 8bit IQ to the samples given to the demodulator
+class Async_Convert_RawIQ_Stage: public Async_Stage
+{
+private:
+    std::shared_ptr<Async_Channel<RawIQ>> m_input;
+    std::shared_ptr<Async_Channel<std::complex<float>>> m_output;
+    std::vector<RawIQ> m_buffer;
+    Async_Pending_Output<std::complex<float>> m_pending;
+public:
+    Async_Convert_RawIQ_Stage(
+        std::shared_ptr<Async_Channel<RawIQ>> input, std::shared_ptr<Async_Channel<std::complex<float>>> output,
+        const size_t block_size)
+    : m_input(input), m_output(output), m_buffer(block_size)
+    {
+        m_input->set_reader(this);
+        m_output->set_writer(this);
+    }
+    Async_Stage_Status step() override {
+        if (!m_pending.flush(*m_output)) return Async_Stage_Status::WAIT;
+        const size_t length = m_input->read(m_buffer);
+        if (length == 0) {
+            if (!m_input->is_finished()) return Async_Stage_Status::WAIT;
+            m_output->close();
+            return Async_Stage_Status::FINISHED;
+        }
+        convert_raw_iq_block(tcb::span(m_buffer).first(length), m_pending.append(length));
+        m_pending.flush(*m_output);
+        return Async_Stage_Status::PROGRESS;
+    }
+};
+
+// Demodulates on the executor thread that steps it (see OFDM_Demod_Sync_Mode::INLINE) so it has no threads of its own
+// Frames that don't fit in the output are held and no more samples are read until they are written
+class Async_OFDM_Stage: public Async_Stage
+{
+private:
+    std::shared_ptr<Async_Channel<std::complex<float>>> m_input;
+    std::shared_ptr<Async_Channel<viterbi_bit_t>> m_output;
+    std::unique_ptr<OFDM_Demod> m_ofdm_demod;
+    std::vector<std::complex<float>> m_buffer;
+    Async_Pending_Output<viterbi_bit_t> m_pending;
+    bool m_is_input_done = false;
+public:
+    Async_OFDM_Stage(
+        const int transmission_mode,
+        std::shared_ptr<Async_Channel<std::complex<float>>> input, std::shared_ptr<Async_Channel<viterbi_bit_t>> output,
+        const size_t block_size, const OFDM_Demod_Precision precision=OFDM_Demod_Precision::FLOAT32)
+    : m_input(input), m_output(output), m_buffer(block_size)
+    {
+        const auto& tables = get_DAB_OFDM_tables(transmission_mode);
+        m_ofdm_demod = std::make_unique<OFDM_Demod>(
+            tables.params, tables.prs_fft_ref, tables.carrier_mapper,
+            1, OFDM_Demod_Sync_Mode::INLINE, OFDM_Demod_Thread_Config{}, nullptr, precision);
+        // there is no gui to show the FFTs of each frame
+        m_ofdm_demod->SetIsHeadless(true);
+        m_ofdm_demod->On_OFDM_Frame().Attach([this](tcb::span<const viterbi_bit_t> buf) {
+            m_pending.append(buf);
+        });
+        m_input->set_reader(this);
+        m_output->set_writer(this);
+    }
+    auto& get_ofdm_demod() { return *(m_ofdm_demod.get()); }
+    Async_Stage_Status step() override {
+        if (!m_pending.flush(*m_output)) return Async_Stage_Status::WAIT;
+        if (m_is_input_done) {
+            m_output->close();
+            return Async_Stage_Status::FINISHED;
+        }
+        const size_t length = m_input->read(m_buffer);
+        if (length == 0) {
+            if (!m_input->is_finished()) return Async_Stage_Status::WAIT;
+            m_ofdm_demod->Flush();
+            m_is_input_done = true;
+        } else {
+            m_ofdm_demod->Process(tcb::span<const std::complex<float>>(m_buffer).first(length));
+        }
+        m_pending.flush(*m_output);
+        return Async_Stage_Status::PROGRESS;
+    }
+};
+
+// Decodes one frame of soft bits each step
+// The radio's sinks are its observers or event queues (see BasicRadio::AddEventQueue())
+class Async_Radio_Stage: public Async_Stage
+{
+private:
+    std::shared_ptr<Async_Channel<viterbi_bit_t>> m_input;
+    std::unique_ptr<BasicRadio> m_basic_radio;
+    std::vector<viterbi_bit_t> m_frame;
+public:
+    // radio is a client of a thread pool shared with other radios
+    // NOTE: Each radio must have its own client since only one thread can push into a client at a time
+    Async_Radio_Stage(
+        const int transmission_mode, std::shared_ptr<Async_Channel<viterbi_bit_t>> input,
+        std::shared_ptr<BasicThreadPool> thread_pool, const size_t thread_pool_client)
+    : m_input(input)
+    {
+        const auto params = get_dab_parameters(transmission_mode);
+        m_basic_radio = std::make_unique<BasicRadio>(params, thread_pool, thread_pool_client);
+        m_frame.resize(params.nb_frame_bits);
+        m_input->set_reader(this);
+    }
+    BasicRadio& get_basic_radio() { return *(m_basic_radio.get()); }
+    Async_Stage_Status step() override {
+        if (!m_input->read_exact(m_frame)) {
+            if (!m_input->is_finished()) return Async_Stage_Status::WAIT;
+            m_basic_radio->Flush();
+            return Async_Stage_Status::FINISHED;
+        }
+        m_basic_radio->Process(m_frame);
+        return Async_Stage_Status::PROGRESS;
+    }
+};
+
+// Writes a channel to an OutputBuffer, e.g. soft bits to a file
+template <typename T>
+class Async_Output_Stage: public Async_Stage
+{
+private:
+    std::shared_ptr<Async_Channel<T>> m_input;
+    std::shared_ptr<OutputBuffer<T>> m_output;
+    std::vector<T> m_buffer;
+public:
+    Async_Output_Stage(std::shared_ptr<Async_Channel<T>> input, std::shared_ptr<OutputBuffer<T>> output, const size_t block_size)
+    : m_input(input), m_output(output), m_buffer(block_size)
+    {
+        m_input->set_reader(this);
+    }
+    Async_Stage_Status step() override {
+        const size_t length = m_input->read(m_buffer);
+        if (length == 0) {
+            return m_input->is_finished() ? Async_Stage_Status::FINISHED : Async_Stage_Status::WAIT;
+        }
+        m_output->write(tcb::span<const T>(m_buffer).first(length));
+        return Async_Stage_Status::PROGRESS;
+    }
+};
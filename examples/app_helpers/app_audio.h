@@ -18,10 +18,11 @@ static void attach_audio_pipeline_to_radio(std::shared_ptr<AudioPipeline> audio_
             auto& controls = channel.GetControls();
             auto audio_source = std::make_shared<AudioPipelineSource>();
             audio_pipeline->add_source(audio_source);
-            channel.OnAudioData().Attach(
-                [&controls, audio_source, audio_pipeline]
+            // played audio doesn't count as demand so on demand channels only decode while played or recorded
+            controls.SetIsDecodeOnDemand(true);
+            channel.OnPlayAudioData().Attach(
+                [audio_source, audio_pipeline]
                 (BasicAudioParams params, tcb::span<const uint8_t> buf) {
-                    if (!controls.GetIsPlayAudio()) return;
                     auto frame_ptr = reinterpret_cast<const Frame<int16_t>*>(buf.data());
                     const size_t total_frames = buf.size() / sizeof(Frame<int16_t>);
                     auto frame_buf = tcb::span(frame_ptr, total_frames);
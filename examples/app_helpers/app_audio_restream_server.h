@@ -0,0 +1,398 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "utility/span.h"
+#include "./app_network_buffers.h"
+
+// Restreams the encoded audio of each channel over HTTP without decoding it
+// Clients request "GET /<subchannel_id>" and receive an endless stream like an Icecast mount point
+//   DAB+ is sent as ADTS framed AAC (audio/aac) and DAB is sent as MP2 frames (audio/mpeg)
+//   "GET /" lists the channels that can be streamed
+// Each channel keeps one ring of recent frames which is shared by all of its clients
+//   A frame is copied once into the ring and clients send it straight from there with scatter-gather writes
+//   Clients that fall behind the ring skip ahead to the newest frames instead of slowing down the radio
+
+enum class Restream_Audio_Type {
+    AAC_ADTS, MP2,
+};
+
+struct Restream_Statistics {
+    uint64_t total_frames = 0;          // frames pushed into all channels
+    uint64_t total_connections = 0;
+    uint64_t total_active_clients = 0;
+    uint64_t total_skipped_frames = 0;  // frames that slow clients skipped over
+};
+
+namespace restream_internal {
+
+using Frame = std::vector<uint8_t>;
+using Frame_Ref = std::shared_ptr<Frame>;
+
+static constexpr size_t MAX_REQUEST_SIZE = 4096;
+// frames given to a single scatter-gather write
+static constexpr size_t MAX_FRAMES_PER_SEND = network_internal::MAX_SEND_BUFFERS;
+
+// Partial writes are resumed from where they stopped
+// NOTE: The buffers are trimmed in place as they are sent
+static inline bool send_all_vectored(network_internal::socket_t s, tcb::span<tcb::span<const uint8_t>> bufs) {
+    size_t index = 0;
+    while (index < bufs.size()) {
+        const int64_t total_sent = network_internal::send_vectored(s, bufs.subspan(index));
+        if (total_sent <= 0) return false;
+        size_t total_left = size_t(total_sent);
+        while ((index < bufs.size()) && (total_left >= bufs[index].size())) {
+            total_left -= bufs[index].size();
+            index++;
+        }
+        if (total_left > 0) bufs[index] = bufs[index].subspan(total_left);
+    }
+    return true;
+}
+
+// Recent frames of a channel that its clients read from
+class Channel
+{
+public:
+    const uint32_t id;
+    const Restream_Audio_Type type;
+private:
+    std::vector<Frame_Ref> m_frames;
+    uint64_t m_next_sequence = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+public:
+    Channel(const uint32_t _id, const Restream_Audio_Type _type, const size_t total_frames)
+    : id(_id), type(_type), m_frames(std::max(total_frames, size_t(2))) {}
+    // The ADTS header and access unit are joined into one frame which is the only copy made for all clients
+    void push(tcb::span<const uint8_t> header, tcb::span<const uint8_t> data) {
+        auto lock = std::unique_lock(m_mutex);
+        auto& frame = m_frames[m_next_sequence % m_frames.size()];
+        // the oldest frame is reused if no client is still sending it
+        if ((frame == nullptr) || (frame.use_count() != 1)) {
+            frame = std::make_shared<Frame>();
+        } else {
+            // the last client released its reference with a release decrement so its reads happen before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        frame->resize(header.size() + data.size());
+        std::copy(header.begin(), header.end(), frame->begin());
+        std::copy(data.begin(), data.end(), frame->begin() + ptrdiff_t(header.size()));
+        m_next_sequence++;
+        lock.unlock();
+        m_cv.notify_all();
+    }
+    // Takes references to the frames after sequence without holding the lock while they are sent
+    // Returns the number of frames that were skipped since they were overwritten
+    uint64_t read(uint64_t& sequence, std::vector<Frame_Ref>& frames, const size_t total_prebuffer, const std::chrono::milliseconds timeout) {
+        auto lock = std::unique_lock(m_mutex);
+        m_cv.wait_for(lock, timeout, [this, &sequence]() { return sequence < m_next_sequence; });
+        uint64_t total_skipped = 0;
+        const uint64_t total_held = std::min(uint64_t(m_frames.size()), m_next_sequence);
+        if (sequence + total_held < m_next_sequence) {
+            const uint64_t total_behind = std::min(uint64_t(total_prebuffer), total_held);
+            total_skipped = (m_next_sequence - total_behind) - sequence;
+            sequence = m_next_sequence - total_behind;
+        }
+        while ((sequence < m_next_sequence) && (frames.size() < MAX_FRAMES_PER_SEND)) {
+            frames.push_back(m_frames[sequence % m_frames.size()]);
+            sequence++;
+        }
+        return total_skipped;
+    }
+    // New clients start a few frames behind so players can fill their buffers straight away
+    uint64_t get_start_sequence(const size_t total_prebuffer) {
+        auto lock = std::scoped_lock(m_mutex);
+        const uint64_t total_held = std::min(uint64_t(m_frames.size()), m_next_sequence);
+        return m_next_sequence - std::min(uint64_t(total_prebuffer), total_held);
+    }
+    void notify_all() { m_cv.notify_all(); }
+};
+
+}
+
+class Audio_Restream_Server
+{
+private:
+    using socket_t = network_internal::socket_t;
+    using Channel = restream_internal::Channel;
+    struct Client {
+        std::atomic<socket_t> socket{network_internal::INVALID_SOCKET_HANDLE};
+        std::atomic<bool> is_finished{false};
+        std::unique_ptr<std::thread> thread;
+    };
+    const size_t m_total_ring_frames;
+    const size_t m_total_prebuffer_frames;
+    std::atomic<socket_t> m_listen_socket{network_internal::INVALID_SOCKET_HANDLE};
+    std::atomic<bool> m_is_closed{false};
+    std::unique_ptr<std::thread> m_accept_thread;
+    std::map<uint32_t, std::shared_ptr<Channel>> m_channels;
+    std::mutex m_mutex_channels;
+    std::list<std::unique_ptr<Client>> m_clients;
+    std::mutex m_mutex_clients;
+    std::atomic<uint64_t> m_total_frames{0};
+    std::atomic<uint64_t> m_total_connections{0};
+    std::atomic<uint64_t> m_total_skipped_frames{0};
+public:
+    // total_ring_frames is how far a client can fall behind before it skips ahead
+    // total_prebuffer_frames are sent immediately to a client that connects or skips ahead
+    explicit Audio_Restream_Server(const size_t total_ring_frames=256, const size_t total_prebuffer_frames=16)
+    : m_total_ring_frames(std::max(total_ring_frames, size_t(2))),
+      m_total_prebuffer_frames(std::min(total_prebuffer_frames, m_total_ring_frames))
+    {}
+    ~Audio_Restream_Server() { close(); }
+    Audio_Restream_Server(Audio_Restream_Server&) = delete;
+    Audio_Restream_Server(Audio_Restream_Server&&) = delete;
+    Audio_Restream_Server& operator=(Audio_Restream_Server&) = delete;
+    Audio_Restream_Server& operator=(Audio_Restream_Server&&) = delete;
+    // Returns false if the port couldn't be bound
+    bool listen(const std::string& address, const std::string& port) {
+        using namespace network_internal;
+        if (!init_network()) return false;
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        hints.ai_flags = AI_PASSIVE;
+        struct addrinfo* results = nullptr;
+        const char* node = address.empty() ? nullptr : address.c_str();
+        if (getaddrinfo(node, port.c_str(), &hints, &results) != 0) return false;
+        socket_t listen_socket = INVALID_SOCKET_HANDLE;
+        for (auto* res = results; res != nullptr; res = res->ai_next) {
+            socket_t s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            if (s == INVALID_SOCKET_HANDLE) continue;
+            const int is_reuse = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&is_reuse), sizeof(is_reuse));
+            if ((bind(s, res->ai_addr, int(res->ai_addrlen)) != 0) || (::listen(s, 16) != 0)) {
+                network_internal::close_socket(s);
+                continue;
+            }
+            listen_socket = s;
+            break;
+        }
+        freeaddrinfo(results);
+        if (listen_socket == INVALID_SOCKET_HANDLE) return false;
+        m_listen_socket.store(listen_socket);
+        m_accept_thread = std::make_unique<std::thread>([this]() { run_accept(); });
+        return true;
+    }
+    // Disconnects all clients and waits for their threads to stop
+    void close() {
+        if (m_is_closed.exchange(true)) return;
+        shutdown_socket(m_listen_socket.exchange(network_internal::INVALID_SOCKET_HANDLE));
+        if (m_accept_thread != nullptr) m_accept_thread->join();
+        m_accept_thread = nullptr;
+        auto lock = std::scoped_lock(m_mutex_clients);
+        for (auto& client: m_clients) {
+            shutdown_socket(client->socket.exchange(network_internal::INVALID_SOCKET_HANDLE));
+        }
+        {
+            auto lock_channels = std::scoped_lock(m_mutex_channels);
+            for (auto& [_, channel]: m_channels) channel->notify_all();
+        }
+        for (auto& client: m_clients) {
+            if (client->thread != nullptr) client->thread->join();
+        }
+        m_clients.clear();
+    }
+    // Called by the thread decoding the channel
+    // The header is empty for MP2 frames and is the ADTS header for AAC access units
+    void push_frame(const uint32_t channel_id, const Restream_Audio_Type type, tcb::span<const uint8_t> header, tcb::span<const uint8_t> data) {
+        auto channel = get_channel(channel_id, type);
+        channel->push(header, data);
+        m_total_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    Restream_Statistics get_statistics() {
+        Restream_Statistics stats;
+        stats.total_frames = m_total_frames.load(std::memory_order_relaxed);
+        stats.total_connections = m_total_connections.load(std::memory_order_relaxed);
+        stats.total_skipped_frames = m_total_skipped_frames.load(std::memory_order_relaxed);
+        auto lock = std::scoped_lock(m_mutex_clients);
+        for (auto& client: m_clients) {
+            if (!client->is_finished.load()) stats.total_active_clients++;
+        }
+        return stats;
+    }
+private:
+    static void shutdown_socket(const socket_t s) {
+        if (s == network_internal::INVALID_SOCKET_HANDLE) return;
+        #if _WIN32
+        shutdown(s, SD_BOTH);
+        #else
+        shutdown(s, SHUT_RDWR);
+        #endif
+        network_internal::close_socket(s);
+    }
+
+    std::shared_ptr<Channel> get_channel(const uint32_t channel_id, const Restream_Audio_Type type) {
+        auto lock = std::scoped_lock(m_mutex_channels);
+        auto res = m_channels.find(channel_id);
+        if ((res != m_channels.end()) && (res->second->type == type)) return res->second;
+        // a subchannel that is reconfigured with another codec starts a new stream
+        auto channel = std::make_shared<Channel>(channel_id, type, m_total_ring_frames);
+        m_channels[channel_id] = channel;
+        return channel;
+    }
+
+    std::shared_ptr<Channel> find_channel(const uint32_t channel_id) {
+        auto lock = std::scoped_lock(m_mutex_channels);
+        auto res = m_channels.find(channel_id);
+        if (res == m_channels.end()) return nullptr;
+        return res->second;
+    }
+
+    void run_accept() {
+        using namespace network_internal;
+        while (!m_is_closed.load()) {
+            const socket_t listen_socket = m_listen_socket.load();
+            if (listen_socket == INVALID_SOCKET_HANDLE) break;
+            const socket_t s = accept(listen_socket, nullptr, nullptr);
+            if (s == INVALID_SOCKET_HANDLE) continue;
+            #if defined(SO_NOSIGPIPE)
+            const int is_no_sigpipe = 1;
+            setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<const char*>(&is_no_sigpipe), sizeof(is_no_sigpipe));
+            #endif
+            m_total_connections.fetch_add(1, std::memory_order_relaxed);
+            auto lock = std::scoped_lock(m_mutex_clients);
+            reap_clients();
+            if (m_is_closed.load()) {
+                network_internal::close_socket(s);
+                break;
+            }
+            auto client = std::make_unique<Client>();
+            client->socket.store(s);
+            auto* client_ptr = client.get();
+            client->thread = std::make_unique<std::thread>([this, client_ptr]() {
+                run_client(*client_ptr);
+                shutdown_socket(client_ptr->socket.exchange(INVALID_SOCKET_HANDLE));
+                client_ptr->is_finished.store(true);
+            });
+            m_clients.push_back(std::move(client));
+        }
+    }
+
+    // NOTE: Called with m_mutex_clients held
+    void reap_clients() {
+        for (auto it = m_clients.begin(); it != m_clients.end();) {
+            auto& client = *it;
+            if (!client->is_finished.load()) {
+                ++it;
+                continue;
+            }
+            client->thread->join();
+            it = m_clients.erase(it);
+        }
+    }
+
+    void run_client(Client& client) {
+        const socket_t s = client.socket.load();
+        if (s == network_internal::INVALID_SOCKET_HANDLE) return;
+        std::string path;
+        if (!read_request_path(s, path)) {
+            send_response(s, "400 Bad Request", "text/plain", "Bad request\n");
+            return;
+        }
+        if (path.compare("/") == 0) {
+            send_response(s, "200 OK", "text/plain", get_channel_listing());
+            return;
+        }
+        // paths can have an extension so players detect the format (/<id>.aac or /<id>.mp2)
+        const auto name = std::string_view(path).substr(1);
+        uint32_t channel_id = 0;
+        size_t total_digits = 0;
+        while ((total_digits < name.size()) && (total_digits < 9) && (name[total_digits] >= '0') && (name[total_digits] <= '9')) {
+            channel_id = channel_id*10 + uint32_t(name[total_digits]-'0');
+            total_digits++;
+        }
+        const bool is_valid_name = (total_digits > 0) && ((total_digits == name.size()) || (name[total_digits] == '.'));
+        auto channel = is_valid_name ? find_channel(channel_id) : nullptr;
+        if (channel == nullptr) {
+            send_response(s, "404 Not Found", "text/plain", "Channel not found\n");
+            return;
+        }
+        const char* content_type = (channel->type == Restream_Audio_Type::AAC_ADTS) ? "audio/aac" : "audio/mpeg";
+        const auto header = fmt::format(
+            "HTTP/1.0 200 OK\r\nContent-Type: {}\r\nCache-Control: no-cache\r\nConnection: close\r\nicy-name: Subchannel {}\r\n\r\n",
+            content_type, channel_id
+        );
+        if (!network_internal::send_all(s, { reinterpret_cast<const uint8_t*>(header.data()), header.size() })) return;
+        stream_channel(client, *channel);
+    }
+
+    void stream_channel(Client& client, Channel& channel) {
+        constexpr auto WAIT_TIMEOUT = std::chrono::milliseconds(500);
+        std::vector<restream_internal::Frame_Ref> frames;
+        std::vector<tcb::span<const uint8_t>> bufs;
+        frames.reserve(restream_internal::MAX_FRAMES_PER_SEND);
+        bufs.reserve(restream_internal::MAX_FRAMES_PER_SEND);
+        uint64_t sequence = channel.get_start_sequence(m_total_prebuffer_frames);
+        while (!m_is_closed.load()) {
+            const socket_t s = client.socket.load();
+            if (s == network_internal::INVALID_SOCKET_HANDLE) return;
+            const uint64_t total_skipped = channel.read(sequence, frames, m_total_prebuffer_frames, WAIT_TIMEOUT);
+            if (total_skipped > 0) m_total_skipped_frames.fetch_add(total_skipped, std::memory_order_relaxed);
+            if (frames.empty()) continue;
+            for (const auto& frame: frames) bufs.push_back({ frame->data(), frame->size() });
+            const bool is_sent = restream_internal::send_all_vectored(s, bufs);
+            bufs.clear();
+            // references are dropped straight away so the channel can reuse the frames
+            frames.clear();
+            if (!is_sent) return;
+        }
+    }
+
+    static bool read_request_path(const socket_t s, std::string& path) {
+        std::string request;
+        char buf[512];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            if (request.size() >= restream_internal::MAX_REQUEST_SIZE) return false;
+            const auto total_read = ::recv(s, buf, int(sizeof(buf)), 0);
+            if (total_read <= 0) return false;
+            request.append(buf, size_t(total_read));
+        }
+        constexpr std::string_view METHOD = "GET ";
+        if (request.compare(0, METHOD.size(), METHOD) != 0) return false;
+        const size_t path_start = METHOD.size();
+        const size_t path_end = request.find(' ', path_start);
+        if ((path_end == std::string::npos) || (path_end == path_start)) return false;
+        path = request.substr(path_start, path_end-path_start);
+        // query strings that players add to avoid caching are ignored
+        const size_t query_start = path.find('?');
+        if (query_start != std::string::npos) path.resize(query_start);
+        return !path.empty() && (path[0] == '/');
+    }
+
+    static void send_response(const socket_t s, std::string_view status, std::string_view content_type, std::string_view body) {
+        const auto response = fmt::format(
+            "HTTP/1.0 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+            status, content_type, body.size(), body
+        );
+        network_internal::send_all(s, { reinterpret_cast<const uint8_t*>(response.data()), response.size() });
+    }
+
+    std::string get_channel_listing() {
+        std::string listing;
+        auto lock = std::scoped_lock(m_mutex_channels);
+        for (const auto& [id, channel]: m_channels) {
+            const char* extension = (channel->type == Restream_Audio_Type::AAC_ADTS) ? "aac" : "mp2";
+            listing += fmt::format("/{}.{}\n", id, extension);
+        }
+        return listing;
+    }
+};
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+#include "utility/span.h"
+#include "./app_shared_memory_ring.h"
+
+// Flat snapshot of a DAB_Database that other processes map and query in place without parsing it
+// Snapshot = [header][table]...[table] where each table is an array of fixed size records at an offset
+//   Entities without heap storage are stored as they are so readers get spans of Ensemble, Service, etc...
+//   Services on other bearers are flattened with their frequencies in a shared frequency table
+// The header has the size of each record so a reader built with a different layout rejects the snapshot
+// NOTE: Records are in native byte order since readers run on the same host
+
+enum class Database_Snapshot_Table: uint32_t {
+    ENSEMBLE = 0,
+    SERVICES,
+    SERVICE_COMPONENTS,
+    SUBCHANNELS,
+    LINK_SERVICES,
+    FM_SERVICES,
+    DRM_SERVICES,
+    AMSS_SERVICES,
+    OTHER_ENSEMBLES,
+    FREQUENCIES,
+    TOTAL,
+};
+
+// FM, DRM and AMSS services whose frequencies are [frequency_index, frequency_index+total_frequencies)
+struct Database_Snapshot_Other_Service {
+    uint32_t id = 0;
+    lsn_t linkage_set_number = 0;
+    bool is_time_compensated = false;
+    bool is_complete = false;
+    uint32_t frequency_index = 0;
+    uint32_t total_frequencies = 0;
+};
+
+struct Database_Snapshot_Table_Entry {
+    uint32_t offset;
+    uint32_t total_records;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+struct Database_Snapshot_Header {
+    static constexpr uint32_t MAGIC = 0x44424144; // "DABD"
+    static constexpr uint32_t VERSION = 1;
+    uint32_t magic;
+    uint32_t version;
+    // BasicRadio::GetDatabaseVersion() when the snapshot was taken
+    uint64_t database_version;
+    uint32_t total_bytes;
+    uint32_t reserved;
+    Database_Snapshot_Table_Entry tables[size_t(Database_Snapshot_Table::TOTAL)];
+};
+
+namespace database_snapshot_internal {
+
+static constexpr size_t TABLE_ALIGN = 8;
+
+template <typename T>
+static constexpr size_t get_record_size() {
+    static_assert(std::is_trivially_copyable_v<T>, "Database snapshot records are copied as they are");
+    return sizeof(T);
+}
+
+static inline size_t get_table_size(const Database_Snapshot_Table_Entry& entry) {
+    return size_t(entry.total_records)*size_t(entry.record_size);
+}
+
+}
+
+// Read only view of a snapshot that points into its buffer
+class Database_Snapshot_View
+{
+private:
+    const uint8_t* m_data = nullptr;
+    const Database_Snapshot_Header* m_header = nullptr;
+public:
+    // Returns false if the buffer isn't a complete snapshot with the same record layout as this reader
+    bool open(tcb::span<const uint8_t> buf) {
+        using namespace database_snapshot_internal;
+        m_data = nullptr;
+        m_header = nullptr;
+        if (buf.size() < sizeof(Database_Snapshot_Header)) return false;
+        const auto* header = reinterpret_cast<const Database_Snapshot_Header*>(buf.data());
+        if ((header->magic != Database_Snapshot_Header::MAGIC) || (header->version != Database_Snapshot_Header::VERSION)) return false;
+        if (size_t(header->total_bytes) > buf.size()) return false;
+        const size_t record_sizes[size_t(Database_Snapshot_Table::TOTAL)] = {
+            get_record_size<Ensemble>(),
+            get_record_size<Service>(),
+            get_record_size<ServiceComponent>(),
+            get_record_size<Subchannel>(),
+            get_record_size<LinkService>(),
+            get_record_size<Database_Snapshot_Other_Service>(),
+            get_record_size<Database_Snapshot_Other_Service>(),
+            get_record_size<Database_Snapshot_Other_Service>(),
+            get_record_size<OtherEnsemble>(),
+            get_record_size<freq_t>(),
+        };
+        for (size_t i = 0; i < size_t(Database_Snapshot_Table::TOTAL); i++) {
+            const auto& entry = header->tables[i];
+            if (size_t(entry.record_size) != record_sizes[i]) return false;
+            if ((entry.offset % TABLE_ALIGN) != 0) return false;
+            if ((size_t(entry.offset) + get_table_size(entry)) > size_t(header->total_bytes)) return false;
+        }
+        if (header->tables[size_t(Database_Snapshot_Table::ENSEMBLE)].total_records != 1) return false;
+        m_data = buf.data();
+        m_header = header;
+        return true;
+    }
+    uint64_t get_database_version() const { return m_header->database_version; }
+    const Ensemble& get_ensemble() const { return get_table<Ensemble>(Database_Snapshot_Table::ENSEMBLE)[0]; }
+    tcb::span<const Service> get_services() const { return get_table<Service>(Database_Snapshot_Table::SERVICES); }
+    tcb::span<const ServiceComponent> get_service_components() const { return get_table<ServiceComponent>(Database_Snapshot_Table::SERVICE_COMPONENTS); }
+    tcb::span<const Subchannel> get_subchannels() const { return get_table<Subchannel>(Database_Snapshot_Table::SUBCHANNELS); }
+    tcb::span<const LinkService> get_link_services() const { return get_table<LinkService>(Database_Snapshot_Table::LINK_SERVICES); }
+    tcb::span<const Database_Snapshot_Other_Service> get_fm_services() const { return get_table<Database_Snapshot_Other_Service>(Database_Snapshot_Table::FM_SERVICES); }
+    tcb::span<const Database_Snapshot_Other_Service> get_drm_services() const { return get_table<Database_Snapshot_Other_Service>(Database_Snapshot_Table::DRM_SERVICES); }
+    tcb::span<const Database_Snapshot_Other_Service> get_amss_services() const { return get_table<Database_Snapshot_Other_Service>(Database_Snapshot_Table::AMSS_SERVICES); }
+    tcb::span<const OtherEnsemble> get_other_ensembles() const { return get_table<OtherEnsemble>(Database_Snapshot_Table::OTHER_ENSEMBLES); }
+    tcb::span<const freq_t> get_frequencies(const Database_Snapshot_Other_Service& service) const {
+        const auto frequencies = get_table<freq_t>(Database_Snapshot_Table::FREQUENCIES);
+        if ((size_t(service.frequency_index) + size_t(service.total_frequencies)) > frequencies.size()) return {};
+        return frequencies.subspan(service.frequency_index, service.total_frequencies);
+    }
+    // Linear search since databases only have tens of entries
+    const Service* get_service(const service_id_t service_reference) const {
+        for (const auto& service: get_services()) {
+            if (service.reference == service_reference) return &service;
+        }
+        return nullptr;
+    }
+    const ServiceComponent* get_service_component_subchannel(const subchannel_id_t subchannel_id) const {
+        for (const auto& component: get_service_components()) {
+            if (component.subchannel_id == subchannel_id) return &component;
+        }
+        return nullptr;
+    }
+private:
+    template <typename T>
+    tcb::span<const T> get_table(const Database_Snapshot_Table table) const {
+        const auto& entry = m_header->tables[size_t(table)];
+        return { reinterpret_cast<const T*>(m_data + entry.offset), size_t(entry.total_records) };
+    }
+};
+
+// Serialises the database into a reusable buffer
+static inline void serialise_database_snapshot(const DAB_Database& db, const uint64_t database_version, std::vector<uint8_t>& buf) {
+    using namespace database_snapshot_internal;
+    std::vector<Database_Snapshot_Other_Service> other_services[3];
+    std::vector<freq_t> frequencies;
+    const auto flatten = [&frequencies](auto& dest, const auto& services, auto&& get_id, auto&& get_lsn) {
+        for (const auto& service: services) {
+            Database_Snapshot_Other_Service flat;
+            flat.id = uint32_t(get_id(service));
+            flat.linkage_set_number = get_lsn(service);
+            flat.is_time_compensated = service.is_time_compensated;
+            flat.is_complete = service.is_complete;
+            flat.frequency_index = uint32_t(frequencies.size());
+            flat.total_frequencies = uint32_t(service.frequencies.size());
+            frequencies.insert(frequencies.end(), service.frequencies.begin(), service.frequencies.end());
+            dest.push_back(flat);
+        }
+    };
+    flatten(other_services[0], db.fm_services,
+        [](const FM_Service& s) { return s.RDS_PI_code; }, [](const FM_Service& s) { return s.linkage_set_number; });
+    flatten(other_services[1], db.drm_services,
+        [](const DRM_Service& s) { return s.drm_code; }, [](const DRM_Service& s) { return s.linkage_set_number; });
+    flatten(other_services[2], db.amss_services,
+        [](const AMSS_Service& s) { return s.amss_code; }, [](const AMSS_Service&) { return lsn_t(0); });
+
+    Database_Snapshot_Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = Database_Snapshot_Header::MAGIC;
+    header.version = Database_Snapshot_Header::VERSION;
+    header.database_version = database_version;
+    size_t offset = (sizeof(Database_Snapshot_Header) + TABLE_ALIGN-1) & ~(TABLE_ALIGN-1);
+    buf.clear();
+    buf.resize(offset, 0);
+    const auto push_table = [&](const Database_Snapshot_Table table, const auto* records, const size_t total_records) {
+        using T = std::remove_cv_t<std::remove_pointer_t<decltype(records)>>;
+        auto& entry = header.tables[size_t(table)];
+        entry.offset = uint32_t(offset);
+        entry.total_records = uint32_t(total_records);
+        entry.record_size = uint32_t(get_record_size<T>());
+        const size_t total_bytes = total_records*sizeof(T);
+        offset = (offset + total_bytes + TABLE_ALIGN-1) & ~(TABLE_ALIGN-1);
+        buf.resize(offset, 0);
+        if (total_bytes > 0) memcpy(buf.data() + entry.offset, records, total_bytes);
+    };
+    push_table(Database_Snapshot_Table::ENSEMBLE, &db.ensemble, 1);
+    push_table(Database_Snapshot_Table::SERVICES, db.services.data(), db.services.size());
+    push_table(Database_Snapshot_Table::SERVICE_COMPONENTS, db.service_components.data(), db.service_components.size());
+    push_table(Database_Snapshot_Table::SUBCHANNELS, db.subchannels.data(), db.subchannels.size());
+    push_table(Database_Snapshot_Table::LINK_SERVICES, db.link_services.data(), db.link_services.size());
+    push_table(Database_Snapshot_Table::FM_SERVICES, other_services[0].data(), other_services[0].size());
+    push_table(Database_Snapshot_Table::DRM_SERVICES, other_services[1].data(), other_services[1].size());
+    push_table(Database_Snapshot_Table::AMSS_SERVICES, other_services[2].data(), other_services[2].size());
+    push_table(Database_Snapshot_Table::OTHER_ENSEMBLES, db.other_ensembles.data(), db.other_ensembles.size());
+    push_table(Database_Snapshot_Table::FREQUENCIES, frequencies.data(), frequencies.size());
+    header.total_bytes = uint32_t(buf.size());
+    memcpy(buf.data(), &header, sizeof(header));
+}
+
+// Snapshot is written to a temporary file and renamed so a reader that maps the file never sees a partial snapshot
+static inline bool save_database_snapshot(const std::string& filename, tcb::span<const uint8_t> snapshot) {
+    const std::string temp_filename = filename + ".tmp";
+    FILE* fp = fopen(temp_filename.c_str(), "wb");
+    if (fp == nullptr) return false;
+    bool is_written = fwrite(snapshot.data(), 1, snapshot.size(), fp) == snapshot.size();
+    is_written = (fclose(fp) == 0) && is_written;
+    if (!is_written) {
+        remove(temp_filename.c_str());
+        return false;
+    }
+#if _WIN32
+    remove(filename.c_str());
+#endif
+    return rename(temp_filename.c_str(), filename.c_str()) == 0;
+}
+
+// Header of the shared memory that holds the latest snapshot
+// The snapshot is guarded by a sequence number like "utility/seqlock.h" so readers query it in place
+struct Database_Snapshot_Region_Header {
+    static constexpr uint32_t MAGIC = 0x52424144; // "DABR"
+    static constexpr uint32_t VERSION = 1;
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t capacity;
+    // odd while the snapshot is being written
+    alignas(64) std::atomic<uint64_t> sequence;
+    // copy of the snapshot's database version so readers check for changes without reading the snapshot
+    std::atomic<uint64_t> database_version;
+};
+
+class Database_Snapshot_Writer: public SharedMemoryMapping
+{
+private:
+    Database_Snapshot_Region_Header* m_header = nullptr;
+    std::vector<uint8_t> m_buffer;
+    std::string m_filename;
+    size_t m_total_oversized = 0;
+public:
+    // capacity is the largest snapshot that can be published to the shared memory
+    bool create(const std::string& name, const size_t capacity) {
+        m_header = nullptr;
+        if (!SharedMemoryMapping::create(name, get_snapshot_offset() + capacity)) return false;
+        auto* header = new (m_data) Database_Snapshot_Region_Header;
+        header->version = Database_Snapshot_Region_Header::VERSION;
+        header->capacity = uint64_t(capacity);
+        header->sequence.store(0, std::memory_order_relaxed);
+        header->database_version.store(0, std::memory_order_relaxed);
+        header->magic.store(Database_Snapshot_Region_Header::MAGIC, std::memory_order_release);
+        m_header = header;
+        return true;
+    }
+    // Each snapshot is also saved to this file if it isn't empty
+    void set_filename(std::string filename) { m_filename = std::move(filename); }
+    // Called from one thread whenever the database changes
+    void publish(const DAB_Database& db, const uint64_t database_version) {
+        serialise_database_snapshot(db, database_version, m_buffer);
+        if (!m_filename.empty() && !save_database_snapshot(m_filename, m_buffer)) {
+            fprintf(stderr, "Failed to save database snapshot to '%s'\n", m_filename.c_str());
+        }
+        if (m_header == nullptr) return;
+        if (m_buffer.size() > size_t(m_header->capacity)) {
+            m_total_oversized++;
+            return;
+        }
+        const uint64_t sequence = m_header->sequence.load(std::memory_order_relaxed);
+        m_header->sequence.store(sequence+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(m_data + get_snapshot_offset(), m_buffer.data(), m_buffer.size());
+        m_header->database_version.store(database_version, std::memory_order_relaxed);
+        m_header->sequence.store(sequence+2, std::memory_order_release);
+    }
+    size_t get_total_oversized() const { return m_total_oversized; }
+    static constexpr size_t get_snapshot_offset() {
+        return (sizeof(Database_Snapshot_Region_Header) + 63) & ~size_t(63);
+    }
+};
+
+class Database_Snapshot_Reader: public SharedMemoryMapping
+{
+public:
+    enum class Result { OK, EMPTY, OVERWRITTEN };
+private:
+    const Database_Snapshot_Region_Header* m_header = nullptr;
+public:
+    bool open(const std::string& name) {
+        m_header = nullptr;
+        if (!SharedMemoryMapping::open(name)) return false;
+        if (m_size < Database_Snapshot_Writer::get_snapshot_offset()) {
+            close();
+            return false;
+        }
+        const auto* header = reinterpret_cast<const Database_Snapshot_Region_Header*>(m_data);
+        if ((header->magic.load(std::memory_order_acquire) != Database_Snapshot_Region_Header::MAGIC) ||
+            (header->version != Database_Snapshot_Region_Header::VERSION) ||
+            (m_size < Database_Snapshot_Writer::get_snapshot_offset() + size_t(header->capacity)))
+        {
+            close();
+            return false;
+        }
+        m_header = header;
+        return true;
+    }
+    // Compare against the last version that was read to check for changes
+    uint64_t get_database_version() const {
+        if (m_header == nullptr) return 0;
+        return m_header->database_version.load(std::memory_order_acquire);
+    }
+    // Calls on_snapshot with a view into the mapping that is only valid inside the callback
+    // If OVERWRITTEN is returned the snapshot changed while it was being read, so anything derived from it must be discarded
+    template <typename F>
+    Result read(F&& on_snapshot) {
+        if (m_header == nullptr) return Result::EMPTY;
+        const uint64_t sequence = m_header->sequence.load(std::memory_order_acquire);
+        if (sequence == 0) return Result::EMPTY;
+        if ((sequence % 2) != 0) return Result::OVERWRITTEN;
+        const auto buf = tcb::span<const uint8_t>(m_data + Database_Snapshot_Writer::get_snapshot_offset(), size_t(m_header->capacity));
+        Database_Snapshot_View view;
+        const bool is_valid = view.open(buf);
+        if (is_valid) on_snapshot(view);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_header->sequence.load(std::memory_order_relaxed) != sequence) return Result::OVERWRITTEN;
+        return is_valid ? Result::OK : Result::EMPTY;
+    }
+};
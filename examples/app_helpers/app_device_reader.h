@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "./app_io_buffers.h"
+#include "./app_ofdm_blocks.h"
+
+struct Device_Block_Info {
+    // when the usb transfer was handed to us
+    std::chrono::steady_clock::time_point timestamp;
+    // index of the first sample since the reader was created including samples that were dropped
+    uint64_t sample_index = 0;
+    size_t total_bytes = 0;
+};
+
+struct Device_Reader_Statistics {
+    uint64_t total_transfers = 0;
+    // transfers dropped because every block was still held by the reader
+    uint64_t total_overruns = 0;
+    uint64_t total_dropped_bytes = 0;
+    // most blocks waiting to be read at once
+    size_t max_blocks_used = 0;
+};
+
+// Hands the transfers from the device's callback to the demodulator thread through a pool of blocks
+// 1. The callback copies each transfer into a free block of a lock free ring and returns straight away
+//    If there are no free blocks the transfer is dropped and counted instead of blocking the usb thread
+// 2. read_span() gives out views into the oldest block which is released once it has been fully read
+// NOTE: librtlsdr resubmits its transfer buffers when the callback returns so they are copied once here
+//       The callback can be called from more than one device while a device is being replaced
+class Device_Reader: public SpanInputBuffer<RawIQ>
+{
+private:
+    static constexpr auto POLL_PERIOD = std::chrono::milliseconds(1);
+    SPSC_Frame_Ring<uint8_t> m_ring;
+    // info of the block in each slot of the ring
+    std::vector<Device_Block_Info> m_block_infos;
+    // producer
+    std::atomic<bool> m_is_writing{false};
+    uint64_t m_total_written = 0;
+    uint64_t m_write_sample_index = 0;
+    std::atomic<uint64_t> m_total_transfers{0};
+    std::atomic<uint64_t> m_total_overruns{0};
+    std::atomic<uint64_t> m_total_dropped_bytes{0};
+    std::atomic<size_t> m_max_blocks_used{0};
+    // consumer
+    uint64_t m_total_read = 0;
+    bool m_is_holding_block = false;
+    tcb::span<const uint8_t> m_read_block;
+    size_t m_read_offset = 0;
+    Device_Block_Info m_read_info;
+public:
+    // block_size should be the transfer size of the device so each transfer takes one block
+    Device_Reader(const size_t block_size, const size_t total_blocks)
+    : m_ring(block_size, total_blocks), m_block_infos(total_blocks) {}
+    ~Device_Reader() override { close(); }
+    Device_Reader(Device_Reader&) = delete;
+    Device_Reader(Device_Reader&&) = delete;
+    Device_Reader& operator=(Device_Reader&) = delete;
+    Device_Reader& operator=(Device_Reader&&) = delete;
+
+    void close() { m_ring.close(); }
+    size_t get_block_size() const { return m_ring.get_frame_length(); }
+    size_t get_total_blocks() const { return m_ring.get_total_slots(); }
+    size_t get_total_blocks_used() const { return m_ring.get_total_used(); }
+    Device_Reader_Statistics get_statistics() const {
+        Device_Reader_Statistics stats;
+        stats.total_transfers = m_total_transfers.load(std::memory_order_relaxed);
+        stats.total_overruns = m_total_overruns.load(std::memory_order_relaxed);
+        stats.total_dropped_bytes = m_total_dropped_bytes.load(std::memory_order_relaxed);
+        stats.max_blocks_used = m_max_blocks_used.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // Producer: called from the device's data callback
+    // Returns the size of the transfer even if it was dropped so the device keeps running
+    size_t write(tcb::span<const uint8_t> transfer) {
+        if (m_ring.is_closed()) return 0;
+        const auto timestamp = std::chrono::steady_clock::now();
+        while (m_is_writing.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        m_total_transfers.fetch_add(1, std::memory_order_relaxed);
+        // transfers are only larger than a block if the device's transfer size doesn't match
+        const size_t block_size = m_ring.get_frame_length();
+        for (size_t offset = 0; offset < transfer.size(); offset += block_size) {
+            const auto src = transfer.subspan(offset, std::min(block_size, transfer.size()-offset));
+            auto block = m_ring.acquire_write();
+            if (block.empty()) {
+                m_total_overruns.fetch_add(1, std::memory_order_relaxed);
+                m_total_dropped_bytes.fetch_add(src.size(), std::memory_order_relaxed);
+            } else {
+                std::copy(src.begin(), src.end(), block.begin());
+                auto& info = m_block_infos[m_total_written % m_block_infos.size()];
+                info.timestamp = timestamp;
+                info.sample_index = m_write_sample_index;
+                info.total_bytes = src.size();
+                m_ring.commit_write();
+                m_total_written++;
+                const size_t total_used = m_ring.get_total_used();
+                if (total_used > m_max_blocks_used.load(std::memory_order_relaxed)) {
+                    m_max_blocks_used.store(total_used, std::memory_order_relaxed);
+                }
+            }
+            m_write_sample_index += src.size()/sizeof(RawIQ);
+        }
+        m_is_writing.store(false, std::memory_order_release);
+        return transfer.size();
+    }
+
+    // Consumer: returns up to max_length samples from the current block
+    // Waits for the next block if the current one has been read and returns an empty span once closed
+    tcb::span<const RawIQ> read_span(size_t max_length) override {
+        if (m_read_offset >= m_read_block.size()) {
+            if (!acquire_next_block()) return {};
+        }
+        const size_t total_samples = std::min(max_length, (m_read_block.size()-m_read_offset)/sizeof(RawIQ));
+        auto samples = tcb::span(
+            reinterpret_cast<const RawIQ*>(m_read_block.data() + m_read_offset),
+            total_samples
+        );
+        m_read_offset += total_samples*sizeof(RawIQ);
+        return samples;
+    }
+    size_t read(tcb::span<RawIQ> dest) override {
+        size_t total_read = 0;
+        while (total_read < dest.size()) {
+            const auto src = read_span(dest.size()-total_read);
+            if (src.empty()) break;
+            std::copy(src.begin(), src.end(), dest.begin()+total_read);
+            total_read += src.size();
+        }
+        return total_read;
+    }
+    // Info of the block that the last span was read from
+    const Device_Block_Info& get_read_block_info() const { return m_read_info; }
+private:
+    bool acquire_next_block() {
+        m_read_block = {};
+        m_read_offset = 0;
+        while (true) {
+            if (m_is_holding_block) {
+                m_ring.release_read();
+                m_total_read++;
+                m_is_holding_block = false;
+            }
+            // the device can write its last blocks right before closing so only stop once closed and drained
+            const bool is_closed = m_ring.is_closed();
+            const auto block = m_ring.acquire_read();
+            if (block.empty()) {
+                if (is_closed) return false;
+                std::this_thread::sleep_for(POLL_PERIOD);
+                continue;
+            }
+            m_read_info = m_block_infos[m_total_read % m_block_infos.size()];
+            // drop the odd byte of a partial transfer
+            const size_t total_bytes = m_read_info.total_bytes - (m_read_info.total_bytes % sizeof(RawIQ));
+            m_read_block = block.first(total_bytes);
+            m_is_holding_block = true;
+            if (!m_read_block.empty()) return true;
+        }
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include "basic_radio/basic_ensemble_config.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+
+// Channels of each ensemble that was decoded so tuning back to it can create them before the FIC is decoded
+// Entries are keyed by frequency and keep the ensemble id so BasicRadio can discard them if another ensemble is found
+// File = one line per channel with tab separated fields
+//        [frequency] [ensemble_id] [subchannel_id] [start_address] [length] [is_uep] [uep_prot_index]
+//        [eep_prot_level] [eep_type] [fec_scheme] [transport_mode] [audio_service_type] [data_service_type]
+// NOTE: This can be accessed from any thread
+class App_Ensemble_Config_Cache
+{
+private:
+    const std::string m_filename;
+    std::mutex m_mutex;
+    std::map<uint32_t, Basic_Ensemble_Config> m_entries;
+public:
+    // An empty filename keeps the cache in memory only
+    explicit App_Ensemble_Config_Cache(std::string filename=""): m_filename(std::move(filename)) {
+        Load();
+    }
+    std::optional<Basic_Ensemble_Config> Get(const uint32_t frequency) {
+        auto lock = std::scoped_lock(m_mutex);
+        auto res = m_entries.find(frequency);
+        if (res == m_entries.end()) return std::nullopt;
+        return res->second;
+    }
+    // Written to disk straight away since retuning is rare
+    // An ensemble without any channels is ignored so a weak signal doesn't erase a good entry
+    void Set(const uint32_t frequency, const Basic_Ensemble_Config& config) {
+        if (config.channels.empty()) return;
+        auto lock = std::scoped_lock(m_mutex);
+        m_entries[frequency] = config;
+        Save();
+    }
+private:
+    void Load() {
+        if (m_filename.empty()) return;
+        FILE* fp = fopen(m_filename.c_str(), "r");
+        if (fp == nullptr) return;
+        unsigned int frequency, ensemble_id, id, start_address, length, is_uep, uep_prot_index;
+        unsigned int eep_prot_level, eep_type, fec_scheme, transport_mode, audio_service_type, data_service_type;
+        while (true) {
+            const int total_read = fscanf(
+                fp, " %u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u",
+                &frequency, &ensemble_id, &id, &start_address, &length, &is_uep, &uep_prot_index,
+                &eep_prot_level, &eep_type, &fec_scheme, &transport_mode, &audio_service_type, &data_service_type
+            );
+            if (total_read != 13) break;
+            Basic_Cached_Channel channel{subchannel_id_t(id)};
+            channel.subchannel.start_address = subchannel_addr_t(start_address);
+            channel.subchannel.length = subchannel_size_t(length);
+            channel.subchannel.is_uep = (is_uep != 0);
+            channel.subchannel.uep_prot_index = uep_protection_index_t(uep_prot_index);
+            channel.subchannel.eep_prot_level = eep_protection_level_t(eep_prot_level);
+            channel.subchannel.eep_type = EEP_Type(eep_type);
+            channel.subchannel.fec_scheme = FEC_Scheme(fec_scheme);
+            channel.subchannel.is_complete = true;
+            channel.transport_mode = TransportMode(transport_mode);
+            channel.audio_service_type = AudioServiceType(audio_service_type);
+            channel.data_service_type = DataServiceType(data_service_type);
+            auto& config = m_entries[frequency];
+            config.ensemble_id = ensemble_id_t(ensemble_id);
+            config.channels.push_back(channel);
+        }
+        fclose(fp);
+    }
+    void Save() {
+        if (m_filename.empty()) return;
+        FILE* fp = fopen(m_filename.c_str(), "w");
+        if (fp == nullptr) {
+            fprintf(stderr, "Failed to open ensemble config cache '%s' for writing\n", m_filename.c_str());
+            return;
+        }
+        for (const auto& [frequency, config]: m_entries) {
+            for (const auto& channel: config.channels) {
+                const auto& subchannel = channel.subchannel;
+                fprintf(
+                    fp, "%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n",
+                    unsigned(frequency), unsigned(config.ensemble_id), unsigned(subchannel.id),
+                    unsigned(subchannel.start_address), unsigned(subchannel.length), unsigned(subchannel.is_uep),
+                    unsigned(subchannel.uep_prot_index), unsigned(subchannel.eep_prot_level),
+                    unsigned(subchannel.eep_type), unsigned(subchannel.fec_scheme), unsigned(channel.transport_mode),
+                    unsigned(channel.audio_service_type), unsigned(channel.data_service_type)
+                );
+            }
+        }
+        fclose(fp);
+    }
+};
@@ -15,6 +15,16 @@ struct InputBuffer {
     virtual size_t read(tcb::span<T> dest) = 0;
 };
 
+// Input that hands out views into its own storage instead of copying into dest
+// NOTE: The returned span is valid until the next call to read_span()
+template <typename T>
+struct SpanInputBuffer: public InputBuffer<T> {
+    ~SpanInputBuffer() override {}
+    virtual tcb::span<const T> read_span(size_t max_length) = 0;
+    // True if returned spans stay valid until the input is destroyed, e.g. a memory mapped file
+    virtual bool get_is_span_persistent() const { return false; }
+};
+
 template <typename T>
 struct OutputBuffer {
     virtual ~OutputBuffer() {}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_audio_controls.h"
+#include "basic_radio/basic_radio.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "./app_multi_ensemble.h"
+
+struct Linked_Service_Config {
+    // an ensemble can take over a service once its demodulator has this modulation error ratio
+    float min_mer_db = 8.0f;
+};
+
+struct Linked_Service_Status {
+    // services carried by more than one ensemble
+    size_t total_groups = 0;
+    // audio channels kept on standby since another ensemble decodes the same service
+    size_t total_standby = 0;
+    // times a service moved to another ensemble since its ensemble lost sync
+    size_t total_failovers = 0;
+};
+
+// Decodes each service that several ensembles carry on only one of them
+// DOC: ETSI EN 300 401
+// Clause 8.1.15: Service linking information
+// Services are the same if they have the same service id or are in the same active hard linkage set (FIG 0/6)
+// The other instances are kept on standby so they are still demodulated into the CIF history without any decoding
+// If the ensemble decoding a service loses sync then the instance on the ensemble with the best signal takes over
+class Linked_Service_Coordinator
+{
+private:
+    struct Instance {
+        size_t ensemble_index;
+        service_id_t service_reference;
+        subchannel_id_t subchannel_id;
+    };
+    struct Group {
+        std::vector<Instance> instances;
+        // index into instances which is decoded
+        size_t primary = 0;
+    };
+    Multi_Ensemble_Runtime& m_runtime;
+    const Linked_Service_Config m_config;
+    // enables the outputs of a channel that is decoded
+    const std::function<void(Basic_Audio_Controls&)> m_enable_controls;
+    std::vector<uint64_t> m_database_versions;
+    std::vector<Group> m_groups;
+    size_t m_total_failovers = 0;
+    // standby subchannels of each ensemble which is read by the radio threads as channels are created
+    std::mutex m_mutex_standby;
+    std::vector<std::unordered_map<subchannel_id_t, bool>> m_is_standby;
+    // standby state last applied to the controls of each channel
+    std::vector<std::unordered_map<subchannel_id_t, bool>> m_applied_is_standby;
+public:
+    Linked_Service_Coordinator(
+        Multi_Ensemble_Runtime& runtime, const Linked_Service_Config& config,
+        std::function<void(Basic_Audio_Controls&)> enable_controls)
+    : m_runtime(runtime), m_config(config), m_enable_controls(std::move(enable_controls))
+    {
+        const size_t total_ensembles = m_runtime.get_total_ensembles();
+        m_database_versions.resize(total_ensembles, 0);
+        m_is_standby.resize(total_ensembles);
+        m_applied_is_standby.resize(total_ensembles);
+        for (size_t i = 0; i < total_ensembles; i++) {
+            // NOTE: Channels are created with the radio's mutex held which update() also locks to apply changes
+            m_runtime.get_radio_block(i).get_basic_radio().On_Audio_Channel().Attach(
+                [this, i](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+                    const bool is_standby = get_is_standby(i, subchannel_id);
+                    apply_controls(channel.GetControls(), is_standby);
+                    m_applied_is_standby[i][subchannel_id] = is_standby;
+                }
+            );
+        }
+    }
+    Linked_Service_Coordinator(Linked_Service_Coordinator&) = delete;
+    Linked_Service_Coordinator(Linked_Service_Coordinator&&) = delete;
+    Linked_Service_Coordinator& operator=(Linked_Service_Coordinator&) = delete;
+    Linked_Service_Coordinator& operator=(Linked_Service_Coordinator&&) = delete;
+    // called periodically from one thread to regroup services and fail over from ensembles that lost sync
+    void update() {
+        const size_t total_ensembles = m_runtime.get_total_ensembles();
+        bool is_database_changed = false;
+        for (size_t i = 0; i < total_ensembles; i++) {
+            const uint64_t version = m_runtime.get_radio_block(i).get_basic_radio().GetDatabaseVersion();
+            if (version == m_database_versions[i]) continue;
+            m_database_versions[i] = version;
+            is_database_changed = true;
+        }
+        if (is_database_changed) update_groups();
+
+        std::vector<OFDM_Demod::Status> ofdm_status(total_ensembles);
+        std::vector<OFDM_Demod_Signal_Quality> signal_quality(total_ensembles);
+        for (size_t i = 0; i < total_ensembles; i++) {
+            const auto& ofdm_demod = m_runtime.get_ofdm_block(i).get_ofdm_demod();
+            ofdm_status[i] = ofdm_demod.GetStatus();
+            signal_quality[i] = ofdm_demod.GetSignalQuality();
+        }
+        const auto get_is_healthy = [&](const size_t index) {
+            if (ofdm_status[index].state != OFDM_Demod::State::READING_SYMBOLS) return false;
+            // NOTE: Signal quality isn't measured if it was disabled in the demodulator config
+            if (signal_quality[index].total_frames == 0) return true;
+            return signal_quality[index].mer_db >= m_config.min_mer_db;
+        };
+        for (auto& group: m_groups) {
+            if (get_is_healthy(group.instances[group.primary].ensemble_index)) continue;
+            size_t best_index = group.primary;
+            float best_mer_db = -1.0f;
+            for (size_t j = 0; j < group.instances.size(); j++) {
+                const size_t ensemble_index = group.instances[j].ensemble_index;
+                if (!get_is_healthy(ensemble_index)) continue;
+                const float mer_db = signal_quality[ensemble_index].mer_db;
+                if (mer_db <= best_mer_db) continue;
+                best_index = j;
+                best_mer_db = mer_db;
+            }
+            if (best_index == group.primary) continue;
+            group.primary = best_index;
+            m_total_failovers++;
+        }
+        update_standby();
+    }
+    // NOTE: Call this from the thread calling update()
+    Linked_Service_Status get_status() {
+        auto lock = std::scoped_lock(m_mutex_standby);
+        Linked_Service_Status status;
+        status.total_groups = m_groups.size();
+        status.total_failovers = m_total_failovers;
+        for (const auto& is_standby: m_is_standby) {
+            status.total_standby += size_t(std::count_if(
+                is_standby.begin(), is_standby.end(),
+                [](const auto& entry) { return entry.second; }));
+        }
+        return status;
+    }
+private:
+    bool get_is_standby(const size_t ensemble_index, const subchannel_id_t subchannel_id) {
+        auto lock = std::scoped_lock(m_mutex_standby);
+        const auto& is_standby = m_is_standby[ensemble_index];
+        auto res = is_standby.find(subchannel_id);
+        if (res == is_standby.end()) return false;
+        return res->second;
+    }
+    void apply_controls(Basic_Audio_Controls& controls, const bool is_standby) {
+        if (is_standby) {
+            controls.StopAll();
+            controls.SetIsStandby(true);
+        } else {
+            controls.SetIsStandby(false);
+            m_enable_controls(controls);
+        }
+    }
+    // Services of every ensemble are merged if they share a service id or hard linkage set
+    void update_groups() {
+        std::vector<Instance> instances;
+        // union find over the instances
+        std::vector<size_t> parents;
+        const auto find_root = [&parents](size_t index) {
+            while (parents[index] != index) {
+                parents[index] = parents[parents[index]];
+                index = parents[index];
+            }
+            return index;
+        };
+        const auto merge = [&](const size_t index, std::unordered_map<uint32_t, size_t>& keys, const uint32_t key) {
+            auto res = keys.find(key);
+            if (res == keys.end()) {
+                keys.insert({ key, index });
+                return;
+            }
+            parents[find_root(index)] = find_root(res->second);
+        };
+        std::unordered_map<uint32_t, size_t> service_keys;
+        std::unordered_map<uint32_t, size_t> link_keys;
+        for (size_t i = 0; i < m_runtime.get_total_ensembles(); i++) {
+            const auto db = m_runtime.get_radio_block(i).get_basic_radio().GetDatabaseSnapshot();
+            if (db == nullptr) continue;
+            for (const auto& service: db->services) {
+                const auto* component = find_audio_component(*db, service.reference);
+                if (component == nullptr) continue;
+                const size_t index = instances.size();
+                instances.push_back({ i, service.reference, component->subchannel_id });
+                parents.push_back(index);
+                merge(index, service_keys, uint32_t(service.reference));
+                for (const auto& link_service: db->link_services) {
+                    if (!link_service.is_complete || !link_service.is_active_link || !link_service.is_hard_link) continue;
+                    if (link_service.service_reference != service.reference) continue;
+                    // national and international linkage sets are numbered separately
+                    const uint32_t key = (uint32_t(link_service.is_international) << 16) | uint32_t(link_service.id);
+                    merge(index, link_keys, key);
+                }
+            }
+        }
+
+        // keep decoding each service where it already is so regrouping doesn't interrupt its audio
+        std::unordered_map<uint64_t, Instance> prev_primary;
+        for (const auto& group: m_groups) {
+            for (const auto& instance: group.instances) {
+                prev_primary.insert({ get_instance_key(instance), group.instances[group.primary] });
+            }
+        }
+        std::unordered_map<size_t, size_t> root_groups;
+        std::vector<Group> groups;
+        for (size_t index = 0; index < instances.size(); index++) {
+            const size_t root = find_root(index);
+            auto res = root_groups.find(root);
+            if (res == root_groups.end()) {
+                res = root_groups.insert({ root, groups.size() }).first;
+                groups.emplace_back();
+            }
+            groups[res->second].instances.push_back(instances[index]);
+        }
+        m_groups.clear();
+        for (auto& group: groups) {
+            if (group.instances.size() < 2) continue;
+            for (size_t j = 0; j < group.instances.size(); j++) {
+                auto res = prev_primary.find(get_instance_key(group.instances[j]));
+                if (res == prev_primary.end()) continue;
+                const uint64_t prev_key = get_instance_key(res->second);
+                for (size_t k = 0; k < group.instances.size(); k++) {
+                    if (get_instance_key(group.instances[k]) == prev_key) group.primary = k;
+                }
+                break;
+            }
+            m_groups.push_back(std::move(group));
+        }
+    }
+    // standby state is pushed to the controls of the channels that currently exist
+    void update_standby() {
+        const size_t total_ensembles = m_runtime.get_total_ensembles();
+        {
+            auto lock = std::scoped_lock(m_mutex_standby);
+            for (auto& is_standby: m_is_standby) is_standby.clear();
+            for (const auto& group: m_groups) {
+                for (size_t j = 0; j < group.instances.size(); j++) {
+                    const auto& instance = group.instances[j];
+                    auto& is_standby = m_is_standby[instance.ensemble_index];
+                    // a subchannel that is decoded for any group stays decoded
+                    auto res = is_standby.insert({ instance.subchannel_id, j != group.primary }).first;
+                    res->second = res->second && (j != group.primary);
+                }
+            }
+        }
+        for (size_t i = 0; i < total_ensembles; i++) {
+            auto& basic_radio = m_runtime.get_radio_block(i).get_basic_radio();
+            auto lock = std::scoped_lock(basic_radio.GetMutex());
+            auto& applied_is_standby = m_applied_is_standby[i];
+            for (auto& [subchannel_id, is_applied_standby]: applied_is_standby) {
+                const bool is_standby = get_is_standby(i, subchannel_id);
+                if (is_standby == is_applied_standby) continue;
+                auto* channel = basic_radio.Get_Audio_Channel(subchannel_id);
+                if (channel == nullptr) continue;
+                apply_controls(channel->GetControls(), is_standby);
+                is_applied_standby = is_standby;
+            }
+        }
+    }
+    static const ServiceComponent* find_audio_component(const DAB_Database& db, const service_id_t service_reference) {
+        for (const auto& component: db.service_components) {
+            if (component.service_reference != service_reference) continue;
+            if (!component.is_complete) continue;
+            if (component.transport_mode != TransportMode::STREAM_MODE_AUDIO) continue;
+            return &component;
+        }
+        return nullptr;
+    }
+    static uint64_t get_instance_key(const Instance& instance) {
+        return (uint64_t(instance.ensemble_index) << 32) | uint64_t(instance.service_reference);
+    }
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_audio_controls.h"
+#include "basic_radio/basic_fic_runner.h"
+#include "basic_radio/basic_radio.h"
+#include "dab/database/dab_database_types.h"
+#include "utility/metrics.h"
+
+// Each level also applies the levels before it
+enum class Load_Shed_Level: uint8_t {
+    NONE = 0,
+    // channels that are decoded but not played (scraping, restreaming, recording) go on standby
+    PAUSE_UNPLAYED = 1,
+    // dynamic labels and MOT slideshows aren't decoded
+    DISABLE_PAD = 2,
+    // DAB+ audio is decoded with downsampled SBR
+    LOW_COMPLEXITY_AAC = 3,
+    // only some FIB groups are decoded once the database is stable
+    REDUCE_FIC = 4,
+};
+
+static constexpr size_t TOTAL_LOAD_SHED_LEVELS = 5;
+
+static inline const char* get_load_shed_level_string(const Load_Shed_Level level) {
+    switch (level) {
+    case Load_Shed_Level::NONE: return "none";
+    case Load_Shed_Level::PAUSE_UNPLAYED: return "pause_unplayed";
+    case Load_Shed_Level::DISABLE_PAD: return "disable_pad";
+    case Load_Shed_Level::LOW_COMPLEXITY_AAC: return "low_complexity_aac";
+    case Load_Shed_Level::REDUCE_FIC: return "reduce_fic";
+    default: return "unknown";
+    }
+}
+
+struct Load_Shedder_Config {
+    // time between frames given to the radio, 96ms in transmission mode I
+    std::chrono::nanoseconds frame_period{96'000'000};
+    // shed load when the average processing time is above this fraction of the frame period
+    float shed_ratio = 0.9f;
+    // restore load when the average processing time is below this fraction of the frame period
+    float restore_ratio = 0.6f;
+    // weight of the newest frame in the moving average of the processing time
+    float smoothing = 0.1f;
+    // frames to wait after changing level so the average reflects the change
+    size_t hold_frames = 25;
+    // FIB groups decoded per interval at the REDUCE_FIC level, see BasicFICRunner::SetAdaptiveDecodeInterval()
+    size_t reduced_fic_interval = 8;
+};
+
+struct Load_Shedder_Status {
+    Load_Shed_Level level = Load_Shed_Level::NONE;
+    // moving average of the time Process() took
+    std::chrono::nanoseconds average_process_time{0};
+    size_t total_shed = 0;
+    size_t total_restored = 0;
+};
+
+// Keeps the radio within its realtime budget by giving up the least important work first
+// Processing time of each frame is compared against the frame period along with any deadline misses
+// When over budget the next level is applied, once there is headroom again the last level is undone
+// Only the controls the shedder changed are restored so settings made by the user are kept
+// NOTE: update() and the channel observer run on the thread calling BasicRadio::Process()
+//       Attach this after every other On_Audio_Channel() observer so it sees the controls they set
+class Radio_Load_Shedder
+{
+private:
+    // controls of each channel that the shedder changed
+    struct Channel_State {
+        bool is_paused = false;
+        bool is_decode_audio = false;
+        bool is_decode_data = false;
+        bool is_encoded_audio = false;
+        bool is_standby = false;
+        bool is_pad_disabled = false;
+        bool is_low_complexity = false;
+    };
+    BasicRadio& m_radio;
+    const Load_Shedder_Config m_config;
+    Load_Shed_Level m_level = Load_Shed_Level::NONE;
+    std::unordered_map<subchannel_id_t, Channel_State> m_channels;
+    double m_average_process_time = -1.0;
+    size_t m_frames_since_change = 0;
+    int m_prev_deadline_misses = 0;
+    // fic settings before REDUCE_FIC was applied
+    bool m_is_fic_reduced = false;
+    bool m_prev_fic_is_adaptive = false;
+    size_t m_prev_fic_decode_interval = 0;
+    std::atomic<Load_Shed_Level> m_status_level{Load_Shed_Level::NONE};
+    std::atomic<int64_t> m_status_average_ns{0};
+    std::atomic<size_t> m_total_shed{0};
+    std::atomic<size_t> m_total_restored{0};
+public:
+    Radio_Load_Shedder(BasicRadio& radio, const Load_Shedder_Config& config)
+    : m_radio(radio), m_config(config)
+    {
+        m_prev_deadline_misses = m_radio.GetTotalDeadlineMisses();
+        // NOTE: Channels are created with the radio's mutex held which update() also locks to apply changes
+        m_radio.On_Audio_Channel().Attach([this](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            // a recreated channel starts with fresh controls
+            auto& state = m_channels[subchannel_id];
+            state = Channel_State{};
+            apply_channel(channel.GetControls(), state);
+        });
+    }
+    Radio_Load_Shedder(Radio_Load_Shedder&) = delete;
+    Radio_Load_Shedder(Radio_Load_Shedder&&) = delete;
+    Radio_Load_Shedder& operator=(Radio_Load_Shedder&) = delete;
+    Radio_Load_Shedder& operator=(Radio_Load_Shedder&&) = delete;
+    // called after each frame with the time BasicRadio::Process() took
+    void update(const std::chrono::nanoseconds process_time) {
+        const double sample = double(process_time.count());
+        if (m_average_process_time < 0.0) {
+            m_average_process_time = sample;
+        } else {
+            m_average_process_time += double(m_config.smoothing) * (sample - m_average_process_time);
+        }
+        m_status_average_ns.store(int64_t(m_average_process_time), std::memory_order_relaxed);
+
+        m_frames_since_change++;
+        if (m_frames_since_change < m_config.hold_frames) return;
+
+        const int deadline_misses = m_radio.GetTotalDeadlineMisses();
+        const bool is_deadline_missed = deadline_misses != m_prev_deadline_misses;
+        m_prev_deadline_misses = deadline_misses;
+        const double frame_period = double(m_config.frame_period.count());
+        const bool is_over_budget = m_average_process_time > double(m_config.shed_ratio) * frame_period;
+        const bool is_headroom = m_average_process_time < double(m_config.restore_ratio) * frame_period;
+
+        const size_t level = size_t(m_level);
+        if ((is_over_budget || is_deadline_missed) && (level+1 < TOTAL_LOAD_SHED_LEVELS)) {
+            set_level(Load_Shed_Level(level+1));
+            get_shed_counter(m_level).Add();
+            m_total_shed.fetch_add(1, std::memory_order_relaxed);
+        } else if (is_headroom && !is_deadline_missed && (level > 0)) {
+            const auto prev_level = m_level;
+            set_level(Load_Shed_Level(level-1));
+            get_restore_counter(prev_level).Add();
+            m_total_restored.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    // NOTE: This can be called from any thread
+    Load_Shedder_Status get_status() const {
+        Load_Shedder_Status status;
+        status.level = m_status_level.load(std::memory_order_relaxed);
+        status.average_process_time = std::chrono::nanoseconds(m_status_average_ns.load(std::memory_order_relaxed));
+        status.total_shed = m_total_shed.load(std::memory_order_relaxed);
+        status.total_restored = m_total_restored.load(std::memory_order_relaxed);
+        return status;
+    }
+private:
+    void set_level(const Load_Shed_Level level) {
+        m_level = level;
+        m_frames_since_change = 0;
+        m_status_level.store(level, std::memory_order_relaxed);
+        apply_fic();
+        auto lock = std::scoped_lock(m_radio.GetMutex());
+        for (auto& [subchannel_id, state]: m_channels) {
+            auto* channel = m_radio.Get_Audio_Channel(subchannel_id);
+            if (channel == nullptr) continue;
+            apply_channel(channel->GetControls(), state);
+        }
+    }
+    bool get_is_applied(const Load_Shed_Level level) const {
+        return uint8_t(m_level) >= uint8_t(level);
+    }
+    void apply_channel(Basic_Audio_Controls& controls, Channel_State& state) {
+        // undo levels in the reverse order they were applied
+        if (!get_is_applied(Load_Shed_Level::LOW_COMPLEXITY_AAC) && state.is_low_complexity) {
+            controls.SetIsLowComplexity(false);
+            state.is_low_complexity = false;
+        }
+        if (!get_is_applied(Load_Shed_Level::DISABLE_PAD) && state.is_pad_disabled) {
+            controls.SetIsDecodeData(true);
+            state.is_pad_disabled = false;
+        }
+        if (!get_is_applied(Load_Shed_Level::PAUSE_UNPLAYED) && state.is_paused) {
+            // a channel that was selected for playback while paused is left as it is
+            if (!controls.GetIsPlayAudio()) {
+                controls.SetIsStandby(state.is_standby);
+                controls.SetIsDecodeAudio(state.is_decode_audio);
+                controls.SetIsDecodeData(state.is_decode_data);
+                controls.SetIsEncodedAudio(state.is_encoded_audio);
+            }
+            state.is_paused = false;
+        }
+
+        if (get_is_applied(Load_Shed_Level::PAUSE_UNPLAYED) && !state.is_paused) {
+            if (controls.GetAnyEnabled() && !controls.GetIsPlayAudio()) {
+                state.is_paused = true;
+                state.is_decode_audio = controls.GetIsDecodeAudio();
+                state.is_decode_data = controls.GetIsDecodeData();
+                state.is_encoded_audio = controls.GetIsEncodedAudio();
+                state.is_standby = controls.GetIsStandby();
+                controls.StopAll();
+                controls.SetIsStandby(true);
+            }
+        }
+        if (state.is_paused) return;
+        if (get_is_applied(Load_Shed_Level::DISABLE_PAD) && !state.is_pad_disabled && controls.GetIsDecodeData()) {
+            controls.SetIsDecodeData(false);
+            state.is_pad_disabled = true;
+        }
+        // NOTE: This has no effect on DAB (MP2) channels
+        if (get_is_applied(Load_Shed_Level::LOW_COMPLEXITY_AAC) && !state.is_low_complexity && !controls.GetIsLowComplexity()) {
+            controls.SetIsLowComplexity(true);
+            state.is_low_complexity = true;
+        }
+    }
+    void apply_fic() {
+        auto& fic_runner = m_radio.GetFICRunner();
+        if (get_is_applied(Load_Shed_Level::REDUCE_FIC) && !m_is_fic_reduced) {
+            m_prev_fic_is_adaptive = fic_runner.GetIsAdaptive();
+            m_prev_fic_decode_interval = fic_runner.GetAdaptiveDecodeInterval();
+            fic_runner.SetAdaptiveDecodeInterval(std::max(m_prev_fic_decode_interval, m_config.reduced_fic_interval));
+            fic_runner.SetIsAdaptive(true);
+            m_is_fic_reduced = true;
+        } else if (!get_is_applied(Load_Shed_Level::REDUCE_FIC) && m_is_fic_reduced) {
+            fic_runner.SetIsAdaptive(m_prev_fic_is_adaptive);
+            fic_runner.SetAdaptiveDecodeInterval(m_prev_fic_decode_interval);
+            m_is_fic_reduced = false;
+        }
+    }
+    static Metrics_Counter& get_shed_counter(const Load_Shed_Level level) {
+        static std::array<Metrics_Counter*, TOTAL_LOAD_SHED_LEVELS> counters = {
+            nullptr,
+            &Metrics_Registry::Get().GetCounter("dab_load_shed_pause_unplayed_total", "Times channels that weren't played were paused to save CPU"),
+            &Metrics_Registry::Get().GetCounter("dab_load_shed_disable_pad_total", "Times PAD decoding was disabled to save CPU"),
+            &Metrics_Registry::Get().GetCounter("dab_load_shed_low_complexity_aac_total", "Times DAB+ audio was switched to low complexity decoding to save CPU"),
+            &Metrics_Registry::Get().GetCounter("dab_load_shed_reduce_fic_total", "Times FIC decoding was reduced to save CPU"),
+        };
+        return *counters[size_t(level)];
+    }
+    static Metrics_Counter& get_restore_counter(const Load_Shed_Level level) {
+        static std::array<Metrics_Counter*, TOTAL_LOAD_SHED_LEVELS> counters = {
+            nullptr,
+            &Metrics_Registry::Get().GetCounter("dab_load_restore_pause_unplayed_total", "Times paused channels were resumed once there was headroom"),
+            &Metrics_Registry::Get().GetCounter("dab_load_restore_disable_pad_total", "Times PAD decoding was resumed once there was headroom"),
+            &Metrics_Registry::Get().GetCounter("dab_load_restore_low_complexity_aac_total", "Times DAB+ audio was switched back to full quality once there was headroom"),
+            &Metrics_Registry::Get().GetCounter("dab_load_restore_reduce_fic_total", "Times full FIC decoding was resumed once there was headroom"),
+        };
+        return *counters[size_t(level)];
+    }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../block_frequencies.h"
+#include "../device/device_manager.h"
+#include "./app_device_reader.h"
+
+// Parses "SERIAL:CHANNEL" where the serial can't contain the last ':'
+static inline bool parse_managed_device_config(const std::string& arg, ManagedDeviceConfig& config) {
+    const size_t split = arg.rfind(':');
+    if ((split == std::string::npos) || (split == 0)) return false;
+    config.serial = arg.substr(0, split);
+    config.channel_label = arg.substr(split+1);
+    auto res = block_frequencies.find(config.channel_label);
+    if (res == block_frequencies.end()) return false;
+    config.frequency = res->second;
+    return true;
+}
+
+// readers[i] is fed by device i of the manager
+static inline void print_managed_device_status(
+    DeviceManager& device_manager, const std::vector<std::shared_ptr<Device_Reader>>& readers)
+{
+    for (size_t i = 0; i < device_manager.get_total_devices(); i++) {
+        const auto& config = device_manager.get_config(i);
+        const auto status = device_manager.get_status(i);
+        const auto stats = readers[i]->get_statistics();
+        fprintf(stderr,
+            "device %s: connected=%d reconnects=%zu transfers=%llu overruns=%llu max_blocks=%zu/%zu\n",
+            config.serial.c_str(), int(status.is_connected), status.total_disconnects,
+            (unsigned long long)stats.total_transfers, (unsigned long long)stats.total_overruns,
+            stats.max_blocks_used, readers[i]->get_total_blocks());
+    }
+}
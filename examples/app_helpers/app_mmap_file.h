@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "utility/span.h"
+#include "utility/mapped_file.h"
+#include "./app_io_buffers.h"
+
+// Shares a mapped file between readers like FileWrapper
+// NOTE: close() only stops further reads since other threads can still use spans into the mapping
+//       The mapping is released once every reader of the file is destroyed
+class MappedFileReader {
+protected:
+    std::shared_ptr<const MappedFile> m_file;
+    std::atomic<size_t> m_offset{0};
+    std::atomic<bool> m_is_closed{false};
+public:
+    explicit MappedFileReader(std::shared_ptr<const MappedFile> file): m_file(file) {}
+    virtual ~MappedFileReader() {}
+    void close() {
+        m_is_closed.store(true, std::memory_order_relaxed);
+    }
+protected:
+    // Reading is lock free so readers on multiple threads get separate parts of the file
+    template <typename T>
+    tcb::span<const T> read_span(const size_t max_length) {
+        if (m_is_closed.load(std::memory_order_relaxed)) return {};
+        const auto data = m_file->get_span<T>();
+        size_t offset = m_offset.load(std::memory_order_relaxed);
+        size_t length = 0;
+        do {
+            length = std::min(max_length, data.size()-offset);
+        } while (!m_offset.compare_exchange_weak(offset, offset+length, std::memory_order_relaxed));
+        return data.subspan(offset, length);
+    }
+};
+
+template <typename T>
+class MappedInputFile: public SpanInputBuffer<T>, public MappedFileReader {
+public:
+    explicit MappedInputFile(std::shared_ptr<const MappedFile> file): MappedFileReader(file) {}
+    ~MappedInputFile() override = default;
+    tcb::span<const T> read_span(size_t max_length) override {
+        return MappedFileReader::read_span<T>(max_length);
+    }
+    bool get_is_span_persistent() const override { return true; }
+    size_t read(tcb::span<T> dest) override {
+        const auto src = MappedFileReader::read_span<T>(dest.size());
+        if (!src.empty()) memcpy(dest.data(), src.data(), src.size()*sizeof(T));
+        return src.size();
+    }
+};
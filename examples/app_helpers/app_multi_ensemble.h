@@ -0,0 +1,298 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_thread_pool.h"
+#include "dab/constants/dab_parameters.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "utility/thread_affinity.h"
+#include "viterbi_config.h"
+#include "./app_io_buffers.h"
+#include "./app_ofdm_blocks.h"
+#include "./app_ofdm_pool_executor.h"
+#include "./app_radio_blocks.h"
+
+struct Multi_Ensemble_Config {
+    int transmission_mode = 1;
+    // each ensemble has its own demodulator threads
+    size_t ofdm_total_threads = 1;
+    OFDM_Demod_Sync_Mode ofdm_sync_mode = OFDM_Demod_Sync_Mode::BLOCKING;
+    // demodulators run on the radio thread pool instead of their own threads
+    // NOTE: ofdm_total_threads is then the number of jobs each frame is split into
+    bool ofdm_use_radio_pool = false;
+    OFDM_Demod_Precision ofdm_precision = OFDM_Demod_Precision::FLOAT32;
+    // only demodulate the symbols of the FIC and the subchannels that each radio is decoding
+    bool ofdm_skip_unused_symbols = false;
+    // cores are split evenly between ensembles so their demodulators don't compete for the same cores
+    // NOTE: numa_node and priority are applied to every thread
+    Thread_Affinity ofdm_affinity;
+    // one radio thread pool is shared by every ensemble (0 = max number of threads)
+    size_t radio_total_threads = 0;
+    // each radio has its own pool of radio_total_threads instead like a radio running on its own
+    bool radio_private_pools = false;
+    Thread_Affinity radio_affinity;
+    // frames buffered between the demodulator and radio of each ensemble
+    size_t total_ring_frames = 4;
+};
+
+// Inputs call this before each read so the demodulator waits for the radio instead of dropping frames
+// NOTE: Benchmarks use this so that the whole chain is measured and their results don't depend on timing
+static inline void wait_for_frame_ring(const SPSC_Frame_Ring<viterbi_bit_t>& ring) {
+    constexpr auto POLL_PERIOD = std::chrono::microseconds(100);
+    const size_t max_used = std::max(ring.get_total_slots()/2, size_t(1));
+    while (ring.get_total_used() >= max_used) {
+        std::this_thread::sleep_for(POLL_PERIOD);
+    }
+}
+
+// CPU time in nanoseconds used by an ensemble
+struct Ensemble_CPU_Usage {
+    // thread calling the demodulator
+    uint64_t ofdm_reader = 0;
+    // coordinator and pipeline threads of the demodulator (or its jobs on the radio pool)
+    uint64_t ofdm_threads = 0;
+    // thread calling the radio
+    uint64_t radio_driver = 0;
+    // shared radio thread pool
+    uint64_t radio_pool = 0;
+    uint64_t radio_pool_tasks = 0;
+    uint64_t get_total() const {
+        return ofdm_reader + ofdm_threads + radio_driver + radio_pool;
+    }
+};
+
+// Time in seconds taken by each phase of creating the runtime
+struct Multi_Ensemble_Startup_Times {
+    float radio_pool_seconds = 0.0f;
+    // ensembles are created in parallel so this is the slowest of them
+    float ensembles_seconds = 0.0f;
+    // phases of each demodulator (the first of each size also builds the shared FFT plans and references)
+    std::vector<OFDM_Demod_Startup_Times> ofdm;
+    float get_total_seconds() const { return radio_pool_seconds + ensembles_seconds; }
+};
+
+// Runs the demodulators and radios of many ensembles in one process
+// The radios share one core aware work stealing pool which gives each ensemble a fair share of its workers
+// NOTE: With Multi_Ensemble_Config::radio_private_pools each ensemble has its own pool for comparison
+class Multi_Ensemble_Runtime
+{
+private:
+    struct Ensemble {
+        // the shared pool or the private pool of the ensemble
+        std::shared_ptr<BasicThreadPool> radio_pool;
+        size_t radio_pool_client = 0;
+        std::shared_ptr<OFDM_Block> ofdm_block;
+        std::shared_ptr<Basic_Radio_Block> radio_block;
+        std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> ring;
+        std::unique_ptr<std::thread> ofdm_thread;
+        std::unique_ptr<std::thread> radio_thread;
+    };
+    const Multi_Ensemble_Config m_config;
+    std::shared_ptr<BasicThreadPool> m_radio_pool;
+    std::vector<Ensemble> m_ensembles;
+    std::atomic<size_t> m_total_finished{0};
+    Multi_Ensemble_Startup_Times m_startup_times;
+public:
+    Multi_Ensemble_Runtime(const size_t total_ensembles, const Multi_Ensemble_Config& config)
+    : m_config(config)
+    {
+        assert(total_ensembles > 0);
+        const auto time_start = std::chrono::steady_clock::now();
+        auto radio_affinity = m_config.radio_affinity;
+        radio_affinity.is_one_core_per_thread = !radio_affinity.cores.empty();
+        // each demodulator has its own client after those of the radios since it submits from its reader thread
+        if (!m_config.radio_private_pools) {
+            const size_t total_clients = m_config.ofdm_use_radio_pool ? 2*total_ensembles : total_ensembles;
+            m_radio_pool = std::make_shared<BasicThreadPool>(m_config.radio_total_threads, radio_affinity, total_clients);
+        }
+
+        const auto time_pool_created = std::chrono::steady_clock::now();
+
+        // NOTE: Building the demodulators and radios is mostly independent so each ensemble is created on its own thread
+        m_ensembles.resize(total_ensembles);
+        std::vector<std::thread> create_threads;
+        create_threads.reserve(total_ensembles);
+        for (size_t i = 0; i < total_ensembles; i++) {
+            create_threads.emplace_back([this, i, total_ensembles]() {
+                create_ensemble(i, total_ensembles);
+            });
+        }
+        for (auto& thread: create_threads) {
+            thread.join();
+        }
+        const auto time_end = std::chrono::steady_clock::now();
+
+        m_startup_times.radio_pool_seconds = std::chrono::duration<float>(time_pool_created - time_start).count();
+        m_startup_times.ensembles_seconds = std::chrono::duration<float>(time_end - time_pool_created).count();
+        for (const auto& ensemble: m_ensembles) {
+            m_startup_times.ofdm.push_back(ensemble.ofdm_block->get_ofdm_demod().GetStartupTimes());
+        }
+    }
+    ~Multi_Ensemble_Runtime() {
+        join();
+    }
+    Multi_Ensemble_Runtime(Multi_Ensemble_Runtime&) = delete;
+    Multi_Ensemble_Runtime(Multi_Ensemble_Runtime&&) = delete;
+    Multi_Ensemble_Runtime& operator=(Multi_Ensemble_Runtime&) = delete;
+    Multi_Ensemble_Runtime& operator=(Multi_Ensemble_Runtime&&) = delete;
+    size_t get_total_ensembles() const { return m_ensembles.size(); }
+    OFDM_Block& get_ofdm_block(const size_t index) { return *(m_ensembles[index].ofdm_block.get()); }
+    Basic_Radio_Block& get_radio_block(const size_t index) { return *(m_ensembles[index].radio_block.get()); }
+    BasicThreadPool& get_radio_pool(const size_t index=0) { return *(m_ensembles[index].radio_pool.get()); }
+    // threads of the shared pool or of every private pool
+    size_t get_total_radio_threads() const {
+        if (m_radio_pool != nullptr) return m_radio_pool->GetTotalThreads();
+        size_t total_threads = 0;
+        for (const auto& ensemble: m_ensembles) {
+            total_threads += ensemble.radio_pool->GetTotalThreads();
+        }
+        return total_threads;
+    }
+    SPSC_Frame_Ring<viterbi_bit_t>& get_frame_ring(const size_t index) { return *(m_ensembles[index].ring.get()); }
+    void set_input_stream(const size_t index, std::shared_ptr<InputBuffer<std::complex<float>>> stream) {
+        m_ensembles[index].ofdm_block->set_input_stream(stream);
+    }
+    // frames are dropped if the radio falls behind unless the input isn't realtime (e.g. a file) and waits for it
+    void set_is_ring_blocking(const size_t index, const bool is_blocking) {
+        auto& ensemble = m_ensembles[index];
+        ensemble.ofdm_block->get_ofdm_demod().SetFrameRing(ensemble.ring, is_blocking);
+    }
+    // each ensemble decodes until its input ends
+    void start(const size_t block_size) {
+        for (size_t i = 0; i < m_ensembles.size(); i++) {
+            auto& ensemble = m_ensembles[i];
+            if (ensemble.ofdm_thread != nullptr) continue;
+            auto ofdm_block = ensemble.ofdm_block;
+            auto radio_block = ensemble.radio_block;
+            auto ring = ensemble.ring;
+            ensemble.ofdm_thread = std::make_unique<std::thread>([ofdm_block, ring, block_size, i]() {
+                ofdm_block->run(block_size);
+                fprintf(stderr, "ensemble %zu ofdm thread finished\n", i);
+                const size_t total_dropped = ring->get_total_dropped();
+                if (total_dropped > 0) fprintf(stderr, "ensemble %zu radio dropped %zu ofdm frames\n", i, total_dropped);
+                ring->close();
+            });
+            ensemble.radio_thread = std::make_unique<std::thread>([this, radio_block, i]() {
+                radio_block->run();
+                fprintf(stderr, "ensemble %zu radio thread finished\n", i);
+                m_total_finished.fetch_add(1, std::memory_order_release);
+            });
+        }
+    }
+    // every ensemble that was started has reached the end of its input
+    bool is_finished() const {
+        return m_total_finished.load(std::memory_order_acquire) == m_ensembles.size();
+    }
+    void join() {
+        for (auto& ensemble: m_ensembles) {
+            if (ensemble.ofdm_thread != nullptr) {
+                ensemble.ofdm_thread->join();
+                ensemble.ofdm_thread = nullptr;
+            }
+            ensemble.ring->close();
+            if (ensemble.radio_thread != nullptr) {
+                ensemble.radio_thread->join();
+                ensemble.radio_thread = nullptr;
+            }
+        }
+    }
+    Ensemble_CPU_Usage get_cpu_usage(const size_t index) const {
+        const auto& ensemble = m_ensembles[index];
+        const auto& account = ensemble.radio_pool->GetClientAccount(ensemble.radio_pool_client);
+        Ensemble_CPU_Usage usage;
+        usage.ofdm_reader = ensemble.ofdm_block->get_reader_cpu_time();
+        usage.ofdm_threads = ensemble.ofdm_block->get_ofdm_demod().GetTotalThreadCPUTime();
+        usage.radio_driver = ensemble.radio_block->get_driver_cpu_time();
+        usage.radio_pool = account.total_cpu_ns.load(std::memory_order_relaxed);
+        usage.radio_pool_tasks = account.total_tasks.load(std::memory_order_relaxed);
+        return usage;
+    }
+    const Multi_Ensemble_Startup_Times& get_startup_times() const { return m_startup_times; }
+    // number of threads whose affinity or priority couldn't be applied
+    int get_total_thread_affinity_errors() const {
+        int total_errors = (m_radio_pool != nullptr) ? m_radio_pool->GetTotalAffinityErrors() : 0;
+        for (const auto& ensemble: m_ensembles) {
+            if (m_radio_pool == nullptr) total_errors += ensemble.radio_pool->GetTotalAffinityErrors();
+            total_errors += ensemble.ofdm_block->get_ofdm_demod().GetTotalThreadConfigErrors();
+        }
+        return total_errors;
+    }
+private:
+    // NOTE: Only writes to its own ensemble so this can run on any thread
+    void create_ensemble(const size_t i, const size_t total_ensembles) {
+        const auto dab_params = get_dab_parameters(m_config.transmission_mode);
+        auto& ensemble = m_ensembles[i];
+        size_t ofdm_pool_client = total_ensembles+i;
+        if (m_config.radio_private_pools) {
+            auto radio_affinity = m_config.radio_affinity;
+            radio_affinity.is_one_core_per_thread = !radio_affinity.cores.empty();
+            const size_t total_clients = m_config.ofdm_use_radio_pool ? 2 : 1;
+            ensemble.radio_pool = std::make_shared<BasicThreadPool>(m_config.radio_total_threads, radio_affinity, total_clients);
+            ensemble.radio_pool_client = 0;
+            ofdm_pool_client = 1;
+        } else {
+            ensemble.radio_pool = m_radio_pool;
+            ensemble.radio_pool_client = i;
+        }
+        std::shared_ptr<OFDM_Demod_Executor> ofdm_executor = nullptr;
+        if (m_config.ofdm_use_radio_pool) {
+            ofdm_executor = std::make_shared<App_OFDM_Pool_Executor>(ensemble.radio_pool, ofdm_pool_client);
+        }
+        ensemble.ofdm_block = std::make_shared<OFDM_Block>(
+            m_config.transmission_mode, m_config.ofdm_total_threads,
+            m_config.ofdm_sync_mode, get_ofdm_thread_config(i, total_ensembles),
+            ofdm_executor, m_config.ofdm_precision
+        );
+        ensemble.radio_block = std::make_shared<Basic_Radio_Block>(
+            m_config.transmission_mode, ensemble.radio_pool, ensemble.radio_pool_client
+        );
+        ensemble.ring = std::make_shared<SPSC_Frame_Ring<viterbi_bit_t>>(
+            dab_params.nb_frame_bits, m_config.total_ring_frames
+        );
+        // there is no gui to show the FFTs of each frame so each symbol is processed in cache
+        ensemble.ofdm_block->get_ofdm_demod().SetIsHeadless(true);
+        ensemble.ofdm_block->get_ofdm_demod().GetConfig().pipeline.is_fused_symbols = true;
+        ensemble.ofdm_block->get_ofdm_demod().SetFrameRing(ensemble.ring);
+        ensemble.radio_block->set_input_ring(ensemble.ring);
+        if (m_config.ofdm_skip_unused_symbols) {
+            auto ofdm_block = ensemble.ofdm_block;
+            ensemble.radio_block->get_basic_radio().On_Symbol_Mask().Attach([ofdm_block](tcb::span<const uint8_t> mask) {
+                ofdm_block->get_ofdm_demod().SetDataSymbolMask(mask);
+            });
+        }
+    }
+    // contiguous slice of the demodulator cores so each ensemble keeps its data in the same caches
+    OFDM_Demod_Thread_Config get_ofdm_thread_config(const size_t index, const size_t total_ensembles) const {
+        const auto& cores = m_config.ofdm_affinity.cores;
+        Thread_Affinity affinity = m_config.ofdm_affinity;
+        if (!cores.empty()) {
+            affinity.cores.clear();
+            if (cores.size() >= total_ensembles) {
+                const size_t start = (index*cores.size()) / total_ensembles;
+                const size_t end = ((index+1)*cores.size()) / total_ensembles;
+                affinity.cores.assign(cores.begin()+start, cores.begin()+end);
+            } else {
+                // ensembles share cores if there aren't enough of them
+                affinity.cores.push_back(cores[index % cores.size()]);
+            }
+        }
+        OFDM_Demod_Thread_Config thread_config;
+        thread_config.reader = affinity;
+        thread_config.coordinator = affinity;
+        thread_config.pipeline = affinity;
+        thread_config.pipeline.is_one_core_per_thread = !affinity.cores.empty();
+        return thread_config;
+    }
+};
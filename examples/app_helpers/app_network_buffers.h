@@ -0,0 +1,792 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dab/algorithms/soft_bit_packing.h"
+#include "dab/constants/dab_parameters.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_io_buffers.h"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// Transport of OFDM frames between a demodulator and a radio on different hosts
+// Each frame carries a sequence number so the receiver can count frames lost in transit
+// TCP:
+//   Frames are sent as [frame header][payload] and a blocked send applies backpressure to the demodulator
+//   The receiver accepts a new sender if the current one disconnects
+// UDP multicast:
+//   Frames are split into datagrams of [fragment header][part of payload] that fit in the network MTU
+//   Many radios can receive the same stream but frames with a lost fragment are dropped
+// NOTE: All fields are little endian
+//       Payloads are soft bits or packed 4bit soft bits (see soft_bit_packing.h)
+
+enum class Network_Bit_Format: uint8_t {
+    SOFT=0, PACKED=1,
+};
+
+struct Network_Frame_Statistics {
+    uint64_t total_frames = 0;          // frames sent or received
+    uint64_t total_dropped = 0;         // frames that couldn't be sent or were incomplete
+    uint64_t total_missing = 0;         // gaps in the sequence numbers seen by the receiver
+    uint64_t total_connections = 0;
+};
+
+namespace network_internal {
+
+#if _WIN32
+typedef SOCKET socket_t;
+static constexpr socket_t INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+static inline void close_socket(socket_t s) { closesocket(s); }
+#else
+typedef int socket_t;
+static constexpr socket_t INVALID_SOCKET_HANDLE = -1;
+static inline void close_socket(socket_t s) { ::close(s); }
+#endif
+
+// Broken connections are reported as errors instead of raising SIGPIPE
+#if defined(MSG_NOSIGNAL)
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+
+static constexpr char FRAME_MAGIC[4] = {'D','A','B','F'};
+static constexpr char FRAGMENT_MAGIC[4] = {'D','A','B','U'};
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t FRAME_HEADER_SIZE = 24;
+static constexpr size_t FRAGMENT_HEADER_SIZE = 32;
+
+// Winsock has to be started before any sockets are created
+static inline bool init_network() {
+#if _WIN32
+    static const bool is_init = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2,2), &data) == 0;
+    }();
+    return is_init;
+#else
+    return true;
+#endif
+}
+
+template <typename T>
+static void put_le(uint8_t* buf, const T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = uint8_t(uint64_t(v) >> (8*i));
+    }
+}
+
+template <typename T>
+static T get_le(const uint8_t* buf) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(buf[i]) << (8*i);
+    }
+    return T(v);
+}
+
+static inline size_t get_payload_size(const Network_Bit_Format format, const size_t nb_frame_bits) {
+    if (format == Network_Bit_Format::PACKED) return get_packed_soft_bits_size(nb_frame_bits);
+    return nb_frame_bits*sizeof(viterbi_bit_t);
+}
+
+static inline void encode_payload(const Network_Bit_Format format, tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> payload) {
+    if (format == Network_Bit_Format::PACKED) {
+        pack_soft_bits_auto(bits, payload);
+    } else {
+        memcpy(payload.data(), bits.data(), payload.size());
+    }
+}
+
+static inline void decode_payload(const Network_Bit_Format format, tcb::span<const uint8_t> payload, tcb::span<viterbi_bit_t> bits) {
+    if (format == Network_Bit_Format::PACKED) {
+        unpack_soft_bits_auto(payload, bits);
+    } else {
+        memcpy(bits.data(), payload.data(), payload.size());
+    }
+}
+
+static inline bool send_all(socket_t s, tcb::span<const uint8_t> buf) {
+    while (!buf.empty()) {
+        const int length = int(std::min(buf.size(), size_t(1) << 30));
+        const auto total_sent = ::send(s, reinterpret_cast<const char*>(buf.data()), length, SEND_FLAGS);
+        if (total_sent <= 0) return false;
+        buf = buf.subspan(size_t(total_sent));
+    }
+    return true;
+}
+
+// Gathers many buffers into one send call and returns the number of bytes sent or -1 on error
+// Non-blocking sockets return 0 if nothing could be sent
+static constexpr size_t MAX_SEND_BUFFERS = 64;
+static inline int64_t send_vectored(socket_t s, tcb::span<const tcb::span<const uint8_t>> bufs) {
+    const size_t total_bufs = std::min(bufs.size(), MAX_SEND_BUFFERS);
+#if _WIN32
+    WSABUF wsa_bufs[MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < total_bufs; i++) {
+        wsa_bufs[i].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(bufs[i].data()));
+        wsa_bufs[i].len = ULONG(bufs[i].size());
+    }
+    DWORD total_sent = 0;
+    if (WSASend(s, wsa_bufs, DWORD(total_bufs), &total_sent, 0, nullptr, nullptr) != 0) {
+        return (WSAGetLastError() == WSAEWOULDBLOCK) ? 0 : -1;
+    }
+    return int64_t(total_sent);
+#else
+    struct iovec iov[MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < total_bufs; i++) {
+        iov[i].iov_base = const_cast<uint8_t*>(bufs[i].data());
+        iov[i].iov_len = bufs[i].size();
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = decltype(msg.msg_iovlen)(total_bufs);
+    const auto total_sent = ::sendmsg(s, &msg, SEND_FLAGS);
+    if (total_sent < 0) return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    return int64_t(total_sent);
+#endif
+}
+
+static inline bool recv_all(socket_t s, tcb::span<uint8_t> buf) {
+    while (!buf.empty()) {
+        const int length = int(std::min(buf.size(), size_t(1) << 30));
+        const auto total_read = ::recv(s, reinterpret_cast<char*>(buf.data()), length, 0);
+        if (total_read <= 0) return false;
+        buf = buf.subspan(size_t(total_read));
+    }
+    return true;
+}
+
+// Counts sequence numbers that were skipped
+// NOTE: A sequence that restarts from 0 is a new sender and isn't counted as missing
+static inline void update_sequence(Network_Frame_Statistics& stats, bool& is_first, uint64_t& expected, const uint64_t sequence) {
+    if (!is_first && (sequence > expected)) {
+        stats.total_missing += sequence - expected;
+    }
+    is_first = false;
+    expected = sequence+1;
+}
+
+}
+
+// Soft bits are grouped into frames and sent over a TCP connection
+// If the connection breaks it is reopened and frames are dropped until it succeeds
+class TCP_Frame_Sender: public OutputBuffer<viterbi_bit_t>
+{
+private:
+    using socket_t = network_internal::socket_t;
+    const std::string m_host;
+    const std::string m_port;
+    const int m_transmission_mode;
+    const Network_Bit_Format m_format;
+    const size_t m_frames_per_batch;
+    size_t m_nb_frame_bits = 0;
+    size_t m_payload_size = 0;
+    socket_t m_socket = network_internal::INVALID_SOCKET_HANDLE;
+    std::vector<viterbi_bit_t> m_partial_frame;
+    std::vector<uint8_t> m_batch;
+    size_t m_batch_frames = 0;
+    uint64_t m_sequence = 0;
+    Network_Frame_Statistics m_stats;
+    std::mutex m_mutex;
+public:
+    // frames_per_batch frames are sent together which reduces system calls for small frames
+    TCP_Frame_Sender(
+        const std::string& host, const std::string& port, const int transmission_mode,
+        const Network_Bit_Format format=Network_Bit_Format::SOFT, const size_t frames_per_batch=1)
+    : m_host(host), m_port(port), m_transmission_mode(transmission_mode), m_format(format),
+      m_frames_per_batch(std::max(frames_per_batch, size_t(1)))
+    {
+        m_nb_frame_bits = size_t(get_dab_parameters(m_transmission_mode).nb_frame_bits);
+        m_payload_size = network_internal::get_payload_size(m_format, m_nb_frame_bits);
+        m_partial_frame.reserve(m_nb_frame_bits);
+        m_batch.reserve((network_internal::FRAME_HEADER_SIZE + m_payload_size)*m_frames_per_batch);
+    }
+    ~TCP_Frame_Sender() override { close(); }
+    TCP_Frame_Sender(TCP_Frame_Sender&) = delete;
+    TCP_Frame_Sender(TCP_Frame_Sender&&) = delete;
+    TCP_Frame_Sender& operator=(TCP_Frame_Sender&) = delete;
+    TCP_Frame_Sender& operator=(TCP_Frame_Sender&&) = delete;
+    // Returns false if the receiver couldn't be reached
+    bool connect() {
+        auto lock = std::scoped_lock(m_mutex);
+        return open_socket();
+    }
+    void close() {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_socket == network_internal::INVALID_SOCKET_HANDLE) return;
+        send_batch();
+        close_socket();
+    }
+    Network_Frame_Statistics get_statistics() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_stats;
+    }
+    size_t write(tcb::span<const viterbi_bit_t> bits) override {
+        auto lock = std::scoped_lock(m_mutex);
+        const size_t total_bits = bits.size();
+        if (!m_partial_frame.empty()) {
+            const size_t length = std::min(m_nb_frame_bits-m_partial_frame.size(), bits.size());
+            m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.begin()+length);
+            bits = bits.subspan(length);
+            if (m_partial_frame.size() == m_nb_frame_bits) {
+                push_frame(m_partial_frame);
+                m_partial_frame.clear();
+            }
+        }
+        while (bits.size() >= m_nb_frame_bits) {
+            push_frame(bits.first(m_nb_frame_bits));
+            bits = bits.subspan(m_nb_frame_bits);
+        }
+        m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.end());
+        return total_bits;
+    }
+private:
+    void push_frame(tcb::span<const viterbi_bit_t> frame) {
+        using namespace network_internal;
+        const size_t offset = m_batch.size();
+        m_batch.resize(offset + FRAME_HEADER_SIZE + m_payload_size);
+        uint8_t* header = &m_batch[offset];
+        memcpy(&header[0], FRAME_MAGIC, sizeof(FRAME_MAGIC));
+        header[4] = VERSION;
+        header[5] = uint8_t(m_transmission_mode);
+        header[6] = uint8_t(m_format);
+        header[7] = 0;
+        put_le<uint64_t>(&header[8], m_sequence);
+        put_le<uint32_t>(&header[16], uint32_t(m_payload_size));
+        put_le<uint32_t>(&header[20], 0);
+        encode_payload(m_format, frame, tcb::span(m_batch).subspan(offset + FRAME_HEADER_SIZE, m_payload_size));
+        m_sequence++;
+        m_batch_frames++;
+        if (m_batch_frames == m_frames_per_batch) {
+            send_batch();
+        }
+    }
+
+    void send_batch() {
+        if (m_batch_frames == 0) return;
+        const bool is_connected = (m_socket != network_internal::INVALID_SOCKET_HANDLE) || open_socket();
+        if (is_connected && network_internal::send_all(m_socket, m_batch)) {
+            m_stats.total_frames += uint64_t(m_batch_frames);
+        } else {
+            m_stats.total_dropped += uint64_t(m_batch_frames);
+            close_socket();
+        }
+        m_batch.clear();
+        m_batch_frames = 0;
+    }
+
+    bool open_socket() {
+        using namespace network_internal;
+        if (m_socket != INVALID_SOCKET_HANDLE) return true;
+        if (!init_network()) return false;
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        struct addrinfo* results = nullptr;
+        if (getaddrinfo(m_host.c_str(), m_port.c_str(), &hints, &results) != 0) return false;
+        for (auto* res = results; res != nullptr; res = res->ai_next) {
+            socket_t s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            if (s == INVALID_SOCKET_HANDLE) continue;
+            if (::connect(s, res->ai_addr, int(res->ai_addrlen)) != 0) {
+                network_internal::close_socket(s);
+                continue;
+            }
+            #if defined(SO_NOSIGPIPE)
+            const int is_no_sigpipe = 1;
+            setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<const char*>(&is_no_sigpipe), sizeof(is_no_sigpipe));
+            #endif
+            m_socket = s;
+            m_stats.total_connections++;
+            break;
+        }
+        freeaddrinfo(results);
+        return m_socket != INVALID_SOCKET_HANDLE;
+    }
+
+    void close_socket() {
+        if (m_socket == network_internal::INVALID_SOCKET_HANDLE) return;
+        network_internal::close_socket(m_socket);
+        m_socket = network_internal::INVALID_SOCKET_HANDLE;
+    }
+};
+
+// Frames from a TCP_Frame_Sender are read as a stream of soft bits
+// The receiver reads the frames of one sender at a time and waits for another when it disconnects
+class TCP_Frame_Receiver: public InputBuffer<viterbi_bit_t>
+{
+private:
+    using socket_t = network_internal::socket_t;
+    const int m_transmission_mode;
+    size_t m_nb_frame_bits = 0;
+    std::atomic<socket_t> m_listen_socket{network_internal::INVALID_SOCKET_HANDLE};
+    std::atomic<socket_t> m_socket{network_internal::INVALID_SOCKET_HANDLE};
+    std::atomic<bool> m_is_closed{false};
+    std::vector<uint8_t> m_payload;
+    std::vector<viterbi_bit_t> m_frame_bits;
+    size_t m_frame_offset = 0;
+    bool m_is_first_sequence = true;
+    uint64_t m_expected_sequence = 0;
+    Network_Frame_Statistics m_stats;
+    std::mutex m_mutex_stats;
+public:
+    explicit TCP_Frame_Receiver(const int transmission_mode): m_transmission_mode(transmission_mode) {
+        m_nb_frame_bits = size_t(get_dab_parameters(m_transmission_mode).nb_frame_bits);
+        m_frame_bits.resize(m_nb_frame_bits);
+        m_frame_offset = m_nb_frame_bits;
+    }
+    ~TCP_Frame_Receiver() override { close(); }
+    TCP_Frame_Receiver(TCP_Frame_Receiver&) = delete;
+    TCP_Frame_Receiver(TCP_Frame_Receiver&&) = delete;
+    TCP_Frame_Receiver& operator=(TCP_Frame_Receiver&) = delete;
+    TCP_Frame_Receiver& operator=(TCP_Frame_Receiver&&) = delete;
+    // Returns false if the port couldn't be bound
+    bool listen(const std::string& address, const std::string& port) {
+        using namespace network_internal;
+        if (!init_network()) return false;
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        hints.ai_flags = AI_PASSIVE;
+        struct addrinfo* results = nullptr;
+        const char* node = address.empty() ? nullptr : address.c_str();
+        if (getaddrinfo(node, port.c_str(), &hints, &results) != 0) return false;
+        socket_t listen_socket = INVALID_SOCKET_HANDLE;
+        for (auto* res = results; res != nullptr; res = res->ai_next) {
+            socket_t s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            if (s == INVALID_SOCKET_HANDLE) continue;
+            const int is_reuse = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&is_reuse), sizeof(is_reuse));
+            if ((bind(s, res->ai_addr, int(res->ai_addrlen)) != 0) || (::listen(s, 1) != 0)) {
+                network_internal::close_socket(s);
+                continue;
+            }
+            listen_socket = s;
+            break;
+        }
+        freeaddrinfo(results);
+        m_listen_socket.store(listen_socket);
+        return listen_socket != INVALID_SOCKET_HANDLE;
+    }
+    // Unblocks a pending read from another thread
+    void close() {
+        using namespace network_internal;
+        m_is_closed.store(true);
+        const socket_t s = m_socket.exchange(INVALID_SOCKET_HANDLE);
+        if (s != INVALID_SOCKET_HANDLE) {
+            #if _WIN32
+            shutdown(s, SD_BOTH);
+            #else
+            shutdown(s, SHUT_RDWR);
+            #endif
+            network_internal::close_socket(s);
+        }
+        const socket_t listen_socket = m_listen_socket.exchange(INVALID_SOCKET_HANDLE);
+        if (listen_socket != INVALID_SOCKET_HANDLE) {
+            #if _WIN32
+            shutdown(listen_socket, SD_BOTH);
+            #else
+            shutdown(listen_socket, SHUT_RDWR);
+            #endif
+            network_internal::close_socket(listen_socket);
+        }
+    }
+    Network_Frame_Statistics get_statistics() {
+        auto lock = std::scoped_lock(m_mutex_stats);
+        return m_stats;
+    }
+    size_t read(tcb::span<viterbi_bit_t> dest) override {
+        size_t total_read = 0;
+        while (!dest.empty()) {
+            if (m_frame_offset == m_nb_frame_bits) {
+                if (!read_frame()) break;
+                m_frame_offset = 0;
+            }
+            const size_t length = std::min(dest.size(), m_nb_frame_bits-m_frame_offset);
+            memcpy(dest.data(), &m_frame_bits[m_frame_offset], length*sizeof(viterbi_bit_t));
+            m_frame_offset += length;
+            dest = dest.subspan(length);
+            total_read += length;
+        }
+        return total_read;
+    }
+private:
+    bool read_frame() {
+        using namespace network_internal;
+        while (!m_is_closed.load()) {
+            socket_t s = m_socket.load();
+            if (s == INVALID_SOCKET_HANDLE) {
+                s = accept_sender();
+                if (s == INVALID_SOCKET_HANDLE) return false;
+                continue;
+            }
+            uint8_t header[FRAME_HEADER_SIZE];
+            bool is_valid = recv_all(s, header);
+            is_valid = is_valid && (memcmp(&header[0], FRAME_MAGIC, sizeof(FRAME_MAGIC)) == 0);
+            is_valid = is_valid && (header[4] == VERSION) && (int(header[5]) == m_transmission_mode);
+            const auto format = Network_Bit_Format(header[6]);
+            const size_t payload_size = get_le<uint32_t>(&header[16]);
+            is_valid = is_valid && (uint8_t(format) <= uint8_t(Network_Bit_Format::PACKED));
+            is_valid = is_valid && (payload_size == get_payload_size(format, m_nb_frame_bits));
+            if (is_valid) {
+                m_payload.resize(payload_size);
+                is_valid = recv_all(s, m_payload);
+            }
+            // a sender that disconnects or sends garbage is dropped and we wait for the next one
+            if (!is_valid) {
+                drop_sender();
+                continue;
+            }
+            decode_payload(format, m_payload, m_frame_bits);
+            auto lock = std::scoped_lock(m_mutex_stats);
+            update_sequence(m_stats, m_is_first_sequence, m_expected_sequence, get_le<uint64_t>(&header[8]));
+            m_stats.total_frames++;
+            return true;
+        }
+        return false;
+    }
+
+    socket_t accept_sender() {
+        using namespace network_internal;
+        const socket_t listen_socket = m_listen_socket.load();
+        if (listen_socket == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+        const socket_t s = accept(listen_socket, nullptr, nullptr);
+        if (s == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+        socket_t expected = INVALID_SOCKET_HANDLE;
+        if (m_is_closed.load() || !m_socket.compare_exchange_strong(expected, s)) {
+            network_internal::close_socket(s);
+            return INVALID_SOCKET_HANDLE;
+        }
+        auto lock = std::scoped_lock(m_mutex_stats);
+        m_stats.total_connections++;
+        m_is_first_sequence = true;
+        return s;
+    }
+
+    void drop_sender() {
+        const socket_t s = m_socket.exchange(network_internal::INVALID_SOCKET_HANDLE);
+        if (s != network_internal::INVALID_SOCKET_HANDLE) {
+            network_internal::close_socket(s);
+        }
+    }
+};
+
+// Soft bits are grouped into frames and each frame is sent to a multicast group as many datagrams
+// NOTE: There is no backpressure so the receivers must keep up with the demodulator
+class UDP_Multicast_Frame_Sender: public OutputBuffer<viterbi_bit_t>
+{
+private:
+    using socket_t = network_internal::socket_t;
+    const int m_transmission_mode;
+    const Network_Bit_Format m_format;
+    const size_t m_max_fragment_payload;
+    size_t m_nb_frame_bits = 0;
+    size_t m_payload_size = 0;
+    socket_t m_socket = network_internal::INVALID_SOCKET_HANDLE;
+    struct sockaddr_in m_group_address;
+    std::vector<viterbi_bit_t> m_partial_frame;
+    std::vector<uint8_t> m_payload;
+    std::vector<uint8_t> m_datagram;
+    uint64_t m_sequence = 0;
+    Network_Frame_Statistics m_stats;
+    std::mutex m_mutex;
+public:
+    // max_datagram_size should fit in the MTU of the network to avoid IP fragmentation
+    UDP_Multicast_Frame_Sender(
+        const int transmission_mode, const Network_Bit_Format format=Network_Bit_Format::SOFT,
+        const size_t max_datagram_size=1400)
+    : m_transmission_mode(transmission_mode), m_format(format),
+      m_max_fragment_payload(std::max(max_datagram_size, network_internal::FRAGMENT_HEADER_SIZE+64) - network_internal::FRAGMENT_HEADER_SIZE)
+    {
+        m_nb_frame_bits = size_t(get_dab_parameters(m_transmission_mode).nb_frame_bits);
+        m_payload_size = network_internal::get_payload_size(m_format, m_nb_frame_bits);
+        m_partial_frame.reserve(m_nb_frame_bits);
+        m_payload.resize(m_payload_size);
+        m_datagram.resize(network_internal::FRAGMENT_HEADER_SIZE + m_max_fragment_payload);
+        memset(&m_group_address, 0, sizeof(m_group_address));
+    }
+    ~UDP_Multicast_Frame_Sender() override { close(); }
+    UDP_Multicast_Frame_Sender(UDP_Multicast_Frame_Sender&) = delete;
+    UDP_Multicast_Frame_Sender(UDP_Multicast_Frame_Sender&&) = delete;
+    UDP_Multicast_Frame_Sender& operator=(UDP_Multicast_Frame_Sender&) = delete;
+    UDP_Multicast_Frame_Sender& operator=(UDP_Multicast_Frame_Sender&&) = delete;
+    // interface is the local IPv4 address to send from (empty for the default route)
+    bool open(const std::string& group, const uint16_t port, const std::string& interface_address="", const int ttl=1) {
+        using namespace network_internal;
+        auto lock = std::scoped_lock(m_mutex);
+        if (!init_network()) return false;
+        m_group_address.sin_family = AF_INET;
+        m_group_address.sin_port = htons(port);
+        if (inet_pton(AF_INET, group.c_str(), &m_group_address.sin_addr) != 1) return false;
+        socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == INVALID_SOCKET_HANDLE) return false;
+        const unsigned char multicast_ttl = (unsigned char)std::clamp(ttl, 0, 255);
+        setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&multicast_ttl), sizeof(multicast_ttl));
+        if (!interface_address.empty()) {
+            struct in_addr local;
+            if ((inet_pton(AF_INET, interface_address.c_str(), &local) != 1) ||
+                (setsockopt(s, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&local), sizeof(local)) != 0))
+            {
+                network_internal::close_socket(s);
+                return false;
+            }
+        }
+        m_socket = s;
+        return true;
+    }
+    void close() {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_socket == network_internal::INVALID_SOCKET_HANDLE) return;
+        network_internal::close_socket(m_socket);
+        m_socket = network_internal::INVALID_SOCKET_HANDLE;
+    }
+    Network_Frame_Statistics get_statistics() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_stats;
+    }
+    size_t write(tcb::span<const viterbi_bit_t> bits) override {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_socket == network_internal::INVALID_SOCKET_HANDLE) return 0;
+        const size_t total_bits = bits.size();
+        if (!m_partial_frame.empty()) {
+            const size_t length = std::min(m_nb_frame_bits-m_partial_frame.size(), bits.size());
+            m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.begin()+length);
+            bits = bits.subspan(length);
+            if (m_partial_frame.size() == m_nb_frame_bits) {
+                send_frame(m_partial_frame);
+                m_partial_frame.clear();
+            }
+        }
+        while (bits.size() >= m_nb_frame_bits) {
+            send_frame(bits.first(m_nb_frame_bits));
+            bits = bits.subspan(m_nb_frame_bits);
+        }
+        m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.end());
+        return total_bits;
+    }
+private:
+    void send_frame(tcb::span<const viterbi_bit_t> frame) {
+        using namespace network_internal;
+        encode_payload(m_format, frame, m_payload);
+        const size_t total_fragments = (m_payload_size + m_max_fragment_payload - 1) / m_max_fragment_payload;
+        bool is_sent = true;
+        for (size_t i = 0; i < total_fragments; i++) {
+            const size_t offset = i*m_max_fragment_payload;
+            const size_t length = std::min(m_max_fragment_payload, m_payload_size-offset);
+            uint8_t* header = m_datagram.data();
+            memcpy(&header[0], FRAGMENT_MAGIC, sizeof(FRAGMENT_MAGIC));
+            header[4] = VERSION;
+            header[5] = uint8_t(m_transmission_mode);
+            header[6] = uint8_t(m_format);
+            header[7] = 0;
+            put_le<uint64_t>(&header[8], m_sequence);
+            put_le<uint32_t>(&header[16], uint32_t(m_payload_size));
+            put_le<uint32_t>(&header[20], uint32_t(offset));
+            put_le<uint16_t>(&header[24], uint16_t(i));
+            put_le<uint16_t>(&header[26], uint16_t(total_fragments));
+            put_le<uint32_t>(&header[28], 0);
+            memcpy(&m_datagram[FRAGMENT_HEADER_SIZE], &m_payload[offset], length);
+            const auto total_sent = sendto(
+                m_socket, reinterpret_cast<const char*>(m_datagram.data()), int(FRAGMENT_HEADER_SIZE+length), 0,
+                reinterpret_cast<const struct sockaddr*>(&m_group_address), sizeof(m_group_address));
+            if (total_sent != int(FRAGMENT_HEADER_SIZE+length)) {
+                is_sent = false;
+                break;
+            }
+        }
+        m_sequence++;
+        if (is_sent) {
+            m_stats.total_frames++;
+        } else {
+            m_stats.total_dropped++;
+        }
+    }
+};
+
+// Frames are reassembled from the datagrams sent to a multicast group
+// A frame is dropped if the next frame starts arriving before all of its fragments were received
+class UDP_Multicast_Frame_Receiver: public InputBuffer<viterbi_bit_t>
+{
+private:
+    using socket_t = network_internal::socket_t;
+    const int m_transmission_mode;
+    size_t m_nb_frame_bits = 0;
+    std::atomic<socket_t> m_socket{network_internal::INVALID_SOCKET_HANDLE};
+    std::atomic<bool> m_is_closed{false};
+    std::vector<uint8_t> m_datagram;
+    // frame being reassembled
+    std::vector<uint8_t> m_payload;
+    std::vector<uint8_t> m_is_fragment_received;
+    size_t m_total_fragments_received = 0;
+    uint64_t m_sequence = 0;
+    bool m_is_assembling = false;
+    Network_Bit_Format m_format = Network_Bit_Format::SOFT;
+    std::vector<viterbi_bit_t> m_frame_bits;
+    size_t m_frame_offset = 0;
+    bool m_is_first_sequence = true;
+    uint64_t m_expected_sequence = 0;
+    Network_Frame_Statistics m_stats;
+    std::mutex m_mutex_stats;
+public:
+    explicit UDP_Multicast_Frame_Receiver(const int transmission_mode): m_transmission_mode(transmission_mode) {
+        m_nb_frame_bits = size_t(get_dab_parameters(m_transmission_mode).nb_frame_bits);
+        m_frame_bits.resize(m_nb_frame_bits);
+        m_frame_offset = m_nb_frame_bits;
+        m_datagram.resize(65536);
+    }
+    ~UDP_Multicast_Frame_Receiver() override { close(); }
+    UDP_Multicast_Frame_Receiver(UDP_Multicast_Frame_Receiver&) = delete;
+    UDP_Multicast_Frame_Receiver(UDP_Multicast_Frame_Receiver&&) = delete;
+    UDP_Multicast_Frame_Receiver& operator=(UDP_Multicast_Frame_Receiver&) = delete;
+    UDP_Multicast_Frame_Receiver& operator=(UDP_Multicast_Frame_Receiver&&) = delete;
+    // interface is the local IPv4 address to join the group on (empty for any)
+    // NOTE: A large receive buffer is requested since a whole frame arrives as a burst of datagrams
+    bool open(const std::string& group, const uint16_t port, const std::string& interface_address="") {
+        using namespace network_internal;
+        if (!init_network()) return false;
+        socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == INVALID_SOCKET_HANDLE) return false;
+        const int is_reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&is_reuse), sizeof(is_reuse));
+        const int receive_buffer_size = 8*1024*1024;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receive_buffer_size), sizeof(receive_buffer_size));
+        struct sockaddr_in local_address;
+        memset(&local_address, 0, sizeof(local_address));
+        local_address.sin_family = AF_INET;
+        local_address.sin_port = htons(port);
+        local_address.sin_addr.s_addr = htonl(INADDR_ANY);
+        struct ip_mreq request;
+        memset(&request, 0, sizeof(request));
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        bool is_valid = bind(s, reinterpret_cast<const struct sockaddr*>(&local_address), sizeof(local_address)) == 0;
+        is_valid = is_valid && (inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) == 1);
+        if (is_valid && !interface_address.empty()) {
+            is_valid = inet_pton(AF_INET, interface_address.c_str(), &request.imr_interface) == 1;
+        }
+        is_valid = is_valid && (setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&request), sizeof(request)) == 0);
+        if (!is_valid) {
+            network_internal::close_socket(s);
+            return false;
+        }
+        m_socket.store(s);
+        return true;
+    }
+    // Unblocks a pending read from another thread
+    void close() {
+        m_is_closed.store(true);
+        const socket_t s = m_socket.exchange(network_internal::INVALID_SOCKET_HANDLE);
+        if (s == network_internal::INVALID_SOCKET_HANDLE) return;
+        #if _WIN32
+        shutdown(s, SD_BOTH);
+        #else
+        shutdown(s, SHUT_RDWR);
+        #endif
+        network_internal::close_socket(s);
+    }
+    Network_Frame_Statistics get_statistics() {
+        auto lock = std::scoped_lock(m_mutex_stats);
+        return m_stats;
+    }
+    size_t read(tcb::span<viterbi_bit_t> dest) override {
+        size_t total_read = 0;
+        while (!dest.empty()) {
+            if (m_frame_offset == m_nb_frame_bits) {
+                if (!read_frame()) break;
+                m_frame_offset = 0;
+            }
+            const size_t length = std::min(dest.size(), m_nb_frame_bits-m_frame_offset);
+            memcpy(dest.data(), &m_frame_bits[m_frame_offset], length*sizeof(viterbi_bit_t));
+            m_frame_offset += length;
+            dest = dest.subspan(length);
+            total_read += length;
+        }
+        return total_read;
+    }
+private:
+    bool read_frame() {
+        using namespace network_internal;
+        while (!m_is_closed.load()) {
+            const socket_t s = m_socket.load();
+            if (s == INVALID_SOCKET_HANDLE) return false;
+            const auto length = recv(s, reinterpret_cast<char*>(m_datagram.data()), int(m_datagram.size()), 0);
+            if (length < 0) return false;
+            if (size_t(length) < FRAGMENT_HEADER_SIZE) continue;
+            const uint8_t* header = m_datagram.data();
+            if (memcmp(&header[0], FRAGMENT_MAGIC, sizeof(FRAGMENT_MAGIC)) != 0) continue;
+            if ((header[4] != VERSION) || (int(header[5]) != m_transmission_mode)) continue;
+            const auto format = Network_Bit_Format(header[6]);
+            if (uint8_t(format) > uint8_t(Network_Bit_Format::PACKED)) continue;
+            const uint64_t sequence = get_le<uint64_t>(&header[8]);
+            const size_t payload_size = get_le<uint32_t>(&header[16]);
+            const size_t offset = get_le<uint32_t>(&header[20]);
+            const size_t fragment_index = get_le<uint16_t>(&header[24]);
+            const size_t total_fragments = get_le<uint16_t>(&header[26]);
+            const size_t fragment_length = size_t(length) - FRAGMENT_HEADER_SIZE;
+            if (payload_size != get_payload_size(format, m_nb_frame_bits)) continue;
+            if ((offset + fragment_length > payload_size) || (fragment_index >= total_fragments)) continue;
+
+            if (!m_is_assembling || (sequence != m_sequence)) {
+                // fragments of an older frame that arrived late are ignored
+                if (m_is_assembling && (sequence < m_sequence) && (m_sequence - sequence) < 16) continue;
+                if (m_is_assembling) {
+                    auto lock = std::scoped_lock(m_mutex_stats);
+                    m_stats.total_dropped++;
+                }
+                m_is_assembling = true;
+                m_sequence = sequence;
+                m_format = format;
+                m_payload.resize(payload_size);
+                m_is_fragment_received.assign(total_fragments, 0);
+                m_total_fragments_received = 0;
+            }
+            if ((total_fragments != m_is_fragment_received.size()) || (format != m_format)) continue;
+            if (m_is_fragment_received[fragment_index]) continue;
+            m_is_fragment_received[fragment_index] = 1;
+            m_total_fragments_received++;
+            memcpy(&m_payload[offset], &m_datagram[FRAGMENT_HEADER_SIZE], fragment_length);
+            if (m_total_fragments_received != total_fragments) continue;
+
+            m_is_assembling = false;
+            decode_payload(m_format, m_payload, m_frame_bits);
+            auto lock = std::scoped_lock(m_mutex_stats);
+            update_sequence(m_stats, m_is_first_sequence, m_expected_sequence, sequence);
+            m_stats.total_frames++;
+            return true;
+        }
+        return false;
+    }
+};
@@ -1,15 +1,20 @@
 #pragma once
 
+#include <assert.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <algorithm>
+#include <atomic>
 #include <complex>
 #include <memory>
 #include <vector>
 #include "utility/span.h"
-#include "ofdm/dab_mapper_ref.h"
-#include "ofdm/dab_ofdm_params_ref.h"
-#include "ofdm/dab_prs_ref.h"
+#include "utility/latency_trace.h"
+#include "utility/spsc_frame_ring.h"
+#include "ofdm/dab_ofdm_tables.h"
 #include "ofdm/ofdm_demodulator.h"
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "utility/thread_affinity_platform.h"
 #include "viterbi_config.h"
 #include "./app_io_buffers.h"
 
@@ -24,12 +29,21 @@ struct RawIQ {
         );
     };
 };
+static_assert(sizeof(RawIQ) == 2, "RawIQ must be interleaved bytes for convert_raw_iq_auto");
+
+// Vectorised conversion of a block with the same result as RawIQ::to_c32()
+static inline void convert_raw_iq_block(tcb::span<const RawIQ> src, tcb::span<std::complex<float>> dest) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(src.data());
+    convert_raw_iq_auto({ bytes, src.size()*sizeof(RawIQ) }, dest.first(src.size()));
+}
 
 class OFDM_Convert_RawIQ: public InputBuffer<std::complex<float>>
 {
 public:
 private:
     std::shared_ptr<InputBuffer<RawIQ>> m_input = nullptr;
+    // converts directly from the input's storage if it has one
+    std::shared_ptr<SpanInputBuffer<RawIQ>> m_span_input = nullptr;
     std::vector<RawIQ> m_buffer;
 public:
     OFDM_Convert_RawIQ() {}
@@ -39,14 +53,24 @@ public:
     }
     void set_input_stream(std::shared_ptr<InputBuffer<RawIQ>> input) {
         m_input = input;
+        m_span_input = std::dynamic_pointer_cast<SpanInputBuffer<RawIQ>>(input);
     }
     size_t read(tcb::span<std::complex<float>> dest) override {
+        if (m_span_input != nullptr) {
+            // NOTE: Spans can be shorter than requested if the input's storage is split into blocks
+            size_t total_read = 0;
+            while (total_read < dest.size()) {
+                const auto src = m_span_input->read_span(dest.size()-total_read);
+                if (src.empty()) break;
+                convert_raw_iq_block(src, dest.subspan(total_read));
+                total_read += src.size();
+            }
+            return total_read;
+        }
         if (m_input == nullptr) return 0;
         m_buffer.resize(dest.size());
         const size_t length = m_input->read(m_buffer);
-        for (size_t i = 0; i < length; i++) {
-            dest[i] = m_buffer[i].to_c32(); 
-        }
+        convert_raw_iq_block(tcb::span(m_buffer).first(length), dest);
         return length;
     }
 };
@@ -55,42 +79,100 @@ class OFDM_Block
 {
 private:
     std::shared_ptr<InputBuffer<std::complex<float>>> m_input_stream = nullptr;
+    std::shared_ptr<SpanInputBuffer<std::complex<float>>> m_span_input_stream = nullptr;
     std::shared_ptr<OutputBuffer<viterbi_bit_t>> m_output_stream = nullptr;
     std::unique_ptr<OFDM_Demod> m_ofdm_demod = nullptr;
     std::vector<std::complex<float>> m_buffer;
+    // last block given to the demodulator which may point into the input's storage
+    tcb::span<const std::complex<float>> m_last_block;
+    // CPU time of the thread reading blocks in run()
+    std::atomic<uint64_t> m_total_reader_cpu_time_ns{0};
 public:
-    OFDM_Block(const int transmission_mode, const size_t total_threads) {
-        const auto ofdm_params = get_DAB_OFDM_params(transmission_mode);
-        auto ofdm_prs_ref = std::vector<std::complex<float>>(ofdm_params.nb_fft);
-        get_DAB_PRS_reference(transmission_mode, ofdm_prs_ref);
-        auto ofdm_mapper_ref = std::vector<int>(ofdm_params.nb_data_carriers);
-        get_DAB_mapper_ref(ofdm_mapper_ref, ofdm_params.nb_fft);
-        m_ofdm_demod = std::make_unique<OFDM_Demod>(ofdm_params, ofdm_prs_ref, ofdm_mapper_ref, int(total_threads));
+    OFDM_Block(
+        const int transmission_mode, const size_t total_threads,
+        const OFDM_Demod_Sync_Mode sync_mode=OFDM_Demod_Sync_Mode::BLOCKING,
+        const OFDM_Demod_Thread_Config& thread_config={},
+        std::shared_ptr<OFDM_Demod_Executor> executor=nullptr,
+        const OFDM_Demod_Precision precision=OFDM_Demod_Precision::FLOAT32)
+    {
+        const auto& tables = get_DAB_OFDM_tables(transmission_mode);
+        m_ofdm_demod = std::make_unique<OFDM_Demod>(
+            tables.params, tables.prs_fft_ref, tables.carrier_mapper,
+            int(total_threads), sync_mode, thread_config, executor, precision);
         m_ofdm_demod->On_OFDM_Frame().Attach([this](tcb::span<const viterbi_bit_t> buf){
             if (m_output_stream == nullptr) return; 
             m_output_stream->write(buf);
         });
     }
     auto& get_ofdm_demod() { return *(m_ofdm_demod.get()); }
-    tcb::span<const std::complex<float>> get_buffer() const { return m_buffer; }
+    uint64_t get_reader_cpu_time() const { return m_total_reader_cpu_time_ns.load(std::memory_order_relaxed); }
+    tcb::span<const std::complex<float>> get_buffer() const { return m_last_block; }
     void set_input_stream(std::shared_ptr<InputBuffer<std::complex<float>>> stream) { 
         m_input_stream = stream; 
+        m_span_input_stream = std::dynamic_pointer_cast<SpanInputBuffer<std::complex<float>>>(stream);
     }
     void set_output_stream(std::shared_ptr<OutputBuffer<viterbi_bit_t>> stream) { 
         m_output_stream = stream; 
     }
+    // Each segment of a frame is written to its own slot as soon as it is demodulated, see OFDM_Demod::SetOutputSegments()
+    // Slots for the whole frame are reserved with its first segment so the reader only ever gets complete frames
+    // Frames are dropped if the ring is full unless is_blocking waits for the reader (e.g. for file input)
+    // NOTE: Slots must be long enough for the largest segment
+    bool set_output_segment_ring(
+        std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> ring, tcb::span<const size_t> segment_symbols, 
+        const bool is_blocking=false
+    ) {
+        if (!m_ofdm_demod->SetOutputSegments(segment_symbols)) return false;
+        const size_t total_segments = segment_symbols.size();
+        m_ofdm_demod->On_OFDM_Segment().Attach(
+            [ring, total_segments, is_blocking, is_dropped=false](size_t segment, tcb::span<const viterbi_bit_t> bits) mutable {
+                if (segment == 0) {
+                    if (is_blocking) {
+                        is_dropped = !ring->wait_for_free_slots(total_segments);
+                    } else {
+                        is_dropped = (ring->get_total_slots() - ring->get_total_used()) < total_segments;
+                    }
+                    if (is_dropped) ring->drop();
+                }
+                if (is_dropped) return;
+                auto slot = ring->acquire_write();
+                assert(slot.size() >= bits.size());
+                std::copy(bits.begin(), bits.end(), slot.begin());
+                ring->commit_write(get_latency_trace_block_time());
+            }
+        );
+        return true;
+    }
     void run(size_t block_size) {
         if (m_input_stream == nullptr) return;
-        m_buffer.resize(block_size);
+        if (m_span_input_stream == nullptr) {
+            m_buffer.resize(block_size);
+        }
+        const bool is_persistent = (m_span_input_stream != nullptr) && m_span_input_stream->get_is_span_persistent();
         bool is_finished = false;
+        uint64_t cpu_time_ns = get_thread_cpu_time_ns();
         while (!is_finished) {
-            const size_t length = m_input_stream->read(m_buffer);
-            if (length != block_size) {
+            tcb::span<const std::complex<float>> buf;
+            if (m_span_input_stream != nullptr) {
+                buf = m_span_input_stream->read_span(block_size);
+            } else {
+                const size_t length = m_input_stream->read(m_buffer);
+                buf = tcb::span(m_buffer).first(length);
+            }
+            if (buf.size() != block_size) {
                 is_finished = true;
             }
-            if (length == 0) break;
-            auto buf = tcb::span(m_buffer).first(length);
-            m_ofdm_demod->Process(buf);
+            if (buf.empty()) break;
+            m_last_block = buf;
+            // the demodulator can keep references to samples which will stay valid
+            if (is_persistent) {
+                m_ofdm_demod->ProcessZeroCopy(buf);
+            } else {
+                m_ofdm_demod->Process(buf);
+            }
+            const uint64_t new_cpu_time_ns = get_thread_cpu_time_ns();
+            m_total_reader_cpu_time_ns.fetch_add(new_cpu_time_ns-cpu_time_ns, std::memory_order_relaxed);
+            cpu_time_ns = new_cpu_time_ns;
         }
     }
 };
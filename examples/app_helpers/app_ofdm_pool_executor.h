@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include "basic_radio/basic_thread_pool.h"
+#include "ofdm/ofdm_demodulator_threads.h"
+
+// Runs the pipelines of a demodulator on a shared thread pool instead of its own threads
+// The jobs are pushed into the submission deque of a client that is reserved for the demodulator
+// The jobs are high priority since every radio waits on the demodulator for its next frame
+// NOTE: The client must not be used by any other thread since only its owner can push into it
+class App_OFDM_Pool_Executor: public OFDM_Demod_Executor
+{
+private:
+    std::shared_ptr<BasicThreadPool> m_pool;
+    const size_t m_client;
+    BasicTaskGroup m_group;
+public:
+    App_OFDM_Pool_Executor(std::shared_ptr<BasicThreadPool> pool, const size_t client)
+    : m_pool(std::move(pool)), m_client(client) {}
+    ~App_OFDM_Pool_Executor() override {
+        m_group.WaitDone();
+    }
+    App_OFDM_Pool_Executor(App_OFDM_Pool_Executor&) = delete;
+    App_OFDM_Pool_Executor(App_OFDM_Pool_Executor&&) = delete;
+    App_OFDM_Pool_Executor& operator=(App_OFDM_Pool_Executor&) = delete;
+    App_OFDM_Pool_Executor& operator=(App_OFDM_Pool_Executor&&) = delete;
+    size_t GetClient() const { return m_client; }
+    void Submit(const OFDM_Demod_Job& job) override {
+        auto pool_scope = BasicThreadPool::ClientScope(*m_pool, m_client);
+        m_pool->PushTask(m_group, BasicTaskPriority::HIGH, [job]() { job(); });
+    }
+};
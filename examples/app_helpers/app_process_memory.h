@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <stdio.h>
+    #include <string.h>
+    #include <sys/resource.h>
+#endif
+
+// Peak resident memory of the process in bytes (0 if unknown)
+static inline uint64_t get_peak_memory_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return uint64_t(counters.PeakWorkingSetSize);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    #if defined(__APPLE__)
+    return uint64_t(usage.ru_maxrss);
+    #else
+    // linux reports kilobytes
+    return uint64_t(usage.ru_maxrss)*1024;
+    #endif
+#endif
+}
+
+#if defined(__linux__)
+// Reads an integer field such as "VmRSS:" from /proc/self/status (-1 if missing)
+static inline int64_t get_proc_status_field(const char* name) {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == nullptr) return -1;
+    const size_t name_length = strlen(name);
+    char line[256];
+    int64_t value = -1;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (strncmp(line, name, name_length) != 0) continue;
+        long long field = 0;
+        if (sscanf(line+name_length, "%lld", &field) == 1) value = int64_t(field);
+        break;
+    }
+    fclose(file);
+    return value;
+}
+#endif
+
+// Current resident memory of the process in bytes (0 if unknown)
+static inline uint64_t get_current_memory_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return uint64_t(counters.WorkingSetSize);
+#elif defined(__linux__)
+    // linux reports kilobytes
+    const int64_t kilobytes = get_proc_status_field("VmRSS:");
+    return (kilobytes > 0) ? uint64_t(kilobytes)*1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+// Number of threads in the process (0 if unknown)
+static inline uint64_t get_total_process_threads() {
+#if defined(__linux__)
+    const int64_t total_threads = get_proc_status_field("Threads:");
+    return (total_threads > 0) ? uint64_t(total_threads) : 0;
+#else
+    return 0;
+#endif
+}
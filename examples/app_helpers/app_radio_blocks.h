@@ -1,10 +1,20 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <vector>
 #include "basic_radio/basic_radio.h"
 #include "dab/constants/dab_parameters.h"
+#include "utility/latency_trace.h"
+#include "utility/observable.h"
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "utility/thread_affinity_platform.h"
 #include "viterbi_config.h"
 #include "./app_io_buffers.h"
 
@@ -12,26 +22,180 @@ class Basic_Radio_Block
 {
 private:
     std::shared_ptr<InputBuffer<viterbi_bit_t>> m_input_stream = nullptr;
+    std::shared_ptr<SpanInputBuffer<viterbi_bit_t>> m_span_input_stream = nullptr;
+    std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> m_input_ring = nullptr;
+    std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> m_input_segment_ring = nullptr;
     std::unique_ptr<BasicRadio> m_basic_radio = nullptr;
     std::vector<viterbi_bit_t> m_bits_buffer;
     DAB_Parameters m_dab_params;
+    // frames read from the input stream and decoded together, see BasicRadio::ProcessBatch()
+    size_t m_batch_frames = 1;
+    // CPU time of the thread decoding frames in run()
+    std::atomic<uint64_t> m_total_driver_cpu_time_ns{0};
+    // notified on the thread running the radio after each frame with its bits and the time Process() took
+    Observable<BasicRadio&, tcb::span<const viterbi_bit_t>, std::chrono::nanoseconds> m_obs_frame;
 public:
-    Basic_Radio_Block(const int transmission_mode, const size_t total_threads)
+    Basic_Radio_Block(
+        const int transmission_mode, const size_t total_threads,
+        const Thread_Affinity& thread_affinity={})
     {
         m_dab_params = get_dab_parameters(transmission_mode);
-        m_basic_radio = std::make_unique<BasicRadio>(m_dab_params, total_threads);
+        m_basic_radio = std::make_unique<BasicRadio>(m_dab_params, total_threads, thread_affinity);
+        m_bits_buffer.resize(m_dab_params.nb_frame_bits);
+    }
+    // radio is a client of a thread pool shared with other radios
+    Basic_Radio_Block(
+        const int transmission_mode, 
+        std::shared_ptr<BasicThreadPool> thread_pool, const size_t thread_pool_client)
+    {
+        m_dab_params = get_dab_parameters(transmission_mode);
+        m_basic_radio = std::make_unique<BasicRadio>(m_dab_params, thread_pool, thread_pool_client);
         m_bits_buffer.resize(m_dab_params.nb_frame_bits);
     }
     BasicRadio& get_basic_radio() { return *(m_basic_radio.get()); }
+    uint64_t get_driver_cpu_time() const { return m_total_driver_cpu_time_ns.load(std::memory_order_relaxed); }
     void set_input_stream(std::shared_ptr<InputBuffer<viterbi_bit_t>> stream) { 
         m_input_stream = stream; 
+        m_span_input_stream = std::dynamic_pointer_cast<SpanInputBuffer<viterbi_bit_t>>(stream);
+    }
+    void set_input_ring(std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> ring) {
+        m_input_ring = ring;
+    }
+    // ring holds the FIC and then each CIF of a frame in its own slot, see OFDM_Block::set_output_segment_ring()
+    void set_input_segment_ring(std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> ring) {
+        m_input_segment_ring = ring;
+    }
+    // Frames from the input stream are decoded in batches which is faster for recordings that are read up front
+    // NOTE: This doesn't apply to the input rings since their frames arrive as they are demodulated
+    void set_batch_frames(const size_t total_frames) {
+        m_batch_frames = std::max(total_frames, size_t(1));
+        m_bits_buffer.resize(m_batch_frames*size_t(m_dab_params.nb_frame_bits));
     }
+    // NOTE: Attach to this before run() is called
+    // Each frame of a batch is notified with its share of the time taken to decode the batch
+    auto& on_frame() { return m_obs_frame; }
     void run() {
+        if (m_input_segment_ring != nullptr) {
+            run_segment_ring();
+            return;
+        }
+        if (m_input_ring != nullptr) {
+            run_ring();
+            return;
+        }
         if (m_input_stream == nullptr) return;  
+        if (m_span_input_stream != nullptr) {
+            run_span();
+            return;
+        }
+        const size_t frame_length = size_t(m_dab_params.nb_frame_bits);
+        uint64_t cpu_time_ns = get_thread_cpu_time_ns();
         while (true) {
             const size_t length = m_input_stream->read(m_bits_buffer);
+            const size_t total_frames = length/frame_length;
+            if (total_frames == 0) return;
+            process_frames(tcb::span(m_bits_buffer).first(total_frames*frame_length));
+            update_driver_cpu_time(cpu_time_ns);
             if (length != m_bits_buffer.size()) return;
-            m_basic_radio->Process(m_bits_buffer);
         }
     }
+private:
+    // decode frames in place from the input's storage
+    void run_span() {
+        const size_t frame_length = size_t(m_dab_params.nb_frame_bits);
+        uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+        while (true) {
+            const auto frames = m_span_input_stream->read_span(m_bits_buffer.size());
+            const size_t total_frames = frames.size()/frame_length;
+            if (total_frames == 0) return;
+            process_frames(frames.first(total_frames*frame_length));
+            update_driver_cpu_time(cpu_time_ns);
+            if (frames.size() != m_bits_buffer.size()) return;
+        }
+    }
+    void process_frames(tcb::span<const viterbi_bit_t> frames) {
+        const size_t frame_length = size_t(m_dab_params.nb_frame_bits);
+        const size_t total_frames = frames.size()/frame_length;
+        const auto process_start = std::chrono::steady_clock::now();
+        if (total_frames == 1) {
+            m_basic_radio->Process(frames);
+            on_frame_processed(frames, process_start);
+            return;
+        }
+        m_basic_radio->ProcessBatch(frames);
+        const auto process_time = (std::chrono::steady_clock::now() - process_start) / total_frames;
+        for (size_t i = 0; i < total_frames; i++) {
+            const auto frame = frames.subspan(i*frame_length, frame_length);
+            m_obs_frame.Notify(*m_basic_radio, frame, std::chrono::duration_cast<std::chrono::nanoseconds>(process_time));
+        }
+    }
+    // decode frames in place from the ring so demodulation of the next frame isn't blocked
+    void run_ring() {
+        constexpr auto POLL_PERIOD = std::chrono::milliseconds(1);
+        uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+        while (true) {
+            // the producer can push its last frames right before closing so only stop once closed and drained
+            const bool is_closed = m_input_ring->is_closed();
+            auto frame = m_input_ring->acquire_read();
+            if (frame.empty()) {
+                if (is_closed) return;
+                std::this_thread::sleep_for(POLL_PERIOD);
+                continue;
+            }
+            const auto process_start = std::chrono::steady_clock::now();
+            {
+                const Latency_Trace_Scope latency_scope(m_input_ring->get_read_timestamp());
+                m_basic_radio->Process(frame);
+            }
+            // the frame is only valid until it is released
+            on_frame_processed(frame, process_start);
+            m_input_ring->release_read();
+            update_driver_cpu_time(cpu_time_ns);
+        }
+    }
+    // decode the FIC and each CIF as soon as they are demodulated
+    // the segments are gathered into a frame for the observers of on_frame()
+    void run_segment_ring() {
+        constexpr auto POLL_PERIOD = std::chrono::milliseconds(1);
+        const size_t total_segments = size_t(m_dab_params.nb_cifs)+1;
+        size_t segment_index = 0;
+        auto process_time = std::chrono::steady_clock::duration::zero();
+        uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+        while (true) {
+            const bool is_closed = m_input_segment_ring->is_closed();
+            auto slot = m_input_segment_ring->acquire_read();
+            if (slot.empty()) {
+                if (is_closed) return;
+                std::this_thread::sleep_for(POLL_PERIOD);
+                continue;
+            }
+            const size_t offset = (segment_index == 0) ? 0 : size_t(m_dab_params.nb_fic_bits) + (segment_index-1)*size_t(m_dab_params.nb_cif_bits);
+            const size_t length = size_t((segment_index == 0) ? m_dab_params.nb_fic_bits : m_dab_params.nb_cif_bits);
+            const auto segment = slot.first(length);
+            const auto process_start = std::chrono::steady_clock::now();
+            {
+                const Latency_Trace_Scope latency_scope(m_input_segment_ring->get_read_timestamp());
+                m_basic_radio->ProcessSegment(segment_index, segment);
+            }
+            process_time += std::chrono::steady_clock::now() - process_start;
+            std::copy(segment.begin(), segment.end(), m_bits_buffer.begin()+offset);
+            m_input_segment_ring->release_read();
+            segment_index++;
+            if (segment_index == total_segments) {
+                m_obs_frame.Notify(*m_basic_radio, m_bits_buffer, std::chrono::duration_cast<std::chrono::nanoseconds>(process_time));
+                segment_index = 0;
+                process_time = std::chrono::steady_clock::duration::zero();
+            }
+            update_driver_cpu_time(cpu_time_ns);
+        }
+    }
+    void on_frame_processed(tcb::span<const viterbi_bit_t> frame, const std::chrono::steady_clock::time_point process_start) {
+        const auto process_time = std::chrono::steady_clock::now() - process_start;
+        m_obs_frame.Notify(*m_basic_radio, frame, std::chrono::duration_cast<std::chrono::nanoseconds>(process_time));
+    }
+    void update_driver_cpu_time(uint64_t& cpu_time_ns) {
+        const uint64_t new_cpu_time_ns = get_thread_cpu_time_ns();
+        m_total_driver_cpu_time_ns.fetch_add(new_cpu_time_ns-cpu_time_ns, std::memory_order_relaxed);
+        cpu_time_ns = new_cpu_time_ns;
+    }
 };
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include "basic_radio/basic_ensemble_config.h"
+#include "basic_radio/basic_radio_checkpoint.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "viterbi_config.h"
+
+// Radio checkpoint along with the OFDM synchronisation so a restarted or standby process takes over without waiting for the FIC
+// File = [header][channel]...[channel][subchannel]...[subchannel][cif soft bits]
+// NOTE: All fields are little endian
+//       The file is written to a temporary file and renamed so a reader never sees a partial checkpoint
+struct App_Radio_Checkpoint {
+    Basic_Radio_Checkpoint radio;
+    std::optional<OFDM_Demod_Acquisition> acquisition;
+};
+
+namespace checkpoint_internal {
+
+static constexpr char FILE_MAGIC[8] = {'D','A','B','C','K','P','T','1'};
+static constexpr uint16_t VERSION = 1;
+static constexpr size_t FILE_HEADER_SIZE = 48;
+static constexpr size_t CHANNEL_SIZE = 16;
+static constexpr size_t SUBCHANNEL_SIZE = 8;
+
+template <typename T>
+static void put_le(uint8_t* buf, const T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = uint8_t(uint64_t(v) >> (8*i));
+    }
+}
+
+template <typename T>
+static T get_le(const uint8_t* buf) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(buf[i]) << (8*i);
+    }
+    return T(v);
+}
+
+static void put_float(uint8_t* buf, const float v) {
+    uint32_t bits = 0;
+    memcpy(&bits, &v, sizeof(bits));
+    put_le<uint32_t>(buf, bits);
+}
+
+static float get_float(const uint8_t* buf) {
+    const uint32_t bits = get_le<uint32_t>(buf);
+    float v = 0.0f;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+}
+
+static inline bool save_radio_checkpoint(const std::string& filename, const App_Radio_Checkpoint& checkpoint) {
+    using namespace checkpoint_internal;
+    const auto& radio = checkpoint.radio;
+    const auto& channels = radio.config.channels;
+    std::vector<uint8_t> data(FILE_HEADER_SIZE + channels.size()*CHANNEL_SIZE + radio.subchannels.size()*SUBCHANNEL_SIZE, 0);
+    uint8_t* header = data.data();
+    memcpy(&header[0], FILE_MAGIC, sizeof(FILE_MAGIC));
+    put_le<uint16_t>(&header[8], VERSION);
+    put_le<uint16_t>(&header[10], uint16_t(radio.config.ensemble_id));
+    put_le<uint32_t>(&header[12], uint32_t(radio.nb_cif_bits));
+    put_le<uint32_t>(&header[16], uint32_t(radio.cif_bits.size()));
+    put_le<uint32_t>(&header[20], uint32_t(channels.size()));
+    put_le<uint32_t>(&header[24], uint32_t(radio.subchannels.size()));
+    put_le<uint8_t>(&header[28], uint8_t(sizeof(viterbi_bit_t)));
+    put_le<uint8_t>(&header[29], uint8_t(checkpoint.acquisition.has_value()));
+    if (checkpoint.acquisition.has_value()) {
+        put_float(&header[32], checkpoint.acquisition->coarse_freq_offset);
+        put_float(&header[36], checkpoint.acquisition->fine_freq_offset);
+        put_float(&header[40], checkpoint.acquisition->signal_l1_average);
+    }
+    uint8_t* buf = data.data() + FILE_HEADER_SIZE;
+    for (const auto& channel: channels) {
+        const auto& subchannel = channel.subchannel;
+        put_le<uint8_t>(&buf[0], uint8_t(subchannel.id));
+        put_le<uint16_t>(&buf[2], uint16_t(subchannel.start_address));
+        put_le<uint16_t>(&buf[4], uint16_t(subchannel.length));
+        put_le<uint8_t>(&buf[6], uint8_t(subchannel.is_uep));
+        put_le<uint8_t>(&buf[7], uint8_t(subchannel.uep_prot_index));
+        put_le<uint8_t>(&buf[8], uint8_t(subchannel.eep_prot_level));
+        put_le<uint8_t>(&buf[9], uint8_t(subchannel.eep_type));
+        put_le<uint8_t>(&buf[10], uint8_t(subchannel.fec_scheme));
+        put_le<uint8_t>(&buf[11], uint8_t(channel.transport_mode));
+        put_le<uint8_t>(&buf[12], uint8_t(channel.audio_service_type));
+        put_le<uint8_t>(&buf[13], uint8_t(channel.data_service_type));
+        buf += CHANNEL_SIZE;
+    }
+    for (const auto& subchannel: radio.subchannels) {
+        put_le<uint8_t>(&buf[0], uint8_t(subchannel.id));
+        put_le<int32_t>(&buf[4], int32_t(subchannel.superframe_phase));
+        buf += SUBCHANNEL_SIZE;
+    }
+
+    const std::string temp_filename = filename + ".tmp";
+    FILE* fp = fopen(temp_filename.c_str(), "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "Failed to open radio checkpoint '%s' for writing\n", temp_filename.c_str());
+        return false;
+    }
+    bool is_written = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    const size_t nb_cif_bytes = radio.cif_bits.size()*sizeof(viterbi_bit_t);
+    is_written = is_written && (fwrite(radio.cif_bits.data(), 1, nb_cif_bytes, fp) == nb_cif_bytes);
+    is_written = (fclose(fp) == 0) && is_written;
+    if (!is_written) {
+        fprintf(stderr, "Failed to write radio checkpoint '%s'\n", temp_filename.c_str());
+        remove(temp_filename.c_str());
+        return false;
+    }
+    // NOTE: Windows doesn't replace an existing file when renaming
+#if _WIN32
+    remove(filename.c_str());
+#endif
+    if (rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        fprintf(stderr, "Failed to replace radio checkpoint '%s'\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+static inline std::optional<App_Radio_Checkpoint> load_radio_checkpoint(const std::string& filename) {
+    using namespace checkpoint_internal;
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == nullptr) return std::nullopt;
+    const auto read_checkpoint = [fp]() -> std::optional<App_Radio_Checkpoint> {
+        uint8_t header[FILE_HEADER_SIZE];
+        if (fread(header, 1, FILE_HEADER_SIZE, fp) != FILE_HEADER_SIZE) return std::nullopt;
+        if (memcmp(header, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return std::nullopt;
+        if (get_le<uint16_t>(&header[8]) != VERSION) return std::nullopt;
+        if (get_le<uint8_t>(&header[28]) != uint8_t(sizeof(viterbi_bit_t))) return std::nullopt;
+        App_Radio_Checkpoint checkpoint;
+        auto& radio = checkpoint.radio;
+        radio.config.ensemble_id = ensemble_id_t(get_le<uint16_t>(&header[10]));
+        radio.nb_cif_bits = int(get_le<uint32_t>(&header[12]));
+        const size_t total_cif_bits = size_t(get_le<uint32_t>(&header[16]));
+        const size_t total_channels = size_t(get_le<uint32_t>(&header[20]));
+        const size_t total_subchannels = size_t(get_le<uint32_t>(&header[24]));
+        if (get_le<uint8_t>(&header[29]) != 0) {
+            OFDM_Demod_Acquisition acquisition;
+            acquisition.coarse_freq_offset = get_float(&header[32]);
+            acquisition.fine_freq_offset = get_float(&header[36]);
+            acquisition.signal_l1_average = get_float(&header[40]);
+            checkpoint.acquisition = acquisition;
+        }
+
+        std::vector<uint8_t> data(total_channels*CHANNEL_SIZE + total_subchannels*SUBCHANNEL_SIZE);
+        if (fread(data.data(), 1, data.size(), fp) != data.size()) return std::nullopt;
+        const uint8_t* buf = data.data();
+        for (size_t i = 0; i < total_channels; i++) {
+            Basic_Cached_Channel channel{subchannel_id_t(get_le<uint8_t>(&buf[0]))};
+            auto& subchannel = channel.subchannel;
+            subchannel.start_address = subchannel_addr_t(get_le<uint16_t>(&buf[2]));
+            subchannel.length = subchannel_size_t(get_le<uint16_t>(&buf[4]));
+            subchannel.is_uep = get_le<uint8_t>(&buf[6]) != 0;
+            subchannel.uep_prot_index = uep_protection_index_t(get_le<uint8_t>(&buf[7]));
+            subchannel.eep_prot_level = eep_protection_level_t(get_le<uint8_t>(&buf[8]));
+            subchannel.eep_type = EEP_Type(get_le<uint8_t>(&buf[9]));
+            subchannel.fec_scheme = FEC_Scheme(get_le<uint8_t>(&buf[10]));
+            subchannel.is_complete = true;
+            channel.transport_mode = TransportMode(get_le<uint8_t>(&buf[11]));
+            channel.audio_service_type = AudioServiceType(get_le<uint8_t>(&buf[12]));
+            channel.data_service_type = DataServiceType(get_le<uint8_t>(&buf[13]));
+            radio.config.channels.push_back(channel);
+            buf += CHANNEL_SIZE;
+        }
+        for (size_t i = 0; i < total_subchannels; i++) {
+            Basic_Subchannel_Checkpoint subchannel;
+            subchannel.id = subchannel_id_t(get_le<uint8_t>(&buf[0]));
+            subchannel.superframe_phase = int(get_le<int32_t>(&buf[4]));
+            radio.subchannels.push_back(subchannel);
+            buf += SUBCHANNEL_SIZE;
+        }
+
+        radio.cif_bits.resize(total_cif_bits);
+        const size_t nb_cif_bytes = total_cif_bits*sizeof(viterbi_bit_t);
+        if (fread(radio.cif_bits.data(), 1, nb_cif_bytes, fp) != nb_cif_bytes) return std::nullopt;
+        return checkpoint;
+    };
+    auto checkpoint = read_checkpoint();
+    fclose(fp);
+    if (!checkpoint.has_value()) {
+        fprintf(stderr, "Ignoring invalid radio checkpoint '%s'\n", filename.c_str());
+    }
+    return checkpoint;
+}
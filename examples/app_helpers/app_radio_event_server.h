@@ -0,0 +1,560 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include "basic_radio/basic_slideshow.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_updater.h"
+#include "utility/span.h"
+#include "./app_network_buffers.h"
+
+#if !_WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+// Publishes changes to the database, dynamic labels and slideshows to dashboards as server sent events
+// GET /events:
+//   A text/event-stream that starts with a "snapshot" event of the full state
+//   followed by "update" events that only contain what changed
+// GET /state:
+//   The full state as json
+// Changes are coalesced over an interval and serialised once into a message that is queued for every client
+// A client that falls too far behind has its queue replaced with a single snapshot of the full state
+// All clients are served by one thread with non-blocking sockets so hundreds of them cost about the same as one
+
+struct Radio_Event_Statistics {
+    uint64_t total_messages = 0;        // update messages serialised
+    uint64_t total_snapshots = 0;       // snapshot messages serialised
+    uint64_t total_connections = 0;
+    uint64_t total_active_clients = 0;
+    uint64_t total_resyncs = 0;         // slow clients that were sent a snapshot instead of their queued updates
+};
+
+namespace radio_event_internal {
+
+using Message = std::shared_ptr<const std::string>;
+
+static constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+static inline void append_json_string(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (const char c: text) {
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (uint8_t(c) < 0x20) {
+                fmt::format_to(std::back_inserter(out), "\\u{:04x}", unsigned(uint8_t(c)));
+            } else {
+                out.push_back(c);
+            }
+            break;
+        }
+    }
+    out.push_back('"');
+}
+
+static inline void append_json(std::string& out, const Ensemble& ensemble) {
+    fmt::format_to(std::back_inserter(out), "{{\"reference\":{},\"country_id\":{},\"label\":", ensemble.reference, ensemble.country_id);
+    append_json_string(out, ensemble.label);
+    fmt::format_to(std::back_inserter(out), ",\"nb_services\":{},\"local_time_offset\":{},\"is_complete\":{}}}",
+        ensemble.nb_services, ensemble.local_time_offset, ensemble.is_complete);
+}
+
+static inline void append_json(std::string& out, const Service& service) {
+    fmt::format_to(std::back_inserter(out), "{{\"reference\":{},\"label\":", service.reference);
+    append_json_string(out, service.label);
+    fmt::format_to(std::back_inserter(out), ",\"programme_type\":{},\"language\":{},\"is_complete\":{}}}",
+        service.programme_type, service.language, service.is_complete);
+}
+
+static inline void append_json(std::string& out, const ServiceComponent& component) {
+    fmt::format_to(std::back_inserter(out), "{{\"service_reference\":{},\"component_id\":{},\"subchannel_id\":{},\"label\":",
+        component.service_reference, component.component_id, component.subchannel_id);
+    append_json_string(out, component.label);
+    fmt::format_to(std::back_inserter(out), ",\"transport_mode\":{},\"audio_service_type\":{},\"data_service_type\":{},\"is_complete\":{}}}",
+        int(component.transport_mode), int(component.audio_service_type), int(component.data_service_type), component.is_complete);
+}
+
+static inline void append_json(std::string& out, const Subchannel& subchannel) {
+    fmt::format_to(std::back_inserter(out),
+        "{{\"id\":{},\"start_address\":{},\"length\":{},\"is_uep\":{},\"uep_prot_index\":{},\"eep_prot_level\":{},\"eep_type\":{},\"is_complete\":{}}}",
+        subchannel.id, subchannel.start_address, subchannel.length, subchannel.is_uep,
+        subchannel.uep_prot_index, subchannel.eep_prot_level, int(subchannel.eep_type), subchannel.is_complete);
+}
+
+// Only the metadata of a slideshow is published since dashboards fetch images separately
+struct Slideshow_Info {
+    uint32_t transport_id = 0;
+    std::string name;
+    std::string mime_type;
+    size_t total_bytes = 0;
+    std::string category_title;
+    std::string click_through_url;
+    bool is_emergency_alert = false;
+};
+
+static inline void append_json(std::string& out, const Slideshow_Info& slideshow) {
+    fmt::format_to(std::back_inserter(out), "{{\"transport_id\":{},\"name\":", slideshow.transport_id);
+    append_json_string(out, slideshow.name);
+    out.append(",\"mime_type\":");
+    append_json_string(out, slideshow.mime_type);
+    fmt::format_to(std::back_inserter(out), ",\"size\":{},\"category_title\":", slideshow.total_bytes);
+    append_json_string(out, slideshow.category_title);
+    out.append(",\"click_through_url\":");
+    append_json_string(out, slideshow.click_through_url);
+    fmt::format_to(std::back_inserter(out), ",\"is_emergency_alert\":{}}}", slideshow.is_emergency_alert);
+}
+
+// Entities of a type are written as an object keyed by their index into the database
+// which stays the same for the lifetime of the database
+template <typename T>
+static void append_json_entities(std::string& out, const char* key, const std::vector<T>& entities, const std::set<size_t>* indices) {
+    fmt::format_to(std::back_inserter(out), ",\"{}\":{{", key);
+    bool is_first = true;
+    const auto append_entity = [&](const size_t index) {
+        if (index >= entities.size()) return;
+        fmt::format_to(std::back_inserter(out), "{}\"{}\":", is_first ? "" : ",", index);
+        append_json(out, entities[index]);
+        is_first = false;
+    };
+    if (indices == nullptr) {
+        for (size_t i = 0; i < entities.size(); i++) append_entity(i);
+    } else {
+        for (const size_t i: *indices) append_entity(i);
+    }
+    out.push_back('}');
+}
+
+template <typename T>
+static void append_json_map(std::string& out, const char* key, const std::map<uint32_t, T>& values, const std::set<uint32_t>* keys) {
+    fmt::format_to(std::back_inserter(out), ",\"{}\":{{", key);
+    bool is_first = true;
+    const auto append_value = [&](const uint32_t id, const T& value) {
+        fmt::format_to(std::back_inserter(out), "{}\"{}\":", is_first ? "" : ",", id);
+        if constexpr (std::is_same_v<T, std::string>) {
+            append_json_string(out, value);
+        } else {
+            append_json(out, value);
+        }
+        is_first = false;
+    };
+    if (keys == nullptr) {
+        for (const auto& [id, value]: values) append_value(id, value);
+    } else {
+        for (const uint32_t id: *keys) {
+            auto res = values.find(id);
+            if (res != values.end()) append_value(id, res->second);
+        }
+    }
+    out.push_back('}');
+}
+
+static inline bool set_non_blocking(network_internal::socket_t s) {
+#if _WIN32
+    u_long is_non_blocking = 1;
+    return ioctlsocket(s, FIONBIO, &is_non_blocking) == 0;
+#else
+    const int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+#if _WIN32
+using pollfd_t = WSAPOLLFD;
+static inline int poll_sockets(pollfd_t* fds, size_t total_fds, int timeout_ms) { return WSAPoll(fds, ULONG(total_fds), timeout_ms); }
+#else
+using pollfd_t = struct pollfd;
+static inline int poll_sockets(pollfd_t* fds, size_t total_fds, int timeout_ms) { return ::poll(fds, nfds_t(total_fds), timeout_ms); }
+#endif
+
+}
+
+class Radio_Event_Server
+{
+private:
+    using socket_t = network_internal::socket_t;
+    using Message = radio_event_internal::Message;
+    using Slideshow_Info = radio_event_internal::Slideshow_Info;
+    using clock = std::chrono::steady_clock;
+    enum class Client_State { REQUEST, STREAM, CLOSE_AFTER_SEND };
+    struct Client {
+        socket_t socket = network_internal::INVALID_SOCKET_HANDLE;
+        Client_State state = Client_State::REQUEST;
+        std::string request;
+        // messages are shared with every other client and only the offset into the first is our own
+        std::deque<Message> queue;
+        size_t offset = 0;
+    };
+    const std::chrono::milliseconds m_interval;
+    const size_t m_max_queued_messages;
+    std::atomic<socket_t> m_listen_socket{network_internal::INVALID_SOCKET_HANDLE};
+    std::atomic<bool> m_is_closed{false};
+    std::unique_ptr<std::thread> m_thread;
+    // state written by the radio threads
+    std::mutex m_mutex_state;
+    std::shared_ptr<const DAB_Database> m_database;
+    std::map<uint32_t, std::string> m_dynamic_labels;
+    std::map<uint32_t, Slideshow_Info> m_slideshows;
+    std::set<size_t> m_dirty_services;
+    std::set<size_t> m_dirty_components;
+    std::set<size_t> m_dirty_subchannels;
+    bool m_is_dirty_ensemble = false;
+    std::set<uint32_t> m_dirty_dynamic_labels;
+    std::set<uint32_t> m_dirty_slideshows;
+    uint64_t m_version = 0;
+    // only used by the server thread
+    std::vector<std::unique_ptr<Client>> m_clients;
+    Message m_snapshot_message;
+    uint64_t m_snapshot_version = 0;
+    uint64_t m_published_version = 0;
+    std::mutex m_mutex_stats;
+    Radio_Event_Statistics m_stats;
+public:
+    // Clients that have more than max_queued_messages unsent updates are resynced with a snapshot
+    explicit Radio_Event_Server(const std::chrono::milliseconds interval=std::chrono::milliseconds(250), const size_t max_queued_messages=64)
+    : m_interval(std::max(interval, std::chrono::milliseconds(1))), m_max_queued_messages(std::max(max_queued_messages, size_t(1))) {}
+    ~Radio_Event_Server() { close(); }
+    Radio_Event_Server(Radio_Event_Server&) = delete;
+    Radio_Event_Server(Radio_Event_Server&&) = delete;
+    Radio_Event_Server& operator=(Radio_Event_Server&) = delete;
+    Radio_Event_Server& operator=(Radio_Event_Server&&) = delete;
+    // Returns false if the port couldn't be bound
+    bool listen(const std::string& address, const std::string& port) {
+        using namespace network_internal;
+        if (!init_network()) return false;
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        hints.ai_flags = AI_PASSIVE;
+        struct addrinfo* results = nullptr;
+        const char* node = address.empty() ? nullptr : address.c_str();
+        if (getaddrinfo(node, port.c_str(), &hints, &results) != 0) return false;
+        socket_t listen_socket = INVALID_SOCKET_HANDLE;
+        for (auto* res = results; res != nullptr; res = res->ai_next) {
+            socket_t s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            if (s == INVALID_SOCKET_HANDLE) continue;
+            const int is_reuse = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&is_reuse), sizeof(is_reuse));
+            if ((bind(s, res->ai_addr, int(res->ai_addrlen)) != 0) || (::listen(s, 64) != 0) ||
+                !radio_event_internal::set_non_blocking(s))
+            {
+                network_internal::close_socket(s);
+                continue;
+            }
+            listen_socket = s;
+            break;
+        }
+        freeaddrinfo(results);
+        if (listen_socket == INVALID_SOCKET_HANDLE) return false;
+        m_listen_socket.store(listen_socket);
+        m_thread = std::make_unique<std::thread>([this]() { run(); });
+        return true;
+    }
+    void close() {
+        if (m_is_closed.exchange(true)) return;
+        if (m_thread != nullptr) m_thread->join();
+        m_thread = nullptr;
+        const socket_t listen_socket = m_listen_socket.exchange(network_internal::INVALID_SOCKET_HANDLE);
+        if (listen_socket != network_internal::INVALID_SOCKET_HANDLE) network_internal::close_socket(listen_socket);
+        for (auto& client: m_clients) network_internal::close_socket(client->socket);
+        m_clients.clear();
+    }
+    // Called from BasicRadio::On_Database_Changes() with the snapshot the changes refer to
+    void update_database(std::shared_ptr<const DAB_Database> database, tcb::span<const DatabaseChange> changes) {
+        auto lock = std::scoped_lock(m_mutex_state);
+        m_database = std::move(database);
+        for (const auto& change: changes) {
+            switch (change.entity_type) {
+            case DatabaseEntityType::ENSEMBLE:          m_is_dirty_ensemble = true; break;
+            case DatabaseEntityType::SERVICE:           m_dirty_services.insert(change.index); break;
+            case DatabaseEntityType::SERVICE_COMPONENT: m_dirty_components.insert(change.index); break;
+            case DatabaseEntityType::SUBCHANNEL:        m_dirty_subchannels.insert(change.index); break;
+            // linked services and other ensembles aren't shown on dashboards
+            default: break;
+            }
+        }
+    }
+    void update_dynamic_label(const uint32_t subchannel_id, std::string_view label) {
+        auto lock = std::scoped_lock(m_mutex_state);
+        auto& current = m_dynamic_labels[subchannel_id];
+        if (current.compare(label) == 0) return;
+        current = std::string(label);
+        m_dirty_dynamic_labels.insert(subchannel_id);
+    }
+    void update_slideshow(const uint32_t subchannel_id, const Basic_Slideshow& slideshow) {
+        Slideshow_Info info;
+        info.transport_id = uint32_t(slideshow.transport_id);
+        info.name = slideshow.name;
+        switch (slideshow.image_type) {
+        case Basic_Image_Type::JPEG: info.mime_type = "image/jpeg"; break;
+        case Basic_Image_Type::PNG:  info.mime_type = "image/png"; break;
+        default:                     info.mime_type = ""; break;
+        }
+        info.total_bytes = slideshow.image_data.size();
+        info.category_title = slideshow.category_title;
+        info.click_through_url = slideshow.click_through_url;
+        info.is_emergency_alert = slideshow.is_emergency_alert;
+        auto lock = std::scoped_lock(m_mutex_state);
+        m_slideshows[subchannel_id] = std::move(info);
+        m_dirty_slideshows.insert(subchannel_id);
+    }
+    Radio_Event_Statistics get_statistics() {
+        auto lock = std::scoped_lock(m_mutex_stats);
+        return m_stats;
+    }
+private:
+    void run() {
+        std::vector<radio_event_internal::pollfd_t> fds;
+        auto next_publish = clock::now() + m_interval;
+        while (!m_is_closed.load()) {
+            const auto now = clock::now();
+            if (now >= next_publish) {
+                publish_update();
+                next_publish = now + m_interval;
+            }
+            const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next_publish - now);
+            // sockets are polled with a bounded timeout so close() is noticed
+            const int timeout_ms = int(std::clamp(timeout.count(), int64_t(1), int64_t(100)));
+            fds.clear();
+            const socket_t listen_socket = m_listen_socket.load();
+            fds.push_back({ listen_socket, POLLIN, 0 });
+            for (auto& client: m_clients) {
+                // disconnects of streaming clients are noticed when they become readable
+                short events = POLLIN;
+                if (!client->queue.empty()) events |= POLLOUT;
+                fds.push_back({ client->socket, events, 0 });
+            }
+            if (radio_event_internal::poll_sockets(fds.data(), fds.size(), timeout_ms) < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+                continue;
+            }
+            for (size_t i = 0; i < m_clients.size(); i++) {
+                const short revents = fds[i+1].revents;
+                auto& client = *m_clients[i];
+                bool is_open = (revents & (POLLERR | POLLNVAL)) == 0;
+                if (is_open && (revents & (POLLIN | POLLHUP))) is_open = read_request(client);
+                if (is_open && (revents & POLLOUT)) is_open = send_queue(client);
+                if (is_open && (client.state == Client_State::CLOSE_AFTER_SEND) && client.queue.empty()) is_open = false;
+                if (!is_open) {
+                    network_internal::close_socket(client.socket);
+                    client.socket = network_internal::INVALID_SOCKET_HANDLE;
+                }
+            }
+            m_clients.erase(
+                std::remove_if(m_clients.begin(), m_clients.end(), [](const auto& client) {
+                    return client->socket == network_internal::INVALID_SOCKET_HANDLE;
+                }),
+                m_clients.end()
+            );
+            if (fds[0].revents & POLLIN) accept_clients(listen_socket);
+            update_active_clients();
+        }
+    }
+
+    void accept_clients(const socket_t listen_socket) {
+        while (true) {
+            const socket_t s = accept(listen_socket, nullptr, nullptr);
+            if (s == network_internal::INVALID_SOCKET_HANDLE) break;
+            if (!radio_event_internal::set_non_blocking(s)) {
+                network_internal::close_socket(s);
+                continue;
+            }
+            #if defined(SO_NOSIGPIPE)
+            const int is_no_sigpipe = 1;
+            setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<const char*>(&is_no_sigpipe), sizeof(is_no_sigpipe));
+            #endif
+            auto client = std::make_unique<Client>();
+            client->socket = s;
+            m_clients.push_back(std::move(client));
+            auto lock = std::scoped_lock(m_mutex_stats);
+            m_stats.total_connections++;
+        }
+    }
+
+    void update_active_clients() {
+        auto lock = std::scoped_lock(m_mutex_stats);
+        m_stats.total_active_clients = uint64_t(m_clients.size());
+    }
+
+    // Returns false if the client disconnected or sent an invalid request
+    bool read_request(Client& client) {
+        char buf[512];
+        const auto total_read = ::recv(client.socket, buf, int(sizeof(buf)), 0);
+        if (total_read <= 0) {
+#if _WIN32
+            return (total_read < 0) && (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+            return (total_read < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+#endif
+        }
+        // anything a streaming client sends after its request is ignored
+        if (client.state != Client_State::REQUEST) return true;
+        client.request.append(buf, size_t(total_read));
+        if (client.request.find("\r\n\r\n") == std::string::npos) {
+            return client.request.size() < radio_event_internal::MAX_REQUEST_SIZE;
+        }
+        const auto path = get_request_path(client.request);
+        client.request.clear();
+        if (path.compare("/events") == 0) {
+            client.state = Client_State::STREAM;
+            client.queue.push_back(std::make_shared<const std::string>(
+                "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                "Connection: keep-alive\r\nAccess-Control-Allow-Origin: *\r\n\r\n"
+            ));
+            client.queue.push_back(get_snapshot_message());
+        } else if (path.compare("/state") == 0) {
+            client.state = Client_State::CLOSE_AFTER_SEND;
+            const auto body = build_snapshot_json();
+            client.queue.push_back(std::make_shared<const std::string>(fmt::format(
+                "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: {}\r\n"
+                "Connection: close\r\nAccess-Control-Allow-Origin: *\r\n\r\n{}",
+                body.size(), body
+            )));
+        } else {
+            client.state = Client_State::CLOSE_AFTER_SEND;
+            constexpr std::string_view body = "Not found\n";
+            client.queue.push_back(std::make_shared<const std::string>(fmt::format(
+                "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+                body.size(), body
+            )));
+        }
+        return true;
+    }
+
+    static std::string get_request_path(const std::string& request) {
+        constexpr std::string_view METHOD = "GET ";
+        if (request.compare(0, METHOD.size(), METHOD) != 0) return "";
+        const size_t path_start = METHOD.size();
+        const size_t path_end = request.find_first_of(" ?", path_start);
+        if (path_end == std::string::npos) return "";
+        return request.substr(path_start, path_end-path_start);
+    }
+
+    // Returns false if the client disconnected
+    bool send_queue(Client& client) {
+        tcb::span<const uint8_t> bufs[network_internal::MAX_SEND_BUFFERS];
+        while (!client.queue.empty()) {
+            size_t total_bufs = 0;
+            for (const auto& message: client.queue) {
+                if (total_bufs == network_internal::MAX_SEND_BUFFERS) break;
+                const size_t start = (total_bufs == 0) ? client.offset : 0;
+                bufs[total_bufs] = { reinterpret_cast<const uint8_t*>(message->data()) + start, message->size() - start };
+                total_bufs++;
+            }
+            const int64_t total_sent = network_internal::send_vectored(client.socket, tcb::span(bufs, total_bufs));
+            if (total_sent < 0) return false;
+            if (total_sent == 0) return true;
+            size_t total_left = size_t(total_sent);
+            while (!client.queue.empty() && (total_left >= (client.queue.front()->size() - client.offset))) {
+                total_left -= client.queue.front()->size() - client.offset;
+                client.offset = 0;
+                client.queue.pop_front();
+            }
+            client.offset += total_left;
+        }
+        return true;
+    }
+
+    // The snapshot is only serialised again once the state has changed
+    Message get_snapshot_message() {
+        if ((m_snapshot_message != nullptr) && (m_snapshot_version == m_published_version)) return m_snapshot_message;
+        const auto json = build_snapshot_json();
+        m_snapshot_message = std::make_shared<const std::string>(
+            fmt::format("event: snapshot\nid: {}\ndata: {}\n\n", m_published_version, json));
+        m_snapshot_version = m_published_version;
+        auto lock = std::scoped_lock(m_mutex_stats);
+        m_stats.total_snapshots++;
+        return m_snapshot_message;
+    }
+
+    void publish_update() {
+        std::string json;
+        {
+            auto lock = std::scoped_lock(m_mutex_state);
+            const bool is_dirty =
+                m_is_dirty_ensemble || !m_dirty_services.empty() || !m_dirty_components.empty() ||
+                !m_dirty_subchannels.empty() || !m_dirty_dynamic_labels.empty() || !m_dirty_slideshows.empty();
+            if (!is_dirty) return;
+            m_version++;
+            json = build_json_locked(true);
+            m_is_dirty_ensemble = false;
+            m_dirty_services.clear();
+            m_dirty_components.clear();
+            m_dirty_subchannels.clear();
+            m_dirty_dynamic_labels.clear();
+            m_dirty_slideshows.clear();
+            m_published_version = m_version;
+        }
+        // every streaming client is given a reference to the same buffer
+        auto message = std::make_shared<const std::string>(
+            fmt::format("event: update\nid: {}\ndata: {}\n\n", m_published_version, json));
+        uint64_t total_resyncs = 0;
+        for (auto& client: m_clients) {
+            if (client->state != Client_State::STREAM) continue;
+            if (client->queue.size() < m_max_queued_messages) {
+                client->queue.push_back(message);
+                continue;
+            }
+            // a partially sent message has to be finished so the event stream stays intact
+            const size_t total_keep = (client->offset > 0) ? 1 : 0;
+            client->queue.resize(total_keep);
+            client->queue.push_back(get_snapshot_message());
+            total_resyncs++;
+        }
+        auto lock = std::scoped_lock(m_mutex_stats);
+        m_stats.total_messages++;
+        m_stats.total_resyncs += total_resyncs;
+    }
+
+    std::string build_snapshot_json() {
+        auto lock = std::scoped_lock(m_mutex_state);
+        return build_json_locked(false);
+    }
+
+    // NOTE: Called with m_mutex_state held
+    std::string build_json_locked(const bool is_dirty_only) {
+        using namespace radio_event_internal;
+        std::string out;
+        fmt::format_to(std::back_inserter(out), "{{\"version\":{}", m_version);
+        if ((m_database != nullptr) && (!is_dirty_only || m_is_dirty_ensemble)) {
+            out.append(",\"ensemble\":");
+            append_json(out, m_database->ensemble);
+        }
+        if (m_database != nullptr) {
+            append_json_entities(out, "services", m_database->services, is_dirty_only ? &m_dirty_services : nullptr);
+            append_json_entities(out, "service_components", m_database->service_components, is_dirty_only ? &m_dirty_components : nullptr);
+            append_json_entities(out, "subchannels", m_database->subchannels, is_dirty_only ? &m_dirty_subchannels : nullptr);
+        }
+        append_json_map(out, "dynamic_labels", m_dynamic_labels, is_dirty_only ? &m_dirty_dynamic_labels : nullptr);
+        append_json_map(out, "slideshows", m_slideshows, is_dirty_only ? &m_dirty_slideshows : nullptr);
+        out.push_back('}');
+        return out;
+    }
+};
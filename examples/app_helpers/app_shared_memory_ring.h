@@ -0,0 +1,347 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string>
+#include "utility/span.h"
+#include "./app_io_buffers.h"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Broadcast ring of variable length frames in shared memory (POSIX shm or a Windows file mapping)
+// Any number of producer threads in one process publish frames which are read in place by any number of consumer processes
+// Producers never wait on consumers, so a consumer that falls behind skips the frames that were overwritten
+// Each slot is guarded by a sequence number like "utility/seqlock.h" so consumers can detect a frame being overwritten
+// NOTE: Only lock free atomics are placed in the mapping since they have to work across processes
+
+enum class SharedMemoryFrameType: uint32_t {
+    // Interleaved 16bit samples, param is the sample rate with the top bit set for stereo
+    PCM_AUDIO = 1,
+    // ADTS header followed by the access unit
+    AAC_ACCESS_UNIT = 2,
+    // Viterbi soft bits of a whole OFDM frame
+    SOFT_BITS = 3,
+};
+
+constexpr uint32_t SHARED_MEMORY_PCM_STEREO_FLAG = 0x80000000;
+
+struct SharedMemoryRingHeader {
+    static constexpr uint32_t MAGIC = 0x53424144; // "DABS"
+    static constexpr uint32_t VERSION = 1;
+    // Written last by the producer so consumers never see a partially initialised ring
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    // Largest payload of a slot and the distance between slots
+    uint32_t slot_size;
+    uint32_t slot_stride;
+    uint32_t total_slots;
+    alignas(64) std::atomic<uint64_t> write_index;
+};
+
+struct SharedMemorySlotHeader {
+    // 2*index+1 while the frame with this index is being written and 2*index+2 once it is published
+    alignas(64) std::atomic<uint64_t> sequence;
+    uint32_t type;
+    // e.g. subchannel id for audio frames
+    uint32_t stream_id;
+    uint32_t param;
+    uint32_t length;
+    uint64_t timestamp;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory ring requires lock free 64bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory ring requires lock free 32bit atomics");
+
+// Frame that is read in place from the mapping
+struct SharedMemoryFrame {
+    SharedMemoryFrameType type;
+    uint32_t stream_id;
+    uint32_t param;
+    uint64_t timestamp;
+    tcb::span<const uint8_t> data;
+};
+
+class SharedMemoryMapping
+{
+protected:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_name;
+    bool m_is_owner = false;
+#if _WIN32
+    HANDLE m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+public:
+    SharedMemoryMapping() {}
+    ~SharedMemoryMapping() { close(); }
+    SharedMemoryMapping(SharedMemoryMapping&) = delete;
+    SharedMemoryMapping(SharedMemoryMapping&&) = delete;
+    SharedMemoryMapping& operator=(SharedMemoryMapping&) = delete;
+    SharedMemoryMapping& operator=(SharedMemoryMapping&&) = delete;
+    // The owner creates the mapping and removes its name when closed
+    bool create(const std::string& name, const size_t size) {
+        close();
+        m_name = get_platform_name(name);
+#if _WIN32
+        const uint64_t size_64 = uint64_t(size);
+        m_mapping = CreateFileMappingA(
+            INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+            DWORD(size_64 >> 32), DWORD(size_64 & 0xFFFFFFFF), m_name.c_str());
+        if (m_mapping == nullptr) return false;
+        m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+        // A stale ring from a producer that didn't exit cleanly is replaced
+        shm_unlink(m_name.c_str());
+        m_file = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (m_file < 0) return false;
+        m_is_owner = true;
+        if (ftruncate(m_file, off_t(size)) != 0) {
+            close();
+            return false;
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        m_data = (data == MAP_FAILED) ? nullptr : reinterpret_cast<uint8_t*>(data);
+#endif
+        if (m_data == nullptr) {
+            close();
+            return false;
+        }
+        m_size = size;
+        return true;
+    }
+    // Consumers map the whole ring as read only
+    bool open(const std::string& name) {
+        close();
+        m_name = get_platform_name(name);
+#if _WIN32
+        m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, m_name.c_str());
+        if (m_mapping == nullptr) return false;
+        m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        MEMORY_BASIC_INFORMATION info;
+        if ((m_data == nullptr) || (VirtualQuery(m_data, &info, sizeof(info)) == 0)) {
+            close();
+            return false;
+        }
+        m_size = size_t(info.RegionSize);
+#else
+        m_file = shm_open(m_name.c_str(), O_RDONLY, 0);
+        if (m_file < 0) return false;
+        struct stat info;
+        if ((fstat(m_file, &info) != 0) || (info.st_size <= 0)) {
+            close();
+            return false;
+        }
+        m_size = size_t(info.st_size);
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+        if (data == MAP_FAILED) {
+            close();
+            return false;
+        }
+        m_data = reinterpret_cast<uint8_t*>(data);
+#endif
+        return true;
+    }
+    void close() {
+#if _WIN32
+        if (m_data != nullptr) UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr) CloseHandle(m_mapping);
+        m_mapping = nullptr;
+#else
+        if (m_data != nullptr) munmap(m_data, m_size);
+        if (m_file >= 0) ::close(m_file);
+        if (m_is_owner) shm_unlink(m_name.c_str());
+        m_file = -1;
+#endif
+        m_is_owner = false;
+        m_data = nullptr;
+        m_size = 0;
+    }
+    bool is_open() const { return m_data != nullptr; }
+    size_t size() const { return m_size; }
+private:
+    static std::string get_platform_name(const std::string& name) {
+#if _WIN32
+        return name;
+#else
+        // POSIX shared memory names start with a single slash
+        if (!name.empty() && (name[0] == '/')) return name;
+        return "/" + name;
+#endif
+    }
+};
+
+class SharedMemoryRingWriter: public SharedMemoryMapping
+{
+private:
+    SharedMemoryRingHeader* m_header = nullptr;
+    std::atomic<size_t> m_total_oversized{0};
+public:
+    bool create(const std::string& name, const size_t slot_size, const size_t total_slots) {
+        m_header = nullptr;
+        if ((slot_size == 0) || (total_slots == 0)) return false;
+        const size_t slot_stride = get_slot_stride(slot_size);
+        const size_t total_bytes = get_slots_offset() + slot_stride*total_slots;
+        if (!SharedMemoryMapping::create(name, total_bytes)) return false;
+
+        auto* header = new (m_data) SharedMemoryRingHeader;
+        header->version = SharedMemoryRingHeader::VERSION;
+        header->slot_size = uint32_t(slot_size);
+        header->slot_stride = uint32_t(slot_stride);
+        header->total_slots = uint32_t(total_slots);
+        header->write_index.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < total_slots; i++) {
+            auto* slot = new (m_data + get_slots_offset() + i*slot_stride) SharedMemorySlotHeader;
+            slot->sequence.store(0, std::memory_order_relaxed);
+        }
+        header->magic.store(SharedMemoryRingHeader::MAGIC, std::memory_order_release);
+        m_header = header;
+        return true;
+    }
+    // Thread safe for any number of producers, returns false if the frame is larger than a slot
+    // The frame is data followed by data_tail so a header and payload can be published without joining them first
+    // NOTE: A producer that is descheduled for a whole lap of the ring can have its slot reused,
+    //       in which case consumers see a mismatching sequence and skip the frame
+    bool publish(
+        const SharedMemoryFrameType type, const uint32_t stream_id, const uint32_t param,
+        tcb::span<const uint8_t> data, tcb::span<const uint8_t> data_tail={}, const uint64_t timestamp=0)
+    {
+        if (m_header == nullptr) return false;
+        const size_t length = data.size() + data_tail.size();
+        if (length > size_t(m_header->slot_size)) {
+            m_total_oversized.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const uint64_t index = m_header->write_index.fetch_add(1, std::memory_order_relaxed);
+        uint8_t* slot_data = m_data + get_slots_offset() + size_t(index % m_header->total_slots)*m_header->slot_stride;
+        auto* slot = reinterpret_cast<SharedMemorySlotHeader*>(slot_data);
+        slot->sequence.store(2*index+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->type = uint32_t(type);
+        slot->stream_id = stream_id;
+        slot->param = param;
+        slot->length = uint32_t(length);
+        slot->timestamp = timestamp;
+        uint8_t* payload = slot_data + sizeof(SharedMemorySlotHeader);
+        if (!data.empty()) memcpy(payload, data.data(), data.size());
+        if (!data_tail.empty()) memcpy(payload + data.size(), data_tail.data(), data_tail.size());
+        slot->sequence.store(2*index+2, std::memory_order_release);
+        return true;
+    }
+    size_t get_total_oversized() const { return m_total_oversized.load(std::memory_order_relaxed); }
+    static constexpr size_t get_slots_offset() {
+        return (sizeof(SharedMemoryRingHeader) + 63) & ~size_t(63);
+    }
+    static constexpr size_t get_slot_stride(const size_t slot_size) {
+        return (sizeof(SharedMemorySlotHeader) + slot_size + 63) & ~size_t(63);
+    }
+};
+
+class SharedMemoryRingReader: public SharedMemoryMapping
+{
+public:
+    enum class Result { OK, EMPTY, OVERWRITTEN };
+private:
+    const SharedMemoryRingHeader* m_header = nullptr;
+    uint64_t m_read_index = 0;
+    uint64_t m_total_dropped = 0;
+public:
+    // Reading starts from the newest frame
+    bool open(const std::string& name) {
+        m_header = nullptr;
+        if (!SharedMemoryMapping::open(name)) return false;
+        if (m_size < SharedMemoryRingWriter::get_slots_offset()) {
+            close();
+            return false;
+        }
+        const auto* header = reinterpret_cast<const SharedMemoryRingHeader*>(m_data);
+        if ((header->magic.load(std::memory_order_acquire) != SharedMemoryRingHeader::MAGIC) ||
+            (header->version != SharedMemoryRingHeader::VERSION) ||
+            (header->slot_stride < SharedMemoryRingWriter::get_slot_stride(header->slot_size)) ||
+            (m_size < SharedMemoryRingWriter::get_slots_offset() + size_t(header->slot_stride)*header->total_slots))
+        {
+            close();
+            return false;
+        }
+        m_header = header;
+        m_read_index = m_header->write_index.load(std::memory_order_acquire);
+        m_total_dropped = 0;
+        return true;
+    }
+    // Calls on_frame with a view into the mapping that is only valid inside the callback
+    // If OVERWRITTEN is returned the producer reused the slot while it was being read, so anything derived from it must be discarded
+    template <typename F>
+    Result read(F&& on_frame) {
+        if (m_header == nullptr) return Result::EMPTY;
+        const uint64_t write_index = m_header->write_index.load(std::memory_order_acquire);
+        if (m_read_index >= write_index) return Result::EMPTY;
+        const uint64_t total_slots = uint64_t(m_header->total_slots);
+        if ((write_index - m_read_index) > total_slots) {
+            m_total_dropped += (write_index - m_read_index) - total_slots;
+            m_read_index = write_index - total_slots;
+        }
+
+        const uint8_t* slot_data = m_data + SharedMemoryRingWriter::get_slots_offset() + size_t(m_read_index % total_slots)*m_header->slot_stride;
+        const auto* slot = reinterpret_cast<const SharedMemorySlotHeader*>(slot_data);
+        const uint64_t expected_sequence = 2*m_read_index+2;
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        // Producer is still writing this frame
+        if (sequence < expected_sequence) return Result::EMPTY;
+        if (sequence == expected_sequence) {
+            SharedMemoryFrame frame;
+            frame.type = SharedMemoryFrameType(slot->type);
+            frame.stream_id = slot->stream_id;
+            frame.param = slot->param;
+            frame.timestamp = slot->timestamp;
+            const size_t length = std::min(size_t(slot->length), size_t(m_header->slot_size));
+            frame.data = { slot_data + sizeof(SharedMemorySlotHeader), length };
+            on_frame(frame);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == expected_sequence) {
+                m_read_index++;
+                return Result::OK;
+            }
+        }
+        m_total_dropped++;
+        m_read_index++;
+        return Result::OVERWRITTEN;
+    }
+    uint64_t get_total_dropped() const { return m_total_dropped; }
+};
+
+// Publishes each write as a frame, e.g. the soft bits of an OFDM frame
+template <typename T>
+class SharedMemoryOutput: public OutputBuffer<T> {
+private:
+    std::shared_ptr<SharedMemoryRingWriter> m_writer;
+    const SharedMemoryFrameType m_type;
+public:
+    SharedMemoryOutput(std::shared_ptr<SharedMemoryRingWriter> writer, const SharedMemoryFrameType type)
+    : m_writer(writer), m_type(type) {}
+    ~SharedMemoryOutput() override = default;
+    size_t write(tcb::span<const T> src) override {
+        const auto bytes = tcb::span<const uint8_t>(reinterpret_cast<const uint8_t*>(src.data()), src.size()*sizeof(T));
+        m_writer->publish(m_type, 0, 0, bytes);
+        // Frames that don't fit are counted by the writer instead of stalling the demodulator
+        return src.size();
+    }
+};
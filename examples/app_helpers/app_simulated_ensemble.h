@@ -0,0 +1,399 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "dab/audio/aac_frame_processor.h"
+#include "dab/audio/aac_superframe_encoder.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/constants/subchannel_protection_tables.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_updater.h"
+#include "dab/fic/fic_encoder.h"
+#include "dab/msc/msc_encoder.h"
+#include "ofdm/dab_ofdm_params_ref.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/dsp/apply_pll.h"
+#include "ofdm/ofdm_modulator.h"
+#include "ofdm/ofdm_params.h"
+#include "utility/span.h"
+
+struct Simulated_Subchannel_Config {
+    // DAB+ carries AAC superframes and DAB carries MP2 frames
+    bool is_dab_plus = true;
+    int bitrate_kbps = 64;
+    // DAB+ subchannels can only use EEP
+    bool is_uep = false;
+    // EEP is 1 to 4 and UEP is 1 to 5
+    int protection_level = 3;
+    bool is_eep_type_b = false;
+};
+
+struct Simulated_Ensemble_Config {
+    // FIC puncturing is only known for modes I, II and IV
+    int transmission_mode = 1;
+    std::vector<Simulated_Subchannel_Config> subchannels;
+    // white gaussian noise is only added if this is finite
+    float snr_db = std::numeric_limits<float>::infinity();
+    float frequency_offset_hz = 0.0f;
+    uint32_t seed = 0;
+};
+
+// Transmitter for a simulated ensemble whose services all broadcast silence
+// Every stage of the receiver is exercised, from the OFDM demodulator through to the audio decoders
+// The FIC and MSC are encoded by FIC_Encoder and MSC_Encoder from a database describing the ensemble
+// The logical frames repeat every 80 CIFs which is a multiple of the 16 CIF time interleaver
+// and the 5 CIF DAB+ superframe, so the frames can be looped without breaking synchronisation
+class Simulated_Ensemble
+{
+public:
+    static constexpr int TOTAL_PERIOD_CIFS = 80;
+    static constexpr int TOTAL_CAPACITY_UNIT_BITS = 64;
+    static constexpr float SAMPLING_RATE = 2.048e6f;
+private:
+    static constexpr country_id_t COUNTRY_ID = 0xC;
+    static constexpr ensemble_id_t ENSEMBLE_REFERENCE = 0x0DE;
+    static constexpr service_id_t SERVICE_REFERENCE_BASE = 0x001;
+    struct Simulated_Subchannel {
+        Subchannel subchannel;
+        bool is_dab_plus;
+        int bitrate_kbps;
+        int nb_cif_bytes;
+        // interleaved bits of the subchannel for each CIF in the period
+        std::vector<uint8_t> encoded_bits;
+        explicit Simulated_Subchannel(const subchannel_id_t id): subchannel(id) {}
+    };
+    int m_transmission_mode = 1;
+    DAB_Parameters m_dab_params;
+    OFDM_Params m_ofdm_params;
+    std::vector<Simulated_Subchannel> m_subchannels;
+    std::unique_ptr<FIC_Encoder> m_fic_encoder;
+    size_t m_frame_length = 0;
+    std::vector<std::complex<float>> m_samples;
+public:
+    // Returns false with a reason if the ensemble can't be created
+    bool create(const Simulated_Ensemble_Config& config, std::string& error) {
+        const int mode = config.transmission_mode;
+        if ((mode != 1) && (mode != 2) && (mode != 4)) {
+            error = "Transmission mode " + std::to_string(mode) + " isn't supported by the FIC decoder";
+            return false;
+        }
+        m_transmission_mode = mode;
+        m_dab_params = get_dab_parameters(mode);
+        m_ofdm_params = get_DAB_OFDM_params(mode);
+        if (!create_subchannels(config.subchannels, error)) {
+            return false;
+        }
+        for (auto& subchannel: m_subchannels) {
+            encode_subchannel(subchannel);
+        }
+        create_fic_encoder();
+
+        std::mt19937 rng(config.seed);
+        modulate_frames(rng);
+        apply_channel(config, rng);
+        return true;
+    }
+    // IQ samples at 2.048MHz
+    tcb::span<const std::complex<float>> get_samples() const { return m_samples; }
+    size_t get_frame_length() const { return m_frame_length; }
+    size_t get_total_frames() const { return size_t(TOTAL_PERIOD_CIFS/m_dab_params.nb_cifs); }
+    float get_frame_duration() const { return float(m_frame_length)/SAMPLING_RATE; }
+    size_t get_total_subchannels() const { return m_subchannels.size(); }
+    // capacity units that are carrying a subchannel
+    int get_total_capacity_units() const {
+        int total = 0;
+        for (const auto& subchannel: m_subchannels) total += int(subchannel.subchannel.length);
+        return total;
+    }
+private:
+    bool create_subchannels(const std::vector<Simulated_Subchannel_Config>& configs, std::string& error) {
+        // DOC: ETSI EN 300 401
+        // Clause 6.2.1 - Basic sub-channel organization
+        // Subchannel ids are 6 bits
+        if (configs.size() > 64) {
+            error = "An ensemble can have at most 64 subchannels";
+            return false;
+        }
+        const int nb_cif_capacity_units = m_dab_params.nb_cif_bits/TOTAL_CAPACITY_UNIT_BITS;
+        int curr_address = 0;
+        m_subchannels.clear();
+        for (size_t i = 0; i < configs.size(); i++) {
+            const auto& config = configs[i];
+            const std::string name = std::string(config.is_dab_plus ? "DAB+" : "DAB") + " subchannel " + std::to_string(i);
+            auto simulated = Simulated_Subchannel(subchannel_id_t(i));
+            auto& subchannel = simulated.subchannel;
+            simulated.is_dab_plus = config.is_dab_plus;
+            simulated.bitrate_kbps = config.bitrate_kbps;
+            subchannel.start_address = subchannel_addr_t(curr_address);
+            subchannel.is_complete = true;
+
+            if (config.is_dab_plus && config.is_uep) {
+                error = name + " can only use EEP";
+                return false;
+            }
+            if (config.is_dab_plus && (config.bitrate_kbps > 192)) {
+                error = name + " has a bitrate above 192kbps which superframe addresses can't reach";
+                return false;
+            }
+            if (!config.is_dab_plus && (get_mp2_bitrate_index(config.bitrate_kbps) < 0)) {
+                error = name + " has a bitrate of " + std::to_string(config.bitrate_kbps) + "kbps which isn't an MPEG-1 layer II bitrate";
+                return false;
+            }
+
+            if (config.is_uep) {
+                int index = -1;
+                for (int j = 0; j < UEP_PROTECTION_TABLE_SIZE; j++) {
+                    const auto& descriptor = UEP_PROTECTION_TABLE[j];
+                    if ((int(descriptor.bitrate) == config.bitrate_kbps) && (int(descriptor.protection_level) == config.protection_level)) {
+                        index = j;
+                        break;
+                    }
+                }
+                if (index < 0) {
+                    error = name + " has no UEP profile for " + std::to_string(config.bitrate_kbps) + "kbps at level " + std::to_string(config.protection_level);
+                    return false;
+                }
+                subchannel.is_uep = true;
+                subchannel.uep_prot_index = uep_protection_index_t(index);
+                subchannel.length = subchannel_size_t(UEP_PROTECTION_TABLE[index].subchannel_size);
+            } else {
+                if ((config.protection_level < 1) || (config.protection_level > EEP_PROTECTION_TABLE_SIZE)) {
+                    error = name + " has an EEP protection level outside of 1 to 4";
+                    return false;
+                }
+                const auto* table = config.is_eep_type_b ? EEP_PROTECTION_TABLE_TYPE_B : EEP_PROTECTION_TABLE_TYPE_A;
+                const auto& descriptor = table[config.protection_level-1];
+                if ((config.bitrate_kbps <= 0) || (config.bitrate_kbps % int(descriptor.bitrate_multiple)) != 0) {
+                    error = name + " needs a bitrate that is a multiple of " + std::to_string(descriptor.bitrate_multiple) + "kbps for its EEP profile";
+                    return false;
+                }
+                const int n = config.bitrate_kbps / int(descriptor.bitrate_multiple);
+                subchannel.is_uep = false;
+                subchannel.eep_type = config.is_eep_type_b ? EEP_Type::TYPE_B : EEP_Type::TYPE_A;
+                subchannel.eep_prot_level = eep_protection_level_t(config.protection_level-1);
+                subchannel.length = subchannel_size_t(int(descriptor.capacity_unit_multiple)*n);
+            }
+
+            // 24ms of audio is carried in each CIF
+            simulated.nb_cif_bytes = MSC_Encoder::GetNbDecodedBytes(subchannel);
+            if (simulated.nb_cif_bytes != 3*config.bitrate_kbps) {
+                error = name + " uses a protection profile that the MSC decoder doesn't decode at " + std::to_string(config.bitrate_kbps) + "kbps";
+                return false;
+            }
+
+            curr_address += int(subchannel.length);
+            if (curr_address > nb_cif_capacity_units) {
+                error = "Subchannels need more than the " + std::to_string(nb_cif_capacity_units) + " capacity units in a CIF";
+                return false;
+            }
+            m_subchannels.push_back(std::move(simulated));
+        }
+        return true;
+    }
+
+    static int get_mp2_bitrate_index(const int bitrate_kbps) {
+        const int BITRATES[14] = { 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 };
+        for (int i = 0; i < 14; i++) {
+            if (BITRATES[i] == bitrate_kbps) return i+1;
+        }
+        return -1;
+    }
+
+    // Silent 48kHz stereo MPEG-1 layer II frame which lasts for 24ms
+    // NOTE: All subbands have no allocated bits so the rest of the frame is padding
+    void create_mp2_frame(const Simulated_Subchannel& subchannel, tcb::span<uint8_t> frame) const {
+        std::fill(frame.begin(), frame.end(), uint8_t(0x00));
+        const int bitrate_index = get_mp2_bitrate_index(subchannel.bitrate_kbps);
+        frame[0] = 0xFF;
+        frame[1] = 0xFD;    // MPEG-1, layer II, no CRC
+        frame[2] = uint8_t((bitrate_index << 4) | (0b01 << 2));    // 48kHz
+        frame[3] = 0x00;    // stereo
+    }
+
+    // DOC: ETSI TS 102 563
+    // Clause 5.2 - Audio super framing syntax
+    // Superframe of silent 48kHz mono AAC-LC access units that lasts for 120ms
+    static void create_dab_plus_superframe(const AAC_Superframe_Encoder& encoder, tcb::span<uint8_t> superframe) {
+        SuperFrameHeader header;
+        header.sampling_rate = 48000;
+        // DOC: ISO/IEC 14496-3
+        // raw_data_block() with a single channel element that has no scalefactor bands
+        // SCE(3) tag(4) global_gain(8) ics_info(11) pulse(1) tns(1) gain_control(1) END(3)
+        static const uint8_t SILENT_ACCESS_UNIT[4] = { 0x00, 0x00, 0x00, 0x07 };
+        constexpr int TOTAL_ACCESS_UNITS = 6;
+        tcb::span<const uint8_t> access_units[TOTAL_ACCESS_UNITS];
+        for (auto& access_unit: access_units) {
+            access_unit = SILENT_ACCESS_UNIT;
+        }
+        const bool is_success = encoder.Encode(header, access_units, superframe);
+        assert(is_success);
+        (void)is_success;
+    }
+
+    void encode_subchannel(Simulated_Subchannel& simulated) const {
+        const auto& subchannel = simulated.subchannel;
+        const size_t nb_cif_bytes = size_t(simulated.nb_cif_bytes);
+
+        // audio frames for each CIF in the period
+        constexpr int TOTAL_SUPERFRAME_CIFS = 5;
+        auto logical_frames = std::vector<uint8_t>(TOTAL_PERIOD_CIFS*nb_cif_bytes);
+        if (simulated.is_dab_plus) {
+            const auto superframe_encoder = AAC_Superframe_Encoder(simulated.nb_cif_bytes);
+            const size_t nb_superframe_bytes = TOTAL_SUPERFRAME_CIFS*nb_cif_bytes;
+            for (int i = 0; i < TOTAL_PERIOD_CIFS; i += TOTAL_SUPERFRAME_CIFS) {
+                create_dab_plus_superframe(superframe_encoder, tcb::span(logical_frames).subspan(size_t(i)*nb_cif_bytes, nb_superframe_bytes));
+            }
+        } else {
+            for (int i = 0; i < TOTAL_PERIOD_CIFS; i++) {
+                create_mp2_frame(simulated, tcb::span(logical_frames).subspan(size_t(i)*nb_cif_bytes, nb_cif_bytes));
+            }
+        }
+
+        // NOTE: The time interleaver is primed with the end of the period so the CIFs can be looped
+        constexpr int TOTAL_PRIMING_CIFS = 15;
+        auto encoder = MSC_Encoder(subchannel);
+        const size_t nb_encoded_bits = size_t(encoder.GetNbEncodedBits());
+        simulated.encoded_bits.assign(TOTAL_PERIOD_CIFS*nb_encoded_bits, 0);
+        for (int i = -TOTAL_PRIMING_CIFS; i < TOTAL_PERIOD_CIFS; i++) {
+            const int frame_index = (i + TOTAL_PERIOD_CIFS) % TOTAL_PERIOD_CIFS;
+            const int cif_index = std::max(i, 0);
+            const bool is_success = encoder.EncodeCIF(
+                tcb::span(logical_frames).subspan(size_t(frame_index)*nb_cif_bytes, nb_cif_bytes),
+                tcb::span(simulated.encoded_bits).subspan(size_t(cif_index)*nb_encoded_bits, nb_encoded_bits));
+            assert(is_success);
+            (void)is_success;
+        }
+    }
+
+    // DOC: ETSI EN 300 401
+    // Clause 6 - Multiplex Configuration Information (MCI)
+    // Each subchannel is carried by a service with a single audio component
+    void create_fic_encoder() {
+        DAB_Database_Updater updater;
+        const auto set_label = [](auto& entity_updater, const std::string& text) {
+            entity_updater.SetLabel({ reinterpret_cast<const uint8_t*>(text.data()), text.size() });
+        };
+        auto& ensemble_updater = updater.GetEnsembleUpdater();
+        ensemble_updater.SetCountryID(COUNTRY_ID);
+        ensemble_updater.SetReference(ENSEMBLE_REFERENCE);
+        set_label(ensemble_updater, "Simulated");
+        for (size_t i = 0; i < m_subchannels.size(); i++) {
+            const auto& simulated = m_subchannels[i];
+            const auto& subchannel = simulated.subchannel;
+            auto& subchannel_updater = updater.GetSubchannelUpdater(subchannel.id);
+            subchannel_updater.SetStartAddress(subchannel.start_address);
+            subchannel_updater.SetLength(subchannel.length);
+            subchannel_updater.SetIsUEP(subchannel.is_uep);
+            if (subchannel.is_uep) {
+                subchannel_updater.SetUEPProtIndex(subchannel.uep_prot_index);
+            } else {
+                subchannel_updater.SetEEPProtLevel(subchannel.eep_prot_level);
+                subchannel_updater.SetEEPType(subchannel.eep_type);
+            }
+
+            const service_id_t service_reference = service_id_t(SERVICE_REFERENCE_BASE + i);
+            auto& service_updater = updater.GetServiceUpdater(service_reference);
+            service_updater.SetCountryID(COUNTRY_ID);
+            set_label(service_updater, std::string(simulated.is_dab_plus ? "DAB+ " : "DAB ") + std::to_string(i));
+            auto& component_updater = updater.GetServiceComponentUpdater_Service(service_reference, 0);
+            component_updater.SetTransportMode(TransportMode::STREAM_MODE_AUDIO);
+            component_updater.SetAudioServiceType(simulated.is_dab_plus ? AudioServiceType::DAB_PLUS : AudioServiceType::DAB);
+            component_updater.SetSubchannel(subchannel.id);
+        }
+        m_fic_encoder = std::make_unique<FIC_Encoder>(size_t(m_dab_params.nb_fib_cif_bits), size_t(m_dab_params.nb_fibs_per_cif));
+        m_fic_encoder->SetDatabase(updater.GetDatabase());
+    }
+
+    // Subchannels are placed at their start addresses and unused capacity units are filled with random bits
+    void create_cif(const int cif_index, tcb::span<uint8_t> cif_bits, std::mt19937& rng) const {
+        for (auto& bit: cif_bits) {
+            bit = uint8_t(rng() & 0b1);
+        }
+        const size_t period_index = size_t(cif_index % TOTAL_PERIOD_CIFS);
+        for (const auto& simulated: m_subchannels) {
+            const auto& subchannel = simulated.subchannel;
+            const size_t nb_encoded_bits = size_t(subchannel.length)*TOTAL_CAPACITY_UNIT_BITS;
+            auto src = tcb::span(simulated.encoded_bits).subspan(period_index*nb_encoded_bits, nb_encoded_bits);
+            std::copy(src.begin(), src.end(), cif_bits.begin() + size_t(subchannel.start_address)*TOTAL_CAPACITY_UNIT_BITS);
+        }
+    }
+
+    // DOC: ETSI EN 300 401
+    // Clause 14.5 - QPSK symbol mapper
+    // Clause 14.6 - Frequency interleaving
+    // OFDM_Modulator packs 2 bits per carrier into each byte in carrier order
+    // Bit i and bit i+K of each symbol are mapped onto the carrier given by the frequency interleaver
+    void pack_symbols(tcb::span<const uint8_t> frame_bits, tcb::span<const int> carrier_map, tcb::span<uint8_t> frame_bytes) const {
+        // indexed by the first and second bit, matching the phases of OFDM_Modulator
+        const uint8_t PHASE_INDEX[2][2] = { {1, 2}, {0, 3} };
+        const size_t K = m_ofdm_params.nb_data_carriers;
+        const size_t nb_symbols = m_ofdm_params.nb_frame_symbols-1;
+        const size_t nb_symbol_bytes = 2*K/8;
+        std::fill(frame_bytes.begin(), frame_bytes.end(), uint8_t(0));
+        for (size_t s = 0; s < nb_symbols; s++) {
+            auto symbol_bits = frame_bits.subspan(s*2*K, 2*K);
+            auto symbol_bytes = frame_bytes.subspan(s*nb_symbol_bytes, nb_symbol_bytes);
+            for (size_t i = 0; i < K; i++) {
+                const size_t carrier = size_t(carrier_map[i]);
+                const uint8_t phase = PHASE_INDEX[symbol_bits[i]][symbol_bits[i+K]];
+                symbol_bytes[carrier/4] |= uint8_t(phase << ((carrier%4)*2));
+            }
+        }
+    }
+
+    void modulate_frames(std::mt19937& rng) {
+        const auto& params = m_ofdm_params;
+        const auto& tables = get_DAB_OFDM_tables(m_transmission_mode);
+        const auto& carrier_map = tables.carrier_mapper;
+        auto modulator = OFDM_Modulator(params, tables.prs_fft_ref);
+
+        m_frame_length = params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols;
+        const size_t total_frames = get_total_frames();
+        m_samples.resize(total_frames*m_frame_length);
+
+        auto frame_bits = std::vector<uint8_t>(size_t(m_dab_params.nb_frame_bits));
+        auto frame_bytes = std::vector<uint8_t>(size_t(m_dab_params.nb_frame_bits)/8);
+        for (size_t i = 0; i < total_frames; i++) {
+            for (int j = 0; j < m_dab_params.nb_cifs; j++) {
+                const int cif_index = int(i)*m_dab_params.nb_cifs + j;
+                const bool is_fic_encoded = m_fic_encoder->EncodeFIBGroup(size_t(cif_index), tcb::span(frame_bits).subspan(
+                    size_t(j*m_dab_params.nb_fib_cif_bits), size_t(m_dab_params.nb_fib_cif_bits)));
+                assert(is_fic_encoded);
+                (void)is_fic_encoded;
+                create_cif(cif_index, tcb::span(frame_bits).subspan(
+                    size_t(m_dab_params.nb_fic_bits + j*m_dab_params.nb_cif_bits), size_t(m_dab_params.nb_cif_bits)), rng);
+            }
+            pack_symbols(frame_bits, carrier_map, frame_bytes);
+            const bool is_success = modulator.ProcessBlock(tcb::span(m_samples).subspan(i*m_frame_length, m_frame_length), frame_bytes);
+            assert(is_success);
+            (void)is_success;
+        }
+    }
+
+    void apply_channel(const Simulated_Ensemble_Config& config, std::mt19937& rng) {
+        if (config.frequency_offset_hz != 0.0f) {
+            apply_pll_auto(m_samples, m_samples, config.frequency_offset_hz/SAMPLING_RATE);
+        }
+        if (!std::isfinite(config.snr_db)) return;
+        double total_power = 0.0;
+        for (const auto& x: m_samples) {
+            total_power += double(std::norm(x));
+        }
+        const double signal_power = total_power/double(m_samples.size());
+        const double noise_power = signal_power / std::pow(10.0, double(config.snr_db)/10.0);
+        // noise power is split evenly between I and Q
+        auto noise = std::normal_distribution<float>(0.0f, float(std::sqrt(noise_power/2.0)));
+        for (auto& x: m_samples) {
+            x += std::complex<float>(noise(rng), noise(rng));
+        }
+    }
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "ofdm/profiler.h"
+#include "utility/metrics.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_io_buffers.h"
+#include "./app_ofdm_blocks.h"
+
+// Histograms of the time each frame takes which are tracked by OFDM_Demod and BasicRadio
+static constexpr const char* SLOW_FRAME_OFDM_HISTOGRAM = "dab_ofdm_frame_seconds";
+static constexpr const char* SLOW_FRAME_RADIO_HISTOGRAM = "dab_radio_frame_seconds";
+
+// Mean frame times hide the sporadic slow frames that cause audible dropouts so the tail is reported instead
+static inline void print_frame_tail_latencies(FILE* fp) {
+    for (const char* name: { SLOW_FRAME_OFDM_HISTOGRAM, SLOW_FRAME_RADIO_HISTOGRAM }) {
+        const auto snapshot = Metrics_Registry::Get().GetHistogramSnapshot(name);
+        if (!snapshot.has_value() || (snapshot->count == 0)) continue;
+        fprintf(fp, "%s over %llu frames: p50=%.2fms p99=%.2fms p99.9=%.2fms max=%.2fms\n",
+            name, (unsigned long long)snapshot->count,
+            double(snapshot->GetPercentile(0.5))*1e-6, double(snapshot->GetPercentile(0.99))*1e-6,
+            double(snapshot->GetPercentile(0.999))*1e-6, double(snapshot->max)*1e-6);
+    }
+}
+
+// Keeps the last samples read by the demodulator so a slow frame can be dumped along with the frames before it
+// Spans of the input are passed through so a memory mapped file or tuner is still read in place
+// NOTE: The history is written by the thread reading the input and copied out by Slow_Frame_Capture
+class Slow_Frame_IQ_History: public SpanInputBuffer<RawIQ>
+{
+private:
+    std::shared_ptr<InputBuffer<RawIQ>> m_input;
+    std::shared_ptr<SpanInputBuffer<RawIQ>> m_span_input;
+    std::vector<RawIQ> m_buffer;
+    std::mutex m_mutex_history;
+    std::vector<RawIQ> m_history;
+    uint64_t m_total_written = 0;
+public:
+    Slow_Frame_IQ_History(std::shared_ptr<InputBuffer<RawIQ>> input, const size_t total_samples)
+    : m_input(input), m_span_input(std::dynamic_pointer_cast<SpanInputBuffer<RawIQ>>(input))
+    {
+        m_history.resize(std::max(total_samples, size_t(1)));
+    }
+    ~Slow_Frame_IQ_History() override = default;
+    tcb::span<const RawIQ> read_span(size_t max_length) override {
+        tcb::span<const RawIQ> buf;
+        if (m_span_input != nullptr) {
+            buf = m_span_input->read_span(max_length);
+        } else {
+            m_buffer.resize(max_length);
+            buf = tcb::span(m_buffer).first(m_input->read(m_buffer));
+        }
+        push_history(buf);
+        return buf;
+    }
+    size_t read(tcb::span<RawIQ> dest) override {
+        const auto src = read_span(dest.size());
+        std::copy(src.begin(), src.end(), dest.begin());
+        return src.size();
+    }
+    bool get_is_span_persistent() const override {
+        return (m_span_input != nullptr) && m_span_input->get_is_span_persistent();
+    }
+    // Oldest sample first
+    void copy_history(std::vector<RawIQ>& dest) {
+        auto lock = std::scoped_lock(m_mutex_history);
+        const size_t N = m_history.size();
+        const size_t total = size_t(std::min(m_total_written, uint64_t(N)));
+        const size_t end = size_t(m_total_written % uint64_t(N));
+        const size_t start = (end + N - total) % N;
+        dest.resize(total);
+        const size_t total_first = std::min(total, N-start);
+        std::copy_n(m_history.begin() + start, total_first, dest.begin());
+        std::copy_n(m_history.begin(), total-total_first, dest.begin() + total_first);
+    }
+private:
+    void push_history(tcb::span<const RawIQ> buf) {
+        auto lock = std::scoped_lock(m_mutex_history);
+        const size_t N = m_history.size();
+        // only the end of a block longer than the history is kept
+        if (buf.size() > N) {
+            m_total_written += uint64_t(buf.size()-N);
+            buf = buf.last(N);
+        }
+        while (!buf.empty()) {
+            const size_t index = size_t(m_total_written % uint64_t(N));
+            const size_t length = std::min(buf.size(), N-index);
+            std::copy_n(buf.begin(), length, m_history.begin() + index);
+            m_total_written += uint64_t(length);
+            buf = buf.subspan(length);
+        }
+    }
+};
+
+struct Slow_Frame_Capture_Config {
+    // directory the captures are written to which must already exist
+    std::string directory = ".";
+    // frames taking longer than this are captured
+    std::chrono::nanoseconds threshold{96'000'000};
+    // stop capturing after this many so a struggling system doesn't fill the disk
+    size_t max_captures = 16;
+};
+
+// Dumps the input of frames that took longer than a threshold so their worst case path can be replayed offline
+// Each capture is written as slow_frame_[index]_[ofdm|radio] with the following extensions
+// - .raw: 8bit IQ samples read before the frame was caught which replay_recording reads as is
+// - .bits: soft bits of the frame which basic_radio_app reads with --configuration dab (radio captures only)
+// - .json: frame time, tail of the frame time histograms, per stage profiler totals and every metric
+// - .trace.json: thread schedule from the profiler rings in the chrome trace format (profiler builds only)
+// NOTE: Frames are checked on the demodulator and radio threads which only copy the soft bits
+//       Files are written by a background thread and frames caught while a capture is pending are skipped
+class Slow_Frame_Capture
+{
+private:
+    struct Capture {
+        const char* source = "";
+        std::chrono::nanoseconds frame_time{0};
+        std::vector<viterbi_bit_t> bits;
+    };
+    const Slow_Frame_Capture_Config m_config;
+    std::shared_ptr<Slow_Frame_IQ_History> m_iq_history = nullptr;
+    std::mutex m_mutex_capture;
+    std::condition_variable m_cv_capture;
+    bool m_is_pending = false;
+    bool m_is_running = true;
+    Capture m_pending;
+    std::atomic<size_t> m_total_captures{0};
+    std::atomic<size_t> m_total_skipped{0};
+    std::thread m_thread;
+public:
+    explicit Slow_Frame_Capture(const Slow_Frame_Capture_Config& config)
+    : m_config(config)
+    {
+        m_thread = std::thread([this]() { run_writer(); });
+    }
+    ~Slow_Frame_Capture() {
+        {
+            auto lock = std::scoped_lock(m_mutex_capture);
+            m_is_running = false;
+        }
+        m_cv_capture.notify_one();
+        m_thread.join();
+    }
+    Slow_Frame_Capture(Slow_Frame_Capture&) = delete;
+    Slow_Frame_Capture(Slow_Frame_Capture&&) = delete;
+    Slow_Frame_Capture& operator=(Slow_Frame_Capture&) = delete;
+    Slow_Frame_Capture& operator=(Slow_Frame_Capture&&) = delete;
+    // NOTE: Set this before any frames are checked
+    void set_iq_history(std::shared_ptr<Slow_Frame_IQ_History> iq_history) { m_iq_history = iq_history; }
+    // called by OFDM_Demod::On_Frame_Time()
+    void check_ofdm_frame(const float frame_seconds) {
+        const auto frame_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<float>(frame_seconds));
+        if (frame_time <= m_config.threshold) return;
+        push_capture("ofdm", frame_time, {});
+    }
+    // called by Basic_Radio_Block::on_frame()
+    void check_radio_frame(tcb::span<const viterbi_bit_t> bits, const std::chrono::nanoseconds process_time) {
+        if (process_time <= m_config.threshold) return;
+        push_capture("radio", process_time, bits);
+    }
+    size_t get_total_captures() const { return m_total_captures.load(std::memory_order_relaxed); }
+    size_t get_total_skipped() const { return m_total_skipped.load(std::memory_order_relaxed); }
+private:
+    void push_capture(const char* source, const std::chrono::nanoseconds frame_time, tcb::span<const viterbi_bit_t> bits) {
+        auto lock = std::unique_lock(m_mutex_capture, std::try_to_lock);
+        if (!lock.owns_lock() || m_is_pending || (m_total_captures.load(std::memory_order_relaxed) >= m_config.max_captures)) {
+            m_total_skipped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_pending.source = source;
+        m_pending.frame_time = frame_time;
+        m_pending.bits.assign(bits.begin(), bits.end());
+        m_is_pending = true;
+        m_total_captures.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+        m_cv_capture.notify_one();
+    }
+    void run_writer() {
+        Capture capture;
+        std::vector<RawIQ> iq;
+        size_t index = 0;
+        while (true) {
+            {
+                auto lock = std::unique_lock(m_mutex_capture);
+                m_cv_capture.wait(lock, [this]() { return m_is_pending || !m_is_running; });
+                if (!m_is_pending) return;
+                std::swap(capture, m_pending);
+                m_is_pending = false;
+            }
+            // the history keeps being written so it is copied as soon as possible
+            iq.clear();
+            if (m_iq_history != nullptr) m_iq_history->copy_history(iq);
+            write_capture(index, capture, iq);
+            index++;
+        }
+    }
+    void write_capture(const size_t index, const Capture& capture, tcb::span<const RawIQ> iq) {
+        const std::string prefix = fmt::format("{}/slow_frame_{:04d}_{}", m_config.directory, index, capture.source);
+        if (!iq.empty()) write_file(prefix + ".raw", iq);
+        if (!capture.bits.empty()) write_file(prefix + ".bits", tcb::span<const viterbi_bit_t>(capture.bits));
+
+        std::string out = fmt::format(
+            "{{\"source\":\"{}\",\"frame_seconds\":{:.6f},\"threshold_seconds\":{:.6f},\"iq_samples\":{},\"soft_bits\":{},\"tails\":{{",
+            capture.source, double(capture.frame_time.count())*1e-9, double(m_config.threshold.count())*1e-9,
+            iq.size(), capture.bits.size());
+        bool is_first = true;
+        for (const char* name: { SLOW_FRAME_OFDM_HISTOGRAM, SLOW_FRAME_RADIO_HISTOGRAM }) {
+            const auto snapshot = Metrics_Registry::Get().GetHistogramSnapshot(name);
+            if (!snapshot.has_value()) continue;
+            out.append(fmt::format("{}\"{}\":{{\"count\":{},\"p50\":{},\"p99\":{},\"p999\":{},\"max\":{}}}",
+                is_first ? "" : ",", name, snapshot->count,
+                snapshot->GetPercentile(0.5), snapshot->GetPercentile(0.99), snapshot->GetPercentile(0.999), snapshot->max));
+            is_first = false;
+        }
+        out.append("},\"stages\":[");
+#if PROFILE_ENABLE
+        is_first = true;
+        for (const auto& stage: Profiler::Get().GetStageSummaries()) {
+            out.append(is_first ? "" : ",");
+            out.append(fmt::format("{{\"calls\":{},\"total_ns\":{},\"name\":", stage.total_calls, stage.total_ns));
+            append_json_string(out, stage.name);
+            out.append("}");
+            is_first = false;
+        }
+        const std::string trace = Profiler::Get().ExportChromeTrace();
+        write_file(prefix + ".trace.json", tcb::span<const char>(trace.data(), trace.size()));
+#endif
+        out.append("],\"metrics\":");
+        out.append(Metrics_Registry::Get().ExportJSON());
+        out.append("}\n");
+        write_file(prefix + ".json", tcb::span<const char>(out.data(), out.size()));
+        fprintf(stderr, "Captured slow %s frame that took %.2fms to '%s'\n",
+            capture.source, double(capture.frame_time.count())*1e-6, prefix.c_str());
+    }
+    template <typename T>
+    static void write_file(const std::string& filename, tcb::span<const T> data) {
+        FILE* fp = fopen(filename.c_str(), "wb");
+        if (fp == nullptr) {
+            fprintf(stderr, "Failed to open slow frame capture '%s' for writing\n", filename.c_str());
+            return;
+        }
+        const bool is_written = fwrite(data.data(), sizeof(T), data.size(), fp) == data.size();
+        if ((fclose(fp) != 0) || !is_written) {
+            fprintf(stderr, "Failed to write slow frame capture '%s'\n", filename.c_str());
+        }
+    }
+    static void append_json_string(std::string& out, const char* str) {
+        out.push_back('"');
+        for (const char* c = str; (*c) != 0; c++) {
+            if (((*c) == '"') || ((*c) == '\\')) out.push_back('\\');
+            if (uint8_t(*c) < 0x20) continue;
+            out.push_back(*c);
+        }
+        out.push_back('"');
+    }
+};
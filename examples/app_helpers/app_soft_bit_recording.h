@@ -0,0 +1,677 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "dab/algorithms/hard_bit_packing.h"
+#include "dab/algorithms/soft_bit_packing.h"
+#include "dab/constants/dab_parameters.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_io_buffers.h"
+
+// Compression libraries are optional and enabled by the build if they are found
+#ifndef APP_RECORDING_USE_LZ4
+#define APP_RECORDING_USE_LZ4 0
+#endif
+#ifndef APP_RECORDING_USE_ZSTD
+#define APP_RECORDING_USE_ZSTD 0
+#endif
+
+#if APP_RECORDING_USE_LZ4
+#include <lz4.h>
+#endif
+#if APP_RECORDING_USE_ZSTD
+#include <zstd.h>
+#endif
+
+// Container for recorded OFDM demodulator output
+// File = [header][chunk]...[chunk][index][footer]
+// Chunk = [chunk header][frames_per_chunk frames (fewer in the last chunk) which may be compressed]
+// Index = location and timestamp of each chunk so a reader can seek straight to any frame
+// NOTE: All fields are little endian
+//       If the recording wasn't closed cleanly the index is rebuilt by walking the chunk headers
+enum class Recording_Bit_Format: uint8_t {
+    SOFT=0,     // viterbi_bit_t
+    PACKED=1,   // 4bit soft bits, see soft_bit_packing.h
+    HARD=2,     // 1 bit per byte
+};
+
+enum class Recording_Compression: uint8_t {
+    NONE=0, LZ4=1, ZSTD=2,
+};
+
+static inline const char* get_recording_bit_format_name(const Recording_Bit_Format format) {
+    switch (format) {
+    case Recording_Bit_Format::SOFT:   return "soft";
+    case Recording_Bit_Format::PACKED: return "packed";
+    case Recording_Bit_Format::HARD:   return "hard";
+    default:                           return "unknown";
+    }
+}
+
+static inline const char* get_recording_compression_name(const Recording_Compression compression) {
+    switch (compression) {
+    case Recording_Compression::NONE: return "none";
+    case Recording_Compression::LZ4:  return "lz4";
+    case Recording_Compression::ZSTD: return "zstd";
+    default:                          return "unknown";
+    }
+}
+
+static inline bool get_recording_compression_is_supported(const Recording_Compression compression) {
+    switch (compression) {
+    case Recording_Compression::NONE: return true;
+    case Recording_Compression::LZ4:  return APP_RECORDING_USE_LZ4 ? true : false;
+    case Recording_Compression::ZSTD: return APP_RECORDING_USE_ZSTD ? true : false;
+    default:                          return false;
+    }
+}
+
+struct Recording_Metadata {
+    int transmission_mode = 1;
+    uint32_t frequency_hz = 0;          // 0 if unknown
+    uint16_t ensemble_id = 0;           // 0 if unknown
+    std::string ensemble_label;         // truncated to 16 characters
+    int64_t start_time_us = 0;          // unix time
+};
+
+struct Recording_Chunk_Entry {
+    uint64_t first_frame = 0;
+    uint64_t file_offset = 0;           // of the chunk header
+    int64_t timestamp_us = 0;           // unix time of the first frame
+};
+
+namespace recording_internal {
+
+static constexpr char FILE_MAGIC[8] = {'D','A','B','S','O','F','T','1'};
+static constexpr char CHUNK_MAGIC[4] = {'S','B','C','K'};
+static constexpr char INDEX_MAGIC[4] = {'S','B','I','X'};
+static constexpr char FOOTER_MAGIC[8] = {'S','B','I','X','E','N','D','1'};
+static constexpr uint16_t VERSION = 1;
+static constexpr size_t FILE_HEADER_SIZE = 64;
+static constexpr size_t CHUNK_HEADER_SIZE = 32;
+static constexpr size_t INDEX_ENTRY_SIZE = 24;
+static constexpr size_t FOOTER_SIZE = 16;
+static constexpr size_t LABEL_SIZE = 16;
+
+template <typename T>
+static void put_le(uint8_t* buf, const T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = uint8_t(uint64_t(v) >> (8*i));
+    }
+}
+
+template <typename T>
+static T get_le(const uint8_t* buf) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(buf[i]) << (8*i);
+    }
+    return T(v);
+}
+
+static bool seek_file(FILE* fp, const uint64_t offset, const int origin=SEEK_SET) {
+#if _WIN32
+    return _fseeki64(fp, int64_t(offset), origin) == 0;
+#else
+    return fseeko(fp, off_t(offset), origin) == 0;
+#endif
+}
+
+static std::optional<uint64_t> tell_file(FILE* fp) {
+#if _WIN32
+    const int64_t offset = _ftelli64(fp);
+#else
+    const int64_t offset = int64_t(ftello(fp));
+#endif
+    if (offset < 0) return std::nullopt;
+    return uint64_t(offset);
+}
+
+static int64_t get_unix_time_us() {
+    const auto dt = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(dt).count();
+}
+
+static size_t get_stored_frame_size(const Recording_Bit_Format format, const size_t nb_frame_bits) {
+    switch (format) {
+    case Recording_Bit_Format::PACKED: return get_packed_soft_bits_size(nb_frame_bits);
+    case Recording_Bit_Format::HARD:   return nb_frame_bits/8;
+    case Recording_Bit_Format::SOFT:
+    default:                           return nb_frame_bits*sizeof(viterbi_bit_t);
+    }
+}
+
+}
+
+// Frames written as soft bits are stored in chunks of whole frames
+// The chunk that is being filled is kept in memory until it is complete
+class Recording_Writer: public OutputBuffer<viterbi_bit_t>
+{
+private:
+    FILE* m_file = nullptr;
+    Recording_Metadata m_metadata;
+    const Recording_Bit_Format m_format;
+    const Recording_Compression m_compression;
+    const size_t m_frames_per_chunk;
+    size_t m_nb_frame_bits = 0;
+    size_t m_stored_frame_size = 0;
+    // timestamps are derived from the frame index instead of the wall clock
+    int64_t m_frame_period_us = 0;
+    bool m_is_derived_timestamps = false;
+    std::vector<viterbi_bit_t> m_partial_frame;
+    std::vector<uint8_t> m_chunk_data;
+    std::vector<uint8_t> m_compressed_data;
+    size_t m_chunk_frames = 0;
+    int64_t m_chunk_timestamp_us = 0;
+    uint64_t m_total_frames = 0;
+    uint64_t m_file_offset = 0;
+    std::vector<Recording_Chunk_Entry> m_index;
+    bool m_is_error = false;
+    std::mutex m_mutex;
+public:
+    // file is owned by the writer and closed by close()
+    Recording_Writer(
+        FILE* file, const Recording_Metadata& metadata,
+        const Recording_Bit_Format format=Recording_Bit_Format::SOFT,
+        const Recording_Compression compression=Recording_Compression::NONE,
+        const size_t frames_per_chunk=16)
+    : m_file(file), m_metadata(metadata), m_format(format), m_compression(compression),
+      m_frames_per_chunk(std::max(frames_per_chunk, size_t(1)))
+    {
+        const auto params = get_dab_parameters(m_metadata.transmission_mode);
+        m_nb_frame_bits = size_t(params.nb_frame_bits);
+        m_stored_frame_size = recording_internal::get_stored_frame_size(m_format, m_nb_frame_bits);
+        // DOC: ETSI EN 300 401
+        // Clause 5.1 - Transmission frame
+        // Each CIF corresponds to 24ms
+        m_frame_period_us = int64_t(params.nb_cifs)*24000;
+        m_partial_frame.reserve(m_nb_frame_bits);
+        m_chunk_data.resize(m_stored_frame_size*m_frames_per_chunk);
+        if (m_metadata.start_time_us == 0) {
+            m_metadata.start_time_us = recording_internal::get_unix_time_us();
+        }
+        if (!get_recording_compression_is_supported(m_compression)) {
+            m_is_error = true;
+            return;
+        }
+        write_file_header();
+    }
+    ~Recording_Writer() override { close(); }
+    Recording_Writer(Recording_Writer&) = delete;
+    Recording_Writer(Recording_Writer&&) = delete;
+    Recording_Writer& operator=(Recording_Writer&) = delete;
+    Recording_Writer& operator=(Recording_Writer&&) = delete;
+    // Timestamps are start_time + frame_index*frame_period instead of when frames were written
+    // Use this when converting an existing recording where the capture time isn't known
+    void set_is_derived_timestamps(const bool is_derived) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_is_derived_timestamps = is_derived;
+    }
+    // Ensemble information is usually only known after the FIC is decoded
+    // NOTE: The header is rewritten on close if the file is seekable
+    void set_ensemble(const uint16_t ensemble_id, const std::string& label) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_metadata.ensemble_id = ensemble_id;
+        m_metadata.ensemble_label = label;
+    }
+    bool get_is_error() const { return m_is_error; }
+    uint64_t get_total_frames() const { return m_total_frames; }
+    size_t write(tcb::span<const viterbi_bit_t> bits) override {
+        auto lock = std::scoped_lock(m_mutex);
+        if ((m_file == nullptr) || m_is_error) return 0;
+        const size_t total_bits = bits.size();
+        // complete a frame that was split across writes
+        if (!m_partial_frame.empty()) {
+            const size_t length = std::min(m_nb_frame_bits-m_partial_frame.size(), bits.size());
+            m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.begin()+length);
+            bits = bits.subspan(length);
+            if (m_partial_frame.size() == m_nb_frame_bits) {
+                push_frame(m_partial_frame);
+                m_partial_frame.clear();
+            }
+        }
+        while (bits.size() >= m_nb_frame_bits) {
+            push_frame(bits.first(m_nb_frame_bits));
+            bits = bits.subspan(m_nb_frame_bits);
+        }
+        m_partial_frame.insert(m_partial_frame.end(), bits.begin(), bits.end());
+        return m_is_error ? 0 : total_bits;
+    }
+    // Writes the last partial chunk and the seek index
+    // NOTE: An incomplete frame at the end is dropped
+    void close() {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_file == nullptr) return;
+        if (!m_is_error) {
+            flush_chunk();
+            write_index();
+            // pipes can't be rewound so the header keeps the metadata known when it was written
+            if (recording_internal::seek_file(m_file, 0)) {
+                write_file_header();
+            }
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+private:
+    void push_frame(tcb::span<const viterbi_bit_t> frame) {
+        if (m_chunk_frames == 0) {
+            m_chunk_timestamp_us = m_is_derived_timestamps ?
+                m_metadata.start_time_us + int64_t(m_total_frames)*m_frame_period_us :
+                recording_internal::get_unix_time_us();
+        }
+        auto dest = tcb::span(m_chunk_data).subspan(m_chunk_frames*m_stored_frame_size, m_stored_frame_size);
+        switch (m_format) {
+        case Recording_Bit_Format::PACKED:
+            pack_soft_bits_auto(frame, dest);
+            break;
+        case Recording_Bit_Format::HARD:
+            pack_hard_bits_auto(frame, dest);
+            break;
+        case Recording_Bit_Format::SOFT:
+        default:
+            memcpy(dest.data(), frame.data(), m_stored_frame_size);
+            break;
+        }
+        m_chunk_frames++;
+        m_total_frames++;
+        if (m_chunk_frames == m_frames_per_chunk) {
+            flush_chunk();
+        }
+    }
+
+    void flush_chunk() {
+        using namespace recording_internal;
+        if (m_chunk_frames == 0) return;
+        const size_t raw_size = m_chunk_frames*m_stored_frame_size;
+        tcb::span<const uint8_t> payload = tcb::span(m_chunk_data).first(raw_size);
+        if (!compress(payload)) {
+            m_is_error = true;
+            return;
+        }
+        if (m_compression != Recording_Compression::NONE) {
+            payload = m_compressed_data;
+        }
+
+        const uint64_t first_frame = m_total_frames - m_chunk_frames;
+        uint8_t header[CHUNK_HEADER_SIZE] = {0};
+        memcpy(&header[0], CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+        put_le<uint32_t>(&header[4], uint32_t(m_chunk_frames));
+        put_le<uint64_t>(&header[8], first_frame);
+        put_le<int64_t>(&header[16], m_chunk_timestamp_us);
+        put_le<uint32_t>(&header[24], uint32_t(payload.size()));
+        put_le<uint32_t>(&header[28], uint32_t(raw_size));
+        m_index.push_back({ first_frame, m_file_offset, m_chunk_timestamp_us });
+        write_bytes({ header, CHUNK_HEADER_SIZE });
+        write_bytes(payload);
+        m_chunk_frames = 0;
+    }
+
+    bool compress(tcb::span<const uint8_t> src) {
+        switch (m_compression) {
+#if APP_RECORDING_USE_LZ4
+        case Recording_Compression::LZ4:
+            {
+                m_compressed_data.resize(size_t(LZ4_compressBound(int(src.size()))));
+                const int length = LZ4_compress_default(
+                    reinterpret_cast<const char*>(src.data()), reinterpret_cast<char*>(m_compressed_data.data()),
+                    int(src.size()), int(m_compressed_data.size()));
+                if (length <= 0) return false;
+                m_compressed_data.resize(size_t(length));
+                return true;
+            }
+#endif
+#if APP_RECORDING_USE_ZSTD
+        case Recording_Compression::ZSTD:
+            {
+                constexpr int ZSTD_LEVEL = 3;
+                m_compressed_data.resize(ZSTD_compressBound(src.size()));
+                const size_t length = ZSTD_compress(
+                    m_compressed_data.data(), m_compressed_data.size(), src.data(), src.size(), ZSTD_LEVEL);
+                if (ZSTD_isError(length)) return false;
+                m_compressed_data.resize(length);
+                return true;
+            }
+#endif
+        case Recording_Compression::NONE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void write_file_header() {
+        using namespace recording_internal;
+        uint8_t header[FILE_HEADER_SIZE] = {0};
+        memcpy(&header[0], FILE_MAGIC, sizeof(FILE_MAGIC));
+        put_le<uint16_t>(&header[8], VERSION);
+        header[10] = uint8_t(m_metadata.transmission_mode);
+        header[11] = uint8_t(m_format);
+        header[12] = uint8_t(m_compression);
+        put_le<uint32_t>(&header[16], uint32_t(m_nb_frame_bits));
+        put_le<uint32_t>(&header[20], uint32_t(m_frames_per_chunk));
+        put_le<uint32_t>(&header[24], m_metadata.frequency_hz);
+        put_le<uint16_t>(&header[28], m_metadata.ensemble_id);
+        put_le<int64_t>(&header[32], m_metadata.start_time_us);
+        const size_t label_length = std::min(m_metadata.ensemble_label.size(), LABEL_SIZE);
+        memcpy(&header[40], m_metadata.ensemble_label.data(), label_length);
+        write_bytes({ header, FILE_HEADER_SIZE });
+    }
+
+    void write_index() {
+        using namespace recording_internal;
+        const uint64_t index_offset = m_file_offset;
+        uint8_t header[8] = {0};
+        memcpy(&header[0], INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        put_le<uint32_t>(&header[4], uint32_t(m_index.size()));
+        write_bytes({ header, sizeof(header) });
+        for (const auto& entry: m_index) {
+            uint8_t buf[INDEX_ENTRY_SIZE] = {0};
+            put_le<uint64_t>(&buf[0], entry.first_frame);
+            put_le<uint64_t>(&buf[8], entry.file_offset);
+            put_le<int64_t>(&buf[16], entry.timestamp_us);
+            write_bytes({ buf, INDEX_ENTRY_SIZE });
+        }
+        uint8_t footer[FOOTER_SIZE] = {0};
+        put_le<uint64_t>(&footer[0], index_offset);
+        memcpy(&footer[8], FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+        write_bytes({ footer, FOOTER_SIZE });
+    }
+
+    void write_bytes(tcb::span<const uint8_t> buf) {
+        if (m_is_error) return;
+        const size_t length = fwrite(buf.data(), 1, buf.size(), m_file);
+        if (length != buf.size()) {
+            m_is_error = true;
+        }
+        m_file_offset += uint64_t(length);
+    }
+};
+
+// Reads frames as soft bits from any position in a recording
+// NOTE: The file must be seekable
+class Recording_Reader: public InputBuffer<viterbi_bit_t>
+{
+private:
+    struct Chunk {
+        Recording_Chunk_Entry entry;
+        size_t total_frames = 0;
+    };
+    FILE* m_file = nullptr;
+    Recording_Metadata m_metadata;
+    Recording_Bit_Format m_format = Recording_Bit_Format::SOFT;
+    Recording_Compression m_compression = Recording_Compression::NONE;
+    size_t m_nb_frame_bits = 0;
+    size_t m_stored_frame_size = 0;
+    size_t m_frames_per_chunk = 0;
+    std::vector<Chunk> m_chunks;
+    uint64_t m_total_frames = 0;
+    bool m_is_index_rebuilt = false;
+    // decoded chunk
+    std::vector<uint8_t> m_stored_data;
+    std::vector<uint8_t> m_chunk_data;
+    size_t m_chunk_index = 0;
+    bool m_is_chunk_loaded = false;
+    uint64_t m_frame_index = 0;
+    std::vector<viterbi_bit_t> m_frame_bits;
+    size_t m_frame_offset = 0;
+public:
+    Recording_Reader() {}
+    ~Recording_Reader() override { close(); }
+    Recording_Reader(Recording_Reader&) = delete;
+    Recording_Reader(Recording_Reader&&) = delete;
+    Recording_Reader& operator=(Recording_Reader&) = delete;
+    Recording_Reader& operator=(Recording_Reader&&) = delete;
+    // file is owned by the reader
+    // Returns false if the file isn't a recording or uses an unsupported compression
+    bool open(FILE* file) {
+        close();
+        m_file = file;
+        if (!read_file_header() || !get_recording_compression_is_supported(m_compression)) {
+            close();
+            return false;
+        }
+        if (!read_index()) {
+            m_is_index_rebuilt = true;
+            rebuild_index();
+        }
+        m_frame_bits.resize(m_nb_frame_bits);
+        m_frame_offset = m_nb_frame_bits;
+        return true;
+    }
+    void close() {
+        if (m_file != nullptr) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+        m_chunks.clear();
+        m_total_frames = 0;
+        m_frame_index = 0;
+        m_is_chunk_loaded = false;
+    }
+    const Recording_Metadata& get_metadata() const { return m_metadata; }
+    Recording_Bit_Format get_bit_format() const { return m_format; }
+    Recording_Compression get_compression() const { return m_compression; }
+    size_t get_frames_per_chunk() const { return m_frames_per_chunk; }
+    size_t get_nb_frame_bits() const { return m_nb_frame_bits; }
+    uint64_t get_total_frames() const { return m_total_frames; }
+    size_t get_total_chunks() const { return m_chunks.size(); }
+    Recording_Chunk_Entry get_chunk(const size_t index) const { return m_chunks[index].entry; }
+    // true if the recording wasn't closed cleanly and the index was recovered from the chunks
+    bool get_is_index_rebuilt() const { return m_is_index_rebuilt; }
+    uint64_t get_frame_index() const { return m_frame_index; }
+    // Only the chunk containing the frame is read
+    bool seek_frame(const uint64_t frame_index) {
+        if (frame_index > m_total_frames) return false;
+        m_frame_index = frame_index;
+        m_frame_offset = m_nb_frame_bits;
+        return true;
+    }
+    // Returns the first frame at or after the unix time
+    std::optional<uint64_t> find_frame_at_time(const int64_t timestamp_us) const {
+        const auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), timestamp_us,
+            [](const Chunk& chunk, const int64_t t) { return chunk.entry.timestamp_us < t; });
+        if (it == m_chunks.end()) return std::nullopt;
+        return it->entry.first_frame;
+    }
+    size_t read(tcb::span<viterbi_bit_t> dest) override {
+        size_t total_read = 0;
+        while (!dest.empty()) {
+            if (m_frame_offset == m_nb_frame_bits) {
+                if (!read_frame(m_frame_index, m_frame_bits)) break;
+                m_frame_index++;
+                m_frame_offset = 0;
+            }
+            const size_t length = std::min(dest.size(), m_nb_frame_bits-m_frame_offset);
+            memcpy(dest.data(), &m_frame_bits[m_frame_offset], length*sizeof(viterbi_bit_t));
+            m_frame_offset += length;
+            dest = dest.subspan(length);
+            total_read += length;
+        }
+        return total_read;
+    }
+private:
+    bool read_frame(const uint64_t frame_index, tcb::span<viterbi_bit_t> bits) {
+        if (frame_index >= m_total_frames) return false;
+        const auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), frame_index,
+            [](const uint64_t index, const Chunk& chunk) { return index < chunk.entry.first_frame; });
+        if (it == m_chunks.begin()) return false;
+        const size_t chunk_index = size_t(std::distance(m_chunks.begin(), it)) - 1;
+        if (!m_is_chunk_loaded || (m_chunk_index != chunk_index)) {
+            if (!load_chunk(chunk_index)) return false;
+        }
+        const auto& chunk = m_chunks[chunk_index];
+        const size_t offset = size_t(frame_index - chunk.entry.first_frame);
+        if (offset >= chunk.total_frames) return false;
+        const auto src = tcb::span(m_chunk_data).subspan(offset*m_stored_frame_size, m_stored_frame_size);
+        switch (m_format) {
+        case Recording_Bit_Format::PACKED:
+            unpack_soft_bits_auto(src, bits);
+            break;
+        case Recording_Bit_Format::HARD:
+            unpack_hard_bits_auto(src, bits);
+            break;
+        case Recording_Bit_Format::SOFT:
+        default:
+            memcpy(bits.data(), src.data(), m_stored_frame_size);
+            break;
+        }
+        return true;
+    }
+
+    bool load_chunk(const size_t chunk_index) {
+        using namespace recording_internal;
+        m_is_chunk_loaded = false;
+        const auto& chunk = m_chunks[chunk_index];
+        uint8_t header[CHUNK_HEADER_SIZE];
+        if (!seek_file(m_file, chunk.entry.file_offset)) return false;
+        if (fread(header, 1, CHUNK_HEADER_SIZE, m_file) != CHUNK_HEADER_SIZE) return false;
+        if (memcmp(&header[0], CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0) return false;
+        const size_t stored_size = get_le<uint32_t>(&header[24]);
+        const size_t raw_size = get_le<uint32_t>(&header[28]);
+        if (raw_size != chunk.total_frames*m_stored_frame_size) return false;
+        m_stored_data.resize(stored_size);
+        if (fread(m_stored_data.data(), 1, stored_size, m_file) != stored_size) return false;
+        m_chunk_data.resize(raw_size);
+        if (!decompress(m_stored_data, m_chunk_data)) return false;
+        m_chunk_index = chunk_index;
+        m_is_chunk_loaded = true;
+        return true;
+    }
+
+    bool decompress(tcb::span<const uint8_t> src, tcb::span<uint8_t> dest) {
+        switch (m_compression) {
+#if APP_RECORDING_USE_LZ4
+        case Recording_Compression::LZ4:
+            {
+                const int length = LZ4_decompress_safe(
+                    reinterpret_cast<const char*>(src.data()), reinterpret_cast<char*>(dest.data()),
+                    int(src.size()), int(dest.size()));
+                return (length >= 0) && (size_t(length) == dest.size());
+            }
+#endif
+#if APP_RECORDING_USE_ZSTD
+        case Recording_Compression::ZSTD:
+            {
+                const size_t length = ZSTD_decompress(dest.data(), dest.size(), src.data(), src.size());
+                return !ZSTD_isError(length) && (length == dest.size());
+            }
+#endif
+        case Recording_Compression::NONE:
+            if (src.size() != dest.size()) return false;
+            memcpy(dest.data(), src.data(), src.size());
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool read_file_header() {
+        using namespace recording_internal;
+        uint8_t header[FILE_HEADER_SIZE];
+        if (!seek_file(m_file, 0)) return false;
+        if (fread(header, 1, FILE_HEADER_SIZE, m_file) != FILE_HEADER_SIZE) return false;
+        if (memcmp(&header[0], FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return false;
+        if (get_le<uint16_t>(&header[8]) != VERSION) return false;
+        m_metadata.transmission_mode = int(header[10]);
+        if ((m_metadata.transmission_mode < 1) || (m_metadata.transmission_mode > 4)) return false;
+        m_format = Recording_Bit_Format(header[11]);
+        if (uint8_t(m_format) > uint8_t(Recording_Bit_Format::HARD)) return false;
+        m_compression = Recording_Compression(header[12]);
+        m_nb_frame_bits = get_le<uint32_t>(&header[16]);
+        m_frames_per_chunk = get_le<uint32_t>(&header[20]);
+        m_metadata.frequency_hz = get_le<uint32_t>(&header[24]);
+        m_metadata.ensemble_id = get_le<uint16_t>(&header[28]);
+        m_metadata.start_time_us = get_le<int64_t>(&header[32]);
+        const char* label = reinterpret_cast<const char*>(&header[40]);
+        m_metadata.ensemble_label = std::string(label, strnlen(label, LABEL_SIZE));
+        if (m_nb_frame_bits != size_t(get_dab_parameters(m_metadata.transmission_mode).nb_frame_bits)) return false;
+        m_stored_frame_size = get_stored_frame_size(m_format, m_nb_frame_bits);
+        return true;
+    }
+
+    bool read_index() {
+        using namespace recording_internal;
+        uint8_t footer[FOOTER_SIZE];
+        if (!seek_file(m_file, 0, SEEK_END)) return false;
+        const auto file_size = tell_file(m_file);
+        if (!file_size.has_value() || (file_size.value() < FILE_HEADER_SIZE+FOOTER_SIZE)) return false;
+        if (!seek_file(m_file, file_size.value()-FOOTER_SIZE)) return false;
+        if (fread(footer, 1, FOOTER_SIZE, m_file) != FOOTER_SIZE) return false;
+        if (memcmp(&footer[8], FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) return false;
+        const uint64_t index_offset = get_le<uint64_t>(&footer[0]);
+
+        uint8_t header[8];
+        if (!seek_file(m_file, index_offset)) return false;
+        if (fread(header, 1, sizeof(header), m_file) != sizeof(header)) return false;
+        if (memcmp(&header[0], INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) return false;
+        const size_t total_entries = get_le<uint32_t>(&header[4]);
+        if (index_offset + sizeof(header) + total_entries*INDEX_ENTRY_SIZE + FOOTER_SIZE != file_size.value()) return false;
+
+        std::vector<uint8_t> entries(total_entries*INDEX_ENTRY_SIZE);
+        if (fread(entries.data(), 1, entries.size(), m_file) != entries.size()) return false;
+        m_chunks.clear();
+        for (size_t i = 0; i < total_entries; i++) {
+            const uint8_t* buf = &entries[i*INDEX_ENTRY_SIZE];
+            Chunk chunk;
+            chunk.entry.first_frame = get_le<uint64_t>(&buf[0]);
+            chunk.entry.file_offset = get_le<uint64_t>(&buf[8]);
+            chunk.entry.timestamp_us = get_le<int64_t>(&buf[16]);
+            m_chunks.push_back(chunk);
+        }
+        // the frames of each chunk follow from the next chunk's first frame
+        // the last chunk's frame count is read from its header
+        for (size_t i = 0; i+1 < m_chunks.size(); i++) {
+            m_chunks[i].total_frames = size_t(m_chunks[i+1].entry.first_frame - m_chunks[i].entry.first_frame);
+        }
+        m_total_frames = 0;
+        if (!m_chunks.empty()) {
+            auto& last = m_chunks.back();
+            uint8_t chunk_header[CHUNK_HEADER_SIZE];
+            if (!seek_file(m_file, last.entry.file_offset)) return false;
+            if (fread(chunk_header, 1, CHUNK_HEADER_SIZE, m_file) != CHUNK_HEADER_SIZE) return false;
+            last.total_frames = get_le<uint32_t>(&chunk_header[4]);
+            m_total_frames = last.entry.first_frame + uint64_t(last.total_frames);
+        }
+        return true;
+    }
+
+    // Walks the chunk headers of a recording that is missing its index
+    // NOTE: A truncated chunk at the end is left out
+    void rebuild_index() {
+        using namespace recording_internal;
+        m_chunks.clear();
+        m_total_frames = 0;
+        uint64_t offset = FILE_HEADER_SIZE;
+        if (!seek_file(m_file, 0, SEEK_END)) return;
+        const auto file_size = tell_file(m_file);
+        if (!file_size.has_value()) return;
+        while (offset + CHUNK_HEADER_SIZE <= file_size.value()) {
+            uint8_t header[CHUNK_HEADER_SIZE];
+            if (!seek_file(m_file, offset)) break;
+            if (fread(header, 1, CHUNK_HEADER_SIZE, m_file) != CHUNK_HEADER_SIZE) break;
+            if (memcmp(&header[0], CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0) break;
+            const uint64_t stored_size = get_le<uint32_t>(&header[24]);
+            if (offset + CHUNK_HEADER_SIZE + stored_size > file_size.value()) break;
+            Chunk chunk;
+            chunk.total_frames = get_le<uint32_t>(&header[4]);
+            chunk.entry.first_frame = get_le<uint64_t>(&header[8]);
+            chunk.entry.timestamp_us = get_le<int64_t>(&header[16]);
+            chunk.entry.file_offset = offset;
+            if (chunk.entry.first_frame != m_total_frames) break;
+            m_chunks.push_back(chunk);
+            m_total_frames += uint64_t(chunk.total_frames);
+            offset += CHUNK_HEADER_SIZE + stored_size;
+        }
+    }
+};
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <fmt/format.h>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_dab_channel.h"
+#include "basic_radio/basic_dab_plus_channel.h"
+#include "basic_radio/basic_radio.h"
+#include "dab/constants/subchannel_protection_tables.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+#include "utility/span.h"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Rewindable history of each audio channel that stores the encoded frames instead of PCM audio
+// DAB+ is stored as ADTS framed AAC and DAB as MP2 frames, so nothing is decoded until it is played back
+//   This is 10-20x smaller than PCM and costs no codec time while recording
+// Each channel has a ring of frames in a memory mapped segment file sized for the requested duration
+//   File = [header][record]...[record] where record = [length][type][timestamp][frame] padded to 8 bytes
+//   The OS writes the pages back to disk in the background so recording doesn't block on IO
+// NOTE: Segment files are recreated when the recorder starts, they are not an archive
+
+enum class Time_Shift_Frame_Type: uint16_t {
+    AAC_ADTS = 1,
+    MP2 = 2,
+};
+
+// Frame that is read in place from the segment
+struct Time_Shift_Frame {
+    Time_Shift_Frame_Type type;
+    // microseconds since the unix epoch when the frame was decoded
+    uint64_t timestamp_us;
+    tcb::span<const uint8_t> data;
+};
+
+namespace time_shift_internal {
+
+static constexpr uint32_t FILE_MAGIC = 0x54424144; // "DABT"
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t FILE_HEADER_SIZE = 64;
+static constexpr size_t RECORD_HEADER_SIZE = 16;
+static constexpr size_t RECORD_ALIGN = 8;
+// rest of the ring is skipped since the next record didn't fit before the end
+static constexpr uint32_t RECORD_WRAP = 0xFFFFFFFF;
+// extra space for the record headers and bitrate changes
+static constexpr size_t OVERHEAD_BYTES_PER_SECOND = 4096;
+
+struct File_Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t subchannel_id;
+    uint32_t reserved;
+    uint64_t capacity;
+    // total bytes written to the ring so the write position is (write_position % capacity)
+    uint64_t write_position;
+};
+static_assert(sizeof(File_Header) <= FILE_HEADER_SIZE, "Time shift file header must fit in its reserved space");
+
+struct Record_Header {
+    uint32_t length;
+    uint16_t type;
+    uint16_t reserved;
+    uint64_t timestamp_us;
+};
+static_assert(sizeof(Record_Header) == RECORD_HEADER_SIZE, "Time shift record header must be packed");
+
+static inline uint64_t get_timestamp_us() {
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+static inline uint32_t get_subchannel_bitrate_kbps(const Subchannel& subchannel) {
+    if (subchannel.is_uep) return GetUEPDescriptor(subchannel).bitrate;
+    return CalculateEEPBitrate(subchannel);
+}
+
+}
+
+// Ring of encoded frames of one channel in a writable memory mapped file
+class Time_Shift_Segment
+{
+private:
+    struct Entry {
+        uint64_t position;
+        uint64_t timestamp_us;
+    };
+    std::mutex m_mutex;
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+    uint64_t m_write_position = 0;
+    // start of each record that hasn't been overwritten yet in the order they were written
+    std::deque<Entry> m_entries;
+    uint64_t m_total_oversized = 0;
+#if _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+public:
+    Time_Shift_Segment() {}
+    ~Time_Shift_Segment() { close(); }
+    Time_Shift_Segment(Time_Shift_Segment&) = delete;
+    Time_Shift_Segment(Time_Shift_Segment&&) = delete;
+    Time_Shift_Segment& operator=(Time_Shift_Segment&) = delete;
+    Time_Shift_Segment& operator=(Time_Shift_Segment&&) = delete;
+    // Any existing file is replaced, returns false if it couldn't be created or mapped
+    bool create(const std::string& filename, const subchannel_id_t subchannel_id, const size_t capacity) {
+        using namespace time_shift_internal;
+        auto lock = std::scoped_lock(m_mutex);
+        close_mapping();
+        if (capacity < RECORD_ALIGN) return false;
+        const size_t aligned_capacity = capacity & ~(RECORD_ALIGN-1);
+        const size_t size = FILE_HEADER_SIZE + aligned_capacity;
+#if _WIN32
+        m_file = CreateFileA(
+            filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        const uint64_t size_64 = uint64_t(size);
+        m_mapping = CreateFileMappingA(
+            m_file, nullptr, PAGE_READWRITE, DWORD(size_64 >> 32), DWORD(size_64 & 0xFFFFFFFF), nullptr);
+        if (m_mapping == nullptr) {
+            close_mapping();
+            return false;
+        }
+        m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+        m_file = ::open(filename.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        if (m_file < 0) return false;
+        if (ftruncate(m_file, off_t(size)) != 0) {
+            close_mapping();
+            return false;
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        m_data = (data == MAP_FAILED) ? nullptr : reinterpret_cast<uint8_t*>(data);
+#endif
+        if (m_data == nullptr) {
+            close_mapping();
+            return false;
+        }
+        m_size = size;
+        m_capacity = aligned_capacity;
+        m_write_position = 0;
+        m_entries.clear();
+        File_Header header;
+        memset(&header, 0, sizeof(header));
+        header.magic = FILE_MAGIC;
+        header.version = VERSION;
+        header.subchannel_id = uint32_t(subchannel_id);
+        header.capacity = uint64_t(m_capacity);
+        header.write_position = 0;
+        memcpy(m_data, &header, sizeof(header));
+        return true;
+    }
+    void close() {
+        auto lock = std::scoped_lock(m_mutex);
+        close_mapping();
+    }
+    // Called by the thread decoding the channel, returns false if the frame doesn't fit in the ring
+    // The frame is data followed by data_tail so a header and payload can be stored without joining them first
+    bool push(
+        const Time_Shift_Frame_Type type, tcb::span<const uint8_t> data, tcb::span<const uint8_t> data_tail={},
+        const uint64_t timestamp_us=time_shift_internal::get_timestamp_us())
+    {
+        using namespace time_shift_internal;
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_data == nullptr) return false;
+        const size_t length = data.size() + data_tail.size();
+        const size_t record_size = get_record_size(length);
+        if (record_size > m_capacity) {
+            m_total_oversized++;
+            return false;
+        }
+        // records don't wrap around the end of the ring so they can be read as one span
+        size_t offset = size_t(m_write_position % m_capacity);
+        if (record_size > (m_capacity - offset)) {
+            Record_Header wrap;
+            memset(&wrap, 0, sizeof(wrap));
+            wrap.length = RECORD_WRAP;
+            if ((m_capacity - offset) >= RECORD_HEADER_SIZE) {
+                memcpy(get_ring() + offset, &wrap, sizeof(wrap));
+            }
+            m_write_position += uint64_t(m_capacity - offset);
+            offset = 0;
+        }
+        const uint64_t end_position = m_write_position + uint64_t(record_size);
+        while (!m_entries.empty() && ((m_entries.front().position + uint64_t(m_capacity)) < end_position)) {
+            m_entries.pop_front();
+        }
+
+        Record_Header header;
+        memset(&header, 0, sizeof(header));
+        header.length = uint32_t(length);
+        header.type = uint16_t(type);
+        header.timestamp_us = timestamp_us;
+        uint8_t* record = get_ring() + offset;
+        memcpy(record, &header, sizeof(header));
+        uint8_t* payload = record + RECORD_HEADER_SIZE;
+        if (!data.empty()) memcpy(payload, data.data(), data.size());
+        if (!data_tail.empty()) memcpy(payload + data.size(), data_tail.data(), data_tail.size());
+        m_entries.push_back({ m_write_position, timestamp_us });
+        m_write_position = end_position;
+        reinterpret_cast<File_Header*>(m_data)->write_position = m_write_position;
+        return true;
+    }
+    // Calls on_frame in order for every stored frame at or after the timestamp
+    // The frame is a view into the mapping that is only valid inside the callback
+    // NOTE: Recording of this channel waits while this runs so on_frame should only copy or queue the frame
+    template <typename F>
+    size_t read_since(const uint64_t timestamp_us, F&& on_frame) {
+        using namespace time_shift_internal;
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_data == nullptr) return 0;
+        auto it = std::lower_bound(
+            m_entries.begin(), m_entries.end(), timestamp_us,
+            [](const Entry& entry, const uint64_t value) { return entry.timestamp_us < value; });
+        size_t total_frames = 0;
+        for (; it != m_entries.end(); it++) {
+            const uint8_t* record = get_ring() + size_t(it->position % m_capacity);
+            Record_Header header;
+            memcpy(&header, record, sizeof(header));
+            Time_Shift_Frame frame;
+            frame.type = Time_Shift_Frame_Type(header.type);
+            frame.timestamp_us = header.timestamp_us;
+            frame.data = { record + RECORD_HEADER_SIZE, size_t(header.length) };
+            on_frame(frame);
+            total_frames++;
+        }
+        return total_frames;
+    }
+    // 0 if nothing is stored
+    uint64_t get_oldest_timestamp() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_entries.empty() ? 0 : m_entries.front().timestamp_us;
+    }
+    uint64_t get_newest_timestamp() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_entries.empty() ? 0 : m_entries.back().timestamp_us;
+    }
+    size_t get_total_frames() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_entries.size();
+    }
+    uint64_t get_total_oversized() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_total_oversized;
+    }
+    size_t get_capacity() const { return m_capacity; }
+private:
+    uint8_t* get_ring() { return m_data + time_shift_internal::FILE_HEADER_SIZE; }
+    static size_t get_record_size(const size_t length) {
+        using namespace time_shift_internal;
+        return (RECORD_HEADER_SIZE + length + RECORD_ALIGN-1) & ~(RECORD_ALIGN-1);
+    }
+    void close_mapping() {
+#if _WIN32
+        if (m_data != nullptr) UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data != nullptr) munmap(m_data, m_size);
+        if (m_file >= 0) ::close(m_file);
+        m_file = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_capacity = 0;
+        m_write_position = 0;
+        m_entries.clear();
+    }
+};
+
+// Keeps the last few minutes of every audio channel of a radio in segment files in a directory
+class Time_Shift_Recorder
+{
+private:
+    const std::string m_directory;
+    const size_t m_total_seconds;
+    std::mutex m_mutex_segments;
+    std::unordered_map<subchannel_id_t, std::shared_ptr<Time_Shift_Segment>> m_segments;
+public:
+    Time_Shift_Recorder(std::string directory, const size_t total_seconds)
+    : m_directory(std::move(directory)), m_total_seconds(total_seconds) {}
+    // Encoded audio is enabled on every channel so the frames are available without running the codec
+    void attach_to_radio(BasicRadio& radio) {
+        radio.On_Audio_Channel().Attach([this](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            auto segment = create_segment(subchannel_id, channel.GetSubchannel());
+            if (segment == nullptr) return;
+            channel.GetControls().SetIsEncodedAudio(true);
+            if (channel.GetType() == AudioServiceType::DAB_PLUS) {
+                auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+                derived.OnAACData().Attach([segment](auto superframe_header, auto mpeg4_header, auto buf) {
+                    segment->push(Time_Shift_Frame_Type::AAC_ADTS, mpeg4_header, buf);
+                });
+            } else {
+                auto& derived = dynamic_cast<Basic_DAB_Channel&>(channel);
+                derived.OnMP2Data().Attach([segment](tcb::span<const uint8_t> data) {
+                    segment->push(Time_Shift_Frame_Type::MP2, data);
+                });
+            }
+        });
+    }
+    // nullptr if the channel isn't recorded
+    std::shared_ptr<Time_Shift_Segment> get_segment(const subchannel_id_t subchannel_id) {
+        auto lock = std::scoped_lock(m_mutex_segments);
+        auto res = m_segments.find(subchannel_id);
+        if (res == m_segments.end()) return nullptr;
+        return res->second;
+    }
+private:
+    std::shared_ptr<Time_Shift_Segment> create_segment(const subchannel_id_t subchannel_id, const Subchannel& subchannel) {
+        using namespace time_shift_internal;
+        // encoded audio fills the subchannel's bitrate apart from the padding of the superframes
+        const size_t bytes_per_second = size_t(get_subchannel_bitrate_kbps(subchannel))*1000/8 + OVERHEAD_BYTES_PER_SECOND;
+        const size_t capacity = bytes_per_second*m_total_seconds;
+        const auto filename = fmt::format("{}/subchannel_{}.tshift", m_directory, subchannel_id);
+        auto segment = std::make_shared<Time_Shift_Segment>();
+        if (!segment->create(filename, subchannel_id, capacity)) {
+            fprintf(stderr, "Failed to create time shift segment '%s'\n", filename.c_str());
+            return nullptr;
+        }
+        auto lock = std::scoped_lock(m_mutex_segments);
+        m_segments[subchannel_id] = segment;
+        return segment;
+    }
+};
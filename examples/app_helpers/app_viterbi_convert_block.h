@@ -3,52 +3,26 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <vector>
+#include "dab/algorithms/hard_bit_packing.h"
+#include "dab/algorithms/soft_bit_packing.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./app_io_buffers.h"
 
-static void convert_viterbi_bytes_to_bits(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits) {
-    constexpr size_t BITS_PER_BYTE = 8;
-    assert(bytes.size()*BITS_PER_BYTE == bits.size());
-    const size_t total_bytes = bytes.size();
-    size_t curr_bit = 0;
-    size_t curr_byte = 0;
-    for (; curr_byte < total_bytes; curr_byte++, curr_bit+=BITS_PER_BYTE) {
-        const uint8_t v = bytes[curr_byte];
-        for (size_t i = 0; i < BITS_PER_BYTE; i++) {
-            const uint8_t byte = (v >> i) & 0b1;
-            const viterbi_bit_t bit = byte ? SOFT_DECISION_VITERBI_HIGH : SOFT_DECISION_VITERBI_LOW;
-            bits[curr_bit+i] = bit;
-        }
-    }
-}
-
-static void convert_viterbi_bits_to_bytes(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes) {
-    constexpr size_t BITS_PER_BYTE = 8;
-    assert(bytes.size()*BITS_PER_BYTE == bits.size());
-    const size_t total_bytes = bytes.size();
-    constexpr viterbi_bit_t MID_POINT = (SOFT_DECISION_VITERBI_HIGH+SOFT_DECISION_VITERBI_LOW)/2;
-    size_t curr_bit = 0;
-    size_t curr_byte = 0;
-    for (; curr_byte < total_bytes; curr_byte++, curr_bit+=BITS_PER_BYTE) {
-        uint8_t v = 0;
-        for (size_t i = 0; i < BITS_PER_BYTE; i++) {
-            const viterbi_bit_t bit = bits[curr_bit+i];
-            const uint8_t byte = (bit >= MID_POINT) ? 0b1 : 0b0;
-            v |= (byte << i);
-        }
-        bytes[curr_byte] = v; 
-    }
-}
-
+// Hard bits are packed 8 to a byte so reads and writes that aren't whole bytes keep the partial byte
 class Convert_Viterbi_Bits_to_Bytes: public InputBuffer<uint8_t>, public OutputBuffer<uint8_t>
 {
 private:
     std::shared_ptr<InputBuffer<viterbi_bit_t>> m_input = nullptr;
     std::shared_ptr<OutputBuffer<viterbi_bit_t>> m_output = nullptr;
     std::vector<viterbi_bit_t> m_bits_buffer;
+    // soft bits read from the input that didn't fill a byte
+    std::array<viterbi_bit_t, HARD_BITS_PER_BYTE> m_partial_bits;
+    size_t m_total_partial_bits = 0;
 public:
     Convert_Viterbi_Bits_to_Bytes() {}
     ~Convert_Viterbi_Bits_to_Bytes() override = default;
@@ -62,27 +36,28 @@ public:
         m_output = output; 
     }
     size_t read(tcb::span<uint8_t> bytes_buffer) override {
-        constexpr size_t BITS_PER_BYTE = 8;
         if (m_input == nullptr) return 0;
-        m_bits_buffer.resize(bytes_buffer.size()*BITS_PER_BYTE);
-        const size_t length = m_input->read(m_bits_buffer);
-        assert(length % BITS_PER_BYTE == 0);
-        const size_t total_bits = length - (length % BITS_PER_BYTE);
-        const size_t total_bytes = total_bits / BITS_PER_BYTE;
-        convert_viterbi_bits_to_bytes(
+        m_bits_buffer.resize(bytes_buffer.size()*HARD_BITS_PER_BYTE);
+        const size_t total_partial_bits = m_total_partial_bits;
+        std::copy_n(m_partial_bits.begin(), total_partial_bits, m_bits_buffer.begin());
+        const size_t length = m_input->read(tcb::span(m_bits_buffer).subspan(total_partial_bits));
+        const size_t total_read = total_partial_bits + length;
+        const size_t total_bytes = total_read / HARD_BITS_PER_BYTE;
+        const size_t total_bits = total_bytes * HARD_BITS_PER_BYTE;
+        pack_hard_bits_auto(
             tcb::span(m_bits_buffer).first(total_bits),
             bytes_buffer.first(total_bytes)
         );
+        m_total_partial_bits = total_read - total_bits;
+        std::copy_n(m_bits_buffer.begin()+total_bits, m_total_partial_bits, m_partial_bits.begin());
         return total_bytes;
     }
     size_t write(tcb::span<const uint8_t> bytes_buffer) override {
-        constexpr size_t BITS_PER_BYTE = 8;
         if (m_output == nullptr) return 0;
-        m_bits_buffer.resize(bytes_buffer.size()*BITS_PER_BYTE);
-        convert_viterbi_bytes_to_bits(bytes_buffer, m_bits_buffer);
+        m_bits_buffer.resize(bytes_buffer.size()*HARD_BITS_PER_BYTE);
+        unpack_hard_bits_auto(bytes_buffer, m_bits_buffer);
         const size_t total_bits = m_output->write(m_bits_buffer);
-        assert(total_bits % BITS_PER_BYTE == 0);
-        const size_t total_bytes = total_bits / 8;
+        const size_t total_bytes = total_bits / HARD_BITS_PER_BYTE;
         return total_bytes;
     };
 };
@@ -93,6 +68,12 @@ private:
     std::shared_ptr<InputBuffer<uint8_t>> m_input = nullptr;
     std::shared_ptr<OutputBuffer<uint8_t>> m_output = nullptr;
     std::vector<uint8_t> m_bytes_buffer;
+    // unpacked byte whose remaining bits didn't fit in the last read
+    std::array<viterbi_bit_t, HARD_BITS_PER_BYTE> m_read_bits;
+    size_t m_read_bits_offset = HARD_BITS_PER_BYTE;
+    // soft bits written that didn't fill a byte
+    std::array<viterbi_bit_t, HARD_BITS_PER_BYTE> m_write_bits;
+    size_t m_total_write_bits = 0;
 public:
     Convert_Viterbi_Bytes_to_Bits() {}
     ~Convert_Viterbi_Bytes_to_Bits() override = default;
@@ -106,31 +87,108 @@ public:
         m_output = output;
     }
     size_t read(tcb::span<viterbi_bit_t> bits_buffer) override {
-        constexpr size_t BITS_PER_BYTE = 8;
+        if (m_input == nullptr) return 0;
+        size_t total_bits = 0;
+        const auto consume_read_bits = [&]() {
+            const size_t length = std::min(bits_buffer.size(), HARD_BITS_PER_BYTE-m_read_bits_offset);
+            std::copy_n(m_read_bits.begin()+m_read_bits_offset, length, bits_buffer.begin());
+            m_read_bits_offset += length;
+            bits_buffer = bits_buffer.subspan(length);
+            total_bits += length;
+        };
+        consume_read_bits();
+        if (bits_buffer.empty()) return total_bits;
+
+        m_bytes_buffer.resize(bits_buffer.size()/HARD_BITS_PER_BYTE);
+        const size_t total_bytes = m_input->read(m_bytes_buffer);
+        const size_t total_whole_bits = total_bytes * HARD_BITS_PER_BYTE;
+        unpack_hard_bits_auto(
+            tcb::span(m_bytes_buffer).first(total_bytes),
+            bits_buffer.first(total_whole_bits)
+        );
+        bits_buffer = bits_buffer.subspan(total_whole_bits);
+        total_bits += total_whole_bits;
+        if ((total_bytes != m_bytes_buffer.size()) || bits_buffer.empty()) return total_bits;
+
+        // request ends partway through a byte so the rest of it is kept for the next read
+        uint8_t byte = 0;
+        if (m_input->read({&byte, 1}) != 1) return total_bits;
+        unpack_hard_bits_auto({&byte, 1}, m_read_bits);
+        m_read_bits_offset = 0;
+        consume_read_bits();
+        return total_bits;
+    }
+    size_t write(tcb::span<const viterbi_bit_t> bits_buffer) override {
+        if (m_output == nullptr) return 0;
+        const size_t total_bits = bits_buffer.size();
+        const size_t total_prior_bits = m_total_write_bits;
+        // complete the partial byte from the last write before the whole bytes
+        const size_t total_fill_bits = std::min(bits_buffer.size(), HARD_BITS_PER_BYTE-m_total_write_bits);
+        std::copy_n(bits_buffer.begin(), total_fill_bits, m_write_bits.begin()+m_total_write_bits);
+        m_total_write_bits += total_fill_bits;
+        bits_buffer = bits_buffer.subspan(total_fill_bits);
+        if (m_total_write_bits != HARD_BITS_PER_BYTE) return total_bits;
+
+        const size_t total_whole_bytes = bits_buffer.size()/HARD_BITS_PER_BYTE;
+        m_bytes_buffer.resize(1 + total_whole_bytes);
+        pack_hard_bits_auto(m_write_bits, tcb::span(m_bytes_buffer).first(1));
+        pack_hard_bits_auto(
+            bits_buffer.first(total_whole_bytes*HARD_BITS_PER_BYTE),
+            tcb::span(m_bytes_buffer).subspan(1)
+        );
+        bits_buffer = bits_buffer.subspan(total_whole_bytes*HARD_BITS_PER_BYTE);
+        m_total_write_bits = bits_buffer.size();
+        std::copy_n(bits_buffer.begin(), m_total_write_bits, m_write_bits.begin());
+
+        const size_t total_bytes = m_output->write(m_bytes_buffer);
+        if (total_bytes == m_bytes_buffer.size()) return total_bits;
+        // bits in the partial byte were given by an earlier write
+        m_total_write_bits = 0;
+        const size_t total_written_bits = total_bytes * HARD_BITS_PER_BYTE;
+        return (total_written_bits > total_prior_bits) ? (total_written_bits - total_prior_bits) : 0;
+    };
+};
+
+// Soft bits packed as 4bit values (2x compression) which keeps most of the soft decision information
+class Convert_Viterbi_Packed_to_Bits: public InputBuffer<viterbi_bit_t>, public OutputBuffer<viterbi_bit_t>
+{
+private:
+    std::shared_ptr<InputBuffer<uint8_t>> m_input = nullptr;
+    std::shared_ptr<OutputBuffer<uint8_t>> m_output = nullptr;
+    std::vector<uint8_t> m_packed_buffer;
+public:
+    Convert_Viterbi_Packed_to_Bits() {}
+    ~Convert_Viterbi_Packed_to_Bits() override = default;
+    void set_input_stream(std::shared_ptr<InputBuffer<uint8_t>> input) {
+        m_input = input;
+    }
+    void set_output_stream(std::shared_ptr<OutputBuffer<uint8_t>> output) {
+        m_output = output;
+    }
+    size_t read(tcb::span<viterbi_bit_t> bits_buffer) override {
+        constexpr size_t BITS_PER_BYTE = 2;
         if (m_input == nullptr) return 0;
         assert(bits_buffer.size() % BITS_PER_BYTE == 0);
         const size_t max_bits = bits_buffer.size() - (bits_buffer.size() % BITS_PER_BYTE);
-        bits_buffer = bits_buffer.first(max_bits);
-        m_bytes_buffer.resize(bits_buffer.size()/BITS_PER_BYTE);
-        const size_t total_bytes = m_input->read(m_bytes_buffer);
+        m_packed_buffer.resize(max_bits/BITS_PER_BYTE);
+        const size_t total_bytes = m_input->read(m_packed_buffer);
         const size_t total_bits = total_bytes * BITS_PER_BYTE;
-        convert_viterbi_bytes_to_bits(
-            tcb::span(m_bytes_buffer).first(total_bytes),
+        unpack_soft_bits_auto(
+            tcb::span(m_packed_buffer).first(total_bytes),
             bits_buffer.first(total_bits)
         );
         return total_bits;
     }
     size_t write(tcb::span<const viterbi_bit_t> bits_buffer) override {
-        constexpr size_t BITS_PER_BYTE = 8;
+        constexpr size_t BITS_PER_BYTE = 2;
         if (m_output == nullptr) return 0;
         assert(bits_buffer.size() % BITS_PER_BYTE == 0);
         const size_t max_bits = bits_buffer.size() - (bits_buffer.size() % BITS_PER_BYTE);
         bits_buffer = bits_buffer.first(max_bits);
-        m_bytes_buffer.resize(bits_buffer.size()/BITS_PER_BYTE);
-        convert_viterbi_bits_to_bytes(bits_buffer, m_bytes_buffer);
-        const size_t total_bytes = m_output->write(m_bytes_buffer);
+        m_packed_buffer.resize(max_bits/BITS_PER_BYTE);
+        pack_soft_bits_auto(bits_buffer, m_packed_buffer);
+        const size_t total_bytes = m_output->write(m_packed_buffer);
         const size_t total_bits = total_bytes * BITS_PER_BYTE;
         return total_bits;
-    };
+    }
 };
-
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <stdint.h>
 #include <stdio.h>
+#include <algorithm>
 #include <complex>
 #include <exception>
 #include <iostream>
@@ -16,6 +17,8 @@
 
 #include <argparse/argparse.hpp>
 #include "ofdm/dsp/apply_pll.h"
+#include "ofdm/iq_file_reader.h"
+#include "ofdm/parallel_frequency_shift.h"
 
 constexpr float DC_LEVEL = 127.0f;
 constexpr float SCALE = 128.0f;
@@ -39,6 +42,34 @@ static RawIQ c32_to_raw_iq(std::complex<float> x) {
     return y;
 }
 
+static int apply_frequency_shift_file(IQ_File_Reader& file_in, FILE* fp_out, const float frequency_shift, const size_t total_threads) {
+    // The reader converts to the 8bit range with a bias of 127.5 so we scale to match the streaming path
+    constexpr float READER_BIAS = 127.5f;
+    bool is_write_error = false;
+    std::vector<RawIQ> block;
+    auto reader = [&file_in](const size_t offset, tcb::span<std::complex<float>> buf) {
+        file_in.Convert(offset, buf);
+    };
+    auto writer = [fp_out, &is_write_error, &block](const size_t offset, tcb::span<const std::complex<float>> buf) {
+        (void)offset;
+        if (is_write_error) return;
+        block.resize(buf.size());
+        for (size_t i = 0; i < buf.size(); i++) {
+            block[i].I = uint8_t(std::clamp(buf[i].real() + READER_BIAS, 0.0f, 255.0f));
+            block[i].Q = uint8_t(std::clamp(buf[i].imag() + READER_BIAS, 0.0f, 255.0f));
+        }
+        const size_t nb_write = fwrite(block.data(), sizeof(RawIQ), block.size(), fp_out);
+        if (nb_write != block.size()) {
+            fprintf(stderr, "Failed to write out block %zu/%zu\n", nb_write, block.size());
+            is_write_error = true;
+        }
+    };
+    Parallel_Frequency_Shift_Config config;
+    config.total_threads = total_threads;
+    apply_frequency_shift_parallel(reader, writer, file_in.GetTotalSamples(), frequency_shift, 0.0f, config);
+    return is_write_error ? 1 : 0;
+}
+
 void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("-f", "--frequency")
         .default_value(float(0.0f)).scan<'g', float>()
@@ -55,11 +86,16 @@ void init_parser(argparse::ArgumentParser& parser) {
         .metavar("BLOCK_SIZE")
         .nargs(1).required()
         .help("Number of IQ samples to read at once");
+    parser.add_argument("--total-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of threads used to shift an input file (0 = max number of threads)");
     parser.add_argument("-i", "--input")
         .default_value(std::string(""))
         .metavar("INPUT_FILENAME")
         .nargs(1).required()
-        .help("Filename of input to converter (defaults to stdin)");
+        .help("Filename of input to converter (defaults to stdin). Files are memory mapped and shifted on all cores");
     parser.add_argument("-o", "--output")
         .default_value(std::string(""))
         .metavar("OUTPUT_FILENAME")
@@ -71,6 +107,7 @@ struct Args {
     float frequency;
     float sampling_rate;
     size_t block_size;
+    size_t total_threads;
     std::string input_filename;
     std::string output_filename;
 };
@@ -80,6 +117,7 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     args.frequency = parser.get<float>("--frequency");
     args.sampling_rate = parser.get<float>("--sampling-rate");
     args.block_size = parser.get<size_t>("--block-size");
+    args.total_threads = parser.get<size_t>("--total-threads");
     args.input_filename = parser.get<std::string>("--input");
     args.output_filename = parser.get<std::string>("--output");
     return args;
@@ -108,15 +146,6 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    FILE* fp_in = stdin;
-    if (!args.input_filename.empty()) { 
-        fp_in = fopen(args.input_filename.c_str(), "rb");
-        if (fp_in == nullptr) {
-            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
-            return 1;
-        }
-    }
-
     FILE* fp_out = stdout;
     if (!args.output_filename.empty()) {
         fp_out = fopen(args.output_filename.c_str(), "wb+");
@@ -127,12 +156,34 @@ int main(int argc, char** argv) {
     }
 
 #if _WIN32
-    _setmode(_fileno(fp_in), _O_BINARY);
     _setmode(_fileno(fp_out), _O_BINARY);
 #endif
 
-    const size_t N = args.block_size;
     const float frequency_shift = args.frequency / args.sampling_rate;
+
+    // Files are mapped and split into chunks that are shifted in parallel
+    // Pipes can't be mapped so they are streamed one block at a time below
+    if (!args.input_filename.empty()) {
+        IQ_File_Reader file_in;
+        if (file_in.Open(args.input_filename, IQ_File_Format::U8)) {
+            return apply_frequency_shift_file(file_in, fp_out, frequency_shift, args.total_threads);
+        }
+    }
+
+    FILE* fp_in = stdin;
+    if (!args.input_filename.empty()) { 
+        fp_in = fopen(args.input_filename.c_str(), "rb");
+        if (fp_in == nullptr) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+            return 1;
+        }
+    }
+
+#if _WIN32
+    _setmode(_fileno(fp_in), _O_BINARY);
+#endif
+
+    const size_t N = args.block_size;
     auto rx_in = std::vector<RawIQ>(N);
     auto rx_float = std::vector<std::complex<float>>(N);
     float dt = 0.0f;
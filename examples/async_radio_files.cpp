@@ -0,0 +1,259 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <complex>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <easylogging++.h>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_radio_events.h"
+#include "basic_radio/basic_thread_pool.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
+#include "ofdm/iq_file_reader.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_async_pipeline.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_logging.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-i", "--input")
+        .default_value(std::vector<std::string>{})
+        .metavar("INPUT_FILENAME")
+        .append()
+        .help("Filename of an IQ recording (raw or wav), repeat this for each ensemble");
+    parser.add_argument("--input-format")
+        .default_value(std::string("u8"))
+        .choices("u8", "s8", "s16", "f32")
+        .metavar("FORMAT")
+        .nargs(1).required()
+        .help("Sample format of raw recordings (wav files use the format in their header)");
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Dab transmission mode");
+    parser.add_argument("--total-threads")
+        .default_value(size_t(4)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of threads that step the stages of every pipeline (0 = max number of threads)");
+    parser.add_argument("--radio-total-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of threads in the radio pool shared by every ensemble (0 = max number of threads)");
+    parser.add_argument("--block-size")
+        .default_value(size_t(8192)).scan<'u', size_t>()
+        .metavar("BLOCK_SIZE")
+        .nargs(1).required()
+        .help("Number of samples read and demodulated in each step");
+    parser.add_argument("--channel-frames")
+        .default_value(size_t(4)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Number of frames buffered between the stages of each pipeline");
+    parser.add_argument("--decode-audio")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Decode audio to PCM instead of only extracting encoded audio");
+    parser.add_argument("--radio-enable-logging")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Enables logging for the radio");
+}
+
+struct Args {
+    std::vector<std::string> input_files;
+    std::string input_format;
+    int transmission_mode;
+    size_t total_threads;
+    size_t radio_total_threads;
+    size_t block_size;
+    size_t channel_frames;
+    bool is_decode_audio;
+    bool radio_enable_logging;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.input_files = parser.get<std::vector<std::string>>("--input");
+    args.input_format = parser.get<std::string>("--input-format");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    args.total_threads = parser.get<size_t>("--total-threads");
+    args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
+    args.block_size = parser.get<size_t>("--block-size");
+    args.channel_frames = parser.get<size_t>("--channel-frames");
+    args.is_decode_audio = parser.get<bool>("--decode-audio");
+    args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
+    return args;
+}
+
+class IQ_File_Input: public InputBuffer<std::complex<float>>
+{
+private:
+    IQ_File_Reader m_reader;
+public:
+    ~IQ_File_Input() override = default;
+    IQ_File_Reader& get_reader() { return m_reader; }
+    size_t read(tcb::span<std::complex<float>> dest) override {
+        return m_reader.Read(dest);
+    }
+};
+
+// Output of an ensemble that is drained by the main thread
+struct Ensemble_Totals {
+    size_t total_labels = 0;
+    size_t total_encoded_bytes = 0;
+    size_t total_audio_bytes = 0;
+    size_t total_database_changes = 0;
+};
+
+INITIALIZE_EASYLOGGINGPP
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("async_radio_files", "0.1.0");
+    parser.add_description("Decodes many IQ recordings at once on a few threads");
+    parser.add_epilog(
+        "The reader, demodulator and radio of each recording are stages that are stepped by a shared pool of threads.\n"
+        "Stages wait on their channels instead of blocking a thread so many recordings scale on a few threads."
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+
+    if (args.input_files.empty()) {
+        fprintf(stderr, "At least one input file is required\n");
+        return 1;
+    }
+    if ((args.block_size == 0) || (args.channel_frames == 0)) {
+        fprintf(stderr, "Block size and channel frames cannot be zero\n");
+        return 1;
+    }
+
+    IQ_File_Format input_format = IQ_File_Format::U8;
+    get_iq_file_format_from_name(args.input_format.c_str(), input_format);
+    std::vector<std::shared_ptr<IQ_File_Input>> inputs;
+    for (const auto& filename: args.input_files) {
+        auto input = std::make_shared<IQ_File_Input>();
+        if (!input->get_reader().Open(filename, input_format)) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", filename.c_str());
+            return 1;
+        }
+        inputs.push_back(input);
+    }
+    setup_easylogging(false, args.radio_enable_logging, false);
+
+    const size_t total_ensembles = inputs.size();
+    const auto dab_params = get_dab_parameters(args.transmission_mode);
+    auto radio_pool = std::make_shared<BasicThreadPool>(args.radio_total_threads, Thread_Affinity{}, total_ensembles);
+    auto executor = std::make_unique<Async_Executor>(args.total_threads);
+    fprintf(stderr, "Decoding %zu ensembles with %zu pipeline threads and %zu shared radio threads\n",
+        total_ensembles, executor->get_total_threads(), radio_pool->GetTotalThreads());
+
+    uint32_t event_mask =
+        Basic_Radio_Event_Queue::GetTypeMask(Basic_Radio_Event_Type::AAC_ACCESS_UNIT) |
+        Basic_Radio_Event_Queue::GetTypeMask(Basic_Radio_Event_Type::MP2_FRAME) |
+        Basic_Radio_Event_Queue::GetTypeMask(Basic_Radio_Event_Type::DYNAMIC_LABEL) |
+        Basic_Radio_Event_Queue::GetTypeMask(Basic_Radio_Event_Type::DATABASE_CHANGE);
+    if (args.is_decode_audio) event_mask |= Basic_Radio_Event_Queue::GetTypeMask(Basic_Radio_Event_Type::AUDIO_BUFFER);
+    std::vector<std::shared_ptr<Basic_Radio_Event_Queue>> event_queues;
+    std::vector<std::shared_ptr<Async_OFDM_Stage>> ofdm_stages;
+    std::vector<std::shared_ptr<Async_Radio_Stage>> radio_stages;
+    for (size_t i = 0; i < total_ensembles; i++) {
+        auto iq_channel = std::make_shared<Async_Channel<std::complex<float>>>(4*args.block_size);
+        auto bits_channel = std::make_shared<Async_Channel<viterbi_bit_t>>(args.channel_frames*dab_params.nb_frame_bits);
+        auto input_stage = std::make_shared<Async_Input_Stage<std::complex<float>>>(inputs[i], iq_channel, args.block_size);
+        auto ofdm_stage = std::make_shared<Async_OFDM_Stage>(args.transmission_mode, iq_channel, bits_channel, args.block_size);
+        auto radio_stage = std::make_shared<Async_Radio_Stage>(args.transmission_mode, bits_channel, radio_pool, i);
+
+        auto& basic_radio = radio_stage->get_basic_radio();
+        const bool is_decode_audio = args.is_decode_audio;
+        basic_radio.On_Audio_Channel().Attach([is_decode_audio](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            auto& controls = channel.GetControls();
+            controls.SetIsEncodedAudio(true);
+            controls.SetIsDecodeAudio(is_decode_audio);
+            controls.SetIsDecodeData(true);
+            controls.SetIsPlayAudio(false);
+        });
+        auto event_queue = std::make_shared<Basic_Radio_Event_Queue>(Basic_Radio_Event_Queue::DEFAULT_MAX_EVENTS, event_mask);
+        basic_radio.AddEventQueue(event_queue);
+
+        event_queues.push_back(event_queue);
+        ofdm_stages.push_back(ofdm_stage);
+        radio_stages.push_back(radio_stage);
+        executor->add_stage(radio_stage);
+        executor->add_stage(ofdm_stage);
+        executor->add_stage(input_stage);
+    }
+
+    // Events are handled here so the pipeline threads never wait on us
+    std::vector<Ensemble_Totals> totals(total_ensembles);
+    auto drain_events = [&]() {
+        for (size_t i = 0; i < total_ensembles; i++) {
+            auto& total = totals[i];
+            event_queues[i]->Drain([i, &total](Basic_Radio_Event& event) {
+                switch (event.type) {
+                case Basic_Radio_Event_Type::AUDIO_BUFFER:
+                    total.total_audio_bytes += event.audio_buffer->data.size();
+                    break;
+                case Basic_Radio_Event_Type::AAC_ACCESS_UNIT:
+                case Basic_Radio_Event_Type::MP2_FRAME:
+                    total.total_encoded_bytes += event.data.size();
+                    break;
+                case Basic_Radio_Event_Type::DYNAMIC_LABEL:
+                    total.total_labels++;
+                    fprintf(stderr, "ensemble %zu subchannel %u: %s\n", i, unsigned(event.subchannel_id), event.label.c_str());
+                    break;
+                case Basic_Radio_Event_Type::DATABASE_CHANGE:
+                    total.total_database_changes++;
+                    break;
+                default:
+                    break;
+                }
+            });
+        }
+    };
+
+    constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(50);
+    const auto time_start = std::chrono::steady_clock::now();
+    while (!executor->is_done()) {
+        std::this_thread::sleep_for(DRAIN_PERIOD);
+        drain_events();
+    }
+    const auto time_end = std::chrono::steady_clock::now();
+    drain_events();
+    const double elapsed_seconds = std::chrono::duration<double>(time_end - time_start).count();
+
+    for (size_t i = 0; i < total_ensembles; i++) {
+        const auto& total = totals[i];
+        const auto database = radio_stages[i]->get_basic_radio().GetDatabaseSnapshot();
+        const auto& ofdm_demod = ofdm_stages[i]->get_ofdm_demod();
+        fprintf(stderr,
+            "ensemble %zu: services=%zu database_changes=%zu labels=%zu encoded_bytes=%zu audio_bytes=%zu "
+            "desyncs=%d dropped_events=%llu | %s\n",
+            i, database->services.size(), total.total_database_changes, total.total_labels,
+            total.total_encoded_bytes, total.total_audio_bytes,
+            ofdm_demod.GetTotalFramesDesync(), (unsigned long long)event_queues[i]->GetTotalDropped(),
+            args.input_files[i].c_str());
+    }
+    fprintf(stderr, "Decoded %zu ensembles in %.3fs\n", total_ensembles, elapsed_seconds);
+    // stop stepping before the stages and the radio pool they use are destroyed
+    executor = nullptr;
+    return 0;
+}
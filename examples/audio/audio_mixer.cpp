@@ -0,0 +1,131 @@
+#include "./audio_mixer.h"
+#include <stddef.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+
+static void audio_mix_sources_scalar(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min, const float v_max, const size_t start)
+{
+    for (size_t i = start; i < dest.size(); i++) {
+        float y = 0.0f;
+        for (const auto& source: sources) {
+            y += source.data[i]*source.gain;
+        }
+        y *= global_gain;
+        y = (y > v_min) ? y : v_min;
+        y = (y > v_max) ? v_max : y;
+        dest[i] = y;
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+// 8 samples per iteration
+SIMD_TARGET_SSE4_1 static void audio_mix_sources_sse4_1(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min, const float v_max)
+{
+    constexpr size_t K = 8;
+    const size_t N = (dest.size()/K)*K;
+    const __m128 lower = _mm_set1_ps(v_min);
+    const __m128 upper = _mm_set1_ps(v_max);
+    for (size_t i = 0; i < N; i+=K) {
+        __m128 y0 = _mm_setzero_ps();
+        __m128 y1 = _mm_setzero_ps();
+        for (const auto& source: sources) {
+            // global gain is folded into each source so the sum isn't rescaled
+            const __m128 gain = _mm_set1_ps(source.gain*global_gain);
+            y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_loadu_ps(&source.data[i+0]), gain));
+            y1 = _mm_add_ps(y1, _mm_mul_ps(_mm_loadu_ps(&source.data[i+4]), gain));
+        }
+        _mm_storeu_ps(&dest[i+0], _mm_min_ps(_mm_max_ps(y0, lower), upper));
+        _mm_storeu_ps(&dest[i+4], _mm_min_ps(_mm_max_ps(y1, lower), upper));
+    }
+    audio_mix_sources_scalar(dest, sources, global_gain, v_min, v_max, N);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+// 16 samples per iteration
+SIMD_TARGET_AVX2 static void audio_mix_sources_avx2(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min, const float v_max)
+{
+    constexpr size_t K = 16;
+    const size_t N = (dest.size()/K)*K;
+    const __m256 lower = _mm256_set1_ps(v_min);
+    const __m256 upper = _mm256_set1_ps(v_max);
+    for (size_t i = 0; i < N; i+=K) {
+        __m256 y0 = _mm256_setzero_ps();
+        __m256 y1 = _mm256_setzero_ps();
+        for (const auto& source: sources) {
+            const __m256 gain = _mm256_set1_ps(source.gain*global_gain);
+            y0 = _mm256_fmadd_ps(_mm256_loadu_ps(&source.data[i+0]), gain, y0);
+            y1 = _mm256_fmadd_ps(_mm256_loadu_ps(&source.data[i+8]), gain, y1);
+        }
+        _mm256_storeu_ps(&dest[i+0], _mm256_min_ps(_mm256_max_ps(y0, lower), upper));
+        _mm256_storeu_ps(&dest[i+8], _mm256_min_ps(_mm256_max_ps(y1, lower), upper));
+    }
+    audio_mix_sources_scalar(dest, sources, global_gain, v_min, v_max, N);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+// 8 samples per iteration
+static void audio_mix_sources_neon(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min, const float v_max)
+{
+    constexpr size_t K = 8;
+    const size_t N = (dest.size()/K)*K;
+    const float32x4_t lower = vdupq_n_f32(v_min);
+    const float32x4_t upper = vdupq_n_f32(v_max);
+    for (size_t i = 0; i < N; i+=K) {
+        float32x4_t y0 = vdupq_n_f32(0.0f);
+        float32x4_t y1 = vdupq_n_f32(0.0f);
+        for (const auto& source: sources) {
+            const float gain = source.gain*global_gain;
+            y0 = vfmaq_n_f32(y0, vld1q_f32(&source.data[i+0]), gain);
+            y1 = vfmaq_n_f32(y1, vld1q_f32(&source.data[i+4]), gain);
+        }
+        vst1q_f32(&dest[i+0], vminq_f32(vmaxq_f32(y0, lower), upper));
+        vst1q_f32(&dest[i+4], vminq_f32(vmaxq_f32(y1, lower), upper));
+    }
+    audio_mix_sources_scalar(dest, sources, global_gain, v_min, v_max, N);
+}
+
+#endif
+
+void audio_mix_sources_auto(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min, const float v_max)
+{
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return audio_mix_sources_avx2(dest, sources, global_gain, v_min, v_max);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return audio_mix_sources_sse4_1(dest, sources, global_gain, v_min, v_max);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return audio_mix_sources_neon(dest, sources, global_gain, v_min, v_max);
+        }
+    #endif
+    (void)level;
+    audio_mix_sources_scalar(dest, sources, global_gain, v_min, v_max, 0);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include "utility/span.h"
+
+struct Audio_Mix_Source {
+    const float* data;
+    float gain;
+};
+
+// dest[i] = clamp(global_gain * sum(source.gain * source.data[i]), v_min, v_max) in a single pass
+// Every source must have dest.size() samples which can be interleaved frames or one planar channel
+// If there are no sources dest is filled with silence
+void audio_mix_sources_auto(
+    tcb::span<float> dest, tcb::span<const Audio_Mix_Source> sources,
+    const float global_gain, const float v_min=-1.0f, const float v_max=1.0f);
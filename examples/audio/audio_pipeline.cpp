@@ -2,6 +2,8 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <limits>
@@ -41,45 +43,38 @@ static void audio_resample_with_callback(tcb::span<const Frame<T>> src, tcb::spa
     }
 }
 
-template <typename T, typename F>
-static void audio_resample_same_type_with_callback(tcb::span<const Frame<T>> src, tcb::span<Frame<T>> dest, F&& func) {
-    if (src.size() == dest.size()) {
-        audio_map_with_callback<T,T>(src, dest, std::move(func));
-    } else {
-        audio_resample_with_callback<T,T>(src, dest, std::move(func));
-    }
-}
-
-template <typename T>
-static void audio_clamp_inplace(tcb::span<Frame<T>> buf, const T v_min, const T v_max) {
-    const size_t N = buf.size();
-    for (size_t i = 0; i < N; i++) {
-        auto& v = buf[i];
-        for (int j = 0; j < Frame<T>::TOTAL_AUDIO_CHANNELS; j++) {
-            auto& x = v.channels[j];
-            x = (x > v_min) ? x : v_min;
-            x = (x > v_max) ? v_max : x;
-        }
-    }
-}
-
 AudioPipelineSource::AudioPipelineSource(float sampling_rate, size_t buffer_length)
 : m_sampling_rate(sampling_rate), m_ring_buffer(buffer_length)
 {}
 
 void AudioPipelineSource::write(tcb::span<const Frame<int16_t>> src, float src_sampling_rate, bool is_blocking) {
-    const float gain = m_gain / float(std::numeric_limits<int16_t>::max());
-    const size_t resample_length = size_t(float(src.size()) * m_sampling_rate / src_sampling_rate);
-    m_resampling_buffer.resize(resample_length);
-
-    if (resample_length == src.size()) {
-        audio_map_with_callback<int16_t,float>(
-            src, m_resampling_buffer, 
-            [gain](Frame<float>& v_dest, const Frame<int16_t>& v_src) {
-                v_dest = static_cast<Frame<float>>(v_src) * gain;
-            }
-        );
+    const float gain = 1.0f / float(std::numeric_limits<int16_t>::max());
+    const auto convert = [gain](Frame<float>& v_dest, const Frame<int16_t>& v_src) {
+        v_dest = static_cast<Frame<float>>(v_src) * gain;
+    };
+
+    // common ratios use the polyphase resampler which keeps its state across blocks
+    const auto input_rate = uint32_t(std::lround(src_sampling_rate));
+    const auto output_rate = uint32_t(std::lround(m_sampling_rate));
+    const bool is_integer_rates = (float(input_rate) == src_sampling_rate) && (float(output_rate) == m_sampling_rate);
+    const bool is_polyphase = 
+        is_integer_rates && (input_rate != output_rate) &&
+        Polyphase_Resampler::get_is_supported(input_rate, output_rate);
+
+    if (is_polyphase) {
+        if ((m_resampler == nullptr) || (m_resampler->get_input_rate() != input_rate)) {
+            m_resampler = std::make_unique<Polyphase_Resampler>(input_rate, output_rate);
+        }
+        auto input = m_resampler->get_input_buffer(src.size());
+        audio_map_with_callback<int16_t,float>(src, input, convert);
+        m_resampling_buffer.resize(m_resampler->get_output_length());
+        m_resampler->process(m_resampling_buffer);
+    } else if (input_rate == output_rate) {
+        m_resampling_buffer.resize(src.size());
+        audio_map_with_callback<int16_t,float>(src, m_resampling_buffer, convert);
     } else {
+        const size_t resample_length = size_t(float(src.size()) * m_sampling_rate / src_sampling_rate);
+        m_resampling_buffer.resize(resample_length);
         audio_resample_with_callback<int16_t,float>(
             src, m_resampling_buffer, 
             [gain](Frame<float>& v_dest, const Frame<float>& v_src) {
@@ -88,9 +83,8 @@ void AudioPipelineSource::write(tcb::span<const Frame<int16_t>> src, float src_s
         );
     }
 
-    auto lock = std::unique_lock(m_mutex_ring_buffer);
     if (!is_blocking) {
-        m_ring_buffer.write_forcefully(m_resampling_buffer);
+        m_ring_buffer.write_or_drop(m_resampling_buffer);
         return;
     }
 
@@ -99,23 +93,42 @@ void AudioPipelineSource::write(tcb::span<const Frame<int16_t>> src, float src_s
         const size_t total_read = m_ring_buffer.write(read_buffer);
         read_buffer = read_buffer.subspan(total_read);
         if (read_buffer.empty()) break;
-        m_cv_ring_buffer.wait(lock, [this]{ 
+        // a wakeup can be missed between the check and the wait so we only wait for a short period
+        constexpr auto MAX_WAIT = std::chrono::milliseconds(10);
+        auto lock = std::unique_lock(m_mutex_writer);
+        m_is_writer_waiting.store(true, std::memory_order_release);
+        m_cv_writer.wait_for(lock, MAX_WAIT, [this]{ 
             return !m_ring_buffer.is_full();
         });
+        m_is_writer_waiting.store(false, std::memory_order_release);
     }
 }
 
 bool AudioPipelineSource::read(tcb::span<Frame<float>> dest) {
-    auto lock = std::unique_lock(m_mutex_ring_buffer);
     if (m_ring_buffer.get_total_used() < dest.size()) {
         return false;
     }
     m_ring_buffer.read(dest);
-    lock.unlock();
-    m_cv_ring_buffer.notify_one();
+    notify_writer();
     return true;
 }
 
+bool AudioPipelineSource::acquire_read(
+    const size_t length, tcb::span<const Frame<float>>& first, tcb::span<const Frame<float>>& second)
+{
+    const auto regions = m_ring_buffer.acquire_read();
+    if (regions.size() < length) return false;
+    const size_t first_length = (length > regions.first.size()) ? regions.first.size() : length;
+    first = regions.first.first(first_length);
+    second = regions.second.first(length-first_length);
+    return true;
+}
+
+void AudioPipelineSource::commit_read(const size_t length) {
+    m_ring_buffer.commit_read(length);
+    notify_writer();
+}
+
 void AudioPipeline::set_sink(std::unique_ptr<AudioPipelineSink>&& sink) {
     m_sink = std::move(sink);
     if (m_sink == nullptr) return;
@@ -126,39 +139,76 @@ void AudioPipeline::set_sink(std::unique_ptr<AudioPipelineSink>&& sink) {
 
 void AudioPipeline::mix_sources_to_sink(tcb::span<Frame<float>> dest, float dest_sampling_rate) {
     const size_t N_dest = dest.size();
-    for (auto& v: dest) {
-        for (size_t i = 0; i < Frame<float>::TOTAL_AUDIO_CHANNELS; i++) {
-            v.channels[i] = 0.0f;
-        }
-    }
-    std::vector<std::shared_ptr<AudioPipelineSource>> sources;
     {
         auto lock = std::scoped_lock(m_mutex_sources);
-        sources = m_sources;
+        m_mix_sources = m_sources;
     }
-    size_t total_sources_mixed = 0;
-    for (auto& source: sources) {
+
+    // each source is read in place or resampled into its own buffer
+    m_mix_inputs.clear();
+    m_resampled_buffers.resize(m_mix_sources.size());
+    for (size_t i = 0; i < m_mix_sources.size(); i++) {
+        auto& source = m_mix_sources[i];
         const float src_sampling_rate = source->get_sampling_rate();
         const size_t N_src = size_t(float(N_dest) * src_sampling_rate / dest_sampling_rate);
-        m_read_buffer.resize(N_src);
-
-        if (!source->read(m_read_buffer)) {
+        Mix_Input input;
+        input.source = source.get();
+        input.is_in_place = (N_src == N_dest);
+        if (input.is_in_place) {
+            if (!source->acquire_read(N_src, input.first, input.second)) continue;
+            m_mix_inputs.push_back(input);
             continue;
         }
 
-        audio_resample_same_type_with_callback<float>(
-            m_read_buffer, dest,
+        m_read_buffer.resize(N_src);
+        if (!source->read(m_read_buffer)) continue;
+        auto& resampled_buffer = m_resampled_buffers[i];
+        resampled_buffer.resize(N_dest);
+        audio_resample_with_callback<float,float>(
+            m_read_buffer, resampled_buffer,
             [](Frame<float>& v_dest, const Frame<float>& v_src) { 
-                v_dest += v_src;
+                v_dest = v_src;
             }
         );
-        total_sources_mixed++;
+        input.first = resampled_buffer;
+        input.second = {};
+        m_mix_inputs.push_back(input);
     }
 
-    const float gain = m_global_gain / std::log10(float(total_sources_mixed * 10.0f));
-    for (auto& v: dest) {
-        v = v * gain;
+    // sources that wrap around their ring buffer split the output into blocks where every source is contiguous
+    m_mix_boundaries.clear();
+    m_mix_boundaries.push_back(0);
+    m_mix_boundaries.push_back(N_dest);
+    for (const auto& input: m_mix_inputs) {
+        if (!input.second.empty()) m_mix_boundaries.push_back(input.first.size());
+    }
+    std::sort(m_mix_boundaries.begin(), m_mix_boundaries.end());
+    m_mix_boundaries.erase(std::unique(m_mix_boundaries.begin(), m_mix_boundaries.end()), m_mix_boundaries.end());
+
+    const size_t total_sources_mixed = m_mix_inputs.size();
+    const float global_gain = m_global_gain / std::log10(float(total_sources_mixed * 10.0f));
+    constexpr size_t TOTAL_CHANNELS = size_t(Frame<float>::TOTAL_AUDIO_CHANNELS);
+    for (size_t i = 0; (i+1) < m_mix_boundaries.size(); i++) {
+        const size_t start = m_mix_boundaries[i];
+        const size_t end = m_mix_boundaries[i+1];
+        m_mix_block.clear();
+        for (const auto& input: m_mix_inputs) {
+            const Frame<float>* data = (start < input.first.size()) ? 
+                &input.first[start] : &input.second[start-input.first.size()];
+            Audio_Mix_Source block;
+            block.data = reinterpret_cast<const float*>(data);
+            block.gain = input.source->get_gain();
+            m_mix_block.push_back(block);
+        }
+        auto dest_block = dest.subspan(start, end-start);
+        audio_mix_sources_auto(
+            tcb::span(reinterpret_cast<float*>(dest_block.data()), dest_block.size()*TOTAL_CHANNELS),
+            m_mix_block, global_gain, -1.0f, 1.0f
+        );
     }
 
-    audio_clamp_inplace(dest, -1.0f, 1.0f);
+    // resampled sources were already released when they were copied out
+    for (const auto& input: m_mix_inputs) {
+        if (input.is_in_place) input.source->commit_read(N_dest);
+    }
 }
@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -9,8 +10,10 @@
 #include <string_view>
 #include <vector>
 #include "utility/span.h"
+#include "./audio_mixer.h"
 #include "./frame.h"
-#include "./ring_buffer.h"
+#include "./polyphase_resampler.h"
+#include "./spsc_ring_buffer.h"
 
 constexpr float DEFAULT_AUDIO_SAMPLE_RATE = 48000.0f;
 constexpr float DEFAULT_AUDIO_SINK_DURATION = 0.1f;
@@ -27,23 +30,40 @@ public:
     virtual std::string_view get_name() const = 0;
 };
 
+// The decoder thread writes to the source and the audio callback reads from it
+// Reads are wait free so the callback never blocks on the decoder
 class AudioPipelineSource 
 {
 private:
     const float m_sampling_rate;
     float m_gain = 1.0f;
 
+    std::unique_ptr<Polyphase_Resampler> m_resampler = nullptr;
     std::vector<Frame<float>> m_resampling_buffer;
-    RingBuffer<Frame<float>> m_ring_buffer;
-    std::vector<Frame<float>> m_read_buffer;
+    SPSC_RingBuffer<Frame<float>> m_ring_buffer;
 
-    std::mutex m_mutex_ring_buffer;
-    std::condition_variable m_cv_ring_buffer;
+    // a blocked writer polls with a timeout since the callback wakes it without a lock
+    std::atomic<bool> m_is_writer_waiting{false};
+    std::mutex m_mutex_writer;
+    std::condition_variable m_cv_writer;
 public:
     explicit AudioPipelineSource(float sampling_rate=DEFAULT_AUDIO_SAMPLE_RATE, size_t buffer_length=DEFAULT_AUDIO_SOURCE_SAMPLES);
     void write(tcb::span<const Frame<int16_t>> src, float src_sampling_rate, bool is_blocking); 
     bool read(tcb::span<Frame<float>> dest);
+    // Frames are read in place from up to two regions and released with commit_read()
+    // Returns false if there aren't enough frames buffered
+    bool acquire_read(const size_t length, tcb::span<const Frame<float>>& first, tcb::span<const Frame<float>>& second);
+    void commit_read(const size_t length);
+    // Applied when mixing so changes are heard immediately
+    float& get_gain() { return m_gain; }
     float get_sampling_rate() const { return m_sampling_rate; }
+    size_t get_total_dropped() const { return m_ring_buffer.get_total_dropped(); }
+private:
+    void notify_writer() {
+        if (m_is_writer_waiting.load(std::memory_order_acquire)) {
+            m_cv_writer.notify_one();
+        }
+    }
 };
 
 class AudioPipeline
@@ -52,8 +72,20 @@ private:
     float m_global_gain = 1.0f;
     std::vector<std::shared_ptr<AudioPipelineSource>> m_sources;
     std::unique_ptr<AudioPipelineSink> m_sink = nullptr;
-    std::vector<Frame<float>> m_read_buffer;
     std::mutex m_mutex_sources;
+    // reused by the audio callback so it doesn't allocate
+    struct Mix_Input {
+        AudioPipelineSource* source;
+        bool is_in_place;
+        tcb::span<const Frame<float>> first;
+        tcb::span<const Frame<float>> second;
+    };
+    std::vector<std::shared_ptr<AudioPipelineSource>> m_mix_sources;
+    std::vector<Mix_Input> m_mix_inputs;
+    std::vector<size_t> m_mix_boundaries;
+    std::vector<Audio_Mix_Source> m_mix_block;
+    std::vector<Frame<float>> m_read_buffer;
+    std::vector<std::vector<Frame<float>>> m_resampled_buffers;
 public:
     AudioPipeline() {}
     void set_sink(std::unique_ptr<AudioPipelineSink>&& sink);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+#include "./frame.h"
+
+// Rational resampler by L/M using a windowed sinc prototype filter split into L phases
+// Each output is a dot product of one phase with the most recent input frames
+// The last input frames are kept between blocks so there are no discontinuities at block edges
+// Usage:
+//   auto input = resampler.get_input_buffer(N);     // fill with N input frames
+//   output.resize(resampler.get_output_length());
+//   resampler.process(output);
+class Polyphase_Resampler
+{
+public:
+    // 44.1kHz <-> 48kHz needs 160 phases so larger ratios are left to other resamplers
+    static constexpr size_t MAX_PHASES = 256;
+    static constexpr size_t DEFAULT_TAPS_PER_PHASE = 24;
+private:
+    const uint32_t m_input_rate;
+    const uint32_t m_output_rate;
+    size_t m_total_phases;
+    size_t m_decimation;
+    const size_t m_taps_per_phase;
+    // [phase][tap][channel] with taps in ascending time order so the dot product is contiguous
+    std::vector<float, AlignedAllocator<float>> m_coefficients;
+    // history of the last (taps-1) frames followed by the new input
+    std::vector<Frame<float>> m_buffer;
+    // position of the next output in upsampled frames from the start of m_buffer
+    size_t m_time = 0;
+public:
+    static bool get_is_supported(const uint32_t input_rate, const uint32_t output_rate);
+    Polyphase_Resampler(const uint32_t input_rate, const uint32_t output_rate, const size_t taps_per_phase=DEFAULT_TAPS_PER_PHASE);
+    uint32_t get_input_rate() const { return m_input_rate; }
+    uint32_t get_output_rate() const { return m_output_rate; }
+    size_t get_taps_per_phase() const { return m_taps_per_phase; }
+    // Space for length input frames which is valid until process() is called
+    tcb::span<Frame<float>> get_input_buffer(const size_t length);
+    // Number of frames process() outputs for the input given to get_input_buffer()
+    size_t get_output_length() const;
+    // Returns the number of frames written to the start of dest
+    size_t process(tcb::span<Frame<float>> dest);
+    // Clears the history when the stream is discontinuous
+    void reset();
+};
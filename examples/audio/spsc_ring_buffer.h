@@ -0,0 +1,111 @@
+#pragma once
+#include <assert.h>
+#include <stddef.h>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "./utility/span.h"
+
+// Wait free single producer single consumer ring buffer
+// The producer only modifies the write index and the consumer only modifies the read index
+// Regions are exposed directly so callers can process samples in place without an intermediate copy
+template <typename T>
+class SPSC_RingBuffer
+{
+public:
+    // Free or used space can wrap around the end of the buffer so it is split into two regions
+    struct Regions {
+        tcb::span<T> first;
+        tcb::span<T> second;
+        size_t size() const { return first.size() + second.size(); }
+    };
+private:
+    // avoid false sharing between producer and consumer indices
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    std::vector<T> m_data;
+    // indices are monotonically increasing and wrapped on access
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_write_index{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_read_index{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_total_dropped{0};
+public:
+    explicit SPSC_RingBuffer(const size_t length): m_data(length) {
+        assert(length > 0);
+    }
+    SPSC_RingBuffer(SPSC_RingBuffer&) = delete;
+    SPSC_RingBuffer(SPSC_RingBuffer&&) = delete;
+    SPSC_RingBuffer& operator=(SPSC_RingBuffer&) = delete;
+    SPSC_RingBuffer& operator=(SPSC_RingBuffer&&) = delete;
+
+    size_t get_size() const { return m_data.size(); }
+    size_t get_total_used() const {
+        const size_t read_index = m_read_index.load(std::memory_order_acquire);
+        const size_t write_index = m_write_index.load(std::memory_order_acquire);
+        return write_index - read_index;
+    }
+    size_t get_total_free() const { return get_size() - get_total_used(); }
+    // Samples the producer couldn't fit with write_or_drop
+    size_t get_total_dropped() const { return m_total_dropped.load(std::memory_order_relaxed); }
+    bool is_full() const { return get_total_used() == get_size(); }
+    bool is_empty() const { return get_total_used() == 0; }
+
+    // Producer: free space which is published with commit_write
+    Regions acquire_write() {
+        const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        const size_t read_index = m_read_index.load(std::memory_order_acquire);
+        return get_regions(write_index, get_size() - (write_index - read_index));
+    }
+    void commit_write(const size_t length) {
+        const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        assert(length <= get_size() - (write_index - m_read_index.load(std::memory_order_acquire)));
+        m_write_index.store(write_index+length, std::memory_order_release);
+    }
+    size_t write(tcb::span<const T> src) {
+        const auto regions = acquire_write();
+        const size_t length = (src.size() > regions.size()) ? regions.size() : src.size();
+        copy_to_regions(src.first(length), regions);
+        commit_write(length);
+        return length;
+    }
+    // Producer: samples that don't fit are dropped since only the consumer can discard old samples
+    void write_or_drop(tcb::span<const T> src) {
+        const size_t length = write(src);
+        if (length != src.size()) {
+            m_total_dropped.fetch_add(src.size()-length, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer: buffered samples which are released with commit_read
+    Regions acquire_read() {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        const size_t write_index = m_write_index.load(std::memory_order_acquire);
+        return get_regions(read_index, write_index - read_index);
+    }
+    void commit_read(const size_t length) {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        assert(length <= m_write_index.load(std::memory_order_acquire) - read_index);
+        m_read_index.store(read_index+length, std::memory_order_release);
+    }
+    size_t read(tcb::span<T> dest) {
+        const auto regions = acquire_read();
+        const size_t length = (dest.size() > regions.size()) ? regions.size() : dest.size();
+        const size_t first_length = (length > regions.first.size()) ? regions.first.size() : length;
+        std::memcpy(dest.data(), regions.first.data(), first_length*sizeof(T));
+        std::memcpy(dest.data()+first_length, regions.second.data(), (length-first_length)*sizeof(T));
+        commit_read(length);
+        return length;
+    }
+private:
+    Regions get_regions(const size_t index, const size_t length) {
+        const size_t start = index % get_size();
+        const size_t first_length = (start + length > get_size()) ? (get_size() - start) : length;
+        Regions regions;
+        regions.first = tcb::span(m_data).subspan(start, first_length);
+        regions.second = tcb::span(m_data).first(length - first_length);
+        return regions;
+    }
+    static void copy_to_regions(tcb::span<const T> src, const Regions& regions) {
+        const size_t first_length = (src.size() > regions.first.size()) ? regions.first.size() : src.size();
+        std::memcpy(regions.first.data(), src.data(), first_length*sizeof(T));
+        std::memcpy(regions.second.data(), src.data()+first_length, (src.size()-first_length)*sizeof(T));
+    }
+};
@@ -1,11 +1,13 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #if _WIN32
 #include <io.h>
@@ -15,15 +17,36 @@
 #include <argparse/argparse.hpp>
 #include <easylogging++.h>
 #include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_dab_channel.h"
+#include "basic_radio/basic_dab_plus_channel.h"
 #include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_slideshow.h"
 #include "basic_scraper/basic_scraper.h"
 #include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
 #include "dab/database/dab_database_types.h"
+#include "ofdm/fft_plan_cache.h"
+#include "utility/memory_policy.h"
+#include "utility/spsc_frame_ring.h"
+#include "utility/thread_affinity.h"
+#include "simd_dispatch.h"
 #include "viterbi_config.h"
+#include "./app_helpers/app_audio_restream_server.h"
+#include "./app_helpers/app_database_snapshot.h"
+#include "./app_helpers/app_device_reader.h"
 #include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_load_shedder.h"
 #include "./app_helpers/app_logging.h"
+#include "./app_helpers/app_managed_devices.h"
+#include "./app_helpers/app_mmap_file.h"
 #include "./app_helpers/app_ofdm_blocks.h"
 #include "./app_helpers/app_radio_blocks.h"
+#include "./app_helpers/app_radio_checkpoint.h"
+#include "./app_helpers/app_radio_event_server.h"
+#include "./app_helpers/app_shared_memory_ring.h"
+#include "./app_helpers/app_slow_frame_capture.h"
+#include "./app_helpers/app_soft_bit_recording.h"
+#include "./app_helpers/app_time_shift.h"
 #include "./app_helpers/app_viterbi_convert_block.h"
 
 #if !BUILD_COMMAND_LINE
@@ -48,6 +71,29 @@ void init_parser(argparse::ArgumentParser& parser) {
         .metavar("INPUT_FILENAME")
         .nargs(1).required()
         .help("Filename of input to radio (defaults to stdin)");
+    parser.add_argument("-d", "--device")
+        .default_value(std::string(""))
+        .metavar("SERIAL:CHANNEL")
+        .nargs(1).required()
+        .help("Read from the tuner with this serial number inside the app instead of through a pipe from rtl_sdr");
+    parser.add_argument("--device-reader-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the usb reader thread of the tuner (e.g. 7)");
+    parser.add_argument("--device-gain")
+        .default_value(19.0f).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain of the tuner");
+    parser.add_argument("--device-auto-gain")
+        .default_value(false).implicit_value(true)
+        .help("Tuner uses auto gain instead of manual gain");
+    parser.add_argument("--device-total-blocks")
+        .default_value(size_t(32)).scan<'u', size_t>()
+        .metavar("TOTAL_BLOCKS")
+        .nargs(1).required()
+        .help("Number of usb transfers that can wait for the OFDM demodulator before they are dropped");
     parser.add_argument("--transmission-mode")
         .default_value(int(1)).scan<'i', int>()
         .choices(1,2,3,4)
@@ -71,9 +117,33 @@ void init_parser(argparse::ArgumentParser& parser) {
         .metavar("TOTAL_THREADS")
         .nargs(1).required()
         .help("Number of OFDM demodulator threads (0 = max number of threads)");
+    parser.add_argument("--ofdm-spin-park")
+        .default_value(false).implicit_value(true)
+        .help("OFDM demodulator threads spin briefly before sleeping to reduce wakeup latency");
+    parser.add_argument("--ofdm-inline")
+        .default_value(false).implicit_value(true)
+        .help("Demodulate each OFDM frame on the thread reading it without creating any threads");
+    parser.add_argument("--ofdm-reader-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the OFDM reader and coordinator threads (e.g. 0-1,4)");
+    parser.add_argument("--ofdm-pipeline-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the OFDM pipeline threads with one core per thread (e.g. 2-5)");
+    parser.add_argument("--ofdm-ingest-frames")
+        .default_value(size_t(2)).scan<'u', size_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Frames the OFDM reader can hold while the pipelines are busy (tuners skip a frame once all are used)");
     parser.add_argument("--ofdm-disable-coarse-freq")
         .default_value(false).implicit_value(true)
         .help("Disable OFDM coarse frequency correction");
+    parser.add_argument("--ofdm-idle-probing")
+        .default_value(false).implicit_value(true)
+        .help("Sparsely probe for a signal after a long time without a frame instead of searching every sample");
     parser.add_argument("--ofdm-enable-output")
         .default_value(false).implicit_value(true)
         .help("OFDM demodulator output is written to a file");
@@ -85,18 +155,119 @@ void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("--ofdm-output-hard-bytes")
         .default_value(false).implicit_value(true)
         .help("Output of OFDM demodulator is converted from soft bits to hard bytes (8x compression)");
+    parser.add_argument("--ofdm-output-packed")
+        .default_value(false).implicit_value(true)
+        .help("Output of OFDM demodulator is converted from soft bits to packed 4bit soft bits (2x compression)");
+    parser.add_argument("--ofdm-output-recording")
+        .default_value(false).implicit_value(true)
+        .help("Output of OFDM demodulator is written as an indexed recording (see convert_recording)");
+    parser.add_argument("--ofdm-output-compression")
+        .default_value(std::string("none"))
+        .choices("none", "lz4", "zstd")
+        .metavar("COMPRESSION")
+        .nargs(1).required()
+        .help("Compression of the chunks of the recording (lz4 and zstd are only available if they were found when building)");
+    parser.add_argument("--ofdm-output-frequency")
+        .default_value(uint32_t(0)).scan<'u', uint32_t>()
+        .metavar("FREQUENCY_HZ")
+        .nargs(1).required()
+        .help("Centre frequency of the input that is stored in the recording");
+    parser.add_argument("--ofdm-skip-unused-symbols")
+        .default_value(false).implicit_value(true)
+        .help("Only demodulate the symbols of the FIC and the subchannels that are being decoded");
+    parser.add_argument("--ofdm-stream-cifs")
+        .default_value(false).implicit_value(true)
+        .help("Decode the FIC and each CIF as soon as they are demodulated instead of waiting for the whole frame");
     // radio settings
     parser.add_argument("--radio-total-threads")
         .default_value(size_t(1)).scan<'u', size_t>()
         .metavar("TOTAL_THREADS")
         .nargs(1).required()
         .help("Number of basic radio threads (0 = max number of threads)");
+    parser.add_argument("--radio-pipeline-depth")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("DEPTH")
+        .nargs(1).required()
+        .help("Number of frames the radio can decode concurrently (1 = no pipelining)");
+    parser.add_argument("--radio-batch-viterbi")
+        .default_value(false).implicit_value(true)
+        .help("Viterbi decode subchannels together across SIMD lanes (requires pipeline depth of 1)");
+    parser.add_argument("--radio-multi-cif-viterbi")
+        .default_value(false).implicit_value(true)
+        .help("Viterbi decode the CIFs of a frame together across SIMD lanes for each subchannel");
+    parser.add_argument("--radio-queued-pad")
+        .default_value(false).implicit_value(true)
+        .help("Process dynamic labels and slideshows in low priority tasks separate to the audio");
+    parser.add_argument("--radio-queued-packet-data")
+        .default_value(false).implicit_value(true)
+        .help("Assemble each packet address of data channels in parallel low priority tasks");
+    parser.add_argument("--radio-low-latency-aac")
+        .default_value(false).implicit_value(true)
+        .help("Decode DAB+ access units whose crc is valid before their superframe is reed solomon corrected");
+    parser.add_argument("--radio-max-error-per-bit")
+        .default_value(0.0f).scan<'g', float>()
+        .metavar("ERROR")
+        .nargs(1).required()
+        .help("Skip decoding past viterbi for CIFs with a higher average error per bit during fades (0 = disabled)");
+    parser.add_argument("--radio-low-complexity-aac")
+        .default_value(false).implicit_value(true)
+        .help("Decode DAB+ audio at half the sampling rate with downsampled SBR for less CPU");
+    parser.add_argument("--radio-standby-channels")
+        .default_value(false).implicit_value(true)
+        .help("Audio channels that aren't decoded are kept demodulated so they start instantly when selected");
+    parser.add_argument("--radio-shard-index")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("INDEX")
+        .nargs(1).required()
+        .help("Share of the subchannels this radio decodes when the ensemble is split between radios");
+    parser.add_argument("--radio-total-shards")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_SHARDS")
+        .nargs(1).required()
+        .help("Number of radios receiving the same frames (e.g. from soft_bit_network) that split the subchannels");
+    parser.add_argument("--radio-checkpoint")
+        .default_value(std::string(""))
+        .metavar("FILE")
+        .nargs(1).required()
+        .help("Radio state is restored from this file on startup and saved to it so a restart resumes decoding without waiting for the FIC");
+    parser.add_argument("--radio-checkpoint-interval")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Number of frames between each radio checkpoint (0 = only on exit)");
+    parser.add_argument("--radio-load-shedding")
+        .default_value(false).implicit_value(true)
+        .help("Pause unplayed channels, PAD, full quality AAC then FIC decoding in turn while frames take too long to process");
     parser.add_argument("--radio-enable-logging")
         .default_value(false).implicit_value(true)
         .help("Enable verbose logging for radio");
     parser.add_argument("--radio-input-hard-bytes")
         .default_value(false).implicit_value(true)
         .help("Input of radio is converted from hard bytes to soft bits (unpack compression)");
+    parser.add_argument("--radio-input-packed")
+        .default_value(false).implicit_value(true)
+        .help("Input of radio is converted from packed 4bit soft bits to soft bits");
+    parser.add_argument("--radio-input-recording")
+        .default_value(false).implicit_value(true)
+        .help("Input of radio is an indexed recording (see convert_recording)");
+    parser.add_argument("--radio-input-start-frame")
+        .default_value(uint64_t(0)).scan<'u', uint64_t>()
+        .metavar("FRAME")
+        .nargs(1).required()
+        .help("First frame that is read from the indexed recording");
+    parser.add_argument("--radio-batch-frames")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Number of frames read from the input file that each subchannel decodes together (1 = frame by frame)");
+    parser.add_argument("--radio-packed-history")
+        .default_value(false).implicit_value(true)
+        .help("Deinterleaver history stores 4bit soft bits which halves its memory usage");
+    parser.add_argument("--radio-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the basic radio threads with one core per thread (e.g. 6-11)");
     // scraper settings
     parser.add_argument("--scraper-enable")
         .default_value(false).implicit_value(true)
@@ -112,7 +283,153 @@ void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("--scraper-disable-auto")
         .default_value(false).implicit_value(true)
         .help("Disable automatic scraping of new channels");
+    parser.add_argument("--scraper-encoded-only")
+        .default_value(false).implicit_value(true)
+        .help("Only save the AAC/MP2 frames without decoding them to a wav file");
+    parser.add_argument("--scraper-archive")
+        .default_value(false).implicit_value(true)
+        .help("Append slideshows and MOT objects to an indexed archive instead of writing a file for each one");
+    parser.add_argument("--scraper-rotate-minutes")
+        .default_value(int(0)).scan<'i', int>()
+        .metavar("MINUTES")
+        .nargs(1).required()
+        .help("Start a new audio file every N minutes aligned to the clock (0 to disable)");
+    parser.add_argument("--scraper-rotate-mb")
+        .default_value(int(0)).scan<'i', int>()
+        .metavar("MB")
+        .nargs(1).required()
+        .help("Start a new audio file when it would grow past N megabytes (0 to disable)");
+    // shared memory settings
+    parser.add_argument("--shm-output")
+        .default_value(std::string(""))
+        .metavar("NAME")
+        .nargs(1).required()
+        .help("Publish decoded audio to a shared memory ring that other processes can read (see read_shared_memory)");
+    parser.add_argument("--shm-total-slots")
+        .default_value(size_t(64)).scan<'u', size_t>()
+        .metavar("TOTAL_SLOTS")
+        .nargs(1).required()
+        .help("Number of frames held by the shared memory ring before the oldest is overwritten");
+    parser.add_argument("--shm-slot-size")
+        .default_value(size_t(256*1024)).scan<'u', size_t>()
+        .metavar("BYTES")
+        .nargs(1).required()
+        .help("Largest frame in the shared memory ring which should fit an OFDM frame of soft bits");
+    parser.add_argument("--shm-soft-bits")
+        .default_value(false).implicit_value(true)
+        .help("Also publish the OFDM soft bits of each frame to the shared memory ring");
+    parser.add_argument("--shm-encoded-audio")
+        .default_value(false).implicit_value(true)
+        .help("Also publish the AAC access units of DAB+ channels to the shared memory ring");
+    parser.add_argument("--shm-database")
+        .default_value(std::string(""))
+        .metavar("NAME")
+        .nargs(1).required()
+        .help("Publish a flat snapshot of the database to shared memory whenever it changes (see read_shared_memory)");
+    parser.add_argument("--shm-database-size")
+        .default_value(size_t(256*1024)).scan<'u', size_t>()
+        .metavar("BYTES")
+        .nargs(1).required()
+        .help("Largest database snapshot held by the shared memory");
+    parser.add_argument("--database-snapshot")
+        .default_value(std::string(""))
+        .metavar("FILE")
+        .nargs(1).required()
+        .help("Save a flat snapshot of the database to this file whenever it changes so tools can map it");
+    // restream settings
+    parser.add_argument("--restream-port")
+        .default_value(std::string(""))
+        .metavar("PORT")
+        .nargs(1).required()
+        .help("Restream the encoded audio of every channel over HTTP on this port without decoding it (GET / lists channels)");
+    parser.add_argument("--restream-address")
+        .default_value(std::string(""))
+        .metavar("ADDRESS")
+        .nargs(1).required()
+        .help("Local address the restream server listens on (defaults to all interfaces)");
+    parser.add_argument("--restream-ring-frames")
+        .default_value(size_t(256)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Frames held for each channel before slow clients skip ahead");
+    // time shift settings
+    parser.add_argument("--time-shift-dir")
+        .default_value(std::string(""))
+        .metavar("DIRECTORY")
+        .nargs(1).required()
+        .help("Keep the encoded audio of every channel in memory mapped segment files in this directory so it can be rewound");
+    parser.add_argument("--time-shift-seconds")
+        .default_value(size_t(600)).scan<'u', size_t>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Length of the encoded audio kept for each channel");
+    // event server settings
+    parser.add_argument("--event-port")
+        .default_value(std::string(""))
+        .metavar("PORT")
+        .nargs(1).required()
+        .help("Serve database, dynamic label and slideshow changes to dashboards over HTTP on this port (GET /events or /state)");
+    parser.add_argument("--event-address")
+        .default_value(std::string(""))
+        .metavar("ADDRESS")
+        .nargs(1).required()
+        .help("Local address the event server listens on (defaults to all interfaces)");
+    parser.add_argument("--event-interval-ms")
+        .default_value(int(250)).scan<'i', int>()
+        .metavar("MILLISECONDS")
+        .nargs(1).required()
+        .help("Changes are coalesced into one update sent to every client at this interval");
+    // slow frame capture
+    parser.add_argument("--slow-frame-dir")
+        .default_value(std::string(""))
+        .metavar("DIRECTORY")
+        .nargs(1).required()
+        .help("Dump the input, stage timings and thread schedule of frames that take too long into this directory");
+    parser.add_argument("--slow-frame-threshold-ms")
+        .default_value(0.0f).scan<'g', float>()
+        .metavar("MILLISECONDS")
+        .nargs(1).required()
+        .help("Frames that take longer than this to demodulate or decode are captured (0 = frame period)");
+    parser.add_argument("--slow-frame-max-captures")
+        .default_value(size_t(16)).scan<'u', size_t>()
+        .metavar("TOTAL_CAPTURES")
+        .nargs(1).required()
+        .help("Stop capturing slow frames after this many");
     // other
+    parser.add_argument("--simd-level")
+        .default_value(std::string("auto"))
+        .choices("auto", "scalar", "sse4.1", "avx", "avx2", "avx512", "neon", "sve2", "rvv")
+        .metavar("LEVEL")
+        .nargs(1).required()
+        .help("Override the SIMD kernels selected for this CPU");
+    parser.add_argument("--fft-rigor")
+        .default_value(std::string("estimate"))
+        .choices("estimate", "measure", "patient")
+        .metavar("RIGOR")
+        .nargs(1).required()
+        .help("How long FFTW3 searches for the fastest FFT plans at startup");
+    parser.add_argument("--fft-wisdom")
+        .default_value(std::string(""))
+        .metavar("WISDOM_FILENAME")
+        .nargs(1).required()
+        .help("File that measured FFT plans are loaded from and saved to");
+    parser.add_argument("--numa-node")
+        .default_value(int(-1)).scan<'i', int>()
+        .metavar("NODE")
+        .nargs(1).required()
+        .help("Bind OFDM and radio threads to the cores of a NUMA node (-1 = any node)");
+    parser.add_argument("--thread-priority")
+        .default_value(std::string("default"))
+        .choices("default", "low", "high", "realtime")
+        .metavar("PRIORITY")
+        .nargs(1).required()
+        .help("Priority of the OFDM and radio threads (high/realtime may need elevated privileges)");
+    parser.add_argument("--huge-pages")
+        .default_value(false).implicit_value(true)
+        .help("Back the OFDM buffers and CIF history with 2MB huge pages");
+    parser.add_argument("--lock-memory")
+        .default_value(false).implicit_value(true)
+        .help("Lock the OFDM buffers and CIF history into RAM so they never page fault");
 #if !BUILD_COMMAND_LINE
     parser.add_argument("--audio-no-auto-select")
         .default_value(false).implicit_value(true)
@@ -126,26 +443,96 @@ void init_parser(argparse::ArgumentParser& parser) {
 
 struct Args {
     std::string input_file; 
+    std::string device;
+    // device settings
+    std::string device_reader_cores;
+    float device_gain;
+    bool device_auto_gain;
+    size_t device_total_blocks;
     int transmission_mode;
     bool is_ofdm_used;
     bool is_dab_used;
     // ofdm settings
     size_t ofdm_block_size;
     size_t ofdm_total_threads;
+    bool ofdm_spin_park;
+    bool ofdm_inline;
+    std::string ofdm_reader_cores;
+    std::string ofdm_pipeline_cores;
+    size_t ofdm_ingest_frames;
     bool ofdm_disable_coarse_freq;
+    bool ofdm_idle_probing;
     bool ofdm_enable_output;
     std::string ofdm_output;
     bool ofdm_output_hard_bytes;
+    bool ofdm_output_packed;
+    bool ofdm_output_recording;
+    std::string ofdm_output_compression;
+    uint32_t ofdm_output_frequency;
+    bool ofdm_skip_unused_symbols;
+    bool ofdm_stream_cifs;
     // radio settings
     size_t radio_total_threads;
+    size_t radio_pipeline_depth;
+    bool radio_batch_viterbi;
+    bool radio_multi_cif_viterbi;
+    bool radio_queued_pad;
+    bool radio_queued_packet_data;
+    bool radio_low_latency_aac;
+    float radio_max_error_per_bit;
+    bool radio_low_complexity_aac;
+    bool radio_standby_channels;
     bool radio_enable_logging;
     bool radio_input_hard_bytes;
+    bool radio_input_packed;
+    bool radio_input_recording;
+    uint64_t radio_input_start_frame;
+    size_t radio_batch_frames;
+    bool radio_packed_history;
+    size_t radio_shard_index;
+    size_t radio_total_shards;
+    std::string radio_checkpoint;
+    size_t radio_checkpoint_interval;
+    bool radio_load_shedding;
+    std::string radio_cores;
     // scraper settings
     bool scraper_enable;
     std::string scraper_output;
     bool scraper_disable_logging;
     bool scraper_disable_auto;
+    bool scraper_encoded_only;
+    bool scraper_archive;
+    int scraper_rotate_minutes;
+    int scraper_rotate_mb;
+    // shared memory settings
+    std::string shm_output;
+    size_t shm_total_slots;
+    size_t shm_slot_size;
+    bool shm_soft_bits;
+    bool shm_encoded_audio;
+    std::string shm_database;
+    size_t shm_database_size;
+    std::string database_snapshot;
+    std::string restream_port;
+    std::string restream_address;
+    size_t restream_ring_frames;
+    std::string time_shift_dir;
+    size_t time_shift_seconds;
+    std::string event_port;
+    std::string event_address;
+    int event_interval_ms;
+    // slow frame capture
+    std::string slow_frame_dir;
+    float slow_frame_threshold_ms;
+    size_t slow_frame_max_captures;
     // other
+    std::string simd_level;
+    std::string fft_rigor;
+    std::string fft_wisdom;
+    int numa_node;
+    std::string thread_priority;
+    bool huge_pages;
+    bool lock_memory;
 #if !BUILD_COMMAND_LINE
     bool audio_no_auto_select;
 #else
@@ -156,6 +543,12 @@ struct Args {
 Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     Args args;
     args.input_file = parser.get<std::string>("--input");
+    args.device = parser.get<std::string>("--device");
+    // device settings
+    args.device_reader_cores = parser.get<std::string>("--device-reader-cores");
+    args.device_gain = parser.get<float>("--device-gain");
+    args.device_auto_gain = parser.get<bool>("--device-auto-gain");
+    args.device_total_blocks = parser.get<size_t>("--device-total-blocks");
     args.transmission_mode = parser.get<int>("--transmission-mode");
     auto configuration = parser.get<std::string>("--configuration");
     args.is_ofdm_used = true;
@@ -168,20 +561,84 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     // ofdm settings
     args.ofdm_block_size = parser.get<size_t>("--ofdm-block-size");
     args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
+    args.ofdm_spin_park = parser.get<bool>("--ofdm-spin-park");
+    args.ofdm_inline = parser.get<bool>("--ofdm-inline");
+    args.ofdm_reader_cores = parser.get<std::string>("--ofdm-reader-cores");
+    args.ofdm_pipeline_cores = parser.get<std::string>("--ofdm-pipeline-cores");
+    args.ofdm_ingest_frames = parser.get<size_t>("--ofdm-ingest-frames");
     args.ofdm_disable_coarse_freq = parser.get<bool>("--ofdm-disable-coarse-freq");
+    args.ofdm_idle_probing = parser.get<bool>("--ofdm-idle-probing");
     args.ofdm_enable_output = parser.get<bool>("--ofdm-enable-output");
     args.ofdm_output = parser.get<std::string>("--ofdm-output");
     args.ofdm_output_hard_bytes = parser.get<bool>("--ofdm-output-hard-bytes");
+    args.ofdm_output_packed = parser.get<bool>("--ofdm-output-packed");
+    args.ofdm_output_recording = parser.get<bool>("--ofdm-output-recording");
+    args.ofdm_output_compression = parser.get<std::string>("--ofdm-output-compression");
+    args.ofdm_output_frequency = parser.get<uint32_t>("--ofdm-output-frequency");
+    args.ofdm_skip_unused_symbols = parser.get<bool>("--ofdm-skip-unused-symbols");
+    args.ofdm_stream_cifs = parser.get<bool>("--ofdm-stream-cifs");
     // radio settings
     args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
+    args.radio_pipeline_depth = parser.get<size_t>("--radio-pipeline-depth");
+    args.radio_batch_viterbi = parser.get<bool>("--radio-batch-viterbi");
+    args.radio_multi_cif_viterbi = parser.get<bool>("--radio-multi-cif-viterbi");
+    args.radio_queued_pad = parser.get<bool>("--radio-queued-pad");
+    args.radio_queued_packet_data = parser.get<bool>("--radio-queued-packet-data");
+    args.radio_low_latency_aac = parser.get<bool>("--radio-low-latency-aac");
+    args.radio_max_error_per_bit = parser.get<float>("--radio-max-error-per-bit");
+    args.radio_low_complexity_aac = parser.get<bool>("--radio-low-complexity-aac");
+    args.radio_standby_channels = parser.get<bool>("--radio-standby-channels");
     args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
     args.radio_input_hard_bytes = parser.get<bool>("--radio-input-hard-bytes");
+    args.radio_input_packed = parser.get<bool>("--radio-input-packed");
+    args.radio_input_recording = parser.get<bool>("--radio-input-recording");
+    args.radio_input_start_frame = parser.get<uint64_t>("--radio-input-start-frame");
+    args.radio_batch_frames = parser.get<size_t>("--radio-batch-frames");
+    args.radio_packed_history = parser.get<bool>("--radio-packed-history");
+    args.radio_shard_index = parser.get<size_t>("--radio-shard-index");
+    args.radio_total_shards = parser.get<size_t>("--radio-total-shards");
+    args.radio_checkpoint = parser.get<std::string>("--radio-checkpoint");
+    args.radio_checkpoint_interval = parser.get<size_t>("--radio-checkpoint-interval");
+    args.radio_load_shedding = parser.get<bool>("--radio-load-shedding");
+    args.radio_cores = parser.get<std::string>("--radio-cores");
     // scraper settings
     args.scraper_enable = parser.get<bool>("--scraper-enable");
     args.scraper_output = parser.get<std::string>("--scraper-output");
     args.scraper_disable_logging = parser.get<bool>("--scraper-disable-logging");
     args.scraper_disable_auto = parser.get<bool>("--scraper-disable-auto");
+    args.scraper_encoded_only = parser.get<bool>("--scraper-encoded-only");
+    args.scraper_archive = parser.get<bool>("--scraper-archive");
+    args.scraper_rotate_minutes = parser.get<int>("--scraper-rotate-minutes");
+    args.scraper_rotate_mb = parser.get<int>("--scraper-rotate-mb");
+    // shared memory settings
+    args.shm_output = parser.get<std::string>("--shm-output");
+    args.shm_total_slots = parser.get<size_t>("--shm-total-slots");
+    args.shm_slot_size = parser.get<size_t>("--shm-slot-size");
+    args.shm_soft_bits = parser.get<bool>("--shm-soft-bits");
+    args.shm_encoded_audio = parser.get<bool>("--shm-encoded-audio");
+    args.shm_database = parser.get<std::string>("--shm-database");
+    args.shm_database_size = parser.get<size_t>("--shm-database-size");
+    args.database_snapshot = parser.get<std::string>("--database-snapshot");
+    args.restream_port = parser.get<std::string>("--restream-port");
+    args.restream_address = parser.get<std::string>("--restream-address");
+    args.restream_ring_frames = parser.get<size_t>("--restream-ring-frames");
+    args.time_shift_dir = parser.get<std::string>("--time-shift-dir");
+    args.time_shift_seconds = parser.get<size_t>("--time-shift-seconds");
+    args.event_port = parser.get<std::string>("--event-port");
+    args.event_address = parser.get<std::string>("--event-address");
+    args.event_interval_ms = parser.get<int>("--event-interval-ms");
+    // slow frame capture
+    args.slow_frame_dir = parser.get<std::string>("--slow-frame-dir");
+    args.slow_frame_threshold_ms = parser.get<float>("--slow-frame-threshold-ms");
+    args.slow_frame_max_captures = parser.get<size_t>("--slow-frame-max-captures");
     // other
+    args.simd_level = parser.get<std::string>("--simd-level");
+    args.fft_rigor = parser.get<std::string>("--fft-rigor");
+    args.fft_wisdom = parser.get<std::string>("--fft-wisdom");
+    args.numa_node = parser.get<int>("--numa-node");
+    args.thread_priority = parser.get<std::string>("--thread-priority");
+    args.huge_pages = parser.get<bool>("--huge-pages");
+    args.lock_memory = parser.get<bool>("--lock-memory");
 #if !BUILD_COMMAND_LINE
     args.audio_no_auto_select = parser.get<bool>("--audio-no-auto-select");
 #else
@@ -191,14 +648,98 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
 }
 
 
+// Files that can be memory mapped are read directly from the mapping
+template <typename T>
+static std::shared_ptr<InputBuffer<T>> create_input_file(
+    FILE* fp_in, std::shared_ptr<const MappedFile> mapped_fp_in,
+    std::shared_ptr<FileWrapper>& file_in, std::shared_ptr<MappedFileReader>& mapped_file_in)
+{
+    if (mapped_fp_in != nullptr) {
+        auto input = std::make_shared<MappedInputFile<T>>(mapped_fp_in);
+        mapped_file_in = input;
+        return input;
+    }
+    auto input = std::make_shared<InputFile<T>>(fp_in);
+    file_in = input;
+    return input;
+}
+
+// Audio of every channel is published once so any number of processes can read it without going through a pipe
+static void attach_shared_memory_to_radio(std::shared_ptr<SharedMemoryRingWriter> writer, BasicRadio& radio, const bool is_encoded_audio) {
+    radio.On_Audio_Channel().Attach(
+        [writer, is_encoded_audio](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            channel.OnAudioData().Attach([writer, subchannel_id](BasicAudioParams params, tcb::span<const uint8_t> data) {
+                const uint32_t param = params.frequency | (params.is_stereo ? SHARED_MEMORY_PCM_STEREO_FLAG : 0);
+                writer->publish(SharedMemoryFrameType::PCM_AUDIO, uint32_t(subchannel_id), param, data);
+            });
+            if (!is_encoded_audio || (channel.GetType() != AudioServiceType::DAB_PLUS)) return;
+            channel.GetControls().SetIsEncodedAudio(true);
+            auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+            derived.OnAACData().Attach([writer, subchannel_id](auto superframe_header, auto mpeg4_header, auto buf) {
+                writer->publish(SharedMemoryFrameType::AAC_ACCESS_UNIT, uint32_t(subchannel_id), 0, mpeg4_header, buf);
+            });
+        }
+    );
+}
+
+// Snapshots are published from the radio thread as soon as the database changes
+static void attach_database_writer_to_radio(std::shared_ptr<Database_Snapshot_Writer> writer, BasicRadio& radio) {
+    auto* radio_ptr = &radio;
+    radio.On_Database_Changes().Attach([writer, radio_ptr](tcb::span<const DatabaseChange> changes) {
+        const auto database = radio_ptr->GetDatabaseSnapshot();
+        if (database == nullptr) return;
+        writer->publish(*database, radio_ptr->GetDatabaseVersion());
+    });
+}
+
+// Encoded frames are restreamed as they are so no codec runs for listeners
+static void attach_restream_server_to_radio(std::shared_ptr<Audio_Restream_Server> server, BasicRadio& radio) {
+    radio.On_Audio_Channel().Attach(
+        [server](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            channel.GetControls().SetIsEncodedAudio(true);
+            const auto id = uint32_t(subchannel_id);
+            if (channel.GetType() == AudioServiceType::DAB_PLUS) {
+                auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+                derived.OnAACData().Attach([server, id](auto superframe_header, auto mpeg4_header, auto buf) {
+                    server->push_frame(id, Restream_Audio_Type::AAC_ADTS, mpeg4_header, buf);
+                });
+            } else {
+                auto& derived = dynamic_cast<Basic_DAB_Channel&>(channel);
+                derived.OnMP2Data().Attach([server, id](tcb::span<const uint8_t> data) {
+                    server->push_frame(id, Restream_Audio_Type::MP2, {}, data);
+                });
+            }
+        }
+    );
+}
+
+// Changes are pushed to the server as they happen so dashboards never poll the radio under its mutex
+static void attach_event_server_to_radio(std::shared_ptr<Radio_Event_Server> server, BasicRadio& radio) {
+    auto* radio_ptr = &radio;
+    radio.On_Database_Changes().Attach([server, radio_ptr](tcb::span<const DatabaseChange> changes) {
+        server->update_database(radio_ptr->GetDatabaseSnapshot(), changes);
+    });
+    radio.On_Audio_Channel().Attach(
+        [server](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            const auto id = uint32_t(subchannel_id);
+            channel.OnDynamicLabel().Attach([server, id](std::string_view label) {
+                server->update_dynamic_label(id, label);
+            });
+            channel.GetSlideshowManager().OnNewSlideshow().Attach([server, id](const std::shared_ptr<Basic_Slideshow>& slideshow) {
+                server->update_slideshow(id, *slideshow);
+            });
+        }
+    );
+}
+
 INITIALIZE_EASYLOGGINGPP
 int main(int argc, char** argv) {
 #if !BUILD_COMMAND_LINE
     const char* PROGRAM_NAME = "basic_radio_app";
-    const char* PROGRAM_DESCRIPTION = "Radio app that reads from a file with a gui";
+    const char* PROGRAM_DESCRIPTION = "Radio app that reads from a file or tuner with a gui";
 #else
     const char* PROGRAM_NAME = "basic_radio_app_cli";
-    const char* PROGRAM_DESCRIPTION = "Radio app that reads from a file";
+    const char* PROGRAM_DESCRIPTION = "Radio app that reads from a file or tuner";
 #endif
     const char* PROGRAM_VERSION_NAME = "0.1.0";
 
@@ -217,9 +758,127 @@ int main(int argc, char** argv) {
         fprintf(stderr, "OFDM block size cannot be zero\n");
         return 1;
     }
+    if ((args.radio_total_shards == 0) || (args.radio_shard_index >= args.radio_total_shards)) {
+        fprintf(stderr, "Radio shard index %zu must be less than the total number of shards %zu\n",
+            args.radio_shard_index, args.radio_total_shards);
+        return 1;
+    }
+    if (args.ofdm_skip_unused_symbols && (!args.is_ofdm_used || !args.is_dab_used || args.ofdm_enable_output)) {
+        fprintf(stderr, "Skipping unused OFDM symbols requires the radio and can't be used with the OFDM output\n");
+        return 1;
+    }
+    if ((args.radio_batch_frames == 0) || ((args.radio_batch_frames > 1) && args.is_ofdm_used)) {
+        fprintf(stderr, "Radio batches of %zu frames need at least 1 frame and can only be read from an input file\n",
+            args.radio_batch_frames);
+        return 1;
+    }
+    if (args.ofdm_stream_cifs && (!args.is_ofdm_used || !args.is_dab_used)) {
+        fprintf(stderr, "Streaming CIFs from the OFDM demodulator requires the radio\n");
+        return 1;
+    }
+    if (args.simd_level.compare("auto") != 0) {
+        SIMD_Level simd_level;
+        if (!simd_get_level_from_name(args.simd_level.c_str(), simd_level) || !simd_set_level(simd_level)) {
+            fprintf(stderr, "SIMD level '%s' is not supported on this CPU (supported up to '%s')\n", 
+                args.simd_level.c_str(), simd_get_level_name(simd_get_supported_level()));
+            return 1;
+        }
+    }
+    fprintf(stderr, "Using SIMD kernels for %s\n", simd_get_level_name(simd_get_level()));
+    FFT_Plan_Rigor fft_rigor = FFT_Plan_Rigor::ESTIMATE;
+    fft_get_plan_rigor_from_name(args.fft_rigor.c_str(), fft_rigor);
+    fft_set_plan_rigor(fft_rigor);
+    fprintf(stderr, "Using %s for FFTs\n", fft_get_backend_name());
+    if (!args.fft_wisdom.empty() && !fft_import_wisdom(args.fft_wisdom.c_str())) {
+        fprintf(stderr, "FFT wisdom will be created in '%s'\n", args.fft_wisdom.c_str());
+    }
+    Thread_Affinity default_affinity;
+    default_affinity.numa_node = args.numa_node;
+    parse_thread_priority(args.thread_priority.c_str(), default_affinity.priority);
+    OFDM_Demod_Thread_Config ofdm_thread_config;
+    ofdm_thread_config.reader = default_affinity;
+    ofdm_thread_config.pipeline = default_affinity;
+    ofdm_thread_config.pipeline.is_one_core_per_thread = true;
+    Thread_Affinity radio_thread_affinity = default_affinity;
+    radio_thread_affinity.is_one_core_per_thread = true;
+    const auto parse_cores = [](const std::string& name, const std::string& list, std::vector<int>& cores) {
+        if (!parse_thread_cores(list.c_str(), cores)) {
+            fprintf(stderr, "Invalid core list for %s: '%s'\n", name.c_str(), list.c_str());
+            return false;
+        }
+        return true;
+    };
+    if (
+        !parse_cores("--ofdm-reader-cores", args.ofdm_reader_cores, ofdm_thread_config.reader.cores) ||
+        !parse_cores("--ofdm-pipeline-cores", args.ofdm_pipeline_cores, ofdm_thread_config.pipeline.cores) ||
+        !parse_cores("--radio-cores", args.radio_cores, radio_thread_affinity.cores)
+    ) {
+        return 1;
+    }
+    ofdm_thread_config.coordinator = ofdm_thread_config.reader;
+    ofdm_thread_config.total_ingest_frames = args.ofdm_ingest_frames;
+    // the node of each buffer is taken from the threads that use it
+    Memory_Policy memory_policy;
+    memory_policy.is_huge_pages = args.huge_pages;
+    memory_policy.is_locked = args.lock_memory;
+    ofdm_thread_config.memory = memory_policy;
+
+    // the tuner's usb transfers are handed to the demodulator through a lock free ring instead of a pipe
+    const bool is_device_input = !args.device.empty();
+    ManagedDeviceConfig device_config;
+    if (is_device_input) {
+        if (!args.is_ofdm_used) {
+            fprintf(stderr, "Reading from a tuner requires the OFDM demodulator\n");
+            return 1;
+        }
+        if (!args.input_file.empty()) {
+            fprintf(stderr, "Only one of --input and --device can be used\n");
+            return 1;
+        }
+        if (args.device_total_blocks == 0) {
+            fprintf(stderr, "Device total blocks cannot be zero\n");
+            return 1;
+        }
+        if (!parse_managed_device_config(args.device, device_config)) {
+            fprintf(stderr, "Invalid device '%s', expected SERIAL:CHANNEL with a channel from radio_app --list-channels\n", args.device.c_str());
+            return 1;
+        }
+        if (!parse_cores("--device-reader-cores", args.device_reader_cores, device_config.reader_affinity.cores)) {
+            return 1;
+        }
+        device_config.reader_affinity.numa_node = args.numa_node;
+        // samples are dropped upstream if the reader blocks so a late frame is skipped instead
+        ofdm_thread_config.is_skip_ingest_overrun = true;
+        device_config.is_auto_gain = args.device_auto_gain;
+        device_config.gain = args.device_gain;
+    }
+
+    const bool is_input_recording = !args.is_ofdm_used && args.radio_input_recording;
+    if (is_input_recording && args.input_file.empty()) {
+        fprintf(stderr, "Indexed recordings must be read from a file since they are seeked\n");
+        return 1;
+    }
+    Recording_Compression ofdm_output_compression = Recording_Compression::NONE;
+    if (args.ofdm_output_compression.compare("lz4") == 0) {
+        ofdm_output_compression = Recording_Compression::LZ4;
+    } else if (args.ofdm_output_compression.compare("zstd") == 0) {
+        ofdm_output_compression = Recording_Compression::ZSTD;
+    }
+    if (args.ofdm_output_recording && !get_recording_compression_is_supported(ofdm_output_compression)) {
+        fprintf(stderr, "Compression '%s' wasn't available when building\n", args.ofdm_output_compression.c_str());
+        return 1;
+    }
 
+    // regular files are memory mapped so they are read without a lock or an intermediate copy
     FILE* fp_in = stdin;
-    if (!args.input_file.empty()) { 
+    std::shared_ptr<MappedFile> mapped_fp_in = nullptr;
+    if (!args.input_file.empty() && !is_input_recording && !is_device_input) {
+        mapped_fp_in = std::make_shared<MappedFile>();
+        if (!mapped_fp_in->open(args.input_file)) {
+            mapped_fp_in = nullptr;
+        }
+    }
+    if (!args.input_file.empty() && (mapped_fp_in == nullptr) && !is_device_input) { 
         fp_in = fopen(args.input_file.c_str(), "rb");
         if (fp_in == nullptr) {
             fprintf(stderr, "Failed to open input file: '%s'\n", args.input_file.c_str());
@@ -247,47 +906,176 @@ int main(int argc, char** argv) {
     std::shared_ptr<OFDM_Block> ofdm_block = nullptr;
     auto ofdm_output_splitter = std::shared_ptr<OutputSplitter<viterbi_bit_t>>();
     if (args.is_ofdm_used) {
-        ofdm_block = std::make_shared<OFDM_Block>(args.transmission_mode, args.ofdm_total_threads);
+        ofdm_block = std::make_shared<OFDM_Block>(
+            args.transmission_mode, args.ofdm_total_threads,
+            args.ofdm_inline ? OFDM_Demod_Sync_Mode::INLINE :
+                args.ofdm_spin_park ? OFDM_Demod_Sync_Mode::SPIN_PARK : OFDM_Demod_Sync_Mode::BLOCKING,
+            ofdm_thread_config
+        );
         ofdm_output_splitter = std::make_shared<OutputSplitter<viterbi_bit_t>>();
         ofdm_block->set_output_stream(ofdm_output_splitter);
         auto& config = ofdm_block->get_ofdm_demod().GetConfig();
         config.sync.is_coarse_freq_correction = !args.ofdm_disable_coarse_freq;
+        config.idle.is_enabled = args.ofdm_idle_probing;
+#if BUILD_COMMAND_LINE
+        // there is no gui to show the FFTs of each frame so each symbol is processed in cache
+        ofdm_block->get_ofdm_demod().SetIsHeadless(true);
+        config.pipeline.is_fused_symbols = true;
+#endif
+        // Save our plans straight away so they are kept even if we don't exit cleanly
+        if (!args.fft_wisdom.empty() && !fft_export_wisdom(args.fft_wisdom.c_str())) {
+            fprintf(stderr, "Failed to save FFT wisdom to '%s'\n", args.fft_wisdom.c_str());
+        }
     }
     // setup radio
     std::shared_ptr<Basic_Radio_Block> radio_block = nullptr;
     if (args.is_dab_used) {
-        radio_block = std::make_shared<Basic_Radio_Block>(args.transmission_mode, args.radio_total_threads);
+        radio_block = std::make_shared<Basic_Radio_Block>(
+            args.transmission_mode, args.radio_total_threads, radio_thread_affinity
+        );
+        radio_block->get_basic_radio().SetPipelineDepth(args.radio_pipeline_depth);
+        radio_block->set_batch_frames(args.radio_batch_frames);
+        radio_block->get_basic_radio().SetIsBatchViterbi(args.radio_batch_viterbi);
+        radio_block->get_basic_radio().SetIsMultiCIFViterbi(args.radio_multi_cif_viterbi);
+        radio_block->get_basic_radio().SetIsQueuedPAD(args.radio_queued_pad);
+        radio_block->get_basic_radio().SetIsQueuedPacketData(args.radio_queued_packet_data);
+        radio_block->get_basic_radio().SetIsLowLatencyAAC(args.radio_low_latency_aac);
+        radio_block->get_basic_radio().SetMaxErrorPerBit(args.radio_max_error_per_bit);
+        radio_block->get_basic_radio().SetIsPackedCIFHistory(args.radio_packed_history);
+        radio_block->get_basic_radio().SetShard(args.radio_shard_index, args.radio_total_shards);
+        if (!memory_policy.IsDefault()) {
+            Memory_Policy cif_memory_policy = memory_policy;
+            cif_memory_policy.numa_node = radio_thread_affinity.numa_node;
+            radio_block->get_basic_radio().SetCIFHistoryMemoryPolicy(cif_memory_policy);
+        }
+        if (args.radio_standby_channels) {
+            radio_block->get_basic_radio().On_Audio_Channel().Attach(
+                [](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+                    channel.GetControls().SetIsStandby(true);
+                }
+            );
+        }
+        if (args.radio_low_complexity_aac) {
+            radio_block->get_basic_radio().On_Audio_Channel().Attach(
+                [](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+                    channel.GetControls().SetIsLowComplexity(true);
+                }
+            );
+        }
+    }
+    // slow frame capture
+    // NOTE: The IQ history covers the frames the demodulator can hold before one is caught being slow
+    std::shared_ptr<Slow_Frame_Capture> slow_frame_capture = nullptr;
+    if (!args.slow_frame_dir.empty()) {
+        Slow_Frame_Capture_Config config;
+        config.directory = args.slow_frame_dir;
+        config.threshold = (args.slow_frame_threshold_ms > 0.0f) ?
+            std::chrono::nanoseconds(int64_t(double(args.slow_frame_threshold_ms)*1e6)) :
+            std::chrono::nanoseconds(std::chrono::milliseconds(24*dab_params.nb_cifs));
+        config.max_captures = args.slow_frame_max_captures;
+        slow_frame_capture = std::make_shared<Slow_Frame_Capture>(config);
+        if (ofdm_block != nullptr) {
+            ofdm_block->get_ofdm_demod().On_Frame_Time().Attach([slow_frame_capture](float frame_seconds) {
+                slow_frame_capture->check_ofdm_frame(frame_seconds);
+            });
+        }
+        if (radio_block != nullptr) {
+            radio_block->on_frame().Attach(
+                [slow_frame_capture](BasicRadio&, tcb::span<const viterbi_bit_t> bits, std::chrono::nanoseconds process_time) {
+                    slow_frame_capture->check_radio_frame(bits, process_time);
+                }
+            );
+        }
     }
     // setup input
     std::shared_ptr<FileWrapper> file_in = nullptr;
+    std::shared_ptr<MappedFileReader> mapped_file_in = nullptr;
+    std::unique_ptr<DeviceManager> device_manager = nullptr;
+    std::vector<std::shared_ptr<Device_Reader>> device_readers;
     if (args.is_ofdm_used) {
-        auto raw_iq_in = std::make_shared<InputFile<RawIQ>>(fp_in);
+        std::shared_ptr<InputBuffer<RawIQ>> raw_iq_in = nullptr;
+        if (is_device_input) {
+            // one usb transfer per block which the demodulator reads in place
+            DeviceTransferConfig transfer_config;
+            transfer_config.transfer_size = 16*32*512;
+            auto device_reader = std::make_shared<Device_Reader>(size_t(transfer_config.transfer_size), args.device_total_blocks);
+            device_manager = std::make_unique<DeviceManager>(transfer_config);
+            device_manager->add_device(device_config, [device_reader](tcb::span<const uint8_t> buf) {
+                return device_reader->write(buf);
+            });
+            device_readers.push_back(device_reader);
+            raw_iq_in = device_reader;
+        } else {
+            raw_iq_in = create_input_file<RawIQ>(fp_in, mapped_fp_in, file_in, mapped_file_in);
+        }
+        if (slow_frame_capture != nullptr) {
+            const auto& ofdm_params = get_DAB_OFDM_tables(args.transmission_mode).params;
+            const size_t frame_length = ofdm_params.nb_null_period + ofdm_params.nb_symbol_period*ofdm_params.nb_frame_symbols;
+            const size_t total_history_frames = args.ofdm_ingest_frames + 4;
+            auto iq_history = std::make_shared<Slow_Frame_IQ_History>(raw_iq_in, total_history_frames*frame_length);
+            slow_frame_capture->set_iq_history(iq_history);
+            raw_iq_in = iq_history;
+        }
         auto ofdm_convert_raw_iq = std::make_shared<OFDM_Convert_RawIQ>();
         ofdm_convert_raw_iq->set_input_stream(raw_iq_in);
         ofdm_block->set_input_stream(ofdm_convert_raw_iq);
-        file_in = raw_iq_in;
     } else {
-        if (args.radio_input_hard_bytes) {
-            auto hard_bytes_in = std::make_shared<InputFile<uint8_t>>(fp_in);
+        if (is_input_recording) {
+            auto recording_in = std::make_shared<Recording_Reader>();
+            if (!recording_in->open(fp_in)) {
+                fprintf(stderr, "Input file isn't a valid recording: '%s'\n", args.input_file.c_str());
+                return 1;
+            }
+            if (recording_in->get_metadata().transmission_mode != args.transmission_mode) {
+                fprintf(stderr, "Recording uses transmission mode %d\n", recording_in->get_metadata().transmission_mode);
+                return 1;
+            }
+            if (!recording_in->seek_frame(args.radio_input_start_frame)) {
+                fprintf(stderr, "Start frame %llu is past the end of the recording with %llu frames\n",
+                    (unsigned long long)args.radio_input_start_frame, (unsigned long long)recording_in->get_total_frames());
+                return 1;
+            }
+            radio_block->set_input_stream(recording_in);
+        } else if (args.radio_input_hard_bytes) {
+            auto hard_bytes_in = create_input_file<uint8_t>(fp_in, mapped_fp_in, file_in, mapped_file_in);
             auto convert_viterbi_hard_to_soft = std::make_shared<Convert_Viterbi_Bytes_to_Bits>();
             convert_viterbi_hard_to_soft->set_input_stream(hard_bytes_in);
             radio_block->set_input_stream(convert_viterbi_hard_to_soft);
-            file_in = hard_bytes_in;
+        } else if (args.radio_input_packed) {
+            auto packed_in = create_input_file<uint8_t>(fp_in, mapped_fp_in, file_in, mapped_file_in);
+            auto convert_viterbi_packed_to_soft = std::make_shared<Convert_Viterbi_Packed_to_Bits>();
+            convert_viterbi_packed_to_soft->set_input_stream(packed_in);
+            radio_block->set_input_stream(convert_viterbi_packed_to_soft);
         } else {
-            auto soft_bits_in = std::make_shared<InputFile<viterbi_bit_t>>(fp_in);
+            auto soft_bits_in = create_input_file<viterbi_bit_t>(fp_in, mapped_fp_in, file_in, mapped_file_in);
             radio_block->set_input_stream(soft_bits_in);
-            file_in = soft_bits_in;
         }
     }
     // setup output
     std::shared_ptr<FileWrapper> file_out = nullptr;
+    std::shared_ptr<Recording_Writer> recording_out = nullptr;
     if (args.is_ofdm_used && args.ofdm_enable_output) {
-        if (args.ofdm_output_hard_bytes) {
+        if (args.ofdm_output_recording) {
+            Recording_Metadata metadata;
+            metadata.transmission_mode = args.transmission_mode;
+            metadata.frequency_hz = args.ofdm_output_frequency;
+            const auto bit_format =
+                args.ofdm_output_hard_bytes ? Recording_Bit_Format::HARD :
+                args.ofdm_output_packed ? Recording_Bit_Format::PACKED : Recording_Bit_Format::SOFT;
+            recording_out = std::make_shared<Recording_Writer>(fp_ofdm_out, metadata, bit_format, ofdm_output_compression);
+            ofdm_output_splitter->add_output_stream(recording_out);
+        } else if (args.ofdm_output_hard_bytes) {
             auto convert_viterbi_soft_to_hard = std::make_shared<Convert_Viterbi_Bytes_to_Bits>();
             auto hard_bytes_out = std::make_shared<OutputFile<uint8_t>>(fp_ofdm_out);
             ofdm_output_splitter->add_output_stream(convert_viterbi_soft_to_hard);
             convert_viterbi_soft_to_hard->set_output_stream(hard_bytes_out);
             file_out = hard_bytes_out;
+        } else if (args.ofdm_output_packed) {
+            auto convert_viterbi_soft_to_packed = std::make_shared<Convert_Viterbi_Packed_to_Bits>();
+            auto packed_out = std::make_shared<OutputFile<uint8_t>>(fp_ofdm_out);
+            ofdm_output_splitter->add_output_stream(convert_viterbi_soft_to_packed);
+            convert_viterbi_soft_to_packed->set_output_stream(packed_out);
+            file_out = packed_out;
         } else {
             auto soft_bits_out = std::make_shared<OutputFile<viterbi_bit_t>>(fp_ofdm_out);
             ofdm_output_splitter->add_output_stream(soft_bits_out);
@@ -295,21 +1083,113 @@ int main(int argc, char** argv) {
         }
     }
     // setup connection between ofdm to dab
-    std::shared_ptr<ThreadedRingBuffer<viterbi_bit_t>> ofdm_to_radio_buffer = nullptr;
+    std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> ofdm_to_radio_buffer = nullptr;
     if (args.is_ofdm_used && args.is_dab_used) {
-        ofdm_to_radio_buffer = std::make_shared<ThreadedRingBuffer<viterbi_bit_t>>(dab_params.nb_frame_bits*2);
-        ofdm_output_splitter->add_output_stream(ofdm_to_radio_buffer);
-        radio_block->set_input_stream(ofdm_to_radio_buffer);
+        constexpr size_t TOTAL_RING_FRAMES = 4;
+        // frames are only dropped for live devices since files and stdin can wait for the radio to catch up
+        const bool is_ring_blocking = !is_device_input;
+        if (args.ofdm_stream_cifs) {
+            // each slot holds either the FIC or a CIF
+            const size_t total_segments = size_t(dab_params.nb_cifs)+1;
+            const size_t segment_length = size_t(std::max(dab_params.nb_fic_bits, dab_params.nb_cif_bits));
+            ofdm_to_radio_buffer = std::make_shared<SPSC_Frame_Ring<viterbi_bit_t>>(segment_length, TOTAL_RING_FRAMES*total_segments);
+            const auto segment_symbols = radio_block->get_basic_radio().GetSegmentSymbols();
+            if (!ofdm_block->set_output_segment_ring(ofdm_to_radio_buffer, segment_symbols, is_ring_blocking)) {
+                fprintf(stderr, "OFDM demodulator can't be split into the FIC and CIFs of the radio\n");
+                return 1;
+            }
+            radio_block->set_input_segment_ring(ofdm_to_radio_buffer);
+        } else {
+            ofdm_to_radio_buffer = std::make_shared<SPSC_Frame_Ring<viterbi_bit_t>>(dab_params.nb_frame_bits, TOTAL_RING_FRAMES);
+            ofdm_block->get_ofdm_demod().SetFrameRing(ofdm_to_radio_buffer, is_ring_blocking);
+            radio_block->set_input_ring(ofdm_to_radio_buffer);
+        }
+        if (args.ofdm_skip_unused_symbols) {
+            radio_block->get_basic_radio().On_Symbol_Mask().Attach([ofdm_block](tcb::span<const uint8_t> mask) {
+                ofdm_block->get_ofdm_demod().SetDataSymbolMask(mask);
+            });
+        }
+    }
+    // shared memory
+    std::shared_ptr<SharedMemoryRingWriter> shm_writer = nullptr;
+    if (!args.shm_output.empty()) {
+        shm_writer = std::make_shared<SharedMemoryRingWriter>();
+        if (!shm_writer->create(args.shm_output, args.shm_slot_size, args.shm_total_slots)) {
+            fprintf(stderr, "Failed to create shared memory ring: '%s'\n", args.shm_output.c_str());
+            return 1;
+        }
+        fprintf(stderr, "publishing to shared memory ring '%s'\n", args.shm_output.c_str());
+        if (args.is_dab_used) {
+            attach_shared_memory_to_radio(shm_writer, radio_block->get_basic_radio(), args.shm_encoded_audio);
+        }
+        if (args.is_ofdm_used && args.shm_soft_bits) {
+            auto soft_bits_shm = std::make_shared<SharedMemoryOutput<viterbi_bit_t>>(shm_writer, SharedMemoryFrameType::SOFT_BITS);
+            ofdm_output_splitter->add_output_stream(soft_bits_shm);
+        }
+    }
+    // database snapshot
+    std::shared_ptr<Database_Snapshot_Writer> database_writer = nullptr;
+    if (args.is_dab_used && (!args.shm_database.empty() || !args.database_snapshot.empty())) {
+        database_writer = std::make_shared<Database_Snapshot_Writer>();
+        if (!args.shm_database.empty()) {
+            if (!database_writer->create(args.shm_database, args.shm_database_size)) {
+                fprintf(stderr, "Failed to create shared memory database: '%s'\n", args.shm_database.c_str());
+                return 1;
+            }
+            fprintf(stderr, "publishing database to shared memory '%s'\n", args.shm_database.c_str());
+        }
+        database_writer->set_filename(args.database_snapshot);
+        attach_database_writer_to_radio(database_writer, radio_block->get_basic_radio());
+    }
+    // restream
+    std::shared_ptr<Audio_Restream_Server> restream_server = nullptr;
+    if (args.is_dab_used && !args.restream_port.empty()) {
+        restream_server = std::make_shared<Audio_Restream_Server>(args.restream_ring_frames);
+        if (!restream_server->listen(args.restream_address, args.restream_port)) {
+            fprintf(stderr, "Failed to listen for restream clients on port '%s'\n", args.restream_port.c_str());
+            return 1;
+        }
+        fprintf(stderr, "restreaming encoded audio on port '%s'\n", args.restream_port.c_str());
+        attach_restream_server_to_radio(restream_server, radio_block->get_basic_radio());
+    }
+    // time shift
+    std::shared_ptr<Time_Shift_Recorder> time_shift_recorder = nullptr;
+    if (args.is_dab_used && !args.time_shift_dir.empty()) {
+        if (args.time_shift_seconds == 0) {
+            fprintf(stderr, "Time shift length must be at least one second\n");
+            return 1;
+        }
+        time_shift_recorder = std::make_shared<Time_Shift_Recorder>(args.time_shift_dir, args.time_shift_seconds);
+        time_shift_recorder->attach_to_radio(radio_block->get_basic_radio());
+        fprintf(stderr, "keeping %zu seconds of encoded audio in '%s'\n", args.time_shift_seconds, args.time_shift_dir.c_str());
+    }
+    // event server
+    std::shared_ptr<Radio_Event_Server> event_server = nullptr;
+    if (args.is_dab_used && !args.event_port.empty()) {
+        event_server = std::make_shared<Radio_Event_Server>(std::chrono::milliseconds(args.event_interval_ms));
+        if (!event_server->listen(args.event_address, args.event_port)) {
+            fprintf(stderr, "Failed to listen for event clients on port '%s'\n", args.event_port.c_str());
+            return 1;
+        }
+        fprintf(stderr, "serving radio events on port '%s'\n", args.event_port.c_str());
+        attach_event_server_to_radio(event_server, radio_block->get_basic_radio());
     }
     // scraper
     if (args.is_dab_used && args.scraper_enable) {
-        auto basic_scraper = std::make_shared<BasicScraper>(args.scraper_output);
+        auto basic_scraper = std::make_shared<BasicScraper>(args.scraper_output, args.scraper_encoded_only);
+        basic_scraper->SetIsArchive(args.scraper_archive);
+        Basic_Scraper_Rotation_Settings rotation;
+        rotation.interval = std::chrono::minutes(std::max(args.scraper_rotate_minutes, 0));
+        rotation.max_bytes = size_t(std::max(args.scraper_rotate_mb, 0)) << 20;
+        basic_scraper->SetRotation(rotation);
         fprintf(stderr, "basic scraper is writing to folder '%s'\n", args.scraper_output.c_str()); 
         BasicScraper::attach_to_radio(basic_scraper, radio_block->get_basic_radio());
+        const bool is_decode_audio = !args.scraper_encoded_only;
         radio_block->get_basic_radio().On_Audio_Channel().Attach(
-            [](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            [is_decode_audio](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
                 auto& controls = channel.GetControls();
-                controls.SetIsDecodeAudio(true);
+                controls.SetIsEncodedAudio(true);
+                controls.SetIsDecodeAudio(is_decode_audio);
                 controls.SetIsDecodeData(true);
                 controls.SetIsPlayAudio(false);
             }
@@ -380,14 +1260,57 @@ int main(int argc, char** argv) {
         }
     };
 #endif
+    // load shedding
+    // NOTE: Attached after the channel callbacks so the controls they enable are the ones that are shed
+    std::shared_ptr<Radio_Load_Shedder> load_shedder = nullptr;
+    if (args.is_dab_used && args.radio_load_shedding) {
+        Load_Shedder_Config config;
+        config.frame_period = std::chrono::milliseconds(24*dab_params.nb_cifs);
+        load_shedder = std::make_shared<Radio_Load_Shedder>(radio_block->get_basic_radio(), config);
+        radio_block->on_frame().Attach([load_shedder](BasicRadio&, tcb::span<const viterbi_bit_t>, std::chrono::nanoseconds process_time) {
+            load_shedder->update(process_time);
+        });
+    }
+    // checkpoint
+    // NOTE: Restored after the channel callbacks are attached so the restored channels are configured the same way
+    const auto save_checkpoint = [ofdm_block, checkpoint_filename = args.radio_checkpoint](BasicRadio& radio) {
+        App_Radio_Checkpoint checkpoint;
+        checkpoint.radio = radio.GetCheckpoint();
+        if (ofdm_block != nullptr) checkpoint.acquisition = ofdm_block->get_ofdm_demod().GetAcquisition();
+        save_radio_checkpoint(checkpoint_filename, checkpoint);
+    };
+    if (args.is_dab_used && !args.radio_checkpoint.empty()) {
+        const auto checkpoint = load_radio_checkpoint(args.radio_checkpoint);
+        if (checkpoint.has_value()) {
+            radio_block->get_basic_radio().RestoreCheckpoint(checkpoint->radio);
+            if (ofdm_block != nullptr) ofdm_block->get_ofdm_demod().SetAcquisitionSeed(checkpoint->acquisition);
+        }
+        if (args.radio_checkpoint_interval > 0) {
+            radio_block->on_frame().Attach(
+                [save_checkpoint, interval = args.radio_checkpoint_interval, total_frames = size_t(0)]
+                (BasicRadio& radio, tcb::span<const viterbi_bit_t>, std::chrono::nanoseconds) mutable {
+                    total_frames++;
+                    if ((total_frames % interval) != 0) return;
+                    save_checkpoint(radio);
+                }
+            );
+        }
+    }
     // threads
+    if (device_manager != nullptr) {
+        device_manager->start();
+    }
     std::unique_ptr<std::thread> thread_ofdm = nullptr;
     if (args.is_ofdm_used) {
         const size_t block_size = args.ofdm_block_size;
         thread_ofdm = std::make_unique<std::thread>([ofdm_block, block_size, ofdm_to_radio_buffer]() {
             ofdm_block->run(block_size);
             fprintf(stderr, "ofdm thread finished\n");
-            if (ofdm_to_radio_buffer != nullptr) ofdm_to_radio_buffer->close();
+            if (ofdm_to_radio_buffer != nullptr) {
+                const size_t total_dropped = ofdm_to_radio_buffer->get_total_dropped();
+                if (total_dropped > 0) fprintf(stderr, "radio dropped %zu ofdm frames\n", total_dropped);
+                ofdm_to_radio_buffer->close();
+            }
         });
     }
     std::unique_ptr<std::thread> thread_radio = nullptr;
@@ -406,15 +1329,57 @@ int main(int argc, char** argv) {
         });
     }
 #endif
+    const auto report_thread_affinity_errors = [&ofdm_block, &radio_block]() {
+        const int total_ofdm_errors = ofdm_block ? ofdm_block->get_ofdm_demod().GetTotalThreadConfigErrors() : 0;
+        const int total_radio_errors = radio_block ? radio_block->get_basic_radio().GetTotalThreadAffinityErrors() : 0;
+        if ((total_ofdm_errors > 0) || (total_radio_errors > 0)) {
+            fprintf(stderr, "Failed to apply thread affinity or priority to %d ofdm and %d radio threads\n", 
+                total_ofdm_errors, total_radio_errors);
+        }
+    };
+    const auto close_device_input = [&device_manager, &device_readers]() {
+        if (device_manager == nullptr) return;
+        device_manager->stop();
+        print_managed_device_status(*device_manager, device_readers);
+        for (auto& reader: device_readers) reader->close();
+    };
+    const auto report_slow_frames = [&slow_frame_capture]() {
+        if (slow_frame_capture == nullptr) return;
+        print_frame_tail_latencies(stderr);
+        fprintf(stderr, "captured %zu slow frames and skipped %zu\n",
+            slow_frame_capture->get_total_captures(), slow_frame_capture->get_total_skipped());
+    };
+    const auto report_load_shedding = [&load_shedder]() {
+        if (load_shedder == nullptr) return;
+        const auto status = load_shedder->get_status();
+        if (status.total_shed == 0) return;
+        fprintf(stderr, "radio shed load %zu times and restored it %zu times, final level is %s\n",
+            status.total_shed, status.total_restored, get_load_shed_level_string(status.level));
+    };
+    const auto close_recording_out = [&recording_out, &radio_block]() {
+        if (recording_out == nullptr) return;
+        if (radio_block != nullptr) {
+            const auto database = radio_block->get_basic_radio().GetDatabaseSnapshot();
+            recording_out->set_ensemble(database->ensemble.reference, std::string(database->ensemble.label.view()));
+        }
+        recording_out->close();
+    };
     // shutdown
 #if !BUILD_COMMAND_LINE
     const int gui_retval = render_common_gui_blocking(gui);
     if (thread_select_default_audio != nullptr) thread_select_default_audio->join();
     if (file_in != nullptr) file_in->close();
+    if (mapped_file_in != nullptr) mapped_file_in->close();
+    close_device_input();
     if (file_out != nullptr) file_out->close();
     if (thread_ofdm != nullptr) thread_ofdm->join();
     if (ofdm_to_radio_buffer != nullptr) ofdm_to_radio_buffer->close();
     if (thread_radio != nullptr) thread_radio->join();
+    if ((radio_block != nullptr) && !args.radio_checkpoint.empty()) save_checkpoint(radio_block->get_basic_radio());
+    close_recording_out();
+    report_thread_affinity_errors();
+    report_load_shedding();
+    report_slow_frames();
     ofdm_block = nullptr;
     radio_block = nullptr;
     portaudio_threaded_actions = nullptr;
@@ -424,10 +1389,17 @@ int main(int argc, char** argv) {
     return gui_retval;
 #else
     if (thread_ofdm != nullptr) thread_ofdm->join();
+    close_device_input();
     if (ofdm_to_radio_buffer != nullptr) ofdm_to_radio_buffer->close();
     if (thread_radio != nullptr) thread_radio->join();
+    if ((radio_block != nullptr) && !args.radio_checkpoint.empty()) save_checkpoint(radio_block->get_basic_radio());
+    close_recording_out();
     if (file_in != nullptr) file_in->close();
+    if (mapped_file_in != nullptr) mapped_file_in->close();
     if (file_out != nullptr) file_out->close();
+    report_thread_affinity_errors();
+    report_load_shedding();
+    report_slow_frames();
     ofdm_block = nullptr;
     radio_block = nullptr;
     return 0;
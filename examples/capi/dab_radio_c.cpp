@@ -0,0 +1,393 @@
+#include "./dab_radio_c.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "utility/span.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_updater.h"
+#include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_audio_buffer.h"
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_dab_channel.h"
+#include "basic_radio/basic_dab_plus_channel.h"
+#include "viterbi_config.h"
+#include "../app_helpers/app_logging.h"
+
+// Bounded ring of events and their data which is filled by the decoder threads and drained by dab_radio_poll()
+// Event data is stored back to back in one preallocated block so pushing an event never allocates
+// Events handed out by a poll keep their slots and data until the next poll so the caller can read them in place
+class Event_Ring
+{
+private:
+    struct Slot {
+        dab_radio_event_t event;
+        size_t data_offset;
+        // position of the data writer after this event which is where the reader moves to once it is released
+        uint64_t data_end;
+    };
+    std::mutex m_mutex;
+    std::vector<Slot> m_slots;
+    uint64_t m_slot_write = 0;
+    uint64_t m_slot_read = 0;
+    size_t m_total_polled = 0;
+    std::vector<uint8_t> m_data;
+    uint64_t m_data_write = 0;
+    uint64_t m_data_read = 0;
+    uint64_t m_sequence = 0;
+    uint64_t m_total_dropped = 0;
+    uint64_t m_total_unreported_dropped = 0;
+public:
+    Event_Ring(const size_t max_events, const size_t max_data_bytes)
+    : m_slots(max_events), m_data(max_data_bytes) {}
+    // The data is the concatenation of header and body
+    void Push(dab_radio_event_t event, tcb::span<const uint8_t> header, tcb::span<const uint8_t> body) {
+        const size_t N = header.size() + body.size();
+        auto lock = std::scoped_lock(m_mutex);
+        event.sequence = m_sequence++;
+        const size_t C = m_data.size();
+        const size_t position = (C > 0) ? size_t(m_data_write % C) : 0;
+        // data doesn't wrap around so it can be read in place
+        const size_t padding = (position + N > C) ? (C - position) : 0;
+        const bool is_slot_free = (m_slot_write - m_slot_read) < m_slots.size();
+        const bool is_data_free = (N <= C) && ((m_data_write - m_data_read) + padding + N <= C);
+        if (!is_slot_free || !is_data_free) {
+            m_total_dropped++;
+            m_total_unreported_dropped++;
+            return;
+        }
+        m_data_write += padding;
+        const size_t offset = (C > 0) ? size_t(m_data_write % C) : 0;
+        if (!header.empty()) memcpy(m_data.data() + offset, header.data(), header.size());
+        if (!body.empty()) memcpy(m_data.data() + offset + header.size(), body.data(), body.size());
+        m_data_write += N;
+        auto& slot = m_slots[size_t(m_slot_write % m_slots.size())];
+        event.data = nullptr;
+        event.data_size = uint32_t(N);
+        slot.event = event;
+        slot.data_offset = offset;
+        slot.data_end = m_data_write;
+        m_slot_write++;
+    }
+    size_t Poll(dab_radio_event_t* events, const size_t max_events) {
+        auto lock = std::scoped_lock(m_mutex);
+        // release the events of the previous poll
+        if (m_total_polled > 0) {
+            m_slot_read += m_total_polled;
+            m_data_read = m_slots[size_t((m_slot_read-1) % m_slots.size())].data_end;
+            m_total_polled = 0;
+        }
+        size_t total_events = 0;
+        if ((total_events < max_events) && (m_total_unreported_dropped > 0)) {
+            static const std::string_view message = "Events were dropped since the ring was full";
+            dab_radio_event_t& event = events[total_events++];
+            event = dab_radio_event_t{};
+            event.type = DAB_RADIO_EVENT_ERROR;
+            event.sequence = m_sequence;
+            event.error_code = DAB_RADIO_ERROR_CODE_EVENTS_DROPPED;
+            event.error_count = uint32_t(std::min(m_total_unreported_dropped, uint64_t(UINT32_MAX)));
+            event.data = reinterpret_cast<const uint8_t*>(message.data());
+            event.data_size = uint32_t(message.size());
+            m_total_unreported_dropped = 0;
+        }
+        while ((total_events < max_events) && (m_slot_read + m_total_polled < m_slot_write)) {
+            const auto& slot = m_slots[size_t((m_slot_read + m_total_polled) % m_slots.size())];
+            dab_radio_event_t& event = events[total_events++];
+            event = slot.event;
+            event.data = (event.data_size > 0) ? (m_data.data() + slot.data_offset) : nullptr;
+            m_total_polled++;
+        }
+        return total_events;
+    }
+    uint64_t GetTotalDropped() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_total_dropped;
+    }
+};
+
+static tcb::span<const uint8_t> get_bytes(std::string_view x) {
+    return { reinterpret_cast<const uint8_t*>(x.data()), x.size() };
+}
+
+static dab_radio_event_t create_error_event(const dab_radio_error_code_t code, const uint32_t count) {
+    dab_radio_event_t event{};
+    event.type = DAB_RADIO_EVENT_ERROR;
+    event.error_code = code;
+    event.error_count = count;
+    return event;
+}
+
+// 16bit samples are scaled to the range of 8bit samples that the demodulator expects
+constexpr float S16_SCALE = 1.0f/256.0f;
+constexpr size_t CONVERT_BLOCK_SIZE = 16384;
+
+struct dab_radio {
+    dab_radio_config_t config;
+    // destroyed after the radio and demodulator which push into it
+    Event_Ring events;
+    std::unique_ptr<BasicRadio> radio;
+    std::unique_ptr<OFDM_Demod> demod;
+    std::vector<std::complex<float>> convert_buffer;
+    int total_frames_desync = 0;
+
+    explicit dab_radio(const dab_radio_config_t& _config)
+    : config(_config), events(_config.max_events, _config.max_event_data_bytes)
+    {
+        radio = std::make_unique<BasicRadio>(get_dab_parameters(config.transmission_mode), size_t(config.total_radio_threads));
+        const auto& tables = get_DAB_OFDM_tables(config.transmission_mode);
+        demod = std::make_unique<OFDM_Demod>(tables.params, tables.prs_fft_ref, tables.carrier_mapper, config.total_ofdm_threads);
+        auto* radio_ptr = radio.get();
+        demod->On_OFDM_Frame().Attach([radio_ptr](tcb::span<const viterbi_bit_t> bits) {
+            radio_ptr->Process(bits);
+        });
+        radio->On_Database_Changes().Attach([this](tcb::span<const DatabaseChange> changes) {
+            OnDatabaseChanges(changes);
+        });
+        radio->On_Audio_Channel().Attach([this](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            OnAudioChannel(uint32_t(subchannel_id), channel);
+        });
+    }
+    // NOTE: This is called with the radio's mutex held so its database can be read
+    void OnDatabaseChanges(tcb::span<const DatabaseChange> changes) {
+        const auto& db = radio->GetDatabase();
+        for (const auto& change: changes) {
+            dab_radio_event_t event{};
+            event.type = DAB_RADIO_EVENT_DATABASE_CHANGE;
+            event.change_type = uint32_t(change.change_type);
+            event.entity_index = uint32_t(change.index);
+            std::string_view label;
+            switch (change.entity_type) {
+            case DatabaseEntityType::ENSEMBLE:
+                event.entity_type = DAB_RADIO_ENTITY_ENSEMBLE;
+                event.entity_id = uint32_t(db.ensemble.reference);
+                label = db.ensemble.label.view();
+                break;
+            case DatabaseEntityType::SERVICE:
+                event.entity_type = DAB_RADIO_ENTITY_SERVICE;
+                if (change.index < db.services.size()) {
+                    const auto& service = db.services[change.index];
+                    event.entity_id = uint32_t(service.reference);
+                    label = service.label.view();
+                }
+                break;
+            case DatabaseEntityType::SERVICE_COMPONENT:
+                event.entity_type = DAB_RADIO_ENTITY_SERVICE_COMPONENT;
+                if (change.index < db.service_components.size()) {
+                    const auto& component = db.service_components[change.index];
+                    event.entity_id = uint32_t(component.service_reference);
+                    event.subchannel_id = uint32_t(component.subchannel_id);
+                    label = component.label.view();
+                }
+                break;
+            case DatabaseEntityType::SUBCHANNEL:
+                event.entity_type = DAB_RADIO_ENTITY_SUBCHANNEL;
+                if (change.index < db.subchannels.size()) {
+                    event.entity_id = uint32_t(db.subchannels[change.index].id);
+                    event.subchannel_id = event.entity_id;
+                }
+                break;
+            default:
+                event.entity_type = DAB_RADIO_ENTITY_OTHER;
+                break;
+            }
+            events.Push(event, {}, get_bytes(label));
+        }
+    }
+    void OnAudioChannel(const uint32_t id, Basic_Audio_Channel& channel) {
+        auto& controls = channel.GetControls();
+        controls.SetIsDecodeAudio(config.is_pcm_audio != 0);
+        controls.SetIsEncodedAudio(config.is_encoded_audio != 0);
+        controls.SetIsDecodeData(config.is_dynamic_labels != 0);
+        if (config.is_pcm_audio) {
+            channel.OnAudioBuffer().Attach([this, id](const Basic_Audio_Buffer_Ref& buffer) {
+                dab_radio_event_t event{};
+                event.type = DAB_RADIO_EVENT_PCM;
+                event.subchannel_id = id;
+                event.sample_rate = buffer->params.frequency;
+                event.is_stereo = buffer->params.is_stereo ? 1 : 0;
+                events.Push(event, {}, buffer->GetData());
+            });
+        }
+        if (config.is_dynamic_labels) {
+            channel.OnDynamicLabel().Attach([this, id](std::string_view label) {
+                dab_radio_event_t event{};
+                event.type = DAB_RADIO_EVENT_DYNAMIC_LABEL;
+                event.subchannel_id = id;
+                events.Push(event, {}, get_bytes(label));
+            });
+        }
+        if (!config.is_encoded_audio) return;
+        if (channel.GetType() == AudioServiceType::DAB_PLUS) {
+            auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+            derived.OnAACData().Attach([this, id](auto superframe_header, auto mpeg4_header, auto buf) {
+                (void)superframe_header;
+                dab_radio_event_t event{};
+                event.type = DAB_RADIO_EVENT_AAC_AU;
+                event.subchannel_id = id;
+                events.Push(event, mpeg4_header, buf);
+            });
+        } else {
+            auto& derived = dynamic_cast<Basic_DAB_Channel&>(channel);
+            derived.OnMP2Data().Attach([this, id](tcb::span<const uint8_t> data) {
+                dab_radio_event_t event{};
+                event.type = DAB_RADIO_EVENT_MP2_FRAME;
+                event.subchannel_id = id;
+                events.Push(event, {}, data);
+            });
+        }
+    }
+    void CheckDesync() {
+        const int total = demod->GetTotalFramesDesync();
+        if (total <= total_frames_desync) return;
+        static const std::string_view message = "OFDM demodulator lost synchronisation";
+        events.Push(create_error_event(DAB_RADIO_ERROR_CODE_OFDM_DESYNC, uint32_t(total - total_frames_desync)), {}, get_bytes(message));
+        total_frames_desync = total;
+    }
+};
+
+// The library is the final binary so it owns the logger storage
+INITIALIZE_EASYLOGGINGPP
+
+extern "C" {
+
+uint32_t dab_radio_get_api_version(void) {
+    return DAB_RADIO_C_API_VERSION;
+}
+
+void dab_radio_config_init(dab_radio_config_t* config) {
+    if (config == nullptr) return;
+    *config = dab_radio_config_t{};
+    config->struct_size = uint32_t(sizeof(dab_radio_config_t));
+    config->transmission_mode = 1;
+    config->total_ofdm_threads = 0;
+    config->total_radio_threads = 0;
+    config->max_events = 4096;
+    config->max_event_data_bytes = uint32_t(4) << 20;
+    config->is_pcm_audio = 0;
+    config->is_encoded_audio = 1;
+    config->is_dynamic_labels = 1;
+}
+
+dab_radio_t* dab_radio_create(const dab_radio_config_t* user_config) {
+    if (user_config == nullptr) return nullptr;
+    // fields that an older caller doesn't know about keep their defaults
+    dab_radio_config_t config;
+    dab_radio_config_init(&config);
+    const size_t total_bytes = std::min(size_t(user_config->struct_size), sizeof(config));
+    if (total_bytes < sizeof(uint32_t)) return nullptr;
+    memcpy(&config, user_config, total_bytes);
+    if ((config.transmission_mode < 1) || (config.transmission_mode > 4)) return nullptr;
+    if ((config.total_ofdm_threads < 0) || (config.total_radio_threads < 0)) return nullptr;
+    if (config.max_events == 0) return nullptr;
+    try {
+        static std::once_flag logging_flag;
+        std::call_once(logging_flag, []() { setup_easylogging(false, false, false); });
+        return new dab_radio(config);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void dab_radio_destroy(dab_radio_t* radio) {
+    delete radio;
+}
+
+int dab_radio_process_iq(dab_radio_t* radio, const void* data, size_t total_bytes, dab_radio_iq_format_t format) {
+    if ((radio == nullptr) || ((data == nullptr) && (total_bytes > 0))) return DAB_RADIO_ERROR_INVALID_ARGUMENT;
+    try {
+        switch (format) {
+        case DAB_RADIO_IQ_U8:
+            if (total_bytes % sizeof(RawIQ_u8) != 0) return DAB_RADIO_ERROR_INVALID_SIZE;
+            radio->demod->Process(tcb::span<const RawIQ_u8>(reinterpret_cast<const RawIQ_u8*>(data), total_bytes/sizeof(RawIQ_u8)));
+            break;
+        case DAB_RADIO_IQ_S8:
+            if (total_bytes % sizeof(RawIQ_s8) != 0) return DAB_RADIO_ERROR_INVALID_SIZE;
+            radio->demod->Process(tcb::span<const RawIQ_s8>(reinterpret_cast<const RawIQ_s8*>(data), total_bytes/sizeof(RawIQ_s8)));
+            break;
+        case DAB_RADIO_IQ_S16:
+            {
+                if (total_bytes % sizeof(RawIQ_s16) != 0) return DAB_RADIO_ERROR_INVALID_SIZE;
+                if (reinterpret_cast<uintptr_t>(data) % alignof(int16_t) != 0) return DAB_RADIO_ERROR_INVALID_ARGUMENT;
+                const auto x = tcb::span<const int16_t>(reinterpret_cast<const int16_t*>(data), total_bytes/sizeof(int16_t));
+                Raw_IQ_Correction correction;
+                correction.gain = { S16_SCALE, S16_SCALE };
+                radio->convert_buffer.resize(CONVERT_BLOCK_SIZE);
+                const size_t total_samples = x.size()/2;
+                for (size_t i = 0; i < total_samples; i += CONVERT_BLOCK_SIZE) {
+                    const size_t N = std::min(CONVERT_BLOCK_SIZE, total_samples-i);
+                    auto y = tcb::span(radio->convert_buffer).first(N);
+                    convert_raw_iq_auto(x.subspan(2*i, 2*N), y, 0.0f, correction);
+                    radio->demod->Process(tcb::span<const std::complex<float>>(y));
+                }
+            }
+            break;
+        case DAB_RADIO_IQ_F32:
+            if (total_bytes % sizeof(std::complex<float>) != 0) return DAB_RADIO_ERROR_INVALID_SIZE;
+            if (reinterpret_cast<uintptr_t>(data) % alignof(float) != 0) return DAB_RADIO_ERROR_INVALID_ARGUMENT;
+            radio->demod->Process(tcb::span<const std::complex<float>>(
+                reinterpret_cast<const std::complex<float>*>(data), total_bytes/sizeof(std::complex<float>)));
+            break;
+        default:
+            return DAB_RADIO_ERROR_INVALID_FORMAT;
+        }
+        radio->CheckDesync();
+    } catch (const std::bad_alloc&) {
+        return DAB_RADIO_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        return DAB_RADIO_ERROR_INTERNAL;
+    }
+    return DAB_RADIO_OK;
+}
+
+int dab_radio_process_soft_bits(dab_radio_t* radio, const int8_t* bits, size_t total_bits) {
+    if ((radio == nullptr) || ((bits == nullptr) && (total_bits > 0))) return DAB_RADIO_ERROR_INVALID_ARGUMENT;
+    const size_t frame_bits = size_t(get_dab_parameters(radio->config.transmission_mode).nb_frame_bits);
+    if (total_bits % frame_bits != 0) return DAB_RADIO_ERROR_INVALID_SIZE;
+    try {
+        for (size_t i = 0; i < total_bits; i += frame_bits) {
+            radio->radio->Process({ reinterpret_cast<const viterbi_bit_t*>(bits + i), frame_bits });
+        }
+    } catch (const std::bad_alloc&) {
+        return DAB_RADIO_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        return DAB_RADIO_ERROR_INTERNAL;
+    }
+    return DAB_RADIO_OK;
+}
+
+int dab_radio_flush(dab_radio_t* radio) {
+    if (radio == nullptr) return DAB_RADIO_ERROR_INVALID_ARGUMENT;
+    try {
+        radio->demod->Flush();
+        radio->radio->Flush();
+        radio->CheckDesync();
+    } catch (...) {
+        return DAB_RADIO_ERROR_INTERNAL;
+    }
+    return DAB_RADIO_OK;
+}
+
+size_t dab_radio_poll(dab_radio_t* radio, dab_radio_event_t* events, size_t max_events) {
+    if ((radio == nullptr) || (events == nullptr)) return 0;
+    return radio->events.Poll(events, max_events);
+}
+
+uint64_t dab_radio_get_total_dropped_events(const dab_radio_t* radio) {
+    if (radio == nullptr) return 0;
+    return const_cast<dab_radio_t*>(radio)->events.GetTotalDropped();
+}
+
+}
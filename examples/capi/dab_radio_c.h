@@ -0,0 +1,150 @@
+#ifndef DAB_RADIO_C_H
+#define DAB_RADIO_C_H
+
+/*
+ * C API of the OFDM demodulator and radio for embedding in other languages (Go, Rust, etc)
+ * - IQ samples are given in large batches with dab_radio_process_iq()
+ * - Decoded results are queued as events in a preallocated ring and drained in bulk with dab_radio_poll()
+ *   so there is one call across the FFI boundary per batch instead of a callback per event
+ * - The ring is bounded. Events that don't fit are dropped and counted (see dab_radio_get_total_dropped_events())
+ * NOTE: A dab_radio_t must only be used by one thread at a time
+ *       The config starts with struct_size so fields can be appended without breaking older callers
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #if defined(DAB_RADIO_C_BUILD)
+        #define DAB_RADIO_C_EXPORT __declspec(dllexport)
+    #else
+        #define DAB_RADIO_C_EXPORT __declspec(dllimport)
+    #endif
+#else
+    #define DAB_RADIO_C_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented when a function or struct changes incompatibly */
+#define DAB_RADIO_C_API_VERSION 1
+
+typedef struct dab_radio dab_radio_t;
+
+typedef enum {
+    DAB_RADIO_OK = 0,
+    DAB_RADIO_ERROR_INVALID_ARGUMENT = -1,
+    DAB_RADIO_ERROR_INVALID_FORMAT = -2,
+    DAB_RADIO_ERROR_INVALID_SIZE = -3,
+    DAB_RADIO_ERROR_OUT_OF_MEMORY = -4,
+    DAB_RADIO_ERROR_INTERNAL = -5
+} dab_radio_result_t;
+
+typedef enum {
+    DAB_RADIO_IQ_U8 = 0,    /* interleaved unsigned 8bit IQ (rtl-sdr) */
+    DAB_RADIO_IQ_S8 = 1,    /* interleaved signed 8bit IQ (HackRF) */
+    DAB_RADIO_IQ_S16 = 2,   /* interleaved signed 16bit IQ */
+    DAB_RADIO_IQ_F32 = 3    /* interleaved 32bit float IQ in the range of 8bit samples */
+} dab_radio_iq_format_t;
+
+typedef enum {
+    /* data = AAC access unit with an ADTS header */
+    DAB_RADIO_EVENT_AAC_AU = 0,
+    /* data = MPEG-1/2 audio layer II frame */
+    DAB_RADIO_EVENT_MP2_FRAME = 1,
+    /* data = interleaved int16 PCM, see sample_rate and is_stereo */
+    DAB_RADIO_EVENT_PCM = 2,
+    /* data = UTF-8 dynamic label without a null terminator */
+    DAB_RADIO_EVENT_DYNAMIC_LABEL = 3,
+    /* see entity_type, change_type, entity_index and entity_id. data = label of the entity if it has one */
+    DAB_RADIO_EVENT_DATABASE_CHANGE = 4,
+    /* see error_code and error_count. data = description of the error */
+    DAB_RADIO_EVENT_ERROR = 5
+} dab_radio_event_type_t;
+
+typedef enum {
+    DAB_RADIO_ENTITY_ENSEMBLE = 0,
+    DAB_RADIO_ENTITY_SERVICE = 1,
+    DAB_RADIO_ENTITY_SERVICE_COMPONENT = 2,
+    DAB_RADIO_ENTITY_SUBCHANNEL = 3,
+    DAB_RADIO_ENTITY_OTHER = 4
+} dab_radio_entity_type_t;
+
+typedef enum {
+    DAB_RADIO_CHANGE_CREATED = 0,
+    DAB_RADIO_CHANGE_UPDATED = 1,
+    DAB_RADIO_CHANGE_COMPLETED = 2
+} dab_radio_change_type_t;
+
+typedef enum {
+    /* error_count events were dropped since the ring was full */
+    DAB_RADIO_ERROR_CODE_EVENTS_DROPPED = 1,
+    /* error_count frames lost synchronisation in the demodulator */
+    DAB_RADIO_ERROR_CODE_OFDM_DESYNC = 2
+} dab_radio_error_code_t;
+
+typedef struct {
+    uint32_t struct_size;
+    /* DAB transmission mode from 1 to 4 */
+    int32_t transmission_mode;
+    /* 0 uses one thread per core */
+    int32_t total_ofdm_threads;
+    int32_t total_radio_threads;
+    /* maximum number of events in the ring */
+    uint32_t max_events;
+    /* bytes of event data in the ring */
+    uint32_t max_event_data_bytes;
+    /* which events audio channels produce (0 or 1) */
+    int32_t is_pcm_audio;
+    int32_t is_encoded_audio;
+    int32_t is_dynamic_labels;
+} dab_radio_config_t;
+
+/* NOTE: Fields are only changed along with DAB_RADIO_C_API_VERSION since callers allocate arrays of these */
+typedef struct {
+    /* dab_radio_event_type_t */
+    uint32_t type;
+    /* increments by one for each event so gaps show where events were dropped */
+    uint64_t sequence;
+    /* audio and label events */
+    uint32_t subchannel_id;
+    uint32_t sample_rate;
+    uint32_t is_stereo;
+    /* database change events */
+    uint32_t entity_type;
+    uint32_t change_type;
+    uint32_t entity_index;
+    /* service reference, subchannel id or ensemble reference */
+    uint32_t entity_id;
+    /* error events */
+    int32_t error_code;
+    uint32_t error_count;
+    /* NOTE: Only valid until the next call to dab_radio_poll() or dab_radio_destroy() */
+    const uint8_t* data;
+    uint32_t data_size;
+} dab_radio_event_t;
+
+DAB_RADIO_C_EXPORT uint32_t dab_radio_get_api_version(void);
+/* Fills in the default configuration */
+DAB_RADIO_C_EXPORT void dab_radio_config_init(dab_radio_config_t* config);
+/* Returns NULL if the configuration is invalid or memory couldn't be allocated */
+DAB_RADIO_C_EXPORT dab_radio_t* dab_radio_create(const dab_radio_config_t* config);
+DAB_RADIO_C_EXPORT void dab_radio_destroy(dab_radio_t* radio);
+/* total_bytes must be a whole number of samples of the format */
+DAB_RADIO_C_EXPORT int dab_radio_process_iq(dab_radio_t* radio, const void* data, size_t total_bytes, dab_radio_iq_format_t format);
+/* Soft bits of whole OFDM frames for when the demodulator runs elsewhere */
+DAB_RADIO_C_EXPORT int dab_radio_process_soft_bits(dab_radio_t* radio, const int8_t* bits, size_t total_bits);
+/* Blocks until the samples given so far are demodulated and decoded */
+DAB_RADIO_C_EXPORT int dab_radio_flush(dab_radio_t* radio);
+/* Copies up to max_events of the oldest events and returns how many were copied
+ * The data of the previous poll is released so it must not be used afterwards */
+DAB_RADIO_C_EXPORT size_t dab_radio_poll(dab_radio_t* radio, dab_radio_event_t* events, size_t max_events);
+DAB_RADIO_C_EXPORT uint64_t dab_radio_get_total_dropped_events(const dab_radio_t* radio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
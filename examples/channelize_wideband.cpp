@@ -0,0 +1,370 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utility/span.h"
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "ofdm/dsp/iq_resampler.h"
+#include "ofdm/dsp/wideband_channelizer.h"
+#include "./block_frequencies.h"
+#if APP_USE_SOAPYSDR
+#include "./device/soapy_source.h"
+#endif
+
+constexpr uint32_t DAB_SAMPLING_RATE = 2'048'000;
+constexpr float RAW_IQ_BIAS = 127.5f;
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-i", "--input")
+        .default_value(std::string(""))
+        .metavar("INPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of the wideband IQ input (defaults to stdin)");
+    parser.add_argument("-s", "--sampling-rate")
+        .default_value(float(10'240'000)).scan<'g', float>()
+        .metavar("SAMPLING_RATE")
+        .nargs(1).required()
+        .help("Sampling rate of the wideband input in Hz (must be a multiple of 1kHz unless it is resampled)");
+    parser.add_argument("-f", "--frequency")
+        .default_value(float(0.0f)).scan<'g', float>()
+        .metavar("FREQUENCY")
+        .nargs(1).required()
+        .help("Centre frequency of the wideband input in Hz");
+    parser.add_argument("-c", "--channel")
+        .metavar("BLOCK:OUTPUT_FILENAME")
+        .append().required()
+        .help("DAB block to extract and the file it is written to as 2.048MHz 8bit IQ, e.g. 5A:dab_5a");
+    parser.add_argument("--input-format")
+        .default_value(std::string("u8"))
+        .choices("u8", "s8", "s16")
+        .metavar("FORMAT")
+        .nargs(1).required()
+        .help("IQ samples are unsigned 8bit (rtl-sdr), signed 8bit (HackRF) or signed 16bit (Airspy, SDRplay)");
+    parser.add_argument("--input-gain")
+        .default_value(float(1.0f)).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain applied to the input, e.g. 0.0625 brings 12bit samples down to the range of 8bit samples");
+    parser.add_argument("--resample-rate")
+        .default_value(uint32_t(0)).scan<'u', uint32_t>()
+        .metavar("SAMPLING_RATE")
+        .nargs(1).required()
+        .help("Resample the input to this rate before it is channelized, e.g. 2048000 for a 2.5MHz tuner (0 to disable)");
+    parser.add_argument("--output-gain")
+        .default_value(float(1.0f)).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain applied to each channel before it is written as 8bit IQ");
+    parser.add_argument("-n", "--block-size")
+        .default_value(size_t(65536)).scan<'u', size_t>()
+        .metavar("BLOCK_SIZE")
+        .nargs(1).required()
+        .help("Number of wideband IQ samples to read at once");
+    parser.add_argument("--list-channels")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Show the DAB blocks that are inside the wideband input");
+#if APP_USE_SOAPYSDR
+    parser.add_argument("--soapy")
+        .default_value(std::string(""))
+        .metavar("DEVICE_ARGS")
+        .nargs(1).required()
+        .help("Read from a SoapySDR device instead of the input, e.g. driver=airspy");
+    parser.add_argument("--soapy-format")
+        .default_value(std::string("native"))
+        .choices("native", "cs16", "cf32")
+        .metavar("FORMAT")
+        .nargs(1).required()
+        .help("Sample format read from the SoapySDR device");
+    parser.add_argument("--soapy-gain")
+        .default_value(float(-1.0f)).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain of the SoapySDR device in dB (negative for automatic gain)");
+    parser.add_argument("--soapy-total-blocks")
+        .default_value(size_t(64)).scan<'u', size_t>()
+        .metavar("TOTAL_BLOCKS")
+        .nargs(1).required()
+        .help("Blocks of --block-size samples queued between the SoapySDR device and the channelizer");
+#endif
+}
+
+struct Args {
+    std::string input_filename;
+    float sampling_rate;
+    float frequency;
+    std::vector<std::string> channels;
+    std::string input_format;
+    float input_gain;
+    uint32_t resample_rate;
+    float output_gain;
+    size_t block_size;
+    bool is_list_channels;
+    std::string soapy_args;
+    std::string soapy_format;
+    float soapy_gain;
+    size_t soapy_total_blocks;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.input_filename = parser.get<std::string>("--input");
+    args.sampling_rate = parser.get<float>("--sampling-rate");
+    args.frequency = parser.get<float>("--frequency");
+    if (parser.is_used("--channel")) {
+        args.channels = parser.get<std::vector<std::string>>("--channel");
+    }
+    args.input_format = parser.get<std::string>("--input-format");
+    args.input_gain = parser.get<float>("--input-gain");
+    args.resample_rate = parser.get<uint32_t>("--resample-rate");
+    args.output_gain = parser.get<float>("--output-gain");
+    args.block_size = parser.get<size_t>("--block-size");
+    args.is_list_channels = parser.get<bool>("--list-channels");
+#if APP_USE_SOAPYSDR
+    args.soapy_args = parser.get<std::string>("--soapy");
+    args.soapy_format = parser.get<std::string>("--soapy-format");
+    args.soapy_gain = parser.get<float>("--soapy-gain");
+    args.soapy_total_blocks = parser.get<size_t>("--soapy-total-blocks");
+#endif
+    return args;
+}
+
+struct Channel_Output {
+    std::string block;
+    std::string filename;
+    float frequency = 0.0f;
+    FILE* fp = nullptr;
+    std::vector<uint8_t> buffer;
+};
+
+// A channel fits if its neighbours can still be filtered out before the edge of the input
+static bool is_channel_inside(const float frequency, const float centre_frequency, const float sampling_rate) {
+    constexpr float STOP_BANDWIDTH = 1'888'000.0f;
+    return (std::abs(frequency - centre_frequency) + STOP_BANDWIDTH*0.5f) <= (sampling_rate*0.5f);
+}
+
+static void list_channels(const float centre_frequency, const float sampling_rate) {
+    std::vector<std::pair<std::string, uint32_t>> channels;
+    for (const auto& [block, frequency_Hz]: block_frequencies) {
+        if (!is_channel_inside(float(frequency_Hz), centre_frequency, sampling_rate)) continue;
+        channels.push_back({ block, frequency_Hz });
+    }
+    std::sort(channels.begin(), channels.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second;
+    });
+    fprintf(stderr, "Block |    Frequency |      Offset\n");
+    for (const auto& [block, frequency_Hz]: channels) {
+        const float frequency_MHz = float(frequency_Hz) * 1e-6f;
+        const float offset_MHz = (float(frequency_Hz) - centre_frequency) * 1e-6f;
+        fprintf(stderr, "%*s | %8.3f MHz | %+7.3f MHz\n", 5, block.c_str(), frequency_MHz, offset_MHz);
+    }
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("channelize_wideband", "0.1.0");
+    parser.add_description("Splits a wideband 8bit IQ stream into one 2.048MHz 8bit IQ stream per DAB block");
+    parser.add_epilog(
+        "Each output can be a named pipe into its own demodulator, e.g.\n"
+        "mkfifo dab_5a dab_5b && ./channelize_wideband -s 10240000 -f 177500000 -c 5A:dab_5a -c 5B:dab_5b &\n"
+        "./multi_radio_app -i dab_5a -i dab_5b"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+
+    if (args.sampling_rate <= 0.0f) {
+        fprintf(stderr, "Sampling rate must be positive (%.3f)\n", args.sampling_rate);
+        return 1;
+    }
+    const uint32_t sampling_rate = uint32_t(std::round(args.sampling_rate));
+    const bool is_resampled = (args.resample_rate != 0) && (args.resample_rate != sampling_rate);
+    if (is_resampled && !IQ_Resampler::IsSupported(sampling_rate, args.resample_rate)) {
+        fprintf(stderr, "Sampling rate %u cannot be resampled to %u\n", sampling_rate, args.resample_rate);
+        return 1;
+    }
+    const uint32_t channelizer_rate = is_resampled ? args.resample_rate : sampling_rate;
+    if (!Wideband_Channelizer::IsSupported(channelizer_rate, DAB_SAMPLING_RATE)) {
+        fprintf(stderr, "Sampling rate %u cannot be decimated to %u\n", channelizer_rate, DAB_SAMPLING_RATE);
+        return 1;
+    }
+    if (args.is_list_channels) {
+        fprintf(stderr, "DAB blocks inside the input are:\n");
+        list_channels(args.frequency, float(channelizer_rate));
+        return 1;
+    }
+    if (args.block_size == 0) {
+        fprintf(stderr, "Block size cannot be zero\n");
+        return 1;
+    }
+    if (args.channels.empty()) {
+        fprintf(stderr, "At least one channel is required\n");
+        return 1;
+    }
+
+    std::vector<Channel_Output> outputs;
+    std::vector<float> channel_frequencies;
+    for (const auto& channel: args.channels) {
+        const size_t separator = channel.find(':');
+        if ((separator == std::string::npos) || (separator == 0) || (separator+1 == channel.size())) {
+            fprintf(stderr, "Channel must be given as BLOCK:OUTPUT_FILENAME: '%s'\n", channel.c_str());
+            return 1;
+        }
+        Channel_Output output;
+        output.block = channel.substr(0, separator);
+        output.filename = channel.substr(separator+1);
+        auto res = block_frequencies.find(output.block);
+        if (res == block_frequencies.end()) {
+            fprintf(stderr, "Invalid DAB block: '%s'\n", output.block.c_str());
+            return 1;
+        }
+        output.frequency = float(res->second);
+        if (!is_channel_inside(output.frequency, args.frequency, float(channelizer_rate))) {
+            fprintf(stderr, "DAB block %s at %.3fMHz is outside of the input (use --list-channels)\n",
+                output.block.c_str(), output.frequency*1e-6f);
+            return 1;
+        }
+        outputs.push_back(output);
+        channel_frequencies.push_back(output.frequency - args.frequency);
+    }
+
+    const size_t N = args.block_size;
+#if APP_USE_SOAPYSDR
+    // the device is read in blocks which are already resampled
+    std::unique_ptr<SoapySource> soapy_source = nullptr;
+    if (!args.soapy_args.empty()) {
+        SoapySourceConfig config;
+        config.args = args.soapy_args;
+        config.sample_rate = double(sampling_rate);
+        config.frequency = double(args.frequency);
+        config.is_auto_gain = (args.soapy_gain < 0.0f);
+        config.gain = double(args.soapy_gain);
+        if (args.soapy_format.compare("cs16") == 0) {
+            config.format = SoapySourceFormat::CS16;
+        } else if (args.soapy_format.compare("cf32") == 0) {
+            config.format = SoapySourceFormat::CF32;
+        }
+        config.output_sample_rate = channelizer_rate;
+        config.block_size = N;
+        config.total_blocks = args.soapy_total_blocks;
+        soapy_source = SoapySource::open(config);
+        if (soapy_source == nullptr) {
+            fprintf(stderr, "Failed to open SoapySDR device: '%s'\n", args.soapy_args.c_str());
+            return 1;
+        }
+    }
+    const bool is_file_input = (soapy_source == nullptr);
+#else
+    const bool is_file_input = true;
+#endif
+
+    FILE* fp_in = stdin;
+    if (is_file_input && !args.input_filename.empty()) {
+        fp_in = fopen(args.input_filename.c_str(), "rb");
+        if (fp_in == nullptr) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+            return 1;
+        }
+    }
+#if _WIN32
+    _setmode(_fileno(fp_in), _O_BINARY);
+#endif
+    for (auto& output: outputs) {
+        output.fp = fopen(output.filename.c_str(), "wb+");
+        if (output.fp == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", output.filename.c_str());
+            return 1;
+        }
+    }
+
+    auto channelizer = Wideband_Channelizer(channelizer_rate, DAB_SAMPLING_RATE, channel_frequencies);
+    std::unique_ptr<IQ_Resampler> resampler = nullptr;
+    if (is_file_input && is_resampled) {
+        resampler = std::make_unique<IQ_Resampler>(sampling_rate, channelizer_rate);
+    }
+    const float output_gain = args.output_gain;
+    bool is_write_error = false;
+    channelizer.On_Channel_Block().Attach([&outputs, output_gain, &is_write_error](size_t index, tcb::span<const std::complex<float>> y) {
+        auto& output = outputs[index];
+        output.buffer.resize(y.size()*2);
+        const auto quantise = [output_gain](const float x) {
+            const float v = std::round(x*output_gain + RAW_IQ_BIAS);
+            return uint8_t(std::clamp(v, 0.0f, 255.0f));
+        };
+        for (size_t i = 0; i < y.size(); i++) {
+            output.buffer[2*i+0] = quantise(y[i].real());
+            output.buffer[2*i+1] = quantise(y[i].imag());
+        }
+        const size_t nb_write = fwrite(output.buffer.data(), sizeof(uint8_t), output.buffer.size(), output.fp);
+        if (nb_write != output.buffer.size()) {
+            fprintf(stderr, "Failed to write out block %s %zu/%zu\n", output.block.c_str(), nb_write, output.buffer.size());
+            is_write_error = true;
+        }
+    });
+    for (const auto& output: outputs) {
+        const auto& channel = channelizer.GetChannel(&output - outputs.data());
+        fprintf(stderr, "Extracting %s at %+.3fMHz into '%s'\n",
+            output.block.c_str(), channel.frequency*1e-6f, output.filename.c_str());
+    }
+
+    const bool is_signed = (args.input_format.compare("s8") == 0);
+    const bool is_s16 = (args.input_format.compare("s16") == 0);
+    const size_t bytes_per_sample = is_s16 ? sizeof(RawIQ_s16) : sizeof(RawIQ_u8);
+    Raw_IQ_Correction input_correction;
+    input_correction.gain = { args.input_gain, args.input_gain };
+    auto rx_in = std::vector<uint8_t>(N*bytes_per_sample);
+    auto rx_float = std::vector<std::complex<float>>(N);
+    while (!is_write_error) {
+        size_t nb_read = 0;
+#if APP_USE_SOAPYSDR
+        if (!is_file_input) {
+            nb_read = soapy_source->read(rx_float);
+        }
+#endif
+        if (is_file_input) {
+            nb_read = fread(rx_in.data(), bytes_per_sample, N, fp_in);
+            auto y = tcb::span(rx_float).first(nb_read);
+            if (is_s16) {
+                const auto* values = reinterpret_cast<const int16_t*>(rx_in.data());
+                convert_raw_iq_auto({ values, nb_read*2 }, y, 0.0f, input_correction);
+            } else if (is_signed) {
+                const auto* bytes = reinterpret_cast<const int8_t*>(rx_in.data());
+                convert_raw_iq_auto({ bytes, nb_read*2 }, y, 0.0f, input_correction);
+            } else {
+                convert_raw_iq_auto({ rx_in.data(), nb_read*2 }, y, RAW_IQ_BIAS, input_correction);
+            }
+        }
+        auto x = tcb::span<const std::complex<float>>(rx_float).first(nb_read);
+        if (resampler != nullptr) {
+            x = resampler->Process(x);
+        }
+        channelizer.Process(x);
+        if (nb_read != N) {
+            fprintf(stderr, "Failed to read in block %zu/%zu\n", nb_read, N);
+            break;
+        }
+    }
+
+    for (auto& output: outputs) {
+        fclose(output.fp);
+    }
+    return is_write_error ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include "dab/algorithms/dab_convolutional_encoder.h"
+#include "dab/algorithms/dab_depuncture_plan.h"
+#include "dab/algorithms/dab_viterbi_batch_decoder.h"
+#include "dab/algorithms/dab_viterbi_decoder.h"
+#include "dab/constants/puncture_codes.h"
+#include "utility/span.h"
+#include "simd_dispatch.h"
+#include "viterbi_config.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("--puncture-code")
+        .default_value(std::vector<std::string>{})
+        .metavar("PI")
+        .append()
+        .help("Puncture code (1 to 24) of the codewords, repeat this for each code (defaults to 8 which is rate 1/2)");
+    parser.add_argument("--ebn0-start")
+        .default_value(float(0.0f)).scan<'g', float>()
+        .metavar("DB")
+        .nargs(1).required()
+        .help("First Eb/N0 of the sweep");
+    parser.add_argument("--ebn0-end")
+        .default_value(float(5.0f)).scan<'g', float>()
+        .metavar("DB")
+        .nargs(1).required()
+        .help("Last Eb/N0 of the sweep");
+    parser.add_argument("--ebn0-step")
+        .default_value(float(0.5f)).scan<'g', float>()
+        .metavar("DB")
+        .nargs(1).required()
+        .help("Step between each Eb/N0 of the sweep");
+    parser.add_argument("--codeword-bits")
+        .default_value(size_t(3072)).scan<'u', size_t>()
+        .metavar("TOTAL_BITS")
+        .nargs(1).required()
+        .help("Information bits of each codeword (multiple of 32), 3072 is a 64kbps subchannel");
+    parser.add_argument("--codewords")
+        .default_value(size_t(256)).scan<'u', size_t>()
+        .metavar("TOTAL_CODEWORDS")
+        .nargs(1).required()
+        .help("Number of noisy codewords at each Eb/N0 which sets the smallest bit error rate that can be measured");
+    parser.add_argument("--min-seconds")
+        .default_value(float(0.2f)).scan<'g', float>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Codewords are decoded repeatedly until at least this long has passed to measure the throughput");
+    parser.add_argument("--simd-level")
+        .default_value(std::vector<std::string>{})
+        .metavar("LEVEL")
+        .append()
+        .help("SIMD kernels to compare, repeat this for each level (defaults to every supported level)");
+    parser.add_argument("--decoder")
+        .default_value(std::vector<std::string>{})
+        .metavar("DECODER")
+        .append()
+        .help("Decoder to compare (u16, u8, batch, batch_window), repeat this for each decoder (defaults to all)");
+    parser.add_argument("--window")
+        .default_value(size_t(DAB_Viterbi_Batch_Decoder::DEFAULT_TRACEBACK_LENGTH)).scan<'u', size_t>()
+        .metavar("TRACEBACK_LENGTH")
+        .nargs(1).required()
+        .help("Traceback length of the sliding window used by batch_window");
+    parser.add_argument("--seed")
+        .default_value(int(1234)).scan<'i', int>()
+        .metavar("SEED")
+        .nargs(1).required()
+        .help("Seed for the random bits and noise");
+    parser.add_argument("--csv")
+        .default_value(false).implicit_value(true)
+        .help("Print the results as csv instead of a table");
+}
+
+struct Args {
+    std::vector<std::string> puncture_codes;
+    float ebn0_start;
+    float ebn0_end;
+    float ebn0_step;
+    size_t codeword_bits;
+    size_t total_codewords;
+    float min_seconds;
+    std::vector<std::string> simd_levels;
+    std::vector<std::string> decoders;
+    size_t window;
+    int seed;
+    bool is_csv;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.puncture_codes = parser.get<std::vector<std::string>>("--puncture-code");
+    args.ebn0_start = parser.get<float>("--ebn0-start");
+    args.ebn0_end = parser.get<float>("--ebn0-end");
+    args.ebn0_step = parser.get<float>("--ebn0-step");
+    args.codeword_bits = parser.get<size_t>("--codeword-bits");
+    args.total_codewords = parser.get<size_t>("--codewords");
+    args.min_seconds = parser.get<float>("--min-seconds");
+    args.simd_levels = parser.get<std::vector<std::string>>("--simd-level");
+    args.decoders = parser.get<std::vector<std::string>>("--decoder");
+    args.window = parser.get<size_t>("--window");
+    args.seed = parser.get<int>("--seed");
+    args.is_csv = parser.get<bool>("--csv");
+    return args;
+}
+
+enum class Decoder_Type {
+    // one trellis at a time with 16bit or 8bit path metrics over the whole codeword like the FIC and MSC decoders
+    U16, U8,
+    // 16 codewords at a time with one trellis per SIMD lane like batched EEP subchannels
+    BATCH, BATCH_WINDOW,
+};
+
+static const char* get_decoder_name(const Decoder_Type type) {
+    switch (type) {
+    case Decoder_Type::U16: return "u16";
+    case Decoder_Type::U8: return "u8";
+    case Decoder_Type::BATCH: return "batch";
+    case Decoder_Type::BATCH_WINDOW: return "batch_window";
+    default: return "unknown";
+    }
+}
+
+static bool get_decoder_from_name(const std::string& name, Decoder_Type& type) {
+    for (const auto t: { Decoder_Type::U16, Decoder_Type::U8, Decoder_Type::BATCH, Decoder_Type::BATCH_WINDOW }) {
+        if (name.compare(get_decoder_name(t)) == 0) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Noisy codewords at one Eb/N0 which every decoder is given
+struct Codeword_Set {
+    std::vector<std::vector<uint8_t>> bytes;
+    std::vector<std::vector<viterbi_bit_t>> soft_bits;
+    float code_rate = 0.0f;
+};
+
+// DOC: ETSI EN 300 401
+// Clause 11.1.1 - Mother code
+// Clause 11.1.2 - Puncturing procedure
+// Random bytes are encoded and punctured followed by the tail bits then white gaussian noise is added
+static Codeword_Set create_codewords(
+    tcb::span<const uint8_t> puncture_code, const size_t codeword_bits, const size_t total_codewords,
+    const float ebn0_db, std::mt19937& rng)
+{
+    constexpr size_t R = DAB_Convolutional_Encoder::m_code_rate;
+    const size_t nb_mother_bits = codeword_bits*R;
+    const size_t nb_tail_mother_bits = DAB_Convolutional_Encoder::m_nb_tail_bits*R;
+    Codeword_Set set;
+    set.bytes.resize(total_codewords);
+    set.soft_bits.resize(total_codewords);
+    DAB_Convolutional_Encoder encoder;
+    std::vector<uint8_t> bits(nb_mother_bits + nb_tail_mother_bits);
+    auto noise = std::normal_distribution<float>(0.0f, 1.0f);
+    // Leave headroom for the noise before the soft decisions are clipped
+    const float amplitude = float(SOFT_DECISION_VITERBI_HIGH)/2.0f;
+    for (size_t i = 0; i < total_codewords; i++) {
+        auto& bytes = set.bytes[i];
+        bytes.resize(codeword_bits/8);
+        for (auto& x: bytes) x = uint8_t(rng() & 0xFF);
+        encoder.encode(bytes);
+        size_t nb_bits = encoder.puncture(puncture_code, nb_mother_bits, bits);
+        nb_bits += encoder.puncture(PI_X, nb_tail_mother_bits, tcb::span(bits).subspan(nb_bits));
+
+        // Eb/N0 is per information bit so the noise scales with the punctured code rate
+        set.code_rate = float(codeword_bits) / float(nb_bits);
+        const float ebn0 = std::pow(10.0f, ebn0_db/10.0f);
+        const float noise_stddev = std::sqrt(1.0f / (2.0f*set.code_rate*ebn0));
+        auto& soft_bits = set.soft_bits[i];
+        soft_bits.resize(nb_bits);
+        for (size_t j = 0; j < nb_bits; j++) {
+            const float symbol = bits[j] ? +1.0f : -1.0f;
+            const float x = std::round((symbol + noise(rng)*noise_stddev)*amplitude);
+            soft_bits[j] = viterbi_bit_t(std::clamp(x, float(SOFT_DECISION_VITERBI_LOW), float(SOFT_DECISION_VITERBI_HIGH)));
+        }
+    }
+    return set;
+}
+
+struct Decode_Result {
+    double mbits_per_second = 0.0;
+    uint64_t total_bit_errors = 0;
+    uint64_t total_bits = 0;
+    double get_ber() const {
+        return (total_bits > 0) ? (double(total_bit_errors) / double(total_bits)) : 0.0;
+    }
+};
+
+static uint64_t count_bit_errors(tcb::span<const uint8_t> x0, tcb::span<const uint8_t> x1) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < x0.size(); i++) {
+        total += uint64_t(std::bitset<8>(x0[i] ^ x1[i]).count());
+    }
+    return total;
+}
+
+// Decodes every codeword of the set once into decoded_bytes
+class Codeword_Decoder
+{
+private:
+    const Decoder_Type m_type;
+    tcb::span<const uint8_t> m_puncture_code;
+    const size_t m_codeword_bits;
+    DAB_Viterbi_Decoder m_vitdec;
+    DAB_Viterbi_Batch_Decoder m_batch_vitdec;
+    DAB_Depuncture_Plan m_plan;
+public:
+    Codeword_Decoder(
+        const Decoder_Type type, tcb::span<const uint8_t> puncture_code,
+        const size_t codeword_bits, const size_t window)
+    :   m_type(type), m_puncture_code(puncture_code), m_codeword_bits(codeword_bits),
+        m_vitdec((type == Decoder_Type::U8) ? DAB_Viterbi_Decoder::Metric::U8 : DAB_Viterbi_Decoder::Metric::U16)
+    {
+        constexpr size_t R = DAB_Viterbi_Decoder::m_code_rate;
+        m_vitdec.set_traceback_length(codeword_bits);
+        m_batch_vitdec.set_traceback_length((type == Decoder_Type::BATCH_WINDOW) ? window : 0);
+        m_plan.append(puncture_code, codeword_bits*R);
+        m_plan.append(PI_X, DAB_Convolutional_Encoder::m_nb_tail_bits*R);
+    }
+    void decode(const Codeword_Set& set, std::vector<std::vector<uint8_t>>& decoded_bytes) {
+        constexpr size_t R = DAB_Viterbi_Decoder::m_code_rate;
+        const size_t total_codewords = set.soft_bits.size();
+        if ((m_type == Decoder_Type::U16) || (m_type == Decoder_Type::U8)) {
+            for (size_t i = 0; i < total_codewords; i++) {
+                m_vitdec.reset();
+                auto symbols = tcb::span<const viterbi_bit_t>(set.soft_bits[i]);
+                const size_t N = m_vitdec.update(symbols, m_puncture_code, m_codeword_bits*R);
+                m_vitdec.update(symbols.subspan(N), PI_X, DAB_Convolutional_Encoder::m_nb_tail_bits*R);
+                m_vitdec.chainback(decoded_bytes[i]);
+            }
+            return;
+        }
+        const size_t total_lanes = m_batch_vitdec.get_total_lanes();
+        for (size_t i = 0; i < total_codewords; i += total_lanes) {
+            const size_t nb_lanes = std::min(total_lanes, total_codewords-i);
+            m_batch_vitdec.reset();
+            for (size_t lane = 0; lane < nb_lanes; lane++) {
+                m_batch_vitdec.update(lane, set.soft_bits[i+lane], m_plan);
+            }
+            m_batch_vitdec.decode();
+            for (size_t lane = 0; lane < nb_lanes; lane++) {
+                m_batch_vitdec.chainback(lane, decoded_bytes[i+lane]);
+            }
+        }
+    }
+};
+
+// Bit errors are counted on the first pass and the throughput over every pass
+static Decode_Result run_decoder(
+    Codeword_Decoder& decoder, const Codeword_Set& set, const size_t codeword_bits, const float min_seconds)
+{
+    using clock = std::chrono::steady_clock;
+    auto decoded_bytes = std::vector<std::vector<uint8_t>>(set.bytes.size(), std::vector<uint8_t>(codeword_bits/8));
+    Decode_Result result;
+    size_t total_passes = 0;
+    double total_seconds = 0.0;
+    while ((total_passes == 0) || (total_seconds < double(min_seconds))) {
+        const auto time_start = clock::now();
+        decoder.decode(set, decoded_bytes);
+        total_seconds += std::chrono::duration<double>(clock::now() - time_start).count();
+        if (total_passes == 0) {
+            for (size_t i = 0; i < set.bytes.size(); i++) {
+                result.total_bit_errors += count_bit_errors(set.bytes[i], decoded_bytes[i]);
+                result.total_bits += uint64_t(codeword_bits);
+            }
+        }
+        total_passes++;
+    }
+    const double total_decoded_bits = double(total_passes)*double(set.bytes.size())*double(codeword_bits);
+    result.mbits_per_second = (total_seconds > 0.0) ? (total_decoded_bits / total_seconds * 1e-6) : 0.0;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("characterise_viterbi", "0.1.0");
+    parser.add_description(
+        "Measures the throughput and bit error rate of each viterbi decoder and SIMD level "
+        "over a sweep of Eb/N0 in white gaussian noise."
+    );
+    parser.add_epilog(
+        "Codewords are encoded with the DAB mother code and punctured like a subchannel.\n"
+        "./characterise_viterbi --puncture-code 8 --puncture-code 16 --ebn0-end 4 --csv > viterbi.csv"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    if ((args.codeword_bits == 0) || ((args.codeword_bits % 32) != 0)) {
+        fprintf(stderr, "Codeword bits must be a non zero multiple of 32\n");
+        return 1;
+    }
+    if (args.total_codewords == 0) {
+        fprintf(stderr, "At least one codeword is required\n");
+        return 1;
+    }
+    if ((args.ebn0_step <= 0.0f) || (args.ebn0_end < args.ebn0_start)) {
+        fprintf(stderr, "Eb/N0 sweep must have a positive step and end after it starts\n");
+        return 1;
+    }
+
+    std::vector<int> puncture_codes;
+    for (const auto& name: args.puncture_codes) {
+        const int code = atoi(name.c_str());
+        if ((code < 1) || (code > 24)) {
+            fprintf(stderr, "Puncture code '%s' must be between 1 and 24\n", name.c_str());
+            return 1;
+        }
+        puncture_codes.push_back(code);
+    }
+    if (puncture_codes.empty()) puncture_codes.push_back(8);
+
+    std::vector<SIMD_Level> simd_levels;
+    for (const auto& name: args.simd_levels) {
+        SIMD_Level level;
+        if (!simd_get_level_from_name(name.c_str(), level) || !simd_is_level_supported(level)) {
+            fprintf(stderr, "SIMD level '%s' is not supported on this CPU (supported up to '%s')\n",
+                name.c_str(), simd_get_level_name(simd_get_supported_level()));
+            return 1;
+        }
+        simd_levels.push_back(level);
+    }
+    if (simd_levels.empty()) {
+        for (int i = int(SIMD_Level::SCALAR); i <= int(SIMD_Level::RVV); i++) {
+            if (simd_is_level_supported(SIMD_Level(i))) simd_levels.push_back(SIMD_Level(i));
+        }
+    }
+
+    std::vector<Decoder_Type> decoders;
+    for (const auto& name: args.decoders) {
+        Decoder_Type type;
+        if (!get_decoder_from_name(name, type)) {
+            fprintf(stderr, "Unknown decoder '%s'\n", name.c_str());
+            return 1;
+        }
+        decoders.push_back(type);
+    }
+    if (decoders.empty()) {
+        decoders = { Decoder_Type::U16, Decoder_Type::U8, Decoder_Type::BATCH, Decoder_Type::BATCH_WINDOW };
+    }
+
+    if (args.is_csv) {
+        fprintf(stdout, "puncture_code,code_rate,ebn0_db,simd_level,decoder,mbits_per_second,ber,bit_errors,bits\n");
+    } else {
+        fprintf(stdout, "%4s %6s %7s %8s %13s %10s %12s %12s\n",
+            "pi", "rate", "ebn0_db", "simd", "decoder", "mbit/s", "ber", "bit_errors");
+    }
+    const size_t total_steps = size_t(std::floor((args.ebn0_end - args.ebn0_start) / args.ebn0_step + 1e-3f)) + 1;
+    for (const int code: puncture_codes) {
+        const auto puncture_code = GetPunctureCode(code);
+        for (size_t step = 0; step < total_steps; step++) {
+            const float ebn0_db = args.ebn0_start + float(step)*args.ebn0_step;
+            // every decoder sees the same codewords at each point
+            auto rng = std::mt19937(uint32_t(args.seed));
+            const auto set = create_codewords(puncture_code, args.codeword_bits, args.total_codewords, ebn0_db, rng);
+            for (const auto level: simd_levels) {
+                // NOTE: Decoders pick their kernels each call so the level can be changed between runs
+                simd_set_level(level);
+                for (const auto type: decoders) {
+                    Codeword_Decoder decoder(type, puncture_code, args.codeword_bits, args.window);
+                    const auto result = run_decoder(decoder, set, args.codeword_bits, args.min_seconds);
+                    if (args.is_csv) {
+                        fprintf(stdout, "%d,%.4f,%.2f,%s,%s,%.3f,%.6e,%llu,%llu\n",
+                            code, set.code_rate, ebn0_db, simd_get_level_name(level), get_decoder_name(type),
+                            result.mbits_per_second, result.get_ber(),
+                            (unsigned long long)result.total_bit_errors, (unsigned long long)result.total_bits);
+                    } else {
+                        fprintf(stdout, "%4d %6.3f %7.2f %8s %13s %10.2f %12.3e %12llu\n",
+                            code, set.code_rate, ebn0_db, simd_get_level_name(level), get_decoder_name(type),
+                            result.mbits_per_second, result.get_ber(), (unsigned long long)result.total_bit_errors);
+                    }
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    return 0;
+}
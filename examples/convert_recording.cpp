@@ -0,0 +1,264 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include "dab/constants/dab_parameters.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_soft_bit_recording.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-t", "--type")
+        .choices("soft_to_recording", "recording_to_soft", "info")
+        .metavar("TYPE")
+        .nargs(1).required()
+        .help("Type of conversion to perform (soft_to_recording, recording_to_soft, info)");
+    parser.add_argument("-i", "--input")
+        .default_value(std::string(""))
+        .metavar("INPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of input to converter (defaults to stdin, recordings must be a file)");
+    parser.add_argument("-o", "--output")
+        .default_value(std::string(""))
+        .metavar("OUTPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of output from converter (defaults to stdout)");
+    // recording settings
+    parser.add_argument("-M", "--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Transmission mode of the soft bits");
+    parser.add_argument("--bit-format")
+        .default_value(std::string("soft"))
+        .choices("soft", "packed", "hard")
+        .metavar("FORMAT")
+        .nargs(1).required()
+        .help("Format of stored bits (soft = 8bit, packed = 4bit, hard = 1bit)");
+    parser.add_argument("--compression")
+        .default_value(std::string("none"))
+        .choices("none", "lz4", "zstd")
+        .metavar("COMPRESSION")
+        .nargs(1).required()
+        .help("Compression of each chunk (lz4 and zstd are only available if they were found when building)");
+    parser.add_argument("--frames-per-chunk")
+        .default_value(size_t(16)).scan<'u', size_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Number of frames in each chunk which is the granularity of seeking");
+    parser.add_argument("--frequency")
+        .default_value(uint32_t(0)).scan<'u', uint32_t>()
+        .metavar("FREQUENCY_HZ")
+        .nargs(1).required()
+        .help("Centre frequency of the ensemble that was recorded");
+    parser.add_argument("--start-time")
+        .default_value(int64_t(0)).scan<'i', int64_t>()
+        .metavar("UNIX_TIME_US")
+        .nargs(1).required()
+        .help("Time the recording started (0 = now)");
+    // playback settings
+    parser.add_argument("--start-frame")
+        .default_value(uint64_t(0)).scan<'u', uint64_t>()
+        .metavar("FRAME")
+        .nargs(1).required()
+        .help("First frame to output from the recording");
+    parser.add_argument("--total-frames")
+        .default_value(uint64_t(0)).scan<'u', uint64_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Number of frames to output from the recording (0 = until the end)");
+}
+
+enum class Conversion_Type {
+    SOFT_TO_RECORDING, RECORDING_TO_SOFT, INFO,
+};
+
+struct Args {
+    Conversion_Type type;
+    std::string input_filename;
+    std::string output_filename;
+    int transmission_mode;
+    Recording_Bit_Format bit_format;
+    Recording_Compression compression;
+    size_t frames_per_chunk;
+    uint32_t frequency;
+    int64_t start_time;
+    uint64_t start_frame;
+    uint64_t total_frames;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    const auto type = parser.get<std::string>("--type");
+    args.type = Conversion_Type::INFO;
+    if (type.compare("soft_to_recording") == 0) {
+        args.type = Conversion_Type::SOFT_TO_RECORDING;
+    } else if (type.compare("recording_to_soft") == 0) {
+        args.type = Conversion_Type::RECORDING_TO_SOFT;
+    }
+    args.input_filename = parser.get<std::string>("--input");
+    args.output_filename = parser.get<std::string>("--output");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    const auto bit_format = parser.get<std::string>("--bit-format");
+    args.bit_format = Recording_Bit_Format::SOFT;
+    if (bit_format.compare("packed") == 0) {
+        args.bit_format = Recording_Bit_Format::PACKED;
+    } else if (bit_format.compare("hard") == 0) {
+        args.bit_format = Recording_Bit_Format::HARD;
+    }
+    const auto compression = parser.get<std::string>("--compression");
+    args.compression = Recording_Compression::NONE;
+    if (compression.compare("lz4") == 0) {
+        args.compression = Recording_Compression::LZ4;
+    } else if (compression.compare("zstd") == 0) {
+        args.compression = Recording_Compression::ZSTD;
+    }
+    args.frames_per_chunk = parser.get<size_t>("--frames-per-chunk");
+    args.frequency = parser.get<uint32_t>("--frequency");
+    args.start_time = parser.get<int64_t>("--start-time");
+    args.start_frame = parser.get<uint64_t>("--start-frame");
+    args.total_frames = parser.get<uint64_t>("--total-frames");
+    return args;
+}
+
+static void print_info(const Recording_Reader& reader, FILE* fp_out) {
+    const auto& metadata = reader.get_metadata();
+    const auto params = get_dab_parameters(metadata.transmission_mode);
+    const double frame_period = double(params.nb_cifs)*0.024;
+    fprintf(fp_out, "transmission_mode: %d\n", metadata.transmission_mode);
+    fprintf(fp_out, "frequency_hz: %u\n", metadata.frequency_hz);
+    fprintf(fp_out, "ensemble_id: 0x%04X\n", unsigned(metadata.ensemble_id));
+    fprintf(fp_out, "ensemble_label: '%s'\n", metadata.ensemble_label.c_str());
+    fprintf(fp_out, "start_time_us: %lld\n", (long long)metadata.start_time_us);
+    fprintf(fp_out, "bit_format: %s\n", get_recording_bit_format_name(reader.get_bit_format()));
+    fprintf(fp_out, "compression: %s\n", get_recording_compression_name(reader.get_compression()));
+    fprintf(fp_out, "frames_per_chunk: %zu\n", reader.get_frames_per_chunk());
+    fprintf(fp_out, "total_frames: %llu\n", (unsigned long long)reader.get_total_frames());
+    fprintf(fp_out, "duration_seconds: %.3f\n", double(reader.get_total_frames())*frame_period);
+    fprintf(fp_out, "total_chunks: %zu\n", reader.get_total_chunks());
+    fprintf(fp_out, "index_rebuilt: %s\n", reader.get_is_index_rebuilt() ? "true" : "false");
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("convert_recording", "0.1.0");
+    parser.add_description("Converts between raw viterbi soft bits and an indexed recording");
+    parser.add_epilog(
+        "Recordings are split into chunks of whole frames with a timestamp and an index at the end.\n"
+        "This lets a player start from any frame without reading the frames before it.\n"
+        "Storing packed or hard bits and compressing each chunk reduces the space used."
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+
+    if (args.type == Conversion_Type::SOFT_TO_RECORDING) {
+        if (!get_recording_compression_is_supported(args.compression)) {
+            fprintf(stderr, "Compression '%s' wasn't available when building\n", get_recording_compression_name(args.compression));
+            return 1;
+        }
+    } else if (args.input_filename.empty()) {
+        fprintf(stderr, "Recordings must be read from a file since they are seeked\n");
+        return 1;
+    }
+
+    FILE* fp_in = stdin;
+    if (!args.input_filename.empty()) {
+        fp_in = fopen(args.input_filename.c_str(), "rb");
+        if (fp_in == nullptr) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+            return 1;
+        }
+    }
+
+    FILE* fp_out = stdout;
+    if (!args.output_filename.empty()) {
+        fp_out = fopen(args.output_filename.c_str(), "wb+");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", args.output_filename.c_str());
+            return 1;
+        }
+    }
+
+#if _WIN32
+    _setmode(_fileno(fp_in), _O_BINARY);
+    _setmode(_fileno(fp_out), _O_BINARY);
+#endif
+
+    if (args.type == Conversion_Type::SOFT_TO_RECORDING) {
+        Recording_Metadata metadata;
+        metadata.transmission_mode = args.transmission_mode;
+        metadata.frequency_hz = args.frequency;
+        metadata.start_time_us = args.start_time;
+        auto bits_in = std::make_shared<InputFile<viterbi_bit_t>>(fp_in);
+        auto recording_out = std::make_shared<Recording_Writer>(
+            fp_out, metadata, args.bit_format, args.compression, args.frames_per_chunk);
+        recording_out->set_is_derived_timestamps(true);
+        const auto params = get_dab_parameters(args.transmission_mode);
+        auto buf_bits = std::vector<viterbi_bit_t>(size_t(params.nb_frame_bits));
+        bool is_running = true;
+        while (is_running) {
+            const size_t total_read = bits_in->read(buf_bits);
+            if (total_read != buf_bits.size()) {
+                is_running = false;
+            }
+            const auto write_buf = tcb::span(buf_bits).first(total_read);
+            const size_t total_written = recording_out->write(write_buf);
+            if (total_written != total_read) {
+                is_running = false;
+            }
+        }
+        recording_out->close();
+        if (recording_out->get_is_error()) {
+            fprintf(stderr, "Failed to write recording\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    auto recording_in = std::make_shared<Recording_Reader>();
+    if (!recording_in->open(fp_in)) {
+        fprintf(stderr, "Input file isn't a valid recording: '%s'\n", args.input_filename.c_str());
+        return 1;
+    }
+
+    if (args.type == Conversion_Type::INFO) {
+        print_info(*recording_in, fp_out);
+        return 0;
+    }
+
+    if (!recording_in->seek_frame(args.start_frame)) {
+        fprintf(stderr, "Start frame %llu is past the end of the recording with %llu frames\n",
+            (unsigned long long)args.start_frame, (unsigned long long)recording_in->get_total_frames());
+        return 1;
+    }
+    auto bits_out = std::make_shared<OutputFile<viterbi_bit_t>>(fp_out);
+    auto buf_bits = std::vector<viterbi_bit_t>(recording_in->get_nb_frame_bits());
+    uint64_t total_frames = 0;
+    while ((args.total_frames == 0) || (total_frames < args.total_frames)) {
+        const size_t total_read = recording_in->read(buf_bits);
+        if (total_read != buf_bits.size()) break;
+        const size_t total_written = bits_out->write(buf_bits);
+        if (total_written != total_read) break;
+        total_frames++;
+    }
+    return 0;
+}
@@ -20,10 +20,10 @@
 
 void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("-t", "--type")
-        .choices("soft_to_hard", "hard_to_soft")
+        .choices("soft_to_hard", "hard_to_soft", "soft_to_packed", "packed_to_soft")
         .metavar("TYPE")
         .nargs(1).required()
-        .help("Type of conversion to perform (soft_to_hard, hard_to_soft)");
+        .help("Type of conversion to perform (soft_to_hard, hard_to_soft, soft_to_packed, packed_to_soft)");
     parser.add_argument("-i", "--input")
         .default_value(std::string(""))
         .metavar("INPUT_FILENAME")
@@ -38,11 +38,15 @@ void init_parser(argparse::ArgumentParser& parser) {
         .default_value(size_t(8192)).scan<'u', size_t>()
         .metavar("BLOCK_SIZE")
         .nargs(1).required()
-        .help("Number of hard bytes to read/write at once");
+        .help("Number of hard or packed bytes to read/write at once");
 }
 
+enum class Conversion_Type {
+    SOFT_TO_HARD, HARD_TO_SOFT, SOFT_TO_PACKED, PACKED_TO_SOFT,
+};
+
 struct Args {
-    bool is_soft_to_hard;
+    Conversion_Type type;
     std::string input_filename;
     std::string output_filename;
     size_t block_size;
@@ -50,10 +54,14 @@ struct Args {
 
 Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     Args args;
-    args.is_soft_to_hard = false;
+    args.type = Conversion_Type::HARD_TO_SOFT;
     auto type = parser.get<std::string>("--type");
     if (type.compare("soft_to_hard") == 0) {
-        args.is_soft_to_hard = true;
+        args.type = Conversion_Type::SOFT_TO_HARD;
+    } else if (type.compare("soft_to_packed") == 0) {
+        args.type = Conversion_Type::SOFT_TO_PACKED;
+    } else if (type.compare("packed_to_soft") == 0) {
+        args.type = Conversion_Type::PACKED_TO_SOFT;
     }
     args.input_filename = parser.get<std::string>("--input");
     args.output_filename = parser.get<std::string>("--output");
@@ -63,10 +71,11 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
 
 int main(int argc, char** argv) {
     auto parser = argparse::ArgumentParser("convert_viterbi", "0.1.0");
-    parser.add_description("Converts between viterbi soft bits and hard bytes");
+    parser.add_description("Converts between viterbi soft bits and hard bytes or packed soft bits");
     parser.add_epilog(
         "Use this to compress and decompress the output from the OFDM demodulator.\n"
-        "Converting from viterbi soft bits to hard bytes will reduce space used by 8 times."
+        "Converting from viterbi soft bits to hard bytes will reduce space used by 8 times.\n"
+        "Converting from viterbi soft bits to packed 4bit soft bits will reduce space used by 2 times."
     );
     init_parser(parser);
     try {
@@ -106,7 +115,7 @@ int main(int argc, char** argv) {
     _setmode(_fileno(fp_out), _O_BINARY);
 #endif
 
-    if (args.is_soft_to_hard) {
+    if (args.type == Conversion_Type::SOFT_TO_HARD) {
         auto bits_in = std::make_shared<InputFile<viterbi_bit_t>>(fp_in);
         auto bytes_out = std::make_shared<OutputFile<uint8_t>>(fp_out);
         auto convert_bits_to_bytes = std::make_shared<Convert_Viterbi_Bits_to_Bytes>();
@@ -124,6 +133,42 @@ int main(int argc, char** argv) {
                 is_running = false;
             }
         }
+    } else if (args.type == Conversion_Type::SOFT_TO_PACKED) {
+        auto bits_in = std::make_shared<InputFile<viterbi_bit_t>>(fp_in);
+        auto packed_out = std::make_shared<OutputFile<uint8_t>>(fp_out);
+        auto convert_bits_to_packed = std::make_shared<Convert_Viterbi_Packed_to_Bits>();
+        convert_bits_to_packed->set_output_stream(packed_out);
+        auto buf_bits = std::vector<viterbi_bit_t>(args.block_size*2);
+        bool is_running = true;
+        while (is_running) {
+            const size_t total_read = bits_in->read(buf_bits);
+            if (total_read != buf_bits.size()) {
+                is_running = false;
+            }
+            const auto write_buf = tcb::span(buf_bits).first(total_read);
+            const size_t total_written = convert_bits_to_packed->write(write_buf);
+            if (total_written != total_read) {
+                is_running = false;
+            }
+        }
+    } else if (args.type == Conversion_Type::PACKED_TO_SOFT) {
+        auto packed_in = std::make_shared<InputFile<uint8_t>>(fp_in);
+        auto bits_out = std::make_shared<OutputFile<viterbi_bit_t>>(fp_out);
+        auto convert_packed_to_bits = std::make_shared<Convert_Viterbi_Packed_to_Bits>();
+        convert_packed_to_bits->set_input_stream(packed_in);
+        auto buf_bits = std::vector<viterbi_bit_t>(args.block_size*2);
+        bool is_running = true;
+        while (is_running) {
+            const size_t total_read = convert_packed_to_bits->read(buf_bits);
+            if (total_read != buf_bits.size()) {
+                is_running = false;
+            }
+            const auto write_buf = tcb::span(buf_bits).first(total_read);
+            const size_t total_written = bits_out->write(write_buf);
+            if (total_written != total_read) {
+                is_running = false;
+            }
+        }
     } else {
         auto bytes_in = std::make_shared<InputFile<uint8_t>>(fp_in);
         auto bits_out = std::make_shared<OutputFile<viterbi_bit_t>>(fp_out);
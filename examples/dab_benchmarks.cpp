@@ -0,0 +1,533 @@
+// Micro benchmarks for the DSP and decoding stages of the receiver
+// Inputs are synthetic so the numbers are repeatable across machines and releases
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <easylogging++.h>
+#include <fmt/format.h>
+#include "ofdm/dsp/apply_pll.h"
+#include "ofdm/dsp/apply_pll_cyclic_prefix.h"
+#include "ofdm/dsp/complex_conj_mul_sum.h"
+#include "ofdm/dsp/dqpsk_demapper.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/ofdm_helpers.h"
+#include "ofdm/ofdm_modulator.h"
+#include "dab/algorithms/crc.h"
+#include "dab/algorithms/dab_viterbi_decoder.h"
+#include "dab/algorithms/reed_solomon_decoder.h"
+#include "dab/audio/aac_frame_processor.h"
+#include "dab/audio/mp2_audio_decoder.h"
+#include "dab/constants/puncture_codes.h"
+#include "dab/dab_logging.h"
+#include "dab/dab_misc_info.h"
+#include "dab/database/dab_database_updater.h"
+#include "dab/fic/fic_encoder.h"
+#include "dab/fic/fig_processor.h"
+#include "dab/msc/cif_deinterleaver.h"
+#include "dab/radio_fig_handler.h"
+#include "utility/allocation_counter.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Fixed seed so every run sees the same inputs
+static std::vector<std::complex<float>> CreateRandomSignal(const size_t N) {
+    auto rng = std::mt19937(1234);
+    auto dist = std::normal_distribution<float>(0.0f, 1.0f);
+    auto buf = std::vector<std::complex<float>>(N);
+    for (auto& x: buf) x = { dist(rng), dist(rng) };
+    return buf;
+}
+
+static std::vector<viterbi_bit_t> CreateRandomSoftBits(const size_t N) {
+    auto rng = std::mt19937(1234);
+    auto dist = std::uniform_int_distribution<int>(SOFT_DECISION_VITERBI_LOW, SOFT_DECISION_VITERBI_HIGH);
+    auto buf = std::vector<viterbi_bit_t>(N);
+    for (auto& x: buf) x = viterbi_bit_t(dist(rng));
+    return buf;
+}
+
+static std::vector<uint8_t> CreateRandomBytes(const size_t N) {
+    auto rng = std::mt19937(1234);
+    auto dist = std::uniform_int_distribution<int>(0, 255);
+    auto buf = std::vector<uint8_t>(N);
+    for (auto& x: buf) x = uint8_t(dist(rng));
+    return buf;
+}
+
+// Modulated frames of random data which the demodulator can synchronise to
+static std::vector<std::complex<float>> CreateOFDMFrames(const int transmission_mode, const size_t nb_frames) {
+    const auto& tables = get_DAB_OFDM_tables(transmission_mode);
+    const auto& params = tables.params;
+    const size_t frame_size = params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols;
+    const size_t nb_frame_bytes = (params.nb_frame_symbols-1)*params.nb_data_carriers*2/8;
+    auto modulator = OFDM_Modulator(params, tables.prs_fft_ref);
+    auto frames = std::vector<std::complex<float>>(frame_size*nb_frames);
+    for (size_t i = 0; i < nb_frames; i++) {
+        const auto data = CreateRandomBytes(nb_frame_bytes);
+        modulator.ProcessBlock(tcb::span(frames).subspan(i*frame_size, frame_size), data);
+    }
+    return frames;
+}
+
+// Heap allocations are only counted if dab_benchmarks was built with DAB_BENCHMARKS_COUNT_ALLOCATIONS
+// The scope should start after warm up so any allocation reported here is a regression of the steady state
+// NOTE: This includes allocations from worker threads of the demodulator
+static void SetAllocationCounters(benchmark::State& state, const Allocation_Scope& scope) {
+    if (!get_is_allocation_counter_enabled()) return;
+    const auto counts = scope.get_process_counts();
+    state.counters["allocs"] = benchmark::Counter(double(counts.nb_allocations), benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] = benchmark::Counter(double(counts.nb_bytes), benchmark::Counter::kAvgIterations);
+}
+
+static void BM_ApplyPLL(benchmark::State& state) {
+    const size_t N = size_t(state.range(0));
+    const auto x = CreateRandomSignal(N);
+    auto y = std::vector<std::complex<float>>(N);
+    for (auto _: state) {
+        apply_pll_auto(x, y, 0.01f);
+        benchmark::DoNotOptimize(y.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(N));
+}
+BENCHMARK(BM_ApplyPLL)->Arg(256)->Arg(2048);
+
+static void BM_ComplexConjMulSum(benchmark::State& state) {
+    const size_t N = size_t(state.range(0));
+    const auto x0 = CreateRandomSignal(N);
+    const auto x1 = CreateRandomSignal(N);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(complex_conj_mul_sum_auto(x0, x1));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(N));
+}
+BENCHMARK(BM_ComplexConjMulSum)->Arg(256)->Arg(2048);
+
+// One symbol per iteration of each transmission mode
+static void BM_ApplyPLLCyclicPrefix(benchmark::State& state) {
+    const auto& params = get_DAB_OFDM_tables(int(state.range(0))).params;
+    const auto x = CreateRandomSignal(params.nb_symbol_period);
+    auto y = std::vector<std::complex<float>>(params.nb_fft);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(apply_pll_cyclic_prefix_auto(x, y, params.nb_cyclic_prefix, 0.01f));
+        benchmark::DoNotOptimize(y.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(params.nb_symbol_period));
+}
+BENCHMARK(BM_ApplyPLLCyclicPrefix)->DenseRange(1, 4);
+
+// One symbol per iteration of each transmission mode with the frequency deinterleaving of the demodulator
+static void BM_DQPSK_Demapper(benchmark::State& state) {
+    const auto& tables = get_DAB_OFDM_tables(int(state.range(0)));
+    const auto& params = tables.params;
+    const int M = int(params.nb_data_carriers)/2;
+    const int N_fft = int(params.nb_fft);
+    auto carrier_fft_index = std::vector<int>(params.nb_data_carriers);
+    for (size_t i = 0; i < params.nb_data_carriers; i++) {
+        const int subcarrier_index = tables.carrier_mapper[i];
+        const int frequency_index = (subcarrier_index < M) ? (subcarrier_index-M) : (subcarrier_index-M+1);
+        carrier_fft_index[i] = (N_fft+frequency_index) % N_fft;
+    }
+    const auto fft_0 = CreateRandomSignal(params.nb_fft);
+    const auto fft_1 = CreateRandomSignal(params.nb_fft);
+    auto bits = std::vector<viterbi_bit_t>(params.nb_data_carriers*2);
+    for (auto _: state) {
+        dqpsk_demapper_auto(fft_0, fft_1, carrier_fft_index, bits);
+        benchmark::DoNotOptimize(bits.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(params.nb_data_carriers));
+}
+BENCHMARK(BM_DQPSK_Demapper)->DenseRange(1, 4);
+
+// One transmission frame per iteration after the demodulator has synchronised
+static void BM_OFDM_Demod(benchmark::State& state) {
+    const int transmission_mode = int(state.range(0));
+    constexpr size_t TOTAL_FRAMES = 4;
+    const auto frames = CreateOFDMFrames(transmission_mode, TOTAL_FRAMES);
+    const size_t frame_size = frames.size()/TOTAL_FRAMES;
+    auto demod = Create_OFDM_Demodulator(transmission_mode);
+    for (size_t i = 0; i < TOTAL_FRAMES; i++) {
+        demod->Process(tcb::span(frames).subspan(i*frame_size, frame_size));
+    }
+    size_t frame_index = 0;
+    const auto allocations = Allocation_Scope();
+    for (auto _: state) {
+        demod->Process(tcb::span(frames).subspan(frame_index*frame_size, frame_size));
+        frame_index = (frame_index+1) % TOTAL_FRAMES;
+    }
+    SetAllocationCounters(state, allocations);
+    demod->Flush();
+    state.counters["desync"] = double(demod->GetTotalFramesDesync());
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(frame_size));
+}
+BENCHMARK(BM_OFDM_Demod)->DenseRange(1, 4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// 96 capacity units is a typical 128kbps subchannel
+static void BM_CIF_Deinterleaver(benchmark::State& state) {
+    constexpr int nb_bytes = 96*8;
+    const auto bits = CreateRandomSoftBits(size_t(nb_bytes)*8);
+    auto out_bits = std::vector<viterbi_bit_t>(bits.size());
+    auto deinterleaver = CIF_Deinterleaver(nb_bytes);
+    for (auto _: state) {
+        deinterleaver.Consume(bits);
+        benchmark::DoNotOptimize(deinterleaver.Deinterleave(out_bits));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations())*int64_t(nb_bytes));
+}
+BENCHMARK(BM_CIF_Deinterleaver);
+
+// Decodes 3072 bits with the puncture code PI=range(0) followed by the tail bits
+static void BM_DAB_Viterbi_Decoder(benchmark::State& state) {
+    const int puncture_code_index = int(state.range(0));
+    constexpr size_t nb_decoded_bits = 3072;
+    constexpr size_t nb_output_symbols = nb_decoded_bits*DAB_Viterbi_Decoder::m_code_rate;
+    const auto soft_bits = CreateRandomSoftBits(nb_output_symbols);
+    auto decoded_bytes = std::vector<uint8_t>(nb_decoded_bits/8);
+    const auto puncture_code = GetPunctureCode(puncture_code_index);
+    DAB_Viterbi_Decoder vitdec;
+    for (auto _: state) {
+        vitdec.reset();
+        auto symbols = tcb::span<const viterbi_bit_t>(soft_bits);
+        const size_t N = vitdec.update(symbols, puncture_code, nb_output_symbols);
+        vitdec.update(symbols.subspan(N), PI_X, 24);
+        benchmark::DoNotOptimize(vitdec.chainback(decoded_bytes));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(nb_decoded_bits));
+}
+BENCHMARK(BM_DAB_Viterbi_Decoder)->Arg(1)->Arg(8)->Arg(16)->Arg(24);
+
+// Same as above with 8bit path metrics
+static void BM_DAB_Viterbi_Decoder_U8(benchmark::State& state) {
+    const int puncture_code_index = int(state.range(0));
+    constexpr size_t nb_decoded_bits = 3072;
+    constexpr size_t nb_output_symbols = nb_decoded_bits*DAB_Viterbi_Decoder::m_code_rate;
+    const auto soft_bits = CreateRandomSoftBits(nb_output_symbols);
+    auto decoded_bytes = std::vector<uint8_t>(nb_decoded_bits/8);
+    const auto puncture_code = GetPunctureCode(puncture_code_index);
+    DAB_Viterbi_Decoder vitdec(DAB_Viterbi_Decoder::Metric::U8);
+    for (auto _: state) {
+        vitdec.reset();
+        auto symbols = tcb::span<const viterbi_bit_t>(soft_bits);
+        const size_t N = vitdec.update(symbols, puncture_code, nb_output_symbols);
+        vitdec.update(symbols.subspan(N), PI_X, 24);
+        benchmark::DoNotOptimize(vitdec.chainback(decoded_bytes));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(nb_decoded_bits));
+}
+BENCHMARK(BM_DAB_Viterbi_Decoder_U8)->Arg(1)->Arg(8)->Arg(16)->Arg(24);
+
+// DOC: ETSI EN 300 401
+// Clause 11.1.1 - Mother code
+// Clause 11.1.2 - Puncturing procedure
+// Encodes and punctures the bytes followed by the tail bits then adds white gaussian noise
+static std::vector<viterbi_bit_t> CreateNoisySoftBits(
+    tcb::span<const uint8_t> bytes, tcb::span<const uint8_t> puncture_code, const float EbN0_dB, std::mt19937& rng) 
+{
+    constexpr size_t R = DAB_Viterbi_Decoder::m_code_rate;
+    constexpr uint8_t code_polynomial[R] = { 109, 79, 83, 109 };
+    const size_t nb_bits = bytes.size()*8;
+    const size_t nb_tail_bits = sizeof(PI_X);
+    auto symbols = std::vector<float>();
+    uint32_t encoder_state = 0;
+    for (size_t i = 0; i < (nb_bits+nb_tail_bits); i++) {
+        const uint32_t bit = (i < nb_bits) ? ((bytes[i/8] >> (7-(i%8))) & 0b1) : 0;
+        encoder_state = ((encoder_state << 1) | bit) & 0x7F;
+        // NOTE: Puncture codes store the number of transmitted symbols in each block of R symbols
+        const size_t nb_transmitted = (i < nb_bits) ? puncture_code[i % puncture_code.size()] : PI_X[i-nb_bits];
+        for (size_t j = 0; j < nb_transmitted; j++) {
+            uint32_t parity = encoder_state & code_polynomial[j];
+            parity ^= parity >> 4;
+            parity ^= parity >> 2;
+            parity ^= parity >> 1;
+            symbols.push_back((parity & 0b1) ? +1.0f : -1.0f);
+        }
+    }
+
+    // Eb/N0 is per information bit so the noise scales with the punctured code rate
+    const float code_rate = float(nb_bits) / float(symbols.size());
+    const float EbN0 = std::pow(10.0f, EbN0_dB/10.0f);
+    const float noise_stddev = std::sqrt(1.0f / (2.0f*code_rate*EbN0));
+    auto dist = std::normal_distribution<float>(0.0f, noise_stddev);
+    // Leave headroom for the noise before the soft decisions are clipped
+    const float amplitude = float(SOFT_DECISION_VITERBI_HIGH)/2.0f;
+    auto soft_bits = std::vector<viterbi_bit_t>(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) {
+        const float x = std::round((symbols[i] + dist(rng))*amplitude);
+        soft_bits[i] = viterbi_bit_t(std::clamp(x, float(SOFT_DECISION_VITERBI_LOW), float(SOFT_DECISION_VITERBI_HIGH)));
+    }
+    return soft_bits;
+}
+
+// Bit error rate of a code rate 1/2 subchannel (PI=8) in white gaussian noise
+// range(0) selects 16bit (0) or 8bit (1) path metrics and range(1) is Eb/N0 in tenths of a dB
+// NOTE: The bit error rate is given by the "ber" counter, the time is for reference only
+static void BM_DAB_Viterbi_BER(benchmark::State& state) {
+    const auto metric = (state.range(0) == 0) ? DAB_Viterbi_Decoder::Metric::U16 : DAB_Viterbi_Decoder::Metric::U8;
+    const float EbN0_dB = float(state.range(1))/10.0f;
+    constexpr size_t nb_decoded_bits = 3072;
+    constexpr size_t nb_frames = 64;
+    const auto puncture_code = GetPunctureCode(8);
+    auto rng = std::mt19937(1234);
+    auto frame_bytes = std::vector<std::vector<uint8_t>>(nb_frames);
+    auto frame_soft_bits = std::vector<std::vector<viterbi_bit_t>>(nb_frames);
+    for (size_t i = 0; i < nb_frames; i++) {
+        frame_bytes[i].resize(nb_decoded_bits/8);
+        for (auto& x: frame_bytes[i]) x = uint8_t(rng() & 0xFF);
+        frame_soft_bits[i] = CreateNoisySoftBits(frame_bytes[i], puncture_code, EbN0_dB, rng);
+    }
+
+    auto decoded_bytes = std::vector<uint8_t>(nb_decoded_bits/8);
+    DAB_Viterbi_Decoder vitdec(metric);
+    vitdec.set_traceback_length(nb_decoded_bits);
+    uint64_t total_bit_errors = 0;
+    uint64_t total_bits = 0;
+    size_t frame = 0;
+    for (auto _: state) {
+        const auto& soft_bits = frame_soft_bits[frame];
+        vitdec.reset();
+        auto symbols = tcb::span<const viterbi_bit_t>(soft_bits);
+        const size_t N = vitdec.update(symbols, puncture_code, nb_decoded_bits*DAB_Viterbi_Decoder::m_code_rate);
+        vitdec.update(symbols.subspan(N), PI_X, 24);
+        vitdec.chainback(decoded_bytes);
+        for (size_t i = 0; i < decoded_bytes.size(); i++) {
+            total_bit_errors += uint64_t(std::bitset<8>(decoded_bytes[i] ^ frame_bytes[frame][i]).count());
+        }
+        total_bits += uint64_t(nb_decoded_bits);
+        frame = (frame+1) % nb_frames;
+    }
+    state.counters["ber"] = double(total_bit_errors) / double(std::max(total_bits, uint64_t(1)));
+    state.SetItemsProcessed(int64_t(state.iterations())*int64_t(nb_decoded_bits));
+}
+BENCHMARK(BM_DAB_Viterbi_BER)
+    ->Args({0, 10})->Args({1, 10})
+    ->Args({0, 20})->Args({1, 20})
+    ->Args({0, 30})->Args({1, 30})
+    ->Args({0, 40})->Args({1, 40});
+
+// DAB+ RS(120,110) shortened from RS(255,245), range(0) is the number of byte errors
+static void BM_Reed_Solomon_Decoder(benchmark::State& state) {
+    constexpr int NB_CODEWORD_BYTES = 120;
+    constexpr int NB_PADDING_BYTES = 135;
+    const int nb_errors = int(state.range(0));
+    auto decoder = Reed_Solomon_Decoder(8, 0x11D, 0, 1, 10, NB_PADDING_BYTES);
+    // all zeros is a valid codeword so errors are injected by setting bytes
+    auto codeword = std::vector<uint8_t>(NB_CODEWORD_BYTES, 0);
+    for (auto _: state) {
+        std::fill(codeword.begin(), codeword.end(), uint8_t(0));
+        for (int i = 0; i < nb_errors; i++) codeword[size_t(i*11)] = 0xA5;
+        benchmark::DoNotOptimize(decoder.Decode(codeword.data(), nullptr, 0));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations())*NB_CODEWORD_BYTES);
+}
+BENCHMARK(BM_Reed_Solomon_Decoder)->Arg(0)->Arg(1)->Arg(5);
+
+static void BM_CRC_Calculator(benchmark::State& state) {
+    const size_t N = size_t(state.range(0));
+    const auto data = CreateRandomBytes(N);
+    const auto calc = CRC_Calculator<uint16_t>(0b0001000000100001);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(calc.Process(data));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations())*int64_t(N));
+}
+BENCHMARK(BM_CRC_Calculator)->Arg(30)->Arg(1024);
+
+// A 96kbps DAB+ superframe of zeros passes the firecode and is a valid reed solomon codeword
+// range(0) sets the number of byte errors injected into each codeword so the full decoder runs
+static void BM_AAC_Frame_Processor(benchmark::State& state) {
+    constexpr size_t NB_FRAME_BYTES = 264;
+    constexpr size_t TOTAL_FRAMES = 5;
+    constexpr size_t TOTAL_CODEWORDS = NB_FRAME_BYTES*TOTAL_FRAMES/120;
+    const size_t nb_errors = size_t(state.range(0));
+    auto super_frame = std::vector<uint8_t>(NB_FRAME_BYTES*TOTAL_FRAMES, 0);
+    // byte j of codeword i is at i + j*TOTAL_CODEWORDS and we avoid the firecode in the first frame
+    for (size_t j = 50; j < 50+nb_errors; j++) {
+        for (size_t i = 0; i < TOTAL_CODEWORDS; i++) {
+            super_frame[i + j*TOTAL_CODEWORDS] = 0x5A;
+        }
+    }
+    AAC_Frame_Processor processor;
+    for (size_t i = 0; i < TOTAL_FRAMES; i++) {
+        processor.Process(tcb::span(super_frame).subspan(i*NB_FRAME_BYTES, NB_FRAME_BYTES));
+    }
+    const auto allocations = Allocation_Scope();
+    for (auto _: state) {
+        for (size_t i = 0; i < TOTAL_FRAMES; i++) {
+            processor.Process(tcb::span(super_frame).subspan(i*NB_FRAME_BYTES, NB_FRAME_BYTES));
+        }
+    }
+    SetAllocationCounters(state, allocations);
+    state.SetBytesProcessed(int64_t(state.iterations())*int64_t(super_frame.size()));
+}
+BENCHMARK(BM_AAC_Frame_Processor)->Arg(0)->Arg(3);
+
+// 128kbps 48kHz stereo MPEG-1 layer II frame with no bit allocations decodes to silence
+// The synthesis filterbank still runs for every subband so this is close to the real cost
+static void BM_MP2_Decoder(benchmark::State& state) {
+    constexpr size_t NB_FRAME_BYTES = 384;
+    auto frame = std::vector<uint8_t>(NB_FRAME_BYTES, 0);
+    frame[0] = 0xFF;
+    frame[1] = 0xFD;
+    frame[2] = 0x84;
+    frame[3] = 0x00;
+    MP2_Audio_Decoder decoder;
+    decoder.DecodeFrame(frame);
+    const auto allocations = Allocation_Scope();
+    for (auto _: state) {
+        const auto res = decoder.DecodeFrame(frame);
+        if (res.is_error) {
+            state.SkipWithError("Invalid MP2 frame");
+            break;
+        }
+        benchmark::DoNotOptimize(res.samples);
+    }
+    SetAllocationCounters(state, allocations);
+    state.SetBytesProcessed(int64_t(state.iterations())*int64_t(NB_FRAME_BYTES));
+}
+BENCHMARK(BM_MP2_Decoder);
+
+// FIBs carrying FIG 0/1, 0/2 and 1/1 into a database updater
+// range(0) enables the repeated FIG cache which is how the FIC runner uses the processor
+static void BM_FIG_Processor(benchmark::State& state) {
+    constexpr size_t NB_FIB_BYTES = 30;
+    auto fib_0 = std::vector<uint8_t>(NB_FIB_BYTES, 0xFF);
+    {
+        // FIG 0/1 with 4 short form subchannels followed by FIG 0/2 with 2 services
+        const uint8_t figs[] = {
+            0x0D, 0x01,
+            0x04, 0x00, 0x0A,  0x08, 0x30, 0x0A,  0x0C, 0x60, 0x0A,  0x10, 0x90, 0x0A,
+            0x0B, 0x02,
+            0xC2, 0x21, 0x01, 0x3F, 0x06,
+            0xC2, 0x22, 0x01, 0x3F, 0x0A,
+        };
+        std::copy(std::begin(figs), std::end(figs), fib_0.begin());
+    }
+    auto fib_1 = std::vector<uint8_t>(NB_FIB_BYTES, 0xFF);
+    {
+        // FIG 1/1 service label
+        const uint8_t figs[] = {
+            0x35, 0x01, 0xC2, 0x21,
+            'B','e','n','c','h','m','a','r','k',' ','S','e','r','v','i','c',
+            0xFF, 0x00,
+        };
+        std::copy(std::begin(figs), std::end(figs), fib_1.begin());
+    }
+
+    DAB_Database_Updater updater;
+    DAB_Misc_Info misc_info;
+    Radio_FIG_Handler handler;
+    handler.SetUpdater(&updater);
+    handler.SetMiscInfo(&misc_info);
+    FIG_Processor processor;
+    processor.SetHandler(&handler);
+    processor.SetIsCacheEnabled(state.range(0) != 0);
+    for (auto _: state) {
+        processor.ProcessFIB(fib_0);
+        processor.ProcessFIB(fib_1);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations())*2);
+}
+BENCHMARK(BM_FIG_Processor)->Arg(0)->Arg(1);
+
+// FIB groups of an encoded ensemble with 18 DAB+ services processed the same way as BasicFICRunner
+// range(0) uses the processor specialised on Radio_FIG_Handler instead of the virtual interface
+// range(1) enables the repeated FIG cache
+template <typename Processor>
+static void RunFIGProcessorFICStream(benchmark::State& state, const std::vector<std::vector<uint8_t>>& groups) {
+    constexpr size_t NB_FIB_BYTES = 32;
+    constexpr size_t NB_FIB_DATA_BYTES = 30;
+    DAB_Database_Updater updater;
+    DAB_Misc_Info misc_info;
+    Radio_FIG_Handler handler;
+    handler.SetUpdater(&updater);
+    handler.SetMiscInfo(&misc_info);
+    Processor processor;
+    processor.SetHandler(&handler);
+    processor.SetIsCacheEnabled(state.range(1) != 0);
+    const auto process_groups = [&]() {
+        size_t total_fibs = 0;
+        for (const auto& group: groups) {
+            handler.BeginBatch();
+            for (size_t i = 0; (i+NB_FIB_BYTES) <= group.size(); i += NB_FIB_BYTES) {
+                processor.ProcessFIB({ group.data()+i, NB_FIB_DATA_BYTES });
+                total_fibs++;
+            }
+            handler.EndBatch();
+        }
+        return total_fibs;
+    };
+    // the first pass creates the database entities
+    process_groups();
+    size_t total_fibs = 0;
+    const auto allocations = Allocation_Scope();
+    for (auto _: state) {
+        total_fibs += process_groups();
+    }
+    SetAllocationCounters(state, allocations);
+    state.SetItemsProcessed(int64_t(total_fibs));
+}
+
+static void BM_FIG_Processor_FIC_Stream(benchmark::State& state) {
+    constexpr size_t NB_SERVICES = 18;
+    constexpr size_t NB_GROUPS = 64;
+    // FIC of transmission mode I has 3 FIBs per CIF
+    constexpr size_t NB_FIB_GROUP_BITS = 2304;
+    constexpr size_t NB_FIBS_PER_GROUP = 3;
+    DAB_Database_Updater source;
+    Radio_FIG_Handler source_handler;
+    source_handler.SetUpdater(&source);
+    const auto ensemble_label = std::string_view("Benchmark       ");
+    source_handler.OnEnsemble_1_ID(0xE, 0x234, 0, 0, 0, 0, 0);
+    source_handler.OnEnsemble_3_Label(0xE, 0x234, 0, { reinterpret_cast<const uint8_t*>(ensemble_label.data()), ensemble_label.size() });
+    for (size_t i = 0; i < NB_SERVICES; i++) {
+        const auto service_reference = uint32_t(0x100+i);
+        const auto label = fmt::format("Service {:<8}", i);
+        source_handler.OnSubchannel_1_Long(uint8_t(i), uint16_t(i*48), 0, 2, 48, false);
+        source_handler.OnServiceComponent_1_StreamAudioType(0xE, service_reference, 0xE1, uint8_t(i), 63, true);
+        source_handler.OnService_2_Label(0xE, service_reference, 0xE1, 0, { reinterpret_cast<const uint8_t*>(label.data()), label.size() });
+    }
+
+    FIC_Encoder encoder(NB_FIB_GROUP_BITS, NB_FIBS_PER_GROUP);
+    encoder.SetDatabase(source.GetDatabase());
+    auto encoded_bits = std::vector<uint8_t>(NB_FIB_GROUP_BITS);
+    auto groups = std::vector<std::vector<uint8_t>>();
+    for (size_t i = 0; i < NB_GROUPS; i++) {
+        encoder.EncodeFIBGroup(i, encoded_bits);
+        const auto group = encoder.GetFIBGroup();
+        groups.emplace_back(group.begin(), group.end());
+    }
+
+    if (state.range(0) != 0) {
+        RunFIGProcessorFICStream<Basic_FIG_Processor<Radio_FIG_Handler>>(state, groups);
+    } else {
+        RunFIGProcessorFICStream<FIG_Processor>(state, groups);
+    }
+}
+BENCHMARK(BM_FIG_Processor_FIC_Stream)->ArgsProduct({{0, 1}, {0, 1}});
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char** argv) {
+    // Logging would dominate the timings
+    el::Configurations config;
+    config.setToDefault();
+    config.setGlobally(el::ConfigurationType::Enabled, "false");
+    el::Loggers::reconfigureAllLoggers(config);
+    for (const char* name: get_dab_registered_loggers()) {
+        auto* logger = el::Loggers::getLogger(name);
+        if (logger != nullptr) logger->configure(config);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
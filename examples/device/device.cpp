@@ -14,10 +14,30 @@ extern "C" {
 #include <vector>
 #include <fmt/format.h>
 #include "utility/span.h"
-
-Device::Device(rtlsdr_dev_t* device, const DeviceDescriptor& descriptor, const int block_size)
-:  m_descriptor(descriptor), m_device(device), m_block_size(block_size)
+#include "utility/thread_affinity_platform.h"
+
+// defaults of rtlsdr_read_async() when buf_num or buf_len are 0
+constexpr uint32_t DEFAULT_TOTAL_TRANSFERS = 15;
+constexpr uint32_t DEFAULT_TRANSFER_SIZE = 16*32*512;
+// librtlsdr silently uses the default size if the transfer size isn't a multiple of this
+constexpr uint32_t TRANSFER_SIZE_ALIGN = 512;
+
+Device::Device(
+    rtlsdr_dev_t* device, const DeviceDescriptor& descriptor,
+    const DeviceTransferConfig& transfer_config, const Thread_Affinity& reader_affinity)
+:  m_descriptor(descriptor), m_device(device), m_transfer_config(transfer_config), m_reader_affinity(reader_affinity)
 {
+    if (m_transfer_config.total_transfers == 0) {
+        m_transfer_config.total_transfers = DEFAULT_TOTAL_TRANSFERS;
+    }
+    if (m_transfer_config.transfer_size == 0) {
+        m_transfer_config.transfer_size = DEFAULT_TRANSFER_SIZE;
+    }
+    const uint32_t transfer_remainder = m_transfer_config.transfer_size % TRANSFER_SIZE_ALIGN;
+    if (transfer_remainder != 0) {
+        m_transfer_config.transfer_size += TRANSFER_SIZE_ALIGN-transfer_remainder;
+    }
+
     m_is_running = true;
     m_is_gain_manual = true;
     m_selected_gain = 0.0f;
@@ -33,12 +53,17 @@ Device::Device(rtlsdr_dev_t* device, const DeviceDescriptor& descriptor, const i
     if (status < 0) m_error_list.push_back(fmt::format("Failed to reset buffer ({})", status));
 
     m_runner_thread = std::make_unique<std::thread>([this]() {
+        if (!apply_thread_affinity(m_reader_affinity)) {
+            fprintf(stderr, "[device] Failed to apply thread affinity to reader of %s\n", m_descriptor.serial.c_str());
+        }
         const int status_read = rtlsdr_read_async(
             m_device, 
             &Device::rtlsdr_callback, reinterpret_cast<void*>(this), 
-            0, m_block_size
+            m_transfer_config.total_transfers, m_transfer_config.transfer_size
         );
         fprintf(stderr, "[device] rtlsdr_read_sync exited with %d\n", status_read);
+        // NOTE: This also returns if the device was unplugged
+        m_is_running = false;
     });
 }
 
@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 #include <functional>
 #include <list>
 #include <memory>
@@ -9,6 +10,7 @@
 #include <thread>
 #include <vector>
 #include "utility/span.h"
+#include "utility/thread_affinity.h"
 
 struct DeviceDescriptor {
     std::string vendor;
@@ -16,13 +18,25 @@ struct DeviceDescriptor {
     std::string serial;
 };
 
+// USB transfers used by rtlsdr_read_async()
+// NOTE: Each transfer is passed to the data callback once it completes
+//       More and larger transfers ride out longer stalls of the reading thread before samples are lost
+struct DeviceTransferConfig {
+    // 0 uses the librtlsdr default of 15
+    uint32_t total_transfers = 0;
+    // bytes per transfer rounded up to a multiple of 512 (0 uses the librtlsdr default of 256kB)
+    uint32_t transfer_size = 0;
+};
+
 class Device 
 {
 private:
     DeviceDescriptor m_descriptor;
     struct rtlsdr_dev* m_device;
-    const int m_block_size;
-    bool m_is_running;
+    DeviceTransferConfig m_transfer_config;
+    Thread_Affinity m_reader_affinity;
+    // false once closed or if the reader stopped, e.g. the device was unplugged
+    std::atomic<bool> m_is_running;
     std::unique_ptr<std::thread> m_runner_thread;
 
     std::vector<float> m_gain_list;
@@ -34,7 +48,10 @@ private:
     std::function<size_t(tcb::span<const uint8_t>)> m_callback_on_data = nullptr;
     std::function<void(const std::string&, const uint32_t)> m_callback_on_center_frequency = nullptr;
 public:
-    explicit Device(struct rtlsdr_dev* device, const DeviceDescriptor& descriptor, const int block_size=8192);
+    // reader_affinity is applied to the thread that calls the data callback
+    explicit Device(
+        struct rtlsdr_dev* device, const DeviceDescriptor& descriptor,
+        const DeviceTransferConfig& transfer_config={}, const Thread_Affinity& reader_affinity={});
     ~Device();
     // we are holding a pointer to rtlsdr_dev_t, so we cant move/copy this class
     Device(Device&) = delete;
@@ -44,7 +61,8 @@ public:
     void Close();
     bool IsRunning() const { return m_is_running; }
     const auto& GetDescriptor() { return m_descriptor; }
-    int GetBlockSize(void) { return m_block_size; }
+    // total_transfers and transfer_size are the values actually used by librtlsdr
+    const auto& GetTransferConfig(void) const { return m_transfer_config; }
     const auto& GetGainList(void) { return m_gain_list; }
     bool GetIsGainManual(void) { return m_is_gain_manual; }
     float GetSelectedGain(void) { return m_selected_gain; }
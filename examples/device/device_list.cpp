@@ -52,7 +52,7 @@ void DeviceList::refresh() {
     m_descriptors = descriptors;
 }
 
-std::shared_ptr<Device> DeviceList::get_device(size_t index) {
+std::shared_ptr<Device> DeviceList::get_device(size_t index, const Thread_Affinity& reader_affinity) {
     if (index >= m_descriptors.size()) {
         auto lock = std::unique_lock(m_mutex_errors);
         LOG_ERROR("Device at index %zu out of bounds", index);
@@ -62,7 +62,31 @@ std::shared_ptr<Device> DeviceList::get_device(size_t index) {
     auto lock_descriptors = std::unique_lock(m_mutex_descriptors);
     const auto descriptor = m_descriptors[index];
     lock_descriptors.unlock();
+    return open_device(index, descriptor, reader_affinity);
+}
+
+bool DeviceList::is_serial_connected(const std::string& serial) {
+    return rtlsdr_get_index_by_serial(serial.c_str()) >= 0;
+}
+
+std::shared_ptr<Device> DeviceList::get_device_by_serial(const std::string& serial, const Thread_Affinity& reader_affinity) {
+    const int index = rtlsdr_get_index_by_serial(serial.c_str());
+    if (index < 0) return nullptr;
+
+    constexpr size_t N = 256;
+    char vendor_str[N] = {0};
+    char product_str[N] = {0};
+    char serial_str[N] = {0};
+    rtlsdr_get_device_usb_strings(uint32_t(index), vendor_str, product_str, serial_str);
+    const auto descriptor = DeviceDescriptor {
+        std::string(vendor_str, strnlen(vendor_str, N)), 
+        std::string(product_str, strnlen(product_str, N)),
+        std::string(serial_str, strnlen(serial_str, N))
+    };
+    return open_device(size_t(index), descriptor, reader_affinity);
+}
 
+std::shared_ptr<Device> DeviceList::open_device(size_t index, const DeviceDescriptor& descriptor, const Thread_Affinity& reader_affinity) {
     rtlsdr_dev_t* device = nullptr;
     const auto status = rtlsdr_open(&device, uint32_t(index));
     if (status < 0) {
@@ -70,5 +94,5 @@ std::shared_ptr<Device> DeviceList::get_device(size_t index) {
         LOG_ERROR("Failed to open device at index %zu (%d)", index, status);
         return nullptr;
     }
-    return std::make_shared<Device>(device, descriptor, 4);
+    return std::make_shared<Device>(device, descriptor, m_transfer_config, reader_affinity);
 }
\ No newline at end of file
@@ -3,8 +3,10 @@
 #include <stddef.h>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 #include "utility/span.h"
+#include "utility/thread_affinity.h"
 #include "./device.h"
 
 class DeviceList 
@@ -13,9 +15,18 @@ private:
     std::mutex m_mutex_descriptors;
     std::mutex m_mutex_errors;
     std::vector<DeviceDescriptor> m_descriptors;
+    DeviceTransferConfig m_transfer_config;
 public:
     auto& get_mutex_descriptors() { return m_mutex_descriptors; }
     tcb::span<const DeviceDescriptor> get_descriptors() const { return m_descriptors; }
+    // used by devices opened after this is set
+    void set_transfer_config(const DeviceTransferConfig& config) { m_transfer_config = config; }
     void refresh(); 
-    std::shared_ptr<Device> get_device(size_t index);
+    std::shared_ptr<Device> get_device(size_t index, const Thread_Affinity& reader_affinity={});
+    // Opens the device without refreshing the list since its index changes when devices are plugged in or out
+    // Returns nullptr if it isn't connected
+    std::shared_ptr<Device> get_device_by_serial(const std::string& serial, const Thread_Affinity& reader_affinity={});
+    static bool is_serial_connected(const std::string& serial);
+private:
+    std::shared_ptr<Device> open_device(size_t index, const DeviceDescriptor& descriptor, const Thread_Affinity& reader_affinity);
 };
\ No newline at end of file
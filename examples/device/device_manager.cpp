@@ -0,0 +1,111 @@
+#include "./device_manager.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "utility/span.h"
+#include "./device.h"
+#include "./device_list.h"
+
+#define LOG_MESSAGE(...) fprintf(stderr, "[device-manager] " __VA_ARGS__)
+
+DeviceManager::DeviceManager(const DeviceTransferConfig& transfer_config, const std::chrono::milliseconds poll_period)
+: m_poll_period(poll_period)
+{
+    m_device_list.set_transfer_config(transfer_config);
+}
+
+DeviceManager::~DeviceManager() {
+    stop();
+}
+
+size_t DeviceManager::add_device(const ManagedDeviceConfig& config, DataCallback&& callback) {
+    auto lock = std::unique_lock(m_mutex_slots);
+    Slot slot;
+    slot.config = config;
+    slot.callback = std::move(callback);
+    m_slots.push_back(std::move(slot));
+    return m_slots.size()-1;
+}
+
+void DeviceManager::start() {
+    if (m_monitor_thread != nullptr) return;
+    update();
+    m_monitor_thread = std::make_unique<std::thread>([this]() {
+        auto lock = std::unique_lock(m_mutex_monitor);
+        while (!m_is_stopped) {
+            m_cv_monitor.wait_for(lock, m_poll_period, [this]() { return m_is_stopped; });
+            if (m_is_stopped) break;
+            lock.unlock();
+            update();
+            lock.lock();
+        }
+    });
+}
+
+void DeviceManager::stop() {
+    {
+        auto lock = std::unique_lock(m_mutex_monitor);
+        m_is_stopped = true;
+    }
+    m_cv_monitor.notify_all();
+    if (m_monitor_thread != nullptr) {
+        m_monitor_thread->join();
+        m_monitor_thread = nullptr;
+    }
+    auto lock = std::unique_lock(m_mutex_slots);
+    for (auto& slot: m_slots) {
+        slot.device = nullptr;
+        slot.status.is_connected = false;
+    }
+}
+
+ManagedDeviceStatus DeviceManager::get_status(const size_t index) {
+    auto lock = std::unique_lock(m_mutex_slots);
+    return m_slots[index].status;
+}
+
+void DeviceManager::update() {
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        auto lock = std::unique_lock(m_mutex_slots);
+        auto& slot = m_slots[i];
+        // NOTE: Closing an unplugged device waits for its reader thread to exit
+        if ((slot.device != nullptr) && !slot.device->IsRunning()) {
+            LOG_MESSAGE("Device %s stopped reading and will be reopened once it is available\n", slot.config.serial.c_str());
+            slot.device = nullptr;
+            slot.status.is_connected = false;
+            slot.status.total_disconnects++;
+        }
+        if (slot.device != nullptr) continue;
+        if (!DeviceList::is_serial_connected(slot.config.serial)) continue;
+
+        auto device = m_device_list.get_device_by_serial(slot.config.serial, slot.config.reader_affinity);
+        if (device == nullptr) {
+            LOG_MESSAGE("Failed to open device %s\n", slot.config.serial.c_str());
+            continue;
+        }
+        if (slot.config.is_auto_gain) {
+            device->SetAutoGain();
+        } else {
+            device->SetNearestGain(slot.config.gain);
+        }
+        auto callback = slot.callback;
+        device->SetDataCallback([callback](tcb::span<const uint8_t> buf) {
+            return callback(buf);
+        });
+        device->SetCenterFrequency(slot.config.channel_label, slot.config.frequency);
+        for (const auto& error: device->GetErrorList()) {
+            LOG_MESSAGE("Device %s: %s\n", slot.config.serial.c_str(), error.c_str());
+        }
+        device->GetErrorList().clear();
+        LOG_MESSAGE("Device %s is reading %s@%uHz\n",
+            slot.config.serial.c_str(), slot.config.channel_label.c_str(), slot.config.frequency);
+        slot.device = device;
+        slot.status.is_connected = true;
+        slot.status.total_connects++;
+    }
+}
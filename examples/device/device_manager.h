@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+#include "utility/thread_affinity.h"
+#include "./device.h"
+#include "./device_list.h"
+
+struct ManagedDeviceConfig {
+    std::string serial;
+    std::string channel_label;
+    uint32_t frequency = 0;
+    bool is_auto_gain = false;
+    float gain = 19.0f;
+    // thread that calls the data callback
+    Thread_Affinity reader_affinity;
+};
+
+struct ManagedDeviceStatus {
+    bool is_connected = false;
+    size_t total_connects = 0;
+    size_t total_disconnects = 0;
+};
+
+// Keeps a fixed set of devices open by their serial numbers
+// A device that stops reading (e.g. it was unplugged) is closed and reopened once it is plugged back in
+// The data callback of each device stays the same across reconnects so its pipeline keeps running
+// NOTE: Each device needs a unique serial since devices are found with rtlsdr_get_index_by_serial()
+class DeviceManager
+{
+public:
+    using DataCallback = std::function<size_t(tcb::span<const uint8_t>)>;
+private:
+    struct Slot {
+        ManagedDeviceConfig config;
+        DataCallback callback;
+        std::shared_ptr<Device> device;
+        ManagedDeviceStatus status;
+    };
+    DeviceList m_device_list;
+    const std::chrono::milliseconds m_poll_period;
+    std::vector<Slot> m_slots;
+    std::mutex m_mutex_slots;
+    std::unique_ptr<std::thread> m_monitor_thread;
+    std::mutex m_mutex_monitor;
+    std::condition_variable m_cv_monitor;
+    bool m_is_stopped = false;
+public:
+    explicit DeviceManager(
+        const DeviceTransferConfig& transfer_config={},
+        const std::chrono::milliseconds poll_period=std::chrono::milliseconds(1000));
+    ~DeviceManager();
+    DeviceManager(DeviceManager&) = delete;
+    DeviceManager(DeviceManager&&) = delete;
+    DeviceManager& operator=(DeviceManager&) = delete;
+    DeviceManager& operator=(DeviceManager&&) = delete;
+    // Returns the index of the device
+    // NOTE: Devices can only be added before start()
+    size_t add_device(const ManagedDeviceConfig& config, DataCallback&& callback);
+    // Opens every connected device straight away and then checks for changes in the background
+    void start();
+    void stop();
+    size_t get_total_devices() const { return m_slots.size(); }
+    const ManagedDeviceConfig& get_config(const size_t index) const { return m_slots[index].config; }
+    ManagedDeviceStatus get_status(const size_t index);
+private:
+    void update();
+};
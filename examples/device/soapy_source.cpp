@@ -0,0 +1,260 @@
+#include "./soapy_source.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <SoapySDR/Constants.h>
+#include <SoapySDR/Device.hpp>
+#include <SoapySDR/Errors.hpp>
+#include <SoapySDR/Formats.h>
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "ofdm/dsp/iq_resampler.h"
+#include "utility/span.h"
+#include "utility/thread_affinity_platform.h"
+
+#define LOG_MESSAGE(...) fprintf(stderr, "[soapy-source] " __VA_ARGS__)
+
+// readStream() returns at least this often so the reader can be stopped
+constexpr long READ_TIMEOUT_US = 100'000;
+// full scale of the rtl-sdr's 8bit samples after removing their bias
+constexpr float OUTPUT_FULL_SCALE = 128.0f;
+// full scale of CS16 samples when the driver converts to them
+constexpr double CS16_FULL_SCALE = 32768.0;
+
+static const char* get_format_string(const SoapySourceFormat format) {
+    return (format == SoapySourceFormat::CS16) ? SOAPY_SDR_CS16 : SOAPY_SDR_CF32;
+}
+
+static size_t get_bytes_per_sample(const SoapySourceFormat format) {
+    return (format == SoapySourceFormat::CS16) ? sizeof(RawIQ_s16) : sizeof(std::complex<float>);
+}
+
+std::unique_ptr<SoapySource> SoapySource::open(const SoapySourceConfig& config) {
+    const uint32_t sample_rate = uint32_t(std::round(config.sample_rate));
+    const bool is_resampled = (config.output_sample_rate != 0) && (config.output_sample_rate != sample_rate);
+    if (is_resampled && !IQ_Resampler::IsSupported(sample_rate, config.output_sample_rate)) {
+        LOG_MESSAGE("Sample rate %u cannot be resampled to %u\n", sample_rate, config.output_sample_rate);
+        return nullptr;
+    }
+    if ((config.block_size == 0) || (config.total_blocks == 0)) {
+        LOG_MESSAGE("Block size and total blocks must be positive\n");
+        return nullptr;
+    }
+
+    SoapySDR::Device* device = nullptr;
+    SoapySDR::Stream* stream = nullptr;
+    try {
+        device = SoapySDR::Device::make(config.args);
+    } catch (const std::exception& ex) {
+        LOG_MESSAGE("Failed to open device '%s': %s\n", config.args.c_str(), ex.what());
+        return nullptr;
+    }
+    if (device == nullptr) {
+        LOG_MESSAGE("Failed to open device '%s'\n", config.args.c_str());
+        return nullptr;
+    }
+
+    SoapySourceFormat format = config.format;
+    double full_scale = 1.0;
+    try {
+        const size_t channel = config.channel;
+        device->setSampleRate(SOAPY_SDR_RX, channel, config.sample_rate);
+        device->setFrequency(SOAPY_SDR_RX, channel, config.frequency);
+        device->setGainMode(SOAPY_SDR_RX, channel, config.is_auto_gain);
+        if (!config.is_auto_gain) {
+            device->setGain(SOAPY_SDR_RX, channel, config.gain);
+        }
+        if (!config.antenna.empty()) {
+            device->setAntenna(SOAPY_SDR_RX, channel, config.antenna);
+        }
+
+        double native_full_scale = 1.0;
+        const auto native_format = device->getNativeStreamFormat(SOAPY_SDR_RX, channel, native_full_scale);
+        const bool is_native_cs16 = (native_format.compare(SOAPY_SDR_CS16) == 0);
+        if (format == SoapySourceFormat::NATIVE) {
+            // formats other than CS16 are converted to CF32 inside the driver
+            format = is_native_cs16 ? SoapySourceFormat::CS16 : SoapySourceFormat::CF32;
+        }
+        if (format == SoapySourceFormat::CS16) {
+            full_scale = is_native_cs16 ? native_full_scale : CS16_FULL_SCALE;
+        }
+
+        stream = device->setupStream(SOAPY_SDR_RX, get_format_string(format), { channel });
+        if (stream == nullptr) {
+            LOG_MESSAGE("Failed to setup %s stream of '%s'\n", get_format_string(format), config.args.c_str());
+            SoapySDR::Device::unmake(device);
+            return nullptr;
+        }
+        const int rv = device->activateStream(stream);
+        if (rv != 0) {
+            LOG_MESSAGE("Failed to activate stream of '%s': %s\n", config.args.c_str(), SoapySDR::errToStr(rv));
+            device->closeStream(stream);
+            SoapySDR::Device::unmake(device);
+            return nullptr;
+        }
+    } catch (const std::exception& ex) {
+        LOG_MESSAGE("Failed to configure device '%s': %s\n", config.args.c_str(), ex.what());
+        if (stream != nullptr) device->closeStream(stream);
+        SoapySDR::Device::unmake(device);
+        return nullptr;
+    }
+
+    LOG_MESSAGE("Reading %s from '%s' at %.3fMHz with %.0f samples/s\n",
+        get_format_string(format), config.args.c_str(), config.frequency*1e-6, config.sample_rate);
+    return std::unique_ptr<SoapySource>(new SoapySource(config, device, stream, format, full_scale));
+}
+
+SoapySource::SoapySource(
+    const SoapySourceConfig& config,
+    SoapySDR::Device* device, SoapySDR::Stream* stream,
+    const SoapySourceFormat format, const double full_scale)
+:   m_config(config),
+    m_device(device), m_stream(stream),
+    m_format(format),
+    m_bytes_per_sample(get_bytes_per_sample(format)),
+    m_scale(OUTPUT_FULL_SCALE / float(full_scale)),
+    m_ring(config.block_size*get_bytes_per_sample(format), config.total_blocks),
+    m_scratch(config.block_size*get_bytes_per_sample(format)),
+    m_converted(config.block_size)
+{
+    const uint32_t sample_rate = uint32_t(std::round(config.sample_rate));
+    if ((config.output_sample_rate != 0) && (config.output_sample_rate != sample_rate)) {
+        m_resampler = std::make_unique<IQ_Resampler>(sample_rate, config.output_sample_rate);
+    }
+    m_reader_thread = std::make_unique<std::thread>([this]() {
+        if (!apply_thread_affinity(m_config.reader_affinity)) {
+            LOG_MESSAGE("Failed to apply thread affinity to reader of '%s'\n", m_config.args.c_str());
+        }
+        run_reader();
+    });
+}
+
+SoapySource::~SoapySource() {
+    close();
+}
+
+void SoapySource::close() {
+    m_is_running = false;
+    if (m_reader_thread != nullptr) {
+        m_reader_thread->join();
+        m_reader_thread = nullptr;
+    }
+    if (m_device != nullptr) {
+        m_device->deactivateStream(m_stream);
+        m_device->closeStream(m_stream);
+        SoapySDR::Device::unmake(m_device);
+        m_device = nullptr;
+        m_stream = nullptr;
+    }
+    m_ring.close();
+}
+
+uint32_t SoapySource::get_sample_rate() const {
+    if (m_resampler != nullptr) return m_resampler->GetOutputSampleRate();
+    return uint32_t(std::round(m_config.sample_rate));
+}
+
+SoapySourceStatistics SoapySource::get_statistics() const {
+    SoapySourceStatistics stats;
+    stats.total_blocks = m_total_blocks.load(std::memory_order_relaxed);
+    stats.total_overruns = m_total_overruns.load(std::memory_order_relaxed);
+    stats.total_device_overflows = m_total_device_overflows.load(std::memory_order_relaxed);
+    stats.max_blocks_used = m_max_blocks_used.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SoapySource::run_reader() {
+    const size_t block_size = m_config.block_size;
+    while (m_is_running) {
+        auto block = m_ring.acquire_write();
+        const bool is_dropped = block.empty();
+        uint8_t* data = is_dropped ? m_scratch.data() : block.data();
+
+        // drivers can return less than requested so a block takes multiple reads
+        size_t total_read = 0;
+        while ((total_read < block_size) && m_is_running) {
+            void* buffers[] = { data + total_read*m_bytes_per_sample };
+            int flags = 0;
+            long long time_ns = 0;
+            const int rv = m_device->readStream(m_stream, buffers, block_size-total_read, flags, time_ns, READ_TIMEOUT_US);
+            if (rv == SOAPY_SDR_TIMEOUT) continue;
+            if (rv == SOAPY_SDR_OVERFLOW) {
+                m_total_device_overflows.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (rv < 0) {
+                LOG_MESSAGE("Failed to read from '%s': %s\n", m_config.args.c_str(), SoapySDR::errToStr(rv));
+                m_is_running = false;
+                break;
+            }
+            total_read += size_t(rv);
+        }
+        if (total_read != block_size) break;
+
+        m_total_blocks.fetch_add(1, std::memory_order_relaxed);
+        if (is_dropped) {
+            m_total_overruns.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        m_ring.commit_write();
+        const size_t total_used = m_ring.get_total_used();
+        if (total_used > m_max_blocks_used.load(std::memory_order_relaxed)) {
+            m_max_blocks_used.store(total_used, std::memory_order_relaxed);
+        }
+    }
+    m_ring.close();
+}
+
+size_t SoapySource::read(tcb::span<std::complex<float>> dest) {
+    size_t total_read = 0;
+    while (total_read < dest.size()) {
+        if (m_pending.empty()) {
+            if (!process_next_block()) break;
+            continue;
+        }
+        const size_t length = std::min(m_pending.size(), dest.size()-total_read);
+        std::copy_n(m_pending.begin(), length, dest.begin() + total_read);
+        m_pending = m_pending.subspan(length);
+        total_read += length;
+    }
+    return total_read;
+}
+
+bool SoapySource::process_next_block() {
+    tcb::span<const uint8_t> block;
+    while (true) {
+        // the stream thread can push its last blocks right before closing so only stop once closed and drained
+        const bool is_closed = m_ring.is_closed();
+        block = m_ring.acquire_read();
+        if (!block.empty()) break;
+        if (is_closed) return false;
+        std::this_thread::sleep_for(POLL_PERIOD);
+    }
+
+    if (m_format == SoapySourceFormat::CS16) {
+        const auto* x = reinterpret_cast<const int16_t*>(block.data());
+        Raw_IQ_Correction correction;
+        correction.gain = { m_scale, m_scale };
+        convert_raw_iq_auto({ x, m_converted.size()*2 }, m_converted, 0.0f, correction);
+    } else {
+        const auto* x = reinterpret_cast<const std::complex<float>*>(block.data());
+        for (size_t i = 0; i < m_converted.size(); i++) {
+            m_converted[i] = x[i]*m_scale;
+        }
+    }
+    m_ring.release_read();
+
+    if (m_resampler != nullptr) {
+        m_pending = m_resampler->Process(m_converted);
+    } else {
+        m_pending = m_converted;
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "utility/thread_affinity.h"
+#include "../app_helpers/app_io_buffers.h"
+
+namespace SoapySDR {
+    class Device;
+    class Stream;
+}
+class IQ_Resampler;
+
+enum class SoapySourceFormat {
+    // use the format of the device's hardware which avoids a conversion inside the driver
+    NATIVE, CS16, CF32
+};
+
+struct SoapySourceConfig {
+    // device arguments, e.g. "driver=airspy" or "driver=sdrplay,serial=1234"
+    std::string args;
+    size_t channel = 0;
+    double sample_rate = 2'500'000.0;
+    double frequency = 0.0;
+    bool is_auto_gain = true;
+    double gain = 0.0;
+    // empty keeps the default antenna
+    std::string antenna;
+    SoapySourceFormat format = SoapySourceFormat::NATIVE;
+    // resamples the stream before read() returns it, 0 keeps the sample rate of the device
+    uint32_t output_sample_rate = 0;
+    // samples read from the device into each block
+    size_t block_size = 65536;
+    // blocks queued between the device and read()
+    size_t total_blocks = 64;
+    // thread that reads from the device
+    Thread_Affinity reader_affinity;
+};
+
+struct SoapySourceStatistics {
+    uint64_t total_blocks = 0;
+    // blocks dropped because read() fell behind and every block was queued
+    uint64_t total_overruns = 0;
+    // samples dropped inside the driver or hardware
+    uint64_t total_device_overflows = 0;
+    // most blocks waiting to be read at once
+    size_t max_blocks_used = 0;
+};
+
+// Reads IQ samples from any SoapySDR device (Airspy, SDRplay, HackRF, LimeSDR, ...)
+// 1. A reader thread calls readStream() straight into a free block of a lock free ring in the native format
+//    If read() falls behind the block is read into a scratch buffer and dropped so the device never stalls
+// 2. read() converts a block to complex<float> and optionally resamples it, e.g. to 2.048MHz for the demodulator
+// Samples are scaled so the full scale of the device is +-128 which matches the 8bit rtl-sdr pipeline
+class SoapySource: public InputBuffer<std::complex<float>>
+{
+private:
+    static constexpr auto POLL_PERIOD = std::chrono::milliseconds(1);
+    const SoapySourceConfig m_config;
+    SoapySDR::Device* m_device;
+    SoapySDR::Stream* m_stream;
+    const SoapySourceFormat m_format;
+    const size_t m_bytes_per_sample;
+    const float m_scale;
+    // producer
+    SPSC_Frame_Ring<uint8_t> m_ring;
+    std::vector<uint8_t> m_scratch;
+    std::atomic<bool> m_is_running{true};
+    std::unique_ptr<std::thread> m_reader_thread;
+    std::atomic<uint64_t> m_total_blocks{0};
+    std::atomic<uint64_t> m_total_overruns{0};
+    std::atomic<uint64_t> m_total_device_overflows{0};
+    std::atomic<size_t> m_max_blocks_used{0};
+    // consumer
+    std::vector<std::complex<float>> m_converted;
+    std::unique_ptr<IQ_Resampler> m_resampler;
+    tcb::span<const std::complex<float>> m_pending;
+public:
+    // Returns nullptr if the device couldn't be opened or configured
+    static std::unique_ptr<SoapySource> open(const SoapySourceConfig& config);
+    ~SoapySource() override;
+    SoapySource(SoapySource&) = delete;
+    SoapySource(SoapySource&&) = delete;
+    SoapySource& operator=(SoapySource&) = delete;
+    SoapySource& operator=(SoapySource&&) = delete;
+    // Stops the device and makes read() return what is left in the queue
+    void close();
+    // false once closed or if the device stopped with an error
+    bool is_running() const { return m_is_running; }
+    const SoapySourceConfig& get_config() const { return m_config; }
+    SoapySourceFormat get_format() const { return m_format; }
+    // sample rate of read() after resampling
+    uint32_t get_sample_rate() const;
+    size_t get_total_blocks() const { return m_ring.get_total_slots(); }
+    size_t get_total_blocks_used() const { return m_ring.get_total_used(); }
+    SoapySourceStatistics get_statistics() const;
+    // Blocks until dest is full and returns less once closed
+    size_t read(tcb::span<std::complex<float>> dest) override;
+private:
+    SoapySource(
+        const SoapySourceConfig& config,
+        SoapySDR::Device* device, SoapySDR::Stream* stream,
+        const SoapySourceFormat format, const double full_scale);
+    void run_reader();
+    bool process_next_block();
+};
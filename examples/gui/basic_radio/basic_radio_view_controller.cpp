@@ -4,30 +4,28 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
-#include "dab/database/dab_database_types.h"
-#include "dab/mot/MOT_entities.h"
-#include "utility/span.h"
+#include "basic_radio/basic_image_service.h"
+#include "basic_radio/basic_slideshow.h"
 #include "./texture.h"
 
 BasicRadioViewController::BasicRadioViewController(const size_t _max_textures) {
     textures.set_max_size(_max_textures);
+    image_service = std::make_unique<Basic_Image_Service>(Decode_Image_RGBA);
     services_filter = std::make_unique<ImGuiTextFilter>();
 }
 
 BasicRadioViewController::~BasicRadioViewController() = default;
 
-static uint32_t get_key(subchannel_id_t subchannel_id, mot_transport_id_t transport_id) {
-    return (subchannel_id << 16) | transport_id;
-}
-
-Texture& BasicRadioViewController::GetTexture(
-    subchannel_id_t subchannel_id, mot_transport_id_t transport_id, tcb::span<const uint8_t> data
-) {
-    const auto key = get_key(subchannel_id, transport_id);
-    auto res = textures.find(key);
+Texture* BasicRadioViewController::GetTexture(const std::shared_ptr<Basic_Slideshow>& slideshow, const bool is_thumbnail) {
+    auto image = image_service->GetImage(slideshow, is_thumbnail);
+    if ((image == nullptr) || image->GetIsError()) {
+        return nullptr;
+    }
+    auto* res = textures.find(image.get());
     if (res == nullptr) {
-        auto& texture = textures.emplace(key, std::make_unique<Texture>(data));
-        return *(texture.get());
+        auto texture = std::make_unique<Texture>(*image);
+        const auto* key = image.get();
+        res = &textures.insert(key, TextureEntry { std::move(image), std::move(texture) });
     }
-    return *(res->get());
-}
\ No newline at end of file
+    return res->texture.get();
+}
@@ -7,10 +7,11 @@
 #include "dab/database/dab_database_types.h"
 #include "dab/mot/MOT_entities.h"
 #include "utility/lru_cache.h"
-#include "utility/span.h"
 #include "./texture.h"
 
 struct Basic_Slideshow;
+struct Basic_Decoded_Image;
+class Basic_Image_Service;
 class BasicRadio;
 struct ImGuiTextFilter;
 
@@ -22,7 +23,13 @@ struct SlideshowView {
 class BasicRadioViewController
 {
 private:
-    LRU_Cache<uint32_t, std::unique_ptr<Texture>> textures;
+    struct TextureEntry {
+        // keeps the decoded image alive so its address is a unique key
+        std::shared_ptr<const Basic_Decoded_Image> image;
+        std::unique_ptr<Texture> texture;
+    };
+    std::unique_ptr<Basic_Image_Service> image_service;
+    LRU_Cache<const Basic_Decoded_Image*, TextureEntry> textures;
 public:
     std::optional<SlideshowView> selected_slideshow = std::nullopt;
     service_id_t selected_service = 0;
@@ -30,5 +37,6 @@ public:
 public:
     explicit BasicRadioViewController(const size_t _max_textures=100);
     ~BasicRadioViewController();
-    Texture& GetTexture(subchannel_id_t subchannel_id, mot_transport_id_t transport_id, tcb::span<const uint8_t> data);
+    // Returns nullptr while the image is being decoded or if it is invalid
+    Texture* GetTexture(const std::shared_ptr<Basic_Slideshow>& slideshow, const bool is_thumbnail);
 };
\ No newline at end of file
@@ -24,18 +24,10 @@
 #include "./formatters.h"
 #include "./render_basic_radio.h"
 
-template <typename T, typename F>
-static T* find_by_callback(std::vector<T>& vec, F&& func) {
-    for (auto& e: vec) {
-        if (func(e)) return &e;
-    }
-    return nullptr;
-}
-
 static void RenderSimple_ServiceList(BasicRadio& radio, BasicRadioViewController& controller);
 static void RenderSimple_Service(BasicRadio& radio, BasicRadioViewController& controller, const Service* service);
 static void RenderSimple_ServiceComponentList(BasicRadio& radio, BasicRadioViewController& controller, const Service* service);
-static void RenderSimple_ServiceComponent(BasicRadio& radio, BasicRadioViewController& controller, ServiceComponent& component);
+static void RenderSimple_ServiceComponent(BasicRadio& radio, BasicRadioViewController& controller, const ServiceComponent& component);
 static void RenderSimple_Basic_Audio_Channel(BasicRadio& radio, BasicRadioViewController& controller, Basic_Audio_Channel& channel, const subchannel_id_t subchannel_id);
 static void RenderSimple_Basic_Data_Channel(BasicRadio& radio, BasicRadioViewController& controller, Basic_Data_Packet_Channel& channel, const subchannel_id_t subchannel_id);
 static void RenderSimple_BasicSlideshowSelected(BasicRadio& radio, BasicRadioViewController& controller);
@@ -49,12 +41,7 @@ void RenderBasicRadio(BasicRadio& radio, BasicRadioViewController& controller) {
     auto lock = std::scoped_lock(radio.GetMutex());
     auto& db = radio.GetDatabase();
 
-    auto* selected_service = find_by_callback(
-        db.services,
-        [&controller](const auto& service) {
-            return service.reference == controller.selected_service;
-        }
-    );
+    auto* selected_service = db.GetService(controller.selected_service);
 
     RenderSimple_ServiceList(radio, controller);
     RenderSimple_Service(radio, controller, selected_service);
@@ -77,7 +64,7 @@ void RenderSimple_ServiceList(BasicRadio& radio, BasicRadioViewController& contr
         auto& search_filter = *(controller.services_filter.get());
         search_filter.Draw("###Services search filter", -1.0f);
         if (ImGui::BeginListBox("###Services list", ImVec2(-1,-1))) {
-            static std::vector<Service*> service_list;
+            static std::vector<const Service*> service_list;
             service_list.clear();
             for (auto& service: db.services) {
                 if (!search_filter.PassFilter(service.label.c_str())) {
@@ -87,14 +74,14 @@ void RenderSimple_ServiceList(BasicRadio& radio, BasicRadioViewController& contr
             }
 
             std::sort(service_list.begin(), service_list.end(), [](const auto* a, const auto* b) {
-                return (a->label.compare(b->label) < 0);
+                return (a->label.view().compare(b->label.view()) < 0);
             });
 
             for (auto* service_ptr: service_list) {
                 auto& service = *service_ptr;
                 const service_id_t service_id = service.reference;
                 const bool is_selected = (service_id == controller.selected_service);
-                auto label = fmt::format("{}###{}", service.label.empty() ? "[Unknown]" : service.label, service.reference);
+                auto label = fmt::format("{}###{}", service.label.empty() ? "[Unknown]" : service.label.view(), service.reference);
                 if (ImGui::Selectable(label.c_str(), is_selected)) {
                     controller.selected_service = is_selected ? -1 : service_id;
                 }
@@ -173,7 +160,7 @@ void RenderSimple_Service(BasicRadio& radio, BasicRadioViewController& controlle
 
 void RenderSimple_ServiceComponentList(BasicRadio& radio, BasicRadioViewController& controller, const Service* service) {
     auto& db = radio.GetDatabase();
-    static std::vector<ServiceComponent*> service_components;
+    static std::vector<const ServiceComponent*> service_components;
     service_components.clear();
     if (service) {
         for (auto& service_component: db.service_components) {
@@ -199,15 +186,10 @@ void RenderSimple_ServiceComponentList(BasicRadio& radio, BasicRadioViewControll
     ImGui::End();
 }
 
-void RenderSimple_ServiceComponent(BasicRadio& radio, BasicRadioViewController& controller, ServiceComponent& component) {
+void RenderSimple_ServiceComponent(BasicRadio& radio, BasicRadioViewController& controller, const ServiceComponent& component) {
     auto& db = radio.GetDatabase();
     const auto subchannel_id = component.subchannel_id;
-    auto* subchannel = find_by_callback(
-        db.subchannels,
-        [subchannel_id](const auto& other) {
-            return other.id == subchannel_id;
-        }
-    );
+    auto* subchannel = db.GetSubchannel(subchannel_id);
 
     ImGui::DockSpace(ImGui::GetID("Service Component Dockspace"));
 
@@ -301,28 +283,25 @@ static void RenderSimple_Slideshow_Manager(BasicRadioViewController& controller,
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_None;
     if (ImGui::BeginChild("Slideshow", ImVec2(0, 0), child_flags, window_flags)) {
         const ImGuiStyle& style = ImGui::GetStyle();
-        static std::vector<std::shared_ptr<Basic_Slideshow>> slideshows;
-        {
-            auto lock = std::unique_lock(slideshow_manager.GetSlideshowsMutex());
-            slideshows.clear();
-            for (auto& slideshow: slideshow_manager.GetSlideshows()) {
-                slideshows.push_back(slideshow);
-            }
-        }
+        // The snapshot is never changed so it is iterated while the decoder adds slideshows
+        const auto slideshows_snapshot = slideshow_manager.GetSlideshows();
+        const auto& slideshows = *slideshows_snapshot;
 
         const float window_width = ImGui::GetWindowContentRegionMax().x;
         float curr_x = 0.0f;
         int slideshow_id = 0;
         for (auto& slideshow: slideshows) {
-            const auto& texture = controller.GetTexture(subchannel_id, slideshow->transport_id, slideshow->image_data);
-            // Determine size of thumbnail
-            const auto texture_id = reinterpret_cast<ImTextureID>(texture.GetTextureID());
+            // Thumbnails are decoded in the background so a square placeholder is shown until then
+            const auto* texture = controller.GetTexture(slideshow, true);
             const float target_height = 200.0f;
-            const float scale = target_height / static_cast<float>(texture.GetHeight());
-            const auto texture_size = ImVec2(
-                static_cast<float>(texture.GetWidth()) * scale, 
-                static_cast<float>(texture.GetHeight()) * scale
-            );
+            auto texture_size = ImVec2(target_height, target_height);
+            if (texture != nullptr) {
+                const float scale = target_height / static_cast<float>(texture->GetHeight());
+                texture_size = ImVec2(
+                    static_cast<float>(texture->GetWidth()) * scale, 
+                    static_cast<float>(texture->GetHeight()) * scale
+                );
+            }
 
             // Determine if the thumbnail needs to be on a new line
             const float next_x = curr_x + style.ItemSpacing.x + texture_size.x;
@@ -335,7 +314,11 @@ static void RenderSimple_Slideshow_Manager(BasicRadioViewController& controller,
             }
 
             ImGui::PushID(slideshow_id++);
-            ImGui::Image(texture_id, texture_size);
+            if (texture != nullptr) {
+                ImGui::Image(reinterpret_cast<ImTextureID>(texture->GetTextureID()), texture_size);
+            } else {
+                ImGui::Button("...", texture_size);
+            }
             if (ImGui::IsItemHovered()) {
                 ImGui::SetTooltip("%.*s", int(slideshow->name.length()), slideshow->name.c_str());
             }
@@ -467,7 +450,7 @@ void RenderSimple_BasicSlideshowSelected(BasicRadio& radio, BasicRadioViewContro
     }
     auto& selection = controller.selected_slideshow.value();
     auto& slideshow = selection.slideshow;
-    auto& texture = controller.GetTexture(selection.subchannel_id, slideshow->transport_id, slideshow->image_data);
+    const auto* texture = controller.GetTexture(slideshow, false);
 
     bool is_open = true;
     if (ImGui::Begin("Slideshow Viewer", &is_open)) {
@@ -476,12 +459,16 @@ void RenderSimple_BasicSlideshowSelected(BasicRadio& radio, BasicRadioViewContro
 
         ImGuiWindowFlags image_flags = ImGuiWindowFlags_HorizontalScrollbar;
         if (ImGui::Begin("Image Viewer", nullptr, image_flags)) {
-            const auto texture_id = reinterpret_cast<ImTextureID>(texture.GetTextureID());
-            const auto texture_size = ImVec2(
-                static_cast<float>(texture.GetWidth()), 
-                static_cast<float>(texture.GetHeight())
-            );
-            ImGui::Image(texture_id, texture_size);
+            if (texture != nullptr) {
+                const auto texture_id = reinterpret_cast<ImTextureID>(texture->GetTextureID());
+                const auto texture_size = ImVec2(
+                    static_cast<float>(texture->GetWidth()), 
+                    static_cast<float>(texture->GetHeight())
+                );
+                ImGui::Image(texture_id, texture_size);
+            } else {
+                ImGui::TextUnformatted("Loading image...");
+            }
         }
         ImGui::End();
 
@@ -515,8 +502,10 @@ void RenderSimple_BasicSlideshowSelected(BasicRadio& radio, BasicRadioViewContro
                 FIELD_MACRO("Alt Location URL", "%.*s", int(slideshow->alt_location_url.length()), slideshow->alt_location_url.c_str());
                 FIELD_MACRO("Size", "%zu Bytes", slideshow->image_data.size());
 
-                FIELD_MACRO("Resolution", "%u x %u", texture.GetWidth(), texture.GetHeight());
-                FIELD_MACRO("Internal Texture ID", "%" PRIuPTR, uintptr_t(texture.GetTextureID()));
+                if (texture != nullptr) {
+                    FIELD_MACRO("Resolution", "%u x %u", texture->GetWidth(), texture->GetHeight());
+                    FIELD_MACRO("Internal Texture ID", "%" PRIuPTR, uintptr_t(texture->GetTextureID()));
+                }
 
                 #undef FIELD_MACRO
                 ImGui::EndTable();
@@ -584,7 +573,7 @@ void RenderSimple_LinkService(BasicRadio& radio, BasicRadioViewController& contr
         }
 
         // FM Services
-        static std::vector<FM_Service*> fm_services;
+        static std::vector<const FM_Service*> fm_services;
         fm_services.clear();
         for (auto& fm_service: db.fm_services) {
             if (fm_service.linkage_set_number != link_service.id) continue;
@@ -619,7 +608,7 @@ void RenderSimple_LinkService(BasicRadio& radio, BasicRadioViewController& contr
         }
 
         // DRM Services
-        static std::vector<DRM_Service*> drm_services;
+        static std::vector<const DRM_Service*> drm_services;
         drm_services.clear();
         for (auto& drm_service: db.drm_services) {
             if (drm_service.linkage_set_number != link_service.id) continue;
@@ -13,14 +13,6 @@
 #include "./formatters.h"
 #include "./render_common.h"
 
-template <typename T, typename F>
-static T* find_by_callback(std::vector<T>& vec, F&& func) {
-    for (auto& e: vec) {
-        if (func(e)) return &e;
-    }
-    return nullptr;
-}
-
 // Render a list of all subchannels
 void RenderSubchannels(BasicRadio& radio) {
     auto& db = radio.GetDatabase();
@@ -39,20 +31,10 @@ void RenderSubchannels(BasicRadio& radio) {
 
             int row_id  = 0;
             for (auto& subchannel: db.subchannels) {
-                auto* service_component = find_by_callback(
-                    db.service_components, 
-                    [&subchannel](const auto& e) { 
-                        return e.subchannel_id == subchannel.id; 
-                    }
-                );
-                Service* service = nullptr;
+                auto* service_component = db.GetServiceComponent_Subchannel(subchannel.id);
+                const Service* service = nullptr;
                 if (service_component) {
-                    service = find_by_callback(
-                        db.services,
-                        [&service_component](const auto& e) {
-                            return e.reference == service_component->service_reference;
-                        }
-                    );
+                    service = db.GetService(service_component->service_reference);
                 }
                 auto service_label = service ? service->label.c_str() : "";
 
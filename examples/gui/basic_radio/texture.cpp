@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <iostream>
+#include "basic_radio/basic_image_service.h"
 #include "utility/span.h"
 #if __APPLE__
 #include <OpenGL/gl.h>
@@ -50,7 +51,21 @@ bool GLCheckErrors(const char *funcName, const char *file, int line) {
     return true; 
 }
 
-Texture::Texture(tcb::span<const uint8_t> image_buffer)
+bool Decode_Image_RGBA(tcb::span<const uint8_t> image_buffer, Basic_Decoded_Image& image) {
+    int bpp = 0;
+    uint8_t* pixels = stbi_load_from_memory(
+        image_buffer.data(), (int)image_buffer.size(), 
+        &image.width, &image.height, &bpp, 4);
+    if (pixels == nullptr) {
+        return false;
+    }
+    const size_t total_bytes = size_t(image.width)*size_t(image.height)*4;
+    image.rgba.assign(pixels, pixels+total_bytes);
+    stbi_image_free(pixels);
+    return true;
+}
+
+Texture::Texture(const Basic_Decoded_Image& image)
     : m_RendererID(0),
       m_Width(0), m_Height(0), m_BPP(0),
       m_is_success(false)
@@ -70,13 +85,11 @@ Texture::Texture(tcb::span<const uint8_t> image_buffer)
     GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
     // give image buffer to opengl
-    // stbi_set_flip_vertically_on_load(1);
-    uint8_t* m_LocalBuffer = stbi_load_from_memory(
-        image_buffer.data(), (int)image_buffer.size(), 
-        &m_Width, &m_Height, &m_BPP, 4);
-    if (m_LocalBuffer != nullptr) {
-        GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
-        stbi_image_free(m_LocalBuffer);
+    if (!image.GetIsError()) {
+        m_Width = image.width;
+        m_Height = image.height;
+        m_BPP = 4;
+        GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.rgba.data()));
         m_is_success = true;
     }
 }
@@ -3,6 +3,11 @@
 #include <stdint.h>
 #include "utility/span.h"
 
+struct Basic_Decoded_Image;
+
+// Decodes a png or jpeg into RGBA, used by the image service on its worker thread
+bool Decode_Image_RGBA(tcb::span<const uint8_t> image_buffer, Basic_Decoded_Image& image);
+
 class Texture
 {
 private:
@@ -10,7 +15,8 @@ private:
     int m_Width, m_Height, m_BPP; // BPP = bits per pixel
     bool m_is_success;
 public:
-    explicit Texture(tcb::span<const uint8_t> image_buffer);
+    // Only uploads the already decoded image so this is cheap enough for the render thread
+    explicit Texture(const Basic_Decoded_Image& image);
     ~Texture();
     Texture(Texture&) = delete;
     Texture(Texture&&) = delete;
@@ -8,29 +8,41 @@
 #include <complex>
 #include <vector>
 #include "ofdm/ofdm_demodulator.h"
+#include "ofdm/plot_downsample.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 
-static void CalculateMagnitude(tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf, const float scale=20.0f);
+static void PlotEnvelope(const char* label, const Plot_Envelope& envelope);
 static void RenderControls(OFDM_Demod& demod);
 static void RenderState(const OFDM_Demod& demod);
-static void RenderPlots(const OFDM_Demod& demod);
-static void RenderMagnitudeSpectrum(const OFDM_Demod& demod);
-static void RenderDemodulatedSymbols(const OFDM_Demod& demod);
-static void RenderSynchronisation(const OFDM_Demod& demod);
+static void RenderPlots(const OFDM_Demod& demod, const OFDM_Demod_Snapshot& snapshot);
+static void RenderMagnitudeSpectrum(const OFDM_Demod_Snapshot& snapshot);
+static void RenderDemodulatedSymbols(const OFDM_Demod_Snapshot& snapshot);
+static void RenderSynchronisation(const OFDM_Demod& demod, const OFDM_Demod_Snapshot& snapshot);
 
 constexpr float Fs = 2.048e6f; // OFDM sampling frequency
+// Plots are downsampled by the demodulator so each one draws about this many points
+constexpr size_t TOTAL_PLOT_POINTS = 512;
 
 void RenderOFDMDemodulator(OFDM_Demod& demod) {
+    // The plots are of a snapshot since the buffers of the demodulator are written by its threads
+    // Only the downsampled plots of the snapshot are drawn so the FFTs of the frame aren't copied into it
+    OFDM_Demod_Tap_Config tap_config;
+    tap_config.is_frame_fft = false;
+    tap_config.plot_points = TOTAL_PLOT_POINTS;
+    demod.SetTap(tap_config);
+    const auto snapshot = demod.GetTapSnapshot();
     RenderState(demod);
     RenderControls(demod);
-    RenderPlots(demod);
+    if (snapshot != nullptr) {
+        RenderPlots(demod, *snapshot);
+    }
 }
 
-void RenderPlots(const OFDM_Demod& demod) {
-    RenderMagnitudeSpectrum(demod);
-    RenderSynchronisation(demod);
-    RenderDemodulatedSymbols(demod);
+void RenderPlots(const OFDM_Demod& demod, const OFDM_Demod_Snapshot& snapshot) {
+    RenderMagnitudeSpectrum(snapshot);
+    RenderSynchronisation(demod, snapshot);
+    RenderDemodulatedSymbols(snapshot);
 }
 
 void RenderSourceBuffer(tcb::span<const std::complex<float>> buf_raw)
@@ -68,6 +80,8 @@ void RenderControls(OFDM_Demod& demod) {
         ImGui::SliderFloat("Coarse freq slow beta", &cfg.sync.coarse_freq_slow_beta, 0.0f, 1.0f);
         ImGui::SliderFloat("Impulse peak threshold (dB)", &cfg.sync.impulse_peak_threshold_db, 0, 100.0f, "%.f");
         ImGui::SliderFloat("Impulse peak distance weight", &cfg.sync.impulse_peak_distance_probability, 0.0f, 1.0f, "%.3f");
+        ImGui::Checkbox("Sample rate correction", &cfg.sync.is_sample_rate_correction);
+        ImGui::SliderFloat("Sample rate beta", &cfg.sync.sample_rate_update_beta, 0.0f, 1.0f, "%.2f");
         static float null_threshold[2] = {0,0};
         null_threshold[0] = cfg.null_l1_search.thresh_null_start;
         null_threshold[1] = cfg.null_l1_search.thresh_null_end;
@@ -87,30 +101,39 @@ void RenderState(const OFDM_Demod& demod) {
     case OFDM_Demod::State::NAME: ImGui::Text("State: "#NAME); break;
 
     if (ImGui::Begin("Stats")) {
-        switch (demod.GetState()) {
+        // The status is copied since the demodulator keeps updating it while we render
+        const auto status = demod.GetStatus();
+        switch (status.state) {
         ENUM_TO_STRING(FINDING_NULL_POWER_DIP);
         ENUM_TO_STRING(READING_NULL_AND_PRS);
         ENUM_TO_STRING(RUNNING_COARSE_FREQ_SYNC);
         ENUM_TO_STRING(RUNNING_FINE_TIME_SYNC);
         ENUM_TO_STRING(READING_SYMBOLS);
+        ENUM_TO_STRING(IDLE_PROBING);
         default: 
         ImGui::Text("State: Unknown"); 
             break;
         }
-        ImGui::Text("Fine freq: %.2f Hz", demod.GetFineFrequencyOffset() * Fs);
-        ImGui::Text("Coarse freq: %.2f Hz", demod.GetCoarseFrequencyOffset() * Fs);
-        ImGui::Text("Net freq: %.2f Hz", demod.GetNetFrequencyOffset() * Fs);
-        ImGui::Text("Signal level: %.2f", demod.GetSignalAverage());
-        ImGui::Text("Frames read: %d", demod.GetTotalFramesRead());
-        ImGui::Text("Frames desynced: %d", demod.GetTotalFramesDesync());
+        ImGui::Text("Fine freq: %.2f Hz", status.fine_freq_offset * Fs);
+        ImGui::Text("Coarse freq: %.2f Hz", status.coarse_freq_offset * Fs);
+        ImGui::Text("Net freq: %.2f Hz", (status.fine_freq_offset + status.coarse_freq_offset) * Fs);
+        ImGui::Text("Sample rate offset: %.2f ppm", status.sample_rate_offset * 1e6f);
+        ImGui::Text("Signal level: %.2f", status.signal_l1_average);
+        ImGui::Text("Frames read: %d", status.total_frames_read);
+        ImGui::Text("Frames desynced: %d", status.total_frames_desync);
+        ImGui::Text("Frames tracked: %d", status.total_frames_tracked);
+        ImGui::Text("Frames overrun: %d", status.total_frames_overrun);
+        ImGui::Text("Frames queued: %d", status.total_frames_queued);
+        ImGui::Text("Idle probes: %d", status.total_idle_probes);
+        ImGui::Text("Idle wakeups: %d", status.total_idle_wakeups);
     }
     ImGui::End();
 
     #undef ENUM_TO_STRING
 }
 
-void RenderDemodulatedSymbols(const OFDM_Demod& demod) {
-    const auto params = demod.GetOFDMParams();
+void RenderDemodulatedSymbols(const OFDM_Demod_Snapshot& snapshot) {
+    const auto& params = snapshot.params;
     const int total_symbols = (int)params.nb_frame_symbols;
     const int total_dqpsk_symbols = total_symbols-1;
     static int symbol_index = 0;
@@ -118,21 +141,19 @@ void RenderDemodulatedSymbols(const OFDM_Demod& demod) {
     if (ImGui::Begin("Demodulated Symbols")) {
         ImGui::SliderInt("DQPSK Symbol Index", &symbol_index, 0, total_dqpsk_symbols-1);
         if (ImGui::BeginTabBar("OFDM symbol plots")) {
-            // Raw constellation
+            // Raw constellation of every data symbol in the frame
             if (ImGui::BeginTabItem("Raw vectors")) {
-                const size_t N = params.nb_data_carriers;
-                auto syms_vec_data = demod.GetFrameDataVec();
-                // vec[0:1] = [real, imag]
-                auto sym_vec = syms_vec_data.subspan(symbol_index*N, N);
-                const double A = 4e6;
+                const auto& density = snapshot.plots.constellation;
+                const double A = density.range;
                 if (ImPlot::BeginPlot("IQ", ImVec2(-1,0), ImPlotFlags_Equal)) {
-                    ImPlot::SetupAxisLimits(ImAxis_X1, -A, A, ImPlotCond_Once);
-                    ImPlot::SetupAxisLimits(ImAxis_Y1, -A, A, ImPlotCond_Once);
-
-                    auto* buf = reinterpret_cast<const float*>(sym_vec.data());
-                    const float marker_size = 2.0f;
-                    ImPlot::SetNextMarkerStyle(ImPlotMarker_Cross, marker_size);
-                    ImPlot::PlotScatter("IQ", &buf[0], &buf[1], (int)N, 0, 0, 2*sizeof(buf[0]));
+                    ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+                    if (!density.counts.empty()) {
+                        const int size = (int)density.size;
+                        ImPlot::PlotHeatmap(
+                            "IQ", density.counts.data(), size, size, 0.0, density.max_count, nullptr,
+                            ImPlotPoint(-A, -A), ImPlotPoint(A, A)
+                        );
+                    }
                     ImPlot::EndPlot();
                 }
 
@@ -142,7 +163,7 @@ void RenderDemodulatedSymbols(const OFDM_Demod& demod) {
             if (ImGui::BeginTabItem("Bits")) {
                 const size_t nb_data_carriers = params.nb_data_carriers;
                 const size_t nb_sym_bits = nb_data_carriers*2;
-                auto syms_bits_data = demod.GetFrameDataBits();
+                auto syms_bits_data = tcb::span<const viterbi_bit_t>(snapshot.frame_bits);
                 // bits[0:N-1]  = Real component
                 // bits[N:2N-1] = Imaginary component
                 auto sym_bits = syms_bits_data.subspan(symbol_index*nb_sym_bits, nb_sym_bits);
@@ -179,7 +200,7 @@ void RenderDemodulatedSymbols(const OFDM_Demod& demod) {
             if (ImGui::BeginTabItem("Phase error")) {
                 const size_t nb_data_carriers = params.nb_data_carriers;
                 const size_t nb_sym_bits = nb_data_carriers*2;
-                auto syms_bits_data = demod.GetFrameDataBits();
+                auto syms_bits_data = tcb::span<const viterbi_bit_t>(snapshot.frame_bits);
                 // bits[0:N-1]  = Real component
                 // bits[N:2N-1] = Imaginary component
                 auto sym_bits = syms_bits_data.subspan(symbol_index*nb_sym_bits, nb_sym_bits);
@@ -225,19 +246,19 @@ void RenderDemodulatedSymbols(const OFDM_Demod& demod) {
     ImGui::End();
 }
 
-void RenderSynchronisation(const OFDM_Demod& demod) {
-    const auto params = demod.GetOFDMParams();
+void RenderSynchronisation(const OFDM_Demod& demod, const OFDM_Demod_Snapshot& snapshot) {
+    const auto& params = snapshot.params;
     const auto& cfg = demod.GetConfig();
 
     if (ImGui::Begin("Fine time synchronisation")) {
         if (ImPlot::BeginPlot("Fine time response")) {
-            auto buf = demod.GetImpulseResponse();
+            const auto& line = snapshot.plots.impulse_response;
             ImPlot::SetupAxisLimits(ImAxis_Y1, 60, 150, ImPlotCond_Once);
-            ImPlot::PlotLine("Impulse response", buf.data(), (int)buf.size());
+            ImPlot::PlotLine("Impulse response", line.x.data(), line.y.data(), (int)line.y.size());
             // Plot useful markers for fine time sync using time correlation
             int marker_id = 0;
             const int target_peak_x = (int)params.nb_cyclic_prefix;
-            const int actual_peak_x = target_peak_x + demod.GetFineTimeOffset();
+            const int actual_peak_x = target_peak_x + snapshot.fine_time_offset;
             double marker_0 = target_peak_x;
             double marker_1 = actual_peak_x;
             ImPlot::DragLineX(marker_id++, &marker_0, ImVec4(0,1,0,1), 1.0f, ImPlotDragToolFlags_NoInputs);
@@ -249,12 +270,11 @@ void RenderSynchronisation(const OFDM_Demod& demod) {
 
     if (ImGui::Begin("Coarse frequency response")) {
         if (ImPlot::BeginPlot("Coarse frequency response")) {
-            auto buf = demod.GetCoarseFrequencyResponse();
             ImPlot::SetupAxisLimits(ImAxis_Y1, 180, 260, ImPlotCond_Once);
-            ImPlot::PlotLine("Impulse response", buf.data(), (int)buf.size());
+            PlotEnvelope("Impulse response", snapshot.plots.coarse_frequency_response);
 
             // Plot useful markers for coarse freq sync using freq correlation
-            const float coarse_freq_offset = std::round(demod.GetCoarseFrequencyOffset() * Fs);
+            const float coarse_freq_offset = std::round(snapshot.coarse_freq_offset * Fs);
             const float max_coarse_freq_offset = cfg.sync.max_coarse_freq_correction_norm * Fs;
             const float freq_fft_bin = Fs / float(params.nb_fft);
             const float peak_offset_x = -coarse_freq_offset / freq_fft_bin;
@@ -281,13 +301,12 @@ void RenderSynchronisation(const OFDM_Demod& demod) {
     ImGui::End();
 
     if (ImGui::Begin("Correlation time buffer")) {
-        auto buf_raw = demod.GetCorrelationTimeBuffer();
-        const size_t N = buf_raw.size();
+        const auto& real = snapshot.plots.correlation_time_real;
+        const auto& imag = snapshot.plots.correlation_time_imag;
         if (ImPlot::BeginPlot("NULL+PRS")) {
-            const auto* buf = reinterpret_cast<const float*>(buf_raw.data());
             ImPlot::SetupAxisLimits(ImAxis_Y1, -128, 128, ImPlotCond_Once);
-            ImPlot::PlotLine("Real", &buf[0], (int)N, 1.0f, 0, 0, 0, 2*sizeof(float));
-            ImPlot::PlotLine("Imag", &buf[1], (int)N, 1.0f, 0, 0, 0, 2*sizeof(float));
+            ImPlot::PlotLine("Real", real.x.data(), real.y.data(), (int)real.y.size());
+            ImPlot::PlotLine("Imag", imag.x.data(), imag.y.data(), (int)imag.y.size());
 
             const auto target_colour = ImVec4(0,0.8,0,1);
             int marker_id = 0;
@@ -300,33 +319,23 @@ void RenderSynchronisation(const OFDM_Demod& demod) {
     ImGui::End();
 }
 
-void RenderMagnitudeSpectrum(const OFDM_Demod& demod) {
-    const auto params = demod.GetOFDMParams();
+void RenderMagnitudeSpectrum(const OFDM_Demod_Snapshot& snapshot) {
+    const auto& params = snapshot.params;
+    // headless demodulators don't keep the FFTs of the frame so there are no spectrums to show
+    const auto& spectrums = snapshot.plots.symbol_spectrums;
 
-    // NOTE: We are calculating the magnitude spectrum in the GUI thread because
-    //       the ofdm demodulation process doesn't need this
-    // TODO: Move the magnitude calculation into the demodulator if we plan on doing 
-    //       TII decoding (transmittor identifier information)
     if (ImGui::Begin("Null symbol spectrum")) {
         if (ImPlot::BeginPlot("Null symbol")) {
-            const int N = (int)params.nb_fft;
-            auto fft_buf = demod.GetFrameFFT();
-            auto null_fft = fft_buf.subspan(N*params.nb_frame_symbols, N);
-
-            static auto mag_buf = std::vector<float>();
-            mag_buf.resize(N);
-
-            CalculateMagnitude(null_fft, mag_buf);
-
+            ImPlot::SetupAxisLimits(ImAxis_X1, 0, (double)params.nb_fft, ImPlotCond_Once);
             ImPlot::SetupAxisLimits(ImAxis_Y1, 20, 90, ImPlotCond_Once);
-            ImPlot::PlotLine("Null symbol", mag_buf.data(), N);
+            if (!spectrums.empty()) {
+                PlotEnvelope("Null symbol", spectrums.back());
+            }
             ImPlot::EndPlot();
         }
     }
     ImGui::End();
 
-    // NOTE: We are calculating the magnitude spectrum in the GUI thread because
-    //       the ofdm demodulation process doesn't need this
     if (ImGui::Begin("Data symbol spectrum")) {
         const int total_symbols = (int)params.nb_frame_symbols;
 
@@ -334,33 +343,23 @@ void RenderMagnitudeSpectrum(const OFDM_Demod& demod) {
         ImGui::SliderInt("Data Symbol Index", &symbol_index, 0, total_symbols-1);
 
         if (ImPlot::BeginPlot("Data symbol spectrum")) {
-            const int N = (int)params.nb_fft;
-            auto fft_buf = demod.GetFrameFFT();
-            auto syms_fft_buf = fft_buf.first(N*params.nb_frame_symbols);
-
-            static auto mag_buf = std::vector<float>();
-            mag_buf.resize(N);
-
-            auto sym_fft_buf = syms_fft_buf.subspan(symbol_index*N, N);
-            CalculateMagnitude(sym_fft_buf, mag_buf);
-
+            ImPlot::SetupAxisLimits(ImAxis_X1, 0, (double)params.nb_fft, ImPlotCond_Once);
             ImPlot::SetupAxisLimits(ImAxis_Y1, 20, 90, ImPlotCond_Once);
-            ImPlot::PlotLine("Data symbol", mag_buf.data(), N);
+            if (size_t(symbol_index) < spectrums.size()) {
+                PlotEnvelope("Data symbol", spectrums[size_t(symbol_index)]);
+            }
             ImPlot::EndPlot();
         }
     }
     ImGui::End();
 }
 
-void CalculateMagnitude(tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf, const float scale) {
-    const size_t N = fft_buf.size();
-    const size_t M = N/2;
-    // F/2 <= f < 0 
-    for (size_t i = 0; i < M; i++) {
-        mag_buf[i] = scale*std::log10(std::abs(fft_buf[i+M]));
-    }
-    // 0 <= f < F/2 
-    for (size_t i = 0; i < M; i++) {
-        mag_buf[i+M] = scale*std::log10(std::abs(fft_buf[i]));
-    }
+// Shaded between the minimum and maximum of each block with a line along the maximum
+void PlotEnvelope(const char* label, const Plot_Envelope& envelope) {
+    const int N = (int)envelope.y_max.size();
+    const double x_scale = (double)envelope.x_scale;
+    ImPlot::PushStyleVar(ImPlotStyleVar_FillAlpha, 0.5f);
+    ImPlot::PlotShaded(label, envelope.y_min.data(), envelope.y_max.data(), N, x_scale);
+    ImPlot::PopStyleVar();
+    ImPlot::PlotLine(label, envelope.y_max.data(), N, x_scale);
 }
@@ -6,20 +6,54 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <functional>
-#include <mutex>
-#include <thread>
+#include <algorithm>
+#include <string>
+#include <vector>
 
-static void RenderTrace(const InstrumentorThread::profile_trace_t& trace);
-static void RenderLoggedTraces(const InstrumentorThread::profile_trace_logger_t& traces);
+#if PROFILE_ENABLE
+static void RenderTrace(const std::vector<ProfileResult>& trace);
+static void GetLastTrace(const std::vector<ProfileResult>& events, std::vector<ProfileResult>& trace);
+static void RenderStageSummaries(const std::vector<ProfileStageSummary>& summaries);
+#endif
 
 void RenderProfiler() {
-    auto& instrumentor = Instrumentor::Get();
-
     if (ImGui::Begin("Profiler")) {
-        static InstrumentorThread* thread = nullptr;
-        static std::hash<std::thread::id> thread_id_hasher;
+#if !PROFILE_ENABLE
+        ImGui::TextWrapped("Profiling was disabled at build time. Configure with -DOFDM_CORE_USE_PROFILER=ON to enable it.");
+#else
+        auto& profiler = Profiler::Get();
+        static int selected_thread_index = -1;
+
+        static const char* trace_filename = "ofdm_profiler_trace.json";
+        static std::string save_status;
+        if (ImGui::Button("Save Chrome Trace")) {
+            const auto trace = profiler.ExportChromeTrace();
+            FILE* fp = fopen(trace_filename, "w");
+            if (fp != nullptr) {
+                fwrite(trace.data(), 1, trace.size(), fp);
+                fclose(fp);
+                save_status = std::string("Saved to ") + trace_filename;
+            } else {
+                save_status = std::string("Failed to open ") + trace_filename;
+            }
+        }
+        if (!save_status.empty()) {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(save_status.c_str());
+        }
 
+        bool is_hw_counters = profiler.GetIsHardwareCounters();
+        if (ImGui::Checkbox("Hardware Counters", &is_hw_counters)) {
+            profiler.SetIsHardwareCounters(is_hw_counters);
+        }
+        const int total_hw_counter_errors = profiler.GetTotalHardwareCounterErrors();
+        if (is_hw_counters && (total_hw_counter_errors > 0)) {
+            ImGui::SameLine();
+            ImGui::Text("Unavailable for %d scopes (needs perf_event_paranoid <= 2 on linux)", total_hw_counter_errors);
+        }
+
+        const auto threads = profiler.GetThreads();
+        ProfilerThread* thread = nullptr;
         const ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_NoBordersInBody;
         if (ImGui::BeginTable("Threads", 3, flags)) {
             // The first column will use the default _WidthStretch when ScrollX is Off and _WidthFixed when ScrollX is On
@@ -29,25 +63,23 @@ void RenderProfiler() {
             ImGui::TableHeadersRow();
 
             int row_id = 0;
-            auto lock = std::unique_lock(instrumentor.GetMutexThreadsList());
-            for (auto& [thread_id, instrumentor_thread]: instrumentor.GetThreadsList()) {
-                const bool is_selected = (thread == &instrumentor_thread);
-                const size_t thread_id_hash = thread_id_hasher(thread_id);
+            for (auto* profiler_thread: threads) {
+                if (!profiler_thread->GetIsActive()) continue;
+                const bool is_selected = (selected_thread_index == profiler_thread->GetIndex());
+                if (is_selected) {
+                    thread = profiler_thread;
+                }
 
                 ImGui::PushID(row_id++);
                 ImGui::TableNextRow();
                 ImGui::TableNextColumn();
-                ImGui::Text("%zu", thread_id_hash);
+                ImGui::Text("%d", profiler_thread->GetIndex());
                 ImGui::TableNextColumn();
-                if (ImGui::Selectable(instrumentor_thread.GetLabel(), is_selected, ImGuiSelectableFlags_SpanAllColumns)) {
-                    if (is_selected) {
-                        thread = nullptr;
-                    } else {
-                        thread = &instrumentor_thread;
-                    }
+                if (ImGui::Selectable(profiler_thread->GetLabel(), is_selected, ImGuiSelectableFlags_SpanAllColumns)) {
+                    selected_thread_index = is_selected ? -1 : profiler_thread->GetIndex();
                 }
                 ImGui::TableNextColumn();
-                const auto& data_opt = instrumentor_thread.GetData();
+                const auto data_opt = profiler_thread->GetData();
                 if (data_opt.has_value()) {
                     const auto& data = data_opt.value();
                     const size_t total_symbols = data.symbol_end-data.symbol_start;
@@ -63,73 +95,52 @@ void RenderProfiler() {
         if (ImGui::BeginTabBar("Trace Viewer", tab_bar_flags))
         {
             if ((thread != nullptr) && ImGui::BeginTabItem("Last Trace")) {
-                auto lock = std::scoped_lock(thread->GetPrevTraceMutex());
-                const auto& trace = thread->GetPrevTrace(); 
+                static std::vector<ProfileResult> events;
+                static std::vector<ProfileResult> trace;
+                thread->GetSnapshot(events);
+                GetLastTrace(events, trace);
                 RenderTrace(trace);
                 ImGui::EndTabItem();
             }
-            if ((thread != nullptr) && (thread->GetIsLogTraces()) && ImGui::BeginTabItem("Trace Logs")) {
-                auto lock = std::scoped_lock(thread->GetTraceLogsMutex());
-                const auto& traces = thread->GetTraceLogs();
-                RenderLoggedTraces(traces);
+            if (ImGui::BeginTabItem("Stages")) {
+                const auto summaries = profiler.GetStageSummaries();
+                RenderStageSummaries(summaries);
                 ImGui::EndTabItem();
             }
             ImGui::EndTabBar();
         }
-
+#endif
     }
     ImGui::End();
 }
 
-void RenderLoggedTraces(const InstrumentorThread::profile_trace_logger_t& traces) {
-    const InstrumentorThread::profile_trace_t* selected_trace = nullptr;
-
-    const ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_NoBordersInBody;
-    if (ImGui::BeginTable("Traces", 3, flags)) {
-        static uint64_t selected_key = 0;
-        // The first column will use the default _WidthStretch when ScrollX is Off and _WidthFixed when ScrollX is On
-        ImGui::TableSetupColumn("Length", ImGuiTableColumnFlags_NoHide);
-        ImGui::TableSetupColumn("Hash", ImGuiTableColumnFlags_NoHide);
-        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_NoHide);
-        ImGui::TableHeadersRow();
-
-        int row_id = 0;
-        for (auto& [key, log]: traces) {
-            const bool is_selected = (key == selected_key);
-            const int count = log.count;
-            auto& trace = log.trace;
-            if (is_selected) {
-                selected_trace = &trace;
-            }
-
-            ImGui::PushID(row_id++);
-            ImGui::TableNextRow();
-            ImGui::TableNextColumn();
-            ImGui::Text("%zu", trace.size());
-            ImGui::TableNextColumn();
-            static char hash_string[32];
-            snprintf(hash_string, sizeof(hash_string), "%" PRIx64, key);
-            if (ImGui::Selectable(hash_string, is_selected, ImGuiSelectableFlags_SpanAllColumns)) {
-                if (is_selected) {
-                    selected_key = 0;
-                } else {
-                    selected_key = key;
-                }
-            }
-            ImGui::TableNextColumn();
-            ImGui::Text("%d", count);
-            ImGui::PopID();
+#if PROFILE_ENABLE
+// Events are written when they finish so children come before their parent
+// Find the last outermost event and sort it and its children by their start time
+void GetLastTrace(const std::vector<ProfileResult>& events, std::vector<ProfileResult>& trace) {
+    trace.clear();
+    int root_index = -1;
+    for (int i = int(events.size())-1; i >= 0; i--) {
+        if (events[i].stack_index == 0) {
+            root_index = i;
+            break;
         }
-
-        ImGui::EndTable();
     }
-
-    if (selected_trace != nullptr) {
-        RenderTrace(*selected_trace);
+    if (root_index < 0) return;
+    const auto& root = events[root_index];
+    trace.push_back(root);
+    for (int i = root_index-1; i >= 0; i--) {
+        const auto& event = events[i];
+        if ((event.stack_index == 0) || (event.start < root.start)) break;
+        trace.push_back(event);
     }
+    std::stable_sort(trace.begin(), trace.end(), [](const ProfileResult& a, const ProfileResult& b) {
+        if (a.start != b.start) return a.start < b.start;
+        return a.stack_index < b.stack_index;
+    });
 }
 
-void RenderTrace(const InstrumentorThread::profile_trace_t& trace) {
+void RenderTrace(const std::vector<ProfileResult>& trace) {
     const int N = (int)trace.size();
     static ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_NoBordersInBody;
     if (ImGui::BeginTable("Results", 4, flags)) {
@@ -140,7 +151,7 @@ void RenderTrace(const InstrumentorThread::profile_trace_t& trace) {
         ImGui::TableSetupColumn("End (us)", ImGuiTableColumnFlags_NoHide);
         ImGui::TableHeadersRow();
 
-        // Keep track of position in tree 
+        // Keep track of position in tree
         int prev_stack_index = 0;
         bool show_node = true;
         for (int i = 0; i < N; i++) {
@@ -167,13 +178,13 @@ void RenderTrace(const InstrumentorThread::profile_trace_t& trace) {
                 show_node = is_open;
             } else {
                 ImGui::TreeNodeEx(result.name, ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_Bullet | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanFullWidth);
-            } 
+            }
             ImGui::TableNextColumn();
-            ImGui::Text("%" PRIi64, result.end-result.start);
+            ImGui::Text("%" PRIi64, (result.end-result.start)/1000);
             ImGui::TableNextColumn();
-            ImGui::Text("%" PRIi64, result.start);
+            ImGui::Text("%" PRIi64, result.start/1000);
             ImGui::TableNextColumn();
-            ImGui::Text("%" PRIi64, result.end);
+            ImGui::Text("%" PRIi64, result.end/1000);
         }
 
         while (prev_stack_index > 0) {
@@ -184,3 +195,38 @@ void RenderTrace(const InstrumentorThread::profile_trace_t& trace) {
         ImGui::EndTable();
     }
 }
+
+// Misses per thousand instructions and a low IPC point to a memory bound stage
+void RenderStageSummaries(const std::vector<ProfileStageSummary>& summaries) {
+    static ImGuiTableFlags flags = ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_NoBordersInBody;
+    if (ImGui::BeginTable("Stages", 7, flags)) {
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("Mean (us)", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("IPC", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("L1D MPKI", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("LLC MPKI", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("Branch MPKI", ImGuiTableColumnFlags_NoHide);
+        ImGui::TableHeadersRow();
+        for (const auto& summary: summaries) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(summary.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%" PRIu64, summary.total_calls);
+            ImGui::TableNextColumn();
+            const double mean_us = (summary.total_calls > 0) ? double(summary.total_ns)*1e-3/double(summary.total_calls) : 0.0;
+            ImGui::Text("%.1f", mean_us);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", summary.GetInstructionsPerCycle());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", summary.GetPerKiloInstructions(Profile_HW_Counter::L1D_MISSES));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", summary.GetPerKiloInstructions(Profile_HW_Counter::LLC_MISSES));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", summary.GetPerKiloInstructions(Profile_HW_Counter::BRANCH_MISSES));
+        }
+        ImGui::EndTable();
+    }
+}
+#endif
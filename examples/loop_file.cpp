@@ -1,9 +1,9 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <algorithm>
 #include <exception>
 #include <iostream>
 #include <string>
-#include <vector>
 
 #if _WIN32
 #include <io.h>
@@ -11,6 +11,7 @@
 #endif
 
 #include <argparse/argparse.hpp>
+#include "utility/mapped_file.h"
 
 void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("input")
@@ -26,7 +27,7 @@ void init_parser(argparse::ArgumentParser& parser) {
         .default_value(size_t(8192)).scan<'u', size_t>()
         .metavar("BLOCK_SIZE")
         .nargs(1).required()
-        .help("Number of bytes to read from the wav file in chunks");
+        .help("Number of bytes to write out in chunks");
 }
 
 struct Args {
@@ -62,11 +63,17 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    FILE* fp_in = fopen(args.input_filename.c_str(), "rb");
-    if (fp_in == nullptr) {
+    // The whole file is mapped once so looping doesn't copy, reopen or seek it
+    MappedFile file_in;
+    if (!file_in.open(args.input_filename)) {
         fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
         return 1;
     }
+    const auto data = file_in.get_bytes();
+    if (data.empty()) {
+        fprintf(stderr, "Input file is empty: '%s'\n", args.input_filename.c_str());
+        return 1;
+    }
 
     FILE* fp_out = stdout;
     if (!args.output_filename.empty()) {
@@ -78,23 +85,20 @@ int main(int argc, char** argv) {
     }
 
 #if _WIN32
-    _setmode(_fileno(fp_in), _O_BINARY);
     _setmode(_fileno(fp_out), _O_BINARY);
 #endif
 
     const size_t N = args.block_size;
-    auto block = std::vector<uint8_t>(N);
-
+    size_t offset = 0;
     while (true) {
-        const size_t nb_read = fread(block.data(), sizeof(uint8_t), N, fp_in);
-        const size_t nb_write = fwrite(block.data(), sizeof(uint8_t), nb_read, fp_out);
-        if (nb_write != nb_read) {
-            fprintf(stderr, "Failed to write out block %zu/%zu bytes. Exiting...\n", nb_write, nb_read);
+        const auto block = data.subspan(offset, std::min(N, data.size()-offset));
+        const size_t nb_write = fwrite(block.data(), sizeof(uint8_t), block.size(), fp_out);
+        if (nb_write != block.size()) {
+            fprintf(stderr, "Failed to write out block %zu/%zu bytes. Exiting...\n", nb_write, block.size());
             break;
         }
-        if (nb_read != N) {
-            fseek(fp_in, 0, SEEK_SET);
-        }
+        offset += block.size();
+        if (offset >= data.size()) offset = 0;
     }
     return 0;
 }
@@ -0,0 +1,540 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include <easylogging++.h>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_radio.h"
+#include "basic_scraper/basic_scraper.h"
+#include "dab/database/dab_database_types.h"
+#include "ofdm/fft_plan_cache.h"
+#include "utility/thread_affinity.h"
+#include "simd_dispatch.h"
+#include "./app_helpers/app_device_reader.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_linked_services.h"
+#include "./app_helpers/app_logging.h"
+#include "./app_helpers/app_managed_devices.h"
+#include "./app_helpers/app_mmap_file.h"
+#include "./app_helpers/app_multi_ensemble.h"
+#include "./app_helpers/app_ofdm_blocks.h"
+#include "./device/device.h"
+#include "./device/device_manager.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-i", "--input")
+        .default_value(std::vector<std::string>{})
+        .metavar("INPUT_FILENAME")
+        .append()
+        .help("Filename of the 8bit IQ input of an ensemble, repeat this for each ensemble");
+    parser.add_argument("-d", "--device")
+        .default_value(std::vector<std::string>{})
+        .metavar("SERIAL:CHANNEL")
+        .append()
+        .help("Tuner with this serial number tuned to a channel, repeat this for each ensemble after the input files");
+    // device settings
+    parser.add_argument("--device-reader-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the usb reader thread of each tuner with one core per tuner in order (e.g. 16-23)");
+    parser.add_argument("--device-gain")
+        .default_value(19.0f).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain of every tuner");
+    parser.add_argument("--device-auto-gain")
+        .default_value(false).implicit_value(true)
+        .help("Tuners use auto gain instead of manual gain");
+    parser.add_argument("--device-total-blocks")
+        .default_value(size_t(32)).scan<'u', size_t>()
+        .metavar("TOTAL_BLOCKS")
+        .nargs(1).required()
+        .help("Number of usb transfers of each tuner that can wait for its OFDM demodulator before they are dropped");
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Dab transmission mode of every ensemble");
+    // ofdm settings
+    parser.add_argument("--ofdm-block-size")
+        .default_value(size_t(65536)).scan<'u', size_t>()
+        .metavar("BLOCK_SIZE")
+        .nargs(1).required()
+        .help("Number of bytes each OFDM demodulator will read in each block");
+    parser.add_argument("--ofdm-total-threads")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of OFDM demodulator threads for each ensemble");
+    parser.add_argument("--ofdm-spin-park")
+        .default_value(false).implicit_value(true)
+        .help("OFDM demodulator threads spin briefly before sleeping to reduce wakeup latency");
+    parser.add_argument("--ofdm-inline")
+        .default_value(false).implicit_value(true)
+        .help("Demodulate each OFDM frame on the thread reading it without creating any threads");
+    parser.add_argument("--ofdm-use-radio-pool")
+        .default_value(false).implicit_value(true)
+        .help("Run the OFDM demodulators on the radio thread pool instead of their own threads");
+    parser.add_argument("--ofdm-int16")
+        .default_value(false).implicit_value(true)
+        .help("Demodulate the OFDM symbols in 16bit fixed point for targets without fast floating point");
+    parser.add_argument("--ofdm-skip-unused-symbols")
+        .default_value(false).implicit_value(true)
+        .help("Only demodulate the symbols of the FIC and the subchannels that are being decoded");
+    parser.add_argument("--ofdm-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the OFDM threads which are split evenly between ensembles (e.g. 0-7)");
+    parser.add_argument("--ofdm-disable-coarse-freq")
+        .default_value(false).implicit_value(true)
+        .help("Disable OFDM coarse frequency correction");
+    // radio settings
+    parser.add_argument("--radio-total-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of radio threads shared by every ensemble (0 = max number of threads)");
+    parser.add_argument("--radio-cores")
+        .default_value(std::string(""))
+        .metavar("CORES")
+        .nargs(1).required()
+        .help("Cores for the shared radio threads with one core per thread (e.g. 8-15)");
+    parser.add_argument("--radio-pipeline-depth")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("DEPTH")
+        .nargs(1).required()
+        .help("Number of frames each radio can decode concurrently (1 = no pipelining)");
+    parser.add_argument("--radio-decode-all")
+        .default_value(false).implicit_value(true)
+        .help("Decode the audio and data of every subchannel");
+    parser.add_argument("--radio-skip-linked-services")
+        .default_value(false).implicit_value(true)
+        .help("Decode services carried by several ensembles on only one of them and keep the others on standby");
+    parser.add_argument("--radio-enable-logging")
+        .default_value(false).implicit_value(true)
+        .help("Enable verbose logging for radio");
+    // scraper settings
+    parser.add_argument("--scraper-enable")
+        .default_value(false).implicit_value(true)
+        .help("Radio scraper will save the data of each ensemble to its own folder");
+    parser.add_argument("--scraper-output")
+        .default_value(std::string("data/scraper"))
+        .metavar("OUTPUT_FOLDER")
+        .nargs(1).required()
+        .help("Output folder for scraper");
+    parser.add_argument("--scraper-disable-logging")
+        .default_value(false).implicit_value(true)
+        .help("Disable verbose logging for scraper");
+    parser.add_argument("--scraper-encoded-only")
+        .default_value(false).implicit_value(true)
+        .help("Only save the AAC/MP2 frames without decoding them to a wav file");
+    // other
+    parser.add_argument("--stats-interval")
+        .default_value(float(10.0f)).scan<'g', float>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Seconds between reports of the CPU usage of each ensemble (0 = only at exit)");
+    parser.add_argument("--simd-level")
+        .default_value(std::string("auto"))
+        .choices("auto", "scalar", "sse4.1", "avx", "avx2", "avx512", "neon", "sve2", "rvv")
+        .metavar("LEVEL")
+        .nargs(1).required()
+        .help("Override the SIMD kernels selected for this CPU");
+    parser.add_argument("--fft-rigor")
+        .default_value(std::string("estimate"))
+        .choices("estimate", "measure", "patient")
+        .metavar("RIGOR")
+        .nargs(1).required()
+        .help("How long FFTW3 searches for the fastest FFT plans at startup");
+    parser.add_argument("--fft-wisdom")
+        .default_value(std::string(""))
+        .metavar("WISDOM_FILENAME")
+        .nargs(1).required()
+        .help("File that measured FFT plans are loaded from and saved to");
+    parser.add_argument("--numa-node")
+        .default_value(int(-1)).scan<'i', int>()
+        .metavar("NODE")
+        .nargs(1).required()
+        .help("Bind OFDM and radio threads to the cores of a NUMA node (-1 = any node)");
+    parser.add_argument("--thread-priority")
+        .default_value(std::string("default"))
+        .choices("default", "low", "high", "realtime")
+        .metavar("PRIORITY")
+        .nargs(1).required()
+        .help("Priority of the OFDM and radio threads (high/realtime may need elevated privileges)");
+}
+
+struct Args {
+    std::vector<std::string> input_files;
+    std::vector<std::string> devices;
+    int transmission_mode;
+    // device settings
+    std::string device_reader_cores;
+    float device_gain;
+    bool device_auto_gain;
+    size_t device_total_blocks;
+    // ofdm settings
+    size_t ofdm_block_size;
+    size_t ofdm_total_threads;
+    bool ofdm_spin_park;
+    bool ofdm_inline;
+    bool ofdm_use_radio_pool;
+    bool ofdm_int16;
+    bool ofdm_skip_unused_symbols;
+    std::string ofdm_cores;
+    bool ofdm_disable_coarse_freq;
+    // radio settings
+    size_t radio_total_threads;
+    std::string radio_cores;
+    size_t radio_pipeline_depth;
+    bool radio_decode_all;
+    bool radio_skip_linked_services;
+    bool radio_enable_logging;
+    // scraper settings
+    bool scraper_enable;
+    std::string scraper_output;
+    bool scraper_disable_logging;
+    bool scraper_encoded_only;
+    // other
+    float stats_interval;
+    std::string simd_level;
+    std::string fft_rigor;
+    std::string fft_wisdom;
+    int numa_node;
+    std::string thread_priority;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.input_files = parser.get<std::vector<std::string>>("--input");
+    args.devices = parser.get<std::vector<std::string>>("--device");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    // device settings
+    args.device_reader_cores = parser.get<std::string>("--device-reader-cores");
+    args.device_gain = parser.get<float>("--device-gain");
+    args.device_auto_gain = parser.get<bool>("--device-auto-gain");
+    args.device_total_blocks = parser.get<size_t>("--device-total-blocks");
+    // ofdm settings
+    args.ofdm_block_size = parser.get<size_t>("--ofdm-block-size");
+    args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
+    args.ofdm_spin_park = parser.get<bool>("--ofdm-spin-park");
+    args.ofdm_inline = parser.get<bool>("--ofdm-inline");
+    args.ofdm_use_radio_pool = parser.get<bool>("--ofdm-use-radio-pool");
+    args.ofdm_int16 = parser.get<bool>("--ofdm-int16");
+    args.ofdm_skip_unused_symbols = parser.get<bool>("--ofdm-skip-unused-symbols");
+    args.ofdm_cores = parser.get<std::string>("--ofdm-cores");
+    args.ofdm_disable_coarse_freq = parser.get<bool>("--ofdm-disable-coarse-freq");
+    // radio settings
+    args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
+    args.radio_cores = parser.get<std::string>("--radio-cores");
+    args.radio_pipeline_depth = parser.get<size_t>("--radio-pipeline-depth");
+    args.radio_decode_all = parser.get<bool>("--radio-decode-all");
+    args.radio_skip_linked_services = parser.get<bool>("--radio-skip-linked-services");
+    args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
+    // scraper settings
+    args.scraper_enable = parser.get<bool>("--scraper-enable");
+    args.scraper_output = parser.get<std::string>("--scraper-output");
+    args.scraper_disable_logging = parser.get<bool>("--scraper-disable-logging");
+    args.scraper_encoded_only = parser.get<bool>("--scraper-encoded-only");
+    // other
+    args.stats_interval = parser.get<float>("--stats-interval");
+    args.simd_level = parser.get<std::string>("--simd-level");
+    args.fft_rigor = parser.get<std::string>("--fft-rigor");
+    args.fft_wisdom = parser.get<std::string>("--fft-wisdom");
+    args.numa_node = parser.get<int>("--numa-node");
+    args.thread_priority = parser.get<std::string>("--thread-priority");
+    return args;
+}
+
+// Regular files are memory mapped and anything else such as a pipe from rtl_sdr is read with fread
+static std::shared_ptr<InputBuffer<RawIQ>> create_input_file(
+    const std::string& filename,
+    std::vector<std::shared_ptr<FileWrapper>>& files_in,
+    std::vector<std::shared_ptr<MappedFileReader>>& mapped_files_in)
+{
+    auto mapped_fp_in = std::make_shared<MappedFile>();
+    if (mapped_fp_in->open(filename)) {
+        auto input = std::make_shared<MappedInputFile<RawIQ>>(mapped_fp_in);
+        mapped_files_in.push_back(input);
+        return input;
+    }
+    FILE* fp_in = fopen(filename.c_str(), "rb");
+    if (fp_in == nullptr) {
+        return nullptr;
+    }
+#if _WIN32
+    _setmode(_fileno(fp_in), _O_BINARY);
+#endif
+    auto input = std::make_shared<InputFile<RawIQ>>(fp_in);
+    files_in.push_back(input);
+    return input;
+}
+
+// CPU usage is given as a percentage of one core over the elapsed time
+static void print_cpu_usage(
+    Multi_Ensemble_Runtime& runtime,
+    std::vector<Ensemble_CPU_Usage>& prev_usage, const double elapsed_seconds)
+{
+    const auto to_percent = [elapsed_seconds](const uint64_t ns) {
+        return (elapsed_seconds > 0.0) ? (double(ns)*1e-9 / elapsed_seconds * 100.0) : 0.0;
+    };
+    double total_percent = 0.0;
+    for (size_t i = 0; i < runtime.get_total_ensembles(); i++) {
+        const auto usage = runtime.get_cpu_usage(i);
+        const auto& prev = prev_usage[i];
+        const uint64_t ofdm_ns = (usage.ofdm_reader+usage.ofdm_threads) - (prev.ofdm_reader+prev.ofdm_threads);
+        const uint64_t radio_ns = (usage.radio_driver+usage.radio_pool) - (prev.radio_driver+prev.radio_pool);
+        const auto& ofdm_demod = runtime.get_ofdm_block(i).get_ofdm_demod();
+        const auto ofdm_status = ofdm_demod.GetStatus();
+        const auto signal_quality = ofdm_demod.GetSignalQuality();
+        fprintf(stderr,
+            "ensemble %zu: cpu=%.1f%% (ofdm=%.1f%%, radio=%.1f%%, radio_tasks=%llu) frames=%d desync=%d mer=%.1fdB\n",
+            i, to_percent(ofdm_ns+radio_ns), to_percent(ofdm_ns), to_percent(radio_ns),
+            (unsigned long long)(usage.radio_pool_tasks-prev.radio_pool_tasks),
+            ofdm_status.total_frames_read, ofdm_status.total_frames_desync, signal_quality.mer_db);
+        total_percent += to_percent(ofdm_ns+radio_ns);
+        prev_usage[i] = usage;
+    }
+    fprintf(stderr, "total: cpu=%.1f%% over %.1fs\n", total_percent, elapsed_seconds);
+}
+
+INITIALIZE_EASYLOGGINGPP
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("multi_radio_app", "0.1.0");
+    parser.add_description("Decodes many ensembles in one process with a shared radio thread pool");
+    parser.add_epilog(
+        "Each input is usually a named pipe from its own tuner, e.g.\n"
+        "mkfifo dab_a dab_b && (./rtl_sdr -c 9A -d 0 > dab_a &) && (./rtl_sdr -c 9C -d 1 > dab_b &)\n"
+        "./multi_radio_app -i dab_a -i dab_b\n"
+        "Or the tuners are opened by their serial numbers and reopened if they are unplugged, e.g.\n"
+        "./multi_radio_app -d 00000001:9A -d 00000002:9C --device-reader-cores 6-7"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    if (args.ofdm_block_size == 0) {
+        fprintf(stderr, "OFDM block size cannot be zero\n");
+        return 1;
+    }
+    if (args.input_files.empty() && args.devices.empty()) {
+        fprintf(stderr, "At least one input or device is required\n");
+        return 1;
+    }
+    if (args.device_total_blocks == 0) {
+        fprintf(stderr, "Device total blocks cannot be zero\n");
+        return 1;
+    }
+    std::vector<ManagedDeviceConfig> device_configs;
+    {
+        std::vector<int> reader_cores;
+        if (!parse_thread_cores(args.device_reader_cores.c_str(), reader_cores)) {
+            fprintf(stderr, "Invalid core list for --device-reader-cores: '%s'\n", args.device_reader_cores.c_str());
+            return 1;
+        }
+        for (const auto& arg: args.devices) {
+            ManagedDeviceConfig device_config;
+            if (!parse_managed_device_config(arg, device_config)) {
+                fprintf(stderr, "Invalid device '%s', expected SERIAL:CHANNEL with a channel from radio_app --list-channels\n", arg.c_str());
+                return 1;
+            }
+            device_config.is_auto_gain = args.device_auto_gain;
+            device_config.gain = args.device_gain;
+            if (!reader_cores.empty()) {
+                device_config.reader_affinity.cores.push_back(reader_cores[device_configs.size() % reader_cores.size()]);
+            }
+            device_configs.push_back(device_config);
+        }
+    }
+    if (args.simd_level.compare("auto") != 0) {
+        SIMD_Level simd_level;
+        if (!simd_get_level_from_name(args.simd_level.c_str(), simd_level) || !simd_set_level(simd_level)) {
+            fprintf(stderr, "SIMD level '%s' is not supported on this CPU (supported up to '%s')\n",
+                args.simd_level.c_str(), simd_get_level_name(simd_get_supported_level()));
+            return 1;
+        }
+    }
+    fprintf(stderr, "Using SIMD kernels for %s\n", simd_get_level_name(simd_get_level()));
+    FFT_Plan_Rigor fft_rigor = FFT_Plan_Rigor::ESTIMATE;
+    fft_get_plan_rigor_from_name(args.fft_rigor.c_str(), fft_rigor);
+    fft_set_plan_rigor(fft_rigor);
+    fprintf(stderr, "Using %s for FFTs\n", fft_get_backend_name());
+    if (!args.fft_wisdom.empty() && !fft_import_wisdom(args.fft_wisdom.c_str())) {
+        fprintf(stderr, "FFT wisdom will be created in '%s'\n", args.fft_wisdom.c_str());
+    }
+
+    Multi_Ensemble_Config config;
+    config.transmission_mode = args.transmission_mode;
+    config.ofdm_total_threads = args.ofdm_total_threads;
+    config.ofdm_sync_mode = args.ofdm_inline ? OFDM_Demod_Sync_Mode::INLINE :
+        args.ofdm_spin_park ? OFDM_Demod_Sync_Mode::SPIN_PARK : OFDM_Demod_Sync_Mode::BLOCKING;
+    config.ofdm_use_radio_pool = args.ofdm_use_radio_pool;
+    config.ofdm_precision = args.ofdm_int16 ? OFDM_Demod_Precision::INT16 : OFDM_Demod_Precision::FLOAT32;
+    config.ofdm_skip_unused_symbols = args.ofdm_skip_unused_symbols;
+    config.ofdm_affinity.numa_node = args.numa_node;
+    parse_thread_priority(args.thread_priority.c_str(), config.ofdm_affinity.priority);
+    config.radio_total_threads = args.radio_total_threads;
+    config.radio_affinity = config.ofdm_affinity;
+    const auto parse_cores = [](const std::string& name, const std::string& list, std::vector<int>& cores) {
+        if (!parse_thread_cores(list.c_str(), cores)) {
+            fprintf(stderr, "Invalid core list for %s: '%s'\n", name.c_str(), list.c_str());
+            return false;
+        }
+        return true;
+    };
+    if (
+        !parse_cores("--ofdm-cores", args.ofdm_cores, config.ofdm_affinity.cores) ||
+        !parse_cores("--radio-cores", args.radio_cores, config.radio_affinity.cores)
+    ) {
+        return 1;
+    }
+
+    std::vector<std::shared_ptr<FileWrapper>> files_in;
+    std::vector<std::shared_ptr<MappedFileReader>> mapped_files_in;
+    std::vector<std::shared_ptr<InputBuffer<RawIQ>>> raw_iq_inputs;
+    for (const auto& filename: args.input_files) {
+        auto input = create_input_file(filename, files_in, mapped_files_in);
+        if (input == nullptr) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", filename.c_str());
+            return 1;
+        }
+        raw_iq_inputs.push_back(input);
+    }
+    // each device has its own pool of blocks with one usb transfer per block
+    DeviceTransferConfig transfer_config;
+    transfer_config.transfer_size = 16*32*512;
+    auto device_manager = std::make_unique<DeviceManager>(transfer_config);
+    std::vector<std::shared_ptr<Device_Reader>> device_readers;
+    for (const auto& device_config: device_configs) {
+        auto reader = std::make_shared<Device_Reader>(size_t(transfer_config.transfer_size), args.device_total_blocks);
+        device_manager->add_device(device_config, [reader](tcb::span<const uint8_t> buf) {
+            return reader->write(buf);
+        });
+        device_readers.push_back(reader);
+        raw_iq_inputs.push_back(reader);
+    }
+    setup_easylogging(false, args.radio_enable_logging, !args.scraper_disable_logging);
+
+    const size_t total_ensembles = raw_iq_inputs.size();
+    auto runtime = std::make_unique<Multi_Ensemble_Runtime>(total_ensembles, config);
+    fprintf(stderr, "Decoding %zu ensembles with %zu shared radio threads\n",
+        total_ensembles, runtime->get_radio_pool().GetTotalThreads());
+    const auto& startup_times = runtime->get_startup_times();
+    fprintf(stderr, "Startup took %.3fs: radio_pool=%.3fs ensembles=%.3fs\n",
+        startup_times.get_total_seconds(), startup_times.radio_pool_seconds, startup_times.ensembles_seconds);
+    for (size_t i = 0; i < startup_times.ofdm.size(); i++) {
+        const auto& ofdm = startup_times.ofdm[i];
+        fprintf(stderr, "ensemble %zu ofdm startup: allocate=%.3fs fft_plans=%.3fs references=%.3fs threads=%.3fs\n",
+            i, ofdm.allocate_seconds, ofdm.fft_plans_seconds, ofdm.references_seconds, ofdm.threads_seconds);
+    }
+    // Save our plans straight away so they are kept even if we don't exit cleanly
+    if (!args.fft_wisdom.empty() && !fft_export_wisdom(args.fft_wisdom.c_str())) {
+        fprintf(stderr, "Failed to save FFT wisdom to '%s'\n", args.fft_wisdom.c_str());
+    }
+
+    const bool is_decode_channels = args.scraper_enable || args.radio_decode_all;
+    const bool is_encoded_audio = args.scraper_enable;
+    const bool is_decode_audio = args.radio_decode_all || !args.scraper_encoded_only;
+    const auto enable_controls = [is_encoded_audio, is_decode_audio](Basic_Audio_Controls& controls) {
+        controls.SetIsEncodedAudio(is_encoded_audio);
+        controls.SetIsDecodeAudio(is_decode_audio);
+        controls.SetIsDecodeData(true);
+        controls.SetIsPlayAudio(false);
+    };
+    std::vector<std::shared_ptr<BasicScraper>> scrapers;
+    for (size_t i = 0; i < total_ensembles; i++) {
+        auto ofdm_convert_raw_iq = std::make_shared<OFDM_Convert_RawIQ>();
+        ofdm_convert_raw_iq->set_input_stream(raw_iq_inputs[i]);
+        runtime->set_input_stream(i, ofdm_convert_raw_iq);
+        // the input files come before the devices
+        runtime->set_is_ring_blocking(i, i < args.input_files.size());
+        auto& config_ofdm = runtime->get_ofdm_block(i).get_ofdm_demod().GetConfig();
+        config_ofdm.sync.is_coarse_freq_correction = !args.ofdm_disable_coarse_freq;
+
+        auto& basic_radio = runtime->get_radio_block(i).get_basic_radio();
+        basic_radio.SetPipelineDepth(args.radio_pipeline_depth);
+        if (args.scraper_enable) {
+            const auto scraper_output = args.scraper_output + "/ensemble_" + std::to_string(i);
+            auto basic_scraper = std::make_shared<BasicScraper>(scraper_output, args.scraper_encoded_only);
+            fprintf(stderr, "ensemble %zu scraper is writing to folder '%s'\n", i, scraper_output.c_str());
+            BasicScraper::attach_to_radio(basic_scraper, basic_radio);
+            scrapers.push_back(basic_scraper);
+        }
+        if (is_decode_channels && !args.radio_skip_linked_services) {
+            basic_radio.On_Audio_Channel().Attach(
+                [enable_controls](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+                    enable_controls(channel.GetControls());
+                }
+            );
+        }
+    }
+    // the coordinator enables the channels itself so duplicates of a service can be put on standby
+    std::unique_ptr<Linked_Service_Coordinator> linked_services = nullptr;
+    if (is_decode_channels && args.radio_skip_linked_services) {
+        linked_services = std::make_unique<Linked_Service_Coordinator>(*runtime, Linked_Service_Config{}, enable_controls);
+    }
+
+    for (size_t i = 0; i < device_configs.size(); i++) {
+        fprintf(stderr, "ensemble %zu reads from device %s on %s\n",
+            args.input_files.size()+i, device_configs[i].serial.c_str(), device_configs[i].channel_label.c_str());
+    }
+    device_manager->start();
+    runtime->start(args.ofdm_block_size);
+    std::vector<Ensemble_CPU_Usage> prev_usage(total_ensembles);
+    const auto time_start = std::chrono::steady_clock::now();
+    auto time_report = time_start;
+    constexpr auto POLL_PERIOD = std::chrono::milliseconds(100);
+    while (!runtime->is_finished()) {
+        std::this_thread::sleep_for(POLL_PERIOD);
+        if (linked_services != nullptr) linked_services->update();
+        if (args.stats_interval <= 0.0f) continue;
+        const auto time_now = std::chrono::steady_clock::now();
+        const double elapsed_seconds = std::chrono::duration<double>(time_now - time_report).count();
+        if (elapsed_seconds < double(args.stats_interval)) continue;
+        print_cpu_usage(*runtime, prev_usage, elapsed_seconds);
+        print_managed_device_status(*device_manager, device_readers);
+        if (linked_services != nullptr) {
+            const auto status = linked_services->get_status();
+            fprintf(stderr, "linked services: groups=%zu standby=%zu failovers=%zu\n",
+                status.total_groups, status.total_standby, status.total_failovers);
+        }
+        time_report = time_now;
+    }
+    device_manager->stop();
+    for (auto& reader: device_readers) reader->close();
+    runtime->join();
+
+    // report usage over the whole run for capacity planning
+    const auto time_end = std::chrono::steady_clock::now();
+    std::fill(prev_usage.begin(), prev_usage.end(), Ensemble_CPU_Usage{});
+    print_cpu_usage(*runtime, prev_usage, std::chrono::duration<double>(time_end - time_start).count());
+    const int total_affinity_errors = runtime->get_total_thread_affinity_errors();
+    if (total_affinity_errors > 0) {
+        fprintf(stderr, "Failed to apply thread affinity or priority to %d threads\n", total_affinity_errors);
+    }
+    runtime = nullptr;
+    for (auto& file_in: files_in) file_in->close();
+    for (auto& mapped_file_in: mapped_files_in) mapped_file_in->close();
+    return 0;
+}
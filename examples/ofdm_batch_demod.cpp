@@ -0,0 +1,193 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <complex>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include "utility/span.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/fft_plan_cache.h"
+#include "ofdm/iq_file_reader.h"
+#include "ofdm/ofdm_batch_demodulator.h"
+#include "viterbi_config.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-i", "--input")
+        .metavar("INPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of the IQ recording (must be a file so it can be memory mapped)");
+    parser.add_argument("--input-format")
+        .default_value(std::string("u8"))
+        .choices("u8", "s8", "s16", "f32")
+        .metavar("FORMAT")
+        .nargs(1).required()
+        .help("Sample format of a raw recording (wav files use the format in their header)");
+    parser.add_argument("-o", "--output")
+        .default_value(std::string(""))
+        .metavar("OUTPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of the OFDM soft bits (defaults to stdout)");
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Dab transmission mode");
+    parser.add_argument("--total-workers")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_WORKERS")
+        .nargs(1).required()
+        .help("Number of segments demodulated at once (0 = max number of threads)");
+    parser.add_argument("--frames-per-segment")
+        .default_value(size_t(16)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Maximum number of consecutive frames demodulated by a worker at once");
+    parser.add_argument("--disable-coarse-freq")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Disables coarse frequency correction");
+    parser.add_argument("--fft-rigor")
+        .default_value(std::string("estimate"))
+        .choices("estimate", "measure", "patient")
+        .metavar("RIGOR")
+        .nargs(1).required()
+        .help("How long FFTW3 searches for the fastest FFT plans at startup");
+    parser.add_argument("--fft-wisdom")
+        .default_value(std::string(""))
+        .metavar("WISDOM_FILENAME")
+        .nargs(1).required()
+        .help("File that measured FFT plans are loaded from and saved to");
+}
+
+struct Args {
+    std::string input_filename;
+    std::string input_format;
+    std::string output_filename;
+    int transmission_mode;
+    size_t total_workers;
+    size_t frames_per_segment;
+    bool is_disable_coarse_freq;
+    std::string fft_rigor;
+    std::string fft_wisdom;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.input_filename = parser.get<std::string>("--input");
+    args.input_format = parser.get<std::string>("--input-format");
+    args.output_filename = parser.get<std::string>("--output");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    args.total_workers = parser.get<size_t>("--total-workers");
+    args.frames_per_segment = parser.get<size_t>("--frames-per-segment");
+    args.is_disable_coarse_freq = parser.get<bool>("--disable-coarse-freq");
+    args.fft_rigor = parser.get<std::string>("--fft-rigor");
+    args.fft_wisdom = parser.get<std::string>("--fft-wisdom");
+    return args;
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("ofdm_batch_demod", "0.1.0");
+    parser.add_description("Demodulates a recorded IQ file into OFDM soft bits using all cores");
+    parser.add_epilog(
+        "Many frames are demodulated at once so this runs faster than real time on multicore systems.\n"
+        "The output can be decoded with: basic_radio_app -i [FILENAME] --configuration dab"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+
+    if (args.frames_per_segment == 0) {
+        fprintf(stderr, "Frames per segment cannot be zero\n");
+        return 1;
+    }
+
+    IQ_File_Format input_format = IQ_File_Format::U8;
+    get_iq_file_format_from_name(args.input_format.c_str(), input_format);
+    IQ_File_Reader file_in;
+    if (!file_in.Open(args.input_filename, input_format)) {
+        fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+        return 1;
+    }
+    if (file_in.GetIsWav()) {
+        fprintf(stderr, "Reading %s IQ from wav file\n", get_iq_file_format_name(file_in.GetFormat()));
+    }
+
+    FILE* fp_out = stdout;
+    if (!args.output_filename.empty()) {
+        fp_out = fopen(args.output_filename.c_str(), "wb+");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", args.output_filename.c_str());
+            return 1;
+        }
+    }
+
+#if _WIN32
+    _setmode(_fileno(fp_out), _O_BINARY);
+#endif
+
+    FFT_Plan_Rigor fft_rigor = FFT_Plan_Rigor::ESTIMATE;
+    fft_get_plan_rigor_from_name(args.fft_rigor.c_str(), fft_rigor);
+    fft_set_plan_rigor(fft_rigor);
+    if (!args.fft_wisdom.empty() && !fft_import_wisdom(args.fft_wisdom.c_str())) {
+        fprintf(stderr, "FFT wisdom will be created in '%s'\n", args.fft_wisdom.c_str());
+    }
+
+    const auto& tables = get_DAB_OFDM_tables(args.transmission_mode);
+    const auto& ofdm_params = tables.params;
+
+    auto batch_demod = OFDM_Batch_Demod(
+        ofdm_params, tables.prs_fft_ref, tables.carrier_mapper,
+        args.total_workers, args.frames_per_segment);
+    batch_demod.GetConfig().sync.is_coarse_freq_correction = !args.is_disable_coarse_freq;
+    if (!args.fft_wisdom.empty() && !fft_export_wisdom(args.fft_wisdom.c_str())) {
+        fprintf(stderr, "Failed to save FFT wisdom to '%s'\n", args.fft_wisdom.c_str());
+    }
+
+    bool is_write_error = false;
+    batch_demod.On_OFDM_Frame().Attach([fp_out, &is_write_error](tcb::span<const viterbi_bit_t> buf) {
+        if (is_write_error) return;
+        const size_t nb_write = fwrite(buf.data(), sizeof(viterbi_bit_t), buf.size(), fp_out);
+        if (nb_write != buf.size()) {
+            fprintf(stderr, "Failed to write out frame %zu/%zu\n", nb_write, buf.size());
+            is_write_error = true;
+        }
+    });
+
+    // The recording is converted by each worker as it reads so no copy of the whole file is made
+    auto reader = [&file_in](const size_t offset, tcb::span<std::complex<float>> buf) {
+        file_in.Convert(offset, buf);
+    };
+
+    const auto time_start = std::chrono::steady_clock::now();
+    batch_demod.Process(reader, file_in.GetTotalSamples());
+    const auto time_end = std::chrono::steady_clock::now();
+    const double elapsed_seconds = std::chrono::duration<double>(time_end - time_start).count();
+
+    if (fp_out != stdout) {
+        fclose(fp_out);
+    }
+
+    fprintf(stderr, "Read %zu/%zu frames with %zu workers in %.3fs\n",
+        batch_demod.GetTotalFramesRead(), batch_demod.GetTotalFramesExpected(),
+        batch_demod.GetTotalWorkers(), elapsed_seconds);
+    if (batch_demod.GetTotalSegmentsDesync() > 0) {
+        fprintf(stderr, "Lost synchronisation in %zu segments\n", batch_demod.GetTotalSegmentsDesync());
+    }
+    return is_write_error ? 1 : 0;
+}
@@ -0,0 +1,439 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <complex>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/complex.h>
+#include <pybind11/stl.h>
+
+#include "utility/span.h"
+#include "utility/buffer_pool.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "ofdm/iq_file_reader.h"
+#include "ofdm/parallel_frequency_shift.h"
+#include "ofdm/dsp/apply_pll.h"
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_audio_buffer.h"
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_dab_channel.h"
+#include "basic_radio/basic_dab_plus_channel.h"
+#include "viterbi_config.h"
+#include "../app_helpers/app_logging.h"
+
+namespace py = pybind11;
+
+// Python bindings for prototyping analysis in notebooks
+// - Inputs are taken through the buffer protocol (e.g. numpy arrays) without copying
+// - The GIL is released while the library processes so other python threads keep running
+// - Outputs are queued by the library threads and read by python as Buffer objects
+//   A Buffer is a read only view over library owned storage. Use memoryview(buf) or numpy.frombuffer(buf)
+//   Pooled storage is returned to its pool once python drops every view of it
+// NOTE: Observers only push into queues so no python code is run on the library threads
+
+// Read only view of library owned memory exposed through the buffer protocol
+struct Py_Buffer_View {
+    std::shared_ptr<const void> owner;
+    const void* data = nullptr;
+    size_t total_items = 0;
+    size_t item_size = 1;
+    std::string format = py::format_descriptor<uint8_t>::format();
+};
+
+template <typename T>
+static Py_Buffer_View create_view(std::shared_ptr<const void> owner, tcb::span<const T> data) {
+    Py_Buffer_View view;
+    view.owner = std::move(owner);
+    view.data = data.data();
+    view.total_items = data.size();
+    view.item_size = sizeof(T);
+    view.format = py::format_descriptor<T>::format();
+    return view;
+}
+
+// Data that is only valid during a callback is copied once into pooled storage
+template <typename T>
+static Py_Buffer_View copy_to_pooled_view(tcb::span<const uint8_t> header, tcb::span<const T> data) {
+    const size_t total_bytes = header.size() + data.size_bytes();
+    auto buffer = std::make_shared<Pooled_Buffer>(Buffer_Pool::GetGlobal().Acquire(total_bytes));
+    buffer->resize(total_bytes);
+    if (!header.empty()) memcpy(buffer->data(), header.data(), header.size());
+    if (!data.empty()) memcpy(buffer->data() + header.size(), data.data(), data.size_bytes());
+    const auto* items = reinterpret_cast<const T*>(buffer->data());
+    return create_view<T>(buffer, { items, total_bytes/sizeof(T) });
+}
+
+// Thread safe queue from the library threads to python
+// The oldest items are dropped if python doesn't keep up so memory stays bounded
+template <typename T>
+class Py_Queue
+{
+private:
+    std::mutex m_mutex;
+    std::deque<T> m_items;
+    const size_t m_max_items;
+    size_t m_total_dropped = 0;
+public:
+    explicit Py_Queue(const size_t max_items): m_max_items(std::max(max_items, size_t(1))) {}
+    void Push(T&& item) {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_items.size() >= m_max_items) {
+            m_items.pop_front();
+            m_total_dropped++;
+        }
+        m_items.push_back(std::move(item));
+    }
+    std::vector<T> PopAll() {
+        auto lock = std::scoped_lock(m_mutex);
+        std::vector<T> items(std::make_move_iterator(m_items.begin()), std::make_move_iterator(m_items.end()));
+        m_items.clear();
+        return items;
+    }
+    size_t GetTotalDropped() {
+        auto lock = std::scoped_lock(m_mutex);
+        return m_total_dropped;
+    }
+};
+
+// Checks that a python buffer is one contiguous run of T
+template <typename T>
+static tcb::span<const T> get_buffer_span(const py::buffer_info& info, const char* name) {
+    if (info.format != py::format_descriptor<T>::format()) {
+        throw py::value_error(std::string(name) + " has format '" + info.format + "' but expected '" + py::format_descriptor<T>::format() + "'");
+    }
+    if (size_t(info.itemsize) != sizeof(T)) {
+        throw py::value_error(std::string(name) + " has the wrong item size");
+    }
+    py::ssize_t stride = info.itemsize;
+    for (py::ssize_t i = info.ndim-1; i >= 0; i--) {
+        if ((info.shape[i] > 1) && (info.strides[i] != stride)) {
+            throw py::value_error(std::string(name) + " must be contiguous");
+        }
+        stride *= info.shape[i];
+    }
+    return { reinterpret_cast<const T*>(info.ptr), size_t(info.size) };
+}
+
+template <typename T>
+static tcb::span<T> get_writable_buffer_span(const py::buffer_info& info, const char* name) {
+    if (info.readonly) {
+        throw py::value_error(std::string(name) + " must be writable");
+    }
+    const auto data = get_buffer_span<T>(info, name);
+    return { const_cast<T*>(data.data()), data.size() };
+}
+
+class Py_OFDM_Demod
+{
+private:
+    Py_Queue<Py_Buffer_View> m_frames;
+    std::unique_ptr<OFDM_Demod> m_demod;
+public:
+    Py_OFDM_Demod(const int transmission_mode, const int total_threads, const size_t max_queued_frames)
+    : m_frames(max_queued_frames)
+    {
+        const auto& tables = get_DAB_OFDM_tables(transmission_mode);
+        m_demod = std::make_unique<OFDM_Demod>(tables.params, tables.prs_fft_ref, tables.carrier_mapper, total_threads);
+        m_demod->On_OFDM_Frame().Attach([this](tcb::span<const viterbi_bit_t> bits) {
+            m_frames.Push(copy_to_pooled_view<viterbi_bit_t>({}, bits));
+        });
+    }
+    // complex64 samples or interleaved uint8/int8 IQ
+    void Process(const py::buffer& samples) {
+        const auto info = samples.request();
+        if (info.format == py::format_descriptor<std::complex<float>>::format()) {
+            const auto data = get_buffer_span<std::complex<float>>(info, "samples");
+            py::gil_scoped_release release;
+            m_demod->Process(data);
+        } else if (info.format == py::format_descriptor<uint8_t>::format()) {
+            const auto data = get_buffer_span<uint8_t>(info, "samples");
+            py::gil_scoped_release release;
+            m_demod->Process(tcb::span<const RawIQ_u8>(reinterpret_cast<const RawIQ_u8*>(data.data()), data.size()/2));
+        } else if (info.format == py::format_descriptor<int8_t>::format()) {
+            const auto data = get_buffer_span<int8_t>(info, "samples");
+            py::gil_scoped_release release;
+            m_demod->Process(tcb::span<const RawIQ_s8>(reinterpret_cast<const RawIQ_s8*>(data.data()), data.size()/2));
+        } else {
+            throw py::value_error("samples must be complex64, uint8 or int8 but got format '" + info.format + "'");
+        }
+    }
+    void Flush() {
+        py::gil_scoped_release release;
+        m_demod->Flush();
+    }
+    void Reset() {
+        py::gil_scoped_release release;
+        m_demod->Reset();
+    }
+    std::vector<Py_Buffer_View> ReadFrames() { return m_frames.PopAll(); }
+    size_t GetTotalFramesDropped() { return m_frames.GetTotalDropped(); }
+    py::dict GetStatus() const {
+        const auto status = m_demod->GetStatus();
+        py::dict d;
+        d["state"] = int(status.state);
+        d["signal_l1_average"] = status.signal_l1_average;
+        d["coarse_freq_offset"] = status.coarse_freq_offset;
+        d["fine_freq_offset"] = status.fine_freq_offset;
+        d["is_coarse_freq_locked"] = status.is_coarse_freq_locked;
+        d["fine_time_offset"] = status.fine_time_offset;
+        d["sample_rate_offset"] = status.sample_rate_offset;
+        d["total_frames_read"] = status.total_frames_read;
+        d["total_frames_desync"] = status.total_frames_desync;
+        return d;
+    }
+};
+
+struct Py_Audio_Block {
+    subchannel_id_t subchannel_id;
+    Basic_Audio_Buffer_Ref buffer;
+};
+
+struct Py_Encoded_Frame {
+    subchannel_id_t subchannel_id;
+    Py_Buffer_View data;
+};
+
+struct Py_Dynamic_Label {
+    subchannel_id_t subchannel_id;
+    std::string label;
+};
+
+struct Py_Radio_Channel_Settings {
+    bool is_decode_audio = true;
+    bool is_encoded_audio = true;
+    bool is_decode_data = true;
+};
+
+class Py_BasicRadio
+{
+private:
+    const Py_Radio_Channel_Settings m_settings;
+    Py_Queue<Py_Audio_Block> m_audio;
+    Py_Queue<Py_Encoded_Frame> m_encoded;
+    Py_Queue<Py_Dynamic_Label> m_labels;
+    // destroyed first so no observer pushes into the queues afterwards
+    std::unique_ptr<BasicRadio> m_radio;
+public:
+    Py_BasicRadio(
+        const int transmission_mode, const size_t total_threads, const size_t max_queued_items,
+        const Py_Radio_Channel_Settings& settings)
+    : m_settings(settings), m_audio(max_queued_items), m_encoded(max_queued_items), m_labels(max_queued_items)
+    {
+        m_radio = std::make_unique<BasicRadio>(get_dab_parameters(transmission_mode), total_threads);
+        m_radio->On_Audio_Channel().Attach([this](subchannel_id_t id, Basic_Audio_Channel& channel) {
+            auto& controls = channel.GetControls();
+            controls.SetIsDecodeAudio(m_settings.is_decode_audio);
+            controls.SetIsEncodedAudio(m_settings.is_encoded_audio);
+            controls.SetIsDecodeData(m_settings.is_decode_data);
+            // pooled PCM buffers are shared with python without copying
+            channel.OnAudioBuffer().Attach([this, id](const Basic_Audio_Buffer_Ref& buffer) {
+                m_audio.Push({ id, buffer });
+            });
+            channel.OnDynamicLabel().Attach([this, id](std::string_view label) {
+                m_labels.Push({ id, std::string(label) });
+            });
+            if (channel.GetType() == AudioServiceType::DAB_PLUS) {
+                auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+                // access units are prefixed with their ADTS header so each one can be decoded on its own
+                derived.OnAACData().Attach([this, id](auto superframe_header, auto mpeg4_header, auto buf) {
+                    (void)superframe_header;
+                    m_encoded.Push({ id, copy_to_pooled_view<uint8_t>(mpeg4_header, buf) });
+                });
+            } else {
+                auto& derived = dynamic_cast<Basic_DAB_Channel&>(channel);
+                derived.OnMP2Data().Attach([this, id](tcb::span<const uint8_t> data) {
+                    m_encoded.Push({ id, copy_to_pooled_view<uint8_t>({}, data) });
+                });
+            }
+        });
+    }
+    // int8 soft bits of one frame such as a Buffer from OFDM_Demod.read_frames()
+    void Process(const py::buffer& frame) {
+        const auto info = frame.request();
+        const auto data = get_buffer_span<viterbi_bit_t>(info, "frame");
+        py::gil_scoped_release release;
+        m_radio->Process(data);
+    }
+    void Flush() {
+        py::gil_scoped_release release;
+        m_radio->Flush();
+    }
+    // Returns (subchannel_id, sample_rate, is_stereo, pcm) where pcm holds int16 samples
+    py::list ReadAudio() {
+        py::list items;
+        for (auto& block: m_audio.PopAll()) {
+            const auto& params = block.buffer->params;
+            const auto data = block.buffer->GetData();
+            Py_Buffer_View view;
+            if (params.bytes_per_sample == sizeof(int16_t)) {
+                view = create_view<int16_t>(block.buffer, { reinterpret_cast<const int16_t*>(data.data()), data.size()/sizeof(int16_t) });
+            } else {
+                view = create_view<uint8_t>(block.buffer, data);
+            }
+            items.append(py::make_tuple(block.subchannel_id, params.frequency, params.is_stereo, view));
+        }
+        return items;
+    }
+    // Returns (subchannel_id, frame) where frame is an AAC access unit with an ADTS header or an MP2 frame
+    py::list ReadEncodedAudio() {
+        py::list items;
+        for (auto& frame: m_encoded.PopAll()) {
+            items.append(py::make_tuple(frame.subchannel_id, std::move(frame.data)));
+        }
+        return items;
+    }
+    py::list ReadDynamicLabels() {
+        py::list items;
+        for (auto& label: m_labels.PopAll()) {
+            items.append(py::make_tuple(label.subchannel_id, py::str(label.label)));
+        }
+        return items;
+    }
+    py::list GetServices() {
+        const auto db = m_radio->GetDatabaseSnapshot();
+        py::list services;
+        if (db == nullptr) return services;
+        for (const auto& service: db->services) {
+            py::list subchannels;
+            for (const auto& component: db->service_components) {
+                if (component.service_reference != service.reference) continue;
+                subchannels.append(component.subchannel_id);
+            }
+            py::dict d;
+            d["service_id"] = service.reference;
+            d["label"] = py::str(std::string(service.label.view()));
+            d["subchannels"] = subchannels;
+            services.append(d);
+        }
+        return services;
+    }
+    size_t GetTotalDropped() {
+        return m_audio.GetTotalDropped() + m_encoded.GetTotalDropped() + m_labels.GetTotalDropped();
+    }
+};
+
+class Py_IQ_File_Reader
+{
+private:
+    std::shared_ptr<IQ_File_Reader> m_reader;
+public:
+    Py_IQ_File_Reader(const std::string& filename, const std::string& raw_format) {
+        IQ_File_Format format = IQ_File_Format::U8;
+        if (!get_iq_file_format_from_name(raw_format.c_str(), format)) {
+            throw py::value_error("Unknown IQ format '" + raw_format + "'");
+        }
+        m_reader = std::make_shared<IQ_File_Reader>();
+        if (!m_reader->Open(filename, format)) {
+            throw std::runtime_error("Failed to open IQ file '" + filename + "'");
+        }
+    }
+    // The mapped samples without their header which stay valid while any view of them is alive
+    Py_Buffer_View GetData() const { return create_view<uint8_t>(m_reader, m_reader->GetData()); }
+    size_t Convert(const size_t offset, const py::buffer& out) {
+        const auto info = out.request(true);
+        const auto y = get_writable_buffer_span<std::complex<float>>(info, "out");
+        py::gil_scoped_release release;
+        return m_reader->Convert(offset, y);
+    }
+    const IQ_File_Reader& Get() const { return *m_reader; }
+};
+
+INITIALIZE_EASYLOGGINGPP
+PYBIND11_MODULE(dab_radio, m) {
+    m.doc() = "Bindings of the DAB OFDM demodulator, radio and DSP helpers";
+    setup_easylogging(false, false, false);
+
+    m.def("set_logging", [](bool is_default, bool is_basic_radio) {
+        setup_easylogging(is_default, is_basic_radio, false);
+    }, py::arg("is_default")=false, py::arg("is_basic_radio")=false);
+
+    py::class_<Py_Buffer_View>(m, "Buffer", py::buffer_protocol())
+        .def_buffer([](Py_Buffer_View& view) {
+            return py::buffer_info(
+                const_cast<void*>(view.data), py::ssize_t(view.item_size), view.format, 1,
+                { py::ssize_t(view.total_items) }, { py::ssize_t(view.item_size) }, true);
+        })
+        .def("__len__", [](const Py_Buffer_View& view) { return view.total_items; });
+
+    py::class_<Py_OFDM_Demod>(m, "OFDM_Demod")
+        .def(py::init<int, int, size_t>(),
+            py::arg("transmission_mode")=1, py::arg("total_threads")=0, py::arg("max_queued_frames")=64)
+        .def("process", &Py_OFDM_Demod::Process, py::arg("samples"))
+        .def("flush", &Py_OFDM_Demod::Flush)
+        .def("reset", &Py_OFDM_Demod::Reset)
+        .def("read_frames", &Py_OFDM_Demod::ReadFrames)
+        .def("get_status", &Py_OFDM_Demod::GetStatus)
+        .def_property_readonly("total_frames_dropped", &Py_OFDM_Demod::GetTotalFramesDropped);
+
+    py::class_<Py_BasicRadio>(m, "BasicRadio")
+        .def(py::init([](int transmission_mode, size_t total_threads, size_t max_queued_items,
+                         bool decode_audio, bool encoded_audio, bool decode_data) {
+                Py_Radio_Channel_Settings settings;
+                settings.is_decode_audio = decode_audio;
+                settings.is_encoded_audio = encoded_audio;
+                settings.is_decode_data = decode_data;
+                return std::make_unique<Py_BasicRadio>(transmission_mode, total_threads, max_queued_items, settings);
+            }),
+            py::arg("transmission_mode")=1, py::arg("total_threads")=0, py::arg("max_queued_items")=1024,
+            py::arg("decode_audio")=true, py::arg("encoded_audio")=true, py::arg("decode_data")=true)
+        .def("process", &Py_BasicRadio::Process, py::arg("frame"))
+        .def("flush", &Py_BasicRadio::Flush)
+        .def("read_audio", &Py_BasicRadio::ReadAudio)
+        .def("read_encoded_audio", &Py_BasicRadio::ReadEncodedAudio)
+        .def("read_dynamic_labels", &Py_BasicRadio::ReadDynamicLabels)
+        .def("get_services", &Py_BasicRadio::GetServices)
+        .def_property_readonly("total_dropped", &Py_BasicRadio::GetTotalDropped);
+
+    py::class_<Py_IQ_File_Reader>(m, "IQ_File_Reader")
+        .def(py::init<const std::string&, const std::string&>(), py::arg("filename"), py::arg("raw_format")="u8")
+        .def_property_readonly("data", &Py_IQ_File_Reader::GetData)
+        .def_property_readonly("format", [](const Py_IQ_File_Reader& r) { return get_iq_file_format_name(r.Get().GetFormat()); })
+        .def_property_readonly("sample_rate", [](const Py_IQ_File_Reader& r) { return r.Get().GetSampleRate(); })
+        .def_property_readonly("total_samples", [](const Py_IQ_File_Reader& r) { return r.Get().GetTotalSamples(); })
+        .def("convert", &Py_IQ_File_Reader::Convert, py::arg("offset"), py::arg("out"));
+
+    // DSP helpers write into a caller provided complex64 array so nothing is allocated
+    m.def("convert_raw_iq", [](const py::buffer& x, const py::buffer& y) {
+        const auto x_info = x.request();
+        const auto y_info = y.request(true);
+        const auto x_data = get_buffer_span<uint8_t>(x_info, "x");
+        const auto y_data = get_writable_buffer_span<std::complex<float>>(y_info, "y");
+        if (x_data.size() != 2*y_data.size()) throw py::value_error("x must have 2 values for each sample of y");
+        py::gil_scoped_release release;
+        convert_raw_iq_auto(x_data, y_data);
+    }, py::arg("x"), py::arg("y"));
+
+    m.def("apply_pll", [](const py::buffer& x, const py::buffer& y, float freq_norm, float dt_norm) {
+        const auto x_info = x.request();
+        const auto y_info = y.request(true);
+        const auto x_data = get_buffer_span<std::complex<float>>(x_info, "x");
+        const auto y_data = get_writable_buffer_span<std::complex<float>>(y_info, "y");
+        if (x_data.size() != y_data.size()) throw py::value_error("x and y must be the same length");
+        py::gil_scoped_release release;
+        apply_pll_auto(x_data, y_data, freq_norm, dt_norm);
+    }, py::arg("x"), py::arg("y"), py::arg("freq_norm"), py::arg("dt_norm")=0.0f);
+
+    m.def("apply_frequency_shift", [](const py::buffer& x, const py::buffer& y, float freq_norm, float dt_norm, size_t total_threads) {
+        const auto x_info = x.request();
+        const auto y_info = y.request(true);
+        const auto x_data = get_buffer_span<std::complex<float>>(x_info, "x");
+        const auto y_data = get_writable_buffer_span<std::complex<float>>(y_info, "y");
+        if (x_data.size() != y_data.size()) throw py::value_error("x and y must be the same length");
+        Parallel_Frequency_Shift_Config config;
+        config.total_threads = total_threads;
+        py::gil_scoped_release release;
+        apply_frequency_shift_parallel(x_data, y_data, freq_norm, dt_norm, config);
+    }, py::arg("x"), py::arg("y"), py::arg("freq_norm"), py::arg("dt_norm")=0.0f, py::arg("total_threads")=0);
+}
@@ -26,8 +26,11 @@
 #include "dab/database/dab_database_types.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
+#include "./app_helpers/app_acquisition_cache.h"
 #include "./app_helpers/app_audio.h"
 #include "./app_helpers/app_common_gui.h"
+#include "./app_helpers/app_device_reader.h"
+#include "./app_helpers/app_ensemble_config_cache.h"
 #include "./app_helpers/app_io_buffers.h"
 #include "./app_helpers/app_logging.h"
 #include "./app_helpers/app_ofdm_blocks.h"
@@ -76,6 +79,21 @@ void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("--tuner-no-auto-select")
         .default_value(false).implicit_value(true)
         .help("Do not automatically select tuner on startup");
+    parser.add_argument("--tuner-total-transfers")
+        .default_value(uint32_t(15)).scan<'u', uint32_t>()
+        .metavar("TOTAL_TRANSFERS")
+        .nargs(1).required()
+        .help("Number of usb transfers queued by the tuner");
+    parser.add_argument("--tuner-transfer-size")
+        .default_value(uint32_t(262144)).scan<'u', uint32_t>()
+        .metavar("TRANSFER_SIZE")
+        .nargs(1).required()
+        .help("Number of bytes in each usb transfer (multiple of 512)");
+    parser.add_argument("--tuner-total-blocks")
+        .default_value(size_t(32)).scan<'u', size_t>()
+        .metavar("TOTAL_BLOCKS")
+        .nargs(1).required()
+        .help("Number of transfers that can wait for the OFDM demodulator before they are dropped");
     parser.add_argument("--ofdm-block-size")
         .default_value(size_t(65536)).scan<'u', size_t>()
         .metavar("BLOCK_SIZE")
@@ -89,6 +107,16 @@ void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("--ofdm-disable-coarse-freq")
         .default_value(false).implicit_value(true)
         .help("Disable OFDM coarse frequency correction");
+    parser.add_argument("--ofdm-acquisition-cache")
+        .default_value(std::string(""))
+        .metavar("CACHE_FILENAME")
+        .nargs(1).required()
+        .help("File to keep the synchronisation of each block in so retuning to it is faster (defaults to memory only)");
+    parser.add_argument("--radio-ensemble-cache")
+        .default_value(std::string(""))
+        .metavar("CACHE_FILENAME")
+        .nargs(1).required()
+        .help("File to keep the channels of each ensemble in so they start decoding before the FIC is read (defaults to memory only)");
     parser.add_argument("--radio-total-threads")
         .default_value(size_t(1)).scan<'u', size_t>()
         .metavar("TOTAL_THREADS")
@@ -127,9 +155,14 @@ struct Args {
     bool tuner_auto_gain;
     size_t tuner_device_index;
     bool tuner_no_auto_select;
+    uint32_t tuner_total_transfers;
+    uint32_t tuner_transfer_size;
+    size_t tuner_total_blocks;
     size_t ofdm_block_size;
     size_t ofdm_total_threads;
     bool ofdm_disable_coarse_freq;
+    std::string ofdm_acquisition_cache;
+    std::string radio_ensemble_cache;
     size_t radio_total_threads;
     bool radio_enable_logging;
     bool scraper_enable;
@@ -149,9 +182,14 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     args.tuner_auto_gain = parser.get<bool>("--tuner-auto-gain");
     args.tuner_device_index = parser.get<size_t>("--tuner-device-index");
     args.tuner_no_auto_select = parser.get<bool>("--tuner-no-auto-select");
+    args.tuner_total_transfers = parser.get<uint32_t>("--tuner-total-transfers");
+    args.tuner_transfer_size = parser.get<uint32_t>("--tuner-transfer-size");
+    args.tuner_total_blocks = parser.get<size_t>("--tuner-total-blocks");
     args.ofdm_block_size = parser.get<size_t>("--ofdm-block-size");
     args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
     args.ofdm_disable_coarse_freq = parser.get<bool>("--ofdm-disable-coarse-freq");
+    args.ofdm_acquisition_cache = parser.get<std::string>("--ofdm-acquisition-cache");
+    args.radio_ensemble_cache = parser.get<std::string>("--radio-ensemble-cache");
     args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
     args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
     args.scraper_enable = parser.get<bool>("--scraper-enable");
@@ -306,6 +344,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if ((args.tuner_transfer_size == 0) || ((args.tuner_transfer_size % 512) != 0)) {
+        fprintf(stderr, "Tuner transfer size must be a non-zero multiple of 512\n");
+        return 1;
+    }
+
+    if (args.tuner_total_blocks == 0) {
+        fprintf(stderr, "Tuner total blocks cannot be zero\n");
+        return 1;
+    }
+
     const auto tuner_default_channel = args.tuner_default_channel;
     if (block_frequencies.find(tuner_default_channel) == block_frequencies.end()) {
         fprintf(stderr, "Invalid channel block '%s'. Refer to --list-channels for valid blocks\n", tuner_default_channel.c_str());
@@ -320,11 +368,13 @@ int main(int argc, char** argv) {
     auto ofdm_block = std::make_shared<OFDM_Block>(args.transmission_mode, args.ofdm_total_threads);
     auto& ofdm_config = ofdm_block->get_ofdm_demod().GetConfig();
     ofdm_config.sync.is_coarse_freq_correction = !args.ofdm_disable_coarse_freq;
+    auto acquisition_cache = std::make_shared<App_Acquisition_Cache>(args.ofdm_acquisition_cache);
+    auto ensemble_cache = std::make_shared<App_Ensemble_Config_Cache>(args.radio_ensemble_cache);
     // radio switcher
     auto audio_pipeline = std::make_shared<AudioPipeline>();
     auto radio_switcher = std::make_shared<Basic_Radio_Switcher>(
         args.transmission_mode,
-        [args, audio_pipeline](const DAB_Parameters& params, std::string_view channel_name) -> auto {
+        [args, audio_pipeline, ensemble_cache](const DAB_Parameters& params, std::string_view channel_name) -> auto {
             auto instance = std::make_shared<Radio_Instance>(channel_name, params, args.radio_total_threads);
             auto& radio = instance->get_radio(); 
             attach_audio_pipeline_to_radio(audio_pipeline, radio);
@@ -344,13 +394,25 @@ int main(int argc, char** argv) {
                     );
                 }
             }
+            // channels are created once every observer is attached
+            const auto ensemble_config = ensemble_cache->Get(block_frequencies.at(std::string(channel_name)));
+            if (ensemble_config.has_value()) {
+                radio.LoadEnsembleConfig(ensemble_config.value());
+            }
             return instance;
         }
     );
+    auto save_ensemble_config = [radio_switcher, ensemble_cache]() {
+        auto instance = radio_switcher->get_instance();
+        if (instance == nullptr) return;
+        const auto frequency = block_frequencies.at(std::string(instance->get_name()));
+        ensemble_cache->Set(frequency, instance->get_radio().GetEnsembleConfig());
+    };
     // ofdm input
-    auto device_output_buffer = std::make_shared<ThreadedRingBuffer<RawIQ>>(args.ofdm_block_size*sizeof(RawIQ));
+    // NOTE: Each transfer takes one block so the demodulator converts the samples from where they were copied to
+    auto device_reader = std::make_shared<Device_Reader>(size_t(args.tuner_transfer_size), args.tuner_total_blocks);
     auto ofdm_convert_raw_iq = std::make_shared<OFDM_Convert_RawIQ>();
-    ofdm_convert_raw_iq->set_input_stream(device_output_buffer);
+    ofdm_convert_raw_iq->set_input_stream(device_reader);
     ofdm_block->set_input_stream(ofdm_convert_raw_iq);
     // connect ofdm to radio_switcher
     auto ofdm_to_radio_buffer = std::make_shared<ThreadedRingBuffer<viterbi_bit_t>>(dab_params.nb_frame_bits*2);
@@ -358,8 +420,14 @@ int main(int argc, char** argv) {
     radio_switcher->set_input_stream(ofdm_to_radio_buffer);
     // device to ofdm
     auto device_list = std::make_shared<DeviceList>();
+    {
+        DeviceTransferConfig transfer_config;
+        transfer_config.total_transfers = args.tuner_total_transfers;
+        transfer_config.transfer_size = args.tuner_transfer_size;
+        device_list->set_transfer_config(transfer_config);
+    }
     auto device_source = std::make_shared<DeviceSource>(
-        [device_output_buffer, radio_switcher, args]
+        [device_reader, radio_switcher, ofdm_block, acquisition_cache, save_ensemble_config, args]
         (std::shared_ptr<Device> device) {
             radio_switcher->flush_input_stream();
             if (device == nullptr) return;
@@ -368,21 +436,22 @@ int main(int argc, char** argv) {
             } else {
                 device->SetNearestGain(args.tuner_manual_gain);
             }
-            device->SetDataCallback([device_output_buffer](tcb::span<const uint8_t> bytes) {
-                constexpr size_t BYTES_PER_SAMPLE = sizeof(RawIQ);
-                const size_t total_bytes = bytes.size() - (bytes.size() % BYTES_PER_SAMPLE);
-                const size_t total_samples = total_bytes / BYTES_PER_SAMPLE;
-                auto raw_iq = tcb::span(
-                    reinterpret_cast<const RawIQ*>(bytes.data()),
-                    total_samples
-                );
-                const size_t total_read_samples = device_output_buffer->write(raw_iq);
-                const size_t total_read_bytes = total_read_samples * BYTES_PER_SAMPLE;
-                return total_read_bytes;
-            });
-            device->SetFrequencyChangeCallback([radio_switcher](const std::string& label, const uint32_t freq) {
-                radio_switcher->switch_instance(label);
+            device->SetDataCallback([device_reader](tcb::span<const uint8_t> bytes) {
+                return device_reader->write(bytes);
             });
+            // NOTE: The device owns this callback so we can't hold a shared_ptr to it
+            auto* device_ptr = device.get();
+            device->SetFrequencyChangeCallback(
+                [radio_switcher, ofdm_block, acquisition_cache, save_ensemble_config, device_ptr]
+                (const std::string& label, const uint32_t freq) {
+                    acquisition_cache->Retune(
+                        ofdm_block->get_ofdm_demod(), device_ptr->GetDescriptor().serial,
+                        device_ptr->GetSelectedFrequencyLabel(), label
+                    );
+                    save_ensemble_config();
+                    radio_switcher->switch_instance(label);
+                }
+            );
             device->SetCenterFrequency(args.tuner_default_channel, block_frequencies.at(args.tuner_default_channel));
         }
     ); 
@@ -392,7 +461,7 @@ int main(int argc, char** argv) {
     // gui
     CommonGui gui;
     gui.window_title = "Radio App";
-    gui.render_callback = [ofdm_block, radio_switcher, portaudio_threaded_actions, audio_pipeline, device_source, device_list] () {
+    gui.render_callback = [ofdm_block, radio_switcher, portaudio_threaded_actions, audio_pipeline, device_source, device_list, device_reader] () {
         if (ImGui::Begin("OFDM Demodulator")) {
             ImGuiID dockspace_id = ImGui::GetID("Demodulator Dockspace");
             ImGui::DockSpace(dockspace_id);
@@ -405,6 +474,13 @@ int main(int argc, char** argv) {
                 if (device != nullptr) {
                     RenderDevice(*(device.get()), block_frequencies);
                 }
+                const auto stats = device_reader->get_statistics();
+                ImGui::Text("Blocks: %zu/%zu (max %zu)",
+                    device_reader->get_total_blocks_used(), device_reader->get_total_blocks(), stats.max_blocks_used);
+                ImGui::Text("Transfers: %llu (%llu overruns, %llu bytes dropped)",
+                    (unsigned long long)stats.total_transfers,
+                    (unsigned long long)stats.total_overruns,
+                    (unsigned long long)stats.total_dropped_bytes);
                 if (selected_device != nullptr) {
                     device_source->set_device(selected_device);
                 }
@@ -471,12 +547,13 @@ int main(int argc, char** argv) {
     });
     // shutdown
     const int gui_retval = render_common_gui_blocking(gui);
-    device_output_buffer->close();
+    device_reader->close();
     ofdm_to_radio_buffer->close();
     if (thread_select_default_audio != nullptr) thread_select_default_audio->join();
     if (thread_select_default_tuner != nullptr) thread_select_default_tuner->join();
     thread_ofdm_run.join();
     thread_radio_switcher.join();
+    save_ensemble_config();
     ofdm_block = nullptr;
     radio_switcher = nullptr;
     portaudio_threaded_actions = nullptr;
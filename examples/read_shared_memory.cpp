@@ -0,0 +1,180 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include "./app_helpers/app_database_snapshot.h"
+#include "./app_helpers/app_shared_memory_ring.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-n", "--name")
+        .metavar("NAME")
+        .nargs(1).required()
+        .help("Name of the shared memory ring given to --shm-output (or --shm-database for the database)");
+    parser.add_argument("-t", "--type")
+        .default_value(std::string("pcm"))
+        .choices("pcm", "aac", "soft-bits", "database")
+        .metavar("TYPE")
+        .nargs(1).required()
+        .help("Frames to read (pcm = 16bit audio, aac = ADTS access units, soft-bits = OFDM soft bits, database = services on each change)");
+    parser.add_argument("-s", "--subchannel")
+        .default_value(int(-1)).scan<'i', int>()
+        .metavar("SUBCHANNEL_ID")
+        .nargs(1).required()
+        .help("Only read audio of this subchannel (defaults to the first one received)");
+    parser.add_argument("-o", "--output")
+        .default_value(std::string(""))
+        .metavar("OUTPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of output (defaults to stdout)");
+}
+
+struct Args {
+    std::string name;
+    SharedMemoryFrameType type;
+    bool is_database;
+    int subchannel;
+    std::string output_filename;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.name = parser.get<std::string>("--name");
+    const auto type = parser.get<std::string>("--type");
+    args.type = SharedMemoryFrameType::PCM_AUDIO;
+    args.is_database = (type.compare("database") == 0);
+    if (type.compare("aac") == 0) {
+        args.type = SharedMemoryFrameType::AAC_ACCESS_UNIT;
+    } else if (type.compare("soft-bits") == 0) {
+        args.type = SharedMemoryFrameType::SOFT_BITS;
+    }
+    args.subchannel = parser.get<int>("--subchannel");
+    args.output_filename = parser.get<std::string>("--output");
+    return args;
+}
+
+// Services are listed whenever the database version changes
+static int read_database(const Args& args) {
+    Database_Snapshot_Reader reader;
+    if (!reader.open(args.name)) {
+        fprintf(stderr, "Failed to open shared memory database: '%s'\n", args.name.c_str());
+        return 1;
+    }
+    FILE* fp_out = stdout;
+    if (!args.output_filename.empty()) {
+        fp_out = fopen(args.output_filename.c_str(), "w+");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", args.output_filename.c_str());
+            return 1;
+        }
+    }
+    uint64_t last_version = 0;
+    while (true) {
+        const uint64_t version = reader.get_database_version();
+        if (version == last_version) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        // The output is formatted in place and only written if the snapshot didn't change while it was read
+        std::string output;
+        const auto res = reader.read([&](const Database_Snapshot_View& view) {
+            const auto& ensemble = view.get_ensemble();
+            output = "ensemble=" + std::to_string(ensemble.reference) + " label='" + std::string(ensemble.label.view()) + "'\n";
+            for (const auto& service: view.get_services()) {
+                output += "  service=" + std::to_string(service.reference) + " label='" + std::string(service.label.view()) + "'\n";
+            }
+        });
+        if (res != Database_Snapshot_Reader::Result::OK) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        last_version = version;
+        fprintf(fp_out, "version=%llu %s", (unsigned long long)version, output.c_str());
+        fflush(fp_out);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("read_shared_memory", "0.1.0");
+    parser.add_description("Reads frames published by basic_radio_app to a shared memory ring and outputs raw data");
+    parser.add_epilog("Many readers can attach to the same ring without slowing down the radio");
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    if (args.is_database) return read_database(args);
+
+    SharedMemoryRingReader reader;
+    if (!reader.open(args.name)) {
+        fprintf(stderr, "Failed to open shared memory ring: '%s'\n", args.name.c_str());
+        return 1;
+    }
+
+    FILE* fp_out = stdout;
+    if (!args.output_filename.empty()) {
+        fp_out = fopen(args.output_filename.c_str(), "wb+");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", args.output_filename.c_str());
+            return 1;
+        }
+    }
+
+#if _WIN32
+    _setmode(_fileno(fp_out), _O_BINARY);
+#endif
+
+    int subchannel = args.subchannel;
+    uint32_t audio_param = 0;
+    uint64_t total_dropped = 0;
+    // The frame is copied out before writing since it can be overwritten while being read
+    std::vector<uint8_t> frame_data;
+    while (true) {
+        bool is_selected = false;
+        const auto res = reader.read([&](const SharedMemoryFrame& frame) {
+            if (frame.type != args.type) return;
+            if (frame.type != SharedMemoryFrameType::SOFT_BITS) {
+                if (subchannel < 0) subchannel = int(frame.stream_id);
+                if (frame.stream_id != uint32_t(subchannel)) return;
+            }
+            is_selected = true;
+            frame_data.assign(frame.data.begin(), frame.data.end());
+            if ((frame.type == SharedMemoryFrameType::PCM_AUDIO) && (frame.param != audio_param)) {
+                audio_param = frame.param;
+                fprintf(stderr, "audio subchannel=%d sample_rate=%u stereo=%d\n",
+                    subchannel, audio_param & ~SHARED_MEMORY_PCM_STEREO_FLAG, int((audio_param & SHARED_MEMORY_PCM_STEREO_FLAG) != 0));
+            }
+        });
+        if (res == SharedMemoryRingReader::Result::EMPTY) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (reader.get_total_dropped() != total_dropped) {
+            total_dropped = reader.get_total_dropped();
+            fprintf(stderr, "reader fell behind and dropped %llu frames\n", (unsigned long long)total_dropped);
+        }
+        if ((res != SharedMemoryRingReader::Result::OK) || !is_selected) continue;
+        const size_t nb_write = fwrite(frame_data.data(), sizeof(uint8_t), frame_data.size(), fp_out);
+        if (nb_write != frame_data.size()) {
+            fprintf(stderr, "Failed to write out frame %zu/%zu\n", nb_write, frame_data.size());
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <complex>
 #include <exception>
 #include <iostream>
 #include <string>
@@ -12,6 +14,7 @@
 #endif
 
 #include <argparse/argparse.hpp>
+#include "ofdm/iq_file_reader.h"
 
 // Source: http://soundfile.sapp.org/doc/WaveFormat/
 struct WavHeader {
@@ -33,6 +36,7 @@ struct WavHeader {
 };
 
 static bool validate_wav_header(const WavHeader& header);
+static int read_mapped_wav(IQ_File_Reader& reader, const size_t block_size, FILE* fp_out);
 
 void init_parser(argparse::ArgumentParser& parser) {
     parser.add_argument("-n", "--block-size")
@@ -86,15 +90,6 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    FILE* fp_in = stdin;
-    if (!args.input_filename.empty()) { 
-        fp_in = fopen(args.input_filename.c_str(), "rb");
-        if (fp_in == nullptr) {
-            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
-            return 1;
-        }
-    }
-
     FILE* fp_out = stdout;
     if (!args.output_filename.empty()) {
         fp_out = fopen(args.output_filename.c_str(), "wb+");
@@ -105,10 +100,31 @@ int main(int argc, char** argv) {
     }
 
 #if _WIN32
-    _setmode(_fileno(fp_in), _O_BINARY);
     _setmode(_fileno(fp_out), _O_BINARY);
 #endif
 
+    // Files are memory mapped and converted in place
+    // Pipes can't be mapped and headers the reader doesn't support are reported by the streaming reader below
+    if (!args.input_filename.empty()) {
+        IQ_File_Reader reader;
+        if (reader.Open(args.input_filename) && reader.GetIsWav()) {
+            return read_mapped_wav(reader, args.block_size, fp_out);
+        }
+    }
+
+    FILE* fp_in = stdin;
+    if (!args.input_filename.empty()) { 
+        fp_in = fopen(args.input_filename.c_str(), "rb");
+        if (fp_in == nullptr) {
+            fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+            return 1;
+        }
+    }
+
+#if _WIN32
+    _setmode(_fileno(fp_in), _O_BINARY);
+#endif
+
     size_t nb_read;
     WavHeader header;
     const size_t header_size = sizeof(header);
@@ -171,6 +187,49 @@ int main(int argc, char** argv) {
     return 0;
 }
 
+int read_mapped_wav(IQ_File_Reader& reader, const size_t block_size, FILE* fp_out) {
+    const uint32_t Fs_expected = 2048000;
+    if (reader.GetSampleRate() != Fs_expected) {
+        fprintf(stderr, "[WARN] Expected a sampling rate of %u but got %u\n", Fs_expected, reader.GetSampleRate());
+    }
+    fprintf(stderr, "WAV file has %zu samples of %s IQ\n", reader.GetTotalSamples(), get_iq_file_format_name(reader.GetFormat()));
+
+    const size_t N = std::max(block_size/2, size_t(1));
+    // stream 8bit directly out of the mapping
+    if (reader.GetFormat() == IQ_File_Format::U8) {
+        while (true) {
+            const auto block = reader.ReadBytes(N);
+            if (block.empty()) break;
+            const size_t nb_write = fwrite(block.data(), sizeof(uint8_t), block.size(), fp_out);
+            if (nb_write != block.size()) {
+                fprintf(stderr, "Failed to write out block %zu/%zu bytes\n", nb_write, block.size());
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // other formats are scaled to the 8bit range by the reader
+    fprintf(stderr, "Running conversion from %s to 8bit pcm\n", get_iq_file_format_name(reader.GetFormat()));
+    auto samples = std::vector<std::complex<float>>(N);
+    auto block = std::vector<uint8_t>(2*N);
+    while (true) {
+        const size_t total_samples = reader.Read(samples);
+        if (total_samples == 0) break;
+        for (size_t i = 0; i < total_samples; i++) {
+            block[2*i+0] = uint8_t(std::clamp(samples[i].real() + 127.5f, 0.0f, 255.0f));
+            block[2*i+1] = uint8_t(std::clamp(samples[i].imag() + 127.5f, 0.0f, 255.0f));
+        }
+        const size_t nb_bytes = 2*total_samples;
+        const size_t nb_write = fwrite(block.data(), sizeof(uint8_t), nb_bytes, fp_out);
+        if (nb_write != nb_bytes) {
+            fprintf(stderr, "Failed to write out block %zu/%zu bytes\n", nb_write, nb_bytes);
+            return 1;
+        }
+    }
+    return 0;
+}
+
 bool validate_wav_header(const WavHeader& header) {
     bool is_error = false;
     bool is_warning = false;
@@ -0,0 +1,351 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <easylogging++.h>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_radio.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+#include "ofdm/dab_ofdm_params_ref.h"
+#include "utility/metrics.h"
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "simd_dispatch.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_logging.h"
+#include "./app_helpers/app_mmap_file.h"
+#include "./app_helpers/app_multi_ensemble.h"
+#include "./app_helpers/app_ofdm_blocks.h"
+#include "./app_helpers/app_process_memory.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-i", "--input")
+        .metavar("INPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of the 8bit IQ recording");
+    parser.add_argument("-o", "--output")
+        .default_value(std::string(""))
+        .metavar("REPORT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of the json report (defaults to stdout)");
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Dab transmission mode of the recording");
+    parser.add_argument("--paced")
+        .default_value(false).implicit_value(true)
+        .help("Read the recording at the 2.048MHz sampling rate instead of as fast as possible");
+    parser.add_argument("--frames")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Only replay this many OFDM frames of the recording (0 = whole recording)");
+    // runtime settings
+    parser.add_argument("--ofdm-block-size")
+        .default_value(size_t(65536)).scan<'u', size_t>()
+        .metavar("BLOCK_SIZE")
+        .nargs(1).required()
+        .help("Number of samples the OFDM demodulator will read in each block");
+    parser.add_argument("--ofdm-total-threads")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of OFDM demodulator threads");
+    parser.add_argument("--radio-total-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of radio threads (0 = max number of threads)");
+    // other
+    parser.add_argument("--simd-level")
+        .default_value(std::string("auto"))
+        .choices("auto", "scalar", "sse4.1", "avx", "avx2", "avx512", "neon", "sve2", "rvv")
+        .metavar("LEVEL")
+        .nargs(1).required()
+        .help("Override the SIMD kernels selected for this CPU");
+    parser.add_argument("--radio-enable-logging")
+        .default_value(false).implicit_value(true)
+        .help("Enable verbose logging for radio");
+}
+
+struct Args {
+    std::string input_file;
+    std::string output_file;
+    int transmission_mode;
+    bool is_paced;
+    size_t total_frames;
+    // runtime settings
+    size_t ofdm_block_size;
+    size_t ofdm_total_threads;
+    size_t radio_total_threads;
+    // other
+    std::string simd_level;
+    bool radio_enable_logging;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.input_file = parser.get<std::string>("--input");
+    args.output_file = parser.get<std::string>("--output");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    args.is_paced = parser.get<bool>("--paced");
+    args.total_frames = parser.get<size_t>("--frames");
+    // runtime settings
+    args.ofdm_block_size = parser.get<size_t>("--ofdm-block-size");
+    args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
+    args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
+    // other
+    args.simd_level = parser.get<std::string>("--simd-level");
+    args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
+    return args;
+}
+
+// Reads the recording so that every run decodes exactly the same frames
+// Unpaced reads wait for the radio instead of letting the ring drop frames
+// Paced reads are scheduled from the number of samples read so the clock doesn't drift
+class Replay_Input: public SpanInputBuffer<RawIQ>
+{
+private:
+    static constexpr double SAMPLING_RATE = 2.048e6;
+    std::shared_ptr<SpanInputBuffer<RawIQ>> m_input;
+    const SPSC_Frame_Ring<viterbi_bit_t>& m_ring;
+    const bool m_is_paced;
+    size_t m_total_remain;
+    size_t m_total_read = 0;
+    std::chrono::steady_clock::time_point m_time_start;
+    bool m_is_started = false;
+public:
+    Replay_Input(
+        std::shared_ptr<SpanInputBuffer<RawIQ>> input, const SPSC_Frame_Ring<viterbi_bit_t>& ring,
+        const bool is_paced, const size_t total_samples
+    ): m_input(input), m_ring(ring), m_is_paced(is_paced), m_total_remain(total_samples) {}
+    ~Replay_Input() override = default;
+    tcb::span<const RawIQ> read_span(size_t max_length) override {
+        if (!m_is_started) {
+            m_time_start = std::chrono::steady_clock::now();
+            m_is_started = true;
+        }
+        if (m_is_paced) {
+            const auto offset = std::chrono::duration<double>(double(m_total_read)/SAMPLING_RATE);
+            std::this_thread::sleep_until(m_time_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+        } else {
+            wait_for_frame_ring(m_ring);
+        }
+        const auto buf = m_input->read_span(std::min(max_length, m_total_remain));
+        m_total_remain -= buf.size();
+        m_total_read += buf.size();
+        return buf;
+    }
+    size_t read(tcb::span<RawIQ> dest) override {
+        const auto src = read_span(dest.size());
+        std::copy(src.begin(), src.end(), dest.begin());
+        return src.size();
+    }
+};
+
+// Seconds of audio decoded from each subchannel
+class Audio_Duration_Counter
+{
+private:
+    std::mutex m_mutex;
+    std::map<subchannel_id_t, uint64_t> m_total_microseconds;
+public:
+    void attach(BasicRadio& basic_radio) {
+        basic_radio.On_Audio_Channel().Attach(
+            [this](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+                auto& controls = channel.GetControls();
+                controls.SetIsDecodeAudio(true);
+                controls.SetIsDecodeData(true);
+                controls.SetIsPlayAudio(false);
+                channel.OnAudioData().Attach([this, subchannel_id](BasicAudioParams params, tcb::span<const uint8_t> buf) {
+                    const uint64_t bytes_per_second = uint64_t(params.frequency) * uint64_t(params.bytes_per_sample) * (params.is_stereo ? 2 : 1);
+                    if (bytes_per_second == 0) return;
+                    auto lock = std::scoped_lock(m_mutex);
+                    m_total_microseconds[subchannel_id] += uint64_t(buf.size())*1000000 / bytes_per_second;
+                });
+            }
+        );
+    }
+    double get_seconds(const subchannel_id_t subchannel_id) {
+        auto lock = std::scoped_lock(m_mutex);
+        auto res = m_total_microseconds.find(subchannel_id);
+        if (res == m_total_microseconds.end()) return 0.0;
+        return double(res->second)*1e-6;
+    }
+};
+
+static const char* get_audio_service_type_name(const AudioServiceType type) {
+    switch (type) {
+    case AudioServiceType::DAB: return "DAB";
+    case AudioServiceType::DAB_PLUS: return "DAB+";
+    default: return "unknown";
+    }
+}
+
+static std::string escape_json_string(const std::string& str) {
+    std::string out;
+    for (const char c: str) {
+        if ((c == '"') || (c == '\\')) {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (uint8_t(c) < 0x20) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", int(c));
+            out.append(hex);
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+INITIALIZE_EASYLOGGINGPP
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("replay_recording", "0.1.0");
+    parser.add_description(
+        "Replays a recording through the demodulator and radio and writes a json report. "
+        "Compare reports of different builds or SIMD levels on the same recording."
+    );
+    parser.add_epilog(
+        "Unpaced replays never drop frames so the decoded frames and error counts are the same for every run.\n"
+        "./replay_recording -i recording.raw -o scalar.json --simd-level scalar"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    if (args.ofdm_block_size == 0) {
+        fprintf(stderr, "OFDM block size cannot be zero\n");
+        return 1;
+    }
+    if (args.simd_level.compare("auto") != 0) {
+        SIMD_Level simd_level;
+        if (!simd_get_level_from_name(args.simd_level.c_str(), simd_level) || !simd_set_level(simd_level)) {
+            fprintf(stderr, "SIMD level '%s' is not supported on this CPU (supported up to '%s')\n",
+                args.simd_level.c_str(), simd_get_level_name(simd_get_supported_level()));
+            return 1;
+        }
+    }
+    const char* simd_level_name = simd_get_level_name(simd_get_level());
+    fprintf(stderr, "Using SIMD kernels for %s\n", simd_level_name);
+
+    auto mapped_file = std::make_shared<MappedFile>();
+    if (!mapped_file->open(args.input_file)) {
+        fprintf(stderr, "Failed to open recording: '%s'\n", args.input_file.c_str());
+        return 1;
+    }
+    FILE* fp_out = stdout;
+    if (!args.output_file.empty()) {
+        fp_out = fopen(args.output_file.c_str(), "w");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open report file: '%s'\n", args.output_file.c_str());
+            return 1;
+        }
+    }
+    setup_easylogging(false, args.radio_enable_logging, false);
+
+    Multi_Ensemble_Config config;
+    config.transmission_mode = args.transmission_mode;
+    config.ofdm_total_threads = args.ofdm_total_threads;
+    config.radio_total_threads = args.radio_total_threads;
+    config.total_ring_frames = 8;
+    auto runtime = std::make_unique<Multi_Ensemble_Runtime>(1, config);
+
+    const auto ofdm_params = get_DAB_OFDM_params(args.transmission_mode);
+    const size_t frame_length = ofdm_params.nb_null_period + ofdm_params.nb_symbol_period*ofdm_params.nb_frame_symbols;
+    const size_t total_recording_samples = mapped_file->get_span<RawIQ>().size();
+    const size_t total_samples = (args.total_frames > 0) ?
+        std::min(total_recording_samples, args.total_frames*frame_length) :
+        total_recording_samples;
+    auto mapped_input = std::make_shared<MappedInputFile<RawIQ>>(mapped_file);
+    auto replay_input = std::make_shared<Replay_Input>(mapped_input, runtime->get_frame_ring(0), args.is_paced, total_samples);
+    auto ofdm_convert_raw_iq = std::make_shared<OFDM_Convert_RawIQ>();
+    ofdm_convert_raw_iq->set_input_stream(replay_input);
+    runtime->set_input_stream(0, ofdm_convert_raw_iq);
+    auto& basic_radio = runtime->get_radio_block(0).get_basic_radio();
+    Audio_Duration_Counter audio_counter;
+    audio_counter.attach(basic_radio);
+
+    const auto time_start = std::chrono::steady_clock::now();
+    runtime->start(args.ofdm_block_size);
+    constexpr auto POLL_PERIOD = std::chrono::milliseconds(10);
+    while (!runtime->is_finished()) {
+        std::this_thread::sleep_for(POLL_PERIOD);
+    }
+    runtime->join();
+    const auto time_end = std::chrono::steady_clock::now();
+
+    const double wall_seconds = std::chrono::duration<double>(time_end - time_start).count();
+    const double signal_seconds = double(total_samples)/2.048e6;
+    const auto usage = runtime->get_cpu_usage(0);
+    auto& ofdm_demod = runtime->get_ofdm_block(0).get_ofdm_demod();
+    std::string report;
+    const auto append = [&report](const char* fmt, auto... values) {
+        char buf[512];
+        snprintf(buf, sizeof(buf), fmt, values...);
+        report.append(buf);
+    };
+    append("{\"input\":\"%s\",\"transmission_mode\":%d,\"simd_level\":\"%s\",\"paced\":%s,",
+        escape_json_string(args.input_file).c_str(), args.transmission_mode, simd_level_name, args.is_paced ? "true" : "false");
+    append("\"samples\":%zu,\"signal_seconds\":%.3f,\"wall_seconds\":%.3f,\"realtime_factor\":%.3f,",
+        total_samples, signal_seconds, wall_seconds, (wall_seconds > 0.0) ? (signal_seconds / wall_seconds) : 0.0);
+    append("\"frames\":{\"read\":%d,\"desync\":%d,\"dropped\":%zu},",
+        ofdm_demod.GetTotalFramesRead(), ofdm_demod.GetTotalFramesDesync(), runtime->get_frame_ring(0).get_total_dropped());
+    append("\"cpu_seconds\":{\"ofdm_reader\":%.3f,\"ofdm_threads\":%.3f,\"radio_driver\":%.3f,\"radio_pool\":%.3f},",
+        double(usage.ofdm_reader)*1e-9, double(usage.ofdm_threads)*1e-9,
+        double(usage.radio_driver)*1e-9, double(usage.radio_pool)*1e-9);
+    append("\"peak_memory_bytes\":%llu,", (unsigned long long)get_peak_memory_bytes());
+    // the pipeline has been joined so the demodulator and radio can be read from this thread
+    report.append("\"memory\":[");
+    report.append(ofdm_demod.GetMemoryUsage().ToJSON());
+    report.append(",");
+    report.append(basic_radio.GetMemoryUsage().ToJSON());
+    report.append("],");
+    report.append("\"subchannels\":[");
+    const auto database = basic_radio.GetDatabaseSnapshot();
+    bool is_first_subchannel = true;
+    for (const auto& subchannel: database->subchannels) {
+        auto* channel = basic_radio.Get_Audio_Channel(subchannel.id);
+        if (channel == nullptr) continue;
+        const auto& counts = channel->GetErrorCounts();
+        append("%s{\"id\":%d,\"type\":\"%s\",\"audio_seconds\":%.3f,\"frames\":%llu,\"access_units\":%llu,",
+            is_first_subchannel ? "" : ",", int(subchannel.id), get_audio_service_type_name(channel->GetType()),
+            audio_counter.get_seconds(subchannel.id),
+            (unsigned long long)counts.total_frames, (unsigned long long)counts.total_access_units);
+        append("\"firecode_errors\":%llu,\"rs_errors\":%llu,\"au_crc_errors\":%llu,\"codec_errors\":%llu,\"unreliable_cifs\":%llu}",
+            (unsigned long long)counts.firecode_errors, (unsigned long long)counts.rs_errors,
+            (unsigned long long)counts.au_crc_errors, (unsigned long long)counts.codec_errors,
+            (unsigned long long)counts.unreliable_cifs);
+        is_first_subchannel = false;
+    }
+    report.append("],\"metrics\":");
+    report.append(Metrics_Registry::Get().ExportJSON());
+    report.append("}\n");
+    runtime = nullptr;
+
+    fwrite(report.data(), 1, report.size(), fp_out);
+    if (fp_out != stdout) fclose(fp_out);
+    fprintf(stderr, "Replayed %.1fs of signal in %.1fs (%.2fx realtime)\n",
+        signal_seconds, wall_seconds, (wall_seconds > 0.0) ? (signal_seconds / wall_seconds) : 0.0);
+    return 0;
+}
@@ -0,0 +1,368 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "utility/span.h"
+
+#include <argparse/argparse.hpp>
+#include <easylogging++.h>
+#include "basic_radio/basic_scanner.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "ofdm/dab_mode_detector.h"
+#include "ofdm/dab_ofdm_tables.h"
+#include "ofdm/ofdm_demodulator.h"
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_logging.h"
+#include "./block_frequencies.h"
+#include "./device/device.h"
+#include "./device/device_list.h"
+
+constexpr uint32_t DAB_SAMPLING_RATE = 2'048'000;
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-c", "--channel")
+        .metavar("CHANNEL")
+        .append().required()
+        .help("DAB channel to scan (defaults to all channels)");
+    parser.add_argument("--list-channels")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("List all DAB channels");
+    parser.add_argument("-d", "--device")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("INDEX")
+        .nargs(1).required()
+        .help("Index from all connected devices");
+    parser.add_argument("-g", "--gain")
+        .default_value(float(19.0f)).scan<'g', float>()
+        .metavar("GAIN")
+        .nargs(1).required()
+        .help("Gain of receiver in dB");
+    parser.add_argument("--auto-gain")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Use automatic gain control");
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(0,1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Transmission mode (0 to detect it on each channel)");
+    parser.add_argument("--ofdm-total-threads")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of OFDM demodulator threads (only the PRS and FIC symbols are demodulated)");
+    parser.add_argument("--timeout")
+        .default_value(float(3.0f)).scan<'g', float>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Time spent on a channel before moving onto the next one");
+    parser.add_argument("--stable-time")
+        .default_value(float(1.0f)).scan<'g', float>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Time the labels must stay unchanged before the scan of a channel is complete");
+    parser.add_argument("--settle-time")
+        .default_value(float(0.1f)).scan<'g', float>()
+        .metavar("SECONDS")
+        .nargs(1).required()
+        .help("Time the samples are ignored for after retuning");
+    parser.add_argument("--radio-enable-logging")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Enable verbose logging for radio");
+}
+
+struct Args {
+    std::vector<std::string> channels;
+    bool is_list_channels;
+    size_t device_index;
+    float gain;
+    bool is_auto_gain;
+    int transmission_mode;
+    size_t ofdm_total_threads;
+    float timeout;
+    float stable_time;
+    float settle_time;
+    bool radio_enable_logging;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    if (parser.is_used("--channel")) {
+        args.channels = parser.get<std::vector<std::string>>("--channel");
+    }
+    args.is_list_channels = parser.get<bool>("--list-channels");
+    args.device_index = parser.get<size_t>("--device");
+    args.gain = parser.get<float>("--gain");
+    args.is_auto_gain = parser.get<bool>("--auto-gain");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
+    args.timeout = parser.get<float>("--timeout");
+    args.stable_time = parser.get<float>("--stable-time");
+    args.settle_time = parser.get<float>("--settle-time");
+    args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
+    return args;
+}
+
+struct Scan_Result {
+    std::string channel;
+    uint32_t frequency = 0;
+    Basic_Scan_Status status = Basic_Scan_Status::SCANNING;
+    // 0 if the transmission mode was given or couldn't be detected
+    int detected_mode = 0;
+    Ensemble ensemble;
+    std::vector<Service> services;
+};
+
+// Only the FIC is demodulated and decoded while the device is tuned to a channel
+// If the transmission mode isn't given it is detected from the samples after each retune
+// The demodulator and scanner are then only created once the mode is known
+class Channel_Scanner
+{
+private:
+    const int m_fixed_transmission_mode;
+    const size_t m_total_threads;
+    const float m_timeout;
+    const float m_stable_time;
+    std::mutex m_mutex_demod;
+    std::unique_ptr<DAB_Mode_Detector> m_mode_detector;
+    int m_transmission_mode;
+    std::unique_ptr<OFDM_Demod> m_ofdm_demod;
+    std::shared_ptr<BasicScanner> m_scanner;
+    size_t m_total_skip_samples;
+public:
+    Channel_Scanner(const int transmission_mode, const size_t total_threads, const float timeout, const float stable_time)
+    :   m_fixed_transmission_mode(transmission_mode), m_total_threads(total_threads),
+        m_timeout(timeout), m_stable_time(stable_time),
+        m_transmission_mode(0), m_total_skip_samples(0)
+    {
+        if (m_fixed_transmission_mode > 0) {
+            create_demodulator(m_fixed_transmission_mode);
+        } else {
+            m_mode_detector = std::make_unique<DAB_Mode_Detector>();
+        }
+    }
+    // NOTE: This is nullptr until the transmission mode of the channel has been detected
+    std::shared_ptr<BasicScanner> get_scanner() {
+        auto lock = std::scoped_lock(m_mutex_demod);
+        return m_scanner;
+    }
+    int get_detected_mode() {
+        auto lock = std::scoped_lock(m_mutex_demod);
+        return (m_fixed_transmission_mode > 0) ? 0 : m_transmission_mode;
+    }
+    // NOTE: Call this after retuning which drops the samples that were captured before the tuner settled
+    void restart(const size_t total_skip_samples) {
+        auto lock = std::scoped_lock(m_mutex_demod);
+        m_total_skip_samples = total_skip_samples;
+        if (m_mode_detector != nullptr) {
+            // the demodulator publishes into the scanner so it is destroyed first
+            m_ofdm_demod = nullptr;
+            m_scanner = nullptr;
+            m_transmission_mode = 0;
+            m_mode_detector->Reset();
+            return;
+        }
+        m_ofdm_demod->Flush();
+        m_ofdm_demod->Reset();
+        m_scanner->Reset();
+    }
+    void process(tcb::span<const RawIQ_u8> buf) {
+        auto lock = std::scoped_lock(m_mutex_demod);
+        const size_t total_skip = std::min(m_total_skip_samples, buf.size());
+        m_total_skip_samples -= total_skip;
+        buf = buf.subspan(total_skip);
+        if (buf.empty()) return;
+        if (m_ofdm_demod == nullptr) {
+            m_mode_detector->Process(buf);
+            const auto estimate = m_mode_detector->GetEstimate();
+            if (estimate.transmission_mode == 0) return;
+            create_demodulator(estimate.transmission_mode);
+            return;
+        }
+        if (m_scanner->IsFinished()) return;
+        m_ofdm_demod->Process(buf);
+    }
+private:
+    void create_demodulator(const int transmission_mode) {
+        m_transmission_mode = transmission_mode;
+        const auto& tables = get_DAB_OFDM_tables(transmission_mode);
+        const auto& ofdm_params = tables.params;
+        m_ofdm_demod = std::make_unique<OFDM_Demod>(ofdm_params, tables.prs_fft_ref, tables.carrier_mapper, int(m_total_threads));
+
+        const auto dab_params = get_dab_parameters(transmission_mode);
+        m_ofdm_demod->SetTotalDataSymbols(size_t(dab_params.nb_fic_symbols));
+        m_ofdm_demod->SetIsHeadless(true);
+        m_ofdm_demod->GetConfig().pipeline.is_fused_symbols = true;
+
+        const size_t frame_period = ofdm_params.nb_null_period + ofdm_params.nb_frame_symbols*ofdm_params.nb_symbol_period;
+        const float frame_duration = float(frame_period) / float(DAB_SAMPLING_RATE);
+        const size_t max_frames = size_t(std::max(m_timeout / frame_duration, 1.0f));
+        const size_t min_stable_frames = size_t(std::max(m_stable_time / frame_duration, 0.0f));
+        m_scanner = std::make_shared<BasicScanner>(dab_params, max_frames, min_stable_frames);
+        m_ofdm_demod->On_OFDM_Frame().Attach([scanner = m_scanner.get()](tcb::span<const viterbi_bit_t> buf) {
+            scanner->Process(buf);
+        });
+    }
+};
+
+static std::vector<std::pair<std::string, uint32_t>> get_sorted_channels() {
+    std::vector<std::pair<std::string, uint32_t>> channels;
+    for (const auto& [label, frequency]: block_frequencies) {
+        channels.push_back({ label, frequency });
+    }
+    std::sort(channels.begin(), channels.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second;
+    });
+    return channels;
+}
+
+static void print_result(const Scan_Result& result) {
+    const char* status = (result.status == Basic_Scan_Status::COMPLETE) ? "complete" : "timeout";
+    fprintf(stdout, "%s %.3fMHz %s", result.channel.c_str(), float(result.frequency)*1e-6f, status);
+    if (result.detected_mode > 0) {
+        fprintf(stdout, " mode=%d", result.detected_mode);
+    }
+    if (result.ensemble.is_complete) {
+        fprintf(stdout, " ensemble=0x%04X label='%s'", result.ensemble.reference, result.ensemble.label.c_str());
+    }
+    fprintf(stdout, " services=%zu\n", result.services.size());
+    for (const auto& service: result.services) {
+        fprintf(stdout, "    service=0x%08X label='%s'\n", service.reference, service.label.c_str());
+    }
+    fflush(stdout);
+}
+
+INITIALIZE_EASYLOGGINGPP
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("scan_band", "0.1.0");
+    parser.add_description("Scans DAB channels for ensembles by only decoding their FIC");
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+
+    const auto all_channels = get_sorted_channels();
+    if (args.is_list_channels) {
+        for (const auto& [label, frequency]: all_channels) {
+            fprintf(stderr, "%*s: %.3f MHz\n", 3, label.c_str(), float(frequency)*1e-6f);
+        }
+        return 0;
+    }
+    if (args.timeout <= 0.0f) {
+        fprintf(stderr, "Timeout must be positive (%.3f)\n", args.timeout);
+        return 1;
+    }
+    if ((args.stable_time < 0.0f) || (args.settle_time < 0.0f)) {
+        fprintf(stderr, "Stable time and settle time cannot be negative\n");
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, uint32_t>> channels;
+    if (args.channels.empty()) {
+        channels = all_channels;
+    }
+    for (const auto& channel: args.channels) {
+        auto res = block_frequencies.find(channel);
+        if (res == block_frequencies.end()) {
+            fprintf(stderr, "Invalid channel: '%s'\n", channel.c_str());
+            return 1;
+        }
+        channels.push_back({ res->first, res->second });
+    }
+
+    setup_easylogging(false, args.radio_enable_logging, false);
+
+    auto device_list = DeviceList();
+    device_list.refresh();
+    auto device = device_list.get_device(args.device_index);
+    if (device == nullptr) {
+        fprintf(stderr, "Failed to open device %zu\n", args.device_index);
+        return 1;
+    }
+    if (args.is_auto_gain) {
+        device->SetAutoGain();
+    } else {
+        device->SetNearestGain(args.gain);
+    }
+
+    auto scanner = std::make_shared<Channel_Scanner>(
+        args.transmission_mode, args.ofdm_total_threads, args.timeout, args.stable_time);
+    device->SetDataCallback([scanner](tcb::span<const uint8_t> bytes) {
+        constexpr size_t BYTES_PER_SAMPLE = sizeof(RawIQ_u8);
+        const size_t total_samples = bytes.size() / BYTES_PER_SAMPLE;
+        auto raw_iq = tcb::span(reinterpret_cast<const RawIQ_u8*>(bytes.data()), total_samples);
+        scanner->process(raw_iq);
+        return bytes.size();
+    });
+
+    const size_t total_settle_samples = size_t(args.settle_time * float(DAB_SAMPLING_RATE));
+    // the device timeout also covers channels where the demodulator never finds a frame
+    const auto timeout = std::chrono::duration<float>(args.timeout + args.settle_time);
+    size_t total_found = 0;
+    const auto scan_start = std::chrono::steady_clock::now();
+    for (const auto& [label, frequency]: channels) {
+        if (!device->IsRunning()) {
+            fprintf(stderr, "Device stopped before the scan finished\n");
+            break;
+        }
+        device->SetCenterFrequency(label, frequency);
+        scanner->restart(total_settle_samples);
+
+        const auto channel_start = std::chrono::steady_clock::now();
+        while (device->IsRunning()) {
+            auto basic_scanner = scanner->get_scanner();
+            if ((basic_scanner != nullptr) && basic_scanner->IsFinished()) break;
+            if ((std::chrono::steady_clock::now() - channel_start) >= timeout) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        Scan_Result result;
+        result.channel = label;
+        result.frequency = frequency;
+        result.detected_mode = scanner->get_detected_mode();
+        result.status = Basic_Scan_Status::TIMEOUT;
+        auto basic_scanner = scanner->get_scanner();
+        if (basic_scanner != nullptr) {
+            if (basic_scanner->GetStatus() == Basic_Scan_Status::COMPLETE) {
+                result.status = Basic_Scan_Status::COMPLETE;
+            }
+            auto lock = std::scoped_lock(basic_scanner->GetMutex());
+            const auto& db = basic_scanner->GetDatabase();
+            result.ensemble = db.ensemble;
+            for (const auto& service: db.services) {
+                if (service.is_complete) result.services.push_back(service);
+            }
+        }
+        if (result.ensemble.is_complete) total_found++;
+        print_result(result);
+    }
+    const auto scan_end = std::chrono::steady_clock::now();
+    const float scan_duration = std::chrono::duration<float>(scan_end - scan_start).count();
+    fprintf(stderr, "Found %zu ensembles in %zu channels in %.1fs\n", total_found, channels.size(), scan_duration);
+    // stop the callback before the scanner is destroyed
+    device->Close();
+    device = nullptr;
+    return 0;
+}
@@ -0,0 +1,767 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <easylogging++.h>
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_radio.h"
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database_types.h"
+#include "ofdm/dsp/convert_raw_iq.h"
+#include "ofdm/ofdm_helpers.h"
+#include "utility/metrics.h"
+#include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
+#include "simd_dispatch.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_logging.h"
+#include "./app_helpers/app_mmap_file.h"
+#include "./app_helpers/app_multi_ensemble.h"
+#include "./app_helpers/app_process_memory.h"
+#include "./app_helpers/app_simulated_ensemble.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Dab transmission mode of the simulated ensemble");
+    // ensemble settings
+    parser.add_argument("--dab-subchannels")
+        .default_value(int(0)).scan<'i', int>()
+        .metavar("TOTAL")
+        .nargs(1).required()
+        .help("Number of DAB (MPEG-1 layer II) subchannels");
+    parser.add_argument("--dab-bitrate")
+        .default_value(int(128)).scan<'i', int>()
+        .metavar("KBPS")
+        .nargs(1).required()
+        .help("Bitrate of each DAB subchannel");
+    parser.add_argument("--dab-plus-subchannels")
+        .default_value(int(8)).scan<'i', int>()
+        .metavar("TOTAL")
+        .nargs(1).required()
+        .help("Number of DAB+ (AAC) subchannels");
+    parser.add_argument("--dab-plus-bitrate")
+        .default_value(int(64)).scan<'i', int>()
+        .metavar("KBPS")
+        .nargs(1).required()
+        .help("Bitrate of each DAB+ subchannel");
+    parser.add_argument("--protection")
+        .default_value(std::string("eep"))
+        .choices("eep", "uep")
+        .metavar("TYPE")
+        .nargs(1).required()
+        .help("Protection of the DAB subchannels (DAB+ subchannels always use EEP)");
+    parser.add_argument("--protection-level")
+        .default_value(int(3)).scan<'i', int>()
+        .metavar("LEVEL")
+        .nargs(1).required()
+        .help("Protection level where EEP is 1 to 4 and UEP is 1 to 5");
+    parser.add_argument("--eep-type-b")
+        .default_value(false).implicit_value(true)
+        .help("Use EEP type B profiles instead of type A");
+    parser.add_argument("--snr")
+        .default_value(std::numeric_limits<float>::infinity()).scan<'g', float>()
+        .metavar("DB")
+        .nargs(1).required()
+        .help("Signal to noise ratio of the added white gaussian noise (inf = no noise)");
+    parser.add_argument("--frequency-offset")
+        .default_value(float(0.0f)).scan<'g', float>()
+        .metavar("HZ")
+        .nargs(1).required()
+        .help("Frequency offset applied to the signal");
+    parser.add_argument("--seed")
+        .default_value(int(0)).scan<'i', int>()
+        .metavar("SEED")
+        .nargs(1).required()
+        .help("Seed for the random bits and noise");
+    // runtime settings
+    parser.add_argument("--frames")
+        .default_value(size_t(1000)).scan<'u', size_t>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Number of OFDM frames each ensemble demodulates");
+    parser.add_argument("--ensembles")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_ENSEMBLES")
+        .nargs(1).required()
+        .help("Number of copies of the ensemble that are decoded concurrently");
+    parser.add_argument("--ofdm-block-size")
+        .default_value(size_t(65536)).scan<'u', size_t>()
+        .metavar("BLOCK_SIZE")
+        .nargs(1).required()
+        .help("Number of samples each OFDM demodulator will read in each block");
+    parser.add_argument("--ofdm-total-threads")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of OFDM demodulator threads for each ensemble");
+    parser.add_argument("--radio-total-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("TOTAL_THREADS")
+        .nargs(1).required()
+        .help("Number of radio threads shared by every ensemble (0 = max number of threads)");
+    parser.add_argument("--radio-private-pools")
+        .default_value(false).implicit_value(true)
+        .help("Give each ensemble its own pool of --radio-total-threads instead of sharing one pool");
+    parser.add_argument("--sweep-ensembles")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("MAX_ENSEMBLES")
+        .nargs(1).required()
+        .help("Benchmark 1 to MAX_ENSEMBLES ensembles decoded concurrently in doubling steps (0 = disabled)");
+    parser.add_argument("--sweep-threads")
+        .default_value(size_t(0)).scan<'u', size_t>()
+        .metavar("MAX_THREADS")
+        .nargs(1).required()
+        .help("Benchmark the demodulator and radio separately with 1 to MAX_THREADS threads (0 = disabled)");
+    parser.add_argument("--sweep-input")
+        .default_value(std::string(""))
+        .metavar("FILENAME")
+        .nargs(1).required()
+        .help("Raw 8bit IQ recording used by --sweep-threads instead of the simulated ensemble");
+    // other
+    parser.add_argument("--simd-level")
+        .default_value(std::string("auto"))
+        .choices("auto", "scalar", "sse4.1", "avx", "avx2", "avx512", "neon", "sve2", "rvv")
+        .metavar("LEVEL")
+        .nargs(1).required()
+        .help("Override the SIMD kernels selected for this CPU");
+    parser.add_argument("--metrics")
+        .default_value(false).implicit_value(true)
+        .help("Print the latency histograms of each stage as json at exit");
+    parser.add_argument("--radio-enable-logging")
+        .default_value(false).implicit_value(true)
+        .help("Enable verbose logging for radio");
+}
+
+struct Args {
+    int transmission_mode;
+    // ensemble settings
+    int dab_subchannels;
+    int dab_bitrate;
+    int dab_plus_subchannels;
+    int dab_plus_bitrate;
+    bool is_uep;
+    int protection_level;
+    bool is_eep_type_b;
+    float snr_db;
+    float frequency_offset;
+    int seed;
+    // runtime settings
+    size_t total_frames;
+    size_t total_ensembles;
+    size_t ofdm_block_size;
+    size_t ofdm_total_threads;
+    size_t radio_total_threads;
+    bool is_radio_private_pools;
+    size_t sweep_max_ensembles;
+    size_t sweep_max_threads;
+    std::string sweep_input;
+    // other
+    std::string simd_level;
+    bool is_metrics;
+    bool radio_enable_logging;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    // ensemble settings
+    args.dab_subchannels = parser.get<int>("--dab-subchannels");
+    args.dab_bitrate = parser.get<int>("--dab-bitrate");
+    args.dab_plus_subchannels = parser.get<int>("--dab-plus-subchannels");
+    args.dab_plus_bitrate = parser.get<int>("--dab-plus-bitrate");
+    args.is_uep = parser.get<std::string>("--protection").compare("uep") == 0;
+    args.protection_level = parser.get<int>("--protection-level");
+    args.is_eep_type_b = parser.get<bool>("--eep-type-b");
+    args.snr_db = parser.get<float>("--snr");
+    args.frequency_offset = parser.get<float>("--frequency-offset");
+    args.seed = parser.get<int>("--seed");
+    // runtime settings
+    args.total_frames = parser.get<size_t>("--frames");
+    args.total_ensembles = parser.get<size_t>("--ensembles");
+    args.ofdm_block_size = parser.get<size_t>("--ofdm-block-size");
+    args.ofdm_total_threads = parser.get<size_t>("--ofdm-total-threads");
+    args.radio_total_threads = parser.get<size_t>("--radio-total-threads");
+    args.is_radio_private_pools = parser.get<bool>("--radio-private-pools");
+    args.sweep_max_ensembles = parser.get<size_t>("--sweep-ensembles");
+    args.sweep_max_threads = parser.get<size_t>("--sweep-threads");
+    args.sweep_input = parser.get<std::string>("--sweep-input");
+    // other
+    args.simd_level = parser.get<std::string>("--simd-level");
+    args.is_metrics = parser.get<bool>("--metrics");
+    args.radio_enable_logging = parser.get<bool>("--radio-enable-logging");
+    return args;
+}
+
+// Loops over the simulated frames until the requested number of samples has been read
+// Reading waits while the radio is behind so that frames aren't dropped from the ring
+// NOTE: Otherwise the demodulator would appear faster than the whole chain can decode
+class Looped_Samples_Input: public SpanInputBuffer<std::complex<float>>
+{
+private:
+    tcb::span<const std::complex<float>> m_samples;
+    SPSC_Frame_Ring<viterbi_bit_t>& m_ring;
+    size_t m_curr_index;
+    size_t m_total_remain;
+    std::vector<std::complex<float>> m_stitch_buffer;
+public:
+    Looped_Samples_Input(
+        tcb::span<const std::complex<float>> samples, SPSC_Frame_Ring<viterbi_bit_t>& ring,
+        const size_t start_index, const size_t total_samples
+    ): m_samples(samples), m_ring(ring), m_curr_index(start_index % samples.size()), m_total_remain(total_samples) {}
+    ~Looped_Samples_Input() override = default;
+    tcb::span<const std::complex<float>> read_span(size_t max_length) override {
+        wait_for_frame_ring(m_ring);
+        const size_t length = std::min(max_length, m_total_remain);
+        m_total_remain -= length;
+        const size_t nb_contiguous = m_samples.size() - m_curr_index;
+        if (length <= nb_contiguous) {
+            const auto buf = m_samples.subspan(m_curr_index, length);
+            m_curr_index = (m_curr_index + length) % m_samples.size();
+            return buf;
+        }
+        m_stitch_buffer.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            m_stitch_buffer[i] = m_samples[m_curr_index];
+            m_curr_index = (m_curr_index+1) % m_samples.size();
+        }
+        return m_stitch_buffer;
+    }
+    size_t read(tcb::span<std::complex<float>> dest) override {
+        const auto src = read_span(dest.size());
+        std::copy(src.begin(), src.end(), dest.begin());
+        return src.size();
+    }
+};
+
+// Seconds of audio decoded from every subchannel of an ensemble
+struct Ensemble_Audio_Counter {
+    std::atomic<uint64_t> total_microseconds{0};
+    std::atomic<int> total_channels{0};
+};
+
+static void attach_audio_counter(BasicRadio& basic_radio, Ensemble_Audio_Counter& counter) {
+    Ensemble_Audio_Counter* counter_ptr = &counter;
+    basic_radio.On_Audio_Channel().Attach(
+        [counter_ptr](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+            counter_ptr->total_channels.fetch_add(1, std::memory_order_relaxed);
+            auto& controls = channel.GetControls();
+            controls.SetIsDecodeAudio(true);
+            controls.SetIsDecodeData(true);
+            controls.SetIsPlayAudio(false);
+            channel.OnAudioData().Attach([counter_ptr](BasicAudioParams params, tcb::span<const uint8_t> buf) {
+                const uint64_t bytes_per_second = uint64_t(params.frequency) * uint64_t(params.bytes_per_sample) * (params.is_stereo ? 2 : 1);
+                if (bytes_per_second == 0) return;
+                counter_ptr->total_microseconds.fetch_add(uint64_t(buf.size())*1000000 / bytes_per_second, std::memory_order_relaxed);
+            });
+        }
+    );
+}
+
+static Simulated_Ensemble_Config get_ensemble_config(const Args& args) {
+    Simulated_Ensemble_Config config;
+    config.transmission_mode = args.transmission_mode;
+    config.snr_db = args.snr_db;
+    config.frequency_offset_hz = args.frequency_offset;
+    config.seed = uint32_t(args.seed);
+    for (int i = 0; i < args.dab_subchannels; i++) {
+        Simulated_Subchannel_Config subchannel;
+        subchannel.is_dab_plus = false;
+        subchannel.bitrate_kbps = args.dab_bitrate;
+        subchannel.is_uep = args.is_uep;
+        subchannel.protection_level = args.protection_level;
+        subchannel.is_eep_type_b = args.is_eep_type_b;
+        config.subchannels.push_back(subchannel);
+    }
+    for (int i = 0; i < args.dab_plus_subchannels; i++) {
+        Simulated_Subchannel_Config subchannel;
+        subchannel.is_dab_plus = true;
+        subchannel.bitrate_kbps = args.dab_plus_bitrate;
+        subchannel.is_uep = false;
+        subchannel.protection_level = args.is_uep ? 3 : args.protection_level;
+        subchannel.is_eep_type_b = args.is_eep_type_b;
+        config.subchannels.push_back(subchannel);
+    }
+    return config;
+}
+
+// Frames given to each stage before it is timed so that it has synchronised and created its channels
+constexpr size_t SWEEP_WARMUP_FRAMES = 32;
+
+// Throughput and latency of one stage with a given number of threads
+struct Sweep_Result {
+    size_t total_threads = 0;
+    size_t total_frames = 0;
+    double wall_seconds = 0.0;
+    std::vector<double> latencies_ms;
+    int total_desync = 0;
+    double get_frames_per_second() const {
+        return (wall_seconds > 0.0) ? (double(total_frames) / wall_seconds) : 0.0;
+    }
+};
+
+static double get_percentile(std::vector<double> values, const double percentile) {
+    if (values.empty()) return 0.0;
+    const size_t index = std::min(size_t(percentile*double(values.size())), values.size()-1);
+    std::nth_element(values.begin(), values.begin()+ptrdiff_t(index), values.end());
+    return values[index];
+}
+
+// Latency of a frame is from the start of the Process() call that read its last sample until it is published
+// Each call reads exactly one frame of samples so once the demodulator is flushed after warm up
+// every call publishes one frame and they can be paired in order
+// NOTE: A desync breaks the pairing so the latencies are only meaningful if total_desync is 0
+static Sweep_Result run_ofdm_sweep_step(
+    tcb::span<const std::complex<float>> samples, const size_t frame_length,
+    const int transmission_mode, const size_t total_threads, const size_t total_frames,
+    std::vector<std::vector<viterbi_bit_t>>* out_frames
+) {
+    using clock = std::chrono::steady_clock;
+    auto ofdm_demod = Create_OFDM_Demodulator(transmission_mode, int(total_threads));
+    ofdm_demod->SetIsHeadless(true);
+    ofdm_demod->GetConfig().pipeline.is_fused_symbols = true;
+
+    Sweep_Result result;
+    result.total_threads = total_threads;
+    std::mutex mutex_submit;
+    std::deque<clock::time_point> submit_times;
+    bool is_measuring = false;
+    ofdm_demod->On_OFDM_Frame().Attach([&](tcb::span<const viterbi_bit_t> buf) {
+        const auto time_publish = clock::now();
+        auto lock = std::scoped_lock(mutex_submit);
+        if (!is_measuring) return;
+        if (!submit_times.empty()) {
+            const auto time_submit = submit_times.front();
+            submit_times.pop_front();
+            result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(time_publish - time_submit).count());
+        }
+        result.total_frames++;
+        if (out_frames != nullptr) out_frames->emplace_back(buf.begin(), buf.end());
+    });
+
+    const size_t total_sample_frames = samples.size() / frame_length;
+    const auto get_frame = [&](const size_t index) {
+        return samples.subspan((index % total_sample_frames)*frame_length, frame_length);
+    };
+    for (size_t i = 0; i < SWEEP_WARMUP_FRAMES; i++) {
+        ofdm_demod->Process(get_frame(i));
+    }
+    ofdm_demod->Flush();
+    const int total_desync_start = ofdm_demod->GetTotalFramesDesync();
+    {
+        auto lock = std::scoped_lock(mutex_submit);
+        is_measuring = true;
+    }
+
+    const auto time_start = clock::now();
+    for (size_t i = 0; i < total_frames; i++) {
+        {
+            auto lock = std::scoped_lock(mutex_submit);
+            submit_times.push_back(clock::now());
+        }
+        ofdm_demod->Process(get_frame(SWEEP_WARMUP_FRAMES+i));
+    }
+    ofdm_demod->Flush();
+    const auto time_end = clock::now();
+    result.wall_seconds = std::chrono::duration<double>(time_end - time_start).count();
+    result.total_desync = ofdm_demod->GetTotalFramesDesync() - total_desync_start;
+    ofdm_demod = nullptr;
+    return result;
+}
+
+// Latency of a frame is the duration of its Process() call since the radio decodes it completely before returning
+static Sweep_Result run_radio_sweep_step(
+    const std::vector<std::vector<viterbi_bit_t>>& frames,
+    const int transmission_mode, const size_t total_threads, const size_t total_frames
+) {
+    using clock = std::chrono::steady_clock;
+    auto basic_radio = std::make_unique<BasicRadio>(get_dab_parameters(transmission_mode), total_threads);
+    basic_radio->SetPipelineDepth(1);
+    Ensemble_Audio_Counter audio_counter;
+    attach_audio_counter(*basic_radio, audio_counter);
+
+    Sweep_Result result;
+    result.total_threads = total_threads;
+    result.latencies_ms.reserve(total_frames);
+    for (size_t i = 0; i < SWEEP_WARMUP_FRAMES; i++) {
+        basic_radio->Process(frames[i % frames.size()]);
+    }
+    basic_radio->Flush();
+
+    const auto time_start = clock::now();
+    for (size_t i = 0; i < total_frames; i++) {
+        const auto time_submit = clock::now();
+        basic_radio->Process(frames[(SWEEP_WARMUP_FRAMES+i) % frames.size()]);
+        result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - time_submit).count());
+    }
+    basic_radio->Flush();
+    const auto time_end = clock::now();
+    result.wall_seconds = std::chrono::duration<double>(time_end - time_start).count();
+    result.total_frames = total_frames;
+    if (audio_counter.total_channels.load() == 0) {
+        fprintf(stderr, "Warning: Radio with %zu threads didn't create any audio channels\n", total_threads);
+    }
+    basic_radio = nullptr;
+    return result;
+}
+
+// Efficiency is the speedup over one thread divided by the number of threads
+static void print_sweep_results(const char* name, const std::vector<Sweep_Result>& results) {
+    if (results.empty()) return;
+    const double base_frames_per_second = results.front().get_frames_per_second();
+    fprintf(stderr, "%s:\n", name);
+    fprintf(stderr, "%8s %10s %12s %10s %10s %8s %10s\n",
+        "threads", "frames", "frames/s", "p50_ms", "p99_ms", "speedup", "efficiency");
+    for (const auto& result: results) {
+        const double frames_per_second = result.get_frames_per_second();
+        const double speedup = (base_frames_per_second > 0.0) ? (frames_per_second / base_frames_per_second) : 0.0;
+        const double efficiency = speedup / double(result.total_threads);
+        fprintf(stderr, "%8zu %10zu %12.1f %10.3f %10.3f %7.2fx %9.1f%%\n",
+            result.total_threads, result.total_frames, frames_per_second,
+            get_percentile(result.latencies_ms, 0.50), get_percentile(result.latencies_ms, 0.99),
+            speedup, efficiency*100.0);
+        if (result.total_desync > 0) {
+            fprintf(stderr, "Warning: %d frames desynchronised with %zu threads so the latencies are unreliable\n",
+                result.total_desync, result.total_threads);
+        }
+    }
+}
+
+// Runs the same input through the demodulator and then its output through the radio for each number of threads
+// The stages are run separately so each curve shows the scaling of one stage without the other competing for cores
+static int run_thread_sweep(const Args& args) {
+    std::vector<std::complex<float>> recording;
+    Simulated_Ensemble ensemble;
+    tcb::span<const std::complex<float>> samples;
+    size_t frame_length = 0;
+    if (!args.sweep_input.empty()) {
+        const auto& params = get_DAB_OFDM_tables(args.transmission_mode).params;
+        frame_length = params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols;
+        MappedFile file;
+        if (!file.open(args.sweep_input)) {
+            fprintf(stderr, "Failed to open recording '%s'\n", args.sweep_input.c_str());
+            return 1;
+        }
+        // the recording isn't looped since it wouldn't be continuous where it wraps around
+        const auto bytes = file.get_bytes();
+        const size_t total_recorded_frames = (bytes.size()/2) / frame_length;
+        const size_t total_frames = std::min(total_recorded_frames, SWEEP_WARMUP_FRAMES+args.total_frames);
+        if (total_frames <= SWEEP_WARMUP_FRAMES) {
+            fprintf(stderr, "Recording has %zu frames but needs more than %zu\n", total_recorded_frames, SWEEP_WARMUP_FRAMES);
+            return 1;
+        }
+        recording.resize(total_frames*frame_length);
+        convert_raw_iq_auto(bytes.first(recording.size()*2), recording);
+        samples = recording;
+    } else {
+        std::string error;
+        if (!ensemble.create(get_ensemble_config(args), error)) {
+            fprintf(stderr, "Failed to create ensemble: %s\n", error.c_str());
+            return 1;
+        }
+        samples = ensemble.get_samples();
+        frame_length = ensemble.get_frame_length();
+    }
+    const size_t total_sample_frames = samples.size() / frame_length;
+    const size_t total_frames = args.sweep_input.empty() ? args.total_frames : (total_sample_frames-SWEEP_WARMUP_FRAMES);
+    fprintf(stderr, "Sweeping 1 to %zu threads over %zu frames after %zu warm up frames\n",
+        args.sweep_max_threads, total_frames, SWEEP_WARMUP_FRAMES);
+
+    std::vector<std::vector<viterbi_bit_t>> soft_bit_frames;
+    std::vector<Sweep_Result> ofdm_results;
+    for (size_t total_threads = 1; total_threads <= args.sweep_max_threads; total_threads++) {
+        // the radio is given the frames demodulated by the first step so every radio step decodes the same bits
+        auto* out_frames = (total_threads == 1) ? &soft_bit_frames : nullptr;
+        ofdm_results.push_back(run_ofdm_sweep_step(
+            samples, frame_length, args.transmission_mode, total_threads, total_frames, out_frames
+        ));
+    }
+    print_sweep_results("ofdm_demod", ofdm_results);
+
+    if (soft_bit_frames.empty()) {
+        fprintf(stderr, "Demodulator didn't produce any frames for the radio\n");
+        return 1;
+    }
+    std::vector<Sweep_Result> radio_results;
+    for (size_t total_threads = 1; total_threads <= args.sweep_max_threads; total_threads++) {
+        radio_results.push_back(run_radio_sweep_step(
+            soft_bit_frames, args.transmission_mode, total_threads, total_frames
+        ));
+    }
+    print_sweep_results("basic_radio", radio_results);
+    return 0;
+}
+
+// Time each frame of an ensemble spent in the demodulator pipeline and in BasicRadio::Process()
+// NOTE: Each list only has one writer which is the thread running that stage
+struct Ensemble_Frame_Times {
+    std::vector<double> ofdm_ms;
+    std::vector<double> radio_ms;
+};
+
+// Aggregate throughput and per ensemble tail latency of decoding many ensembles at once
+struct Ensembles_Result {
+    size_t total_ensembles = 0;
+    bool is_private_pools = false;
+    double wall_seconds = 0.0;
+    double signal_seconds = 0.0;
+    size_t radio_threads = 0;
+    // sampled while decoding so it includes every thread and buffer of the demodulators and radios
+    uint64_t max_process_threads = 0;
+    uint64_t max_memory_bytes = 0;
+    // worst p99 over the ensembles
+    double ofdm_p99_ms = 0.0;
+    double radio_p99_ms = 0.0;
+    bool is_audio_missing = false;
+    double get_realtime_factor() const {
+        return (wall_seconds > 0.0) ? (signal_seconds / wall_seconds) : 0.0;
+    }
+};
+
+static Ensembles_Result run_ensembles(
+    const Args& args, const Simulated_Ensemble& ensemble, const size_t total_ensembles, const bool is_verbose
+) {
+    Multi_Ensemble_Config config;
+    config.transmission_mode = args.transmission_mode;
+    config.ofdm_total_threads = args.ofdm_total_threads;
+    config.radio_total_threads = args.radio_total_threads;
+    config.radio_private_pools = args.is_radio_private_pools;
+    config.total_ring_frames = 8;
+    auto runtime = std::make_unique<Multi_Ensemble_Runtime>(total_ensembles, config);
+    if (is_verbose) {
+        fprintf(stderr, "Decoding %zu ensembles with %zu %s radio threads\n",
+            total_ensembles, runtime->get_total_radio_threads(), config.radio_private_pools ? "private" : "shared");
+    }
+
+    // each ensemble starts at a different frame so they don't run in lockstep
+    const size_t frame_length = ensemble.get_frame_length();
+    const size_t total_samples = args.total_frames*frame_length;
+    std::vector<Ensemble_Audio_Counter> audio_counters(total_ensembles);
+    std::vector<Ensemble_Frame_Times> frame_times(total_ensembles);
+    for (size_t i = 0; i < total_ensembles; i++) {
+        const size_t start_index = (i % ensemble.get_total_frames())*frame_length + (i*frame_length)/7;
+        auto input = std::make_shared<Looped_Samples_Input>(
+            ensemble.get_samples(), runtime->get_frame_ring(i), start_index, total_samples
+        );
+        runtime->set_input_stream(i, input);
+        attach_audio_counter(runtime->get_radio_block(i).get_basic_radio(), audio_counters[i]);
+        auto* times = &frame_times[i];
+        times->ofdm_ms.reserve(args.total_frames);
+        times->radio_ms.reserve(args.total_frames);
+        runtime->get_ofdm_block(i).get_ofdm_demod().On_Frame_Time().Attach([times](const float seconds) {
+            times->ofdm_ms.push_back(double(seconds)*1e3);
+        });
+        runtime->get_radio_block(i).on_frame().Attach(
+            [times](BasicRadio&, tcb::span<const viterbi_bit_t>, const std::chrono::nanoseconds process_time) {
+                times->radio_ms.push_back(std::chrono::duration<double, std::milli>(process_time).count());
+            }
+        );
+    }
+
+    Ensembles_Result result;
+    result.total_ensembles = total_ensembles;
+    result.is_private_pools = config.radio_private_pools;
+    result.radio_threads = runtime->get_total_radio_threads();
+    const auto time_start = std::chrono::steady_clock::now();
+    runtime->start(args.ofdm_block_size);
+    constexpr auto POLL_PERIOD = std::chrono::milliseconds(10);
+    while (!runtime->is_finished()) {
+        std::this_thread::sleep_for(POLL_PERIOD);
+        result.max_process_threads = std::max(result.max_process_threads, get_total_process_threads());
+        result.max_memory_bytes = std::max(result.max_memory_bytes, get_current_memory_bytes());
+    }
+    runtime->join();
+    const auto time_end = std::chrono::steady_clock::now();
+
+    // cores is the number of cores each stage needs to keep up with one realtime ensemble
+    result.wall_seconds = std::chrono::duration<double>(time_end - time_start).count();
+    result.signal_seconds = double(args.total_frames)*double(ensemble.get_frame_duration());
+    const double signal_seconds = result.signal_seconds;
+    const auto to_cores = [signal_seconds](const uint64_t ns) {
+        return (signal_seconds > 0.0) ? (double(ns)*1e-9 / signal_seconds) : 0.0;
+    };
+    Ensemble_CPU_Usage total_usage;
+    for (size_t i = 0; i < total_ensembles; i++) {
+        const auto usage = runtime->get_cpu_usage(i);
+        auto& ofdm_demod = runtime->get_ofdm_block(i).get_ofdm_demod();
+        const double audio_seconds = double(audio_counters[i].total_microseconds.load())*1e-6;
+        const int total_channels = audio_counters[i].total_channels.load();
+        const double ofdm_p99_ms = get_percentile(frame_times[i].ofdm_ms, 0.99);
+        const double radio_p99_ms = get_percentile(frame_times[i].radio_ms, 0.99);
+        if (is_verbose) {
+            fprintf(stderr,
+                "ensemble %zu: frames=%d desync=%d dropped=%zu channels=%d audio=%.1fs "
+                "p99_ms=(ofdm=%.3f, radio=%.3f) "
+                "cores=%.3f (ofdm_reader=%.3f, ofdm_threads=%.3f, radio_driver=%.3f, radio_pool=%.3f)\n",
+                i, ofdm_demod.GetTotalFramesRead(), ofdm_demod.GetTotalFramesDesync(),
+                runtime->get_frame_ring(i).get_total_dropped(), total_channels, audio_seconds,
+                ofdm_p99_ms, radio_p99_ms,
+                to_cores(usage.get_total()),
+                to_cores(usage.ofdm_reader), to_cores(usage.ofdm_threads),
+                to_cores(usage.radio_driver), to_cores(usage.radio_pool));
+        }
+        if (audio_seconds <= 0.0) result.is_audio_missing = true;
+        result.ofdm_p99_ms = std::max(result.ofdm_p99_ms, ofdm_p99_ms);
+        result.radio_p99_ms = std::max(result.radio_p99_ms, radio_p99_ms);
+        total_usage.ofdm_reader += usage.ofdm_reader;
+        total_usage.ofdm_threads += usage.ofdm_threads;
+        total_usage.radio_driver += usage.radio_driver;
+        total_usage.radio_pool += usage.radio_pool;
+        total_usage.radio_pool_tasks += usage.radio_pool_tasks;
+    }
+    const int total_affinity_errors = runtime->get_total_thread_affinity_errors();
+    runtime = nullptr;
+    if (!is_verbose) {
+        return result;
+    }
+
+    const double wall_seconds = result.wall_seconds;
+    const double total_frames = double(args.total_frames)*double(total_ensembles);
+    const double realtime_factor = result.get_realtime_factor();
+    fprintf(stderr, "wall=%.2fs signal=%.2fs frames_per_second=%.1f\n",
+        wall_seconds, signal_seconds, (wall_seconds > 0.0) ? (total_frames / wall_seconds) : 0.0);
+    fprintf(stderr, "realtime_factor=%.2fx per ensemble, %.2fx total\n",
+        realtime_factor, realtime_factor*double(total_ensembles));
+    fprintf(stderr, "cpu=%.2fs cores_per_ensemble=%.3f (ofdm=%.3f, radio=%.3f) radio_tasks=%llu\n",
+        double(total_usage.get_total())*1e-9, to_cores(total_usage.get_total())/double(total_ensembles),
+        to_cores(total_usage.ofdm_reader+total_usage.ofdm_threads)/double(total_ensembles),
+        to_cores(total_usage.radio_driver+total_usage.radio_pool)/double(total_ensembles),
+        (unsigned long long)(total_usage.radio_pool_tasks));
+    fprintf(stderr, "threads=%llu memory=%.1fMB peak_memory=%.1fMB\n",
+        (unsigned long long)(result.max_process_threads),
+        double(result.max_memory_bytes)/(1024.0*1024.0), double(get_peak_memory_bytes())/(1024.0*1024.0));
+    if (result.is_audio_missing) {
+        fprintf(stderr, "Warning: Some ensembles didn't decode any audio so the throughput isn't representative\n");
+    }
+    if (total_affinity_errors > 0) {
+        fprintf(stderr, "Failed to apply thread affinity or priority to %d threads\n", total_affinity_errors);
+    }
+    return result;
+}
+
+// Decodes 1, 2, 4, ... up to the max number of ensembles at once to show how the radio pools scale
+// NOTE: The process is reused between steps so memory is sampled while each step runs instead of its peak
+static void run_ensemble_sweep(const Args& args, const Simulated_Ensemble& ensemble) {
+    std::vector<size_t> steps;
+    for (size_t total_ensembles = 1; total_ensembles < args.sweep_max_ensembles; total_ensembles *= 2) {
+        steps.push_back(total_ensembles);
+    }
+    steps.push_back(args.sweep_max_ensembles);
+    fprintf(stderr, "Sweeping 1 to %zu ensembles with %s radio pools over %zu frames\n",
+        args.sweep_max_ensembles, args.is_radio_private_pools ? "private" : "shared", args.total_frames);
+
+    std::vector<Ensembles_Result> results;
+    for (const size_t total_ensembles: steps) {
+        results.push_back(run_ensembles(args, ensemble, total_ensembles, false));
+        const auto& result = results.back();
+        if (result.is_audio_missing) {
+            fprintf(stderr, "Warning: Some of the %zu ensembles didn't decode any audio\n", total_ensembles);
+        }
+    }
+
+    fprintf(stderr, "%9s %8s %13s %14s %12s %13s %8s %13s %11s\n",
+        "ensembles", "pools", "realtime_total", "realtime_each", "ofdm_p99_ms", "radio_p99_ms",
+        "threads", "radio_threads", "memory_MB");
+    for (const auto& result: results) {
+        const double realtime_factor = result.get_realtime_factor();
+        fprintf(stderr, "%9zu %8s %13.2fx %13.2fx %12.3f %13.3f %8llu %13zu %11.1f\n",
+            result.total_ensembles, result.is_private_pools ? "private" : "shared",
+            realtime_factor*double(result.total_ensembles), realtime_factor,
+            result.ofdm_p99_ms, result.radio_p99_ms,
+            (unsigned long long)(result.max_process_threads), result.radio_threads,
+            double(result.max_memory_bytes)/(1024.0*1024.0));
+    }
+}
+
+INITIALIZE_EASYLOGGINGPP
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("simulate_ensemble_throughput", "0.1.0");
+    parser.add_description(
+        "Decodes a simulated ensemble from IQ samples to audio as fast as possible. "
+        "Reports the throughput, CPU usage of each stage and peak memory usage."
+    );
+    parser.add_epilog(
+        "The services carry silent audio so the audio decoders do less work than with a real broadcast.\n"
+        "./simulate_ensemble_throughput --dab-plus-subchannels 12 --snr 10 --frequency-offset 500\n"
+        "Thread scaling of the demodulator and radio is measured with --sweep-threads.\n"
+        "./simulate_ensemble_throughput --sweep-threads 8 --frames 200\n"
+        "Scaling with the number of ensembles is measured with --sweep-ensembles.\n"
+        "./simulate_ensemble_throughput --sweep-ensembles 32 --frames 200 --radio-private-pools"
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    if (args.ofdm_block_size == 0) {
+        fprintf(stderr, "OFDM block size cannot be zero\n");
+        return 1;
+    }
+    if (args.total_ensembles == 0) {
+        fprintf(stderr, "At least one ensemble is required\n");
+        return 1;
+    }
+    if ((args.dab_subchannels < 0) || (args.dab_plus_subchannels < 0)) {
+        fprintf(stderr, "Number of subchannels cannot be negative\n");
+        return 1;
+    }
+    if (args.simd_level.compare("auto") != 0) {
+        SIMD_Level simd_level;
+        if (!simd_get_level_from_name(args.simd_level.c_str(), simd_level) || !simd_set_level(simd_level)) {
+            fprintf(stderr, "SIMD level '%s' is not supported on this CPU (supported up to '%s')\n",
+                args.simd_level.c_str(), simd_get_level_name(simd_get_supported_level()));
+            return 1;
+        }
+    }
+    fprintf(stderr, "Using SIMD kernels for %s\n", simd_get_level_name(simd_get_level()));
+    setup_easylogging(false, args.radio_enable_logging, false);
+    Metrics_Registry::Get().SetIsEnabled(args.is_metrics);
+    if (args.sweep_max_threads > 0) {
+        return run_thread_sweep(args);
+    }
+
+    const auto time_create_start = std::chrono::steady_clock::now();
+    Simulated_Ensemble ensemble;
+    std::string error;
+    if (!ensemble.create(get_ensemble_config(args), error)) {
+        fprintf(stderr, "Failed to create ensemble: %s\n", error.c_str());
+        return 1;
+    }
+    const auto time_create_end = std::chrono::steady_clock::now();
+    fprintf(stderr, "Simulated %zu subchannels using %d capacity units over %zu frames in %.2fs\n",
+        ensemble.get_total_subchannels(), ensemble.get_total_capacity_units(), ensemble.get_total_frames(),
+        std::chrono::duration<double>(time_create_end - time_create_start).count());
+
+    if (args.sweep_max_ensembles > 0) {
+        run_ensemble_sweep(args, ensemble);
+    } else {
+        run_ensembles(args, ensemble, args.total_ensembles, true);
+    }
+
+    if (args.is_metrics) {
+        const auto json = Metrics_Registry::Get().ExportJSON();
+        fprintf(stdout, "%s\n", json.c_str());
+    }
+    return 0;
+}
@@ -1,9 +1,12 @@
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <cmath>
 #include <complex>
 #include <exception>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 #include "utility/span.h"
 
@@ -13,11 +16,9 @@
 #endif
 
 #include <argparse/argparse.hpp>
-#include "ofdm/dab_mapper_ref.h"
-#include "ofdm/dab_ofdm_params_ref.h"
-#include "ofdm/dab_prs_ref.h"
+#include "ofdm/dab_ofdm_tables.h"
 #include "ofdm/dsp/apply_pll.h"
-#include "ofdm/ofdm_modulator.h"
+#include "ofdm/ofdm_batch_modulator.h"
 #include "ofdm/ofdm_params.h"
 
 // scrambler that is used for DVB transmissions
@@ -68,12 +69,24 @@ void init_parser(argparse::ArgumentParser& parser) {
         .metavar("OUTPUT_FILENAME")
         .nargs(1).required()
         .help("Filename of output from converter (defaults to stdout)");
+    parser.add_argument("--total-workers")
+        .default_value(int(0)).scan<'i', int>()
+        .metavar("TOTAL_WORKERS")
+        .nargs(1).required()
+        .help("Number of threads that modulate frames (0 for one per core)");
+    parser.add_argument("--frames-per-batch")
+        .default_value(int(16)).scan<'i', int>()
+        .metavar("TOTAL_FRAMES")
+        .nargs(1).required()
+        .help("Number of frames that are modulated together");
 }
 
 struct Args {
     int transmission_mode;
     float frequency;
     std::string output_filename;
+    int total_workers;
+    int frames_per_batch;
 };
 
 Args get_args_from_parser(const argparse::ArgumentParser& parser) {
@@ -81,6 +94,8 @@ Args get_args_from_parser(const argparse::ArgumentParser& parser) {
     args.transmission_mode = parser.get<int>("--transmission-mode");
     args.frequency = parser.get<float>("--frequency");
     args.output_filename = parser.get<std::string>("--output");
+    args.total_workers = parser.get<int>("--total-workers");
+    args.frames_per_batch = parser.get<int>("--frames-per-batch");
     return args;
 }
 
@@ -110,63 +125,86 @@ int main(int argc, char** argv) {
     _setmode(_fileno(fp_out), _O_BINARY);
 #endif
 
-    const auto params = get_DAB_OFDM_params(args.transmission_mode);
-    auto prs_fft_ref = std::vector<std::complex<float>>(params.nb_fft);
-    auto carrier_mapper = std::vector<int>(params.nb_data_carriers);
-    get_DAB_PRS_reference(args.transmission_mode, prs_fft_ref);
-    get_DAB_mapper_ref(carrier_mapper, params.nb_fft);
+    if (args.total_workers < 0) {
+        fprintf(stderr, "Total workers must be positive (%d)\n", args.total_workers);
+        return 1;
+    }
+    if (args.frames_per_batch <= 0) {
+        fprintf(stderr, "Frames per batch must be positive (%d)\n", args.frames_per_batch);
+        return 1;
+    }
 
-    // create our single ofdm frame
-    const size_t frame_size = params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols;
-    auto frame_out_buf = std::vector<std::complex<float>>(frame_size);
-    auto frame_tx_buf = std::vector<RawIQ>(frame_size);
+    const auto& tables = get_DAB_OFDM_tables(args.transmission_mode);
+    const auto& params = tables.params;
+    auto ofdm_mod = OFDM_Batch_Modulator(params, tables.prs_fft_ref, size_t(args.total_workers));
 
     // determine the number of bits that the ofdm frame contains
     // a single carrier contains 2 bits (there are four possible dqpsk phases)
     // the PRS (phase reference symbol) doesnt contain any information
-    const size_t nb_frame_bits = (params.nb_frame_symbols-1)*params.nb_data_carriers*2;
-    const size_t nb_frame_bytes = nb_frame_bits/8;
+    const size_t nb_frames = size_t(args.frames_per_batch);
+    const size_t frame_size = ofdm_mod.GetFrameSize();
+    const size_t nb_frame_bytes = ofdm_mod.GetFrameDataSize();
+    auto frames_bytes_buf = std::vector<uint8_t>(nb_frames*nb_frame_bytes);
+    auto frames_out_buf = std::vector<std::complex<float>>(nb_frames*frame_size);
+    // one batch is written out while the next one is modulated
+    auto frames_tx_bufs = std::vector<std::vector<RawIQ>>(2, std::vector<RawIQ>(nb_frames*frame_size));
 
-    // generate random digital data
-    auto frame_bytes_buf = std::vector<uint8_t>(nb_frame_bytes);
     auto scrambler = Scrambler();
     scrambler.Reset();
-    for (size_t i = 0; i < nb_frame_bytes; i++) {
-        frame_bytes_buf[i] = scrambler.Process();
-    }
+    const float Fs = 2.048e6f; // DAB sampling frequency
+    const float frequency_norm = args.frequency / Fs;
+    float dt = 0.0f;
+    bool is_write_ok = true;
+    std::thread writer_thread;
+    for (size_t batch_index = 0; ; batch_index++) {
+        // generate random digital data
+        for (auto& v: frames_bytes_buf) {
+            v = scrambler.Process();
+        }
 
-    // perform OFDM modulation 
-    auto ofdm_mod = OFDM_Modulator(params, prs_fft_ref);
-    auto res = ofdm_mod.ProcessBlock(frame_out_buf, frame_bytes_buf);
-    if (!res) {
-        fprintf(stderr, "Failed to create the OFDM frame\n");
-        return 1;
-    }
- 
-    if (args.frequency != 0.0f) {
-        const float Fs = 2.048e6f; // DAB sampling frequency
-        const float frequency_norm = args.frequency / Fs;
-        apply_pll_auto(frame_out_buf, frame_out_buf, frequency_norm);
-    }
+        // perform OFDM modulation
+        const bool res = ofdm_mod.ProcessFrames(frames_out_buf, frames_bytes_buf);
+        if (!res) {
+            fprintf(stderr, "Failed to create the OFDM frames\n");
+            break;
+        }
+
+        if (frequency_norm != 0.0f) {
+            apply_pll_auto(frames_out_buf, frames_out_buf, frequency_norm, dt);
+            dt += float(frames_out_buf.size())*frequency_norm;
+            dt = dt - std::round(dt);
+        }
 
-    for (size_t i = 0; i < frame_size; i++) {
-        const float I = frame_out_buf[i].real();
-        const float Q = frame_out_buf[i].imag();
+        auto& frames_tx_buf = frames_tx_bufs[batch_index % 2];
         const float A = 1.0f/(float)params.nb_data_carriers * 200.0f * 2.0f;
-        const float I0 = clamp(I*A + 128.0f, 0.0f, 255.0f);
-        const float Q0 = clamp(Q*A + 128.0f, 0.0f, 255.0f);
-        const uint8_t I1 = static_cast<uint8_t>(I0);
-        const uint8_t Q1 = static_cast<uint8_t>(Q0);
-        frame_tx_buf[i] = RawIQ{ I1, Q1 };
-    }
+        for (size_t i = 0; i < frames_out_buf.size(); i++) {
+            const float I = frames_out_buf[i].real();
+            const float Q = frames_out_buf[i].imag();
+            const float I0 = clamp(I*A + 128.0f, 0.0f, 255.0f);
+            const float Q0 = clamp(Q*A + 128.0f, 0.0f, 255.0f);
+            const uint8_t I1 = static_cast<uint8_t>(I0);
+            const uint8_t Q1 = static_cast<uint8_t>(Q0);
+            frames_tx_buf[i] = RawIQ{ I1, Q1 };
+        }
 
-    while (true) {
-        const size_t N = frame_tx_buf.size();
-        const size_t nb_write = fwrite(frame_tx_buf.data(), sizeof(RawIQ), N, fp_out);
-        if (nb_write != N) {
-            fprintf(stderr, "Failed to write out frame %zu/%zu\n", nb_write, N);
+        // NOTE: The writer of the previous batch is finished before the buffer it used is converted into again
+        if (writer_thread.joinable()) {
+            writer_thread.join();
+        }
+        if (!is_write_ok) {
             break;
         }
+        writer_thread = std::thread([&frames_tx_buf, &is_write_ok, fp_out]() {
+            const size_t N = frames_tx_buf.size();
+            const size_t nb_write = fwrite(frames_tx_buf.data(), sizeof(RawIQ), N, fp_out);
+            if (nb_write != N) {
+                fprintf(stderr, "Failed to write out frames %zu/%zu\n", nb_write, N);
+                is_write_ok = false;
+            }
+        });
+    }
+    if (writer_thread.joinable()) {
+        writer_thread.join();
     }
     fclose(fp_out);
     return 0;
@@ -0,0 +1,235 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include <argparse/argparse.hpp>
+#include "dab/constants/dab_parameters.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./app_helpers/app_io_buffers.h"
+#include "./app_helpers/app_network_buffers.h"
+
+void init_parser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-m", "--mode")
+        .choices("send", "receive")
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Send soft bits from the input or receive soft bits to the output (send, receive)");
+    parser.add_argument("-p", "--protocol")
+        .default_value(std::string("tcp"))
+        .choices("tcp", "udp")
+        .metavar("PROTOCOL")
+        .nargs(1).required()
+        .help("Network transport (tcp = single receiver with backpressure, udp = multicast to many receivers)");
+    parser.add_argument("-a", "--address")
+        .default_value(std::string(""))
+        .metavar("ADDRESS")
+        .nargs(1).required()
+        .help("Host to send to or address to listen on for tcp, multicast group for udp");
+    parser.add_argument("--port")
+        .default_value(uint16_t(5055)).scan<'u', uint16_t>()
+        .metavar("PORT")
+        .nargs(1).required()
+        .help("Port to send to or receive on");
+    parser.add_argument("-i", "--input")
+        .default_value(std::string(""))
+        .metavar("INPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of soft bits to send (defaults to stdin)");
+    parser.add_argument("-o", "--output")
+        .default_value(std::string(""))
+        .metavar("OUTPUT_FILENAME")
+        .nargs(1).required()
+        .help("Filename of received soft bits (defaults to stdout)");
+    parser.add_argument("-M", "--transmission-mode")
+        .default_value(int(1)).scan<'i', int>()
+        .choices(1,2,3,4)
+        .metavar("MODE")
+        .nargs(1).required()
+        .help("Transmission mode of the soft bits");
+    parser.add_argument("--packed")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Send soft bits as packed 4bit values which halves the bandwidth");
+    parser.add_argument("--frames-per-batch")
+        .default_value(size_t(1)).scan<'u', size_t>()
+        .metavar("FRAMES")
+        .nargs(1).required()
+        .help("Number of frames sent together over tcp");
+    parser.add_argument("--max-datagram-size")
+        .default_value(size_t(1400)).scan<'u', size_t>()
+        .metavar("BYTES")
+        .nargs(1).required()
+        .help("Largest udp datagram which should fit in the network MTU");
+    parser.add_argument("--multicast-interface")
+        .default_value(std::string(""))
+        .metavar("IPV4_ADDRESS")
+        .nargs(1).required()
+        .help("Local interface used for udp multicast (defaults to any)");
+    parser.add_argument("--multicast-ttl")
+        .default_value(int(1)).scan<'i', int>()
+        .metavar("TTL")
+        .nargs(1).required()
+        .help("Number of router hops udp multicast can cross");
+    parser.add_argument("--disable-statistics")
+        .default_value(false).implicit_value(true)
+        .nargs(0)
+        .help("Don't print the number of frames transferred, dropped and missing when finished");
+}
+
+struct Args {
+    bool is_send;
+    bool is_tcp;
+    std::string address;
+    uint16_t port;
+    std::string input_filename;
+    std::string output_filename;
+    int transmission_mode;
+    bool is_packed;
+    size_t frames_per_batch;
+    size_t max_datagram_size;
+    std::string multicast_interface;
+    int multicast_ttl;
+    bool is_print_statistics;
+};
+
+Args get_args_from_parser(const argparse::ArgumentParser& parser) {
+    Args args;
+    args.is_send = parser.get<std::string>("--mode").compare("send") == 0;
+    args.is_tcp = parser.get<std::string>("--protocol").compare("tcp") == 0;
+    args.address = parser.get<std::string>("--address");
+    args.port = parser.get<uint16_t>("--port");
+    args.input_filename = parser.get<std::string>("--input");
+    args.output_filename = parser.get<std::string>("--output");
+    args.transmission_mode = parser.get<int>("--transmission-mode");
+    args.is_packed = parser.get<bool>("--packed");
+    args.frames_per_batch = parser.get<size_t>("--frames-per-batch");
+    args.max_datagram_size = parser.get<size_t>("--max-datagram-size");
+    args.multicast_interface = parser.get<std::string>("--multicast-interface");
+    args.multicast_ttl = parser.get<int>("--multicast-ttl");
+    args.is_print_statistics = !parser.get<bool>("--disable-statistics");
+    return args;
+}
+
+static void print_statistics(const Network_Frame_Statistics& stats) {
+    fprintf(stderr,
+        "frames=%llu dropped=%llu missing=%llu connections=%llu\n",
+        (unsigned long long)stats.total_frames, (unsigned long long)stats.total_dropped,
+        (unsigned long long)stats.total_missing, (unsigned long long)stats.total_connections);
+}
+
+// Copy whole frames between an input and output buffer until either ends
+static void copy_frames(InputBuffer<viterbi_bit_t>& input, OutputBuffer<viterbi_bit_t>& output, const size_t nb_frame_bits) {
+    auto buf_bits = std::vector<viterbi_bit_t>(nb_frame_bits);
+    while (true) {
+        const size_t total_read = input.read(buf_bits);
+        if (total_read == 0) break;
+        const auto write_buf = tcb::span(buf_bits).first(total_read);
+        const size_t total_written = output.write(write_buf);
+        if (total_written != total_read) break;
+        if (total_read != buf_bits.size()) break;
+    }
+}
+
+int main(int argc, char** argv) {
+    auto parser = argparse::ArgumentParser("soft_bit_network", "0.1.0");
+    parser.add_description("Sends or receives viterbi soft bits over the network");
+    parser.add_epilog(
+        "This lets the OFDM demodulator and the radio run on different hosts.\n"
+        "Over tcp a slow receiver blocks the sender while over udp multicast frames with lost datagrams are dropped."
+    );
+    init_parser(parser);
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    const auto args = get_args_from_parser(parser);
+    const auto format = args.is_packed ? Network_Bit_Format::PACKED : Network_Bit_Format::SOFT;
+    const auto params = get_dab_parameters(args.transmission_mode);
+    const size_t nb_frame_bits = size_t(params.nb_frame_bits);
+    const std::string port = std::to_string(args.port);
+
+    if ((!args.is_tcp || args.is_send) && args.address.empty()) {
+        fprintf(stderr, "An address must be given to send to or for the multicast group\n");
+        return 1;
+    }
+
+    if (args.is_send) {
+        FILE* fp_in = stdin;
+        if (!args.input_filename.empty()) {
+            fp_in = fopen(args.input_filename.c_str(), "rb");
+            if (fp_in == nullptr) {
+                fprintf(stderr, "Failed to open input file: '%s'\n", args.input_filename.c_str());
+                return 1;
+            }
+        }
+#if _WIN32
+        _setmode(_fileno(fp_in), _O_BINARY);
+#endif
+        auto bits_in = std::make_shared<InputFile<viterbi_bit_t>>(fp_in);
+        if (args.is_tcp) {
+            auto sender = std::make_shared<TCP_Frame_Sender>(args.address, port, args.transmission_mode, format, args.frames_per_batch);
+            if (!sender->connect()) {
+                fprintf(stderr, "Failed to connect to %s:%s\n", args.address.c_str(), port.c_str());
+                return 1;
+            }
+            copy_frames(*bits_in, *sender, nb_frame_bits);
+            sender->close();
+            if (args.is_print_statistics) print_statistics(sender->get_statistics());
+        } else {
+            auto sender = std::make_shared<UDP_Multicast_Frame_Sender>(args.transmission_mode, format, args.max_datagram_size);
+            if (!sender->open(args.address, args.port, args.multicast_interface, args.multicast_ttl)) {
+                fprintf(stderr, "Failed to open multicast group %s:%s\n", args.address.c_str(), port.c_str());
+                return 1;
+            }
+            copy_frames(*bits_in, *sender, nb_frame_bits);
+            sender->close();
+            if (args.is_print_statistics) print_statistics(sender->get_statistics());
+        }
+        return 0;
+    }
+
+    FILE* fp_out = stdout;
+    if (!args.output_filename.empty()) {
+        fp_out = fopen(args.output_filename.c_str(), "wb+");
+        if (fp_out == nullptr) {
+            fprintf(stderr, "Failed to open output file: '%s'\n", args.output_filename.c_str());
+            return 1;
+        }
+    }
+#if _WIN32
+    _setmode(_fileno(fp_out), _O_BINARY);
+#endif
+    auto bits_out = std::make_shared<OutputFile<viterbi_bit_t>>(fp_out);
+    if (args.is_tcp) {
+        auto receiver = std::make_shared<TCP_Frame_Receiver>(args.transmission_mode);
+        if (!receiver->listen(args.address, port)) {
+            fprintf(stderr, "Failed to listen on port %s\n", port.c_str());
+            return 1;
+        }
+        copy_frames(*receiver, *bits_out, nb_frame_bits);
+        if (args.is_print_statistics) print_statistics(receiver->get_statistics());
+    } else {
+        auto receiver = std::make_shared<UDP_Multicast_Frame_Receiver>(args.transmission_mode);
+        if (!receiver->open(args.address, args.port, args.multicast_interface)) {
+            fprintf(stderr, "Failed to join multicast group %s:%s\n", args.address.c_str(), port.c_str());
+            return 1;
+        }
+        copy_frames(*receiver, *bits_out, nb_frame_bits);
+        if (args.is_print_statistics) print_statistics(receiver->get_statistics());
+    }
+    return 0;
+}
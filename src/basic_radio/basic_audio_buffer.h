@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "utility/span.h"
+#include "./basic_audio_params.h"
+
+// Decoded PCM audio that observers can hold onto and process asynchronously without copying it
+struct Basic_Audio_Buffer {
+    BasicAudioParams params;
+    std::vector<uint8_t> data;
+    tcb::span<const uint8_t> GetData(void) const { return { data.data(), data.size() }; }
+};
+
+// Shared by every consumer of a block of audio and released once they all drop their reference
+using Basic_Audio_Buffer_Ref = std::shared_ptr<const Basic_Audio_Buffer>;
+
+// Pool of audio buffers owned by a channel
+// A buffer is free once the pool holds the only reference to it, so released buffers are reused without allocating
+// If consumers hold onto every buffer then extra ones are allocated outside of the pool until they catch up
+// NOTE: Acquire() must only be called by one thread at a time (the thread decoding the channel)
+class Basic_Audio_Buffer_Pool
+{
+public:
+    static constexpr size_t DEFAULT_MAX_BUFFERS = 32;
+private:
+    std::vector<std::shared_ptr<Basic_Audio_Buffer>> m_buffers;
+    const size_t m_max_buffers;
+    size_t m_next_index = 0;
+    std::atomic<uint64_t> m_total_overflows{0};
+public:
+    explicit Basic_Audio_Buffer_Pool(const size_t max_buffers=DEFAULT_MAX_BUFFERS)
+    : m_max_buffers(max_buffers)
+    {
+        m_buffers.reserve(m_max_buffers);
+    }
+    Basic_Audio_Buffer_Pool(Basic_Audio_Buffer_Pool&) = delete;
+    Basic_Audio_Buffer_Pool(Basic_Audio_Buffer_Pool&&) = delete;
+    Basic_Audio_Buffer_Pool& operator=(Basic_Audio_Buffer_Pool&) = delete;
+    Basic_Audio_Buffer_Pool& operator=(Basic_Audio_Buffer_Pool&&) = delete;
+
+    Basic_Audio_Buffer_Ref Acquire(const BasicAudioParams& params, tcb::span<const uint8_t> data) {
+        auto buffer = GetFreeBuffer();
+        buffer->params = params;
+        buffer->data.assign(data.begin(), data.end());
+        return buffer;
+    }
+    size_t GetTotalBuffers(void) const { return m_buffers.size(); }
+    // Buffers that were allocated outside of the pool since all of the pooled ones were held
+    uint64_t GetTotalOverflows(void) const { return m_total_overflows.load(std::memory_order_relaxed); }
+private:
+    std::shared_ptr<Basic_Audio_Buffer> GetFreeBuffer(void) {
+        // Scanning starts after the last acquired buffer since the oldest buffers are the most likely to be released
+        const size_t N = m_buffers.size();
+        for (size_t i = 0; i < N; i++) {
+            const size_t index = (m_next_index + i) % N;
+            auto& buffer = m_buffers[index];
+            if (buffer.use_count() != 1) continue;
+            // The last consumer released its reference with a release decrement so their reads happen before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+            m_next_index = (index+1) % N;
+            return buffer;
+        }
+        if (N < m_max_buffers) {
+            m_buffers.push_back(std::make_shared<Basic_Audio_Buffer>());
+            m_next_index = 0;
+            return m_buffers.back();
+        }
+        m_total_overflows.fetch_add(1, std::memory_order_relaxed);
+        return std::make_shared<Basic_Audio_Buffer>();
+    }
+};
@@ -1,16 +1,74 @@
 #include "./basic_audio_channel.h"
 #include <assert.h>
 #include <memory>
+#include <memory_resource>
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
+#include "dab/mot/MOT_processor.h"
 #include "dab/msc/msc_decoder.h"
+#include "dab/pad/pad_processor.h"
+#include "utility/cost_account.h"
+#include "utility/memory_usage.h"
+#include "utility/span.h"
+#include "./basic_pad_queue.h"
 #include "./basic_slideshow.h"
+#include "./basic_thread_pool.h"
 
-Basic_Audio_Channel::Basic_Audio_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type) 
-: m_params(params), m_subchannel(subchannel), m_audio_service_type(audio_service_type) {
+Basic_Audio_Channel::Basic_Audio_Channel(
+    const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+    std::pmr::memory_resource* memory_resource)
+: m_params(params), m_subchannel(subchannel), m_audio_service_type(audio_service_type),
+  m_memory_resource(memory_resource)
+{
     assert(subchannel.is_complete);
-    m_msc_decoder = std::make_unique<MSC_Decoder>(m_subchannel);
+    m_msc_decoder = std::make_unique<MSC_Decoder>(m_subchannel, memory_resource);
     m_slideshow_manager = std::make_unique<Basic_Slideshow_Manager>();
 }
 
 Basic_Audio_Channel::~Basic_Audio_Channel() = default;
+
+void Basic_Audio_Channel::Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) {
+    m_msc_decoder->Reconfigure(subchannel, cif_index);
+}
+
+void Basic_Audio_Channel::SetMaxErrorPerBit(const float max_error_per_bit) {
+    m_msc_decoder->SetMaxErrorPerBit(max_error_per_bit);
+}
+
+void Basic_Audio_Channel::SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) {
+    m_msc_decoder->SetViterbiBackend(std::move(backend));
+}
+
+Memory_Usage Basic_Audio_Channel::GetMemoryUsage() {
+    Memory_Usage usage("channel");
+    usage.AddChild(m_msc_decoder->GetMemoryUsage());
+    usage.AddChild(GetPADProcessor().Get_MOT_Processor().GetMemoryUsage());
+    usage.AddChild("slideshows", m_slideshow_manager->GetTotalBytes());
+    return usage;
+}
+
+void Basic_Audio_Channel::SetPADThreadPool(std::shared_ptr<BasicThreadPool> thread_pool) {
+    // the old queue finishes its pending PAD first so it is still processed in order
+    m_pad_queue = nullptr;
+    if (thread_pool == nullptr) return;
+    m_pad_queue = std::make_unique<Basic_PAD_Queue>(
+        GetPADProcessor(), std::move(thread_pool), GetCostAccount(), 
+        Basic_PAD_Queue::DEFAULT_CAPACITY, m_memory_resource);
+}
+
+void Basic_Audio_Channel::ProcessPAD(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad) {
+    if (m_pad_queue == nullptr) {
+        COST_STAGE_SCOPE(Cost_Stage::PAD);
+        GetPADProcessor().Process(fpad, xpad);
+        return;
+    }
+    if (!m_pad_queue->Push(fpad, xpad)) {
+        m_error_counts.dropped_pad++;
+    }
+}
+
+BasicTaskPriority Basic_Audio_Channel::GetPriority() {
+    if (m_controls.GetIsPlayAudio()) return BasicTaskPriority::HIGH;
+    if (m_controls.GetIsDecodeAudio()) return BasicTaskPriority::NORMAL;
+    return BasicTaskPriority::LOW;
+}
@@ -2,21 +2,47 @@
 
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
+#include "./basic_audio_buffer.h"
 #include "./basic_audio_controls.h"
 #include "./basic_audio_params.h"
 #include "./basic_msc_runner.h"
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
+#include "dab/pad/pad_dynamic_label.h"
+#include "utility/latency_trace.h"
 #include "utility/observable.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 
 class MSC_Decoder;
+class PAD_Processor;
+class BasicThreadPool;
+class Basic_PAD_Queue;
 struct MOT_Entity;
 struct Basic_Slideshow;
 class Basic_Slideshow_Manager;
+class MOT_Assembler_Budget;
+
+// Running totals since the channel was created
+// NOTE: These are written by the thread decoding the channel so read them once the radio has stopped
+struct Basic_Audio_Error_Counts {
+    // MP2 frames for DAB and superframes for DAB+
+    uint64_t total_frames = 0;
+    uint64_t total_access_units = 0;
+    uint64_t firecode_errors = 0;
+    // reed solomon codewords that couldn't be corrected
+    uint64_t rs_errors = 0;
+    uint64_t au_crc_errors = 0;
+    // MP2 frames or AAC access units that failed to decode
+    uint64_t codec_errors = 0;
+    // PAD that didn't fit in the queue of a channel whose PAD is processed on the thread pool
+    uint64_t dropped_pad = 0;
+    // CIFs that weren't decoded past viterbi since they were mostly noise
+    uint64_t unreliable_cifs = 0;
+};
 
 // Shared interface for DAB+/DAB channels
 class Basic_Audio_Channel: public Basic_MSC_Runner
@@ -26,25 +52,99 @@ protected:
     const Subchannel m_subchannel;
     const AudioServiceType m_audio_service_type;
     Basic_Audio_Controls m_controls;
+    // epoch of the controls that the decoders were last updated for
+    uint32_t m_controls_epoch = 0;
+    // formatted once since it is set for every processed CIF
+    std::string m_thread_name;
     // DAB data processing components
+    // UTF-8 label which is only updated when the broadcaster changes it
     std::string m_dynamic_label;
     std::unique_ptr<MSC_Decoder> m_msc_decoder;
     // Programme associated data
     std::unique_ptr<Basic_Slideshow_Manager> m_slideshow_manager;
+    // PAD is processed inline if there is no queue
+    // NOTE: Derived classes reset this before their PAD_Processor is destroyed
+    std::unique_ptr<Basic_PAD_Queue> m_pad_queue;
+    std::pmr::memory_resource* const m_memory_resource;
+    Basic_Audio_Error_Counts m_error_counts;
+    // audio handed to observers that keep a reference to it
+    Basic_Audio_Buffer_Pool m_audio_buffer_pool;
     // callbacks
-    Observable<BasicAudioParams, tcb::span<const uint8_t>> m_obs_audio_data;
-    Observable<std::string_view> m_obs_dynamic_label;
-    Observable<MOT_Entity> m_obs_MOT_entity;
+    Ref_Observable<BasicAudioParams, tcb::span<const uint8_t>> m_obs_audio_data;
+    Ref_Observable<Basic_Audio_Buffer_Ref> m_obs_audio_buffer;
+    Ref_Observable<BasicAudioParams, tcb::span<const uint8_t>> m_obs_play_audio_data;
+    Ref_Observable<std::string_view> m_obs_dynamic_label;
+    Ref_Observable<DL_Plus_Info> m_obs_dynamic_label_plus;
+    Ref_Observable<MOT_Entity> m_obs_MOT_entity;
 public:
-    explicit Basic_Audio_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type);
+    explicit Basic_Audio_Channel(
+        const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+        std::pmr::memory_resource* memory_resource);
     virtual ~Basic_Audio_Channel() override;
-    virtual void Process(tcb::span<const viterbi_bit_t> msc_bits_buf) override = 0;
+    virtual void Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) override = 0;
+    // Programme associated MOT entities are assembled within this shared byte budget
+    virtual void SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) = 0;
+    // PAD is queued and processed by low priority tasks on this pool instead of with the audio
+    // Dynamic label and MOT observers are then notified from the pool's workers
+    // nullptr processes PAD inline with the audio, which is the default
+    // NOTE: This can't be changed while Process() is running
+    void SetPADThreadPool(std::shared_ptr<BasicThreadPool> thread_pool);
+    bool GetIsPADQueued() const { return m_pad_queue != nullptr; }
+    MSC_Decoder* GetActiveMSCDecoder() override { return m_controls.GetAnyEnabled() ? m_msc_decoder.get() : nullptr; }
+    const MSC_Decoder* GetHistoryMSCDecoder() override {
+        return (m_controls.GetAnyEnabled() || m_controls.GetIsStandby()) ? m_msc_decoder.get() : nullptr;
+    }
+    void Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) override;
+    void SetMaxErrorPerBit(const float max_error_per_bit) override;
+    void SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) override;
+    // Played audio is ahead of audio that is only decoded which is ahead of data or encoded output
+    BasicTaskPriority GetPriority() override;
+    Memory_Usage GetMemoryUsage() override;
     AudioServiceType GetType(void) const { return m_audio_service_type; }
+    const Subchannel& GetSubchannel(void) const { return m_subchannel; }
+    // Whether the audio codec has to run to produce PCM audio
+    bool GetIsPCMAudioNeeded(void) const {
+        if (!m_controls.GetIsDecodeAudio()) return false;
+        if (!m_controls.GetIsDecodeOnDemand()) return true;
+        return m_controls.GetIsPlayAudio() || (m_obs_audio_data.GetTotalObservers() > 0) || (m_obs_audio_buffer.GetTotalObservers() > 0);
+    }
     auto& GetControls(void) { return m_controls; }
     std::string_view GetDynamicLabel(void) const { return m_dynamic_label; }
     auto& GetSlideshowManager(void) { return *m_slideshow_manager; }
+    const auto& GetErrorCounts(void) const { return m_error_counts; }
+    // Decoded audio for recorders and other consumers that always want it
     auto& OnAudioData(void) { return m_obs_audio_data; }
+    // Same as above except observers can keep the buffer to process it later instead of copying it
+    // Each block of audio is copied once into a pooled buffer that is shared by all of these observers
+    auto& OnAudioBuffer(void) { return m_obs_audio_buffer; }
+    const auto& GetAudioBufferPool(void) const { return m_audio_buffer_pool; }
+    // Decoded audio while play audio is enabled for sound devices
+    auto& OnPlayAudioData(void) { return m_obs_play_audio_data; }
     auto& OnDynamicLabel(void) { return m_obs_dynamic_label; }
+    // DL Plus tags (e.g. title and artist) of the dynamic label
+    // NOTE: The tags are only valid during the callback
+    auto& OnDynamicLabelPlus(void) { return m_obs_dynamic_label_plus; }
     auto& OnMOTEntity(void) { return m_obs_MOT_entity; }
+protected:
+    virtual PAD_Processor& GetPADProcessor() = 0;
+    // Queued if there is a PAD thread pool, otherwise processed straight away
+    void ProcessPAD(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad);
+    // Called at the start of each CIF so changes from other threads are applied between CIFs
+    bool IsControlsChanged(void) {
+        const uint32_t epoch = m_controls.GetEpoch();
+        if (epoch == m_controls_epoch) return false;
+        m_controls_epoch = epoch;
+        return true;
+    }
+    // Decoded audio is sent to the observers of OnAudioData(), OnAudioBuffer() and OnPlayAudioData()
+    // They can add their own output delay to get_latency_trace_capture_time() which is the capture time of the audio
+    void NotifyAudioData(const BasicAudioParams& params, tcb::span<const uint8_t> data) {
+        LATENCY_TRACE_RECORD("dab_latency_audio_seconds", "Time from capturing the samples of a frame to its PCM audio being given to observers");
+        m_obs_audio_data.Notify(params, data);
+        if (m_obs_audio_buffer.GetTotalObservers() > 0) {
+            m_obs_audio_buffer.Notify(m_audio_buffer_pool.Acquire(params, data));
+        }
+        if (m_controls.GetIsPlayAudio()) m_obs_play_audio_data.Notify(params, data);
+    }
 };
 
@@ -1,43 +1,55 @@
 #include "./basic_audio_controls.h"
 #include <stdint.h>
+#include <atomic>
 
 // controls
 constexpr uint8_t CONTROL_FLAG_DECODE_AUDIO = 0b10000000;
 constexpr uint8_t CONTROL_FLAG_DECODE_DATA  = 0b01000000;
 constexpr uint8_t CONTROL_FLAG_PLAY_AUDIO   = 0b00100000;
 constexpr uint8_t CONTROL_FLAG_ALL_SELECTED = 0b11100000;
+// standby isn't a decoding control so it is kept by RunAll() and StopAll()
+constexpr uint8_t CONTROL_FLAG_STANDBY      = 0b00010000;
+// encoded audio is only wanted for archiving so it isn't turned on by RunAll()
+constexpr uint8_t CONTROL_FLAG_ENCODED_AUDIO= 0b00001000;
+// on demand only changes how decoded audio is produced so it is also kept by RunAll() and StopAll()
+constexpr uint8_t CONTROL_FLAG_DECODE_ON_DEMAND = 0b00000100;
+// low complexity only changes how decoded audio is produced so it is also kept by RunAll() and StopAll()
+constexpr uint8_t CONTROL_FLAG_LOW_COMPLEXITY = 0b00000010;
+constexpr uint8_t CONTROL_FLAG_ANY_OUTPUT   = CONTROL_FLAG_ALL_SELECTED | CONTROL_FLAG_ENCODED_AUDIO;
 
 bool Basic_Audio_Controls::GetAnyEnabled(void) const {
-    return (flags != 0);
+    return GetFlag(CONTROL_FLAG_ANY_OUTPUT);
 }
 
 bool Basic_Audio_Controls::GetAllEnabled(void) const {
-    return (flags == CONTROL_FLAG_ALL_SELECTED);
+    return (m_flags.load(std::memory_order_acquire) & CONTROL_FLAG_ALL_SELECTED) == CONTROL_FLAG_ALL_SELECTED;
 }
 
 void Basic_Audio_Controls::RunAll(void) {
-    flags = CONTROL_FLAG_ALL_SELECTED;
+    UpdateFlags(0, CONTROL_FLAG_ALL_SELECTED);
 }
 
 void Basic_Audio_Controls::StopAll(void) {
-    flags = 0;
+    UpdateFlags(CONTROL_FLAG_ANY_OUTPUT, 0);
 }
 
 // Decode AAC audio elements
 bool Basic_Audio_Controls::GetIsDecodeAudio(void) const {
-    return (flags & CONTROL_FLAG_DECODE_AUDIO) != 0;
+    return GetFlag(CONTROL_FLAG_DECODE_AUDIO);
 }
 
 void Basic_Audio_Controls::SetIsDecodeAudio(bool v) {
-    SetFlag(CONTROL_FLAG_DECODE_AUDIO, v);
-    if (!v) {
-        SetFlag(CONTROL_FLAG_PLAY_AUDIO, false);
+    if (v) {
+        UpdateFlags(0, CONTROL_FLAG_DECODE_AUDIO);
+    } else {
+        // audio can't be played without decoding it
+        UpdateFlags(CONTROL_FLAG_DECODE_AUDIO | CONTROL_FLAG_PLAY_AUDIO, 0);
     }
 }
 
 // Decode AAC data_stream_element
 bool Basic_Audio_Controls::GetIsDecodeData(void) const {
-    return (flags & CONTROL_FLAG_DECODE_DATA) != 0;
+    return GetFlag(CONTROL_FLAG_DECODE_DATA);
 }
 
 void Basic_Audio_Controls::SetIsDecodeData(bool v) {
@@ -46,20 +58,76 @@ void Basic_Audio_Controls::SetIsDecodeData(bool v) {
 
 // Play audio data through sound device
 bool Basic_Audio_Controls::GetIsPlayAudio(void) const {
-    return (flags & CONTROL_FLAG_PLAY_AUDIO) != 0;
+    return GetFlag(CONTROL_FLAG_PLAY_AUDIO);
 }
 
 void Basic_Audio_Controls::SetIsPlayAudio(bool v) { 
-    SetFlag(CONTROL_FLAG_PLAY_AUDIO, v);
     if (v) {
-        SetFlag(CONTROL_FLAG_DECODE_AUDIO, true);
+        UpdateFlags(0, CONTROL_FLAG_PLAY_AUDIO | CONTROL_FLAG_DECODE_AUDIO);
+    } else {
+        UpdateFlags(CONTROL_FLAG_PLAY_AUDIO, 0);
     }
 }
 
+// Output encoded AAC/MP2 frames without decoding them
+bool Basic_Audio_Controls::GetIsEncodedAudio(void) const {
+    return GetFlag(CONTROL_FLAG_ENCODED_AUDIO);
+}
+
+void Basic_Audio_Controls::SetIsEncodedAudio(bool v) {
+    SetFlag(CONTROL_FLAG_ENCODED_AUDIO, v);
+}
+
+// Only run the audio codec while audio is played or recorded
+bool Basic_Audio_Controls::GetIsDecodeOnDemand(void) const {
+    return GetFlag(CONTROL_FLAG_DECODE_ON_DEMAND);
+}
+
+void Basic_Audio_Controls::SetIsDecodeOnDemand(bool v) {
+    SetFlag(CONTROL_FLAG_DECODE_ON_DEMAND, v);
+}
+
+// Keep the subchannel in the CIF history while nothing is enabled
+bool Basic_Audio_Controls::GetIsStandby(void) const {
+    return GetFlag(CONTROL_FLAG_STANDBY);
+}
+
+void Basic_Audio_Controls::SetIsStandby(bool v) {
+    SetFlag(CONTROL_FLAG_STANDBY, v);
+}
+
+// Decode DAB+ audio with downsampled SBR
+bool Basic_Audio_Controls::GetIsLowComplexity(void) const {
+    return GetFlag(CONTROL_FLAG_LOW_COMPLEXITY);
+}
+
+void Basic_Audio_Controls::SetIsLowComplexity(bool v) {
+    SetFlag(CONTROL_FLAG_LOW_COMPLEXITY, v);
+}
+
+uint32_t Basic_Audio_Controls::GetEpoch(void) const {
+    return m_epoch.load(std::memory_order_acquire);
+}
+
 void Basic_Audio_Controls::SetFlag(const uint8_t flag, const bool state) {
     if (state) {
-        flags |= flag;
+        UpdateFlags(0, flag);
     } else {
-        flags &= ~flag;
+        UpdateFlags(flag, 0);
     }
 }
+
+void Basic_Audio_Controls::UpdateFlags(const uint8_t clear_mask, const uint8_t set_mask) {
+    uint8_t old_flags = m_flags.load(std::memory_order_relaxed);
+    uint8_t new_flags = 0;
+    do {
+        new_flags = uint8_t((old_flags & ~clear_mask) | set_mask);
+        if (new_flags == old_flags) return;
+    } while (!m_flags.compare_exchange_weak(old_flags, new_flags, std::memory_order_release, std::memory_order_relaxed));
+    // NOTE: A reader that sees the new epoch also sees these flags
+    m_epoch.fetch_add(1, std::memory_order_release);
+}
+
+bool Basic_Audio_Controls::GetFlag(const uint8_t flag) const {
+    return (m_flags.load(std::memory_order_acquire) & flag) != 0;
+}
@@ -1,10 +1,15 @@
 #pragma once
 #include <stdint.h>
+#include <atomic>
 
+// Controls can be changed from any thread while the channel is being decoded
+// The channel reads the epoch once per CIF and reacts to any changes before decoding it
 class Basic_Audio_Controls 
 {
 private:
-    uint8_t flags = 0;
+    std::atomic<uint8_t> m_flags{0};
+    // incremented after each change to the flags
+    std::atomic<uint32_t> m_epoch{0};
 public:
     // Is anything enabled?
     bool GetAnyEnabled(void) const;
@@ -20,7 +25,28 @@ public:
     // Play audio data through sound device
     bool GetIsPlayAudio(void) const;
     void SetIsPlayAudio(bool);
+    // Output encoded AAC/MP2 frames without decoding them
+    // This is enough to archive or restream a service without any codec cost
+    bool GetIsEncodedAudio(void) const;
+    void SetIsEncodedAudio(bool);
+    // Only run the audio codec while audio is played or something is attached to OnAudioData() or OnAudioBuffer()
+    // Access units are still framed and CRC checked and PAD is still decoded
+    bool GetIsDecodeOnDemand(void) const;
+    void SetIsDecodeOnDemand(bool);
+    // Keep demodulating the subchannel into the CIF history while nothing is enabled
+    // This costs no viterbi, reed solomon or AAC decoding and enabling it later is instant
+    bool GetIsStandby(void) const;
+    void SetIsStandby(bool);
+    // Decode DAB+ audio with downsampled SBR which outputs half rate audio for less CPU
+    // This is only for monitoring where fidelity doesn't matter and has no effect on DAB (MP2) audio
+    bool GetIsLowComplexity(void) const;
+    void SetIsLowComplexity(bool);
+    // Flags read after this are at least as new as this epoch
+    uint32_t GetEpoch(void) const;
 private:
     void SetFlag(const uint8_t flag, const bool state);
+    // Clears then sets the flags in one step so linked flags never appear half changed
+    void UpdateFlags(const uint8_t clear_mask, const uint8_t set_mask);
+    bool GetFlag(const uint8_t flag) const;
 };
 
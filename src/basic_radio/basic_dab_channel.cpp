@@ -1,8 +1,10 @@
 #include "./basic_dab_channel.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -10,12 +12,20 @@
 #include "dab/audio/mp2_audio_decoder.h"
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
+#include "dab/mot/MOT_processor.h"
+#include "dab/msc/cif_history.h"
 #include "dab/msc/msc_decoder.h"
+#include "dab/pad/pad_dynamic_label.h"
 #include "dab/pad/pad_processor.h"
+#include "utility/cost_account.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_usage.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./basic_audio_channel.h"
 #include "./basic_audio_params.h"
+#include "./basic_pad_queue.h"
 #include "./basic_radio_logging.h"
 #include "./basic_slideshow.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
@@ -23,69 +33,103 @@
 #undef min // NOLINT
 #undef max // NOLINT
 
-Basic_DAB_Channel::Basic_DAB_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type)
-: Basic_Audio_Channel(params, subchannel, audio_service_type) 
+Basic_DAB_Channel::Basic_DAB_Channel(
+    const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+    std::pmr::memory_resource* memory_resource)
+: Basic_Audio_Channel(params, subchannel, audio_service_type, memory_resource)
 {
-    m_plm_buffer = plm_buffer_create_with_capacity(32);
-    m_plm_audio = plm_audio_create_with_buffer(m_plm_buffer);
-    m_pad_processor = std::make_unique<PAD_Processor>();
+    m_thread_name = fmt::format("MSC-dab-subchannel-{}", m_subchannel.id);
+    // NOTE: The MP2 decoder is created with the first frame since most channels are never enabled
+    m_mp2_audio_decoder = nullptr;
+    m_pad_processor = std::make_unique<PAD_Processor>(memory_resource);
     SetupCallbacks();
 }
 
+void Basic_DAB_Channel::SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) {
+    m_pad_processor->Get_MOT_Processor().SetAssemblerBudget(budget);
+}
+
 Basic_DAB_Channel::~Basic_DAB_Channel() {
-    plm_audio_destroy(m_plm_audio);
-    plm_buffer_destroy(m_plm_buffer);
-    m_plm_audio = nullptr;
-    m_plm_buffer = nullptr;
-};
-
-void Basic_DAB_Channel::Process(tcb::span<const viterbi_bit_t> msc_bits_buf) {
-    BASIC_RADIO_SET_THREAD_NAME(fmt::format("MSC-dab-subchannel-{}", m_subchannel.id));
-
-    const int nb_msc_bits = (int)msc_bits_buf.size();
-    if (nb_msc_bits != m_params.nb_msc_bits) {
-        LOG_ERROR("Got incorrect number of MSC bits {}/{}", nb_msc_bits, m_params.nb_msc_bits);
+    // queued PAD refers to our PAD_Processor
+    m_pad_queue = nullptr;
+}
+
+Memory_Usage Basic_DAB_Channel::GetMemoryUsage() {
+    auto usage = Basic_Audio_Channel::GetMemoryUsage();
+    usage.AddChild("mp2_audio", get_memory_bytes(m_audio_data));
+    return usage;
+}
+
+PAD_Processor& Basic_DAB_Channel::GetPADProcessor() {
+    return *m_pad_processor;
+}
+
+void Basic_DAB_Channel::Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) {
+    BASIC_RADIO_SET_THREAD_NAME(m_thread_name.c_str());
+
+    const int nb_cif_bits = cif_history.GetCIFBits();
+    if (nb_cif_bits != m_params.nb_cif_bits) {
+        LOG_ERROR("Got incorrect number of CIF bits {}/{}", nb_cif_bits, m_params.nb_cif_bits);
         return;
     }
 
+    if (IsControlsChanged()) {
+        // The synthesis filterbank overlaps frames so it would mix in audio from before decoding stopped
+        if (!m_controls.GetIsDecodeAudio() && (m_mp2_audio_decoder != nullptr)) {
+            m_mp2_audio_decoder->Reset();
+        }
+    }
+
     if (!m_controls.GetAnyEnabled()) {
         return;
     }
 
-    for (int i = 0; i < m_params.nb_cifs; i++) {
-        const auto cif_buf = msc_bits_buf.subspan(
-            i*m_params.nb_cif_bits, 
-              m_params.nb_cif_bits);
-        const auto decoded_bytes = m_msc_decoder->DecodeCIF(cif_buf);
+    m_msc_decoder->DecodeCIFs(cif_history, cif_index, total_cifs);
+    for (int i = 0; i < total_cifs; i++) {
+        const auto decoded_bytes = m_msc_decoder->DecodeCIF(cif_history, cif_index+uint64_t(i));
         // The MSC decoder can have 0 bytes if the deinterleaver is still collecting frames
         if (decoded_bytes.empty()) {
             continue;
         }
+        // each MP2 frame is self contained so there is no sync to keep when one is skipped
+        if (m_msc_decoder->GetIsLastUnreliable()) {
+            m_error_counts.unreliable_cifs++;
+            continue;
+        }
+        LATENCY_TRACE_RECORD("dab_latency_msc_cif_seconds", "Time from capturing the samples of a frame to a CIF of a subchannel being decoded");
 
-        m_obs_mp2_data.Notify(decoded_bytes);
+        // MP2 frames are self contained so they can be stored without decoding
+        if (m_controls.GetIsEncodedAudio()) {
+            m_obs_mp2_data.Notify(decoded_bytes);
+        }
 
-        if (!m_controls.GetAnyEnabled()) { 
+        // NOTE: PAD starts where the MP2 decoder stops reading so decoding data still runs the decoder
+        const bool is_pcm_audio_needed = GetIsPCMAudioNeeded();
+        if (!is_pcm_audio_needed && !m_controls.GetIsDecodeData()) { 
             continue;
         }
  
-        plm_buffer_rewind(m_plm_buffer); // we can assume full frames are decoded each time
-        plm_buffer_write(m_plm_buffer, decoded_bytes.data(), decoded_bytes.size());
-        const int total_data_bytes = plm_audio_decode_header(m_plm_audio);
-        if (total_data_bytes == 0) {
-            m_is_error = true;
-            continue;
+        m_error_counts.total_frames++;
+        // each MSC output is a full frame so it is decoded in place
+        if (m_mp2_audio_decoder == nullptr) {
+            m_mp2_audio_decoder = std::make_unique<MP2_Audio_Decoder>();
         }
-
-        plm_samples_t* samples = plm_audio_decode(m_plm_audio, total_data_bytes);
-        if (samples == nullptr) {
-            m_is_error = true;
+        MP2_Audio_Decoder::Result res{};
+        {
+            COST_STAGE_SCOPE(Cost_Stage::DECODE);
+            res = m_mp2_audio_decoder->DecodeFrame(decoded_bytes);
+        }
+        if (res.is_error) {
+            m_is_error.store(true, std::memory_order_relaxed);
+            m_error_counts.codec_errors++;
             continue;
         }
-        m_is_error = false;
+        m_is_error.store(false, std::memory_order_relaxed);
+        const plm_samples_t* samples = res.samples;
 
-        const int bitrate_kbps = plm_audio_get_bitrate(m_plm_audio);
-        const int total_channels = plm_audio_get_channels(m_plm_audio);
-        const int sample_rate = plm_audio_get_samplerate(m_plm_audio);
+        const int bitrate_kbps = m_mp2_audio_decoder->GetBitrate();
+        const int total_channels = m_mp2_audio_decoder->GetTotalChannels();
+        const int sample_rate = m_mp2_audio_decoder->GetSampleRate();
         const bool is_stereo = (total_channels == 2);
         m_audio_params = std::optional<AudioParams>({ is_stereo, bitrate_kbps, sample_rate });
  
@@ -98,18 +142,18 @@ void Basic_DAB_Channel::Process(tcb::span<const viterbi_bit_t> msc_bits_buf) {
             const int total_crc_bytes = (bitrate_per_channel >= 56) ? 4 : 2;
             const int total_fpad_bytes = 2;
             // Determine number of xpad bytes
-            const int total_audio_frame_bytes = int(plm_buffer_get_read_head_bytes(m_plm_buffer));
+            const int total_audio_frame_bytes = int(res.total_audio_bytes);
             const int total_pad_bytes = int(decoded_bytes.size()) - total_audio_frame_bytes;
             const int total_xpad_bytes = total_pad_bytes-total_crc_bytes-total_fpad_bytes;
             if (total_xpad_bytes >= 0) {
                 auto pad = decoded_bytes.subspan(size_t(total_audio_frame_bytes));
                 auto fpad = pad.last(size_t(total_fpad_bytes));
                 auto xpad = pad.first(size_t(total_xpad_bytes));
-                m_pad_processor->Process(fpad, xpad);
+                ProcessPAD(fpad, xpad);
             }
         }
 
-        if (m_controls.GetIsPlayAudio()) {
+        if (is_pcm_audio_needed) {
             constexpr float gain = float(std::numeric_limits<int16_t>::max()-1);
             const size_t N = size_t(samples->count*2);
             m_audio_data.resize(N);
@@ -127,19 +171,24 @@ void Basic_DAB_Channel::Process(tcb::span<const viterbi_bit_t> msc_bits_buf) {
             params.frequency = uint32_t(sample_rate);
             params.bytes_per_sample = 2;
             params.is_stereo = true;
-            m_obs_audio_data.Notify(params, data);
+            METRICS_TIME_SCOPE("dab_audio_observer_seconds", "Time spent in observers of decoded audio");
+            NotifyAudioData(params, data);
         }
     }
 }
 
 void Basic_DAB_Channel::SetupCallbacks(void) {
     m_pad_processor->OnLabelUpdate().Attach([this](std::string_view label_str, const uint8_t charset) {
-        m_dynamic_label = std::string(label_str);
+        m_dynamic_label.assign(label_str);
         m_obs_dynamic_label.Notify(m_dynamic_label);
         LOG_MESSAGE("dynamic_label[{}]={} | charset={}", label_str.size(), label_str, charset);
     });
 
-    m_pad_processor->OnMOTUpdate().Attach([this](MOT_Entity entity) {
+    m_pad_processor->OnLabelPlusUpdate().Attach([this](const DL_Plus_Info& info) {
+        m_obs_dynamic_label_plus.Notify(info);
+    });
+
+    m_pad_processor->OnMOTUpdate().Attach([this](MOT_Entity& entity) {
         auto slideshow = m_slideshow_manager->Process_MOT_Entity(entity);
         if (slideshow == nullptr) {
             m_obs_MOT_entity.Notify(entity);
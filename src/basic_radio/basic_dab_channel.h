@@ -1,7 +1,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <vector>
 #include "dab/constants/dab_parameters.h"
@@ -12,8 +14,7 @@
 #include "./basic_audio_channel.h"
 
 class PAD_Processor;
-struct plm_buffer_t;
-struct plm_audio_t;
+class MP2_Audio_Decoder;
 
 // Audio channel player for DAB+
 class Basic_DAB_Channel: public Basic_Audio_Channel
@@ -25,20 +26,26 @@ public:
         int sample_rate = 0;
     };
 private:
-    plm_buffer_t* m_plm_buffer;
-    plm_audio_t* m_plm_audio;
+    std::unique_ptr<MP2_Audio_Decoder> m_mp2_audio_decoder;
     std::vector<int16_t> m_audio_data;
     std::unique_ptr<PAD_Processor> m_pad_processor;
-    bool m_is_error = false;
+    // status that views read from other threads without locking
+    std::atomic<bool> m_is_error{false};
     std::optional<AudioParams> m_audio_params = std::nullopt;
-    Observable<tcb::span<const uint8_t>> m_obs_mp2_data;
+    Ref_Observable<tcb::span<const uint8_t>> m_obs_mp2_data;
 public:
-    explicit Basic_DAB_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type);
+    explicit Basic_DAB_Channel(
+        const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~Basic_DAB_Channel() override;
-    void Process(tcb::span<const viterbi_bit_t> msc_bits_buf) override;
+    void Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) override;
+    void SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) override;
+    Memory_Usage GetMemoryUsage() override;
     auto& OnMP2Data() { return m_obs_mp2_data; }
-    bool GetIsError() const { return m_is_error; }
+    bool GetIsError() const { return m_is_error.load(std::memory_order_relaxed); }
     const auto& GetAudioParams() const { return m_audio_params; }
+protected:
+    PAD_Processor& GetPADProcessor() override;
 private:
     void SetupCallbacks(void);
 };
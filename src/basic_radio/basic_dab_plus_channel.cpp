@@ -1,6 +1,8 @@
 #include "./basic_dab_plus_channel.h"
 #include <stdint.h>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <fmt/format.h>
@@ -10,50 +12,161 @@
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
 #include "dab/mot/MOT_entities.h"
+#include "dab/mot/MOT_processor.h"
+#include "dab/msc/cif_history.h"
 #include "dab/msc/msc_decoder.h"
+#include "dab/pad/pad_dynamic_label.h"
+#include "dab/pad/pad_processor.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_usage.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./basic_audio_channel.h"
 #include "./basic_audio_params.h"
+#include "./basic_pad_queue.h"
 #include "./basic_radio_logging.h"
 #include "./basic_slideshow.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
 
-Basic_DAB_Plus_Channel::Basic_DAB_Plus_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type)
-: Basic_Audio_Channel(params, subchannel, audio_service_type)
+constexpr size_t MAX_CACHED_AUDIO_DECODERS = 4;
+
+static uint32_t get_audio_decoder_key(const AAC_Audio_Decoder::Params& params) {
+    return 
+        (params.sampling_frequency << 4) | 
+        (uint32_t(params.is_low_complexity) << 3) | 
+        (uint32_t(params.is_SBR) << 2) | 
+        (uint32_t(params.is_stereo) << 1) | 
+        (uint32_t(params.is_PS) << 0);
+}
+
+Basic_DAB_Plus_Channel::Basic_DAB_Plus_Channel(
+    const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+    std::pmr::memory_resource* memory_resource)
+: Basic_Audio_Channel(params, subchannel, audio_service_type, memory_resource),
+  m_aac_audio_decoders(MAX_CACHED_AUDIO_DECODERS)
 {
-    m_aac_frame_processor = std::make_unique<AAC_Frame_Processor>();
-    m_aac_audio_decoder = nullptr;
-    m_aac_data_decoder = std::make_unique<AAC_Data_Decoder>();
+    m_thread_name = fmt::format("MSC-dab-plus-subchannel-{}", m_subchannel.id);
+    m_aac_frame_processor = std::make_unique<AAC_Frame_Processor>(memory_resource);
+    m_aac_data_decoder = std::make_unique<AAC_Data_Decoder>(memory_resource);
+    // Reed solomon can correct twice as many bytes if it knows which ones are unreliable
+    m_msc_decoder->SetIsByteSoftErrors(true);
     SetupCallbacks();
 }
 
-Basic_DAB_Plus_Channel::~Basic_DAB_Plus_Channel() = default;
+Basic_DAB_Plus_Channel::~Basic_DAB_Plus_Channel() {
+    // queued PAD refers to our PAD_Processor
+    m_pad_queue = nullptr;
+}
+
+PAD_Processor& Basic_DAB_Plus_Channel::GetPADProcessor() {
+    return m_aac_data_decoder->Get_PAD_Processor();
+}
+
+void Basic_DAB_Plus_Channel::SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) {
+    m_aac_data_decoder->Get_PAD_Processor().Get_MOT_Processor().SetAssemblerBudget(budget);
+}
+
+Memory_Usage Basic_DAB_Plus_Channel::GetMemoryUsage() {
+    auto usage = Basic_Audio_Channel::GetMemoryUsage();
+    usage.AddChild("aac_frame_processor", m_aac_frame_processor->GetMemoryBytes());
+    return usage;
+}
+
+void Basic_DAB_Plus_Channel::Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) {
+    BASIC_RADIO_SET_THREAD_NAME(m_thread_name.c_str());
 
-void Basic_DAB_Plus_Channel::Process(tcb::span<const viterbi_bit_t> msc_bits_buf) {
-    BASIC_RADIO_SET_THREAD_NAME(fmt::format("MSC-dab-plus-subchannel-{}", m_subchannel.id));
+    const int nb_cif_bits = cif_history.GetCIFBits();
+    if (nb_cif_bits != m_params.nb_cif_bits) {
+        LOG_ERROR("Got incorrect number of CIF bits {}/{}", nb_cif_bits, m_params.nb_cif_bits);
+        return;
+    }
+
+    if (IsControlsChanged()) {
+        // Audio decoded after decoding is turned back on doesn't continue from what was decoded before
+        const bool is_decode_audio = m_controls.GetIsDecodeAudio();
+        if (!is_decode_audio && (m_aac_audio_decoder != nullptr)) {
+            m_aac_audio_decoder->Reset();
+        }
+        // switch to or from downsampled SBR without waiting for the next superframe header
+        if (m_aac_audio_decoder != nullptr) {
+            SelectAudioDecoder();
+        }
+    }
 
-    const int nb_msc_bits = (int)msc_bits_buf.size();
-    if (nb_msc_bits != m_params.nb_msc_bits) {
-        LOG_ERROR("Got incorrect number of MSC bits {}/{}", nb_msc_bits, m_params.nb_msc_bits);
+    // NOTE: Disabled channels skip all decoding and only their CIFs are kept in the shared history
+    //       So once enabled they deinterleave straight away if they were on standby
+    const bool is_enabled = m_controls.GetAnyEnabled();
+    const bool is_restart = is_enabled && !m_is_prev_enabled;
+    m_is_prev_enabled = is_enabled;
+    if (!is_enabled) {
         return;
     }
+    if (is_restart) {
+        m_aac_frame_processor->Reset();
+    }
+
+    m_msc_decoder->DecodeCIFs(cif_history, cif_index, total_cifs);
+    for (int i = 0; i < total_cifs; i++) {
+        ProcessCIF(cif_history, cif_index+uint64_t(i));
+    }
+}
+
+// The logical frames of the superframe before the checkpoint are still in the restored history
+// So they are decoded again from the start of the superframe which is found by its firecode as usual
+void Basic_DAB_Plus_Channel::RestoreSuperFrame(
+    const CIF_History& cif_history, const uint64_t cif_index, const int superframe_phase)
+{
+    m_is_prev_enabled = m_controls.GetAnyEnabled();
+    if (!m_is_prev_enabled) return;
+    m_aac_frame_processor->Reset();
+    for (int i = superframe_phase; i > 0; i--) {
+        ProcessCIF(cif_history, cif_index-uint64_t(i));
+    }
+}
 
-    if (!m_controls.GetAnyEnabled()) {
+void Basic_DAB_Plus_Channel::ProcessCIF(const CIF_History& cif_history, const uint64_t cif_index) {
+    const auto decoded_bytes = m_msc_decoder->DecodeCIF(cif_history, cif_index);
+    // The MSC decoder can have 0 bytes if the deinterleaver is still collecting frames
+    if (decoded_bytes.empty()) {
         return;
     }
+    // keep our place in the superframe without spending reed solomon and firecode searches on noise
+    if (m_msc_decoder->GetIsLastUnreliable()) {
+        m_error_counts.unreliable_cifs++;
+        m_aac_frame_processor->Skip();
+        return;
+    }
+    LATENCY_TRACE_RECORD("dab_latency_msc_cif_seconds", "Time from capturing the samples of a frame to a CIF of a subchannel being decoded");
+    m_aac_frame_processor->Process(decoded_bytes, m_msc_decoder->GetByteSoftErrors());
+}
+
+void Basic_DAB_Plus_Channel::SelectAudioDecoder(void) {
+    const auto& header = m_super_frame_header;
+    AAC_Audio_Decoder::Params audio_params;
+    audio_params.sampling_frequency = header.sampling_rate;
+    audio_params.is_PS = header.PS_flag;
+    audio_params.is_SBR = header.SBR_flag;
+    audio_params.is_stereo = header.is_stereo;
+    audio_params.is_low_complexity = m_controls.GetIsLowComplexity();
+
+    const bool replace_decoder = 
+        (m_aac_audio_decoder == nullptr) ||
+        (m_aac_audio_decoder->GetParams() != audio_params);
 
-    for (int i = 0; i < m_params.nb_cifs; i++) {
-        const auto cif_buf = msc_bits_buf.subspan(
-            i*m_params.nb_cif_bits, 
-              m_params.nb_cif_bits);
-        const auto decoded_bytes = m_msc_decoder->DecodeCIF(cif_buf);
-        // The MSC decoder can have 0 bytes if the deinterleaver is still collecting frames
-        if (decoded_bytes.empty()) {
-            continue;
+    if (replace_decoder) {
+        const uint32_t key = get_audio_decoder_key(audio_params);
+        auto* decoder = m_aac_audio_decoders.find(key);
+        if (decoder == nullptr) {
+            decoder = &m_aac_audio_decoders.insert(key, std::make_unique<AAC_Audio_Decoder>(audio_params));
+        } else {
+            // history from when these params were last used doesn't belong to this stream
+            (*decoder)->Reset();
         }
-        m_aac_frame_processor->Process(decoded_bytes);
+        m_aac_audio_decoder = decoder->get();
+        m_adts_header = std::make_unique<AAC_ADTS_Header>(
+            audio_params.sampling_frequency, audio_params.is_SBR, audio_params.is_stereo);
     }
 }
 
@@ -61,55 +174,52 @@ void Basic_DAB_Plus_Channel::SetupCallbacks(void) {
     // Decode audio
     m_aac_frame_processor->OnSuperFrameHeader().Attach([this](SuperFrameHeader header) {
         m_super_frame_header = header;
+        SelectAudioDecoder();
+    });
+
+    // Encoded audio
+    m_aac_frame_processor->OnAccessUnit().Attach([this](const int au_index, const int nb_aus, tcb::span<uint8_t> buf) {
+        if (!m_controls.GetIsEncodedAudio()) {
+            return;
+        }
 
-        AAC_Audio_Decoder::Params audio_params;
-        audio_params.sampling_frequency = header.sampling_rate;
-        audio_params.is_PS = header.PS_flag;
-        audio_params.is_SBR = header.SBR_flag;
-        audio_params.is_stereo = header.is_stereo;
-
-        const bool replace_decoder = 
-            (m_aac_audio_decoder == nullptr) ||
-            (m_aac_audio_decoder->GetParams() != audio_params);
- 
-        if (replace_decoder) {
-            m_aac_audio_decoder = std::make_unique<AAC_Audio_Decoder>(audio_params);
+        if ((m_adts_header == nullptr) || buf.empty()) {
+            return;
         }
+
+        auto header = m_adts_header->Get(uint16_t(buf.size()));
+        m_obs_aac_data.Notify(m_super_frame_header, header, buf);
     });
 
     // Decode audio
     m_aac_frame_processor->OnAccessUnit().Attach([this](const int au_index, const int nb_aus, tcb::span<uint8_t> buf) {
-        if (!m_controls.GetIsDecodeAudio()) {
+        if (!GetIsPCMAudioNeeded()) {
             return;
         }
 
         if (m_aac_audio_decoder == nullptr) {
             return;
         }
- 
-        if (!buf.empty()) {
-            auto header = m_aac_audio_decoder->GetMPEG4Header(uint16_t(buf.size()));
-            m_obs_aac_data.Notify(m_super_frame_header, header, buf);
-        }
 
         const auto res = m_aac_audio_decoder->DecodeFrame(buf);
         // reset error flag on new superframe
         if (au_index == 0) {
-            m_is_codec_error = res.is_error;
+            m_is_codec_error.store(res.is_error, std::memory_order_relaxed);
         }
         if (res.is_error) {
+            m_error_counts.codec_errors++;
             LOG_ERROR("[aac-audio-decoder] error={} au_index={}/{}", 
                 res.error_code, au_index, nb_aus);
-            m_is_codec_error = true;
+            m_is_codec_error.store(true, std::memory_order_relaxed);
             return;
         }
 
-        const auto audio_params = m_aac_audio_decoder->GetParams();
         BasicAudioParams params;
-        params.frequency = audio_params.sampling_frequency;
+        params.frequency = res.sampling_frequency;
         params.is_stereo = true;
         params.bytes_per_sample = 2;
-        m_obs_audio_data.Notify(params, res.audio_buf);
+        METRICS_TIME_SCOPE("dab_audio_observer_seconds", "Time spent in observers of decoded audio");
+        NotifyAudioData(params, res.audio_buf);
     });
 
     // Decode data
@@ -117,17 +227,25 @@ void Basic_DAB_Plus_Channel::SetupCallbacks(void) {
         if (!m_controls.GetIsDecodeData()) {
             return;
         }
-        m_aac_data_decoder->ProcessAccessUnit(buf);
+        // NOTE: Only the data stream element is found here so a queued PAD doesn't hold up the audio
+        tcb::span<const uint8_t> fpad;
+        tcb::span<const uint8_t> xpad;
+        AAC_Data_Decoder::ExtractPAD(buf, fpad, xpad);
+        ProcessPAD(fpad, xpad);
     });
 
     auto& pad_processor = m_aac_data_decoder->Get_PAD_Processor();
     pad_processor.OnLabelUpdate().Attach([this](std::string_view label_str, const uint8_t charset) {
-        m_dynamic_label = std::string(label_str);
+        m_dynamic_label.assign(label_str);
         m_obs_dynamic_label.Notify(m_dynamic_label);
         LOG_MESSAGE("dynamic_label[{}]={} | charset={}", label_str.size(), label_str, charset);
     });
 
-    pad_processor.OnMOTUpdate().Attach([this](MOT_Entity entity) {
+    pad_processor.OnLabelPlusUpdate().Attach([this](const DL_Plus_Info& info) {
+        m_obs_dynamic_label_plus.Notify(info);
+    });
+
+    pad_processor.OnMOTUpdate().Attach([this](MOT_Entity& entity) {
         auto slideshow = m_slideshow_manager->Process_MOT_Entity(entity);
         if (slideshow == nullptr) {
             m_obs_MOT_entity.Notify(entity);
@@ -136,25 +254,30 @@ void Basic_DAB_Plus_Channel::SetupCallbacks(void) {
 
     // Listen for errors
     m_aac_frame_processor->OnFirecodeError().Attach([this](int frame_index, uint16_t crc_got, uint16_t crc_calc) {
-        m_is_firecode_error = true;
+        m_is_firecode_error.store(true, std::memory_order_relaxed);
+        m_error_counts.firecode_errors++;
     });
 
     m_aac_frame_processor->OnRSError().Attach([this](int au_index, int total_aus) {
-        m_is_rs_error = true;
+        m_is_rs_error.store(true, std::memory_order_relaxed);
+        m_error_counts.rs_errors++;
     });
 
     m_aac_frame_processor->OnSuperFrameHeader().Attach([this](SuperFrameHeader header) {
-        m_is_firecode_error = false;
-        m_is_rs_error = false;
+        m_is_firecode_error.store(false, std::memory_order_relaxed);
+        m_is_rs_error.store(false, std::memory_order_relaxed);
+        m_error_counts.total_frames++;
     });
 
     m_aac_frame_processor->OnAccessUnitCRCError().Attach([this](int au_index, int nb_aus, uint16_t crc_got, uint16_t crc_calc) {
-        m_is_au_error = true;
+        m_is_au_error.store(true, std::memory_order_relaxed);
+        m_error_counts.au_crc_errors++;
     });
 
     m_aac_frame_processor->OnAccessUnit().Attach([this](int au_index, int nb_aus, tcb::span<uint8_t> data) {
+        m_error_counts.total_access_units++;
         if (au_index == 0) {
-            m_is_au_error = false;
+            m_is_au_error.store(false, std::memory_order_relaxed);
         }
     });
 }
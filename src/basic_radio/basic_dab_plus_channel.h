@@ -1,15 +1,19 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include "dab/audio/aac_frame_processor.h"
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
+#include "utility/lru_cache.h"
 #include "utility/observable.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./basic_audio_channel.h"
 
+class AAC_ADTS_Header;
 class AAC_Audio_Decoder;
 class AAC_Data_Decoder;
 
@@ -18,25 +22,47 @@ class Basic_DAB_Plus_Channel: public Basic_Audio_Channel
 {
 private:
     std::unique_ptr<AAC_Frame_Processor> m_aac_frame_processor;
-    std::unique_ptr<AAC_Audio_Decoder> m_aac_audio_decoder;
+    // decoders are kept for recently seen params so a flapping header doesn't reopen libfaad
+    LRU_Cache<uint32_t, std::unique_ptr<AAC_Audio_Decoder>> m_aac_audio_decoders;
+    AAC_Audio_Decoder* m_aac_audio_decoder = nullptr;
+    std::unique_ptr<AAC_ADTS_Header> m_adts_header;
     std::unique_ptr<AAC_Data_Decoder> m_aac_data_decoder;
     SuperFrameHeader m_super_frame_header;
-    bool m_is_firecode_error = false;
-    bool m_is_rs_error = false;
-    bool m_is_au_error = false;
-    bool m_is_codec_error = false;
+    // status that views read from other threads without locking
+    std::atomic<bool> m_is_firecode_error{false};
+    std::atomic<bool> m_is_rs_error{false};
+    std::atomic<bool> m_is_au_error{false};
+    std::atomic<bool> m_is_codec_error{false};
+    // superframe collected before the channel was disabled is dropped when it is enabled again
+    bool m_is_prev_enabled = false;
     // superframe, header, audio_frame_data
-    Observable<SuperFrameHeader, tcb::span<const uint8_t>, tcb::span<const uint8_t>> m_obs_aac_data;
+    Ref_Observable<SuperFrameHeader, tcb::span<const uint8_t>, tcb::span<const uint8_t>> m_obs_aac_data;
 public:
-    explicit Basic_DAB_Plus_Channel(const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type);
+    explicit Basic_DAB_Plus_Channel(
+        const DAB_Parameters& params, const Subchannel subchannel, const AudioServiceType audio_service_type,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~Basic_DAB_Plus_Channel() override;
-    void Process(tcb::span<const viterbi_bit_t> msc_bits_buf) override;
+    void Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) override;
+    void SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) override;
+    Memory_Usage GetMemoryUsage() override;
+    int GetSuperFramePhase() override { return m_aac_frame_processor->GetSuperFramePhase(); }
+    void RestoreSuperFrame(const CIF_History& cif_history, const uint64_t cif_index, const int superframe_phase) override;
+    // Access units are decoded as their logical frames arrive instead of after the superframe is reed solomon corrected
+    // See AAC_Frame_Processor::SetIsLowLatency()
+    // NOTE: This can't be changed while Process() is running
+    void SetIsLowLatency(const bool is_low_latency) { m_aac_frame_processor->SetIsLowLatency(is_low_latency); }
+    bool GetIsLowLatency() const { return m_aac_frame_processor->GetIsLowLatency(); }
     const auto& GetSuperFrameHeader() const { return m_super_frame_header; }
-    bool IsFirecodeError() const { return m_is_firecode_error; }
-    bool IsRSError() const { return m_is_rs_error; }
-    bool IsAUError() const { return m_is_au_error; }
-    bool IsCodecError() const { return m_is_codec_error; }
+    bool IsFirecodeError() const { return m_is_firecode_error.load(std::memory_order_relaxed); }
+    bool IsRSError() const { return m_is_rs_error.load(std::memory_order_relaxed); }
+    bool IsAUError() const { return m_is_au_error.load(std::memory_order_relaxed); }
+    bool IsCodecError() const { return m_is_codec_error.load(std::memory_order_relaxed); }
     auto& OnAACData() { return m_obs_aac_data; }
+protected:
+    PAD_Processor& GetPADProcessor() override;
 private:
     void SetupCallbacks(void);
+    void ProcessCIF(const CIF_History& cif_history, const uint64_t cif_index);
+    // Reuses or opens a decoder for the current superframe header and controls
+    void SelectAudioDecoder(void);
 };
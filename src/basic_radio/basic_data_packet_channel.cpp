@@ -3,28 +3,37 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <fmt/format.h>
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
 #include "dab/mot/MOT_processor.h"
+#include "dab/msc/cif_history.h"
 #include "dab/msc/msc_data_packet_processor.h"
 #include "dab/msc/msc_decoder.h"
 #include "dab/msc/msc_reed_solomon_data_packet_processor.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_usage.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
+#include "./basic_packet_queue.h"
 #include "./basic_radio_logging.h"
 #include "./basic_slideshow.h"
+#include "./basic_thread_pool.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
 
-Basic_Data_Packet_Channel::Basic_Data_Packet_Channel(const DAB_Parameters& params, Subchannel subchannel, DataServiceType type)
-: m_params(params), m_subchannel(subchannel), m_type(type)
+Basic_Data_Packet_Channel::Basic_Data_Packet_Channel(
+    const DAB_Parameters& params, Subchannel subchannel, DataServiceType type,
+    std::pmr::memory_resource* memory_resource)
+: m_params(params), m_subchannel(subchannel), m_type(type), m_memory_resource(memory_resource)
 {
     assert(subchannel.is_complete);
     assert(subchannel.fec_scheme != FEC_Scheme::UNDEFINED);
+    m_thread_name = fmt::format("MSC-data-packet-subchannel-{}", m_subchannel.id);
     m_msc_rs_data_packet_processor = nullptr;
-    m_msc_decoder = std::make_unique<MSC_Decoder>(m_subchannel);
-    m_msc_data_packet_processor = std::make_unique<MSC_Data_Packet_Processor>();
+    m_msc_decoder = std::make_unique<MSC_Decoder>(m_subchannel, memory_resource);
     m_slideshow_manager = std::make_unique<Basic_Slideshow_Manager>();
     if (m_subchannel.fec_scheme == FEC_Scheme::REED_SOLOMON) {
         m_msc_rs_data_packet_processor = std::make_unique<MSC_Reed_Solomon_Data_Packet_Processor>();
@@ -32,36 +41,112 @@ Basic_Data_Packet_Channel::Basic_Data_Packet_Channel(const DAB_Parameters& param
             ProcessNonFECPackets(buf);
         });
     }
-    m_msc_data_packet_processor->Get_MOT_Processor().OnEntityComplete().Attach([this](MOT_Entity entity) {
+    // TODO: Right now we just pass everything through the MOT decoder via the data packet processor
+    //       How to handle other object types besides MOT
+    (void)m_type;
+}
+
+Basic_Data_Packet_Channel::~Basic_Data_Packet_Channel() {
+    // queued packets refer to our processors and observers
+    m_address_streams.clear();
+}
+
+void Basic_Data_Packet_Channel::SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) {
+    m_mot_assembler_budget = budget;
+    for (auto& [_, stream]: m_address_streams) {
+        stream.processor->Get_MOT_Processor().SetAssemblerBudget(budget);
+    }
+}
+
+void Basic_Data_Packet_Channel::SetPacketThreadPool(std::shared_ptr<BasicThreadPool> thread_pool) {
+    m_packet_thread_pool = std::move(thread_pool);
+    for (auto& [_, stream]: m_address_streams) {
+        // the old queue finishes its pending packets first so they are still assembled in order
+        stream.queue = nullptr;
+        SetupAddressQueue(stream);
+    }
+}
+
+Basic_Data_Packet_Channel::Address_Stream& Basic_Data_Packet_Channel::GetAddressStream(const uint16_t address) {
+    auto it = m_address_streams.find(address);
+    if (it != m_address_streams.end()) return it->second;
+
+    LOG_MESSAGE("Added packet address {} to data packet subchannel {}", address, m_subchannel.id);
+    Address_Stream stream;
+    stream.processor = std::make_unique<MSC_Data_Packet_Processor>(m_memory_resource);
+    auto& mot_processor = stream.processor->Get_MOT_Processor();
+    if (m_mot_assembler_budget != nullptr) {
+        mot_processor.SetAssemblerBudget(m_mot_assembler_budget);
+    }
+    mot_processor.OnEntityComplete().Attach([this](MOT_Entity& entity) {
+        auto lock = std::scoped_lock(m_mutex_MOT_entity);
         auto slideshow = m_slideshow_manager->Process_MOT_Entity(entity);
         if (slideshow == nullptr) {
             m_obs_MOT_entity.Notify(entity);
         }
     });
- 
-    // TODO: Right now we just pass everything through the MOT decoder via the data packet processor
-    //       How to handle other object types besides MOT
-    (void)m_type;
+    auto& res = m_address_streams.insert({ address, std::move(stream) }).first->second;
+    SetupAddressQueue(res);
+    return res;
 }
 
-Basic_Data_Packet_Channel::~Basic_Data_Packet_Channel() = default;
+void Basic_Data_Packet_Channel::SetupAddressQueue(Address_Stream& stream) {
+    if (m_packet_thread_pool == nullptr) return;
+    stream.queue = std::make_unique<Basic_Packet_Queue>(
+        *stream.processor, m_packet_thread_pool, GetCostAccount(),
+        Basic_Packet_Queue::DEFAULT_CAPACITY, m_memory_resource);
+}
 
-void Basic_Data_Packet_Channel::Process(tcb::span<const viterbi_bit_t> msc_bits_buf) {
-    BASIC_RADIO_SET_THREAD_NAME(fmt::format("MSC-data-packet-subchannel-{}", m_subchannel.id));
+void Basic_Data_Packet_Channel::Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) {
+    m_msc_decoder->Reconfigure(subchannel, cif_index);
+}
+
+void Basic_Data_Packet_Channel::SetMaxErrorPerBit(const float max_error_per_bit) {
+    m_msc_decoder->SetMaxErrorPerBit(max_error_per_bit);
+}
+
+void Basic_Data_Packet_Channel::SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) {
+    m_msc_decoder->SetViterbiBackend(std::move(backend));
+}
+
+BasicTaskPriority Basic_Data_Packet_Channel::GetPriority() {
+    return BasicTaskPriority::LOW;
+}
+
+Memory_Usage Basic_Data_Packet_Channel::GetMemoryUsage() {
+    Memory_Usage usage("channel");
+    usage.AddChild(m_msc_decoder->GetMemoryUsage());
+    auto& addresses = usage.AddChild("addresses");
+    for (const auto& [address, stream]: m_address_streams) {
+        auto mot_usage = stream.processor->Get_MOT_Processor().GetMemoryUsage();
+        mot_usage.name = fmt::format("address_{}", address);
+        addresses.AddChild(std::move(mot_usage));
+    }
+    usage.AddChild("slideshows", m_slideshow_manager->GetTotalBytes());
+    return usage;
+}
+
+void Basic_Data_Packet_Channel::Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) {
+    BASIC_RADIO_SET_THREAD_NAME(m_thread_name.c_str());
 
-    const int nb_msc_bits = (int)msc_bits_buf.size();
-    if (nb_msc_bits != m_params.nb_msc_bits) {
-        LOG_ERROR("Got incorrect number of MSC bits {}/{}", nb_msc_bits, m_params.nb_msc_bits);
+    const int nb_cif_bits = cif_history.GetCIFBits();
+    if (nb_cif_bits != m_params.nb_cif_bits) {
+        LOG_ERROR("Got incorrect number of CIF bits {}/{}", nb_cif_bits, m_params.nb_cif_bits);
         return;
     }
 
-    for (int i = 0; i < m_params.nb_cifs; i++) {
-        const auto cif_buf = msc_bits_buf.subspan(i*m_params.nb_cif_bits, m_params.nb_cif_bits);
-        auto buf = m_msc_decoder->DecodeCIF(cif_buf);
+    m_msc_decoder->DecodeCIFs(cif_history, cif_index, total_cifs);
+    for (int i = 0; i < total_cifs; i++) {
+        auto buf = m_msc_decoder->DecodeCIF(cif_history, cif_index+uint64_t(i));
         // The MSC decoder can have 0 bytes if the deinterleaver is still collecting frames
         if (buf.empty()) {
             continue;
         }
+        if (m_msc_decoder->GetIsLastUnreliable()) {
+            m_total_unreliable_cifs++;
+            continue;
+        }
+        LATENCY_TRACE_RECORD("dab_latency_msc_cif_seconds", "Time from capturing the samples of a frame to a CIF of a subchannel being decoded");
 
         if (m_msc_rs_data_packet_processor) {
             ProcessFECPackets(buf);
@@ -81,8 +166,18 @@ void Basic_Data_Packet_Channel::ProcessFECPackets(tcb::span<const uint8_t> buf)
 
 void Basic_Data_Packet_Channel::ProcessNonFECPackets(tcb::span<const uint8_t> buf) {
     while (!buf.empty()) {
-        const size_t total_read = m_msc_data_packet_processor->ReadPacket(buf);
-        assert(total_read <= buf.size());
-        buf = buf.subspan(total_read);
+        // the crc is checked before routing so corrupt addresses don't create streams
+        const auto res = MSC_Data_Packet_Parse(buf);
+        assert(res.nb_read <= buf.size());
+        buf = buf.subspan(res.nb_read);
+        if (res.status != MSC_Data_Packet_Parse_Result::Status::SUCCESS) {
+            continue;
+        }
+        auto& stream = GetAddressStream(res.address);
+        if (stream.queue == nullptr) {
+            stream.processor->ProcessPacket(res);
+        } else if (!stream.queue->Push(res.packet)) {
+            m_total_dropped_packets++;
+        }
     }
 }
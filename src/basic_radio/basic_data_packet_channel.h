@@ -2,6 +2,10 @@
 
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include "dab/constants/dab_parameters.h"
 #include "dab/database/dab_database_entities.h"
 #include "utility/observable.h"
@@ -13,6 +17,9 @@ class MSC_Decoder;
 class MSC_Data_Packet_Processor;
 class MSC_Reed_Solomon_Data_Packet_Processor;
 class Basic_Slideshow_Manager;
+class MOT_Assembler_Budget;
+class BasicThreadPool;
+class Basic_Packet_Queue;
 struct MOT_Entity;
 
 class Basic_Data_Packet_Channel: public Basic_MSC_Runner
@@ -21,18 +28,63 @@ private:
     const DAB_Parameters m_params;
     const Subchannel m_subchannel;
     const DataServiceType m_type;
+    // formatted once since it is set for every processed CIF
+    std::string m_thread_name;
+    std::pmr::memory_resource* const m_memory_resource;
     std::unique_ptr<MSC_Decoder> m_msc_decoder;
-    std::unique_ptr<MSC_Data_Packet_Processor> m_msc_data_packet_processor;
     std::unique_ptr<MSC_Reed_Solomon_Data_Packet_Processor> m_msc_rs_data_packet_processor;
     std::unique_ptr<Basic_Slideshow_Manager> m_slideshow_manager;
-    Observable<MOT_Entity> m_obs_MOT_entity;
+    std::shared_ptr<MOT_Assembler_Budget> m_mot_assembler_budget;
+    std::shared_ptr<BasicThreadPool> m_packet_thread_pool;
+    // entities of different addresses can complete at the same time if they are assembled on the thread pool
+    std::mutex m_mutex_MOT_entity;
+    Ref_Observable<MOT_Entity> m_obs_MOT_entity;
+    // DOC: ETSI EN 300 401
+    // Clause 5.3.2: Packet mode - services are multiplexed in a subchannel by their packet address
+    // Each address is assembled separately with its own MOT_Processor
+    // NOTE: This is declared last so that queued packets are finished before the rest of the channel is destroyed
+    struct Address_Stream {
+        std::unique_ptr<MSC_Data_Packet_Processor> processor;
+        std::unique_ptr<Basic_Packet_Queue> queue;
+    };
+    std::unordered_map<uint16_t, Address_Stream> m_address_streams;
+    size_t m_total_dropped_packets = 0;
+    size_t m_total_unreliable_cifs = 0;
 public:
-    explicit Basic_Data_Packet_Channel(const DAB_Parameters& params, Subchannel subchannel, DataServiceType type);
+    explicit Basic_Data_Packet_Channel(
+        const DAB_Parameters& params, Subchannel subchannel, DataServiceType type,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~Basic_Data_Packet_Channel() override;
-    void Process(tcb::span<const viterbi_bit_t> msc_bits_buf) override;
+    void Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) override;
+    void SetMOTAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget);
+    // Packets of each address are queued and assembled by low priority tasks on this pool
+    // so addresses are assembled in parallel and a large carousel doesn't delay the other addresses
+    // MOT observers are then notified from the pool's workers one entity at a time
+    // nullptr assembles every address inline, which is the default
+    // NOTE: This can't be changed while Process() is running
+    void SetPacketThreadPool(std::shared_ptr<BasicThreadPool> thread_pool);
+    bool GetIsPacketQueued() const { return m_packet_thread_pool != nullptr; }
+    size_t GetTotalAddresses() const { return m_address_streams.size(); }
+    // Packets that didn't fit in the queue of their address
+    // NOTE: This is written by the thread decoding the channel so read it once the radio has stopped
+    size_t GetTotalDroppedPackets() const { return m_total_dropped_packets; }
+    // CIFs that weren't read for packets since they were mostly noise
+    // NOTE: This is written by the thread decoding the channel so read it once the radio has stopped
+    size_t GetTotalUnreliableCIFs() const { return m_total_unreliable_cifs; }
+    MSC_Decoder* GetActiveMSCDecoder() override { return m_msc_decoder.get(); }
+    const MSC_Decoder* GetHistoryMSCDecoder() override { return m_msc_decoder.get(); }
+    void Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) override;
+    void SetMaxErrorPerBit(const float max_error_per_bit) override;
+    void SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) override;
+    // Packet data has no playback deadline so it is decoded after any audio
+    BasicTaskPriority GetPriority() override;
+    // Each packet address has its own MOT assemblers
+    Memory_Usage GetMemoryUsage() override;
     auto& GetSlideshowManager() { return *m_slideshow_manager; }
     auto& OnMOTEntity() { return m_obs_MOT_entity; }
 private:
     void ProcessNonFECPackets(tcb::span<const uint8_t> buf);
     void ProcessFECPackets(tcb::span<const uint8_t> buf);
+    Address_Stream& GetAddressStream(const uint16_t address);
+    void SetupAddressQueue(Address_Stream& stream);
 };
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_types.h"
+
+// Everything needed to create the runner of a subchannel without waiting for the FIC
+struct Basic_Cached_Channel {
+    Subchannel subchannel;
+    TransportMode transport_mode = TransportMode::UNDEFINED;
+    AudioServiceType audio_service_type = AudioServiceType::UNDEFINED;
+    DataServiceType data_service_type = DataServiceType::UNDEFINED;
+    explicit Basic_Cached_Channel(const subchannel_id_t id): subchannel(id) {}
+};
+
+// Channels of an ensemble that were decoded previously so tuning back to it can start decoding straight away
+// See BasicRadio::LoadEnsembleConfig() and BasicRadio::GetEnsembleConfig()
+struct Basic_Ensemble_Config {
+    ensemble_id_t ensemble_id = 0;
+    std::vector<Basic_Cached_Channel> channels;
+};
@@ -1,5 +1,8 @@
 #include "./basic_fic_runner.h"
+#include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include <memory>
 #include <fmt/format.h>
 #include "dab/constants/dab_parameters.h"
@@ -7,23 +10,35 @@
 #include "dab/fic/fic_decoder.h"
 #include "dab/fic/fig_processor.h"
 #include "dab/radio_fig_handler.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./basic_radio_logging.h"
+#include "./basic_thread_pool.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
 
-BasicFICRunner::BasicFICRunner(const DAB_Parameters& _params) 
-: m_params(_params)
+BasicFICRunner::BasicFICRunner(const DAB_Parameters& _params, std::shared_ptr<BasicThreadPool> thread_pool) 
+: m_params(_params), m_thread_pool(std::move(thread_pool)),
+  m_is_adaptive(false), m_adaptive_stable_frames(100), m_adaptive_decode_interval(8),
+  m_is_database_changed(false), m_total_stable_frames(0), m_total_groups_until_decode(0),
+  m_is_reduced_decoding(false), m_total_decoded_groups(0), m_total_skipped_groups(0)
 {
+    assert(size_t(m_params.nb_cifs) <= MAX_GROUPS);
     m_dab_db_updater = std::make_unique<DAB_Database_Updater>();
-    m_fic_decoder = std::make_unique<FIC_Decoder>(m_params.nb_fib_cif_bits, m_params.nb_fibs_per_cif);
-    m_fig_processor = std::make_unique<FIG_Processor>();
+    // one slot per CIF so every FIB group of a frame can be decoded at once
+    m_fic_decoder = std::make_unique<FIC_Decoder>(m_params.nb_fib_cif_bits, m_params.nb_fibs_per_cif, size_t(m_params.nb_cifs));
+    m_fig_processor = std::make_unique<Basic_FIG_Processor<Radio_FIG_Handler>>();
     m_fig_handler = std::make_unique<Radio_FIG_Handler>();
 
     m_fig_handler->SetUpdater(m_dab_db_updater.get());
     m_fig_handler->SetMiscInfo(&m_misc_info);
     m_fig_processor->SetHandler(m_fig_handler.get());
+    // FIGs that were dropped since they referred to missing entities can apply after the database changes
+    m_dab_db_updater->OnChange().Attach([this](const DatabaseChange&) {
+        m_fig_processor->InvalidateCache();
+        m_is_database_changed = true;
+    });
     m_fic_decoder->OnFIB().Attach([this](tcb::span<const uint8_t> buf) {
         m_fig_processor->ProcessFIB(buf);
     });
@@ -31,8 +46,17 @@ BasicFICRunner::BasicFICRunner(const DAB_Parameters& _params)
 
 BasicFICRunner::~BasicFICRunner() = default;
 
+const FIG_Cache& BasicFICRunner::GetFIGCache(void) const {
+    return m_fig_processor->GetCache();
+}
+
+const Radio_FIG_Update_Stats& BasicFICRunner::GetFIGUpdateStats(void) const {
+    return m_fig_handler->GetUpdateStats();
+}
+
 void BasicFICRunner::Process(tcb::span<const viterbi_bit_t> fic_bits_buf) {
     BASIC_RADIO_SET_THREAD_NAME("FIC");
+    METRICS_TIME_SCOPE("dab_fic_process_seconds", "Time spent decoding and processing the FIC of a frame");
 
     const int nb_fic_bits = (int)fic_bits_buf.size(); 
     if (nb_fic_bits != m_params.nb_fic_bits) {
@@ -41,9 +65,83 @@ void BasicFICRunner::Process(tcb::span<const viterbi_bit_t> fic_bits_buf) {
     }
 
 
+    const bool is_reduced = GetIsDatabaseStable();
+    m_is_reduced_decoding = is_reduced;
+    // The first group after the database becomes stable is decoded
+    if (!is_reduced) m_total_groups_until_decode = 0;
+
+    // The interval is chosen so the decoded group moves through each CIF of the frame
+    // otherwise FIGs that are only sent in some CIFs would never be seen
+    const size_t nb_cifs = size_t(m_params.nb_cifs);
+    size_t decode_interval = std::max(m_adaptive_decode_interval.load(), size_t(1));
+    if ((decode_interval > 1) && (decode_interval % nb_cifs) == 0) decode_interval++;
+
+    size_t total_groups = 0;
+    int group_cifs[MAX_GROUPS];
     for (int i = 0; i < m_params.nb_cifs; i++) {
-        const int N = m_params.nb_fib_cif_bits;
-        const auto fib_cif_buf = fic_bits_buf.subspan(i*N, N);
-        m_fic_decoder->DecodeFIBGroup(fib_cif_buf, i);
+        if (is_reduced) {
+            if (m_total_groups_until_decode > 0) {
+                m_total_groups_until_decode--;
+                m_total_skipped_groups++;
+                continue;
+            }
+            m_total_groups_until_decode = decode_interval-1;
+        }
+        group_cifs[total_groups++] = i;
+    }
+
+    // The Viterbi decoding of each FIB group is independent so they run in parallel
+    // while the FIGs are processed afterwards in CIF order
+    const int N = m_params.nb_fib_cif_bits;
+    auto* fic_decoder = m_fic_decoder.get();
+    if ((m_thread_pool != nullptr) && (total_groups > 1)) {
+        BasicTaskGroup task_group;
+        for (size_t i = 1; i < total_groups; i++) {
+            const auto fib_cif_buf = fic_bits_buf.subspan(size_t(group_cifs[i]*N), size_t(N));
+            m_thread_pool->PushTask(task_group, BasicTaskPriority::HIGH, [fic_decoder, fib_cif_buf, i]() {
+                fic_decoder->DecodeGroup(fib_cif_buf, i);
+            });
+        }
+        fic_decoder->DecodeGroup(fic_bits_buf.subspan(size_t(group_cifs[0]*N), size_t(N)), 0);
+        m_thread_pool->Wait(task_group);
+    } else {
+        for (size_t i = 0; i < total_groups; i++) {
+            fic_decoder->DecodeGroup(fic_bits_buf.subspan(size_t(group_cifs[i]*N), size_t(N)), i);
+        }
+    }
+
+    // The FIGs of each group are applied to the database in one pass
+    bool is_crc_error = false;
+    for (size_t i = 0; i < total_groups; i++) {
+        m_fig_handler->BeginBatch();
+        is_crc_error |= !fic_decoder->NotifyGroup(i);
+        m_fig_handler->EndBatch();
+        m_total_decoded_groups++;
+    }
+
+    // We can't tell if we missed a change so we go back to decoding every group
+    if (is_crc_error || (m_misc_info.change_flags != 0)) {
+        m_total_stable_frames = 0;
+    }
+}
+
+bool BasicFICRunner::GetIsDatabaseStable(void) {
+    const bool is_changed = m_is_database_changed;
+    m_is_database_changed = false;
+    if (!m_is_adaptive) {
+        m_total_stable_frames = 0;
+        return false;
+    }
+
+    const auto& stats = m_dab_db_updater->GetStatistics();
+    const bool is_complete = (stats.nb_total > 0) && (stats.nb_pending == 0);
+    if (is_changed || !is_complete) {
+        m_total_stable_frames = 0;
+        return false;
+    }
+    if (m_total_stable_frames < m_adaptive_stable_frames) {
+        m_total_stable_frames++;
+        return false;
     }
+    return true;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <atomic>
 #include <memory>
 
 #include "dab/constants/dab_parameters.h"
@@ -7,24 +9,59 @@
 #include "utility/span.h"
 #include "viterbi_config.h"
 
+class BasicThreadPool;
 class DAB_Database_Updater;
 class FIC_Decoder;
-class FIG_Processor;
+class FIG_Cache;
+template <typename Handler> class Basic_FIG_Processor;
 class Radio_FIG_Handler;
+struct Radio_FIG_Update_Stats;
 
 class BasicFICRunner
 {
 private:
+    // 4 CIFs per frame in transmission mode I
+    static constexpr size_t MAX_GROUPS = 4;
     const DAB_Parameters m_params;
     DAB_Misc_Info m_misc_info;
     std::unique_ptr<DAB_Database_Updater> m_dab_db_updater;
     std::unique_ptr<FIC_Decoder> m_fic_decoder;
-    std::unique_ptr<FIG_Processor> m_fig_processor;
+    std::unique_ptr<Basic_FIG_Processor<Radio_FIG_Handler>> m_fig_processor;
     std::unique_ptr<Radio_FIG_Handler> m_fig_handler;
+    // FIB groups are decoded in parallel on the pool if one is given
+    std::shared_ptr<BasicThreadPool> m_thread_pool;
+    // adaptive decoding where only some FIB groups are decoded once the database is stable
+    std::atomic<bool> m_is_adaptive;
+    std::atomic<size_t> m_adaptive_stable_frames;
+    std::atomic<size_t> m_adaptive_decode_interval;
+    bool m_is_database_changed;
+    size_t m_total_stable_frames;
+    size_t m_total_groups_until_decode;
+    std::atomic<bool> m_is_reduced_decoding;
+    std::atomic<size_t> m_total_decoded_groups;
+    std::atomic<size_t> m_total_skipped_groups;
 public:
-    explicit BasicFICRunner(const DAB_Parameters& _params);
+    explicit BasicFICRunner(const DAB_Parameters& _params, std::shared_ptr<BasicThreadPool> thread_pool=nullptr);
     ~BasicFICRunner();
     void Process(tcb::span<const viterbi_bit_t> fic_bits_buf);
     auto& GetDatabaseUpdater(void) { return *(m_dab_db_updater.get()); }
     const auto& GetMiscInfo(void) { return m_misc_info; }
+    // Hit rate of the cache that skips repeated FIGs
+    const FIG_Cache& GetFIGCache(void) const;
+    // Database updates from the FIGs that changed something versus those that were repeats
+    const Radio_FIG_Update_Stats& GetFIGUpdateStats(void) const;
+    // Once the database is complete and hasn't changed for stable_frames only 1 in decode_interval FIB groups is decoded
+    // Every FIB group is decoded again when the database changes, a CRC fails or FIG 0/0 announces a reconfiguration
+    // NOTE: FIG 0/7 reconfiguration counts are part of the database so a new count also counts as a change
+    void SetIsAdaptive(const bool is_adaptive) { m_is_adaptive = is_adaptive; }
+    bool GetIsAdaptive(void) const { return m_is_adaptive; }
+    void SetAdaptiveStableFrames(const size_t stable_frames) { m_adaptive_stable_frames = stable_frames; }
+    size_t GetAdaptiveStableFrames(void) const { return m_adaptive_stable_frames; }
+    void SetAdaptiveDecodeInterval(const size_t decode_interval) { m_adaptive_decode_interval = decode_interval; }
+    size_t GetAdaptiveDecodeInterval(void) const { return m_adaptive_decode_interval; }
+    bool GetIsReducedDecoding(void) const { return m_is_reduced_decoding; }
+    size_t GetTotalDecodedGroups(void) const { return m_total_decoded_groups; }
+    size_t GetTotalSkippedGroups(void) const { return m_total_skipped_groups; }
+private:
+    bool GetIsDatabaseStable(void);
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "./basic_image_service.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include "utility/span.h"
+#include "./basic_radio_logging.h"
+#include "./basic_slideshow.h"
+#define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
+#define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
+
+// Box filter so every source pixel contributes and small text stays legible
+static Basic_Decoded_Image Create_Thumbnail(const Basic_Decoded_Image& src, const int max_size) {
+    const int longest = std::max(src.width, src.height);
+    if (longest <= max_size) {
+        Basic_Decoded_Image dest = src;
+        dest.is_thumbnail = true;
+        return dest;
+    }
+
+    Basic_Decoded_Image dest;
+    dest.is_thumbnail = true;
+    dest.width = std::max(1, int(int64_t(src.width)*max_size/longest));
+    dest.height = std::max(1, int(int64_t(src.height)*max_size/longest));
+    dest.rgba.resize(size_t(dest.width)*size_t(dest.height)*4);
+    for (int y = 0; y < dest.height; y++) {
+        const int y0 = int(int64_t(y)*src.height/dest.height);
+        const int y1 = std::max(y0+1, int(int64_t(y+1)*src.height/dest.height));
+        for (int x = 0; x < dest.width; x++) {
+            const int x0 = int(int64_t(x)*src.width/dest.width);
+            const int x1 = std::max(x0+1, int(int64_t(x+1)*src.width/dest.width));
+            uint32_t sum[4] = {0,0,0,0};
+            for (int sy = y0; sy < y1; sy++) {
+                const uint8_t* row = &src.rgba[(size_t(sy)*size_t(src.width) + size_t(x0))*4];
+                for (int sx = x0; sx < x1; sx++) {
+                    for (int c = 0; c < 4; c++) sum[c] += row[c];
+                    row += 4;
+                }
+            }
+            const uint32_t total = uint32_t((y1-y0)*(x1-x0));
+            uint8_t* pixel = &dest.rgba[(size_t(y)*size_t(dest.width) + size_t(x))*4];
+            for (int c = 0; c < 4; c++) pixel[c] = uint8_t((sum[c] + total/2) / total);
+        }
+    }
+    return dest;
+}
+
+Basic_Image_Service::Basic_Image_Service(Decoder decoder, const Basic_Image_Service_Settings& settings)
+: m_settings(settings), m_decoder(std::move(decoder))
+{
+    m_thread = std::thread([this]() { RunWorker(); });
+}
+
+Basic_Image_Service::~Basic_Image_Service() {
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        m_is_stop = true;
+    }
+    m_cv_job.notify_one();
+    m_thread.join();
+}
+
+std::shared_ptr<const Basic_Decoded_Image> Basic_Image_Service::GetImage(
+    const std::shared_ptr<Basic_Slideshow>& slideshow, const bool is_thumbnail)
+{
+    if (slideshow == nullptr) return nullptr;
+    const Key key { slideshow.get(), is_thumbnail };
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            auto& entry = it->second;
+            if (entry.owner.lock() == slideshow) {
+                m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+                return entry.image;
+            }
+            RemoveEntry(key);
+        }
+
+        if (m_pending.find(key) != m_pending.end()) {
+            return nullptr;
+        }
+        while (m_jobs.size() >= m_settings.max_pending_requests) {
+            m_pending.erase(m_jobs.front().key);
+            m_jobs.pop_front();
+        }
+        m_jobs.push_back({ key, slideshow });
+        m_pending.insert(key);
+    }
+    m_cv_job.notify_one();
+    return nullptr;
+}
+
+size_t Basic_Image_Service::GetTotalDecodedBytes() {
+    auto lock = std::scoped_lock(m_mutex);
+    return m_total_decoded_bytes;
+}
+
+void Basic_Image_Service::Clear() {
+    auto lock = std::scoped_lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_total_decoded_bytes = 0;
+}
+
+void Basic_Image_Service::RunWorker() {
+    BASIC_RADIO_SET_THREAD_NAME("basic_image_service");
+    while (true) {
+        Job job;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv_job.wait(lock, [this]() { return m_is_stop || !m_jobs.empty(); });
+            if (m_is_stop) return;
+            // the newest request is most likely to be what is on screen
+            job = std::move(m_jobs.back());
+            m_jobs.pop_back();
+        }
+        Decode(job);
+    }
+}
+
+void Basic_Image_Service::Decode(const Job& job) {
+    auto slideshow = job.slideshow.lock();
+    if (slideshow == nullptr) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_pending.erase(job.key);
+        return;
+    }
+
+    auto image = std::make_shared<Basic_Decoded_Image>();
+    // the image data is never modified after the slideshow is created
+    const auto data = tcb::span<const uint8_t>(slideshow->image_data.data(), slideshow->image_data.size());
+    if (!m_decoder(data, *image) || (image->width <= 0) || (image->height <= 0)) {
+        LOG_ERROR("Failed to decode slideshow image transport_id={} size={}", slideshow->transport_id, data.size());
+        image->width = 0;
+        image->height = 0;
+        image->rgba.clear();
+    } else if (job.key.is_thumbnail) {
+        image = std::make_shared<Basic_Decoded_Image>(Create_Thumbnail(*image, m_settings.thumbnail_max_size));
+    }
+    Insert(job, std::move(image));
+}
+
+void Basic_Image_Service::Insert(const Job& job, std::shared_ptr<const Basic_Decoded_Image> image) {
+    auto lock = std::scoped_lock(m_mutex);
+    m_pending.erase(job.key);
+    if (m_entries.find(job.key) != m_entries.end()) {
+        RemoveEntry(job.key);
+    }
+
+    // failed decodes are kept so they aren't retried every frame
+    const size_t total_bytes = sizeof(Basic_Decoded_Image) + image->rgba.size();
+    m_lru.push_front(job.key);
+    m_entries.insert({ job.key, Entry { job.slideshow, std::move(image), total_bytes, m_lru.begin() } });
+    m_total_decoded_bytes += total_bytes;
+
+    // always keep the newest image even if it is over budget by itself
+    while ((m_total_decoded_bytes > m_settings.max_decoded_bytes) && (m_lru.size() > 1)) {
+        const Key key = m_lru.back();
+        RemoveEntry(key);
+    }
+}
+
+void Basic_Image_Service::RemoveEntry(const Key& key) {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) return;
+    m_total_decoded_bytes -= it->second.total_bytes;
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "utility/span.h"
+
+struct Basic_Slideshow;
+
+struct Basic_Decoded_Image {
+    int width = 0;
+    int height = 0;
+    bool is_thumbnail = false;
+    // width*height*4 bytes of RGBA, empty if the image couldn't be decoded
+    std::vector<uint8_t> rgba;
+    bool GetIsError() const { return rgba.empty(); }
+};
+
+struct Basic_Image_Service_Settings {
+    // total size of decoded images kept in memory
+    size_t max_decoded_bytes = size_t(64) << 20;
+    // thumbnails are downscaled so their longest side is at most this
+    int thumbnail_max_size = 256;
+    // requests past this are dropped oldest first since they are requested again when still in view
+    size_t max_pending_requests = 64;
+};
+
+// Decodes slideshow images on a worker thread the first time they are viewed
+// Decoded images are kept in a least recently used cache bounded by memory
+// so browsing the slideshows of many services keeps a constant memory footprint
+// NOTE: The image codec is provided by the application so the library doesn't depend on one
+class Basic_Image_Service
+{
+public:
+    // Fill in width, height and rgba or return false if the image is invalid
+    using Decoder = std::function<bool(tcb::span<const uint8_t> data, Basic_Decoded_Image& image)>;
+private:
+    struct Key {
+        const Basic_Slideshow* slideshow;
+        bool is_thumbnail;
+        bool operator==(const Key& other) const {
+            return (slideshow == other.slideshow) && (is_thumbnail == other.is_thumbnail);
+        }
+    };
+    struct Key_Hash {
+        size_t operator()(const Key& key) const {
+            return std::hash<const void*>{}(key.slideshow) ^ size_t(key.is_thumbnail);
+        }
+    };
+    struct Entry {
+        // slideshows can be freed and another allocated at the same address
+        std::weak_ptr<Basic_Slideshow> owner;
+        std::shared_ptr<const Basic_Decoded_Image> image;
+        size_t total_bytes;
+        std::list<Key>::iterator lru;
+    };
+    struct Job {
+        Key key;
+        std::weak_ptr<Basic_Slideshow> slideshow;
+    };
+    const Basic_Image_Service_Settings m_settings;
+    const Decoder m_decoder;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_job;
+    std::unordered_map<Key, Entry, Key_Hash> m_entries;
+    // most recently used first
+    std::list<Key> m_lru;
+    size_t m_total_decoded_bytes = 0;
+    std::deque<Job> m_jobs;
+    std::unordered_set<Key, Key_Hash> m_pending;
+    bool m_is_stop = false;
+    std::thread m_thread;
+public:
+    Basic_Image_Service(Decoder decoder, const Basic_Image_Service_Settings& settings={});
+    ~Basic_Image_Service();
+    Basic_Image_Service(Basic_Image_Service&) = delete;
+    Basic_Image_Service(Basic_Image_Service&&) = delete;
+    Basic_Image_Service& operator=(Basic_Image_Service&) = delete;
+    Basic_Image_Service& operator=(Basic_Image_Service&&) = delete;
+    // Returns nullptr and queues a decode if the image isn't ready yet
+    std::shared_ptr<const Basic_Decoded_Image> GetImage(const std::shared_ptr<Basic_Slideshow>& slideshow, const bool is_thumbnail);
+    size_t GetTotalDecodedBytes();
+    void Clear();
+private:
+    void RunWorker();
+    void Decode(const Job& job);
+    void Insert(const Job& job, std::shared_ptr<const Basic_Decoded_Image> image);
+    void RemoveEntry(const Key& key);
+};
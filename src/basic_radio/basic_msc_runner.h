@@ -1,10 +1,50 @@
 #pragma once
 
-#include "utility/span.h"
-#include "viterbi_config.h"
+#include <stdint.h>
+#include <memory>
+#include "utility/cost_account.h"
+#include "utility/memory_usage.h"
+
+class CIF_History;
+class MSC_Decoder;
+class DAB_Viterbi_Backend;
+struct Subchannel;
+enum class BasicTaskPriority: uint8_t;
 
 class Basic_MSC_Runner {
+private:
+    // time spent decoding the subchannel which the radio binds to the thread running Process()
+    Cost_Account m_cost_account;
 public:
     virtual ~Basic_MSC_Runner() {};
-    virtual void Process(tcb::span<const viterbi_bit_t> msc_bits_buf) = 0;
+    // Decodes total_cifs CIFs starting at cif_index from the ensemble wide history
+    // This is usually every CIF of a frame unless the radio decodes each CIF as it is demodulated
+    virtual void Process(const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs) = 0;
+    // Returns the decoder of the subchannel if the next frame will be decoded otherwise nullptr
+    // This lets the radio decode many subchannels together before calling Process()
+    virtual MSC_Decoder* GetActiveMSCDecoder() = 0;
+    // Returns the decoder of the subchannel if its CIFs have to be kept intact in the history otherwise nullptr
+    // This includes subchannels on standby that aren't decoded but can be enabled at any time
+    virtual const MSC_Decoder* GetHistoryMSCDecoder() = 0;
+    // Switch to the layout of a multiplex reconfiguration starting at cif_index
+    // NOTE: This can't be called while Process() is running
+    virtual void Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) = 0;
+    // CIFs with a higher viterbi error skip outer decoding, see MSC_Decoder::SetMaxErrorPerBit()
+    // NOTE: This can't be called while Process() is running
+    virtual void SetMaxErrorPerBit(const float max_error_per_bit) = 0;
+    // The CIFs of each frame are viterbi decoded together with this backend, see MSC_Decoder::DecodeCIFs()
+    // NOTE: This can't be called while Process() is running
+    virtual void SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) = 0;
+    // Priority of the tasks that decode the next frame since busy radios decode background channels last
+    virtual BasicTaskPriority GetPriority() = 0;
+    // Decoder buffers along with the MOT assemblers and slideshows held by the channel
+    // NOTE: This can't be called while Process() is running
+    virtual Memory_Usage GetMemoryUsage() = 0;
+    // Logical frames of the current audio superframe that were already decoded (0 for channels without superframes)
+    // NOTE: This can't be called while Process() is running
+    virtual int GetSuperFramePhase() { return 0; }
+    // Decodes the superframe_phase CIFs before cif_index again so a restored channel continues its superframe
+    // NOTE: This can't be called while Process() is running
+    virtual void RestoreSuperFrame(const CIF_History& /*cif_history*/, const uint64_t /*cif_index*/, const int /*superframe_phase*/) {}
+    Cost_Account& GetCostAccount() { return m_cost_account; }
 };
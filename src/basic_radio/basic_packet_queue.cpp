@@ -0,0 +1,54 @@
+#include "./basic_packet_queue.h"
+#include <assert.h>
+#include <string.h>
+#include <memory>
+#include "dab/msc/msc_data_packet_processor.h"
+#include "utility/cost_account.h"
+#include "utility/span.h"
+#include "./basic_thread_pool.h"
+
+Basic_Packet_Queue::Basic_Packet_Queue(
+    MSC_Data_Packet_Processor& processor, std::shared_ptr<BasicThreadPool> thread_pool, Cost_Account& cost_account,
+    const size_t capacity, std::pmr::memory_resource* memory_resource)
+: m_processor(processor), m_thread_pool(thread_pool), m_cost_account(cost_account),
+  m_entries(capacity, memory_resource), m_write_index(0), m_read_index(0), m_total_pending(0)
+{
+    assert(capacity > 0);
+    m_task_group = std::make_unique<BasicTaskGroup>();
+}
+
+Basic_Packet_Queue::~Basic_Packet_Queue() {
+    m_task_group->WaitDone();
+}
+
+bool Basic_Packet_Queue::Push(tcb::span<const uint8_t> packet) {
+    if (packet.size() > MAX_PACKET_BYTES) return false;
+    // the drain task only frees an entry once it is done with it
+    if (m_total_pending.load(std::memory_order_acquire) >= m_entries.size()) return false;
+
+    auto& entry = m_entries[m_write_index];
+    entry.nb_bytes = uint8_t(packet.size());
+    memcpy(entry.packet, packet.data(), packet.size());
+    m_write_index = (m_write_index+1) % m_entries.size();
+
+    // only one drain task is running at any time so the packets are assembled in order
+    if (m_total_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        m_thread_pool->PushTask(*m_task_group, BasicTaskPriority::LOW, [this]() {
+            Drain();
+        });
+    }
+    return true;
+}
+
+void Basic_Packet_Queue::Drain() {
+    const Cost_Account_Scope cost_scope(m_cost_account);
+    COST_STAGE_SCOPE(Cost_Stage::DECODE);
+    do {
+        const auto& entry = m_entries[m_read_index];
+        const auto res = MSC_Data_Packet_Parse({ entry.packet, size_t(entry.nb_bytes) }, false);
+        if (res.status == MSC_Data_Packet_Parse_Result::Status::SUCCESS) {
+            m_processor.ProcessPacket(res);
+        }
+        m_read_index = (m_read_index+1) % m_entries.size();
+    } while (m_total_pending.fetch_sub(1, std::memory_order_acq_rel) > 1);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "utility/span.h"
+
+class MSC_Data_Packet_Processor;
+class Cost_Account;
+class BasicThreadPool;
+class BasicTaskGroup;
+
+// Bounded queue of packets of one packet mode address that a low priority task on the thread pool assembles
+// Each address of a data packet channel has its own queue so a large carousel on one address
+// doesn't hold up the data groups of another address
+// NOTE: Push() must only be called by one thread at a time (the thread decoding the channel)
+//       The observers of the MSC_Data_Packet_Processor are notified from the pool's workers one packet at a time
+class Basic_Packet_Queue
+{
+public:
+    // DOC: ETSI EN 300 401
+    // Clause 5.3.2: Table 6 - the longest packet is 96 bytes
+    static constexpr size_t MAX_PACKET_BYTES = 96;
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+private:
+    struct Entry {
+        uint8_t nb_bytes;
+        uint8_t packet[MAX_PACKET_BYTES];
+    };
+    MSC_Data_Packet_Processor& m_processor;
+    std::shared_ptr<BasicThreadPool> m_thread_pool;
+    // processing is counted as the decode stage of the channel that queued it
+    Cost_Account& m_cost_account;
+    std::unique_ptr<BasicTaskGroup> m_task_group;
+    std::pmr::vector<Entry> m_entries;
+    size_t m_write_index;
+    size_t m_read_index;
+    std::atomic<size_t> m_total_pending;
+public:
+    Basic_Packet_Queue(
+        MSC_Data_Packet_Processor& processor, std::shared_ptr<BasicThreadPool> thread_pool, Cost_Account& cost_account,
+        const size_t capacity=DEFAULT_CAPACITY,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
+    // waits for the queued entries to be processed
+    ~Basic_Packet_Queue();
+    Basic_Packet_Queue(Basic_Packet_Queue&) = delete;
+    Basic_Packet_Queue(Basic_Packet_Queue&&) = delete;
+    Basic_Packet_Queue& operator=(Basic_Packet_Queue&) = delete;
+    Basic_Packet_Queue& operator=(Basic_Packet_Queue&&) = delete;
+    // Packet must have passed MSC_Data_Packet_Parse() since its crc isn't checked again
+    // Returns false if the packet was dropped because the queue is full or the packet is too long
+    bool Push(tcb::span<const uint8_t> packet);
+private:
+    void Drain();
+};
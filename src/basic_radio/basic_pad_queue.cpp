@@ -0,0 +1,56 @@
+#include "./basic_pad_queue.h"
+#include <assert.h>
+#include <string.h>
+#include <memory>
+#include "dab/pad/pad_processor.h"
+#include "utility/cost_account.h"
+#include "utility/span.h"
+#include "./basic_thread_pool.h"
+
+Basic_PAD_Queue::Basic_PAD_Queue(
+    PAD_Processor& pad_processor, std::shared_ptr<BasicThreadPool> thread_pool, Cost_Account& cost_account,
+    const size_t capacity, std::pmr::memory_resource* memory_resource)
+: m_pad_processor(pad_processor), m_thread_pool(thread_pool), m_cost_account(cost_account),
+  m_entries(capacity, memory_resource), m_write_index(0), m_read_index(0), m_total_pending(0)
+{
+    assert(capacity > 0);
+    m_task_group = std::make_unique<BasicTaskGroup>();
+}
+
+Basic_PAD_Queue::~Basic_PAD_Queue() {
+    m_task_group->WaitDone();
+}
+
+bool Basic_PAD_Queue::Push(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad) {
+    assert(fpad.size() == 2);
+    if (xpad.size() > MAX_XPAD_BYTES) return false;
+    // the drain task only frees an entry once it is done with it
+    if (m_total_pending.load(std::memory_order_acquire) >= m_entries.size()) return false;
+
+    auto& entry = m_entries[m_write_index];
+    entry.fpad[0] = fpad[0];
+    entry.fpad[1] = fpad[1];
+    entry.nb_xpad = uint16_t(xpad.size());
+    if (!xpad.empty()) memcpy(entry.xpad, xpad.data(), xpad.size());
+    m_write_index = (m_write_index+1) % m_entries.size();
+
+    // only one drain task is running at any time so the PAD is processed in order
+    if (m_total_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        m_thread_pool->PushTask(*m_task_group, BasicTaskPriority::LOW, [this]() {
+            Drain();
+        });
+    }
+    return true;
+}
+
+void Basic_PAD_Queue::Drain() {
+    const Cost_Account_Scope cost_scope(m_cost_account);
+    COST_STAGE_SCOPE(Cost_Stage::PAD);
+    do {
+        const auto& entry = m_entries[m_read_index];
+        m_pad_processor.Process(
+            { entry.fpad, sizeof(entry.fpad) },
+            { entry.xpad, size_t(entry.nb_xpad) });
+        m_read_index = (m_read_index+1) % m_entries.size();
+    } while (m_total_pending.fetch_sub(1, std::memory_order_acq_rel) > 1);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "utility/span.h"
+
+class PAD_Processor;
+class Cost_Account;
+class BasicThreadPool;
+class BasicTaskGroup;
+
+// Bounded queue of programme associated data that a low priority task on the thread pool hands to a PAD_Processor
+// This keeps dynamic labels, MOT assembly and slideshow decoding off the task that decodes the audio
+// NOTE: Push() must only be called by one thread at a time (the thread decoding the channel)
+//       The observers of the PAD_Processor are notified from the pool's workers one entry at a time
+class Basic_PAD_Queue
+{
+public:
+    // DOC: ETSI TS 102 563
+    // Clause 5.4.1: PAD insertion - the data stream element is at most 255+255 bytes including the 2 FPAD bytes
+    static constexpr size_t MAX_XPAD_BYTES = 508;
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+private:
+    struct Entry {
+        uint8_t fpad[2];
+        uint16_t nb_xpad;
+        uint8_t xpad[MAX_XPAD_BYTES];
+    };
+    PAD_Processor& m_pad_processor;
+    std::shared_ptr<BasicThreadPool> m_thread_pool;
+    // processing is counted as the PAD stage of the channel that queued it
+    Cost_Account& m_cost_account;
+    std::unique_ptr<BasicTaskGroup> m_task_group;
+    std::pmr::vector<Entry> m_entries;
+    size_t m_write_index;
+    size_t m_read_index;
+    std::atomic<size_t> m_total_pending;
+public:
+    Basic_PAD_Queue(
+        PAD_Processor& pad_processor, std::shared_ptr<BasicThreadPool> thread_pool, Cost_Account& cost_account,
+        const size_t capacity=DEFAULT_CAPACITY,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
+    // waits for the queued entries to be processed
+    ~Basic_PAD_Queue();
+    Basic_PAD_Queue(Basic_PAD_Queue&) = delete;
+    Basic_PAD_Queue(Basic_PAD_Queue&&) = delete;
+    Basic_PAD_Queue& operator=(Basic_PAD_Queue&) = delete;
+    Basic_PAD_Queue& operator=(Basic_PAD_Queue&&) = delete;
+    // Returns false if the PAD was dropped because the queue is full or the xpad is too long
+    bool Push(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad);
+private:
+    void Drain();
+};
@@ -1,14 +1,34 @@
 #include "./basic_radio.h"
+#include <assert.h>
 #include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include <fmt/format.h>
+#include "dab/algorithms/dab_viterbi_backend.h"
+#include "dab/algorithms/dab_viterbi_batch_decoder.h"
+#include "dab/algorithms/dab_viterbi_decoder.h"
 #include "dab/constants/dab_parameters.h"
+#include "dab/constants/subchannel_protection_tables.h"
 #include "dab/dab_misc_info.h"
 #include "dab/database/dab_database.h"
 #include "dab/database/dab_database_entities.h"
 #include "dab/database/dab_database_types.h"
 #include "dab/database/dab_database_updater.h"
+#include "dab/mot/MOT_assembler_budget.h"
+#include "dab/msc/cif_history.h"
+#include "dab/msc/msc_decoder.h"
+#include "utility/cost_account.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_policy.h"
+#include "utility/memory_usage.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./basic_audio_channel.h"
@@ -17,27 +37,237 @@
 #include "./basic_data_packet_channel.h"
 #include "./basic_fic_runner.h"
 #include "./basic_msc_runner.h"
+#include "./basic_radio_events.h"
 #include "./basic_radio_logging.h"
 #include "./basic_thread_pool.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
 
-BasicRadio::BasicRadio(const DAB_Parameters& params, const size_t nb_threads)
-: m_params(params)
+// Number of CIFs the deinterleaver needs in addition to the ones being decoded
+constexpr size_t TOTAL_CIF_DEINTERLEAVE_HISTORY = 16;
+// DOC: ETSI EN 300 401
+// Clause 3.1: Definitions - capacity unit
+constexpr int TOTAL_CAPACITY_UNIT_BITS = 64;
+// FIG 0/1 and 0/2 are repeated every second so cached channels the FIC hasn't described by now are stale
+constexpr uint64_t TOTAL_CACHED_CHANNEL_TIMEOUT_CIFS = 500;
+// DOC: ETSI EN 300 401
+// Clause 5.1: Transmission frame - each common interleaved frame (CIF) lasts 24ms
+constexpr int CIF_DURATION_MS = 24;
+
+// A frame is due to be decoded before the next frame arrives one frame period later
+using Basic_Frame_Clock = std::chrono::steady_clock;
+// Subchannel costs are compared over windows of about a second
+constexpr int COST_WINDOW_MS = 1000;
+// about 3 seconds of transmission mode I which keeps the CIF history of a batch within a few MB
+constexpr size_t MAX_BATCH_FRAMES = 32;
+
+static uint32_t get_subchannel_bitrate(const Subchannel& subchannel) {
+    if (!subchannel.is_complete) return 0;
+    if (subchannel.is_uep) return GetUEPDescriptor(subchannel).bitrate;
+    return CalculateEEPBitrate(subchannel);
+}
+
+static void process_msc_frame(
+    Basic_MSC_Runner& runner, const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs,
+    const BasicTaskPriority priority, const Basic_Frame_Clock::time_point deadline, const uint64_t capture_time,
+    std::atomic<int>& total_deadline_misses)
+{
+    {
+        const Cost_Account_Scope cost_scope(runner.GetCostAccount());
+        const Latency_Trace_Scope latency_scope(capture_time);
+        runner.Process(cif_history, cif_index, total_cifs);
+    }
+    if ((priority == BasicTaskPriority::HIGH) && (Basic_Frame_Clock::now() > deadline)) {
+        total_deadline_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static bool is_supported_channel(const Subchannel& subchannel, const TransportMode mode, const AudioServiceType audio_type) {
+    if (mode == TransportMode::STREAM_MODE_AUDIO) {
+        return (audio_type == AudioServiceType::DAB_PLUS) || (audio_type == AudioServiceType::DAB);
+    }
+    // DOC: EN 300 401
+    // Clause: 5.3.5 FEC for MSC packet mode
+    // Data packet channels require the FEC scheme to be defined for outer encoding
+    return (mode == TransportMode::PACKET_MODE_DATA) && (subchannel.fec_scheme != FEC_Scheme::UNDEFINED);
+}
+
+// Longest processing time first so each shard gets about the same decoding cost
+// Viterbi decoding dominates and its cost is proportional to the capacity units of a subchannel
+// NOTE: Ties are broken by subchannel id so every radio computes the same assignment
+static void assign_shard_subchannels(
+    std::vector<Subchannel>& subchannels, const size_t shard_index, const size_t total_shards,
+    std::unordered_set<subchannel_id_t>& shard_subchannels)
+{
+    std::sort(subchannels.begin(), subchannels.end(), [](const Subchannel& a, const Subchannel& b) {
+        if (a.length != b.length) return a.length > b.length;
+        return a.id < b.id;
+    });
+    std::vector<uint32_t> shard_costs(total_shards, 0);
+    shard_subchannels.clear();
+    for (const auto& subchannel: subchannels) {
+        const auto min_shard = std::min_element(shard_costs.begin(), shard_costs.end());
+        *min_shard += uint32_t(subchannel.length);
+        if (size_t(min_shard - shard_costs.begin()) == shard_index) shard_subchannels.insert(subchannel.id);
+    }
+}
+
+static bool is_same_layout(const Subchannel& a, const Subchannel& b) {
+    return
+        (a.start_address == b.start_address) &&
+        (a.length == b.length) &&
+        (a.is_uep == b.is_uep) &&
+        (a.is_uep ?
+            (a.uep_prot_index == b.uep_prot_index) :
+            ((a.eep_prot_level == b.eep_prot_level) && (a.eep_type == b.eep_type)));
+}
+
+// Tracks when all of the subchannels of an in flight frame are decoded
+struct BasicRadioFrame {
+    BasicTaskGroup task_group;
+};
+
+// Serialises frames for a single msc runner so only one frame is decoded at a time and in order
+// The drain task has the priority of the runner when it was pushed
+// A drain task below BasicTaskPriority::HIGH that falls behind the deadline of its next frame pushes itself again
+// instead of looping so that the newer frames of playing audio are taken first
+class Basic_MSC_Strand
 {
-    m_thread_pool = std::make_unique<BasicThreadPool>(nb_threads);
-    m_fic_runner = std::make_unique<BasicFICRunner>(m_params);
-    m_dab_misc_info = std::make_unique<DAB_Misc_Info>();
-    m_dab_database = std::make_unique<DAB_Database>();
+private:
+    struct Entry {
+        const CIF_History* cif_history = nullptr;
+        uint64_t cif_index = 0;
+        int total_cifs = 0;
+        BasicTaskGroup* group = nullptr;
+        Basic_Frame_Clock::time_point deadline;
+        uint64_t capture_time = 0;
+    };
+    Basic_MSC_Runner& m_runner;
+    BasicThreadPool& m_pool;
+    BasicTaskGroup& m_strand_group;
+    std::atomic<int>& m_total_deadline_misses;
+    std::vector<Entry> m_entries;
+    size_t m_write_index;
+    size_t m_read_index;
+    std::atomic<size_t> m_total_pending;
+    // only written by the thread that pushes the drain task
+    BasicTaskPriority m_priority;
+public:
+    // total_entries must be at least the pipeline depth
+    Basic_MSC_Strand(
+        Basic_MSC_Runner& runner, const size_t total_entries,
+        BasicThreadPool& pool, BasicTaskGroup& strand_group, std::atomic<int>& total_deadline_misses)
+    : m_runner(runner), m_pool(pool), m_strand_group(strand_group), m_total_deadline_misses(total_deadline_misses),
+      m_entries(total_entries), m_write_index(0), m_read_index(0), m_total_pending(0),
+      m_priority(BasicTaskPriority::NORMAL) {}
+    void Push(
+        BasicTaskGroup& frame_group, const CIF_History& cif_history, const uint64_t cif_index, const int total_cifs,
+        const Basic_Frame_Clock::time_point deadline, const uint64_t capture_time) 
+    {
+        frame_group.Add();
+        m_entries[m_write_index] = { &cif_history, cif_index, total_cifs, &frame_group, deadline, capture_time };
+        m_write_index = (m_write_index+1) % m_entries.size();
+        // only one drain task per strand is running at any time
+        if (m_total_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            PushDrain();
+        }
+    }
+private:
+    void PushDrain() {
+        m_priority = m_runner.GetPriority();
+        m_pool.PushTask(m_strand_group, m_priority, [this]() {
+            Drain();
+        });
+    }
+    void Drain() {
+        while (true) {
+            const auto entry = m_entries[m_read_index];
+            m_read_index = (m_read_index+1) % m_entries.size();
+            process_msc_frame(
+                m_runner, *entry.cif_history, entry.cif_index, entry.total_cifs,
+                m_priority, entry.deadline, entry.capture_time, m_total_deadline_misses);
+            entry.group->Done();
+            if (m_total_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) return;
+            // NOTE: The next entry was written before the pending count we just read was incremented
+            const bool is_late = Basic_Frame_Clock::now() > m_entries[m_read_index].deadline;
+            if (is_late && (m_priority != BasicTaskPriority::HIGH)) {
+                PushDrain();
+                return;
+            }
+        }
+    }
+};
+
+BasicRadio::BasicRadio(
+    const DAB_Parameters& params, const size_t nb_threads, const Thread_Affinity& thread_affinity,
+    std::pmr::memory_resource* memory_resource)
+: BasicRadio(params, std::make_shared<BasicThreadPool>(nb_threads, thread_affinity), 0, memory_resource)
+{}
+
+BasicRadio::BasicRadio(
+    const DAB_Parameters& params, std::shared_ptr<BasicThreadPool> thread_pool, const size_t thread_pool_client,
+    std::pmr::memory_resource* memory_resource)
+: m_params(params), m_thread_pool(thread_pool), m_thread_pool_client(thread_pool_client),
+  m_memory_resource(memory_resource)
+{
+    m_fic_runner = std::make_unique<BasicFICRunner>(m_params, m_thread_pool);
+    m_dab_database = std::make_shared<const DAB_Database>();
+    m_dab_database_version = 0;
     m_dab_database_stats = std::make_unique<DatabaseUpdaterGlobalStatistics>();
+    m_fic_runner->GetDatabaseUpdater().OnChange().Attach([this](const DatabaseChange& change) {
+        m_pending_database_changes.push_back(change);
+    });
+    m_pipeline_index = 0;
+    m_strand_task_group = std::make_unique<BasicTaskGroup>();
+    m_next_segment_index = 0;
+    m_segment_fic_task_group = std::make_unique<BasicTaskGroup>();
+    m_segment_cif_task_group = std::make_unique<BasicTaskGroup>();
+    Memory_Policy cif_memory_policy;
+    cif_memory_policy.numa_node = m_thread_pool->GetThreadAffinity().numa_node;
+    m_cif_history = std::make_unique<CIF_History>(
+        m_params.nb_cif_bits, TOTAL_CIF_DEINTERLEAVE_HISTORY+size_t(m_params.nb_cifs), 0, false, cif_memory_policy);
+    m_is_batch_viterbi = false;
+    m_is_multi_cif_viterbi = false;
+    m_is_queued_pad = false;
+    m_is_low_latency_aac = false;
+    m_is_queued_packet_data = false;
+    m_max_error_per_bit = 0.0f;
+    m_shard_index = 0;
+    m_total_shards = 1;
+    m_viterbi_backend = std::make_shared<DAB_Viterbi_CPU_Backend>();
+    m_fic_cif_index = 0;
+    m_reconfig_cif_index = 0;
+    m_total_reconfig_subchannels = 0;
+    m_mot_assembler_budget = std::make_shared<MOT_Assembler_Budget>();
+    m_cached_cif_index = 0;
+    m_is_unconfirmed_channels = false;
+    m_total_deadline_misses = 0;
+    m_frame_capture_time = 0;
+    m_cost_window_frames = std::max(1, COST_WINDOW_MS/(CIF_DURATION_MS*m_params.nb_cifs));
+    m_cost_window_counter = 0;
+    m_cost_window_start = std::chrono::steady_clock::now();
+    m_cost_window_seconds = 0.0f;
+    m_symbol_mask.resize(size_t(m_params.nb_symbols), 1);
+    m_new_symbol_mask.resize(size_t(m_params.nb_symbols), 1);
 }
 
-BasicRadio::~BasicRadio() = default;
+BasicRadio::~BasicRadio() {
+    // runners can't be destroyed while they are still decoding in flight frames
+    Flush();
+}
 
 size_t BasicRadio::GetTotalThreads() const {
     return m_thread_pool->GetTotalThreads();
 }
 
+int BasicRadio::GetTotalThreadAffinityErrors() const {
+    return m_thread_pool->GetTotalAffinityErrors();
+}
+
+const BasicTaskAccount& BasicRadio::GetTaskAccount() const {
+    return m_thread_pool->GetClientAccount(m_thread_pool_client);
+}
+
 void BasicRadio::Process(tcb::span<const viterbi_bit_t> buf) {
     const int N = (int)buf.size();
     if (N != m_params.nb_frame_bits) {
@@ -45,23 +275,428 @@ void BasicRadio::Process(tcb::span<const viterbi_bit_t> buf) {
         return;
     }
 
+    METRICS_TIME_SCOPE("dab_radio_frame_seconds", "Time spent decoding a frame including any frames it waits on in the pipeline");
+    auto pool_scope = BasicThreadPool::ClientScope(*m_thread_pool, m_thread_pool_client);
+    m_frame_capture_time = get_latency_trace_block_time();
+    const Latency_Trace_Scope latency_scope(m_frame_capture_time);
+    LATENCY_TRACE_RECORD("dab_latency_radio_frame_seconds", "Time from capturing the samples of a frame to the radio starting to decode it");
+
+    if (!m_pipeline_frames.empty()) {
+        ProcessPipelined(buf);
+        return;
+    }
+
     auto fic_buf = buf.subspan(0, m_params.nb_fic_bits);
     auto msc_buf = buf.subspan(m_params.nb_fic_bits, m_params.nb_msc_bits);
+    const uint64_t cif_index = PushCIFs(msc_buf);
+    const auto* cif_history = m_cif_history.get();
+    m_fic_cif_index = cif_index;
 
-    m_thread_pool->PushTask([this, fic_buf] {
+    const auto deadline = Basic_Frame_Clock::now() + std::chrono::milliseconds(CIF_DURATION_MS*m_params.nb_cifs);
+    // FIC is small and any runner created from it starts on the next frame so it is never held up
+    BasicTaskGroup task_group;
+    m_thread_pool->PushTask(task_group, BasicTaskPriority::HIGH, [this, fic_buf] {
         m_fic_runner->Process(fic_buf);
     });
 
+    // Runners use the bytes that were decoded ahead of time
+    if (m_is_batch_viterbi) {
+        BasicTaskGroup batch_task_group;
+        PushBatchViterbi(batch_task_group, cif_index, m_params.nb_cifs);
+        m_thread_pool->Wait(batch_task_group);
+    }
+
+    // NOTE: Tasks are stored inline without reference counting
+    //       The runners outlive the task group since they are only added after all tasks are done
+    // NOTE: Workers take the runners of playing audio first regardless of their order in the map
+    for (const auto& [_, msc_runner]: m_msc_runners) {
+        auto* runner = msc_runner.get();
+        const auto priority = runner->GetPriority();
+        m_thread_pool->PushTask(task_group, priority, [this, runner, cif_history, cif_index, priority, deadline]() {
+            process_msc_frame(
+                *runner, *cif_history, cif_index, m_params.nb_cifs, priority, deadline,
+                m_frame_capture_time, m_total_deadline_misses);
+        });
+    }
+
+    m_thread_pool->Wait(task_group);
+
+    UpdateReconfiguration();
+    UpdateAfterProcessing();
+    UpdateCostWindow();
+    UpdateSymbolMask();
+}
+
+void BasicRadio::ProcessSegment(const size_t segment_index, tcb::span<const viterbi_bit_t> buf) {
+    const size_t total_segments = size_t(m_params.nb_cifs)+1;
+    const int nb_segment_bits = (segment_index == 0) ? m_params.nb_fic_bits : m_params.nb_cif_bits;
+    if ((segment_index >= total_segments) || (int(buf.size()) != nb_segment_bits)) {
+        LOG_ERROR("Got incorrect segment {}/{} with {}/{} bits", segment_index, total_segments, buf.size(), nb_segment_bits);
+        return;
+    }
+    if (segment_index != m_next_segment_index) {
+        LOG_ERROR("Got segment {} when expecting segment {}", segment_index, m_next_segment_index);
+        m_next_segment_index = 0;
+        if (segment_index != 0) return;
+    }
+    m_next_segment_index = (segment_index+1) % total_segments;
+    const bool is_frame_end = (m_next_segment_index == 0);
+
+    // Pipelined frames already overlap the decoding of a frame with the next one
+    if (!m_pipeline_frames.empty()) {
+        const size_t offset = (segment_index == 0) ? 0 : size_t(m_params.nb_fic_bits + int(segment_index-1)*m_params.nb_cif_bits);
+        m_segment_bits.resize(size_t(m_params.nb_frame_bits));
+        std::copy(buf.begin(), buf.end(), m_segment_bits.begin()+offset);
+        if (is_frame_end) Process(m_segment_bits);
+        return;
+    }
+
+    auto pool_scope = BasicThreadPool::ClientScope(*m_thread_pool, m_thread_pool_client);
+    if (segment_index == 0) {
+        // the FIC runner is still busy if the last frame was dropped part way through
+        m_thread_pool->Wait(*m_segment_fic_task_group);
+        m_thread_pool->Wait(*m_segment_cif_task_group);
+        m_frame_capture_time = get_latency_trace_block_time();
+        const Latency_Trace_Scope latency_scope(m_frame_capture_time);
+        LATENCY_TRACE_RECORD("dab_latency_radio_frame_seconds", "Time from capturing the samples of a frame to the radio starting to decode it");
+        // the caller's buffer is only valid during the call
+        m_segment_bits.assign(buf.begin(), buf.end());
+        m_fic_cif_index = m_cif_history->GetTotalPushed();
+        m_segment_deadline = Basic_Frame_Clock::now() + std::chrono::milliseconds(CIF_DURATION_MS*m_params.nb_cifs);
+        const auto fic_buf = tcb::span<const viterbi_bit_t>(m_segment_bits);
+        m_thread_pool->PushTask(*m_segment_fic_task_group, BasicTaskPriority::HIGH, [this, fic_buf] {
+            m_fic_runner->Process(fic_buf);
+        });
+        return;
+    }
+
+    const Latency_Trace_Scope latency_scope(m_frame_capture_time);
+    // Each runner decodes its CIFs in order with a stateful deinterleaver
+    m_thread_pool->Wait(*m_segment_cif_task_group);
+    const uint64_t cif_index = m_cif_history->GetTotalPushed();
+    m_cif_history->Push(buf);
+    const auto* cif_history = m_cif_history.get();
+    const auto deadline = m_segment_deadline;
+
+    if (m_is_batch_viterbi) {
+        BasicTaskGroup batch_task_group;
+        PushBatchViterbi(batch_task_group, cif_index, 1);
+        m_thread_pool->Wait(batch_task_group);
+    }
+
+    for (const auto& [_, msc_runner]: m_msc_runners) {
+        auto* runner = msc_runner.get();
+        const auto priority = runner->GetPriority();
+        m_thread_pool->PushTask(*m_segment_cif_task_group, priority, [this, runner, cif_history, cif_index, priority, deadline]() {
+            process_msc_frame(
+                *runner, *cif_history, cif_index, 1, priority, deadline,
+                m_frame_capture_time, m_total_deadline_misses);
+        });
+    }
+    if (!is_frame_end) return;
+
+    m_thread_pool->Wait(*m_segment_cif_task_group);
+    m_thread_pool->Wait(*m_segment_fic_task_group);
+    UpdateReconfiguration();
+    UpdateAfterProcessing();
+    UpdateCostWindow();
+    UpdateSymbolMask();
+}
+
+void BasicRadio::ProcessBatch(tcb::span<const viterbi_bit_t> frames) {
+    const size_t nb_frame_bits = size_t(m_params.nb_frame_bits);
+    if ((frames.size() % nb_frame_bits) != 0) {
+        LOG_ERROR("Got incorrect number of batch bits {} which isn't a multiple of {}", frames.size(), nb_frame_bits);
+        return;
+    }
+    const size_t total_frames = frames.size() / nb_frame_bits;
+    if (total_frames == 0) return;
+
+    METRICS_TIME_SCOPE("dab_radio_batch_seconds", "Time spent decoding a batch of frames");
+    // frames in the pipeline are decoded before the batch
+    Flush();
+    auto pool_scope = BasicThreadPool::ClientScope(*m_thread_pool, m_thread_pool_client);
+    m_frame_capture_time = get_latency_trace_block_time();
+    const Latency_Trace_Scope latency_scope(m_frame_capture_time);
+
+    // Every frame of a batch is decoded from the history along with the deinterleaving history before it
+    const size_t max_batch_frames = std::min(total_frames, MAX_BATCH_FRAMES);
+    ReserveCIFHistory(TOTAL_CIF_DEINTERLEAVE_HISTORY + max_batch_frames*size_t(m_params.nb_cifs));
+
+    size_t batch_start = 0;
+    uint64_t batch_cif_index = m_cif_history->GetTotalPushed();
+    for (size_t i = 0; i < total_frames; i++) {
+        const auto frame = frames.subspan(i*nb_frame_bits, nb_frame_bits);
+        m_fic_cif_index = PushCIFs(frame.subspan(size_t(m_params.nb_fic_bits), size_t(m_params.nb_msc_bits)));
+        m_fic_runner->Process(frame.first(size_t(m_params.nb_fic_bits)));
+        // Channels change after the frame whose FIC changed them like they do with Process()
+        const size_t total_batch_frames = i+1-batch_start;
+        const bool is_end = (i+1 == total_frames) || (total_batch_frames == max_batch_frames) || IsUpdatePending();
+        if (!is_end) continue;
+
+        DecodeBatch(batch_cif_index, int(total_batch_frames)*m_params.nb_cifs);
+        UpdateReconfiguration();
+        UpdateAfterProcessing();
+        UpdateCostWindow(int(total_batch_frames));
+        UpdateSymbolMask();
+        batch_start = i+1;
+        batch_cif_index = m_cif_history->GetTotalPushed();
+    }
+}
+
+bool BasicRadio::IsUpdatePending() {
+    if (!m_pending_database_changes.empty()) return true;
+    if (m_is_unconfirmed_channels.load(std::memory_order_relaxed)) return true;
+    const auto& misc_info = m_fic_runner->GetMiscInfo();
+    const auto& next_subchannels = m_fic_runner->GetDatabaseUpdater().GetNextSubchannels();
+    return (misc_info.change_flags != 0) && !next_subchannels.empty();
+}
+
+void BasicRadio::DecodeBatch(const uint64_t cif_index, const int total_cifs) {
+    const auto* cif_history = m_cif_history.get();
+    BasicTaskGroup task_group;
+    // NOTE: Offline frames have no deadline since they aren't played as they are decoded
+    for (const auto& [_, msc_runner]: m_msc_runners) {
+        auto* runner = msc_runner.get();
+        const auto priority = runner->GetPriority();
+        m_thread_pool->PushTask(task_group, priority, [this, runner, cif_history, cif_index, total_cifs, priority]() {
+            process_msc_frame(
+                *runner, *cif_history, cif_index, total_cifs, priority, Basic_Frame_Clock::time_point::max(),
+                m_frame_capture_time, m_total_deadline_misses);
+        });
+    }
+    m_thread_pool->Wait(task_group);
+}
+
+// The CIFs that are kept are copied so subchannels don't lose their place in the history
+void BasicRadio::ReserveCIFHistory(const size_t total_cifs) {
+    if (total_cifs <= m_cif_history->GetTotalCIFs()) return;
+    Flush();
+    const uint64_t total_pushed = m_cif_history->GetTotalPushed();
+    const uint64_t total_kept = std::min(
+        total_pushed - m_cif_history->GetFirstIndex(), uint64_t(m_cif_history->GetTotalCIFs()));
+    auto cif_history = std::make_unique<CIF_History>(
+        m_params.nb_cif_bits, total_cifs, total_pushed-total_kept, m_cif_history->GetIsPacked(),
+        m_cif_history->GetMemoryPolicy());
+    std::vector<viterbi_bit_t> cif_bits(size_t(m_params.nb_cif_bits));
+    for (uint64_t index = total_pushed-total_kept; index < total_pushed; index++) {
+        m_cif_history->ReadCIF(index, 0, cif_bits);
+        cif_history->Push(cif_bits);
+    }
+    m_cif_history = std::move(cif_history);
+}
+
+std::vector<size_t> BasicRadio::GetSegmentSymbols() const {
+    std::vector<size_t> segment_symbols;
+    segment_symbols.push_back(size_t(m_params.nb_fic_symbols));
+    for (int i = 0; i < m_params.nb_cifs; i++) {
+        segment_symbols.push_back(size_t(m_params.nb_msc_symbols/m_params.nb_cifs));
+    }
+    return segment_symbols;
+}
+
+void BasicRadio::PushBatchViterbi(BasicTaskGroup& task_group, const uint64_t cif_index, const int total_cifs) {
+    m_batch_msc_decoders.clear();
     for (const auto& [_, msc_runner]: m_msc_runners) {
-        const auto runner = msc_runner;
-        m_thread_pool->PushTask([runner, msc_buf]() {
-            runner->Process(msc_buf);
+        auto* decoder = msc_runner->GetActiveMSCDecoder();
+        if (decoder == nullptr) continue;
+        if (decoder->GetSubchannel().is_uep) continue;
+        m_batch_msc_decoders.push_back(decoder);
+    }
+
+    // Subchannels with the same protection and length have the same trellis length
+    // Grouping them together means fewer lanes are left idle
+    std::sort(m_batch_msc_decoders.begin(), m_batch_msc_decoders.end(), 
+        [](const MSC_Decoder* a, const MSC_Decoder* b) {
+            const auto& x = a->GetSubchannel();
+            const auto& y = b->GetSubchannel();
+            return std::tie(x.eep_type, x.eep_prot_level, x.length) < std::tie(y.eep_type, y.eep_prot_level, y.length);
+        }
+    );
+
+    // Each task fills the lanes of one CPU batch decoder
+    constexpr size_t TOTAL_LANES = DAB_Viterbi_Batch_Decoder::TOTAL_LANES;
+    const size_t total_decoders = m_batch_msc_decoders.size();
+    const size_t total_batches = (total_decoders + TOTAL_LANES-1) / TOTAL_LANES;
+    for (size_t i = 0; i < total_batches; i++) {
+        auto* const* decoders = &m_batch_msc_decoders[i*TOTAL_LANES];
+        const size_t total_lanes = std::min(TOTAL_LANES, total_decoders - i*TOTAL_LANES);
+        m_thread_pool->PushTask(task_group, [this, decoders, total_lanes, cif_index, total_cifs]() {
+            MSC_Decoder::DecodeCIFBatch(
+                *m_viterbi_backend, { decoders, total_lanes }, 
+                *m_cif_history, cif_index, total_cifs);
         });
     }
+}
 
-    m_thread_pool->WaitAll();
+void BasicRadio::SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) {
+    if (backend == nullptr) {
+        backend = std::make_shared<DAB_Viterbi_CPU_Backend>();
+    }
+    m_viterbi_backend = std::move(backend);
+    if (!m_is_multi_cif_viterbi) return;
+    for (auto& [_, runner]: m_msc_runners) {
+        runner->SetViterbiBackend(m_viterbi_backend);
+    }
+}
 
+void BasicRadio::SetIsMultiCIFViterbi(const bool is_multi_cif_viterbi) {
+    if (m_is_multi_cif_viterbi == is_multi_cif_viterbi) return;
+    // channels can't change how they decode while they are decoding in flight frames
+    Flush();
+    m_is_multi_cif_viterbi = is_multi_cif_viterbi;
+    for (auto& [_, runner]: m_msc_runners) {
+        runner->SetViterbiBackend(m_is_multi_cif_viterbi ? m_viterbi_backend : nullptr);
+    }
+}
+
+void BasicRadio::SetIsQueuedPAD(const bool is_queued_pad) {
+    if (m_is_queued_pad == is_queued_pad) return;
+    // channels can't swap their PAD queue while they are decoding in flight frames
+    Flush();
+    m_is_queued_pad = is_queued_pad;
+    for (auto& [_, channel]: m_audio_channels) {
+        channel->SetPADThreadPool(m_is_queued_pad ? m_thread_pool : nullptr);
+    }
+}
+
+void BasicRadio::SetIsLowLatencyAAC(const bool is_low_latency_aac) {
+    if (m_is_low_latency_aac == is_low_latency_aac) return;
+    // channels can't change how superframes are collected while they are decoding in flight frames
+    Flush();
+    m_is_low_latency_aac = is_low_latency_aac;
+    for (auto& [_, channel]: m_audio_channels) {
+        if (channel->GetType() != AudioServiceType::DAB_PLUS) continue;
+        static_cast<Basic_DAB_Plus_Channel&>(*channel).SetIsLowLatency(m_is_low_latency_aac);
+    }
+}
+
+void BasicRadio::SetIsQueuedPacketData(const bool is_queued_packet_data) {
+    if (m_is_queued_packet_data == is_queued_packet_data) return;
+    // channels can't swap their packet queues while they are decoding in flight frames
+    Flush();
+    m_is_queued_packet_data = is_queued_packet_data;
+    for (auto& [_, channel]: m_data_packet_channels) {
+        channel->SetPacketThreadPool(m_is_queued_packet_data ? m_thread_pool : nullptr);
+    }
+}
+
+void BasicRadio::SetMaxErrorPerBit(const float max_error_per_bit) {
+    if (m_max_error_per_bit == max_error_per_bit) return;
+    // channels can't change their threshold while they are decoding in flight frames
+    Flush();
+    m_max_error_per_bit = max_error_per_bit;
+    for (auto& [_, runner]: m_msc_runners) {
+        runner->SetMaxErrorPerBit(m_max_error_per_bit);
+    }
+}
+
+void BasicRadio::SetShard(const size_t shard_index, const size_t total_shards) {
+    assert(total_shards > 0);
+    assert(shard_index < total_shards);
+    auto lock = std::scoped_lock(m_mutex_data);
+    m_shard_index = shard_index;
+    m_total_shards = total_shards;
+    UpdateShard();
+}
+
+void BasicRadio::ProcessPipelined(tcb::span<const viterbi_bit_t> buf) {
+    // reuse the oldest frame once all of its subchannels have finished decoding
+    auto& frame = *m_pipeline_frames[m_pipeline_index];
+    m_pipeline_index = (m_pipeline_index+1) % m_pipeline_frames.size();
+    m_thread_pool->Wait(frame.task_group);
+
+    // NOTE: The history is large enough that CIFs used by in flight frames aren't overwritten
+    auto fic_buf = buf.subspan(0, m_params.nb_fic_bits);
+    auto msc_buf = buf.subspan(m_params.nb_fic_bits, m_params.nb_msc_bits);
+    const uint64_t cif_index = PushCIFs(msc_buf);
+    m_fic_cif_index = cif_index;
+
+    const auto deadline = Basic_Frame_Clock::now() + std::chrono::milliseconds(CIF_DURATION_MS*m_params.nb_cifs);
+    for (const auto& [id, msc_runner]: m_msc_runners) {
+        auto res = m_msc_strands.find(id);
+        if (res == m_msc_strands.end()) {
+            auto strand = std::make_unique<Basic_MSC_Strand>(
+                *msc_runner, m_pipeline_frames.size(), *m_thread_pool, *m_strand_task_group, m_total_deadline_misses);
+            res = m_msc_strands.insert({ id, std::move(strand) }).first;
+        }
+        res->second->Push(frame.task_group, *m_cif_history, cif_index, m_params.nb_cifs, deadline, m_frame_capture_time);
+    }
+
+    // FIC updates the database used to create new runners so we decode it before continuing
+    m_fic_runner->Process(fic_buf);
+    UpdateReconfiguration();
     UpdateAfterProcessing();
+    UpdateCostWindow();
+    UpdateSymbolMask();
+}
+
+void BasicRadio::SetPipelineDepth(const size_t depth) {
+    Flush();
+    m_next_segment_index = 0;
+    m_msc_strands.clear();
+    m_pipeline_frames.clear();
+    m_pipeline_index = 0;
+    for (size_t i = 0; (i < depth) && (depth > 1); i++) {
+        m_pipeline_frames.push_back(std::make_unique<BasicRadioFrame>());
+    }
+
+    // Keep the CIFs of every in flight frame along with the deinterleaving history
+    // Numbering is continued so subchannels don't lose their place in the history
+    const size_t total_frames = std::max(depth, size_t(1));
+    const size_t total_cifs = TOTAL_CIF_DEINTERLEAVE_HISTORY + total_frames*size_t(m_params.nb_cifs);
+    if (total_cifs != m_cif_history->GetTotalCIFs()) {
+        m_cif_history = std::make_unique<CIF_History>(
+            m_params.nb_cif_bits, total_cifs, m_cif_history->GetTotalPushed(), m_cif_history->GetIsPacked(),
+            m_cif_history->GetMemoryPolicy());
+    }
+}
+
+void BasicRadio::SetIsPackedCIFHistory(const bool is_packed) {
+    if (is_packed == m_cif_history->GetIsPacked()) return;
+    Flush();
+    m_cif_history = std::make_unique<CIF_History>(
+        m_params.nb_cif_bits, m_cif_history->GetTotalCIFs(), m_cif_history->GetTotalPushed(), is_packed,
+        m_cif_history->GetMemoryPolicy());
+}
+
+bool BasicRadio::GetIsPackedCIFHistory() const {
+    return m_cif_history->GetIsPacked();
+}
+
+void BasicRadio::SetCIFHistoryMemoryPolicy(const Memory_Policy& policy) {
+    if (policy == m_cif_history->GetMemoryPolicy()) return;
+    Flush();
+    m_cif_history = std::make_unique<CIF_History>(
+        m_params.nb_cif_bits, m_cif_history->GetTotalCIFs(), m_cif_history->GetTotalPushed(), m_cif_history->GetIsPacked(),
+        policy);
+}
+
+const Memory_Policy& BasicRadio::GetCIFHistoryMemoryPolicy() const {
+    return m_cif_history->GetMemoryPolicy();
+}
+
+uint64_t BasicRadio::PushCIFs(tcb::span<const viterbi_bit_t> msc_buf) {
+    const uint64_t cif_index = m_cif_history->GetTotalPushed();
+    for (int i = 0; i < m_params.nb_cifs; i++) {
+        const auto cif_buf = msc_buf.subspan(i*m_params.nb_cif_bits, m_params.nb_cif_bits);
+        m_cif_history->Push(cif_buf);
+    }
+    return cif_index;
+}
+
+size_t BasicRadio::GetPipelineDepth() const {
+    return m_pipeline_frames.empty() ? 1 : m_pipeline_frames.size();
+}
+
+void BasicRadio::Flush() {
+    auto pool_scope = BasicThreadPool::ClientScope(*m_thread_pool, m_thread_pool_client);
+    for (auto& frame: m_pipeline_frames) {
+        m_thread_pool->Wait(frame->task_group);
+    }
+    m_thread_pool->Wait(*m_strand_task_group);
+    m_thread_pool->Wait(*m_segment_cif_task_group);
+    m_thread_pool->Wait(*m_segment_fic_task_group);
 }
 
 Basic_Audio_Channel* BasicRadio::Get_Audio_Channel(const subchannel_id_t id) {
@@ -80,74 +715,490 @@ Basic_Data_Packet_Channel* BasicRadio::Get_Data_Packet_Channel(const subchannel_
     return res->second.get();
 }
 
-void BasicRadio::UpdateAfterProcessing() {
+void BasicRadio::UpdateSymbolMask() {
+    // The FIC is always decoded since it is needed to find new subchannels
+    std::fill(m_new_symbol_mask.begin(), m_new_symbol_mask.end(), uint8_t(0));
+    std::fill_n(m_new_symbol_mask.begin(), m_params.nb_fic_symbols, uint8_t(1));
+
+    // Each subchannel is at the same capacity units in every CIF
+    // The layout of a pending reconfiguration is also needed since it can start in any CIF
+    for (const auto& [_, msc_runner]: m_msc_runners) {
+        const auto* decoder = msc_runner->GetHistoryMSCDecoder();
+        if (decoder == nullptr) continue;
+        AddSymbolMask(decoder->GetSubchannel());
+        const auto* next_subchannel = decoder->GetNextSubchannel();
+        if (next_subchannel != nullptr) AddSymbolMask(*next_subchannel);
+    }
+
+    if (m_new_symbol_mask == m_symbol_mask) return;
+    std::swap(m_new_symbol_mask, m_symbol_mask);
+    m_obs_symbol_mask.Notify(m_symbol_mask);
+}
+
+void BasicRadio::AddSymbolMask(const Subchannel& subchannel) {
+    const int start_bit = int(subchannel.start_address)*TOTAL_CAPACITY_UNIT_BITS;
+    const int end_bit = int(subchannel.start_address + subchannel.length)*TOTAL_CAPACITY_UNIT_BITS;
+    if ((end_bit <= start_bit) || (end_bit > m_params.nb_cif_bits)) return;
+    for (int i = 0; i < m_params.nb_cifs; i++) {
+        const int cif_bit = i*m_params.nb_cif_bits;
+        const int symbol_start = m_params.nb_fic_symbols + (cif_bit+start_bit)/m_params.nb_sym_bits;
+        const int symbol_end = m_params.nb_fic_symbols + (cif_bit+end_bit-1)/m_params.nb_sym_bits + 1;
+        std::fill(m_new_symbol_mask.begin()+symbol_start, m_new_symbol_mask.begin()+symbol_end, uint8_t(1));
+    }
+}
+
+void BasicRadio::UpdateReconfiguration() {
+    // DOC: ETSI EN 300 401
+    // Clause 6.5: Multiplex reconfiguration
+    // FIG 0/0 signals the CIF count at which the next configuration from FIG 0/1 (C/N=1) is used
+    const auto& misc_info = m_fic_runner->GetMiscInfo();
+    const auto& next_subchannels = m_fic_runner->GetDatabaseUpdater().GetNextSubchannels();
+    if ((misc_info.change_flags == 0) || next_subchannels.empty()) return;
+
+    // The CIF count of FIG 0/0 refers to the first CIF of the frame and wraps around every 250 CIFs
+    constexpr int TOTAL_CIF_LOWER_COUNT = 250;
+    const int cif_offset = 
+        (int(misc_info.occurrence_change) - int(misc_info.cif_counter.lower_count) + TOTAL_CIF_LOWER_COUNT) % 
+        TOTAL_CIF_LOWER_COUNT;
+    const uint64_t reconfig_cif_index = m_fic_cif_index + uint64_t(cif_offset);
+    if ((reconfig_cif_index == m_reconfig_cif_index) && (next_subchannels.size() == m_total_reconfig_subchannels)) {
+        return;
+    }
+    m_reconfig_cif_index = reconfig_cif_index;
+    m_total_reconfig_subchannels = next_subchannels.size();
+
+    // Runners switch over at the signalled CIF by themselves so we only wait for in flight frames once
+    Flush();
+    for (const auto& next: next_subchannels) {
+        auto res = m_msc_runners.find(next.id);
+        if (res == m_msc_runners.end()) continue;
+        LOG_MESSAGE("Reconfiguring subchannel {} at cif={}", next.id, reconfig_cif_index);
+        res->second->Reconfigure(next, reconfig_cif_index);
+    }
+}
+
+std::vector<Basic_Subchannel_Cost> BasicRadio::GetSubchannelCosts() {
     auto lock = std::scoped_lock(m_mutex_data);
+    std::vector<Basic_Subchannel_Cost> costs;
+    costs.reserve(m_msc_runners.size());
+    for (const auto& [id, runner]: m_msc_runners) {
+        Basic_Subchannel_Cost cost;
+        const Subchannel* subchannel = m_dab_database->GetSubchannel(id);
+        if (subchannel == nullptr) {
+            for (const auto& cached: m_cached_config.channels) {
+                if (cached.subchannel.id == id) subchannel = &cached.subchannel;
+            }
+        }
+        if (subchannel != nullptr) {
+            cost.subchannel = *subchannel;
+            cost.bitrate_kbps = get_subchannel_bitrate(*subchannel);
+        } else {
+            cost.subchannel = Subchannel(id);
+        }
+        cost.total = runner->GetCostAccount().Load();
+        auto res = m_cost_windows.find(id);
+        if ((res != m_cost_windows.end()) && (res->second.runner == runner.get())) {
+            cost.window = res->second.last;
+            cost.window_seconds = m_cost_window_seconds;
+        }
+        costs.push_back(cost);
+    }
+    return costs;
+}
+
+Memory_Usage BasicRadio::GetMemoryUsage() {
+    // channels can't be read while they are decoding in flight frames
+    Flush();
+    auto lock = std::scoped_lock(m_mutex_data);
+    Memory_Usage usage("radio");
+    if (m_cif_history != nullptr) {
+        usage.AddChild("cif_history", m_cif_history->GetMemoryBytes());
+    }
+    auto& channels = usage.AddChild("channels");
+    for (const auto& [id, runner]: m_msc_runners) {
+        auto channel_usage = runner->GetMemoryUsage();
+        channel_usage.name = fmt::format("subchannel_{}", id);
+        channels.AddChild(std::move(channel_usage));
+    }
+    // NOTE: This includes the decoders of threads outside this radio since they are shared by every decoder
+    usage.AddChild("viterbi_threads", DAB_Viterbi_Decoder::get_total_thread_memory_bytes());
+    usage.AddChild(m_dab_database->GetMemoryUsage());
+    return usage;
+}
+
+void BasicRadio::UpdateCostWindow(const int total_frames) {
+    m_cost_window_counter += total_frames;
+    if (m_cost_window_counter < m_cost_window_frames) return;
+    m_cost_window_counter = 0;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration<float>(now - m_cost_window_start);
+    m_cost_window_start = now;
+
+    auto lock = std::scoped_lock(m_mutex_data);
+    m_cost_window_seconds = elapsed.count();
+    for (const auto& [id, runner]: m_msc_runners) {
+        const auto totals = runner->GetCostAccount().Load();
+        auto& window = m_cost_windows[id];
+        // the first window of a new or replaced channel starts now
+        if (window.runner != runner.get()) {
+            window = { runner.get(), totals, Cost_Totals{} };
+            continue;
+        }
+        window.last = totals - window.start;
+        window.start = totals;
+    }
+    for (auto it = m_cost_windows.begin(); it != m_cost_windows.end();) {
+        if (m_msc_runners.find(it->first) == m_msc_runners.end()) {
+            it = m_cost_windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void BasicRadio::UpdateAfterProcessing() {
     const auto& new_misc_info = m_fic_runner->GetMiscInfo();
     const auto& dab_database_updater = m_fic_runner->GetDatabaseUpdater();
-    const auto& new_dab_database = dab_database_updater.GetDatabase();
-    const auto& new_dab_database_stats = dab_database_updater.GetStatistics();
 
+    // Only this thread runs the updater so we can copy the database before locking
+    // Every change is reported so we don't need to compare the statistics to find out if it was updated
+    const bool is_updated = !m_pending_database_changes.empty();
+    std::shared_ptr<const DAB_Database> new_dab_database = nullptr;
+    if (is_updated) {
+        new_dab_database = std::make_shared<const DAB_Database>(dab_database_updater.GetDatabase());
+    }
 
-    *m_dab_misc_info = new_misc_info;
+    // Readers of the misc info never hold up this thread since it changes every frame
+    m_dab_misc_info.store(new_misc_info);
+    if (!is_updated && !m_is_unconfirmed_channels.load(std::memory_order_relaxed)) return;
 
-    const bool is_updated = new_dab_database_stats != *m_dab_database_stats;
+    auto lock = std::scoped_lock(m_mutex_data);
+    if (is_updated) {
+        std::atomic_store(&m_dab_database, new_dab_database);
+        m_dab_database_version.fetch_add(1, std::memory_order_release);
+        *m_dab_database_stats = dab_database_updater.GetStatistics();
+    }
+    ValidateCachedChannels();
+    m_is_unconfirmed_channels.store(!m_unconfirmed_channels.empty(), std::memory_order_relaxed);
     if (!is_updated) return;
-    *m_dab_database = new_dab_database;
-    *m_dab_database_stats = new_dab_database_stats;
+    UpdateShard();
 
-    for (auto& subchannel: m_dab_database->subchannels) {
-        if (!subchannel.is_complete) continue;
+    // Only subchannels whose subchannel or service component changed can get a new channel
+    for (const auto& change: m_pending_database_changes) {
+        const Subchannel* subchannel = nullptr;
+        if (change.entity_type == DatabaseEntityType::SUBCHANNEL) {
+            subchannel = &(m_dab_database->subchannels[change.index]);
+        } else if (change.entity_type == DatabaseEntityType::SERVICE_COMPONENT) {
+            const auto& service_component = m_dab_database->service_components[change.index];
+            subchannel = m_dab_database->GetSubchannel(service_component.subchannel_id);
+        }
+        if (subchannel == nullptr) continue;
+        if (!subchannel->is_complete) continue;
+        if (m_msc_runners.find(subchannel->id) != m_msc_runners.end()) continue;
+        CreateChannel(*subchannel);
+    }
 
-        if (m_msc_runners.find(subchannel.id) != m_msc_runners.end()) {
+    for (auto& queue: m_event_queues) {
+        queue->PushDatabaseChanges(m_pending_database_changes, m_dab_database);
+    }
+    m_obs_database_changes.Notify(m_pending_database_changes);
+    m_pending_database_changes.clear();
+}
+
+void BasicRadio::CreateChannel(const Subchannel& subchannel) {
+    const auto* service_component = m_dab_database->GetServiceComponent_Subchannel(subchannel.id);
+    if (!service_component) {
+        return;
+    }
+    if (!service_component->is_complete) {
+        return;
+    }
+    CreateChannel(
+        subchannel, 
+        service_component->transport_mode, service_component->audio_service_type, service_component->data_service_type);
+}
+
+bool BasicRadio::CreateChannel(
+    const Subchannel& subchannel,
+    const TransportMode mode, const AudioServiceType audio_type, const DataServiceType data_type) 
+{
+    if (!is_supported_channel(subchannel, mode, audio_type)) {
+        return false;
+    }
+    if (!IsShardSubchannel(subchannel.id)) {
+        return false;
+    }
+
+    if (audio_type == AudioServiceType::DAB_PLUS && mode == TransportMode::STREAM_MODE_AUDIO) {
+        LOG_MESSAGE("Added DAB+ subchannel {}", subchannel.id);
+        auto channel = std::make_shared<Basic_DAB_Plus_Channel>(m_params, subchannel, audio_type, m_memory_resource);
+        channel->SetMOTAssemblerBudget(m_mot_assembler_budget);
+        if (m_is_queued_pad) channel->SetPADThreadPool(m_thread_pool);
+        channel->SetIsLowLatency(m_is_low_latency_aac);
+        channel->SetMaxErrorPerBit(m_max_error_per_bit);
+        if (m_is_multi_cif_viterbi) channel->SetViterbiBackend(m_viterbi_backend);
+        m_msc_runners.insert({ subchannel.id, channel });
+        m_audio_channels.insert({ subchannel.id, channel });
+        for (auto& queue: m_event_queues) Basic_Radio_Event_Queue::AttachAudioChannel(queue, subchannel.id, *channel);
+        m_obs_audio_channel.Notify(subchannel.id, *channel);
+        return true;
+    }
+
+    if (audio_type == AudioServiceType::DAB && mode == TransportMode::STREAM_MODE_AUDIO) {
+        LOG_MESSAGE("Added DAB subchannel {}", subchannel.id);
+        auto channel = std::make_shared<Basic_DAB_Channel>(m_params, subchannel, audio_type, m_memory_resource);
+        channel->SetMOTAssemblerBudget(m_mot_assembler_budget);
+        if (m_is_queued_pad) channel->SetPADThreadPool(m_thread_pool);
+        channel->SetMaxErrorPerBit(m_max_error_per_bit);
+        if (m_is_multi_cif_viterbi) channel->SetViterbiBackend(m_viterbi_backend);
+        m_msc_runners.insert({ subchannel.id, channel });
+        m_audio_channels.insert({ subchannel.id, channel });
+        for (auto& queue: m_event_queues) Basic_Radio_Event_Queue::AttachAudioChannel(queue, subchannel.id, *channel);
+        m_obs_audio_channel.Notify(subchannel.id, *channel);
+        return true;
+    } 
+ 
+    LOG_MESSAGE("Added data packet subchannel {}", subchannel.id);
+    auto channel = std::make_shared<Basic_Data_Packet_Channel>(m_params, subchannel, data_type, m_memory_resource);
+    channel->SetMOTAssemblerBudget(m_mot_assembler_budget);
+    if (m_is_queued_packet_data) channel->SetPacketThreadPool(m_thread_pool);
+    channel->SetMaxErrorPerBit(m_max_error_per_bit);
+    if (m_is_multi_cif_viterbi) channel->SetViterbiBackend(m_viterbi_backend);
+    m_msc_runners.insert({ subchannel.id, channel });
+    m_data_packet_channels.insert({ subchannel.id, channel });
+    for (auto& queue: m_event_queues) Basic_Radio_Event_Queue::AttachDataPacketChannel(queue, subchannel.id, *channel);
+    m_obs_data_packet_channel.Notify(subchannel.id, *channel);
+    return true;
+}
+
+void BasicRadio::AddEventQueue(std::shared_ptr<Basic_Radio_Event_Queue> queue) {
+    auto lock = std::scoped_lock(m_mutex_data);
+    // channels loaded from a cached ensemble config already exist
+    for (auto& [id, channel]: m_audio_channels) {
+        Basic_Radio_Event_Queue::AttachAudioChannel(queue, id, *channel);
+    }
+    for (auto& [id, channel]: m_data_packet_channels) {
+        Basic_Radio_Event_Queue::AttachDataPacketChannel(queue, id, *channel);
+    }
+    m_event_queues.push_back(std::move(queue));
+}
+
+void BasicRadio::LoadEnsembleConfig(const Basic_Ensemble_Config& config) {
+    auto lock = std::scoped_lock(m_mutex_data);
+    m_cached_config = config;
+    m_cached_cif_index = m_cif_history->GetTotalPushed();
+    UpdateShard();
+    for (const auto& cached: config.channels) {
+        const auto id = cached.subchannel.id;
+        if (m_msc_runners.find(id) != m_msc_runners.end()) continue;
+        const bool is_created = CreateChannel(
+            cached.subchannel, cached.transport_mode, cached.audio_service_type, cached.data_service_type);
+        if (is_created) m_unconfirmed_channels.insert(id);
+    }
+    m_is_unconfirmed_channels.store(!m_unconfirmed_channels.empty(), std::memory_order_relaxed);
+    LOG_MESSAGE("Loaded {}/{} cached channels of ensemble {:04X}", 
+        m_unconfirmed_channels.size(), config.channels.size(), config.ensemble_id);
+}
+
+Basic_Ensemble_Config BasicRadio::GetEnsembleConfig() {
+    auto lock = std::scoped_lock(m_mutex_data);
+    return CreateEnsembleConfig();
+}
+
+Basic_Radio_Checkpoint BasicRadio::GetCheckpoint() {
+    Flush();
+    auto lock = std::scoped_lock(m_mutex_data);
+    Basic_Radio_Checkpoint checkpoint;
+    checkpoint.config = CreateEnsembleConfig();
+    // Enough CIFs are kept for the deinterleavers and the superframe in progress of every channel
+    const uint64_t total_pushed = m_cif_history->GetTotalPushed();
+    const uint64_t total_cifs = std::min(total_pushed - m_cif_history->GetFirstIndex(), uint64_t(m_cif_history->GetTotalCIFs()));
+    const size_t N = size_t(m_params.nb_cif_bits);
+    checkpoint.nb_cif_bits = m_params.nb_cif_bits;
+    checkpoint.cif_bits.resize(size_t(total_cifs)*N);
+    for (uint64_t i = 0; i < total_cifs; i++) {
+        const uint64_t index = total_pushed - total_cifs + i;
+        m_cif_history->ReadCIF(index, 0, tcb::span(checkpoint.cif_bits).subspan(size_t(i)*N, N));
+    }
+    for (const auto& [id, runner]: m_msc_runners) {
+        Basic_Subchannel_Checkpoint subchannel;
+        subchannel.id = id;
+        subchannel.superframe_phase = runner->GetSuperFramePhase();
+        checkpoint.subchannels.push_back(subchannel);
+    }
+    return checkpoint;
+}
+
+void BasicRadio::RestoreCheckpoint(const Basic_Radio_Checkpoint& checkpoint) {
+    const size_t N = size_t(m_params.nb_cif_bits);
+    if ((checkpoint.nb_cif_bits != m_params.nb_cif_bits) || (checkpoint.cif_bits.size() % N != 0)) {
+        LOG_ERROR("Ignoring checkpoint with {} bits per CIF instead of {}", checkpoint.nb_cif_bits, m_params.nb_cif_bits);
+        return;
+    }
+    // The history is refilled first so the channels created from the config deinterleave straight away
+    const size_t total_cifs = std::min(checkpoint.cif_bits.size()/N, m_cif_history->GetTotalCIFs());
+    const auto cif_bits = tcb::span(checkpoint.cif_bits).last(total_cifs*N);
+    for (size_t i = 0; i < total_cifs; i++) {
+        m_cif_history->Push(cif_bits.subspan(i*N, N));
+    }
+    LoadEnsembleConfig(checkpoint.config);
+
+    auto lock = std::scoped_lock(m_mutex_data);
+    const uint64_t cif_index = m_cif_history->GetTotalPushed();
+    const uint64_t first_index = m_cif_history->GetFirstIndex();
+    for (const auto& subchannel: checkpoint.subchannels) {
+        auto res = m_msc_runners.find(subchannel.id);
+        if (res == m_msc_runners.end()) continue;
+        // the CIFs of the superframe need a full deinterleaver history of their own
+        const uint64_t min_cif_index = first_index + TOTAL_CIF_DEINTERLEAVE_HISTORY-1 + uint64_t(subchannel.superframe_phase);
+        if ((subchannel.superframe_phase <= 0) || (cif_index < min_cif_index)) continue;
+        res->second->RestoreSuperFrame(*m_cif_history, cif_index, subchannel.superframe_phase);
+    }
+    LOG_MESSAGE("Restored checkpoint with {} CIFs and {} channels", total_cifs, checkpoint.subchannels.size());
+}
+
+Basic_Ensemble_Config BasicRadio::CreateEnsembleConfig() const {
+    const auto& db = *m_dab_database;
+    Basic_Ensemble_Config config;
+    config.ensemble_id = (db.ensemble.reference != 0) ? db.ensemble.reference : m_cached_config.ensemble_id;
+    for (const auto& subchannel: db.subchannels) {
+        if (!subchannel.is_complete) continue;
+        if (m_unconfirmed_channels.find(subchannel.id) != m_unconfirmed_channels.end()) continue;
+        const auto* service_component = db.GetServiceComponent_Subchannel(subchannel.id);
+        if ((service_component == nullptr) || !service_component->is_complete) continue;
+        if (!is_supported_channel(subchannel, service_component->transport_mode, service_component->audio_service_type)) {
             continue;
         }
- 
-        const ServiceComponent* service_component = nullptr;
-        for (auto& e: m_dab_database->service_components) {
-            if (e.subchannel_id == subchannel.id) {
-                service_component = &e;
-                break;
-            }
+        Basic_Cached_Channel cached(subchannel.id);
+        cached.subchannel = subchannel;
+        cached.transport_mode = service_component->transport_mode;
+        cached.audio_service_type = service_component->audio_service_type;
+        cached.data_service_type = service_component->data_service_type;
+        config.channels.push_back(cached);
+    }
+    // keep cached channels that the FIC hasn't described yet
+    for (const auto& cached: m_cached_config.channels) {
+        if (m_unconfirmed_channels.find(cached.subchannel.id) == m_unconfirmed_channels.end()) continue;
+        config.channels.push_back(cached);
+    }
+    return config;
+}
+
+void BasicRadio::ValidateCachedChannels() {
+    if (m_unconfirmed_channels.empty()) return;
+
+    // A different ensemble on the same frequency invalidates the whole cache
+    const ensemble_id_t ensemble_id = m_dab_database->ensemble.reference;
+    const bool is_other_ensemble = (ensemble_id != 0) && (ensemble_id != m_cached_config.ensemble_id);
+    const bool is_expired = m_fic_cif_index >= (m_cached_cif_index + TOTAL_CACHED_CHANNEL_TIMEOUT_CIFS);
+    if (is_other_ensemble || is_expired) {
+        if (is_other_ensemble) {
+            LOG_MESSAGE("Discarding cached channels of ensemble {:04X} since ensemble {:04X} was found", 
+                m_cached_config.ensemble_id, ensemble_id);
+        } else {
+            LOG_MESSAGE("Discarding {} cached channels that weren't found in the FIC", m_unconfirmed_channels.size());
         }
-        if (!service_component) {
-            continue;
+        for (const auto id: m_unconfirmed_channels) {
+            RetireChannel(id);
+            const auto* subchannel = m_dab_database->GetSubchannel(id);
+            if ((subchannel != nullptr) && subchannel->is_complete) CreateChannel(*subchannel);
         }
-        if (!service_component->is_complete) {
+        m_unconfirmed_channels.clear();
+        return;
+    }
+
+    for (auto it = m_unconfirmed_channels.begin(); it != m_unconfirmed_channels.end();) {
+        const auto id = *it;
+        const auto* subchannel = m_dab_database->GetSubchannel(id);
+        const auto* service_component = m_dab_database->GetServiceComponent_Subchannel(id);
+        if ((subchannel == nullptr) || !subchannel->is_complete || 
+            (service_component == nullptr) || !service_component->is_complete) 
+        {
+            it++;
             continue;
         }
+        it = m_unconfirmed_channels.erase(it);
 
-        const auto mode = service_component->transport_mode;
-        const auto audio_type = service_component->audio_service_type;
-        const auto data_type = service_component->data_service_type;
-
-        if (audio_type == AudioServiceType::DAB_PLUS && mode == TransportMode::STREAM_MODE_AUDIO) {
-            LOG_MESSAGE("Added DAB+ subchannel {}", subchannel.id);
-            auto channel = std::make_shared<Basic_DAB_Plus_Channel>(m_params, subchannel, audio_type);
-            m_msc_runners.insert({ subchannel.id, channel });
-            m_audio_channels.insert({ subchannel.id, channel });
-            m_obs_audio_channel.Notify(subchannel.id, *channel);
+        const auto cached = std::find_if(m_cached_config.channels.begin(), m_cached_config.channels.end(), 
+            [id](const auto& channel) { return channel.subchannel.id == id; });
+        const bool is_same_type = 
+            (cached != m_cached_config.channels.end()) &&
+            (cached->transport_mode == service_component->transport_mode) &&
+            (cached->audio_service_type == service_component->audio_service_type) &&
+            (cached->data_service_type == service_component->data_service_type) &&
+            (cached->subchannel.fec_scheme == subchannel->fec_scheme);
+        if (!is_same_type) {
+            LOG_MESSAGE("Recreating cached subchannel {} since its service component changed", id);
+            RetireChannel(id);
+            CreateChannel(*subchannel);
             continue;
         }
+        if (!is_same_layout(cached->subchannel, *subchannel)) {
+            // Switch over from the next frame like a multiplex reconfiguration
+            LOG_MESSAGE("Relocating cached subchannel {} since its layout changed", id);
+            Flush();
+            auto& runner = *m_msc_runners.at(id);
+            runner.Reconfigure(*subchannel, m_fic_cif_index + uint64_t(m_params.nb_cifs));
+        }
+    }
+}
 
-        if (audio_type == AudioServiceType::DAB && mode == TransportMode::STREAM_MODE_AUDIO) {
-            LOG_MESSAGE("Added DAB subchannel {}", subchannel.id);
-            auto channel = std::make_shared<Basic_DAB_Channel>(m_params, subchannel, audio_type);
-            m_msc_runners.insert({ subchannel.id, channel });
-            m_audio_channels.insert({ subchannel.id, channel });
-            m_obs_audio_channel.Notify(subchannel.id, *channel);
-            continue;
-        } 
- 
-        // DOC: EN 300 401
-        // Clause: 5.3.5 FEC for MSC packet mode
-        // Data packet channels require the FEC scheme to be defined for outer encoding
-        if (mode == TransportMode::PACKET_MODE_DATA && (subchannel.fec_scheme != FEC_Scheme::UNDEFINED)) {
-            LOG_MESSAGE("Added data packet subchannel {}", subchannel.id);
-            auto channel = std::make_shared<Basic_Data_Packet_Channel>(m_params, subchannel, data_type);
-            m_msc_runners.insert({ subchannel.id, channel });
-            m_data_packet_channels.insert({ subchannel.id, channel });
-            m_obs_data_packet_channel.Notify(subchannel.id, *channel);
+// Subchannels of the database and the cached ensemble config that the FIC hasn't described yet are assigned to shards
+// Channels that moved to another shard are retired and those that moved to this one are created
+void BasicRadio::UpdateShard() {
+    if (m_total_shards <= 1) {
+        m_shard_subchannels.clear();
+        return;
+    }
+    std::vector<Subchannel> subchannels;
+    for (const auto& subchannel: m_dab_database->subchannels) {
+        if (!subchannel.is_complete) continue;
+        const auto* service_component = m_dab_database->GetServiceComponent_Subchannel(subchannel.id);
+        if ((service_component == nullptr) || !service_component->is_complete) continue;
+        if (!is_supported_channel(subchannel, service_component->transport_mode, service_component->audio_service_type)) {
             continue;
         }
+        subchannels.push_back(subchannel);
+    }
+    for (const auto& cached: m_cached_config.channels) {
+        const auto id = cached.subchannel.id;
+        const bool is_described = std::any_of(subchannels.begin(), subchannels.end(),
+            [id](const auto& subchannel) { return subchannel.id == id; });
+        if (!is_described) subchannels.push_back(cached.subchannel);
+    }
+    assign_shard_subchannels(subchannels, m_shard_index, m_total_shards, m_shard_subchannels);
+
+    std::vector<subchannel_id_t> moved_subchannels;
+    for (const auto& [id, _]: m_msc_runners) {
+        if (!IsShardSubchannel(id)) moved_subchannels.push_back(id);
+    }
+    for (const auto id: moved_subchannels) {
+        LOG_MESSAGE("Retiring subchannel {} since it moved to another shard", id);
+        RetireChannel(id);
+        m_unconfirmed_channels.erase(id);
     }
-}
\ No newline at end of file
+    for (const auto id: m_shard_subchannels) {
+        if (m_msc_runners.find(id) != m_msc_runners.end()) continue;
+        const auto* subchannel = m_dab_database->GetSubchannel(id);
+        if ((subchannel == nullptr) || !subchannel->is_complete) continue;
+        CreateChannel(*subchannel);
+    }
+}
+
+bool BasicRadio::IsShardSubchannel(const subchannel_id_t id) const {
+    if (m_total_shards <= 1) return true;
+    return m_shard_subchannels.find(id) != m_shard_subchannels.end();
+}
+
+void BasicRadio::RetireChannel(const subchannel_id_t id) {
+    auto res = m_msc_runners.find(id);
+    if (res == m_msc_runners.end()) return;
+    // runners can't be removed while they are still decoding in flight frames
+    Flush();
+    m_msc_strands.erase(id);
+    m_retired_runners.push_back(res->second);
+    m_msc_runners.erase(res);
+    m_audio_channels.erase(id);
+    m_data_packet_channels.erase(id);
+}
@@ -1,53 +1,323 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "dab/constants/dab_parameters.h"
+#include "dab/dab_misc_info.h"
+#include "dab/database/dab_database_entities.h"
 #include "dab/database/dab_database_types.h"
+#include "utility/cost_account.h"
+#include "utility/memory_policy.h"
+#include "utility/memory_usage.h"
 #include "utility/observable.h"
+#include "utility/seqlock.h"
 #include "utility/span.h"
+#include "utility/thread_affinity.h"
 #include "viterbi_config.h"
+#include "./basic_ensemble_config.h"
+#include "./basic_radio_checkpoint.h"
 
 struct DAB_Database;
-struct DAB_Misc_Info;
 struct DatabaseUpdaterGlobalStatistics;
+struct DatabaseChange;
+class CIF_History;
+class MSC_Decoder;
+class DAB_Viterbi_Backend;
 class BasicThreadPool;
+class BasicTaskGroup;
+struct BasicTaskAccount;
 class BasicFICRunner;
 class Basic_MSC_Runner;
+class Basic_MSC_Strand;
+struct BasicRadioFrame;
 class Basic_Audio_Channel;
 class Basic_Data_Packet_Channel;
+class MOT_Assembler_Budget;
+class Basic_Radio_Event_Queue;
+
+// CPU time spent decoding a subchannel split by stage, see BasicRadio::GetSubchannelCosts()
+// NOTE: Subchannels that are viterbi decoded as a batch (see BasicRadio::SetIsBatchViterbi()) 
+//       only count their viterbi decoding if it falls back to decoding them one at a time
+struct Basic_Subchannel_Cost {
+    // protection level and size from the database or the cached ensemble config
+    Subchannel subchannel = Subchannel(0);
+    // 0 if the subchannel isn't described yet
+    uint32_t bitrate_kbps = 0;
+    // since the channel was created
+    Cost_Totals total;
+    // over the last window which is about a second long
+    Cost_Totals window;
+    float window_seconds = 0.0f;
+};
 
 // Our basic radio
 class BasicRadio
 {
 private:
+    struct Basic_Cost_Window {
+        const Basic_MSC_Runner* runner = nullptr;
+        Cost_Totals start;
+        Cost_Totals last;
+    };
     const DAB_Parameters m_params;
-    std::unique_ptr<BasicThreadPool> m_thread_pool;
+    std::shared_ptr<BasicThreadPool> m_thread_pool;
+    const size_t m_thread_pool_client;
     std::unique_ptr<BasicFICRunner> m_fic_runner;
     std::unordered_map<subchannel_id_t, std::shared_ptr<Basic_MSC_Runner>> m_msc_runners;
     std::mutex m_mutex_data;
-    std::unique_ptr<DAB_Misc_Info> m_dab_misc_info;
-    std::unique_ptr<DAB_Database> m_dab_database;
+    // published every frame without locking m_mutex_data
+    Seqlock<DAB_Misc_Info> m_dab_misc_info;
+    // immutable snapshot that is replaced as a whole when the database is updated
+    std::shared_ptr<const DAB_Database> m_dab_database;
+    std::atomic<uint64_t> m_dab_database_version;
     std::unique_ptr<DatabaseUpdaterGlobalStatistics> m_dab_database_stats;
+    // changes reported by the fic runner's database updater since the last update
+    std::vector<DatabaseChange> m_pending_database_changes;
+    Observable<tcb::span<const DatabaseChange>> m_obs_database_changes;
     std::unordered_map<subchannel_id_t, std::shared_ptr<Basic_Audio_Channel>> m_audio_channels;
     std::unordered_map<subchannel_id_t, std::shared_ptr<Basic_Data_Packet_Channel>> m_data_packet_channels;
     Observable<subchannel_id_t, Basic_Audio_Channel&> m_obs_audio_channel;
     Observable<subchannel_id_t, Basic_Data_Packet_Channel&> m_obs_data_packet_channel;
+    // consumers that drain their events on their own threads instead of observing the channels
+    std::vector<std::shared_ptr<Basic_Radio_Event_Queue>> m_event_queues;
+    // pipelined decoding where msc subchannels of a frame can overlap with later frames
+    size_t m_pipeline_index;
+    std::vector<std::unique_ptr<BasicRadioFrame>> m_pipeline_frames;
+    std::unordered_map<subchannel_id_t, std::unique_ptr<Basic_MSC_Strand>> m_msc_strands;
+    std::unique_ptr<BasicTaskGroup> m_strand_task_group;
+    // frame given to ProcessSegment() where the FIC and each CIF are decoded as soon as they arrive
+    size_t m_next_segment_index;
+    std::vector<viterbi_bit_t> m_segment_bits;
+    std::unique_ptr<BasicTaskGroup> m_segment_fic_task_group;
+    std::unique_ptr<BasicTaskGroup> m_segment_cif_task_group;
+    std::chrono::steady_clock::time_point m_segment_deadline;
+    // ensemble wide CIF history shared by all subchannel deinterleavers
+    std::unique_ptr<CIF_History> m_cif_history;
+    // viterbi decoding of many subchannels together as one set of jobs
+    bool m_is_batch_viterbi;
+    // viterbi decoding of the CIFs of a frame together by each subchannel
+    bool m_is_multi_cif_viterbi;
+    // programme associated data of audio channels is processed separately to the audio
+    bool m_is_queued_pad;
+    // DAB+ access units are emitted before their superframe is reed solomon corrected
+    bool m_is_low_latency_aac;
+    // packet addresses of data channels are assembled in parallel on the thread pool
+    bool m_is_queued_packet_data;
+    // CIFs with a higher viterbi error aren't decoded past viterbi (0 if disabled)
+    float m_max_error_per_bit;
+    // share of the subchannels decoded by this radio when the ensemble is split between radios
+    size_t m_shard_index;
+    size_t m_total_shards;
+    std::unordered_set<subchannel_id_t> m_shard_subchannels;
+    std::shared_ptr<DAB_Viterbi_Backend> m_viterbi_backend;
+    std::vector<MSC_Decoder*> m_batch_msc_decoders;
+    // data symbols used by the FIC and the subchannels that are being decoded or on standby (non zero if used)
+    std::vector<uint8_t> m_symbol_mask;
+    std::vector<uint8_t> m_new_symbol_mask;
+    Observable<tcb::span<const uint8_t>> m_obs_symbol_mask;
+    // index of the first CIF of the frame whose FIC was last decoded
+    uint64_t m_fic_cif_index;
+    // multiplex reconfiguration that was passed onto the runners
+    uint64_t m_reconfig_cif_index;
+    size_t m_total_reconfig_subchannels;
+    // partially assembled MOT entities of all channels share one byte budget
+    std::shared_ptr<MOT_Assembler_Budget> m_mot_assembler_budget;
+    // channels created from a cached ensemble config that the live FIC hasn't confirmed yet
+    Basic_Ensemble_Config m_cached_config;
+    uint64_t m_cached_cif_index;
+    std::unordered_set<subchannel_id_t> m_unconfirmed_channels;
+    // m_mutex_data is only locked after a frame if the database changed, there are channels to confirm
+    // or a cost window ended
+    std::atomic<bool> m_is_unconfirmed_channels;
+    // channels replaced after the cache was invalidated are kept since observers hold references to them
+    std::vector<std::shared_ptr<Basic_MSC_Runner>> m_retired_runners;
+    // decoder buffers of every channel are allocated from this
+    std::pmr::memory_resource* const m_memory_resource;
+    // frames of playing audio that were decoded after the next frame was due
+    std::atomic<int> m_total_deadline_misses;
+    // capture time of the frame given to Process() which its msc tasks decode under
+    uint64_t m_frame_capture_time;
+    // per subchannel costs are windowed by the thread calling Process() with m_mutex_data held
+    std::unordered_map<subchannel_id_t, Basic_Cost_Window> m_cost_windows;
+    int m_cost_window_frames;
+    int m_cost_window_counter;
+    std::chrono::steady_clock::time_point m_cost_window_start;
+    float m_cost_window_seconds;
 public:
-    explicit BasicRadio(const DAB_Parameters& params, const size_t nb_threads=0);
+    // NOTE: memory_resource must outlive the radio and any channels which observers still hold
+    //       It must also be thread safe (e.g. std::pmr::synchronized_pool_resource or a locked arena)
+    //       since channels are created and decoded on different threads
+    explicit BasicRadio(
+        const DAB_Parameters& params, const size_t nb_threads=0, const Thread_Affinity& thread_affinity={},
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
+    // Decodes with a pool shared by many radios where each radio is a separate client of the pool
+    BasicRadio(
+        const DAB_Parameters& params, std::shared_ptr<BasicThreadPool> thread_pool, const size_t thread_pool_client,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~BasicRadio();
+    // The capture time of the frame is taken from a Latency_Trace_Scope around the call, otherwise it is now
+    // Subchannels are decoded inside a scope with that time so "utility/latency_trace.h" can trace them to the audio
     void Process(tcb::span<const viterbi_bit_t> buf);
+    // Decodes a frame one segment at a time as it is demodulated, see OFDM_Demod::SetOutputSegments()
+    // Segment 0 is the FIC and segments 1 to nb_cifs are each a CIF which subchannels decode while the next is demodulated
+    // The whole frame has finished decoding when the call with its last segment returns
+    // NOTE: Segments must be given in order, a frame with a missing segment is dropped until the next FIC
+    //       With a pipeline depth above 1 the segments are gathered and decoded together by Process()
+    void ProcessSegment(const size_t segment_index, tcb::span<const viterbi_bit_t> buf);
+    // Data symbols of each segment given to ProcessSegment()
+    std::vector<size_t> GetSegmentSymbols() const;
+    // Decodes consecutive frames that are all available up front, e.g. from a recording of soft bits
+    // The FIC is decoded frame by frame first and then each subchannel decodes all of the frames in one go
+    // with subchannels decoded in parallel, so a channel's state stays in cache instead of being revisited every frame
+    // The frames are split where the FIC changes the channels so they start on the same frame as with Process()
+    // NOTE: Events of each channel are in frame order but events of different channels interleave within a batch
+    //       The CIF history grows to fit the frames decoded together the first time this is called
+    void ProcessBatch(tcb::span<const viterbi_bit_t> frames);
     Basic_Audio_Channel* Get_Audio_Channel(const subchannel_id_t id);
     Basic_Data_Packet_Channel* Get_Data_Packet_Channel(const subchannel_id_t id);
     auto& GetMutex() { return m_mutex_data; }
-    auto& GetMiscInfo() { return *(m_dab_misc_info.get()); }
-    auto& GetDatabase() { return *(m_dab_database.get()); }
+    // Copy of the latest misc info which doesn't need GetMutex()
+    DAB_Misc_Info GetMiscInfo() const { return m_dab_misc_info.load(); }
+    // NOTE: Only valid while GetMutex() is held, use GetDatabaseSnapshot() otherwise
+    const DAB_Database& GetDatabase() const { return *m_dab_database; }
+    // Readers can keep a snapshot for as long as they want without holding the mutex
+    std::shared_ptr<const DAB_Database> GetDatabaseSnapshot() const { return std::atomic_load(&m_dab_database); }
+    // Incremented each time a new snapshot is published
+    uint64_t GetDatabaseVersion() const { return m_dab_database_version.load(std::memory_order_acquire); }
     auto& GetDatabaseStatistics() { return *(m_dab_database_stats.get()); }
+    // Deinterleave, viterbi, reed solomon, audio decode and PAD time of each subchannel with a channel
+    // Use this to find which services are expensive to decode
+    std::vector<Basic_Subchannel_Cost> GetSubchannelCosts();
+    // Notified with the entities that changed once their snapshot is published (GetMutex() is held)
+    // Indices refer to the vectors of the new snapshot
+    auto& On_Database_Changes() { return m_obs_database_changes; }
     auto& On_Audio_Channel() { return m_obs_audio_channel; }
     auto& On_Data_Packet_Channel() { return m_obs_data_packet_channel; }
+    // Events of every channel and database changes are pushed into the queue for its consumer to drain in batches
+    // The consumer then processes them on its own thread instead of inside observers on the decoding threads
+    // NOTE: Call this before the first Process() since the channel observers aren't thread safe
+    void AddEventQueue(std::shared_ptr<Basic_Radio_Event_Queue> queue);
+    // Notified from the thread calling Process() when the data symbols used by the radio change
+    // Pass this to OFDM_Demod::SetDataSymbolMask() so symbols of unused subchannels aren't demodulated
+    // NOTE: A subchannel that is enabled later decodes erasures until its deinterleaver history is refilled
+    //       unless it was on standby, see Basic_Audio_Controls::SetIsStandby()
+    auto& On_Symbol_Mask() { return m_obs_symbol_mask; }
+    tcb::span<const uint8_t> GetSymbolMask() const { return m_symbol_mask; }
     size_t GetTotalThreads() const;
+    // number of worker threads whose affinity or priority couldn't be applied
+    int GetTotalThreadAffinityErrors() const;
+    // CPU time the workers of the thread pool spent decoding this radio
+    const BasicTaskAccount& GetTaskAccount() const;
+    // Frames of playing audio that finished decoding more than a frame period after they were given to Process()
+    // Subchannels are decoded by priority (see Basic_MSC_Runner::GetPriority()) so this stays low
+    // until the pool can't keep up with playing audio alone
+    int GetTotalDeadlineMisses() const { return m_total_deadline_misses.load(std::memory_order_relaxed); }
+    // depth=1 decodes each frame completely before Process() returns
+    // depth>1 lets subchannels of a frame keep decoding while the next depth-1 frames are processed
+    // NOTE: Each subchannel still decodes its frames in order since the deinterleaver is stateful
+    void SetPipelineDepth(const size_t depth);
+    size_t GetPipelineDepth() const;
+    // Wait for all in flight frames to finish decoding
+    void Flush();
+    // Equal error protection subchannels are viterbi decoded together before their runners are processed
+    // NOTE: This is only used when the pipeline depth is 1
+    void SetIsBatchViterbi(const bool is_batch_viterbi) { m_is_batch_viterbi = is_batch_viterbi; }
+    bool GetIsBatchViterbi() const { return m_is_batch_viterbi; }
+    // Each subchannel viterbi decodes the CIFs of a frame together with the viterbi backend
+    // This shortens the decoding of high bitrate subchannels when they aren't batched with others
+    // NOTE: Bytes decoded this way have no soft errors for reed solomon erasures
+    void SetIsMultiCIFViterbi(const bool is_multi_cif_viterbi);
+    bool GetIsMultiCIFViterbi() const { return m_is_multi_cif_viterbi; }
+    // Backend used for batched viterbi decoding which defaults to the SIMD lane decoder on the CPU
+    // A backend can be shared by many radios so it can combine their jobs
+    // NOTE: This can't be changed while Process() is running
+    void SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend);
+    const auto& GetViterbiBackend() const { return m_viterbi_backend; }
+    // Soft bits in the CIF history are quantised to 4bits which halves its memory and bandwidth
+    // NOTE: Subchannels decode erasures until the history is refilled after this is changed
+    void SetIsPackedCIFHistory(const bool is_packed);
+    bool GetIsPackedCIFHistory() const;
+    // Huge pages, NUMA node and locking of the CIF history
+    // Defaults to the NUMA node of the thread pool's workers since they deinterleave from it
+    // NOTE: Subchannels decode erasures until the history is refilled after this is changed
+    void SetCIFHistoryMemoryPolicy(const Memory_Policy& policy);
+    const Memory_Policy& GetCIFHistoryMemoryPolicy() const;
+    // Programme associated data (dynamic labels, MOT slideshows) of audio channels is processed by low priority tasks
+    // so a large slideshow doesn't hold up the audio that carries it, see Basic_Audio_Channel::SetPADThreadPool()
+    // NOTE: This must be called from the thread that calls Process()
+    void SetIsQueuedPAD(const bool is_queued_pad);
+    bool GetIsQueuedPAD() const { return m_is_queued_pad; }
+    // DAB+ audio is decoded up to a superframe (120ms) sooner by checking access units before reed solomon
+    // see Basic_DAB_Plus_Channel::SetIsLowLatency()
+    // NOTE: This must be called from the thread that calls Process()
+    void SetIsLowLatencyAAC(const bool is_low_latency_aac);
+    bool GetIsLowLatencyAAC() const { return m_is_low_latency_aac; }
+    // Each packet address of a data packet channel is assembled by low priority tasks
+    // so a large carousel on one address doesn't delay the others, see Basic_Data_Packet_Channel::SetPacketThreadPool()
+    // NOTE: This must be called from the thread that calls Process()
+    void SetIsQueuedPacketData(const bool is_queued_packet_data);
+    bool GetIsQueuedPacketData() const { return m_is_queued_packet_data; }
+    // Subchannels skip reed solomon and audio/data decoding for CIFs that viterbi found to be mostly noise
+    // This keeps CPU usage flat during deep fades and DAB+ channels keep their superframe sync
+    // see MSC_Decoder::SetMaxErrorPerBit(), 0 disables this which is the default
+    // NOTE: This must be called from the thread that calls Process()
+    void SetMaxErrorPerBit(const float max_error_per_bit);
+    float GetMaxErrorPerBit() const { return m_max_error_per_bit; }
+    // Radios on different hosts that receive the same frames (see soft_bit_network) each decode a share of the subchannels
+    // Every radio decodes the FIC and balances the subchannels by their size so they agree without a coordinator
+    // Subchannels move between shards as the FIC describes more of them, 1 shard decodes everything (default)
+    // NOTE: Call this before the first Process()
+    void SetShard(const size_t shard_index, const size_t total_shards);
+    size_t GetShardIndex() const { return m_shard_index; }
+    size_t GetTotalShards() const { return m_total_shards; }
+    // Adaptive FIC decoding and FIG cache statistics, see BasicFICRunner::SetIsAdaptive()
+    auto& GetFICRunner() { return *m_fic_runner; }
+    // Limit and statistics for the memory used to assemble MOT entities (slideshows, data carousels)
+    auto& GetMOTAssemblerBudget() { return *m_mot_assembler_budget; }
+    // Bytes held by the CIF history, each channel (subchannel_<id>) and the current database
+    // NOTE: This must be called from the thread that calls Process() since it waits for in flight frames
+    Memory_Usage GetMemoryUsage();
+    // Create the channels of a previously decoded ensemble before its FIC is decoded
+    // Channels are checked against the FIC once it describes them and are recreated if it disagrees
+    // NOTE: Call this before the first Process() since the channels are created straight away
+    void LoadEnsembleConfig(const Basic_Ensemble_Config& config);
+    // Channels of the current database that can be loaded next time, see LoadEnsembleConfig()
+    Basic_Ensemble_Config GetEnsembleConfig();
+    // Channels, CIF history and superframe positions that another radio can continue decoding from
+    // NOTE: This must be called from the thread that calls Process() since it waits for in flight frames
+    Basic_Radio_Checkpoint GetCheckpoint();
+    // Channels decode from the first frame given to Process() if it is the frame after the checkpoint
+    // e.g. a standby receiving the same sequenced frames (see soft_bit_network) or a restart from a recording
+    // Otherwise the stale history is decoded as errors and the channels resync within 16 CIFs as usual
+    // NOTE: Call this before the first Process() and after attaching to On_Audio_Channel()
+    void RestoreCheckpoint(const Basic_Radio_Checkpoint& checkpoint);
 private:
+    void PushBatchViterbi(BasicTaskGroup& task_group, const uint64_t cif_index, const int total_cifs);
+    void ProcessPipelined(tcb::span<const viterbi_bit_t> buf);
+    uint64_t PushCIFs(tcb::span<const viterbi_bit_t> msc_buf);
     void UpdateAfterProcessing();
+    void UpdateCostWindow(const int total_frames=1);
+    bool IsUpdatePending();
+    void DecodeBatch(const uint64_t cif_index, const int total_cifs);
+    void ReserveCIFHistory(const size_t total_cifs);
+    void UpdateReconfiguration();
+    void CreateChannel(const Subchannel& subchannel);
+    bool CreateChannel(
+        const Subchannel& subchannel,
+        const TransportMode mode, const AudioServiceType audio_type, const DataServiceType data_type);
+    void ValidateCachedChannels();
+    Basic_Ensemble_Config CreateEnsembleConfig() const;
+    void RetireChannel(const subchannel_id_t id);
+    void UpdateShard();
+    bool IsShardSubchannel(const subchannel_id_t id) const;
+    void UpdateSymbolMask();
+    void AddSymbolMask(const Subchannel& subchannel);
 };
\ No newline at end of file
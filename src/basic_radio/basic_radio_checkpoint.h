@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "dab/database/dab_database_types.h"
+#include "viterbi_config.h"
+#include "./basic_ensemble_config.h"
+
+// Position of a channel in its audio superframe, see Basic_MSC_Runner::GetSuperFramePhase()
+struct Basic_Subchannel_Checkpoint {
+    subchannel_id_t id = 0;
+    int superframe_phase = 0;
+};
+
+// Decoder state that a restarted or standby radio continues from without waiting for the FIC and deinterleavers
+// See BasicRadio::GetCheckpoint() and BasicRadio::RestoreCheckpoint()
+struct Basic_Radio_Checkpoint {
+    Basic_Ensemble_Config config;
+    // soft bits of the newest CIFs in the history from oldest to newest
+    int nb_cif_bits = 0;
+    std::vector<viterbi_bit_t> cif_bits;
+    std::vector<Basic_Subchannel_Checkpoint> subchannels;
+};
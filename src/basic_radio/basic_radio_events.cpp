@@ -0,0 +1,127 @@
+#include "./basic_radio_events.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "dab/audio/aac_frame_processor.h"
+#include "dab/database/dab_database_updater.h"
+#include "dab/mot/MOT_entities.h"
+#include "utility/buffer_pool.h"
+#include "utility/span.h"
+#include "./basic_audio_buffer.h"
+#include "./basic_audio_channel.h"
+#include "./basic_dab_channel.h"
+#include "./basic_dab_plus_channel.h"
+#include "./basic_data_packet_channel.h"
+#include "./basic_slideshow.h"
+
+using Queue_Ref = std::shared_ptr<Basic_Radio_Event_Queue>;
+
+static Pooled_Buffer copy_to_pooled_buffer(tcb::span<const uint8_t> header, tcb::span<const uint8_t> body) {
+    auto buffer = Buffer_Pool::GetGlobal().Acquire(header.size() + body.size());
+    buffer.resize(header.size() + body.size());
+    std::copy(header.begin(), header.end(), buffer.begin());
+    std::copy(body.begin(), body.end(), buffer.begin() + header.size());
+    return buffer;
+}
+
+static void push_mot_entity(Basic_Radio_Event_Queue& queue, const subchannel_id_t id, const MOT_Entity& entity) {
+    Basic_Radio_Event event;
+    event.type = Basic_Radio_Event_Type::MOT_ENTITY;
+    event.subchannel_id = id;
+    event.mot_transport_id = entity.transport_id;
+    event.mot_header = entity.header;
+    // other observers of the entity can still read its body so it is copied
+    event.data = copy_to_pooled_buffer({}, { entity.body.data(), entity.body.size() });
+    queue.Push(std::move(event));
+}
+
+static void attach_slideshows(const Queue_Ref& queue, const subchannel_id_t id, Basic_Slideshow_Manager& manager) {
+    if (!queue->GetIsWanted(Basic_Radio_Event_Type::SLIDESHOW)) return;
+    manager.OnNewSlideshow().Attach([queue, id](const std::shared_ptr<Basic_Slideshow>& slideshow) {
+        Basic_Radio_Event event;
+        event.type = Basic_Radio_Event_Type::SLIDESHOW;
+        event.subchannel_id = id;
+        event.slideshow = slideshow;
+        queue->Push(std::move(event));
+    });
+}
+
+void Basic_Radio_Event_Queue::AttachAudioChannel(Queue_Ref queue, const subchannel_id_t id, Basic_Audio_Channel& channel) {
+    // observers of audio buffers make on demand channels decode audio so only attach if it is wanted
+    if (queue->GetIsWanted(Basic_Radio_Event_Type::AUDIO_BUFFER)) {
+        channel.OnAudioBuffer().Attach([queue, id](const Basic_Audio_Buffer_Ref& buffer) {
+            Basic_Radio_Event event;
+            event.type = Basic_Radio_Event_Type::AUDIO_BUFFER;
+            event.subchannel_id = id;
+            event.audio_buffer = buffer;
+            queue->Push(std::move(event));
+        });
+    }
+
+    if (queue->GetIsWanted(Basic_Radio_Event_Type::DYNAMIC_LABEL)) {
+        channel.OnDynamicLabel().Attach([queue, id](const std::string_view& label) {
+            Basic_Radio_Event event;
+            event.type = Basic_Radio_Event_Type::DYNAMIC_LABEL;
+            event.subchannel_id = id;
+            event.label = std::string(label);
+            queue->Push(std::move(event));
+        });
+    }
+
+    if (queue->GetIsWanted(Basic_Radio_Event_Type::MOT_ENTITY)) {
+        channel.OnMOTEntity().Attach([queue, id](const MOT_Entity& entity) {
+            push_mot_entity(*queue, id, entity);
+        });
+    }
+
+    attach_slideshows(queue, id, channel.GetSlideshowManager());
+
+    if (channel.GetType() == AudioServiceType::DAB_PLUS) {
+        if (!queue->GetIsWanted(Basic_Radio_Event_Type::AAC_ACCESS_UNIT)) return;
+        auto& dab_plus_channel = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
+        dab_plus_channel.OnAACData().Attach([queue, id](
+            const SuperFrameHeader& header, const tcb::span<const uint8_t>& adts_header, const tcb::span<const uint8_t>& buf)
+        {
+            Basic_Radio_Event event;
+            event.type = Basic_Radio_Event_Type::AAC_ACCESS_UNIT;
+            event.subchannel_id = id;
+            event.superframe_header = header;
+            event.data = copy_to_pooled_buffer(adts_header, buf);
+            queue->Push(std::move(event));
+        });
+    } else {
+        if (!queue->GetIsWanted(Basic_Radio_Event_Type::MP2_FRAME)) return;
+        auto& dab_channel = dynamic_cast<Basic_DAB_Channel&>(channel);
+        dab_channel.OnMP2Data().Attach([queue, id](const tcb::span<const uint8_t>& buf) {
+            Basic_Radio_Event event;
+            event.type = Basic_Radio_Event_Type::MP2_FRAME;
+            event.subchannel_id = id;
+            event.data = copy_to_pooled_buffer({}, buf);
+            queue->Push(std::move(event));
+        });
+    }
+}
+
+void Basic_Radio_Event_Queue::AttachDataPacketChannel(Queue_Ref queue, const subchannel_id_t id, Basic_Data_Packet_Channel& channel) {
+    if (queue->GetIsWanted(Basic_Radio_Event_Type::MOT_ENTITY)) {
+        channel.OnMOTEntity().Attach([queue, id](const MOT_Entity& entity) {
+            push_mot_entity(*queue, id, entity);
+        });
+    }
+    attach_slideshows(queue, id, channel.GetSlideshowManager());
+}
+
+void Basic_Radio_Event_Queue::PushDatabaseChanges(
+    tcb::span<const DatabaseChange> changes, const std::shared_ptr<const DAB_Database>& database)
+{
+    if (!GetIsWanted(Basic_Radio_Event_Type::DATABASE_CHANGE)) return;
+    for (const auto& change: changes) {
+        Basic_Radio_Event event;
+        event.type = Basic_Radio_Event_Type::DATABASE_CHANGE;
+        event.database_change = change;
+        event.database = database;
+        Push(std::move(event));
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include "dab/audio/aac_frame_processor.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_updater.h"
+#include "dab/mot/MOT_entities.h"
+#include "utility/buffer_pool.h"
+#include "utility/mpsc_queue.h"
+#include "utility/span.h"
+#include "./basic_audio_buffer.h"
+
+struct DAB_Database;
+struct Basic_Slideshow;
+class Basic_Audio_Channel;
+class Basic_Data_Packet_Channel;
+
+enum class Basic_Radio_Event_Type: uint8_t {
+    // audio_buffer
+    AUDIO_BUFFER = 0,
+    // superframe_header and data which is an ADTS header followed by the access unit
+    AAC_ACCESS_UNIT,
+    // data
+    MP2_FRAME,
+    // label
+    DYNAMIC_LABEL,
+    // MOT entities that weren't slideshows with mot_transport_id, mot_header and data which is the body
+    MOT_ENTITY,
+    // slideshow
+    SLIDESHOW,
+    // database_change and database which is the snapshot it was made in
+    DATABASE_CHANGE,
+};
+
+// Output of the radio that is queued for a consumer instead of being handed to observers on the decoding threads
+// Only the fields listed for its type are set
+struct Basic_Radio_Event {
+    Basic_Radio_Event_Type type = Basic_Radio_Event_Type::AUDIO_BUFFER;
+    // 0 for database changes
+    subchannel_id_t subchannel_id = 0;
+    Basic_Audio_Buffer_Ref audio_buffer = nullptr;
+    SuperFrameHeader superframe_header;
+    Pooled_Buffer data;
+    std::string label;
+    mot_transport_id_t mot_transport_id = 0;
+    MOT_Header_Entity mot_header;
+    std::shared_ptr<Basic_Slideshow> slideshow = nullptr;
+    DatabaseChange database_change = { DatabaseEntityType::ENSEMBLE, DatabaseChangeType::CREATED, 0 };
+    std::shared_ptr<const DAB_Database> database = nullptr;
+};
+
+// Queue of events for one consumer that drains it in batches from its own thread
+// The decoding threads only push into the queue so the consumer's processing never holds them up
+// and the consumer doesn't need to synchronise with them, see BasicRadio::AddEventQueue()
+// If the consumer falls behind the newest events are dropped and counted
+class Basic_Radio_Event_Queue
+{
+public:
+    static constexpr size_t DEFAULT_MAX_EVENTS = 1024;
+    static constexpr uint32_t ALL_EVENTS = 0xFFFFFFFF;
+    static constexpr uint32_t GetTypeMask(const Basic_Radio_Event_Type type) { return uint32_t(1) << uint32_t(type); }
+private:
+    MPSC_Queue<Basic_Radio_Event> m_queue;
+    // only events in the mask are produced so channels don't decode audio that nobody reads
+    const uint32_t m_event_mask;
+public:
+    // event_mask is a combination of GetTypeMask() for each wanted type
+    explicit Basic_Radio_Event_Queue(const size_t max_events=DEFAULT_MAX_EVENTS, const uint32_t event_mask=ALL_EVENTS)
+    : m_queue(max_events), m_event_mask(event_mask) {}
+    bool GetIsWanted(const Basic_Radio_Event_Type type) const { return (m_event_mask & GetTypeMask(type)) != 0; }
+    uint32_t GetEventMask() const { return m_event_mask; }
+    size_t GetMaxEvents() const { return m_queue.get_total_slots(); }
+    uint64_t GetTotalDropped() const { return uint64_t(m_queue.get_total_dropped()); }
+    // Producer: called from any decoding thread
+    bool Push(Basic_Radio_Event&& event) { return m_queue.try_push(std::move(event)); }
+    // Consumer: only one thread can pop
+    bool Pop(Basic_Radio_Event& event) { return m_queue.try_pop(event); }
+    // Consumer: calls callback(Basic_Radio_Event&) for up to max_events and returns how many were drained
+    // The callback can move fields out of the event
+    template <typename F>
+    size_t Drain(F&& callback, const size_t max_events=SIZE_MAX) {
+        Basic_Radio_Event event;
+        size_t total_events = 0;
+        while ((total_events < max_events) && Pop(event)) {
+            callback(event);
+            total_events++;
+        }
+        return total_events;
+    }
+    // Called by BasicRadio from the thread that creates the channel
+    static void AttachAudioChannel(
+        std::shared_ptr<Basic_Radio_Event_Queue> queue, const subchannel_id_t id, Basic_Audio_Channel& channel);
+    static void AttachDataPacketChannel(
+        std::shared_ptr<Basic_Radio_Event_Queue> queue, const subchannel_id_t id, Basic_Data_Packet_Channel& channel);
+    void PushDatabaseChanges(tcb::span<const DatabaseChange> changes, const std::shared_ptr<const DAB_Database>& database);
+};
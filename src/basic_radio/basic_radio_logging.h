@@ -1,21 +1,70 @@
 #pragma once
 
+// Messages below BASIC_RADIO_LOG_LEVEL are stripped at compile time so their arguments are never evaluated
+// Messages that are compiled in are only formatted if the logger has the level enabled at runtime
+#define BASIC_RADIO_LOG_LEVEL_DEBUG 0
+#define BASIC_RADIO_LOG_LEVEL_INFO 1
+#define BASIC_RADIO_LOG_LEVEL_WARN 2
+#define BASIC_RADIO_LOG_LEVEL_ERROR 3
+#define BASIC_RADIO_LOG_LEVEL_NONE 4
+
+#ifndef BASIC_RADIO_LOG_LEVEL
+#define BASIC_RADIO_LOG_LEVEL BASIC_RADIO_LOG_LEVEL_INFO
+#endif
+
 #if BASIC_RADIO_LOGGING_USE_EASYLOGGING
 
 #include <easylogging++.h>
 #include <string>
 
 static const char* BASIC_RADIO_LOGGER = "basic-radio";
-static void BASIC_RADIO_LOG_MESSAGE(const std::string&& message) { CLOG(INFO, BASIC_RADIO_LOGGER) << message; }
-static void BASIC_RADIO_LOG_WARN(const std::string&& message) { CLOG(WARNING, BASIC_RADIO_LOGGER) << message; }
-static void BASIC_RADIO_LOG_ERROR(const std::string&& message) { CLOG(ERROR, BASIC_RADIO_LOGGER) << message; }
-static void BASIC_RADIO_SET_THREAD_NAME(const std::string&& name) { el::Helpers::setThreadName(name); }
+static inline bool BASIC_RADIO_LOG_IS_ENABLED(const el::Level level) {
+    auto* logger = el::Loggers::getLogger(BASIC_RADIO_LOGGER, false);
+    return (logger != nullptr) && logger->enabled(level);
+}
+#define BASIC_RADIO_LOG_IMPL(clog_level, level, message) \
+    do { if (BASIC_RADIO_LOG_IS_ENABLED(level)) { CLOG(clog_level, BASIC_RADIO_LOGGER) << (message); } } while (0)
+
+#if BASIC_RADIO_LOG_LEVEL <= BASIC_RADIO_LOG_LEVEL_DEBUG
+#define BASIC_RADIO_LOG_DEBUG(message) BASIC_RADIO_LOG_IMPL(DEBUG, el::Level::Debug, message)
+#endif
+#if BASIC_RADIO_LOG_LEVEL <= BASIC_RADIO_LOG_LEVEL_INFO
+#define BASIC_RADIO_LOG_MESSAGE(message) BASIC_RADIO_LOG_IMPL(INFO, el::Level::Info, message)
+#endif
+#if BASIC_RADIO_LOG_LEVEL <= BASIC_RADIO_LOG_LEVEL_WARN
+#define BASIC_RADIO_LOG_WARN(message) BASIC_RADIO_LOG_IMPL(WARNING, el::Level::Warning, message)
+#endif
+#if BASIC_RADIO_LOG_LEVEL <= BASIC_RADIO_LOG_LEVEL_ERROR
+#define BASIC_RADIO_LOG_ERROR(message) BASIC_RADIO_LOG_IMPL(ERROR, el::Level::Error, message)
+#endif
+
+// Pool workers run tasks from every channel so the name is only set when a worker switches to another one
+// NOTE: The name is compared by address so callers should pass storage that outlives the call
+static inline void BASIC_RADIO_SET_THREAD_NAME(const char* name) {
+    thread_local const char* curr_name = nullptr;
+    if (curr_name == name) return;
+    curr_name = name;
+    el::Helpers::setThreadName(name);
+}
 
 #else
 
-#define BASIC_RADIO_LOG_MESSAGE(message) (void)0
-#define BASIC_RADIO_LOG_WARN(message) (void)0
-#define BASIC_RADIO_LOG_ERROR(message) (void)0
 #define BASIC_RADIO_SET_THREAD_NAME(name) (void)0
 
 #endif
+
+// Stripped messages still reference their arguments so values only used for logging aren't unused
+// NOTE: The arguments are never evaluated
+#define BASIC_RADIO_LOG_STRIPPED(message) do { if (false) { (void)(message); } } while (0)
+#ifndef BASIC_RADIO_LOG_DEBUG
+#define BASIC_RADIO_LOG_DEBUG(message) BASIC_RADIO_LOG_STRIPPED(message)
+#endif
+#ifndef BASIC_RADIO_LOG_MESSAGE
+#define BASIC_RADIO_LOG_MESSAGE(message) BASIC_RADIO_LOG_STRIPPED(message)
+#endif
+#ifndef BASIC_RADIO_LOG_WARN
+#define BASIC_RADIO_LOG_WARN(message) BASIC_RADIO_LOG_STRIPPED(message)
+#endif
+#ifndef BASIC_RADIO_LOG_ERROR
+#define BASIC_RADIO_LOG_ERROR(message) BASIC_RADIO_LOG_STRIPPED(message)
+#endif
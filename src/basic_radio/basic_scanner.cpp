@@ -0,0 +1,96 @@
+#include "./basic_scanner.h"
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <fmt/format.h>
+#include "dab/constants/dab_parameters.h"
+#include "dab/database/dab_database.h"
+#include "dab/database/dab_database_entities.h"
+#include "dab/database/dab_database_updater.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./basic_fic_runner.h"
+#include "./basic_radio_logging.h"
+#define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
+#define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
+
+BasicScanner::BasicScanner(const DAB_Parameters& params, const size_t max_frames, const size_t min_stable_frames)
+: m_params(params), m_max_frames(max_frames), m_min_stable_frames(min_stable_frames)
+{
+    m_dab_database = std::make_unique<DAB_Database>();
+    m_dab_database_stats = std::make_unique<DatabaseUpdaterGlobalStatistics>();
+    Reset();
+}
+
+BasicScanner::~BasicScanner() = default;
+
+void BasicScanner::Reset() {
+    auto lock = std::scoped_lock(m_mutex_data);
+    m_fic_runner = std::make_unique<BasicFICRunner>(m_params);
+    m_dab_database->reset();
+    *m_dab_database_stats = DatabaseUpdaterGlobalStatistics{};
+    m_total_frames = 0;
+    m_total_stable_frames = 0;
+    m_status.store(Basic_Scan_Status::SCANNING, std::memory_order_release);
+}
+
+void BasicScanner::Process(tcb::span<const viterbi_bit_t> buf) {
+    if (IsFinished()) return;
+
+    const int N = (int)buf.size();
+    if ((N != m_params.nb_frame_bits) && (N != m_params.nb_fic_bits)) {
+        LOG_ERROR("Got incorrect number of frame bits {}/{}", N, m_params.nb_frame_bits);
+        return;
+    }
+
+    m_fic_runner->Process(buf.first(m_params.nb_fic_bits));
+    m_total_frames++;
+    const bool is_updated = UpdateDatabase();
+    m_total_stable_frames = is_updated ? 0 : (m_total_stable_frames+1);
+
+    auto lock = std::scoped_lock(m_mutex_data);
+    Basic_Scan_Status status = Basic_Scan_Status::SCANNING;
+    if (IsLabelsComplete() && (m_total_stable_frames >= m_min_stable_frames)) {
+        status = Basic_Scan_Status::COMPLETE;
+    } else if (m_total_frames >= m_max_frames) {
+        status = Basic_Scan_Status::TIMEOUT;
+    } else {
+        return;
+    }
+
+    if (status == Basic_Scan_Status::COMPLETE) {
+        LOG_MESSAGE("Scan completed after {} frames with {} services", m_total_frames, m_dab_database->services.size());
+    } else {
+        LOG_MESSAGE("Scan timed out after {} frames", m_total_frames);
+    }
+    m_status.store(status, std::memory_order_release);
+    m_obs_scan_finished.Notify(status, *m_dab_database);
+}
+
+bool BasicScanner::UpdateDatabase() {
+    const auto& dab_database_updater = m_fic_runner->GetDatabaseUpdater();
+    const auto& new_dab_database_stats = dab_database_updater.GetStatistics();
+    const bool is_updated = new_dab_database_stats != *m_dab_database_stats;
+    if (!is_updated) return false;
+
+    auto lock = std::scoped_lock(m_mutex_data);
+    *m_dab_database = dab_database_updater.GetDatabase();
+    *m_dab_database_stats = new_dab_database_stats;
+    return true;
+}
+
+bool BasicScanner::IsLabelsComplete() const {
+    const auto& ensemble = m_dab_database->ensemble;
+    if (!ensemble.is_complete || ensemble.label.empty()) return false;
+
+    // FIG 0/7 is optional but if it is sent we know how many services to expect
+    size_t total_services = 0;
+    for (const auto& service: m_dab_database->services) {
+        if (!service.is_complete) continue;
+        if (service.label.empty()) return false;
+        total_services++;
+    }
+    if (total_services == 0) return false;
+    if ((ensemble.nb_services > 0) && (total_services < size_t(ensemble.nb_services))) return false;
+    return true;
+}
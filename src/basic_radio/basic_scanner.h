@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "dab/constants/dab_parameters.h"
+#include "utility/observable.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+struct DAB_Database;
+struct DatabaseUpdaterGlobalStatistics;
+class BasicFICRunner;
+
+enum class Basic_Scan_Status {
+    SCANNING,
+    // ensemble and service labels were found
+    COMPLETE,
+    // labels weren't found before the frame limit
+    TIMEOUT,
+};
+
+// Finds the labels of an ensemble by only decoding the FIC
+// No subchannels are decoded so OFDM_Demod::SetTotalDataSymbols(nb_fic_symbols) can skip the MSC symbols
+class BasicScanner
+{
+private:
+    const DAB_Parameters m_params;
+    const size_t m_max_frames;
+    const size_t m_min_stable_frames;
+    std::unique_ptr<BasicFICRunner> m_fic_runner;
+    std::mutex m_mutex_data;
+    std::unique_ptr<DAB_Database> m_dab_database;
+    std::unique_ptr<DatabaseUpdaterGlobalStatistics> m_dab_database_stats;
+    size_t m_total_frames;
+    size_t m_total_stable_frames;
+    std::atomic<Basic_Scan_Status> m_status;
+    Observable<Basic_Scan_Status, const DAB_Database&> m_obs_scan_finished;
+public:
+    // Labels are complete when the ensemble and every service has one
+    // and the database hasn't changed for min_stable_frames so late services are also found
+    // The scan times out after max_frames
+    BasicScanner(const DAB_Parameters& params, const size_t max_frames, const size_t min_stable_frames);
+    ~BasicScanner();
+    BasicScanner(BasicScanner&) = delete;
+    BasicScanner(BasicScanner&&) = delete;
+    BasicScanner& operator=(BasicScanner&) = delete;
+    BasicScanner& operator=(BasicScanner&&) = delete;
+    // buf contains either a whole frame or only its FIC bits
+    // NOTE: Frames are ignored once the scan has finished until Reset() is called
+    void Process(tcb::span<const viterbi_bit_t> buf);
+    // Start a new scan with an empty database, e.g. after retuning
+    void Reset();
+    Basic_Scan_Status GetStatus() const { return m_status.load(std::memory_order_acquire); }
+    bool IsFinished() const { return GetStatus() != Basic_Scan_Status::SCANNING; }
+    size_t GetTotalFrames() const { return m_total_frames; }
+    auto& GetMutex() { return m_mutex_data; }
+    auto& GetDatabase() { return *(m_dab_database.get()); }
+    auto& GetDatabaseStatistics() { return *(m_dab_database_stats.get()); }
+    // Notified once from the thread calling Process() when the scan finishes
+    auto& On_Scan_Finished() { return m_obs_scan_finished; }
+private:
+    bool UpdateDatabase();
+    bool IsLabelsComplete() const;
+};
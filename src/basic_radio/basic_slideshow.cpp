@@ -1,15 +1,17 @@
 #include "./basic_slideshow.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <algorithm>
 #include <ctime>
-#include <iterator>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <fmt/format.h>
 #include "dab/constants/MOT_content_types.h"
 #include "dab/mot/MOT_entities.h"
 #include "dab/mot/MOT_slideshow_processor.h"
+#include "utility/span.h"
 #include "./basic_radio_logging.h"
 #define LOG_MESSAGE(...) BASIC_RADIO_LOG_MESSAGE(fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) BASIC_RADIO_LOG_ERROR(fmt::format(__VA_ARGS__))
@@ -25,8 +27,21 @@ static std::time_t Convert_MOT_Time(const MOT_UTC_Time& time) {
     return std::mktime(&t);
 }
 
-Basic_Slideshow_Manager::Basic_Slideshow_Manager(size_t max_slideshows) {
+// FNV-1a
+static uint64_t Get_Content_Hash(tcb::span<const uint8_t> data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const uint8_t x: data) {
+        hash = (hash ^ uint64_t(x)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+Basic_Slideshow_Manager::Basic_Slideshow_Manager(size_t max_slideshows, size_t max_bytes) {
+    m_total_bytes = 0;
     m_max_size = max_slideshows;
+    m_max_bytes = max_bytes;
+    m_snapshot = std::make_shared<const Basic_Slideshow_List>();
+    m_snapshot_version = 0;
 }
 
 std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::Process_MOT_Entity(MOT_Entity& entity) {
@@ -49,8 +64,30 @@ std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::Process_MOT_Entity(MOT
         return nullptr;
     }
 
+    // Broadcasters repeat the same slides so only the times of an existing slideshow are updated
+    const auto body = tcb::span<const uint8_t>(entity.body.data(), entity.body.size());
+    const uint64_t content_hash = Get_Content_Hash(body);
+    {
+        auto lock = std::unique_lock(m_mutex_writer);
+        auto duplicate = FindDuplicate(content_hash, body);
+        if (duplicate != nullptr) {
+            auto& expire_time = entity.header.expire_time;
+            if (expire_time.exists) {
+                duplicate->expire_time = Convert_MOT_Time(expire_time);
+            }
+            auto& trigger_time = entity.header.trigger_time;
+            if (trigger_time.exists) {
+                duplicate->trigger_time = Convert_MOT_Time(trigger_time);
+            }
+            PublishSnapshot();
+            LOG_MESSAGE("Refreshed slideshow tid={} name={}", duplicate->transport_id, duplicate->name);
+            return duplicate;
+        }
+    }
+
     // User application header extension parameters
     auto slideshow = std::make_shared<Basic_Slideshow>();
+    slideshow->content_hash = content_hash;
     slideshow->transport_id = entity.transport_id;
     slideshow->image_type = image_type;
 
@@ -59,9 +96,7 @@ std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::Process_MOT_Entity(MOT
         MOT_Slideshow_Processor::ProcessHeaderExtension(slideshow_header, p.type, p.data);
     }
 
-    const size_t total_bytes = entity.body_buf.size();
-    slideshow->image_data.resize(total_bytes);
-    std::copy_n(entity.body_buf.begin(), total_bytes, slideshow->image_data.begin());
+    slideshow->image_data = std::move(entity.body);
 
     // Core MOT header parameters
     auto& content_name = entity.header.content_name;
@@ -104,9 +139,11 @@ std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::Process_MOT_Entity(MOT
     }
  
     {
-        auto lock = std::unique_lock(m_mutex_slideshows);
-        m_slideshows.push_front(slideshow);
+        auto lock = std::unique_lock(m_mutex_writer);
+        m_slideshows.insert(m_slideshows.begin(), slideshow);
+        m_total_bytes += slideshow->image_data.size();
         RestrictSize();
+        PublishSnapshot();
     }
 
     LOG_MESSAGE("Added slideshow tid={} name={}", slideshow->transport_id, slideshow->name);
@@ -115,17 +152,54 @@ std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::Process_MOT_Entity(MOT
 }
 
 void Basic_Slideshow_Manager::SetMaxSize(const size_t max_size) {
-    auto lock = std::unique_lock(m_mutex_slideshows);
+    auto lock = std::unique_lock(m_mutex_writer);
     m_max_size = max_size;
     RestrictSize();
+    PublishSnapshot();
+}
+
+void Basic_Slideshow_Manager::SetMaxBytes(const size_t max_bytes) {
+    auto lock = std::unique_lock(m_mutex_writer);
+    m_max_bytes = max_bytes;
+    RestrictSize();
+    PublishSnapshot();
 }
 
+size_t Basic_Slideshow_Manager::GetTotalBytes(void) {
+    auto lock = std::unique_lock(m_mutex_writer);
+    return m_total_bytes;
+}
+
+// The oldest slideshows are dropped first
 void Basic_Slideshow_Manager::RestrictSize(void) {
-    if (m_slideshows.size() <= m_max_size) {
-        return;
+    const auto is_too_large = [this]() {
+        if (m_slideshows.size() > m_max_size) return true;
+        if (m_slideshows.size() <= 1) return false;
+        return (m_max_bytes != 0) && (m_total_bytes > m_max_bytes);
+    };
+    while (!m_slideshows.empty() && is_too_large()) {
+        m_total_bytes -= m_slideshows.back()->image_data.size();
+        m_slideshows.pop_back();
+    }
+}
+
+// Readers holding the previous snapshot keep its slideshows alive until they release it
+void Basic_Slideshow_Manager::PublishSnapshot(void) {
+    auto snapshot = std::make_shared<const Basic_Slideshow_List>(m_slideshows);
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Basic_Slideshow_List>(std::move(snapshot)));
+    m_snapshot_version.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<Basic_Slideshow> Basic_Slideshow_Manager::FindDuplicate(const uint64_t content_hash, tcb::span<const uint8_t> data) {
+    for (auto it = m_slideshows.begin(); it != m_slideshows.end(); it++) {
+        const auto& image = (*it)->image_data;
+        // compare the whole image so a hash collision can't hide a new slide
+        if ((*it)->content_hash != content_hash) continue;
+        if (image.size() != data.size()) continue;
+        if (!std::equal(data.begin(), data.end(), image.data())) continue;
+        // repeated slides are the most recent
+        std::rotate(m_slideshows.begin(), it, it+1);
+        return m_slideshows.front();
     }
-    auto start = m_slideshows.begin();
-    auto end = m_slideshows.end();
-    std::advance(start, m_max_size);
-    m_slideshows.erase(start, end);
-}
\ No newline at end of file
+    return nullptr;
+}
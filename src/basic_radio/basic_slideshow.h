@@ -1,15 +1,18 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 #include <string>
-#include <list>
 #include <vector>
 #include <memory>
 #include <ctime>
 #include <mutex>
 
 #include "dab/mot/MOT_entities.h"
+#include "utility/buffer_pool.h"
 #include "utility/observable.h"
+#include "utility/span.h"
 
 enum class Basic_Image_Type {
     NONE, JPEG, PNG
@@ -20,33 +23,58 @@ struct Basic_Slideshow {
     Basic_Image_Type image_type = Basic_Image_Type::NONE;
     uint8_t name_charset = 0;
     std::string name;
-    std::time_t trigger_time = 0;
-    std::time_t expire_time = 0;
+    // refreshed in place when the same image is broadcast again
+    std::atomic<std::time_t> trigger_time{0};
+    std::atomic<std::time_t> expire_time{0};
     uint8_t category_id = 0;
     uint8_t slide_id = 0; 
     std::string category_title = "";
     std::string click_through_url = "";
     std::string alt_location_url = "";
     bool is_emergency_alert = false;
-    std::vector<uint8_t> image_data;
+    uint64_t content_hash = 0;
+    Pooled_Buffer image_data;
 };
 
+// Most recent slideshow first
+using Basic_Slideshow_List = std::vector<std::shared_ptr<Basic_Slideshow>>;
+
+// Keeps the most recent slideshows up to a maximum count and total image size
+// Readers get an immutable snapshot of the list which is replaced as a whole when it changes
+// so they never lock anything and the decoder never waits for them
 class Basic_Slideshow_Manager 
 {
 private:
-    std::list<std::shared_ptr<Basic_Slideshow>> m_slideshows;
-    Observable<std::shared_ptr<Basic_Slideshow>> m_obs_on_new_slideshow;
+    // only changed by writers while holding m_mutex_writer
+    Basic_Slideshow_List m_slideshows;
+    size_t m_total_bytes;
     size_t m_max_size;
-    std::mutex m_mutex_slideshows;
+    size_t m_max_bytes;
+    std::mutex m_mutex_writer;
+    std::shared_ptr<const Basic_Slideshow_List> m_snapshot;
+    std::atomic<uint64_t> m_snapshot_version;
+    Ref_Observable<std::shared_ptr<Basic_Slideshow>> m_obs_on_new_slideshow;
 public:
-    explicit Basic_Slideshow_Manager(size_t max_slideshows=25);
+    // max_bytes=0 only limits the number of slideshows
+    explicit Basic_Slideshow_Manager(size_t max_slideshows=25, size_t max_bytes=8*1024*1024);
     // returns nullptr if MOT entity wasn't a slideshow
+    // if the image is already stored that slideshow is refreshed and returned without notifying
+    // otherwise the entity body is moved into the slideshow
     std::shared_ptr<Basic_Slideshow> Process_MOT_Entity(MOT_Entity& entity);
-    auto& GetSlideshowsMutex(void) { return m_mutex_slideshows; }
-    auto& GetSlideshows(void) { return m_slideshows; }
+    // Readers can keep a snapshot for as long as they want without holding up the decoder
+    std::shared_ptr<const Basic_Slideshow_List> GetSlideshows(void) const { return std::atomic_load(&m_snapshot); }
+    // Incremented each time a new snapshot is published so readers can skip rebuilding their views
+    uint64_t GetSlideshowsVersion(void) const { return m_snapshot_version.load(std::memory_order_acquire); }
     auto& OnNewSlideshow(void) { return m_obs_on_new_slideshow; }
     void SetMaxSize(const size_t max_size);
     size_t GetMaxSize(void) const { return m_max_size; };
+    // The newest slideshow is always kept even if it is larger than this
+    void SetMaxBytes(const size_t max_bytes);
+    size_t GetMaxBytes(void) const { return m_max_bytes; }
+    // Bytes of the images currently stored
+    size_t GetTotalBytes(void);
 private:
     void RestrictSize(void);
+    void PublishSnapshot(void);
+    std::shared_ptr<Basic_Slideshow> FindDuplicate(const uint64_t content_hash, tcb::span<const uint8_t> data);
 };
@@ -1,98 +1,412 @@
 #pragma once
 
-#include <functional>
-#include <mutex>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <thread>
-#include <queue>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <stddef.h>
+#include "utility/thread_affinity.h"
+#include "utility/thread_affinity_platform.h"
+
+// tasks of a higher priority are always taken before those of a lower priority
+// within a priority the oldest task submitted by a client is stolen first
+enum class BasicTaskPriority: uint8_t {
+    HIGH = 0,
+    NORMAL = 1,
+    LOW = 2,
+};
+
+// latch that counts the number of outstanding tasks that were pushed with it
+class BasicTaskGroup
+{
+private:
+    std::atomic<int> m_total_remaining{0};
+    // tasks finish under the mutex so that the group can't be destroyed by the waiter while in use
+    std::mutex m_mutex_done;
+    std::condition_variable m_cv_done;
+public:
+    BasicTaskGroup() = default;
+    BasicTaskGroup(BasicTaskGroup&) = delete;
+    BasicTaskGroup(BasicTaskGroup&&) = delete;
+    BasicTaskGroup& operator=(BasicTaskGroup&) = delete;
+    BasicTaskGroup& operator=(BasicTaskGroup&&) = delete;
+    bool IsDone() const { return m_total_remaining.load(std::memory_order_acquire) == 0; }
+    void Add(int total=1) { m_total_remaining.fetch_add(total, std::memory_order_relaxed); }
+    void Done() {
+        auto lock = std::scoped_lock(m_mutex_done);
+        if (m_total_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_cv_done.notify_all();
+        }
+    }
+    void WaitDone() {
+        auto lock = std::unique_lock(m_mutex_done);
+        m_cv_done.wait(lock, [this] { return IsDone(); });
+    }
+};
 
-// simple thread pool to decode FIC and MSC channels across all cores
-class BasicThreadPool 
+// fixed size task that stores its callable inline so pushing a task never allocates
+// NOTE: the callable must be trivially copyable since tasks are copied between worker deques
+class BasicTask
 {
+public:
+    static constexpr size_t MAX_STORAGE_BYTES = 48;
+private:
+    using Invoke = void (*)(void*);
+    Invoke m_invoke = nullptr;
+    BasicTaskGroup* m_group = nullptr;
+    // client of the pool whose CPU time this task is accounted to
+    uint32_t m_client = 0;
+    alignas(std::max_align_t) uint8_t m_storage[MAX_STORAGE_BYTES];
+public:
+    BasicTask() = default;
+    template <typename F>
+    BasicTask(BasicTaskGroup* group, const size_t client, F&& func) {
+        using Callable = std::decay_t<F>;
+        static_assert(std::is_trivially_copyable_v<Callable>, "Task callable must be trivially copyable");
+        static_assert(std::is_trivially_destructible_v<Callable>, "Task callable must be trivially destructible");
+        static_assert(sizeof(Callable) <= MAX_STORAGE_BYTES, "Task callable exceeds inline storage");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "Task callable is overaligned");
+        new (m_storage) Callable(std::forward<F>(func));
+        m_invoke = [](void* storage) {
+            (*std::launder(reinterpret_cast<Callable*>(storage)))();
+        };
+        m_group = group;
+        m_client = uint32_t(client);
+    }
+    size_t GetClient() const { return size_t(m_client); }
+    void Run() {
+        m_invoke(m_storage);
+        if (m_group != nullptr) m_group->Done();
+    }
+};
+
+// bounded Chase-Lev work stealing deque
+// DOC: "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Nardelli)
+// The owner pushes and takes from the bottom, other threads steal from the top
+class BasicTaskDeque
+{
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    const int64_t m_capacity;
+    const int64_t m_mask;
+    std::unique_ptr<BasicTask[]> m_buffer;
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_bottom{0};
+public:
+    // capacity must be a power of two
+    explicit BasicTaskDeque(size_t capacity)
+    : m_capacity(int64_t(capacity)), m_mask(int64_t(capacity)-1), m_buffer(std::make_unique<BasicTask[]>(capacity))
+    {
+        assert((capacity & (capacity-1)) == 0);
+    }
+    // owner only: returns false if the deque is full
+    bool Push(const BasicTask& task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t t = m_top.load(std::memory_order_acquire);
+        if ((b-t) >= m_capacity) {
+            return false;
+        }
+        std::memcpy(&m_buffer[size_t(b & m_mask)], &task, sizeof(BasicTask));
+        m_bottom.store(b+1, std::memory_order_release);
+        return true;
+    }
+    // owner only
+    bool Take(BasicTask& task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        if (t > b) {
+            m_bottom.store(b+1, std::memory_order_relaxed);
+            return false;
+        }
+        std::memcpy(&task, &m_buffer[size_t(b & m_mask)], sizeof(BasicTask));
+        if (t == b) {
+            // last element so we race with thieves
+            const bool is_taken = m_top.compare_exchange_strong(
+                t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(b+1, std::memory_order_relaxed);
+            return is_taken;
+        }
+        return true;
+    }
+    // any thread
+    bool Steal(BasicTask& task) {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = m_bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        std::memcpy(&task, &m_buffer[size_t(t & m_mask)], sizeof(BasicTask));
+        return m_top.compare_exchange_strong(
+            t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+// CPU time the workers of a thread pool spent on the tasks of one client
+// NOTE: Tasks run by the client's own thread while it waits aren't included
+//       Tasks run while a worker waits inside another task are accounted to the outer task
+struct BasicTaskAccount {
+    std::atomic<uint64_t> total_cpu_ns{0};
+    std::atomic<uint64_t> total_tasks{0};
+};
+
+// work stealing thread pool to decode FIC and MSC channels across all cores
+// Each worker owns a deque and steals from the others when it runs out of tasks
+// Tasks pushed from outside the pool go into the submission deque of a client which must only be used by one thread
+// Every deque is split into one lane per BasicTaskPriority and the lanes of a higher priority are searched first
+// NOTE: A pool can be shared by many radios with one client each
+//       Idle workers take from the client that has used the least CPU time so each gets a fair share
+class BasicThreadPool
+{
+public:
+    // Tasks pushed and waited on by this thread use the submission deque of the client until the scope ends
+    class ClientScope
+    {
+    private:
+        const BasicThreadPool* m_prev_pool;
+        size_t m_prev_deque_index;
+        size_t m_prev_client_index;
+    public:
+        ClientScope(BasicThreadPool& pool, const size_t client)
+        : m_prev_pool(m_thread_pool), m_prev_deque_index(m_thread_deque_index), m_prev_client_index(m_thread_client_index)
+        {
+            assert(client < pool.m_nb_clients);
+            m_thread_pool = &pool;
+            m_thread_deque_index = client;
+            m_thread_client_index = client;
+        }
+        ~ClientScope() {
+            m_thread_pool = m_prev_pool;
+            m_thread_deque_index = m_prev_deque_index;
+            m_thread_client_index = m_prev_client_index;
+        }
+        ClientScope(ClientScope&) = delete;
+        ClientScope(ClientScope&&) = delete;
+        ClientScope& operator=(ClientScope&) = delete;
+        ClientScope& operator=(ClientScope&&) = delete;
+    };
 private:
+    static constexpr size_t DEQUE_CAPACITY = 1024;
+    static constexpr int TOTAL_IDLE_SPINS = 64;
+    static constexpr size_t MAX_CLIENTS = 64;
+    static constexpr size_t TOTAL_PRIORITIES = 3;
     // threads
-    volatile bool m_is_running;
+    std::atomic<bool> m_is_running;
     size_t m_nb_threads;
     std::vector<std::thread> m_task_threads;
-    // tasks
-    using Task = std::function<void()>;
-    int m_total_tasks;
-    std::mutex m_mutex_total_tasks;
+    const Thread_Affinity m_thread_affinity;
+    std::atomic<int> m_total_affinity_errors{0};
+    // index i < nb_clients is the submission deque of client i, index nb_clients+i is owned by worker i
+    // each index has a lane for every priority (see GetDeque())
+    const size_t m_nb_clients;
+    size_t m_nb_deques;
+    std::vector<std::unique_ptr<BasicTaskDeque>> m_task_deques;
+    std::unique_ptr<BasicTaskAccount[]> m_client_accounts;
+    // parking of idle workers
+    std::atomic<int> m_total_pending;
+    std::atomic<int> m_total_sleeping;
+    std::mutex m_mutex_sleep;
     std::condition_variable m_cv_wait_task;
-    std::queue<Task> m_task_queue;
-    // wait all tasks
-    bool m_is_wait_all;
-    std::condition_variable m_cv_wait_done;
+    // group used by PushTask() without a group
+    BasicTaskGroup m_default_group;
+    // identifies the deque used by the current thread
+    inline static thread_local const BasicThreadPool* m_thread_pool = nullptr;
+    inline static thread_local size_t m_thread_deque_index = 0;
+    inline static thread_local size_t m_thread_client_index = 0;
 public:
-    explicit BasicThreadPool(size_t nb_threads=0) {
-        m_total_tasks = 0;
+    // each worker applies the affinity when it starts using its worker index
+    explicit BasicThreadPool(size_t nb_threads=0, const Thread_Affinity& thread_affinity={}, const size_t nb_clients=1)
+    : m_thread_affinity(thread_affinity), m_nb_clients(std::max(nb_clients, size_t(1)))
+    {
+        assert(m_nb_clients <= MAX_CLIENTS);
         m_is_running = true;
-        m_is_wait_all = false;
+        m_total_pending = 0;
+        m_total_sleeping = 0;
         m_nb_threads = nb_threads ? nb_threads : std::thread::hardware_concurrency();
+        if (m_nb_threads == 0) m_nb_threads = 1;
+
+        m_nb_deques = m_nb_clients+m_nb_threads;
+        m_task_deques.reserve(m_nb_deques*TOTAL_PRIORITIES);
+        for (size_t i = 0; i < (m_nb_deques*TOTAL_PRIORITIES); i++) {
+            m_task_deques.push_back(std::make_unique<BasicTaskDeque>(DEQUE_CAPACITY));
+        }
+        m_client_accounts = std::make_unique<BasicTaskAccount[]>(m_nb_clients);
 
         m_task_threads.reserve(m_nb_threads);
         for (size_t i = 0; i < m_nb_threads; i++) {
-            m_task_threads.emplace_back(&BasicThreadPool::RunnerThread, this);
+            m_task_threads.emplace_back(&BasicThreadPool::RunnerThread, this, m_nb_clients+i);
         }
     }
     ~BasicThreadPool() {
         StopAll();
     }
+    BasicThreadPool(BasicThreadPool&) = delete;
+    BasicThreadPool(BasicThreadPool&&) = delete;
+    BasicThreadPool& operator=(BasicThreadPool&) = delete;
+    BasicThreadPool& operator=(BasicThreadPool&&) = delete;
     size_t GetTotalThreads() const { return m_nb_threads; }
+    const Thread_Affinity& GetThreadAffinity() const { return m_thread_affinity; }
+    // number of workers whose affinity or priority couldn't be applied
+    int GetTotalAffinityErrors() const { return m_total_affinity_errors.load(std::memory_order_relaxed); }
+    size_t GetTotalClients() const { return m_nb_clients; }
+    const BasicTaskAccount& GetClientAccount(const size_t client) const { return m_client_accounts[client]; }
     void StopAll() {
         if (!m_is_running) {
             return;
         }
 
-        m_is_running = false;
+        {
+            auto lock = std::scoped_lock(m_mutex_sleep);
+            m_is_running = false;
+        }
         m_cv_wait_task.notify_all();
         for (auto& thread: m_task_threads) {
             thread.join();
         }
     }
-    void PushTask(const Task& task) {
-        auto lock = std::scoped_lock(m_mutex_total_tasks);
-        m_task_queue.push(task);
-        m_total_tasks++;
-        m_cv_wait_task.notify_one();
+    template <typename F>
+    void PushTask(BasicTaskGroup& group, const BasicTaskPriority priority, F&& func) {
+        group.Add();
+        const auto task = BasicTask(&group, GetThreadClientIndex(), std::forward<F>(func));
+        auto& deque = GetDeque(priority, GetThreadDequeIndex());
+        if (!deque.Push(task)) {
+            // run inline if we have too many outstanding tasks
+            auto inline_task = task;
+            RunTask(inline_task);
+            return;
+        }
+        m_total_pending.fetch_add(1, std::memory_order_seq_cst);
+        if (m_total_sleeping.load(std::memory_order_seq_cst) > 0) {
+            auto lock = std::scoped_lock(m_mutex_sleep);
+            m_cv_wait_task.notify_one();
+        }
     }
-    void WaitAll() {
-        m_is_wait_all = true;
-        auto lock = std::unique_lock(m_mutex_total_tasks);
-        if (m_total_tasks != 0) {
-            m_cv_wait_done.wait(lock, [this] {
-                return m_total_tasks == 0;
-            });
+    template <typename F>
+    void PushTask(BasicTaskGroup& group, F&& func) {
+        PushTask(group, BasicTaskPriority::NORMAL, std::forward<F>(func));
+    }
+    template <typename F>
+    void PushTask(F&& func) {
+        PushTask(m_default_group, std::forward<F>(func));
+    }
+    // calling thread helps run tasks until all tasks in the group are done
+    void Wait(BasicTaskGroup& group) {
+        const size_t index = GetThreadDequeIndex();
+        BasicTask task;
+        while (!group.IsDone()) {
+            if (!FindTask(index, task)) break;
+            RunTask(task);
         }
-        m_is_wait_all = false;
+        group.WaitDone();
+    }
+    void WaitAll() {
+        Wait(m_default_group);
     }
 private:
-    // thread waits for new tasks and runs them
-    void RunnerThread() {
+    BasicTaskDeque& GetDeque(const BasicTaskPriority priority, const size_t index) {
+        return *m_task_deques[size_t(priority)*m_nb_deques + index];
+    }
+    size_t GetThreadDequeIndex() const {
+        return (m_thread_pool == this) ? m_thread_deque_index : 0;
+    }
+    size_t GetThreadClientIndex() const {
+        return (m_thread_pool == this) ? m_thread_client_index : 0;
+    }
+    // tasks pushed while running a task belong to the same client
+    void RunTask(BasicTask& task) {
+        const size_t prev_client = m_thread_client_index;
+        m_thread_client_index = task.GetClient();
+        task.Run();
+        m_thread_client_index = prev_client;
+    }
+    void RunWorkerTask(BasicTask& task) {
+        const size_t client = task.GetClient();
+        const uint64_t cpu_start = get_thread_cpu_time_ns();
+        RunTask(task);
+        const uint64_t cpu_end = get_thread_cpu_time_ns();
+        auto& account = m_client_accounts[client];
+        account.total_cpu_ns.fetch_add(cpu_end-cpu_start, std::memory_order_relaxed);
+        account.total_tasks.fetch_add(1, std::memory_order_relaxed);
+    }
+    // visit the submission deques from the client that has used the least CPU time
+    // NOTE: This is approximate since the accounts are updated while we read them
+    bool StealFromClients(const BasicTaskPriority priority, BasicTask& task) {
+        uint64_t visited = 0;
+        for (size_t i = 0; i < m_nb_clients; i++) {
+            size_t best_client = 0;
+            uint64_t best_cpu_ns = UINT64_MAX;
+            for (size_t client = 0; client < m_nb_clients; client++) {
+                if (visited & (uint64_t(1) << client)) continue;
+                const uint64_t cpu_ns = m_client_accounts[client].total_cpu_ns.load(std::memory_order_relaxed);
+                if (cpu_ns < best_cpu_ns) {
+                    best_cpu_ns = cpu_ns;
+                    best_client = client;
+                }
+            }
+            visited |= (uint64_t(1) << best_client);
+            if (GetDeque(priority, best_client).Steal(task)) return true;
+        }
+        return false;
+    }
+    bool FindTask(const size_t index, BasicTask& task) {
+        bool is_found = false;
+        const size_t N = m_nb_deques;
+        for (size_t p = 0; (p < TOTAL_PRIORITIES) && !is_found; p++) {
+            const auto priority = BasicTaskPriority(p);
+            is_found = GetDeque(priority, index).Take(task);
+            if (!is_found && (m_nb_clients > 1)) {
+                is_found = StealFromClients(priority, task);
+            }
+            for (size_t i = 1; (i < N) && !is_found; i++) {
+                is_found = GetDeque(priority, (index+i) % N).Steal(task);
+            }
+        }
+        if (is_found) {
+            m_total_pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return is_found;
+    }
+    // thread runs its own tasks, steals from others, and parks when there is nothing left
+    void RunnerThread(const size_t index) {
+        m_thread_pool = this;
+        m_thread_deque_index = index;
+        if (!apply_thread_affinity(m_thread_affinity, index-m_nb_clients)) {
+            m_total_affinity_errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        BasicTask task;
+        int total_idle = 0;
         while (m_is_running) {
-            auto lock = std::unique_lock(m_mutex_total_tasks);
-            m_cv_wait_task.wait(lock, [this] {
-                return !m_task_queue.empty() || !m_is_running;
-            });
-
-            if (!m_is_running) {
-                break;
+            if (FindTask(index, task)) {
+                total_idle = 0;
+                RunWorkerTask(task);
+                continue;
             }
 
-            auto task = m_task_queue.front();
-            m_task_queue.pop();
-
-            lock.unlock();
-            task();
-
-            lock.lock();
-            m_total_tasks--;
-
-            if (m_is_wait_all) {
-                m_cv_wait_done.notify_one();
+            if (total_idle < TOTAL_IDLE_SPINS) {
+                total_idle++;
+                std::this_thread::yield();
+                continue;
             }
+
+            total_idle = 0;
+            auto lock = std::unique_lock(m_mutex_sleep);
+            m_total_sleeping.fetch_add(1, std::memory_order_seq_cst);
+            m_cv_wait_task.wait(lock, [this] {
+                return (m_total_pending.load(std::memory_order_seq_cst) > 0) || !m_is_running;
+            });
+            m_total_sleeping.fetch_sub(1, std::memory_order_seq_cst);
         }
     }
-};
\ No newline at end of file
+};
@@ -8,6 +8,7 @@
 #include <optional>
 #include <string>
 #include <fmt/format.h>
+#include "basic_radio/basic_audio_buffer.h"
 #include "basic_radio/basic_audio_channel.h"
 #include "basic_radio/basic_audio_params.h"
 #include "basic_radio/basic_dab_channel.h"
@@ -19,7 +20,9 @@
 #include "dab/database/dab_database.h"
 #include "dab/database/dab_database_entities.h"
 #include "dab/database/dab_database_types.h"
+#include "utility/buffer_pool.h"
 #include "utility/span.h"
+#include "./basic_scraper_writer.h"
 
 namespace fs = std::filesystem;
 
@@ -37,25 +40,27 @@ static std::string GetCurrentTime(void) {
         tm.tm_hour, tm.tm_min, tm.tm_sec);
 }
 
-static ServiceComponent* find_service_component(DAB_Database& db, subchannel_id_t id) {
-    ServiceComponent* component = nullptr;
-    for (auto& e: db.service_components) {
-        if (e.subchannel_id == id) {
-            component = &e;
-            break;
-        };
+void BasicScraper::SetIsArchive(const bool is_archive, const size_t max_segment_bytes) {
+    if (!is_archive) {
+        m_archive = nullptr;
+        return;
     }
-    return component;
+    const auto dir = fs::absolute(fs::path(m_root_directory) / "archive");
+    m_archive = std::make_shared<Basic_Scraper_Archive>(dir, max_segment_bytes);
 }
 
 void BasicScraper::attach_to_radio(std::shared_ptr<BasicScraper> scraper, BasicRadio& radio) {
     if (scraper == nullptr) return;
     auto root_directory = scraper->m_root_directory;
+    const bool is_encoded_only = scraper->m_is_encoded_only;
+    auto writer = scraper->m_writer;
+    auto archive = scraper->m_archive;
+    const auto rotation = scraper->m_rotation;
     radio.On_Audio_Channel().Attach(
-        [scraper, root_directory, &radio](subchannel_id_t id, Basic_Audio_Channel& channel) {
+        [scraper, root_directory, is_encoded_only, writer, archive, rotation, &radio](subchannel_id_t id, Basic_Audio_Channel& channel) {
             // determine root folder
             auto& db = radio.GetDatabase();
-            auto* component = find_service_component(db, id);
+            auto* component = db.GetServiceComponent_Subchannel(id);
             if (component == nullptr) return;
             const auto service_id = component->service_reference;
             const auto component_id = component->component_id;
@@ -64,16 +69,17 @@ void BasicScraper::attach_to_radio(std::shared_ptr<BasicScraper> scraper, BasicR
             auto base_path = fs::path(root_folder) / fs::path(child_folder);
             auto abs_path = fs::absolute(base_path);
 
-            auto dab_plus_scraper = std::make_shared<Basic_Audio_Channel_Scraper>(abs_path);
+            const Basic_Scraper_Archive_Source archive_source { archive, uint32_t(service_id), uint32_t(component_id) };
+            auto dab_plus_scraper = std::make_shared<Basic_Audio_Channel_Scraper>(writer, abs_path, is_encoded_only, archive_source, rotation);
             scraper->m_scrapers.push_back(dab_plus_scraper);
             Basic_Audio_Channel_Scraper::attach_to_channel(dab_plus_scraper, channel);
         }
     );
     radio.On_Data_Packet_Channel().Attach(
-        [scraper, root_directory, &radio](subchannel_id_t id, Basic_Data_Packet_Channel& channel) {
+        [root_directory, writer, archive, &radio](subchannel_id_t id, Basic_Data_Packet_Channel& channel) {
             // determine root folder
             auto& db = radio.GetDatabase();
-            auto* component = find_service_component(db, id);
+            auto* component = db.GetServiceComponent_Subchannel(id);
             if (component == nullptr) return;
             const auto service_id = component->service_reference;
             const auto component_id = component->component_id;
@@ -82,14 +88,15 @@ void BasicScraper::attach_to_radio(std::shared_ptr<BasicScraper> scraper, BasicR
             auto base_path = fs::path(root_folder) / fs::path(child_folder);
             auto abs_path = fs::absolute(base_path);
 
-            auto mot_scraper = std::make_shared<BasicMOTScraper>(abs_path / "MOT");
-            channel.OnMOTEntity().Attach([mot_scraper](MOT_Entity mot_entity) {
+            const Basic_Scraper_Archive_Source archive_source { archive, uint32_t(service_id), uint32_t(component_id) };
+            auto mot_scraper = std::make_shared<BasicMOTScraper>(writer, abs_path / "MOT", archive_source);
+            channel.OnMOTEntity().Attach([mot_scraper](const MOT_Entity& mot_entity) {
                 mot_scraper->OnMOTEntity(mot_entity);
             });
 
-            auto slideshow_scraper = std::make_shared<BasicSlideshowScraper>(abs_path / "slideshow");
+            auto slideshow_scraper = std::make_shared<BasicSlideshowScraper>(writer, abs_path / "slideshow", archive_source);
             channel.GetSlideshowManager().OnNewSlideshow().Attach(
-                [slideshow_scraper](std::shared_ptr<Basic_Slideshow> slideshow) {
+                [slideshow_scraper](const std::shared_ptr<Basic_Slideshow>& slideshow) {
                     slideshow_scraper->OnSlideshow(*slideshow);
                 }
             );
@@ -97,29 +104,36 @@ void BasicScraper::attach_to_radio(std::shared_ptr<BasicScraper> scraper, BasicR
     );
 }
 
-Basic_Audio_Channel_Scraper::Basic_Audio_Channel_Scraper(const fs::path& dir) 
+Basic_Audio_Channel_Scraper::Basic_Audio_Channel_Scraper(
+    std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& dir, const bool is_encoded_only,
+    const Basic_Scraper_Archive_Source& archive_source, const Basic_Scraper_Rotation_Settings& rotation) 
 : m_dir(dir), 
-  m_audio_scraper(dir / "audio"), 
-  m_slideshow_scraper(dir / "slideshow"),
-  m_mot_scraper(dir / "MOT")
+  m_writer(writer),
+  m_audio_scraper(writer, dir / "audio", rotation), 
+  m_slideshow_scraper(writer, dir / "slideshow", archive_source),
+  m_mot_scraper(writer, dir / "MOT", archive_source),
+  m_encoded_rotation(rotation),
+  m_is_encoded_only(is_encoded_only)
 {
     LOG_MESSAGE("[DAB+] Opened directory {}", m_dir.string());
 }
 
 void Basic_Audio_Channel_Scraper::attach_to_channel(std::shared_ptr<Basic_Audio_Channel_Scraper> scraper, Basic_Audio_Channel& channel) {
     if (scraper == nullptr) return;
-    channel.OnAudioData().Attach(
-        [scraper](BasicAudioParams params, tcb::span<const uint8_t> data) {
-            scraper->m_audio_scraper.OnAudioData(params, data);
-        }
-    );
+    if (!scraper->m_is_encoded_only) {
+        channel.OnAudioBuffer().Attach(
+            [scraper](const Basic_Audio_Buffer_Ref& buffer) {
+                scraper->m_audio_scraper.OnAudioBuffer(buffer);
+            }
+        );
+    }
     channel.GetSlideshowManager().OnNewSlideshow().Attach(
-        [scraper](std::shared_ptr<Basic_Slideshow> slideshow) {
+        [scraper](const std::shared_ptr<Basic_Slideshow>& slideshow) {
             scraper->m_slideshow_scraper.OnSlideshow(*slideshow);
         }
     );
     channel.OnMOTEntity().Attach(
-        [scraper](MOT_Entity mot) {
+        [scraper](const MOT_Entity& mot) {
             scraper->m_mot_scraper.OnMOTEntity(mot);
         }
     );
@@ -129,121 +143,107 @@ void Basic_Audio_Channel_Scraper::attach_to_channel(std::shared_ptr<Basic_Audio_
         auto& derived = dynamic_cast<Basic_DAB_Channel&>(channel);
         derived.OnMP2Data().Attach([scraper](tcb::span<const uint8_t> data) {
             auto& writer = scraper->m_audio_mp2_writer;
-            if (writer == nullptr) {
-                auto dir = scraper->m_dir / "mp2";
-                fs::create_directories(dir);
-                auto filepath = dir / fmt::format("{}_audio.mp2", GetCurrentTime());
-                auto filepath_str = filepath.string();
-                FILE* fp = fopen(filepath_str.c_str(), "wb+");
-                if (fp != nullptr) LOG_MESSAGE("[mp2] Opened file {}", filepath_str);
-                writer = std::make_unique<BasicBinaryWriter>(fp);
+            auto& rotation = scraper->m_encoded_rotation;
+            if ((writer == nullptr) || rotation.IsRotate(data.size())) {
+                auto filepath = scraper->m_dir / "mp2" / fmt::format("{}_audio.mp2", GetCurrentTime());
+                writer = std::make_unique<BasicBinaryWriter>(scraper->m_writer, filepath);
+                rotation.Start();
             }
             writer->Write(data);
+            rotation.Add(data.size());
         });
     } else if (ascty == AudioServiceType::DAB_PLUS) {
         auto& derived = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
         derived.OnAACData().Attach([scraper](auto superframe_header, auto mpeg4_header, auto buf) {
             auto& writer = scraper->m_audio_aac_writer;
             auto& old_header = scraper->m_old_aac_header;
-            if ((writer == nullptr) || (old_header != superframe_header)) {
-                auto dir = scraper->m_dir / "aac";
-                fs::create_directories(dir);
-                auto filepath = dir / fmt::format("{}_audio.aac", GetCurrentTime());
-                auto filepath_str = filepath.string();
-                FILE* fp = fopen(filepath_str.c_str(), "wb+");
-                if (fp != nullptr) LOG_MESSAGE("[aac] Opened file {}", filepath_str);
-                writer = std::make_unique<BasicBinaryWriter>(fp);
+            auto& rotation = scraper->m_encoded_rotation;
+            // each access unit has its own ADTS header so a file can be split at any of them
+            const size_t total_bytes = mpeg4_header.size() + buf.size();
+            if ((writer == nullptr) || (old_header != superframe_header) || rotation.IsRotate(total_bytes)) {
+                auto filepath = scraper->m_dir / "aac" / fmt::format("{}_audio.aac", GetCurrentTime());
+                writer = std::make_unique<BasicBinaryWriter>(scraper->m_writer, filepath);
                 old_header = superframe_header;
+                rotation.Start();
             }
-            writer->Write(mpeg4_header);
-            writer->Write(buf);
+            writer->Write(mpeg4_header, buf);
+            rotation.Add(total_bytes);
         });
     }
 
+    // NOTE: Slideshows and MOT still need the data decoder
+    //       For DAB this runs the MP2 decoder since it finds where the PAD starts
     auto& controls = channel.GetControls();
-    controls.SetIsDecodeAudio(true);
+    controls.SetIsEncodedAudio(true);
+    controls.SetIsDecodeAudio(!scraper->m_is_encoded_only);
     controls.SetIsDecodeData(true);
     controls.SetIsPlayAudio(false);
 }
 
+BasicBinaryWriter::BasicBinaryWriter(std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& path)
+: m_writer(std::move(writer)), m_file(std::make_shared<Basic_Scraper_File>(path))
+{}
+
 BasicBinaryWriter::~BasicBinaryWriter() {
-    if (m_fp != nullptr) {
-        fclose(m_fp);
-        m_fp = nullptr;
-    }
+    m_writer->Close(m_file);
 }
 
 void BasicBinaryWriter::Write(tcb::span<const uint8_t> data) {
-    if (m_fp != nullptr) {
-        fwrite(data.data(), sizeof(uint8_t), data.size(), m_fp);
-    }
+    m_writer->Append(m_file, data);
 }
 
-BasicAudioScraper::~BasicAudioScraper() {
-    if (m_fp_wav != nullptr) {
-        CloseWavFile(m_fp_wav, m_total_bytes_written);
-        m_fp_wav = nullptr;
-        m_total_bytes_written = 0;
-    }
+void BasicBinaryWriter::Write(tcb::span<const uint8_t> header, tcb::span<const uint8_t> data) {
+    auto buffer = Buffer_Pool::GetGlobal().Acquire(header.size() + data.size());
+    buffer.resize(header.size() + data.size());
+    std::memcpy(buffer.data(), header.data(), header.size());
+    std::memcpy(buffer.data() + header.size(), data.data(), data.size());
+    m_writer->Append(m_file, std::move(buffer));
 }
 
-void BasicAudioScraper::OnAudioData(BasicAudioParams params, tcb::span<const uint8_t> data) {
-    if (!m_old_params.has_value() || (m_old_params.value() != params)) {
-        if (m_fp_wav != nullptr) {
-            CloseWavFile(m_fp_wav, m_total_bytes_written);
-            m_fp_wav = nullptr;
-            m_total_bytes_written = 0;
-        }
+// Source: http://soundfile.sapp.org/doc/WaveFormat/
+struct WavHeader {
+    char     ChunkID[4];
+    int32_t  ChunkSize;
+    char     Format[4];
+    // Subchunk 1 = format information
+    char     Subchunk1ID[4];
+    int32_t  Subchunk1Size;
+    int16_t  AudioFormat;
+    int16_t  NumChannels;
+    int32_t  SampleRate;
+    int32_t  ByteRate;
+    int16_t  BlockAlign;
+    int16_t  BitsPerSample;
+    // Subchunk 2 = data 
+    char     Subchunk2ID[4];
+    int32_t  Subchunk2Size;
+};
+
+constexpr size_t WAV_HEADER_SIZE = sizeof(WavHeader);
+static_assert(WAV_HEADER_SIZE == 44, "Wav header must be packed");
 
-        m_fp_wav = CreateWavFile(params);
-        m_total_bytes_written = 0;
-        m_old_params = std::optional(params);
-    }
-
-    if (m_fp_wav == nullptr) {
-        return;
-    }
+BasicAudioScraper::~BasicAudioScraper() {
+    m_writer->Close(m_file_wav);
+}
 
-    const size_t N = data.size(); 
-    const size_t nb_written = fwrite(data.data(), sizeof(uint8_t), N, m_fp_wav);
-    if (nb_written != N) {
-        LOG_ERROR("[audio] Failed to write bytes {}/{}", nb_written, N);
+void BasicAudioScraper::OnAudioBuffer(const Basic_Audio_Buffer_Ref& buffer) {
+    const auto& params = buffer->params;
+    const auto data = buffer->GetData();
+    if (!m_old_params.has_value() || (m_old_params.value() != params) || m_rotation.IsRotate(data.size())) {
+        m_writer->Close(m_file_wav);
+        m_file_wav = CreateWavFile(params);
+        m_old_params = std::optional(params);
+        m_rotation.Start(WAV_HEADER_SIZE);
     }
-    m_total_bytes_written += (int)nb_written;
-    UpdateWavHeader(m_fp_wav, m_total_bytes_written);
+    m_writer->Append(m_file_wav, buffer, data);
+    m_rotation.Add(data.size());
 }
 
-FILE* BasicAudioScraper::CreateWavFile(BasicAudioParams params) {
-    fs::create_directories(m_dir);
+std::shared_ptr<Basic_Scraper_File> BasicAudioScraper::CreateWavFile(BasicAudioParams params) {
     auto filepath = m_dir / fmt::format("{}_audio.wav", GetCurrentTime());
-    auto filepath_str = filepath.string();
+    auto file = std::make_shared<Basic_Scraper_File>(filepath, &BasicAudioScraper::UpdateWavHeader);
 
-    FILE* fp = fopen(filepath_str.c_str(), "wb+");
-    if (fp == nullptr) {
-        LOG_ERROR("[audio] Failed to open file {}", filepath_str);
-        return fp;
-    }
-
-    LOG_MESSAGE("[audio] Opened file {}", filepath_str);
-
-    // Source: http://soundfile.sapp.org/doc/WaveFormat/
-    struct WavHeader {
-        char     ChunkID[4];
-        int32_t  ChunkSize;
-        char     Format[4];
-        // Subchunk 1 = format information
-        char     Subchunk1ID[4];
-        int32_t  Subchunk1Size;
-        int16_t  AudioFormat;
-        int16_t  NumChannels;
-        int32_t  SampleRate;
-        int32_t  ByteRate;
-        int16_t  BlockAlign;
-        int16_t  BitsPerSample;
-        // Subchunk 2 = data 
-        char     Subchunk2ID[4];
-        int32_t  Subchunk2Size;
-    } header;
+    WavHeader header;
 
     const int16_t NumChannels = params.is_stereo ? 2 : 1;
     const int32_t BitsPerSample = params.bytes_per_sample * 8;
@@ -262,17 +262,18 @@ FILE* BasicAudioScraper::CreateWavFile(BasicAudioParams params) {
     header.ByteRate = header.SampleRate * header.NumChannels * header.BitsPerSample / 8;
     header.BlockAlign = header.NumChannels * header.BitsPerSample / 8;
 
-    // We update these values when we close the file
+    // The writer only updates these values when it closes the file so the header isn't rewritten while recording
     header.Subchunk2Size = 0;
     header.ChunkSize = 36 + header.Subchunk2Size; 
 
-    fwrite(&header, sizeof(WavHeader), 1, fp);
-
-    return fp;
+    m_writer->Append(file, tcb::span(reinterpret_cast<const uint8_t*>(&header), sizeof(WavHeader)));
+    return file;
 }
 
-void BasicAudioScraper::UpdateWavHeader(FILE* fp, const int nb_data_bytes) {
-    const int32_t Subchunk2Size = nb_data_bytes;
+// Runs on the writer thread with the total bytes written including the header
+void BasicAudioScraper::UpdateWavHeader(FILE* fp, const size_t total_bytes) {
+    if (total_bytes < WAV_HEADER_SIZE) return;
+    const int32_t Subchunk2Size = int32_t(total_bytes - WAV_HEADER_SIZE);
     const int32_t ChunkSize = 36 + Subchunk2Size;
 
     // Source: http://soundfile.sapp.org/doc/WaveFormat/
@@ -287,34 +288,38 @@ void BasicAudioScraper::UpdateWavHeader(FILE* fp, const int nb_data_bytes) {
     fseek(fp, 0, SEEK_END);
 }
 
-void BasicAudioScraper::CloseWavFile(FILE* fp, const int nb_data_bytes) {
-    UpdateWavHeader(fp, nb_data_bytes);
-    fclose(fp);
-}
-
 void BasicSlideshowScraper::OnSlideshow(Basic_Slideshow& slideshow) {
-    fs::create_directories(m_dir);
     const auto id = slideshow.transport_id;
-    auto filepath = m_dir / fmt::format("{}_{}_{}", GetCurrentTime(), id, slideshow.name);
-    auto filepath_str = filepath.string();
-
-    FILE* fp = fopen(filepath_str.c_str(), "wb+");
-    if (fp == nullptr) {
-        LOG_ERROR("[slideshow] Failed to open file {}", filepath_str);
+    const size_t total_bytes = slideshow.image_data.size();
+    auto* written_bytes = m_written_images.find(slideshow.content_hash);
+    if ((written_bytes != nullptr) && (*written_bytes == total_bytes)) {
         return;
     }
-
-    const auto image_buffer = slideshow.image_data;
-    const size_t nb_written = fwrite(image_buffer.data(), sizeof(uint8_t), image_buffer.size(), fp);
-    if (nb_written != image_buffer.size()) {
-        LOG_ERROR("[slideshow] Failed to write bytes {}/{}", nb_written, image_buffer.size());
+    m_written_images.insert(slideshow.content_hash, size_t(total_bytes));
+
+    const auto& image_buffer = slideshow.image_data;
+    if (m_archive_source.archive != nullptr) {
+        Basic_Scraper_Archive_Entry entry;
+        entry.type = Basic_Scraper_Archive_Object_Type::SLIDESHOW;
+        entry.service_id = m_archive_source.service_id;
+        entry.component_id = m_archive_source.component_id;
+        entry.transport_id = id;
+        entry.timestamp = int64_t(std::time(nullptr));
+        entry.name = slideshow.name;
+        if (!m_writer->WriteArchive(m_archive_source.archive, std::move(entry), tcb::span(image_buffer.data(), image_buffer.size()))) {
+            LOG_ERROR("[slideshow] Dropped archived slideshow {} since the write queue is full", id);
+        }
+        return;
     }
-    fclose(fp);
 
-    LOG_MESSAGE("[slideshow] Wrote file {}", filepath_str);
+    auto filepath = m_dir / fmt::format("{}_{}_{}", GetCurrentTime(), id, slideshow.name);
+    // the slideshow is still shared with other listeners so its image is copied
+    if (!m_writer->WriteFile(filepath, tcb::span(image_buffer.data(), image_buffer.size()))) {
+        LOG_ERROR("[slideshow] Dropped file {} since the write queue is full", filepath.string());
+    }
 }
 
-void BasicMOTScraper::OnMOTEntity(MOT_Entity mot) {
+void BasicMOTScraper::OnMOTEntity(const MOT_Entity& mot) {
     auto& content_name_str = mot.header.content_name;
     std::string content_name;
     if (content_name_str.exists) {
@@ -325,23 +330,23 @@ void BasicMOTScraper::OnMOTEntity(MOT_Entity mot) {
             header.content_type, header.content_sub_type);
     }
 
-    fs::create_directories(m_dir);
-    auto filepath = m_dir / fmt::format("{}_{}_{}", GetCurrentTime(), mot.transport_id, content_name);
-    auto filepath_str = filepath.string();
-
-    FILE* fp = fopen(filepath_str.c_str(), "wb+");
-    if (fp == nullptr) {
-        LOG_ERROR("[MOT] Failed to open file {}", filepath_str);
+    const auto& body_buf = mot.body;
+    if (m_archive_source.archive != nullptr) {
+        Basic_Scraper_Archive_Entry entry;
+        entry.type = Basic_Scraper_Archive_Object_Type::MOT;
+        entry.service_id = m_archive_source.service_id;
+        entry.component_id = m_archive_source.component_id;
+        entry.transport_id = mot.transport_id;
+        entry.timestamp = int64_t(std::time(nullptr));
+        entry.name = std::move(content_name);
+        if (!m_writer->WriteArchive(m_archive_source.archive, std::move(entry), tcb::span(body_buf.data(), body_buf.size()))) {
+            LOG_ERROR("[MOT] Dropped archived object {} since the write queue is full", mot.transport_id);
+        }
         return;
     }
-    
-    auto body_buf = mot.body_buf;
 
-    const size_t nb_written = fwrite(body_buf.data(), sizeof(uint8_t), body_buf.size(), fp);
-    if (nb_written != body_buf.size()) {
-        LOG_ERROR("[MOT] Failed to write bytes {}/{}", nb_written, body_buf.size());
+    auto filepath = m_dir / fmt::format("{}_{}_{}", GetCurrentTime(), mot.transport_id, content_name);
+    if (!m_writer->WriteFile(filepath, tcb::span(body_buf.data(), body_buf.size()))) {
+        LOG_ERROR("[MOT] Dropped file {} since the write queue is full", filepath.string());
     }
-    fclose(fp);
-
-    LOG_MESSAGE("[MOT] Wrote file {}", filepath_str);
 }
\ No newline at end of file
@@ -1,15 +1,21 @@
 #pragma once
 #include <stdint.h>
 #include <stdio.h>
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
+#include "basic_radio/basic_audio_buffer.h"
 #include "basic_radio/basic_audio_params.h"
 #include "dab/audio/aac_frame_processor.h"
 #include "dab/mot/MOT_entities.h"
+#include "utility/lru_cache.h"
 #include "utility/span.h"
+#include "./basic_scraper_archive.h"
+#include "./basic_scraper_writer.h"
 
 namespace fs = std::filesystem;
 
@@ -19,79 +25,145 @@ namespace fs = std::filesystem;
 //   └─component_{id}
 //     ├─audio
 //     │ └─{date}_audio.wav
+//     ├─aac
+//     │ └─{date}_audio.aac
+//     ├─mp2
+//     │ └─{date}_audio.mp2
 //     ├─slideshow
 //     │ └─{date}_{transport_id}_{label}.{ext}
 //     └─MOT
 //       └─{date}_{transport_id}_{label}.{ext}
+// If an archive is set then slideshows and MOT objects are appended to root/archive instead
+// (see basic_scraper_archive.h) which avoids creating millions of small files on long runs
+// All files are written by a Basic_Scraper_Writer so the decoder threads never wait on the disk
 class BasicRadio;
 class Basic_Audio_Channel;
 struct Basic_Slideshow;
 
+// Long captures of audio are split into files by time and size
+struct Basic_Scraper_Rotation_Settings {
+    // files start on a multiple of the interval since the epoch so hourly files start on the hour (0 = never)
+    std::chrono::seconds interval = std::chrono::seconds(0);
+    // a file is closed before it grows past this (0 = never)
+    size_t max_bytes = 0;
+};
+
+class Basic_Scraper_Rotation
+{
+private:
+    const Basic_Scraper_Rotation_Settings m_settings;
+    std::time_t m_rotate_time = 0;
+    size_t m_total_bytes = 0;
+public:
+    explicit Basic_Scraper_Rotation(const Basic_Scraper_Rotation_Settings& settings={}): m_settings(settings) {}
+    // Returns true if the current file should be closed before the bytes are written to it
+    bool IsRotate(const size_t total_bytes) const {
+        const bool is_time = (m_settings.interval.count() > 0) && (std::time(nullptr) >= m_rotate_time);
+        const bool is_size = (m_settings.max_bytes > 0) && (m_total_bytes > 0) && (m_total_bytes + total_bytes > m_settings.max_bytes);
+        return is_time || is_size;
+    }
+    // Called when a new file is started with the size of its header
+    void Start(const size_t total_header_bytes=0) {
+        m_total_bytes = total_header_bytes;
+        const auto interval = std::time_t(m_settings.interval.count());
+        if (interval > 0) m_rotate_time = (std::time(nullptr) / interval + 1) * interval;
+    }
+    void Add(const size_t total_bytes) { m_total_bytes += total_bytes; }
+};
+
 class BasicAudioScraper 
 {
 private:
     std::optional<BasicAudioParams> m_old_params = std::nullopt;
-    FILE* m_fp_wav = nullptr;
-    int m_total_bytes_written = 0;
+    const std::shared_ptr<Basic_Scraper_Writer> m_writer;
+    std::shared_ptr<Basic_Scraper_File> m_file_wav;
     const fs::path m_dir;    
+    Basic_Scraper_Rotation m_rotation;
 public:
-    explicit BasicAudioScraper(const fs::path& dir): m_dir(dir) {}
+    BasicAudioScraper(std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& dir, const Basic_Scraper_Rotation_Settings& rotation={})
+    : m_writer(std::move(writer)), m_dir(dir), m_rotation(rotation) {}
     ~BasicAudioScraper();
     BasicAudioScraper(BasicAudioScraper&) = delete;
     BasicAudioScraper(BasicAudioScraper&&) = delete;
     BasicAudioScraper& operator=(BasicAudioScraper&) = delete;
     BasicAudioScraper& operator=(BasicAudioScraper&&) = delete;
-    void OnAudioData(BasicAudioParams params, tcb::span<const uint8_t> data);
+    // The buffer is queued for writing as is instead of being copied
+    void OnAudioBuffer(const Basic_Audio_Buffer_Ref& buffer);
 private:
-    FILE* CreateWavFile(BasicAudioParams params);
-    void UpdateWavHeader(FILE* fp, const int nb_data_bytes);
-    void CloseWavFile(FILE* fp, const int nb_data_bytes);
+    std::shared_ptr<Basic_Scraper_File> CreateWavFile(BasicAudioParams params);
+    static void UpdateWavHeader(FILE* fp, const size_t total_bytes);
+};
+
+// Service component that objects are archived under
+struct Basic_Scraper_Archive_Source {
+    std::shared_ptr<Basic_Scraper_Archive> archive = nullptr;
+    uint32_t service_id = 0;
+    uint32_t component_id = 0;
 };
 
+// Slides on a long loop can fall out of the slideshow manager and be seen again
+// so images already written are remembered by content hash and size
 class BasicSlideshowScraper
 {
 private:
+    static constexpr size_t MAX_WRITTEN_IMAGES = 256;
+    const std::shared_ptr<Basic_Scraper_Writer> m_writer;
     const fs::path m_dir;
+    const Basic_Scraper_Archive_Source m_archive_source;
+    LRU_Cache<uint64_t, size_t> m_written_images;
 public:
-    explicit BasicSlideshowScraper(const fs::path& dir): m_dir(dir) {}
+    BasicSlideshowScraper(std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& dir, Basic_Scraper_Archive_Source archive_source={})
+    : m_writer(std::move(writer)), m_dir(dir), m_archive_source(std::move(archive_source)), m_written_images(MAX_WRITTEN_IMAGES) {}
     void OnSlideshow(Basic_Slideshow& slideshow);
 };
 
 class BasicMOTScraper
 {
 private:
+    const std::shared_ptr<Basic_Scraper_Writer> m_writer;
     const fs::path m_dir;
+    const Basic_Scraper_Archive_Source m_archive_source;
 public:
-    explicit BasicMOTScraper(const fs::path& dir): m_dir(dir) {}
-    void OnMOTEntity(MOT_Entity mot);
+    BasicMOTScraper(std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& dir, Basic_Scraper_Archive_Source archive_source={})
+    : m_writer(std::move(writer)), m_dir(dir), m_archive_source(std::move(archive_source)) {}
+    void OnMOTEntity(const MOT_Entity& mot);
 };
 
 class BasicBinaryWriter
 {
 private:
-    FILE* m_fp = nullptr;
+    const std::shared_ptr<Basic_Scraper_Writer> m_writer;
+    const std::shared_ptr<Basic_Scraper_File> m_file;
 public:
-    explicit BasicBinaryWriter(FILE* fp): m_fp(fp) {}
+    BasicBinaryWriter(std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& path);
     ~BasicBinaryWriter();
     BasicBinaryWriter(BasicBinaryWriter&) = delete;
     BasicBinaryWriter(BasicBinaryWriter&&) = delete;
     BasicBinaryWriter& operator=(BasicBinaryWriter&) = delete;
     BasicBinaryWriter& operator=(BasicBinaryWriter&&) = delete;
     void Write(tcb::span<const uint8_t> data);
+    // Written together so a full queue never drops one without the other
+    void Write(tcb::span<const uint8_t> header, tcb::span<const uint8_t> data);
 };
 
 class Basic_Audio_Channel_Scraper
 {
 private:
     const fs::path m_dir;
+    const std::shared_ptr<Basic_Scraper_Writer> m_writer;
     BasicAudioScraper m_audio_scraper;
     BasicSlideshowScraper m_slideshow_scraper;
     BasicMOTScraper m_mot_scraper;
     std::unique_ptr<BasicBinaryWriter> m_audio_aac_writer;
     std::unique_ptr<BasicBinaryWriter> m_audio_mp2_writer;
+    Basic_Scraper_Rotation m_encoded_rotation;
     SuperFrameHeader m_old_aac_header;
+    // only store the encoded AAC/MP2 frames so the audio codec isn't run
+    const bool m_is_encoded_only;
 public:
-    explicit Basic_Audio_Channel_Scraper(const fs::path& dir);
+    Basic_Audio_Channel_Scraper(
+        std::shared_ptr<Basic_Scraper_Writer> writer, const fs::path& dir, const bool is_encoded_only=false,
+        const Basic_Scraper_Archive_Source& archive_source={}, const Basic_Scraper_Rotation_Settings& rotation={});
     static void attach_to_channel(std::shared_ptr<Basic_Audio_Channel_Scraper> scraper, Basic_Audio_Channel& channel);
 };
 
@@ -99,9 +171,27 @@ class BasicScraper
 {
 private:
     std::string m_root_directory;
+    const bool m_is_encoded_only;
+    std::shared_ptr<Basic_Scraper_Writer> m_writer;
+    std::shared_ptr<Basic_Scraper_Archive> m_archive;
+    Basic_Scraper_Rotation_Settings m_rotation;
     std::vector<std::shared_ptr<Basic_Audio_Channel_Scraper>> m_scrapers;
 public:
+    // Encoded only doesn't write the decoded wav file which avoids the audio codec entirely
     template <typename T>
-    explicit BasicScraper(T root_directory): m_root_directory(root_directory) {}
+    explicit BasicScraper(
+        T root_directory, const bool is_encoded_only=false, 
+        const Basic_Scraper_Writer_Settings& writer_settings={})
+    : m_root_directory(root_directory), m_is_encoded_only(is_encoded_only),
+      m_writer(std::make_shared<Basic_Scraper_Writer>(writer_settings)) {}
+    auto& GetWriter() { return *m_writer; }
+    // Slideshows and MOT objects are appended to root/archive instead of being written as separate files
+    // NOTE: This must be called before attach_to_radio()
+    void SetIsArchive(const bool is_archive, const size_t max_segment_bytes=Basic_Scraper_Archive::DEFAULT_MAX_SEGMENT_BYTES);
+    const auto& GetArchive() const { return m_archive; }
+    // Audio files of each channel are split by time or size instead of growing until the parameters change
+    // NOTE: This must be called before attach_to_radio()
+    void SetRotation(const Basic_Scraper_Rotation_Settings& rotation) { m_rotation = rotation; }
+    const auto& GetRotation() const { return m_rotation; }
     static void attach_to_radio(std::shared_ptr<BasicScraper> scraper, BasicRadio& radio);
 };
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "./basic_scraper_archive.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fmt/format.h>
+#include "utility/span.h"
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "./basic_scraper_logging.h"
+#define LOG_MESSAGE(...) BASIC_SCRAPER_LOG_MESSAGE(fmt::format(__VA_ARGS__))
+#define LOG_ERROR(...) BASIC_SCRAPER_LOG_ERROR(fmt::format(__VA_ARGS__))
+
+// Index record
+//  0: magic[4]
+//  4: version (u8)
+//  5: object type (u8)
+//  6: name length (u16)
+//  8: service id (u32)
+// 12: component id (u32)
+// 16: transport id (u16)
+// 18: reserved (u16)
+// 20: segment index (u32)
+// 24: offset into segment (u64)
+// 32: body size (u32)
+// 36: reserved (u32)
+// 40: content hash (u64)
+// 48: timestamp (i64)
+// 56: name
+constexpr char INDEX_MAGIC[4] = {'D','A','B','A'};
+constexpr uint8_t INDEX_VERSION = 1;
+constexpr size_t INDEX_HEADER_SIZE = 56;
+constexpr size_t MAX_NAME_LENGTH = 0xFFFF;
+
+template <typename T>
+static void put_le(uint8_t* buf, const T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = uint8_t(uint64_t(v) >> (8*i));
+    }
+}
+
+template <typename T>
+static T get_le(const uint8_t* buf) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= uint64_t(buf[i]) << (8*i);
+    }
+    return T(v);
+}
+
+static void sync_file(FILE* fp) {
+    if (fp == nullptr) return;
+    fflush(fp);
+#if _WIN32
+    _commit(_fileno(fp));
+#else
+    fsync(fileno(fp));
+#endif
+}
+
+Basic_Scraper_Archive::~Basic_Scraper_Archive() {
+    Close(false);
+}
+
+fs::path Basic_Scraper_Archive::GetIndexPath(const fs::path& dir) {
+    return dir / "index.dat";
+}
+
+fs::path Basic_Scraper_Archive::GetSegmentPath(const fs::path& dir, const uint32_t segment_index) {
+    return dir / fmt::format("segment_{:06}.dat", segment_index);
+}
+
+uint64_t Basic_Scraper_Archive::GetContentHash(tcb::span<const uint8_t> data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const uint8_t x: data) {
+        hash = (hash ^ uint64_t(x)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t Basic_Scraper_Archive::LoadIndex(const fs::path& dir, std::vector<Basic_Scraper_Archive_Entry>& entries) {
+    entries.clear();
+    const auto index_path = GetIndexPath(dir).string();
+    FILE* fp = fopen(index_path.c_str(), "rb");
+    if (fp == nullptr) return 0;
+    // segments are only appended to so a body past the end of its segment was lost in a crash
+    std::unordered_map<uint32_t, uint64_t> segment_sizes;
+    const auto get_segment_size = [&](const uint32_t segment_index) {
+        auto res = segment_sizes.find(segment_index);
+        if (res != segment_sizes.end()) return res->second;
+        std::error_code ec;
+        uint64_t size = uint64_t(fs::file_size(GetSegmentPath(dir, segment_index), ec));
+        if (ec) size = 0;
+        segment_sizes.insert({ segment_index, size });
+        return size;
+    };
+
+    uint64_t total_valid_bytes = 0;
+    uint8_t header[INDEX_HEADER_SIZE];
+    while (fread(header, 1, INDEX_HEADER_SIZE, fp) == INDEX_HEADER_SIZE) {
+        if ((std::memcmp(header, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) || (header[4] != INDEX_VERSION)) break;
+        Basic_Scraper_Archive_Entry entry;
+        entry.type = Basic_Scraper_Archive_Object_Type(header[5]);
+        const size_t name_length = get_le<uint16_t>(&header[6]);
+        entry.service_id = get_le<uint32_t>(&header[8]);
+        entry.component_id = get_le<uint32_t>(&header[12]);
+        entry.transport_id = get_le<uint16_t>(&header[16]);
+        entry.segment_index = get_le<uint32_t>(&header[20]);
+        entry.offset = get_le<uint64_t>(&header[24]);
+        entry.size = get_le<uint32_t>(&header[32]);
+        entry.content_hash = get_le<uint64_t>(&header[40]);
+        entry.timestamp = get_le<int64_t>(&header[48]);
+        entry.name.resize(name_length);
+        if ((name_length > 0) && (fread(entry.name.data(), 1, name_length, fp) != name_length)) break;
+        if (entry.offset + entry.size > get_segment_size(entry.segment_index)) break;
+        total_valid_bytes += INDEX_HEADER_SIZE + name_length;
+        entries.push_back(std::move(entry));
+    }
+    fclose(fp);
+    return total_valid_bytes;
+}
+
+bool Basic_Scraper_Archive::Open() {
+    if (m_fp_index != nullptr) return true;
+    // avoid retrying and logging on every object
+    if (m_is_open_failed) return false;
+
+    std::error_code ec;
+    fs::create_directories(m_dir, ec);
+    std::vector<Basic_Scraper_Archive_Entry> entries;
+    const uint64_t total_valid_bytes = LoadIndex(m_dir, entries);
+    const auto index_path = GetIndexPath(m_dir);
+    if (fs::exists(index_path, ec) && (fs::file_size(index_path, ec) != total_valid_bytes)) {
+        LOG_MESSAGE("[archive] Dropping partial index records after {} bytes in {}", total_valid_bytes, index_path.string());
+        fs::resize_file(index_path, total_valid_bytes, ec);
+    }
+
+    m_bodies.clear();
+    uint32_t last_segment_index = 0;
+    for (const auto& entry: entries) {
+        m_bodies.insert({ entry.content_hash, { entry.segment_index, entry.offset, entry.size } });
+        if (entry.segment_index > last_segment_index) last_segment_index = entry.segment_index;
+    }
+    m_total_objects = uint64_t(entries.size());
+
+    const auto index_path_str = index_path.string();
+    m_fp_index = fopen(index_path_str.c_str(), "ab");
+    if ((m_fp_index == nullptr) || !OpenSegment(last_segment_index)) {
+        LOG_ERROR("[archive] Failed to open archive {}", m_dir.string());
+        Close(false);
+        m_is_open_failed = true;
+        return false;
+    }
+    LOG_MESSAGE("[archive] Opened archive {} with {} objects", m_dir.string(), m_total_objects);
+    return true;
+}
+
+bool Basic_Scraper_Archive::OpenSegment(const uint32_t segment_index) {
+    if (m_fp_segment != nullptr) {
+        // a finished segment is never written again so it is synced straight away
+        sync_file(m_fp_segment);
+        fclose(m_fp_segment);
+        m_fp_segment = nullptr;
+    }
+    const auto path = GetSegmentPath(m_dir, segment_index).string();
+    m_fp_segment = fopen(path.c_str(), "ab");
+    if (m_fp_segment == nullptr) return false;
+    fseek(m_fp_segment, 0, SEEK_END);
+    const long size = ftell(m_fp_segment);
+    m_segment_index = segment_index;
+    m_segment_bytes = (size > 0) ? uint64_t(size) : 0;
+    return true;
+}
+
+bool Basic_Scraper_Archive::Append(Basic_Scraper_Archive_Entry& entry, tcb::span<const uint8_t> data) {
+    if (!Open()) return false;
+    if (data.size() > size_t(UINT32_MAX)) return false;
+
+    // a 64bit hash and the size are enough to tell bodies apart without reading back old segments
+    entry.content_hash = GetContentHash(data);
+    entry.size = uint32_t(data.size());
+    auto res = m_bodies.find(entry.content_hash);
+    const bool is_duplicate = (res != m_bodies.end()) && (res->second.size == entry.size);
+    if (is_duplicate) {
+        entry.segment_index = res->second.segment_index;
+        entry.offset = res->second.offset;
+        m_total_duplicates++;
+    } else {
+        if ((m_segment_bytes > 0) && (m_segment_bytes + data.size() > m_max_segment_bytes)) {
+            if (!OpenSegment(m_segment_index+1)) {
+                LOG_ERROR("[archive] Failed to open segment {} of {}", m_segment_index+1, m_dir.string());
+                return false;
+            }
+        }
+        const size_t nb_written = fwrite(data.data(), 1, data.size(), m_fp_segment);
+        // the space is still used so later bodies don't overlap this one
+        m_segment_bytes += nb_written;
+        if (nb_written != data.size()) {
+            LOG_ERROR("[archive] Failed to write bytes {}/{} to segment {}", nb_written, data.size(), m_segment_index);
+            return false;
+        }
+        entry.segment_index = m_segment_index;
+        entry.offset = m_segment_bytes - nb_written;
+        m_bodies.insert({ entry.content_hash, { entry.segment_index, entry.offset, entry.size } });
+    }
+
+    const size_t name_length = std::min(entry.name.size(), MAX_NAME_LENGTH);
+    uint8_t header[INDEX_HEADER_SIZE];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(&header[0], INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header[4] = INDEX_VERSION;
+    header[5] = uint8_t(entry.type);
+    put_le<uint16_t>(&header[6], uint16_t(name_length));
+    put_le<uint32_t>(&header[8], entry.service_id);
+    put_le<uint32_t>(&header[12], entry.component_id);
+    put_le<uint16_t>(&header[16], entry.transport_id);
+    put_le<uint32_t>(&header[20], entry.segment_index);
+    put_le<uint64_t>(&header[24], entry.offset);
+    put_le<uint32_t>(&header[32], entry.size);
+    put_le<uint64_t>(&header[40], entry.content_hash);
+    put_le<int64_t>(&header[48], entry.timestamp);
+    bool is_written = fwrite(header, 1, INDEX_HEADER_SIZE, m_fp_index) == INDEX_HEADER_SIZE;
+    is_written = is_written && (fwrite(entry.name.data(), 1, name_length, m_fp_index) == name_length);
+    if (!is_written) {
+        LOG_ERROR("[archive] Failed to write index record of {} to {}", entry.transport_id, m_dir.string());
+        return false;
+    }
+    m_total_objects++;
+    m_is_dirty = true;
+    return true;
+}
+
+void Basic_Scraper_Archive::Flush() {
+    if (!m_is_dirty) return;
+    if (m_fp_segment != nullptr) fflush(m_fp_segment);
+    if (m_fp_index != nullptr) fflush(m_fp_index);
+    m_is_dirty = false;
+}
+
+void Basic_Scraper_Archive::Sync() {
+    Flush();
+    sync_file(m_fp_segment);
+    sync_file(m_fp_index);
+}
+
+void Basic_Scraper_Archive::Close(const bool is_sync) {
+    if (is_sync) Sync();
+    else Flush();
+    if (m_fp_segment != nullptr) {
+        fclose(m_fp_segment);
+        m_fp_segment = nullptr;
+    }
+    if (m_fp_index != nullptr) {
+        fclose(m_fp_index);
+        m_fp_index = nullptr;
+        LOG_MESSAGE("[archive] Closed archive {} with {} objects ({} duplicates)", m_dir.string(), m_total_objects, m_total_duplicates);
+    }
+}
+
+bool Basic_Scraper_Archive_Reader::Open(const fs::path& dir) {
+    m_dir = dir;
+    Basic_Scraper_Archive::LoadIndex(m_dir, m_entries);
+    std::error_code ec;
+    return fs::exists(Basic_Scraper_Archive::GetIndexPath(m_dir), ec);
+}
+
+const Basic_Scraper_Archive_Entry* Basic_Scraper_Archive_Reader::FindLatest(
+    const Basic_Scraper_Archive_Object_Type type, const uint32_t service_id, const uint16_t transport_id) const
+{
+    for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+        if ((it->type == type) && (it->service_id == service_id) && (it->transport_id == transport_id)) return &(*it);
+    }
+    return nullptr;
+}
+
+bool Basic_Scraper_Archive_Reader::Read(const Basic_Scraper_Archive_Entry& entry, std::vector<uint8_t>& data) const {
+    const auto path = Basic_Scraper_Archive::GetSegmentPath(m_dir, entry.segment_index).string();
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) return false;
+    data.resize(entry.size);
+#if _WIN32
+    const bool is_seek = _fseeki64(fp, int64_t(entry.offset), SEEK_SET) == 0;
+#else
+    const bool is_seek = fseeko(fp, off_t(entry.offset), SEEK_SET) == 0;
+#endif
+    const bool is_read = is_seek && (fread(data.data(), 1, data.size(), fp) == data.size());
+    fclose(fp);
+    return is_read;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utility/span.h"
+
+namespace fs = std::filesystem;
+
+// Append only archive of scraped objects which replaces writing one small file per slideshow or MOT object
+// root
+// └─archive
+//   ├─index.dat           records of every object in the order they were scraped
+//   ├─segment_000000.dat  object bodies stored back to back
+//   └─segment_000001.dat  a new segment is started once the current one reaches its maximum size
+// Bodies that were already archived are only recorded in the index so repeated carousel objects cost no space
+// NOTE: All fields in the index are little endian
+
+enum class Basic_Scraper_Archive_Object_Type: uint8_t {
+    SLIDESHOW = 0, MOT = 1,
+};
+
+struct Basic_Scraper_Archive_Entry {
+    Basic_Scraper_Archive_Object_Type type = Basic_Scraper_Archive_Object_Type::MOT;
+    uint32_t service_id = 0;
+    uint32_t component_id = 0;
+    uint16_t transport_id = 0;
+    // unix time in seconds of when the object was scraped
+    int64_t timestamp = 0;
+    std::string name;
+    // filled in when the object is archived
+    uint64_t content_hash = 0;
+    uint32_t segment_index = 0;
+    uint64_t offset = 0;
+    uint32_t size = 0;
+};
+
+// Written to on the writer thread of a Basic_Scraper_Writer (see Basic_Scraper_Writer::WriteArchive())
+// NOTE: Only one writer can use an archive and one process can have the archive directory open for writing
+class Basic_Scraper_Archive
+{
+    friend class Basic_Scraper_Writer;
+public:
+    static constexpr size_t DEFAULT_MAX_SEGMENT_BYTES = size_t(256) << 20;
+private:
+    struct Location {
+        uint32_t segment_index;
+        uint64_t offset;
+        uint32_t size;
+    };
+    const fs::path m_dir;
+    const size_t m_max_segment_bytes;
+    FILE* m_fp_index = nullptr;
+    FILE* m_fp_segment = nullptr;
+    uint32_t m_segment_index = 0;
+    uint64_t m_segment_bytes = 0;
+    // bodies by content hash for deduplication
+    std::unordered_map<uint64_t, Location> m_bodies;
+    bool m_is_open_failed = false;
+    bool m_is_dirty = false;
+    uint64_t m_total_objects = 0;
+    uint64_t m_total_duplicates = 0;
+public:
+    explicit Basic_Scraper_Archive(const fs::path& dir, const size_t max_segment_bytes=DEFAULT_MAX_SEGMENT_BYTES)
+    : m_dir(dir), m_max_segment_bytes(max_segment_bytes) {}
+    ~Basic_Scraper_Archive();
+    Basic_Scraper_Archive(Basic_Scraper_Archive&) = delete;
+    Basic_Scraper_Archive(Basic_Scraper_Archive&&) = delete;
+    Basic_Scraper_Archive& operator=(Basic_Scraper_Archive&) = delete;
+    Basic_Scraper_Archive& operator=(Basic_Scraper_Archive&&) = delete;
+    const fs::path& GetPath() const { return m_dir; }
+    static fs::path GetIndexPath(const fs::path& dir);
+    static fs::path GetSegmentPath(const fs::path& dir, const uint32_t segment_index);
+    // Reads the index sequentially and stops at the first record that is incomplete or refers to a missing body
+    // which is where a crash stopped the archive. Returns the number of bytes of valid records
+    static uint64_t LoadIndex(const fs::path& dir, std::vector<Basic_Scraper_Archive_Entry>& entries);
+    static uint64_t GetContentHash(tcb::span<const uint8_t> data);
+private:
+    // Opens the archive for appending after dropping any partial records left by a crash
+    bool Open();
+    // Returns false if the object couldn't be written
+    bool Append(Basic_Scraper_Archive_Entry& entry, tcb::span<const uint8_t> data);
+    // Bodies are flushed before the index so a record never refers to a body that isn't written
+    void Flush();
+    void Sync();
+    void Close(const bool is_sync);
+    bool OpenSegment(const uint32_t segment_index);
+};
+
+// Looks up archived objects without going through the writer
+class Basic_Scraper_Archive_Reader
+{
+private:
+    fs::path m_dir;
+    std::vector<Basic_Scraper_Archive_Entry> m_entries;
+public:
+    bool Open(const fs::path& dir);
+    const auto& GetEntries() const { return m_entries; }
+    // Returns the most recently archived object with this transport id or nullptr
+    const Basic_Scraper_Archive_Entry* FindLatest(
+        const Basic_Scraper_Archive_Object_Type type, const uint32_t service_id, const uint16_t transport_id) const;
+    bool Read(const Basic_Scraper_Archive_Entry& entry, std::vector<uint8_t>& data) const;
+};
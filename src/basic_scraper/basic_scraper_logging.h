@@ -12,8 +12,11 @@ static void BASIC_SCRAPER_LOG_ERROR(const std::string&& message) { CLOG(ERROR, B
 
 #else
 
-#define BASIC_SCRAPER_LOG_MESSAGE(message) (void)0
-#define BASIC_SCRAPER_LOG_WARN(message) (void)0
-#define BASIC_SCRAPER_LOG_ERROR(message) (void)0
+// Disabled messages still reference their arguments so values only used for logging aren't unused
+// NOTE: The arguments are never evaluated
+#define BASIC_SCRAPER_LOG_STRIPPED(message) do { if (false) { (void)(message); } } while (0)
+#define BASIC_SCRAPER_LOG_MESSAGE(message) BASIC_SCRAPER_LOG_STRIPPED(message)
+#define BASIC_SCRAPER_LOG_WARN(message) BASIC_SCRAPER_LOG_STRIPPED(message)
+#define BASIC_SCRAPER_LOG_ERROR(message) BASIC_SCRAPER_LOG_STRIPPED(message)
 
 #endif
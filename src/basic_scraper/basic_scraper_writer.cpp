@@ -0,0 +1,412 @@
+#include "./basic_scraper_writer.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include "utility/buffer_pool.h"
+#include "utility/metrics.h"
+#include "utility/span.h"
+
+#if _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "./basic_scraper_logging.h"
+#define LOG_MESSAGE(...) BASIC_SCRAPER_LOG_MESSAGE(fmt::format(__VA_ARGS__))
+#define LOG_ERROR(...) BASIC_SCRAPER_LOG_ERROR(fmt::format(__VA_ARGS__))
+
+static Metrics_Counter& get_bytes_written_counter() {
+    static auto& counter = Metrics_Registry::Get().GetCounter(
+        "scraper_written_bytes_total", "Bytes written to disk by the scraper");
+    return counter;
+}
+
+static Metrics_Counter& get_bytes_dropped_counter() {
+    static auto& counter = Metrics_Registry::Get().GetCounter(
+        "scraper_dropped_bytes_total", "Bytes dropped by the scraper because the write queue was full");
+    return counter;
+}
+
+static Metrics_Counter& get_write_errors_counter() {
+    static auto& counter = Metrics_Registry::Get().GetCounter(
+        "scraper_write_errors_total", "Files the scraper failed to open or write");
+    return counter;
+}
+
+static Pooled_Buffer copy_to_pooled_buffer(tcb::span<const uint8_t> data) {
+    auto buffer = Buffer_Pool::GetGlobal().Acquire(data.size());
+    buffer.resize(data.size());
+    if (!data.empty()) std::memcpy(buffer.data(), data.data(), data.size());
+    return buffer;
+}
+
+Basic_Scraper_File::~Basic_Scraper_File() {
+    if (m_fp != nullptr) {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+}
+
+Basic_Scraper_Writer::Basic_Scraper_Writer(const Basic_Scraper_Writer_Settings& settings)
+: m_settings(settings)
+{
+    m_last_sync = std::chrono::steady_clock::now();
+    m_thread = std::thread([this]() { RunWriter(); });
+}
+
+Basic_Scraper_Writer::~Basic_Scraper_Writer() {
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        m_is_stop = true;
+    }
+    m_cv_job.notify_one();
+    m_cv_space.notify_all();
+    m_thread.join();
+}
+
+bool Basic_Scraper_Writer::Append(const std::shared_ptr<Basic_Scraper_File>& file, Pooled_Buffer&& data) {
+    if ((file == nullptr) || data.empty()) return true;
+    Job job;
+    job.type = Job_Type::APPEND;
+    job.file = file;
+    job.data = std::move(data);
+    return Push(std::move(job));
+}
+
+bool Basic_Scraper_Writer::Append(const std::shared_ptr<Basic_Scraper_File>& file, tcb::span<const uint8_t> data) {
+    if ((file == nullptr) || data.empty()) return true;
+    return Append(file, copy_to_pooled_buffer(data));
+}
+
+bool Basic_Scraper_Writer::Append(const std::shared_ptr<Basic_Scraper_File>& file, std::shared_ptr<const void> owner, tcb::span<const uint8_t> data) {
+    if ((file == nullptr) || data.empty()) return true;
+    Job job;
+    job.type = Job_Type::APPEND;
+    job.file = file;
+    job.shared_owner = std::move(owner);
+    job.shared_data = data;
+    return Push(std::move(job));
+}
+
+void Basic_Scraper_Writer::Close(const std::shared_ptr<Basic_Scraper_File>& file) {
+    if (file == nullptr) return;
+    Job job;
+    job.type = Job_Type::CLOSE;
+    job.file = file;
+    Push(std::move(job));
+}
+
+bool Basic_Scraper_Writer::WriteFile(const fs::path& path, Pooled_Buffer&& data) {
+    Job job;
+    job.type = Job_Type::WRITE_FILE;
+    job.path = path;
+    job.data = std::move(data);
+    return Push(std::move(job));
+}
+
+bool Basic_Scraper_Writer::WriteFile(const fs::path& path, tcb::span<const uint8_t> data) {
+    return WriteFile(path, copy_to_pooled_buffer(data));
+}
+
+bool Basic_Scraper_Writer::WriteArchive(
+    const std::shared_ptr<Basic_Scraper_Archive>& archive, Basic_Scraper_Archive_Entry&& entry, Pooled_Buffer&& data)
+{
+    if (archive == nullptr) return true;
+    Job job;
+    job.type = Job_Type::WRITE_ARCHIVE;
+    job.archive = archive;
+    job.archive_entry = std::move(entry);
+    job.data = std::move(data);
+    return Push(std::move(job));
+}
+
+bool Basic_Scraper_Writer::WriteArchive(
+    const std::shared_ptr<Basic_Scraper_Archive>& archive, Basic_Scraper_Archive_Entry&& entry, tcb::span<const uint8_t> data)
+{
+    return WriteArchive(archive, std::move(entry), copy_to_pooled_buffer(data));
+}
+
+void Basic_Scraper_Writer::Flush() {
+    auto lock = std::unique_lock(m_mutex);
+    m_cv_space.wait(lock, [this]() {
+        return (m_jobs.empty() && !m_is_busy) || m_is_stop;
+    });
+}
+
+Basic_Scraper_Writer_Statistics Basic_Scraper_Writer::GetStatistics() {
+    Basic_Scraper_Writer_Statistics stats;
+    stats.total_jobs = m_total_jobs.load(std::memory_order_relaxed);
+    stats.total_bytes_written = m_total_bytes_written.load(std::memory_order_relaxed);
+    stats.total_jobs_dropped = m_total_jobs_dropped.load(std::memory_order_relaxed);
+    stats.total_bytes_dropped = m_total_bytes_dropped.load(std::memory_order_relaxed);
+    stats.total_write_errors = m_total_write_errors.load(std::memory_order_relaxed);
+    stats.max_queued_bytes = m_max_queued_bytes.load(std::memory_order_relaxed);
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        stats.queued_bytes = m_queued_bytes;
+    }
+    return stats;
+}
+
+bool Basic_Scraper_Writer::Push(Job&& job) {
+    const size_t total_bytes = job.GetData().size();
+    {
+        auto lock = std::unique_lock(m_mutex);
+        // a job larger than the whole queue is still let through once the queue is empty
+        const auto is_space = [this, total_bytes]() {
+            return (m_queued_bytes == 0) || (m_queued_bytes + total_bytes <= m_settings.max_queued_bytes);
+        };
+        // closing a file carries no data and must always reach the writer
+        if ((job.type != Job_Type::CLOSE) && !is_space()) {
+            if (m_settings.overflow_policy == Scraper_Overflow_Policy::DROP) {
+                lock.unlock();
+                m_total_jobs_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_total_bytes_dropped.fetch_add(total_bytes, std::memory_order_relaxed);
+                get_bytes_dropped_counter().Add(total_bytes);
+                return false;
+            }
+            m_cv_space.wait(lock, [this, &is_space]() { return is_space() || m_is_stop; });
+        }
+        m_queued_bytes += total_bytes;
+        m_jobs.push_back(std::move(job));
+        if (m_queued_bytes > m_max_queued_bytes.load(std::memory_order_relaxed)) {
+            m_max_queued_bytes.store(m_queued_bytes, std::memory_order_relaxed);
+        }
+    }
+    m_total_jobs.fetch_add(1, std::memory_order_relaxed);
+    m_cv_job.notify_one();
+    return true;
+}
+
+void Basic_Scraper_Writer::RunWriter() {
+    while (true) {
+        size_t total_batch_bytes = 0;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            // wake up periodically even without jobs so open files are still synced
+            m_cv_job.wait_for(lock, m_settings.sync_interval, [this]() {
+                return !m_jobs.empty() || m_is_stop;
+            });
+            if (m_jobs.empty() && m_is_stop) break;
+            // take the whole queue so the lock isn't held while writing
+            std::swap(m_batch, m_jobs);
+            m_is_busy = !m_batch.empty();
+            for (const auto& job: m_batch) total_batch_bytes += job.GetData().size();
+        }
+
+        if (!m_batch.empty()) {
+            METRICS_TIME_SCOPE("scraper_write_batch_seconds", "Time spent writing a batch of queued scraper jobs");
+            for (auto& job: m_batch) {
+                ProcessJob(job);
+            }
+            // archived objects become visible to readers once per batch
+            for (auto& archive: m_open_archives) {
+                archive->Flush();
+            }
+            m_batch.clear();
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if ((m_settings.sync_policy != Scraper_Sync_Policy::NONE) && (now - m_last_sync >= m_settings.sync_interval)) {
+            if (m_settings.sync_policy == Scraper_Sync_Policy::PERIODIC) {
+                for (auto& file: m_open_files) {
+                    SyncFile(file->m_fp);
+                }
+            }
+            // archives replace many small files that would each be synced on close with one sync per interval
+            for (auto& archive: m_open_archives) {
+                archive->Sync();
+            }
+            m_last_sync = now;
+        }
+
+        {
+            auto lock = std::scoped_lock(m_mutex);
+            m_queued_bytes -= total_batch_bytes;
+            m_is_busy = false;
+        }
+        m_cv_space.notify_all();
+    }
+
+    for (auto& file: m_open_files) {
+        CloseFile(*file);
+    }
+    m_open_files.clear();
+    for (auto& archive: m_open_archives) {
+        archive->Close(m_settings.sync_policy != Scraper_Sync_Policy::NONE);
+    }
+    m_open_archives.clear();
+}
+
+void Basic_Scraper_Writer::ProcessJob(Job& job) {
+    switch (job.type) {
+    case Job_Type::APPEND:
+        {
+            if (!OpenFile(job.file)) break;
+            auto& file = *job.file;
+            const auto data = job.GetData();
+            const size_t nb_written = fwrite(data.data(), sizeof(uint8_t), data.size(), file.m_fp);
+            if (nb_written != data.size()) {
+                LOG_ERROR("[writer] Failed to write bytes {}/{} to {}", nb_written, data.size(), file.m_path.string());
+                m_total_write_errors.fetch_add(1, std::memory_order_relaxed);
+                get_write_errors_counter().Add();
+            }
+            file.m_total_bytes += nb_written;
+            PreallocateFile(file);
+            m_total_bytes_written.fetch_add(nb_written, std::memory_order_relaxed);
+            get_bytes_written_counter().Add(nb_written);
+        }
+        break;
+    case Job_Type::CLOSE:
+        {
+            auto it = std::find(m_open_files.begin(), m_open_files.end(), job.file);
+            if (it != m_open_files.end()) m_open_files.erase(it);
+            CloseFile(*job.file);
+        }
+        break;
+    case Job_Type::WRITE_FILE:
+        {
+            const auto path_str = job.path.string();
+            std::error_code ec;
+            fs::create_directories(job.path.parent_path(), ec);
+            FILE* fp = fopen(path_str.c_str(), "wb+");
+            if (fp == nullptr) {
+                LOG_ERROR("[writer] Failed to open file {}", path_str);
+                m_total_write_errors.fetch_add(1, std::memory_order_relaxed);
+                get_write_errors_counter().Add();
+                break;
+            }
+            const size_t nb_written = fwrite(job.data.data(), sizeof(uint8_t), job.data.size(), fp);
+            if (nb_written != job.data.size()) {
+                LOG_ERROR("[writer] Failed to write bytes {}/{} to {}", nb_written, job.data.size(), path_str);
+                m_total_write_errors.fetch_add(1, std::memory_order_relaxed);
+                get_write_errors_counter().Add();
+            }
+            if (m_settings.sync_policy != Scraper_Sync_Policy::NONE) SyncFile(fp);
+            fclose(fp);
+            m_total_bytes_written.fetch_add(nb_written, std::memory_order_relaxed);
+            get_bytes_written_counter().Add(nb_written);
+            LOG_MESSAGE("[writer] Wrote file {}", path_str);
+        }
+        break;
+    case Job_Type::WRITE_ARCHIVE:
+        {
+            auto& archive = job.archive;
+            if (std::find(m_open_archives.begin(), m_open_archives.end(), archive) == m_open_archives.end()) {
+                m_open_archives.push_back(archive);
+            }
+            if (!archive->Append(job.archive_entry, { job.data.data(), job.data.size() })) {
+                m_total_write_errors.fetch_add(1, std::memory_order_relaxed);
+                get_write_errors_counter().Add();
+                break;
+            }
+            m_total_bytes_written.fetch_add(job.data.size(), std::memory_order_relaxed);
+            get_bytes_written_counter().Add(job.data.size());
+        }
+        break;
+    }
+    // release the buffer back to its pool straight away
+    job.data.Reset();
+    job.shared_owner = nullptr;
+    job.file = nullptr;
+    job.archive = nullptr;
+}
+
+bool Basic_Scraper_Writer::OpenFile(const std::shared_ptr<Basic_Scraper_File>& file_ptr) {
+    auto& file = *file_ptr;
+    if (file.m_fp != nullptr) return true;
+    // avoid retrying and logging on every append
+    if (file.m_is_open_failed) return false;
+
+    const auto path_str = file.m_path.string();
+    std::error_code ec;
+    fs::create_directories(file.m_path.parent_path(), ec);
+    file.m_fp = fopen(path_str.c_str(), "wb+");
+    if (file.m_fp == nullptr) {
+        LOG_ERROR("[writer] Failed to open file {}", path_str);
+        file.m_is_open_failed = true;
+        m_total_write_errors.fetch_add(1, std::memory_order_relaxed);
+        get_write_errors_counter().Add();
+        return false;
+    }
+    if (m_settings.file_buffer_size > 0) {
+        constexpr size_t PAGE_SIZE = 4096;
+        file.m_file_buffer = std::vector<char, AlignedAllocator<char>>(AlignedAllocator<char>(PAGE_SIZE));
+        file.m_file_buffer.resize((m_settings.file_buffer_size + PAGE_SIZE-1) / PAGE_SIZE * PAGE_SIZE);
+        setvbuf(file.m_fp, file.m_file_buffer.data(), _IOFBF, file.m_file_buffer.size());
+    }
+    LOG_MESSAGE("[writer] Opened file {}", path_str);
+    m_open_files.push_back(file_ptr);
+    return true;
+}
+
+void Basic_Scraper_Writer::CloseFile(Basic_Scraper_File& file) {
+    if (file.m_fp == nullptr) return;
+    if (file.m_header_updater) file.m_header_updater(file.m_fp, file.m_total_bytes);
+    ReleasePreallocation(file);
+    if (m_settings.sync_policy != Scraper_Sync_Policy::NONE) SyncFile(file.m_fp);
+    fclose(file.m_fp);
+    file.m_fp = nullptr;
+    LOG_MESSAGE("[writer] Closed file {}", file.m_path.string());
+}
+
+void Basic_Scraper_Writer::PreallocateFile(Basic_Scraper_File& file) {
+#if defined(__linux__)
+    const size_t chunk_bytes = m_settings.preallocate_bytes;
+    if ((chunk_bytes == 0) || (file.m_total_bytes < file.m_preallocated_bytes)) return;
+    // the file size is kept so readers and the header updater see the real length
+    const size_t target_bytes = (file.m_total_bytes / chunk_bytes + 1) * chunk_bytes;
+    if (fallocate(fileno(file.m_fp), FALLOC_FL_KEEP_SIZE, 0, off_t(target_bytes)) != 0) {
+        // the filesystem doesn't support it so don't try again
+        file.m_preallocated_bytes = SIZE_MAX;
+        return;
+    }
+    file.m_preallocated_bytes = target_bytes;
+#else
+    (void)file;
+#endif
+}
+
+void Basic_Scraper_Writer::ReleasePreallocation(Basic_Scraper_File& file) {
+#if defined(__linux__)
+    if ((file.m_preallocated_bytes == 0) || (file.m_preallocated_bytes == SIZE_MAX)) return;
+    // blocks reserved past the end of the file are freed by truncating it to its own size
+    fflush(file.m_fp);
+    const int fd = fileno(file.m_fp);
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        if (ftruncate(fd, st.st_size) != 0) {
+            LOG_ERROR("[writer] Failed to release preallocated space of {}", file.m_path.string());
+        }
+    }
+    file.m_preallocated_bytes = 0;
+#else
+    (void)file;
+#endif
+}
+
+void Basic_Scraper_Writer::SyncFile(FILE* fp) {
+    if (fp == nullptr) return;
+    fflush(fp);
+#if _WIN32
+    _commit(_fileno(fp));
+#else
+    fsync(fileno(fp));
+#endif
+}
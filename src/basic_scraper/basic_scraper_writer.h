@@ -0,0 +1,159 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utility/aligned_allocator.hpp"
+#include "utility/buffer_pool.h"
+#include "utility/span.h"
+#include "./basic_scraper_archive.h"
+
+namespace fs = std::filesystem;
+
+// File which is appended to by the scrapers and opened, written and closed on the writer thread
+// NOTE: Everything except the path is only accessed by the writer thread
+class Basic_Scraper_File
+{
+    friend class Basic_Scraper_Writer;
+public:
+    // Called once before closing, e.g. to patch the sizes in a wav header
+    using Header_Updater = std::function<void(FILE* fp, const size_t total_bytes)>;
+private:
+    const fs::path m_path;
+    const Header_Updater m_header_updater;
+    FILE* m_fp = nullptr;
+    std::vector<char, AlignedAllocator<char>> m_file_buffer;
+    size_t m_total_bytes = 0;
+    // disk space reserved ahead of the end of the file
+    size_t m_preallocated_bytes = 0;
+    bool m_is_open_failed = false;
+public:
+    explicit Basic_Scraper_File(const fs::path& path, Header_Updater header_updater=nullptr)
+    : m_path(path), m_header_updater(std::move(header_updater)) {}
+    ~Basic_Scraper_File();
+    Basic_Scraper_File(Basic_Scraper_File&) = delete;
+    Basic_Scraper_File(Basic_Scraper_File&&) = delete;
+    Basic_Scraper_File& operator=(Basic_Scraper_File&) = delete;
+    Basic_Scraper_File& operator=(Basic_Scraper_File&&) = delete;
+    const fs::path& GetPath() const { return m_path; }
+};
+
+enum class Scraper_Overflow_Policy {
+    DROP,       // writes that don't fit in the queue are dropped so decoding never stalls
+    BLOCK,      // decoder threads wait for the queue to drain which keeps every byte
+};
+
+enum class Scraper_Sync_Policy {
+    NONE,       // leave it to the operating system
+    ON_CLOSE,   // fsync each file when it is closed
+    PERIODIC,   // also fsync open files every sync_interval
+};
+// NOTE: Archives stay open while scraping so they are fsynced every sync_interval unless the policy is NONE
+
+struct Basic_Scraper_Writer_Settings {
+    size_t max_queued_bytes = size_t(32) << 20;
+    Scraper_Overflow_Policy overflow_policy = Scraper_Overflow_Policy::DROP;
+    Scraper_Sync_Policy sync_policy = Scraper_Sync_Policy::ON_CLOSE;
+    std::chrono::milliseconds sync_interval = std::chrono::seconds(10);
+    // stdio buffer of each open file so many small appends become a few large page aligned writes
+    size_t file_buffer_size = size_t(1) << 20;
+    // disk space is reserved in chunks of this size as files grow so long captures aren't fragmented
+    // NOTE: This is only supported on linux and 0 disables it
+    size_t preallocate_bytes = size_t(16) << 20;
+};
+
+struct Basic_Scraper_Writer_Statistics {
+    uint64_t total_jobs = 0;
+    uint64_t total_bytes_written = 0;
+    uint64_t total_jobs_dropped = 0;
+    uint64_t total_bytes_dropped = 0;
+    uint64_t total_write_errors = 0;
+    size_t queued_bytes = 0;
+    size_t max_queued_bytes = 0;
+};
+
+// Moves all file io of the scrapers off the decoder threads
+// Jobs own their data and are written in batches by a single thread
+// The queue is bounded by bytes and either drops new writes or blocks the caller when full
+class Basic_Scraper_Writer
+{
+private:
+    enum class Job_Type { APPEND, CLOSE, WRITE_FILE, WRITE_ARCHIVE };
+    struct Job {
+        Job_Type type;
+        std::shared_ptr<Basic_Scraper_File> file;
+        fs::path path;
+        std::shared_ptr<Basic_Scraper_Archive> archive;
+        Basic_Scraper_Archive_Entry archive_entry;
+        Pooled_Buffer data;
+        // Data owned by someone else which is kept alive until it is written
+        std::shared_ptr<const void> shared_owner;
+        tcb::span<const uint8_t> shared_data;
+        tcb::span<const uint8_t> GetData() const {
+            if (shared_owner != nullptr) return shared_data;
+            return { data.data(), data.size() };
+        }
+    };
+    const Basic_Scraper_Writer_Settings m_settings;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_job;
+    std::condition_variable m_cv_space;
+    std::vector<Job> m_jobs;
+    size_t m_queued_bytes = 0;
+    bool m_is_busy = false;
+    bool m_is_stop = false;
+    // writer thread only
+    std::vector<Job> m_batch;
+    std::vector<std::shared_ptr<Basic_Scraper_File>> m_open_files;
+    std::vector<std::shared_ptr<Basic_Scraper_Archive>> m_open_archives;
+    std::chrono::steady_clock::time_point m_last_sync;
+    // statistics
+    std::atomic<uint64_t> m_total_jobs{0};
+    std::atomic<uint64_t> m_total_bytes_written{0};
+    std::atomic<uint64_t> m_total_jobs_dropped{0};
+    std::atomic<uint64_t> m_total_bytes_dropped{0};
+    std::atomic<uint64_t> m_total_write_errors{0};
+    std::atomic<size_t> m_max_queued_bytes{0};
+    std::thread m_thread;
+public:
+    explicit Basic_Scraper_Writer(const Basic_Scraper_Writer_Settings& settings={});
+    // Writes everything still queued before returning
+    ~Basic_Scraper_Writer();
+    Basic_Scraper_Writer(Basic_Scraper_Writer&) = delete;
+    Basic_Scraper_Writer(Basic_Scraper_Writer&&) = delete;
+    Basic_Scraper_Writer& operator=(Basic_Scraper_Writer&) = delete;
+    Basic_Scraper_Writer& operator=(Basic_Scraper_Writer&&) = delete;
+    // Returns false if the data was dropped
+    bool Append(const std::shared_ptr<Basic_Scraper_File>& file, Pooled_Buffer&& data);
+    bool Append(const std::shared_ptr<Basic_Scraper_File>& file, tcb::span<const uint8_t> data);
+    // Data is written without copying and stays valid while owner is held
+    bool Append(const std::shared_ptr<Basic_Scraper_File>& file, std::shared_ptr<const void> owner, tcb::span<const uint8_t> data);
+    // Closing is never dropped so files are always finalised
+    void Close(const std::shared_ptr<Basic_Scraper_File>& file);
+    // Creates a file with all of the data, returns false if it was dropped
+    bool WriteFile(const fs::path& path, Pooled_Buffer&& data);
+    bool WriteFile(const fs::path& path, tcb::span<const uint8_t> data);
+    // Appends an object to an archive instead of creating a file for it, returns false if it was dropped
+    bool WriteArchive(const std::shared_ptr<Basic_Scraper_Archive>& archive, Basic_Scraper_Archive_Entry&& entry, Pooled_Buffer&& data);
+    bool WriteArchive(const std::shared_ptr<Basic_Scraper_Archive>& archive, Basic_Scraper_Archive_Entry&& entry, tcb::span<const uint8_t> data);
+    // Waits until every job queued so far is written
+    void Flush();
+    Basic_Scraper_Writer_Statistics GetStatistics();
+private:
+    bool Push(Job&& job);
+    void RunWriter();
+    void ProcessJob(Job& job);
+    bool OpenFile(const std::shared_ptr<Basic_Scraper_File>& file);
+    void CloseFile(Basic_Scraper_File& file);
+    void SyncFile(FILE* fp);
+    void PreallocateFile(Basic_Scraper_File& file);
+    void ReleasePreallocation(Basic_Scraper_File& file);
+};
@@ -0,0 +1,121 @@
+#include "./additive_scrambler.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+
+constexpr uint16_t PRBS_SYNCWORD = 0xFFFF;
+constexpr size_t PRBS_PERIOD_BYTES = 511;
+// 864 capacity units of 64bits is the largest CIF
+constexpr size_t MIN_PRBS_TABLE_BYTES = 864*8;
+constexpr size_t PRBS_TABLE_BYTES = ((MIN_PRBS_TABLE_BYTES + PRBS_PERIOD_BYTES-1)/PRBS_PERIOD_BYTES)*PRBS_PERIOD_BYTES;
+
+tcb::span<const uint8_t> get_energy_dispersal_prbs() {
+    static const auto table = []() {
+        auto scrambler = AdditiveScrambler();
+        scrambler.SetSyncword(PRBS_SYNCWORD);
+        scrambler.Reset();
+        auto prbs = std::vector<uint8_t>(PRBS_TABLE_BYTES);
+        for (auto& b: prbs) {
+            b = scrambler.Process();
+        }
+        return prbs;
+    } ();
+    return table;
+}
+
+static void xor_bytes_scalar(tcb::span<uint8_t> x, tcb::span<const uint8_t> y) {
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] ^= y[i];
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <emmintrin.h>
+
+SIMD_TARGET_SSE4_1 static void xor_bytes_sse4_1(tcb::span<uint8_t> x, tcb::span<const uint8_t> y) {
+    // 128bits = 16bytes
+    const size_t K = 16u;
+    const size_t N = x.size();
+    const size_t N_vector = (N/K)*K;
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i]));
+        const __m128i Y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&y[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&x[i]), _mm_xor_si128(X, Y));
+    }
+    xor_bytes_scalar(x.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+
+SIMD_TARGET_AVX2 static void xor_bytes_avx2(tcb::span<uint8_t> x, tcb::span<const uint8_t> y) {
+    // 256bits = 32bytes
+    const size_t K = 32u;
+    const size_t N = x.size();
+    const size_t N_vector = (N/K)*K;
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m256i X = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&x[i]));
+        const __m256i Y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&y[i]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&x[i]), _mm256_xor_si256(X, Y));
+    }
+    xor_bytes_scalar(x.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+static void xor_bytes_neon(tcb::span<uint8_t> x, tcb::span<const uint8_t> y) {
+    // 128bits = 16bytes
+    const size_t K = 16u;
+    const size_t N = x.size();
+    const size_t N_vector = (N/K)*K;
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const uint8x16_t X = vld1q_u8(&x[i]);
+        const uint8x16_t Y = vld1q_u8(&y[i]);
+        vst1q_u8(&x[i], veorq_u8(X, Y));
+    }
+    xor_bytes_scalar(x.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+static void xor_bytes_auto(tcb::span<uint8_t> x, tcb::span<const uint8_t> y) {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return xor_bytes_avx2(x, y);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return xor_bytes_sse4_1(x, y);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return xor_bytes_neon(x, y);
+        }
+    #endif
+    (void)level;
+    xor_bytes_scalar(x, y);
+}
+
+void apply_energy_dispersal_auto(tcb::span<uint8_t> buf) {
+    // The table restarts at the same state since its length is a multiple of the period
+    const auto prbs = get_energy_dispersal_prbs();
+    while (!buf.empty()) {
+        const size_t N = std::min(buf.size(), prbs.size());
+        xor_bytes_auto(buf.first(N), prbs.first(N));
+        buf = buf.subspan(N);
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include "utility/span.h"
 
 // DOC: ETSI EN 300 401
 // Clause 10 - Energy dispersal
@@ -33,4 +34,12 @@ public:
     void Reset() {
         m_reg = m_syncword;
     }
-};
\ No newline at end of file
+};
+
+// Process wide table of the PRBS from the syncword 0xFFFF used by both the FIC and MSC
+// The PRBS has a period of 511 bits so it repeats every 511 bytes
+// NOTE: The table is a multiple of the period and at least as long as the largest CIF
+tcb::span<const uint8_t> get_energy_dispersal_prbs();
+
+// Same as XORing buf with AdditiveScrambler::Process() after Reset() with syncword 0xFFFF
+void apply_energy_dispersal_auto(tcb::span<uint8_t> buf);
@@ -0,0 +1,71 @@
+#include "./byte_reversal.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+
+static void reverse_bytes_scalar(tcb::span<const uint8_t> src, tcb::span<uint8_t> dst, const size_t dst_start) {
+    const size_t N = src.size();
+    for (size_t i = dst_start; i < N; i++) {
+        dst[i] = src[N-1-i];
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <tmmintrin.h>
+// 16 bytes per iteration
+SIMD_TARGET_SSE4_1 static void reverse_bytes_sse4_1(tcb::span<const uint8_t> src, tcb::span<uint8_t> dst) {
+    constexpr size_t K = 16;
+    const size_t N = src.size();
+    const size_t M = (N/K)*K;
+    const __m128i shuffle = _mm_setr_epi8(15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0);
+    for (size_t i = 0; i < M; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[N-K-i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]), _mm_shuffle_epi8(X, shuffle));
+    }
+    reverse_bytes_scalar(src, dst, M);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+// 16 bytes per iteration
+static void reverse_bytes_neon(tcb::span<const uint8_t> src, tcb::span<uint8_t> dst) {
+    constexpr size_t K = 16;
+    const size_t N = src.size();
+    const size_t M = (N/K)*K;
+    for (size_t i = 0; i < M; i+=K) {
+        // reverse each half then swap the halves
+        const uint8x16_t X = vrev64q_u8(vld1q_u8(&src[N-K-i]));
+        vst1q_u8(&dst[i], vextq_u8(X, X, 8));
+    }
+    reverse_bytes_scalar(src, dst, M);
+}
+
+#endif
+
+void reverse_bytes_auto(tcb::span<const uint8_t> src, tcb::span<uint8_t> dst) {
+    assert(dst.size() >= src.size());
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return reverse_bytes_sse4_1(src, dst);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return reverse_bytes_neon(src, dst);
+        }
+    #endif
+    (void)level;
+    reverse_bytes_scalar(src, dst, 0);
+}
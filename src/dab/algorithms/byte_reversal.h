@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utility/span.h"
+
+// dst[i] = src[N-1-i] for the N = src.size() bytes
+// NOTE: dst.size() must be at least src.size() and the buffers can't overlap
+void reverse_bytes_auto(tcb::span<const uint8_t> src, tcb::span<uint8_t> dst);
@@ -0,0 +1,50 @@
+#include "./charset_conversion.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <memory_resource>
+#include <string>
+#include "utility/span.h"
+#include "../constants/charset_table.h"
+
+static void append_code_point(const uint32_t code, std::pmr::string& out) {
+    if (code < 0x80) {
+        out.push_back(char(code));
+    } else if (code < 0x800) {
+        out.push_back(char(0xC0 | (code >> 6)));
+        out.push_back(char(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(char(0xE0 | (code >> 12)));
+        out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (code & 0x3F)));
+    }
+}
+
+void append_charset_as_utf8(tcb::span<const uint8_t> buf, const uint8_t charset, std::pmr::string& out) {
+    size_t N = buf.size();
+    while ((N > 0) && (buf[N-1] == 0x00)) {
+        N--;
+    }
+
+    switch (DAB_Charset(charset)) {
+    case DAB_Charset::UTF8:
+        out.append(reinterpret_cast<const char*>(buf.data()), N);
+        break;
+    case DAB_Charset::UCS2_BE:
+        // NOTE: UCS-2 has no surrogate pairs so every character is a single code point
+        for (size_t i = 0; (i+1) < N; i += 2) {
+            const uint32_t code = (uint32_t(buf[i]) << 8) | uint32_t(buf[i+1]);
+            append_code_point(code, out);
+        }
+        break;
+    case DAB_Charset::EBU_LATIN:
+    default:
+        for (size_t i = 0; i < N; i++) {
+            append_code_point(DAB_EBU_LATIN_TO_UNICODE[buf[i]], out);
+        }
+        break;
+    }
+}
+
+size_t get_charset_bytes_per_char(const uint8_t charset) {
+    return (DAB_Charset(charset) == DAB_Charset::UCS2_BE) ? 2 : 1;
+}
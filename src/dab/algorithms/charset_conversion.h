@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory_resource>
+#include <string>
+#include "utility/span.h"
+
+// Appends text encoded in a DAB charset (ETSI TS 101 756 Table 1) to a UTF-8 string
+// Unsupported charsets are read as EBU Latin since it agrees with ASCII for printable characters
+// NOTE: Trailing null bytes are dropped since some broadcasters pad their labels with them
+void append_charset_as_utf8(tcb::span<const uint8_t> buf, const uint8_t charset, std::pmr::string& out);
+// Number of bytes that a character of the charset takes for labels with character positions (e.g. DL Plus tags)
+size_t get_charset_bytes_per_char(const uint8_t charset);
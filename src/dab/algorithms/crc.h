@@ -1,69 +1,113 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
-#include <unordered_map> // NOLINT
+#include <array>
 #include "utility/span.h"
+#include "./crc_fold.h"
 
 // Source: http://www.sunshine2k.de/articles/coding/crc/understanding_crc.html#ch44
 // A copy of the HTML page is also stored in docs/
 // A very good source on understanding how CRC works and is implemented
 // The lookup implementation below is completely based on their examples
+// It is extended to slicing-by-8 which uses 8 tables to process 8 bytes per step
+// Long buffers are folded 16 bytes at a time with carryless multiplication if the CPU supports it
 template <typename T>
 class CRC_Calculator {
+public:
+    static constexpr size_t TOTAL_SLICES = 8;
+    using Table = std::array<std::array<T, 256>, TOTAL_SLICES>;
 private:
-    T* m_lut;
+    static_assert(sizeof(T) <= 4, "CRC folding only supports polynomials up to 32bits");
+    static constexpr size_t m_width = sizeof(T)*8;
+    static constexpr size_t m_shift = m_width-8;
+    // Each calculator has its own tables so construction is thread safe
     const T m_G;
+    const Table m_lut;
+    const CRC_Fold_Constants m_fold_constants;
     // Different CRC implementations have a non-zero initial register state
     // Additionally the CRC result may be XORed with a value prior to transmission
     T m_initial_value = 0u;   
     T m_final_xor_value = 0u;
 public:
     // Generator polynomial without leading coefficient (msb left)
-    explicit CRC_Calculator(const T G): m_G(G) {
-        m_lut = CRC_Calculator<T>::GenerateTable(m_G);
+    explicit CRC_Calculator(const T G)
+    : m_G(G), m_lut(GenerateTable(G)), m_fold_constants(crc_get_fold_constants(uint32_t(G), m_width)) {}
+    T Process(tcb::span<const uint8_t> x) const {
+        return Finalise(Update(m_initial_value, x));
     }
-    T Process(tcb::span<const uint8_t> x) {
-        T crc = m_initial_value;
-        const size_t shift = (sizeof(T)-1)*8;
+    // Messages that arrive in pieces are calculated as
+    // crc = GetInitialValue(), crc = Update(crc, piece) for each piece, result = Finalise(crc)
+    T Update(T crc, tcb::span<const uint8_t> x) const {
+        // The initial value is absorbed by the fold so it restarts from an empty register
+        uint64_t folded = 0;
+        const size_t nb_folded = crc_fold_auto(x, uint32_t(crc), m_width, m_fold_constants, folded);
+        if (nb_folded > 0) {
+            // folded is congruent to the folded bytes and its 8 bytes are processed like a message
+            uint8_t folded_bytes[8];
+            for (size_t i = 0; i < 8; i++) {
+                folded_bytes[i] = uint8_t(folded >> (56-i*8));
+            }
+            crc = ProcessSlices(0u, folded_bytes);
+            x = x.subspan(nb_folded);
+        }
+
         const size_t N = x.size();
-        for (size_t i = 0; i < N; i++) {
-            crc = crc ^ ((T)(x[i]) << shift);
-            uint8_t lut_idx = (crc >> shift) & 0xFF;
-            crc = (crc << 8) ^ m_lut[lut_idx];
+        const size_t N_sliced = (N/TOTAL_SLICES)*TOTAL_SLICES;
+        for (size_t i = 0; i < N_sliced; i+=TOTAL_SLICES) {
+            crc = ProcessSlices(crc, &x[i]);
+        }
+        for (size_t i = N_sliced; i < N; i++) {
+            crc = ProcessByte(crc, x[i]);
         }
-        return crc ^ m_final_xor_value;
+        return crc;
     }
+    inline T GetInitialValue() const { return m_initial_value; }
+    inline T Finalise(const T crc) const { return crc ^ m_final_xor_value; }
     inline void SetInitialValue(const T x) { m_initial_value = x; }
     inline void SetFinalXORValue(const T x) { m_final_xor_value = x; }
-private:
-    static T* GenerateTable(const T G) {
-        // Global lut for CRC lookup tables for all CRC polynomials
-        // key = polynomial, value = lookup table
-        static auto table = std::unordered_map<T, T*>{};
-        auto res = table.find(G);
-        if (res != table.end()) {
-            return res->second;
-        }
-
-        const T bitcheck = 1u << (sizeof(T)*8 - 1);
-        const int shift = (sizeof(T)-1)*8;
-
-        const size_t N = 256;
-        auto* lut = new T[N];
-        for (size_t i = 0; i < N; i++) {
-            T crc = static_cast<uint8_t>(i) << shift;
+    // Table k is the CRC of a byte followed by k zero bytes
+    static constexpr Table GenerateTable(const T G) {
+        const T bitcheck = T(T(1u) << (m_width-1));
+        Table lut{};
+        for (size_t i = 0; i < 256; i++) {
+            T crc = T(T(i) << m_shift);
             for (int j = 0; j < 8; j++) {
                 if ((crc & bitcheck) != 0) {
-                    crc = crc << 1;
-                    crc = crc ^ G;
+                    crc = T(crc << 1);
+                    crc = T(crc ^ G);
                 } else {
-                    crc = crc << 1;
+                    crc = T(crc << 1);
                 }
             }
-            lut[i] = crc;
+            lut[0][i] = crc;
+        }
+        for (size_t k = 1; k < TOTAL_SLICES; k++) {
+            for (size_t i = 0; i < 256; i++) {
+                const T crc = lut[k-1][i];
+                lut[k][i] = T(T(crc << 8) ^ lut[0][(crc >> m_shift) & 0xFF]);
+            }
         }
-
-        table.insert({G, lut});
         return lut;
     }
-};
\ No newline at end of file
+private:
+    inline T ProcessByte(const T crc, const uint8_t x) const {
+        const uint8_t lut_idx = uint8_t((crc >> m_shift) ^ x);
+        return T(T(crc << 8) ^ m_lut[0][lut_idx]);
+    }
+    inline T ProcessSlices(const T crc, const uint8_t* x) const {
+        // The register overlaps the first bytes of the slice
+        uint8_t y[TOTAL_SLICES];
+        for (size_t i = 0; i < TOTAL_SLICES; i++) {
+            y[i] = x[i];
+        }
+        for (size_t i = 0; i < sizeof(T); i++) {
+            y[i] ^= uint8_t(crc >> (m_shift - i*8));
+        }
+        T res = 0;
+        for (size_t i = 0; i < TOTAL_SLICES; i++) {
+            res ^= m_lut[TOTAL_SLICES-1-i][y[i]];
+        }
+        return res;
+    }
+};
@@ -0,0 +1,96 @@
+#include "./crc_fold.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+
+// Shorter buffers are faster with the lookup tables
+constexpr size_t MIN_FOLD_BYTES = 64;
+constexpr size_t FOLD_BLOCK_SIZE = 16;
+
+// x^n mod (x^width + G)
+static uint64_t get_power_modulo(const size_t n, const uint32_t G, const size_t width) {
+    const uint64_t P = (uint64_t(1) << width) | uint64_t(G);
+    uint64_t r = 1;
+    for (size_t i = 0; i < n; i++) {
+        r = r << 1;
+        if ((r >> width) & 0b1) {
+            r = r ^ P;
+        }
+    }
+    return r;
+}
+
+CRC_Fold_Constants crc_get_fold_constants(const uint32_t G, const size_t width) {
+    assert((width >= 8) && (width <= 32));
+    CRC_Fold_Constants constants;
+    constants.x64 = get_power_modulo(64, G, width);
+    constants.x128 = get_power_modulo(128, G, width);
+    constants.x192 = get_power_modulo(192, G, width);
+    return constants;
+}
+
+#if defined(__ARCH_X86__) && defined(SIMD_COMPILE_PCLMUL)
+#include <smmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+// DOC: Intel, Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction
+// Each block is a 128bit polynomial with the first byte as the most significant
+// A(x)*x^128 + B(x) = A_hi(x)*x^192 + A_lo(x)*x^128 + B(x) which is reduced with the precomputed powers
+SIMD_TARGET_PCLMUL static uint64_t crc_fold_pclmul(
+    const uint8_t* x, const size_t nb_blocks, const uint64_t initial_top, const CRC_Fold_Constants& constants)
+{
+    const __m128i reverse_bytes = _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    const __m128i fold_constants = _mm_set_epi64x(int64_t(constants.x192), int64_t(constants.x128));
+    const __m128i reduce_constants = _mm_set_epi64x(0, int64_t(constants.x64));
+
+    __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+    A = _mm_shuffle_epi8(A, reverse_bytes);
+    A = _mm_xor_si128(A, _mm_set_epi64x(int64_t(initial_top), 0));
+    for (size_t i = 1; i < nb_blocks; i++) {
+        __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[i*FOLD_BLOCK_SIZE]));
+        B = _mm_shuffle_epi8(B, reverse_bytes);
+        const __m128i A_hi = _mm_clmulepi64_si128(A, fold_constants, 0x11);
+        const __m128i A_lo = _mm_clmulepi64_si128(A, fold_constants, 0x00);
+        A = _mm_xor_si128(_mm_xor_si128(A_hi, A_lo), B);
+    }
+
+    // 128bits to 96bits to 64bits with A_hi(x)*x^64
+    __m128i T = _mm_xor_si128(_mm_clmulepi64_si128(A, reduce_constants, 0x01), _mm_move_epi64(A));
+    T = _mm_xor_si128(_mm_clmulepi64_si128(_mm_srli_si128(T, 8), reduce_constants, 0x00), _mm_move_epi64(T));
+    uint64_t folded = 0;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&folded), T);
+    return folded;
+}
+#endif
+
+size_t crc_fold_auto(
+    tcb::span<const uint8_t> x, const uint32_t initial_value, const size_t width,
+    const CRC_Fold_Constants& constants, uint64_t& folded)
+{
+    if (x.size() < MIN_FOLD_BYTES) {
+        return 0;
+    }
+    const size_t nb_blocks = x.size() / FOLD_BLOCK_SIZE;
+    const uint64_t initial_top = uint64_t(initial_value) << (64-width);
+
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__) && defined(SIMD_COMPILE_PCLMUL)
+        static const bool is_pclmul = simd_is_pclmul_supported();
+        if (is_pclmul && simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            folded = crc_fold_pclmul(x.data(), nb_blocks, initial_top, constants);
+            return nb_blocks*FOLD_BLOCK_SIZE;
+        }
+    #endif
+    (void)level;
+    (void)nb_blocks;
+    (void)initial_top;
+    (void)constants;
+    (void)folded;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utility/span.h"
+
+// Powers of x modulo the generator polynomial used to fold 16 byte blocks together
+struct CRC_Fold_Constants {
+    uint64_t x64 = 0;
+    uint64_t x128 = 0;
+    uint64_t x192 = 0;
+};
+
+// G is the generator polynomial without the leading coefficient (msb left) of width bits
+CRC_Fold_Constants crc_get_fold_constants(const uint32_t G, const size_t width);
+
+// Folds the largest multiple of 16 bytes of x into a 64bit polynomial that is congruent to it
+// The initial register of the CRC is absorbed into the first bytes
+// Returns the number of bytes that were folded
+// NOTE: This is 0 if x is too short for folding to be faster or carryless multiplication isn't supported
+size_t crc_fold_auto(
+    tcb::span<const uint8_t> x, const uint32_t initial_value, const size_t width,
+    const CRC_Fold_Constants& constants, uint64_t& folded);
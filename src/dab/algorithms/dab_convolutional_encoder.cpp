@@ -0,0 +1,59 @@
+#include "./dab_convolutional_encoder.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utility/span.h"
+
+// DOC: ETSI EN 300 401
+// Clause 11.1.1 - Mother code
+// Octal forms of the generator polynomials are 133, 171, 145 and 133
+constexpr uint8_t CODE_POLYNOMIAL[DAB_Convolutional_Encoder::m_code_rate] = { 109, 79, 83, 109 };
+
+static uint8_t get_parity(uint32_t x) {
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return uint8_t(x & 0b1);
+}
+
+void DAB_Convolutional_Encoder::encode(tcb::span<const uint8_t> bytes) {
+    const size_t R = m_code_rate;
+    const uint32_t state_mask = (1u << m_constraint_length) - 1u;
+    const size_t nb_data_bits = bytes.size()*8;
+    const size_t nb_bits = nb_data_bits + m_nb_tail_bits;
+    m_mother_bits.resize(nb_bits*R);
+    uint32_t state = 0;
+    for (size_t i = 0; i < nb_bits; i++) {
+        uint32_t bit = 0;
+        if (i < nb_data_bits) {
+            bit = (bytes[i/8] >> (7-(i%8))) & 0b1;
+        }
+        state = ((state << 1) | bit) & state_mask;
+        for (size_t j = 0; j < R; j++) {
+            m_mother_bits[i*R+j] = get_parity(state & CODE_POLYNOMIAL[j]);
+        }
+    }
+    m_curr_mother_bit = 0;
+}
+
+size_t DAB_Convolutional_Encoder::puncture(
+    tcb::span<const uint8_t> puncture_code, const size_t nb_mother_bits,
+    tcb::span<uint8_t> bits_out)
+{
+    const size_t R = m_code_rate;
+    assert(m_curr_mother_bit + nb_mother_bits <= m_mother_bits.size());
+    const uint8_t* mother_bits = &m_mother_bits[m_curr_mother_bit];
+    size_t curr_code = 0;
+    size_t curr_bit_out = 0;
+    for (size_t i = 0; i < nb_mother_bits; i += R) {
+        const size_t nb_kept = size_t(puncture_code[curr_code]);
+        assert(curr_bit_out + nb_kept <= bits_out.size());
+        for (size_t j = 0; j < nb_kept; j++) {
+            bits_out[curr_bit_out++] = mother_bits[i+j];
+        }
+        curr_code++;
+        if (curr_code == puncture_code.size()) curr_code = 0;
+    }
+    m_curr_mother_bit += nb_mother_bits;
+    return curr_bit_out;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/span.h"
+
+// DOC: ETSI EN 300 401
+// Clause 11.1 - Convolutional code
+// Mother code with rate 1/4 and constraint length 7 followed by puncturing
+// This is the inverse of DAB_Viterbi_Decoder where each puncture code restarts from its first entry
+// NOTE: Each encoded bit is a byte that is 0 or 1
+class DAB_Convolutional_Encoder
+{
+public:
+    static constexpr size_t m_constraint_length = 7;
+    static constexpr size_t m_code_rate = 4;
+    static constexpr size_t m_nb_tail_bits = m_constraint_length-1;
+private:
+    std::vector<uint8_t> m_mother_bits;
+    size_t m_curr_mother_bit = 0;
+public:
+    // bytes are encoded most significant bit first and the encoder is flushed with zero tail bits
+    void encode(tcb::span<const uint8_t> bytes);
+    // Each entry of the count table is the number of bits kept from a block of 4 mother bits
+    // Returns the number of punctured bits written which must fit in bits_out
+    size_t puncture(tcb::span<const uint8_t> puncture_code, const size_t nb_mother_bits, tcb::span<uint8_t> bits_out);
+    // All the mother bits from the last encode() have been punctured
+    bool is_finished() const { return m_curr_mother_bit == m_mother_bits.size(); }
+};
@@ -0,0 +1,140 @@
+#include "./dab_depuncture_plan.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "../constants/puncture_codes.h"
+
+constexpr size_t R = DAB_Depuncture_Plan::m_code_rate;
+constexpr int16_t soft_decision_unpunctured = int16_t(SOFT_DECISION_VITERBI_PUNCTURED);
+// PI_X is given the id after the table of puncture codes
+constexpr int PI_X_ID = 25;
+
+// Where each output symbol of one period of a puncture code is read from, or -1 if it was punctured
+template <int PI>
+struct Depuncture_Pattern {
+    static constexpr tcb::span<const uint8_t> get_code() {
+        if constexpr(PI == PI_X_ID) {
+            return { PI_X, sizeof(PI_X) };
+        } else {
+            return { PI_TABLE[PI-1], sizeof(PI_TABLE[PI-1]) };
+        }
+    }
+    static constexpr size_t TOTAL_BLOCKS = get_code().size();
+    static constexpr size_t TOTAL_OUTPUT = TOTAL_BLOCKS*R;
+    static constexpr auto get_offsets() {
+        std::array<int16_t, TOTAL_OUTPUT> offsets{};
+        int16_t offset = 0;
+        for (size_t block = 0; block < TOTAL_BLOCKS; block++) {
+            for (size_t i = 0; i < R; i++) {
+                offsets[block*R+i] = (i < size_t(get_code()[block])) ? offset++ : int16_t(-1);
+            }
+        }
+        return offsets;
+    }
+    static constexpr std::array<int16_t, TOTAL_OUTPUT> OFFSETS = get_offsets();
+    static constexpr size_t get_total_input() {
+        size_t total = 0;
+        for (const auto x: get_code()) total += size_t(x);
+        return total;
+    }
+    static constexpr size_t TOTAL_INPUT = get_total_input();
+};
+
+// The offsets are constant so each period unrolls into moves with the erasures filled in
+template <int PI>
+static size_t depuncture_region(const viterbi_bit_t* punctured_symbols, int16_t* output_symbols, const size_t total_blocks) {
+    using Pattern = Depuncture_Pattern<PI>;
+    const size_t total_periods = total_blocks / Pattern::TOTAL_BLOCKS;
+    for (size_t period = 0; period < total_periods; period++) {
+        for (size_t i = 0; i < Pattern::TOTAL_OUTPUT; i++) {
+            const int16_t offset = Pattern::OFFSETS[i];
+            output_symbols[i] = (offset < 0) ? soft_decision_unpunctured : int16_t(punctured_symbols[offset]);
+        }
+        punctured_symbols += Pattern::TOTAL_INPUT;
+        output_symbols += Pattern::TOTAL_OUTPUT;
+    }
+
+    // A region that isn't a whole number of periods ends partway through the code
+    size_t total_input = total_periods*Pattern::TOTAL_INPUT;
+    const size_t total_remaining_output = (total_blocks % Pattern::TOTAL_BLOCKS)*R;
+    for (size_t i = 0; i < total_remaining_output; i++) {
+        const int16_t offset = Pattern::OFFSETS[i];
+        if (offset < 0) {
+            output_symbols[i] = soft_decision_unpunctured;
+        } else {
+            output_symbols[i] = int16_t(punctured_symbols[offset]);
+            total_input++;
+        }
+    }
+    return total_input;
+}
+
+template <size_t... I>
+static constexpr auto make_depuncture_functions(std::index_sequence<I...>) {
+    return std::array<DAB_Depuncture_Plan::Depuncture_Function, sizeof...(I)>{ &depuncture_region<int(I)+1>... };
+}
+
+// Index i is the specialisation for puncture code id i+1
+static constexpr auto DEPUNCTURE_FUNCTIONS = make_depuncture_functions(std::make_index_sequence<PI_X_ID>{});
+
+static DAB_Depuncture_Plan::Depuncture_Function find_depuncture_function(tcb::span<const uint8_t> puncture_code) {
+    for (int id = 1; id <= PI_X_ID; id++) {
+        const auto code = (id == PI_X_ID) ? tcb::span<const uint8_t>(PI_X) : GetPunctureCode(id);
+        if (std::equal(code.begin(), code.end(), puncture_code.begin(), puncture_code.end())) {
+            return DEPUNCTURE_FUNCTIONS[size_t(id-1)];
+        }
+    }
+    return nullptr;
+}
+
+void DAB_Depuncture_Plan::clear() {
+    m_indices.clear();
+    m_regions.clear();
+    m_total_input_symbols = 0;
+    m_is_specialised = true;
+}
+
+void DAB_Depuncture_Plan::append(tcb::span<const uint8_t> puncture_code, const size_t requested_output_symbols) {
+    assert(requested_output_symbols % m_code_rate == 0);
+    assert(!puncture_code.empty());
+
+    const size_t total_blocks = requested_output_symbols / m_code_rate;
+    const size_t total_puncture_code = puncture_code.size();
+    m_indices.reserve(m_indices.size() + requested_output_symbols);
+    for (size_t block = 0; block < total_blocks; block++) {
+        // NOTE: Puncture codes store the number of transmitted symbols in each block of R symbols
+        const size_t total_block_punctured = size_t(puncture_code[block % total_puncture_code]);
+        for (size_t i = 0; i < m_code_rate; i++) {
+            if (i < total_block_punctured) {
+                m_total_input_symbols++;
+                m_indices.push_back(uint16_t(m_total_input_symbols));
+            } else {
+                m_indices.push_back(0u);
+            }
+        }
+    }
+    assert(m_total_input_symbols <= MAX_INPUT_SYMBOLS);
+
+    if (total_blocks == 0) {
+        return;
+    }
+    const auto depuncture = find_depuncture_function(puncture_code);
+    if (depuncture == nullptr) {
+        m_is_specialised = false;
+        return;
+    }
+    m_regions.push_back({ depuncture, total_blocks });
+}
+
+void DAB_Depuncture_Plan::depuncture(const viterbi_bit_t* punctured_symbols, int16_t* output_symbols) const {
+    assert(m_is_specialised);
+    for (const auto& region: m_regions) {
+        punctured_symbols += region.depuncture(punctured_symbols, output_symbols, region.total_blocks);
+        output_symbols += region.total_blocks*m_code_rate;
+    }
+}
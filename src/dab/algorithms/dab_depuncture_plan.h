@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Depuncturing of a whole codeword flattened into a gather from the received symbols
+// This is built once for a protection profile so decoding doesn't walk the puncture codes every frame
+// NOTE: Index 0 is a punctured symbol and index i+1 is received symbol i
+//       The decoder gathers from the received symbols with an erasure prepended so it never branches
+// Runs of the plan that use a puncture code from the standard are also depunctured by a function
+// specialised for that code at compile time, which is picked once when the plan is built
+class DAB_Depuncture_Plan
+{
+public:
+    static constexpr size_t m_code_rate = 4;
+    // The largest subchannel has 864 capacity units of 64 bits
+    static constexpr size_t MAX_INPUT_SYMBOLS = size_t(UINT16_MAX)-1u;
+    // Returns the number of punctured symbols read
+    using Depuncture_Function = size_t (*)(const viterbi_bit_t* punctured_symbols, int16_t* output_symbols, const size_t total_blocks);
+private:
+    struct Region {
+        Depuncture_Function depuncture;
+        size_t total_blocks;
+    };
+    std::vector<uint16_t> m_indices;
+    std::vector<Region> m_regions;
+    size_t m_total_input_symbols = 0;
+    bool m_is_specialised = true;
+public:
+    void clear();
+    // Appends symbols depunctured with a puncture code, the same as DAB_Viterbi_Decoder::update()
+    void append(tcb::span<const uint8_t> puncture_code, const size_t requested_output_symbols);
+    size_t get_total_input_symbols() const { return m_total_input_symbols; }
+    size_t get_total_output_symbols() const { return m_indices.size(); }
+    tcb::span<const uint16_t> get_indices() const { return m_indices; }
+    // False if a puncture code isn't in the standard so get_indices() has to be used instead
+    bool get_is_specialised() const { return m_is_specialised; }
+    size_t get_memory_bytes() const { return m_indices.capacity()*sizeof(uint16_t) + m_regions.capacity()*sizeof(Region); }
+    // Writes get_total_output_symbols() symbols with erasures for the punctured ones
+    // NOTE: The plan must be specialised
+    void depuncture(const viterbi_bit_t* punctured_symbols, int16_t* output_symbols) const;
+};
@@ -0,0 +1,48 @@
+#include "./dab_viterbi_backend.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./dab_depuncture_plan.h"
+#include "./dab_viterbi_batch_decoder.h"
+
+DAB_Viterbi_CPU_Backend::DAB_Viterbi_CPU_Backend() = default;
+DAB_Viterbi_CPU_Backend::~DAB_Viterbi_CPU_Backend() = default;
+
+void DAB_Viterbi_CPU_Backend::Decode(tcb::span<DAB_Viterbi_Job> jobs) {
+    std::unique_ptr<DAB_Viterbi_Batch_Decoder> vitdec = nullptr;
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        if (!m_free_decoders.empty()) {
+            vitdec = std::move(m_free_decoders.back());
+            m_free_decoders.pop_back();
+        }
+    }
+    if (vitdec == nullptr) {
+        vitdec = std::make_unique<DAB_Viterbi_Batch_Decoder>();
+    }
+
+    constexpr size_t TOTAL_LANES = DAB_Viterbi_Batch_Decoder::TOTAL_LANES;
+    for (size_t i = 0; i < jobs.size(); i += TOTAL_LANES) {
+        auto lane_jobs = jobs.subspan(i, std::min(TOTAL_LANES, jobs.size()-i));
+        vitdec->reset();
+        for (size_t lane = 0; lane < lane_jobs.size(); lane++) {
+            const auto& job = lane_jobs[lane];
+            assert(job.plan != nullptr);
+            vitdec->update(lane, job.punctured_symbols, *job.plan);
+        }
+        vitdec->decode();
+        for (size_t lane = 0; lane < lane_jobs.size(); lane++) {
+            auto& job = lane_jobs[lane];
+            job.error = vitdec->chainback(lane, job.bytes_out);
+        }
+    }
+
+    auto lock = std::scoped_lock(m_mutex);
+    m_free_decoders.push_back(std::move(vitdec));
+}
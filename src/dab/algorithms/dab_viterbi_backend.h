@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "viterbi_config.h"
+#include "utility/span.h"
+
+class DAB_Depuncture_Plan;
+class DAB_Viterbi_Batch_Decoder;
+
+// Codeword which is depunctured with its plan and decoded from and to state 0
+// NOTE: DAB flushes the encoder with 6 tail bits which aren't written to bytes_out
+struct DAB_Viterbi_Job {
+    tcb::span<const viterbi_bit_t> punctured_symbols;
+    const DAB_Depuncture_Plan* plan = nullptr;
+    tcb::span<uint8_t> bytes_out;
+    uint64_t error = 0;
+};
+
+// Viterbi decodes many independent codewords at once
+// This lets the decoding of equal error protection subchannels be moved onto other hardware
+// NOTE: Decode() is called concurrently by every radio and worker sharing the backend
+//       so a backend is free to combine the jobs of many ensembles into one large pass
+class DAB_Viterbi_Backend
+{
+public:
+    virtual ~DAB_Viterbi_Backend() = default;
+    // Returns once every job has been decoded
+    virtual void Decode(tcb::span<DAB_Viterbi_Job> jobs) = 0;
+};
+
+// Default backend which decodes each call 16 jobs at a time with one trellis per SIMD lane
+class DAB_Viterbi_CPU_Backend: public DAB_Viterbi_Backend
+{
+private:
+    // decoders are reused between calls and a new one is created for each concurrent caller
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<DAB_Viterbi_Batch_Decoder>> m_free_decoders;
+public:
+    DAB_Viterbi_CPU_Backend();
+    ~DAB_Viterbi_CPU_Backend() override;
+    DAB_Viterbi_CPU_Backend(DAB_Viterbi_CPU_Backend&) = delete;
+    DAB_Viterbi_CPU_Backend(DAB_Viterbi_CPU_Backend&&) = delete;
+    DAB_Viterbi_CPU_Backend& operator=(DAB_Viterbi_CPU_Backend&) = delete;
+    DAB_Viterbi_CPU_Backend& operator=(DAB_Viterbi_CPU_Backend&&) = delete;
+    void Decode(tcb::span<DAB_Viterbi_Job> jobs) override;
+};
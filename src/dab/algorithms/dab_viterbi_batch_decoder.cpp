@@ -0,0 +1,643 @@
+#include "./dab_viterbi_batch_decoder.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./dab_depuncture_plan.h"
+
+// DOC: ETSI EN 300 401
+// Clause 11.1.1 - Mother code
+// Refer to dab_viterbi_decoder.cpp for the derivation of the reversed binary polynomials
+constexpr size_t K = DAB_Viterbi_Batch_Decoder::m_constraint_length;
+constexpr size_t R = DAB_Viterbi_Batch_Decoder::m_code_rate;
+constexpr size_t L = DAB_Viterbi_Batch_Decoder::TOTAL_LANES;
+constexpr size_t NB_STATES = DAB_Viterbi_Batch_Decoder::TOTAL_STATES;
+constexpr size_t NB_BUTTERFLIES = NB_STATES/2;
+constexpr uint8_t code_polynomial[R] = { 109, 79, 83, 109 };
+constexpr int16_t soft_decision_high = int16_t(SOFT_DECISION_VITERBI_HIGH);
+constexpr viterbi_bit_t soft_decision_unpunctured = SOFT_DECISION_VITERBI_PUNCTURED;
+// Metrics are renormalised often enough that they never overflow int16
+// Between renormalisations the metrics can change by at most R*SOFT_DECISION_VITERBI_HIGH per step
+constexpr size_t RENORMALISATION_INTERVAL = 16;
+constexpr int16_t INITIAL_NON_START_METRIC = int16_t((K-1)*R*size_t(soft_decision_high));
+
+static_assert(K == 7 && R == 4, "Branch metric sharing assumes the DAB mother code");
+static_assert(code_polynomial[0] == code_polynomial[3], "Branch metric sharing assumes the first and last polynomials are equal");
+static_assert(L == 16, "Decision packing assumes 16 lanes");
+
+// The branch metric is the correlation between the received symbols and the expected symbols
+// Since polynomial 0 and 3 are the same there are only 8 unique correlations which we index
+// Correlation = s0*(x0+x3) + s1*x1 + s2*x2 where s is +1 if we expect a 1 otherwise -1
+// [0..3] = +(x0+x3) +/- x1 +/- x2
+// [4..7] = negated [0..3]
+struct BranchIndexTable {
+    uint8_t index[NB_BUTTERFLIES];
+    constexpr BranchIndexTable(): index() {
+        for (size_t i = 0; i < NB_BUTTERFLIES; i++) {
+            // expected symbols when the upper predecessor (i) shifts in a 0 to state 2i
+            bool is_high[R] = { false };
+            for (size_t r = 0; r < R; r++) {
+                uint8_t v = uint8_t(2*i) & code_polynomial[r];
+                bool parity = false;
+                while (v) {
+                    parity = !parity;
+                    v = uint8_t(v & (v-1));
+                }
+                is_high[r] = parity;
+            }
+            if (is_high[0]) {
+                index[i] = uint8_t((is_high[1] ? 0 : 2) + (is_high[2] ? 0 : 1));
+            } else {
+                index[i] = uint8_t(4 + (is_high[1] ? 2 : 0) + (is_high[2] ? 1 : 0));
+            }
+        }
+    }
+};
+static constexpr auto BRANCH_INDEX = BranchIndexTable();
+
+// Decision bits of both outputs of a butterfly are packed so that
+// bits [0..7]   = new state 2i   lanes [0..7]
+// bits [8..15]  = new state 2i+1 lanes [0..7]
+// bits [16..23] = new state 2i   lanes [8..15]
+// bits [24..31] = new state 2i+1 lanes [8..15]
+static inline size_t get_decision_bit(const size_t lane, const size_t state) {
+    return (lane & 0b111) + 8*(state & 0b1) + 16*(lane >> 3);
+}
+
+// Compile time selected vector of int16 soft decision metrics with one element per lane
+// NOTE: Symbols are stored as int8 and only widened when the branch metrics are calculated
+#if defined(__ARCH_X86__) && defined(__AVX2__)
+#pragma message("DAB_VITERBI_BATCH_DECODER using x86 AVX2")
+#include <immintrin.h>
+struct lanes_t { __m256i x; };
+static inline lanes_t lanes_load(const int16_t* p) { return { _mm256_load_si256(reinterpret_cast<const __m256i*>(p)) }; }
+static inline lanes_t lanes_load_symbols(const int8_t* p) { return { _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(p))) }; }
+static inline void lanes_store(int16_t* p, lanes_t a) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), a.x); }
+static inline lanes_t lanes_add(lanes_t a, lanes_t b) { return { _mm256_add_epi16(a.x, b.x) }; }
+static inline lanes_t lanes_sub(lanes_t a, lanes_t b) { return { _mm256_sub_epi16(a.x, b.x) }; }
+static inline lanes_t lanes_min(lanes_t a, lanes_t b) { return { _mm256_min_epi16(a.x, b.x) }; }
+static inline lanes_t lanes_neg(lanes_t a) { return { _mm256_sub_epi16(_mm256_setzero_si256(), a.x) }; }
+static inline uint32_t lanes_decisions(lanes_t m0, lanes_t m1, lanes_t m2, lanes_t m3) {
+    const __m256i d0 = _mm256_cmpgt_epi16(m0.x, m1.x);
+    const __m256i d1 = _mm256_cmpgt_epi16(m2.x, m3.x);
+    return uint32_t(_mm256_movemask_epi8(_mm256_packs_epi16(d0, d1)));
+}
+#elif defined(__ARCH_X86__) && defined(__SSE4_1__)
+#pragma message("DAB_VITERBI_BATCH_DECODER using x86 SSE4.1")
+#include <smmintrin.h>
+struct lanes_t { __m128i lo, hi; };
+static inline lanes_t lanes_load(const int16_t* p) {
+    return {
+        _mm_load_si128(reinterpret_cast<const __m128i*>(p)),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(p+8)),
+    };
+}
+static inline lanes_t lanes_load_symbols(const int8_t* p) {
+    const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+    return { _mm_cvtepi8_epi16(x), _mm_cvtepi8_epi16(_mm_srli_si128(x, 8)) };
+}
+static inline void lanes_store(int16_t* p, lanes_t a) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(p), a.lo);
+    _mm_store_si128(reinterpret_cast<__m128i*>(p+8), a.hi);
+}
+static inline lanes_t lanes_add(lanes_t a, lanes_t b) { return { _mm_add_epi16(a.lo, b.lo), _mm_add_epi16(a.hi, b.hi) }; }
+static inline lanes_t lanes_sub(lanes_t a, lanes_t b) { return { _mm_sub_epi16(a.lo, b.lo), _mm_sub_epi16(a.hi, b.hi) }; }
+static inline lanes_t lanes_min(lanes_t a, lanes_t b) { return { _mm_min_epi16(a.lo, b.lo), _mm_min_epi16(a.hi, b.hi) }; }
+static inline lanes_t lanes_neg(lanes_t a) {
+    const __m128i zero = _mm_setzero_si128();
+    return { _mm_sub_epi16(zero, a.lo), _mm_sub_epi16(zero, a.hi) };
+}
+static inline uint32_t lanes_decisions(lanes_t m0, lanes_t m1, lanes_t m2, lanes_t m3) {
+    const __m128i lo = _mm_packs_epi16(_mm_cmpgt_epi16(m0.lo, m1.lo), _mm_cmpgt_epi16(m2.lo, m3.lo));
+    const __m128i hi = _mm_packs_epi16(_mm_cmpgt_epi16(m0.hi, m1.hi), _mm_cmpgt_epi16(m2.hi, m3.hi));
+    return uint32_t(_mm_movemask_epi8(lo)) | (uint32_t(_mm_movemask_epi8(hi)) << 16);
+}
+#elif defined(__ARCH_AARCH64__)
+#pragma message("DAB_VITERBI_BATCH_DECODER using ARM AARCH64 NEON")
+#include <arm_neon.h>
+struct lanes_t { int16x8_t lo, hi; };
+static inline lanes_t lanes_load(const int16_t* p) { return { vld1q_s16(p), vld1q_s16(p+8) }; }
+static inline lanes_t lanes_load_symbols(const int8_t* p) {
+    const int8x16_t x = vld1q_s8(p);
+    return { vmovl_s8(vget_low_s8(x)), vmovl_s8(vget_high_s8(x)) };
+}
+static inline void lanes_store(int16_t* p, lanes_t a) { vst1q_s16(p, a.lo); vst1q_s16(p+8, a.hi); }
+static inline lanes_t lanes_add(lanes_t a, lanes_t b) { return { vaddq_s16(a.lo, b.lo), vaddq_s16(a.hi, b.hi) }; }
+static inline lanes_t lanes_sub(lanes_t a, lanes_t b) { return { vsubq_s16(a.lo, b.lo), vsubq_s16(a.hi, b.hi) }; }
+static inline lanes_t lanes_min(lanes_t a, lanes_t b) { return { vminq_s16(a.lo, b.lo), vminq_s16(a.hi, b.hi) }; }
+static inline lanes_t lanes_neg(lanes_t a) { return { vnegq_s16(a.lo), vnegq_s16(a.hi) }; }
+static inline uint32_t lanes_movemask(uint16x8_t d0, uint16x8_t d1) {
+    static const uint8_t weights[16] = { 1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128 };
+    const uint8x16_t d = vandq_u8(vcombine_u8(vmovn_u16(d0), vmovn_u16(d1)), vld1q_u8(weights));
+    return uint32_t(vaddv_u8(vget_low_u8(d))) | (uint32_t(vaddv_u8(vget_high_u8(d))) << 8);
+}
+static inline uint32_t lanes_decisions(lanes_t m0, lanes_t m1, lanes_t m2, lanes_t m3) {
+    const uint32_t lo = lanes_movemask(vcgtq_s16(m0.lo, m1.lo), vcgtq_s16(m2.lo, m3.lo));
+    const uint32_t hi = lanes_movemask(vcgtq_s16(m0.hi, m1.hi), vcgtq_s16(m2.hi, m3.hi));
+    return lo | (hi << 16);
+}
+#else
+#pragma message("DAB_VITERBI_BATCH_DECODER using crossplatform SCALAR")
+struct lanes_t { int16_t x[L]; };
+static inline lanes_t lanes_load(const int16_t* p) { lanes_t a; memcpy(a.x, p, sizeof(a.x)); return a; }
+static inline lanes_t lanes_load_symbols(const int8_t* p) { lanes_t a; for (size_t i = 0; i < L; i++) a.x[i] = int16_t(p[i]); return a; }
+static inline void lanes_store(int16_t* p, lanes_t a) { memcpy(p, a.x, sizeof(a.x)); }
+static inline lanes_t lanes_add(lanes_t a, lanes_t b) { for (size_t i = 0; i < L; i++) a.x[i] = int16_t(a.x[i]+b.x[i]); return a; }
+static inline lanes_t lanes_sub(lanes_t a, lanes_t b) { for (size_t i = 0; i < L; i++) a.x[i] = int16_t(a.x[i]-b.x[i]); return a; }
+static inline lanes_t lanes_min(lanes_t a, lanes_t b) { for (size_t i = 0; i < L; i++) a.x[i] = std::min(a.x[i], b.x[i]); return a; }
+static inline lanes_t lanes_neg(lanes_t a) { for (size_t i = 0; i < L; i++) a.x[i] = int16_t(-a.x[i]); return a; }
+static inline uint32_t lanes_decisions(lanes_t m0, lanes_t m1, lanes_t m2, lanes_t m3) {
+    uint32_t decisions = 0;
+    for (size_t i = 0; i < L; i++) {
+        decisions |= uint32_t(m0.x[i] > m1.x[i]) << get_decision_bit(i, 0);
+        decisions |= uint32_t(m2.x[i] > m3.x[i]) << get_decision_bit(i, 1);
+    }
+    return decisions;
+}
+#endif
+
+// Compile time selected add compare select for all butterflies of a step
+static void update_butterflies(
+    const viterbi_bit_t* step_symbols, const int16_t* old_metrics, int16_t* new_metrics, uint32_t* decisions) 
+{
+    // branch metrics shared by all butterflies
+    const lanes_t x0 = lanes_load_symbols(&step_symbols[0*L]);
+    const lanes_t x1 = lanes_load_symbols(&step_symbols[1*L]);
+    const lanes_t x2 = lanes_load_symbols(&step_symbols[2*L]);
+    const lanes_t x3 = lanes_load_symbols(&step_symbols[3*L]);
+    const lanes_t a = lanes_add(x0, x3);
+    const lanes_t a_add_b = lanes_add(a, x1);
+    const lanes_t a_sub_b = lanes_sub(a, x1);
+    lanes_t branch[8];
+    branch[0] = lanes_add(a_add_b, x2);
+    branch[1] = lanes_sub(a_add_b, x2);
+    branch[2] = lanes_add(a_sub_b, x2);
+    branch[3] = lanes_sub(a_sub_b, x2);
+    for (size_t i = 0; i < 4; i++) {
+        branch[i+4] = lanes_neg(branch[i]);
+    }
+
+    // add compare select where the metric is the negated correlation so we keep the minimum
+    for (size_t i = 0; i < NB_BUTTERFLIES; i++) {
+        const lanes_t c = branch[BRANCH_INDEX.index[i]];
+        const lanes_t upper = lanes_load(&old_metrics[i*L]);
+        const lanes_t lower = lanes_load(&old_metrics[(i+NB_BUTTERFLIES)*L]);
+        const lanes_t m0 = lanes_sub(upper, c);
+        const lanes_t m1 = lanes_add(lower, c);
+        const lanes_t m2 = lanes_add(upper, c);
+        const lanes_t m3 = lanes_sub(lower, c);
+        lanes_store(&new_metrics[(2*i+0)*L], lanes_min(m0, m1));
+        lanes_store(&new_metrics[(2*i+1)*L], lanes_min(m2, m3));
+        decisions[i] = lanes_decisions(m0, m1, m2, m3);
+    }
+}
+
+// Runtime selected AVX512 add compare select which updates two butterflies at once
+// Each 512bit vector holds the metrics of two consecutive states for all 16 lanes
+// NOTE: The output states of the butterflies are interleaved so they are stored as [2i,2i+1] and [2i+2,2i+3]
+#if defined(__ARCH_X86__) && defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+SIMD_IGNORE_UNINITIALIZED_PUSH
+SIMD_TARGET_AVX512 static void update_butterflies_avx512(
+    const viterbi_bit_t* step_symbols, const int16_t* old_metrics, int16_t* new_metrics, uint32_t* decisions) 
+{
+    const __m256i x0 = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(&step_symbols[0*L])));
+    const __m256i x1 = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(&step_symbols[1*L])));
+    const __m256i x2 = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(&step_symbols[2*L])));
+    const __m256i x3 = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(&step_symbols[3*L])));
+    const __m256i a = _mm256_add_epi16(x0, x3);
+    const __m256i a_add_b = _mm256_add_epi16(a, x1);
+    const __m256i a_sub_b = _mm256_sub_epi16(a, x1);
+    __m256i branch[8];
+    branch[0] = _mm256_add_epi16(a_add_b, x2);
+    branch[1] = _mm256_sub_epi16(a_add_b, x2);
+    branch[2] = _mm256_add_epi16(a_sub_b, x2);
+    branch[3] = _mm256_sub_epi16(a_sub_b, x2);
+    for (size_t i = 0; i < 4; i++) {
+        branch[i+4] = _mm256_sub_epi16(_mm256_setzero_si256(), branch[i]);
+    }
+
+    // Select the 256bit halves so the new states are stored in order
+    constexpr int SELECT_LOW_PAIRS = 0b01'00'01'00;
+    constexpr int SELECT_HIGH_PAIRS = 0b11'10'11'10;
+    for (size_t i = 0; i < NB_BUTTERFLIES; i+=2) {
+        const __m512i c = _mm512_inserti64x4(
+            _mm512_castsi256_si512(branch[BRANCH_INDEX.index[i]]),
+            branch[BRANCH_INDEX.index[i+1]], 1);
+        const __m512i upper = _mm512_load_si512(&old_metrics[i*L]);
+        const __m512i lower = _mm512_load_si512(&old_metrics[(i+NB_BUTTERFLIES)*L]);
+        const __m512i m0 = _mm512_sub_epi16(upper, c);
+        const __m512i m1 = _mm512_add_epi16(lower, c);
+        const __m512i m2 = _mm512_add_epi16(upper, c);
+        const __m512i m3 = _mm512_sub_epi16(lower, c);
+        // min(m0,m1) = [2i,2i+2], min(m2,m3) = [2i+1,2i+3]
+        const __m512i y0 = _mm512_min_epi16(m0, m1);
+        const __m512i y1 = _mm512_min_epi16(m2, m3);
+        _mm512_store_si512(&new_metrics[(2*i+0)*L], _mm512_shuffle_i64x2(y0, y1, SELECT_LOW_PAIRS));
+        _mm512_store_si512(&new_metrics[(2*i+2)*L], _mm512_shuffle_i64x2(y0, y1, SELECT_HIGH_PAIRS));
+        // Same packing as the 256bit decisions for each butterfly
+        const __m512i d0 = _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(m0, m1));
+        const __m512i d1 = _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(m2, m3));
+        const uint64_t d = uint64_t(_mm512_movepi8_mask(_mm512_packs_epi16(d0, d1)));
+        decisions[i+0] = uint32_t(d);
+        decisions[i+1] = uint32_t(d >> 32);
+    }
+}
+SIMD_IGNORE_UNINITIALIZED_POP
+#endif
+
+// Branch metrics of all lanes for the scalable vector add compare selects
+// NOTE: The lanes are read from memory so any vector length can process them
+#if (defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)) || (defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV))
+static void get_branch_metrics(const viterbi_bit_t* step_symbols, int16_t branch[8][L]) {
+    for (size_t l = 0; l < L; l++) {
+        const int16_t x0 = int16_t(step_symbols[0*L+l]);
+        const int16_t x1 = int16_t(step_symbols[1*L+l]);
+        const int16_t x2 = int16_t(step_symbols[2*L+l]);
+        const int16_t x3 = int16_t(step_symbols[3*L+l]);
+        const int16_t a = int16_t(x0+x3);
+        branch[0][l] = int16_t(a+x1+x2);
+        branch[1][l] = int16_t(a+x1-x2);
+        branch[2][l] = int16_t(a-x1+x2);
+        branch[3][l] = int16_t(a-x1-x2);
+        for (size_t i = 0; i < 4; i++) {
+            branch[i+4][l] = int16_t(-branch[i][l]);
+        }
+    }
+}
+#endif
+
+// Runtime selected vector length agnostic add compare select
+// The 16 lanes of a butterfly are processed in as many vectors as the implementation needs
+// NOTE: Vectors wider than 256bits are predicated down to the 16 lanes
+#if defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+#include <arm_sve.h>
+static void update_butterflies_sve2(
+    const viterbi_bit_t* step_symbols, const int16_t* old_metrics, int16_t* new_metrics, uint32_t* decisions) 
+{
+    alignas(32) int16_t branch[8][L];
+    get_branch_metrics(step_symbols, branch);
+    for (size_t i = 0; i < NB_BUTTERFLIES; i++) {
+        decisions[i] = 0;
+    }
+
+    const size_t K = svcnth();
+    for (size_t l = 0; l < L; l+=K) {
+        const svbool_t pg = svwhilelt_b16(l, L);
+        // SVE has no move mask so the decision bits are found with a bitwise or reduction of weights
+        // Lanes [0..7] and [8..15] are reduced separately since they are stored in different bytes
+        const svuint16_t lane = svindex_u16(uint16_t(l), 1);
+        const svbool_t pg_lo = svcmplt_n_u16(pg, lane, 8);
+        const svbool_t pg_hi = svcmpge_n_u16(pg, lane, 8);
+        const svuint16_t weight = svlsl_u16_x(pg, svdup_n_u16(1), svand_n_u16_x(pg, lane, 0b111));
+        for (size_t i = 0; i < NB_BUTTERFLIES; i++) {
+            const svint16_t c = svld1_s16(pg, &branch[BRANCH_INDEX.index[i]][l]);
+            const svint16_t upper = svld1_s16(pg, &old_metrics[i*L+l]);
+            const svint16_t lower = svld1_s16(pg, &old_metrics[(i+NB_BUTTERFLIES)*L+l]);
+            const svint16_t m0 = svsub_s16_x(pg, upper, c);
+            const svint16_t m1 = svadd_s16_x(pg, lower, c);
+            const svint16_t m2 = svadd_s16_x(pg, upper, c);
+            const svint16_t m3 = svsub_s16_x(pg, lower, c);
+            svst1_s16(pg, &new_metrics[(2*i+0)*L+l], svmin_s16_x(pg, m0, m1));
+            svst1_s16(pg, &new_metrics[(2*i+1)*L+l], svmin_s16_x(pg, m2, m3));
+            const svbool_t d0 = svcmpgt_s16(pg, m0, m1);
+            const svbool_t d1 = svcmpgt_s16(pg, m2, m3);
+            decisions[i] |=
+                (uint32_t(svorv_u16(svand_b_z(pg, d0, pg_lo), weight)) << 0)  |
+                (uint32_t(svorv_u16(svand_b_z(pg, d1, pg_lo), weight)) << 8)  |
+                (uint32_t(svorv_u16(svand_b_z(pg, d0, pg_hi), weight)) << 16) |
+                (uint32_t(svorv_u16(svand_b_z(pg, d1, pg_hi), weight)) << 24);
+        }
+    }
+}
+#endif
+
+#if defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+#include <riscv_vector.h>
+// The comparison masks are stored to memory as one bit per lane
+static inline uint32_t rvv_get_lane_mask(const vbool8_t mask, const size_t vl) {
+    uint8_t bytes[2] = { 0, 0 };
+    __riscv_vsm_v_b8(bytes, mask, vl);
+    // the bits past the vector length are undefined
+    return (uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8)) & ((uint32_t(1) << vl) - 1);
+}
+
+static void update_butterflies_rvv(
+    const viterbi_bit_t* step_symbols, const int16_t* old_metrics, int16_t* new_metrics, uint32_t* decisions) 
+{
+    alignas(32) int16_t branch[8][L];
+    get_branch_metrics(step_symbols, branch);
+
+    // NOTE: The V extension has at least 128bit vectors so LMUL=2 holds all 16 lanes in one pass
+    for (size_t i = 0; i < NB_BUTTERFLIES; i++) {
+        const int16_t* c_buf = branch[BRANCH_INDEX.index[i]];
+        uint32_t lane_mask_0 = 0;
+        uint32_t lane_mask_1 = 0;
+        for (size_t l = 0, vl = 0; l < L; l+=vl) {
+            vl = __riscv_vsetvl_e16m2(L-l);
+            const vint16m2_t c = __riscv_vle16_v_i16m2(&c_buf[l], vl);
+            const vint16m2_t upper = __riscv_vle16_v_i16m2(&old_metrics[i*L+l], vl);
+            const vint16m2_t lower = __riscv_vle16_v_i16m2(&old_metrics[(i+NB_BUTTERFLIES)*L+l], vl);
+            const vint16m2_t m0 = __riscv_vsub_vv_i16m2(upper, c, vl);
+            const vint16m2_t m1 = __riscv_vadd_vv_i16m2(lower, c, vl);
+            const vint16m2_t m2 = __riscv_vadd_vv_i16m2(upper, c, vl);
+            const vint16m2_t m3 = __riscv_vsub_vv_i16m2(lower, c, vl);
+            __riscv_vse16_v_i16m2(&new_metrics[(2*i+0)*L+l], __riscv_vmin_vv_i16m2(m0, m1, vl), vl);
+            __riscv_vse16_v_i16m2(&new_metrics[(2*i+1)*L+l], __riscv_vmin_vv_i16m2(m2, m3, vl), vl);
+            lane_mask_0 |= rvv_get_lane_mask(__riscv_vmsgt_vv_i16m2_b8(m0, m1, vl), vl) << l;
+            lane_mask_1 |= rvv_get_lane_mask(__riscv_vmsgt_vv_i16m2_b8(m2, m3, vl), vl) << l;
+        }
+        decisions[i] =
+            ((lane_mask_0 & 0xFF) << 0)  |
+            ((lane_mask_1 & 0xFF) << 8)  |
+            ((lane_mask_0 >> 8)   << 16) |
+            ((lane_mask_1 >> 8)   << 24);
+    }
+}
+#endif
+
+using update_butterflies_t = void (*)(const viterbi_bit_t*, const int16_t*, int16_t*, uint32_t*);
+
+static update_butterflies_t select_update_butterflies() {
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__) && defined(SIMD_COMPILE_AVX512)
+    if (simd_is_level_at_least(level, SIMD_Level::AVX512)) return &update_butterflies_avx512;
+    #elif defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+    if (simd_is_level_at_least(level, SIMD_Level::SVE2)) return &update_butterflies_sve2;
+    #elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+    if (simd_is_level_at_least(level, SIMD_Level::RVV)) return &update_butterflies_rvv;
+    #endif
+    (void)level;
+    return &update_butterflies;
+}
+
+DAB_Viterbi_Batch_Decoder::DAB_Viterbi_Batch_Decoder()
+: m_symbols(AlignedAllocator<viterbi_bit_t>(32)), m_decisions(), 
+  m_traceback_length(DEFAULT_TRACEBACK_LENGTH), m_lane_bytes(), m_lane_total_bytes(0),
+  m_end_metrics(L*NB_STATES), m_total_steps(0)
+{
+    reset();
+}
+
+DAB_Viterbi_Batch_Decoder::~DAB_Viterbi_Batch_Decoder() = default;
+
+void DAB_Viterbi_Batch_Decoder::set_traceback_length(const size_t traceback_length) {
+    m_traceback_length = traceback_length;
+}
+
+size_t DAB_Viterbi_Batch_Decoder::get_current_decoded_bit(const size_t lane) const {
+    assert(lane < L);
+    return m_lane_steps[lane];
+}
+
+void DAB_Viterbi_Batch_Decoder::reset() {
+    // Unused lanes and the ends of shorter lanes are run with punctured symbols
+    std::fill(m_symbols.begin(), m_symbols.end(), soft_decision_unpunctured);
+    for (size_t i = 0; i < L; i++) {
+        m_lane_steps[i] = 0;
+        m_lane_offset[i] = 0;
+    }
+    m_total_steps = 0;
+}
+
+size_t DAB_Viterbi_Batch_Decoder::update(
+    const size_t lane,
+    tcb::span<const viterbi_bit_t> punctured_symbols,
+    tcb::span<const uint8_t> puncture_code,
+    const size_t requested_output_symbols
+) {
+    assert(lane < L);
+    assert(requested_output_symbols % R == 0);
+
+    const size_t total_steps = m_lane_steps[lane] + requested_output_symbols/R;
+    if (total_steps*R*L > m_symbols.size()) {
+        m_symbols.resize(total_steps*R*L, soft_decision_unpunctured);
+    }
+
+    const size_t total_punctured_symbols = punctured_symbols.size();
+    const size_t total_puncture_code = puncture_code.size();
+    size_t index_punctured_symbol = 0;
+    size_t index_puncture_code = 0;
+    size_t index_step = m_lane_steps[lane];
+
+    while (index_step < total_steps) {
+        // NOTE: Puncture codes store the number of transmitted symbols in each block of R symbols
+        const size_t total_block_punctured = size_t(puncture_code[index_puncture_code]);
+        const size_t remaining_punctured = total_punctured_symbols - index_punctured_symbol;
+        assert(remaining_punctured >= total_block_punctured);
+        if (remaining_punctured < total_block_punctured) {
+            break;
+        }
+
+        viterbi_bit_t* step_symbols = &m_symbols[index_step*R*L + lane];
+        for (size_t i = 0; i < R; i++) {
+            step_symbols[i*L] = (i < total_block_punctured) ?
+                punctured_symbols[index_punctured_symbol+i] : soft_decision_unpunctured;
+        }
+        index_punctured_symbol += total_block_punctured;
+        index_puncture_code = (index_puncture_code+1) % total_puncture_code;
+        index_step++;
+    }
+
+    m_lane_steps[lane] = index_step;
+    m_total_steps = std::max(m_total_steps, index_step);
+    return index_punctured_symbol;
+}
+
+size_t DAB_Viterbi_Batch_Decoder::update(
+    const size_t lane, tcb::span<const viterbi_bit_t> punctured_symbols, const DAB_Depuncture_Plan& plan)
+{
+    assert(lane < L);
+    const size_t total_punctured_symbols = plan.get_total_input_symbols();
+    const size_t total_output_symbols = plan.get_total_output_symbols();
+    assert(total_output_symbols % R == 0);
+    assert(punctured_symbols.size() >= total_punctured_symbols);
+    if (punctured_symbols.size() < total_punctured_symbols) {
+        return 0;
+    }
+
+    const size_t total_steps = m_lane_steps[lane] + total_output_symbols/R;
+    if (total_steps*R*L > m_symbols.size()) {
+        m_symbols.resize(total_steps*R*L, soft_decision_unpunctured);
+    }
+
+    m_gather_symbols.resize(total_punctured_symbols+1);
+    m_gather_symbols[0] = soft_decision_unpunctured;
+    memcpy(&m_gather_symbols[1], punctured_symbols.data(), total_punctured_symbols*sizeof(viterbi_bit_t));
+
+    // symbols of a lane are strided by the number of lanes
+    const auto indices = plan.get_indices();
+    viterbi_bit_t* lane_symbols = &m_symbols[m_lane_steps[lane]*R*L + lane];
+    for (size_t i = 0; i < total_output_symbols; i++) {
+        lane_symbols[i*L] = m_gather_symbols[indices[i]];
+    }
+
+    m_lane_steps[lane] = total_steps;
+    m_total_steps = std::max(m_total_steps, total_steps);
+    return total_punctured_symbols;
+}
+
+void DAB_Viterbi_Batch_Decoder::decode() {
+    const size_t D = m_traceback_length;
+    const bool is_sliding_window = (D > 0);
+    const size_t total_decision_steps = is_sliding_window ? 2*D : m_total_steps;
+    if (total_decision_steps*NB_BUTTERFLIES > m_decisions.size()) {
+        m_decisions.resize(total_decision_steps*NB_BUTTERFLIES);
+    }
+    if (is_sliding_window) {
+        m_lane_total_bytes = (m_total_steps+7)/8;
+        m_lane_bytes.resize(L*m_lane_total_bytes);
+        std::fill(m_lane_bytes.begin(), m_lane_bytes.end(), uint8_t(0));
+    }
+    // number of bits decoded by the sliding window for each lane
+    size_t lane_decoded_bits[L] = { 0 };
+
+    alignas(64) int16_t metrics_buf[2][NB_STATES*L];
+    int16_t* old_metrics = metrics_buf[0];
+    int16_t* new_metrics = metrics_buf[1];
+    for (size_t s = 0; s < NB_STATES; s++) {
+        for (size_t l = 0; l < L; l++) {
+            old_metrics[s*L+l] = (s == 0) ? 0 : INITIAL_NON_START_METRIC;
+        }
+    }
+    int64_t offsets[L] = { 0 };
+
+    const auto update_butterflies_selected = select_update_butterflies();
+
+    for (size_t step = 0; step < m_total_steps; step++) {
+        const viterbi_bit_t* step_symbols = &m_symbols[step*R*L];
+        uint32_t* decisions = &m_decisions[get_decision_index(step)];
+        update_butterflies_selected(step_symbols, old_metrics, new_metrics, decisions);
+        std::swap(old_metrics, new_metrics);
+
+        if (((step+1) % RENORMALISATION_INTERVAL) == 0) {
+            lanes_t min_metric = lanes_load(&old_metrics[0]);
+            for (size_t s = 1; s < NB_STATES; s++) {
+                min_metric = lanes_min(min_metric, lanes_load(&old_metrics[s*L]));
+            }
+            for (size_t s = 0; s < NB_STATES; s++) {
+                lanes_store(&old_metrics[s*L], lanes_sub(lanes_load(&old_metrics[s*L]), min_metric));
+            }
+            alignas(32) int16_t min_values[L];
+            lanes_store(min_values, min_metric);
+            for (size_t l = 0; l < L; l++) {
+                offsets[l] += int64_t(min_values[l]);
+            }
+        }
+
+        // keep the final metrics of lanes which end on this step
+        const size_t total_steps = step+1;
+        for (size_t l = 0; l < L; l++) {
+            if (m_lane_steps[l] != total_steps) continue;
+            for (size_t s = 0; s < NB_STATES; s++) {
+                m_end_metrics[l*NB_STATES+s] = old_metrics[s*L+l];
+            }
+            m_lane_offset[l] = offsets[l];
+            // flush the remaining bits of the sliding window
+            if (is_sliding_window) {
+                auto lane_bytes = tcb::span(m_lane_bytes).subspan(l*m_lane_total_bytes, m_lane_total_bytes);
+                traceback(l, 0, total_steps, lane_decoded_bits[l], total_steps, lane_bytes);
+                lane_decoded_bits[l] = total_steps;
+            }
+        }
+
+        // Sliding window traceback where the survivor paths have merged after D steps
+        // We traceback the last 2D steps from the best state and decode the oldest D bits
+        const bool is_window_full = is_sliding_window && (total_steps >= 2*D) && ((total_steps % D) == 0);
+        if (!is_window_full) continue;
+        for (size_t l = 0; l < L; l++) {
+            if (m_lane_steps[l] <= total_steps) continue;
+            size_t best_state = 0;
+            for (size_t s = 1; s < NB_STATES; s++) {
+                if (old_metrics[s*L+l] < old_metrics[best_state*L+l]) {
+                    best_state = s;
+                }
+            }
+            auto lane_bytes = tcb::span(m_lane_bytes).subspan(l*m_lane_total_bytes, m_lane_total_bytes);
+            traceback(l, best_state, total_steps, total_steps-2*D, total_steps-D, lane_bytes);
+            lane_decoded_bits[l] = total_steps-D;
+        }
+    }
+}
+
+size_t DAB_Viterbi_Batch_Decoder::get_decision_index(const size_t step) const {
+    const size_t index = (m_traceback_length > 0) ? (step % (2*m_traceback_length)) : step;
+    return index*NB_BUTTERFLIES;
+}
+
+void DAB_Viterbi_Batch_Decoder::traceback(
+    const size_t lane, size_t state, 
+    const size_t end_step, const size_t start_step, const size_t output_end_step, 
+    tcb::span<uint8_t> bytes_out) 
+{
+    // The decision bit of a lane only depends on the parity of the state after the lane is fixed
+    const size_t lane_decision_bit = get_decision_bit(lane, 0);
+    const size_t total_decision_steps = (m_traceback_length > 0) ? 2*m_traceback_length : m_total_steps;
+    // NOTE: The circular buffer index is walked backwards instead of taking a modulo each step
+    size_t decision_step = (end_step > 0) ? ((get_decision_index(end_step-1))/NB_BUTTERFLIES) : 0;
+    auto step_back = [&]() {
+        const uint32_t decisions = m_decisions[decision_step*NB_BUTTERFLIES + (state >> 1)];
+        const size_t decision = (decisions >> (lane_decision_bit + 8*(state & 0b1))) & 0b1;
+        state = (state >> 1) | (decision << (K-2));
+        decision_step = (decision_step == 0) ? (total_decision_steps-1) : (decision_step-1);
+    };
+
+    // Steps after the output are only followed to reach the decoded steps
+    size_t step = end_step;
+    const size_t output_start_step = std::max(output_end_step, start_step);
+    for (; step > output_start_step; step--) {
+        step_back();
+    }
+
+    // The newest input bit is the lsb of the state it leads to
+    auto output_bit = [&]() {
+        const size_t curr_step = step-1;
+        bytes_out[curr_step/8] |= uint8_t((state & 0b1) << (7 - (curr_step % 8)));
+        step_back();
+        step--;
+    };
+    // Finish the partial byte at the end of the output
+    for (; (step > start_step) && ((step % 8) != 0); ) {
+        output_bit();
+    }
+    // Decode a whole byte every 8 stages so the bits are packed in a register
+    for (; step >= start_step+8; step -= 8) {
+        uint8_t byte = 0;
+        for (size_t i = 0; i < 8; i++) {
+            byte |= uint8_t((state & 0b1) << i);
+            step_back();
+        }
+        bytes_out[step/8 - 1] |= byte;
+    }
+    // Partial byte at the start of the output
+    for (; step > start_step; ) {
+        output_bit();
+    }
+}
+
+uint64_t DAB_Viterbi_Batch_Decoder::chainback(const size_t lane, tcb::span<uint8_t> bytes_out, const size_t end_state) {
+    assert(lane < L);
+    const size_t total_steps = m_lane_steps[lane];
+    const size_t total_bits = bytes_out.size()*8u;
+    assert(total_bits <= total_steps);
+
+    if (m_traceback_length > 0) {
+        assert(end_state == 0);
+        memcpy(bytes_out.data(), &m_lane_bytes[lane*m_lane_total_bytes], bytes_out.size());
+    } else {
+        memset(bytes_out.data(), 0, bytes_out.size());
+        traceback(lane, end_state % NB_STATES, total_steps, 0, total_bits, bytes_out);
+    }
+
+    // Error is the sum of absolute differences between the received and expected symbols
+    // This is recovered from the correlation metric since |x-y| = HIGH - x*sign(y)
+    const int64_t metric = int64_t(m_end_metrics[lane*NB_STATES + (end_state % NB_STATES)]) + m_lane_offset[lane];
+    const int64_t error = int64_t(total_steps*R)*int64_t(soft_decision_high) + metric;
+    return uint64_t(std::max(error, int64_t(0)));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "viterbi_config.h"
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+
+class DAB_Depuncture_Plan;
+
+// Decodes multiple independent DAB trellises at once with one trellis per SIMD lane
+// Each lane is depunctured separately so lanes can have different puncture codes and lengths
+// NOTE: This is a 64 state soft decision decoder for the DAB mother code (K=7, R=1/4)
+//       The metrics are stored state major so each vector holds the same state of every lane
+class DAB_Viterbi_Batch_Decoder
+{
+public:
+    static constexpr size_t m_constraint_length = 7;
+    static constexpr size_t m_code_rate = 4;
+    static constexpr size_t TOTAL_LANES = 16;
+    static constexpr size_t TOTAL_STATES = size_t(1) << (m_constraint_length-1);
+    // Punctured codes need a deeper traceback than the usual 5*K before paths merge
+    static constexpr size_t DEFAULT_TRACEBACK_LENGTH = 5*m_constraint_length*m_code_rate;
+private:
+    // depunctured symbols interleaved as [step][code_rate][lane]
+    // NOTE: These are kept at their received width and widened while calculating the branch metrics
+    std::vector<viterbi_bit_t, AlignedAllocator<viterbi_bit_t>> m_symbols;
+    // received symbols with an erasure prepended for depuncturing with a plan
+    std::vector<viterbi_bit_t> m_gather_symbols;
+    // decision bits of each butterfly packed into 32bits for all lanes as [step][butterfly]
+    // NOTE: With a sliding window this is a circular buffer of the last 2*traceback_length steps
+    std::vector<uint32_t> m_decisions;
+    size_t m_traceback_length;
+    // bits decoded by the sliding window as [lane][byte]
+    std::vector<uint8_t> m_lane_bytes;
+    size_t m_lane_total_bytes;
+    // path metrics of all lanes at the end of each lane
+    std::vector<int16_t> m_end_metrics;
+    size_t m_lane_steps[TOTAL_LANES];
+    int64_t m_lane_offset[TOTAL_LANES];
+    size_t m_total_steps;
+public:
+    DAB_Viterbi_Batch_Decoder();
+    ~DAB_Viterbi_Batch_Decoder();
+    size_t get_total_lanes() const { return TOTAL_LANES; }
+    // Decisions are only kept for a sliding window of 2*traceback_length steps
+    // The oldest traceback_length bits are decoded each time the window has advanced by traceback_length
+    // NOTE: traceback_length=0 keeps the decisions of the whole trellis until chainback()
+    void set_traceback_length(const size_t traceback_length);
+    size_t get_traceback_length() const { return m_traceback_length; }
+    size_t get_current_decoded_bit(const size_t lane) const;
+    // Clears the symbols of all lanes
+    void reset();
+    // Depunctures symbols into a lane and returns the number of punctured symbols consumed
+    // NOTE: The trellis is only run when decode() is called
+    size_t update(
+        const size_t lane,
+        tcb::span<const viterbi_bit_t> punctured_symbols,
+        tcb::span<const uint8_t> puncture_code,
+        const size_t requested_output_symbols
+    );
+    // Same as above but depunctures the whole codeword with a precomputed plan
+    size_t update(const size_t lane, tcb::span<const viterbi_bit_t> punctured_symbols, const DAB_Depuncture_Plan& plan);
+    // Runs all lanes through the trellis in one pass
+    void decode();
+    // NOTE: With a sliding window the bits were already decoded by decode() assuming an end state of 0
+    //       This is the case for DAB since the 6 tail bits flush the encoder
+    uint64_t chainback(const size_t lane, tcb::span<uint8_t> bytes_out, const size_t end_state=0u);
+private:
+    size_t get_decision_index(const size_t step) const;
+    void traceback(
+        const size_t lane, size_t state, 
+        const size_t end_step, const size_t start_step, const size_t output_end_step, 
+        tcb::span<uint8_t> bytes_out);
+};
@@ -2,15 +2,20 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <vector>
 #include "detect_architecture.h"
 #include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 #include "utility/span.h"
 #include "viterbi/viterbi_branch_table.h"
 #include "viterbi/viterbi_decoder_config.h"
 #include "viterbi/viterbi_decoder_core.h"
 #include "viterbi_config.h"
+#include "./dab_depuncture_plan.h"
 
 // DOC: ETSI EN 300 401
 // Clause 11.1 - Convolutional code
@@ -26,6 +31,10 @@ const uint8_t code_polynomial[R] = { 109, 79, 83, 109 };
 constexpr int16_t soft_decision_low = int16_t(SOFT_DECISION_VITERBI_LOW);
 constexpr int16_t soft_decision_high = int16_t(SOFT_DECISION_VITERBI_HIGH);
 constexpr int16_t soft_decision_unpunctured = int16_t(SOFT_DECISION_VITERBI_PUNCTURED);
+// 8bit metrics need the soft decisions scaled down so a step changes a metric by at most R*(high-low)=32
+// The metrics of the survivor paths then stay within (K-1)*32 of each other and fit in a uint8
+constexpr int8_t soft_decision_u8_high = +4;
+constexpr int8_t soft_decision_u8_low = -4;
 
 // Use same configuration for all decoders
 static ViterbiDecoder_Config<uint16_t> create_decoder_config() {
@@ -40,60 +49,240 @@ static ViterbiDecoder_Config<uint16_t> create_decoder_config() {
 }
 static const auto decoder_config = create_decoder_config();
 
+// Renormalise once the metrics are within two steps of overflowing
+static ViterbiDecoder_Config<uint8_t> create_decoder_config_u8() {
+    const uint8_t max_error = uint8_t(soft_decision_u8_high-soft_decision_u8_low) * uint8_t(DAB_Viterbi_Decoder::m_code_rate);
+    const uint8_t error_margin = max_error * uint8_t(2u);
+    ViterbiDecoder_Config<uint8_t> config;
+    config.soft_decision_max_error = max_error;
+    config.initial_start_error = std::numeric_limits<uint8_t>::min();
+    config.initial_non_start_error = config.initial_start_error + error_margin;
+    config.renormalisation_threshold = std::numeric_limits<uint8_t>::max() - error_margin;
+    return config; 
+}
+static const auto decoder_config_u8 = create_decoder_config_u8();
+
 // Share the branch table for all decoders
 // This saves memory since we don't reallocate the same table for each decoder instance
 static const auto decoder_branch_table = ViterbiBranchTable<K,R,int16_t>(
     code_polynomial,
     soft_decision_high, soft_decision_low
 );
+static const auto decoder_branch_table_u8 = ViterbiBranchTable<K,R,int8_t>(
+    code_polynomial,
+    soft_decision_u8_high, soft_decision_u8_low
+);
+
+using Core = ViterbiDecoder_Core<K,R,uint16_t,int16_t>;
+using Core_u8 = ViterbiDecoder_Core<K,R,uint8_t,int8_t>;
 
-// Wrap compile time selected decoder for forward declaration
+// Include every decoder that can be selected
+// NOTE: The x86 decoders are compiled for their instruction set so they can be selected at runtime
+#include "viterbi/viterbi_decoder_scalar.h"
 #if defined(__ARCH_X86__)
-    #if defined(__AVX2__)
-        #pragma message("DAB_VITERBI_DECODER using x86 AVX2")
+    #if defined(SIMD_COMPILE_SSE4_1)
+        SIMD_TARGET_PUSH_SSE4_1
+        #include "viterbi/x86/viterbi_decoder_sse_u16.h"
+        #include "viterbi/x86/viterbi_decoder_sse_u8.h"
+        SIMD_TARGET_POP
+    #endif
+    #if defined(SIMD_COMPILE_AVX2)
+        SIMD_TARGET_PUSH_AVX2
         #include "viterbi/x86/viterbi_decoder_avx_u16.h"
-        using Decoder = ViterbiDecoder_AVX_u16<K,R>;
+        #include "viterbi/x86/viterbi_decoder_avx_u8.h"
+        SIMD_TARGET_POP
+    #endif
+    #if defined(SIMD_RUNTIME_DISPATCH)
+        #pragma message("DAB_VITERBI_DECODER using x86 runtime dispatch")
+    #elif defined(__AVX2__)
+        #pragma message("DAB_VITERBI_DECODER using x86 AVX2")
     #elif defined(__SSE4_1__)
         #pragma message("DAB_VITERBI_DECODER using x86 SSE4.1")
-        #include "viterbi/x86/viterbi_decoder_sse_u16.h"
-        using Decoder = ViterbiDecoder_SSE_u16<K,R>;
     #else
         #pragma message("DAB_VITERBI_DECODER using x86 SCALAR")
-        #include "viterbi/viterbi_decoder_scalar.h"
-        using Decoder = ViterbiDecoder_Scalar<K,R,uint16_t,int16_t>;
     #endif
 #elif defined(__ARCH_AARCH64__)
     #pragma message("DAB_VITERBI_DECODER using ARM AARCH64 NEON")
     #include "viterbi/arm/viterbi_decoder_neon_u16.h"
-    using Decoder = ViterbiDecoder_NEON_u16<K,R>;
+    #include "viterbi/arm/viterbi_decoder_neon_u8.h"
 #else
     #pragma message("DAB_VITERBI_DECODER using crossplatform SCALAR")
-    #include "viterbi/viterbi_decoder_scalar.h"
-    using Decoder = ViterbiDecoder_Scalar<K,R,uint16_t,int16_t>;
 #endif
 
-using Core = ViterbiDecoder_Core<K,R,uint16_t,int16_t>;
-class DAB_Viterbi_Decoder_Internal: public Core
+// Runtime selected decoder
+static uint64_t update_decoder(Core& core, const int16_t* symbols, const size_t total_symbols) {
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return ViterbiDecoder_AVX_u16<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return ViterbiDecoder_SSE_u16<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return ViterbiDecoder_NEON_u16<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+    #endif
+    (void)level;
+    return ViterbiDecoder_Scalar<K,R,uint16_t,int16_t>::update<uint64_t>(core, symbols, total_symbols);
+}
+
+static uint64_t update_decoder(Core_u8& core, const int8_t* symbols, const size_t total_symbols) {
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return ViterbiDecoder_AVX_u8<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return ViterbiDecoder_SSE_u8<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return ViterbiDecoder_NEON_u8<K,R>::update<uint64_t>(core, symbols, total_symbols);
+        }
+    #endif
+    (void)level;
+    return ViterbiDecoder_Scalar<K,R,uint8_t,int8_t>::update<uint64_t>(core, symbols, total_symbols);
+}
+
+// Rescale soft decisions from [-127,+127] to [-4,+4] with rounding
+static inline int8_t quantise_symbol_u8(const int16_t x) {
+    const int32_t y = int32_t(x)*int32_t(soft_decision_u8_high);
+    const int32_t half = int32_t(soft_decision_high)/2;
+    return int8_t((y + ((y >= 0) ? half : -half)) / int32_t(soft_decision_high));
+}
+
+// Errors are reported in the units of the 16bit decoder so both can be compared
+static inline uint64_t rescale_error_u8(const uint64_t error) {
+    return error*uint64_t(soft_decision_high)/uint64_t(soft_decision_u8_high);
+}
+
+static inline uint32_t get_parity(uint32_t x) {
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 0b1;
+}
+
+// Only the core with the selected metric width is created
+class DAB_Viterbi_Decoder_Internal
 {
+private:
+    std::unique_ptr<Core> m_core_u16;
+    std::unique_ptr<Core_u8> m_core_u8;
+    std::vector<int8_t> m_symbols_u8;
 public:
-    template <typename ... U>
-    DAB_Viterbi_Decoder_Internal(U&& ... args): Core(std::forward<U>(args)...) {}
+    explicit DAB_Viterbi_Decoder_Internal(const DAB_Viterbi_Decoder::Metric metric) {
+        if (metric == DAB_Viterbi_Decoder::Metric::U8) {
+            m_core_u8 = std::make_unique<Core_u8>(decoder_branch_table_u8, decoder_config_u8);
+        } else {
+            m_core_u16 = std::make_unique<Core>(decoder_branch_table, decoder_config);
+        }
+    }
+    void set_traceback_length(const size_t traceback_length) {
+        if (m_core_u8) {
+            m_core_u8->set_traceback_length(traceback_length);
+        } else {
+            m_core_u16->set_traceback_length(traceback_length);
+        }
+    }
+    size_t get_traceback_length() const {
+        if (m_core_u8) return m_core_u8->get_traceback_length();
+        return m_core_u16->get_traceback_length();
+    }
+    size_t get_current_decoded_bit() const {
+        if (m_core_u8) return m_core_u8->m_current_decoded_bit;
+        return m_core_u16->m_current_decoded_bit;
+    }
+    // NOTE: The core keeps one decision bit per state for every stage it can trace back over
+    //       along with the current and next path metrics of each state
+    size_t get_memory_bytes() const {
+        constexpr size_t TOTAL_STATES = size_t(1) << (DAB_Viterbi_Decoder::m_constraint_length-1);
+        const size_t total_stages = get_traceback_length() + DAB_Viterbi_Decoder::m_constraint_length;
+        const size_t metric_bytes = m_core_u8 ? sizeof(uint8_t) : sizeof(uint16_t);
+        const size_t decision_bytes = total_stages*TOTAL_STATES/8;
+        return decision_bytes + 2*TOTAL_STATES*metric_bytes + m_symbols_u8.capacity()*sizeof(int8_t);
+    }
+    void reset(const size_t starting_state) {
+        if (m_core_u8) {
+            m_core_u8->reset(starting_state);
+        } else {
+            m_core_u16->reset(starting_state);
+        }
+    }
+    uint64_t update(const int16_t* symbols, const size_t total_symbols) {
+        if (m_core_u16) return update_decoder(*m_core_u16, symbols, total_symbols);
+        m_symbols_u8.resize(total_symbols);
+        for (size_t i = 0; i < total_symbols; i++) {
+            m_symbols_u8[i] = quantise_symbol_u8(symbols[i]);
+        }
+        return rescale_error_u8(update_decoder(*m_core_u8, m_symbols_u8.data(), total_symbols));
+    }
+    uint64_t chainback(uint8_t* bytes_out, const size_t total_bits, const size_t end_state) {
+        if (m_core_u16) {
+            m_core_u16->chainback(bytes_out, total_bits, end_state);
+            return uint64_t(m_core_u16->get_error());
+        }
+        m_core_u8->chainback(bytes_out, total_bits, end_state);
+        return rescale_error_u8(uint64_t(m_core_u8->get_error()));
+    }
 };
 
-
-DAB_Viterbi_Decoder::DAB_Viterbi_Decoder()
-: m_depunctured_symbols(), m_accumulated_error(0)
+DAB_Viterbi_Decoder::DAB_Viterbi_Decoder(const Metric metric)
+: m_metric(metric), m_depunctured_symbols(), m_total_depunctured_symbols(0), m_accumulated_error(0)
 {
-    m_decoder = std::make_unique<DAB_Viterbi_Decoder_Internal>(
-        decoder_branch_table,
-        decoder_config
-    );
+    m_decoder = std::make_unique<DAB_Viterbi_Decoder_Internal>(m_metric);
 }
 
 DAB_Viterbi_Decoder::~DAB_Viterbi_Decoder() {
 
 }
 
+// Memory then scales with the number of worker threads instead of the number of subchannels
+// and the decisions of each worker stay warm in its cache
+static std::atomic<size_t> total_thread_memory_bytes{0};
+
+struct Thread_Decoder {
+    std::unique_ptr<DAB_Viterbi_Decoder> decoder = nullptr;
+    size_t memory_bytes = 0;
+    // NOTE: The buffers of the previous codeword are counted the next time the decoder is borrowed
+    void update_memory_bytes() {
+        const size_t new_bytes = decoder->get_memory_bytes();
+        total_thread_memory_bytes.fetch_add(new_bytes, std::memory_order_relaxed);
+        total_thread_memory_bytes.fetch_sub(memory_bytes, std::memory_order_relaxed);
+        memory_bytes = new_bytes;
+    }
+    ~Thread_Decoder() {
+        total_thread_memory_bytes.fetch_sub(memory_bytes, std::memory_order_relaxed);
+    }
+};
+
+DAB_Viterbi_Decoder& DAB_Viterbi_Decoder::borrow_thread_decoder(const size_t traceback_length) {
+    static thread_local Thread_Decoder thread_decoder;
+    if (thread_decoder.decoder == nullptr) {
+        thread_decoder.decoder = std::make_unique<DAB_Viterbi_Decoder>();
+    }
+    auto& decoder = *thread_decoder.decoder;
+    if (decoder.get_traceback_length() < traceback_length) {
+        decoder.set_traceback_length(traceback_length);
+    }
+    thread_decoder.update_memory_bytes();
+    return decoder;
+}
+
+size_t DAB_Viterbi_Decoder::get_total_thread_memory_bytes() {
+    return total_thread_memory_bytes.load(std::memory_order_relaxed);
+}
+
 void DAB_Viterbi_Decoder::set_traceback_length(const size_t traceback_length) {
     m_decoder->set_traceback_length(traceback_length);
 }
@@ -103,11 +292,20 @@ size_t DAB_Viterbi_Decoder::get_traceback_length() const {
 }
 
 size_t DAB_Viterbi_Decoder::get_current_decoded_bit() const {
-    return m_decoder->m_current_decoded_bit;
+    return m_decoder->get_current_decoded_bit();
 };
 
+size_t DAB_Viterbi_Decoder::get_memory_bytes() const {
+    return
+        m_decoder->get_memory_bytes() +
+        m_depunctured_symbols.capacity()*sizeof(int16_t) +
+        m_gather_symbols.capacity()*sizeof(int16_t) +
+        m_stage_soft_errors.capacity()*sizeof(uint32_t);
+}
+
 void DAB_Viterbi_Decoder::reset(const size_t starting_state) {
     m_decoder->reset(starting_state);
+    m_total_depunctured_symbols = 0;
     m_accumulated_error = 0;
 }
 
@@ -117,17 +315,102 @@ size_t DAB_Viterbi_Decoder::update(
     const size_t requested_output_symbols
 ) {
     const auto res = depuncture_symbols(punctured_symbols, puncture_code, requested_output_symbols);
-    m_accumulated_error += Decoder::update<uint64_t>(*m_decoder.get(), m_depunctured_symbols.data(), res.total_output_symbols);
+    const int16_t* symbols = &m_depunctured_symbols[m_total_depunctured_symbols];
+    m_accumulated_error += m_decoder->update(symbols, res.total_output_symbols);
+    m_total_depunctured_symbols += res.total_output_symbols;
     return res.total_punctured_symbols;
 }
 
+size_t DAB_Viterbi_Decoder::update(
+    tcb::span<const viterbi_bit_t> punctured_symbols, const DAB_Depuncture_Plan& plan)
+{
+    const size_t total_punctured_symbols = plan.get_total_input_symbols();
+    const size_t total_output_symbols = plan.get_total_output_symbols();
+    assert(punctured_symbols.size() >= total_punctured_symbols);
+    if (punctured_symbols.size() < total_punctured_symbols) {
+        return 0;
+    }
+
+    const size_t total_required_symbols = m_total_depunctured_symbols + total_output_symbols;
+    if (total_required_symbols > m_depunctured_symbols.size()) {
+        m_depunctured_symbols.resize(total_required_symbols);
+    }
+
+    int16_t* symbols = &m_depunctured_symbols[m_total_depunctured_symbols];
+    if (plan.get_is_specialised()) {
+        plan.depuncture(punctured_symbols.data(), symbols);
+    } else {
+        m_gather_symbols.resize(total_punctured_symbols+1);
+        m_gather_symbols[0] = soft_decision_unpunctured;
+        for (size_t i = 0; i < total_punctured_symbols; i++) {
+            m_gather_symbols[i+1] = int16_t(punctured_symbols[i]);
+        }
+        const auto indices = plan.get_indices();
+        for (size_t i = 0; i < total_output_symbols; i++) {
+            symbols[i] = m_gather_symbols[indices[i]];
+        }
+    }
+
+    m_accumulated_error += m_decoder->update(symbols, total_output_symbols);
+    m_total_depunctured_symbols += total_output_symbols;
+    return total_punctured_symbols;
+}
+
 uint64_t DAB_Viterbi_Decoder::chainback(tcb::span<uint8_t> bytes_out, const size_t end_state) {
     const size_t total_bits = bytes_out.size()*8u;
-    m_decoder->chainback(bytes_out.data(), total_bits, end_state);
-    const uint64_t error = m_accumulated_error + uint64_t(m_decoder->get_error());
+    const uint64_t error = m_accumulated_error + m_decoder->chainback(bytes_out.data(), total_bits, end_state);
+    return error;
+}
+
+uint64_t DAB_Viterbi_Decoder::chainback(
+    tcb::span<uint8_t> bytes_out, tcb::span<uint16_t> byte_soft_errors_out, const size_t end_state) 
+{
+    const uint64_t error = chainback(bytes_out, end_state);
+    calculate_byte_soft_errors(bytes_out, byte_soft_errors_out);
     return error;
 }
 
+void DAB_Viterbi_Decoder::calculate_byte_soft_errors(
+    tcb::span<const uint8_t> bytes, tcb::span<uint16_t> byte_soft_errors_out) 
+{
+    assert(byte_soft_errors_out.size() == bytes.size());
+    const size_t total_bits = bytes.size()*8u;
+    const size_t total_stages = m_total_depunctured_symbols / R;
+
+    // Re-encode the decoded bits and compare them against the received symbols
+    // NOTE: The encoder starts from state 0 (reset) and is flushed with zero tail bits
+    m_stage_soft_errors.resize(total_stages);
+    uint32_t encoder_state = 0;
+    for (size_t stage = 0; stage < total_stages; stage++) {
+        uint32_t bit = 0;
+        if (stage < total_bits) {
+            bit = (bytes[stage/8u] >> (7u-(stage%8u))) & 0b1;
+        }
+        encoder_state = ((encoder_state << 1) | bit) & ((1u << K)-1u);
+        uint32_t soft_error = 0;
+        for (size_t i = 0; i < R; i++) {
+            const uint32_t parity = get_parity(encoder_state & code_polynomial[i]);
+            const int16_t symbol = m_depunctured_symbols[stage*R + i];
+            // Punctured symbols are 0 and never disagree
+            const int16_t mismatch = parity ? int16_t(-symbol) : symbol;
+            soft_error += uint32_t(std::max(mismatch, int16_t(0)));
+        }
+        m_stage_soft_errors[stage] = soft_error;
+    }
+
+    // A byte affects its own 8 stages and the next K-1 stages while it is in the encoder
+    constexpr uint32_t MAX_SOFT_ERROR = uint32_t(std::numeric_limits<uint16_t>::max());
+    for (size_t i = 0; i < bytes.size(); i++) {
+        const size_t stage_start = std::min(i*8u, total_stages);
+        const size_t stage_end = std::min(i*8u + 8u + K-1u, total_stages);
+        uint32_t soft_error = 0;
+        for (size_t stage = stage_start; stage < stage_end; stage++) {
+            soft_error += m_stage_soft_errors[stage];
+        }
+        byte_soft_errors_out[i] = uint16_t(std::min(soft_error, MAX_SOFT_ERROR));
+    }
+}
+
 DAB_Viterbi_Decoder::depuncture_res DAB_Viterbi_Decoder::depuncture_symbols(
     tcb::span<const viterbi_bit_t> punctured_symbols, 
     tcb::span<const uint8_t> puncture_code,
@@ -139,8 +422,9 @@ DAB_Viterbi_Decoder::depuncture_res DAB_Viterbi_Decoder::depuncture_symbols(
     const size_t total_puncture_code = puncture_code.size();
 
     // Resize only if we need more depunctured symbols
-    if (requested_output_symbols > m_depunctured_symbols.size()) {
-        m_depunctured_symbols.resize(requested_output_symbols);
+    const size_t total_required_symbols = m_total_depunctured_symbols + requested_output_symbols;
+    if (total_required_symbols > m_depunctured_symbols.size()) {
+        m_depunctured_symbols.resize(total_required_symbols);
     }
 
     depuncture_res res;
@@ -150,6 +434,7 @@ DAB_Viterbi_Decoder::depuncture_res DAB_Viterbi_Decoder::depuncture_symbols(
     size_t index_punctured_symbol = 0;
     size_t index_puncture_code = 0;
     size_t index_output_symbol = 0;
+    auto output_symbols = tcb::span(m_depunctured_symbols).subspan(m_total_depunctured_symbols, requested_output_symbols);
 
     while (index_output_symbol < requested_output_symbols) {
         const size_t total_block_punctured = size_t(puncture_code[index_puncture_code]);
@@ -162,13 +447,13 @@ DAB_Viterbi_Decoder::depuncture_res DAB_Viterbi_Decoder::depuncture_symbols(
         }
 
         for (size_t i = 0; i < total_block_punctured; i++)  {
-            m_depunctured_symbols[index_output_symbol] = int16_t(punctured_symbols[index_punctured_symbol]);
+            output_symbols[index_output_symbol] = int16_t(punctured_symbols[index_punctured_symbol]);
             index_punctured_symbol++;
             index_output_symbol++;
         }
 
         for (size_t i = 0; i < total_block_unpunctured; i++)  {
-            m_depunctured_symbols[index_output_symbol] = soft_decision_unpunctured;
+            output_symbols[index_output_symbol] = soft_decision_unpunctured;
             index_output_symbol++;
         }
 
@@ -8,29 +8,56 @@
 #include "utility/span.h"
 
 class DAB_Viterbi_Decoder_Internal;
+class DAB_Depuncture_Plan;
 
 class DAB_Viterbi_Decoder 
 {
 public:
     static constexpr size_t m_constraint_length = 7;
     static constexpr size_t m_code_rate = 4;
+    // U16 = 16bit path metrics with the full soft decision range
+    // U8  = 8bit path metrics with soft decisions quantised to 4 bits and more frequent renormalisation
+    //       This fits twice as many states in each vector at a loss of about 0.2dB from the quantisation
+    //       Refer to BM_DAB_Viterbi_BER in the benchmarks for the bit error rate of each
+    enum class Metric { U16, U8 };
 private:
+    const Metric m_metric;
     std::unique_ptr<DAB_Viterbi_Decoder_Internal> m_decoder;
+    // every depunctured symbol since reset() is kept to measure the reliability of the decoded bytes
     std::vector<int16_t> m_depunctured_symbols;
+    size_t m_total_depunctured_symbols;
+    // received symbols with an erasure prepended for depuncturing with a plan
+    std::vector<int16_t> m_gather_symbols;
+    std::vector<uint32_t> m_stage_soft_errors;
     uint64_t m_accumulated_error;
 public:
-    DAB_Viterbi_Decoder();
+    explicit DAB_Viterbi_Decoder(const Metric metric=Metric::U16);
     ~DAB_Viterbi_Decoder();
+    Metric get_metric() const { return m_metric; }
     void set_traceback_length(const size_t traceback_length);
     size_t get_traceback_length() const;
     size_t get_current_decoded_bit() const;
+    // Heap bytes of the symbol buffers and an estimate of the decisions kept by the core for traceback
+    size_t get_memory_bytes() const;
     void reset(const size_t starting_state=0u);
     size_t update(
         tcb::span<const viterbi_bit_t> punctured_symbols,
         tcb::span<const uint8_t> puncture_code,
         const size_t requested_output_symbols
     );
+    // Same as above but depunctures the whole codeword with a precomputed plan
+    size_t update(tcb::span<const viterbi_bit_t> punctured_symbols, const DAB_Depuncture_Plan& plan);
     uint64_t chainback(tcb::span<uint8_t> bytes_out, const size_t end_state=0u);
+    // Same as above but also gives the soft error of each decoded byte (higher is less reliable)
+    // This is how far the received symbols disagree with the re-encoded decoded bits
+    // over every trellis stage the byte affects, so bytes on a weak survivor path stand out
+    uint64_t chainback(tcb::span<uint8_t> bytes_out, tcb::span<uint16_t> byte_soft_errors_out, const size_t end_state=0u);
+    // Working state shared by every decoder on the calling thread since each codeword starts from reset()
+    // The traceback only grows so it ends up sized to the largest codeword decoded on that thread
+    // NOTE: The decoder must be reset, updated and chained back without decoding anything else on the thread
+    static DAB_Viterbi_Decoder& borrow_thread_decoder(const size_t traceback_length);
+    // Heap bytes of the decoders held by every thread that has borrowed one
+    static size_t get_total_thread_memory_bytes();
 private:
     struct depuncture_res {
         size_t total_output_symbols;
@@ -42,4 +69,5 @@ private:
         tcb::span<const uint8_t> puncture_code,
         const size_t requested_output_symbols
     );
+    void calculate_byte_soft_errors(tcb::span<const uint8_t> bytes, tcb::span<uint16_t> byte_soft_errors_out);
 };
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "./hard_bit_packing.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+static constexpr viterbi_bit_t MID_POINT = (SOFT_DECISION_VITERBI_HIGH+SOFT_DECISION_VITERBI_LOW)/2;
+// The sign bit is used as the hard decision in the vectorised packers
+static_assert(MID_POINT == 0, "Hard decisions must be the sign of the soft bit");
+
+static void pack_hard_bits_scalar(
+    tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes, const size_t byte_start)
+{
+    for (size_t i = byte_start; i < bytes.size(); i++) {
+        uint8_t v = 0;
+        for (size_t j = 0; j < HARD_BITS_PER_BYTE; j++) {
+            const uint8_t bit = (bits[i*HARD_BITS_PER_BYTE+j] >= MID_POINT) ? 0b1 : 0b0;
+            v |= uint8_t(bit << j);
+        }
+        bytes[i] = v;
+    }
+}
+
+static void unpack_hard_bits_scalar(
+    tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits, const size_t byte_start)
+{
+    for (size_t i = byte_start; i < bytes.size(); i++) {
+        const uint8_t v = bytes[i];
+        for (size_t j = 0; j < HARD_BITS_PER_BYTE; j++) {
+            const uint8_t bit = (v >> j) & 0b1;
+            bits[i*HARD_BITS_PER_BYTE+j] = bit ? SOFT_DECISION_VITERBI_HIGH : SOFT_DECISION_VITERBI_LOW;
+        }
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <tmmintrin.h>
+// 16 soft bits = 2 bytes per iteration
+SIMD_TARGET_SSE4_1 static void pack_hard_bits_sse4_1(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes) {
+    constexpr size_t K = 2;
+    const size_t N = (bytes.size()/K)*K;
+    for (size_t i = 0; i < N; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bits[i*HARD_BITS_PER_BYTE]));
+        // movemask collects the sign bits which are set for negative soft bits
+        const uint16_t v = uint16_t(~_mm_movemask_epi8(X));
+        bytes[i+0] = uint8_t(v);
+        bytes[i+1] = uint8_t(v >> 8);
+    }
+    pack_hard_bits_scalar(bits, bytes, N);
+}
+
+SIMD_TARGET_SSE4_1 static void unpack_hard_bits_sse4_1(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 2;
+    const size_t N = (bytes.size()/K)*K;
+    // byte i is broadcast to soft bits 8i to 8i+7 which each test a different bit
+    const __m128i shuffle = _mm_setr_epi8(0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1);
+    const __m128i bit_mask = _mm_setr_epi8(1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128);
+    const __m128i high = _mm_set1_epi8(SOFT_DECISION_VITERBI_HIGH);
+    const __m128i low = _mm_set1_epi8(SOFT_DECISION_VITERBI_LOW);
+    for (size_t i = 0; i < N; i+=K) {
+        const uint16_t v = uint16_t(bytes[i]) | uint16_t(bytes[i+1] << 8);
+        const __m128i X = _mm_shuffle_epi8(_mm_cvtsi32_si128(int(v)), shuffle);
+        const __m128i is_high = _mm_cmpeq_epi8(_mm_and_si128(X, bit_mask), bit_mask);
+        const __m128i Y = _mm_blendv_epi8(low, high, is_high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bits[i*HARD_BITS_PER_BYTE]), Y);
+    }
+    unpack_hard_bits_scalar(bytes, bits, N);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+// 32 soft bits = 4 bytes per iteration
+SIMD_TARGET_AVX2 static void pack_hard_bits_avx2(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes) {
+    constexpr size_t K = 4;
+    const size_t N = (bytes.size()/K)*K;
+    for (size_t i = 0; i < N; i+=K) {
+        const __m256i X = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&bits[i*HARD_BITS_PER_BYTE]));
+        const uint32_t v = ~uint32_t(_mm256_movemask_epi8(X));
+        bytes[i+0] = uint8_t(v);
+        bytes[i+1] = uint8_t(v >> 8);
+        bytes[i+2] = uint8_t(v >> 16);
+        bytes[i+3] = uint8_t(v >> 24);
+    }
+    pack_hard_bits_scalar(bits, bytes, N);
+}
+
+SIMD_TARGET_AVX2 static void unpack_hard_bits_avx2(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 4;
+    const size_t N = (bytes.size()/K)*K;
+    // shuffles are within each 128bit lane so both lanes get all 4 bytes
+    const __m256i shuffle = _mm256_setr_epi8(
+        0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1,
+        2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3);
+    const __m256i bit_mask = _mm256_setr_epi8(
+        1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128,
+        1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128);
+    const __m256i high = _mm256_set1_epi8(SOFT_DECISION_VITERBI_HIGH);
+    const __m256i low = _mm256_set1_epi8(SOFT_DECISION_VITERBI_LOW);
+    for (size_t i = 0; i < N; i+=K) {
+        const uint32_t v =
+            uint32_t(bytes[i]) | (uint32_t(bytes[i+1]) << 8) |
+            (uint32_t(bytes[i+2]) << 16) | (uint32_t(bytes[i+3]) << 24);
+        const __m256i X = _mm256_shuffle_epi8(_mm256_set1_epi32(int(v)), shuffle);
+        const __m256i is_high = _mm256_cmpeq_epi8(_mm256_and_si256(X, bit_mask), bit_mask);
+        const __m256i Y = _mm256_blendv_epi8(low, high, is_high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&bits[i*HARD_BITS_PER_BYTE]), Y);
+    }
+    unpack_hard_bits_scalar(bytes, bits, N);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+// 16 soft bits = 2 bytes per iteration
+static void pack_hard_bits_neon(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes) {
+    constexpr size_t K = 2;
+    const size_t N = (bytes.size()/K)*K;
+    static const uint8_t BIT_MASK[16] = {1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128};
+    const uint8x16_t bit_mask = vld1q_u8(BIT_MASK);
+    for (size_t i = 0; i < N; i+=K) {
+        const int8x16_t X = vld1q_s8(&bits[i*HARD_BITS_PER_BYTE]);
+        // there is no movemask so each set bit is weighted and summed across each half
+        const uint8x16_t Y = vandq_u8(vcgezq_s8(X), bit_mask);
+        bytes[i+0] = vaddv_u8(vget_low_u8(Y));
+        bytes[i+1] = vaddv_u8(vget_high_u8(Y));
+    }
+    pack_hard_bits_scalar(bits, bytes, N);
+}
+
+static void unpack_hard_bits_neon(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 2;
+    const size_t N = (bytes.size()/K)*K;
+    static const uint8_t BIT_MASK[16] = {1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128};
+    const uint8x16_t bit_mask = vld1q_u8(BIT_MASK);
+    const int8x16_t high = vdupq_n_s8(SOFT_DECISION_VITERBI_HIGH);
+    const int8x16_t low = vdupq_n_s8(SOFT_DECISION_VITERBI_LOW);
+    for (size_t i = 0; i < N; i+=K) {
+        const uint8x16_t X = vcombine_u8(vdup_n_u8(bytes[i]), vdup_n_u8(bytes[i+1]));
+        const uint8x16_t is_high = vtstq_u8(X, bit_mask);
+        vst1q_s8(&bits[i*HARD_BITS_PER_BYTE], vbslq_s8(is_high, high, low));
+    }
+    unpack_hard_bits_scalar(bytes, bits, N);
+}
+
+#endif
+
+void pack_hard_bits_auto(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes) {
+    assert(bits.size() == bytes.size()*HARD_BITS_PER_BYTE);
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return pack_hard_bits_avx2(bits, bytes);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return pack_hard_bits_sse4_1(bits, bytes);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return pack_hard_bits_neon(bits, bytes);
+        }
+    #endif
+    (void)level;
+    pack_hard_bits_scalar(bits, bytes, 0);
+}
+
+void unpack_hard_bits_auto(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits) {
+    assert(bits.size() == bytes.size()*HARD_BITS_PER_BYTE);
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return unpack_hard_bits_avx2(bytes, bits);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return unpack_hard_bits_sse4_1(bytes, bits);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return unpack_hard_bits_neon(bytes, bits);
+        }
+    #endif
+    (void)level;
+    unpack_hard_bits_scalar(bytes, bits, 0);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Soft bits reduced to hard decisions with eight bits per byte
+// Soft bit 8i+j is bit j of byte i where non-negative soft bits are 1
+// NOTE: bits.size() must be 8*bytes.size() so callers buffer any partial byte
+static constexpr size_t HARD_BITS_PER_BYTE = 8;
+
+void pack_hard_bits_auto(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> bytes);
+// Hard bits are expanded to SOFT_DECISION_VITERBI_HIGH or SOFT_DECISION_VITERBI_LOW
+void unpack_hard_bits_auto(tcb::span<const uint8_t> bytes, tcb::span<viterbi_bit_t> bits);
@@ -3,9 +3,14 @@
  * May be used under the terms of the GNU Lesser General Public License (LGPL)
  */
 #include "./reed_solomon_decoder.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
 // alloca() for windows
 #if _WIN32
 #include <malloc.h>
@@ -477,6 +482,151 @@ finish:
 }
 // NOLINTEND
 
+// Syndromes of interleaved codewords
+// Multiplying by a constant is linear over GF(2) so x*c = lo[x & 0xF] ^ hi[x >> 4]
+// Each root has a 32 byte table of lo[16] followed by hi[16]
+constexpr size_t SYNDROME_TABLE_SIZE = 32;
+
+static void find_clean_codewords_scalar(
+    const uint8_t* tables, const int nb_roots, const int nb_message_bytes,
+    const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out)
+{
+    for (size_t i = 0; i < is_clean_out.size(); i++) {
+        uint8_t syndromes = 0;
+        for (int r = 0; r < nb_roots; r++) {
+            const uint8_t* lo = &tables[size_t(r)*SYNDROME_TABLE_SIZE];
+            const uint8_t* hi = lo + 16;
+            uint8_t s = 0;
+            for (int j = 0; j < nb_message_bytes; j++) {
+                s = lo[s & 0x0F] ^ hi[s >> 4] ^ data[i + size_t(j)*stride];
+            }
+            syndromes |= s;
+        }
+        is_clean_out[i] = (syndromes == 0) ? 1 : 0;
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <tmmintrin.h>
+
+SIMD_TARGET_SSE4_1 static void find_clean_codewords_sse4_1(
+    const uint8_t* tables, const int nb_roots, const int nb_message_bytes,
+    const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out)
+{
+    // 128bits = 16 codewords
+    const size_t K = 16u;
+    const size_t N = is_clean_out.size();
+    const size_t N_vector = (N/K)*K;
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i one = _mm_set1_epi8(1);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m128i syndromes = _mm_setzero_si128();
+        for (int r = 0; r < nb_roots; r++) {
+            const uint8_t* table = &tables[size_t(r)*SYNDROME_TABLE_SIZE];
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table+16));
+            __m128i s = _mm_setzero_si128();
+            for (int j = 0; j < nb_message_bytes; j++) {
+                const __m128i s_lo = _mm_and_si128(s, nibble_mask);
+                const __m128i s_hi = _mm_and_si128(_mm_srli_epi16(s, 4), nibble_mask);
+                const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i + size_t(j)*stride]));
+                s = _mm_xor_si128(_mm_shuffle_epi8(lo, s_lo), _mm_shuffle_epi8(hi, s_hi));
+                s = _mm_xor_si128(s, X);
+            }
+            syndromes = _mm_or_si128(syndromes, s);
+        }
+        const __m128i is_clean = _mm_and_si128(_mm_cmpeq_epi8(syndromes, _mm_setzero_si128()), one);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&is_clean_out[i]), is_clean);
+    }
+    find_clean_codewords_scalar(tables, nb_roots, nb_message_bytes, data + N_vector, stride, is_clean_out.subspan(N_vector));
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+
+SIMD_TARGET_AVX2 static void find_clean_codewords_avx2(
+    const uint8_t* tables, const int nb_roots, const int nb_message_bytes,
+    const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out)
+{
+    // 256bits = 32 codewords
+    const size_t K = 32u;
+    const size_t N = is_clean_out.size();
+    const size_t N_vector = (N/K)*K;
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    const __m256i one = _mm256_set1_epi8(1);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m256i syndromes = _mm256_setzero_si256();
+        for (int r = 0; r < nb_roots; r++) {
+            // shuffles only index within each 128bit lane so the tables are repeated
+            const uint8_t* table = &tables[size_t(r)*SYNDROME_TABLE_SIZE];
+            const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+            const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table+16)));
+            __m256i s = _mm256_setzero_si256();
+            for (int j = 0; j < nb_message_bytes; j++) {
+                const __m256i s_lo = _mm256_and_si256(s, nibble_mask);
+                const __m256i s_hi = _mm256_and_si256(_mm256_srli_epi16(s, 4), nibble_mask);
+                const __m256i X = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i + size_t(j)*stride]));
+                s = _mm256_xor_si256(_mm256_shuffle_epi8(lo, s_lo), _mm256_shuffle_epi8(hi, s_hi));
+                s = _mm256_xor_si256(s, X);
+            }
+            syndromes = _mm256_or_si256(syndromes, s);
+        }
+        const __m256i is_clean = _mm256_and_si256(_mm256_cmpeq_epi8(syndromes, _mm256_setzero_si256()), one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&is_clean_out[i]), is_clean);
+    }
+    #if defined(SIMD_COMPILE_SSE4_1)
+    find_clean_codewords_sse4_1(tables, nb_roots, nb_message_bytes, data + N_vector, stride, is_clean_out.subspan(N_vector));
+    #else
+    find_clean_codewords_scalar(tables, nb_roots, nb_message_bytes, data + N_vector, stride, is_clean_out.subspan(N_vector));
+    #endif
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+static void find_clean_codewords_neon(
+    const uint8_t* tables, const int nb_roots, const int nb_message_bytes,
+    const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out)
+{
+    // 128bits = 16 codewords
+    const size_t K = 16u;
+    const size_t N = is_clean_out.size();
+    const size_t N_vector = (N/K)*K;
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0F);
+    const uint8x16_t one = vdupq_n_u8(1);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        uint8x16_t syndromes = vdupq_n_u8(0);
+        for (int r = 0; r < nb_roots; r++) {
+            const uint8_t* table = &tables[size_t(r)*SYNDROME_TABLE_SIZE];
+            const uint8x16_t lo = vld1q_u8(table);
+            const uint8x16_t hi = vld1q_u8(table+16);
+            uint8x16_t s = vdupq_n_u8(0);
+            for (int j = 0; j < nb_message_bytes; j++) {
+                const uint8x16_t s_lo = vandq_u8(s, nibble_mask);
+                const uint8x16_t s_hi = vshrq_n_u8(s, 4);
+                const uint8x16_t X = vld1q_u8(&data[i + size_t(j)*stride]);
+                s = veorq_u8(vqtbl1q_u8(lo, s_lo), vqtbl1q_u8(hi, s_hi));
+                s = veorq_u8(s, X);
+            }
+            syndromes = vorrq_u8(syndromes, s);
+        }
+        const uint8x16_t is_clean = vandq_u8(vceqq_u8(syndromes, vdupq_n_u8(0)), one);
+        vst1q_u8(&is_clean_out[i], is_clean);
+    }
+    find_clean_codewords_scalar(tables, nb_roots, nb_message_bytes, data + N_vector, stride, is_clean_out.subspan(N_vector));
+}
+#endif
+
+static uint8_t gf_mul(struct RS_data* rs, const uint8_t x, const int power) {
+    if (x == 0) return 0;
+    return rs->alpha_to[modnn(rs, int(rs->index_of[x]) + power)];
+}
+
 // C++ wrapper code
 Reed_Solomon_Decoder::Reed_Solomon_Decoder(
     const int symbol_size, const int galois_field_polynomial,
@@ -485,6 +635,20 @@ Reed_Solomon_Decoder::Reed_Solomon_Decoder(
     m_rs = init_rs_char(
         symbol_size, galois_field_polynomial,
         fcr, primer, nb_roots, pad);
+
+    // Syndrome i is evaluated at the root α^((fcr+i)*prim) using Horner's method
+    // NOTE: The nibble tables only work with 8bit symbols
+    if ((m_rs == nullptr) || (symbol_size != 8)) return;
+    m_syndrome_tables.resize(size_t(nb_roots)*SYNDROME_TABLE_SIZE);
+    for (int i = 0; i < nb_roots; i++) {
+        const int power = modnn(m_rs, (fcr+i)*primer);
+        uint8_t* lo = &m_syndrome_tables[size_t(i)*SYNDROME_TABLE_SIZE];
+        uint8_t* hi = lo + 16;
+        for (int x = 0; x < 16; x++) {
+            lo[x] = gf_mul(m_rs, uint8_t(x), power);
+            hi[x] = gf_mul(m_rs, uint8_t(x << 4), power);
+        }
+    }
 }
 
 Reed_Solomon_Decoder::~Reed_Solomon_Decoder() {
@@ -493,4 +657,36 @@ Reed_Solomon_Decoder::~Reed_Solomon_Decoder() {
 
 int Reed_Solomon_Decoder::Decode(uint8_t* data, int* eras_pos, int no_eras) {
     return decode_rs_char(m_rs, data, eras_pos, no_eras);
+}
+
+void Reed_Solomon_Decoder::FindCleanCodewords(const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out) const {
+    // Codewords are left for Decode() if we don't have tables for it
+    if (m_syndrome_tables.empty()) {
+        for (auto& v: is_clean_out) v = 0;
+        return;
+    }
+    const uint8_t* tables = m_syndrome_tables.data();
+    const int nb_roots = m_rs->nroots;
+    const int nb_message_bytes = m_rs->nn - m_rs->pad;
+
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return find_clean_codewords_avx2(tables, nb_roots, nb_message_bytes, data, stride, is_clean_out);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return find_clean_codewords_sse4_1(tables, nb_roots, nb_message_bytes, data, stride, is_clean_out);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return find_clean_codewords_neon(tables, nb_roots, nb_message_bytes, data, stride, is_clean_out);
+        }
+    #endif
+    (void)level;
+    find_clean_codewords_scalar(tables, nb_roots, nb_message_bytes, data, stride, is_clean_out);
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
+#include <vector>
+#include "utility/span.h"
 
 /* These are the function definitions for Phil Karn's 2002 Reed Solomon decoder
  * A mirror of his code is found here: https://github.com/zleffke/libfec
@@ -14,6 +17,8 @@ class Reed_Solomon_Decoder
 {
 private:
     struct RS_data* m_rs;
+    // split nibble multiplication tables used to find the syndromes of many codewords at once
+    std::vector<uint8_t> m_syndrome_tables;
 public:
     Reed_Solomon_Decoder(
         const int symbol_size, const int galois_field_polynomial,
@@ -24,6 +29,10 @@ public:
     Reed_Solomon_Decoder& operator=(Reed_Solomon_Decoder&) = delete;
     Reed_Solomon_Decoder& operator=(Reed_Solomon_Decoder&&) = delete;
     int Decode(uint8_t* data, int* eras_pos, int no_eras);
+    // Finds the codewords with zero syndromes which Decode() would leave unmodified
+    // Byte j of codeword i is data[i + j*stride] which is how DAB+ superframes are interleaved
+    // is_clean_out[i] is 1 if codeword i has no errors otherwise 0
+    void FindCleanCodewords(const uint8_t* data, const size_t stride, tcb::span<uint8_t> is_clean_out) const;
 };
 
 
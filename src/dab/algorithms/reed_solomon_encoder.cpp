@@ -0,0 +1,49 @@
+#include "./reed_solomon_encoder.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+Reed_Solomon_Encoder::Reed_Solomon_Encoder(const int galois_field_polynomial, const int fcr, const int nb_roots)
+: m_nb_roots(nb_roots)
+{
+    constexpr int NB_SYMBOLS = 255;
+    assert((nb_roots > 0) && (nb_roots < NB_SYMBOLS));
+    m_exp.resize(2*NB_SYMBOLS);
+    m_log.resize(NB_SYMBOLS+1, 0);
+    int x = 1;
+    for (int i = 0; i < NB_SYMBOLS; i++) {
+        m_exp[size_t(i)] = uint8_t(x);
+        m_log[size_t(x)] = uint8_t(i);
+        x <<= 1;
+        if (x & 0x100) x ^= galois_field_polynomial;
+    }
+    for (int i = NB_SYMBOLS; i < 2*NB_SYMBOLS; i++) {
+        m_exp[size_t(i)] = m_exp[size_t(i-NB_SYMBOLS)];
+    }
+
+    m_generator.resize(size_t(nb_roots+1), 0);
+    m_generator[0] = 1;
+    for (int root = 0; root < nb_roots; root++) {
+        const uint8_t a = m_exp[size_t((fcr+root) % NB_SYMBOLS)];
+        m_generator[size_t(root+1)] = Multiply(m_generator[size_t(root)], a);
+        for (int i = root; i > 0; i--) {
+            m_generator[size_t(i)] ^= Multiply(m_generator[size_t(i-1)], a);
+        }
+    }
+}
+
+void Reed_Solomon_Encoder::Encode(uint8_t* codeword, const size_t nb_data_bytes, const size_t stride) const {
+    constexpr int MAX_ROOTS = 255;
+    uint8_t remainder[MAX_ROOTS] = {0};
+    const size_t R = size_t(m_nb_roots);
+    for (size_t i = 0; i < nb_data_bytes; i++) {
+        const uint8_t feedback = codeword[i*stride] ^ remainder[0];
+        for (size_t j = 0; j < R-1; j++) {
+            remainder[j] = remainder[j+1] ^ Multiply(feedback, m_generator[j+1]);
+        }
+        remainder[R-1] = Multiply(feedback, m_generator[R]);
+    }
+    for (size_t i = 0; i < R; i++) {
+        codeword[(nb_data_bytes+i)*stride] = remainder[i];
+    }
+}
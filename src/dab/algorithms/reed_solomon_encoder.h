@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/span.h"
+
+// Systematic encoder for 8bit symbols which is the counterpart of Reed_Solomon_Decoder
+// G(x) = (x+λ^fcr)*(x+λ^(fcr+1))*...*(x+λ^(fcr+nb_roots-1))
+// Shortened codes are encoded by giving fewer data bytes since the leading zeros don't change the parity
+class Reed_Solomon_Encoder
+{
+private:
+    const int m_nb_roots;
+    std::vector<uint8_t> m_exp;
+    std::vector<uint8_t> m_log;
+    // highest degree first
+    std::vector<uint8_t> m_generator;
+public:
+    Reed_Solomon_Encoder(const int galois_field_polynomial, const int fcr, const int nb_roots);
+    // Remainder of the message multiplied by x^nb_roots and divided by the generator
+    // Byte j of the codeword is data[j*stride] and the parity follows the data at the same stride
+    // This is how DAB+ superframes interleave their codewords
+    void Encode(uint8_t* codeword, const size_t nb_data_bytes, const size_t stride=1) const;
+    int GetTotalParityBytes() const { return m_nb_roots; }
+private:
+    uint8_t Multiply(const uint8_t a, const uint8_t b) const {
+        if ((a == 0) || (b == 0)) return 0;
+        return m_exp[size_t(m_log[a]) + size_t(m_log[b])];
+    }
+};
@@ -0,0 +1,243 @@
+#include "./soft_bit_packing.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Signed 4bit value to rescaled soft bit
+// NOTE: -8 is never produced when packing so it is clamped to -7
+alignas(16) static const int8_t UNPACK_LOOKUP[16] = {
+    0*PACKED_SOFT_BIT_SCALE,  1*PACKED_SOFT_BIT_SCALE,  2*PACKED_SOFT_BIT_SCALE,  3*PACKED_SOFT_BIT_SCALE,
+    4*PACKED_SOFT_BIT_SCALE,  5*PACKED_SOFT_BIT_SCALE,  6*PACKED_SOFT_BIT_SCALE,  7*PACKED_SOFT_BIT_SCALE,
+   -7*PACKED_SOFT_BIT_SCALE, -7*PACKED_SOFT_BIT_SCALE, -6*PACKED_SOFT_BIT_SCALE, -5*PACKED_SOFT_BIT_SCALE,
+   -4*PACKED_SOFT_BIT_SCALE, -3*PACKED_SOFT_BIT_SCALE, -2*PACKED_SOFT_BIT_SCALE, -1*PACKED_SOFT_BIT_SCALE,
+};
+static_assert(PACKED_SOFT_BIT_MAX*PACKED_SOFT_BIT_SCALE <= SOFT_DECISION_VITERBI_HIGH, "Unpacked soft bits must fit");
+
+// |x| is rounded to the nearest multiple of 16 and saturated to 7
+static inline uint8_t pack_soft_bit(const viterbi_bit_t x) {
+    const int v = int(x);
+    const int a = (v < 0) ? -v : v;
+    int q = (a+8) >> 4;
+    q = (q > PACKED_SOFT_BIT_MAX) ? PACKED_SOFT_BIT_MAX : q;
+    q = (v < 0) ? -q : q;
+    return uint8_t(q) & 0x0F;
+}
+
+static void pack_soft_bits_scalar(
+    tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed, const size_t byte_start)
+{
+    const size_t N = bits.size();
+    for (size_t i = byte_start; i < packed.size(); i++) {
+        const size_t j = 2*i;
+        const uint8_t lo = pack_soft_bit(bits[j]);
+        const uint8_t hi = ((j+1) < N) ? pack_soft_bit(bits[j+1]) : 0;
+        packed[i] = uint8_t(lo | (hi << 4));
+    }
+}
+
+static void unpack_soft_bits_scalar(
+    tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits, const size_t bit_start)
+{
+    for (size_t i = bit_start; i < bits.size(); i++) {
+        const uint8_t v = packed[i/2];
+        const uint8_t q = (i % 2) ? (v >> 4) : (v & 0x0F);
+        bits[i] = viterbi_bit_t(UNPACK_LOOKUP[q]);
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <tmmintrin.h>
+// 32 soft bits = 16 packed bytes per iteration
+SIMD_TARGET_SSE4_1 static inline __m128i pack_soft_bits_quantise_sse4_1(const __m128i x) {
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    __m128i q = _mm_adds_epu8(_mm_abs_epi8(x), _mm_set1_epi8(8));
+    q = _mm_and_si128(_mm_srli_epi16(q, 4), nibble_mask);
+    q = _mm_min_epu8(q, _mm_set1_epi8(PACKED_SOFT_BIT_MAX));
+    q = _mm_sign_epi8(q, x);
+    return _mm_and_si128(q, nibble_mask);
+}
+
+SIMD_TARGET_SSE4_1 static void pack_soft_bits_sse4_1(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed) {
+    constexpr size_t K = 16;
+    const size_t N = (bits.size()/(2*K))*K;
+    const __m128i lo_mask = _mm_set1_epi16(0x00FF);
+    for (size_t i = 0; i < N; i+=K) {
+        const __m128i X0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bits[2*i]));
+        const __m128i X1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bits[2*i+K]));
+        // each 16bit pair [lo,hi] becomes lo | (hi << 4) in the low byte
+        __m128i Q0 = pack_soft_bits_quantise_sse4_1(X0);
+        __m128i Q1 = pack_soft_bits_quantise_sse4_1(X1);
+        Q0 = _mm_and_si128(_mm_or_si128(Q0, _mm_srli_epi16(Q0, 4)), lo_mask);
+        Q1 = _mm_and_si128(_mm_or_si128(Q1, _mm_srli_epi16(Q1, 4)), lo_mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&packed[i]), _mm_packus_epi16(Q0, Q1));
+    }
+    pack_soft_bits_scalar(bits, packed, N);
+}
+
+SIMD_TARGET_SSE4_1 static void unpack_soft_bits_sse4_1(tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 16;
+    const size_t N = (bits.size()/(2*K))*K;
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i lookup = _mm_load_si128(reinterpret_cast<const __m128i*>(UNPACK_LOOKUP));
+    for (size_t i = 0; i < N; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&packed[i]));
+        const __m128i lo = _mm_and_si128(X, nibble_mask);
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(X, 4), nibble_mask);
+        const __m128i Y0 = _mm_shuffle_epi8(lookup, _mm_unpacklo_epi8(lo, hi));
+        const __m128i Y1 = _mm_shuffle_epi8(lookup, _mm_unpackhi_epi8(lo, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bits[2*i]), Y0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bits[2*i+K]), Y1);
+    }
+    unpack_soft_bits_scalar(packed, bits, 2*N);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+// 64 soft bits = 32 packed bytes per iteration
+SIMD_TARGET_AVX2 static inline __m256i pack_soft_bits_quantise_avx2(const __m256i x) {
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    __m256i q = _mm256_adds_epu8(_mm256_abs_epi8(x), _mm256_set1_epi8(8));
+    q = _mm256_and_si256(_mm256_srli_epi16(q, 4), nibble_mask);
+    q = _mm256_min_epu8(q, _mm256_set1_epi8(PACKED_SOFT_BIT_MAX));
+    q = _mm256_sign_epi8(q, x);
+    return _mm256_and_si256(q, nibble_mask);
+}
+
+SIMD_TARGET_AVX2 static void pack_soft_bits_avx2(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed) {
+    constexpr size_t K = 32;
+    const size_t N = (bits.size()/(2*K))*K;
+    const __m256i lo_mask = _mm256_set1_epi16(0x00FF);
+    for (size_t i = 0; i < N; i+=K) {
+        const __m256i X0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&bits[2*i]));
+        const __m256i X1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&bits[2*i+K]));
+        __m256i Q0 = pack_soft_bits_quantise_avx2(X0);
+        __m256i Q1 = pack_soft_bits_quantise_avx2(X1);
+        Q0 = _mm256_and_si256(_mm256_or_si256(Q0, _mm256_srli_epi16(Q0, 4)), lo_mask);
+        Q1 = _mm256_and_si256(_mm256_or_si256(Q1, _mm256_srli_epi16(Q1, 4)), lo_mask);
+        // packing is done within each 128bit lane so the 64bit blocks are reordered afterwards
+        const __m256i Y = _mm256_permute4x64_epi64(_mm256_packus_epi16(Q0, Q1), 0b11'01'10'00);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&packed[i]), Y);
+    }
+    pack_soft_bits_scalar(bits, packed, N);
+}
+
+SIMD_TARGET_AVX2 static void unpack_soft_bits_avx2(tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 32;
+    const size_t N = (bits.size()/(2*K))*K;
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    const __m256i lookup = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(UNPACK_LOOKUP)));
+    for (size_t i = 0; i < N; i+=K) {
+        const __m256i X = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&packed[i]));
+        const __m256i lo = _mm256_and_si256(X, nibble_mask);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(X, 4), nibble_mask);
+        // unpacking is done within each 128bit lane so the lanes are recombined in order
+        const __m256i A = _mm256_unpacklo_epi8(lo, hi);
+        const __m256i B = _mm256_unpackhi_epi8(lo, hi);
+        const __m256i Y0 = _mm256_shuffle_epi8(lookup, _mm256_permute2x128_si256(A, B, 0x20));
+        const __m256i Y1 = _mm256_shuffle_epi8(lookup, _mm256_permute2x128_si256(A, B, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&bits[2*i]), Y0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&bits[2*i+K]), Y1);
+    }
+    unpack_soft_bits_scalar(packed, bits, 2*N);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+// 32 soft bits = 16 packed bytes per iteration
+static void pack_soft_bits_neon(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed) {
+    constexpr size_t K = 16;
+    const size_t N = (bits.size()/(2*K))*K;
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0F);
+    const auto quantise = [&](const int8x16_t x) -> uint8x16_t {
+        uint8x16_t q = vqaddq_u8(vreinterpretq_u8_s8(vqabsq_s8(x)), vdupq_n_u8(8));
+        q = vminq_u8(vshrq_n_u8(q, 4), vdupq_n_u8(PACKED_SOFT_BIT_MAX));
+        const int8x16_t v = vreinterpretq_s8_u8(q);
+        const int8x16_t y = vbslq_s8(vcltzq_s8(x), vnegq_s8(v), v);
+        return vandq_u8(vreinterpretq_u8_s8(y), nibble_mask);
+    };
+    for (size_t i = 0; i < N; i+=K) {
+        // even and odd soft bits are split apart on load
+        const int8x16x2_t X = vld2q_s8(&bits[2*i]);
+        const uint8x16_t lo = quantise(X.val[0]);
+        const uint8x16_t hi = quantise(X.val[1]);
+        vst1q_u8(&packed[i], vorrq_u8(lo, vshlq_n_u8(hi, 4)));
+    }
+    pack_soft_bits_scalar(bits, packed, N);
+}
+
+static void unpack_soft_bits_neon(tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits) {
+    constexpr size_t K = 16;
+    const size_t N = (bits.size()/(2*K))*K;
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0F);
+    const int8x16_t lookup = vld1q_s8(UNPACK_LOOKUP);
+    for (size_t i = 0; i < N; i+=K) {
+        const uint8x16_t X = vld1q_u8(&packed[i]);
+        int8x16x2_t Y;
+        Y.val[0] = vqtbl1q_s8(lookup, vandq_u8(X, nibble_mask));
+        Y.val[1] = vqtbl1q_s8(lookup, vshrq_n_u8(X, 4));
+        // even and odd soft bits are interleaved on store
+        vst2q_s8(&bits[2*i], Y);
+    }
+    unpack_soft_bits_scalar(packed, bits, 2*N);
+}
+
+#endif
+
+void pack_soft_bits_auto(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed) {
+    assert(packed.size() == get_packed_soft_bits_size(bits.size()));
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return pack_soft_bits_avx2(bits, packed);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return pack_soft_bits_sse4_1(bits, packed);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return pack_soft_bits_neon(bits, packed);
+        }
+    #endif
+    (void)level;
+    pack_soft_bits_scalar(bits, packed, 0);
+}
+
+void unpack_soft_bits_auto(tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits) {
+    assert(packed.size() >= get_packed_soft_bits_size(bits.size()));
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return unpack_soft_bits_avx2(packed, bits);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return unpack_soft_bits_sse4_1(packed, bits);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return unpack_soft_bits_neon(packed, bits);
+        }
+    #endif
+    (void)level;
+    unpack_soft_bits_scalar(packed, bits, 0);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Soft bits stored as signed 4bit values with two soft bits per byte
+// This halves the memory and bandwidth used to store or transport soft bits
+// Soft bit 2i is the low nibble of byte i and soft bit 2i+1 is the high nibble
+// NOTE: The viterbi decoder still consumes viterbi_bit_t so these are unpacked before decoding
+static constexpr int PACKED_SOFT_BIT_MAX = 7;
+// Unpacked soft bits are multiples of the quantisation step so packing them again is lossless
+static constexpr int PACKED_SOFT_BIT_SCALE = 16;
+
+static inline size_t get_packed_soft_bits_size(const size_t nb_bits) {
+    return (nb_bits+1)/2;
+}
+
+// Quantises soft bits with rounding to nearest while keeping punctured bits as 0
+// If there is an odd number of bits the unused high nibble of the last byte is 0
+void pack_soft_bits_auto(tcb::span<const viterbi_bit_t> bits, tcb::span<uint8_t> packed);
+// bits.size() soft bits are unpacked from the start of packed
+void unpack_soft_bits_auto(tcb::span<const uint8_t> packed, tcb::span<viterbi_bit_t> bits);
@@ -5,11 +5,14 @@
 #include <vector>
 #include <fmt/format.h>
 #include <neaacdec.h>
+#include "utility/cost_account.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "../dab_logging.h"
 #define TAG "aac-audio-decoder"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 // Push bits into a buffer
@@ -245,63 +248,65 @@ void AAC_Audio_Decoder::GenerateBitfileConfig() {
         bit_pusher.Push(m_mp4_bitfile_config, SYNC_EXTENSION_TYPE_SBR, 11);
         bit_pusher.Push(m_mp4_bitfile_config, SBR_index, 5);
         bit_pusher.Push(m_mp4_bitfile_config, 1, 1);
-        bit_pusher.Push(m_mp4_bitfile_config, sample_rate_index, 4);
+        // libfaad uses downsampled SBR if the extension sampling frequency is the same as the core's
+        // Refer to AudioSpecificConfigFromBitfile in libfaad/mp4.c
+        const uint8_t extension_sample_rate_index = m_params.is_low_complexity ? core_sample_rate_index : sample_rate_index;
+        bit_pusher.Push(m_mp4_bitfile_config, extension_sample_rate_index, 4);
     }
     m_mp4_bitfile_config.resize(size_t(bit_pusher.GetTotalBytesCeil()));
 }
 
-void AAC_Audio_Decoder::GenerateMPEG4Header() {
+AAC_ADTS_Header::AAC_ADTS_Header(const uint32_t sampling_frequency, const bool is_SBR, const bool is_stereo) {
     const uint8_t AAC_LC_index = 2;
-    const uint8_t channel_config  = m_params.is_stereo ? 2 : 1;
+    const uint8_t channel_config  = is_stereo ? 2 : 1;
 
     // DOC: ETSI TS 102 563 
     // In Table 4 it states that when the SBR flag is used that 
     // the sampling rate of the AAC core is half the sampling rate of the DAC
-    const uint32_t core_sample_rate = m_params.is_SBR ? (m_params.sampling_frequency/2) : m_params.sampling_frequency;
+    const uint32_t core_sample_rate = is_SBR ? (sampling_frequency/2) : sampling_frequency;
     const uint8_t core_sample_rate_index = get_index_from_sample_rate(core_sample_rate);
  
     // Source: https://wiki.multimedia.cx/index.php/ADTS
+    m_header.resize(32);
     BitPusherHelper bit_pusher;
-    bit_pusher.Push(m_mpeg4_header, 0xFFF, 12); // Syncword all 1s
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // MPEG Version: 0 = MPEG4, 1 = MPEG2
-    bit_pusher.Push(m_mpeg4_header, 0, 2); // Layer all 0s
-    bit_pusher.Push(m_mpeg4_header, 1, 1); // Protection absence: 1 for no CRC
-    bit_pusher.Push(m_mpeg4_header, AAC_LC_index-1, 2); // Profile
-    bit_pusher.Push(m_mpeg4_header, core_sample_rate_index, 4); // Sampling frequency index
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // Private bit (unused in decoding)
-    bit_pusher.Push(m_mpeg4_header, channel_config, 3); // Channel config
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // Originality
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // Home usage
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // Copyright
-    bit_pusher.Push(m_mpeg4_header, 0, 1); // Copyright id start
-    bit_pusher.Push(m_mpeg4_header, 0, 13); // Frame length including headers (placeholder)
-    bit_pusher.Push(m_mpeg4_header, 0x7FF, 11); // Variable bitrate
-    bit_pusher.Push(m_mpeg4_header, 1-1, 2); // Number of raw data blocks in frame - 1 (Single AAC frame raw data block is advised)
+    bit_pusher.Push(m_header, 0xFFF, 12); // Syncword all 1s
+    bit_pusher.Push(m_header, 0, 1); // MPEG Version: 0 = MPEG4, 1 = MPEG2
+    bit_pusher.Push(m_header, 0, 2); // Layer all 0s
+    bit_pusher.Push(m_header, 1, 1); // Protection absence: 1 for no CRC
+    bit_pusher.Push(m_header, AAC_LC_index-1, 2); // Profile
+    bit_pusher.Push(m_header, core_sample_rate_index, 4); // Sampling frequency index
+    bit_pusher.Push(m_header, 0, 1); // Private bit (unused in decoding)
+    bit_pusher.Push(m_header, channel_config, 3); // Channel config
+    bit_pusher.Push(m_header, 0, 1); // Originality
+    bit_pusher.Push(m_header, 0, 1); // Home usage
+    bit_pusher.Push(m_header, 0, 1); // Copyright
+    bit_pusher.Push(m_header, 0, 1); // Copyright id start
+    bit_pusher.Push(m_header, 0, 13); // Frame length including headers (placeholder)
+    bit_pusher.Push(m_header, 0x7FF, 11); // Variable bitrate
+    bit_pusher.Push(m_header, 1-1, 2); // Number of raw data blocks in frame - 1 (Single AAC frame raw data block is advised)
     const int total_size = bit_pusher.GetTotalBytesCeil();
     assert(total_size == 7);
-    m_mpeg4_header.resize(size_t(total_size));
+    m_header.resize(size_t(total_size));
 }
 
-// Generate MPEG4 Header for ADTS format
-tcb::span<const uint8_t> AAC_Audio_Decoder::GetMPEG4Header(uint16_t frame_length_bytes) {
+tcb::span<const uint8_t> AAC_ADTS_Header::Get(uint16_t frame_length_bytes) {
     // Most of MPEG4 header is pregenerated, we only need to store the number of bytes in the associated frame
     // frame length is stored 30bits into the header
-    uint16_t total_frame_bytes = uint16_t(m_mpeg4_header.size()) + frame_length_bytes;
+    uint16_t total_frame_bytes = uint16_t(m_header.size()) + frame_length_bytes;
     total_frame_bytes &= 0b1'1111'1111'1111;
     // introduce 24bit (3 bytes) offset
-    m_mpeg4_header[3] = (m_mpeg4_header[3] & 0b1111'1100) | ((total_frame_bytes & 0b1'1000'0000'0000) >> 11); // 2bits
-    m_mpeg4_header[4] = (m_mpeg4_header[4] & 0b0000'0000) | ((total_frame_bytes & 0b0'0111'1111'1000) >> 3);  // 8bits
-    m_mpeg4_header[5] = (m_mpeg4_header[5] & 0b0001'1111) | ((total_frame_bytes & 0b0'0000'0000'0111) << 5);  // 3bits
-    return m_mpeg4_header;
+    m_header[3] = (m_header[3] & 0b1111'1100) | ((total_frame_bytes & 0b1'1000'0000'0000) >> 11); // 2bits
+    m_header[4] = (m_header[4] & 0b0000'0000) | ((total_frame_bytes & 0b0'0111'1111'1000) >> 3);  // 8bits
+    m_header[5] = (m_header[5] & 0b0001'1111) | ((total_frame_bytes & 0b0'0000'0000'0111) << 5);  // 3bits
+    return m_header;
 }
 
 AAC_Audio_Decoder::AAC_Audio_Decoder(const struct Params _params)
-: m_params(_params)
+: m_params(_params),
+  m_adts_header(_params.sampling_frequency, _params.is_SBR, _params.is_stereo)
 {
     m_mp4_bitfile_config.resize(32);
-    m_mpeg4_header.resize(32);
     GenerateBitfileConfig();
-    GenerateMPEG4Header();
 
     m_decoder_handle = NeAACDecOpen();
     m_decoder_frame_info = new NeAACDecFrameInfo();
@@ -325,9 +330,15 @@ AAC_Audio_Decoder::~AAC_Audio_Decoder() {
     delete m_decoder_frame_info;
 }
 
+void AAC_Audio_Decoder::Reset() {
+    NeAACDecPostSeekReset(m_decoder_handle, 0);
+}
+
 AAC_Audio_Decoder::Result AAC_Audio_Decoder::DecodeFrame(tcb::span<uint8_t> data) {
+    METRICS_TIME_SCOPE("dab_aac_decode_seconds", "Time spent decoding an AAC access unit");
+    COST_STAGE_SCOPE(Cost_Stage::DECODE);
     const uint8_t* audio_data_buf = reinterpret_cast<const uint8_t*>(NeAACDecDecode(m_decoder_handle, m_decoder_frame_info, data.data(), int(data.size())));
-    LOG_MESSAGE("aac_decoder_error={}", m_decoder_frame_info->error);
+    LOG_DEBUG("aac_decoder_error={}", m_decoder_frame_info->error);
 
     // abort, if no output at all
     const int nb_consumed_bytes = m_decoder_frame_info->bytesconsumed;
@@ -336,6 +347,7 @@ AAC_Audio_Decoder::Result AAC_Audio_Decoder::DecodeFrame(tcb::span<uint8_t> data
     if (nb_consumed_bytes <= 0 || nb_samples <= 0 || nb_consumed_bytes != int(data.size())) {
         AAC_Audio_Decoder::Result res;
         res.audio_buf = {};
+        res.sampling_frequency = 0;
         res.is_error = true;
         res.error_code = m_decoder_frame_info->error;
         return res;
@@ -344,6 +356,7 @@ AAC_Audio_Decoder::Result AAC_Audio_Decoder::DecodeFrame(tcb::span<uint8_t> data
     const int nb_output_bytes = nb_samples * sizeof(uint16_t);
     AAC_Audio_Decoder::Result res;
     res.audio_buf = tcb::span(audio_data_buf, size_t(nb_output_bytes));
+    res.sampling_frequency = uint32_t(m_decoder_frame_info->samplerate);
     res.is_error = false;
     res.error_code = m_decoder_frame_info->error;
     return res;
@@ -6,6 +6,18 @@
 
 struct NeAACDecFrameInfo;
 
+// Generates the ADTS header that precedes each access unit in a .aac stream
+// This doesn't need a decoder so access units can be archived or streamed as is
+class AAC_ADTS_Header
+{
+private:
+    std::vector<uint8_t> m_header;
+public:
+    AAC_ADTS_Header(const uint32_t sampling_frequency, const bool is_SBR, const bool is_stereo);
+    // Header is only valid until the next call
+    tcb::span<const uint8_t> Get(uint16_t frame_length_bytes);
+};
+
 // Wrapper around libfaad2
 // Consumes AAC access units
 // Outputs 16bit stereo audio data
@@ -14,6 +26,8 @@ class AAC_Audio_Decoder
 public:
     struct Result {
         tcb::span<const uint8_t> audio_buf;
+        // this is half the superframe's rate if SBR is downsampled
+        uint32_t sampling_frequency;
         bool is_error;
         int error_code;
     };
@@ -22,23 +36,27 @@ public:
         bool is_SBR;
         bool is_stereo;
         bool is_PS;
+        // SBR runs at the rate of the AAC core (downsampled SBR) which halves the output rate and its cost
+        bool is_low_complexity = false;
         bool operator==(const Params& other) const {
             return (sampling_frequency == other.sampling_frequency) &&
                    (is_SBR == other.is_SBR) &&
                    (is_stereo == other.is_stereo) &&
-                   (is_PS == other.is_PS);
+                   (is_PS == other.is_PS) &&
+                   (is_low_complexity == other.is_low_complexity);
         }
         bool operator!=(const Params& other) const {
             return (sampling_frequency != other.sampling_frequency) || 
                    (is_SBR != other.is_SBR) || 
                    (is_stereo != other.is_stereo) ||
-                   (is_PS != other.is_PS);
+                   (is_PS != other.is_PS) ||
+                   (is_low_complexity != other.is_low_complexity);
         }
     };
 private:
     const struct Params m_params;
     std::vector<uint8_t> m_mp4_bitfile_config;
-    std::vector<uint8_t> m_mpeg4_header;
+    AAC_ADTS_Header m_adts_header;
     void* m_decoder_handle;
     struct NeAACDecFrameInfo* m_decoder_frame_info;
 public:
@@ -49,9 +67,10 @@ public:
     AAC_Audio_Decoder& operator=(AAC_Audio_Decoder&) = delete;
     AAC_Audio_Decoder& operator=(AAC_Audio_Decoder&&) = delete;
     Result DecodeFrame(tcb::span<uint8_t> data);
+    // Clears the decoder history so it can be reused for an unrelated stream with the same params
+    void Reset();
     Params GetParams() { return m_params; }
-    tcb::span<const uint8_t> GetMPEG4Header(uint16_t frame_length_bytes);
+    tcb::span<const uint8_t> GetMPEG4Header(uint16_t frame_length_bytes) { return m_adts_header.Get(frame_length_bytes); }
 private:
     void GenerateBitfileConfig();
-    void GenerateMPEG4Header();
 };
\ No newline at end of file
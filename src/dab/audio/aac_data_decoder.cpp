@@ -10,21 +10,36 @@ static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 constexpr int TOTAL_FPAD_BYTES = 2;
+static const uint8_t EMPTY_FPAD[TOTAL_FPAD_BYTES] = {0, 0};
 
 bool AAC_Data_Decoder::ProcessAccessUnit(tcb::span<const uint8_t> data) {
-    const bool is_success = ProcessDataElement(data);
+    tcb::span<const uint8_t> fpad;
+    tcb::span<const uint8_t> xpad;
+    const bool is_success = ExtractPAD(data, fpad, xpad);
+    m_pad_processor.Process(fpad, xpad);
+    return is_success;
+}
+
+bool AAC_Data_Decoder::ExtractPAD(
+    tcb::span<const uint8_t> data, 
+    tcb::span<const uint8_t>& fpad, tcb::span<const uint8_t>& xpad) 
+{
+    const bool is_success = ExtractDataElement(data, fpad, xpad);
     if (!is_success) {
         // DOC: ETSI TS 102 563
         // Clause 5.4.3 PAD extraction
         // If we didn't detect any data stream element then
         // Pad decoder gets: FPAD={0,0}, XPAD=NULL
-        uint8_t fpad[TOTAL_FPAD_BYTES] = {0, 0};
-        ProcessPAD(fpad, {});
+        fpad = { EMPTY_FPAD, size_t(TOTAL_FPAD_BYTES) };
+        xpad = {};
     }
     return is_success;
 }
 
-bool AAC_Data_Decoder::ProcessDataElement(tcb::span<const uint8_t> data) {
+bool AAC_Data_Decoder::ExtractDataElement(
+    tcb::span<const uint8_t> data,
+    tcb::span<const uint8_t>& fpad, tcb::span<const uint8_t>& xpad) 
+{
     const int N = (int)data.size();
     if (N < 2) {
         LOG_ERROR("Data element size too small {}<2", N);
@@ -80,12 +95,7 @@ bool AAC_Data_Decoder::ProcessDataElement(tcb::span<const uint8_t> data) {
     auto* xpad_data = &pad_data[0];
     auto* fpad_data = &pad_data[nb_xpad_bytes];
     
-    ProcessPAD(
-        {fpad_data, (size_t)TOTAL_FPAD_BYTES}, 
-        {xpad_data, (size_t)nb_xpad_bytes});
+    fpad = {fpad_data, (size_t)TOTAL_FPAD_BYTES};
+    xpad = {xpad_data, (size_t)nb_xpad_bytes};
     return true;
-}
-
-void AAC_Data_Decoder::ProcessPAD(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad) {
-    m_pad_processor.Process(fpad, xpad);
 }
\ No newline at end of file
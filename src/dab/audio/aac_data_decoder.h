@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <memory_resource>
 #include "../pad/pad_processor.h"
 #include "utility/span.h"
 
@@ -11,9 +12,18 @@ class AAC_Data_Decoder
 private:
     PAD_Processor m_pad_processor;
 public:
+    explicit AAC_Data_Decoder(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource())
+    : m_pad_processor(memory_resource) {}
     bool ProcessAccessUnit(tcb::span<const uint8_t> data);
+    // Finds the PAD of an access unit without processing it so it can be processed later or on another thread
+    // The spans point into data or a static FPAD={0,0} with an empty XPAD if there is no data stream element
+    // Returns false if there was no data stream element
+    static bool ExtractPAD(
+        tcb::span<const uint8_t> data, 
+        tcb::span<const uint8_t>& fpad, tcb::span<const uint8_t>& xpad);
     auto& Get_PAD_Processor(void) { return m_pad_processor; }
 private:
-    bool ProcessDataElement(tcb::span<const uint8_t> data);
-    void ProcessPAD(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad);
+    static bool ExtractDataElement(
+        tcb::span<const uint8_t> data,
+        tcb::span<const uint8_t>& fpad, tcb::span<const uint8_t>& xpad);
 };
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "./aac_frame_processor.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include <memory>
+#include <memory_resource>
 #include <fmt/format.h>
+#include "utility/cost_account.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_usage.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "../algorithms/crc.h"
 #include "../algorithms/reed_solomon_decoder.h"
@@ -10,6 +16,7 @@
 #define TAG "aac-frame-processor"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 constexpr int NB_FIRECODE_CRC16_BYTES = 2;
@@ -97,33 +104,64 @@ static auto ACCESS_UNIT_CRC_CALC = []() {
     return calc;
 } ();
 
-AAC_Frame_Processor::AAC_Frame_Processor() {
-    // DOC: ETSI TS 102 563 
-    // Refer to clause 6.1 on reed solomon coding
-    // The polynomial for this is given as
-    // P(x) = x^8 + x^4 + x^3 + x^2 + 1
-    const int GALOIS_FIELD_POLY = 0b100011101;
-    // G(x) = (x+λ^0)*(x+λ^1)*...*(x+λ^9)
-    const int CODE_TOTAL_ROOTS = 10;
-    // The Phil Karn reed solmon decoder works with the 2^8 Galois field
-    // Therefore we need to use the RS(255,245) decoder
-    // As according to the spec we should insert 135 padding symbols (bytes)
-    m_rs_decoder = std::make_unique<Reed_Solomon_Decoder>(8, GALOIS_FIELD_POLY, 0, 1, CODE_TOTAL_ROOTS, NB_RS_PADDING_BYTES);
-    m_rs_encoded_buf.resize(NB_RS_MESSAGE_BYTES, 0);
-    // Reed solomon code can correct up to floor(t/2) symbols that were wrong
-    // where t = the number of parity symbols
-    m_rs_error_positions.resize(NB_RS_PARITY_BYTES, 0);
+AAC_Frame_Processor::AAC_Frame_Processor(std::pmr::memory_resource* memory_resource)
+: m_rs_encoded_buf(memory_resource),
+  m_rs_dirty_codewords(memory_resource),
+  m_rs_error_positions(memory_resource),
+  m_super_frame_buf(memory_resource),
+  m_super_frame_soft_errors(memory_resource),
+  m_rs_soft_errors(memory_resource),
+  m_rs_erasure_candidates(memory_resource),
+  m_rs_is_clean(memory_resource)
+{
+    // NOTE: The reed solomon decoder is created with the first superframe since most channels are never enabled
+    m_rs_decoder = nullptr;
+    Reset();
+}
+
+AAC_Frame_Processor::~AAC_Frame_Processor() = default;
 
+size_t AAC_Frame_Processor::GetMemoryBytes() const {
+    return
+        get_memory_bytes(m_rs_encoded_buf) +
+        get_memory_bytes(m_rs_dirty_codewords) +
+        get_memory_bytes(m_rs_error_positions) +
+        get_memory_bytes(m_super_frame_buf) +
+        get_memory_bytes(m_super_frame_soft_errors) +
+        get_memory_bytes(m_rs_soft_errors) +
+        get_memory_bytes(m_rs_erasure_candidates) +
+        get_memory_bytes(m_rs_is_clean);
+}
+
+void AAC_Frame_Processor::Reset() {
     m_state = State::WAIT_FRAME_START;
     m_curr_dab_frame = 0;
     m_prev_nb_dab_frame_bytes = 0;
     m_is_synced_superframe = false;
     m_nb_desync_count = 0;
+    // the confirmed header is kept since the service is most likely unchanged
+    m_nb_candidate_count = 0;
+    m_is_early_header = false;
+    m_num_aus = 0;
+    m_next_au = 0;
+    m_is_skipped_superframe = false;
 }
 
-AAC_Frame_Processor::~AAC_Frame_Processor() = default;
+void AAC_Frame_Processor::Skip() {
+    // Without sync or a firecode match there isn't a superframe to keep our place in
+    if (!m_is_synced_superframe && (m_state == State::WAIT_FRAME_START)) {
+        return;
+    }
+    m_state = State::COLLECT_FRAMES;
+    m_is_skipped_superframe = true;
+    m_curr_dab_frame++;
+    if (m_curr_dab_frame == m_TOTAL_DAB_FRAMES) {
+        m_state = State::WAIT_FRAME_START;
+        m_curr_dab_frame = 0;
+    }
+}
 
-void AAC_Frame_Processor::Process(tcb::span<const uint8_t> buf) {
+void AAC_Frame_Processor::Process(tcb::span<const uint8_t> buf, tcb::span<const uint16_t> byte_soft_errors) {
     const int N = (int)buf.size();
     if (N == 0) { 
         LOG_ERROR("Received an empty buffer");
@@ -142,6 +180,10 @@ void AAC_Frame_Processor::Process(tcb::span<const uint8_t> buf) {
         }
         m_prev_nb_dab_frame_bytes = N;
         m_super_frame_buf.resize(m_TOTAL_DAB_FRAMES*N);
+        m_super_frame_soft_errors.resize(m_TOTAL_DAB_FRAMES*N);
+        // every codeword needing correction shouldn't allocate mid superframe
+        m_rs_encoded_buf.reserve(m_TOTAL_DAB_FRAMES*N);
+        m_rs_dirty_codewords.reserve(m_TOTAL_DAB_FRAMES*N/NB_RS_MESSAGE_BYTES);
         m_curr_dab_frame = 0;
         m_state = State::WAIT_FRAME_START;
     }
@@ -166,41 +208,89 @@ void AAC_Frame_Processor::Process(tcb::span<const uint8_t> buf) {
         m_state = State::COLLECT_FRAMES;
     }
 
-    AccumulateFrame(buf);
+    if (m_curr_dab_frame == 0) {
+        m_is_early_header = false;
+        m_num_aus = 0;
+        m_next_au = 0;
+        m_is_skipped_superframe = false;
+    }
+
+    AccumulateFrame(buf, byte_soft_errors);
+    if (m_is_low_latency && !m_is_skipped_superframe) {
+        ProcessEarlyAccessUnits(N);
+    }
     m_curr_dab_frame++;
 
     if (m_curr_dab_frame == m_TOTAL_DAB_FRAMES) {
-        ProcessSuperFrame(N);
+        // a skipped logical frame leaves too many errors for reed solomon to correct
+        if (!m_is_skipped_superframe) {
+            ProcessSuperFrame(N);
+        }
         m_state = State::WAIT_FRAME_START;
         m_curr_dab_frame = 0;
     }
 }
 
-bool AAC_Frame_Processor::CalculateFirecode(tcb::span<const uint8_t> buf) {
+bool AAC_Frame_Processor::CalculateFirecode(tcb::span<const uint8_t> buf, const bool is_notify_error) {
     auto crc_data = buf.subspan(NB_FIRECODE_CRC16_BYTES, NB_FIRECODE_DATA_BYTES);
     const uint16_t crc_rx = (buf[0] << 8) | buf[1];
     const uint16_t crc_pred = FIRECODE_CRC_CALC->Process(crc_data);
     const bool is_valid = (crc_rx == crc_pred);
-    LOG_MESSAGE("[crc16] [firecode] is_match={} got={:04X} calc={:04X}", is_valid, crc_rx, crc_pred);
+    LOG_DEBUG("[crc16] [firecode] is_match={} got={:04X} calc={:04X}", is_valid, crc_rx, crc_pred);
 
-    if (!is_valid) {
+    if (!is_valid && is_notify_error) {
         m_obs_firecode_error.Notify(m_curr_dab_frame, crc_rx, crc_pred);
     }
 
     return is_valid;
 }
 
-void AAC_Frame_Processor::AccumulateFrame(tcb::span<const uint8_t> buf) {
+void AAC_Frame_Processor::AccumulateFrame(tcb::span<const uint8_t> buf, tcb::span<const uint16_t> byte_soft_errors) {
     const size_t N = buf.size();
     auto dst_buf = tcb::span(m_super_frame_buf).subspan(m_curr_dab_frame*N, N);
     for (size_t i = 0; i < N; i++) {
         dst_buf[i] = buf[i];
     }
+    auto dst_soft_errors = tcb::span(m_super_frame_soft_errors).subspan(m_curr_dab_frame*N, N);
+    if (byte_soft_errors.size() == N) {
+        std::copy_n(byte_soft_errors.begin(), N, dst_soft_errors.begin());
+    } else {
+        std::fill(dst_soft_errors.begin(), dst_soft_errors.end(), uint16_t(0));
+    }
+}
+
+void AAC_Frame_Processor::ProcessEarlyAccessUnits(const int nb_dab_frame_bytes) {
+    // DOC: ETSI TS 102 563
+    // Clause 6.2: Virtual interleaving
+    // The parity bytes of every codeword come after all of the data bytes in the superframe
+    // So the access units arrive in order with the logical frames and can be checked before reed solomon
+    const int nb_received_bytes = (m_curr_dab_frame+1)*nb_dab_frame_bytes;
+
+    if (!m_is_early_header) {
+        // the header is only read from the first logical frame if its firecode matches
+        // otherwise everything waits for the reed solomon corrected superframe
+        if (m_curr_dab_frame != 0) return;
+        if (!CalculateFirecode(m_super_frame_buf, false)) return;
+        const auto super_frame_header = ReadSuperFrameHeader(nb_dab_frame_bytes);
+        UpdateSuperFrameHeader(super_frame_header);
+        m_is_early_header = true;
+    }
+
+    // access units are emitted in order so the first one that fails waits with the rest for reed solomon
+    while (m_next_au < m_num_aus) {
+        if ((int)m_au_start[m_next_au+1] > nb_received_bytes) return;
+        if (!ProcessAccessUnit(m_next_au, false)) return;
+        m_next_au++;
+    }
 }
 
 void AAC_Frame_Processor::ProcessSuperFrame(const int nb_dab_frame_bytes) {
-    const int nb_rs_super_frame_bytes = nb_dab_frame_bytes*m_TOTAL_DAB_FRAMES;
-    const int N = nb_rs_super_frame_bytes/NB_RS_MESSAGE_BYTES;
+    // all access units were emitted before reed solomon so there is nothing left to correct
+    if (m_is_early_header && (m_next_au >= m_num_aus)) {
+        m_nb_desync_count = 0;
+        m_is_synced_superframe = true;
+        return;
+    }
 
     if (!ReedSolomonDecode(nb_dab_frame_bytes)) {
         m_nb_desync_count++;
@@ -215,6 +305,26 @@ void AAC_Frame_Processor::ProcessSuperFrame(const int nb_dab_frame_bytes) {
     // if validated, reset resynchronisation counter
     m_nb_desync_count = 0;
     m_is_synced_superframe = true;
+    LATENCY_TRACE_RECORD("dab_latency_aac_super_frame_seconds", "Time from capturing the samples of a frame to the DAB+ super frame it completed being corrected");
+
+    if (!m_is_early_header) {
+        const auto super_frame_header = ReadSuperFrameHeader(nb_dab_frame_bytes);
+        UpdateSuperFrameHeader(super_frame_header);
+    } else if (m_next_au == 0) {
+        // reed solomon may have corrected the start of the access units
+        ReadSuperFrameHeader(nb_dab_frame_bytes);
+    }
+
+    // process each access unit through the AAC decoder
+    for (int i = m_next_au; i < m_num_aus; i++) {
+        ProcessAccessUnit(i, true);
+    }
+    m_next_au = m_num_aus;
+}
+
+SuperFrameHeader AAC_Frame_Processor::ReadSuperFrameHeader(const int nb_dab_frame_bytes) {
+    const int nb_rs_super_frame_bytes = nb_dab_frame_bytes*m_TOTAL_DAB_FRAMES;
+    const int N = nb_rs_super_frame_bytes/NB_RS_MESSAGE_BYTES;
 
     // Decode audio superframe header
     // DOC: ETSI TS 102 563
@@ -262,19 +372,17 @@ void AAC_Frame_Processor::ProcessSuperFrame(const int nb_dab_frame_bytes) {
         break;
     }
 
-    m_obs_superframe_header.Notify(super_frame_header);
-    LOG_MESSAGE("AAC decoder parameters: sampling_rate={}Hz PS={} SBR={} stereo={}", 
-        sampling_rate, ps_flag, sbr_flag, is_stereo);
-
     // Get the starting byte index for each AU (access unit) in the super frame
-    uint8_t num_aus = 0;
+    int num_aus = 0;
     if ((dac_rate == 0) && (sbr_flag == 1)) num_aus = 2;
     if ((dac_rate == 1) && (sbr_flag == 1)) num_aus = 3;
     if ((dac_rate == 0) && (sbr_flag == 0)) num_aus = 4;
     if ((dac_rate == 1) && (sbr_flag == 0)) num_aus = 6;
-    uint16_t au_start[7] = {0};
+    auto& au_start = m_au_start;
+    std::fill_n(au_start, 7, uint16_t(0));
     const int nb_au_start_bytes = read_au_start(&buf[3], &au_start[1], num_aus-1);
     au_start[num_aus] = NB_RS_DATA_BYTES*N;
+    m_num_aus = num_aus;
 
     // size of the audio descriptor fields
     curr_byte += 3;
@@ -282,57 +390,157 @@ void AAC_Frame_Processor::ProcessSuperFrame(const int nb_dab_frame_bytes) {
     // the first access unit doesn't have the starting index specified
     // it begins immediately after the superframe header
     au_start[0] = curr_byte;
+    return super_frame_header;
+}
 
-    // process each access unit through the AAC decoder
-    for (int i = 0; i < num_aus; i++) {
-        const int nb_au_bytes = (int)au_start[i+1] - (int)au_start[i];
-        const int nb_crc_bytes = (int)sizeof(uint16_t);
-        const int nb_data_bytes = nb_au_bytes - nb_crc_bytes;
-        if ((nb_data_bytes < 0) || (au_start[i+1] >= buf.size())) {
-            LOG_ERROR("access unit out of bounds: i=%d/%d range=[%d,%d] N=%d", 
+void AAC_Frame_Processor::UpdateSuperFrameHeader(const SuperFrameHeader& super_frame_header) {
+    bool is_header_accepted = !m_is_header_valid;
+    if (m_is_header_valid && (super_frame_header != m_header)) {
+        if ((m_nb_candidate_count > 0) && (super_frame_header == m_candidate_header)) {
+            m_nb_candidate_count++;
+        } else {
+            m_candidate_header = super_frame_header;
+            m_nb_candidate_count = 1;
+        }
+        is_header_accepted = (m_nb_candidate_count >= m_nb_header_confirm_count);
+        if (!is_header_accepted) {
+            LOG_MESSAGE("Superframe header changed, waiting for it to repeat {}/{}", 
+                m_nb_candidate_count, m_nb_header_confirm_count);
+        }
+    } else {
+        m_nb_candidate_count = 0;
+    }
+
+    if (is_header_accepted) {
+        m_header = super_frame_header;
+        m_is_header_valid = true;
+        m_nb_candidate_count = 0;
+        LOG_MESSAGE("AAC decoder parameters: sampling_rate={}Hz PS={} SBR={} stereo={}", 
+            super_frame_header.sampling_rate, super_frame_header.PS_flag, 
+            super_frame_header.SBR_flag, super_frame_header.is_stereo);
+    }
+    m_obs_superframe_header.Notify(m_header);
+}
+
+bool AAC_Frame_Processor::ProcessAccessUnit(const int index, const bool is_notify_error) {
+    auto& buf = m_super_frame_buf;
+    const int i = index;
+    const int num_aus = m_num_aus;
+    const auto& au_start = m_au_start;
+
+    const int nb_au_bytes = (int)au_start[i+1] - (int)au_start[i];
+    const int nb_crc_bytes = (int)sizeof(uint16_t);
+    const int nb_data_bytes = nb_au_bytes - nb_crc_bytes;
+    if ((nb_data_bytes < 0) || (au_start[i+1] >= buf.size())) {
+        if (is_notify_error) {
+            LOG_ERROR("access unit out of bounds: i={}/{} range=[{},{}] N={}", 
                 i, num_aus, 
                 (int)au_start[i], (int)au_start[i+1],
                 buf.size());
-            return;
         }
+        return false;
+    }
 
-        auto au_buf = tcb::span(buf).subspan(au_start[i], nb_au_bytes);
-        auto data_buf = au_buf.first(nb_data_bytes);
-        auto crc_buf = au_buf.last(nb_crc_bytes);
+    auto au_buf = tcb::span(buf).subspan(au_start[i], nb_au_bytes);
+    auto data_buf = au_buf.first(nb_data_bytes);
+    auto crc_buf = au_buf.last(nb_crc_bytes);
 
-        const uint16_t crc_rx = (crc_buf[0] << 8) | crc_buf[1];
-        const uint16_t crc_pred = ACCESS_UNIT_CRC_CALC->Process(data_buf);
-        const bool is_crc_valid = (crc_pred == crc_rx);
-        LOG_MESSAGE("[crc16] au={} is_match={} crc_pred={:04X} crc_rx={:04X}", i, is_crc_valid, crc_pred, crc_rx);
+    const uint16_t crc_rx = (crc_buf[0] << 8) | crc_buf[1];
+    const uint16_t crc_pred = ACCESS_UNIT_CRC_CALC->Process(data_buf);
+    const bool is_crc_valid = (crc_pred == crc_rx);
+    LOG_DEBUG("[crc16] au={} is_match={} crc_pred={:04X} crc_rx={:04X}", i, is_crc_valid, crc_pred, crc_rx);
 
-        if (!is_crc_valid) {
+    if (!is_crc_valid) {
+        if (is_notify_error) {
             m_obs_au_crc_error.Notify(i, num_aus, crc_rx, crc_pred);
-            continue;
         }
-
-        m_obs_access_unit.Notify(i, num_aus, data_buf);
+        return false;
     }
+
+    LATENCY_TRACE_RECORD("dab_latency_aac_access_unit_seconds", "Time from capturing the samples of a frame to an AAC access unit of its super frame being extracted");
+    m_obs_access_unit.Notify(i, num_aus, data_buf);
+    return true;
+}
+
+void AAC_Frame_Processor::CreateReedSolomonDecoder() {
+    // DOC: ETSI TS 102 563 
+    // Refer to clause 6.1 on reed solomon coding
+    // The polynomial for this is given as
+    // P(x) = x^8 + x^4 + x^3 + x^2 + 1
+    const int GALOIS_FIELD_POLY = 0b100011101;
+    // G(x) = (x+λ^0)*(x+λ^1)*...*(x+λ^9)
+    const int CODE_TOTAL_ROOTS = 10;
+    // The Phil Karn reed solmon decoder works with the 2^8 Galois field
+    // Therefore we need to use the RS(255,245) decoder
+    // As according to the spec we should insert 135 padding symbols (bytes)
+    m_rs_decoder = std::make_unique<Reed_Solomon_Decoder>(8, GALOIS_FIELD_POLY, 0, 1, CODE_TOTAL_ROOTS, NB_RS_PADDING_BYTES);
+    // Reed solomon code can correct up to floor(t/2) symbols that were wrong
+    // where t = the number of parity symbols
+    m_rs_error_positions.resize(NB_RS_PARITY_BYTES, 0);
+    m_rs_soft_errors.resize(NB_RS_MESSAGE_BYTES, 0);
+    m_rs_erasure_candidates.reserve(NB_RS_MESSAGE_BYTES);
 }
 
 bool AAC_Frame_Processor::ReedSolomonDecode(const int nb_dab_frame_bytes) {
+    METRICS_TIME_SCOPE("dab_aac_reed_solomon_seconds", "Time spent reed solomon decoding a DAB+ super frame");
+    COST_STAGE_SCOPE(Cost_Stage::OUTER_CODE);
     const int nb_rs_super_frame_bytes = nb_dab_frame_bytes*m_TOTAL_DAB_FRAMES;
     const int N = nb_rs_super_frame_bytes/NB_RS_MESSAGE_BYTES;
+    if (m_rs_decoder == nullptr) {
+        CreateReedSolomonDecoder();
+    }
 
     // DOC: ETSI TS 102 563
     // Clause 6: Transport error coding and interleaving 
     // We need to interleave the data so we can perform Reed Solomon decoding
     // Then we deinterleave the corrected RS data into the super frame buffer
 
-    // reed solomon decoder
+    // Most codewords are error free so they are found together without running the full decoder
+    m_rs_is_clean.resize(size_t(N));
+    m_rs_decoder->FindCleanCodewords(m_super_frame_buf.data(), size_t(N), m_rs_is_clean);
+
+    auto& dirty_codewords = m_rs_dirty_codewords;
+    dirty_codewords.clear();
     for (int i = 0; i < N; i++) {
-        // Interleave for decoding
-        for (int j = 0; j < NB_RS_MESSAGE_BYTES; j++) {
-            m_rs_encoded_buf[j] = m_super_frame_buf[i + j*N];
+        if (m_rs_is_clean[i]) {
+            LOG_DEBUG("[reed-solomon] index={}/{} error_count=0", i, N);
+            continue;
+        }
+        dirty_codewords.push_back(i);
+    }
+    if (dirty_codewords.empty()) {
+        return true;
+    }
+
+    // Interleave for decoding
+    // Each row of the superframe holds byte j of every codeword so it is read sequentially once
+    // instead of striding through the whole superframe for each codeword
+    const size_t nb_dirty = dirty_codewords.size();
+    m_rs_encoded_buf.resize(nb_dirty*NB_RS_MESSAGE_BYTES);
+    for (int j = 0; j < NB_RS_MESSAGE_BYTES; j++) {
+        const uint8_t* row = &m_super_frame_buf[size_t(j*N)];
+        uint8_t* dst = &m_rs_encoded_buf[size_t(j)];
+        for (size_t d = 0; d < nb_dirty; d++) {
+            dst[d*NB_RS_MESSAGE_BYTES] = row[dirty_codewords[d]];
         }
-        const int error_count = m_rs_decoder->Decode(
-            m_rs_encoded_buf.data(), m_rs_error_positions.data(), 0);
+    }
 
-        LOG_MESSAGE("[reed-solomon] index={}/{} error_count={}", i, N, error_count);
+    // reed solomon decoder
+    for (size_t d = 0; d < nb_dirty; d++) {
+        const int i = dirty_codewords[d];
+        uint8_t* codeword = &m_rs_encoded_buf[d*NB_RS_MESSAGE_BYTES];
+        int error_count = m_rs_decoder->Decode(
+            codeword, m_rs_error_positions.data(), 0);
+        // Up to 10 erasures can be corrected instead of 5 errors if we know where they are
+        // The soft errors are only gathered for the few codewords that need them
+        if (error_count < 0) {
+            for (int j = 0; j < NB_RS_MESSAGE_BYTES; j++) {
+                m_rs_soft_errors[j] = m_super_frame_soft_errors[i + j*N];
+            }
+            error_count = ReedSolomonDecodeErasures(codeword);
+        }
+
+        LOG_DEBUG("[reed-solomon] index={}/{} error_count={}", i, N, error_count);
         // rs decoder returns -1 to indicate too many errors
         if (error_count < 0) {
             LOG_ERROR("Too many errors for reed solomon to correct");
@@ -349,9 +557,38 @@ bool AAC_Frame_Processor::ReedSolomonDecode(const int nb_dab_frame_bytes) {
                 continue;
             }
             // Deinterleave for error correction
-            m_super_frame_buf[i + k*N] = m_rs_encoded_buf[k];
+            // NOTE: Only the corrected bytes are written back
+            m_super_frame_buf[i + k*N] = codeword[k];
         }
     }
 
     return true;
+}
+
+int AAC_Frame_Processor::ReedSolomonDecodeErasures(uint8_t* codeword) {
+    // Erase the least reliable bytes according to the inner viterbi decoder
+    auto& candidates = m_rs_erasure_candidates;
+    candidates.clear();
+    for (int j = 0; j < NB_RS_MESSAGE_BYTES; j++) {
+        if (m_rs_soft_errors[j] > 0) {
+            candidates.push_back(j);
+        }
+    }
+    if (candidates.empty()) {
+        return -1;
+    }
+
+    const int nb_erasures = std::min(int(candidates.size()), NB_RS_PARITY_BYTES);
+    std::partial_sort(
+        candidates.begin(), candidates.begin()+nb_erasures, candidates.end(),
+        [this](const int a, const int b) { return m_rs_soft_errors[a] > m_rs_soft_errors[b]; }
+    );
+    // NOTE: Phil Karn's reed solomon decoder expects erasure positions to include the padding
+    for (int j = 0; j < nb_erasures; j++) {
+        m_rs_error_positions[j] = candidates[j] + NB_RS_PADDING_BYTES;
+    }
+    const int error_count = m_rs_decoder->Decode(
+        codeword, m_rs_error_positions.data(), nb_erasures);
+    LOG_DEBUG("[reed-solomon] erasures={} error_count={}", nb_erasures, error_count);
+    return error_count;
 }
\ No newline at end of file
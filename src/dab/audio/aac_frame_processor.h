@@ -1,6 +1,8 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include <vector>
 #include "utility/observable.h"
 #include "utility/span.h"
@@ -17,7 +19,7 @@ struct SuperFrameHeader {
     bool SBR_flag = false;
     bool is_stereo = false;
     MPEG_Surround mpeg_surround = MPEG_Surround::NOT_USED;
-    bool operator==(const SuperFrameHeader& other) {
+    bool operator==(const SuperFrameHeader& other) const {
         return 
             (sampling_rate == other.sampling_rate) &&
             (PS_flag == other.PS_flag) &&
@@ -25,7 +27,7 @@ struct SuperFrameHeader {
             (is_stereo == other.is_stereo) &&
             (mpeg_surround == other.mpeg_surround);
     }
-    bool operator !=(const SuperFrameHeader& other) {
+    bool operator !=(const SuperFrameHeader& other) const {
         return !(*this == other);
     }
 };
@@ -33,6 +35,7 @@ struct SuperFrameHeader {
 // Reads in DAB main service channel frames
 // Reconstructs and decodes AAC superframe
 // Outputs superframe header and AAC access units
+// NOTE: The internal buffers are allocated from memory_resource which must outlive the processor
 class AAC_Frame_Processor 
 {
 public:
@@ -41,9 +44,16 @@ private:
     enum class State { WAIT_FRAME_START, COLLECT_FRAMES };
 private:
     std::unique_ptr<Reed_Solomon_Decoder> m_rs_decoder;
-    std::vector<uint8_t> m_rs_encoded_buf;
-    std::vector<int> m_rs_error_positions;
-    std::vector<uint8_t> m_super_frame_buf;
+    // codewords that need correcting are gathered together one after another
+    std::pmr::vector<uint8_t> m_rs_encoded_buf;
+    std::pmr::vector<int> m_rs_dirty_codewords;
+    std::pmr::vector<int> m_rs_error_positions;
+    std::pmr::vector<uint8_t> m_super_frame_buf;
+    // soft errors of the superframe bytes from the inner decoder (0 if unknown)
+    std::pmr::vector<uint16_t> m_super_frame_soft_errors;
+    std::pmr::vector<uint16_t> m_rs_soft_errors;
+    std::pmr::vector<int> m_rs_erasure_candidates;
+    std::pmr::vector<uint8_t> m_rs_is_clean;
     // superframe acquisition state
     State m_state;
     const int m_TOTAL_DAB_FRAMES = 5;
@@ -52,31 +62,71 @@ private:
     int m_prev_nb_dab_frame_bytes;
     bool m_is_synced_superframe;
     int m_nb_desync_count;
+    // a logical frame of the current superframe was skipped so it can't be corrected
+    bool m_is_skipped_superframe = false;
+    // a changed superframe header has to repeat before it is reported
+    // so a corrupt header that passes the firecode check doesn't reconfigure the decoder
+    const int m_nb_header_confirm_count = 2;
+    bool m_is_header_valid = false;
+    SuperFrameHeader m_header;
+    SuperFrameHeader m_candidate_header;
+    int m_nb_candidate_count = 0;
+    // low latency mode emits access units as soon as their bytes arrive if their crc is valid
+    // so audio isn't held back until the last logical frame of the superframe is reed solomon corrected
+    bool m_is_low_latency = false;
+    // header of the current superframe was decoded before reed solomon
+    bool m_is_early_header = false;
+    int m_num_aus = 0;
+    uint16_t m_au_start[7] = {0};
+    // access units before this have already been emitted for the current superframe
+    int m_next_au = 0;
     // callback signatures
     // frame_index, crc_got, crc_calculated
-    Observable<const int, const uint16_t, const uint16_t> m_obs_firecode_error;
+    Ref_Observable<const int, const uint16_t, const uint16_t> m_obs_firecode_error;
     // rs_frame_index, rs_total_frames
-    Observable<const int, const int> m_obs_rs_error;
+    Ref_Observable<const int, const int> m_obs_rs_error;
     // superframe_header
-    Observable<SuperFrameHeader> m_obs_superframe_header;
+    Ref_Observable<SuperFrameHeader> m_obs_superframe_header;
     // au_index, total_aus, crc_got, crc_calculated
-    Observable<const int, const int, const uint16_t, const uint16_t> m_obs_au_crc_error;
+    Ref_Observable<const int, const int, const uint16_t, const uint16_t> m_obs_au_crc_error;
     // au_index, total_aus, au_buffer
-    Observable<const int, const int , tcb::span<uint8_t>> m_obs_access_unit;
+    Ref_Observable<const int, const int , tcb::span<uint8_t>> m_obs_access_unit;
 public:
-    AAC_Frame_Processor();
+    explicit AAC_Frame_Processor(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~AAC_Frame_Processor();
     // A audio super frame consists of 5 DAB logical frames
-    void Process(tcb::span<const uint8_t> buf);
+    // byte_soft_errors is optional and lets the least reliable bytes be erased if reed solomon fails
+    void Process(tcb::span<const uint8_t> buf, tcb::span<const uint16_t> byte_soft_errors={});
+    // Drop a partially collected superframe and wait for the start of the next one
+    void Reset();
+    // Count a logical frame that was too corrupted to be worth decoding
+    // The superframe it belongs to is dropped without reed solomon or firecode searches
+    // but the superframe sync is kept so decoding resumes straight away once the signal recovers
+    void Skip();
+    // Logical frames of the current superframe that were received (0 while waiting for a superframe to start)
+    int GetSuperFramePhase() const { return (m_state == State::COLLECT_FRAMES) ? m_curr_dab_frame : 0; }
+    // NOTE: A corrupt access unit whose 16bit crc happens to match is emitted without reed solomon correction
+    //       Access units that fail their crc early are still emitted after reed solomon corrects them
+    void SetIsLowLatency(const bool is_low_latency) { m_is_low_latency = is_low_latency; }
+    bool GetIsLowLatency() const { return m_is_low_latency; }
+    // Superframe and reed solomon buffers
+    size_t GetMemoryBytes() const;
     auto& OnFirecodeError(void) { return m_obs_firecode_error; }
     auto& OnRSError(void) { return m_obs_rs_error; }
     auto& OnSuperFrameHeader(void) { return m_obs_superframe_header; }
     auto& OnAccessUnitCRCError(void) { return m_obs_au_crc_error; }
     auto& OnAccessUnit(void) { return m_obs_access_unit; }
 private:
-    bool CalculateFirecode(tcb::span<const uint8_t> buf);
-    void AccumulateFrame(tcb::span<const uint8_t> buf);
+    bool CalculateFirecode(tcb::span<const uint8_t> buf, const bool is_notify_error=true);
+    void AccumulateFrame(tcb::span<const uint8_t> buf, tcb::span<const uint16_t> byte_soft_errors);
+    void ProcessEarlyAccessUnits(const int nb_dab_frame_bytes);
     void ProcessSuperFrame(const int nb_dab_frame_bytes);
+    SuperFrameHeader ReadSuperFrameHeader(const int nb_dab_frame_bytes);
+    void UpdateSuperFrameHeader(const SuperFrameHeader& super_frame_header);
+    // Returns false if the access unit is out of bounds or its crc didn't match
+    bool ProcessAccessUnit(const int index, const bool is_notify_error);
 private:
+    void CreateReedSolomonDecoder();
     bool ReedSolomonDecode(const int nb_dab_frame_bytes);
+    int ReedSolomonDecodeErasures(uint8_t* codeword);
 };
\ No newline at end of file
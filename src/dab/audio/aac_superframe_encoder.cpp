@@ -0,0 +1,168 @@
+#include "./aac_superframe_encoder.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include "utility/span.h"
+#include "./aac_frame_processor.h"
+#include "../algorithms/crc.h"
+#include "../algorithms/reed_solomon_encoder.h"
+
+constexpr int TOTAL_DAB_FRAMES = 5;
+constexpr int MAX_ACCESS_UNITS = 6;
+constexpr int NB_FIRECODE_CRC16_BYTES = 2;
+constexpr int NB_FIRECODE_DATA_BYTES = 9;
+constexpr int NB_AU_CRC16_BYTES = 2;
+// 12bit start addresses
+constexpr int MAX_AU_ADDRESS = 0xFFF;
+
+// Reed solomon encoder paramters
+constexpr int NB_RS_MESSAGE_BYTES = 120;
+constexpr int NB_RS_DATA_BYTES    = 110;
+constexpr int NB_RS_PARITY_BYTES  = 10;
+
+static auto FIRECODE_CRC_CALC = []() {
+    // DOC: ETSI TS 102 563
+    // Refer to the section below table 2 in clause 5.2
+    // G(x) = x^16 + x^14 + x^13 + x^12 + x^11 + x^5 + x^3 + x^2 + x^1 + 1
+    const uint16_t firecode_poly = 0b0111100000101111;
+    auto calc = new CRC_Calculator<uint16_t>(firecode_poly);
+    calc->SetInitialValue(0x0000);
+    calc->SetFinalXORValue(0x0000);
+    return calc;
+} ();
+
+static auto ACCESS_UNIT_CRC_CALC = []() {
+    // DOC: ETSI TS 102 563
+    // Refer to the section below table 1 in clause 5.2
+    // G(x) = x^16 + x^12 + x^5 + 1
+    const uint16_t au_crc_poly = 0b0001000000100001;
+    auto calc = new CRC_Calculator<uint16_t>(au_crc_poly);
+    calc->SetInitialValue(0xFFFF);
+    calc->SetFinalXORValue(0xFFFF);
+    return calc;
+} ();
+
+// Number of bytes taken by the (N-1) 12bit start addresses after the header
+static int get_nb_au_start_bytes(const int total_access_units) {
+    return ((total_access_units-1)*12 + 7)/8;
+}
+
+AAC_Superframe_Encoder::AAC_Superframe_Encoder(const int nb_frame_bytes)
+: m_nb_frame_bytes(nb_frame_bytes)
+{
+    // DOC: ETSI TS 102 563
+    // Clause 6.1 - Reed-Solomon coding
+    // P(x) = x^8 + x^4 + x^3 + x^2 + 1
+    // G(x) = (x+λ^0)*(x+λ^1)*...*(x+λ^9)
+    const int GALOIS_FIELD_POLY = 0b100011101;
+    m_rs_encoder = std::make_unique<Reed_Solomon_Encoder>(GALOIS_FIELD_POLY, 0, NB_RS_PARITY_BYTES);
+}
+
+AAC_Superframe_Encoder::~AAC_Superframe_Encoder() = default;
+
+int AAC_Superframe_Encoder::GetSuperframeSize() const {
+    return TOTAL_DAB_FRAMES*m_nb_frame_bytes;
+}
+
+int AAC_Superframe_Encoder::GetTotalAccessUnits(const SuperFrameHeader& header) {
+    // DOC: ETSI TS 102 563
+    // Clause 5.2 - Audio super framing syntax
+    const bool is_48kHz = (header.sampling_rate == 48000);
+    if (header.SBR_flag) return is_48kHz ? 3 : 2;
+    return is_48kHz ? 6 : 4;
+}
+
+int AAC_Superframe_Encoder::GetMaxAccessUnitBytes(const SuperFrameHeader& header) const {
+    const int N = GetSuperframeSize()/NB_RS_MESSAGE_BYTES;
+    const int total_access_units = GetTotalAccessUnits(header);
+    const int nb_header_bytes = NB_FIRECODE_CRC16_BYTES + 1 + get_nb_au_start_bytes(total_access_units);
+    return N*NB_RS_DATA_BYTES - nb_header_bytes - total_access_units*NB_AU_CRC16_BYTES;
+}
+
+bool AAC_Superframe_Encoder::Encode(
+    const SuperFrameHeader& header, tcb::span<const tcb::span<const uint8_t>> access_units,
+    tcb::span<uint8_t> superframe_out) const
+{
+    const int nb_superframe_bytes = GetSuperframeSize();
+    if ((nb_superframe_bytes <= 0) || (nb_superframe_bytes % NB_RS_MESSAGE_BYTES) != 0) {
+        return false;
+    }
+    if (superframe_out.size() != size_t(nb_superframe_bytes)) {
+        return false;
+    }
+    const int total_access_units = GetTotalAccessUnits(header);
+    if (access_units.size() != size_t(total_access_units)) {
+        return false;
+    }
+    const int max_au_bytes = GetMaxAccessUnitBytes(header);
+    int total_au_bytes = 0;
+    for (const auto& access_unit: access_units) {
+        total_au_bytes += int(access_unit.size());
+    }
+    if (total_au_bytes > max_au_bytes) {
+        return false;
+    }
+
+    // Padding is split evenly and the remainder goes to the last access unit
+    const int N = nb_superframe_bytes/NB_RS_MESSAGE_BYTES;
+    const int nb_data_bytes = N*NB_RS_DATA_BYTES;
+    const int nb_padding_bytes = max_au_bytes - total_au_bytes;
+    int au_start[MAX_ACCESS_UNITS+1];
+    au_start[0] = NB_FIRECODE_CRC16_BYTES + 1 + get_nb_au_start_bytes(total_access_units);
+    for (int i = 0; i < total_access_units; i++) {
+        const int nb_au_bytes = int(access_units[size_t(i)].size()) + NB_AU_CRC16_BYTES + nb_padding_bytes/total_access_units;
+        au_start[i+1] = au_start[i] + nb_au_bytes;
+    }
+    au_start[total_access_units] = nb_data_bytes;
+    if (au_start[total_access_units-1] > MAX_AU_ADDRESS) {
+        return false;
+    }
+
+    // DOC: ETSI TS 102 563
+    // Clause 5.2 - Audio super framing syntax
+    // Table 2: Syntax of he_aac_super_frame_header()
+    std::fill(superframe_out.begin(), superframe_out.end(), uint8_t(0x00));
+    uint8_t mpeg_config = 0b000;
+    switch (header.mpeg_surround) {
+    case MPEG_Surround::NOT_USED:       mpeg_config = 0b000; break;
+    case MPEG_Surround::SURROUND_51:    mpeg_config = 0b001; break;
+    case MPEG_Surround::SURROUND_OTHER: mpeg_config = 0b111; break;
+    case MPEG_Surround::RFA:            mpeg_config = 0b010; break;
+    }
+    superframe_out[2] = uint8_t(
+        ((header.sampling_rate == 48000) ? 0b01000000 : 0) |
+        (header.SBR_flag  ? 0b00100000 : 0) |
+        (header.is_stereo ? 0b00010000 : 0) |
+        (header.PS_flag   ? 0b00001000 : 0) |
+        mpeg_config);
+    int curr_bit = 3*8;
+    for (int i = 1; i < total_access_units; i++) {
+        for (int j = 11; j >= 0; j--) {
+            const uint8_t bit = uint8_t((au_start[i] >> j) & 0b1);
+            superframe_out[size_t(curr_bit/8)] |= uint8_t(bit << (7-(curr_bit%8)));
+            curr_bit++;
+        }
+    }
+    const uint16_t firecode = FIRECODE_CRC_CALC->Process(superframe_out.subspan(NB_FIRECODE_CRC16_BYTES, NB_FIRECODE_DATA_BYTES));
+    superframe_out[0] = uint8_t(firecode >> 8);
+    superframe_out[1] = uint8_t(firecode & 0xFF);
+
+    for (int i = 0; i < total_access_units; i++) {
+        const auto& payload = access_units[size_t(i)];
+        const size_t nb_au_bytes = size_t(au_start[i+1]-au_start[i]);
+        auto access_unit = superframe_out.subspan(size_t(au_start[i]), nb_au_bytes);
+        std::copy(payload.begin(), payload.end(), access_unit.begin());
+        const uint16_t crc = ACCESS_UNIT_CRC_CALC->Process(access_unit.first(nb_au_bytes-NB_AU_CRC16_BYTES));
+        access_unit[nb_au_bytes-2] = uint8_t(crc >> 8);
+        access_unit[nb_au_bytes-1] = uint8_t(crc & 0xFF);
+    }
+
+    // DOC: ETSI TS 102 563
+    // Clause 6 - Transport error coding and interleaving
+    // Codeword i is made from every N-th byte starting from byte i
+    for (int i = 0; i < N; i++) {
+        m_rs_encoder->Encode(&superframe_out[size_t(i)], NB_RS_DATA_BYTES, size_t(N));
+    }
+    return true;
+}
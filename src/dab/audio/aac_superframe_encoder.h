@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include "utility/span.h"
+#include "./aac_frame_processor.h"
+
+class Reed_Solomon_Encoder;
+
+// Builds DAB+ audio superframes out of AAC access units
+// This is the inverse of AAC_Frame_Processor
+// 1. Superframe header with its firecode and the start address of each access unit
+// 2. CRC16 of each access unit
+// 3. RS(120,110) parity of the interleaved codewords
+class AAC_Superframe_Encoder
+{
+private:
+    const int m_nb_frame_bytes;
+    std::unique_ptr<Reed_Solomon_Encoder> m_rs_encoder;
+public:
+    // nb_frame_bytes is the size of each of the 5 DAB logical frames in a superframe
+    explicit AAC_Superframe_Encoder(const int nb_frame_bytes);
+    ~AAC_Superframe_Encoder();
+    AAC_Superframe_Encoder(AAC_Superframe_Encoder&) = delete;
+    AAC_Superframe_Encoder(AAC_Superframe_Encoder&&) = delete;
+    AAC_Superframe_Encoder& operator=(AAC_Superframe_Encoder&) = delete;
+    AAC_Superframe_Encoder& operator=(AAC_Superframe_Encoder&&) = delete;
+    // superframe_out has GetSuperframeSize() bytes and there must be GetTotalAccessUnits() access units
+    // Unused bytes are spread evenly over the access units as zero padding after their payload
+    // Returns false if the sizes don't match or the access units don't fit
+    bool Encode(
+        const SuperFrameHeader& header, tcb::span<const tcb::span<const uint8_t>> access_units,
+        tcb::span<uint8_t> superframe_out) const;
+    int GetSuperframeSize() const;
+    // Total payload of all the access units in a superframe excluding their CRCs
+    int GetMaxAccessUnitBytes(const SuperFrameHeader& header) const;
+    static int GetTotalAccessUnits(const SuperFrameHeader& header);
+};
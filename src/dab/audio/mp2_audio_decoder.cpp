@@ -30,11 +30,13 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 
 #ifndef PLM_MALLOC
     #define PLM_MALLOC(sz) malloc(sz)
     #define PLM_FREE(p) free(p)
-    #define PLM_REALLOC(p, sz) realloc(p, sz)
 #endif
 
 #define PLM_UNUSED(expr) (void)(expr)
@@ -42,30 +44,23 @@ SOFTWARE.
 // -----------------------------------------------------------------------------
 struct plm_buffer_t {
     size_t bit_index;
-    size_t capacity;
     size_t length;
-    size_t total_size;
-    uint8_t *bytes;
+    const uint8_t *bytes;
 };
 
-static void plm_buffer_discard_read_bytes(plm_buffer_t *self);
 static bool plm_buffer_has_bits(const plm_buffer_t *self, size_t count);
 static int plm_buffer_read(plm_buffer_t *self, int count);
 static void plm_buffer_align(plm_buffer_t *self);
 static void plm_buffer_skip(plm_buffer_t *self, size_t count);
 static int plm_buffer_skip_bytes(plm_buffer_t *self, uint8_t v);
 
-plm_buffer_t *plm_buffer_create_with_capacity(size_t capacity) {
-    assert(capacity != 0);
+plm_buffer_t *plm_buffer_create(void) {
     plm_buffer_t *self = reinterpret_cast<plm_buffer_t *>(PLM_MALLOC(sizeof(plm_buffer_t)));
     memset(self, 0, sizeof(plm_buffer_t));
-    self->capacity = capacity;
-    self->bytes = reinterpret_cast<uint8_t *>(PLM_MALLOC(capacity));
     return self;
 }
 
 void plm_buffer_destroy(plm_buffer_t *self) {
-    PLM_FREE(self->bytes);
     PLM_FREE(self);
 }
 
@@ -77,34 +72,16 @@ size_t plm_buffer_get_remaining(const plm_buffer_t *self) {
     return self->length - plm_buffer_get_read_head_bytes(self);
 }
 
-size_t plm_buffer_write(plm_buffer_t *self, const uint8_t *bytes, size_t length) {
-    // This should be a ring buffer, but instead it just shifts all unread 
-    // data to the beginning of the buffer and appends new data at the end. 
-    // Seems to be good enough.
-    plm_buffer_discard_read_bytes(self);
-    self->total_size = 0;
-
-    // Do we have to resize to fit the new data?
-    size_t bytes_available = self->capacity - self->length;
-    if (bytes_available < length) {
-        size_t new_size = self->capacity;
-        do {
-            new_size *= 2;
-        } while (new_size - self->length < length);
-        self->bytes = reinterpret_cast<uint8_t *>(PLM_REALLOC(self->bytes, new_size));
-        self->capacity = new_size;
-    }
-
-    memcpy(self->bytes + self->length, bytes, length);
-    self->length += length;
-    return length;
+void plm_buffer_set_data(plm_buffer_t *self, const uint8_t *bytes, size_t length) {
+    self->bytes = bytes;
+    self->length = length;
+    self->bit_index = 0;
 }
 
-
 void plm_buffer_rewind(plm_buffer_t *self) {
     self->bit_index = 0;
     self->length = 0;
-    self->total_size = 0;
+    self->bytes = nullptr;
 }
 
 size_t plm_buffer_get_read_head_bytes(const plm_buffer_t *self) {
@@ -118,19 +95,6 @@ bool plm_buffer_has_bits(const plm_buffer_t *self, size_t count) {
     return false;
 }
 
-void plm_buffer_discard_read_bytes(plm_buffer_t *self) {
-    size_t byte_pos = plm_buffer_get_read_head_bytes(self);
-    if (byte_pos == self->length) {
-        self->bit_index = 0;
-        self->length = 0;
-    }
-    else if (byte_pos > 0) {
-        memmove(self->bytes, self->bytes + byte_pos, self->length - byte_pos);
-        self->bit_index -= byte_pos << 3;
-        self->length -= byte_pos;
-    }
-}
-
 int plm_buffer_read(plm_buffer_t *self, int count) {
     if (!plm_buffer_has_bits(self, count)) {
         return 0;
@@ -433,6 +397,7 @@ static void plm_audio_decode_frame(plm_audio_t *self);
 static const plm_quantizer_spec_t *plm_audio_read_allocation(plm_audio_t *self, int sb, int tab3);
 static void plm_audio_read_samples(plm_audio_t *self, int ch, int sb, int part); 
 static void plm_audio_idct36(int s[32][3], int ss, float *d, int dp);
+static void plm_audio_synthesis_window_auto(const float *D, const float *V, int v_pos, float *U);
 
 plm_audio_t *plm_audio_create_with_buffer(plm_buffer_t *buffer) {
     plm_audio_t *self = reinterpret_cast<plm_audio_t *>(PLM_MALLOC(sizeof(plm_audio_t)));
@@ -491,6 +456,11 @@ void plm_audio_rewind(plm_audio_t *self) {
     self->samples_decoded = 0;
 }
 
+void plm_audio_clear_history(plm_audio_t *self) {
+    memset(self->V, 0, sizeof(self->V));
+    self->v_pos = 0;
+}
+
 plm_samples_t *plm_audio_decode(plm_audio_t *self, int data_frame_size) {
     if (data_frame_size == 0) {
         return nullptr;
@@ -715,29 +685,7 @@ void plm_audio_decode_frame(plm_audio_t *self) {
                     plm_audio_idct36(self->sample[ch], p, self->V[ch], self->v_pos);
 
                     // Build U, windowing, calculate output
-                    memset(self->U, 0, sizeof(self->U));
-
-                    int d_index = 512 - (self->v_pos >> 1);
-                    int v_index = (self->v_pos % 128) >> 1;
-                    while (v_index < 1024) {
-                        for (int i = 0; i < 32; ++i) {
-                            self->U[i] += self->D[d_index++] * self->V[ch][v_index++];
-                        }
-
-                        v_index += 128 - 32;
-                        d_index += 64 - 32;
-                    }
-
-                    d_index -= (512 - 32);
-                    v_index = (128 - 32 + 1024) - v_index;
-                    while (v_index < 1024) {
-                        for (int i = 0; i < 32; ++i) {
-                            self->U[i] += self->D[d_index++] * self->V[ch][v_index++];
-                        }
-
-                        v_index += 128 - 32;
-                        d_index += 64 - 32;
-                    }
+                    plm_audio_synthesis_window_auto(self->D, self->V[ch], self->v_pos, self->U);
 
                     // Output samples
                     #ifdef PLM_AUDIO_SEPARATE_CHANNELS
@@ -960,3 +908,143 @@ void plm_audio_idct36(int s[32][3], int ss, float *d, int dp) {
     d[dp + 14] = t31; d[dp + 17] = -t02;
     d[dp + 15] = t02; d[dp + 16] = 0.0;
 }
+
+// Synthesis windowing
+// Each output block of 32 samples is the sum of 16 rows of 32 window coefficients multiplied by V
+// This is most of the decoding time so it is vectorised across the 32 samples
+// The rows of V and D are visited in the same order for every implementation
+// ROW is run for each row with d and v pointing to the 32 window coefficients and samples
+#define PLM_AUDIO_SYNTHESIS_ROWS(ROW) \
+    do { \
+        int d_index = 512 - (v_pos >> 1); \
+        int v_index = (v_pos % 128) >> 1; \
+        while (v_index < 1024) { \
+            const float *d = &D[d_index]; \
+            const float *v = &V[v_index]; \
+            ROW \
+            v_index += 128; \
+            d_index += 64; \
+        } \
+        d_index -= (512 - 32); \
+        v_index = (128 - 32 + 1024) - v_index; \
+        while (v_index < 1024) { \
+            const float *d = &D[d_index]; \
+            const float *v = &V[v_index]; \
+            ROW \
+            v_index += 128; \
+            d_index += 64; \
+        } \
+    } while (0)
+
+static void plm_audio_synthesis_window_scalar(const float *D, const float *V, int v_pos, float *U) {
+    memset(U, 0, 32*sizeof(float));
+    PLM_AUDIO_SYNTHESIS_ROWS({
+        for (int i = 0; i < 32; i++) {
+            U[i] += d[i] * v[i];
+        }
+    });
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+SIMD_TARGET_SSE4_1 static void plm_audio_synthesis_window_sse4_1(const float *D, const float *V, int v_pos, float *U) {
+    __m128 acc[8];
+    for (int k = 0; k < 8; k++) acc[k] = _mm_setzero_ps();
+    PLM_AUDIO_SYNTHESIS_ROWS({
+        for (int k = 0; k < 8; k++) {
+            acc[k] = _mm_add_ps(acc[k], _mm_mul_ps(_mm_loadu_ps(&d[k*4]), _mm_loadu_ps(&v[k*4])));
+        }
+    });
+    for (int k = 0; k < 8; k++) _mm_storeu_ps(&U[k*4], acc[k]);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+SIMD_TARGET_AVX2 static void plm_audio_synthesis_window_avx2(const float *D, const float *V, int v_pos, float *U) {
+    __m256 acc[4];
+    for (int k = 0; k < 4; k++) acc[k] = _mm256_setzero_ps();
+    PLM_AUDIO_SYNTHESIS_ROWS({
+        for (int k = 0; k < 4; k++) {
+            acc[k] = _mm256_fmadd_ps(_mm256_loadu_ps(&d[k*8]), _mm256_loadu_ps(&v[k*8]), acc[k]);
+        }
+    });
+    for (int k = 0; k < 4; k++) _mm256_storeu_ps(&U[k*8], acc[k]);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+static void plm_audio_synthesis_window_neon(const float *D, const float *V, int v_pos, float *U) {
+    float32x4_t acc[8];
+    for (int k = 0; k < 8; k++) acc[k] = vdupq_n_f32(0.0f);
+    PLM_AUDIO_SYNTHESIS_ROWS({
+        for (int k = 0; k < 8; k++) {
+            acc[k] = vfmaq_f32(acc[k], vld1q_f32(&d[k*4]), vld1q_f32(&v[k*4]));
+        }
+    });
+    for (int k = 0; k < 8; k++) vst1q_f32(&U[k*4], acc[k]);
+}
+
+#endif
+
+static void plm_audio_synthesis_window_auto(const float *D, const float *V, int v_pos, float *U) {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return plm_audio_synthesis_window_avx2(D, V, v_pos, U);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return plm_audio_synthesis_window_sse4_1(D, V, v_pos, U);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return plm_audio_synthesis_window_neon(D, V, v_pos, U);
+        }
+    #endif
+    (void)level;
+    plm_audio_synthesis_window_scalar(D, V, v_pos, U);
+}
+
+// -----------------------------------------------------------------------------
+// MP2_Audio_Decoder
+
+MP2_Audio_Decoder::MP2_Audio_Decoder() {
+    m_buffer = plm_buffer_create();
+    m_audio = plm_audio_create_with_buffer(m_buffer);
+}
+
+MP2_Audio_Decoder::~MP2_Audio_Decoder() {
+    plm_audio_destroy(m_audio);
+    plm_buffer_destroy(m_buffer);
+}
+
+void MP2_Audio_Decoder::Reset() {
+    plm_audio_clear_history(m_audio);
+}
+
+MP2_Audio_Decoder::Result MP2_Audio_Decoder::DecodeFrame(tcb::span<const uint8_t> frame) {
+    Result res;
+    res.samples = nullptr;
+    res.total_audio_bytes = 0;
+    res.is_error = true;
+
+    plm_buffer_set_data(m_buffer, frame.data(), frame.size());
+    const int total_data_bytes = plm_audio_decode_header(m_audio);
+    if (total_data_bytes > 0) {
+        res.samples = plm_audio_decode(m_audio, total_data_bytes);
+    }
+    res.total_audio_bytes = plm_buffer_get_read_head_bytes(m_buffer);
+    res.is_error = (res.samples == nullptr);
+    // the frame is only borrowed for this call
+    plm_buffer_rewind(m_buffer);
+    return res;
+}
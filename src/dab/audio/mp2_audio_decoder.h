@@ -45,23 +45,15 @@ samples for the left and right channel interleaved, or if the
 PLM_AUDIO_SEPARATE_CHANNELS is defined *before* including this library, into
 two separate float arrays - one for each channel.
 
-When using your own plm_buffer_t instance, you can fill this buffer using 
-plm_buffer_write(). You can either monitor plm_buffer_get_remaining() and push 
-data when appropriate, or install a callback on the buffer with 
-plm_buffer_set_load_callback() that gets called whenever the buffer needs more 
-data.
-
-A buffer created with plm_buffer_create_with_capacity() is treated as a ring
-buffer, meaning that data that has already been read, will be discarded. In
-contrast, a buffer created with plm_buffer_create_for_appending() will keep all
-data written to it in memory. This enables seeking in the already loaded data.
-
-This library uses malloc(), realloc() and free() to manage memory. Typically 
-all allocation happens up-front when creating the interface. However, the
-default buffer size may be too small for certain inputs. In these cases plmpeg
-will realloc() the buffer with a larger size whenever needed.
-
-You can also define PLM_MALLOC, PLM_REALLOC and PLM_FREE to provide your own
+A plm_buffer_t doesn't own any data. It is a bit reader over memory given to
+plm_buffer_set_data() which must stay valid while the frame is being decoded.
+DAB delivers one complete audio frame at a time so frames are read in place
+without being copied or compacted.
+
+This library uses malloc() and free() to manage memory. All allocation happens
+up-front when creating the interface.
+
+You can also define PLM_MALLOC and PLM_FREE to provide your own
 memory management functions.
 
 See below for detailed the API documentation.
@@ -70,8 +62,10 @@ See below for detailed the API documentation.
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "utility/span.h"
 
 // -----------------------------------------------------------------------------
 // Public Data Types
@@ -96,26 +90,20 @@ typedef struct {
 // plm_buffer public API
 // Provides the data source for all other plm_* interfaces
 
-// Create an empty buffer with an initial capacity. The buffer will grow
-// as needed. Data that has already been read, will be discarded.
-plm_buffer_t *plm_buffer_create_with_capacity(size_t capacity);
+// Create an empty buffer which reads from memory owned by the caller
+plm_buffer_t *plm_buffer_create(void);
 
-// Destroy a buffer instance and free all data
+// Destroy a buffer instance
 void plm_buffer_destroy(plm_buffer_t *self);
 
-// Copy data into the buffer. If the data to be written is larger than the 
-// available space, the buffer will realloc() with a larger capacity. 
-// Returns the number of bytes written. This will always be the same as the
-// passed in length, except when the buffer was created _with_memory() for
-// which _write() is forbidden.
-size_t plm_buffer_write(plm_buffer_t *self, const uint8_t *bytes, size_t length);
+// Read from bytes starting at the first bit. The data is not copied and must
+// outlive any decoding done with this buffer.
+void plm_buffer_set_data(plm_buffer_t *self, const uint8_t *bytes, size_t length);
 
-// Rewind the buffer back to the beginning. When loading from a file handle,
-// this also seeks to the beginning of the file.
+// Rewind the buffer back to the beginning and forget the data.
 void plm_buffer_rewind(plm_buffer_t *self);
 
-// Get the total size. For files, this returns the file size. For all other 
-// types it returns the number of bytes currently in the buffer.
+// Get the number of bytes in the buffer.
 size_t plm_buffer_get_size(const plm_buffer_t *self);
 
 // Get the number of remaining (yet unread) bytes in the buffer. This can be
@@ -158,6 +146,10 @@ void plm_audio_set_time(plm_audio_t *self, double time);
 // Rewind the internal buffer. See plm_buffer_rewind().
 void plm_audio_rewind(plm_audio_t *self);
 
+// Clear the synthesis filterbank so the next frame doesn't overlap with
+// audio from before a gap in the stream.
+void plm_audio_clear_history(plm_audio_t *self);
+
 // Decode header and return number of bytes for entire data frame
 int plm_audio_decode_header(plm_audio_t *self);
 
@@ -166,3 +158,35 @@ int plm_audio_decode_header(plm_audio_t *self);
 // is valid until the next call of plm_audio_decode() or until the audio
 // decoder is destroyed.
 plm_samples_t *plm_audio_decode(plm_audio_t *self, int data_frame_size);
+
+// -----------------------------------------------------------------------------
+// Wrapper around the plm_audio decoder
+// Consumes one complete MP2 frame at a time directly from the MSC decoder output
+// Outputs interleaved stereo float samples
+class MP2_Audio_Decoder
+{
+public:
+    struct Result {
+        // Valid until the next call to DecodeFrame()
+        const plm_samples_t* samples;
+        // Bytes read by the decoder with the PAD following them
+        size_t total_audio_bytes;
+        bool is_error;
+    };
+private:
+    plm_buffer_t* m_buffer;
+    plm_audio_t* m_audio;
+public:
+    MP2_Audio_Decoder();
+    ~MP2_Audio_Decoder();
+    MP2_Audio_Decoder(MP2_Audio_Decoder&) = delete;
+    MP2_Audio_Decoder(MP2_Audio_Decoder&&) = delete;
+    MP2_Audio_Decoder& operator=(MP2_Audio_Decoder&) = delete;
+    MP2_Audio_Decoder& operator=(MP2_Audio_Decoder&&) = delete;
+    Result DecodeFrame(tcb::span<const uint8_t> frame);
+    // Forget the previous frames when the stream is interrupted
+    void Reset();
+    int GetBitrate() const { return plm_audio_get_bitrate(m_audio); }
+    int GetTotalChannels() const { return plm_audio_get_channels(m_audio); }
+    int GetSampleRate() const { return plm_audio_get_samplerate(m_audio); }
+};
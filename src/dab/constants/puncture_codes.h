@@ -39,7 +39,7 @@
 
 // NOTE: Convert the puncture codes to a count table 
 //       This is more efficient when we are depuncturing an encoded symbol stream
-const uint8_t PI_TABLE[24][8] = {
+constexpr uint8_t PI_TABLE[24][8] = {
     { 2, 1, 1, 1, 1, 1, 1, 1},
     { 2, 1, 1, 1, 2, 1, 1, 1},
     { 2, 1, 2, 1, 2, 1, 1, 1},
@@ -66,7 +66,7 @@ const uint8_t PI_TABLE[24][8] = {
     { 4, 4, 4, 4, 4, 4, 4, 4},
 };
 
-const uint8_t PI_X[6] = {2, 2, 2, 2, 2, 2};
+constexpr uint8_t PI_X[6] = {2, 2, 2, 2, 2, 2};
 
 // Puncture codes are indexed starting from 1
 static tcb::span<const uint8_t> GetPunctureCode(const int x) {
@@ -1,5 +1,18 @@
 #pragma once
 
+// Messages below DAB_LOG_LEVEL are stripped at compile time so their arguments are never evaluated
+// Messages that are compiled in are only formatted if the logger has the level enabled at runtime
+// NOTE: Per frame messages in the decoding hot paths use DAB_LOG_DEBUG
+#define DAB_LOG_LEVEL_DEBUG 0
+#define DAB_LOG_LEVEL_INFO 1
+#define DAB_LOG_LEVEL_WARN 2
+#define DAB_LOG_LEVEL_ERROR 3
+#define DAB_LOG_LEVEL_NONE 4
+
+#ifndef DAB_LOG_LEVEL
+#define DAB_LOG_LEVEL DAB_LOG_LEVEL_INFO
+#endif
+
 #if DAB_LOGGING_USE_EASYLOGGING
 
 #include <easylogging++.h>
@@ -14,15 +27,44 @@ static bool DAB_LOG_REGISTER(const char* name) {
     loggers.push_back(name);
     return true;
 }
-static void DAB_LOG_MESSAGE(const char* name, const std::string&& message) { CLOG(INFO, name) << message; }
-static void DAB_LOG_WARN(const char* name, const std::string&& message) { CLOG(WARNING, name) << message; }
-static void DAB_LOG_ERROR(const char* name, const std::string&& message) { CLOG(ERROR, name) << message; }
+static inline bool DAB_LOG_IS_ENABLED(const char* name, const el::Level level) {
+    auto* logger = el::Loggers::getLogger(name, false);
+    return (logger != nullptr) && logger->enabled(level);
+}
+#define DAB_LOG_IMPL(name, clog_level, level, message) \
+    do { if (DAB_LOG_IS_ENABLED(name, level)) { CLOG(clog_level, name) << (message); } } while (0)
+
+#if DAB_LOG_LEVEL <= DAB_LOG_LEVEL_DEBUG
+#define DAB_LOG_DEBUG(name, message) DAB_LOG_IMPL(name, DEBUG, el::Level::Debug, message)
+#endif
+#if DAB_LOG_LEVEL <= DAB_LOG_LEVEL_INFO
+#define DAB_LOG_MESSAGE(name, message) DAB_LOG_IMPL(name, INFO, el::Level::Info, message)
+#endif
+#if DAB_LOG_LEVEL <= DAB_LOG_LEVEL_WARN
+#define DAB_LOG_WARN(name, message) DAB_LOG_IMPL(name, WARNING, el::Level::Warning, message)
+#endif
+#if DAB_LOG_LEVEL <= DAB_LOG_LEVEL_ERROR
+#define DAB_LOG_ERROR(name, message) DAB_LOG_IMPL(name, ERROR, el::Level::Error, message)
+#endif
 
 #else
 
 static bool DAB_LOG_REGISTER(const char* name) { return false; }
-#define DAB_LOG_MESSAGE(name, message) (void)0
-#define DAB_LOG_WARN(name, message) (void)0
-#define DAB_LOG_ERROR(name, message) (void)0
 
 #endif
+
+// Stripped messages still reference their arguments so values only used for logging aren't unused
+// NOTE: The arguments are never evaluated
+#define DAB_LOG_STRIPPED(name, message) do { if (false) { (void)(name); (void)(message); } } while (0)
+#ifndef DAB_LOG_DEBUG
+#define DAB_LOG_DEBUG(name, message) DAB_LOG_STRIPPED(name, message)
+#endif
+#ifndef DAB_LOG_MESSAGE
+#define DAB_LOG_MESSAGE(name, message) DAB_LOG_STRIPPED(name, message)
+#endif
+#ifndef DAB_LOG_WARN
+#define DAB_LOG_WARN(name, message) DAB_LOG_STRIPPED(name, message)
+#endif
+#ifndef DAB_LOG_ERROR
+#define DAB_LOG_ERROR(name, message) DAB_LOG_STRIPPED(name, message)
+#endif
@@ -26,4 +26,10 @@ struct DAB_Datetime {
 struct DAB_Misc_Info {
     DAB_Datetime datetime;
     DAB_CIF_Counter cif_counter;
+    // DOC: ETSI EN 300 401
+    // Clause 6.4: Ensemble information
+    // Non zero if the subchannel or service organisation is about to be reconfigured
+    uint8_t change_flags = 0;
+    // Lower part of the CIF count at which the reconfiguration occurs
+    uint8_t occurrence_change = 0;
 };
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
 #include <vector>
+#include "utility/memory_usage.h"
 #include "./dab_database_entities.h"
+#include "./dab_database_types.h"
 
-struct DAB_Database 
+struct DAB_Database
 {
 public:
     Ensemble ensemble;
@@ -15,7 +20,25 @@ public:
     std::vector<DRM_Service> drm_services;
     std::vector<AMSS_Service> amss_services;
     std::vector<OtherEnsemble> other_ensembles;
-
+private:
+    // Side tables from identifiers to indices into the above vectors
+    // NOTE: Entries are only added through DAB_Database_Updater which keeps these in sync
+    friend class DAB_Database_Updater;
+    friend class ServiceComponentUpdater;
+    template <typename K>
+    using Lookup = std::unordered_map<K, size_t>;
+    Lookup<service_id_t> m_service_lookup;
+    Lookup<uint64_t> m_service_component_lookup;
+    Lookup<subchannel_id_t> m_subchannel_lookup;
+    Lookup<lsn_t> m_link_service_lookup;
+    Lookup<fm_id_t> m_fm_service_lookup;
+    Lookup<drm_id_t> m_drm_service_lookup;
+    Lookup<amss_id_t> m_amss_service_lookup;
+    Lookup<ensemble_id_t> m_other_ensemble_lookup;
+    // Service components refer to these so the first component with the identifier is used
+    Lookup<subchannel_id_t> m_subchannel_component_lookup;
+    Lookup<service_component_global_id_t> m_global_id_component_lookup;
+public:
     void reset() {
         ensemble = Ensemble{};
         services.clear();
@@ -26,5 +49,123 @@ public:
         drm_services.clear();
         amss_services.clear();
         other_ensembles.clear();
+        m_service_lookup.clear();
+        m_service_component_lookup.clear();
+        m_subchannel_lookup.clear();
+        m_link_service_lookup.clear();
+        m_fm_service_lookup.clear();
+        m_drm_service_lookup.clear();
+        m_amss_service_lookup.clear();
+        m_other_ensemble_lookup.clear();
+        m_subchannel_component_lookup.clear();
+        m_global_id_component_lookup.clear();
+    }
+
+    // Entities are grouped by type with the side tables counted together
+    Memory_Usage GetMemoryUsage() const {
+        Memory_Usage usage("database");
+        usage.AddChild("services", get_memory_bytes(services));
+        usage.AddChild("service_components", get_memory_bytes(service_components));
+        usage.AddChild("subchannels", get_memory_bytes(subchannels));
+        usage.AddChild("link_services", get_memory_bytes(link_services));
+        usage.AddChild("fm_services", get_entities_memory_bytes(fm_services));
+        usage.AddChild("drm_services", get_entities_memory_bytes(drm_services));
+        usage.AddChild("amss_services", get_entities_memory_bytes(amss_services));
+        usage.AddChild("other_ensembles", get_memory_bytes(other_ensembles));
+        usage.AddChild("lookups",
+            get_memory_bytes(m_service_lookup) +
+            get_memory_bytes(m_service_component_lookup) +
+            get_memory_bytes(m_subchannel_lookup) +
+            get_memory_bytes(m_link_service_lookup) +
+            get_memory_bytes(m_fm_service_lookup) +
+            get_memory_bytes(m_drm_service_lookup) +
+            get_memory_bytes(m_amss_service_lookup) +
+            get_memory_bytes(m_other_ensemble_lookup) +
+            get_memory_bytes(m_subchannel_component_lookup) +
+            get_memory_bytes(m_global_id_component_lookup));
+        return usage;
+    }
+
+    // Returns nullptr if the entity doesn't exist
+    Service* GetService(const service_id_t service_ref) {
+        return find(m_service_lookup, services, service_ref);
+    }
+    const Service* GetService(const service_id_t service_ref) const {
+        return find(m_service_lookup, services, service_ref);
+    }
+    Subchannel* GetSubchannel(const subchannel_id_t subchannel_id) {
+        return find(m_subchannel_lookup, subchannels, subchannel_id);
+    }
+    const Subchannel* GetSubchannel(const subchannel_id_t subchannel_id) const {
+        return find(m_subchannel_lookup, subchannels, subchannel_id);
+    }
+    ServiceComponent* GetServiceComponent(const service_id_t service_ref, const service_component_id_t component_id) {
+        return find(m_service_component_lookup, service_components, GetServiceComponentKey(service_ref, component_id));
+    }
+    const ServiceComponent* GetServiceComponent(const service_id_t service_ref, const service_component_id_t component_id) const {
+        return find(m_service_component_lookup, service_components, GetServiceComponentKey(service_ref, component_id));
+    }
+    ServiceComponent* GetServiceComponent_Subchannel(const subchannel_id_t subchannel_id) {
+        return find(m_subchannel_component_lookup, service_components, subchannel_id);
+    }
+    const ServiceComponent* GetServiceComponent_Subchannel(const subchannel_id_t subchannel_id) const {
+        return find(m_subchannel_component_lookup, service_components, subchannel_id);
+    }
+    ServiceComponent* GetServiceComponent_GlobalID(const service_component_global_id_t global_id) {
+        return find(m_global_id_component_lookup, service_components, global_id);
+    }
+    const ServiceComponent* GetServiceComponent_GlobalID(const service_component_global_id_t global_id) const {
+        return find(m_global_id_component_lookup, service_components, global_id);
+    }
+private:
+    static uint64_t GetServiceComponentKey(const service_id_t service_ref, const service_component_id_t component_id) {
+        return (uint64_t(service_ref) << 8) | uint64_t(component_id);
+    }
+
+    // Services on other bearers each hold their list of frequencies
+    template <typename T>
+    static size_t get_entities_memory_bytes(const std::vector<T>& entities) {
+        size_t total_bytes = get_memory_bytes(entities);
+        for (const auto& entity: entities) total_bytes += get_memory_bytes(entity.frequencies);
+        return total_bytes;
+    }
+
+    template <typename K, typename T>
+    static T* find(const Lookup<K>& lookup, std::vector<T>& entries, const K key) {
+        auto res = lookup.find(key);
+        if (res == lookup.end()) return nullptr;
+        return &entries[res->second];
+    }
+
+    template <typename K, typename T>
+    static const T* find(const Lookup<K>& lookup, const std::vector<T>& entries, const K key) {
+        auto res = lookup.find(key);
+        if (res == lookup.end()) return nullptr;
+        return &entries[res->second];
+    }
+
+    // Service components can change which subchannel or global id they refer to
+    template <typename K, typename F>
+    void update_component_lookup(Lookup<K>& lookup, const size_t index, const K old_key, const K new_key, const bool is_old_key, F&& get_key) {
+        if (is_old_key) {
+            auto res = lookup.find(old_key);
+            if ((res != lookup.end()) && (res->second == index)) {
+                lookup.erase(res);
+                // fallback to the next component that has the old identifier
+                const size_t N = service_components.size();
+                for (size_t i = 0; i < N; i++) {
+                    if ((i != index) && (get_key(service_components[i]) == old_key)) {
+                        lookup.insert({ old_key, i });
+                        break;
+                    }
+                }
+            }
+        }
+        auto res = lookup.find(new_key);
+        if (res == lookup.end()) {
+            lookup.insert({ new_key, index });
+        } else if (res->second > index) {
+            res->second = index;
+        }
     }
-};
\ No newline at end of file
+};
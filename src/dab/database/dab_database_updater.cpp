@@ -46,7 +46,7 @@ UpdateResult EnsembleUpdater::SetExtendedCountryCode(const extended_country_id_t
 }
 
 UpdateResult EnsembleUpdater::SetLabel(tcb::span<const uint8_t> buf) {
-    auto new_label = std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size());
+    const auto new_label = DAB_Label({ reinterpret_cast<const char*>(buf.data()), buf.size() });
     return UpdateField(GetData().label, new_label, ENSEMBLE_FLAG_LABEL);
 }
 
@@ -91,7 +91,7 @@ UpdateResult ServiceUpdater::SetExtendedCountryCode(const extended_country_id_t
 }
 
 UpdateResult ServiceUpdater::SetLabel(tcb::span<const uint8_t> buf) {
-    auto new_label = std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size());
+    const auto new_label = DAB_Label({ reinterpret_cast<const char*>(buf.data()), buf.size() });
     return UpdateField(GetData().label, new_label, SERVICE_FLAG_LABEL);
 }
 
@@ -123,7 +123,7 @@ const uint8_t SERVICE_COMPONENT_FLAG_REQUIRED_AUDIO = 0b01101000;
 const uint8_t SERVICE_COMPONENT_FLAG_REQUIRED_DATA  = 0b01001000;
 
 UpdateResult ServiceComponentUpdater::SetLabel(tcb::span<const uint8_t> buf) {
-    auto new_label = std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size());
+    const auto new_label = DAB_Label({ reinterpret_cast<const char*>(buf.data()), buf.size() });
     return UpdateField(GetData().label, new_label, SERVICE_COMPONENT_FLAG_LABEL);
 }
 
@@ -158,12 +158,28 @@ UpdateResult ServiceComponentUpdater::SetDataServiceType(const DataServiceType d
 }
 
 UpdateResult ServiceComponentUpdater::SetSubchannel(const subchannel_id_t subchannel_id) {
-    return UpdateField(GetData().subchannel_id, subchannel_id, SERVICE_COMPONENT_FLAG_SUBCHANNEL);
+    const auto old_subchannel_id = GetData().subchannel_id;
+    const bool is_old_subchannel = (m_dirty_field & SERVICE_COMPONENT_FLAG_SUBCHANNEL) != 0;
+    const auto res = UpdateField(GetData().subchannel_id, subchannel_id, SERVICE_COMPONENT_FLAG_SUBCHANNEL);
+    if (res == UpdateResult::SUCCESS) {
+        m_db.update_component_lookup(
+            m_db.m_subchannel_component_lookup, m_index, old_subchannel_id, subchannel_id, is_old_subchannel,
+            [](const auto& e) { return e.subchannel_id; });
+    }
+    return res;
 }
 
 UpdateResult ServiceComponentUpdater::SetGlobalID(const service_component_global_id_t global_id) {
+    const auto old_global_id = GetData().global_id;
+    const bool is_old_global_id = (m_dirty_field & SERVICE_COMPONENT_FLAG_GLOBAL_ID) != 0;
     // In some transmitters they keep changing this for some reason?
-    return UpdateField(GetData().global_id, global_id, SERVICE_COMPONENT_FLAG_GLOBAL_ID, true);
+    const auto res = UpdateField(GetData().global_id, global_id, SERVICE_COMPONENT_FLAG_GLOBAL_ID, true);
+    if (res == UpdateResult::SUCCESS) {
+        m_db.update_component_lookup(
+            m_db.m_global_id_component_lookup, m_index, old_global_id, global_id, is_old_global_id,
+            [](const auto& e) { return e.global_id; });
+    }
+    return res;
 }
 
 uint32_t ServiceComponentUpdater::GetServiceReference() {
@@ -229,6 +245,20 @@ UpdateResult SubchannelUpdater::SetFECScheme(const FEC_Scheme fec_scheme) {
     return UpdateField(GetData().fec_scheme, fec_scheme, SUBCHANNEL_FLAG_FEC_SCHEME);
 }
 
+void SubchannelUpdater::Reconfigure(const Subchannel& next) {
+    const bool ignore_conflict = true;
+    auto& data = GetData();
+    UpdateField(data.start_address, next.start_address, SUBCHANNEL_FLAG_START_ADDRESS, ignore_conflict);
+    UpdateField(data.length, next.length, SUBCHANNEL_FLAG_LENGTH, ignore_conflict);
+    UpdateField(data.is_uep, next.is_uep, SUBCHANNEL_FLAG_IS_UEP, ignore_conflict);
+    if (next.is_uep) {
+        UpdateField(data.uep_prot_index, next.uep_prot_index, SUBCHANNEL_FLAG_UEP_PROT_INDEX, ignore_conflict);
+    } else {
+        UpdateField(data.eep_prot_level, next.eep_prot_level, SUBCHANNEL_FLAG_EEP_PROT_LEVEL, ignore_conflict);
+        UpdateField(data.eep_type, next.eep_type, SUBCHANNEL_FLAG_EEP_TYPE, ignore_conflict);
+    }
+}
+
 bool SubchannelUpdater::IsComplete() {
     const bool eep_complete = (m_dirty_field & SUBCHANNEL_FLAG_REQUIRED_EEP) == SUBCHANNEL_FLAG_REQUIRED_EEP;
     const bool uep_complete = (m_dirty_field & SUBCHANNEL_FLAG_REQUIRED_UEP) == SUBCHANNEL_FLAG_REQUIRED_UEP;
@@ -377,15 +407,14 @@ bool OtherEnsembleUpdater::IsComplete() {
 DAB_Database_Updater::DAB_Database_Updater() {
     m_db = std::make_unique<DAB_Database>();
     m_stats = std::make_unique<DatabaseUpdaterGlobalStatistics>();
-    m_ensemble_updater = std::make_unique<EnsembleUpdater>(*(m_db.get()), *(m_stats.get()));
+    m_obs_change = std::make_unique<Ref_Observable<DatabaseChange>>();
+    m_ensemble_updater = std::make_unique<EnsembleUpdater>(*(m_db.get()), *(m_stats.get()), *(m_obs_change.get()));
 }
 
 ServiceUpdater& DAB_Database_Updater::GetServiceUpdater(const service_id_t service_ref) {
     return find_or_insert_updater(
+        m_db->m_service_lookup, service_ref,
         m_db->services, m_service_updaters,
-        [service_ref](const auto& e) { 
-            return e.reference == service_ref; 
-        },
         service_ref
     );
 }
@@ -394,70 +423,70 @@ ServiceComponentUpdater& DAB_Database_Updater::GetServiceComponentUpdater_Servic
     const service_id_t service_ref, const service_component_id_t component_id) 
 {
     return find_or_insert_updater(
+        m_db->m_service_component_lookup, DAB_Database::GetServiceComponentKey(service_ref, component_id),
         m_db->service_components, m_service_component_updaters,
-        [service_ref, component_id](const auto& e) { 
-            return (e.service_reference == service_ref) && (e.component_id == component_id); 
-        },
         service_ref, component_id
     );
 }
 
 SubchannelUpdater& DAB_Database_Updater::GetSubchannelUpdater(const subchannel_id_t subchannel_id) {
     return find_or_insert_updater(
+        m_db->m_subchannel_lookup, subchannel_id,
         m_db->subchannels, m_subchannel_updaters,
-        [subchannel_id](const auto& e) {
-            return e.id == subchannel_id;
-        },
         subchannel_id
     );
 }
 
+Subchannel& DAB_Database_Updater::GetNextSubchannel(const subchannel_id_t subchannel_id) {
+    for (auto& subchannel: m_next_subchannels) {
+        if (subchannel.id == subchannel_id) return subchannel;
+    }
+    return m_next_subchannels.emplace_back(subchannel_id);
+}
+
+void DAB_Database_Updater::ApplyNextSubchannels() {
+    for (const auto& next: m_next_subchannels) {
+        GetSubchannelUpdater(next.id).Reconfigure(next);
+    }
+    m_next_subchannels.clear();
+}
+
 LinkServiceUpdater& DAB_Database_Updater::GetLinkServiceUpdater(const lsn_t link_service_number) {
     return find_or_insert_updater(
+        m_db->m_link_service_lookup, link_service_number,
         m_db->link_services, m_link_service_updaters,
-        [link_service_number](const auto& e) {
-            return e.id == link_service_number;
-        },
         link_service_number
     );
 }
 
 FM_ServiceUpdater& DAB_Database_Updater::GetFMServiceUpdater(const fm_id_t RDS_PI_code) {
     return find_or_insert_updater(
+        m_db->m_fm_service_lookup, RDS_PI_code,
         m_db->fm_services, m_fm_service_updaters,
-        [RDS_PI_code](const auto& e) {
-            return e.RDS_PI_code == RDS_PI_code;
-        },
         RDS_PI_code
     );
 }
 
 DRM_ServiceUpdater& DAB_Database_Updater::GetDRMServiceUpdater(const drm_id_t drm_code) {
     return find_or_insert_updater(
+        m_db->m_drm_service_lookup, drm_code,
         m_db->drm_services, m_drm_service_updaters,
-        [drm_code](const auto& e) {
-            return e.drm_code == drm_code;
-        },
         drm_code
     );
 }
 
 AMSS_ServiceUpdater& DAB_Database_Updater::GetAMSS_ServiceUpdater(const amss_id_t amss_code) {
     return find_or_insert_updater(
+        m_db->m_amss_service_lookup, amss_code,
         m_db->amss_services, m_amss_service_updaters,
-        [amss_code](const auto& e) {
-            return e.amss_code == amss_code;
-        },
         amss_code
     );
 }
 
 OtherEnsembleUpdater& DAB_Database_Updater::GetOtherEnsemble(const ensemble_id_t ensemble_reference) {
     return find_or_insert_updater(
+        m_db->m_other_ensemble_lookup, ensemble_reference,
         m_db->other_ensembles, m_other_ensemble_updaters,
-        [ensemble_reference](const auto& e) {
-            return e.reference == ensemble_reference;
-        },
         ensemble_reference
     );
 }
@@ -465,21 +494,11 @@ OtherEnsembleUpdater& DAB_Database_Updater::GetOtherEnsemble(const ensemble_id_t
 ServiceComponentUpdater* DAB_Database_Updater::GetServiceComponentUpdater_GlobalID(
     const service_component_global_id_t global_id) 
 {
-    return find_updater(
-        m_db->service_components, m_service_component_updaters,
-        [global_id](const auto& e) {
-            return e.global_id == global_id;
-        }
-    );
+    return find_updater(m_db->m_global_id_component_lookup, global_id, m_service_component_updaters);
 }
 
 ServiceComponentUpdater* DAB_Database_Updater::GetServiceComponentUpdater_Subchannel(
     const subchannel_id_t subchannel_id) 
 {
-    return find_updater(
-        m_db->service_components, m_service_component_updaters,
-        [subchannel_id](const auto& e) {
-            return e.subchannel_id == subchannel_id;
-        }
-    );
-}
\ No newline at end of file
+    return find_updater(m_db->m_subchannel_component_lookup, subchannel_id, m_service_component_updaters);
+}
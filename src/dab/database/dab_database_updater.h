@@ -4,9 +4,9 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
-#include <string>
-#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include "utility/observable.h"
 #include "utility/span.h"
 #include "./dab_database.h"
 #include "./dab_database_entities.h"
@@ -33,6 +33,21 @@ struct DatabaseUpdaterGlobalStatistics {
 
 enum class UpdateResult { SUCCESS, CONFLICT, NO_CHANGE };
 
+enum class DatabaseEntityType {
+    ENSEMBLE, SERVICE, SERVICE_COMPONENT, SUBCHANNEL,
+    LINK_SERVICE, FM_SERVICE, DRM_SERVICE, AMSS_SERVICE, OTHER_ENSEMBLE
+};
+
+enum class DatabaseChangeType { CREATED, UPDATED, COMPLETED };
+
+struct DatabaseChange {
+    DatabaseEntityType entity_type;
+    DatabaseChangeType change_type;
+    // Index into the matching vector of DAB_Database (always 0 for the ensemble)
+    // This never changes since entities are never removed
+    size_t index;
+};
+
 template <typename T>
 class DatabaseEntityUpdater
 {
@@ -43,13 +58,18 @@ protected:
     T m_dirty_field = T(0);
 private:
     DatabaseUpdaterGlobalStatistics& m_stats;
+    Ref_Observable<DatabaseChange>& m_obs_change;
+    const DatabaseEntityType m_entity_type;
+    const size_t m_entity_index;
 public:
-    DatabaseEntityUpdater(DatabaseUpdaterGlobalStatistics& stats): m_stats(stats) {}
+    DatabaseEntityUpdater(DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change, DatabaseEntityType entity_type, size_t entity_index)
+    : m_stats(stats), m_obs_change(obs_change), m_entity_type(entity_type), m_entity_index(entity_index) {}
     virtual ~DatabaseEntityUpdater() {}
     virtual bool IsComplete() = 0;
     void OnCreate() {
         m_stats.nb_total++;
         m_stats.nb_pending++; 
+        NotifyChange(DatabaseChangeType::CREATED);
         OnComplete();
     }
     void OnConflict() {
@@ -63,6 +83,7 @@ public:
         if (new_is_complete) {
             m_stats.nb_completed++;
             m_stats.nb_pending--;
+            NotifyChange(DatabaseChangeType::COMPLETED);
         } else {
             m_stats.nb_completed--;
             m_stats.nb_pending++;
@@ -71,21 +92,10 @@ public:
     void OnUpdate() {
         m_total_updates++;
         m_stats.nb_updates++;
+        NotifyChange(DatabaseChangeType::UPDATED);
     }
-    UpdateResult UpdateField(std::string& dst, std::string_view src, T dirty_flag, bool ignore_conflict=false) {
-        if (m_dirty_field & dirty_flag) {
-            if (src.compare(dst) == 0) {
-                return UpdateResult::NO_CHANGE;
-            } else if (!ignore_conflict) {
-                OnConflict();
-                return UpdateResult::CONFLICT;
-            }
-        }
-        m_dirty_field |= dirty_flag;
-        dst = src;
-        OnComplete();
-        OnUpdate();
-        return UpdateResult::SUCCESS;
+    void NotifyChange(const DatabaseChangeType change_type) {
+        m_obs_change.Notify({ m_entity_type, change_type, m_entity_index });
     }
     template <typename U>
     UpdateResult UpdateField(U& dst, U src, T dirty_flag, bool ignore_conflict=false) {
@@ -110,8 +120,8 @@ class EnsembleUpdater: private DatabaseEntityUpdater<uint8_t>
 private:
     DAB_Database& m_db;
 public:
-    explicit EnsembleUpdater(DAB_Database& db, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db) { OnCreate(); } 
+    explicit EnsembleUpdater(DAB_Database& db, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::ENSEMBLE, 0), m_db(db) { OnCreate(); } 
     UpdateResult SetReference(const ensemble_id_t reference);
     UpdateResult SetCountryID(const country_id_t country_id);
     UpdateResult SetExtendedCountryCode(const extended_country_id_t extended_country_code);
@@ -131,8 +141,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::SERVICE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetCountryID(const country_id_t country_id);
     UpdateResult SetExtendedCountryCode(const extended_country_id_t extended_country_code);
     UpdateResult SetLabel(tcb::span<const uint8_t> buf);
@@ -150,8 +160,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit ServiceComponentUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit ServiceComponentUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::SERVICE_COMPONENT, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetLabel(tcb::span<const uint8_t> buf);
     UpdateResult SetTransportMode(const TransportMode transport_mode);
     UpdateResult SetAudioServiceType(const AudioServiceType audio_service_type);
@@ -170,8 +180,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit SubchannelUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit SubchannelUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::SUBCHANNEL, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetStartAddress(const subchannel_addr_t start_address);
     UpdateResult SetLength(const subchannel_size_t length);
     UpdateResult SetIsUEP(const bool is_uep);
@@ -179,6 +189,8 @@ public:
     UpdateResult SetEEPProtLevel(const eep_protection_level_t eep_prot_level);
     UpdateResult SetEEPType(const EEP_Type eep_type);
     UpdateResult SetFECScheme(const FEC_Scheme fec_scheme);
+    // Replaces the layout with the one after a multiplex reconfiguration instead of treating it as a conflict
+    void Reconfigure(const Subchannel& next);
     auto& GetData() { return m_db.subchannels[m_index]; }
 private:
     bool IsComplete() override;
@@ -190,8 +202,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit LinkServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit LinkServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::LINK_SERVICE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetIsActiveLink(const bool is_active_link);
     UpdateResult SetIsHardLink(const bool is_hard_link);
     UpdateResult SetIsInternational(const bool is_international);
@@ -208,8 +220,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit FM_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit FM_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::FM_SERVICE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetLinkageSetNumber(const lsn_t linkage_set_number); 
     UpdateResult SetIsTimeCompensated(const bool is_time_compensated);
     UpdateResult AddFrequency(const freq_t frequency);
@@ -224,8 +236,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit DRM_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit DRM_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::DRM_SERVICE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetLinkageSetNumber(const lsn_t linkage_set_number); 
     UpdateResult SetIsTimeCompensated(const bool is_time_compensated);
     UpdateResult AddFrequency(const freq_t frequency);
@@ -240,8 +252,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit AMSS_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit AMSS_ServiceUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::AMSS_SERVICE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetIsTimeCompensated(const bool is_time_compensated);
     UpdateResult AddFrequency(const freq_t frequency);
     auto& GetData() { return m_db.amss_services[m_index]; }
@@ -255,8 +267,8 @@ private:
     DAB_Database& m_db;
     const size_t m_index;
 public:
-    explicit OtherEnsembleUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats)
-        : DatabaseEntityUpdater<uint8_t>(stats), m_db(db), m_index(index) { OnCreate(); }
+    explicit OtherEnsembleUpdater(DAB_Database& db, size_t index, DatabaseUpdaterGlobalStatistics& stats, Ref_Observable<DatabaseChange>& obs_change)
+        : DatabaseEntityUpdater<uint8_t>(stats, obs_change, DatabaseEntityType::OTHER_ENSEMBLE, index), m_db(db), m_index(index) { OnCreate(); }
     UpdateResult SetCountryID(const country_id_t country_id);
     UpdateResult SetIsContinuousOutput(const bool is_continuous_output);
     UpdateResult SetIsGeographicallyAdjacent(const bool is_geographically_adjacent);
@@ -272,6 +284,7 @@ class DAB_Database_Updater
 private:
     std::unique_ptr<DatabaseUpdaterGlobalStatistics> m_stats;
     std::unique_ptr<DAB_Database> m_db;
+    std::unique_ptr<Ref_Observable<DatabaseChange>> m_obs_change;
     std::unique_ptr<EnsembleUpdater> m_ensemble_updater;
     std::vector<ServiceUpdater> m_service_updaters;
     std::vector<ServiceComponentUpdater> m_service_component_updaters;
@@ -281,6 +294,8 @@ private:
     std::vector<DRM_ServiceUpdater> m_drm_service_updaters;
     std::vector<AMSS_ServiceUpdater> m_amss_service_updaters;
     std::vector<OtherEnsembleUpdater> m_other_ensemble_updaters;
+    // subchannels of the next multiplex configuration (FIG 0/1 with C/N set)
+    std::vector<Subchannel> m_next_subchannels;
 public:
     explicit DAB_Database_Updater();
     EnsembleUpdater& GetEnsembleUpdater() { return *(m_ensemble_updater.get()); }
@@ -296,33 +311,35 @@ public:
     ServiceComponentUpdater* GetServiceComponentUpdater_Subchannel(const subchannel_id_t subchannel_id);
     const auto& GetDatabase() const { return *(m_db.get()); }
     const auto& GetStatistics() const { return *(m_stats.get()); }
+    // Layout of subchannels after the next multiplex reconfiguration
+    Subchannel& GetNextSubchannel(const subchannel_id_t subchannel_id);
+    const auto& GetNextSubchannels() const { return m_next_subchannels; }
+    // Called once the reconfiguration has occurred so the next layout becomes the current one
+    void ApplyNextSubchannels();
+    // Notified for each entity that is created, updated or completed so listeners can sync incrementally
+    auto& OnChange() { return *(m_obs_change.get()); }
 private:
-    template <typename T, typename U, typename F, typename ... Args>
-    U& find_or_insert_updater(std::vector<T>& entries, std::vector<U>& updaters, F&& func, Args... args) {
+    // Entities and updaters share the same index which the database's lookup table maps to
+    template <typename K, typename T, typename U, typename ... Args>
+    U& find_or_insert_updater(std::unordered_map<K, size_t>& lookup, const K key, std::vector<T>& entries, std::vector<U>& updaters, Args... args) {
         assert(entries.size() == updaters.size());
-        const size_t N = entries.size();
-        size_t index = 0;
-        for (index = 0; index < N; index++) {
-            if (func(entries[index])) break;
-        }
-        if (index == N) {
-            entries.emplace_back(std::forward<Args>(args)...);
-            updaters.emplace_back(*(m_db.get()), index, *(m_stats.get()));
+        auto res = lookup.find(key);
+        if (res != lookup.end()) {
+            return updaters[res->second];
         }
+        const size_t index = entries.size();
+        entries.emplace_back(std::forward<Args>(args)...);
+        updaters.emplace_back(*(m_db.get()), index, *(m_stats.get()), *(m_obs_change.get()));
+        lookup.insert({ key, index });
         return updaters[index];
     }
 
-    template <typename T, typename U, typename F>
-    U* find_updater(std::vector<T>& entries, std::vector<U>& updaters, F&& func) {
-        assert(entries.size() == updaters.size());
-        const size_t N = entries.size();
-        size_t index = 0;
-        for (index = 0; index < N; index++) {
-            if (func(entries[index])) break;
-        }
-        if (index == N) {
+    template <typename K, typename U>
+    U* find_updater(const std::unordered_map<K, size_t>& lookup, const K key, std::vector<U>& updaters) {
+        auto res = lookup.find(key);
+        if (res == lookup.end()) {
             return nullptr;
         }
-        return &updaters[index];
+        return &updaters[res->second];
     }
 };
\ No newline at end of file
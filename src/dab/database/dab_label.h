@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+// DOC: ETSI EN 300 401
+// Clause 5.2.2.2 - Labels: FIG type 1 data field
+// Labels are at most 16 bytes so they are stored inline instead of on the heap
+// This keeps copies of the database free of allocations and makes comparisons a fixed size compare
+// NOTE: Unused bytes are always zero so two labels are equal if their buffers are equal
+class DAB_Label
+{
+public:
+    static constexpr size_t MAX_LENGTH = 16;
+private:
+    // null terminated so it can be passed to printf style functions
+    char m_data[MAX_LENGTH+1] = {0};
+    uint8_t m_length = 0;
+public:
+    DAB_Label() = default;
+    // Text longer than MAX_LENGTH is truncated
+    explicit DAB_Label(std::string_view text) {
+        m_length = uint8_t(std::min(text.size(), MAX_LENGTH));
+        std::memcpy(m_data, text.data(), m_length);
+    }
+    const char* c_str() const { return m_data; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_length; }
+    size_t length() const { return m_length; }
+    bool empty() const { return m_length == 0; }
+    std::string_view view() const { return { m_data, m_length }; }
+    operator std::string_view() const { return view(); }
+    bool operator==(const DAB_Label& other) const {
+        return (m_length == other.m_length) && (std::memcmp(m_data, other.m_data, MAX_LENGTH) == 0);
+    }
+    bool operator!=(const DAB_Label& other) const {
+        return !(*this == other);
+    }
+};
@@ -2,7 +2,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <memory>
+#include <algorithm>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "viterbi_config.h"
@@ -14,6 +14,7 @@
 #define TAG "fic-decoder"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 static auto Generate_CRC_Calc() {
@@ -32,7 +33,7 @@ static auto Generate_CRC_Calc() {
 
 static auto CRC16_CALC = Generate_CRC_Calc();
 
-FIC_Decoder::FIC_Decoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group)
+FIC_Decoder::FIC_Decoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group, const size_t nb_slots)
 // NOTE: 1/3 coding rate after puncturing and 1/4 code
 // For all transmission modes these parameters are constant
 : m_nb_fibs_per_group(nb_fibs_per_group),
@@ -40,18 +41,26 @@ FIC_Decoder::FIC_Decoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_
   m_nb_decoded_bytes(nb_encoded_bits/(8*3)),
   m_nb_decoded_bits(nb_encoded_bits/3)
 {
-    m_vitdec = std::make_unique<DAB_Viterbi_Decoder>();
-    m_vitdec->set_traceback_length(m_nb_decoded_bits);
-    m_decoded_bytes.resize(m_nb_decoded_bytes);
-    m_scrambler = std::make_unique<AdditiveScrambler>();
-    m_scrambler->SetSyncword(0xFFFF);
+    m_groups.resize(std::max(nb_slots, size_t(1)));
+    for (auto& group: m_groups) {
+        group.decoded_bytes.resize(m_nb_decoded_bytes);
+        group.is_fib_valid.resize(m_nb_fibs_per_group, false);
+    }
 }
 
 FIC_Decoder::~FIC_Decoder() = default;
 
 // Each group contains 3 fibs (fast information blocks) in mode I
-void FIC_Decoder::DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t cif_index) {
+bool FIC_Decoder::DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t cif_index) {
+    LOG_DEBUG("Decoding FIB group of cif={}", cif_index);
+    DecodeGroup(encoded_bits, 0);
+    return NotifyGroup(0);
+}
+
+bool FIC_Decoder::DecodeGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t slot) {
     assert(encoded_bits.size() >= m_nb_encoded_bits);
+    assert(slot < m_groups.size());
+    auto& group = m_groups[slot];
     // DOC: ETSI EN 300 401
     // Clause 11.2 - Coding in the fast information channel
     // PI_16, PI_15 and PI_X are used
@@ -68,31 +77,29 @@ void FIC_Decoder::DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, co
     if (m_nb_decoded_bits != nb_decoded_bits_mode_I) {
         LOG_ERROR("Expected {} encoded bits but got {}", nb_decoded_bits_mode_I, m_nb_decoded_bits);
         LOG_ERROR("ETSI EN 300 401 standard only gives the puncture codes used in transmission mode I");
-        return;
+        std::fill(group.is_fib_valid.begin(), group.is_fib_valid.end(), false);
+        return false;
     }
 
-    m_vitdec->reset();
+    auto& vitdec = DAB_Viterbi_Decoder::borrow_thread_decoder(m_nb_decoded_bits);
+    vitdec.reset();
     {
         size_t N;
         auto encoded_bits_buf = encoded_bits;
-        N = m_vitdec->update(encoded_bits_buf, PI_16, 128*21);
+        N = vitdec.update(encoded_bits_buf, PI_16, 128*21);
         encoded_bits_buf = encoded_bits_buf.subspan(N);
-        N = m_vitdec->update(encoded_bits_buf, PI_15, 128*3);
+        N = vitdec.update(encoded_bits_buf, PI_15, 128*3);
         encoded_bits_buf = encoded_bits_buf.subspan(N);
-        N = m_vitdec->update(encoded_bits_buf, PI_X, 24);
+        N = vitdec.update(encoded_bits_buf, PI_X, 24);
         encoded_bits_buf = encoded_bits_buf.subspan(N);
         assert(encoded_bits_buf.size() == 0);
     }
 
-    const uint64_t error = m_vitdec->chainback(m_decoded_bytes);
-    LOG_MESSAGE("error:    {}", error);
+    const uint64_t error = vitdec.chainback(group.decoded_bytes);
+    LOG_DEBUG("error:    {}", error);
 
     // descrambler
-    m_scrambler->Reset();
-    for (size_t i = 0; i < m_nb_decoded_bytes; i++) {
-        uint8_t b = m_scrambler->Process();
-        m_decoded_bytes[i] ^= b;
-    }
+    apply_energy_dispersal_auto(tcb::span(group.decoded_bytes).first(m_nb_decoded_bytes));
 
     // crc16 check
     const size_t nb_fib_bytes = m_nb_decoded_bytes/m_nb_fibs_per_group;
@@ -100,18 +107,38 @@ void FIC_Decoder::DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, co
     assert(nb_fib_bytes >= nb_crc16_bytes);
     const size_t nb_data_bytes = nb_fib_bytes-nb_crc16_bytes;
 
+    bool is_all_valid = true;
     for (size_t i = 0; i < m_nb_fibs_per_group; i++) {
-        auto fib_buf = tcb::span(m_decoded_bytes).subspan(i*nb_fib_bytes, nb_fib_bytes);
+        auto fib_buf = tcb::span(group.decoded_bytes).subspan(i*nb_fib_bytes, nb_fib_bytes);
         auto data_buf = fib_buf.first(nb_data_bytes);
         auto crc_buf = fib_buf.last(nb_crc16_bytes);
 
         const uint16_t crc16_rx = (crc_buf[0] << 8) | crc_buf[1];
         const uint16_t crc16_pred = CRC16_CALC->Process(data_buf);
         const bool is_valid = crc16_rx == crc16_pred;
-        LOG_MESSAGE("[crc16] fib={}/{} is_match={} pred={:04X} got={:04X}", 
+        LOG_DEBUG("[crc16] fib={}/{} is_match={} pred={:04X} got={:04X}", 
             i, m_nb_fibs_per_group, is_valid, crc16_pred, crc16_rx);
-        if (is_valid) {
-            obs_on_fib.Notify(data_buf);
+        group.is_fib_valid[i] = is_valid;
+        is_all_valid = is_all_valid && is_valid;
+    }
+    return is_all_valid;
+}
+
+bool FIC_Decoder::NotifyGroup(const size_t slot) {
+    assert(slot < m_groups.size());
+    const auto& group = m_groups[slot];
+    const size_t nb_fib_bytes = m_nb_decoded_bytes/m_nb_fibs_per_group;
+    const size_t nb_crc16_bytes = 2;
+    const size_t nb_data_bytes = nb_fib_bytes-nb_crc16_bytes;
+
+    bool is_all_valid = true;
+    for (size_t i = 0; i < m_nb_fibs_per_group; i++) {
+        if (!group.is_fib_valid[i]) {
+            is_all_valid = false;
+            continue;
         }
+        auto data_buf = tcb::span(group.decoded_bytes).subspan(i*nb_fib_bytes, nb_data_bytes);
+        obs_on_fib.Notify(data_buf);
     }
+    return is_all_valid;
 }
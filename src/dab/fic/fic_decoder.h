@@ -2,22 +2,23 @@
 
 #include <stdint.h>
 #include <stddef.h>
-#include <memory>
 #include <vector>
 #include "utility/observable.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 
-class DAB_Viterbi_Decoder;
-class AdditiveScrambler;
-
 // Decodes the convolutionally encoded, scrambled and CRC16 group of FIGs
+// Each FIB group of a frame can be decoded concurrently in its own slot with DecodeGroup()
+// and then passed on with NotifyGroup() from a single thread in CIF order
 class FIC_Decoder 
 {
 private:
-    std::unique_ptr<DAB_Viterbi_Decoder> m_vitdec;
-    std::unique_ptr<AdditiveScrambler> m_scrambler;
-    std::vector<uint8_t> m_decoded_bytes;
+    // NOTE: The viterbi decoder is borrowed from the thread decoding the group
+    struct Group {
+        std::vector<uint8_t> decoded_bytes;
+        std::vector<bool> is_fib_valid;
+    };
+    std::vector<Group> m_groups;
 
     const size_t m_nb_fibs_per_group;
     const size_t m_nb_encoded_bits;
@@ -28,8 +29,16 @@ private:
     Observable<tcb::span<const uint8_t>> obs_on_fib;
 public:
     // number of bits in FIB (fast information block) group per CIF (common interleaved frame)
-    FIC_Decoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group);
+    // nb_slots is the number of groups that can be decoded at the same time
+    FIC_Decoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group, const size_t nb_slots=1);
     ~FIC_Decoder();
-    void DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t cif_index);
+    // Returns false if any FIB in the group failed its CRC
+    bool DecodeFIBGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t cif_index);
+    // Viterbi decode, descramble and CRC check into a slot without notifying
+    // NOTE: Different slots can be decoded from different threads
+    bool DecodeGroup(tcb::span<const viterbi_bit_t> encoded_bits, const size_t slot);
+    // Notifies the valid FIBs of a decoded slot and returns false if any failed their CRC
+    bool NotifyGroup(const size_t slot);
+    size_t GetTotalSlots() const { return m_groups.size(); }
     auto& OnFIB(void) { return obs_on_fib; }
 };
\ No newline at end of file
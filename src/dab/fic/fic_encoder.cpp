@@ -0,0 +1,244 @@
+#include "./fic_encoder.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "utility/span.h"
+#include "../algorithms/additive_scrambler.h"
+#include "../algorithms/crc.h"
+#include "../algorithms/dab_convolutional_encoder.h"
+#include "../constants/puncture_codes.h"
+#include "../database/dab_database.h"
+#include "../database/dab_database_entities.h"
+
+static auto Generate_CRC_Calc() {
+    // DOC: ETSI EN 300 401
+    // Clause 5.2.1 - Fast Information Block (FIB)
+    // G(x) = x^16 + x^12 + x^5 + 1
+    static const uint16_t crc16_poly = 0x1021;
+    static auto crc16_calc = new CRC_Calculator<uint16_t>(crc16_poly);
+    crc16_calc->SetInitialValue(0xFFFF);    // initial value all 1s
+    crc16_calc->SetFinalXORValue(0xFFFF);   // transmitted crc is 1s complemented
+    return crc16_calc;
+};
+
+static auto CRC16_CALC = Generate_CRC_Calc();
+
+constexpr size_t NB_FIB_BYTES = 32;
+constexpr size_t NB_FIB_DATA_BYTES = 30;
+// FIG data fields can be at most 28 bytes after their type and header bytes
+constexpr size_t MAX_FIELD_BYTES = NB_FIB_DATA_BYTES-2;
+constexpr size_t NB_LABEL_BYTES = 16;
+// Service references above this need the long form service identifier
+constexpr uint32_t MAX_SHORT_SERVICE_REFERENCE = 0xFFF;
+
+static bool is_long_form(const Service& service) {
+    return (service.reference > MAX_SHORT_SERVICE_REFERENCE) || (service.extended_country_code != 0);
+}
+
+static void push_service_id(std::vector<uint8_t>& fields, const Service& service) {
+    if (!is_long_form(service)) {
+        const uint16_t sid = uint16_t((uint16_t(service.country_id & 0xF) << 12) | (service.reference & 0xFFF));
+        fields.push_back(uint8_t(sid >> 8));
+        fields.push_back(uint8_t(sid & 0xFF));
+        return;
+    }
+    fields.push_back(uint8_t(service.extended_country_code));
+    fields.push_back(uint8_t(((service.country_id & 0xF) << 4) | ((service.reference >> 16) & 0xF)));
+    fields.push_back(uint8_t((service.reference >> 8) & 0xFF));
+    fields.push_back(uint8_t(service.reference & 0xFF));
+}
+
+// DOC: ETSI EN 300 401
+// Clause 5.2.2.2 - Labels: FIG type 1 data field
+// The short label is the first 8 characters
+static void push_label(std::vector<uint8_t>& fields, std::string_view text) {
+    for (size_t i = 0; i < NB_LABEL_BYTES; i++) {
+        fields.push_back((i < text.size()) ? uint8_t(text[i]) : uint8_t(' '));
+    }
+    fields.push_back(0xFF);
+    fields.push_back(0x00);
+}
+
+FIC_Encoder::FIC_Encoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group)
+// NOTE: 1/3 coding rate after puncturing and 1/4 code
+: m_nb_fibs_per_group(nb_fibs_per_group),
+  m_nb_encoded_bits(nb_encoded_bits),
+  m_nb_decoded_bytes(nb_encoded_bits/(8*3))
+{
+    m_group_buf.resize(m_nb_fibs_per_group*NB_FIB_BYTES);
+    m_scrambled_buf.resize(m_group_buf.size());
+    m_encoder = std::make_unique<DAB_Convolutional_Encoder>();
+}
+
+FIC_Encoder::~FIC_Encoder() = default;
+
+void FIC_Encoder::SetDatabase(const DAB_Database& db) {
+    m_figs.clear();
+    m_curr_fig = 0;
+    m_ensemble_id = uint16_t((uint16_t(db.ensemble.country_id & 0xF) << 12) | (db.ensemble.reference & 0xFFF));
+    CreateFIG_Type_0_Ext_1(db);
+    CreateFIG_Type_0_Ext_2(db);
+    CreateFIG_Type_1(db);
+}
+
+void FIC_Encoder::PushFIG(const uint8_t type, const uint8_t header, tcb::span<const uint8_t> fields) {
+    assert(fields.size() <= MAX_FIELD_BYTES);
+    std::vector<uint8_t> fig;
+    fig.push_back(uint8_t((type << 5) | (fields.size()+1)));
+    fig.push_back(header);
+    fig.insert(fig.end(), fields.begin(), fields.end());
+    m_figs.push_back(std::move(fig));
+}
+
+// DOC: ETSI EN 300 401
+// Clause 6.2.1 - Basic sub-channel organization
+void FIC_Encoder::CreateFIG_Type_0_Ext_1(const DAB_Database& db) {
+    std::vector<uint8_t> fields;
+    for (const auto& subchannel: db.subchannels) {
+        const size_t nb_bytes = subchannel.is_uep ? 3 : 4;
+        if (fields.size() + nb_bytes > MAX_FIELD_BYTES) {
+            PushFIG(0, 0x01, fields);
+            fields.clear();
+        }
+        fields.push_back(uint8_t((subchannel.id << 2) | ((subchannel.start_address >> 8) & 0b11)));
+        fields.push_back(uint8_t(subchannel.start_address & 0xFF));
+        if (subchannel.is_uep) {
+            // short form with table switch 0
+            fields.push_back(uint8_t(subchannel.uep_prot_index & 0b111111));
+        } else {
+            const uint8_t option = (subchannel.eep_type == EEP_Type::TYPE_B) ? 0b001 : 0b000;
+            fields.push_back(uint8_t(
+                0b10000000 | (option << 4) | ((subchannel.eep_prot_level & 0b11) << 2) |
+                ((subchannel.length >> 8) & 0b11)));
+            fields.push_back(uint8_t(subchannel.length & 0xFF));
+        }
+    }
+    if (!fields.empty()) PushFIG(0, 0x01, fields);
+}
+
+// DOC: ETSI EN 300 401
+// Clause 6.3.1 - Basic service and service component definition
+// Services with long form identifiers are sent in their own FIGs with the P/D flag set
+void FIC_Encoder::CreateFIG_Type_0_Ext_2(const DAB_Database& db) {
+    constexpr size_t MAX_COMPONENTS = 15;
+    std::vector<uint8_t> fields[2];
+    for (const auto& service: db.services) {
+        std::vector<uint8_t> components;
+        size_t nb_components = 0;
+        for (const auto& component: db.service_components) {
+            if (component.service_reference != service.reference) continue;
+            if (nb_components == MAX_COMPONENTS) break;
+            const uint8_t is_primary = (component.component_id == 0) ? 0b10 : 0b00;
+            const uint8_t subchannel_id = uint8_t((component.subchannel_id & 0b111111) << 2);
+            if (component.transport_mode == TransportMode::STREAM_MODE_AUDIO) {
+                components.push_back(uint8_t(uint8_t(component.audio_service_type) & 0b111111));
+            } else if (component.transport_mode == TransportMode::STREAM_MODE_DATA) {
+                components.push_back(uint8_t(0b01000000 | (uint8_t(component.data_service_type) & 0b111111)));
+            } else {
+                continue;
+            }
+            components.push_back(uint8_t(subchannel_id | is_primary));
+            nb_components++;
+        }
+        if (nb_components == 0) continue;
+
+        const size_t pd = is_long_form(service) ? 1 : 0;
+        auto& service_fields = fields[pd];
+        const size_t nb_bytes = (pd ? 4 : 2) + 1 + components.size();
+        if (service_fields.size() + nb_bytes > MAX_FIELD_BYTES) {
+            PushFIG(0, uint8_t((pd << 5) | 0x02), service_fields);
+            service_fields.clear();
+        }
+        push_service_id(service_fields, service);
+        service_fields.push_back(uint8_t(nb_components));
+        service_fields.insert(service_fields.end(), components.begin(), components.end());
+    }
+    for (size_t pd = 0; pd < 2; pd++) {
+        if (!fields[pd].empty()) PushFIG(0, uint8_t((pd << 5) | 0x02), fields[pd]);
+    }
+}
+
+// DOC: ETSI EN 300 401
+// Clause 8.1.13 - Programme service label
+// Clause 8.1.14.1 - Data service label
+void FIC_Encoder::CreateFIG_Type_1(const DAB_Database& db) {
+    std::vector<uint8_t> fields;
+    fields.push_back(uint8_t(m_ensemble_id >> 8));
+    fields.push_back(uint8_t(m_ensemble_id & 0xFF));
+    push_label(fields, db.ensemble.label);
+    PushFIG(1, 0x00, fields);
+
+    for (const auto& service: db.services) {
+        if (service.label.empty()) continue;
+        fields.clear();
+        push_service_id(fields, service);
+        push_label(fields, service.label);
+        PushFIG(1, is_long_form(service) ? 0x05 : 0x01, fields);
+    }
+}
+
+// DOC: ETSI EN 300 401
+// Clause 5.2.1 - Fast Information Block (FIB)
+// Clause 6.4 - Ensemble information
+void FIC_Encoder::CreateFIBGroup(const size_t cif_index) {
+    std::fill(m_group_buf.begin(), m_group_buf.end(), uint8_t(0xFF));
+    for (size_t i = 0; i < m_nb_fibs_per_group; i++) {
+        auto fib = tcb::span(m_group_buf).subspan(i*NB_FIB_BYTES, NB_FIB_BYTES);
+        size_t curr_byte = 0;
+        if (i == 0) {
+            // CIF counter is a mod 20 and mod 250 pair
+            const uint8_t fig_0_0[6] = {
+                0x05, 0x00, uint8_t(m_ensemble_id >> 8), uint8_t(m_ensemble_id & 0xFF),
+                uint8_t((cif_index/250) % 20), uint8_t(cif_index % 250),
+            };
+            std::copy_n(fig_0_0, 6, fib.begin());
+            curr_byte += 6;
+        }
+        for (size_t j = 0; j < m_figs.size(); j++) {
+            const auto& fig = m_figs[m_curr_fig];
+            if (curr_byte + fig.size() > NB_FIB_DATA_BYTES) break;
+            std::copy(fig.begin(), fig.end(), fib.begin() + curr_byte);
+            curr_byte += fig.size();
+            m_curr_fig = (m_curr_fig+1) % m_figs.size();
+        }
+        const uint16_t crc = CRC16_CALC->Process(fib.first(NB_FIB_DATA_BYTES));
+        fib[NB_FIB_DATA_BYTES+0] = uint8_t(crc >> 8);
+        fib[NB_FIB_DATA_BYTES+1] = uint8_t(crc & 0xFF);
+    }
+}
+
+bool FIC_Encoder::EncodeFIBGroup(const size_t cif_index, tcb::span<uint8_t> encoded_bits_out) {
+    if (encoded_bits_out.size() != m_nb_encoded_bits) {
+        return false;
+    }
+    // DOC: ETSI EN 300 401
+    // Clause 11.2 - Coding in the fast information channel
+    // We only have the puncture codes used for transmission mode I which also match modes II and IV
+    const size_t nb_decoded_bits_mode_I =
+        (128*21 + 128*3 + 24)/DAB_Convolutional_Encoder::m_code_rate - DAB_Convolutional_Encoder::m_nb_tail_bits;
+    const size_t nb_mode_I_bytes = nb_decoded_bits_mode_I/8;
+    if ((m_nb_decoded_bytes != nb_mode_I_bytes) || (m_group_buf.size() != m_nb_decoded_bytes)) {
+        return false;
+    }
+
+    CreateFIBGroup(cif_index);
+    std::copy(m_group_buf.begin(), m_group_buf.end(), m_scrambled_buf.begin());
+    apply_energy_dispersal_auto(m_scrambled_buf);
+    m_encoder->encode(m_scrambled_buf);
+
+    size_t N;
+    auto bits_out = encoded_bits_out;
+    N = m_encoder->puncture(GetPunctureCode(16), 128*21, bits_out);
+    bits_out = bits_out.subspan(N);
+    N = m_encoder->puncture(GetPunctureCode(15), 128*3, bits_out);
+    bits_out = bits_out.subspan(N);
+    N = m_encoder->puncture(PI_X, 24, bits_out);
+    bits_out = bits_out.subspan(N);
+    assert(bits_out.empty());
+    assert(m_encoder->is_finished());
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "utility/span.h"
+
+struct DAB_Database;
+class DAB_Convolutional_Encoder;
+
+// Describes an ensemble from a DAB database as FIGs which are sent in FIB groups
+// Each FIB group is CRC16 protected, scrambled and convolutionally encoded for a CIF
+// This is the inverse of FIC_Decoder and FIG_Processor
+// The FIGs are
+// - 0/0 Ensemble information at the start of each group so the CIF counter keeps up
+// - 0/1 Subchannel organisation
+// - 0/2 Services and their stream mode components
+// - 1/0, 1/1 and 1/5 Ensemble and service labels
+// NOTE: Packet mode components need FIG 0/3 which isn't generated so they are left out
+//       Each encoded bit is a byte that is 0 or 1
+class FIC_Encoder
+{
+private:
+    const size_t m_nb_fibs_per_group;
+    const size_t m_nb_encoded_bits;
+    const size_t m_nb_decoded_bytes;
+    uint16_t m_ensemble_id = 0;
+    // FIGs other than 0/0 are sent round robin
+    std::vector<std::vector<uint8_t>> m_figs;
+    size_t m_curr_fig = 0;
+    std::vector<uint8_t> m_group_buf;
+    std::vector<uint8_t> m_scrambled_buf;
+    std::unique_ptr<DAB_Convolutional_Encoder> m_encoder;
+public:
+    // number of bits in FIB (fast information block) group per CIF (common interleaved frame)
+    FIC_Encoder(const size_t nb_encoded_bits, const size_t nb_fibs_per_group);
+    ~FIC_Encoder();
+    FIC_Encoder(FIC_Encoder&) = delete;
+    FIC_Encoder(FIC_Encoder&&) = delete;
+    FIC_Encoder& operator=(FIC_Encoder&) = delete;
+    FIC_Encoder& operator=(FIC_Encoder&&) = delete;
+    // Regenerates the FIGs from the database
+    void SetDatabase(const DAB_Database& db);
+    // Returns false if the buffer size doesn't match or the puncture codes for this group size aren't known
+    // NOTE: Like FIC_Decoder only transmission modes I, II and IV are supported
+    bool EncodeFIBGroup(const size_t cif_index, tcb::span<uint8_t> encoded_bits_out);
+    // FIBs of the last encoded group before energy dispersal
+    tcb::span<const uint8_t> GetFIBGroup() const { return m_group_buf; }
+    size_t GetTotalFIGs() const { return m_figs.size(); }
+private:
+    void PushFIG(const uint8_t type, const uint8_t header, tcb::span<const uint8_t> fields);
+    void CreateFIG_Type_0_Ext_1(const DAB_Database& db);
+    void CreateFIG_Type_0_Ext_2(const DAB_Database& db);
+    void CreateFIG_Type_1(const DAB_Database& db);
+    void CreateFIBGroup(const size_t cif_index);
+};
@@ -0,0 +1,67 @@
+#include "./fig_cache.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include "utility/span.h"
+
+FIG_Cache::FIG_Cache(const size_t max_entries)
+: m_entries(max_entries)
+{
+    m_stats.fill(FIG_Cache_Stats{});
+}
+
+bool FIG_Cache::CheckRepeat(const uint8_t type, tcb::span<const uint8_t> buf) {
+    if (buf.empty() || (buf.size() > MAX_FIG_BYTES)) return false;
+
+    const uint8_t extension = GetExtension(type, buf);
+    // DOC: ETSI EN 300 401
+    // Clause 6.4: Ensemble information (FIG 0/0) carries the CIF counter
+    // Clause 8.1.3.1: Date and time (FIG 0/10) carries the current time
+    // These change every time they are sent so caching them would only evict useful entries
+    if ((type == 0) && ((extension == 0) || (extension == 10))) return false;
+
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = (hash ^ uint64_t(type)) * 0x100000001b3ull;
+    for (const uint8_t x: buf) {
+        hash = (hash ^ uint64_t(x)) * 0x100000001b3ull;
+    }
+
+    auto& stats = m_stats[GetStatsIndex(type, extension)];
+    auto* entry = m_entries.find(hash);
+    const bool is_repeat = 
+        (entry != nullptr) && (entry->type == type) && (entry->length == uint8_t(buf.size())) &&
+        std::equal(buf.begin(), buf.end(), entry->data.begin());
+
+    if (is_repeat) {
+        stats.nb_hits++;
+        m_total_stats.nb_hits++;
+        return true;
+    }
+
+    stats.nb_misses++;
+    m_total_stats.nb_misses++;
+    if (entry == nullptr) {
+        entry = &m_entries.emplace(hash);
+    }
+    entry->type = type;
+    entry->length = uint8_t(buf.size());
+    std::copy(buf.begin(), buf.end(), entry->data.begin());
+    return false;
+}
+
+void FIG_Cache::Clear() {
+    m_entries.clear();
+}
+
+uint8_t FIG_Cache::GetExtension(const uint8_t type, tcb::span<const uint8_t> buf) {
+    // DOC: ETSI EN 300 401
+    // Clause 5.2.2.1: MCI and SI: FIG type 0 data field
+    // Clause 5.2.2.2: Labels: FIG type 1 and 2 data fields
+    switch (type) {
+    case 0:  return (buf[0] & 0b00011111) >> 0;
+    case 1:
+    case 2:  return (buf[0] & 0b00000111) >> 0;
+    default: return 0;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include "utility/lru_cache.h"
+#include "utility/span.h"
+
+struct FIG_Cache_Stats {
+    uint64_t nb_hits = 0;
+    uint64_t nb_misses = 0;
+    float GetHitRate() const {
+        const uint64_t total = nb_hits + nb_misses;
+        if (total == 0) return 0.0f;
+        return float(nb_hits) / float(total);
+    }
+};
+
+// Remembers the contents of recently processed FIGs so byte identical repeats can be skipped
+// Most FIGs are repeated unchanged every few frames and would only produce UpdateResult::NO_CHANGE
+// NOTE: The whole FIG is compared and not only its hash so a collision can't drop an update
+class FIG_Cache
+{
+public:
+    static constexpr size_t TOTAL_TYPES = 8;
+    static constexpr size_t TOTAL_EXTENSIONS = 32;
+    // DOC: ETSI EN 300 401
+    // Clause 5.2.1: Fast Information Block (FIB)
+    // A FIG has to fit in the 30 data bytes of a FIB
+    static constexpr size_t MAX_FIG_BYTES = 32;
+private:
+    struct Entry {
+        uint8_t type = 0;
+        uint8_t length = 0;
+        std::array<uint8_t, MAX_FIG_BYTES> data;
+    };
+    LRU_Cache<uint64_t, Entry> m_entries;
+    std::array<FIG_Cache_Stats, TOTAL_TYPES*TOTAL_EXTENSIONS> m_stats;
+    FIG_Cache_Stats m_total_stats;
+public:
+    // The carousel of a large ensemble can have a few hundred distinct FIGs
+    explicit FIG_Cache(const size_t max_entries=1024);
+    // Returns true if the FIG was seen recently, otherwise it is remembered for next time
+    bool CheckRepeat(const uint8_t type, tcb::span<const uint8_t> buf);
+    // Forget all FIGs but keep the statistics
+    void Clear();
+    void SetMaxEntries(const size_t max_entries) { m_entries.set_max_size(max_entries); }
+    const FIG_Cache_Stats& GetStats(const uint8_t type, const uint8_t extension) const {
+        return m_stats[GetStatsIndex(type, extension)];
+    }
+    const FIG_Cache_Stats& GetTotalStats() const { return m_total_stats; }
+private:
+    static uint8_t GetExtension(const uint8_t type, tcb::span<const uint8_t> buf);
+    static size_t GetStatsIndex(const uint8_t type, const uint8_t extension) {
+        return size_t(type % TOTAL_TYPES)*TOTAL_EXTENSIONS + size_t(extension % TOTAL_EXTENSIONS);
+    }
+};
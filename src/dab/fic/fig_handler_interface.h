@@ -9,22 +9,27 @@ class FIG_Handler_Interface
 public:
     virtual ~FIG_Handler_Interface() {};
     // fig 0/0 - ensemble information
+    // occurrence_change is the lower part of the CIF count when a reconfiguration happens (only valid if change_flags != 0)
     virtual void OnEnsemble_1_ID(
         const uint8_t country_id, const uint16_t ensemble_ref,
         const uint8_t change_flags, const uint8_t alarm_flag,
-        const uint8_t cif_upper, const uint8_t cif_lower) = 0;
+        const uint8_t cif_upper, const uint8_t cif_lower,
+        const uint8_t occurrence_change) = 0;
     // fig 0/1 - subchannel configuration
+    // is_next_configuration is set if this describes the layout after the next multiplex reconfiguration
     // Short form for UEP
     virtual void OnSubchannel_1_Short(
         const uint8_t subchannel_id, 
         const uint16_t start_address, 
-        const uint8_t table_switch, const uint8_t table_index) = 0;
+        const uint8_t table_switch, const uint8_t table_index,
+        const bool is_next_configuration) = 0;
     // Long form for EEP
     virtual void OnSubchannel_1_Long(
         const uint8_t subchannel_id, 
         const uint16_t start_address, 
         const uint8_t option, const uint8_t protection_level, 
-        const uint16_t subchannel_size) = 0;
+        const uint16_t subchannel_size,
+        const bool is_next_configuration) = 0;
     // fig 0/2 - service components type
     virtual void OnServiceComponent_1_StreamAudioType(
         const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
@@ -6,11 +6,13 @@
 #include "./fig_processor.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <array>
 #include <string_view>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "./fig_handler_interface.h"
 #include "../dab_logging.h"
+#include "../radio_fig_handler.h"
 #define TAG "fig-processor"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
@@ -56,16 +58,55 @@ struct EnsembleIdentifier {
     }
 };
 
+// Unsupported extensions are left empty
+template <typename Handler>
+constexpr auto Basic_FIG_Processor<Handler>::GetType0Table() -> std::array<FIG_Type_0_Method, TOTAL_TYPE_0_EXTENSIONS> {
+    std::array<FIG_Type_0_Method, TOTAL_TYPE_0_EXTENSIONS> table{};
+    table[0]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_0;
+    table[1]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_1;
+    table[2]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_2;
+    table[3]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_3;
+    table[4]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_4;
+    table[5]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_5;
+    table[6]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_6;
+    table[7]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_7;
+    table[8]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_8;
+    table[9]  = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_9;
+    table[10] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_10;
+    table[13] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_13;
+    table[14] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_14;
+    table[17] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_17;
+    table[21] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_21;
+    table[24] = &Basic_FIG_Processor::ProcessFIG_Type_0_Ext_24;
+    return table;
+}
+
+template <typename Handler>
+constexpr auto Basic_FIG_Processor<Handler>::GetType1Table() -> std::array<FIG_Type_1_Method, TOTAL_TYPE_1_EXTENSIONS> {
+    std::array<FIG_Type_1_Method, TOTAL_TYPE_1_EXTENSIONS> table{};
+    table[0] = &Basic_FIG_Processor::ProcessFIG_Type_1_Ext_0;
+    table[1] = &Basic_FIG_Processor::ProcessFIG_Type_1_Ext_1;
+    table[4] = &Basic_FIG_Processor::ProcessFIG_Type_1_Ext_4;
+    table[5] = &Basic_FIG_Processor::ProcessFIG_Type_1_Ext_5;
+    return table;
+}
+
 // DOC: ETSI EN 300 401
 // Clause 5.2: Fast Information Channel (FIC) 
 // Clause 5.2.1: Fast Information Block (FIB) 
 // A FIB (fast information block) contains many FIGs (fast information groups)
-void FIG_Processor::ProcessFIB(tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIB(tcb::span<const uint8_t> buf) {
     // Dont do anything if we don't have an associated handler
     if (m_handler == nullptr) {
         return;
     }
 
+    if (m_is_cache_stale) {
+        m_is_cache_stale = false;
+        m_cache.Clear();
+    }
+
     const int N = (int)buf.size();
 
     int curr_byte = 0;
@@ -97,6 +138,12 @@ void FIG_Processor::ProcessFIB(tcb::span<const uint8_t> buf) {
         const auto fig_buf = buf.subspan(curr_byte+1, fig_data_length_bytes);
         curr_byte += fig_length_bytes;
 
+        // Repeated FIGs would only reapply the same values
+        const bool is_cacheable = (fig_type == 0) || (fig_type == 1) || (fig_type == 2) || (fig_type == 6);
+        if (is_cacheable && m_is_cache_enabled && m_cache.CheckRepeat(fig_type, fig_buf)) {
+            continue;
+        }
+
         switch (fig_type) {
         // MCI and part of SI
         case 0: ProcessFIG_Type_0(fig_buf); break;
@@ -123,7 +170,8 @@ void FIG_Processor::ProcessFIB(tcb::span<const uint8_t> buf) {
     }
 }
 
-void FIG_Processor::ProcessFIG_Type_0(tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0(tcb::span<const uint8_t> buf) {
     if (buf.empty()) {
         LOG_ERROR("Received an empty fig 0/x buffer");
         return;
@@ -141,30 +189,17 @@ void FIG_Processor::ProcessFIG_Type_0(tcb::span<const uint8_t> buf) {
 
     auto field_buf = buf.subspan(1);
 
-    switch (extension) {
-    case 0 : ProcessFIG_Type_0_Ext_0 (header, field_buf); break;
-    case 1 : ProcessFIG_Type_0_Ext_1 (header, field_buf); break;
-    case 2 : ProcessFIG_Type_0_Ext_2 (header, field_buf); break;
-    case 3 : ProcessFIG_Type_0_Ext_3 (header, field_buf); break;
-    case 4 : ProcessFIG_Type_0_Ext_4 (header, field_buf); break;
-    case 5 : ProcessFIG_Type_0_Ext_5 (header, field_buf); break;
-    case 6 : ProcessFIG_Type_0_Ext_6 (header, field_buf); break;
-    case 7 : ProcessFIG_Type_0_Ext_7 (header, field_buf); break;
-    case 8 : ProcessFIG_Type_0_Ext_8 (header, field_buf); break;
-    case 9 : ProcessFIG_Type_0_Ext_9 (header, field_buf); break;
-    case 10: ProcessFIG_Type_0_Ext_10(header, field_buf); break;
-    case 13: ProcessFIG_Type_0_Ext_13(header, field_buf); break;
-    case 14: ProcessFIG_Type_0_Ext_14(header, field_buf); break;
-    case 17: ProcessFIG_Type_0_Ext_17(header, field_buf); break;
-    case 21: ProcessFIG_Type_0_Ext_21(header, field_buf); break;
-    case 24: ProcessFIG_Type_0_Ext_24(header, field_buf); break;
-    default:
+    static constexpr auto table = GetType0Table();
+    const auto method = table[extension];
+    if (method == nullptr) {
         LOG_MESSAGE("fig 0/{} Unsupported", extension);
-        break;
+        return;
     }
+    (this->*method)(header, field_buf);
 }
 
-void FIG_Processor::ProcessFIG_Type_1(tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_1(tcb::span<const uint8_t> buf) {
     if (buf.empty()) {
         LOG_ERROR("Received an empty fig 1/x buffer");
         return;
@@ -181,18 +216,17 @@ void FIG_Processor::ProcessFIG_Type_1(tcb::span<const uint8_t> buf) {
 
     auto field_buf = buf.subspan(1);
 
-    switch (extension) {
-    case 0: ProcessFIG_Type_1_Ext_0(header, field_buf); break;
-    case 1: ProcessFIG_Type_1_Ext_1(header, field_buf); break;
-    case 4: ProcessFIG_Type_1_Ext_4(header, field_buf); break;
-    case 5: ProcessFIG_Type_1_Ext_5(header, field_buf); break;
-    default:
+    static constexpr auto table = GetType1Table();
+    const auto method = table[extension];
+    if (method == nullptr) {
         LOG_MESSAGE("fig 1/{} L={} Unsupported", extension, field_buf.size());
-        break;
+        return;
     }
+    (this->*method)(header, field_buf);
 }
 
-void FIG_Processor::ProcessFIG_Type_2(tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_2(tcb::span<const uint8_t> buf) {
     if (buf.empty()) {
         LOG_ERROR("Received an empty fig 2/x buffer");
         return;
@@ -209,7 +243,8 @@ void FIG_Processor::ProcessFIG_Type_2(tcb::span<const uint8_t> buf) {
     LOG_MESSAGE("fig 2/{} L={} Unsupported", extension, field_buf.size());
 }
 
-void FIG_Processor::ProcessFIG_Type_6(tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_6(tcb::span<const uint8_t> buf) {
     if (buf.empty()) {
         LOG_ERROR("Received an empty fig 6/x buffer");
         return;
@@ -228,13 +263,18 @@ void FIG_Processor::ProcessFIG_Type_6(tcb::span<const uint8_t> buf) {
 }
 
 // Ensemble information
-void FIG_Processor::ProcessFIG_Type_0_Ext_0(
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_0(
     const FIG_Header_Type_0 header, 
     tcb::span<const uint8_t> buf)
 {
+    // DOC: ETSI EN 300 401
+    // Clause 6.4: Ensemble information
+    // The occurrence change field is only present if the change flags are set
     const int N = (int)buf.size();
     const int nb_field_bytes = 4;
-    if (N != nb_field_bytes) {
+    const int nb_field_bytes_with_occurrence = 5;
+    if ((N != nb_field_bytes) && (N != nb_field_bytes_with_occurrence)) {
         LOG_ERROR("fig 0/0 Length doesn't match expectations ({}/{})",
             nb_field_bytes, N);
         return;
@@ -253,24 +293,26 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_0(
     // mod 250 counter
     const uint8_t cif_lower =    (buf[3] & 0b11111111) >> 0;
 
-    // TODO: For some reason we don't get this byte
-    // Perhaps it is because no changes occur, but this isn't stated in standard
-    // const uint8_t occurance_change = 
-    //                              (buf[4] & 0b11111111) >> 0;
+    // lower part of the CIF count at which the reconfiguration occurs
+    const uint8_t occurrence_change = 
+        (N == nb_field_bytes_with_occurrence) ? 
+                                 ((buf[4] & 0b11111111) >> 0) : 0;
 
-    LOG_MESSAGE("fig 0/0 country_id={} ensemble_ref={} change={} alarm={} cif={}|{}",
+    LOG_MESSAGE("fig 0/0 country_id={} ensemble_ref={} change={} alarm={} cif={}|{} occurrence={}",
         eid.country_id, eid.ensemble_reference,
         change_flags, alarm_flag,
-        cif_upper, cif_lower);
+        cif_upper, cif_lower, occurrence_change);
     
     m_handler->OnEnsemble_1_ID(
         eid.country_id, eid.ensemble_reference,
         change_flags, alarm_flag, 
-        cif_upper, cif_lower);
+        cif_upper, cif_lower,
+        occurrence_change);
 }
 
 // Subchannel for stream mode MSC
-void FIG_Processor::ProcessFIG_Type_0_Ext_1(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_1(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     int curr_byte = 0;
     int curr_subchannel = 0;
@@ -309,7 +351,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_1(const FIG_Header_Type_0 header, tcb:
 
             m_handler->OnSubchannel_1_Short(
                 subchannel_id, start_address,
-                table_switch, table_index);
+                table_switch, table_index,
+                header.cn != 0);
         // process long form
         // this provides configuration for Equal Error Protection
         } else {
@@ -326,7 +369,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_1(const FIG_Header_Type_0 header, tcb:
 
             m_handler->OnSubchannel_1_Long(
                 subchannel_id, start_address,
-                option, prot_level, subchannel_size);
+                option, prot_level, subchannel_size,
+                header.cn != 0);
         }
         curr_byte += nb_data_bytes;
         curr_subchannel++;
@@ -334,7 +378,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_1(const FIG_Header_Type_0 header, tcb:
 }
 
 // Service and service components information in stream mode
-void FIG_Processor::ProcessFIG_Type_0_Ext_2(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_2(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_service_id_bytes = header.pd ? 4 : 2;
     // In addition to the service id field, we have an additional byte of fields
@@ -460,7 +505,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_2(const FIG_Header_Type_0 header, tcb:
 }
 
 // Service components information in packet mode
-void FIG_Processor::ProcessFIG_Type_0_Ext_3(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_3(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_header_bytes = 5;
     const int nb_CAOrg_field_bytes = 2;
@@ -520,7 +566,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_3(const FIG_Header_Type_0 header, tcb:
 }
 
 // Service components information in stream mode with conditional access
-void FIG_Processor::ProcessFIG_Type_0_Ext_4(
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_4(
     const FIG_Header_Type_0 header, 
     tcb::span<const uint8_t> buf)
 {
@@ -551,7 +598,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_4(
 }
 
 // Service component language 
-void FIG_Processor::ProcessFIG_Type_0_Ext_5(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_5(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     int curr_byte = 0;
     while (curr_byte < N) {
@@ -600,7 +648,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_5(const FIG_Header_Type_0 header, tcb:
 }
 
 // Service linking information
-void FIG_Processor::ProcessFIG_Type_0_Ext_6(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_6(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_header_bytes = 2;
 
@@ -908,7 +957,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_6(const FIG_Header_Type_0 header, tcb:
 }
 
 // Configuration information
-void FIG_Processor::ProcessFIG_Type_0_Ext_7(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_7(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_data_bytes = 2;
     if (N != nb_data_bytes) {
@@ -930,7 +980,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_7(const FIG_Header_Type_0 header, tcb:
 }
 
 // Service component global definition 
-void FIG_Processor::ProcessFIG_Type_0_Ext_8(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_8(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_service_id_bytes = header.pd ? 4 : 2;
     // In addition to the service id field, we have an additional byte of fields
@@ -1017,7 +1068,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_8(const FIG_Header_Type_0 header, tcb:
 }
 
 // Country, LTO and International Table
-void FIG_Processor::ProcessFIG_Type_0_Ext_9(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_9(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_header_bytes = 3;
     if (nb_header_bytes > N) {
@@ -1118,7 +1170,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_9(const FIG_Header_Type_0 header, tcb:
 }
 
 // Date and time
-void FIG_Processor::ProcessFIG_Type_0_Ext_10(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_10(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_min_bytes = 4;
     if (nb_min_bytes > N) {
@@ -1171,7 +1224,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_10(const FIG_Header_Type_0 header, tcb
 }
 
 // User application information
-void FIG_Processor::ProcessFIG_Type_0_Ext_13(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_13(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_service_id_bytes = header.pd ? 4 : 2;
     // In addition to the service id field, we have an additional byte of fields
@@ -1252,7 +1306,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_13(const FIG_Header_Type_0 header, tcb
 }
 
 // Subchannel for packet mode MSC FEC type
-void FIG_Processor::ProcessFIG_Type_0_Ext_14(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_14(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
 
     for (int i = 0; i < N; i++) {
@@ -1269,7 +1324,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_14(const FIG_Header_Type_0 header, tcb
 }
 
 // Programme type
-void FIG_Processor::ProcessFIG_Type_0_Ext_17(
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_17(
     const FIG_Header_Type_0 header, 
     tcb::span<const uint8_t> buf)
 {
@@ -1363,7 +1419,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_17(
 }
 
 // Frequency information
-void FIG_Processor::ProcessFIG_Type_0_Ext_21(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_21(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_block_header_bytes = 2;
 
@@ -1568,7 +1625,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_21(const FIG_Header_Type_0 header, tcb
 }
 
 // OE Services for service following?
-void FIG_Processor::ProcessFIG_Type_0_Ext_24(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_0_Ext_24(const FIG_Header_Type_0 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_sid_bytes = header.pd ? 4 : 2;
     const int nb_header_bytes = nb_sid_bytes + 1;
@@ -1626,7 +1684,8 @@ void FIG_Processor::ProcessFIG_Type_0_Ext_24(const FIG_Header_Type_0 header, tcb
 }
 
 // Ensemble label
-void FIG_Processor::ProcessFIG_Type_1_Ext_0(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_1_Ext_0(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_eid_bytes = 2;
     const int nb_char_bytes = 16;
@@ -1662,7 +1721,8 @@ void FIG_Processor::ProcessFIG_Type_1_Ext_0(const FIG_Header_Type_1 header, tcb:
 }
 
 // Short form service identifier label
-void FIG_Processor::ProcessFIG_Type_1_Ext_1(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_1_Ext_1(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_sid_bytes = 2;
     const int nb_char_bytes = 16;
@@ -1696,7 +1756,8 @@ void FIG_Processor::ProcessFIG_Type_1_Ext_1(const FIG_Header_Type_1 header, tcb:
 }
 
 // Service component label (non primary)
-void FIG_Processor::ProcessFIG_Type_1_Ext_4(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_1_Ext_4(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_header_bytes = 1;
     const int nb_char_bytes = 16;
@@ -1751,7 +1812,8 @@ void FIG_Processor::ProcessFIG_Type_1_Ext_4(const FIG_Header_Type_1 header, tcb:
 }
 
 // Long form service identifier label
-void FIG_Processor::ProcessFIG_Type_1_Ext_5(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
+template <typename Handler>
+void Basic_FIG_Processor<Handler>::ProcessFIG_Type_1_Ext_5(const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf) {
     const int N = (int)buf.size();
     const int nb_sid_bytes = 4;
     const int nb_char_bytes = 16;
@@ -1783,3 +1845,8 @@ void FIG_Processor::ProcessFIG_Type_1_Ext_5(const FIG_Header_Type_1 header, tcb:
         sid.country_id, sid.service_reference, sid.ecc,
         flag_field, {char_buf, (size_t)nb_char_bytes});
 }
+
+// The generic processor calls any handler through its virtual interface
+// while the radio's own handler is final so its calls can be resolved and inlined
+template class Basic_FIG_Processor<FIG_Handler_Interface>;
+template class Basic_FIG_Processor<Radio_FIG_Handler>;
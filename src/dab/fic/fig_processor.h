@@ -1,11 +1,18 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <array>
 #include "utility/span.h"
+#include "./fig_cache.h"
 
 class FIG_Handler_Interface;
 
-class FIG_Processor
+// Parses the FIGs of each FIB and passes their fields to the handler
+// Handler is FIG_Handler_Interface or one of its final implementations so its calls are resolved at compile time
+// NOTE: The members are defined in fig_processor.cpp which instantiates each supported handler
+template <typename Handler>
+class Basic_FIG_Processor
 {
 private:
     struct FIG_Header_Type_0 {
@@ -22,11 +29,28 @@ private:
         uint8_t segment_index;
         uint8_t rfu;
     };
-    FIG_Handler_Interface* m_handler = nullptr;
+    // type 0 and type 1 FIGs are dispatched through a table indexed by their extension
+    static constexpr size_t TOTAL_TYPE_0_EXTENSIONS = 32;
+    static constexpr size_t TOTAL_TYPE_1_EXTENSIONS = 8;
+    using FIG_Type_0_Method = void (Basic_FIG_Processor::*)(const FIG_Header_Type_0, tcb::span<const uint8_t>);
+    using FIG_Type_1_Method = void (Basic_FIG_Processor::*)(const FIG_Header_Type_1, tcb::span<const uint8_t>);
+    Handler* m_handler = nullptr;
+    FIG_Cache m_cache;
+    bool m_is_cache_enabled = true;
+    bool m_is_cache_stale = false;
 public:
     void ProcessFIB(tcb::span<const uint8_t> buf);
-    inline void SetHandler(FIG_Handler_Interface* handler) { m_handler = handler; }
+    inline void SetHandler(Handler* handler) { m_handler = handler; }
+    // Byte identical FIGs that were seen recently are skipped
+    // NOTE: The handler can drop a FIG if an entity it refers to doesn't exist yet
+    //       so the cache should be invalidated when the handler's state changes
+    void InvalidateCache() { m_is_cache_stale = true; }
+    void SetIsCacheEnabled(const bool is_enabled) { m_is_cache_enabled = is_enabled; }
+    bool GetIsCacheEnabled() const { return m_is_cache_enabled; }
+    const auto& GetCache() const { return m_cache; }
 private:
+    static constexpr std::array<FIG_Type_0_Method, TOTAL_TYPE_0_EXTENSIONS> GetType0Table();
+    static constexpr std::array<FIG_Type_1_Method, TOTAL_TYPE_1_EXTENSIONS> GetType1Table();
     // handle each type
     void ProcessFIG_Type_0(tcb::span<const uint8_t> buf);
     void ProcessFIG_Type_1(tcb::span<const uint8_t> buf);
@@ -54,4 +78,6 @@ private:
     void ProcessFIG_Type_1_Ext_1 (const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf);
     void ProcessFIG_Type_1_Ext_4 (const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf);
     void ProcessFIG_Type_1_Ext_5 (const FIG_Header_Type_1 header, tcb::span<const uint8_t> buf);
-};
\ No newline at end of file
+};
+
+using FIG_Processor = Basic_FIG_Processor<FIG_Handler_Interface>;
@@ -1,39 +1,83 @@
 #include "./MOT_assembler.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <fmt/format.h>
+#include "utility/buffer_pool.h"
 #include "utility/span.h"
+#include "./MOT_inflater.h"
 #include "../dab_logging.h"
 #define TAG "mot-assembler"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
-MOT_Assembler::MOT_Assembler() {
+MOT_Assembler::MOT_Assembler(std::pmr::memory_resource* memory_resource)
+: m_segment_lengths(memory_resource), m_pending_last_segment(memory_resource)
+{
     Reset();
 }
 
 void MOT_Assembler::Reset(void) {
-    // We end up reusing this data
-    for (auto& segment: m_segments) {
-        segment.length = 0;
-        segment.unordered_index = 0;
-    }
+    m_buffer.Reset();
+    m_segment_lengths.clear();
     m_total_segments = std::nullopt;
-    m_unordered_buffer.clear();
-    m_ordered_buffer.clear();
-    m_segments.clear();
+    m_segment_size = std::nullopt;
+    m_expected_size = 0;
+    m_pending_last_segment.clear();
+    m_is_pending_last_segment = false;
+    m_is_taken = false;
+    m_inflater = nullptr;
+    m_next_inflate_segment = 0;
 }
 
 void MOT_Assembler::SetTotalSegments(const size_t N) {
     m_total_segments = std::optional(N);
-    m_segments.resize(N);
+    m_segment_lengths.resize(N);
+}
+
+void MOT_Assembler::SetExpectedSize(const size_t N) {
+    m_expected_size = N;
+}
+
+bool MOT_Assembler::SetIsInflate(void) {
+    if (m_inflater != nullptr) {
+        return true;
+    }
+    if (m_is_taken || !m_buffer.empty() || m_is_pending_last_segment) {
+        return false;
+    }
+    m_inflater = std::make_unique<MOT_Inflater>();
+    m_next_inflate_segment = 0;
+    return true;
+}
+
+tcb::span<const uint8_t> MOT_Assembler::GetData() const {
+    if (m_inflater != nullptr) {
+        return m_inflater->GetData();
+    }
+    return { m_buffer.data(), m_buffer.size() };
+}
+
+size_t MOT_Assembler::GetTransportSize() const {
+    if (m_inflater != nullptr) {
+        return m_inflater->GetTotalInput();
+    }
+    return m_buffer.size();
+}
+
+size_t MOT_Assembler::GetBytesHeld() const {
+    const size_t inflater_bytes = (m_inflater != nullptr) ? m_inflater->GetBytesHeld() : 0;
+    return m_buffer.capacity() + m_pending_last_segment.capacity() + inflater_bytes;
 }
 
 bool MOT_Assembler::AddSegment(const size_t index, tcb::span<const uint8_t> buf) {
-    if (index >= m_segments.size()) {
-        m_segments.resize(index+1);
+    // Entity was already delivered so this can only be a repetition
+    if (m_is_taken) {
+        return false;
     }
 
     if (m_total_segments.has_value() && (index >= m_total_segments.value())) {
@@ -41,69 +85,140 @@ bool MOT_Assembler::AddSegment(const size_t index, tcb::span<const uint8_t> buf)
         return false;
     }
 
-    auto& segment = m_segments[index];
+    if (m_inflater != nullptr) {
+        return AddInflateSegment(index, buf);
+    }
+
+    if (index >= m_segment_lengths.size()) {
+        m_segment_lengths.resize(index+1);
+    }
+
+    auto& length = m_segment_lengths[index];
 
     // Segment already present
-    if (segment.length != 0) {
-        if (segment.length != buf.size()) {
-            LOG_ERROR("Segment {} has conflicting size {}!={}", index, segment.length, buf.size());
+    if (length != 0) {
+        if (length != buf.size()) {
+            LOG_ERROR("Segment {} has conflicting size {}!={}", index, length, buf.size());
             return false;
         }
         // TODO: do we check if each segment has matching contents?
         return false;
     }
 
-    // Add segment
+    if (buf.empty()) {
+        LOG_ERROR("Segment {} is empty", index);
+        return false;
+    }
+
+    const bool is_last = m_total_segments.has_value() && (index == m_total_segments.value()-1);
+    if (!is_last) {
+        if (!m_segment_size.has_value()) {
+            m_segment_size = buf.size();
+        } else if (m_segment_size.value() != buf.size()) {
+            LOG_ERROR("Segment {} has size which differs from other segments {}!={}", index, buf.size(), m_segment_size.value());
+            return false;
+        }
+    } else if (m_segment_size.has_value() && (buf.size() > m_segment_size.value())) {
+        LOG_ERROR("Last segment {} is larger than other segments {}>{}", index, buf.size(), m_segment_size.value());
+        return false;
+    }
+
     LOG_MESSAGE("Adding segment {} with length={}", index, buf.size());
-    const size_t old_size = m_unordered_buffer.size();
-    const size_t new_size = old_size + buf.size();
-    segment.length = buf.size();
-    segment.unordered_index = old_size;
-    m_unordered_buffer.resize(new_size);
+    length = buf.size();
+    if ((index > 0) && !m_segment_size.has_value()) {
+        m_pending_last_segment.assign(buf.begin(), buf.end());
+        m_is_pending_last_segment = true;
+    } else {
+        WriteSegment(index, buf);
+    }
 
-    auto dst_buf = tcb::span(m_unordered_buffer).subspan(old_size, buf.size());
-    for (size_t i = 0; i < buf.size(); i++) {
-        dst_buf[i] = buf[i];
+    if (m_is_pending_last_segment && m_segment_size.has_value()) {
+        const size_t last_index = m_total_segments.value()-1;
+        if (m_pending_last_segment.size() > m_segment_size.value()) {
+            LOG_ERROR("Last segment {} is larger than other segments {}>{}", last_index, m_pending_last_segment.size(), m_segment_size.value());
+            m_segment_lengths[last_index] = 0;
+        } else {
+            WriteSegment(last_index, m_pending_last_segment);
+        }
+        m_pending_last_segment.clear();
+        m_is_pending_last_segment = false;
     }
-    const auto is_complete = CheckComplete();
-    if (is_complete) {
-        ReconstructOrderedBuffer();
+
+    return CheckComplete();
+}
+
+bool MOT_Assembler::AddInflateSegment(const size_t index, tcb::span<const uint8_t> buf) {
+    // Segments before the next one were already inflated and later ones can't be inflated yet
+    if (index != m_next_inflate_segment) {
+        return false;
+    }
+
+    LOG_MESSAGE("Inflating segment {} with length={}", index, buf.size());
+    if (!m_inflater->Push(buf, m_expected_size)) {
+        LOG_ERROR("Failed to inflate segment {}, restarting from the next repetition", index);
+        m_inflater->Reset();
+        m_next_inflate_segment = 0;
+        return false;
+    }
+    m_next_inflate_segment++;
+    return CheckComplete();
+}
+
+void MOT_Assembler::WriteSegment(const size_t index, tcb::span<const uint8_t> buf) {
+    const size_t offset = (index == 0) ? 0 : index*m_segment_size.value();
+    const size_t end = offset + buf.size();
+
+    if (m_buffer.capacity() == 0) {
+        size_t capacity = std::max(end, m_expected_size);
+        if (m_total_segments.has_value() && m_segment_size.has_value()) {
+            capacity = std::max(capacity, m_total_segments.value()*m_segment_size.value());
+        }
+        m_buffer = Buffer_Pool::GetGlobal().Acquire(capacity);
     }
-    return is_complete;
+
+    if (m_buffer.size() < end) {
+        m_buffer.resize(end);
+    }
+    std::copy_n(buf.begin(), buf.size(), m_buffer.begin() + offset);
+}
+
+Pooled_Buffer MOT_Assembler::TakeData() {
+    m_is_taken = true;
+    if (m_inflater != nullptr) {
+        auto data = m_inflater->TakeData();
+        m_inflater->Reset();
+        return data;
+    }
+    return std::move(m_buffer);
 }
 
 bool MOT_Assembler::CheckComplete(void) {
+    if (m_is_taken) {
+        return false;
+    }
+
     // undefined segment length
     if (!m_total_segments.has_value()) {
         return false;
     }
+
+    if (m_inflater != nullptr) {
+        return (m_next_inflate_segment == m_total_segments.value()) && m_inflater->GetIsFinished();
+    }
+
+    if (m_is_pending_last_segment) {
+        return false;
+    }
  
-    size_t total_size = 0;
-    for (size_t i = 0; i < m_total_segments.value(); i++) {
-        const auto& segment = m_segments[i];
-        if (segment.length == 0) return false;
-        total_size += segment.length;
+    const size_t N = m_total_segments.value();
+    for (size_t i = 0; i < N; i++) {
+        if (m_segment_lengths[i] == 0) return false;
     }
-    if (total_size != m_unordered_buffer.size()) {
+
+    // Segments that were received before the total was known may lie outside of it
+    const size_t total_size = (N-1)*m_segment_size.value_or(0) + m_segment_lengths[N-1];
+    if (total_size != m_buffer.size()) {
         return false;
     }
     return true;
 }
-
-void MOT_Assembler::ReconstructOrderedBuffer(void) {
-    if (!m_total_segments.has_value()) return;
-
-    LOG_MESSAGE("Reconstructing buffer with {} segments with length={}", m_total_segments.value(), m_unordered_buffer.size());
-    m_ordered_buffer.resize(m_unordered_buffer.size());
-    auto dst_buf = tcb::span(m_ordered_buffer);
-
-    size_t curr_write_index = 0;
-    for (size_t i = 0; i < m_total_segments.value(); i++) {
-        auto& segment = m_segments[i];
-        auto src_buf = tcb::span(m_unordered_buffer).subspan(segment.unordered_index, segment.length);
-        for (size_t j = 0; j < segment.length; j++) {
-            dst_buf[curr_write_index+j] = src_buf[j];
-        }
-        curr_write_index += segment.length;
-    }
-}
\ No newline at end of file
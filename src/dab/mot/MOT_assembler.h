@@ -2,34 +2,56 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <optional>
+#include "utility/buffer_pool.h"
 #include "utility/span.h"
+#include "./MOT_inflater.h"
 
 // Assembles MOT entity from segments
+// DOC: ETSI EN 301 234
+// Clause 5.1.1: Segmentation header
+// All segments except the last have the same size, so each segment is written straight into its final offset
+// NOTE: The assembled data is held in a pooled buffer instead of memory_resource since it is handed to listeners
 class MOT_Assembler 
 {
 private:
-    struct Segment {
-        size_t unordered_index;
-        size_t length;
-        Segment() {
-            unordered_index = 0;
-            length = 0;
-        }
-    };
-private:
-    std::vector<uint8_t> m_unordered_buffer;
-    std::vector<uint8_t> m_ordered_buffer;
-    std::vector<Segment> m_segments;
+    Pooled_Buffer m_buffer;
+    // A length of 0 means the segment hasn't been received
+    std::pmr::vector<size_t> m_segment_lengths;
     std::optional<size_t> m_total_segments = std::nullopt;
+    std::optional<size_t> m_segment_size = std::nullopt;
+    size_t m_expected_size = 0;
+    // The last segment can't be placed until the size of the other segments is known
+    std::pmr::vector<uint8_t> m_pending_last_segment;
+    bool m_is_pending_last_segment = false;
+    // Repeated segments are still rejected after the data has been taken
+    bool m_is_taken = false;
+    // Compressed entities are inflated as segments arrive in order instead of being stored
+    std::unique_ptr<MOT_Inflater> m_inflater;
+    size_t m_next_inflate_segment = 0;
 public:
-    MOT_Assembler();
+    explicit MOT_Assembler(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     void Reset(void);
     void SetTotalSegments(const size_t N);
+    // Size hint used to pick the pooled buffer before any segments arrive
+    void SetExpectedSize(const size_t N);
+    // Switches to streaming inflation, which fails if segments were already stored
+    // Segments that are out of order are dropped and picked up again from the next repetition
+    bool SetIsInflate(void);
+    bool GetIsInflate() const { return m_inflater != nullptr; }
     bool AddSegment(const size_t index, tcb::span<const uint8_t> buf);
-    tcb::span<uint8_t> GetData() { return m_ordered_buffer; }
+    tcb::span<const uint8_t> GetData() const;
+    // Size of the entity as it was transported, which differs from GetData() if it was inflated
+    size_t GetTransportSize() const;
+    // Moves the assembled data out, after which the assembler is no longer complete
+    Pooled_Buffer TakeData();
     bool CheckComplete();
+    // Memory used by the assembler for budgeting
+    size_t GetBytesHeld() const;
 private:
-    void ReconstructOrderedBuffer();
-};
\ No newline at end of file
+    bool AddInflateSegment(const size_t index, tcb::span<const uint8_t> buf);
+    void WriteSegment(const size_t index, tcb::span<const uint8_t> buf);
+};
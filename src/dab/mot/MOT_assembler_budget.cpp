@@ -0,0 +1,105 @@
+#include "./MOT_assembler_budget.h"
+#include <stddef.h>
+#include <iterator>
+#include <mutex>
+#include <fmt/format.h>
+#include "./MOT_processor.h"
+#include "../dab_logging.h"
+#define TAG "mot-assembler-budget"
+static auto _logger = DAB_LOG_REGISTER(TAG);
+#define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+
+MOT_Assembler_Budget::MOT_Assembler_Budget(const size_t max_bytes) {
+    m_stats.max_bytes = max_bytes;
+}
+
+void MOT_Assembler_Budget::SetMaxBytes(const size_t max_bytes) {
+    auto lock = std::scoped_lock(m_mutex);
+    m_stats.max_bytes = max_bytes;
+    EvictLocked(nullptr);
+}
+
+MOT_Assembler_Budget_Stats MOT_Assembler_Budget::GetStats(void) {
+    auto lock = std::scoped_lock(m_mutex);
+    return m_stats;
+}
+
+void MOT_Assembler_Budget::Update(MOT_Processor& owner, const mot_transport_id_t transport_id, const size_t bytes, const bool is_new, const bool is_complete) {
+    auto lock = std::scoped_lock(m_mutex);
+    if (is_new) m_stats.total_started++;
+    if (is_complete) m_stats.total_completed++;
+
+    const auto key = Key{ &owner, transport_id };
+    auto res = m_entries.find(key);
+    if (res == m_entries.end()) {
+        if (bytes == 0) return;
+        m_lru_list.push_front({ &owner, transport_id, 0 });
+        res = m_entries.insert({ key, m_lru_list.begin() }).first;
+        m_stats.total_entities++;
+    }
+
+    auto it = res->second;
+    m_lru_list.splice(m_lru_list.begin(), m_lru_list, it);
+    m_stats.bytes_held = m_stats.bytes_held - it->bytes + bytes;
+    it->bytes = bytes;
+    if (m_stats.bytes_held > m_stats.peak_bytes_held) {
+        m_stats.peak_bytes_held = m_stats.bytes_held;
+    }
+    if (bytes == 0) {
+        RemoveEntry(it);
+    }
+}
+
+void MOT_Assembler_Budget::Remove(MOT_Processor& owner, const mot_transport_id_t transport_id) {
+    auto lock = std::scoped_lock(m_mutex);
+    auto res = m_entries.find(Key{ &owner, transport_id });
+    if (res == m_entries.end()) return;
+    RemoveEntry(res->second);
+}
+
+void MOT_Assembler_Budget::RemoveOwner(MOT_Processor& owner) {
+    auto lock = std::scoped_lock(m_mutex);
+    for (auto it = m_lru_list.begin(); it != m_lru_list.end();) {
+        auto curr = it++;
+        if (curr->owner == &owner) {
+            RemoveEntry(curr);
+        }
+    }
+}
+
+void MOT_Assembler_Budget::Evict(MOT_Processor* caller) {
+    auto lock = std::scoped_lock(m_mutex);
+    EvictLocked(caller);
+}
+
+void MOT_Assembler_Budget::EvictLocked(MOT_Processor* caller) {
+    // NOTE: Other processors may be busy on another thread so we only try to lock them
+    //       Their entities are skipped if we can't and the next least recently used one is evicted instead
+    auto it = m_lru_list.end();
+    while ((m_stats.bytes_held > m_stats.max_bytes) && (it != m_lru_list.begin())) {
+        --it;
+        auto& owner = *(it->owner);
+        const auto transport_id = it->transport_id;
+        if (&owner == caller) {
+            owner.EvictAssemblerTable(transport_id);
+        } else {
+            auto owner_lock = std::unique_lock(owner.m_mutex_assemblers, std::try_to_lock);
+            if (!owner_lock.owns_lock()) continue;
+            owner.EvictAssemblerTable(transport_id);
+        }
+        LOG_MESSAGE("Evicted transport entity {} with {} bytes", transport_id, it->bytes);
+        m_stats.total_evictions++;
+        m_stats.total_evicted_bytes += it->bytes;
+        // the next iteration steps back from the more recently used neighbour
+        auto next = std::next(it);
+        RemoveEntry(it);
+        it = next;
+    }
+}
+
+void MOT_Assembler_Budget::RemoveEntry(std::list<Entry>::iterator it) {
+    m_stats.bytes_held -= it->bytes;
+    m_stats.total_entities--;
+    m_entries.erase(Key{ it->owner, it->transport_id });
+    m_lru_list.erase(it);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+#include "./MOT_entities.h"
+
+class MOT_Processor;
+
+struct MOT_Assembler_Budget_Stats {
+    size_t max_bytes = 0;
+    size_t bytes_held = 0;
+    size_t peak_bytes_held = 0;
+    // transport entities with partially assembled data
+    size_t total_entities = 0;
+    size_t total_started = 0;
+    size_t total_completed = 0;
+    size_t total_evictions = 0;
+    size_t total_evicted_bytes = 0;
+    float GetCompletionRate(void) const {
+        if (total_started == 0) return 0.0f;
+        return float(total_completed) / float(total_started);
+    }
+};
+
+// Byte budget for MOT assemblers that is shared by many MOT processors (e.g. all channels of a radio)
+// When the budget is exceeded the least recently updated transport entities are evicted across all processors
+class MOT_Assembler_Budget
+{
+private:
+    struct Entry {
+        MOT_Processor* owner;
+        mot_transport_id_t transport_id;
+        size_t bytes;
+    };
+    using Key = std::pair<const MOT_Processor*, mot_transport_id_t>;
+    std::mutex m_mutex;
+    std::list<Entry> m_lru_list;
+    std::map<Key, std::list<Entry>::iterator> m_entries;
+    MOT_Assembler_Budget_Stats m_stats;
+public:
+    explicit MOT_Assembler_Budget(const size_t max_bytes=32*1024*1024);
+    void SetMaxBytes(const size_t max_bytes);
+    MOT_Assembler_Budget_Stats GetStats(void);
+private:
+    // These are called by a MOT processor while it holds its own lock
+    friend class MOT_Processor;
+    void Update(MOT_Processor& owner, const mot_transport_id_t transport_id, const size_t bytes, const bool is_new, const bool is_complete);
+    void Remove(MOT_Processor& owner, const mot_transport_id_t transport_id);
+    void RemoveOwner(MOT_Processor& owner);
+    void Evict(MOT_Processor* caller);
+    void EvictLocked(MOT_Processor* caller);
+    void RemoveEntry(std::list<Entry>::iterator it);
+};
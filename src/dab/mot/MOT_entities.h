@@ -2,7 +2,7 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
-#include "utility/span.h"
+#include "utility/buffer_pool.h"
 
 typedef uint16_t mot_transport_id_t;
 
@@ -27,6 +27,10 @@ struct MOT_Header_Entity {
     uint16_t header_size = 0;
     uint8_t content_type = 0;
     uint16_t content_sub_type = 0;
+    // DOC: ETSI TS 101 756
+    // Table 19: Compression types
+    // 0 means the body is uncompressed, otherwise it is inflated before being handed over if supported
+    uint8_t compression_type = 0;
 
     struct {
         bool exists = false;
@@ -43,5 +47,6 @@ struct MOT_Header_Entity {
 struct MOT_Entity {
     mot_transport_id_t transport_id;
     MOT_Header_Entity header;
-    tcb::span<const uint8_t> body_buf;
+    // Owned by whoever handles the entity, consumers can move it out to avoid copying
+    Pooled_Buffer body;
 };
\ No newline at end of file
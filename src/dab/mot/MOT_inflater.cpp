@@ -0,0 +1,152 @@
+#include "./MOT_inflater.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <fmt/format.h>
+#include "utility/buffer_pool.h"
+#include "utility/span.h"
+#include "../dab_logging.h"
+#if DAB_CORE_USE_ZLIB
+#include <zlib.h>
+#endif
+#define TAG "mot-inflater"
+static auto _logger = DAB_LOG_REGISTER(TAG);
+#define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
+
+// zlib allocates a 32kB window and roughly 7kB of state
+constexpr static size_t INFLATE_STATE_BYTES = 40*1024;
+constexpr static size_t MIN_OUTPUT_CAPACITY = 4*1024;
+
+#if DAB_CORE_USE_ZLIB
+struct MOT_Inflater::Stream {
+    z_stream z;
+    bool is_init = false;
+    Stream() {
+        z.zalloc = Z_NULL;
+        z.zfree = Z_NULL;
+        z.opaque = Z_NULL;
+        z.next_in = Z_NULL;
+        z.avail_in = 0;
+        // Automatic detection of gzip or zlib header
+        is_init = (inflateInit2(&z, 15+32) == Z_OK);
+    }
+    ~Stream() {
+        if (is_init) inflateEnd(&z);
+    }
+};
+#else
+struct MOT_Inflater::Stream {};
+#endif
+
+MOT_Inflater::MOT_Inflater() = default;
+MOT_Inflater::~MOT_Inflater() = default;
+
+bool MOT_Inflater::GetIsSupported(void) {
+#if DAB_CORE_USE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MOT_Inflater::Reset(void) {
+    m_stream = nullptr;
+    m_output.Reset();
+    m_total_input = 0;
+    m_is_finished = false;
+    m_is_error = false;
+}
+
+bool MOT_Inflater::Push(tcb::span<const uint8_t> buf, const size_t capacity_hint) {
+    if (m_is_error) {
+        return false;
+    }
+    if (m_is_finished) {
+        if (!buf.empty()) {
+            LOG_ERROR("Got {} bytes past the end of the compressed stream", buf.size());
+            m_is_error = true;
+        }
+        return !m_is_error;
+    }
+
+#if DAB_CORE_USE_ZLIB
+    if (m_stream == nullptr) {
+        m_stream = std::make_unique<Stream>();
+        if (!m_stream->is_init) {
+            LOG_ERROR("Failed to initialise inflate stream");
+            m_is_error = true;
+            return false;
+        }
+        m_output = Buffer_Pool::GetGlobal().Acquire(std::max(capacity_hint, MIN_OUTPUT_CAPACITY));
+    }
+
+    auto& z = m_stream->z;
+    z.next_in = const_cast<Bytef*>(buf.data());
+    z.avail_in = uInt(buf.size());
+    m_total_input += buf.size();
+
+    while (z.avail_in > 0) {
+        // Output grows in place so the decompressed data is never copied into another buffer
+        size_t offset = m_output.size();
+        if (offset == m_output.capacity()) {
+            m_output.resize(std::max(offset*2, MIN_OUTPUT_CAPACITY));
+        } else {
+            m_output.resize(m_output.capacity());
+        }
+        z.next_out = m_output.data() + offset;
+        z.avail_out = uInt(m_output.size() - offset);
+        const int rv = inflate(&z, Z_NO_FLUSH);
+        m_output.resize(m_output.size() - size_t(z.avail_out));
+
+        if (rv == Z_STREAM_END) {
+            const size_t nb_trailing = size_t(z.avail_in);
+            m_is_finished = true;
+            m_stream = nullptr;
+            if (nb_trailing > 0) {
+                LOG_ERROR("Got {} bytes past the end of the compressed stream", nb_trailing);
+                m_is_error = true;
+                return false;
+            }
+            LOG_MESSAGE("Inflated {} bytes to {} bytes", m_total_input, m_output.size());
+            return true;
+        }
+        if ((rv != Z_OK) && (rv != Z_BUF_ERROR)) {
+            LOG_ERROR("Inflate failed with error={} msg={}", rv, (z.msg != nullptr) ? z.msg : "");
+            m_is_error = true;
+            m_stream = nullptr;
+            return false;
+        }
+    }
+    return true;
+#else
+    (void)capacity_hint;
+    LOG_ERROR("Inflating {} bytes is unsupported without zlib", buf.size());
+    m_is_error = true;
+    return false;
+#endif
+}
+
+Pooled_Buffer MOT_Inflater::TakeData(void) {
+    return std::move(m_output);
+}
+
+size_t MOT_Inflater::GetBytesHeld(void) const {
+    const size_t state_bytes = (m_stream != nullptr) ? INFLATE_STATE_BYTES : 0;
+    return state_bytes + m_output.capacity();
+}
+
+std::optional<Pooled_Buffer> MOT_Inflater::Inflate(tcb::span<const uint8_t> buf, const size_t capacity_hint) {
+    MOT_Inflater inflater;
+    if (!inflater.Push(buf, capacity_hint)) {
+        return std::nullopt;
+    }
+    if (!inflater.GetIsFinished()) {
+        LOG_ERROR("Compressed stream was truncated after {} bytes", buf.size());
+        return std::nullopt;
+    }
+    return inflater.TakeData();
+}
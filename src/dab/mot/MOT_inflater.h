@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <optional>
+#include "utility/buffer_pool.h"
+#include "utility/span.h"
+
+// Inflates a compressed MOT entity into a pooled buffer as its data arrives in order
+// This avoids holding both the compressed and decompressed copies of large objects (e.g. EPG/SPI)
+// DOC: ETSI TS 101 756
+// Table 19: Compression types
+// The only registered compression is gzip (RFC 1952), zlib streams are accepted as well
+// NOTE: Inflation is only available if dab_core was built with zlib
+class MOT_Inflater
+{
+private:
+    struct Stream;
+    std::unique_ptr<Stream> m_stream;
+    Pooled_Buffer m_output;
+    size_t m_total_input = 0;
+    bool m_is_finished = false;
+    bool m_is_error = false;
+public:
+    MOT_Inflater();
+    ~MOT_Inflater();
+    MOT_Inflater(const MOT_Inflater&) = delete;
+    MOT_Inflater& operator=(const MOT_Inflater&) = delete;
+    static bool GetIsSupported(void);
+    void Reset(void);
+    // Output is acquired with capacity_hint on the first call and grows if the hint is too small
+    bool Push(tcb::span<const uint8_t> buf, const size_t capacity_hint=0);
+    bool GetIsFinished(void) const { return m_is_finished; }
+    bool GetIsError(void) const { return m_is_error; }
+    size_t GetTotalInput(void) const { return m_total_input; }
+    tcb::span<const uint8_t> GetData(void) const { return { m_output.data(), m_output.size() }; }
+    Pooled_Buffer TakeData(void);
+    // Memory used for budgeting which includes the inflate window
+    size_t GetBytesHeld(void) const;
+    // Inflates an entity that was assembled before its compression was known
+    static std::optional<Pooled_Buffer> Inflate(tcb::span<const uint8_t> buf, const size_t capacity_hint=0);
+};
@@ -1,14 +1,23 @@
 #include "./MOT_processor.h"
 #include <assert.h>
 #include <stdint.h>
+#include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <fmt/format.h>
+#include "utility/memory_usage.h"
 #include "utility/span.h"
 #include "./MOT_assembler.h"
+#include "./MOT_assembler_budget.h"
 #include "./MOT_entities.h"
+#include "./MOT_inflater.h"
 #include "../algorithms/modified_julian_date.h"
 #include "../dab_logging.h"
 #define TAG "mot-processor"
@@ -33,11 +42,96 @@ static bool ValidateDataType(const MOT_Data_Type type) {
     return false;
 }
 
-MOT_Processor::MOT_Processor(const size_t max_transport_entities, const size_t max_header_entities) {
+MOT_Processor::MOT_Processor(
+    const size_t max_transport_entities, const size_t max_header_entities,
+    std::pmr::memory_resource* memory_resource)
+: m_memory_resource(memory_resource)
+{
     m_assembler_tables.set_max_size(max_transport_entities);
     m_body_headers.set_max_size(max_header_entities);
 }
 
+MOT_Processor::~MOT_Processor() {
+    // Once removed the budget can no longer evict from us on another thread
+    if (m_budget != nullptr) {
+        m_budget->RemoveOwner(*this);
+    }
+}
+
+void MOT_Processor::SetAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    if (m_budget != nullptr) {
+        m_budget->RemoveOwner(*this);
+    }
+    m_budget = budget;
+    if (m_budget == nullptr) {
+        return;
+    }
+    for (auto& [transport_id, table]: m_assembler_tables) {
+        m_budget->Update(*this, transport_id, GetAssemblerTableBytes(table), true, false);
+    }
+    m_budget->Evict(this);
+}
+
+std::optional<mot_transport_id_t> MOT_Processor::FindCarouselObject(const std::string& content_name) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    auto res = m_carousel_names.find(content_name);
+    if (res == m_carousel_names.end()) {
+        return std::nullopt;
+    }
+    return res->second;
+}
+
+std::optional<MOT_Carousel_Object> MOT_Processor::GetCarouselObject(const mot_transport_id_t transport_id) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    auto res = m_carousel_objects.find(transport_id);
+    if (res == m_carousel_objects.end()) {
+        return std::nullopt;
+    }
+    return res->second;
+}
+
+size_t MOT_Processor::GetTotalCarouselObjects(void) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    return m_carousel_objects.size();
+}
+
+static size_t get_header_entity_bytes(const MOT_Header_Entity& header) {
+    return
+        sizeof(MOT_Header_Entity) +
+        get_memory_bytes(header.content_name.name) +
+        get_memory_bytes(header.user_app_params);
+}
+
+Memory_Usage MOT_Processor::GetMemoryUsage(void) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    Memory_Usage usage("mot");
+    size_t assembler_bytes = 0;
+    for (auto& [transport_id, table]: m_assembler_tables) {
+        assembler_bytes += GetAssemblerTableBytes(table);
+    }
+    usage.AddChild("assemblers", assembler_bytes);
+    size_t header_bytes = 0;
+    for (const auto& [transport_id, header]: m_body_headers) {
+        header_bytes += get_header_entity_bytes(header);
+    }
+    usage.AddChild("body_headers", header_bytes);
+    size_t carousel_bytes = 0;
+    for (const auto& [transport_id, object]: m_carousel_objects) {
+        carousel_bytes += get_header_entity_bytes(object.header) + get_memory_bytes(object.raw_header);
+    }
+    for (const auto& [content_name, transport_id]: m_carousel_names) {
+        carousel_bytes += get_memory_bytes(content_name);
+    }
+    usage.AddChild("carousel", carousel_bytes);
+    return usage;
+}
+
+size_t MOT_Processor::GetTotalSkippedSegments(void) {
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    return m_total_skipped_segments;
+}
+
 void MOT_Processor::Process_MSC_Data_Group(const MOT_MSC_Data_Group_Header header, tcb::span<const uint8_t> buf) {
     // DOC: ETSI EN 301 234
     // Clause 5.1.1: Segmentation header 
@@ -67,14 +161,49 @@ void MOT_Processor::Process_MSC_Data_Group(const MOT_MSC_Data_Group_Header heade
         LOG_WARN("Mismatching repetition count in MSC header and segmentation header {}!={}", header.repetition_index, repetition_count);
     }
 
+    auto lock = std::scoped_lock(m_mutex_assemblers);
+    ProcessSegment(header, data);
+    // Eviction is deferred until the segment is processed since it can remove any of our assemblers
+    if (m_budget != nullptr) {
+        if (m_assembler_tables.find(header.transport_id) != nullptr) {
+            UpdateBudget(header.transport_id, false, false);
+        }
+        m_budget->Evict(this);
+    }
+}
+
+void MOT_Processor::ProcessSegment(const MOT_MSC_Data_Group_Header header, tcb::span<const uint8_t> data) {
     // TODO: For MOT body entities the time taken to assemble them can be quite long
     //       Signal the progress of the assembler to a listener for MOT body entities
-    auto* assembler_table = m_assembler_tables.find(header.transport_id);
-    if (assembler_table == nullptr) {
-        assembler_table = &m_assembler_tables.emplace(header.transport_id);
+    // Repeated transmissions of an unchanged carousel object are dropped before an assembler is created for them
+    if (header.data_group_type == MOT_Data_Type::UNSCRAMBLED_BODY) {
+        auto res = m_carousel_objects.find(header.transport_id);
+        if ((res != m_carousel_objects.end()) && res->second.is_complete) {
+            m_total_skipped_segments++;
+            return;
+        }
+    }
+    if ((header.data_group_type == MOT_Data_Type::COMPRESSED_DIRECTORY) && !MOT_Inflater::GetIsSupported()) {
+        LOG_WARN("Ignoring compressed directory segment since inflation is unsupported tid={}", header.transport_id);
+        return;
+    }
+    auto& assembler_table = GetAssemblerTable(header.transport_id);
+    auto& assembler = GetAssembler(assembler_table, header.data_group_type);
+    if (header.data_group_type == MOT_Data_Type::UNSCRAMBLED_BODY) {
+        auto* body_header = m_body_headers.find(header.transport_id);
+        if (body_header != nullptr) {
+            // Bodies are only inflated while streaming if their header arrived before any segments
+            if ((body_header->compression_type != 0) && MOT_Inflater::GetIsSupported()) {
+                assembler.SetIsInflate();
+            }
+            assembler.SetExpectedSize(size_t(body_header->body_size));
+        }
+    } else if (header.data_group_type == MOT_Data_Type::COMPRESSED_DIRECTORY) {
+        assembler.SetIsInflate();
+        if ((header.segment_number == 0) && !ProcessCompressedDirectoryHeader(assembler, data)) {
+            return;
+        }
     }
-
-    auto& assembler = GetAssembler(*assembler_table, header.data_group_type);
     if (header.is_last_segment) {
         assembler.SetTotalSegments(header.segment_number+1);
     }
@@ -88,8 +217,10 @@ void MOT_Processor::Process_MSC_Data_Group(const MOT_MSC_Data_Group_Header heade
     }
  
     // TODO: Handle other mot data types
-    if (header.data_group_type == MOT_Data_Type::UNCOMPRESSED_DIRECTORY) {
-        ProcessDirectory(header.transport_id);
+    if ((header.data_group_type == MOT_Data_Type::UNCOMPRESSED_DIRECTORY) || 
+        (header.data_group_type == MOT_Data_Type::COMPRESSED_DIRECTORY)) 
+    {
+        ProcessDirectory(header.transport_id, header.data_group_type);
     } else if (header.data_group_type == MOT_Data_Type::HEADER) {
         auto header_buf = assembler.GetData();
         MOT_Header_Entity entity_header;
@@ -102,10 +233,60 @@ void MOT_Processor::Process_MSC_Data_Group(const MOT_MSC_Data_Group_Header heade
     }
 }
 
+MOT_Assembler_Table& MOT_Processor::GetAssemblerTable(const mot_transport_id_t transport_id) {
+    auto* table = m_assembler_tables.find(transport_id);
+    if (table != nullptr) {
+        return *table;
+    }
+
+    // Evict the least recently used table ourselves so the budget knows about it
+    if (m_assembler_tables.size() >= m_assembler_tables.get_max_size()) {
+        const auto lru_transport_id = std::prev(m_assembler_tables.end())->first;
+        m_assembler_tables.remove(lru_transport_id);
+        if (m_budget != nullptr) {
+            m_budget->Remove(*this, lru_transport_id);
+        }
+    }
+    auto& new_table = m_assembler_tables.emplace(transport_id, m_memory_resource);
+    UpdateBudget(transport_id, true, false);
+    return new_table;
+}
+
+size_t MOT_Processor::GetAssemblerTableBytes(MOT_Assembler_Table& table) const {
+    size_t total_bytes = 0;
+    for (const auto& [type, assembler]: table) {
+        total_bytes += assembler.GetBytesHeld();
+    }
+    return total_bytes;
+}
+
+void MOT_Processor::UpdateBudget(const mot_transport_id_t transport_id, const bool is_new, const bool is_complete) {
+    if (m_budget == nullptr) {
+        return;
+    }
+    auto* table = m_assembler_tables.find(transport_id);
+    const size_t total_bytes = (table != nullptr) ? GetAssemblerTableBytes(*table) : 0;
+    m_budget->Update(*this, transport_id, total_bytes, is_new, is_complete);
+}
+
+void MOT_Processor::EvictAssemblerTable(const mot_transport_id_t transport_id) {
+    m_assembler_tables.remove(transport_id);
+}
+
+void MOT_Processor::RemoveAssemblerTable(const mot_transport_id_t transport_id) {
+    if (m_assembler_tables.find(transport_id) == nullptr) {
+        return;
+    }
+    m_assembler_tables.remove(transport_id);
+    if (m_budget != nullptr) {
+        m_budget->Remove(*this, transport_id);
+    }
+}
+
 MOT_Assembler& MOT_Processor::GetAssembler(MOT_Assembler_Table& table, const MOT_Data_Type type) {
     auto res = table.find(type);
     if (res == table.end()) {
-        res = table.insert({type, {}}).first;
+        res = table.try_emplace(type, m_memory_resource).first;
     }
     return res->second;
 }
@@ -127,30 +308,94 @@ bool MOT_Processor::CheckBodyComplete(const mot_transport_id_t transport_id) {
         return false;
     }
 
-    const auto body_buf = body_assembler.GetData();
-    if (header->body_size != uint32_t(body_buf.size())) {
-        LOG_ERROR("Mismatching body length fields {}!={}", header->body_size, body_buf.size());
+    const size_t body_size = body_assembler.GetTransportSize();
+    if (header->body_size != uint32_t(body_size)) {
+        LOG_ERROR("Mismatching body length fields {}!={}", header->body_size, body_size);
         return false;
     }
 
+    // Body is handed off without copying and repeated segments of it are ignored from now on
     MOT_Entity entity;
     entity.transport_id = transport_id;
-    entity.body_buf = body_buf;
+    const bool is_inflated = body_assembler.GetIsInflate();
+    entity.body = body_assembler.TakeData();
     entity.header = *header;
 
+    // Body segments arrived before the header so the compressed body has to be inflated in one go
+    if ((header->compression_type != 0) && !is_inflated && MOT_Inflater::GetIsSupported()) {
+        auto inflated = MOT_Inflater::Inflate({ entity.body.data(), entity.body.size() }, 2*entity.body.size());
+        if (!inflated.has_value()) {
+            LOG_ERROR("Failed to inflate body with compression_type={} tid={}", header->compression_type, transport_id);
+            RemoveAssemblerTable(transport_id);
+            return false;
+        }
+        entity.body = std::move(inflated.value());
+    }
+
     LOG_MESSAGE("Completed a MOT header entity with header={} body={} tid={}", entity.header.header_size, entity.header.body_size, entity.transport_id);
+    UpdateBudget(transport_id, false, true);
     m_obs_on_entity_complete.Notify(entity);
+
+    // Completed carousel objects don't need their assemblers since repeated segments are skipped
+    auto carousel_object = m_carousel_objects.find(transport_id);
+    if (carousel_object != m_carousel_objects.end()) {
+        carousel_object->second.is_complete = true;
+        RemoveAssemblerTable(transport_id);
+    }
     return true;
 }
 
-bool MOT_Processor::ProcessDirectory(const mot_transport_id_t transport_id) {
+bool MOT_Processor::ProcessCompressedDirectoryHeader(MOT_Assembler& assembler, tcb::span<const uint8_t>& data) {
+    // DOC: ETSI EN 301 234
+    // Clause 7.2.6: Compressed MOT directory
+    // The compressed data follows a header in the first segment
+    constexpr size_t TOTAL_HEADER_SIZE = 9;
+    if (data.size() < TOTAL_HEADER_SIZE) {
+        LOG_ERROR("Compressed directory has insufficient length for header ({}<{})", data.size(), TOTAL_HEADER_SIZE);
+        return false;
+    }
+
+    const uint8_t compression_flag   =  (data[0] & 0b10000000) >> 7;
+    // const uint8_t rfu0            =  (data[0] & 0b01000000) >> 6;
+    // const uint32_t directory_size = ((data[0] & 0b00111111) << 24) | 
+    //                                 ((data[1] & 0b11111111) << 16) | 
+    //                                 ((data[2] & 0b11111111) << 8) | 
+    //                                 ((data[3] & 0b11111111) << 0);
+    const uint8_t compression_id     =  (data[4] & 0b11111111) >> 0;
+    // const uint8_t rfu1            =  (data[5] & 0b11000000) >> 6;
+    const uint32_t uncompressed_size = ((data[5] & 0b00111111) << 24) | 
+                                       ((data[6] & 0b11111111) << 16) | 
+                                       ((data[7] & 0b11111111) << 8) | 
+                                       ((data[8] & 0b11111111) << 0);
+
+    if (!compression_flag) {
+        LOG_ERROR("Compressed directory has compression flag unset");
+        return false;
+    }
+
+    // DOC: ETSI TS 101 756
+    // Table 19: Compression types
+    constexpr uint8_t COMPRESSION_ID_GZIP = 1;
+    if (compression_id != COMPRESSION_ID_GZIP) {
+        LOG_ERROR("Compressed directory has unsupported compression_id={}", compression_id);
+        return false;
+    }
+
+    // Decompressed directory is written straight into a buffer of its final size
+    assembler.SetExpectedSize(size_t(uncompressed_size));
+    data = data.subspan(TOTAL_HEADER_SIZE);
+    return true;
+}
+
+bool MOT_Processor::ProcessDirectory(const mot_transport_id_t transport_id, const MOT_Data_Type type) {
     // DOC: ETSI EN 301 234
     // Clause 5.3.2 Multiple object transmissions (MOT directory mode)
     auto* assembler_table = m_assembler_tables.find(transport_id);
     if (assembler_table == nullptr) {
         return false;
     }
-    auto& directory_assembler = GetAssembler(*assembler_table, MOT_Data_Type::UNCOMPRESSED_DIRECTORY);
+    // Compressed directories were inflated as they were received
+    auto& directory_assembler = GetAssembler(*assembler_table, type);
     if (!directory_assembler.CheckComplete()) {
         return false;
     }
@@ -164,7 +409,6 @@ bool MOT_Processor::ProcessDirectory(const mot_transport_id_t transport_id) {
         return false;
     }
  
-    // TODO: Do we need to deal with the data carousel?
     // const uint8_t compression_flag =  (buf[0]  & 0b10000000) >> 7;
     // const uint8_t rfu0             =  (buf[0]  & 0b01000000) >> 6;
     // const uint32_t directory_size  = ((buf[0]  & 0b00111111) << 24) | 
@@ -193,8 +437,10 @@ bool MOT_Processor::ProcessDirectory(const mot_transport_id_t transport_id) {
     // auto dir_extension_parameters = buf.first(dir_ext_length);
     buf = buf.subspan(dir_ext_length);
  
+    // Each directory is a new generation of the carousel and entries are diffed against the previous one
+    const uint32_t generation = ++m_carousel_generation;
     size_t current_directory_entity = 0;
-    while (true) {
+    while (current_directory_entity < total_objects) {
         constexpr size_t TRANSPORT_ID_SIZE = 2;
         if (buf.size() < TRANSPORT_ID_SIZE) {
             LOG_ERROR("Directory entries buffer has insufficient length ({}<{})", buf.size(), TRANSPORT_ID_SIZE);
@@ -203,34 +449,107 @@ bool MOT_Processor::ProcessDirectory(const mot_transport_id_t transport_id) {
         const uint16_t body_transport_id = (buf[0] << 8) | buf[1];
         buf = buf.subspan(TRANSPORT_ID_SIZE);
 
-        MOT_Header_Entity body_header;
-        const auto total_read_opt = ProcessHeader(body_header, buf);
-        // terminate reading of all directories entries if we encounter an intermittent error, this is not recoverable
-        if (!total_read_opt.has_value()) {
-            LOG_ERROR("Directry entry failed to read header, index={}", current_directory_entity);
+        // DOC: ETSI EN 301 234
+        // Clause 6.1: Header core 
+        // Header size is read ahead so the raw entry can be compared with the previous directory
+        constexpr size_t TOTAL_HEADER_CORE = 7;
+        if (buf.size() < TOTAL_HEADER_CORE) {
+            LOG_ERROR("Directory entry has insufficient length for header core ({}<{}) index={}", buf.size(), TOTAL_HEADER_CORE, current_directory_entity);
             break;
         }
-
-        // NOTE: Directory entries seem to be sent very rarely, so we want to be generous about which headers to cache
-        m_body_headers.insert(body_transport_id, std::move(body_header));
-        auto* body_assembler_table = m_assembler_tables.find(body_transport_id);
-        if (body_assembler_table != nullptr) {
-            CheckBodyComplete(body_transport_id);
+        const uint16_t header_size = ((buf[3] & 0b00001111) << 9) |
+                                     ((buf[4] & 0b11111111) << 1) |
+                                     ((buf[5] & 0b10000000) >> 7);
+        if ((header_size < TOTAL_HEADER_CORE) || (buf.size() < header_size)) {
+            LOG_ERROR("Directory entry has invalid header size ({}) buffer={} index={}", header_size, buf.size(), current_directory_entity);
+            break;
         }
 
-        const size_t total_read = total_read_opt.value();
-        assert(total_read <= buf.size());
-        buf = buf.subspan(total_read);
+        // terminate reading of all directories entries if we encounter an intermittent error, this is not recoverable
+        if (!UpdateCarouselObject(body_transport_id, buf.first(header_size), generation)) {
+            LOG_ERROR("Directry entry failed to read header, index={}", current_directory_entity);
+            break;
+        }
+        buf = buf.subspan(header_size);
         current_directory_entity++;
     }
 
     if (current_directory_entity != total_objects) {
         LOG_ERROR("Some directory entries were missed ({} != {})", current_directory_entity, total_objects);
+        return true;
     }
 
+    // Objects that aren't listed in a complete directory update were removed from the carousel
+    for (auto it = m_carousel_objects.begin(); it != m_carousel_objects.end();) {
+        if (it->second.generation == generation) {
+            it++;
+            continue;
+        }
+        RemoveCarouselName(it->first, it->second);
+        it = m_carousel_objects.erase(it);
+    }
+
+    return true;
+}
+
+bool MOT_Processor::UpdateCarouselObject(const mot_transport_id_t transport_id, tcb::span<const uint8_t> raw_header, const uint32_t generation) {
+    auto it = m_carousel_objects.find(transport_id);
+    if (it != m_carousel_objects.end()) {
+        auto& object = it->second;
+        const bool is_unchanged = 
+            (object.raw_header.size() == raw_header.size()) && 
+            std::equal(raw_header.begin(), raw_header.end(), object.raw_header.begin());
+        if (is_unchanged) {
+            object.generation = generation;
+            if (m_body_headers.find(transport_id) == nullptr) {
+                m_body_headers.insert(transport_id, MOT_Header_Entity(object.header));
+            }
+            return true;
+        }
+    }
+
+    MOT_Header_Entity body_header;
+    const auto total_read_opt = ProcessHeader(body_header, raw_header);
+    if (!total_read_opt.has_value()) {
+        return false;
+    }
+
+    if (it != m_carousel_objects.end()) {
+        // A changed entry is a new version of the object so any segments of the old version are discarded
+        RemoveCarouselName(transport_id, it->second);
+        RemoveAssemblerTable(transport_id);
+    } else {
+        it = m_carousel_objects.try_emplace(transport_id).first;
+    }
+
+    auto& object = it->second;
+    object.header = body_header;
+    object.raw_header.assign(raw_header.begin(), raw_header.end());
+    object.is_complete = false;
+    object.generation = generation;
+    if (object.header.content_name.exists) {
+        m_carousel_names[object.header.content_name.name] = transport_id;
+    }
+
+    // NOTE: Directory entries seem to be sent very rarely, so we want to be generous about which headers to cache
+    m_body_headers.insert(transport_id, std::move(body_header));
+    if (m_assembler_tables.find(transport_id) != nullptr) {
+        CheckBodyComplete(transport_id);
+    }
     return true;
 }
 
+void MOT_Processor::RemoveCarouselName(const mot_transport_id_t transport_id, const MOT_Carousel_Object& object) {
+    if (!object.header.content_name.exists) {
+        return;
+    }
+    auto res = m_carousel_names.find(object.header.content_name.name);
+    // Another object may have taken over the name in a directory update
+    if ((res != m_carousel_names.end()) && (res->second == transport_id)) {
+        m_carousel_names.erase(res);
+    }
+}
+
 std::optional<size_t> MOT_Processor::ProcessHeader(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf) {
     // DOC: ETSI EN 301 234
     // Clause 5.3.1: Single object transmission (MOT header mode) 
@@ -382,7 +701,7 @@ bool MOT_Processor::ProcessHeaderExtensionParameter(MOT_Header_Entity& entity, c
     UNIMPLEMENTED_CASE(0b001011, "label");
     UNIMPLEMENTED_CASE(0b001101, "unique_body_version");
     UNIMPLEMENTED_CASE(0b010000, "mime_type");
-    UNIMPLEMENTED_CASE(0b010001, "compression_type");
+    case 0b010001: return ProcessHeaderExtensionParameter_CompressionType(entity, buf);
     UNIMPLEMENTED_CASE(0b100000, "additional_header");
     UNIMPLEMENTED_CASE(0b100001, "profile_subset");
     UNIMPLEMENTED_CASE(0b100011, "conditional_access_info");
@@ -426,6 +745,18 @@ bool MOT_Processor::ProcessHeaderExtensionParameter_ExpireTime(MOT_Header_Entity
     return ProcessHeaderExtensionParameter_UTCTime(entity.expire_time, buf);
 }
 
+bool MOT_Processor::ProcessHeaderExtensionParameter_CompressionType(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf) {
+    // DOC: ETSI EN 301 234
+    // Clause 6.2.3.3: CompressionType
+    if (buf.size() != 1) {
+        LOG_ERROR("[header-ext] type=compression_type Expected 1 byte data field but got {}", buf.size());
+        return false;
+    }
+    entity.compression_type = buf[0];
+    LOG_MESSAGE("[header-ext] type=compression_type id={}", entity.compression_type);
+    return true;
+}
+
 bool MOT_Processor::ProcessHeaderExtensionParameter_TriggerTime(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf) {
     return ProcessHeaderExtensionParameter_UTCTime(entity.trigger_time, buf);
 }
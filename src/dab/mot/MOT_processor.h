@@ -2,12 +2,19 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "utility/lru_cache.h"
+#include "utility/memory_usage.h"
 #include "utility/observable.h"
 #include "utility/span.h"
 #include "./MOT_assembler.h"
+#include "./MOT_assembler_budget.h"
 #include "./MOT_entities.h"
 
 // DOC: ETSI EN 301 234 
@@ -38,9 +45,23 @@ struct MOT_MSC_Data_Group_Header {
     mot_transport_id_t transport_id;
 };
 
-typedef std::unordered_map<MOT_Data_Type, MOT_Assembler> MOT_Assembler_Table;
+typedef std::pmr::unordered_map<MOT_Data_Type, MOT_Assembler> MOT_Assembler_Table;
+
+// DOC: ETSI EN 301 234
+// Clause 5.3.2: Multiple object transmissions (MOT directory mode)
+// Object listed in the current MOT directory of a data carousel
+struct MOT_Carousel_Object {
+    MOT_Header_Entity header;
+    // Directory entry header bytes so that directory updates can be diffed without parsing them
+    std::vector<uint8_t> raw_header;
+    // Body was handed to listeners so its repeated transmissions are skipped until the entry changes
+    bool is_complete = false;
+    // Last directory which listed the object
+    uint32_t generation = 0;
+};
 
 // Create MOT entities from MSC data groups
+// NOTE: Assemblers are allocated from memory_resource which must outlive the processor
 class MOT_Processor
 {
 private:
@@ -48,20 +69,53 @@ private:
     // Clause 5.3.2.1: Interleaving MOT entities in one MOT stream 
     LRU_Cache<mot_transport_id_t, MOT_Assembler_Table> m_assembler_tables;
     LRU_Cache<mot_transport_id_t, MOT_Header_Entity> m_body_headers;
-    Observable<MOT_Entity> m_obs_on_entity_complete;
+    // Passed by mutable reference so a listener can take ownership of the entity body
+    Ref_Observable<MOT_Entity&> m_obs_on_entity_complete;
+    // Optional byte budget shared with other processors which can evict our assemblers from their threads
+    std::shared_ptr<MOT_Assembler_Budget> m_budget;
+    // Carousel objects of the current directory indexed by transport id and ContentName
+    std::unordered_map<mot_transport_id_t, MOT_Carousel_Object> m_carousel_objects;
+    std::unordered_map<std::string, mot_transport_id_t> m_carousel_names;
+    uint32_t m_carousel_generation = 0;
+    size_t m_total_skipped_segments = 0;
+    std::mutex m_mutex_assemblers;
+    std::pmr::memory_resource* const m_memory_resource;
+    friend class MOT_Assembler_Budget;
 public:
     // Header entities are quite small so we set a generous upper bound
-    explicit MOT_Processor(const size_t max_transport_entities=20, const size_t max_header_entities=200);
+    explicit MOT_Processor(
+        const size_t max_transport_entities=20, const size_t max_header_entities=200,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
+    ~MOT_Processor();
     void Process_MSC_Data_Group(const MOT_MSC_Data_Group_Header header, tcb::span<const uint8_t> buf);
+    void SetAssemblerBudget(std::shared_ptr<MOT_Assembler_Budget> budget);
     auto& OnEntityComplete(void) { return m_obs_on_entity_complete; }
+    // Copies are returned since the directory is updated on the decoder thread
+    std::optional<mot_transport_id_t> FindCarouselObject(const std::string& content_name);
+    std::optional<MOT_Carousel_Object> GetCarouselObject(const mot_transport_id_t transport_id);
+    size_t GetTotalCarouselObjects(void);
+    // Body segments of completed carousel objects that were skipped without reassembly
+    size_t GetTotalSkippedSegments(void);
+    // Partially assembled entities along with the cached headers and carousel directory
+    Memory_Usage GetMemoryUsage(void);
 private:
+    void ProcessSegment(const MOT_MSC_Data_Group_Header header, tcb::span<const uint8_t> data);
+    MOT_Assembler_Table& GetAssemblerTable(const mot_transport_id_t transport_id);
     MOT_Assembler& GetAssembler(MOT_Assembler_Table& table, const MOT_Data_Type type);
+    size_t GetAssemblerTableBytes(MOT_Assembler_Table& table) const;
+    void UpdateBudget(const mot_transport_id_t transport_id, const bool is_new, const bool is_complete);
+    void EvictAssemblerTable(const mot_transport_id_t transport_id);
+    void RemoveAssemblerTable(const mot_transport_id_t transport_id);
     bool CheckBodyComplete(const mot_transport_id_t transport_id);
-    bool ProcessDirectory(const mot_transport_id_t transport_id);
+    bool ProcessDirectory(const mot_transport_id_t transport_id, const MOT_Data_Type type);
+    bool ProcessCompressedDirectoryHeader(MOT_Assembler& assembler, tcb::span<const uint8_t>& data);
+    bool UpdateCarouselObject(const mot_transport_id_t transport_id, tcb::span<const uint8_t> raw_header, const uint32_t generation);
+    void RemoveCarouselName(const mot_transport_id_t transport_id, const MOT_Carousel_Object& object);
     std::optional<size_t> ProcessHeader(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf);
     bool ProcessHeaderExtensionParameter(MOT_Header_Entity& entity, const uint8_t id, tcb::span<const uint8_t> buf);
     bool ProcessHeaderExtensionParameter_ContentName(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf);
     bool ProcessHeaderExtensionParameter_ExpireTime(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf);
+    bool ProcessHeaderExtensionParameter_CompressionType(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf);
     bool ProcessHeaderExtensionParameter_TriggerTime(MOT_Header_Entity& entity, tcb::span<const uint8_t> buf);
     bool ProcessHeaderExtensionParameter_UTCTime(MOT_UTC_Time& entity, tcb::span<const uint8_t> buf);
 };
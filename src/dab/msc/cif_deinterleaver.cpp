@@ -1,6 +1,12 @@
 #include "./cif_deinterleaver.h"
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
 #include "utility/span.h"
 #include "viterbi_config.h"
+#include "./cif_history.h"
 
 // DOC: ETSI EN 300 401
 // Clause 12 - Time interleaving
@@ -10,8 +16,188 @@ const int CIF_INDICES_OFFSETS[TOTAL_CIF_DEINTERLEAVE] = {
     0,8,4,12, 2,10,6,14, 1,9,5,13, 3,11,7,15
 };
 
+// Each output bit i is read from the frame selected by (i % 16)
+// We precompute the frame pointer for each of the 16 lanes so the inner loop has no modulo or table lookup
+// The vectorised variants load 16 (or 32) bits from each lane's frame and mask in the lane they own
+static void deinterleave_scalar(
+    const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits,
+    const size_t start, const size_t end)
+{
+    for (size_t i = start; i < end; i++) {
+        const size_t lane = i % TOTAL_CIF_DEINTERLEAVE;
+        out_bits[i] = lane_bufs[lane][i];
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+static void deinterleave_sse4_1(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    // 128bits = 16 soft bits
+    constexpr size_t K = 16;
+    const size_t N_vector = (N/K)*K;
+
+    __m128i lane_masks[TOTAL_CIF_DEINTERLEAVE];
+    for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+        alignas(16) int8_t mask[K] = {0};
+        mask[lane] = -1;
+        lane_masks[lane] = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+    }
+
+    // Use independent accumulators to avoid a long dependency chain
+    constexpr int M = 4;
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m128i Y[M];
+        for (int j = 0; j < M; j++) {
+            Y[j] = _mm_setzero_si128();
+        }
+        for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+            const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lane_bufs[lane][i]));
+            Y[lane % M] = _mm_or_si128(Y[lane % M], _mm_and_si128(X, lane_masks[lane]));
+        }
+        const __m128i Y_out = _mm_or_si128(_mm_or_si128(Y[0], Y[1]), _mm_or_si128(Y[2], Y[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out_bits[i]), Y_out);
+    }
+
+    deinterleave_scalar(lane_bufs, out_bits, N_vector, N);
+}
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+static void deinterleave_avx2(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    // 256bits = 32 soft bits = 2 blocks of the 16 lane pattern
+    constexpr size_t K = 32;
+    const size_t N_vector = (N/K)*K;
+
+    __m256i lane_masks[TOTAL_CIF_DEINTERLEAVE];
+    for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+        alignas(32) int8_t mask[K] = {0};
+        mask[lane] = -1;
+        mask[lane+TOTAL_CIF_DEINTERLEAVE] = -1;
+        lane_masks[lane] = _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+    }
+
+    // Use independent accumulators to avoid a long dependency chain
+    constexpr int M = 4;
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m256i Y[M];
+        for (int j = 0; j < M; j++) {
+            Y[j] = _mm256_setzero_si256();
+        }
+        for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+            const __m256i X = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lane_bufs[lane][i]));
+            Y[lane % M] = _mm256_or_si256(Y[lane % M], _mm256_and_si256(X, lane_masks[lane]));
+        }
+        const __m256i Y_out = _mm256_or_si256(_mm256_or_si256(Y[0], Y[1]), _mm256_or_si256(Y[2], Y[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out_bits[i]), Y_out);
+    }
+
+    deinterleave_scalar(lane_bufs, out_bits, N_vector, N);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#if defined(__SIMD_SVE2__)
+#include <arm_sve.h>
+// Vector length agnostic since every SVE vector holds a multiple of 16 soft bits
+// Each lane's frame is only loaded for the soft bits it owns
+static void deinterleave_sve2(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    const size_t K = svcntb();
+    const svuint8_t lane_index = svand_n_u8_x(svptrue_b8(), svindex_u8(0, 1), uint8_t(TOTAL_CIF_DEINTERLEAVE-1));
+    for (size_t i = 0; i < N; i+=K) {
+        const svbool_t pg = svwhilelt_b8(i, N);
+        svint8_t Y = svdup_n_s8(0);
+        for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+            const svbool_t pg_lane = svcmpeq_n_u8(pg, lane_index, uint8_t(lane));
+            Y = svorr_s8_x(pg, Y, svld1_s8(pg_lane, &lane_bufs[lane][i]));
+        }
+        svst1_s8(pg, &out_bits[i], Y);
+    }
+}
+#else
+#include <arm_neon.h>
+static void deinterleave_neon(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    // 128bits = 16 soft bits
+    constexpr size_t K = 16;
+    const size_t N_vector = (N/K)*K;
+
+    uint8x16_t lane_masks[TOTAL_CIF_DEINTERLEAVE];
+    for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+        uint8_t mask[K] = {0};
+        mask[lane] = 0xFF;
+        lane_masks[lane] = vld1q_u8(mask);
+    }
+
+    for (size_t i = 0; i < N_vector; i+=K) {
+        int8x16_t Y = vdupq_n_s8(0);
+        for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+            const int8x16_t X = vld1q_s8(&lane_bufs[lane][i]);
+            Y = vbslq_s8(lane_masks[lane], X, Y);
+        }
+        vst1q_s8(&out_bits[i], Y);
+    }
+
+    deinterleave_scalar(lane_bufs, out_bits, N_vector, N);
+}
+#endif
+
+#elif defined(__ARCH_RISCV__) && defined(__SIMD_RVV__)
+
+#include <riscv_vector.h>
+// Vector length agnostic where the lane of each soft bit is found from its index
+// since the tail of the strip mined loop isn't always a multiple of 16 soft bits
+static void deinterleave_rvv(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    for (size_t i = 0, vl = 0; i < N; i+=vl) {
+        vl = __riscv_vsetvl_e8m1(N-i);
+        // NOTE: The index wraps around at 256 which is a multiple of 16
+        const vuint8m1_t lane_index = __riscv_vand_vx_u8m1(
+            __riscv_vadd_vx_u8m1(__riscv_vid_v_u8m1(vl), uint8_t(i), vl), uint8_t(TOTAL_CIF_DEINTERLEAVE-1), vl);
+        vint8m1_t Y = __riscv_vmv_v_x_i8m1(0, vl);
+        for (int lane = 0; lane < TOTAL_CIF_DEINTERLEAVE; lane++) {
+            const vbool8_t mask = __riscv_vmseq_vx_u8m1_b8(lane_index, uint8_t(lane), vl);
+            Y = __riscv_vle8_v_i8m1_mu(mask, Y, &lane_bufs[lane][i], vl);
+        }
+        __riscv_vse8_v_i8m1(&out_bits[i], Y, vl);
+    }
+}
+
+#endif
+
+// Compile time selected vectorisation
+static void deinterleave_auto(const viterbi_bit_t* const* lane_bufs, viterbi_bit_t* out_bits, const size_t N) {
+    #if defined(__ARCH_X86__)
+        #if defined(__AVX2__)
+        #pragma message("CIF_DEINTERLEAVER using x86 AVX2")
+        deinterleave_avx2(lane_bufs, out_bits, N);
+        #elif defined(__SSE4_1__)
+        #pragma message("CIF_DEINTERLEAVER using x86 SSE4.1")
+        deinterleave_sse4_1(lane_bufs, out_bits, N);
+        #else
+        #pragma message("CIF_DEINTERLEAVER using x86 SCALAR")
+        deinterleave_scalar(lane_bufs, out_bits, 0, N);
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        #if defined(__SIMD_SVE2__)
+        #pragma message("CIF_DEINTERLEAVER using ARM AARCH64 SVE2")
+        deinterleave_sve2(lane_bufs, out_bits, N);
+        #else
+        #pragma message("CIF_DEINTERLEAVER using ARM AARCH64 NEON")
+        deinterleave_neon(lane_bufs, out_bits, N);
+        #endif
+    #elif defined(__ARCH_RISCV__) && defined(__SIMD_RVV__)
+        #pragma message("CIF_DEINTERLEAVER using RISC-V RVV")
+        deinterleave_rvv(lane_bufs, out_bits, N);
+    #else
+        #pragma message("CIF_DEINTERLEAVER using crossplatform SCALAR")
+        deinterleave_scalar(lane_bufs, out_bits, 0, N);
+    #endif
+}
+
 CIF_Deinterleaver::CIF_Deinterleaver(const int nb_bytes)
-: m_nb_bytes(nb_bytes) 
+: m_nb_bytes(nb_bytes)
 {
     const int nb_bits = m_nb_bytes*8;
     m_bits_buffer.resize(nb_bits*TOTAL_CIF_DEINTERLEAVE);
@@ -22,15 +208,13 @@ void CIF_Deinterleaver::Consume(tcb::span<const viterbi_bit_t> bits_buf) {
 
     // Append data into circular buffer
     auto* curr_bits_buf = &m_bits_buffer[nb_bits*m_curr_frame];
-    for (int i = 0; i < nb_bits; i++) {
-        curr_bits_buf[i] = bits_buf[i];
-    }
+    memcpy(curr_bits_buf, bits_buf.data(), size_t(nb_bits)*sizeof(viterbi_bit_t));
 
     // Advance frame
     m_curr_frame = (m_curr_frame+1) % TOTAL_CIF_DEINTERLEAVE;
     if (m_total_frames_stored < TOTAL_CIF_DEINTERLEAVE) {
         m_total_frames_stored++;
-    } 
+    }
 }
 
 bool CIF_Deinterleaver::Deinterleave(tcb::span<viterbi_bit_t> out_bits_buf) {
@@ -44,7 +228,7 @@ bool CIF_Deinterleaver::Deinterleave(tcb::span<viterbi_bit_t> out_bits_buf) {
     // Create a list of buffer pointers
     // Index=0   points to the newest frame
     // Index=end points to the oldest frame
-    viterbi_bit_t* BUFFER_LOOKUP[TOTAL_CIF_DEINTERLEAVE]; 
+    const viterbi_bit_t* BUFFER_LOOKUP[TOTAL_CIF_DEINTERLEAVE];
     for (int i = 0; i < TOTAL_CIF_DEINTERLEAVE; i++) {
         const int frame_index = ((m_curr_frame-1) -i + TOTAL_CIF_DEINTERLEAVE) % TOTAL_CIF_DEINTERLEAVE;
         BUFFER_LOOKUP[i] = &m_bits_buffer[frame_index*nb_bits];
@@ -52,20 +236,113 @@ bool CIF_Deinterleaver::Deinterleave(tcb::span<viterbi_bit_t> out_bits_buf) {
 
     // DOC: ETSI EN 300 401
     // Clause 12 - Time interleaving
-    // Referring to this section, we can reconstruct a frame 
+    // Referring to this section, we can reconstruct a frame
     // from all the stored frames in our circular buffer
-    // TODO: The specification also states that on a multiplex reconfiguration occurs the deinterleaving changes
-    //       Implement a way to handle this
+    // To get the bits from the same CIF before interleaving
+    // We reconstruct the oldest frame since that has all of its bits stored in the buffer
+    // NOTE: Multiplex reconfigurations are only handled when deinterleaving from a shared history
+    const viterbi_bit_t* LANE_LOOKUP[TOTAL_CIF_DEINTERLEAVE];
+    for (int i = 0; i < TOTAL_CIF_DEINTERLEAVE; i++) {
+        const int frame_offset = CIF_INDICES_OFFSETS[i];
+        const int frame_index = (TOTAL_CIF_DEINTERLEAVE-1) - frame_offset;
+        LANE_LOOKUP[i] = BUFFER_LOOKUP[frame_index];
+    }
 
     // Deinterleave and store in output bits buffer
-    for (int i = 0; i < nb_bits; i++) {
-        const int i_mod = i % TOTAL_CIF_DEINTERLEAVE;
-        // To get the bits from the same CIF before interleaving
-        // We reconstruct the oldest frame since that has all of its bits stored in the buffer
-        const int frame_offset = CIF_INDICES_OFFSETS[i_mod];
-        const int frame_index = (TOTAL_CIF_DEINTERLEAVE-1) - frame_offset;
-        out_bits_buf[i] = BUFFER_LOOKUP[frame_index][i];
+    deinterleave_auto(LANE_LOOKUP, out_bits_buf.data(), size_t(nb_bits));
+    return true;
+}
+
+bool CIF_Deinterleaver::Deinterleave(
+    const CIF_History& history, const uint64_t cif_index, const int start_bit,
+    tcb::span<viterbi_bit_t> out_bits_buf)
+{
+    return Deinterleave(history, cif_index, start_bit, start_bit, 0, out_bits_buf);
+}
+
+bool CIF_Deinterleaver::Deinterleave(
+    const CIF_History& history, const uint64_t cif_index, const int start_bit,
+    const int prev_start_bit, const uint64_t relocate_cif_index,
+    tcb::span<viterbi_bit_t> out_bits_buf)
+{
+    // insufficient frames to deinterleave
+    if (cif_index < (history.GetFirstIndex() + TOTAL_CIF_DEINTERLEAVE - 1)) {
+        return false;
     }
 
+    // Same as above where cif_index is the newest frame
+    const uint64_t oldest_index = cif_index - (TOTAL_CIF_DEINTERLEAVE-1);
+    const size_t nb_bits = out_bits_buf.size();
+    // A packed history is unpacked lane by lane so only the subchannel's address range is expanded
+    thread_local std::vector<viterbi_bit_t> unpacked_lanes;
+    if (history.GetIsPacked()) {
+        unpacked_lanes.resize(nb_bits*TOTAL_CIF_DEINTERLEAVE);
+    }
+    const viterbi_bit_t* LANE_LOOKUP[TOTAL_CIF_DEINTERLEAVE];
+    for (int i = 0; i < TOTAL_CIF_DEINTERLEAVE; i++) {
+        const int frame_offset = CIF_INDICES_OFFSETS[i];
+        // DOC: ETSI EN 300 401
+        // Clause 6.5: Multiplex reconfiguration
+        // A subchannel that only changes its start address keeps its time interleaving across a reconfiguration
+        const uint64_t lane_cif_index = oldest_index + uint64_t(frame_offset);
+        const int lane_start_bit = (lane_cif_index < relocate_cif_index) ? prev_start_bit : start_bit;
+        if (history.GetIsPacked()) {
+            // same layout as the unpacked lane which starts at the subchannel address
+            auto lane_buf = tcb::span(unpacked_lanes).subspan(size_t(i)*nb_bits, nb_bits);
+            history.ReadCIF(lane_cif_index, lane_start_bit, lane_buf);
+            LANE_LOOKUP[i] = lane_buf.data();
+        } else {
+            const auto cif_buf = history.GetCIF(lane_cif_index);
+            LANE_LOOKUP[i] = &cif_buf[size_t(lane_start_bit)];
+        }
+    }
+
+    deinterleave_auto(LANE_LOOKUP, out_bits_buf.data(), nb_bits);
+    return true;
+}
+
+bool CIF_Deinterleaver::DeinterleaveCIFs(
+    const CIF_History& history, const uint64_t cif_index, const int total_cifs, const int start_bit,
+    const int prev_start_bit, const uint64_t relocate_cif_index,
+    tcb::span<viterbi_bit_t> out_bits_buf)
+{
+    // insufficient frames to deinterleave the first CIF
+    if ((total_cifs <= 0) || (cif_index < (history.GetFirstIndex() + TOTAL_CIF_DEINTERLEAVE - 1))) {
+        return false;
+    }
+
+    // Consecutive CIFs overlap in all but one of the frames they are interleaved over
+    const uint64_t oldest_index = cif_index - (TOTAL_CIF_DEINTERLEAVE-1);
+    const size_t nb_bits = out_bits_buf.size() / size_t(total_cifs);
+    const int total_frames = TOTAL_CIF_DEINTERLEAVE + total_cifs-1;
+    thread_local std::vector<const viterbi_bit_t*> frame_lookup;
+    thread_local std::vector<viterbi_bit_t> unpacked_frames;
+    frame_lookup.resize(size_t(total_frames));
+    if (history.GetIsPacked()) {
+        unpacked_frames.resize(nb_bits*size_t(total_frames));
+    }
+    for (int i = 0; i < total_frames; i++) {
+        // DOC: ETSI EN 300 401
+        // Clause 6.5: Multiplex reconfiguration
+        // A subchannel that only changes its start address keeps its time interleaving across a reconfiguration
+        const uint64_t frame_cif_index = oldest_index + uint64_t(i);
+        const int frame_start_bit = (frame_cif_index < relocate_cif_index) ? prev_start_bit : start_bit;
+        if (history.GetIsPacked()) {
+            auto frame_buf = tcb::span(unpacked_frames).subspan(size_t(i)*nb_bits, nb_bits);
+            history.ReadCIF(frame_cif_index, frame_start_bit, frame_buf);
+            frame_lookup[size_t(i)] = frame_buf.data();
+        } else {
+            const auto cif_buf = history.GetCIF(frame_cif_index);
+            frame_lookup[size_t(i)] = &cif_buf[size_t(frame_start_bit)];
+        }
+    }
+
+    for (int cif = 0; cif < total_cifs; cif++) {
+        const viterbi_bit_t* LANE_LOOKUP[TOTAL_CIF_DEINTERLEAVE];
+        for (int i = 0; i < TOTAL_CIF_DEINTERLEAVE; i++) {
+            LANE_LOOKUP[i] = frame_lookup[size_t(cif + CIF_INDICES_OFFSETS[i])];
+        }
+        deinterleave_auto(LANE_LOOKUP, &out_bits_buf[size_t(cif)*nb_bits], nb_bits);
+    }
     return true;
-}
\ No newline at end of file
+}
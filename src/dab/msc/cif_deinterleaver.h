@@ -1,9 +1,13 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <vector>
 #include "utility/span.h"
 #include "viterbi_config.h"
 
+class CIF_History;
+
 // Used to deinterleave DAB logical frames coming over a subchannel
 // Refer to ETSI EN 300 401 Clause 12 for a detailed explanation
 class CIF_Deinterleaver 
@@ -19,4 +23,23 @@ public:
     void Consume(tcb::span<const viterbi_bit_t> bits_buf); 
     // Output the deinterleaved bits into a bits array
     bool Deinterleave(tcb::span<viterbi_bit_t> out_bits_buf);
+    size_t GetMemoryBytes() const { return m_bits_buffer.capacity()*sizeof(viterbi_bit_t); }
+    // Deinterleave the subchannel starting at start_bit directly from a shared history
+    // cif_index is the newest CIF and the 15 CIFs before it must still be retained
+    static bool Deinterleave(
+        const CIF_History& history, const uint64_t cif_index, const int start_bit,
+        tcb::span<viterbi_bit_t> out_bits_buf);
+    // Same as above except CIFs before relocate_cif_index are read from prev_start_bit
+    // This keeps the history of a subchannel that was moved by a multiplex reconfiguration
+    static bool Deinterleave(
+        const CIF_History& history, const uint64_t cif_index, const int start_bit,
+        const int prev_start_bit, const uint64_t relocate_cif_index,
+        tcb::span<viterbi_bit_t> out_bits_buf);
+    // Same as above for total_cifs consecutive CIFs starting at cif_index in one pass over the history
+    // The CIFs shared by their interleaving windows are only read once which matters for a packed history
+    // out_bits_buf holds each deinterleaved CIF one after the other
+    static bool DeinterleaveCIFs(
+        const CIF_History& history, const uint64_t cif_index, const int total_cifs, const int start_bit,
+        const int prev_start_bit, const uint64_t relocate_cif_index,
+        tcb::span<viterbi_bit_t> out_bits_buf);
 };
\ No newline at end of file
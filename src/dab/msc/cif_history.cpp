@@ -0,0 +1,57 @@
+#include "./cif_history.h"
+#include <assert.h>
+#include <string.h>
+#include "dab/algorithms/soft_bit_packing.h"
+#include "utility/memory_policy.h"
+#include "utility/page_allocator.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+CIF_History::CIF_History(
+    const int nb_cif_bits, const size_t total_cifs, const uint64_t first_index, const bool is_packed,
+    const Memory_Policy& memory_policy)
+: m_nb_cif_bits(nb_cif_bits), m_total_cifs(total_cifs), m_first_index(first_index), m_is_packed(is_packed),
+  m_memory_policy(memory_policy), m_total_pushed(first_index),
+  m_bits_buffer(PageAllocator<viterbi_bit_t>(alignof(viterbi_bit_t), memory_policy)),
+  m_packed_buffer(PageAllocator<uint8_t>(alignof(uint8_t), memory_policy))
+{
+    if (m_is_packed) {
+        m_packed_buffer.resize(get_packed_soft_bits_size(size_t(m_nb_cif_bits))*m_total_cifs);
+    } else {
+        m_bits_buffer.resize(size_t(m_nb_cif_bits)*m_total_cifs);
+    }
+}
+
+uint64_t CIF_History::Push(tcb::span<const viterbi_bit_t> cif_buf) {
+    assert(int(cif_buf.size()) == m_nb_cif_bits);
+    const uint64_t index = m_total_pushed;
+    const size_t slot = size_t(index % m_total_cifs);
+    if (m_is_packed) {
+        const size_t nb_packed = get_packed_soft_bits_size(size_t(m_nb_cif_bits));
+        pack_soft_bits_auto(cif_buf, tcb::span(m_packed_buffer).subspan(slot*nb_packed, nb_packed));
+    } else {
+        memcpy(&m_bits_buffer[slot*size_t(m_nb_cif_bits)], cif_buf.data(), size_t(m_nb_cif_bits)*sizeof(viterbi_bit_t));
+    }
+    m_total_pushed++;
+    return index;
+}
+
+tcb::span<const viterbi_bit_t> CIF_History::GetCIF(const uint64_t index) const {
+    assert(!m_is_packed);
+    const size_t slot = size_t(index % m_total_cifs);
+    return tcb::span(m_bits_buffer).subspan(slot*size_t(m_nb_cif_bits), size_t(m_nb_cif_bits));
+}
+
+void CIF_History::ReadCIF(const uint64_t index, const int start_bit, tcb::span<viterbi_bit_t> out_buf) const {
+    assert((start_bit >= 0) && (size_t(start_bit)+out_buf.size() <= size_t(m_nb_cif_bits)));
+    const size_t slot = size_t(index % m_total_cifs);
+    if (!m_is_packed) {
+        memcpy(out_buf.data(), &m_bits_buffer[slot*size_t(m_nb_cif_bits) + size_t(start_bit)], out_buf.size()*sizeof(viterbi_bit_t));
+        return;
+    }
+    assert(start_bit % 2 == 0);
+    const size_t nb_packed = get_packed_soft_bits_size(size_t(m_nb_cif_bits));
+    const size_t packed_start = slot*nb_packed + size_t(start_bit)/2;
+    const auto packed_buf = tcb::span(m_packed_buffer).subspan(packed_start, get_packed_soft_bits_size(out_buf.size()));
+    unpack_soft_bits_auto(packed_buf, out_buf);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/memory_policy.h"
+#include "utility/page_allocator.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+
+// Ensemble wide history of the soft bits of the most recent CIFs (common interleaved frames)
+// This is shared by all subchannels so that each one deinterleaves its address range in place
+// instead of keeping its own private copy of the last 16 CIFs
+// NOTE: A single thread pushes CIFs while other threads read older CIFs that are still retained
+//       The caller must size the history so that CIFs being read are never overwritten
+class CIF_History
+{
+private:
+    const int m_nb_cif_bits;
+    const size_t m_total_cifs;
+    const uint64_t m_first_index;
+    const bool m_is_packed;
+    const Memory_Policy m_memory_policy;
+    uint64_t m_total_pushed;
+    std::vector<viterbi_bit_t, PageAllocator<viterbi_bit_t>> m_bits_buffer;
+    // soft bits quantised to 4bits which halves the memory used by the history
+    std::vector<uint8_t, PageAllocator<uint8_t>> m_packed_buffer;
+public:
+    // first_index lets a resized history continue the numbering of the one it replaces
+    // memory_policy is applied to the buffer which can be several MB for an ensemble
+    CIF_History(
+        const int nb_cif_bits, const size_t total_cifs, const uint64_t first_index=0, const bool is_packed=false,
+        const Memory_Policy& memory_policy={});
+    // Returns the index of the pushed CIF
+    uint64_t Push(tcb::span<const viterbi_bit_t> cif_buf);
+    // NOTE: Only available if the history isn't packed
+    tcb::span<const viterbi_bit_t> GetCIF(const uint64_t index) const;
+    // Copies out_buf.size() soft bits starting at start_bit and unpacks them if needed
+    // NOTE: start_bit must be even if the history is packed which is true for all subchannel addresses
+    void ReadCIF(const uint64_t index, const int start_bit, tcb::span<viterbi_bit_t> out_buf) const;
+    int GetCIFBits() const { return m_nb_cif_bits; }
+    size_t GetTotalCIFs() const { return m_total_cifs; }
+    uint64_t GetFirstIndex() const { return m_first_index; }
+    uint64_t GetTotalPushed() const { return m_total_pushed; }
+    bool GetIsPacked() const { return m_is_packed; }
+    const Memory_Policy& GetMemoryPolicy() const { return m_memory_policy; }
+    size_t GetMemoryBytes() const {
+        return m_bits_buffer.capacity()*sizeof(viterbi_bit_t) + m_packed_buffer.capacity()*sizeof(uint8_t);
+    }
+};
@@ -0,0 +1,44 @@
+#include "./cif_interleaver.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include "utility/span.h"
+
+// DOC: ETSI EN 300 401
+// Clause 12 - Time interleaving
+// Bit i of a logical frame is delayed by the number of CIFs given in table 21 for (i % 16)
+constexpr int TOTAL_CIF_INTERLEAVE = 16;
+const int CIF_INDICES_OFFSETS[TOTAL_CIF_INTERLEAVE] = {
+    0,8,4,12, 2,10,6,14, 1,9,5,13, 3,11,7,15
+};
+
+CIF_Interleaver::CIF_Interleaver(const int nb_bits)
+: m_nb_bits(nb_bits)
+{
+    m_bits_buffer.resize(size_t(TOTAL_CIF_INTERLEAVE*m_nb_bits), 0);
+}
+
+void CIF_Interleaver::Reset() {
+    std::fill(m_bits_buffer.begin(), m_bits_buffer.end(), uint8_t(0));
+    m_curr_frame = 0;
+}
+
+void CIF_Interleaver::Interleave(tcb::span<const uint8_t> bits_in, tcb::span<uint8_t> bits_out) {
+    const size_t N = size_t(m_nb_bits);
+    assert(bits_in.size() == N);
+    assert(bits_out.size() == N);
+    std::copy_n(bits_in.begin(), N, m_bits_buffer.begin() + size_t(m_curr_frame)*N);
+
+    // the frame pointer of each lane is found once so the inner loop has no table lookup
+    const uint8_t* lane_bufs[TOTAL_CIF_INTERLEAVE];
+    for (int lane = 0; lane < TOTAL_CIF_INTERLEAVE; lane++) {
+        const int frame = (m_curr_frame - CIF_INDICES_OFFSETS[lane] + TOTAL_CIF_INTERLEAVE) % TOTAL_CIF_INTERLEAVE;
+        lane_bufs[lane] = &m_bits_buffer[size_t(frame)*N];
+    }
+    for (size_t i = 0; i < N; i++) {
+        const size_t lane = i % TOTAL_CIF_INTERLEAVE;
+        bits_out[i] = lane_bufs[lane][i];
+    }
+    m_curr_frame = (m_curr_frame+1) % TOTAL_CIF_INTERLEAVE;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "utility/span.h"
+
+// Used to interleave DAB logical frames going over a subchannel
+// This is the inverse of CIF_Deinterleaver
+// Refer to ETSI EN 300 401 Clause 12 for a detailed explanation
+// NOTE: Each bit is a byte that is 0 or 1
+class CIF_Interleaver
+{
+private:
+    std::vector<uint8_t> m_bits_buffer;
+    const int m_nb_bits;
+    int m_curr_frame = 0;
+public:
+    explicit CIF_Interleaver(const int nb_bits);
+    // Consume a logical frame of nb_bits and output the interleaved bits of the next CIF
+    // NOTE: Frames before the first consumed frame are all zeros
+    void Interleave(tcb::span<const uint8_t> bits_in, tcb::span<uint8_t> bits_out);
+    void Reset();
+};
@@ -1,6 +1,7 @@
 #include "./msc_data_group_processor.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <optional>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "../algorithms/crc.h"
@@ -25,7 +26,28 @@ static auto Generate_CRC_Calc() {
 
 static auto CRC16_CALC = Generate_CRC_Calc();
 
-MSC_Data_Group_Process_Result MSC_Data_Group_Process(tcb::span<const uint8_t> data_group) {
+void MSC_Data_Group_CRC_Accumulator::Reset() {
+    m_crc = CRC16_CALC->GetInitialValue();
+    m_nb_processed = 0;
+}
+
+void MSC_Data_Group_CRC_Accumulator::Update(tcb::span<const uint8_t> data_group) {
+    constexpr size_t CRC_SIZE = 2;
+    if (data_group.size() < (m_nb_processed + CRC_SIZE)) return;
+    const size_t nb_ready = data_group.size() - CRC_SIZE;
+    m_crc = CRC16_CALC->Update(m_crc, data_group.subspan(m_nb_processed, nb_ready-m_nb_processed));
+    m_nb_processed = nb_ready;
+}
+
+std::optional<uint16_t> MSC_Data_Group_CRC_Accumulator::Get(tcb::span<const uint8_t> data_group) const {
+    constexpr size_t CRC_SIZE = 2;
+    if (data_group.size() != (m_nb_processed + CRC_SIZE)) return std::nullopt;
+    return CRC16_CALC->Finalise(m_crc);
+}
+
+MSC_Data_Group_Process_Result MSC_Data_Group_Process(
+    tcb::span<const uint8_t> data_group, const std::optional<uint16_t> crc_precalc)
+{
     using Status = MSC_Data_Group_Process_Result::Status;
     MSC_Data_Group_Process_Result res;
 
@@ -64,7 +86,7 @@ MSC_Data_Group_Process_Result MSC_Data_Group_Process(tcb::span<const uint8_t> da
         const auto crc_data = data_group.first(data_group.size() - CRC_SIZE);
         const auto crc_buf = data_group.last(CRC_SIZE);
         const uint16_t crc_rx = (crc_buf[0] << 8) | crc_buf[1];
-        const uint16_t crc_calc = CRC16_CALC->Process(crc_data);
+        const uint16_t crc_calc = crc_precalc.has_value() ? crc_precalc.value() : CRC16_CALC->Process(crc_data);
         const bool is_crc_valid = (crc_rx == crc_calc);
         res.has_crc = true;
         res.crc_rx = crc_rx;
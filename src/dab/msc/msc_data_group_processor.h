@@ -1,8 +1,16 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <optional>
 #include "utility/span.h"
 
+// DOC: ETSI EN 300 401
+// Clause 5.3.3 Packet mode - data group level
+// Largest data group is the header, extension, session header with 15 bytes of user access fields,
+// the largest data field and the crc
+constexpr size_t MSC_DATA_GROUP_MAX_SIZE = 2+2+2+1+15+8191+2;
+
 // Decodes the data group sent over MSC (main service component)
 struct MSC_Data_Group_Process_Result {
     enum class Status {
@@ -46,4 +54,22 @@ struct MSC_Data_Group_Process_Result {
     tcb::span<const uint8_t> data_field;
 };
 
-MSC_Data_Group_Process_Result MSC_Data_Group_Process(tcb::span<const uint8_t> data_group);
\ No newline at end of file
+// Calculates the crc of a data group while it is assembled so it isn't read again once it is complete
+// The last 2 bytes are held back since they are the crc field if the group has one
+class MSC_Data_Group_CRC_Accumulator
+{
+private:
+    uint16_t m_crc;
+    size_t m_nb_processed;
+public:
+    MSC_Data_Group_CRC_Accumulator() { Reset(); }
+    void Reset();
+    // data_group is all of the group that was assembled so far
+    void Update(tcb::span<const uint8_t> data_group);
+    // Empty if data_group isn't the one that was accumulated
+    std::optional<uint16_t> Get(tcb::span<const uint8_t> data_group) const;
+};
+
+// crc_precalc is the crc from MSC_Data_Group_CRC_Accumulator so the group isn't read again to check it
+MSC_Data_Group_Process_Result MSC_Data_Group_Process(
+    tcb::span<const uint8_t> data_group, const std::optional<uint16_t> crc_precalc=std::nullopt);
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <fmt/format.h>
 #include "utility/span.h"
@@ -12,6 +13,7 @@
 #define TAG "msc-data-packet-processor"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 // DOC: ETSI EN 300 401 
@@ -42,24 +44,30 @@ enum class PacketLocation: uint8_t {
 // Table 6: Packet length
 static const size_t PACKET_LENGTH[4] = { 24, 48, 72, 96 };
 
-MSC_Data_Packet_Processor::MSC_Data_Packet_Processor() {
-    m_assembly_buffer.reserve(128);
-    m_mot_processor = std::make_unique<MOT_Processor>();
+MSC_Data_Packet_Processor::MSC_Data_Packet_Processor(std::pmr::memory_resource* memory_resource)
+: m_assembly_buffer(memory_resource)
+{
+    m_assembly_buffer.reserve(MSC_DATA_GROUP_MAX_SIZE);
+    m_mot_processor = std::make_unique<MOT_Processor>(20, 200, memory_resource);
 }
 
 MSC_Data_Packet_Processor::~MSC_Data_Packet_Processor() = default;
 
-size_t MSC_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_t> buf) {
+MSC_Data_Packet_Parse_Result MSC_Data_Packet_Parse(tcb::span<const uint8_t> buf, const bool is_check_crc) {
+    using Status = MSC_Data_Packet_Parse_Result::Status;
+    MSC_Data_Packet_Parse_Result res;
     constexpr size_t PACKET_HEADER_SIZE = 3;
     if (buf.size() < PACKET_HEADER_SIZE) {
         LOG_ERROR("Packet is too small to fit minimum non FEC header ({} < {})", buf.size(), PACKET_HEADER_SIZE);
-        return buf.size();
+        res.status = Status::SHORT_HEADER;
+        res.nb_read = buf.size();
+        return res;
     }
  
     // Figure 11: Packet structure
     const uint8_t packet_length_id   = (buf[0] & 0b11000000) >> 6;
     const uint8_t continuity_index   = (buf[0] & 0b00110000) >> 4;
-    const uint8_t _packet_location   = (buf[0] & 0b00001100) >> 2;
+    const uint8_t packet_location    = (buf[0] & 0b00001100) >> 2;
     const uint16_t address  = (uint16_t(buf[0] & 0b00000011) << 8) |
                               (uint16_t(buf[1] & 0b11111111) << 0);
     // const uint8_t command_flag       = (buf[2] & 0b10000000) >> 7;
@@ -68,7 +76,9 @@ size_t MSC_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_t> buf) {
     const size_t packet_length = PACKET_LENGTH[packet_length_id];
     if (buf.size() < packet_length) {
         LOG_ERROR("Packet length smaller than minimum specified in headers ({} < {})", buf.size(), packet_length);
-        return buf.size();
+        res.status = Status::SHORT_PACKET;
+        res.nb_read = buf.size();
+        return res;
     }
     auto packet = buf.first(packet_length);
 
@@ -76,21 +86,47 @@ size_t MSC_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_t> buf) {
     const size_t data_field_length = packet.size()-PACKET_CRC_SIZE-PACKET_HEADER_SIZE;
     if (data_field_length < useful_data_length) {
         LOG_ERROR("Packet data field length ({}) is smaller than specified useful length in headers ({})", data_field_length, useful_data_length);
-        return buf.size();
+        res.status = Status::SHORT_DATA_FIELD;
+        res.nb_read = buf.size();
+        return res;
     }
 
-    const auto crc_buf = packet.last(PACKET_CRC_SIZE);
-    const auto crc_data = packet.first(PACKET_HEADER_SIZE + data_field_length);
-    const uint16_t crc_rx = (crc_buf[0] << 8) | crc_buf[1];
-    const uint16_t crc_pred = CRC16_CALC->Process(crc_data);
-    const bool is_crc_valid = (crc_rx == crc_pred);
-    if (!is_crc_valid) {
-        LOG_MESSAGE("[crc16] is_match={} crc_pred={:04X} crc_rx={:04X}", is_crc_valid, crc_pred, crc_rx);
-        return packet_length;
+    res.nb_read = packet_length;
+    if (is_check_crc) {
+        const auto crc_buf = packet.last(PACKET_CRC_SIZE);
+        const auto crc_data = packet.first(PACKET_HEADER_SIZE + data_field_length);
+        const uint16_t crc_rx = (crc_buf[0] << 8) | crc_buf[1];
+        const uint16_t crc_pred = CRC16_CALC->Process(crc_data);
+        const bool is_crc_valid = (crc_rx == crc_pred);
+        if (!is_crc_valid) {
+            LOG_DEBUG("[crc16] is_match={} crc_pred={:04X} crc_rx={:04X}", is_crc_valid, crc_pred, crc_rx);
+            res.status = Status::CRC_INVALID;
+            return res;
+        }
+    }
+
+    res.status = Status::SUCCESS;
+    res.address = address;
+    res.continuity_index = continuity_index;
+    res.packet_location = packet_location;
+    res.packet = packet;
+    res.data_field = packet.subspan(PACKET_HEADER_SIZE, useful_data_length);
+    return res;
+}
+
+size_t MSC_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_t> buf) {
+    const auto res = MSC_Data_Packet_Parse(buf);
+    if (res.status == MSC_Data_Packet_Parse_Result::Status::SUCCESS) {
+        ProcessPacket(res);
     }
+    return res.nb_read;
+}
 
-    const auto data_field = packet.subspan(PACKET_HEADER_SIZE, useful_data_length);
-    const auto packet_location = static_cast<PacketLocation>(_packet_location);
+void MSC_Data_Packet_Processor::ProcessPacket(const MSC_Data_Packet_Parse_Result& packet) {
+    const uint16_t address = packet.address;
+    const uint8_t continuity_index = packet.continuity_index;
+    const auto data_field = packet.data_field;
+    const auto packet_location = static_cast<PacketLocation>(packet.packet_location);
  
     // Determine if we should scratch current assembly
     const uint8_t expected_continuity_index = (m_last_continuity_index+1) % 4; // mod4 counter
@@ -118,34 +154,36 @@ size_t MSC_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_t> buf) {
             ResetAssembler();
         } else {
             PushPiece(data_field);
-            HandleDataGroup(m_assembly_buffer);
+            if (m_last_address.has_value()) {
+                HandleDataGroup(m_assembly_buffer, m_assembly_crc.Get(m_assembly_buffer));
+            }
             ResetAssembler();
         }
         break;
     }
-
-    return packet_length;
 }
 
 void MSC_Data_Packet_Processor::PushPiece(tcb::span<const uint8_t> piece) {
-    const size_t old_size = m_assembly_buffer.size();
-    const size_t new_size = old_size + piece.size();
-    m_assembly_buffer.resize(new_size);
-    for (size_t i = 0; i < piece.size(); i++) {
-        size_t j = i + old_size;
-        m_assembly_buffer[j] = piece[i];
+    if ((m_assembly_buffer.size() + piece.size()) > MSC_DATA_GROUP_MAX_SIZE) {
+        LOG_ERROR("Data group exceeds maximum size ({} > {})", m_assembly_buffer.size() + piece.size(), MSC_DATA_GROUP_MAX_SIZE);
+        ResetAssembler();
+        return;
     }
+    // NOTE: Capacity was reserved for the largest data group so this never reallocates
+    m_assembly_buffer.insert(m_assembly_buffer.end(), piece.begin(), piece.end());
+    m_assembly_crc.Update(m_assembly_buffer);
     m_total_packets++;
 }
 
 void MSC_Data_Packet_Processor::ResetAssembler() {
     m_last_address = std::nullopt;
     m_total_packets = 0;
-    m_assembly_buffer.resize(0);
+    m_assembly_buffer.clear();
+    m_assembly_crc.Reset();
 }
 
-void MSC_Data_Packet_Processor::HandleDataGroup(tcb::span<const uint8_t> data_group) {
-    const auto res = MSC_Data_Group_Process(data_group);
+void MSC_Data_Packet_Processor::HandleDataGroup(tcb::span<const uint8_t> data_group, const std::optional<uint16_t> crc_precalc) {
+    const auto res = MSC_Data_Group_Process(data_group, crc_precalc);
     using Status = MSC_Data_Group_Process_Result::Status;
     if (res.status != Status::SUCCESS) {
         return;
@@ -5,26 +5,58 @@
 #include <vector>
 #include <optional>
 #include <memory>
+#include <memory_resource>
 #include "utility/span.h"
+#include "./msc_data_group_processor.h"
 
 class MOT_Processor;
 
+// DOC: ETSI EN 300 401
+// Clause: 5.3.2 Packet mode - network level
+// Reads the header of the packet at the start of a buffer so it can be routed by its address
+struct MSC_Data_Packet_Parse_Result {
+    enum class Status {
+        SUCCESS,
+        SHORT_HEADER,
+        SHORT_PACKET,
+        SHORT_DATA_FIELD,
+        CRC_INVALID,
+    };
+    Status status = Status::SUCCESS;
+    // bytes to skip to get to the next packet
+    size_t nb_read = 0;
+    uint16_t address = 0;
+    uint8_t continuity_index = 0;
+    uint8_t packet_location = 0;
+    // whole packet including its header and crc
+    tcb::span<const uint8_t> packet;
+    tcb::span<const uint8_t> data_field;
+};
+
+// A packet that was already checked can skip the crc with is_check_crc=false
+MSC_Data_Packet_Parse_Result MSC_Data_Packet_Parse(tcb::span<const uint8_t> buf, const bool is_check_crc=true);
+
+// NOTE: The internal buffers are allocated from memory_resource which must outlive the processor
+//       The assembly buffer is allocated once for the largest data group so packets are copied straight in
 class MSC_Data_Packet_Processor
 {
 private:
     std::optional<uint16_t> m_last_address = std::nullopt;
     uint8_t m_last_continuity_index = 0;
     size_t m_total_packets = 0;
-    std::vector<uint8_t> m_assembly_buffer;
+    std::pmr::vector<uint8_t> m_assembly_buffer;
+    MSC_Data_Group_CRC_Accumulator m_assembly_crc;
     std::unique_ptr<MOT_Processor> m_mot_processor;
 public:
-    MSC_Data_Packet_Processor();
+    explicit MSC_Data_Packet_Processor(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~MSC_Data_Packet_Processor();
     size_t ReadPacket(tcb::span<const uint8_t> buf);
+    // Assembles a packet that was successfully parsed by MSC_Data_Packet_Parse()
+    void ProcessPacket(const MSC_Data_Packet_Parse_Result& packet);
     MOT_Processor& Get_MOT_Processor() const { return *m_mot_processor; }
 private:
     void PushPiece(tcb::span<const uint8_t> piece);
     void ResetAssembler();
-    void HandleDataGroup(tcb::span<const uint8_t> data_group);
+    void HandleDataGroup(tcb::span<const uint8_t> data_group, const std::optional<uint16_t> crc_precalc=std::nullopt);
 };
 
@@ -2,12 +2,21 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 #include <fmt/format.h>
+#include "utility/cost_account.h"
+#include "utility/memory_usage.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 #include "./cif_deinterleaver.h"
+#include "./cif_history.h"
 #include "../algorithms/additive_scrambler.h"
+#include "../algorithms/dab_depuncture_plan.h"
+#include "../algorithms/dab_viterbi_backend.h"
 #include "../algorithms/dab_viterbi_decoder.h"
 #include "../constants/puncture_codes.h"
 #include "../constants/subchannel_protection_tables.h"
@@ -16,34 +25,68 @@
 #define TAG "msc-decoder"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 // NOTE: Capacity channel sizes for mode I are constant
 constexpr int TOTAL_CAPACITY_UNIT_BITS = 64;
 constexpr int TOTAL_CAPACITY_UNIT_BYTES = TOTAL_CAPACITY_UNIT_BITS/8;
 
-MSC_Decoder::MSC_Decoder(const Subchannel subchannel) 
+MSC_Decoder::MSC_Decoder(const Subchannel subchannel, std::pmr::memory_resource* memory_resource) 
 : m_subchannel(subchannel), 
   m_nb_encoded_bits(m_subchannel.length*TOTAL_CAPACITY_UNIT_BITS),
-  m_nb_encoded_bytes(m_subchannel.length*TOTAL_CAPACITY_UNIT_BYTES)
+  m_nb_encoded_bytes(m_subchannel.length*TOTAL_CAPACITY_UNIT_BYTES),
+  m_encoded_bits_buf(memory_resource),
+  m_decoded_bytes_buf(memory_resource),
+  m_is_byte_soft_errors(false),
+  m_byte_soft_errors_buf(memory_resource),
+  m_nb_byte_soft_errors(0),
+  m_last_error_per_bit(0.0f),
+  m_max_error_per_bit(0.0f),
+  m_batch_cif_index(0),
+  m_batch_nb_decoded_bytes(memory_resource),
+  m_batch_error_per_bit(memory_resource),
+  m_batch_decoded_bytes_buf(memory_resource),
+  m_batch_encoded_bits_buf(memory_resource),
+  m_viterbi_backend(nullptr),
+  m_next_subchannel(std::nullopt),
+  m_next_cif_index(0),
+  m_prev_start_bit(0),
+  m_relocate_cif_index(0),
+  m_layout_cif_index(0)
 {
-    m_encoded_bits_buf.resize(m_nb_encoded_bits);
-    m_decoded_bytes_buf.resize(m_nb_encoded_bytes);
+    // NOTE: Radios create a decoder for every subchannel in the ensemble even if it is never enabled
+    //       So the buffers are only allocated once the subchannel is first decoded
+    //       The private deinterleaver is also only created if we aren't using a shared CIF history
+    m_deinterleaver = nullptr;
 
-    m_deinterleaver = std::make_unique<CIF_Deinterleaver>(m_nb_encoded_bytes);
-
-    m_vitdec = std::make_unique<DAB_Viterbi_Decoder>();
-    // NOTE: The number of encoded symbols is always greater than the number of input bits
-    // TODO: Can we set this to a more conservative number to save memory?
-    m_vitdec->set_traceback_length(m_nb_encoded_bits);
-
-    m_scrambler = std::make_unique<AdditiveScrambler>();
-    m_scrambler->SetSyncword(0xFFFF);
+    m_depuncture_plan = std::make_unique<DAB_Depuncture_Plan>();
+    UpdateDepuncturePlan();
 }
 
 MSC_Decoder::~MSC_Decoder() = default;
 
+Memory_Usage MSC_Decoder::GetMemoryUsage() const {
+    Memory_Usage usage("msc_decoder");
+    usage.bytes =
+        get_memory_bytes(m_encoded_bits_buf) +
+        get_memory_bytes(m_decoded_bytes_buf) +
+        get_memory_bytes(m_byte_soft_errors_buf) +
+        get_memory_bytes(m_batch_nb_decoded_bytes) +
+        get_memory_bytes(m_batch_error_per_bit) +
+        get_memory_bytes(m_batch_decoded_bytes_buf) +
+        get_memory_bytes(m_batch_encoded_bits_buf);
+    // NOTE: Subchannels decoded from a shared CIF history don't have a private deinterleaver
+    if (m_deinterleaver != nullptr) {
+        usage.AddChild("deinterleaver", m_deinterleaver->GetMemoryBytes());
+    }
+    usage.AddChild("depuncture_plan", m_depuncture_plan->get_memory_bytes());
+    return usage;
+}
+
 tcb::span<uint8_t> MSC_Decoder::DecodeCIF(tcb::span<const viterbi_bit_t> buf) {
+    m_nb_byte_soft_errors = 0;
+    m_last_error_per_bit = 0.0f;
     const int N = (int)buf.size();
     const int start_bit = m_subchannel.start_address*TOTAL_CAPACITY_UNIT_BITS;
     const int end_bit = start_bit + m_nb_encoded_bits;
@@ -55,100 +98,340 @@ tcb::span<uint8_t> MSC_Decoder::DecodeCIF(tcb::span<const viterbi_bit_t> buf) {
 
     const int total_bits = end_bit-start_bit;
     auto subchannel_buf = buf.subspan(start_bit, total_bits);
-    m_deinterleaver->Consume(subchannel_buf);
+    AllocateBuffers();
+    if (m_deinterleaver == nullptr) {
+        m_deinterleaver = std::make_unique<CIF_Deinterleaver>(m_nb_encoded_bytes);
+    }
+    bool is_deinterleaved = false;
+    {
+        METRICS_TIME_SCOPE("dab_msc_deinterleave_seconds", "Time spent deinterleaving a subchannel for a CIF");
+        COST_STAGE_SCOPE(Cost_Stage::DEINTERLEAVE);
+        m_deinterleaver->Consume(subchannel_buf);
+        is_deinterleaved = m_deinterleaver->Deinterleave(m_encoded_bits_buf);
+    }
 
     // Deinterleaver doesn't have enough frames
-    if (!m_deinterleaver->Deinterleave(m_encoded_bits_buf)) {
+    if (!is_deinterleaved) {
         return {};
     }
 
-    // viterbi decoding
-    int nb_decoded_bytes = 0;
+    return DecodeEncodedBits();
+}
+
+void MSC_Decoder::Reconfigure(const Subchannel& subchannel, const uint64_t cif_index) {
+    m_next_subchannel = subchannel;
+    m_next_cif_index = cif_index;
+}
+
+void MSC_Decoder::UpdateLayout(const uint64_t cif_index) {
+    if (!m_next_subchannel.has_value() || (cif_index < m_next_cif_index)) {
+        return;
+    }
+
+    const Subchannel next = m_next_subchannel.value();
+    m_next_subchannel = std::nullopt;
+    const bool is_same_coding = 
+        (next.length == m_subchannel.length) &&
+        (next.is_uep == m_subchannel.is_uep) &&
+        (next.is_uep ? 
+            (next.uep_prot_index == m_subchannel.uep_prot_index) :
+            ((next.eep_prot_level == m_subchannel.eep_prot_level) && (next.eep_type == m_subchannel.eep_type)));
+
+    // DOC: ETSI EN 300 401
+    // Clause 6.5: Multiplex reconfiguration
+    // A moved subchannel keeps its time interleaving so older CIFs are read from where it used to be
+    m_prev_start_bit = m_subchannel.start_address*TOTAL_CAPACITY_UNIT_BITS;
+    m_relocate_cif_index = m_next_cif_index;
+    if (is_same_coding) {
+        m_subchannel.start_address = next.start_address;
+        return;
+    }
+
+    // Otherwise the interleaving restarts with the new layout
+    LOG_MESSAGE("Reconfigured subchannel {} at cif={} with length {}->{}", 
+        m_subchannel.id, m_next_cif_index, m_subchannel.length, next.length);
+    // FIG 0/1 doesn't carry the FEC scheme of packet mode subchannels (FIG 0/14)
+    const auto fec_scheme = m_subchannel.fec_scheme;
+    m_subchannel = next;
+    m_subchannel.fec_scheme = fec_scheme;
+    m_subchannel.is_complete = true;
+    m_nb_encoded_bits = m_subchannel.length*TOTAL_CAPACITY_UNIT_BITS;
+    m_nb_encoded_bytes = m_subchannel.length*TOTAL_CAPACITY_UNIT_BYTES;
+    // buffers and the viterbi decoder are resized the next time they are used
+    UpdateDepuncturePlan();
+    m_deinterleaver = nullptr;
+    m_batch_nb_decoded_bytes.clear();
+    m_batch_error_per_bit.clear();
+    m_relocate_cif_index = 0;
+    m_layout_cif_index = m_next_cif_index;
+}
+
+void MSC_Decoder::UpdateDepuncturePlan() {
+    m_depuncture_plan->clear();
     if (!m_subchannel.is_uep) {
-        LOG_MESSAGE("Decoding EEP");
-        nb_decoded_bytes = DecodeEEP();
+        // DOC: ETSI EN 300 401
+        // Clause 11.3.2 - Equal Error Protection (EEP) coding  
+        const auto descriptor = GetEEPDescriptor(m_subchannel);
+        const int n = m_subchannel.length / descriptor.capacity_unit_multiple;
+        for (int i = 0; i < EEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+            // NOTE: A subchannel shorter than its capacity unit multiple has negative block counts
+            const int Lx = std::max(descriptor.Lx[i].GetLx(n), 0);
+            m_depuncture_plan->append(GetPunctureCode(descriptor.PIx[i]), size_t(128*Lx));
+        }
     } else {
-        LOG_MESSAGE("Decoding UEP");
-        nb_decoded_bytes = DecodeUEP();
+        // DOC: ETSI EN 300 401
+        // Clause 11.3.1 - Unequal Error Protection (UEP) coding 
+        const auto descriptor = GetUEPDescriptor(m_subchannel);
+        for (int i = 0; i < UEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+            const int Lx = descriptor.Lx[i];
+            m_depuncture_plan->append(GetPunctureCode(descriptor.PIx[i]), size_t(128*Lx));
+        }
     }
-    return { m_decoded_bytes_buf.data(), size_t(nb_decoded_bytes) };
+    m_depuncture_plan->append(PI_X, 24);
 }
 
-int MSC_Decoder::DecodeEEP() {
-    const auto descriptor = GetEEPDescriptor(m_subchannel);
+bool MSC_Decoder::IsLayoutReady(const uint64_t cif_index) const {
+    constexpr uint64_t TOTAL_CIF_DEINTERLEAVE = 16;
+    return cif_index >= (m_layout_cif_index + TOTAL_CIF_DEINTERLEAVE-1);
+}
+
+tcb::span<uint8_t> MSC_Decoder::DecodeCIF(const CIF_History& history, const uint64_t cif_index) {
+    m_nb_byte_soft_errors = 0;
+    m_last_error_per_bit = 0.0f;
+    UpdateLayout(cif_index);
+    const int N = history.GetCIFBits();
+    const int start_bit = m_subchannel.start_address*TOTAL_CAPACITY_UNIT_BITS;
+    const int end_bit = start_bit + m_nb_encoded_bits;
+    if (end_bit > N) {
+        LOG_ERROR("Subchannel bits {}:{} overflows MSC channel with {} bits", 
+            start_bit, end_bit, N);
+        return {};
+    }
 
-    const int n = m_subchannel.length / descriptor.capacity_unit_multiple;
+    // Use the bytes from DecodeCIFBatch() if this CIF was decoded ahead of time
+    const uint64_t total_batch_cifs = uint64_t(m_batch_nb_decoded_bytes.size());
+    if ((cif_index >= m_batch_cif_index) && (cif_index < (m_batch_cif_index+total_batch_cifs))) {
+        const size_t i = size_t(cif_index-m_batch_cif_index);
+        const int nb_decoded_bytes = m_batch_nb_decoded_bytes[i];
+        if (nb_decoded_bytes >= 0) {
+            m_last_error_per_bit = m_batch_error_per_bit[i];
+            return { &m_batch_decoded_bytes_buf[i*size_t(m_nb_encoded_bytes)], size_t(nb_decoded_bytes) };
+        }
+    }
 
-    // DOC: ETSI EN 300 401
-    // Clause 11.3.2 - Equal Error Protection (EEP) coding  
-    m_vitdec->reset();
+    // History doesn't have enough frames
+    if (!IsLayoutReady(cif_index)) {
+        return {};
+    }
+    AllocateBuffers();
+    bool is_deinterleaved = false;
     {
-        size_t N;
-        auto symbols_buf = tcb::span(m_encoded_bits_buf);
-        for (int i = 0; i < EEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
-            const int Lx = descriptor.Lx[i].GetLx(n);
-            const auto puncture_code = GetPunctureCode(descriptor.PIx[i]);
-            N = m_vitdec->update(symbols_buf, puncture_code, 128*Lx);
-            symbols_buf = symbols_buf.subspan(N);
+        METRICS_TIME_SCOPE("dab_msc_deinterleave_seconds", "Time spent deinterleaving a subchannel for a CIF");
+        COST_STAGE_SCOPE(Cost_Stage::DEINTERLEAVE);
+        is_deinterleaved = CIF_Deinterleaver::Deinterleave(
+            history, cif_index, start_bit, m_prev_start_bit, m_relocate_cif_index, m_encoded_bits_buf);
+    }
+    if (!is_deinterleaved) {
+        return {};
+    }
+
+    return DecodeEncodedBits();
+}
+
+void MSC_Decoder::DecodeCIFs(const CIF_History& history, const uint64_t cif_index, const int total_cifs) {
+    if (m_viterbi_backend == nullptr) {
+        return;
+    }
+    const bool is_batched = 
+        (m_batch_cif_index == cif_index) && 
+        (m_batch_nb_decoded_bytes.size() == size_t(total_cifs));
+    if (is_batched) {
+        return;
+    }
+    // A reconfiguration at the start of the frame is applied so its CIFs can still be batched
+    UpdateLayout(cif_index);
+    MSC_Decoder* decoder = this;
+    DecodeCIFBatch(*m_viterbi_backend, { &decoder, 1 }, history, cif_index, total_cifs);
+}
+
+void MSC_Decoder::DecodeCIFBatch(
+    DAB_Viterbi_Backend& backend, tcb::span<MSC_Decoder* const> decoders,
+    const CIF_History& history, const uint64_t cif_index, const int total_cifs) 
+{
+    METRICS_TIME_SCOPE("dab_msc_batch_decode_seconds", "Time spent deinterleaving and viterbi decoding a batch of CIFs across subchannels");
+    const int N = history.GetCIFBits();
+    const int nb_tail_bits = 24/int(DAB_Depuncture_Plan::m_code_rate);
+
+    // NOTE: Decoders that aren't batched are marked with -1 and fallback to DecodeCIF()
+    //       This includes decoders with a pending reconfiguration since their layout can change between CIFs
+    for (auto* decoder: decoders) {
+        decoder->m_batch_cif_index = cif_index;
+        decoder->m_batch_nb_decoded_bytes.assign(size_t(total_cifs), -1);
+        decoder->m_batch_error_per_bit.assign(size_t(total_cifs), 0.0f);
+        decoder->m_batch_decoded_bytes_buf.resize(size_t(total_cifs)*size_t(decoder->m_nb_encoded_bytes));
+    }
+
+    // NOTE: Each worker reuses its own job lists so a steady stream of CIFs doesn't allocate
+    static thread_local std::vector<DAB_Viterbi_Job> jobs;
+    static thread_local std::vector<MSC_Decoder*> job_decoders;
+    static thread_local std::vector<int> job_cifs;
+    const size_t max_jobs = decoders.size()*size_t(total_cifs);
+    jobs.reserve(max_jobs);
+    job_decoders.reserve(max_jobs);
+    job_cifs.reserve(max_jobs);
+    jobs.clear();
+    job_decoders.clear();
+    job_cifs.clear();
+    // Each EEP subchannel deinterleaves all of its CIFs into its own buffer so the whole batch is one set of jobs
+    for (auto* decoder_ptr: decoders) {
+        auto& decoder = *decoder_ptr;
+        if (decoder.m_subchannel.is_uep || decoder.m_next_subchannel.has_value()) {
+            continue;
+        }
+        const int start_bit = decoder.m_subchannel.start_address*TOTAL_CAPACITY_UNIT_BITS;
+        const int end_bit = start_bit + decoder.m_nb_encoded_bits;
+        if (end_bit > N) {
+            continue;
+        }
+        const size_t nb_encoded_bits = size_t(decoder.m_nb_encoded_bits);
+        decoder.m_batch_encoded_bits_buf.resize(size_t(total_cifs)*nb_encoded_bits);
+        auto encoded_bits_buf = tcb::span(decoder.m_batch_encoded_bits_buf);
+
+        // History doesn't have enough frames for the first few CIFs after the subchannel was added
+        int first_cif = 0;
+        for (; first_cif < total_cifs; first_cif++) {
+            decoder.m_batch_nb_decoded_bytes[size_t(first_cif)] = 0;
+            const uint64_t first_cif_index = cif_index + uint64_t(first_cif);
+            const bool is_deinterleaved = 
+                decoder.IsLayoutReady(first_cif_index) &&
+                CIF_Deinterleaver::DeinterleaveCIFs(
+                    history, first_cif_index, total_cifs-first_cif, start_bit,
+                    decoder.m_prev_start_bit, decoder.m_relocate_cif_index, 
+                    encoded_bits_buf.subspan(size_t(first_cif)*nb_encoded_bits));
+            if (is_deinterleaved) break;
+        }
+
+        const auto& plan = *decoder.m_depuncture_plan;
+        const int curr_decoded_bit = int(plan.get_total_output_symbols()/DAB_Depuncture_Plan::m_code_rate);
+        const int nb_decoded_bits = curr_decoded_bit-nb_tail_bits;
+        const int nb_decoded_bytes = nb_decoded_bits/8;
+        for (int cif = first_cif; cif < total_cifs; cif++) {
+            DAB_Viterbi_Job job;
+            job.punctured_symbols = encoded_bits_buf.subspan(size_t(cif)*nb_encoded_bits, nb_encoded_bits);
+            job.plan = &plan;
+            job.bytes_out = tcb::span(decoder.m_batch_decoded_bytes_buf).subspan(
+                size_t(cif)*size_t(decoder.m_nb_encoded_bytes), size_t(nb_decoded_bytes));
+            jobs.push_back(job);
+            job_decoders.push_back(&decoder);
+            job_cifs.push_back(cif);
         }
-        N = m_vitdec->update(symbols_buf, PI_X, 24);
-        symbols_buf = symbols_buf.subspan(N);
-        assert(symbols_buf.size() == 0);
     }
 
+    if (jobs.empty()) {
+        return;
+    }
+
+    // NOTE: The CIFs of a subchannel are independent codewords so they fill the backend's lanes together
+    backend.Decode(jobs);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto& decoder = *job_decoders[i];
+        const auto& job = jobs[i];
+        const size_t cif = size_t(job_cifs[i]);
+        LOG_DEBUG("vitdec_error: {}", job.error);
+        decoder.Descramble(job.bytes_out);
+        decoder.m_batch_nb_decoded_bytes[cif] = int(job.bytes_out.size());
+        decoder.m_batch_error_per_bit[cif] = GetErrorPerBit(job.error, int(job.bytes_out.size()));
+    }
+}
+
+void MSC_Decoder::AllocateBuffers() {
+    if (m_encoded_bits_buf.size() == size_t(m_nb_encoded_bits)) {
+        return;
+    }
+    m_encoded_bits_buf.resize(m_nb_encoded_bits);
+    m_decoded_bytes_buf.resize(m_nb_encoded_bytes);
+}
+
+tcb::span<uint8_t> MSC_Decoder::DecodeEncodedBits() {
+    METRICS_TIME_SCOPE("dab_msc_viterbi_seconds", "Time spent viterbi decoding and descrambling a subchannel for a CIF");
+    COST_STAGE_SCOPE(Cost_Stage::VITERBI);
+    // NOTE: The number of encoded symbols is always greater than the number of input bits
+    // TODO: Can we set this to a more conservative number to save memory?
+    //       DecodeCIFBatch() avoids this by using a sliding window traceback
+    auto& vitdec = DAB_Viterbi_Decoder::borrow_thread_decoder(size_t(m_nb_encoded_bits));
+    // viterbi decoding
+    int nb_decoded_bytes = 0;
+    if (!m_subchannel.is_uep) {
+        LOG_DEBUG("Decoding EEP");
+        nb_decoded_bytes = DecodeEEP(vitdec);
+    } else {
+        LOG_DEBUG("Decoding UEP");
+        nb_decoded_bytes = DecodeUEP(vitdec);
+    }
+    return { m_decoded_bytes_buf.data(), size_t(nb_decoded_bytes) };
+}
+
+int MSC_Decoder::DecodeEEP(DAB_Viterbi_Decoder& vitdec) {
+    vitdec.reset();
+    {
+        const size_t N = vitdec.update(m_encoded_bits_buf, *m_depuncture_plan);
+        assert(N == m_encoded_bits_buf.size());
+        (void)N;
+    }
 
-    const int curr_decoded_bit = int(m_vitdec->get_current_decoded_bit());
+    const int curr_decoded_bit = int(vitdec.get_current_decoded_bit());
     const int nb_tail_bits = 24/int(DAB_Viterbi_Decoder::m_code_rate);
     const int nb_decoded_bits = curr_decoded_bit-nb_tail_bits;
     const int nb_decoded_bytes = nb_decoded_bits/8;
-    const uint64_t error = m_vitdec->chainback({m_decoded_bytes_buf.data(), (size_t)nb_decoded_bytes});
-    LOG_MESSAGE("vitdec_error: {}", error);
+    const uint64_t error = Chainback(vitdec, nb_decoded_bytes);
+    LOG_DEBUG("vitdec_error: {}", error);
+    m_last_error_per_bit = GetErrorPerBit(error, nb_decoded_bytes);
 
     // descrambler
-    m_scrambler->Reset();
-    for (int i = 0; i < nb_decoded_bytes; i++) {
-        uint8_t b = m_scrambler->Process();
-        m_decoded_bytes_buf[i] ^= b;
-    }
+    Descramble({ m_decoded_bytes_buf.data(), size_t(nb_decoded_bytes) });
 
     return nb_decoded_bytes;
 }
 
 // TODO: We don't have any samples to test if UEP decoding works
-int MSC_Decoder::DecodeUEP() {
-    const auto descriptor = GetUEPDescriptor(m_subchannel);
-
-    // DOC: ETSI EN 300 401
-    // Clause 11.3.1 - Unequal Error Protection (UEP) coding 
-    m_vitdec->reset();
-    {
-        size_t N = 0u;
-        auto symbols_buf = tcb::span(m_encoded_bits_buf);
-        for (int i = 0; i < UEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
-            const int Lx = descriptor.Lx[i];
-            const auto puncture_code = GetPunctureCode(descriptor.PIx[i]);
-            N = m_vitdec->update(symbols_buf, puncture_code, 128*Lx);
-            symbols_buf = symbols_buf.subspan(N);
-        }
-        N = m_vitdec->update(symbols_buf, PI_X, 24);
-        symbols_buf = symbols_buf.subspan(N);
-    }
+int MSC_Decoder::DecodeUEP(DAB_Viterbi_Decoder& vitdec) {
+    // NOTE: Any padding bits after the tail aren't part of the plan
+    vitdec.reset();
+    vitdec.update(m_encoded_bits_buf, *m_depuncture_plan);
 
-    const int curr_decoded_bit = int(m_vitdec->get_current_decoded_bit());
+    const int curr_decoded_bit = int(vitdec.get_current_decoded_bit());
     const int nb_tail_bits = 24/int(DAB_Viterbi_Decoder::m_code_rate);
     // const int nb_padding_bits = (int)descriptor.total_padding_bits;
     const int nb_decoded_bits = curr_decoded_bit-nb_tail_bits;
     assert(nb_decoded_bits % 8 == 0);
     const int nb_decoded_bytes = nb_decoded_bits/8;
-    const uint64_t error = m_vitdec->chainback({m_decoded_bytes_buf.data(), (size_t)nb_decoded_bytes});
-    LOG_MESSAGE("vitdec_error: {}", error);
+    const uint64_t error = Chainback(vitdec, nb_decoded_bytes);
+    LOG_DEBUG("vitdec_error: {}", error);
+    m_last_error_per_bit = GetErrorPerBit(error, nb_decoded_bytes);
 
     // descrambler
-    m_scrambler->Reset();
-    for (int i = 0; i < nb_decoded_bytes; i++) {
-        uint8_t b = m_scrambler->Process();
-        m_decoded_bytes_buf[i] ^= b;
-    }
+    Descramble({ m_decoded_bytes_buf.data(), size_t(nb_decoded_bytes) });
 
     return nb_decoded_bytes;
+}
+
+uint64_t MSC_Decoder::Chainback(DAB_Viterbi_Decoder& vitdec, const int nb_decoded_bytes) {
+    auto decoded_bytes = tcb::span(m_decoded_bytes_buf).first(size_t(nb_decoded_bytes));
+    if (!m_is_byte_soft_errors) {
+        return vitdec.chainback(decoded_bytes);
+    }
+    m_byte_soft_errors_buf.resize(m_decoded_bytes_buf.size());
+    m_nb_byte_soft_errors = size_t(nb_decoded_bytes);
+    auto byte_soft_errors = tcb::span(m_byte_soft_errors_buf).first(m_nb_byte_soft_errors);
+    return vitdec.chainback(decoded_bytes, byte_soft_errors);
+}
+
+float MSC_Decoder::GetErrorPerBit(const uint64_t error, const int nb_decoded_bytes) {
+    if (nb_decoded_bytes <= 0) return 0.0f;
+    const double nb_decoded_bits = double(nb_decoded_bytes)*8.0;
+    return float(double(error) / (nb_decoded_bits*double(SOFT_DECISION_VITERBI_HIGH)));
+}
+
+void MSC_Decoder::Descramble(tcb::span<uint8_t> decoded_bytes) {
+    apply_energy_dispersal_auto(decoded_bytes);
 }
\ No newline at end of file
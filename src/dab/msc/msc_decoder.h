@@ -1,38 +1,121 @@
 #pragma once
 
 #include <stdint.h>
-#include <vector>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
 #include "../database/dab_database_entities.h"
+#include "utility/memory_usage.h"
 #include "utility/span.h"
 #include "viterbi_config.h"
 
 class CIF_Deinterleaver;
+class CIF_History;
 class DAB_Viterbi_Decoder;
-class AdditiveScrambler;
+class DAB_Viterbi_Backend;
+class DAB_Depuncture_Plan;
 
 // Is associated with a subchannel residing inside the CIF (common interleaved frame)
 // Performs deinterleaving and decoding on that subchannel
+// NOTE: The internal buffers are allocated from memory_resource which must outlive the decoder
 class MSC_Decoder 
 {
 private:
-    const Subchannel m_subchannel;
+    Subchannel m_subchannel;
     // Internal buffers
-    const int m_nb_encoded_bits;
-    const int m_nb_encoded_bytes;
-    std::vector<viterbi_bit_t> m_encoded_bits_buf;
-    std::vector<uint8_t> m_decoded_bytes_buf;
-    // Decoders and deinterleavers
+    int m_nb_encoded_bits;
+    int m_nb_encoded_bytes;
+    std::pmr::vector<viterbi_bit_t> m_encoded_bits_buf;
+    std::pmr::vector<uint8_t> m_decoded_bytes_buf;
+    // Reliability of the last decoded bytes for erasure decoding by an outer code
+    bool m_is_byte_soft_errors;
+    std::pmr::vector<uint16_t> m_byte_soft_errors_buf;
+    size_t m_nb_byte_soft_errors;
+    // Viterbi error of the last decoded bytes and the threshold above which they are unreliable
+    float m_last_error_per_bit;
+    float m_max_error_per_bit;
+    // Deinterleaver and the viterbi decoder borrowed from the decoding thread for each CIF
     std::unique_ptr<CIF_Deinterleaver> m_deinterleaver;
-    std::unique_ptr<DAB_Viterbi_Decoder> m_vitdec;
-    std::unique_ptr<AdditiveScrambler> m_scrambler;
+    // Puncture codes of the protection profile flattened once per layout
+    std::unique_ptr<DAB_Depuncture_Plan> m_depuncture_plan;
+    // Bytes decoded ahead of time by DecodeCIFBatch() for each CIF starting at m_batch_cif_index
+    uint64_t m_batch_cif_index;
+    std::pmr::vector<int> m_batch_nb_decoded_bytes;
+    std::pmr::vector<float> m_batch_error_per_bit;
+    std::pmr::vector<uint8_t> m_batch_decoded_bytes_buf;
+    // Deinterleaved bits of each CIF in the batch so they can all be viterbi decoded in one call
+    std::pmr::vector<viterbi_bit_t> m_batch_encoded_bits_buf;
+    // Backend used by DecodeCIFs() which is disabled if this is nullptr
+    std::shared_ptr<DAB_Viterbi_Backend> m_viterbi_backend;
+    // Multiplex reconfiguration where the next layout is used from m_next_cif_index onwards
+    std::optional<Subchannel> m_next_subchannel;
+    uint64_t m_next_cif_index;
+    // A moved subchannel reads CIFs before m_relocate_cif_index from its previous start address
+    int m_prev_start_bit;
+    uint64_t m_relocate_cif_index;
+    // A subchannel with a new size or protection can't use CIFs from before m_layout_cif_index
+    uint64_t m_layout_cif_index;
 public:
-    explicit MSC_Decoder(const Subchannel subchannel);
+    explicit MSC_Decoder(
+        const Subchannel subchannel,
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~MSC_Decoder();
     // Returns the number of bytes decoded
     // NOTE: the number of bytes decoded can be 0 if the deinterleaver is still collecting frames
     tcb::span<uint8_t> DecodeCIF(tcb::span<const viterbi_bit_t> buf);
+    // Same as above except the subchannel is read in place from an ensemble wide history of CIFs
+    // This avoids keeping a private copy of the last 16 CIFs for each subchannel
+    tcb::span<uint8_t> DecodeCIF(const CIF_History& history, const uint64_t cif_index);
+    // Decodes the EEP subchannels of many decoders together as one set of jobs for all CIFs
+    // The decoded bytes are kept by each decoder and returned by DecodeCIF() for the same CIFs
+    // NOTE: UEP subchannels are skipped and decoded as usual when DecodeCIF() is called
+    static void DecodeCIFBatch(
+        DAB_Viterbi_Backend& backend, tcb::span<MSC_Decoder* const> decoders,
+        const CIF_History& history, const uint64_t cif_index, const int total_cifs);
+    // Decodes the total_cifs CIFs of a frame starting at cif_index ahead of DecodeCIF() with the viterbi backend
+    // The CIFs are deinterleaved in one pass and their trellises are decoded side by side in the backend's lanes
+    // NOTE: This does nothing if there isn't a backend or if the CIFs were already decoded by DecodeCIFBatch()
+    void DecodeCIFs(const CIF_History& history, const uint64_t cif_index, const int total_cifs);
+    // Bytes decoded ahead of time have no soft errors, see SetIsByteSoftErrors()
+    // NOTE: nullptr disables DecodeCIFs() which is the default
+    void SetViterbiBackend(std::shared_ptr<DAB_Viterbi_Backend> backend) { m_viterbi_backend = std::move(backend); }
+    const Subchannel& GetSubchannel() const { return m_subchannel; }
+    // Switch to a new layout at the CIF signalled by a multiplex reconfiguration
+    // If only the start address changes the deinterleaving history is kept
+    // otherwise nothing is decoded until 16 CIFs with the new layout are available
+    // NOTE: This is only supported when decoding from a shared CIF history
+    void Reconfigure(const Subchannel& subchannel, const uint64_t cif_index);
+    // Returns nullptr if there isn't a pending reconfiguration
+    const Subchannel* GetNextSubchannel() const { return m_next_subchannel.has_value() ? &(m_next_subchannel.value()) : nullptr; }
+    // Keep the soft error of each byte returned by DecodeCIF() (higher is less reliable)
+    // NOTE: Bytes decoded ahead of time by DecodeCIFBatch() have no soft errors
+    void SetIsByteSoftErrors(const bool is_byte_soft_errors) { m_is_byte_soft_errors = is_byte_soft_errors; }
+    // Empty if the bytes from the last DecodeCIF() have no soft errors
+    tcb::span<const uint16_t> GetByteSoftErrors() const { return { m_byte_soft_errors_buf.data(), m_nb_byte_soft_errors }; }
+    // Viterbi path error of the bytes from the last DecodeCIF() averaged over each decoded bit
+    // This is in units of a full scale soft decision, so a clean signal is close to 0 and noise is a few units
+    // NOTE: This is 0 if no bytes were decoded
+    float GetLastErrorPerBit() const { return m_last_error_per_bit; }
+    // Bytes from DecodeCIF() with a higher error per bit are still returned but are marked as unreliable
+    // so the caller can skip outer decoding (reed solomon, audio codecs) that would only be wasted on noise
+    // NOTE: 0 disables this, which is the default
+    void SetMaxErrorPerBit(const float max_error_per_bit) { m_max_error_per_bit = max_error_per_bit; }
+    float GetMaxErrorPerBit() const { return m_max_error_per_bit; }
+    bool GetIsLastUnreliable() const { return (m_max_error_per_bit > 0.0f) && (m_last_error_per_bit > m_max_error_per_bit); }
+    // Buffers of the decoder along with its private deinterleaver history
+    // NOTE: These are only allocated once the subchannel is first decoded
+    //       The viterbi decisions belong to the decoding threads, refer to DAB_Viterbi_Decoder::borrow_thread_decoder()
+    Memory_Usage GetMemoryUsage() const;
 private:
-    int DecodeEEP();
-    int DecodeUEP();
+    void UpdateLayout(const uint64_t cif_index);
+    void UpdateDepuncturePlan();
+    bool IsLayoutReady(const uint64_t cif_index) const;
+    void AllocateBuffers();
+    tcb::span<uint8_t> DecodeEncodedBits();
+    uint64_t Chainback(DAB_Viterbi_Decoder& vitdec, const int nb_decoded_bytes);
+    static float GetErrorPerBit(const uint64_t error, const int nb_decoded_bytes);
+    int DecodeEEP(DAB_Viterbi_Decoder& vitdec);
+    int DecodeUEP(DAB_Viterbi_Decoder& vitdec);
+    void Descramble(tcb::span<uint8_t> decoded_bytes);
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "./msc_encoder.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "utility/span.h"
+#include "./cif_interleaver.h"
+#include "../algorithms/additive_scrambler.h"
+#include "../algorithms/dab_convolutional_encoder.h"
+#include "../constants/puncture_codes.h"
+#include "../constants/subchannel_protection_tables.h"
+#include "../database/dab_database_entities.h"
+
+// NOTE: Capacity channel sizes for mode I are constant
+constexpr int TOTAL_CAPACITY_UNIT_BITS = 64;
+
+MSC_Encoder::MSC_Encoder(const Subchannel subchannel)
+: m_subchannel(subchannel),
+  m_nb_encoded_bits(m_subchannel.length*TOTAL_CAPACITY_UNIT_BITS),
+  m_nb_decoded_bytes(GetNbDecodedBytes(subchannel))
+{
+    m_scrambled_bytes_buf.resize(size_t(m_nb_decoded_bytes));
+    m_encoded_bits_buf.resize(size_t(m_nb_encoded_bits), 0);
+    m_encoder = std::make_unique<DAB_Convolutional_Encoder>();
+    m_interleaver = std::make_unique<CIF_Interleaver>(m_nb_encoded_bits);
+}
+
+MSC_Encoder::~MSC_Encoder() = default;
+
+int MSC_Encoder::GetNbDecodedBytes(const Subchannel& subchannel) {
+    int total_blocks = 0;
+    if (subchannel.is_uep) {
+        const auto descriptor = GetUEPDescriptor(subchannel);
+        for (int i = 0; i < UEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+            total_blocks += int(descriptor.Lx[i]);
+        }
+    } else {
+        const auto descriptor = GetEEPDescriptor(subchannel);
+        const int n = subchannel.length / descriptor.capacity_unit_multiple;
+        for (int i = 0; i < EEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+            total_blocks += std::max(descriptor.Lx[i].GetLx(n), 0);
+        }
+    }
+    return total_blocks*32/8;
+}
+
+void MSC_Encoder::Reset() {
+    m_interleaver->Reset();
+}
+
+bool MSC_Encoder::EncodeCIF(tcb::span<const uint8_t> logical_frame, tcb::span<uint8_t> cif_bits_out) {
+    if (logical_frame.size() != size_t(m_nb_decoded_bytes)) {
+        return false;
+    }
+    if (cif_bits_out.size() != size_t(m_nb_encoded_bits)) {
+        return false;
+    }
+
+    // DOC: ETSI EN 300 401
+    // Clause 10 - Energy dispersal
+    std::copy(logical_frame.begin(), logical_frame.end(), m_scrambled_bytes_buf.begin());
+    apply_energy_dispersal_auto(m_scrambled_bytes_buf);
+
+    m_encoder->encode(m_scrambled_bytes_buf);
+    if (m_subchannel.is_uep) {
+        EncodeUEP();
+    } else {
+        EncodeEEP();
+    }
+    assert(m_encoder->is_finished());
+
+    m_interleaver->Interleave(m_encoded_bits_buf, cif_bits_out);
+    return true;
+}
+
+void MSC_Encoder::EncodeEEP() {
+    // DOC: ETSI EN 300 401
+    // Clause 11.3.2 - Equal Error Protection (EEP) coding
+    const auto descriptor = GetEEPDescriptor(m_subchannel);
+    const int n = m_subchannel.length / descriptor.capacity_unit_multiple;
+    auto bits_out = tcb::span(m_encoded_bits_buf);
+    for (int i = 0; i < EEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+        const int Lx = std::max(descriptor.Lx[i].GetLx(n), 0);
+        const size_t N = m_encoder->puncture(GetPunctureCode(descriptor.PIx[i]), size_t(128*Lx), bits_out);
+        bits_out = bits_out.subspan(N);
+    }
+    // NOTE: A subchannel shorter than its capacity unit multiple leaves padding
+    const size_t N = m_encoder->puncture(PI_X, 24, bits_out);
+    bits_out = bits_out.subspan(N);
+    std::fill(bits_out.begin(), bits_out.end(), uint8_t(0));
+}
+
+void MSC_Encoder::EncodeUEP() {
+    // DOC: ETSI EN 300 401
+    // Clause 11.3.1 - Unequal Error Protection (UEP) coding
+    // UEP profiles may be shorter than the subchannel so the remainder is left as padding
+    const auto descriptor = GetUEPDescriptor(m_subchannel);
+    auto bits_out = tcb::span(m_encoded_bits_buf);
+    for (int i = 0; i < UEP_Descriptor::TOTAL_PUNCTURE_CODES; i++) {
+        const int Lx = descriptor.Lx[i];
+        const size_t N = m_encoder->puncture(GetPunctureCode(descriptor.PIx[i]), size_t(128*Lx), bits_out);
+        bits_out = bits_out.subspan(N);
+    }
+    const size_t N = m_encoder->puncture(PI_X, 24, bits_out);
+    bits_out = bits_out.subspan(N);
+    std::fill(bits_out.begin(), bits_out.end(), uint8_t(0));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "../database/dab_database_entities.h"
+#include "utility/span.h"
+
+class CIF_Interleaver;
+class DAB_Convolutional_Encoder;
+
+// Is associated with a subchannel residing inside the CIF (common interleaved frame)
+// Performs energy dispersal, convolutional encoding, puncturing and time interleaving on that subchannel
+// This is the inverse of MSC_Decoder
+// NOTE: Each encoded bit is a byte that is 0 or 1
+class MSC_Encoder
+{
+private:
+    Subchannel m_subchannel;
+    int m_nb_encoded_bits;
+    int m_nb_decoded_bytes;
+    // Internal buffers
+    std::vector<uint8_t> m_scrambled_bytes_buf;
+    std::vector<uint8_t> m_encoded_bits_buf;
+    std::unique_ptr<DAB_Convolutional_Encoder> m_encoder;
+    std::unique_ptr<CIF_Interleaver> m_interleaver;
+public:
+    explicit MSC_Encoder(const Subchannel subchannel);
+    ~MSC_Encoder();
+    // Encodes a logical frame of GetNbDecodedBytes() into the GetNbEncodedBits() bits of the subchannel in this CIF
+    // Returns false if the buffer sizes don't match
+    // NOTE: The first 15 CIFs carry zeros in place of the logical frames before the first one
+    bool EncodeCIF(tcb::span<const uint8_t> logical_frame, tcb::span<uint8_t> cif_bits_out);
+    // Clears the time interleaving history
+    void Reset();
+    const Subchannel& GetSubchannel() const { return m_subchannel; }
+    int GetNbDecodedBytes() const { return m_nb_decoded_bytes; }
+    int GetNbEncodedBits() const { return m_nb_encoded_bits; }
+    // DOC: ETSI EN 300 401
+    // Clause 11.3 - Coding in the main service channel
+    // Each 128 mother bits that are punctured carry 32 bits of data
+    static int GetNbDecodedBytes(const Subchannel& subchannel);
+private:
+    void EncodeEEP();
+    void EncodeUEP();
+};
@@ -2,15 +2,20 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <fmt/format.h>
+#include "utility/cost_account.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
 #include "../algorithms/reed_solomon_decoder.h"
 #include "../dab_logging.h"
 #define TAG "msc-reed-solomon-data-packet-processor"
 static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
+#define LOG_DEBUG(...) DAB_LOG_DEBUG(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 // ETSI EN 300 401
@@ -34,14 +39,18 @@ static constexpr size_t TOTAL_FEC_PACKETS = 9;
 static constexpr size_t FEC_PACKET_HEADER_SIZE = 2;
 static constexpr size_t FEC_PACKET_DATA_FIELD_SIZE = FEC_PACKET_LENGTH-FEC_PACKET_HEADER_SIZE;
 static constexpr size_t FEC_PACKET_PADDING_SIZE = 6;
-static constexpr size_t TOTAL_RING_BUFFER_SIZE = APPLICATION_DATA_TABLE_SIZE + FEC_PACKET_LENGTH*TOTAL_FEC_PACKETS;
+static constexpr size_t TOTAL_FEC_FRAME_SIZE = APPLICATION_DATA_TABLE_SIZE + FEC_PACKET_LENGTH*TOTAL_FEC_PACKETS;
 static_assert(RS_DATA_TABLE_SIZE == (FEC_PACKET_DATA_FIELD_SIZE*TOTAL_FEC_PACKETS - FEC_PACKET_PADDING_SIZE));
+static_assert(RS_DATA_TABLE_SIZE == RS_PARITY_BYTES*RS_TOTAL_ROWS);
+// Packets are only moved back to the start of the buffer once they reach the end of this
+// which only happens if FEC packets go missing and old packets are discarded
+static constexpr size_t TOTAL_FRAME_BUFFER_SIZE = 2*TOTAL_FEC_FRAME_SIZE;
 
 MSC_Reed_Solomon_Data_Packet_Processor::MSC_Reed_Solomon_Data_Packet_Processor() {
     m_rs_encoded_buf.resize(RS_MESSAGE_BYTES);
     m_rs_error_positions.resize(RS_PARITY_BYTES);
-    m_rs_data_table.resize(RS_DATA_TABLE_SIZE);
-    m_ring_buf.resize(TOTAL_RING_BUFFER_SIZE);
+    m_rs_is_clean.resize(RS_TOTAL_ROWS);
+    m_frame_buf.resize(TOTAL_FRAME_BUFFER_SIZE);
     // ETSI EN 300 401
     // Clause: 5.3.5.1 FEC frame
     // P(x) = x^8 + x^4 + x^3 + x^2 + 1
@@ -81,7 +90,7 @@ size_t MSC_Reed_Solomon_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_
     }
 
     auto packet = buf.first(packet_length);
-    PushIntoRingBuffer(packet, packet_length_id);
+    PushPacket(packet, packet_length_id);
     if (!is_fec_packet) {
         return packet_length;
     }
@@ -100,7 +109,7 @@ size_t MSC_Reed_Solomon_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_
     // Eject all packets and skip correction
     if (is_fec_invalid) {
         m_last_counter = std::nullopt;
-        ClearRingBuffer();
+        ClearPackets();
         return packet_length;
     }
 
@@ -110,119 +119,105 @@ size_t MSC_Reed_Solomon_Data_Packet_Processor::ReadPacket(tcb::span<const uint8_
     }
 
     // All FEC packets are stored check if we can perform decoding
-    if (m_ring_size != TOTAL_RING_BUFFER_SIZE) {
-        ClearRingBuffer();
+    if ((m_frame_end-m_frame_start) != TOTAL_FEC_FRAME_SIZE) {
+        ClearPackets();
     } else {
         PerformReedSolomonCorrection();
     }
     m_last_counter = std::nullopt;
-    ResetRingBuffer();
+    ResetFrame();
     return packet_length;
 }
 
-void MSC_Reed_Solomon_Data_Packet_Processor::ClearRingBuffer() {
-    while (true) {
-        auto stored_packet = PopRingBuffer();
-        if (stored_packet.empty()) break;
-        if (m_callback != nullptr) m_callback(stored_packet, false);
+void MSC_Reed_Solomon_Data_Packet_Processor::ClearPackets() {
+    EmitPackets(m_frame_end-m_frame_start, false);
+    assert(m_frame_start == m_frame_end);
+}
+
+void MSC_Reed_Solomon_Data_Packet_Processor::EmitPackets(const size_t nb_bytes, const bool is_corrected) {
+    size_t total_read = 0;
+    while ((total_read < nb_bytes) && (m_frame_start < m_frame_end)) {
+        const uint8_t header = m_frame_buf[m_frame_start];
+        const uint8_t packet_length_id = (header & 0b11000000) >> 6;
+        const size_t packet_length = PACKET_LENGTH[packet_length_id];
+        assert((m_frame_end-m_frame_start) >= packet_length);
+        const auto packet = tcb::span<const uint8_t>(&m_frame_buf[m_frame_start], packet_length);
+        m_frame_start += packet_length;
+        total_read += packet_length;
+        if (m_callback != nullptr) m_callback(packet, is_corrected);
     }
-    assert(m_ring_size == 0);
 }
 
-void MSC_Reed_Solomon_Data_Packet_Processor::PushIntoRingBuffer(tcb::span<const uint8_t> packet, uint8_t packet_length_id) {
+void MSC_Reed_Solomon_Data_Packet_Processor::PushPacket(tcb::span<const uint8_t> packet, uint8_t packet_length_id) {
     const size_t packet_length = PACKET_LENGTH[packet_length_id];
     assert(packet.size() == packet_length);
     // Free up last packet/s to make room for new packet
-    while (true) {
-        const size_t total_free = m_ring_buf.size() - m_ring_size;
-        if (total_free >= packet_length) break;
-        const uint8_t other_header = m_ring_buf[m_ring_read_head];
+    while ((m_frame_end-m_frame_start) + packet_length > TOTAL_FEC_FRAME_SIZE) {
+        const uint8_t other_header = m_frame_buf[m_frame_start];
         const uint8_t other_packet_length_id = (other_header & 0b11000000) >> 6;
         const size_t other_packet_length = PACKET_LENGTH[other_packet_length_id];
-        assert(m_ring_size >= other_packet_length);
-        m_ring_size -= other_packet_length;
-        m_ring_read_head = (m_ring_read_head+other_packet_length) % m_ring_buf.size();
-        m_ring_total_bytes_discarded += other_packet_length;
-        m_ring_total_packets_discarded++;
+        assert((m_frame_end-m_frame_start) >= other_packet_length);
+        m_frame_start += other_packet_length;
+        m_total_bytes_discarded += other_packet_length;
+        m_total_packets_discarded++;
     }
- 
-    // override with correct packet length if we want to ignore the source which can be corrupted
-    uint8_t header = packet[0];
-    header = (header & 0b00111111) | ((packet_length_id & 0b11) << 6);
-    m_ring_buf[m_ring_write_head] = header;
-    for (size_t i = 1; i < packet_length; i++) {
-        const size_t j = (m_ring_write_head+i) % m_ring_buf.size();
-        m_ring_buf[j] = packet[i];
+    if (m_frame_end + packet_length > m_frame_buf.size()) {
+        const size_t nb_stored = m_frame_end-m_frame_start;
+        memmove(m_frame_buf.data(), m_frame_buf.data() + m_frame_start, nb_stored);
+        m_frame_start = 0;
+        m_frame_end = nb_stored;
     }
-    m_ring_size += packet_length;
-    m_ring_write_head = (m_ring_write_head+packet_length) % m_ring_buf.size();
-}
-
-tcb::span<const uint8_t> MSC_Reed_Solomon_Data_Packet_Processor::PopRingBuffer() {
-    if (m_ring_size == 0) return {};
-    const uint8_t header = m_ring_buf[m_ring_read_head];
-    const uint8_t packet_length_id = (header & 0b11000000) >> 6;
-    const size_t packet_length = PACKET_LENGTH[packet_length_id];
-    assert(m_ring_size >= packet_length);
 
-    m_pop_buf.resize(packet_length);
-    for (size_t i = 0; i < packet_length; i++) {
-        const size_t j = (m_ring_read_head+i) % m_ring_buf.size();
-        m_pop_buf[i] = m_ring_buf[j];
-    }
-    m_ring_size -= packet_length;
-    m_ring_read_head = (m_ring_read_head+packet_length) % m_ring_buf.size();
-    return m_pop_buf;
+    uint8_t* dst = &m_frame_buf[m_frame_end];
+    std::copy_n(packet.begin(), packet_length, dst);
+    // override with correct packet length if we want to ignore the source which can be corrupted
+    dst[0] = (dst[0] & 0b00111111) | ((packet_length_id & 0b11) << 6);
+    m_frame_end += packet_length;
 }
 
-void MSC_Reed_Solomon_Data_Packet_Processor::ResetRingBuffer() {
-    m_ring_read_head = 0;
-    m_ring_write_head = 0;
-    m_ring_size = 0;
-    m_ring_total_bytes_discarded = 0;
-    m_ring_total_packets_discarded = 0;
+void MSC_Reed_Solomon_Data_Packet_Processor::ResetFrame() {
+    m_frame_start = 0;
+    m_frame_end = 0;
+    m_total_bytes_discarded = 0;
+    m_total_packets_discarded = 0;
 }
 
 void MSC_Reed_Solomon_Data_Packet_Processor::PerformReedSolomonCorrection() {
-    assert(m_ring_size == TOTAL_RING_BUFFER_SIZE);
+    METRICS_TIME_SCOPE("dab_msc_packet_reed_solomon_seconds", "Time spent reed solomon decoding a FEC packet set");
+    COST_STAGE_SCOPE(Cost_Stage::OUTER_CODE);
+    assert((m_frame_end-m_frame_start) == TOTAL_FEC_FRAME_SIZE);
+    uint8_t* frame = &m_frame_buf[m_frame_start];
 
     // Figure 17: Complete FEC packet set
+    // Remove the headers from the FEC packets in place so the RS data table directly follows the application data table
+    // NOTE: Each data field moves to a lower address than any data field after it so they don't overwrite each other
+    uint8_t* rs_data_table = frame + APPLICATION_DATA_TABLE_SIZE;
     for (size_t i = 0; i < TOTAL_FEC_PACKETS; i++) {
-        // Remove header from FEC packets
-        const size_t i_ring = m_ring_read_head + APPLICATION_DATA_TABLE_SIZE + i*FEC_PACKET_LENGTH + FEC_PACKET_HEADER_SIZE;
-        const size_t i_table = i*FEC_PACKET_DATA_FIELD_SIZE;
- 
+        const uint8_t* data_field = rs_data_table + i*FEC_PACKET_LENGTH + FEC_PACKET_HEADER_SIZE;
         size_t data_field_size = FEC_PACKET_DATA_FIELD_SIZE;
-        // Figure 17: Complete FEC packet set
         // Last FEC packet has 6 padding bytes which we ignore
         if (i == (TOTAL_FEC_PACKETS-1)) {
-            constexpr size_t TOTAL_PADDING_BYTES = 6;
-            data_field_size = (FEC_PACKET_DATA_FIELD_SIZE-TOTAL_PADDING_BYTES);
-        }
-        for (size_t j = 0; j < data_field_size; j++) {
-            const size_t j_ring = (i_ring+j) % m_ring_buf.size();
-            m_rs_data_table[i_table+j] = m_ring_buf[j_ring];
+            data_field_size = (FEC_PACKET_DATA_FIELD_SIZE-FEC_PACKET_PADDING_SIZE);
         }
+        memmove(rs_data_table + i*FEC_PACKET_DATA_FIELD_SIZE, data_field, data_field_size);
     }
 
     // Figure 15: Structure of FEC frame
+    // Byte x of row y is at frame[x*RS_TOTAL_ROWS + y] for both tables
+    // Most rows are error free so they are found together without running the full decoder
+    m_rs_decoder->FindCleanCodewords(frame, RS_TOTAL_ROWS, m_rs_is_clean);
     for (size_t y = 0; y < RS_TOTAL_ROWS; y++) {
-        // Read application data table (transform from ring row-wise to table column-wise)
-        for (size_t i = 0; i < RS_DATA_BYTES; i++) {
-            const size_t x = i;
-            const size_t i_offset = i*RS_TOTAL_ROWS + y;
-            const size_t i_ring = (m_ring_read_head + i_offset) % m_ring_buf.size();
-            m_rs_encoded_buf[x] = m_ring_buf[i_ring];
+        if (m_rs_is_clean[y]) {
+            LOG_DEBUG("[reed-solomon] row={}/{} error_count=0", y, RS_TOTAL_ROWS);
+            continue;
         }
-        // Read rs data table (transform from ring row-wise to table column-wise)
-        for (size_t i = 0; i < RS_PARITY_BYTES; i++) {
-            const size_t x = RS_DATA_BYTES + i;
-            const size_t i_offset = i*RS_TOTAL_ROWS + y;
-            m_rs_encoded_buf[x] = m_rs_data_table[i_offset];
+        // Read row from the column-wise tables
+        for (size_t x = 0; x < RS_MESSAGE_BYTES; x++) {
+            m_rs_encoded_buf[x] = frame[x*RS_TOTAL_ROWS + y];
         }
 
         const int error_count = m_rs_decoder->Decode(m_rs_encoded_buf.data(), m_rs_error_positions.data(), 0);
-        LOG_MESSAGE("[reed-solomon] row={}/{} error_count={}", y, RS_TOTAL_ROWS, error_count);
+        LOG_DEBUG("[reed-solomon] row={}/{} error_count={}", y, RS_TOTAL_ROWS, error_count);
         // rs decoder returns -1 to indicate too many errors
         if (error_count < 0) {
             LOG_ERROR("[reed-solomon] Too many errors to correct");
@@ -239,20 +234,12 @@ void MSC_Reed_Solomon_Data_Packet_Processor::PerformReedSolomonCorrection() {
             }
             // correct data packets
             if (x_err < int(RS_DATA_BYTES)) {
-                const size_t i_offset = size_t(x_err)*RS_TOTAL_ROWS + y;
-                const size_t i_ring = (m_ring_read_head + i_offset) % m_ring_buf.size();
-                m_ring_buf[i_ring] = m_rs_encoded_buf[size_t(x_err)]; 
+                frame[size_t(x_err)*RS_TOTAL_ROWS + y] = m_rs_encoded_buf[size_t(x_err)]; 
             }
             // dont correct fec packets they aren't used for anything else
         }
     }
 
-    size_t total_read = 0;
-    while (total_read < APPLICATION_DATA_TABLE_SIZE) {
-        auto buf = PopRingBuffer();
-        if (buf.empty()) break;
-        if (m_callback != nullptr) m_callback(buf, true);
-        total_read += buf.size();
-    }
-    assert(total_read == APPLICATION_DATA_TABLE_SIZE);
+    // the FEC packets were overwritten above so only the corrected data packets are passed on
+    EmitPackets(APPLICATION_DATA_TABLE_SIZE, true);
 }
@@ -19,14 +19,14 @@ public:
 private:
     std::vector<uint8_t> m_rs_encoded_buf;
     std::vector<int> m_rs_error_positions;
-    std::vector<uint8_t> m_rs_data_table;
-    std::vector<uint8_t> m_pop_buf;
-    std::vector<uint8_t> m_ring_buf;
-    size_t m_ring_read_head = 0;
-    size_t m_ring_write_head = 0;
-    size_t m_ring_size = 0;
-    size_t m_ring_total_bytes_discarded = 0;
-    size_t m_ring_total_packets_discarded = 0;
+    std::vector<uint8_t> m_rs_is_clean;
+    // Packets of the FEC frame are stored one after another in [m_frame_start, m_frame_end)
+    // They are corrected in place and passed to the callback without copying
+    std::vector<uint8_t> m_frame_buf;
+    size_t m_frame_start = 0;
+    size_t m_frame_end = 0;
+    size_t m_total_bytes_discarded = 0;
+    size_t m_total_packets_discarded = 0;
     std::optional<uint8_t> m_last_counter = std::nullopt;
     Callback m_callback = nullptr;
     std::unique_ptr<Reed_Solomon_Decoder> m_rs_decoder;
@@ -37,9 +37,10 @@ public:
     void SetCallback(const Callback& callback) { m_callback = callback; } 
     void SetCallback(Callback&& callback) { m_callback = std::move(callback); } 
 private:
-    void PushIntoRingBuffer(tcb::span<const uint8_t> buf, uint8_t packet_length_id);
-    tcb::span<const uint8_t> PopRingBuffer();
-    void ClearRingBuffer();
+    void PushPacket(tcb::span<const uint8_t> buf, uint8_t packet_length_id);
+    // Passes up to nb_bytes of stored packets to the callback and removes them
+    void EmitPackets(const size_t nb_bytes, const bool is_corrected);
+    void ClearPackets();
     void PerformReedSolomonCorrection();
-    void ResetRingBuffer();
+    void ResetFrame();
 };
@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "../dab_logging.h"
@@ -16,7 +17,9 @@ constexpr size_t TOTAL_CRC_BYTES = 2;
 constexpr size_t TOTAL_SEGMENT_HEADER_BYTES = 2;
 constexpr size_t MIN_REQUIRED_BYTES = TOTAL_CRC_BYTES + TOTAL_SEGMENT_HEADER_BYTES;
 
-PAD_MOT_Processor::PAD_MOT_Processor() {
+PAD_MOT_Processor::PAD_MOT_Processor(std::pmr::memory_resource* memory_resource)
+: m_data_group(memory_resource)
+{
     m_data_group.Reset();
     m_state = State::WAIT_LENGTH;
 
@@ -28,7 +31,7 @@ PAD_MOT_Processor::PAD_MOT_Processor() {
     // 2. MSC data stream mode service component
     // 3. PAD via AAC data_stream_element()
     // 4. PAD via MPEG-II
-    m_mot_processor = std::make_unique<MOT_Processor>();
+    m_mot_processor = std::make_unique<MOT_Processor>(20, 200, memory_resource);
 }
 
 PAD_MOT_Processor::~PAD_MOT_Processor() = default;
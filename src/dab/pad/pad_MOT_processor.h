@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include "utility/span.h"
 #include "./pad_data_group.h"
 
@@ -22,7 +23,7 @@ private:
     State m_state;
     std::unique_ptr<MOT_Processor> m_mot_processor;
 public:
-    PAD_MOT_Processor();
+    explicit PAD_MOT_Processor(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~PAD_MOT_Processor();
     void ProcessXPAD(
         const bool is_start, const bool is_conditional_access, 
@@ -1,6 +1,7 @@
 #include "./pad_data_group.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include "utility/span.h"
 #include "../algorithms/crc.h"
 
@@ -25,9 +26,8 @@ size_t PAD_Data_Group::Consume(tcb::span<const uint8_t> data) {
     const size_t N = data.size();
     const size_t nb_remain = m_nb_required_bytes - m_nb_curr_bytes;
     const size_t nb_read = (nb_remain > N) ? N : nb_remain;
-    for (size_t i = 0; i < nb_read; i++) {
-        m_buffer[m_nb_curr_bytes++] = data[i];
-    }
+    std::copy_n(data.begin(), nb_read, m_buffer.begin() + m_nb_curr_bytes);
+    m_nb_curr_bytes += nb_read;
     return nb_read;
 }
 
@@ -51,6 +51,4 @@ bool PAD_Data_Group::CheckCRC(void) {
 void PAD_Data_Group::Reset(void) {
     m_nb_required_bytes = 0;
     m_nb_curr_bytes = 0;
-    m_buffer.resize(0);
-    m_buffer.clear();
 }
\ No newline at end of file
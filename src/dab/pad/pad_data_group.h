@@ -2,18 +2,26 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <memory_resource>
 #include <vector>
 #include "utility/span.h"
 
 // Append data group segments until we reach the required length
+// NOTE: The buffer only grows so it stops allocating once it fits the largest data group
+//       Groups with a known maximum length preallocate it with capacity
 class PAD_Data_Group 
 {
 private:
-    std::vector<uint8_t> m_buffer;
+    std::pmr::vector<uint8_t> m_buffer;
     size_t m_nb_required_bytes;
     size_t m_nb_curr_bytes;
 public:
-    PAD_Data_Group() {
+    explicit PAD_Data_Group(
+        std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource(),
+        const size_t capacity=0)
+    : m_buffer(memory_resource)
+    {
+        m_buffer.resize(capacity);
         m_nb_required_bytes = 0;
         m_nb_curr_bytes = 0;
     }
@@ -21,11 +29,13 @@ public:
     bool CheckCRC(void);
     void Reset(void);
     void SetRequiredBytes(const size_t N) { 
-        m_buffer.resize(N);
+        if (N > m_buffer.size()) {
+            m_buffer.resize(N);
+        }
         m_nb_required_bytes = N; 
     }
     size_t GetRequiredBytes(void) const { return m_nb_required_bytes; }
     size_t GetCurrentBytes(void) const { return m_nb_curr_bytes; }
-    tcb::span<uint8_t> GetData(void) { return m_buffer; }
+    tcb::span<uint8_t> GetData(void) { return tcb::span(m_buffer).first(m_nb_required_bytes); }
     bool IsComplete(void) const { return m_nb_curr_bytes == m_nb_required_bytes; }
 };
\ No newline at end of file
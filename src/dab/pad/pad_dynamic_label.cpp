@@ -2,10 +2,15 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <algorithm>
+#include <array>
 #include <memory>
+#include <memory_resource>
+#include <string>
 #include <string_view>
+#include <vector>
 #include <fmt/format.h>
 #include "utility/span.h"
+#include "../algorithms/charset_conversion.h"
 #include "./pad_dynamic_label_assembler.h"
 #include "../dab_logging.h"
 #define TAG "pad-dynamic-label"
@@ -18,17 +23,50 @@ static auto _logger = DAB_LOG_REGISTER(TAG);
 constexpr size_t TOTAL_CRC16_BYTES = 2;
 constexpr size_t TOTAL_HEADER_BYTES = 2;
 constexpr size_t MIN_DATA_GROUP_BYTES = TOTAL_CRC16_BYTES + TOTAL_HEADER_BYTES;
+// Label segments and commands have at most 16 bytes of data since their length is a 4bit field
+constexpr size_t MAX_DATA_GROUP_BYTES = MIN_DATA_GROUP_BYTES + 16;
+constexpr uint8_t COMMAND_CLEAR_DISPLAY = 0b0001;
+constexpr uint8_t COMMAND_DL_PLUS = 0b0010;
+// DOC: ETSI TS 102 980
+// Clause 5.1: A DL Plus tags command has at most 4 tags of 3 bytes each
+constexpr size_t MAX_DL_PLUS_TAGS = 4;
+constexpr size_t DL_PLUS_TAG_BYTES = 3;
+
+// FNV-1a so repeated labels are detected without keeping a copy of the previous one
+static uint64_t get_bytes_hash(tcb::span<const uint8_t> buf, const uint8_t extra) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const auto update = [&hash](const uint8_t x) {
+        hash ^= uint64_t(x);
+        hash *= 0x100000001b3ull;
+    };
+    for (const uint8_t x: buf) {
+        update(x);
+    }
+    update(extra);
+    return hash;
+}
 
 // DOC: ETSI EN 300 401
 // Clause 7.4.5.2 - Dynamic label 
 // The following code refers heavily to the specified clause
 
-PAD_Dynamic_Label::PAD_Dynamic_Label() {
+PAD_Dynamic_Label::PAD_Dynamic_Label(std::pmr::memory_resource* memory_resource)
+: m_data_group(memory_resource, MAX_DATA_GROUP_BYTES),
+  m_label_utf8(memory_resource),
+  m_dl_plus_command(memory_resource),
+  m_dl_plus_text(memory_resource),
+  m_dl_plus_tags(memory_resource)
+{
     m_data_group.SetRequiredBytes(MIN_DATA_GROUP_BYTES);
     m_state = State::WAIT_START;
     m_group_type = GroupType::LABEL_SEGMENT;
-    m_assembler = std::make_unique<PAD_Dynamic_Label_Assembler>();
+    m_assembler = std::make_unique<PAD_Dynamic_Label_Assembler>(memory_resource);
     m_previous_toggle_flag = 0;
+    m_label_hash = 0;
+    m_is_label_valid = false;
+    m_dl_plus_toggle_flag = 0;
+    m_dl_plus_hash = 0;
+    m_dl_plus_tags.reserve(MAX_DL_PLUS_TAGS);
 }
 
 PAD_Dynamic_Label::~PAD_Dynamic_Label() = default;
@@ -124,11 +162,16 @@ void PAD_Dynamic_Label::ReadGroupHeader(void) {
     // const uint8_t first_last_flag = (buf[0] & 0b01100000) >> 5;
     const uint8_t control_flag    = (buf[0] & 0b00010000) >> 4;
 
-    // Control segment has no data field
+    // Control segment has no data field except for the DL Plus command
     if (control_flag) {
-        m_data_group.SetRequiredBytes(TOTAL_HEADER_BYTES + TOTAL_CRC16_BYTES);
+        const uint8_t command = (buf[0] & 0b00001111) >> 0;
+        size_t nb_command_bytes = 0;
+        if (command == COMMAND_DL_PLUS) {
+            const uint8_t length = (buf[1] & 0b00001111) >> 0;
+            nb_command_bytes = size_t(length) + 1;
+        }
+        m_data_group.SetRequiredBytes(TOTAL_HEADER_BYTES + TOTAL_CRC16_BYTES + nb_command_bytes);
         m_group_type = GroupType::COMMAND;
-        // TODO: manage toggle flag for command data group
     // Label segment has specified length
     } else {
         const uint8_t length = (buf[0] & 0b00001111) >> 0;
@@ -179,20 +222,29 @@ void PAD_Dynamic_Label::InterpretLabelSegment(void) {
         return;
     }
 
-    const auto label = m_assembler->GetData();
-    const size_t nb_label_bytes = m_assembler->GetSize();
-    const auto label_str = std::string_view(
-        reinterpret_cast<const char*>(label.data()), 
-        nb_label_bytes);
-
-    LOG_MESSAGE("label[{}]={}", nb_label_bytes, label_str);
-    m_obs_on_label_change.Notify(label_str, m_assembler->GetCharSet());
+    const auto label = m_assembler->GetData().first(m_assembler->GetSize());
+    const uint8_t charset = m_assembler->GetCharSet();
+    const uint64_t label_hash = get_bytes_hash(label, charset);
+    if (m_is_label_valid && (label_hash == m_label_hash)) {
+        LOG_MESSAGE("label[{}] is repeated", label.size());
+        return;
+    }
+    m_label_hash = label_hash;
+    m_is_label_valid = true;
+
+    m_label_utf8.clear();
+    append_charset_as_utf8(label, charset, m_label_utf8);
+    LOG_MESSAGE("label[{}]={} | charset={}", label.size(), m_label_utf8, charset);
+    m_obs_on_label_change.Notify(m_label_utf8, charset);
+    // DL Plus command can arrive before the label it refers to
+    UpdateDLPlusTags();
 }
 
 void PAD_Dynamic_Label::InterpretCommand(void) {
     const auto buf = m_data_group.GetData();
 
-    const uint8_t command = (buf[0] & 0b00001111) >> 0;
+    const uint8_t toggle_flag = (buf[0] & 0b10000000) >> 7;
+    const uint8_t command     = (buf[0] & 0b00001111) >> 0;
     // const uint8_t field2  = (buf[1] & 0b11110000) >> 4;
     // const uint8_t field3  = (buf[1] & 0b00001111) >> 0;
 
@@ -200,17 +252,111 @@ void PAD_Dynamic_Label::InterpretCommand(void) {
     // Clause 7.4.5.2 - Dynamic label 
     switch (command) {
     // Clear display command
-    case 0b0000:
+    case COMMAND_CLEAR_DISPLAY:
         LOG_MESSAGE("command=clear_display");
+        // the next label is notified even if it is the same as the one that was cleared
+        m_is_label_valid = false;
+        m_label_utf8.clear();
         m_obs_on_command.Notify((uint8_t)Command::CLEAR);
         break;
-    // TODO: Dynamic label plus command, see ETSI TS 102 980
-    case 0b1000:
-        LOG_MESSAGE("command=dynamic_label_plus");
+    // Dynamic label plus command, see ETSI TS 102 980
+    case COMMAND_DL_PLUS:
+        {
+            const size_t N = m_data_group.GetRequiredBytes();
+            const size_t nb_command_bytes = N-TOTAL_HEADER_BYTES-TOTAL_CRC16_BYTES;
+            InterpretDLPlusCommand(toggle_flag, { &buf[TOTAL_HEADER_BYTES], nb_command_bytes });
+        }
         break;
     // Reserved for future use
     default:
         LOG_ERROR("Command code {} reserved for future use", command);
         break;
     }
-}
\ No newline at end of file
+}
+
+void PAD_Dynamic_Label::InterpretDLPlusCommand(const uint8_t toggle_flag, tcb::span<const uint8_t> buf) {
+    // Broadcasters repeat the command along with the label
+    const uint64_t dl_plus_hash = get_bytes_hash(buf, toggle_flag);
+    if (!m_dl_plus_command.empty() && (dl_plus_hash == m_dl_plus_hash)) {
+        return;
+    }
+    LOG_MESSAGE("command=dynamic_label_plus[{}] | toggle={}", buf.size(), toggle_flag);
+    m_dl_plus_hash = dl_plus_hash;
+    m_dl_plus_toggle_flag = toggle_flag;
+    m_dl_plus_command.assign(buf.begin(), buf.end());
+    UpdateDLPlusTags();
+}
+
+void PAD_Dynamic_Label::UpdateDLPlusTags(void) {
+    // DL Plus tags refer to the label with the same toggle flag
+    if (m_dl_plus_command.empty() || !m_is_label_valid || !m_assembler->IsCompleted()) {
+        return;
+    }
+    if (m_dl_plus_toggle_flag != m_previous_toggle_flag) {
+        return;
+    }
+
+    // DOC: ETSI TS 102 980
+    // Clause 5.1: DL Plus command field
+    const auto& buf = m_dl_plus_command;
+    const uint8_t command_id = (buf[0] & 0b11110000) >> 4;
+    const uint8_t command_body = (buf[0] & 0b00001111) >> 0;
+    // Only the DL Plus tags command is defined
+    if (command_id != 0b0000) {
+        LOG_ERROR("DL Plus command id {} reserved for future use", command_id);
+        return;
+    }
+
+    const bool is_item_toggle  = (command_body & 0b1000) != 0;
+    const bool is_item_running = (command_body & 0b0100) != 0;
+    const size_t nb_tags       = size_t((command_body & 0b0011) >> 0) + 1;
+    if (buf.size() < (1 + nb_tags*DL_PLUS_TAG_BYTES)) {
+        LOG_ERROR("DL Plus command has {} bytes which is too short for {} tags", buf.size(), nb_tags);
+        return;
+    }
+
+    const auto label = m_assembler->GetData().first(m_assembler->GetSize());
+    const uint8_t charset = m_assembler->GetCharSet();
+    const size_t nb_char_bytes = get_charset_bytes_per_char(charset);
+
+    // NOTE: Text of every tag is converted before any views are taken since the buffer may reallocate
+    struct Tag_Range { uint8_t content_type; size_t offset; size_t length; };
+    std::array<Tag_Range, MAX_DL_PLUS_TAGS> ranges;
+    size_t nb_ranges = 0;
+    m_dl_plus_text.clear();
+    for (size_t i = 0; i < nb_tags; i++) {
+        const auto* tag = &buf[1 + i*DL_PLUS_TAG_BYTES];
+        const uint8_t content_type   = (tag[0] & 0b01111111) >> 0;
+        const uint8_t start_marker   = (tag[1] & 0b01111111) >> 0;
+        const uint8_t length_marker  = (tag[2] & 0b01111111) >> 0;
+        // Dummy tags pad out the command
+        if (content_type == 0) {
+            continue;
+        }
+        const size_t start_byte = size_t(start_marker)*nb_char_bytes;
+        const size_t nb_bytes = (size_t(length_marker)+1)*nb_char_bytes;
+        if ((start_byte + nb_bytes) > label.size()) {
+            LOG_ERROR("DL Plus tag {} [{},{}) falls outside of label[{}]", i, start_byte, start_byte+nb_bytes, label.size());
+            continue;
+        }
+        const size_t offset = m_dl_plus_text.size();
+        append_charset_as_utf8(label.subspan(start_byte, nb_bytes), charset, m_dl_plus_text);
+        ranges[nb_ranges++] = { content_type, offset, m_dl_plus_text.size()-offset };
+    }
+
+    m_dl_plus_tags.clear();
+    const auto text = std::string_view(m_dl_plus_text);
+    for (size_t i = 0; i < nb_ranges; i++) {
+        const auto& range = ranges[i];
+        DL_Plus_Tag tag;
+        tag.content_type = range.content_type;
+        tag.text = text.substr(range.offset, range.length);
+        LOG_MESSAGE("dl_plus_tag[{}]={} | content_type={}", i, tag.text, tag.content_type);
+        m_dl_plus_tags.push_back(tag);
+    }
+
+    m_dl_plus_info.is_item_toggle = is_item_toggle;
+    m_dl_plus_info.is_item_running = is_item_running;
+    m_dl_plus_info.tags = m_dl_plus_tags;
+    m_obs_on_dl_plus_change.Notify(m_dl_plus_info);
+}
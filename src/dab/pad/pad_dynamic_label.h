@@ -3,19 +3,40 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
+#include <string>
 #include <string_view>
+#include <vector>
 #include "utility/observable.h"
 #include "utility/span.h"
 #include "./pad_data_group.h"
 
 class PAD_Dynamic_Label_Assembler;
 
+// DOC: ETSI TS 102 980
+// Clause 5.1: DL Plus tags command
+// Each tag marks a substring of the dynamic label with a content type from Annex A (e.g. 1 = ITEM.TITLE, 4 = ITEM.ARTIST)
+struct DL_Plus_Tag {
+    uint8_t content_type = 0;
+    // UTF-8 text of the tagged part of the label
+    std::string_view text;
+};
+
+struct DL_Plus_Info {
+    // item toggle changes when the programme item changes
+    bool is_item_toggle = false;
+    bool is_item_running = false;
+    tcb::span<const DL_Plus_Tag> tags;
+};
+
 // XPAD data group segments are combined to create:
 // 1. Dynamic label
 //    Multiple XPAD data group segments creates a single dynamic label segment
 //    Multiple dynamic label segments creates a dynamic label
 // 2. Command
 //    Multiple XPAD data group segments creates a single command
+// Broadcasters repeat the same label every few seconds so observers are only notified when it changes
+// The label is converted to UTF-8 and its DL Plus tags are parsed once per change
 class PAD_Dynamic_Label 
 {
 public:
@@ -31,18 +52,35 @@ private:
     GroupType m_group_type;
     std::unique_ptr<PAD_Dynamic_Label_Assembler> m_assembler;
     uint8_t m_previous_toggle_flag;
-    // label_buffer, charset
-    Observable<std::string_view, const uint8_t> m_obs_on_label_change;
-    Observable<uint8_t> m_obs_on_command;
+    // hash of the raw bytes and charset of the last notified label
+    uint64_t m_label_hash;
+    bool m_is_label_valid;
+    std::pmr::string m_label_utf8;
+    // DL Plus command that refers to the label with the same toggle flag
+    std::pmr::vector<uint8_t> m_dl_plus_command;
+    uint8_t m_dl_plus_toggle_flag;
+    uint64_t m_dl_plus_hash;
+    std::pmr::string m_dl_plus_text;
+    std::pmr::vector<DL_Plus_Tag> m_dl_plus_tags;
+    DL_Plus_Info m_dl_plus_info;
+    // utf8_label, charset
+    Ref_Observable<std::string_view, const uint8_t> m_obs_on_label_change;
+    Ref_Observable<uint8_t> m_obs_on_command;
+    Ref_Observable<DL_Plus_Info> m_obs_on_dl_plus_change;
 public:
-    PAD_Dynamic_Label();
+    explicit PAD_Dynamic_Label(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~PAD_Dynamic_Label();
     void ProcessXPAD(const bool is_start, tcb::span<const uint8_t> buf);
     auto& OnLabelChange(void) { return m_obs_on_label_change; }
     auto& OnCommand(void) { return m_obs_on_command; }
+    auto& OnDLPlusChange(void) { return m_obs_on_dl_plus_change; }
+    std::string_view GetLabel(void) const { return m_label_utf8; }
+    const DL_Plus_Info& GetDLPlus(void) const { return m_dl_plus_info; }
 private:
     size_t ConsumeBuffer(const bool is_start, tcb::span<const uint8_t> buf);
     void ReadGroupHeader(void);
     void InterpretLabelSegment(void);
     void InterpretCommand(void);
+    void InterpretDLPlusCommand(const uint8_t toggle_flag, tcb::span<const uint8_t> buf);
+    void UpdateDLPlusTags(void);
 };
@@ -1,6 +1,7 @@
 #include "./pad_dynamic_label_assembler.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <memory_resource>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "../dab_logging.h"
@@ -9,7 +10,9 @@ static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
-PAD_Dynamic_Label_Assembler::PAD_Dynamic_Label_Assembler() {
+PAD_Dynamic_Label_Assembler::PAD_Dynamic_Label_Assembler(std::pmr::memory_resource* memory_resource)
+: m_segments(memory_resource), m_unordered_buf(memory_resource), m_ordered_buf(memory_resource)
+{
     m_unordered_buf.resize(m_MAX_MESSAGE_BYTES);
     m_ordered_buf.resize(m_MAX_MESSAGE_BYTES);
     m_segments.resize(m_MAX_SEGMENTS);
@@ -1,6 +1,7 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <memory_resource>
 #include <vector>
 #include "utility/span.h"
 
@@ -16,17 +17,17 @@ private:
     const size_t m_MAX_SEGMENT_BYTES = 16;
     const size_t m_MAX_SEGMENTS = m_MAX_MESSAGE_BYTES/m_MAX_SEGMENT_BYTES;
 
-    std::vector<Segment> m_segments;
+    std::pmr::vector<Segment> m_segments;
     size_t m_nb_required_segments;
 
     // We have to recombine all of the variable sized segments into a coherent string
-    std::vector<uint8_t> m_unordered_buf;
-    std::vector<uint8_t> m_ordered_buf;
+    std::pmr::vector<uint8_t> m_unordered_buf;
+    std::pmr::vector<uint8_t> m_ordered_buf;
     uint8_t m_charset;
     size_t m_nb_ordered_bytes;
     bool m_is_changed;
 public:
-    PAD_Dynamic_Label_Assembler();
+    explicit PAD_Dynamic_Label_Assembler(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     void Reset(void);
     // Any segment which updates the completed label returns true
     // Any segment which doesn't update the completed label returns false
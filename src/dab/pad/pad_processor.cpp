@@ -2,10 +2,12 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <memory_resource>
 #include <string_view>
 #include <fmt/format.h>
 #include "utility/observable.h"
 #include "utility/span.h"
+#include "../algorithms/byte_reversal.h"
 #include "./pad_MOT_processor.h"
 #include "./pad_data_length_indicator.h"
 #include "./pad_dynamic_label.h"
@@ -18,44 +20,47 @@ static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
 
-constexpr int MAX_XPAD_BYTES = 196;
-constexpr int MAX_CI_LENGTH = 4;
-
 // DOC: ETSI EN 300 401
 // Clause 7.4.4.2 - Contents indicator in variable size X-PAD 
 // The length_index corresponds to the following table of XPAD data lengths
 const uint8_t CONTENT_INDICATOR_LENGTH_TABLE[8] = {4, 6, 8, 12, 16, 24, 32, 48};
 
-PAD_Processor::PAD_Processor() {
-    m_xpad_unreverse_buf.resize(MAX_XPAD_BYTES);
-
+PAD_Processor::PAD_Processor(std::pmr::memory_resource* memory_resource)
+{
     // we need to persist the contents indicator list between frames
     // this is because the encoder can choose to exclude them in intermediate packets
-    m_ci_list.resize(MAX_CI_LENGTH);
-    m_ci_list.resize(0);
+    m_nb_ci = 0;
 
     // we need to associate consecutive data length indicators and MOT packets
     m_previous_mot_length = 0;
 
-    m_dynamic_label = std::make_unique<PAD_Dynamic_Label>();
+    m_dynamic_label = std::make_unique<PAD_Dynamic_Label>(memory_resource);
     m_data_length_indicator = std::make_unique<PAD_Data_Length_Indicator>();
-    m_pad_mot_processor = std::make_unique<PAD_MOT_Processor>();
+    m_pad_mot_processor = std::make_unique<PAD_MOT_Processor>(memory_resource);
 }
 
 PAD_Processor::~PAD_Processor() = default;
 
-Observable<std::string_view, const uint8_t>& PAD_Processor::OnLabelUpdate() {
+Ref_Observable<std::string_view, const uint8_t>& PAD_Processor::OnLabelUpdate() {
     return m_dynamic_label->OnLabelChange();
 }
 
-Observable<uint8_t>& PAD_Processor::OnLabelCommand() {
+Ref_Observable<DL_Plus_Info>& PAD_Processor::OnLabelPlusUpdate() {
+    return m_dynamic_label->OnDLPlusChange();
+}
+
+Ref_Observable<uint8_t>& PAD_Processor::OnLabelCommand() {
     return m_dynamic_label->OnCommand();
 }
 
-Observable<MOT_Entity>& PAD_Processor::OnMOTUpdate() {
+Ref_Observable<MOT_Entity&>& PAD_Processor::OnMOTUpdate() {
     return m_pad_mot_processor->Get_MOT_Processor().OnEntityComplete();
 }
 
+MOT_Processor& PAD_Processor::Get_MOT_Processor() {
+    return m_pad_mot_processor->Get_MOT_Processor();
+}
+
 void PAD_Processor::Process(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad_reversed) {
     // If we have no XPAD, reset the CI list
     // NOTE: Some broadcasters violate this part of the standard and assume the CI list will be preserved
@@ -115,9 +120,7 @@ void PAD_Processor::Process(tcb::span<const uint8_t> fpad, tcb::span<const uint8
     // Clause 7.4.2.0 Structure of X-PAD (General)
     // NOTE: The byte order of the XPAD is reversed before transmission
     //       The bit order is preserved
-    for (size_t i = 0; i < xpad_reversed.size(); i++) {
-        m_xpad_unreverse_buf[i] = xpad_reversed[xpad_reversed.size()-1-i];
-    }
+    reverse_bytes_auto(xpad_reversed, m_xpad_unreverse_buf);
 
     auto xpad_data = tcb::span(m_xpad_unreverse_buf).first(xpad_reversed.size());
 
@@ -169,19 +172,18 @@ void PAD_Processor::Process_Short_XPAD(tcb::span<const uint8_t> xpad, const bool
         // const uint8_t rfu      = (CI & 0b11100000) >> 5;
         const uint8_t app_type = (CI & 0b00011111) >> 0;
 
-        const auto indicator = PAD_Content_Indicator{ DATA_BYTES_WITH_CI, app_type };
-        m_ci_list.resize(1);
-        m_ci_list[0] = indicator;
+        m_ci_list[0] = PAD_Content_Indicator{ DATA_BYTES_WITH_CI, app_type };
+        m_nb_ci = 1;
     }
 
-    if (m_ci_list.empty()) {
+    if (m_nb_ci == 0) {
         LOG_ERROR("[short-xpad] CI has not been given yet");
         return;
     }
 
-    if (m_ci_list.size() != 1) {
-        LOG_ERROR("[short-xpad] CI list length is unexpected for short xpad {} != 1", m_ci_list.size());
-        m_ci_list.resize(0);
+    if (m_nb_ci != 1) {
+        LOG_ERROR("[short-xpad] CI list length is unexpected for short xpad {} != 1", m_nb_ci);
+        m_nb_ci = 0;
         return;
     }
 
@@ -197,8 +199,12 @@ void PAD_Processor::Process_Variable_XPAD(tcb::span<const uint8_t> xpad, const b
     const size_t N = xpad.size();
     size_t curr_byte = 0;
     if (has_indicator_list) {
-        m_ci_list.resize(0);
+        m_nb_ci = 0;
         for (size_t i = 0; i < MAX_CI_LENGTH; i++) {
+            if (curr_byte >= N) {
+                LOG_ERROR("[var-xpad] Insufficient length for indicator list {}/{}", curr_byte+1, N);
+                return;
+            }
             const uint8_t CI = xpad[curr_byte++];
 
             // DOC: ETSI EN 300 401
@@ -216,8 +222,7 @@ void PAD_Processor::Process_Variable_XPAD(tcb::span<const uint8_t> xpad, const b
             }
 
             const uint8_t length = CONTENT_INDICATOR_LENGTH_TABLE[length_index];
-            const auto indicator = PAD_Content_Indicator{ length, app_type };
-            m_ci_list.push_back(indicator);
+            m_ci_list[m_nb_ci++] = PAD_Content_Indicator{ length, app_type };
         }
     } else {
         LOG_ERROR("[var-xpad] No CI list L={}", N);
@@ -229,12 +234,12 @@ void PAD_Processor::Process_Variable_XPAD(tcb::span<const uint8_t> xpad, const b
 void PAD_Processor::ProcessDataField(tcb::span<const uint8_t> data_field) {
     const int N = (int)data_field.size();
     int curr_byte = 0;
-    for (size_t i = 0; i < m_ci_list.size(); i++) {
+    for (size_t i = 0; i < m_nb_ci; i++) {
         auto& content = m_ci_list[i];
 
         const int nb_remain = N-curr_byte;
         if (content.length > nb_remain) {
-            LOG_ERROR("Insufficent length for data field {}/{} i={}/{}", content.length, nb_remain, i, m_ci_list.size());
+            LOG_ERROR("Insufficent length for data field {}/{} i={}/{}", content.length, nb_remain, i, m_nb_ci);
             return;
         }
 
@@ -311,7 +316,7 @@ void PAD_Processor::ProcessDataField(tcb::span<const uint8_t> data_field) {
             break;
         default:
             LOG_ERROR("Unsupported app_type={} length={} i={}/{}", 
-                content.app_type, content.length, i, m_ci_list.size());
+                content.app_type, content.length, i, m_nb_ci);
             break;
         }
 
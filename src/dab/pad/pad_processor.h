@@ -1,8 +1,10 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
-#include <vector>
+#include <array>
 #include <memory>
+#include <memory_resource>
 #include <string_view>
 #include "../mot/MOT_entities.h"
 #include "utility/observable.h"
@@ -10,7 +12,9 @@
 
 class PAD_Data_Length_Indicator;
 class PAD_Dynamic_Label;
+struct DL_Plus_Info;
 class PAD_MOT_Processor;
+class MOT_Processor;
 
 struct PAD_Content_Indicator {
     uint8_t length;
@@ -19,12 +23,17 @@ struct PAD_Content_Indicator {
 
 // Takes in PAD information and decodes into into relevant objects
 // Updated/new entities are signalled through the observer callbacks
+// NOTE: Buffers have a fixed capacity so processing the PAD of each access unit doesn't allocate
+// NOTE: The internal buffers are allocated from memory_resource which must outlive the processor
 class PAD_Processor 
 {
 private:
+    static constexpr size_t MAX_XPAD_BYTES = 196;
+    static constexpr size_t MAX_CI_LENGTH = 4;
     // The incoming XPAD field has reversed byte order which we unreverse
-    std::vector<uint8_t> m_xpad_unreverse_buf;
-    std::vector<PAD_Content_Indicator> m_ci_list;
+    std::array<uint8_t, MAX_XPAD_BYTES> m_xpad_unreverse_buf;
+    std::array<PAD_Content_Indicator, MAX_CI_LENGTH> m_ci_list;
+    size_t m_nb_ci;
 
     std::unique_ptr<PAD_Data_Length_Indicator> m_data_length_indicator;
     std::unique_ptr<PAD_Dynamic_Label> m_dynamic_label;
@@ -33,16 +42,20 @@ private:
     // We associated MOT XPAD lengths to the most recently declared data length indicator
     uint16_t m_previous_mot_length;
 public:
-    PAD_Processor();
+    explicit PAD_Processor(std::pmr::memory_resource* memory_resource=std::pmr::get_default_resource());
     ~PAD_Processor();
     void Process(tcb::span<const uint8_t> fpad, tcb::span<const uint8_t> xpad_reversed);
 
-    // label, charset
-    Observable<std::string_view, const uint8_t>& OnLabelUpdate();
+    // utf8_label, charset
+    // NOTE: Only notified when the label changes
+    Ref_Observable<std::string_view, const uint8_t>& OnLabelUpdate();
+    // tags of the current label which are only notified when they change
+    Ref_Observable<DL_Plus_Info>& OnLabelPlusUpdate();
     // command id
-    Observable<uint8_t>& OnLabelCommand();
+    Ref_Observable<uint8_t>& OnLabelCommand();
     // mot object
-    Observable<MOT_Entity>& OnMOTUpdate();
+    Ref_Observable<MOT_Entity&>& OnMOTUpdate();
+    MOT_Processor& Get_MOT_Processor();
 private:
     void Process_Short_XPAD(tcb::span<const uint8_t> xpad, const bool has_indicator_list);
     void Process_Variable_XPAD(tcb::span<const uint8_t> xpad, const bool has_indicator_list);
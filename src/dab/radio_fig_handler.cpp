@@ -1,5 +1,8 @@
 #include "./radio_fig_handler.h"
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <fmt/format.h>
 #include "utility/span.h"
 #include "./algorithms/modified_julian_date.h"
@@ -13,35 +16,387 @@ static auto _logger = DAB_LOG_REGISTER(TAG);
 #define LOG_MESSAGE(...) DAB_LOG_MESSAGE(TAG, fmt::format(__VA_ARGS__))
 #define LOG_ERROR(...) DAB_LOG_ERROR(TAG, fmt::format(__VA_ARGS__))
 
+void Radio_FIG_Handler::BeginBatch() {
+    m_is_batching = true;
+    m_updates.clear();
+    m_update_args.clear();
+}
+
+void Radio_FIG_Handler::EndBatch() {
+    m_is_batching = false;
+    if (m_updates.empty()) return;
+    m_update_stats.nb_batches++;
+
+    std::sort(m_updates.begin(), m_updates.end(), [](const Logged_Update& a, const Logged_Update& b) {
+        if (a.key != b.key) return a.key < b.key;
+        return a.index < b.index;
+    });
+
+    const Logged_Update* prev = nullptr;
+    for (const auto& update: m_updates) {
+        const uint8_t* data = m_update_args.data() + update.offset;
+        // FIGs are repeated through the FIC so an identical update in the same batch can't change anything
+        const bool is_duplicate = 
+            (prev != nullptr) && (prev->key == update.key) && 
+            (prev->apply == update.apply) && (prev->length == update.length) &&
+            (memcmp(m_update_args.data() + prev->offset, data, update.length) == 0);
+        if (is_duplicate) {
+            m_update_stats.nb_duplicates++;
+            continue;
+        }
+        prev = &update;
+
+        DatabaseUpdaterGlobalStatistics old_stats;
+        if (m_updater) old_stats = m_updater->GetStatistics();
+        update.apply(*this, data);
+        const bool is_changed = m_updater && (m_updater->GetStatistics() != old_stats);
+        if (is_changed) {
+            m_update_stats.nb_changed++;
+        } else {
+            m_update_stats.nb_no_change++;
+        }
+    }
+    m_updates.clear();
+    m_update_args.clear();
+}
+
 // fig 0/0 - ensemble information
 void Radio_FIG_Handler::OnEnsemble_1_ID(
     const uint8_t country_id, const uint16_t ensemble_ref,
     const uint8_t change_flags, const uint8_t alarm_flag,
-    const uint8_t cif_upper, const uint8_t cif_lower) 
+    const uint8_t cif_upper, const uint8_t cif_lower,
+    const uint8_t occurrence_change) 
+{
+    Submit<&Radio_FIG_Handler::ApplyEnsemble_1_ID>(0, 0, 0,
+        country_id, ensemble_ref, change_flags, alarm_flag, cif_upper, cif_lower, occurrence_change);
+}
+
+// fig 0/1 - subchannel configuration
+void Radio_FIG_Handler::OnSubchannel_1_Short(
+    const uint8_t subchannel_id, 
+    const uint16_t start_address, 
+    const uint8_t table_switch, const uint8_t table_index,
+    const bool is_next_configuration) 
+{
+    Submit<&Radio_FIG_Handler::ApplySubchannel_1_Short>(0, 1, subchannel_id,
+        subchannel_id, start_address, table_switch, table_index, is_next_configuration);
+}
+
+void Radio_FIG_Handler::OnSubchannel_1_Long(
+    const uint8_t subchannel_id, 
+    const uint16_t start_address, 
+    const uint8_t option, const uint8_t protection_level, 
+    const uint16_t subchannel_size,
+    const bool is_next_configuration)
+{
+    Submit<&Radio_FIG_Handler::ApplySubchannel_1_Long>(0, 1, subchannel_id,
+        subchannel_id, start_address, option, protection_level, subchannel_size, is_next_configuration);
+}
+
+// fig 0/2 - service components type
+void Radio_FIG_Handler::OnServiceComponent_1_StreamAudioType(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t subchannel_id, 
+    const uint8_t audio_service_type, const bool is_primary)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_1_StreamAudioType>(0, 2, service_reference,
+        country_id, service_reference, extended_country_code, subchannel_id, audio_service_type, is_primary);
+}
+
+void Radio_FIG_Handler::OnServiceComponent_1_StreamDataType(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t subchannel_id, 
+    const uint8_t data_service_type, const bool is_primary)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_1_StreamDataType>(0, 2, service_reference,
+        country_id, service_reference, extended_country_code, subchannel_id, data_service_type, is_primary);
+}
+
+void Radio_FIG_Handler::OnServiceComponent_1_PacketDataType(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint16_t service_component_global_id, const bool is_primary)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_1_PacketDataType>(0, 2, service_reference,
+        country_id, service_reference, extended_country_code, service_component_global_id, is_primary);
+}
+
+// fig 0/3 - service component packet data type
+void Radio_FIG_Handler::OnServiceComponent_2_PacketDataType(
+    const uint16_t service_component_global_id, const uint8_t subchannel_id,
+    const uint8_t data_service_type, 
+    const uint16_t packet_address)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_2_PacketDataType>(0, 3, service_component_global_id,
+        service_component_global_id, subchannel_id, data_service_type, packet_address);
+}
+
+// fig 0/5 - service component language
+void Radio_FIG_Handler::OnServiceComponent_3_Short_Language(
+    const uint8_t subchannel_id, const uint8_t language)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_3_Short_Language>(0, 5, subchannel_id,
+        subchannel_id, language);
+}
+
+void Radio_FIG_Handler::OnServiceComponent_3_Long_Language(
+    const uint16_t service_component_global_id, 
+    const uint8_t language)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_3_Long_Language>(0, 5, service_component_global_id,
+        service_component_global_id, language);
+}
+
+// fig 0/6 - Service linking information
+void Radio_FIG_Handler::OnServiceLinkage_1_LSN_Only(
+    const bool is_active_link, const bool is_hard_link, const bool is_international,
+    const uint16_t linkage_set_number)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceLinkage_1_LSN_Only>(0, 6, linkage_set_number,
+        is_active_link, is_hard_link, is_international, linkage_set_number);
+}
+
+void Radio_FIG_Handler::OnServiceLinkage_1_ServiceID(
+    const bool is_active_link, const bool is_hard_link, const bool is_international,
+    const uint16_t linkage_set_number,
+    const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceLinkage_1_ServiceID>(0, 6, linkage_set_number,
+        is_active_link, is_hard_link, is_international, linkage_set_number,
+        country_id, service_ref, extended_country_code);
+}
+
+void Radio_FIG_Handler::OnServiceLinkage_1_RDS_PI_ID(
+    const bool is_active_link, const bool is_hard_link, const bool is_international,
+    const uint16_t linkage_set_number,
+    const uint16_t rds_pi_id, const uint8_t extended_country_code)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceLinkage_1_RDS_PI_ID>(0, 6, linkage_set_number,
+        is_active_link, is_hard_link, is_international, linkage_set_number,
+        rds_pi_id, extended_country_code);
+}
+
+void Radio_FIG_Handler::OnServiceLinkage_1_DRM_ID(
+    const bool is_active_link, const bool is_hard_link, const bool is_international,
+    const uint16_t linkage_set_number,
+    const uint32_t drm_id)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceLinkage_1_DRM_ID>(0, 6, linkage_set_number,
+        is_active_link, is_hard_link, is_international, linkage_set_number, drm_id);
+}
+
+// fig 0/7 - Configuration information
+void Radio_FIG_Handler::OnConfigurationInformation_1(
+    const uint8_t nb_services, const uint16_t reconfiguration_count)
+{
+    Submit<&Radio_FIG_Handler::ApplyConfigurationInformation_1>(0, 7, 0,
+        nb_services, reconfiguration_count);
+}
+
+// fig 0/8 - Service component global definition
+void Radio_FIG_Handler::OnServiceComponent_4_Short_Definition(
+    const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
+    const uint8_t service_component_id,
+    const uint8_t subchannel_id)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_4_Short_Definition>(0, 8, service_ref,
+        country_id, service_ref, extended_country_code, service_component_id, subchannel_id);
+}
+
+void Radio_FIG_Handler::OnServiceComponent_4_Long_Definition(
+    const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
+    const uint8_t service_component_id,
+    const uint16_t service_component_global_id)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_4_Long_Definition>(0, 8, service_ref,
+        country_id, service_ref, extended_country_code, service_component_id, service_component_global_id);
+}
+
+// fig 0/9 - Ensemble country, LTO (local time offset), international table
+void Radio_FIG_Handler::OnEnsemble_2_Country(
+    const uint8_t local_time_offset, const uint8_t extended_country_code, 
+    const uint8_t international_table_id)
+{
+    Submit<&Radio_FIG_Handler::ApplyEnsemble_2_Country>(0, 9, 0,
+        local_time_offset, extended_country_code, international_table_id);
+}
+
+void Radio_FIG_Handler::OnEnsemble_2_Service_Country(
+    const uint8_t local_time_offset, const uint8_t extended_country_code, 
+    const uint8_t international_table_id,
+    const uint8_t service_country_id, const uint32_t service_reference, 
+    const uint8_t service_extended_country_code)
+{
+    Submit<&Radio_FIG_Handler::ApplyEnsemble_2_Service_Country>(0, 9, service_reference,
+        local_time_offset, extended_country_code, international_table_id,
+        service_country_id, service_reference, service_extended_country_code);
+}
+
+// fig 0/10 - Ensemble date and time
+void Radio_FIG_Handler::OnDateTime_1(
+    const uint32_t modified_julian_date,
+    const uint8_t hours, const uint8_t minutes, const uint8_t seconds, const uint16_t milliseconds,
+    const bool is_leap_second, const bool is_long_form)
+{
+    Submit<&Radio_FIG_Handler::ApplyDateTime_1>(0, 10, 0,
+        modified_julian_date, hours, minutes, seconds, milliseconds, is_leap_second, is_long_form);
+}
+
+// fig 0/13 - User application information
+void Radio_FIG_Handler::OnServiceComponent_5_UserApplication(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t service_component_id, 
+    const uint16_t app_type, 
+    const uint8_t* buf, const uint8_t N)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_5_UserApplication>(0, 13, service_reference,
+        country_id, service_reference, extended_country_code, service_component_id, app_type,
+        tcb::span<const uint8_t>(buf, size_t(N)));
+}
+
+// fig 0/14 - Packet mode FEC type 
+void Radio_FIG_Handler::OnSubchannel_2_FEC(
+    const uint8_t subchannel_id, const uint8_t fec_type)
+{
+    Submit<&Radio_FIG_Handler::ApplySubchannel_2_FEC>(0, 14, subchannel_id,
+        subchannel_id, fec_type);
+}
+
+// fig 0/17 - Programme type
+void Radio_FIG_Handler::OnService_1_ProgrammeType(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t programme_type, 
+    const uint8_t language_type,  const uint8_t closed_caption_type,
+    const bool has_language, const bool has_closed_caption)
+{
+    Submit<&Radio_FIG_Handler::ApplyService_1_ProgrammeType>(0, 17, service_reference,
+        country_id, service_reference, extended_country_code, programme_type,
+        language_type, closed_caption_type, has_language, has_closed_caption);
+}
+
+// fig 0/21 - Alternate frequency information
+void Radio_FIG_Handler::OnFrequencyInformation_1_Ensemble(
+    const uint8_t country_id, const uint16_t ensemble_reference,
+    const uint32_t frequency,
+    const bool is_continuous_output,
+    const bool is_geographically_adjacent, 
+    const bool is_transmission_mode_I)
+{
+    Submit<&Radio_FIG_Handler::ApplyFrequencyInformation_1_Ensemble>(0, 21, ensemble_reference,
+        country_id, ensemble_reference, frequency,
+        is_continuous_output, is_geographically_adjacent, is_transmission_mode_I);
+}
+
+void Radio_FIG_Handler::OnFrequencyInformation_1_RDS_PI(
+    const uint16_t rds_pi_id, const uint32_t frequency,
+    const bool is_time_compensated)
+{
+    Submit<&Radio_FIG_Handler::ApplyFrequencyInformation_1_RDS_PI>(0, 21, rds_pi_id,
+        rds_pi_id, frequency, is_time_compensated);
+}
+
+void Radio_FIG_Handler::OnFrequencyInformation_1_DRM(
+    const uint32_t drm_id, const uint32_t frequency,
+    const bool is_time_compensated)
+{
+    Submit<&Radio_FIG_Handler::ApplyFrequencyInformation_1_DRM>(0, 21, drm_id,
+        drm_id, frequency, is_time_compensated);
+}
+
+void Radio_FIG_Handler::OnFrequencyInformation_1_AMSS(
+    const uint32_t amss_id, const uint32_t frequency,
+    const bool is_time_compensated)
+{
+    Submit<&Radio_FIG_Handler::ApplyFrequencyInformation_1_AMSS>(0, 21, amss_id,
+        amss_id, frequency, is_time_compensated);
+}
+
+// fig 0/24 - Other ensemble services
+void Radio_FIG_Handler::OnOtherEnsemble_1_Service(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t ensemble_country_id, const uint16_t ensemble_reference)
+{
+    Submit<&Radio_FIG_Handler::ApplyOtherEnsemble_1_Service>(0, 24, service_reference,
+        country_id, service_reference, extended_country_code, ensemble_country_id, ensemble_reference);
+}
+
+// fig 1/0 - Ensemble label
+void Radio_FIG_Handler::OnEnsemble_3_Label(
+    const uint8_t country_id, const uint16_t ensemble_reference,
+    const uint16_t abbreviation_field,
+    tcb::span<const uint8_t> buf)
+{
+    Submit<&Radio_FIG_Handler::ApplyEnsemble_3_Label>(1, 0, 0,
+        country_id, ensemble_reference, abbreviation_field, buf);
+}
+
+// fig 1/1 - Short form service identifier label
+// fig 1/5 - Long form service identifier label
+void Radio_FIG_Handler::OnService_2_Label(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint16_t abbreviation_field,
+    tcb::span<const uint8_t> buf)
+{
+    Submit<&Radio_FIG_Handler::ApplyService_2_Label>(1, 1, service_reference,
+        country_id, service_reference, extended_country_code, abbreviation_field, buf);
+}
+
+// fig 1/4 - Non-primary service component label
+void Radio_FIG_Handler::OnServiceComponent_6_Label(
+    const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+    const uint8_t service_component_id,
+    const uint16_t abbreviation_field,
+    tcb::span<const uint8_t> buf)
+{
+    Submit<&Radio_FIG_Handler::ApplyServiceComponent_6_Label>(1, 4, service_reference,
+        country_id, service_reference, extended_country_code, service_component_id, abbreviation_field, buf);
+}
+
+// fig 0/0 - ensemble information
+void Radio_FIG_Handler::ApplyEnsemble_1_ID(
+    const uint8_t country_id, const uint16_t ensemble_ref,
+    const uint8_t change_flags, const uint8_t alarm_flag,
+    const uint8_t cif_upper, const uint8_t cif_lower,
+    const uint8_t occurrence_change) 
 {
     if (m_updater) {
         auto& u = m_updater->GetEnsembleUpdater();    
         u.SetCountryID(country_id);
         u.SetReference(ensemble_ref);
+
+        // DOC: ETSI EN 300 401
+        // Clause 6.5: Multiplex reconfiguration
+        // The change flags are cleared once the reconfiguration has occurred
+        if (change_flags != 0) {
+            m_is_reconfiguration_pending = true;
+        } else if (m_is_reconfiguration_pending) {
+            m_is_reconfiguration_pending = false;
+            m_updater->ApplyNextSubchannels();
+        }
     }
 
     if (m_misc_info) {
         m_misc_info->cif_counter.upper_count = cif_upper;
         m_misc_info->cif_counter.lower_count = cif_lower;
+        m_misc_info->change_flags = change_flags;
+        m_misc_info->occurrence_change = occurrence_change;
     }
 }
 
 // fig 0/1 - subchannel configuration
 // Short form for UEP
-void Radio_FIG_Handler::OnSubchannel_1_Short(
+void Radio_FIG_Handler::ApplySubchannel_1_Short(
     const uint8_t subchannel_id, 
     const uint16_t start_address, 
-    const uint8_t table_switch, const uint8_t table_index) 
+    const uint8_t table_switch, const uint8_t table_index,
+    const bool is_next_configuration) 
 {
     if (!m_updater) return;
-    auto& u = m_updater->GetSubchannelUpdater(subchannel_id);
-    u.SetStartAddress(start_address);
-    u.SetIsUEP(true);
+    SubchannelUpdater* u = nullptr;
+    if (!is_next_configuration) {
+        u = &m_updater->GetSubchannelUpdater(subchannel_id);
+        u->SetStartAddress(start_address);
+        u->SetIsUEP(true);
+    }
 
     // reserved for future tables
     if (table_switch) {
@@ -57,18 +412,38 @@ void Radio_FIG_Handler::OnSubchannel_1_Short(
     }
 
     const auto props = UEP_PROTECTION_TABLE[table_index];
-    u.SetUEPProtIndex(table_index);
-    u.SetLength(props.subchannel_size);
+    if (is_next_configuration) {
+        auto& next = m_updater->GetNextSubchannel(subchannel_id);
+        next.start_address = start_address;
+        next.is_uep = true;
+        next.uep_prot_index = table_index;
+        next.length = props.subchannel_size;
+        return;
+    }
+
+    u->SetUEPProtIndex(table_index);
+    u->SetLength(props.subchannel_size);
 }
 
 // Long form for EEP
-void Radio_FIG_Handler::OnSubchannel_1_Long(
+void Radio_FIG_Handler::ApplySubchannel_1_Long(
     const uint8_t subchannel_id, 
     const uint16_t start_address, 
     const uint8_t option, const uint8_t protection_level, 
-    const uint16_t subchannel_size)
+    const uint16_t subchannel_size,
+    const bool is_next_configuration)
 {
     if (!m_updater) return;
+    if (is_next_configuration) {
+        auto& next = m_updater->GetNextSubchannel(subchannel_id);
+        next.is_uep = false;
+        next.start_address = start_address;
+        next.eep_type = option ? EEP_Type::TYPE_B : EEP_Type::TYPE_A;
+        next.eep_prot_level = protection_level;
+        next.length = subchannel_size;
+        return;
+    }
+
     auto& u = m_updater->GetSubchannelUpdater(subchannel_id);
     u.SetIsUEP(false);
     u.SetStartAddress(start_address);
@@ -78,7 +453,7 @@ void Radio_FIG_Handler::OnSubchannel_1_Long(
 }
 
 // fig 0/2 - service components type
-void Radio_FIG_Handler::OnServiceComponent_1_StreamAudioType(
+void Radio_FIG_Handler::ApplyServiceComponent_1_StreamAudioType(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t subchannel_id, 
     const uint8_t audio_service_type, const bool is_primary)
@@ -115,7 +490,7 @@ void Radio_FIG_Handler::OnServiceComponent_1_StreamAudioType(
 
 }
 
-void Radio_FIG_Handler::OnServiceComponent_1_StreamDataType(
+void Radio_FIG_Handler::ApplyServiceComponent_1_StreamDataType(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t subchannel_id, 
     const uint8_t data_service_type, const bool is_primary)
@@ -158,7 +533,7 @@ void Radio_FIG_Handler::OnServiceComponent_1_StreamDataType(
     }    
 }
 
-void Radio_FIG_Handler::OnServiceComponent_1_PacketDataType(
+void Radio_FIG_Handler::ApplyServiceComponent_1_PacketDataType(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint16_t service_component_global_id, const bool is_primary)
 {
@@ -183,7 +558,7 @@ void Radio_FIG_Handler::OnServiceComponent_1_PacketDataType(
 }
 
 // fig 0/3 - service component packet data type
-void Radio_FIG_Handler::OnServiceComponent_2_PacketDataType(
+void Radio_FIG_Handler::ApplyServiceComponent_2_PacketDataType(
     const uint16_t service_component_global_id, const uint8_t subchannel_id,
     const uint8_t data_service_type, 
     const uint16_t packet_address)
@@ -213,7 +588,7 @@ void Radio_FIG_Handler::OnServiceComponent_2_StreamConditionalAccess(
 
 // fig 0/5 - service component language
 // For stream mode service components
-void Radio_FIG_Handler::OnServiceComponent_3_Short_Language(
+void Radio_FIG_Handler::ApplyServiceComponent_3_Short_Language(
     const uint8_t subchannel_id, const uint8_t language)
 {
     if (!m_updater) return;
@@ -228,7 +603,7 @@ void Radio_FIG_Handler::OnServiceComponent_3_Short_Language(
 }
 
 // For packet mode service components that have a global id
-void Radio_FIG_Handler::OnServiceComponent_3_Long_Language(
+void Radio_FIG_Handler::ApplyServiceComponent_3_Long_Language(
     const uint16_t service_component_global_id, 
     const uint8_t language)
 {
@@ -245,7 +620,7 @@ void Radio_FIG_Handler::OnServiceComponent_3_Long_Language(
 // fig 0/6 - Service linking information
 // This generates our LSN (linkage set number - 12bits) and a corresponding ID
 // The ID may take the form of a service id, RDS_PI (16bit) id or a DRM id (24bit)
-void Radio_FIG_Handler::OnServiceLinkage_1_LSN_Only(
+void Radio_FIG_Handler::ApplyServiceLinkage_1_LSN_Only(
     const bool is_active_link, const bool is_hard_link, const bool is_international,
     const uint16_t linkage_set_number)
 {
@@ -256,7 +631,7 @@ void Radio_FIG_Handler::OnServiceLinkage_1_LSN_Only(
     u.SetIsInternational(is_international);
 }
 
-void Radio_FIG_Handler::OnServiceLinkage_1_ServiceID(
+void Radio_FIG_Handler::ApplyServiceLinkage_1_ServiceID(
     const bool is_active_link, const bool is_hard_link, const bool is_international,
     const uint16_t linkage_set_number,
     const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code)
@@ -274,7 +649,7 @@ void Radio_FIG_Handler::OnServiceLinkage_1_ServiceID(
     s_u.SetExtendedCountryCode(extended_country_code);
 }
 
-void Radio_FIG_Handler::OnServiceLinkage_1_RDS_PI_ID(
+void Radio_FIG_Handler::ApplyServiceLinkage_1_RDS_PI_ID(
     const bool is_active_link, const bool is_hard_link, const bool is_international,
     const uint16_t linkage_set_number,
     const uint16_t rds_pi_id, const uint8_t extended_country_code)
@@ -293,7 +668,7 @@ void Radio_FIG_Handler::OnServiceLinkage_1_RDS_PI_ID(
     s_u.SetExtendedCountryCode(extended_country_code);
 }
 
-void Radio_FIG_Handler::OnServiceLinkage_1_DRM_ID(
+void Radio_FIG_Handler::ApplyServiceLinkage_1_DRM_ID(
     const bool is_active_link, const bool is_hard_link, const bool is_international,
     const uint16_t linkage_set_number,
     const uint32_t drm_id)
@@ -309,7 +684,7 @@ void Radio_FIG_Handler::OnServiceLinkage_1_DRM_ID(
 }
 
 // fig 0/7 - Configuration information
-void Radio_FIG_Handler::OnConfigurationInformation_1(
+void Radio_FIG_Handler::ApplyConfigurationInformation_1(
     const uint8_t nb_services, const uint16_t reconfiguration_count)
 {
     if (!m_updater) return;
@@ -320,7 +695,7 @@ void Radio_FIG_Handler::OnConfigurationInformation_1(
 
 // fig 0/8 - Service component global definition
 // Links service component to their service and subchannel 
-void Radio_FIG_Handler::OnServiceComponent_4_Short_Definition(
+void Radio_FIG_Handler::ApplyServiceComponent_4_Short_Definition(
     const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
     const uint8_t service_component_id,
     const uint8_t subchannel_id)
@@ -335,7 +710,7 @@ void Radio_FIG_Handler::OnServiceComponent_4_Short_Definition(
 }
 
 // For packet mode service components that have a global id
-void Radio_FIG_Handler::OnServiceComponent_4_Long_Definition(
+void Radio_FIG_Handler::ApplyServiceComponent_4_Long_Definition(
     const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
     const uint8_t service_component_id,
     const uint16_t service_component_global_id)
@@ -350,7 +725,7 @@ void Radio_FIG_Handler::OnServiceComponent_4_Long_Definition(
 }
 
 // fig 0/9 - Ensemble country, LTO (local time offset), international table
-void Radio_FIG_Handler::OnEnsemble_2_Country(
+void Radio_FIG_Handler::ApplyEnsemble_2_Country(
     const uint8_t local_time_offset, const uint8_t extended_country_code, 
     const uint8_t international_table_id)
 {
@@ -371,7 +746,7 @@ void Radio_FIG_Handler::OnEnsemble_2_Country(
     u.SetInternationalTableID(international_table_id);
 }
  
-void Radio_FIG_Handler::OnEnsemble_2_Service_Country(
+void Radio_FIG_Handler::ApplyEnsemble_2_Service_Country(
     const uint8_t local_time_offset, const uint8_t extended_country_code, 
     const uint8_t international_table_id,
     const uint8_t service_country_id, const uint32_t service_reference, 
@@ -401,7 +776,7 @@ void Radio_FIG_Handler::OnEnsemble_2_Service_Country(
  
 // fig 0/10 - Ensemble date and time
 // Long form also includes the seconds and milliseconds
-void Radio_FIG_Handler::OnDateTime_1(
+void Radio_FIG_Handler::ApplyDateTime_1(
     const uint32_t modified_julian_date, // days since 17/11/1858
     const uint8_t hours, const uint8_t minutes, const uint8_t seconds, const uint16_t milliseconds,
     const bool is_leap_second, const bool is_long_form)
@@ -428,13 +803,14 @@ void Radio_FIG_Handler::OnDateTime_1(
 }
 
 // fig 0/13 - User application information
-void Radio_FIG_Handler::OnServiceComponent_5_UserApplication(
+void Radio_FIG_Handler::ApplyServiceComponent_5_UserApplication(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t service_component_id, 
     const uint16_t app_type, 
-    const uint8_t* buf, const uint8_t N)
+    tcb::span<const uint8_t> buf)
 {
     if (!m_updater) return;
+    const size_t N = buf.size();
 
     auto& s_u = m_updater->GetServiceUpdater(service_reference); 
     s_u.SetCountryID(country_id);
@@ -479,7 +855,7 @@ void Radio_FIG_Handler::OnServiceComponent_5_UserApplication(
 }
 
 // fig 0/14 - Packet mode FEC type 
-void Radio_FIG_Handler::OnSubchannel_2_FEC(
+void Radio_FIG_Handler::ApplySubchannel_2_FEC(
     const uint8_t subchannel_id, const uint8_t fec_type)
 {
     if (!m_updater) return;
@@ -489,7 +865,7 @@ void Radio_FIG_Handler::OnSubchannel_2_FEC(
 }
 
 // fig 0/17 - Programme type
-void Radio_FIG_Handler::OnService_1_ProgrammeType(
+void Radio_FIG_Handler::ApplyService_1_ProgrammeType(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t programme_type, 
     const uint8_t language_type,  const uint8_t closed_caption_type,
@@ -512,7 +888,7 @@ void Radio_FIG_Handler::OnService_1_ProgrammeType(
 }
 
 // fig 0/21 - Alternate frequency information
-void Radio_FIG_Handler::OnFrequencyInformation_1_Ensemble(
+void Radio_FIG_Handler::ApplyFrequencyInformation_1_Ensemble(
     const uint8_t country_id, const uint16_t ensemble_reference,
     const uint32_t frequency,
     const bool is_continuous_output,
@@ -529,7 +905,7 @@ void Radio_FIG_Handler::OnFrequencyInformation_1_Ensemble(
     u.SetFrequency(frequency);
 }
 
-void Radio_FIG_Handler::OnFrequencyInformation_1_RDS_PI(
+void Radio_FIG_Handler::ApplyFrequencyInformation_1_RDS_PI(
     const uint16_t rds_pi_id, const uint32_t frequency,
     const bool is_time_compensated)
 {
@@ -540,7 +916,7 @@ void Radio_FIG_Handler::OnFrequencyInformation_1_RDS_PI(
     u.AddFrequency(frequency);
 }
 
-void Radio_FIG_Handler::OnFrequencyInformation_1_DRM(
+void Radio_FIG_Handler::ApplyFrequencyInformation_1_DRM(
     const uint32_t drm_id, const uint32_t frequency,
     const bool is_time_compensated)
 {
@@ -551,7 +927,7 @@ void Radio_FIG_Handler::OnFrequencyInformation_1_DRM(
     u.AddFrequency(frequency);
 }
 
-void Radio_FIG_Handler::OnFrequencyInformation_1_AMSS(
+void Radio_FIG_Handler::ApplyFrequencyInformation_1_AMSS(
     const uint32_t amss_id, const uint32_t frequency,
     const bool is_time_compensated)
 {
@@ -563,7 +939,7 @@ void Radio_FIG_Handler::OnFrequencyInformation_1_AMSS(
 }
 
 // fig 0/24 - Other ensemble services
-void Radio_FIG_Handler::OnOtherEnsemble_1_Service(
+void Radio_FIG_Handler::ApplyOtherEnsemble_1_Service(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t ensemble_country_id, const uint16_t ensemble_reference)
 {
@@ -578,7 +954,7 @@ void Radio_FIG_Handler::OnOtherEnsemble_1_Service(
 }
 
 // fig 1/0 - Ensemble label
-void Radio_FIG_Handler::OnEnsemble_3_Label(
+void Radio_FIG_Handler::ApplyEnsemble_3_Label(
     const uint8_t country_id, const uint16_t ensemble_reference,
     const uint16_t abbreviation_field,
     tcb::span<const uint8_t> buf)
@@ -594,7 +970,7 @@ void Radio_FIG_Handler::OnEnsemble_3_Label(
 
 // fig 1/1 - Short form service identifier label
 // fig 1/5 - Long form service identifier label
-void Radio_FIG_Handler::OnService_2_Label(
+void Radio_FIG_Handler::ApplyService_2_Label(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint16_t abbreviation_field,
     tcb::span<const uint8_t> buf)
@@ -608,7 +984,7 @@ void Radio_FIG_Handler::OnService_2_Label(
 }
 
 // fig 1/4 - Non-primary service component label
-void Radio_FIG_Handler::OnServiceComponent_6_Label(
+void Radio_FIG_Handler::ApplyServiceComponent_6_Label(
     const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
     const uint8_t service_component_id,
     const uint16_t abbreviation_field,
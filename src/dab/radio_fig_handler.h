@@ -1,40 +1,80 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include "utility/span.h"
 #include "./fic/fig_handler_interface.h"
 
 class DAB_Database_Updater;
 struct DAB_Misc_Info;
 
+struct Radio_FIG_Update_Stats {
+    uint64_t nb_batches = 0;
+    // updates that created, changed or conflicted with an entity in the database
+    uint64_t nb_changed = 0;
+    // updates that matched what the database already had
+    uint64_t nb_no_change = 0;
+    // identical updates in the same batch which were only applied once
+    uint64_t nb_duplicates = 0;
+};
+
 // Connects the FIG processor to the DAB database updater
-class Radio_FIG_Handler: public FIG_Handler_Interface
+class Radio_FIG_Handler final: public FIG_Handler_Interface
 {
 private:
+    // An update is the arguments of one FIG entity which are copied into a shared byte log
+    struct Logged_Update {
+        // FIG type and extension in the upper bits and the entity id in the lower bits
+        uint64_t key;
+        uint32_t index;
+        uint32_t offset;
+        uint32_t length;
+        void (*apply)(Radio_FIG_Handler&, const uint8_t*);
+    };
     DAB_Database_Updater* m_updater = nullptr;
     DAB_Misc_Info* m_misc_info = nullptr;
+    // FIG 0/0 signalled an upcoming multiplex reconfiguration
+    bool m_is_reconfiguration_pending = false;
+    bool m_is_batching = false;
+    std::vector<Logged_Update> m_updates;
+    std::vector<uint8_t> m_update_args;
+    Radio_FIG_Update_Stats m_update_stats;
 public:
     ~Radio_FIG_Handler() override = default;
     void SetUpdater(DAB_Database_Updater* updater) { m_updater = updater; }
     void SetMiscInfo(DAB_Misc_Info* info) { m_misc_info = info; }
+    // FIGs received between these are logged and then applied in one pass by EndBatch()
+    // The updates are sorted by FIG and entity so entities that other FIGs refer to are created first
+    // and updates to the same entity are applied together
+    // NOTE: Outside of a batch each FIG is applied straight away
+    void BeginBatch();
+    void EndBatch();
+    const auto& GetUpdateStats() const { return m_update_stats; }
 public:
     // fig 0/0 - ensemble information
     void OnEnsemble_1_ID(
         const uint8_t country_id, const uint16_t ensemble_ref,
         const uint8_t change_flags, const uint8_t alarm_flag,
-        const uint8_t cif_upper, const uint8_t cif_lower) override;
+        const uint8_t cif_upper, const uint8_t cif_lower,
+        const uint8_t occurrence_change) override;
     // fig 0/1 - subchannel configuration
     // Short form for UEP
     void OnSubchannel_1_Short(
         const uint8_t subchannel_id, 
         const uint16_t start_address, 
-        const uint8_t table_switch, const uint8_t table_index) override;
+        const uint8_t table_switch, const uint8_t table_index,
+        const bool is_next_configuration) override;
     // Long form for EEP
     void OnSubchannel_1_Long(
         const uint8_t subchannel_id, 
         const uint16_t start_address, 
         const uint8_t option, const uint8_t protection_level, 
-        const uint16_t subchannel_size) override;
+        const uint16_t subchannel_size,
+        const bool is_next_configuration) override;
     // fig 0/2 - service components type
     void OnServiceComponent_1_StreamAudioType(
         const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
@@ -162,4 +202,195 @@ public:
         const uint8_t service_component_id,
         const uint16_t abbreviation_field,
         tcb::span<const uint8_t> buf) override;
+private:
+    // The FIGs are applied to the database by these
+    // fig 0/0 - ensemble information
+    void ApplyEnsemble_1_ID(
+        const uint8_t country_id, const uint16_t ensemble_ref,
+        const uint8_t change_flags, const uint8_t alarm_flag,
+        const uint8_t cif_upper, const uint8_t cif_lower,
+        const uint8_t occurrence_change);
+    // fig 0/1 - subchannel configuration
+    void ApplySubchannel_1_Short(
+        const uint8_t subchannel_id, 
+        const uint16_t start_address, 
+        const uint8_t table_switch, const uint8_t table_index,
+        const bool is_next_configuration);
+    void ApplySubchannel_1_Long(
+        const uint8_t subchannel_id, 
+        const uint16_t start_address, 
+        const uint8_t option, const uint8_t protection_level, 
+        const uint16_t subchannel_size,
+        const bool is_next_configuration);
+    // fig 0/2 - service components type
+    void ApplyServiceComponent_1_StreamAudioType(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t subchannel_id, 
+        const uint8_t audio_service_type, const bool is_primary);
+    void ApplyServiceComponent_1_StreamDataType(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t subchannel_id, 
+        const uint8_t data_service_type, const bool is_primary);
+    void ApplyServiceComponent_1_PacketDataType(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint16_t service_component_global_id, const bool is_primary);
+    // fig 0/3 - service component packet data type
+    void ApplyServiceComponent_2_PacketDataType(
+        const uint16_t service_component_global_id, const uint8_t subchannel_id,
+        const uint8_t data_service_type, 
+        const uint16_t packet_address);
+    // fig 0/5 - service component language
+    void ApplyServiceComponent_3_Short_Language(
+        const uint8_t subchannel_id, const uint8_t language);
+    void ApplyServiceComponent_3_Long_Language(
+        const uint16_t service_component_global_id, 
+        const uint8_t language);
+    // fig 0/6 - Service linking information
+    void ApplyServiceLinkage_1_LSN_Only(
+        const bool is_active_link, const bool is_hard_link, const bool is_international,
+        const uint16_t linkage_set_number);
+    void ApplyServiceLinkage_1_ServiceID(
+        const bool is_active_link, const bool is_hard_link, const bool is_international,
+        const uint16_t linkage_set_number,
+        const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code);
+    void ApplyServiceLinkage_1_RDS_PI_ID(
+        const bool is_active_link, const bool is_hard_link, const bool is_international,
+        const uint16_t linkage_set_number,
+        const uint16_t rds_pi_id, const uint8_t extended_country_code);
+    void ApplyServiceLinkage_1_DRM_ID(
+        const bool is_active_link, const bool is_hard_link, const bool is_international,
+        const uint16_t linkage_set_number,
+        const uint32_t drm_id);
+    // fig 0/7 - Configuration information
+    void ApplyConfigurationInformation_1(
+        const uint8_t nb_services, const uint16_t reconfiguration_count);
+    // fig 0/8 - Service component global definition
+    void ApplyServiceComponent_4_Short_Definition(
+        const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
+        const uint8_t service_component_id,
+        const uint8_t subchannel_id);
+    void ApplyServiceComponent_4_Long_Definition(
+        const uint8_t country_id, const uint32_t service_ref, const uint8_t extended_country_code,
+        const uint8_t service_component_id,
+        const uint16_t service_component_global_id);
+    // fig 0/9 - Ensemble country, LTO (local time offset), international table
+    void ApplyEnsemble_2_Country(
+        const uint8_t local_time_offset, const uint8_t extended_country_code, 
+        const uint8_t international_table_id);
+    void ApplyEnsemble_2_Service_Country(
+        const uint8_t local_time_offset, const uint8_t extended_country_code, 
+        const uint8_t international_table_id,
+        const uint8_t service_country_id, const uint32_t service_reference, 
+        const uint8_t service_extended_country_code);
+    // fig 0/10 - Ensemble date and time
+    void ApplyDateTime_1(
+        const uint32_t modified_julian_date, // days since 17/11/1858
+        const uint8_t hours, const uint8_t minutes, const uint8_t seconds, const uint16_t milliseconds,
+        const bool is_leap_second, const bool is_long_form);
+    // fig 0/13 - User application information
+    void ApplyServiceComponent_5_UserApplication(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t service_component_id, 
+        const uint16_t app_type, 
+        tcb::span<const uint8_t> buf);
+    // fig 0/14 - Packet mode FEC type 
+    void ApplySubchannel_2_FEC(
+        const uint8_t subchannel_id, const uint8_t fec_type);
+    // fig 0/17 - Programme type
+    void ApplyService_1_ProgrammeType(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t programme_type, 
+        const uint8_t language_type,  const uint8_t closed_caption_type,
+        const bool has_language, const bool has_closed_caption);
+    // fig 0/21 - Alternate frequency information
+    void ApplyFrequencyInformation_1_Ensemble(
+        const uint8_t country_id, const uint16_t ensemble_reference,
+        const uint32_t frequency,
+        const bool is_continuous_output,
+        const bool is_geographically_adjacent, 
+        const bool is_transmission_mode_I);
+    void ApplyFrequencyInformation_1_RDS_PI(
+        const uint16_t rds_pi_id, const uint32_t frequency,
+        const bool is_time_compensated);
+    void ApplyFrequencyInformation_1_DRM(
+        const uint32_t drm_id, const uint32_t frequency,
+        const bool is_time_compensated);
+    void ApplyFrequencyInformation_1_AMSS(
+        const uint32_t amss_id, const uint32_t frequency,
+        const bool is_time_compensated);
+    // fig 0/24 - Other ensemble services
+    void ApplyOtherEnsemble_1_Service(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t ensemble_country_id, const uint16_t ensemble_reference);
+    // fig 1/0 - Ensemble label
+    void ApplyEnsemble_3_Label(
+        const uint8_t country_id, const uint16_t ensemble_reference,
+        const uint16_t abbreviation_field,
+        tcb::span<const uint8_t> buf);
+    // fig 1/1 - Short form service identifier label
+    // fig 1/5 - Long form service identifier label
+    void ApplyService_2_Label(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint16_t abbreviation_field,
+        tcb::span<const uint8_t> buf);
+    // fig 1/4 - Non-primary service component label
+    void ApplyServiceComponent_6_Label(
+        const uint8_t country_id, const uint32_t service_reference, const uint8_t extended_country_code,
+        const uint8_t service_component_id,
+        const uint16_t abbreviation_field,
+        tcb::span<const uint8_t> buf);
+private:
+    template <auto method, typename ... Args>
+    void Submit(const uint8_t fig_type, const uint8_t fig_extension, const uint32_t entity_id, const Args ... args) {
+        if (!m_is_batching) {
+            (this->*method)(args...);
+            return;
+        }
+        Logged_Update update;
+        update.key = (uint64_t(fig_type) << 40) | (uint64_t(fig_extension) << 32) | uint64_t(entity_id);
+        update.index = uint32_t(m_updates.size());
+        update.offset = uint32_t(m_update_args.size());
+        update.length = uint32_t((GetArgSize(args) + ...));
+        m_update_args.resize(size_t(update.offset) + size_t(update.length));
+        uint8_t* data = m_update_args.data() + update.offset;
+        (WriteArg(data, args), ...);
+        update.apply = &ApplyLogged<method, Args...>;
+        m_updates.push_back(update);
+    }
+    template <auto method, typename ... Args>
+    static void ApplyLogged(Radio_FIG_Handler& self, const uint8_t* data) {
+        std::tuple<Args...> args;
+        std::apply([&data](auto& ... arg) { (ReadArg(data, arg), ...); }, args);
+        std::apply([&self](const auto& ... arg) { (self.*method)(arg...); }, args);
+    }
+    template <typename T>
+    static size_t GetArgSize(const T) {
+        static_assert(std::is_trivially_copyable_v<T>, "Logged FIG arguments must be trivially copyable");
+        return sizeof(T);
+    }
+    template <typename T>
+    static void WriteArg(uint8_t*& data, const T value) {
+        memcpy(data, &value, sizeof(T));
+        data += sizeof(T);
+    }
+    template <typename T>
+    static void ReadArg(const uint8_t*& data, T& value) {
+        memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+    }
+    // Labels and other buffers are copied into the log since the FIB is gone by the end of the batch
+    static size_t GetArgSize(tcb::span<const uint8_t> buf) {
+        return sizeof(uint32_t) + buf.size();
+    }
+    static void WriteArg(uint8_t*& data, tcb::span<const uint8_t> buf) {
+        WriteArg(data, uint32_t(buf.size()));
+        if (!buf.empty()) memcpy(data, buf.data(), buf.size());
+        data += buf.size();
+    }
+    static void ReadArg(const uint8_t*& data, tcb::span<const uint8_t>& buf) {
+        uint32_t length = 0;
+        ReadArg(data, length);
+        buf = tcb::span<const uint8_t>(data, size_t(length));
+        data += length;
+    }
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 // Supported architecture detection:
 // __ARCH_X86__
 // __ARCH_AARCH64__
+// __ARCH_RISCV__
 // __ARCH_ANY__
 
 #if defined(MSVC) || defined(_MSC_VER)
@@ -18,6 +19,8 @@
         #define __ARCH_X86__
     #elif defined(__aarch64__)
         #define __ARCH_AARCH64__
+    #elif defined(__riscv)
+        #define __ARCH_RISCV__
     #else
         #define __ARCH_ANY__
     #endif
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <stddef.h>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 #include "utility/span.h"
 
 template <typename T>
 class CircularBuffer
 {
+    static_assert(std::is_trivially_copyable_v<T>, "CircularBuffer copies with memcpy");
 private:
     tcb::span<T>& m_buf;
     size_t m_index;
@@ -26,9 +30,16 @@ public:
             nb_read = (N > N_remain) ? N_remain : N;
         }
 
-        for (size_t i = 0; i < nb_read; i++) {
-            m_buf[m_index++] = src[i];
-            m_index = m_index % capacity;
+        // Samples that would be overwritten in this call are skipped
+        const size_t nb_skip = (nb_read > capacity) ? (nb_read-capacity) : 0;
+        m_index = (m_index + nb_skip) % capacity;
+        // Copy in at most two contiguous segments
+        auto wr_src = src.subspan(nb_skip, nb_read-nb_skip);
+        while (!wr_src.empty()) {
+            const size_t nb_copy = std::min(wr_src.size(), capacity-m_index);
+            std::memcpy(&m_buf[m_index], wr_src.data(), nb_copy*sizeof(T));
+            wr_src = wr_src.subspan(nb_copy);
+            m_index = (m_index + nb_copy) % capacity;
         }
         m_length += nb_read;
         if (m_length > capacity) {
@@ -0,0 +1,216 @@
+#include "./dab_mode_detector.h"
+#include <stddef.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "utility/span.h"
+#include "./dab_ofdm_params_ref.h"
+#include "./dsp/complex_conj_mul_sum.h"
+#include "./dsp/convert_raw_iq.h"
+#include "./dsp/l1_norm_decimate.h"
+#include "./ofdm_params.h"
+
+constexpr static size_t TOTAL_MODES = 4;
+// samples that are correlated at once so the history and the block stay in the cache
+constexpr static size_t CHUNK_SIZE = 8192;
+// null symbols are within this fraction of their expected length
+constexpr static float NULL_LENGTH_TOLERANCE = 0.25f;
+
+DAB_Mode_Detector::DAB_Mode_Detector(const DAB_Mode_Detector_Config& cfg)
+: m_cfg(cfg)
+{
+    m_max_lag = 0;
+    for (size_t i = 0; i < TOTAL_MODES; i++) {
+        m_mode_params[i] = get_DAB_OFDM_params(int(i+1));
+        m_max_lag = std::max(m_max_lag, m_mode_params[i].nb_fft);
+    }
+    const auto& mode_I = m_mode_params[0];
+    const size_t frame_period_I = mode_I.nb_null_period + mode_I.nb_frame_symbols*mode_I.nb_symbol_period;
+    m_min_samples = (m_cfg.min_samples > 0) ? m_cfg.min_samples : frame_period_I;
+    m_cfg.null_l1_decimate = std::max(m_cfg.null_l1_decimate, size_t(1));
+
+    m_buffer.resize(m_max_lag + CHUNK_SIZE);
+    m_raw_buffer.resize(CHUNK_SIZE);
+    m_l1_buffer.resize(CHUNK_SIZE/m_cfg.null_l1_decimate + 1);
+    Reset();
+}
+
+void DAB_Mode_Detector::Reset() {
+    std::fill(m_buffer.begin(), m_buffer.end(), std::complex<float>(0.0f, 0.0f));
+    std::fill(m_lag_sums.begin(), m_lag_sums.end(), std::complex<double>(0.0, 0.0));
+    m_power_sum = 0.0;
+    m_total_samples = 0;
+    m_signal_l1_average = 0.0f;
+    m_l1_block_sum = 0.0f;
+    m_l1_block_length = 0;
+    m_is_null = false;
+    m_is_null_truncated = false;
+    m_null_length = 0;
+    m_null_lengths.clear();
+}
+
+void DAB_Mode_Detector::Process(tcb::span<const std::complex<float>> block) {
+    while (!block.empty()) {
+        const size_t N = std::min(block.size(), CHUNK_SIZE);
+        ProcessChunk(block.first(N));
+        block = block.subspan(N);
+    }
+}
+
+void DAB_Mode_Detector::Process(tcb::span<const RawIQ_u8> block, const float bias) {
+    while (!block.empty()) {
+        const size_t N = std::min(block.size(), CHUNK_SIZE);
+        auto raw = tcb::span<const uint8_t>(reinterpret_cast<const uint8_t*>(block.data()), N*2);
+        auto chunk = tcb::span(m_raw_buffer).first(N);
+        convert_raw_iq_auto(raw, chunk, bias);
+        ProcessChunk(chunk);
+        block = block.subspan(N);
+    }
+}
+
+void DAB_Mode_Detector::ProcessChunk(tcb::span<const std::complex<float>> chunk) {
+    const size_t N = chunk.size();
+    std::copy_n(chunk.begin(), N, m_buffer.begin() + m_max_lag);
+
+    // Each sample is correlated with the one nb_fft samples before it for every mode
+    auto buf = tcb::span<const std::complex<float>>(m_buffer);
+    auto x_late = buf.subspan(m_max_lag, N);
+    for (size_t i = 0; i < TOTAL_MODES; i++) {
+        const size_t lag = m_mode_params[i].nb_fft;
+        auto x_early = buf.subspan(m_max_lag-lag, N);
+        const auto sum = complex_conj_mul_sum_auto(x_early, x_late);
+        m_lag_sums[i] += std::complex<double>(sum.real(), sum.imag());
+    }
+    m_power_sum += double(complex_conj_mul_sum_auto(x_late, x_late).real());
+
+    // Power dips are measured over blocks of samples
+    // NOTE: Samples that don't fill a block are carried over to the next chunk
+    const size_t D = m_cfg.null_l1_decimate;
+    size_t index = 0;
+    size_t total_blocks = 0;
+    if (m_l1_block_length > 0) {
+        const size_t total_carry = std::min(D-m_l1_block_length, N);
+        for (; index < total_carry; index++) {
+            m_l1_block_sum += std::abs(chunk[index].real()) + std::abs(chunk[index].imag());
+        }
+        m_l1_block_length += total_carry;
+        if (m_l1_block_length == D) {
+            m_l1_buffer[total_blocks++] = m_l1_block_sum;
+            m_l1_block_sum = 0.0f;
+            m_l1_block_length = 0;
+        }
+    }
+    const size_t total_full_blocks = (N-index)/D;
+    if (total_full_blocks > 0) {
+        l1_norm_decimate_auto(
+            chunk.subspan(index, total_full_blocks*D),
+            tcb::span(m_l1_buffer).subspan(total_blocks, total_full_blocks)
+        );
+        index += total_full_blocks*D;
+        total_blocks += total_full_blocks;
+    }
+    for (; index < N; index++) {
+        m_l1_block_sum += std::abs(chunk[index].real()) + std::abs(chunk[index].imag());
+        m_l1_block_length++;
+    }
+    UpdateNullSearch(tcb::span(m_l1_buffer).first(total_blocks));
+
+    // Keep the last samples for the correlation with the next chunk
+    std::copy(m_buffer.begin()+N, m_buffer.begin()+N+m_max_lag, m_buffer.begin());
+    m_total_samples += N;
+}
+
+void DAB_Mode_Detector::UpdateNullSearch(tcb::span<const float> l1_blocks) {
+    if (l1_blocks.empty()) return;
+    // NOTE: The average is started from the blocks of the first chunk that are above its mean
+    //       This way a null symbol at the start doesn't lower it
+    //       A dip that starts with the first block is ignored since we don't know where it began
+    if (m_signal_l1_average <= 0.0f) {
+        float sum = 0.0f;
+        for (const float v: l1_blocks) sum += v;
+        const float mean = sum / float(l1_blocks.size());
+        float upper_sum = 0.0f;
+        size_t total_upper = 0;
+        for (const float v: l1_blocks) {
+            if (v < mean) continue;
+            upper_sum += v;
+            total_upper++;
+        }
+        m_signal_l1_average = (total_upper > 0) ? (upper_sum / float(total_upper)) : mean;
+        m_is_null_truncated = true;
+    }
+
+    size_t min_null_length = m_mode_params[0].nb_null_period;
+    for (const auto& params: m_mode_params) {
+        min_null_length = std::min(min_null_length, params.nb_null_period);
+    }
+    // short dips are from fading or noise
+    min_null_length = size_t(float(min_null_length)*(1.0f-NULL_LENGTH_TOLERANCE));
+
+    const float beta = m_cfg.signal_l1_beta;
+    for (const float v: l1_blocks) {
+        const bool is_below = v < (m_cfg.null_threshold*m_signal_l1_average);
+        if (is_below) {
+            m_is_null = true;
+            m_null_length += m_cfg.null_l1_decimate;
+            continue;
+        }
+        if (m_is_null && !m_is_null_truncated && (m_null_length >= min_null_length)) {
+            m_null_lengths.push_back(m_null_length);
+        }
+        m_is_null = false;
+        m_is_null_truncated = false;
+        m_null_length = 0;
+        // NOTE: Dips are excluded from the average so the threshold stays relative to the signal
+        m_signal_l1_average = beta*m_signal_l1_average + (1.0f-beta)*v;
+    }
+}
+
+DAB_Mode_Estimate DAB_Mode_Detector::GetEstimate() const {
+    DAB_Mode_Estimate estimate;
+    estimate.total_samples = m_total_samples;
+    if (m_power_sum <= 0.0) return estimate;
+
+    for (size_t i = 0; i < TOTAL_MODES; i++) {
+        estimate.cyclic_prefix_correlation[i] = float(std::abs(m_lag_sums[i]) / m_power_sum);
+    }
+    size_t best_mode = 0;
+    for (size_t i = 1; i < TOTAL_MODES; i++) {
+        if (estimate.cyclic_prefix_correlation[i] > estimate.cyclic_prefix_correlation[best_mode]) {
+            best_mode = i;
+        }
+    }
+    // Interference such as a DC offset is correlated at every lag so we compare against the next best mode
+    float second_best = 0.0f;
+    for (size_t i = 0; i < TOTAL_MODES; i++) {
+        if (i == best_mode) continue;
+        second_best = std::max(second_best, estimate.cyclic_prefix_correlation[i]);
+    }
+    const float contrast = estimate.cyclic_prefix_correlation[best_mode] - second_best;
+    const float cyclic_confidence = std::clamp(contrast / m_cfg.cyclic_prefix_correlation_full, 0.0f, 1.0f);
+
+    // The null length confirms the mode or lowers our confidence if it disagrees
+    float null_factor = 0.75f;
+    if (!m_null_lengths.empty()) {
+        auto lengths = m_null_lengths;
+        auto median = lengths.begin() + lengths.size()/2;
+        std::nth_element(lengths.begin(), median, lengths.end());
+        estimate.null_length = *median;
+        const float expected = float(m_mode_params[best_mode].nb_null_period);
+        const float error = std::abs(float(estimate.null_length) - expected) / expected;
+        null_factor = (error <= NULL_LENGTH_TOLERANCE) ? 1.0f : 0.5f;
+    }
+
+    estimate.confidence = cyclic_confidence*null_factor;
+    const bool is_confident = IsReady() && (estimate.confidence >= m_cfg.min_confidence);
+    estimate.transmission_mode = is_confident ? int(best_mode+1) : 0;
+    return estimate;
+}
+
+DAB_Mode_Estimate detect_DAB_transmission_mode(tcb::span<const std::complex<float>> buf, const DAB_Mode_Detector_Config& cfg) {
+    auto detector = DAB_Mode_Detector(cfg);
+    detector.Process(buf);
+    return detector.GetEstimate();
+}
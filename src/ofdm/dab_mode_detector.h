@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <array>
+#include <complex>
+#include <vector>
+#include "utility/span.h"
+#include "./dsp/convert_raw_iq.h"
+#include "./ofdm_params.h"
+
+struct DAB_Mode_Detector_Config {
+    // samples read before a mode is given (0 for the frame period of transmission mode I)
+    size_t min_samples = 0;
+    // cyclic prefix correlation above the baseline needed for full confidence
+    // NOTE: A clean DAB signal has about nb_cyclic_prefix/nb_symbol_period = 0.2
+    float cyclic_prefix_correlation_full = 0.1f;
+    // null symbols are blocks of samples whose L1 norm is below this fraction of the average
+    float null_threshold = 0.35f;
+    float signal_l1_beta = 0.999f;
+    size_t null_l1_decimate = 16;
+    // below this the estimated mode is 0 (unknown)
+    float min_confidence = 0.5f;
+};
+
+struct DAB_Mode_Estimate {
+    // 0 if the mode couldn't be determined with enough confidence
+    int transmission_mode = 0;
+    // [0,1]
+    float confidence = 0.0f;
+    // |Σ x(t)*conj[x(t+nb_fft)]| / Σ |x(t)|^2 for the nb_fft of each mode
+    std::array<float, 4> cyclic_prefix_correlation{};
+    // median length of the power dips in samples (0 if none were found)
+    size_t null_length = 0;
+    size_t total_samples = 0;
+};
+
+// Estimates the DAB transmission mode from one pass over the samples without demodulating them
+// 1. The cyclic prefix of each symbol is a copy of its last nb_cyclic_prefix samples
+//    So the signal is only correlated with itself nb_fft samples later for the nb_fft of its mode
+//    The frequency offset rotates every symbol by the same phase so this is summed over the whole input
+// 2. The length of the null symbol is measured from the dips in signal power and should agree with (1)
+// NOTE: Modes II and III have the same frame period so the null length is used instead of the frame period
+class DAB_Mode_Detector
+{
+private:
+    DAB_Mode_Detector_Config m_cfg;
+    std::array<OFDM_Params, 4> m_mode_params;
+    size_t m_max_lag;
+    size_t m_min_samples;
+    // previous m_max_lag samples followed by the block being read
+    std::vector<std::complex<float>> m_buffer;
+    std::vector<std::complex<float>> m_raw_buffer;
+    std::vector<float> m_l1_buffer;
+    // cyclic prefix correlation
+    std::array<std::complex<double>, 4> m_lag_sums;
+    double m_power_sum;
+    size_t m_total_samples;
+    // null symbol search with the L1 norm of the block of samples being summed
+    float m_signal_l1_average;
+    float m_l1_block_sum;
+    size_t m_l1_block_length;
+    bool m_is_null;
+    bool m_is_null_truncated;
+    size_t m_null_length;
+    std::vector<size_t> m_null_lengths;
+public:
+    explicit DAB_Mode_Detector(const DAB_Mode_Detector_Config& cfg={});
+    void Process(tcb::span<const std::complex<float>> block);
+    void Process(tcb::span<const RawIQ_u8> block, const float bias=127.5f);
+    void Reset();
+    size_t GetTotalSamples() const { return m_total_samples; }
+    bool IsReady() const { return m_total_samples >= m_min_samples; }
+    DAB_Mode_Estimate GetEstimate() const;
+private:
+    void ProcessChunk(tcb::span<const std::complex<float>> chunk);
+    void UpdateNullSearch(tcb::span<const float> l1_blocks);
+};
+
+// Estimate from a recording that is already in memory
+DAB_Mode_Estimate detect_DAB_transmission_mode(tcb::span<const std::complex<float>> buf, const DAB_Mode_Detector_Config& cfg={});
@@ -0,0 +1,36 @@
+#include "./dab_ofdm_tables.h"
+#include <array>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+#include <fmt/format.h>
+#include "./dab_mapper_ref.h"
+#include "./dab_ofdm_params_ref.h"
+#include "./dab_prs_ref.h"
+
+constexpr static int TOTAL_TRANSMISSION_MODES = 4;
+
+static DAB_OFDM_Tables create_DAB_OFDM_tables(const int transmission_mode) {
+    DAB_OFDM_Tables tables;
+    tables.params = get_DAB_OFDM_params(transmission_mode);
+    tables.prs_fft_ref.resize(tables.params.nb_fft);
+    tables.carrier_mapper.resize(tables.params.nb_data_carriers);
+    get_DAB_PRS_reference(transmission_mode, tables.prs_fft_ref);
+    get_DAB_mapper_ref(tables.carrier_mapper, tables.params.nb_fft);
+    return tables;
+}
+
+const DAB_OFDM_Tables& get_DAB_OFDM_tables(const int transmission_mode) {
+    if (transmission_mode <= 0 || transmission_mode > TOTAL_TRANSMISSION_MODES) {
+        throw std::runtime_error(fmt::format("Invalid transmission mode {}", transmission_mode));
+    }
+    // NOTE: Initialisation of a static local is thread safe
+    static const auto all_tables = []() {
+        std::array<DAB_OFDM_Tables, TOTAL_TRANSMISSION_MODES> tables;
+        for (int i = 0; i < TOTAL_TRANSMISSION_MODES; i++) {
+            tables[i] = create_DAB_OFDM_tables(i+1);
+        }
+        return tables;
+    }();
+    return all_tables[transmission_mode-1];
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include "./ofdm_params.h"
+
+// Reference tables of a DAB transmission mode which are shared by every modulator and demodulator
+struct DAB_OFDM_Tables {
+    OFDM_Params params;
+    // see get_DAB_PRS_reference()
+    std::vector<std::complex<float>> prs_fft_ref;
+    // see get_DAB_mapper_ref()
+    std::vector<int> carrier_mapper;
+};
+
+// The tables of all transmission modes are generated on the first call and never change afterwards
+// NOTE: This is thread safe and throws std::runtime_error for an invalid transmission mode
+const DAB_OFDM_Tables& get_DAB_OFDM_tables(const int transmission_mode);
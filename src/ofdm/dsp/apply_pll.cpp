@@ -5,6 +5,7 @@
 #include <complex>
 #include "detect_architecture.h"
 #include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 #include "utility/span.h"
 #include "./apply_pll.h"
 #include "./chebyshev_sine.h"
@@ -32,12 +33,12 @@ static void apply_pll_scalar(
 // x86
 #if defined(__ARCH_X86__)
 
-#if defined(__SSE3__)
+#if defined(SIMD_COMPILE_SSE4_1)
 #include <smmintrin.h>
 #include <xmmintrin.h>
 #include "./x86/c32_mul.h"
 
-static void apply_pll_sse3(
+SIMD_TARGET_SSE4_1 static void apply_pll_sse3(
     tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
     const float freq_norm, const float dt_norm) 
 {
@@ -74,12 +75,12 @@ static void apply_pll_sse3(
 }
 #endif
 
-#if defined(__AVX__)
+#if defined(SIMD_COMPILE_AVX)
 #include <immintrin.h>
 #include <smmintrin.h>
 #include "./x86/c32_mul.h"
 
-static void apply_pll_avx(
+SIMD_TARGET_AVX static void apply_pll_avx(
     tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
     const float freq_norm, const float dt_norm) 
 {
@@ -116,22 +117,155 @@ static void apply_pll_avx(
 }
 #endif
 
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+#include "./x86/c32_mul.h"
+
+SIMD_TARGET_AVX512 static void apply_pll_avx512(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
+    const float freq_norm, const float dt_norm) 
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+
+    // 512bits = 64bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+ 
+    const float dt_step = freq_norm;
+    alignas(64) float dt_step_pack_arr[K*2u];
+    for (size_t i = 0; i < K; i++) {
+        const float dt = float(i)*dt_step;
+        dt_step_pack_arr[2*i+0] = dt+0.25f; // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        dt_step_pack_arr[2*i+1] = dt;
+    }
+    const __m512 dt_step_pack = _mm512_load_ps(dt_step_pack_arr);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m512 dt = _mm512_set1_ps(dt_norm + float(i)*dt_step);
+        dt = _mm512_add_ps(dt, dt_step_pack);
+        // translate to [-0.5,+0.5] within chebyshev accurate range
+        constexpr int ROUND_FLAGS = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+        dt = _mm512_reduce_ps(dt, ROUND_FLAGS); // x - round(x)
+        __m512 pll = _mm512_chebyshev_sine(dt);
+        __m512 X = _mm512_loadu_ps(reinterpret_cast<const float*>(&x[i]));
+        __m512 Y = c32_mul_avx512(X, pll);
+        _mm512_storeu_ps(reinterpret_cast<float*>(&y[i]), Y);
+    }
+ 
+    const float dt_scalar = dt_norm + float(N_vector)*dt_step;
+    apply_pll_scalar(x.subspan(N_vector), y.subspan(N_vector), freq_norm, dt_scalar);
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+#include <arm_sve.h>
+
+// Vector length agnostic so the same loop uses every lane of any SVE2 implementation
+// The tail is handled by the loop predicate instead of the scalar variant
+static void apply_pll_sve2(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
+    const float freq_norm, const float dt_norm) 
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    const size_t K = svcntw();
+
+    const float dt_step = freq_norm;
+    const svbool_t all = svptrue_b32();
+    const svfloat32_t dt_step_pack = svmul_n_f32_x(all, svcvt_f32_u32_x(all, svindex_u32(0, 1)), dt_step);
+    const float* x_buf = reinterpret_cast<const float*>(x.data());
+    float* y_buf = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N; i+=K) {
+        const svbool_t pg = svwhilelt_b32(i, N);
+        svfloat32_t dt_sin = svadd_n_f32_x(pg, dt_step_pack, dt_norm + float(i)*dt_step);
+        svfloat32_t dt_cos = svadd_n_f32_x(pg, dt_sin, 0.25f); // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        // translate to [-0.5,+0.5] within chebyshev accurate range
+        dt_sin = svsub_f32_x(pg, dt_sin, svrinta_f32_x(pg, dt_sin));
+        dt_cos = svsub_f32_x(pg, dt_cos, svrinta_f32_x(pg, dt_cos));
+        const svfloat32_t cos = sve_chebyshev_sine(pg, dt_cos);
+        const svfloat32_t sin = sve_chebyshev_sine(pg, dt_sin);
+        // [r0 r1 ...] and [i0 i1 ...]
+        const svfloat32x2_t X = svld2_f32(pg, &x_buf[2*i]);
+        const svfloat32_t X_re = svget2_f32(X, 0);
+        const svfloat32_t X_im = svget2_f32(X, 1);
+        // (a+bj)(c+dj) = (ac-bd) + (ad+bc)j
+        const svfloat32_t Y_re = svmls_f32_x(pg, svmul_f32_x(pg, X_re, cos), X_im, sin);
+        const svfloat32_t Y_im = svmla_f32_x(pg, svmul_f32_x(pg, X_re, sin), X_im, cos);
+        svst2_f32(pg, &y_buf[2*i], svcreate2_f32(Y_re, Y_im));
+    }
+}
+
+#elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+#include <riscv_vector.h>
+
+// Vector length agnostic so the same loop uses every lane of any RVV implementation
+// Strided loads and stores deinterleave the real and imaginary components
+static void apply_pll_rvv(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
+    const float freq_norm, const float dt_norm) 
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    constexpr ptrdiff_t stride = ptrdiff_t(sizeof(std::complex<float>));
+
+    const float dt_step = freq_norm;
+    const float* x_buf = reinterpret_cast<const float*>(x.data());
+    float* y_buf = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0, vl = 0; i < N; i+=vl) {
+        vl = __riscv_vsetvl_e32m2(N-i);
+        const vfloat32m2_t index = __riscv_vfcvt_f_xu_v_f32m2(__riscv_vid_v_u32m2(vl), vl);
+        const vfloat32m2_t dt_start = __riscv_vfmv_v_f_f32m2(dt_norm + float(i)*dt_step, vl);
+        vfloat32m2_t dt_sin = __riscv_vfmadd_vf_f32m2(index, dt_step, dt_start, vl);
+        vfloat32m2_t dt_cos = __riscv_vfadd_vf_f32m2(dt_sin, 0.25f, vl); // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        // translate to [-0.5,+0.5] within chebyshev accurate range
+        dt_sin = __riscv_vfsub_vv_f32m2(dt_sin, __riscv_vfcvt_f_x_v_f32m2(__riscv_vfcvt_x_f_v_i32m2(dt_sin, vl), vl), vl);
+        dt_cos = __riscv_vfsub_vv_f32m2(dt_cos, __riscv_vfcvt_f_x_v_f32m2(__riscv_vfcvt_x_f_v_i32m2(dt_cos, vl), vl), vl);
+        const vfloat32m2_t cos = rvv_chebyshev_sine(dt_cos, vl);
+        const vfloat32m2_t sin = rvv_chebyshev_sine(dt_sin, vl);
+        const vfloat32m2_t X_re = __riscv_vlse32_v_f32m2(&x_buf[2*i+0], stride, vl);
+        const vfloat32m2_t X_im = __riscv_vlse32_v_f32m2(&x_buf[2*i+1], stride, vl);
+        // (a+bj)(c+dj) = (ac-bd) + (ad+bc)j
+        const vfloat32m2_t Y_re = __riscv_vfnmsac_vv_f32m2(__riscv_vfmul_vv_f32m2(X_re, cos, vl), X_im, sin, vl);
+        const vfloat32m2_t Y_im = __riscv_vfmacc_vv_f32m2(__riscv_vfmul_vv_f32m2(X_re, sin, vl), X_im, cos, vl);
+        __riscv_vsse32_v_f32m2(&y_buf[2*i+0], stride, Y_re, vl);
+        __riscv_vsse32_v_f32m2(&y_buf[2*i+1], stride, Y_im, vl);
+    }
+}
+
 #endif
 
 void apply_pll_auto(
     tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y, 
     const float freq_norm, const float dt_norm
 ) {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
     #if defined(__ARCH_X86__)
-        #if defined(__AVX__)
-        apply_pll_avx(x, y, freq_norm, dt_norm);
-        #elif defined(__SSE3__)
-        apply_pll_sse3(x, y, freq_norm, dt_norm);
-        #else
-        apply_pll_scalar(x, y, freq_norm, dt_norm);
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return apply_pll_avx512(x, y, freq_norm, dt_norm);
+        }
         #endif
-    #else
-        apply_pll_scalar(x, y, freq_norm, dt_norm);
+        #if defined(SIMD_COMPILE_AVX)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX)) {
+            return apply_pll_avx(x, y, freq_norm, dt_norm);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return apply_pll_sse3(x, y, freq_norm, dt_norm);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+        if (simd_is_level_at_least(level, SIMD_Level::SVE2)) {
+            return apply_pll_sve2(x, y, freq_norm, dt_norm);
+        }
+    #elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+        if (simd_is_level_at_least(level, SIMD_Level::RVV)) {
+            return apply_pll_rvv(x, y, freq_norm, dt_norm);
+        }
     #endif
+    (void)level;
+    apply_pll_scalar(x, y, freq_norm, dt_norm);
 }
-
@@ -0,0 +1,272 @@
+#include <assert.h>
+#include <stdalign.h> // NOLINT
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "./apply_pll_cyclic_prefix.h"
+#include "./chebyshev_sine.h"
+
+// Same phase calculation as apply_pll
+static inline std::complex<float> pll_mix_scalar(const std::complex<float> x, const float dt) {
+    float dt_sin = dt;
+    float dt_cos = dt_sin+0.25f;
+    // translate to [-0.5,+0.5] within chebyshev accurate range
+    dt_sin = dt_sin - std::round(dt_sin);
+    dt_cos = dt_cos - std::round(dt_cos);
+    const float cos = chebyshev_sine(dt_cos);
+    const float sin = chebyshev_sine(dt_sin);
+    return x * std::complex<float>(cos, sin);
+}
+
+// Processes the prefix from t_prefix and the data from t_data so the vectorised variants can finish their tails
+static std::complex<float> apply_pll_cyclic_prefix_scalar(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm,
+    const size_t t_prefix=0, const size_t t_data=0)
+{
+    const size_t N = nb_cyclic_prefix;
+    const size_t M = y.size();
+    assert(x.size() == N+M);
+    const float dt_step = freq_norm;
+    auto error = std::complex<float>(0,0);
+    // the end of the data is the copy of the prefix
+    for (size_t t = t_prefix; t < N; t++) {
+        const auto x0 = pll_mix_scalar(x[t], dt_norm + float(t)*dt_step);
+        const auto x1 = pll_mix_scalar(x[M+t], dt_norm + float(M+t)*dt_step);
+        error += x1 * std::conj(x0);
+        y[M-N+t] = x1;
+    }
+    for (size_t t = std::max(t_data, N); t < M; t++) {
+        y[t-N] = pll_mix_scalar(x[t], dt_norm + float(t)*dt_step);
+    }
+    return error;
+}
+
+// x86
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <xmmintrin.h>
+#include "./x86/c32_mul.h"
+#include "./x86/c32_conj_mul.h"
+
+SIMD_TARGET_SSE4_1 static inline __m128 pll_mix_sse3(
+    const std::complex<float>* x, const float dt, const __m128 dt_step_pack)
+{
+    __m128 DT = _mm_add_ps(_mm_set1_ps(dt), dt_step_pack);
+    // translate to [-0.5,+0.5] within chebyshev accurate range
+    constexpr int ROUND_FLAGS = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    DT = _mm_sub_ps(DT, _mm_round_ps(DT, ROUND_FLAGS));
+    const __m128 pll = _mm_chebyshev_sine(DT);
+    const __m128 X = _mm_loadu_ps(reinterpret_cast<const float*>(x));
+    return c32_mul_sse3(X, pll);
+}
+
+SIMD_TARGET_SSE4_1 static std::complex<float> apply_pll_cyclic_prefix_sse3(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm)
+{
+    const size_t N = nb_cyclic_prefix;
+    const size_t M = y.size();
+    assert(x.size() == N+M);
+
+    // 128bits = 16bytes = 2*8bytes
+    const size_t K = 2u;
+    const size_t N_prefix_vector = (N/K)*K;
+    const size_t N_data_vector = N + ((M-N)/K)*K;
+
+    const float dt_step = freq_norm;
+    alignas(16) float dt_step_pack_arr[K*2u];
+    for (size_t i = 0; i < K; i++) {
+        const float dt = float(i)*dt_step;
+        dt_step_pack_arr[2*i+0] = dt+0.25f; // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        dt_step_pack_arr[2*i+1] = dt;
+    }
+    const __m128 dt_step_pack = _mm_load_ps(dt_step_pack_arr);
+
+    __m128 error_vec = _mm_set1_ps(0.0f);
+    for (size_t t = 0; t < N_prefix_vector; t+=K) {
+        const __m128 X0 = pll_mix_sse3(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        const __m128 X1 = pll_mix_sse3(&x[M+t], dt_norm + float(M+t)*dt_step, dt_step_pack);
+        error_vec = _mm_add_ps(error_vec, c32_conj_mul_sse3(X1, X0));
+        _mm_storeu_ps(reinterpret_cast<float*>(&y[M-N+t]), X1);
+    }
+    for (size_t t = N; t < N_data_vector; t+=K) {
+        const __m128 X = pll_mix_sse3(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        _mm_storeu_ps(reinterpret_cast<float*>(&y[t-N]), X);
+    }
+
+    // [c1 c2]
+    // [c1+c2 0]
+    error_vec = _mm_add_ps(error_vec, _mm_shuffle_ps(error_vec, error_vec, 0b0000'1110));
+    auto error = std::complex<float>{
+        _mm_cvtss_f32(error_vec),
+        _mm_cvtss_f32(_mm_shuffle_ps(error_vec, error_vec, 0b000000'01)),
+    };
+    error += apply_pll_cyclic_prefix_scalar(x, y, N, freq_norm, dt_norm, N_prefix_vector, N_data_vector);
+    return error;
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX)
+#include <immintrin.h>
+#include <smmintrin.h>
+#include "./x86/c32_mul.h"
+#include "./x86/c32_conj_mul.h"
+
+SIMD_TARGET_AVX static inline __m256 pll_mix_avx(
+    const std::complex<float>* x, const float dt, const __m256 dt_step_pack)
+{
+    __m256 DT = _mm256_add_ps(_mm256_set1_ps(dt), dt_step_pack);
+    // translate to [-0.5,+0.5] within chebyshev accurate range
+    constexpr int ROUND_FLAGS = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    DT = _mm256_sub_ps(DT, _mm256_round_ps(DT, ROUND_FLAGS));
+    const __m256 pll = _mm256_chebyshev_sine(DT);
+    const __m256 X = _mm256_loadu_ps(reinterpret_cast<const float*>(x));
+    return c32_mul_avx(X, pll);
+}
+
+SIMD_TARGET_AVX static std::complex<float> apply_pll_cyclic_prefix_avx(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm)
+{
+    const size_t N = nb_cyclic_prefix;
+    const size_t M = y.size();
+    assert(x.size() == N+M);
+
+    // 256bits = 32bytes = 4*8bytes
+    const size_t K = 4u;
+    const size_t N_prefix_vector = (N/K)*K;
+    const size_t N_data_vector = N + ((M-N)/K)*K;
+
+    const float dt_step = freq_norm;
+    alignas(32) float dt_step_pack_arr[K*2u];
+    for (size_t i = 0; i < K; i++) {
+        const float dt = float(i)*dt_step;
+        dt_step_pack_arr[2*i+0] = dt+0.25f; // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        dt_step_pack_arr[2*i+1] = dt;
+    }
+    const __m256 dt_step_pack = _mm256_load_ps(dt_step_pack_arr);
+
+    __m256 error_vec = _mm256_set1_ps(0.0f);
+    for (size_t t = 0; t < N_prefix_vector; t+=K) {
+        const __m256 X0 = pll_mix_avx(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        const __m256 X1 = pll_mix_avx(&x[M+t], dt_norm + float(M+t)*dt_step, dt_step_pack);
+        error_vec = _mm256_add_ps(error_vec, c32_conj_mul_avx(X1, X0));
+        _mm256_storeu_ps(reinterpret_cast<float*>(&y[M-N+t]), X1);
+    }
+    for (size_t t = N; t < N_data_vector; t+=K) {
+        const __m256 X = pll_mix_avx(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        _mm256_storeu_ps(reinterpret_cast<float*>(&y[t-N]), X);
+    }
+
+    // [c1 c2 c3 c4]
+    // [c1+c3 c2+c4]
+    __m128 v0 = _mm_add_ps(_mm256_extractf128_ps(error_vec, 0), _mm256_extractf128_ps(error_vec, 1));
+    // [c1+c2+c3+c4 0]
+    v0 = _mm_add_ps(v0, _mm_permute_ps(v0, 0b0000'1110));
+    auto error = std::complex<float>{
+        _mm_cvtss_f32(v0),
+        _mm_cvtss_f32(_mm_permute_ps(v0, 0b000000'01)),
+    };
+    error += apply_pll_cyclic_prefix_scalar(x, y, N, freq_norm, dt_norm, N_prefix_vector, N_data_vector);
+    return error;
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+#include "./x86/c32_mul.h"
+#include "./x86/c32_conj_mul.h"
+
+SIMD_TARGET_AVX512 static inline __m512 pll_mix_avx512(
+    const std::complex<float>* x, const float dt, const __m512 dt_step_pack)
+{
+    __m512 DT = _mm512_add_ps(_mm512_set1_ps(dt), dt_step_pack);
+    constexpr int ROUND_FLAGS = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+    DT = _mm512_reduce_ps(DT, ROUND_FLAGS); // x - round(x)
+    const __m512 pll = _mm512_chebyshev_sine(DT);
+    const __m512 X = _mm512_loadu_ps(reinterpret_cast<const float*>(x));
+    return c32_mul_avx512(X, pll);
+}
+
+SIMD_TARGET_AVX512 static std::complex<float> apply_pll_cyclic_prefix_avx512(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm)
+{
+    const size_t N = nb_cyclic_prefix;
+    const size_t M = y.size();
+    assert(x.size() == N+M);
+
+    // 512bits = 64bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t N_prefix_vector = (N/K)*K;
+    const size_t N_data_vector = N + ((M-N)/K)*K;
+
+    const float dt_step = freq_norm;
+    alignas(64) float dt_step_pack_arr[K*2u];
+    for (size_t i = 0; i < K; i++) {
+        const float dt = float(i)*dt_step;
+        dt_step_pack_arr[2*i+0] = dt+0.25f; // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        dt_step_pack_arr[2*i+1] = dt;
+    }
+    const __m512 dt_step_pack = _mm512_load_ps(dt_step_pack_arr);
+
+    __m512 error_vec = _mm512_set1_ps(0.0f);
+    for (size_t t = 0; t < N_prefix_vector; t+=K) {
+        const __m512 X0 = pll_mix_avx512(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        const __m512 X1 = pll_mix_avx512(&x[M+t], dt_norm + float(M+t)*dt_step, dt_step_pack);
+        error_vec = _mm512_add_ps(error_vec, c32_conj_mul_avx512(X1, X0));
+        _mm512_storeu_ps(reinterpret_cast<float*>(&y[M-N+t]), X1);
+    }
+    for (size_t t = N; t < N_data_vector; t+=K) {
+        const __m512 X = pll_mix_avx512(&x[t], dt_norm + float(t)*dt_step, dt_step_pack);
+        _mm512_storeu_ps(reinterpret_cast<float*>(&y[t-N]), X);
+    }
+
+    // NOTE: This is only done once so we avoid the 512bit horizontal adds
+    alignas(64) float error_arr[K*2u];
+    _mm512_store_ps(error_arr, error_vec);
+    auto error = std::complex<float>(0,0);
+    for (size_t i = 0; i < K; i++) {
+        error += std::complex<float>(error_arr[2*i+0], error_arr[2*i+1]);
+    }
+    error += apply_pll_cyclic_prefix_scalar(x, y, N, freq_norm, dt_norm, N_prefix_vector, N_data_vector);
+    return error;
+}
+#endif
+
+#endif
+
+std::complex<float> apply_pll_cyclic_prefix_auto(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm
+) {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return apply_pll_cyclic_prefix_avx512(x, y, nb_cyclic_prefix, freq_norm, dt_norm);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX)) {
+            return apply_pll_cyclic_prefix_avx(x, y, nb_cyclic_prefix, freq_norm, dt_norm);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return apply_pll_cyclic_prefix_sse3(x, y, nb_cyclic_prefix, freq_norm, dt_norm);
+        }
+        #endif
+    #endif
+    (void)level;
+    return apply_pll_cyclic_prefix_scalar(x, y, nb_cyclic_prefix, freq_norm, dt_norm);
+}
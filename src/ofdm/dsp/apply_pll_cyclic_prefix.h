@@ -0,0 +1,15 @@
+#pragma once
+
+#include <complex>
+#include "utility/span.h"
+
+// Fused PLL, cyclic prefix correlation and cyclic prefix removal of an OFDM symbol
+// x = [prefix(N), data(M)] and y = data(M) where x'(t) = x(t) * [cos(2πft) + j*sin(2πft)]
+// y(t) = x'(N+t) for t in [0,M)
+// returns Σ x'(M+t) * conj[x'(t)] for t in [0,N)
+// NOTE: Each sample of x is read once so this replaces apply_pll, complex_conj_mul_sum and the copy into the FFT
+// freq_norm = frequency/sampling_rate
+std::complex<float> apply_pll_cyclic_prefix_auto(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t nb_cyclic_prefix, const float freq_norm, const float dt_norm=0.0f
+);
@@ -0,0 +1,41 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include "utility/span.h"
+#include "./apply_pll_q15.h"
+#include "./chebyshev_sine.h"
+#include "./quantise_q15.h"
+
+// Cycles to the phase accumulator where 2^32 is one cycle
+static inline uint32_t get_phase_q32(const float dt) {
+    const double cycles = double(dt) - std::floor(double(dt));
+    return uint32_t(int64_t(cycles * 4294967296.0));
+}
+
+static inline int16_t saturate_q15(const int32_t x) {
+    return int16_t((x > 32767) ? 32767 : ((x < -32767) ? -32767 : x));
+}
+
+void apply_pll_q15_auto(
+    tcb::span<const Complex_Q15> x, tcb::span<Complex_Q15> y,
+    const float freq_norm, const float dt_norm)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    // NOTE: The phase step is signed so it is added as the two's complement
+    const uint32_t phase_step = uint32_t(int32_t(std::lround(double(freq_norm) * 4294967296.0)));
+    constexpr uint32_t QUARTER_CYCLE = uint32_t(1) << 30;
+    uint32_t phase = get_phase_q32(dt_norm);
+    for (size_t i = 0; i < N; i++) {
+        // f(x) = cos(2*PI*x) = sin[2*PI*(x+0.25)]
+        const int32_t cos = chebyshev_sine_q15(int32_t(phase + QUARTER_CYCLE));
+        const int32_t sin = chebyshev_sine_q15(int32_t(phase));
+        const int32_t re = int32_t(x[i].re);
+        const int32_t im = int32_t(x[i].im);
+        const int32_t rounding = int32_t(1) << 14;
+        y[i].re = saturate_q15((re*cos - im*sin + rounding) >> 15);
+        y[i].im = saturate_q15((re*sin + im*cos + rounding) >> 15);
+        phase += phase_step;
+    }
+}
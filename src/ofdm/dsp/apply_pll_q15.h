@@ -0,0 +1,11 @@
+#pragma once
+
+#include "utility/span.h"
+#include "./quantise_q15.h"
+
+// Fixed point variant of apply_pll_auto() where the phase is a 32bit accumulator that wraps every cycle
+// freq_norm = frequency/sampling_rate
+void apply_pll_q15_auto(
+    tcb::span<const Complex_Q15> x, tcb::span<Complex_Q15> y,
+    const float freq_norm, const float dt_norm=0.0f
+);
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <stdint.h>
 #include "detect_architecture.h"
 #include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 
 // SOURCE: https://gist.github.com/williamyang98/7aca0ca0f1978c7374a66002892e0d8a
 //         Chebyshev polynomial that approximates f(x) = sin(2*pi*x) accurately within [-0.5,+0.5]
@@ -40,6 +42,33 @@ static float chebyshev_sine(float x) {
     return b0 * (z-0.25f) * x;
 }
 
+// Fixed point evaluation of the same polynomial for targets without fast floating point
+// x = phase/2^32 so the full range of phase is [-0.5,+0.5) and wraps around like the angle
+// Coefficients and partial sums are Q24 (|g(x)| < 128) and x, z = x^2 are Q32
+// Returns sin(2*pi*x) in Q15
+static inline int16_t chebyshev_sine_q15(const int32_t phase) {
+    constexpr auto to_q24 = [](const float a) { return int64_t(a*float(1 << 24)); };
+    constexpr int64_t A0 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[0]);
+    constexpr int64_t A1 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[1]);
+    constexpr int64_t A2 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[2]);
+    constexpr int64_t A3 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[3]);
+    constexpr int64_t A4 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[4]);
+    constexpr int64_t A5 = to_q24(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[5]);
+    const int64_t x = phase;
+    const int64_t z = (x*x) >> 32;    // Q32
+    const int64_t b5 = A5;
+    const int64_t b4 = ((b5*z) >> 32) + A4;
+    const int64_t b3 = ((b4*z) >> 32) + A3;
+    const int64_t b2 = ((b3*z) >> 32) + A2;
+    const int64_t b1 = ((b2*z) >> 32) + A1;
+    const int64_t b0 = ((b1*z) >> 32) + A0;
+    // f(x) = g(x) * (z-0.25) * x
+    const int64_t c0 = (b0*(z - (int64_t(1) << 30))) >> 32; // Q24
+    // Q24*Q32 = Q56 => Q15
+    const int64_t y = (c0*x + (int64_t(1) << 40)) >> 41;
+    return int16_t((y > 32767) ? 32767 : ((y < -32767) ? -32767 : y));
+}
+
 // x86
 #if defined(__ARCH_X86__)
 #include <immintrin.h>
@@ -75,8 +104,8 @@ static inline __m128 _mm_chebyshev_sine(__m128 x) {
 }
 #endif
 
-#if defined(__AVX__)
-static inline __m256 _mm256_chebyshev_sine(__m256 x) {
+#if defined(SIMD_COMPILE_AVX)
+SIMD_TARGET_AVX static inline __m256 _mm256_chebyshev_sine(__m256 x) {
     const __m256 A0 = _mm256_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[0]);
     const __m256 A1 = _mm256_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[1]);
     const __m256 A2 = _mm256_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[2]);
@@ -105,4 +134,68 @@ static inline __m256 _mm256_chebyshev_sine(__m256 x) {
 }
 #endif
 
+#if defined(SIMD_COMPILE_AVX512)
+SIMD_TARGET_AVX512 static inline __m512 _mm512_chebyshev_sine(__m512 x) {
+    const __m512 A0 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[0]);
+    const __m512 A1 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[1]);
+    const __m512 A2 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[2]);
+    const __m512 A3 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[3]);
+    const __m512 A4 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[4]);
+    const __m512 A5 = _mm512_set1_ps(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[5]);
+    // Calculate g(x) = a5*x^10 + a4*x^8 + a3*x^6 + a2*x^4 + a1*x^2 + a0
+    // NOTE: AVX512F always has fused multiply add
+    const __m512 z = _mm512_mul_ps(x,x);        // z = x^2
+    const __m512 b5 = A5;                       // a5*z^0
+    const __m512 b4 = _mm512_fmadd_ps(b5,z,A4); // a5*z^1 + a4*z^0
+    const __m512 b3 = _mm512_fmadd_ps(b4,z,A3); // a5*z^2 + a4*z^1 + a3*z^0
+    const __m512 b2 = _mm512_fmadd_ps(b3,z,A2); // a5*z^3 + a4*z^2 + a3*z^1 + a2*z^0
+    const __m512 b1 = _mm512_fmadd_ps(b2,z,A1); // a5*z^4 + a4*z^3 + a3*z^2 + a2*z^1 + a1*z^0
+    const __m512 b0 = _mm512_fmadd_ps(b1,z,A0); // a5*z^5 + a4*z^4 + a3*z^3 + a2*z^2 + a1*z^1 + a0*z^0
+    // Calculate f(x) = g(x) * (x-0.5) * (x+0.5) * x
+    //           f(x) = g(x) * (x^2 - 0.25) * x
+    //           f(x) = g(x) * (z-0.25) * x
+    const __m512 c0 = _mm512_sub_ps(z,_mm512_set1_ps(0.25f));
+    return _mm512_mul_ps(_mm512_mul_ps(b0,c0),x);
+}
+#endif
+
+#endif
+
+// ARM scalable vectors
+#if defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+#include <arm_sve.h>
+static inline svfloat32_t sve_chebyshev_sine(const svbool_t pg, svfloat32_t x) {
+    // Calculate g(x) = a5*x^10 + a4*x^8 + a3*x^6 + a2*x^4 + a1*x^2 + a0
+    const svfloat32_t z = svmul_f32_x(pg, x, x);                                       // z = x^2
+    const svfloat32_t b5 = svdup_n_f32(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[5]);          // a5*z^0
+    const svfloat32_t b4 = svmad_n_f32_x(pg, b5, z, CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[4]); // a5*z^1 + a4*z^0
+    const svfloat32_t b3 = svmad_n_f32_x(pg, b4, z, CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[3]); // a5*z^2 + a4*z^1 + a3*z^0
+    const svfloat32_t b2 = svmad_n_f32_x(pg, b3, z, CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[2]); // a5*z^3 + a4*z^2 + a3*z^1 + a2*z^0
+    const svfloat32_t b1 = svmad_n_f32_x(pg, b2, z, CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[1]); // a5*z^4 + a4*z^3 + a3*z^2 + a2*z^1 + a1*z^0
+    const svfloat32_t b0 = svmad_n_f32_x(pg, b1, z, CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[0]); // a5*z^5 + a4*z^4 + a3*z^3 + a2*z^2 + a1*z^1 + a0*z^0
+    // Calculate f(x) = g(x) * (z-0.25) * x
+    const svfloat32_t c0 = svsub_n_f32_x(pg, z, 0.25f);
+    return svmul_f32_x(pg, svmul_f32_x(pg, b0, c0), x);
+}
+#endif
+
+// RISC-V vector extension
+#if defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+#include <riscv_vector.h>
+static inline vfloat32m2_t rvv_chebyshev_sine(vfloat32m2_t x, const size_t vl) {
+    // Calculate g(x) = a5*x^10 + a4*x^8 + a3*x^6 + a2*x^4 + a1*x^2 + a0
+    // NOTE: vfmadd(vd,vs1,vs2) = vd*vs1 + vs2
+    #define __coefficient(i) __riscv_vfmv_v_f_f32m2(CHEBYSHEV_POLYNOMIAL_COEFFICIENTS[i], vl)
+    const vfloat32m2_t z = __riscv_vfmul_vv_f32m2(x, x, vl);                       // z = x^2
+    const vfloat32m2_t b5 = __coefficient(5);                                      // a5*z^0
+    const vfloat32m2_t b4 = __riscv_vfmadd_vv_f32m2(b5, z, __coefficient(4), vl); // a5*z^1 + a4*z^0
+    const vfloat32m2_t b3 = __riscv_vfmadd_vv_f32m2(b4, z, __coefficient(3), vl); // a5*z^2 + a4*z^1 + a3*z^0
+    const vfloat32m2_t b2 = __riscv_vfmadd_vv_f32m2(b3, z, __coefficient(2), vl); // a5*z^3 + a4*z^2 + a3*z^1 + a2*z^0
+    const vfloat32m2_t b1 = __riscv_vfmadd_vv_f32m2(b2, z, __coefficient(1), vl); // a5*z^4 + a4*z^3 + a3*z^2 + a2*z^1 + a1*z^0
+    const vfloat32m2_t b0 = __riscv_vfmadd_vv_f32m2(b1, z, __coefficient(0), vl); // a5*z^5 + a4*z^4 + a3*z^3 + a2*z^2 + a1*z^1 + a0*z^0
+    #undef __coefficient
+    // Calculate f(x) = g(x) * (z-0.25) * x
+    const vfloat32m2_t c0 = __riscv_vfsub_vf_f32m2(z, 0.25f, vl);
+    return __riscv_vfmul_vv_f32m2(__riscv_vfmul_vv_f32m2(b0, c0, vl), x, vl);
+}
 #endif
@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <stddef.h>
+#include <complex>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "./complex_conj_mul.h"
+
+static void complex_conj_mul_scalar(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y)
+{
+    // DOC: docs/DAB_implementation_in_SDR_detailed.pdf
+    // Clause 3.15 - Differential demodulator
+    assert(x0.size() == x1.size());
+    assert(x0.size() == y.size());
+    const size_t N = x0.size();
+    for (size_t i = 0; i < N; i++) {
+        y[i] = x0[i] * std::conj(x1[i]);
+    }
+}
+
+#if defined(__ARCH_X86__)
+#include "./x86/c32_conj_mul.h"
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <xmmintrin.h>
+SIMD_TARGET_SSE4_1 static void complex_conj_mul_sse3(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y)
+{
+    assert(x0.size() == x1.size());
+    assert(x0.size() == y.size());
+    const size_t N = x0.size();
+
+    // 128bits = 16bytes = 2*8bytes
+    const size_t K = 2u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m128 X0 = _mm_loadu_ps(reinterpret_cast<const float*>(&x0[i]));
+        __m128 X1 = _mm_loadu_ps(reinterpret_cast<const float*>(&x1[i]));
+        __m128 Y = c32_conj_mul_sse3(X0, X1);
+        _mm_storeu_ps(reinterpret_cast<float*>(&y[i]), Y);
+    }
+
+    complex_conj_mul_scalar(x0.subspan(N_vector), x1.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX)
+#include <immintrin.h>
+SIMD_TARGET_AVX static void complex_conj_mul_avx(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y)
+{
+    assert(x0.size() == x1.size());
+    assert(x0.size() == y.size());
+    const size_t N = x0.size();
+
+    // 256bits = 32bytes = 4*8bytes
+    const size_t K = 4u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m256 X0 = _mm256_loadu_ps(reinterpret_cast<const float*>(&x0[i]));
+        __m256 X1 = _mm256_loadu_ps(reinterpret_cast<const float*>(&x1[i]));
+        __m256 Y = c32_conj_mul_avx(X0, X1);
+        _mm256_storeu_ps(reinterpret_cast<float*>(&y[i]), Y);
+    }
+
+    complex_conj_mul_scalar(x0.subspan(N_vector), x1.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+SIMD_TARGET_AVX512 static void complex_conj_mul_avx512(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y)
+{
+    assert(x0.size() == x1.size());
+    assert(x0.size() == y.size());
+    const size_t N = x0.size();
+
+    // 512bits = 64bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m512 X0 = _mm512_loadu_ps(reinterpret_cast<const float*>(&x0[i]));
+        __m512 X1 = _mm512_loadu_ps(reinterpret_cast<const float*>(&x1[i]));
+        __m512 Y = c32_conj_mul_avx512(X0, X1);
+        _mm512_storeu_ps(reinterpret_cast<float*>(&y[i]), Y);
+    }
+
+    complex_conj_mul_scalar(x0.subspan(N_vector), x1.subspan(N_vector), y.subspan(N_vector));
+}
+#endif
+
+#endif
+
+void complex_conj_mul_auto(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y)
+{
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return complex_conj_mul_avx512(x0, x1, y);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX)) {
+            return complex_conj_mul_avx(x0, x1, y);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return complex_conj_mul_sse3(x0, x1, y);
+        }
+        #endif
+    #endif
+    (void)level;
+    complex_conj_mul_scalar(x0, x1, y);
+}
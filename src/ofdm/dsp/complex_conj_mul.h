@@ -0,0 +1,10 @@
+#pragma once
+
+#include <complex>
+#include "utility/span.h"
+
+void complex_conj_mul_auto(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1,
+    tcb::span<std::complex<float>> y
+);
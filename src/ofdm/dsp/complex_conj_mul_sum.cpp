@@ -1,8 +1,10 @@
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <complex>
 #include "detect_architecture.h"
 #include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 #include "utility/span.h"
 #include "./complex_conj_mul_sum.h"
 
@@ -24,9 +26,9 @@ std::complex<float> complex_conj_mul_sum_scalar(
 #if defined(__ARCH_X86__)
 #include "./x86/c32_conj_mul.h"
 
-#if defined(__SSE3__)
+#if defined(SIMD_COMPILE_SSE4_1)
 #include <xmmintrin.h>
-std::complex<float> complex_conj_mul_sum_sse3(
+SIMD_TARGET_SSE4_1 std::complex<float> complex_conj_mul_sum_sse3(
     tcb::span<const std::complex<float>> x0,
     tcb::span<const std::complex<float>> x1)
 {
@@ -60,9 +62,9 @@ std::complex<float> complex_conj_mul_sum_sse3(
 }
 #endif
 
-#if defined(__AVX__)
+#if defined(SIMD_COMPILE_AVX)
 #include <immintrin.h>
-std::complex<float> complex_conj_mul_sum_avx(
+SIMD_TARGET_AVX std::complex<float> complex_conj_mul_sum_avx(
     tcb::span<const std::complex<float>> x0,
     tcb::span<const std::complex<float>> x1)
 {
@@ -99,21 +101,155 @@ std::complex<float> complex_conj_mul_sum_avx(
 }
 #endif
 
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+SIMD_TARGET_AVX512 std::complex<float> complex_conj_mul_sum_avx512(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1)
+{
+    assert(x0.size() == x1.size());
+    const size_t N = x0.size();
+
+    // 512bits = 64bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    __m512 Y_vec = _mm512_set1_ps(0.0f);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m512 X0 = _mm512_loadu_ps(reinterpret_cast<const float*>(&x0[i]));
+        __m512 X1 = _mm512_loadu_ps(reinterpret_cast<const float*>(&x1[i]));
+        __m512 Y = c32_conj_mul_avx512(X0, X1);
+        Y_vec = _mm512_add_ps(Y, Y_vec);
+    }
+
+    // Perform cumulative sum
+    // NOTE: This is only done once so we avoid the 512bit horizontal adds
+    alignas(64) float Y_arr[K*2u];
+    _mm512_store_ps(Y_arr, Y_vec);
+    auto y = std::complex<float>(0,0);
+    for (size_t i = 0; i < K; i++) {
+        y += std::complex<float>(Y_arr[2*i+0], Y_arr[2*i+1]);
+    }
+
+    y += complex_conj_mul_sum_scalar(x0.subspan(N_vector), x1.subspan(N_vector));
+    return y;
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+#include <arm_sve.h>
+// Vector length agnostic where the inactive lanes of the tail leave the accumulators unchanged
+std::complex<float> complex_conj_mul_sum_sve2(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1)
+{
+    assert(x0.size() == x1.size());
+    const size_t N = x0.size();
+    const size_t K = svcntw();
+
+    const float* x0_buf = reinterpret_cast<const float*>(x0.data());
+    const float* x1_buf = reinterpret_cast<const float*>(x1.data());
+    svfloat32_t Y_re = svdup_n_f32(0.0f);
+    svfloat32_t Y_im = svdup_n_f32(0.0f);
+    for (size_t i = 0; i < N; i+=K) {
+        const svbool_t pg = svwhilelt_b32(i, N);
+        const svfloat32x2_t X0 = svld2_f32(pg, &x0_buf[2*i]);
+        const svfloat32x2_t X1 = svld2_f32(pg, &x1_buf[2*i]);
+        const svfloat32_t a = svget2_f32(X0, 0), b = svget2_f32(X0, 1);
+        const svfloat32_t c = svget2_f32(X1, 0), d = svget2_f32(X1, 1);
+        // (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+        Y_re = svmla_f32_m(pg, svmla_f32_m(pg, Y_re, a, c), b, d);
+        Y_im = svmls_f32_m(pg, svmla_f32_m(pg, Y_im, b, c), a, d);
+    }
+
+    const svbool_t all = svptrue_b32();
+    return std::complex<float>{ svaddv_f32(all, Y_re), svaddv_f32(all, Y_im) };
+}
+
+#elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+#include <riscv_vector.h>
+// Vector length agnostic where the tail undisturbed accumulators keep the sums of the inactive lanes
+std::complex<float> complex_conj_mul_sum_rvv(
+    tcb::span<const std::complex<float>> x0,
+    tcb::span<const std::complex<float>> x1)
+{
+    assert(x0.size() == x1.size());
+    const size_t N = x0.size();
+    constexpr ptrdiff_t stride = ptrdiff_t(sizeof(std::complex<float>));
+
+    const size_t vl_max = __riscv_vsetvlmax_e32m2();
+    const float* x0_buf = reinterpret_cast<const float*>(x0.data());
+    const float* x1_buf = reinterpret_cast<const float*>(x1.data());
+    vfloat32m2_t Y_re = __riscv_vfmv_v_f_f32m2(0.0f, vl_max);
+    vfloat32m2_t Y_im = __riscv_vfmv_v_f_f32m2(0.0f, vl_max);
+    for (size_t i = 0, vl = 0; i < N; i+=vl) {
+        vl = __riscv_vsetvl_e32m2(N-i);
+        const vfloat32m2_t a = __riscv_vlse32_v_f32m2(&x0_buf[2*i+0], stride, vl);
+        const vfloat32m2_t b = __riscv_vlse32_v_f32m2(&x0_buf[2*i+1], stride, vl);
+        const vfloat32m2_t c = __riscv_vlse32_v_f32m2(&x1_buf[2*i+0], stride, vl);
+        const vfloat32m2_t d = __riscv_vlse32_v_f32m2(&x1_buf[2*i+1], stride, vl);
+        // (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+        Y_re = __riscv_vfmacc_vv_f32m2_tu(__riscv_vfmacc_vv_f32m2_tu(Y_re, a, c, vl), b, d, vl);
+        Y_im = __riscv_vfnmsac_vv_f32m2_tu(__riscv_vfmacc_vv_f32m2_tu(Y_im, b, c, vl), a, d, vl);
+    }
+
+    const vfloat32m1_t zero = __riscv_vfmv_v_f_f32m1(0.0f, 1);
+    return std::complex<float>{
+        __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredusum_vs_f32m2_f32m1(Y_re, zero, vl_max)),
+        __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredusum_vs_f32m2_f32m1(Y_im, zero, vl_max)),
+    };
+}
+
 #endif
 
 std::complex<float> complex_conj_mul_sum_auto(
     tcb::span<const std::complex<float>> x0,
     tcb::span<const std::complex<float>> x1)
 {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
     #if defined(__ARCH_X86__)
-        #if defined(__AVX__)
-        return complex_conj_mul_sum_avx(x0, x1);
-        #elif defined(__SSE3__)
-        return complex_conj_mul_sum_sse3(x0, x1);
-        #else
-        return complex_conj_mul_sum_scalar(x0, x1);
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return complex_conj_mul_sum_avx512(x0, x1);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX)) {
+            return complex_conj_mul_sum_avx(x0, x1);
+        }
         #endif
-    #else
-        return complex_conj_mul_sum_scalar(x0, x1);
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return complex_conj_mul_sum_sse3(x0, x1);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__) && defined(SIMD_COMPILE_SVE2)
+        if (simd_is_level_at_least(level, SIMD_Level::SVE2)) {
+            return complex_conj_mul_sum_sve2(x0, x1);
+        }
+    #elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+        if (simd_is_level_at_least(level, SIMD_Level::RVV)) {
+            return complex_conj_mul_sum_rvv(x0, x1);
+        }
     #endif
-}
\ No newline at end of file
+    (void)level;
+    return complex_conj_mul_sum_scalar(x0, x1);
+}
+std::complex<float> complex_conj_mul_sum_auto(
+    tcb::span<const Complex_Q15> x0,
+    tcb::span<const Complex_Q15> x1)
+{
+    assert(x0.size() == x1.size());
+    const size_t N = x0.size();
+    int64_t y_re = 0;
+    int64_t y_im = 0;
+    for (size_t i = 0; i < N; i++) {
+        const int32_t a = x0[i].re, b = x0[i].im;
+        const int32_t c = x1[i].re, d = x1[i].im;
+        y_re += int64_t(a*c + b*d);
+        y_im += int64_t(b*c - a*d);
+    }
+    return std::complex<float>(float(y_re), float(y_im));
+}
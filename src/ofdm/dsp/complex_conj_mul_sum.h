@@ -1,9 +1,16 @@
 #pragma once
 
 #include <complex>
+#include "./quantise_q15.h"
 #include "utility/span.h"
 
 std::complex<float> complex_conj_mul_sum_auto(
     tcb::span<const std::complex<float>> x0,
     tcb::span<const std::complex<float>> x1
 );
+
+// Fixed point variant with the sum accumulated exactly in 64bits
+std::complex<float> complex_conj_mul_sum_auto(
+    tcb::span<const Complex_Q15> x0,
+    tcb::span<const Complex_Q15> x1
+);
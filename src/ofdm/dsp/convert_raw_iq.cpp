@@ -0,0 +1,387 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <type_traits>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "./convert_raw_iq.h"
+
+// The bias, dc offset and gain are folded into y = x*scale + offset for each of I and Q
+struct Raw_IQ_Affine {
+    float scale_I;
+    float scale_Q;
+    float offset_I;
+    float offset_Q;
+};
+
+static Raw_IQ_Affine get_raw_iq_affine(const float bias, const Raw_IQ_Correction& correction) {
+    Raw_IQ_Affine affine;
+    affine.scale_I = correction.gain.real();
+    affine.scale_Q = correction.gain.imag();
+    affine.offset_I = -(bias + correction.dc_offset.real()) * affine.scale_I;
+    affine.offset_Q = -(bias + correction.dc_offset.imag()) * affine.scale_Q;
+    return affine;
+}
+
+template <typename T>
+static void convert_raw_iq_scalar(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+    for (size_t i = 0; i < N; i++) {
+        y[i] = std::complex<float>(
+            float(x[2*i+0])*affine.scale_I + affine.offset_I,
+            float(x[2*i+1])*affine.scale_Q + affine.offset_Q
+        );
+    }
+}
+
+// x86
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+#include <xmmintrin.h>
+
+template <typename T>
+SIMD_TARGET_SSE4_1 static void convert_raw_iq_sse4_1(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 16 bytes of input = 8 samples = 4*128bits of output
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const __m128 scale = _mm_setr_ps(affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q);
+    const __m128 offset = _mm_setr_ps(affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i]));
+        __m128i X0, X1, X2, X3;
+        if constexpr (std::is_signed_v<T>) {
+            X0 = _mm_cvtepi8_epi32(X);
+            X1 = _mm_cvtepi8_epi32(_mm_srli_si128(X, 4));
+            X2 = _mm_cvtepi8_epi32(_mm_srli_si128(X, 8));
+            X3 = _mm_cvtepi8_epi32(_mm_srli_si128(X, 12));
+        } else {
+            X0 = _mm_cvtepu8_epi32(X);
+            X1 = _mm_cvtepu8_epi32(_mm_srli_si128(X, 4));
+            X2 = _mm_cvtepu8_epi32(_mm_srli_si128(X, 8));
+            X3 = _mm_cvtepu8_epi32(_mm_srli_si128(X, 12));
+        }
+        const __m128 Y0 = _mm_cvtepi32_ps(X0);
+        const __m128 Y1 = _mm_cvtepi32_ps(X1);
+        const __m128 Y2 = _mm_cvtepi32_ps(X2);
+        const __m128 Y3 = _mm_cvtepi32_ps(X3);
+        _mm_storeu_ps(&y_out[2*i +  0], _mm_add_ps(_mm_mul_ps(Y0, scale), offset));
+        _mm_storeu_ps(&y_out[2*i +  4], _mm_add_ps(_mm_mul_ps(Y1, scale), offset));
+        _mm_storeu_ps(&y_out[2*i +  8], _mm_add_ps(_mm_mul_ps(Y2, scale), offset));
+        _mm_storeu_ps(&y_out[2*i + 12], _mm_add_ps(_mm_mul_ps(Y3, scale), offset));
+    }
+
+    convert_raw_iq_scalar<T>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+
+SIMD_TARGET_SSE4_1 static void convert_raw_iq_s16_sse4_1(
+    tcb::span<const int16_t> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 16 bytes of input = 4 samples = 2*128bits of output
+    const size_t K = 4u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const __m128 scale = _mm_setr_ps(affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q);
+    const __m128 offset = _mm_setr_ps(affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i]));
+        const __m128 Y0 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(X));
+        const __m128 Y1 = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(X, 8)));
+        _mm_storeu_ps(&y_out[2*i + 0], _mm_add_ps(_mm_mul_ps(Y0, scale), offset));
+        _mm_storeu_ps(&y_out[2*i + 4], _mm_add_ps(_mm_mul_ps(Y1, scale), offset));
+    }
+
+    convert_raw_iq_scalar<int16_t>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+
+template <typename T>
+SIMD_TARGET_AVX2 static void convert_raw_iq_avx2(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 16 bytes of input = 8 samples = 2*256bits of output
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const __m256 scale = _mm256_setr_ps(
+        affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q,
+        affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q);
+    const __m256 offset = _mm256_setr_ps(
+        affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q,
+        affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i]));
+        __m256i X0, X1;
+        if constexpr (std::is_signed_v<T>) {
+            X0 = _mm256_cvtepi8_epi32(X);
+            X1 = _mm256_cvtepi8_epi32(_mm_srli_si128(X, 8));
+        } else {
+            X0 = _mm256_cvtepu8_epi32(X);
+            X1 = _mm256_cvtepu8_epi32(_mm_srli_si128(X, 8));
+        }
+        const __m256 Y0 = _mm256_cvtepi32_ps(X0);
+        const __m256 Y1 = _mm256_cvtepi32_ps(X1);
+        _mm256_storeu_ps(&y_out[2*i + 0], _mm256_fmadd_ps(Y0, scale, offset));
+        _mm256_storeu_ps(&y_out[2*i + 8], _mm256_fmadd_ps(Y1, scale, offset));
+    }
+
+    convert_raw_iq_scalar<T>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+
+SIMD_TARGET_AVX2 static void convert_raw_iq_s16_avx2(
+    tcb::span<const int16_t> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 32 bytes of input = 8 samples = 2*256bits of output
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const __m256 scale = _mm256_setr_ps(
+        affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q,
+        affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q);
+    const __m256 offset = _mm256_setr_ps(
+        affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q,
+        affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128i X0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i + 0]));
+        const __m128i X1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i + 8]));
+        const __m256 Y0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(X0));
+        const __m256 Y1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(X1));
+        _mm256_storeu_ps(&y_out[2*i + 0], _mm256_fmadd_ps(Y0, scale, offset));
+        _mm256_storeu_ps(&y_out[2*i + 8], _mm256_fmadd_ps(Y1, scale, offset));
+    }
+
+    convert_raw_iq_scalar<int16_t>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+
+SIMD_IGNORE_UNINITIALIZED_PUSH
+template <typename T>
+SIMD_TARGET_AVX512 static void convert_raw_iq_avx512(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 64 bytes of input = 32 samples = 4*512bits of output
+    const size_t K = 32u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    // lanes are ordered as I,Q pairs so the 4 values are repeated across the register
+    const __m512 scale = _mm512_broadcast_f32x4(
+        _mm_setr_ps(affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q));
+    const __m512 offset = _mm512_broadcast_f32x4(
+        _mm_setr_ps(affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q));
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        for (size_t j = 0; j < 4; j++) {
+            const __m128i X = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&x[2*i + 16*j]));
+            __m512i X_wide;
+            if constexpr (std::is_signed_v<T>) X_wide = _mm512_cvtepi8_epi32(X);
+            else X_wide = _mm512_cvtepu8_epi32(X);
+            const __m512 Y = _mm512_cvtepi32_ps(X_wide);
+            _mm512_storeu_ps(&y_out[2*i + 16*j], _mm512_fmadd_ps(Y, scale, offset));
+        }
+    }
+
+    convert_raw_iq_scalar<T>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+SIMD_IGNORE_UNINITIALIZED_POP
+#endif
+
+#endif
+
+// ARM
+#if defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+template <typename T>
+static void convert_raw_iq_neon(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 16 bytes of input = 8 samples = 4*128bits of output
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const float scale_arr[4] = { affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q };
+    const float offset_arr[4] = { affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q };
+    const float32x4_t scale = vld1q_f32(scale_arr);
+    const float32x4_t offset = vld1q_f32(offset_arr);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        float32x4_t Y0, Y1, Y2, Y3;
+        if constexpr (std::is_signed_v<T>) {
+            const int8x16_t X = vld1q_s8(&x[2*i]);
+            const int16x8_t X_lo = vmovl_s8(vget_low_s8(X));
+            const int16x8_t X_hi = vmovl_s8(vget_high_s8(X));
+            Y0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(X_lo)));
+            Y1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(X_lo)));
+            Y2 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(X_hi)));
+            Y3 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(X_hi)));
+        } else {
+            const uint8x16_t X = vld1q_u8(&x[2*i]);
+            const uint16x8_t X_lo = vmovl_u8(vget_low_u8(X));
+            const uint16x8_t X_hi = vmovl_u8(vget_high_u8(X));
+            Y0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(X_lo)));
+            Y1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(X_lo)));
+            Y2 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(X_hi)));
+            Y3 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(X_hi)));
+        }
+        vst1q_f32(&y_out[2*i +  0], vfmaq_f32(offset, Y0, scale));
+        vst1q_f32(&y_out[2*i +  4], vfmaq_f32(offset, Y1, scale));
+        vst1q_f32(&y_out[2*i +  8], vfmaq_f32(offset, Y2, scale));
+        vst1q_f32(&y_out[2*i + 12], vfmaq_f32(offset, Y3, scale));
+    }
+
+    convert_raw_iq_scalar<T>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+
+static void convert_raw_iq_s16_neon(
+    tcb::span<const int16_t> x, tcb::span<std::complex<float>> y,
+    const Raw_IQ_Affine& affine)
+{
+    assert(x.size() == 2*y.size());
+    const size_t N = y.size();
+
+    // 16 bytes of input = 4 samples = 2*128bits of output
+    const size_t K = 4u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const float scale_arr[4] = { affine.scale_I, affine.scale_Q, affine.scale_I, affine.scale_Q };
+    const float offset_arr[4] = { affine.offset_I, affine.offset_Q, affine.offset_I, affine.offset_Q };
+    const float32x4_t scale = vld1q_f32(scale_arr);
+    const float32x4_t offset = vld1q_f32(offset_arr);
+    auto* y_out = reinterpret_cast<float*>(y.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const int16x8_t X = vld1q_s16(&x[2*i]);
+        const float32x4_t Y0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(X)));
+        const float32x4_t Y1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(X)));
+        vst1q_f32(&y_out[2*i + 0], vfmaq_f32(offset, Y0, scale));
+        vst1q_f32(&y_out[2*i + 4], vfmaq_f32(offset, Y1, scale));
+    }
+
+    convert_raw_iq_scalar<int16_t>(x.subspan(2*N_vector), y.subspan(N_vector), affine);
+}
+#endif
+
+template <typename T>
+static void convert_raw_iq_dispatch(
+    tcb::span<const T> x, tcb::span<std::complex<float>> y,
+    const float bias, const Raw_IQ_Correction& correction)
+{
+    const auto affine = get_raw_iq_affine(bias, correction);
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return convert_raw_iq_avx512<T>(x, y, affine);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return convert_raw_iq_avx2<T>(x, y, affine);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return convert_raw_iq_sse4_1<T>(x, y, affine);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return convert_raw_iq_neon<T>(x, y, affine);
+        }
+    #endif
+    (void)level;
+    convert_raw_iq_scalar<T>(x, y, affine);
+}
+
+void convert_raw_iq_auto(
+    tcb::span<const uint8_t> x, tcb::span<std::complex<float>> y,
+    const float bias, const Raw_IQ_Correction& correction)
+{
+    convert_raw_iq_dispatch(x, y, bias, correction);
+}
+
+void convert_raw_iq_auto(
+    tcb::span<const int8_t> x, tcb::span<std::complex<float>> y,
+    const float bias, const Raw_IQ_Correction& correction)
+{
+    convert_raw_iq_dispatch(x, y, bias, correction);
+}
+
+void convert_raw_iq_auto(
+    tcb::span<const int16_t> x, tcb::span<std::complex<float>> y,
+    const float bias, const Raw_IQ_Correction& correction)
+{
+    const auto affine = get_raw_iq_affine(bias, correction);
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return convert_raw_iq_s16_avx2(x, y, affine);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return convert_raw_iq_s16_sse4_1(x, y, affine);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return convert_raw_iq_s16_neon(x, y, affine);
+        }
+    #endif
+    (void)level;
+    convert_raw_iq_scalar<int16_t>(x, y, affine);
+}
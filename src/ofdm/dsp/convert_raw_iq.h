@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <complex>
+#include "utility/span.h"
+
+// Interleaved 8bit IQ samples
+// Unsigned samples are produced by the rtl-sdr and signed samples by the HackRF
+struct RawIQ_u8 {
+    uint8_t I;
+    uint8_t Q;
+};
+struct RawIQ_s8 {
+    int8_t I;
+    int8_t Q;
+};
+// Interleaved 16bit IQ samples (CS16) which are produced by wideband receivers such as the Airspy and SDRplay
+struct RawIQ_s16 {
+    int16_t I;
+    int16_t Q;
+};
+
+// Corrects the imbalances of a receiver's IQ mixer
+// dc_offset is removed before the gain is applied to each of the I and Q channels
+struct Raw_IQ_Correction {
+    std::complex<float> dc_offset = {0.0f, 0.0f};
+    std::complex<float> gain = {1.0f, 1.0f};
+};
+
+// Converts interleaved 8bit or 16bit IQ samples to complex<float>
+// y[i] = ((x[2i]-bias-dc.I)*gain.I, (x[2i+1]-bias-dc.Q)*gain.Q) where x has 2*y.size() values
+void convert_raw_iq_auto(
+    tcb::span<const uint8_t> x, tcb::span<std::complex<float>> y,
+    const float bias=127.5f, const Raw_IQ_Correction& correction={}
+);
+void convert_raw_iq_auto(
+    tcb::span<const int8_t> x, tcb::span<std::complex<float>> y,
+    const float bias=0.0f, const Raw_IQ_Correction& correction={}
+);
+// NOTE: Use correction.gain to scale 16bit samples down to the range of 8bit samples if needed
+void convert_raw_iq_auto(
+    tcb::span<const int16_t> x, tcb::span<std::complex<float>> y,
+    const float bias=0.0f, const Raw_IQ_Correction& correction={}
+);
@@ -0,0 +1,493 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <limits>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./dqpsk_demapper.h"
+
+// DOC: docs/DAB_implementation_in_SDR_detailed.pdf
+// Clause 3.16.2 - QPSK symbol mapper
+// phi = (1-2*b0) + (1-2*b1)*1j
+// x0 = 1-2*b0, x1 = 1-2*b1
+// b = (1-x)/2
+// NOTE: Phil Karn's viterbi decoder is configured so that b => b' : (0,1) => (-A,+A)
+// Where b is the logical bit value, and b' is the value used for soft decision decoding
+// b' = (2*b-1) * A 
+// b' = (1-x-1)*A
+// b' = -A*x
+// NOTE: We normalise by the L1 norm since it doesn't truncate like L2 norm
+//       I.e. When real=imag, then we expect b0=A, b1=A
+//            But with L2 norm, we get b0=0.707*A, b1=0.707*A
+//                with L1 norm, we get b0=A, b1=A as expected
+// NOTE: A zero vector is clamped to the smallest norm so it is demapped as an erasure
+// The decision error is measured in the same normalised space where the largest component is always 1
+// The ideal point is (+-1,+-1) so the error is 1-min(|re|,|im|) on the smaller component
+// This costs a min, subtract and multiply add on top of the demapper when it is enabled
+constexpr float SOFT_DECISION_SCALE = float(SOFT_DECISION_VITERBI_HIGH);
+constexpr float MIN_NORM = std::numeric_limits<float>::min();
+
+static void dqpsk_demapper_scalar(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error,
+    const size_t start, const size_t end)
+{
+    const size_t N = carrier_fft_index.size();
+    const bool is_error = !carrier_error.empty();
+    for (size_t i = start; i < end; i++) {
+        // Clause 3.16.1 - Frequency deinterleaving
+        const size_t k = size_t(carrier_fft_index[i]);
+        // Clause 3.15 - Differential demodulator
+        // arg(z1*~z0) = arg(z1)+arg(~z0) = arg(z1)-arg(z0)
+        const auto vec = fft_1[k] * std::conj(fft_0[k]);
+        const float A = std::max(std::max(std::abs(vec.real()), std::abs(vec.imag())), MIN_NORM);
+        const auto norm_vec = vec / A;
+        // Clause 3.16.2 - QPSK symbol demapper
+        bits[i]   = viterbi_bit_t(-norm_vec.real()*SOFT_DECISION_SCALE);
+        bits[i+N] = viterbi_bit_t(+norm_vec.imag()*SOFT_DECISION_SCALE);
+        if (is_error) {
+            const float error = 1.0f - std::min(std::abs(norm_vec.real()), std::abs(norm_vec.imag()));
+            carrier_error[i] += error*error;
+        }
+    }
+}
+
+#if defined(__ARCH_X86__)
+#include "./x86/c32_conj_mul.h"
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+SIMD_TARGET_SSE4_1 static inline __m128 c32_load2_sse4_1(const std::complex<float>* x, const int k0, const int k1) {
+    const double* buf = reinterpret_cast<const double*>(x);
+    return _mm_castpd_ps(_mm_loadh_pd(_mm_load_sd(&buf[k0]), &buf[k1]));
+}
+
+SIMD_TARGET_SSE4_1 static void dqpsk_demapper_sse4_1(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+
+    // 128bits = 4 carriers of real or imaginary components
+    const size_t K = 4u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 min_norm = _mm_set1_ps(MIN_NORM);
+    const __m128 soft_scale = _mm_set1_ps(SOFT_DECISION_SCALE);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const bool is_error = !carrier_error.empty();
+    const int* index = carrier_fft_index.data();
+    for (size_t i = 0; i < N_vector; i+=K) {
+        // [c0 c1] and [c2 c3]
+        const __m128 X0_lo = c32_load2_sse4_1(fft_0.data(), index[i+0], index[i+1]);
+        const __m128 X0_hi = c32_load2_sse4_1(fft_0.data(), index[i+2], index[i+3]);
+        const __m128 X1_lo = c32_load2_sse4_1(fft_1.data(), index[i+0], index[i+1]);
+        const __m128 X1_hi = c32_load2_sse4_1(fft_1.data(), index[i+2], index[i+3]);
+        const __m128 Y_lo = c32_conj_mul_sse3(X1_lo, X0_lo);
+        const __m128 Y_hi = c32_conj_mul_sse3(X1_hi, X0_hi);
+        // [r0 r1 r2 r3] and [i0 i1 i2 i3]
+        const __m128 re = _mm_shuffle_ps(Y_lo, Y_hi, 0b10'00'10'00);
+        const __m128 im = _mm_shuffle_ps(Y_lo, Y_hi, 0b11'01'11'01);
+        const __m128 A = _mm_max_ps(_mm_max_ps(_mm_andnot_ps(sign_mask, re), _mm_andnot_ps(sign_mask, im)), min_norm);
+        const __m128 norm_re = _mm_div_ps(re, A);
+        const __m128 norm_im = _mm_div_ps(im, A);
+        const __m128i b_re = _mm_cvttps_epi32(_mm_mul_ps(_mm_xor_ps(norm_re, sign_mask), soft_scale));
+        const __m128i b_im = _mm_cvttps_epi32(_mm_mul_ps(norm_im, soft_scale));
+        if (is_error) {
+            const __m128 min_abs = _mm_min_ps(_mm_andnot_ps(sign_mask, norm_re), _mm_andnot_ps(sign_mask, norm_im));
+            const __m128 error = _mm_sub_ps(one, min_abs);
+            const __m128 total = _mm_add_ps(_mm_loadu_ps(&carrier_error[i]), _mm_mul_ps(error, error));
+            _mm_storeu_ps(&carrier_error[i], total);
+        }
+        // [re0-3 im0-3 re0-3 im0-3]
+        const __m128i b = _mm_packs_epi16(_mm_packs_epi32(b_re, b_im), _mm_setzero_si128());
+        const int32_t b_re_packed = _mm_cvtsi128_si32(b);
+        const int32_t b_im_packed = _mm_extract_epi32(b, 1);
+        memcpy(&bits[i], &b_re_packed, sizeof(int32_t));
+        memcpy(&bits[i+N], &b_im_packed, sizeof(int32_t));
+    }
+
+    dqpsk_demapper_scalar(fft_0, fft_1, carrier_fft_index, bits, carrier_error, N_vector, N);
+}
+#endif
+
+// Gathers are used to read the frequency deinterleaved carriers
+SIMD_IGNORE_UNINITIALIZED_PUSH
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+SIMD_TARGET_AVX2 static void dqpsk_demapper_avx2(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+
+    // 256bits = 8 carriers of real or imaginary components
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    // Gather [c0 c1 c4 c5] and [c2 c3 c6 c7] so deinterleaving the components within each 128bit lane is in order
+    const __m256i gather_order = _mm256_setr_epi32(0,1,4,5, 2,3,6,7);
+    // Move the packed bytes of [re0-3 im0-3 | re4-7 im4-7] into [re0-7 im0-7]
+    const __m256i pack_order = _mm256_setr_epi32(0,4,1,5, 2,6,3,7);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 min_norm = _mm256_set1_ps(MIN_NORM);
+    const __m256 soft_scale = _mm256_set1_ps(SOFT_DECISION_SCALE);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const bool is_error = !carrier_error.empty();
+    const double* buf_0 = reinterpret_cast<const double*>(fft_0.data());
+    const double* buf_1 = reinterpret_cast<const double*>(fft_1.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&carrier_fft_index[i]));
+        index = _mm256_permutevar8x32_epi32(index, gather_order);
+        const __m128i index_lo = _mm256_castsi256_si128(index);
+        const __m128i index_hi = _mm256_extracti128_si256(index, 1);
+        const __m256 X0_lo = _mm256_castpd_ps(_mm256_i32gather_pd(buf_0, index_lo, 8));
+        const __m256 X0_hi = _mm256_castpd_ps(_mm256_i32gather_pd(buf_0, index_hi, 8));
+        const __m256 X1_lo = _mm256_castpd_ps(_mm256_i32gather_pd(buf_1, index_lo, 8));
+        const __m256 X1_hi = _mm256_castpd_ps(_mm256_i32gather_pd(buf_1, index_hi, 8));
+        const __m256 Y_lo = c32_conj_mul_avx(X1_lo, X0_lo);
+        const __m256 Y_hi = c32_conj_mul_avx(X1_hi, X0_hi);
+        // [r0 ... r7] and [i0 ... i7]
+        const __m256 re = _mm256_shuffle_ps(Y_lo, Y_hi, 0b10'00'10'00);
+        const __m256 im = _mm256_shuffle_ps(Y_lo, Y_hi, 0b11'01'11'01);
+        const __m256 A = _mm256_max_ps(_mm256_max_ps(_mm256_andnot_ps(sign_mask, re), _mm256_andnot_ps(sign_mask, im)), min_norm);
+        const __m256 norm_re = _mm256_div_ps(re, A);
+        const __m256 norm_im = _mm256_div_ps(im, A);
+        const __m256i b_re = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_xor_ps(norm_re, sign_mask), soft_scale));
+        const __m256i b_im = _mm256_cvttps_epi32(_mm256_mul_ps(norm_im, soft_scale));
+        if (is_error) {
+            const __m256 min_abs = _mm256_min_ps(_mm256_andnot_ps(sign_mask, norm_re), _mm256_andnot_ps(sign_mask, norm_im));
+            const __m256 error = _mm256_sub_ps(one, min_abs);
+            const __m256 total = _mm256_fmadd_ps(error, error, _mm256_loadu_ps(&carrier_error[i]));
+            _mm256_storeu_ps(&carrier_error[i], total);
+        }
+        const __m256i b16 = _mm256_packs_epi32(b_re, b_im);
+        const __m256i b8 = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(b16, b16), pack_order);
+        const __m128i b = _mm256_castsi256_si128(b8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&bits[i]), b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&bits[i+N]), _mm_unpackhi_epi64(b, b));
+    }
+
+    dqpsk_demapper_scalar(fft_0, fft_1, carrier_fft_index, bits, carrier_error, N_vector, N);
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+SIMD_TARGET_AVX512 static void dqpsk_demapper_avx512(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+
+    // 512bits = 16 carriers of real or imaginary components
+    const size_t K = 16u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    // Gather [c0 c1 c4 c5 ...] and [c2 c3 c6 c7 ...] so deinterleaving the components within each 128bit lane is in order
+    const __m512i gather_order = _mm512_setr_epi32(0,1,4,5,8,9,12,13, 2,3,6,7,10,11,14,15);
+    const __m512 sign_mask = _mm512_set1_ps(-0.0f);
+    const __m512 min_norm = _mm512_set1_ps(MIN_NORM);
+    const __m512 soft_scale = _mm512_set1_ps(SOFT_DECISION_SCALE);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const bool is_error = !carrier_error.empty();
+    const double* buf_0 = reinterpret_cast<const double*>(fft_0.data());
+    const double* buf_1 = reinterpret_cast<const double*>(fft_1.data());
+    for (size_t i = 0; i < N_vector; i+=K) {
+        __m512i index = _mm512_loadu_si512(&carrier_fft_index[i]);
+        index = _mm512_permutexvar_epi32(gather_order, index);
+        const __m256i index_lo = _mm512_castsi512_si256(index);
+        const __m256i index_hi = _mm512_extracti64x4_epi64(index, 1);
+        const __m512 X0_lo = _mm512_castpd_ps(_mm512_i32gather_pd(index_lo, buf_0, 8));
+        const __m512 X0_hi = _mm512_castpd_ps(_mm512_i32gather_pd(index_hi, buf_0, 8));
+        const __m512 X1_lo = _mm512_castpd_ps(_mm512_i32gather_pd(index_lo, buf_1, 8));
+        const __m512 X1_hi = _mm512_castpd_ps(_mm512_i32gather_pd(index_hi, buf_1, 8));
+        const __m512 Y_lo = c32_conj_mul_avx512(X1_lo, X0_lo);
+        const __m512 Y_hi = c32_conj_mul_avx512(X1_hi, X0_hi);
+        // [r0 ... r15] and [i0 ... i15]
+        const __m512 re = _mm512_shuffle_ps(Y_lo, Y_hi, 0b10'00'10'00);
+        const __m512 im = _mm512_shuffle_ps(Y_lo, Y_hi, 0b11'01'11'01);
+        const __m512 A = _mm512_max_ps(_mm512_max_ps(_mm512_abs_ps(re), _mm512_abs_ps(im)), min_norm);
+        const __m512 norm_re = _mm512_div_ps(re, A);
+        const __m512 norm_im = _mm512_div_ps(im, A);
+        const __m512i b_re = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_xor_ps(norm_re, sign_mask), soft_scale));
+        const __m512i b_im = _mm512_cvttps_epi32(_mm512_mul_ps(norm_im, soft_scale));
+        if (is_error) {
+            const __m512 error = _mm512_sub_ps(one, _mm512_min_ps(_mm512_abs_ps(norm_re), _mm512_abs_ps(norm_im)));
+            const __m512 total = _mm512_fmadd_ps(error, error, _mm512_loadu_ps(&carrier_error[i]));
+            _mm512_storeu_ps(&carrier_error[i], total);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bits[i]), _mm512_cvtsepi32_epi8(b_re));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&bits[i+N]), _mm512_cvtsepi32_epi8(b_im));
+    }
+
+    dqpsk_demapper_scalar(fft_0, fft_1, carrier_fft_index, bits, carrier_error, N_vector, N);
+}
+#endif
+
+SIMD_IGNORE_UNINITIALIZED_POP
+
+#elif defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+// [r0 i0 r1 i1] and [r2 i2 r3 i3] of carriers that aren't contiguous in the FFT
+static inline float32x4x2_t c32_load4_neon(const std::complex<float>* x, const int* index) {
+    const float* buf = reinterpret_cast<const float*>(x);
+    float32x4x2_t X;
+    X.val[0] = vcombine_f32(vld1_f32(&buf[2*index[0]]), vld1_f32(&buf[2*index[1]]));
+    X.val[1] = vcombine_f32(vld1_f32(&buf[2*index[2]]), vld1_f32(&buf[2*index[3]]));
+    return X;
+}
+
+// Quantised soft bits of the real and imaginary components of 4 carriers
+static inline int16x8_t dqpsk_demap4_neon(
+    const std::complex<float>* fft_0, const std::complex<float>* fft_1, const int* index,
+    const float32x4_t min_norm, const float32x4_t soft_scale, float* carrier_error)
+{
+    const float32x4x2_t X0 = c32_load4_neon(fft_0, index);
+    const float32x4x2_t X1 = c32_load4_neon(fft_1, index);
+    // [r0 r1 r2 r3] and [i0 i1 i2 i3]
+    const float32x4_t X0_re = vuzp1q_f32(X0.val[0], X0.val[1]);
+    const float32x4_t X0_im = vuzp2q_f32(X0.val[0], X0.val[1]);
+    const float32x4_t X1_re = vuzp1q_f32(X1.val[0], X1.val[1]);
+    const float32x4_t X1_im = vuzp2q_f32(X1.val[0], X1.val[1]);
+    // X1*~X0 = (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+    const float32x4_t re = vfmaq_f32(vmulq_f32(X1_re, X0_re), X1_im, X0_im);
+    const float32x4_t im = vfmsq_f32(vmulq_f32(X1_im, X0_re), X1_re, X0_im);
+    const float32x4_t A = vmaxq_f32(vmaxq_f32(vabsq_f32(re), vabsq_f32(im)), min_norm);
+    const float32x4_t norm_re = vdivq_f32(re, A);
+    const float32x4_t norm_im = vdivq_f32(im, A);
+    const int32x4_t b_re = vcvtq_s32_f32(vmulq_f32(vnegq_f32(norm_re), soft_scale));
+    const int32x4_t b_im = vcvtq_s32_f32(vmulq_f32(norm_im, soft_scale));
+    if (carrier_error != nullptr) {
+        const float32x4_t error = vsubq_f32(vdupq_n_f32(1.0f), vminq_f32(vabsq_f32(norm_re), vabsq_f32(norm_im)));
+        vst1q_f32(carrier_error, vfmaq_f32(vld1q_f32(carrier_error), error, error));
+    }
+    // [re0-3 im0-3]
+    return vcombine_s16(vqmovn_s32(b_re), vqmovn_s32(b_im));
+}
+
+static void dqpsk_demapper_neon(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+
+    // 2*128bits = 8 carriers of real or imaginary components
+    // NOTE: Two groups of 4 carriers are demapped together so the soft bits are stored 8 at a time
+    const size_t K = 8u;
+    const size_t M = N/K;
+    const size_t N_vector = M*K;
+
+    const float32x4_t min_norm = vdupq_n_f32(MIN_NORM);
+    const float32x4_t soft_scale = vdupq_n_f32(SOFT_DECISION_SCALE);
+    const int* index = carrier_fft_index.data();
+    float* error = carrier_error.empty() ? nullptr : carrier_error.data();
+    for (size_t i = 0; i < N_vector; i+=K) {
+        float* error_lo = (error != nullptr) ? &error[i+0] : nullptr;
+        float* error_hi = (error != nullptr) ? &error[i+4] : nullptr;
+        const int16x8_t b_lo = dqpsk_demap4_neon(fft_0.data(), fft_1.data(), &index[i+0], min_norm, soft_scale, error_lo);
+        const int16x8_t b_hi = dqpsk_demap4_neon(fft_0.data(), fft_1.data(), &index[i+4], min_norm, soft_scale, error_hi);
+        // [re0-7] and [im0-7]
+        const int8x8_t b_re = vqmovn_s16(vcombine_s16(vget_low_s16(b_lo), vget_low_s16(b_hi)));
+        const int8x8_t b_im = vqmovn_s16(vcombine_s16(vget_high_s16(b_lo), vget_high_s16(b_hi)));
+        vst1_s8(&bits[i], b_re);
+        vst1_s8(&bits[i+N], b_im);
+    }
+
+    dqpsk_demapper_scalar(fft_0, fft_1, carrier_fft_index, bits, carrier_error, N_vector, N);
+}
+
+#if defined(SIMD_COMPILE_SVE2)
+#include <arm_sve.h>
+// Vector length agnostic where the components of each carrier are gathered with 32bit indices
+// The soft bits are within [-127,+127] so a truncating byte store doesn't need saturation
+static void dqpsk_demapper_sve2(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+    const size_t K = svcntw();
+
+    const bool is_error = !carrier_error.empty();
+    const float* buf_0 = reinterpret_cast<const float*>(fft_0.data());
+    const float* buf_1 = reinterpret_cast<const float*>(fft_1.data());
+    for (size_t i = 0; i < N; i+=K) {
+        const svbool_t pg = svwhilelt_b32(i, N);
+        // [r0 r1 ...] and [i0 i1 ...]
+        const svint32_t index_re = svlsl_n_s32_x(pg, svld1_s32(pg, &carrier_fft_index[i]), 1);
+        const svint32_t index_im = svadd_n_s32_x(pg, index_re, 1);
+        const svfloat32_t X0_re = svld1_gather_s32index_f32(pg, buf_0, index_re);
+        const svfloat32_t X0_im = svld1_gather_s32index_f32(pg, buf_0, index_im);
+        const svfloat32_t X1_re = svld1_gather_s32index_f32(pg, buf_1, index_re);
+        const svfloat32_t X1_im = svld1_gather_s32index_f32(pg, buf_1, index_im);
+        // X1*~X0 = (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+        const svfloat32_t re = svmla_f32_x(pg, svmul_f32_x(pg, X1_re, X0_re), X1_im, X0_im);
+        const svfloat32_t im = svmls_f32_x(pg, svmul_f32_x(pg, X1_im, X0_re), X1_re, X0_im);
+        const svfloat32_t A = svmax_n_f32_x(pg, svmax_f32_x(pg, svabs_f32_x(pg, re), svabs_f32_x(pg, im)), MIN_NORM);
+        const svfloat32_t norm_re = svdiv_f32_x(pg, re, A);
+        const svfloat32_t norm_im = svdiv_f32_x(pg, im, A);
+        const svint32_t b_re = svcvt_s32_f32_x(pg, svmul_n_f32_x(pg, svneg_f32_x(pg, norm_re), SOFT_DECISION_SCALE));
+        const svint32_t b_im = svcvt_s32_f32_x(pg, svmul_n_f32_x(pg, norm_im, SOFT_DECISION_SCALE));
+        if (is_error) {
+            const svfloat32_t min_abs = svmin_f32_x(pg, svabs_f32_x(pg, norm_re), svabs_f32_x(pg, norm_im));
+            const svfloat32_t error = svsubr_n_f32_x(pg, min_abs, 1.0f);
+            svst1_f32(pg, &carrier_error[i], svmla_f32_x(pg, svld1_f32(pg, &carrier_error[i]), error, error));
+        }
+        svst1b_s32(pg, &bits[i], b_re);
+        svst1b_s32(pg, &bits[i+N], b_im);
+    }
+}
+#endif
+
+#elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+#include <riscv_vector.h>
+// Vector length agnostic where the components of each carrier are gathered with indexed loads
+static void dqpsk_demapper_rvv(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    const size_t N = carrier_fft_index.size();
+
+    const bool is_error = !carrier_error.empty();
+    const float* buf_0 = reinterpret_cast<const float*>(fft_0.data());
+    const float* buf_1 = reinterpret_cast<const float*>(fft_1.data());
+    const uint32_t* index = reinterpret_cast<const uint32_t*>(carrier_fft_index.data());
+    for (size_t i = 0, vl = 0; i < N; i+=vl) {
+        vl = __riscv_vsetvl_e32m2(N-i);
+        // byte offsets of [r0 r1 ...] and [i0 i1 ...]
+        const vuint32m2_t offset_re = __riscv_vsll_vx_u32m2(__riscv_vle32_v_u32m2(&index[i], vl), 3, vl);
+        const vuint32m2_t offset_im = __riscv_vadd_vx_u32m2(offset_re, uint32_t(sizeof(float)), vl);
+        const vfloat32m2_t X0_re = __riscv_vloxei32_v_f32m2(buf_0, offset_re, vl);
+        const vfloat32m2_t X0_im = __riscv_vloxei32_v_f32m2(buf_0, offset_im, vl);
+        const vfloat32m2_t X1_re = __riscv_vloxei32_v_f32m2(buf_1, offset_re, vl);
+        const vfloat32m2_t X1_im = __riscv_vloxei32_v_f32m2(buf_1, offset_im, vl);
+        // X1*~X0 = (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+        const vfloat32m2_t re = __riscv_vfmacc_vv_f32m2(__riscv_vfmul_vv_f32m2(X1_re, X0_re, vl), X1_im, X0_im, vl);
+        const vfloat32m2_t im = __riscv_vfnmsac_vv_f32m2(__riscv_vfmul_vv_f32m2(X1_im, X0_re, vl), X1_re, X0_im, vl);
+        const vfloat32m2_t A = __riscv_vfmax_vf_f32m2(
+            __riscv_vfmax_vv_f32m2(__riscv_vfabs_v_f32m2(re, vl), __riscv_vfabs_v_f32m2(im, vl), vl), MIN_NORM, vl);
+        const vfloat32m2_t norm_re = __riscv_vfdiv_vv_f32m2(re, A, vl);
+        const vfloat32m2_t norm_im = __riscv_vfdiv_vv_f32m2(im, A, vl);
+        const vint32m2_t b_re = __riscv_vfcvt_rtz_x_f_v_i32m2(__riscv_vfmul_vf_f32m2(norm_re, -SOFT_DECISION_SCALE, vl), vl);
+        const vint32m2_t b_im = __riscv_vfcvt_rtz_x_f_v_i32m2(__riscv_vfmul_vf_f32m2(norm_im, SOFT_DECISION_SCALE, vl), vl);
+        if (is_error) {
+            const vfloat32m2_t min_abs = __riscv_vfmin_vv_f32m2(__riscv_vfabs_v_f32m2(norm_re, vl), __riscv_vfabs_v_f32m2(norm_im, vl), vl);
+            const vfloat32m2_t error = __riscv_vfrsub_vf_f32m2(min_abs, 1.0f, vl);
+            const vfloat32m2_t total = __riscv_vfmacc_vv_f32m2(__riscv_vle32_v_f32m2(&carrier_error[i], vl), error, error, vl);
+            __riscv_vse32_v_f32m2(&carrier_error[i], total, vl);
+        }
+        // The soft bits are within [-127,+127] so narrowing doesn't need saturation
+        __riscv_vse8_v_i8mf2(&bits[i], __riscv_vncvt_x_x_w_i8mf2(__riscv_vncvt_x_x_w_i16m1(b_re, vl), vl), vl);
+        __riscv_vse8_v_i8mf2(&bits[i+N], __riscv_vncvt_x_x_w_i8mf2(__riscv_vncvt_x_x_w_i16m1(b_im, vl), vl), vl);
+    }
+}
+#endif
+
+void dqpsk_demapper_auto(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    assert(fft_0.size() == fft_1.size());
+    assert(bits.size() == carrier_fft_index.size()*2);
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return dqpsk_demapper_avx512(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return dqpsk_demapper_avx2(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return dqpsk_demapper_sse4_1(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        #if defined(SIMD_COMPILE_SVE2)
+        if (simd_is_level_at_least(level, SIMD_Level::SVE2)) {
+            return dqpsk_demapper_sve2(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+        #endif
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return dqpsk_demapper_neon(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+    #elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+        if (simd_is_level_at_least(level, SIMD_Level::RVV)) {
+            return dqpsk_demapper_rvv(fft_0, fft_1, carrier_fft_index, bits, carrier_error);
+        }
+    #endif
+    (void)level;
+    dqpsk_demapper_scalar(fft_0, fft_1, carrier_fft_index, bits, carrier_error, 0, carrier_fft_index.size());
+}
+
+// The product of the 16bit components fits in 32bits and the soft bits are found with integer division
+void dqpsk_demapper_auto(
+    tcb::span<const Complex_Q15> fft_0,
+    tcb::span<const Complex_Q15> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error)
+{
+    assert(fft_0.size() == fft_1.size());
+    assert(bits.size() == carrier_fft_index.size()*2);
+    constexpr int64_t SOFT_SCALE = int64_t(SOFT_DECISION_VITERBI_HIGH);
+    const size_t N = carrier_fft_index.size();
+    const bool is_error = !carrier_error.empty();
+    for (size_t i = 0; i < N; i++) {
+        const size_t k = size_t(carrier_fft_index[i]);
+        const int32_t x0_re = fft_0[k].re, x0_im = fft_0[k].im;
+        const int32_t x1_re = fft_1[k].re, x1_im = fft_1[k].im;
+        // x1*~x0 = (a+bj)(c-dj) = (ac+bd) + (bc-ad)j
+        const int64_t re = int64_t(x1_re)*x0_re + int64_t(x1_im)*x0_im;
+        const int64_t im = int64_t(x1_im)*x0_re - int64_t(x1_re)*x0_im;
+        const int64_t A = std::max(std::max(std::abs(re), std::abs(im)), int64_t(1));
+        bits[i]   = viterbi_bit_t(-re*SOFT_SCALE/A);
+        bits[i+N] = viterbi_bit_t(+im*SOFT_SCALE/A);
+        if (is_error) {
+            const float error = 1.0f - float(std::min(std::abs(re), std::abs(im)))/float(A);
+            carrier_error[i] += error*error;
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <complex>
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./quantise_q15.h"
+
+// Power of the ideal point (+-1,+-1) that the decision error is measured against
+constexpr float DQPSK_IDEAL_POWER = 2.0f;
+
+// Differential QPSK demodulation and soft decision demapping of a symbol in one pass
+// vec = fft_1[k] * conj(fft_0[k]) where k = carrier_fft_index[i] is the FFT bin of deinterleaved carrier i
+// bits[0:N-1]  = real component of each carrier
+// bits[N:2N-1] = imaginary component of each carrier
+// If carrier_error isn't empty the squared decision error of each carrier is added to carrier_error[i]
+// The error is the distance to the ideal point after normalising by the largest component (see DQPSK_IDEAL_POWER)
+void dqpsk_demapper_auto(
+    tcb::span<const std::complex<float>> fft_0,
+    tcb::span<const std::complex<float>> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error={}
+);
+
+// Fixed point variant for the output of FFT_Q15_Plan
+// NOTE: The FFTs of both symbols can have different exponents since each carrier is normalised by its own L1 norm
+void dqpsk_demapper_auto(
+    tcb::span<const Complex_Q15> fft_0,
+    tcb::span<const Complex_Q15> fft_1,
+    tcb::span<const int> carrier_fft_index,
+    tcb::span<viterbi_bit_t> bits,
+    tcb::span<float> carrier_error={}
+);
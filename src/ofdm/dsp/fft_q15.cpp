@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "utility/span.h"
+#include "./fft_q15.h"
+#include "./quantise_q15.h"
+
+constexpr double TWO_PI = 2.0*3.14159265358979323846;
+
+FFT_Q15_Plan::FFT_Q15_Plan(const size_t nb_fft)
+: m_nb_fft(nb_fft)
+{
+    assert((m_nb_fft > 1) && ((m_nb_fft & (m_nb_fft-1)) == 0));
+    m_nb_stages = 0;
+    while ((size_t(1) << m_nb_stages) < m_nb_fft) m_nb_stages++;
+
+    // w[k] = exp(-2*pi*j*k/N) for the first half of the circle
+    m_twiddles.resize(m_nb_fft/2);
+    for (size_t k = 0; k < m_twiddles.size(); k++) {
+        const double dt = -TWO_PI*double(k)/double(m_nb_fft);
+        m_twiddles[k].re = int16_t(std::lround(std::cos(dt)*32767.0));
+        m_twiddles[k].im = int16_t(std::lround(std::sin(dt)*32767.0));
+    }
+
+    m_bit_reverse.resize(m_nb_fft);
+    for (size_t i = 0; i < m_nb_fft; i++) {
+        uint32_t j = 0;
+        for (size_t b = 0; b < m_nb_stages; b++) {
+            j |= uint32_t((i >> b) & 1) << (m_nb_stages-1-b);
+        }
+        m_bit_reverse[i] = j;
+    }
+}
+
+// Each butterfly output is at most (1+sqrt(2)) times its largest input component
+// Inputs are shifted so the outputs stay below 2.414*2^13 = 19776 which fits in 16bits
+static inline int get_stage_shift(const int32_t max_abs) {
+    if (max_abs >= (1 << 14)) return 2;
+    if (max_abs >= (1 << 13)) return 1;
+    return 0;
+}
+
+static inline int32_t get_max_abs(const Complex_Q15& x, const int32_t max_abs) {
+    return std::max(max_abs, std::max(std::abs(int32_t(x.re)), std::abs(int32_t(x.im))));
+}
+
+int FFT_Q15_Plan::Execute(tcb::span<const Complex_Q15> x, tcb::span<Complex_Q15> y) const {
+    assert(x.size() >= m_nb_fft);
+    assert(y.size() >= m_nb_fft);
+    const size_t N = m_nb_fft;
+
+    int32_t max_abs = 0;
+    for (size_t i = 0; i < N; i++) {
+        y[i] = x[m_bit_reverse[i]];
+        max_abs = get_max_abs(y[i], max_abs);
+    }
+
+    // Decimation in time with the largest component of each stage found while writing it
+    int exponent = 0;
+    const int32_t rounding = int32_t(1) << 14;
+    for (size_t length = 2; length <= N; length <<= 1) {
+        const int shift = get_stage_shift(max_abs);
+        exponent += shift;
+        max_abs = 0;
+        const size_t half = length/2;
+        const size_t twiddle_step = N/length;
+        for (size_t i = 0; i < N; i += length) {
+            for (size_t j = 0; j < half; j++) {
+                const auto& w = m_twiddles[j*twiddle_step];
+                auto& a = y[i+j];
+                auto& b = y[i+j+half];
+                const int32_t t_re = (int32_t(b.re)*w.re - int32_t(b.im)*w.im + rounding) >> 15;
+                const int32_t t_im = (int32_t(b.re)*w.im + int32_t(b.im)*w.re + rounding) >> 15;
+                const int32_t a_re = a.re;
+                const int32_t a_im = a.im;
+                a.re = int16_t((a_re + t_re) >> shift);
+                a.im = int16_t((a_im + t_im) >> shift);
+                b.re = int16_t((a_re - t_re) >> shift);
+                b.im = int16_t((a_im - t_im) >> shift);
+                max_abs = get_max_abs(b, get_max_abs(a, max_abs));
+            }
+        }
+    }
+    return exponent;
+}
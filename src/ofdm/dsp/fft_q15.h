@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "utility/span.h"
+#include "./quantise_q15.h"
+
+// Fixed point radix-2 forward FFT for targets without fast floating point
+// Block floating point is used where each stage is scaled down by 1, 2 or 4 depending on its largest input
+// This keeps every butterfly within 16bits while the output keeps as much precision as possible
+// NOTE: The output is scaled by 2^-exponent relative to the unnormalised transform
+//       Execute() is thread safe so a plan can be used by many threads at once
+class FFT_Q15_Plan
+{
+private:
+    const size_t m_nb_fft;
+    size_t m_nb_stages;
+    std::vector<Complex_Q15> m_twiddles;
+    std::vector<uint32_t> m_bit_reverse;
+public:
+    // nb_fft must be a power of two
+    explicit FFT_Q15_Plan(const size_t nb_fft);
+    size_t GetSize() const { return m_nb_fft; }
+    size_t GetMemoryBytes() const { return m_twiddles.capacity()*sizeof(Complex_Q15) + m_bit_reverse.capacity()*sizeof(uint32_t); }
+    // Returns the exponent of the block floating point output
+    // NOTE: This is out of place and x can be unaligned
+    int Execute(tcb::span<const Complex_Q15> x, tcb::span<Complex_Q15> y) const;
+};
@@ -0,0 +1,302 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "./impulse_peak.h"
+
+// 10*log10(x) = 10*log10(2)*log2(x)
+constexpr float LOG2_TO_DB = 3.01029995664f;
+// x = 2^e * (1+t) where log2(1+t) for t in [0,1) is a least squares fit over chebyshev nodes
+constexpr uint32_t FLOAT_MANTISSA_MASK = 0x007FFFFF;
+constexpr uint32_t FLOAT_ONE = 0x3F800000;
+constexpr int FLOAT_EXPONENT_BIAS = 127;
+constexpr float LOG2_C1 = 1.44187984f;
+constexpr float LOG2_C2 = -0.708864548f;
+constexpr float LOG2_C3 = 0.415243262f;
+constexpr float LOG2_C4 = -0.193513459f;
+constexpr float LOG2_C5 = 0.045266899f;
+
+static float power_db_scalar(const std::complex<float> x) {
+    const float power = x.real()*x.real() + x.imag()*x.imag();
+    uint32_t bits = 0;
+    std::memcpy(&bits, &power, sizeof(bits));
+    const int exponent = int(bits >> 23) - FLOAT_EXPONENT_BIAS;
+    bits = (bits & FLOAT_MANTISSA_MASK) | FLOAT_ONE;
+    float mantissa = 0.0f;
+    std::memcpy(&mantissa, &bits, sizeof(bits));
+    const float t = mantissa - 1.0f;
+    const float log2_power = float(exponent) + t*(LOG2_C1 + t*(LOG2_C2 + t*(LOG2_C3 + t*(LOG2_C4 + t*LOG2_C5))));
+    return LOG2_TO_DB*log2_power;
+}
+
+// Continues the search from start with the sum and peak of the samples before it
+static Impulse_Peak find_impulse_peak_scalar(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float slope,
+    const size_t start=0, float sum=0.0f, Impulse_Peak peak={ 0.0f, -INFINITY, 0 })
+{
+    assert(x.size() == y.size());
+    assert(!x.empty());
+    const size_t N = x.size();
+    for (size_t i = start; i < N; i++) {
+        const float Y = power_db_scalar(x[i]);
+        y[i] = Y;
+        sum += Y;
+        const float distance = std::abs(float(int(i)-expected_index));
+        const float value = (1.0f - slope*distance)*Y;
+        if (value > peak.value) {
+            peak.value = value;
+            peak.index = int(i);
+        }
+    }
+    peak.mean = sum / float(N);
+    return peak;
+}
+
+// The peak of each lane is the first in that lane so ties between lanes go to the lowest index
+static Impulse_Peak reduce_peak_lanes(const float* values, const float* indices, const size_t K) {
+    Impulse_Peak peak { 0.0f, -INFINITY, 0 };
+    for (size_t i = 0; i < K; i++) {
+        const int index = int(indices[i]);
+        if ((values[i] > peak.value) || ((values[i] == peak.value) && (index < peak.index))) {
+            peak.value = values[i];
+            peak.index = index;
+        }
+    }
+    return peak;
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <immintrin.h>
+SIMD_TARGET_SSE4_1 static inline __m128 power_db_sse4_1(const __m128 power) {
+    const __m128i bits = _mm_castps_si128(power);
+    const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(FLOAT_EXPONENT_BIAS));
+    const __m128i mantissa_bits = _mm_or_si128(
+        _mm_and_si128(bits, _mm_set1_epi32(FLOAT_MANTISSA_MASK)), _mm_set1_epi32(FLOAT_ONE));
+    const __m128 t = _mm_sub_ps(_mm_castsi128_ps(mantissa_bits), _mm_set1_ps(1.0f));
+    __m128 p = _mm_set1_ps(LOG2_C5);
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C4));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C3));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C2));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(LOG2_C1));
+    const __m128 log2_power = _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(p, t));
+    return _mm_mul_ps(log2_power, _mm_set1_ps(LOG2_TO_DB));
+}
+
+SIMD_TARGET_SSE4_1 static Impulse_Peak find_impulse_peak_sse4_1(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float slope)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+
+    // 2*128bits = 2*16bytes = 4*8bytes
+    const size_t K = 4u;
+    const size_t N_vector = (N/K)*K;
+
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 expected = _mm_set1_ps(float(expected_index));
+    const __m128 S = _mm_set1_ps(slope);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 step = _mm_set1_ps(float(K));
+    __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 sum = _mm_set1_ps(0.0f);
+    __m128 max_value = _mm_set1_ps(-INFINITY);
+    __m128 max_index = _mm_set1_ps(0.0f);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m128 X0 = _mm_loadu_ps(reinterpret_cast<const float*>(&x[i+0]));
+        const __m128 X1 = _mm_loadu_ps(reinterpret_cast<const float*>(&x[i+2]));
+        // [r0 i0 r1 i1] [r2 i2 r3 i3] => [|x0|^2 |x1|^2 |x2|^2 |x3|^2]
+        const __m128 power = _mm_hadd_ps(_mm_mul_ps(X0, X0), _mm_mul_ps(X1, X1));
+        const __m128 Y = power_db_sse4_1(power);
+        _mm_storeu_ps(&y[i], Y);
+        sum = _mm_add_ps(sum, Y);
+        const __m128 distance = _mm_and_ps(_mm_sub_ps(index, expected), abs_mask);
+        const __m128 value = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(S, distance)), Y);
+        const __m128 is_greater = _mm_cmpgt_ps(value, max_value);
+        max_value = _mm_blendv_ps(max_value, value, is_greater);
+        max_index = _mm_blendv_ps(max_index, index, is_greater);
+        index = _mm_add_ps(index, step);
+    }
+    alignas(16) float values[K];
+    alignas(16) float indices[K];
+    _mm_store_ps(values, max_value);
+    _mm_store_ps(indices, max_index);
+    // [a b c d] => [a+c b+d] => [a+b+c+d]
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0b0000'0001));
+    return find_impulse_peak_scalar(
+        x, y, expected_index, slope,
+        N_vector, _mm_cvtss_f32(sum), reduce_peak_lanes(values, indices, K));
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+SIMD_TARGET_AVX2 static inline __m256 power_db_avx2(const __m256 power) {
+    const __m256i bits = _mm256_castps_si256(power);
+    const __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(FLOAT_EXPONENT_BIAS));
+    const __m256i mantissa_bits = _mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(FLOAT_MANTISSA_MASK)), _mm256_set1_epi32(FLOAT_ONE));
+    const __m256 t = _mm256_sub_ps(_mm256_castsi256_ps(mantissa_bits), _mm256_set1_ps(1.0f));
+    __m256 p = _mm256_set1_ps(LOG2_C5);
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(LOG2_C4));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(LOG2_C3));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(LOG2_C2));
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(LOG2_C1));
+    const __m256 log2_power = _mm256_fmadd_ps(p, t, _mm256_cvtepi32_ps(exponent));
+    return _mm256_mul_ps(log2_power, _mm256_set1_ps(LOG2_TO_DB));
+}
+
+SIMD_TARGET_AVX2 static Impulse_Peak find_impulse_peak_avx2(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float slope)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+
+    // 2*256bits = 2*32bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t N_vector = (N/K)*K;
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 expected = _mm256_set1_ps(float(expected_index));
+    const __m256 S = _mm256_set1_ps(slope);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 step = _mm256_set1_ps(float(K));
+    __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 sum = _mm256_set1_ps(0.0f);
+    __m256 max_value = _mm256_set1_ps(-INFINITY);
+    __m256 max_index = _mm256_set1_ps(0.0f);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        const __m256 X0 = _mm256_loadu_ps(reinterpret_cast<const float*>(&x[i+0]));
+        const __m256 X1 = _mm256_loadu_ps(reinterpret_cast<const float*>(&x[i+4]));
+        // horizontal add is done within each 128bit lane
+        // [x0 x1 x4 x5 | x2 x3 x6 x7] => [x0 x1 x2 x3 | x4 x5 x6 x7]
+        const __m256 power_lanes = _mm256_hadd_ps(_mm256_mul_ps(X0, X0), _mm256_mul_ps(X1, X1));
+        const __m256 power = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(power_lanes), 0b11'01'10'00));
+        const __m256 Y = power_db_avx2(power);
+        _mm256_storeu_ps(&y[i], Y);
+        sum = _mm256_add_ps(sum, Y);
+        const __m256 distance = _mm256_and_ps(_mm256_sub_ps(index, expected), abs_mask);
+        const __m256 value = _mm256_mul_ps(_mm256_fnmadd_ps(S, distance, one), Y);
+        const __m256 is_greater = _mm256_cmp_ps(value, max_value, _CMP_GT_OQ);
+        max_value = _mm256_blendv_ps(max_value, value, is_greater);
+        max_index = _mm256_blendv_ps(max_index, index, is_greater);
+        index = _mm256_add_ps(index, step);
+    }
+    alignas(32) float values[K];
+    alignas(32) float indices[K];
+    _mm256_store_ps(values, max_value);
+    _mm256_store_ps(indices, max_index);
+    __m128 v0 = _mm_add_ps(_mm256_extractf128_ps(sum, 0), _mm256_extractf128_ps(sum, 1));
+    v0 = _mm_add_ps(v0, _mm_movehl_ps(v0, v0));
+    v0 = _mm_add_ss(v0, _mm_permute_ps(v0, 0b0000'0001));
+    return find_impulse_peak_scalar(
+        x, y, expected_index, slope,
+        N_vector, _mm_cvtss_f32(v0), reduce_peak_lanes(values, indices, K));
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+static inline float32x4_t power_db_neon(const float32x4_t power) {
+    const uint32x4_t bits = vreinterpretq_u32_f32(power);
+    const int32x4_t exponent = vsubq_s32(
+        vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(FLOAT_EXPONENT_BIAS));
+    const uint32x4_t mantissa_bits = vorrq_u32(
+        vandq_u32(bits, vdupq_n_u32(FLOAT_MANTISSA_MASK)), vdupq_n_u32(FLOAT_ONE));
+    const float32x4_t t = vsubq_f32(vreinterpretq_f32_u32(mantissa_bits), vdupq_n_f32(1.0f));
+    float32x4_t p = vdupq_n_f32(LOG2_C5);
+    p = vfmaq_f32(vdupq_n_f32(LOG2_C4), p, t);
+    p = vfmaq_f32(vdupq_n_f32(LOG2_C3), p, t);
+    p = vfmaq_f32(vdupq_n_f32(LOG2_C2), p, t);
+    p = vfmaq_f32(vdupq_n_f32(LOG2_C1), p, t);
+    const float32x4_t log2_power = vfmaq_f32(vcvtq_f32_s32(exponent), p, t);
+    return vmulq_n_f32(log2_power, LOG2_TO_DB);
+}
+
+static Impulse_Peak find_impulse_peak_neon(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float slope)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+
+    // 2*128bits = 2*16bytes = 4*8bytes
+    const size_t K = 4u;
+    const size_t N_vector = (N/K)*K;
+
+    const float32x4_t expected = vdupq_n_f32(float(expected_index));
+    const float32x4_t S = vdupq_n_f32(slope);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t step = vdupq_n_f32(float(K));
+    const float index_init[K] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t index = vld1q_f32(index_init);
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x4_t max_value = vdupq_n_f32(-INFINITY);
+    float32x4_t max_index = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < N_vector; i+=K) {
+        // deinterleaved into real and imaginary parts
+        const float32x4x2_t X = vld2q_f32(reinterpret_cast<const float*>(&x[i]));
+        const float32x4_t power = vfmaq_f32(vmulq_f32(X.val[0], X.val[0]), X.val[1], X.val[1]);
+        const float32x4_t Y = power_db_neon(power);
+        vst1q_f32(&y[i], Y);
+        sum = vaddq_f32(sum, Y);
+        const float32x4_t distance = vabdq_f32(index, expected);
+        const float32x4_t value = vmulq_f32(vfmsq_f32(one, S, distance), Y);
+        const uint32x4_t is_greater = vcgtq_f32(value, max_value);
+        max_value = vbslq_f32(is_greater, value, max_value);
+        max_index = vbslq_f32(is_greater, index, max_index);
+        index = vaddq_f32(index, step);
+    }
+    float values[K];
+    float indices[K];
+    vst1q_f32(values, max_value);
+    vst1q_f32(indices, max_index);
+    return find_impulse_peak_scalar(
+        x, y, expected_index, slope,
+        N_vector, vaddvq_f32(sum), reduce_peak_lanes(values, indices, K));
+}
+#endif
+
+Impulse_Peak find_impulse_peak_auto(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float decay, const float distance_scale)
+{
+    const float slope = decay / distance_scale;
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return find_impulse_peak_avx2(x, y, expected_index, slope);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return find_impulse_peak_sse4_1(x, y, expected_index, slope);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return find_impulse_peak_neon(x, y, expected_index, slope);
+        }
+    #endif
+    (void)level;
+    return find_impulse_peak_scalar(x, y, expected_index, slope);
+}
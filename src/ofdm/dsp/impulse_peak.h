@@ -0,0 +1,20 @@
+#pragma once
+
+#include <complex>
+#include "utility/span.h"
+
+struct Impulse_Peak {
+    float mean = 0.0f;
+    float value = 0.0f;
+    int index = 0;
+};
+
+// Power of an impulse response in dB and its peak weighted by the distance from where it is expected
+// y[i] = 10*log10(|x[i]|^2) using a polynomial log2 that is within 1e-4dB (0 is about -382dB instead of -inf)
+// w[i] = 1 - decay*|i-expected_index|/distance_scale
+// mean = Σ y[i] / N, value = max w[i]*y[i] at the first index it occurs
+Impulse_Peak find_impulse_peak_auto(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y,
+    const int expected_index, const float decay, const float distance_scale
+);
@@ -0,0 +1,258 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include "./iq_resampler.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <complex>
+#include <numeric>
+#include <vector>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+
+// Enough for the SIMD kernels
+constexpr size_t ALIGN_AMOUNT = 32;
+// Passband edge as a fraction of the lower nyquist frequency
+constexpr double FILTER_ROLLOFF = 0.9;
+// Kaiser window with about 70dB of stopband attenuation
+constexpr double KAISER_BETA = 7.0;
+
+// Zeroth order modified bessel function of the first kind
+static double bessel_i0(const double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        const double v = x / (2.0*double(k));
+        term *= v*v;
+        sum += term;
+    }
+    return sum;
+}
+
+// Outputs are computed at upsampled times t = start_time + i*decimation
+// where input sample (t / phases) is the newest sample multiplied by phase (t % phases)
+// Samples are interleaved as [I,Q] and the coefficients are duplicated for I and Q
+struct Resample_Block {
+    const float* coefficients;
+    size_t taps;
+    size_t phases;
+    size_t decimation;
+    const float* input;
+    size_t start_time;
+    size_t total_outputs;
+    float* output;
+};
+
+static inline void get_output_window(const Resample_Block& block, const size_t i, const float*& x, const float*& h) {
+    const size_t t = block.start_time + i*block.decimation;
+    const size_t newest = t / block.phases;
+    const size_t phase = t % block.phases;
+    x = &block.input[(newest+1-block.taps)*2];
+    h = &block.coefficients[phase*block.taps*2];
+}
+
+static void resample_scalar(const Resample_Block& block) {
+    const size_t K = block.taps*2;
+    for (size_t i = 0; i < block.total_outputs; i++) {
+        const float* x = nullptr;
+        const float* h = nullptr;
+        get_output_window(block, i, x, h);
+        float y_I = 0.0f;
+        float y_Q = 0.0f;
+        for (size_t k = 0; k < K; k+=2) {
+            y_I += x[k+0]*h[k+0];
+            y_Q += x[k+1]*h[k+1];
+        }
+        block.output[i*2+0] = y_I;
+        block.output[i*2+1] = y_Q;
+    }
+}
+
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <smmintrin.h>
+// Lanes are [I,Q,I,Q]
+SIMD_TARGET_SSE4_1 static void resample_sse4_1(const Resample_Block& block) {
+    const size_t K = block.taps*2;
+    for (size_t i = 0; i < block.total_outputs; i++) {
+        const float* x = nullptr;
+        const float* h = nullptr;
+        get_output_window(block, i, x, h);
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (size_t k = 0; k < K; k+=8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&x[k+0]), _mm_load_ps(&h[k+0])));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&x[k+4]), _mm_load_ps(&h[k+4])));
+        }
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        _mm_storel_pi(reinterpret_cast<__m64*>(&block.output[i*2]), acc);
+    }
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX2)
+#include <immintrin.h>
+SIMD_TARGET_AVX2 static void resample_avx2(const Resample_Block& block) {
+    const size_t K = block.taps*2;
+    const size_t N = (K/16)*16;
+    for (size_t i = 0; i < block.total_outputs; i++) {
+        const float* x = nullptr;
+        const float* h = nullptr;
+        get_output_window(block, i, x, h);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        size_t k = 0;
+        for (; k < N; k+=16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[k+0]), _mm256_load_ps(&h[k+0]), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[k+8]), _mm256_load_ps(&h[k+8]), acc1);
+        }
+        for (; k < K; k+=8) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[k]), _mm256_load_ps(&h[k]), acc0);
+        }
+        const __m256 acc256 = _mm256_add_ps(acc0, acc1);
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc256), _mm256_extractf128_ps(acc256, 1));
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        _mm_storel_pi(reinterpret_cast<__m64*>(&block.output[i*2]), acc);
+    }
+}
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+
+#include <arm_neon.h>
+static void resample_neon(const Resample_Block& block) {
+    const size_t K = block.taps*2;
+    for (size_t i = 0; i < block.total_outputs; i++) {
+        const float* x = nullptr;
+        const float* h = nullptr;
+        get_output_window(block, i, x, h);
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < K; k+=8) {
+            acc0 = vfmaq_f32(acc0, vld1q_f32(&x[k+0]), vld1q_f32(&h[k+0]));
+            acc1 = vfmaq_f32(acc1, vld1q_f32(&x[k+4]), vld1q_f32(&h[k+4]));
+        }
+        const float32x4_t acc = vaddq_f32(acc0, acc1);
+        vst1_f32(&block.output[i*2], vadd_f32(vget_low_f32(acc), vget_high_f32(acc)));
+    }
+}
+
+#endif
+
+static void resample_auto(const Resample_Block& block) {
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX2)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX2)) {
+            return resample_avx2(block);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return resample_sse4_1(block);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return resample_neon(block);
+        }
+    #endif
+    (void)level;
+    resample_scalar(block);
+}
+
+bool IQ_Resampler::IsSupported(const uint32_t input_sample_rate, const uint32_t output_sample_rate) {
+    if ((input_sample_rate == 0) || (output_sample_rate == 0)) return false;
+    const uint32_t divisor = std::gcd(input_sample_rate, output_sample_rate);
+    return (output_sample_rate / divisor) <= MAX_PHASES;
+}
+
+IQ_Resampler::IQ_Resampler(
+    const uint32_t input_sample_rate, const uint32_t output_sample_rate,
+    const size_t taps_per_phase)
+:   m_input_sample_rate(input_sample_rate),
+    m_output_sample_rate(output_sample_rate),
+    // taps are a multiple of 4 so each phase is a whole number of vectors
+    m_taps_per_phase(((taps_per_phase+3)/4)*4),
+    m_coefficients(AlignedAllocator<float>(ALIGN_AMOUNT)),
+    m_input_buffer(AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_output_buffer(AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT))
+{
+    assert(IsSupported(input_sample_rate, output_sample_rate));
+    const uint32_t divisor = std::gcd(input_sample_rate, output_sample_rate);
+    m_total_phases = size_t(output_sample_rate / divisor);
+    m_decimation = size_t(input_sample_rate / divisor);
+
+    // prototype filter runs at the upsampled rate and cuts off at the lower nyquist frequency
+    const size_t L = m_total_phases;
+    const size_t T = m_taps_per_phase;
+    const size_t N = L*T;
+    const double cutoff = FILTER_ROLLOFF * 0.5 / double(std::max(m_total_phases, m_decimation));
+    const double centre = double(N-1) / 2.0;
+    const double window_scale = 1.0 / bessel_i0(KAISER_BETA);
+    std::vector<double> prototype(N);
+    for (size_t n = 0; n < N; n++) {
+        const double x = double(n) - centre;
+        const double sinc = (x == 0.0) ? 1.0 : std::sin(2.0*M_PI*cutoff*x) / (2.0*M_PI*cutoff*x); // NOLINT
+        const double r = x / centre;
+        const double window = bessel_i0(KAISER_BETA*std::sqrt(std::max(0.0, 1.0-r*r))) * window_scale;
+        prototype[n] = sinc*window;
+    }
+
+    // tap k of a phase multiplies the input k samples before the newest
+    // these are stored oldest first and normalised so each phase has unity gain at DC
+    m_coefficients.resize(L*T*2);
+    for (size_t phase = 0; phase < L; phase++) {
+        double sum = 0.0;
+        for (size_t k = 0; k < T; k++) sum += prototype[phase + k*L];
+        const double gain = (sum == 0.0) ? 0.0 : 1.0/sum;
+        for (size_t k = 0; k < T; k++) {
+            const float h = float(prototype[phase + k*L] * gain);
+            const size_t i = phase*T + (T-1-k);
+            m_coefficients[i*2 + 0] = h;
+            m_coefficients[i*2 + 1] = h;
+        }
+    }
+    Reset();
+}
+
+void IQ_Resampler::Reset() {
+    const size_t total_history = m_taps_per_phase-1;
+    m_input_buffer.resize(total_history);
+    std::fill(m_input_buffer.begin(), m_input_buffer.end(), std::complex<float>(0.0f, 0.0f));
+    m_time = total_history*m_total_phases;
+}
+
+tcb::span<const std::complex<float>> IQ_Resampler::Process(tcb::span<const std::complex<float>> x) {
+    const size_t total_history = m_taps_per_phase-1;
+    m_input_buffer.resize(total_history + x.size());
+    std::copy(x.begin(), x.end(), m_input_buffer.begin() + ptrdiff_t(total_history));
+
+    const size_t end_time = m_input_buffer.size()*m_total_phases;
+    const size_t total_outputs = (end_time <= m_time) ? 0 : (end_time - m_time + m_decimation - 1) / m_decimation;
+    m_output_buffer.resize(total_outputs);
+
+    Resample_Block block;
+    block.coefficients = m_coefficients.data();
+    block.taps = m_taps_per_phase;
+    block.phases = m_total_phases;
+    block.decimation = m_decimation;
+    block.input = reinterpret_cast<const float*>(m_input_buffer.data());
+    block.start_time = m_time;
+    block.total_outputs = total_outputs;
+    block.output = reinterpret_cast<float*>(m_output_buffer.data());
+    resample_auto(block);
+
+    // keep the newest samples as the history of the next block
+    m_time = m_time + total_outputs*m_decimation - x.size()*m_total_phases;
+    std::copy(m_input_buffer.end()-ptrdiff_t(total_history), m_input_buffer.end(), m_input_buffer.begin());
+    m_input_buffer.resize(total_history);
+    return m_output_buffer;
+}
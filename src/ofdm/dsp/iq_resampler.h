@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <vector>
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+
+// Rational resampler by L/M for complex baseband using a windowed sinc prototype filter split into L phases
+// This converts the native rate of a receiver to the 2.048MHz rate of the OFDM demodulator
+// e.g. 2.5MHz -> 2.048MHz is 512/625 and 10MHz -> 2.048MHz is 128/625
+// The last input samples are kept between blocks so there are no discontinuities at block edges
+// NOTE: The passband is 90% of the lower nyquist frequency which keeps the 1.536MHz DAB signal intact
+class IQ_Resampler
+{
+public:
+    static constexpr size_t MAX_PHASES = 1024;
+    static constexpr size_t DEFAULT_TAPS_PER_PHASE = 32;
+private:
+    using Buffer = std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>>;
+    const uint32_t m_input_sample_rate;
+    const uint32_t m_output_sample_rate;
+    size_t m_total_phases;
+    size_t m_decimation;
+    const size_t m_taps_per_phase;
+    // [phase][tap][I/Q] with taps in ascending time order so the dot product is contiguous
+    std::vector<float, AlignedAllocator<float>> m_coefficients;
+    // history of the last (taps-1) samples followed by the new input
+    Buffer m_input_buffer;
+    Buffer m_output_buffer;
+    // position of the next output in upsampled samples from the start of m_input_buffer
+    size_t m_time = 0;
+public:
+    IQ_Resampler(
+        const uint32_t input_sample_rate, const uint32_t output_sample_rate,
+        const size_t taps_per_phase=DEFAULT_TAPS_PER_PHASE);
+    // Returns false if the reduced ratio needs more than MAX_PHASES phases
+    static bool IsSupported(const uint32_t input_sample_rate, const uint32_t output_sample_rate);
+    // Returns the resampled block which is valid until the next call
+    tcb::span<const std::complex<float>> Process(tcb::span<const std::complex<float>> x);
+    // Clears the history when the stream is discontinuous
+    void Reset();
+    uint32_t GetInputSampleRate() const { return m_input_sample_rate; }
+    uint32_t GetOutputSampleRate() const { return m_output_sample_rate; }
+    size_t GetTotalPhases() const { return m_total_phases; }
+    size_t GetDecimation() const { return m_decimation; }
+    size_t GetTapsPerPhase() const { return m_taps_per_phase; }
+};
@@ -0,0 +1,274 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include <complex>
+#include <type_traits>
+#include "detect_architecture.h"
+#include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
+#include "utility/span.h"
+#include "./l1_norm_decimate.h"
+
+static float l1_norm_scalar(tcb::span<const std::complex<float>> x) {
+    float y = 0.0f;
+    for (const auto& v: x) {
+        y += std::abs(v.real()) + std::abs(v.imag());
+    }
+    return y;
+}
+
+static void l1_norm_decimate_scalar(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    assert(!y.empty());
+    const size_t D = x.size()/y.size();
+    for (size_t i = 0; i < y.size(); i++) {
+        y[i] = l1_norm_scalar(x.subspan(i*D, D));
+    }
+}
+
+template <typename T>
+static float l1_norm_raw_scalar(tcb::span<const T> x, const float bias) {
+    float y = 0.0f;
+    for (const auto& v: x) {
+        y += std::abs(float(v)-bias);
+    }
+    return y;
+}
+
+template <typename T>
+static void l1_norm_decimate_raw_scalar(
+    tcb::span<const T> x,
+    tcb::span<float> y,
+    const float bias)
+{
+    assert(!y.empty());
+    const size_t D = 2*((x.size()/2)/y.size());
+    for (size_t i = 0; i < y.size(); i++) {
+        y[i] = l1_norm_raw_scalar<T>(x.subspan(i*D, D), bias);
+    }
+}
+
+// NOTE: Each block is vectorised on its own so D should be a multiple of the lane width
+#if defined(__ARCH_X86__)
+
+#if defined(SIMD_COMPILE_SSE4_1)
+#include <immintrin.h>
+SIMD_TARGET_SSE4_1 static void l1_norm_decimate_sse4_1(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    assert(!y.empty());
+    const size_t D = x.size()/y.size();
+
+    // 128bits = 16bytes = 2*8bytes
+    const size_t K = 2u;
+    const size_t D_vector = (D/K)*K;
+
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for (size_t i = 0; i < y.size(); i++) {
+        const auto block = x.subspan(i*D, D);
+        __m128 Y_vec = _mm_set1_ps(0.0f);
+        for (size_t j = 0; j < D_vector; j+=K) {
+            const __m128 X = _mm_loadu_ps(reinterpret_cast<const float*>(&block[j]));
+            Y_vec = _mm_add_ps(Y_vec, _mm_and_ps(X, abs_mask));
+        }
+        // [a b c d] => [a+c b+d] => [a+b+c+d]
+        Y_vec = _mm_add_ps(Y_vec, _mm_movehl_ps(Y_vec, Y_vec));
+        Y_vec = _mm_add_ss(Y_vec, _mm_shuffle_ps(Y_vec, Y_vec, 0b0000'0001));
+        y[i] = _mm_cvtss_f32(Y_vec) + l1_norm_scalar(block.subspan(D_vector));
+    }
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX)
+#include <immintrin.h>
+SIMD_TARGET_AVX static void l1_norm_decimate_avx(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    assert(!y.empty());
+    const size_t D = x.size()/y.size();
+
+    // 256bits = 32bytes = 4*8bytes
+    const size_t K = 4u;
+    const size_t D_vector = (D/K)*K;
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    for (size_t i = 0; i < y.size(); i++) {
+        const auto block = x.subspan(i*D, D);
+        __m256 Y_vec = _mm256_set1_ps(0.0f);
+        for (size_t j = 0; j < D_vector; j+=K) {
+            const __m256 X = _mm256_loadu_ps(reinterpret_cast<const float*>(&block[j]));
+            Y_vec = _mm256_add_ps(Y_vec, _mm256_and_ps(X, abs_mask));
+        }
+        __m128 v0 = _mm_add_ps(_mm256_extractf128_ps(Y_vec, 0), _mm256_extractf128_ps(Y_vec, 1));
+        v0 = _mm_add_ps(v0, _mm_movehl_ps(v0, v0));
+        v0 = _mm_add_ss(v0, _mm_permute_ps(v0, 0b0000'0001));
+        y[i] = _mm_cvtss_f32(v0) + l1_norm_scalar(block.subspan(D_vector));
+    }
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX512)
+#include <immintrin.h>
+SIMD_IGNORE_UNINITIALIZED_PUSH
+SIMD_TARGET_AVX512 static void l1_norm_decimate_avx512(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    assert(!y.empty());
+    const size_t D = x.size()/y.size();
+
+    // 512bits = 64bytes = 8*8bytes
+    const size_t K = 8u;
+    const size_t D_vector = (D/K)*K;
+
+    for (size_t i = 0; i < y.size(); i++) {
+        const auto block = x.subspan(i*D, D);
+        __m512 Y_vec = _mm512_set1_ps(0.0f);
+        for (size_t j = 0; j < D_vector; j+=K) {
+            const __m512 X = _mm512_loadu_ps(reinterpret_cast<const float*>(&block[j]));
+            Y_vec = _mm512_add_ps(Y_vec, _mm512_abs_ps(X));
+        }
+        y[i] = _mm512_reduce_add_ps(Y_vec) + l1_norm_scalar(block.subspan(D_vector));
+    }
+}
+SIMD_IGNORE_UNINITIALIZED_POP
+#endif
+
+#elif defined(__ARCH_AARCH64__)
+#include <arm_neon.h>
+
+static void l1_norm_decimate_neon(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    assert(!y.empty());
+    const size_t D = x.size()/y.size();
+
+    // 128bits = 16bytes = 2*8bytes
+    const size_t K = 2u;
+    const size_t D_vector = (D/K)*K;
+
+    for (size_t i = 0; i < y.size(); i++) {
+        const auto block = x.subspan(i*D, D);
+        float32x4_t Y_vec = vdupq_n_f32(0.0f);
+        for (size_t j = 0; j < D_vector; j+=K) {
+            const float32x4_t X = vld1q_f32(reinterpret_cast<const float*>(&block[j]));
+            Y_vec = vaddq_f32(Y_vec, vabsq_f32(X));
+        }
+        y[i] = vaddvq_f32(Y_vec) + l1_norm_scalar(block.subspan(D_vector));
+    }
+}
+
+template <typename T>
+static void l1_norm_decimate_raw_neon(
+    tcb::span<const T> x,
+    tcb::span<float> y,
+    const float bias)
+{
+    assert(!y.empty());
+    const size_t D = 2*((x.size()/2)/y.size());
+
+    // 16 bytes of input = 8 samples = 4*128bits of floats
+    const size_t K = 16u;
+    const size_t D_vector = (D/K)*K;
+
+    const float32x4_t B = vdupq_n_f32(bias);
+    for (size_t i = 0; i < y.size(); i++) {
+        const auto block = x.subspan(i*D, D);
+        float32x4_t Y_vec = vdupq_n_f32(0.0f);
+        for (size_t j = 0; j < D_vector; j+=K) {
+            float32x4_t X0, X1, X2, X3;
+            if constexpr (std::is_signed_v<T>) {
+                const int8x16_t X = vld1q_s8(&block[j]);
+                const int16x8_t X_lo = vmovl_s8(vget_low_s8(X));
+                const int16x8_t X_hi = vmovl_s8(vget_high_s8(X));
+                X0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(X_lo)));
+                X1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(X_lo)));
+                X2 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(X_hi)));
+                X3 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(X_hi)));
+            } else {
+                const uint8x16_t X = vld1q_u8(&block[j]);
+                const uint16x8_t X_lo = vmovl_u8(vget_low_u8(X));
+                const uint16x8_t X_hi = vmovl_u8(vget_high_u8(X));
+                X0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(X_lo)));
+                X1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(X_lo)));
+                X2 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(X_hi)));
+                X3 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(X_hi)));
+            }
+            // |x-bias| is the absolute difference
+            Y_vec = vaddq_f32(Y_vec, vaddq_f32(vabdq_f32(X0, B), vabdq_f32(X1, B)));
+            Y_vec = vaddq_f32(Y_vec, vaddq_f32(vabdq_f32(X2, B), vabdq_f32(X3, B)));
+        }
+        y[i] = vaddvq_f32(Y_vec) + l1_norm_raw_scalar<T>(block.subspan(D_vector), bias);
+    }
+}
+#endif
+
+void l1_norm_decimate_auto(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y)
+{
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_X86__)
+        #if defined(SIMD_COMPILE_AVX512)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX512)) {
+            return l1_norm_decimate_avx512(x, y);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_AVX)
+        if (simd_is_level_at_least(level, SIMD_Level::AVX)) {
+            return l1_norm_decimate_avx(x, y);
+        }
+        #endif
+        #if defined(SIMD_COMPILE_SSE4_1)
+        if (simd_is_level_at_least(level, SIMD_Level::SSE4_1)) {
+            return l1_norm_decimate_sse4_1(x, y);
+        }
+        #endif
+    #elif defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return l1_norm_decimate_neon(x, y);
+        }
+    #endif
+    (void)level;
+    l1_norm_decimate_scalar(x, y);
+}
+
+template <typename T>
+static void l1_norm_decimate_raw_dispatch(
+    tcb::span<const T> x,
+    tcb::span<float> y,
+    const float bias)
+{
+    // Runtime selected vectorisation
+    const auto level = simd_get_level();
+    #if defined(__ARCH_AARCH64__)
+        if (simd_is_level_at_least(level, SIMD_Level::NEON)) {
+            return l1_norm_decimate_raw_neon<T>(x, y, bias);
+        }
+    #endif
+    (void)level;
+    l1_norm_decimate_raw_scalar<T>(x, y, bias);
+}
+
+void l1_norm_decimate_auto(
+    tcb::span<const uint8_t> x,
+    tcb::span<float> y,
+    const float bias)
+{
+    l1_norm_decimate_raw_dispatch(x, y, bias);
+}
+
+void l1_norm_decimate_auto(
+    tcb::span<const int8_t> x,
+    tcb::span<float> y,
+    const float bias)
+{
+    l1_norm_decimate_raw_dispatch(x, y, bias);
+}
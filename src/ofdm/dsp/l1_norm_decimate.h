@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <complex>
+#include "utility/span.h"
+
+// Sum of L1 norms of consecutive blocks of D = x.size()/y.size() samples
+// y[i] = Σ |Re(x[iD+j])| + |Im(x[iD+j])| for j in [0,D)
+void l1_norm_decimate_auto(
+    tcb::span<const std::complex<float>> x,
+    tcb::span<float> y
+);
+
+// Same as above for interleaved 8bit IQ samples where x has 2*D*y.size() bytes
+// y[i] = Σ |x[2(iD+j)]-bias| + |x[2(iD+j)+1]-bias| for j in [0,D)
+void l1_norm_decimate_auto(
+    tcb::span<const uint8_t> x,
+    tcb::span<float> y,
+    const float bias=127.5f
+);
+void l1_norm_decimate_auto(
+    tcb::span<const int8_t> x,
+    tcb::span<float> y,
+    const float bias=0.0f
+);
@@ -0,0 +1,25 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include "utility/span.h"
+#include "./quantise_q15.h"
+
+static inline int16_t quantise_q15(const float x) {
+    constexpr float MAX_VALUE = 32767.0f;
+    return int16_t(std::lround(std::clamp(x, -MAX_VALUE, +MAX_VALUE)));
+}
+
+void quantise_q15_auto(
+    tcb::span<const std::complex<float>> x, tcb::span<Complex_Q15> y,
+    const float scale)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    for (size_t i = 0; i < N; i++) {
+        y[i].re = quantise_q15(x[i].real()*scale);
+        y[i].im = quantise_q15(x[i].imag()*scale);
+    }
+}
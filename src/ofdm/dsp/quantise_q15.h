@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <complex>
+#include "utility/span.h"
+
+// Complex sample with 16bit fixed point components
+// NOTE: std::complex is only specified for floating point types
+struct Complex_Q15 {
+    int16_t re;
+    int16_t im;
+};
+
+// Converts samples to fixed point with saturation
+// y[i] = round(x[i]*scale) clamped to [-32767,+32767]
+void quantise_q15_auto(
+    tcb::span<const std::complex<float>> x, tcb::span<Complex_Q15> y,
+    const float scale
+);
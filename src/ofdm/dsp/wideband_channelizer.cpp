@@ -0,0 +1,152 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include "./wideband_channelizer.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <complex>
+#include <memory>
+#include <vector>
+#include "ofdm/fft_plan_cache.h"
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+#include "./apply_pll.h"
+
+// Enough for the SIMD kernels of any FFT backend
+constexpr size_t ALIGN_AMOUNT = 64;
+
+bool Wideband_Channelizer::IsSupported(
+    const uint32_t input_sample_rate, const uint32_t output_sample_rate, const size_t nb_output_fft)
+{
+    if ((input_sample_rate == 0) || (output_sample_rate == 0)) return false;
+    if ((nb_output_fft == 0) || (nb_output_fft % 2 != 0)) return false;
+    if (input_sample_rate < output_sample_rate) return false;
+    const uint64_t nb_input_scaled = uint64_t(input_sample_rate) * uint64_t(nb_output_fft);
+    if (nb_input_scaled % uint64_t(output_sample_rate) != 0) return false;
+    const uint64_t nb_input_fft = nb_input_scaled / uint64_t(output_sample_rate);
+    return (nb_input_fft % 2) == 0;
+}
+
+Wideband_Channelizer::Wideband_Channelizer(
+    const uint32_t input_sample_rate, const uint32_t output_sample_rate,
+    tcb::span<const float> channel_frequencies,
+    const size_t nb_output_fft,
+    const float bandwidth, const float stop_bandwidth)
+:   m_input_sample_rate(input_sample_rate),
+    m_output_sample_rate(output_sample_rate),
+    m_nb_input_fft(size_t(uint64_t(input_sample_rate) * uint64_t(nb_output_fft) / uint64_t(output_sample_rate))),
+    m_nb_output_fft(nb_output_fft),
+    m_filter_response(nb_output_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_input_buffer(m_nb_input_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_input_fft(m_nb_input_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_output_fft(nb_output_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_output_buffer(nb_output_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT))
+{
+    assert(IsSupported(input_sample_rate, output_sample_rate, nb_output_fft));
+    assert(stop_bandwidth > bandwidth);
+    const size_t N = m_nb_input_fft;
+    const float Fs = float(input_sample_rate);
+
+    m_fft_plan = fft_get_plan(N, FFT_Direction::FORWARD);
+    m_ifft_plan = fft_get_plan(m_nb_output_fft, FFT_Direction::BACKWARD);
+
+    const float bin_width = Fs / float(N);
+    for (const float frequency: channel_frequencies) {
+        assert(std::abs(frequency) + stop_bandwidth*0.5f <= Fs*0.5f);
+        Channel channel;
+        channel.frequency = frequency;
+        channel.bin_offset = int(std::round(frequency / bin_width));
+        // shift the remainder down to baseband at the output rate
+        const float residual = frequency - float(channel.bin_offset)*bin_width;
+        channel.residual_freq_norm = -residual / float(output_sample_rate);
+        m_channels.push_back(channel);
+    }
+
+    // Blackman windowed sinc at the input rate
+    // NOTE: Overlap-save requires the filter to be no longer than the overlap
+    const float transition = (stop_bandwidth - bandwidth) * 0.5f;
+    const float cutoff = (bandwidth + stop_bandwidth) * 0.25f;
+    size_t nb_taps = size_t(std::ceil(5.5f * Fs / transition));
+    nb_taps = std::min(nb_taps, N/2 + 1);
+    nb_taps = nb_taps | 1;
+    if (nb_taps > (N/2 + 1)) nb_taps -= 2;
+    auto& filter = m_input_buffer;
+    std::fill(filter.begin(), filter.end(), std::complex<float>(0.0f, 0.0f));
+    const float fc_norm = 2.0f * cutoff / Fs;
+    const float centre = float(nb_taps-1) * 0.5f;
+    float filter_sum = 0.0f;
+    for (size_t i = 0; i < nb_taps; i++) {
+        const float t = float(i) - centre;
+        const float x = float(M_PI) * fc_norm * t;
+        const float sinc = (t == 0.0f) ? 1.0f : (std::sin(x) / x);
+        const float w = float(2.0*M_PI) * float(i) / float(nb_taps-1);
+        const float window = 0.42f - 0.5f*std::cos(w) + 0.08f*std::cos(2.0f*w);
+        const float h = fc_norm * sinc * window;
+        filter[i] = h;
+        filter_sum += h;
+    }
+    m_fft_plan->Execute(filter, m_input_fft);
+    // unity gain at the channel centre including the unnormalised FFT
+    const float scale = 1.0f / (filter_sum * float(N));
+    for (size_t i = 0; i < m_nb_output_fft; i++) {
+        const size_t k = (i < m_nb_output_fft/2) ? i : (N - m_nb_output_fft + i);
+        m_filter_response[i] = m_input_fft[k] * scale;
+    }
+
+    Reset();
+}
+
+Wideband_Channelizer::~Wideband_Channelizer() = default;
+
+void Wideband_Channelizer::Reset() {
+    std::fill(m_input_buffer.begin(), m_input_buffer.end(), std::complex<float>(0.0f, 0.0f));
+    // the first half of the first block is the zero history of the filter
+    m_input_length = m_nb_input_fft/2;
+    m_total_blocks = 0;
+    for (auto& channel: m_channels) {
+        channel.pll_dt = 0.0f;
+    }
+}
+
+void Wideband_Channelizer::Process(tcb::span<const std::complex<float>> x) {
+    const size_t N = m_nb_input_fft;
+    while (!x.empty()) {
+        const size_t nb_read = std::min(x.size(), N - m_input_length);
+        std::copy_n(x.begin(), nb_read, m_input_buffer.begin() + m_input_length);
+        m_input_length += nb_read;
+        x = x.subspan(nb_read);
+        if (m_input_length < N) break;
+        ProcessBlock();
+        // keep the last half as the history of the next block
+        std::copy_n(m_input_buffer.begin() + N/2, N/2, m_input_buffer.begin());
+        m_input_length = N/2;
+    }
+}
+
+void Wideband_Channelizer::ProcessBlock() {
+    const int N = int(m_nb_input_fft);
+    const size_t M = m_nb_output_fft;
+    m_fft_plan->Execute(m_input_buffer, m_input_fft);
+
+    for (size_t channel_index = 0; channel_index < m_channels.size(); channel_index++) {
+        auto& channel = m_channels[channel_index];
+        // Blocks start every N/2 samples so the bin shift of each block is rotated by (-1)^(k*m)
+        const bool is_negate = ((uint64_t(std::abs(channel.bin_offset)) & m_total_blocks) & 1) != 0;
+        const float sign = is_negate ? -1.0f : 1.0f;
+        for (size_t i = 0; i < M; i++) {
+            const int frequency_index = (i < M/2) ? int(i) : (int(i) - int(M));
+            const int k = ((channel.bin_offset + frequency_index) % N + N) % N;
+            m_output_fft[i] = m_input_fft[size_t(k)] * m_filter_response[i] * sign;
+        }
+        m_ifft_plan->Execute(m_output_fft, m_output_buffer);
+
+        // Last half of the block doesn't wrap around in the circular convolution
+        auto y = tcb::span(m_output_buffer).subspan(M/2, M/2);
+        apply_pll_auto(y, y, channel.residual_freq_norm, channel.pll_dt);
+        channel.pll_dt += float(M/2) * channel.residual_freq_norm;
+        channel.pll_dt -= std::round(channel.pll_dt);
+        m_obs_on_channel_block.Notify(channel_index, y);
+    }
+    m_total_blocks++;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <memory>
+#include <vector>
+#include "utility/aligned_allocator.hpp"
+#include "utility/observable.h"
+#include "utility/span.h"
+
+class FFT_Plan;
+
+// Splits a wideband IQ stream into narrowband streams around the centre of each channel
+// DOC: "Fast convolution filter banks" (Renfors, Yli-Kaakinen, Harris)
+// This is a fast convolution filter bank which is the FFT equivalent of a polyphase channelizer
+// A uniform polyphase bank only places channels on multiples of its output rate
+// DAB blocks are 1.712MHz apart with 2.048MHz outputs so each channel takes its own bins from one shared FFT instead
+//
+// Each block of the input is transformed once with an overlap of half its length (overlap-save)
+// Each channel multiplies its bins by the lowpass filter and transforms back with a smaller IFFT for decimation
+// The channel centre is rounded to the nearest bin and the remainder is removed with a PLL
+// NOTE: The input sample rate must be a multiple of output_sample_rate/nb_output_fft
+class Wideband_Channelizer
+{
+public:
+    struct Channel {
+        // centre frequency relative to the centre of the wideband input
+        float frequency = 0.0f;
+        int bin_offset = 0;
+        float residual_freq_norm = 0.0f;
+        float pll_dt = 0.0f;
+    };
+private:
+    using Buffer = std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>>;
+    const uint32_t m_input_sample_rate;
+    const uint32_t m_output_sample_rate;
+    const size_t m_nb_input_fft;
+    const size_t m_nb_output_fft;
+    std::vector<Channel> m_channels;
+    // lowpass filter in the output bins which includes the 1/N scaling of the FFT
+    Buffer m_filter_response;
+    std::shared_ptr<FFT_Plan> m_fft_plan;
+    std::shared_ptr<FFT_Plan> m_ifft_plan;
+    Buffer m_input_buffer;
+    Buffer m_input_fft;
+    Buffer m_output_fft;
+    Buffer m_output_buffer;
+    size_t m_input_length;
+    uint64_t m_total_blocks;
+    Observable<size_t, tcb::span<const std::complex<float>>> m_obs_on_channel_block;
+public:
+    // Lowpass filter passes +-bandwidth/2 around each channel and stops at +-stop_bandwidth/2
+    // Defaults are for DAB where the signal is 1.536MHz wide and adjacent blocks start 0.944MHz from the centre
+    Wideband_Channelizer(
+        const uint32_t input_sample_rate, const uint32_t output_sample_rate,
+        tcb::span<const float> channel_frequencies,
+        const size_t nb_output_fft=2048,
+        const float bandwidth=1'536'000.0f, const float stop_bandwidth=1'888'000.0f);
+    ~Wideband_Channelizer();
+    Wideband_Channelizer(Wideband_Channelizer&) = delete;
+    Wideband_Channelizer(Wideband_Channelizer&&) = delete;
+    Wideband_Channelizer& operator=(Wideband_Channelizer&) = delete;
+    Wideband_Channelizer& operator=(Wideband_Channelizer&&) = delete;
+    // Returns false if the output sample rate can't be made from the input sample rate with this IFFT size
+    static bool IsSupported(const uint32_t input_sample_rate, const uint32_t output_sample_rate, const size_t nb_output_fft=2048);
+    // Channels are notified in order once per block with GetOutputBlockSize() samples
+    void Process(tcb::span<const std::complex<float>> x);
+    void Reset();
+    size_t GetTotalChannels() const { return m_channels.size(); }
+    const Channel& GetChannel(const size_t index) const { return m_channels[index]; }
+    size_t GetInputBlockSize() const { return m_nb_input_fft/2; }
+    size_t GetOutputBlockSize() const { return m_nb_output_fft/2; }
+    uint32_t GetInputSampleRate() const { return m_input_sample_rate; }
+    uint32_t GetOutputSampleRate() const { return m_output_sample_rate; }
+    auto& On_Channel_Block() { return m_obs_on_channel_block; }
+private:
+    void ProcessBlock();
+};
@@ -2,12 +2,38 @@
 
 #include <stdint.h>
 #include "simd_flags.h" // NOLINT
+#include "simd_dispatch.h"
 
 // Multiply packed complex float 
 
-#if defined(__AVX__)
+#if defined(SIMD_COMPILE_AVX512)
 #include <immintrin.h>
-static inline __m256 c32_mul_avx(__m256 x0, __m256 x1) {
+SIMD_TARGET_AVX512 static inline __m512 c32_mul_avx512(__m512 x0, __m512 x1) {
+    // Vectorise complex multiplication
+    // [3 2 1 0] -> [2 3 0 1]
+    constexpr uint8_t SWAP_COMPONENT_MASK = 0b10110001;
+    // [3 2 1 0] -> [2 2 0 0]
+    constexpr uint8_t GET_REAL_MASK = 0b10100000;
+    // [3 2 1 0] -> [3 3 1 1]
+    constexpr uint8_t GET_IMAG_MASK = 0b11110101;
+
+    // [d c]
+    __m512 a0 = _mm512_shuffle_ps(x0, x0, SWAP_COMPONENT_MASK);
+    // [a a]
+    __m512 a1 = _mm512_shuffle_ps(x1, x1, GET_REAL_MASK);
+    // [b b]
+    __m512 a2 = _mm512_shuffle_ps(x1, x1, GET_IMAG_MASK);
+    // [bd bc]
+    __m512 b0 = _mm512_mul_ps(a2, a0);
+    // [ac-bd ad+bc]
+    __m512 y = _mm512_fmaddsub_ps(a1, x0, b0);
+    return y;
+}
+#endif
+
+#if defined(SIMD_COMPILE_AVX)
+#include <immintrin.h>
+SIMD_TARGET_AVX static inline __m256 c32_mul_avx(__m256 x0, __m256 x1) {
     // Vectorise complex multiplication
     // [3 2 1 0] -> [2 3 0 1]
     constexpr uint8_t SWAP_COMPONENT_MASK = 0b10110001;
@@ -39,9 +65,9 @@ static inline __m256 c32_mul_avx(__m256 x0, __m256 x1) {
 }
 #endif
 
-#if defined(__SSE3__)
+#if defined(SIMD_COMPILE_SSE4_1)
 #include <xmmintrin.h>
-static inline __m128 c32_mul_sse3(__m128 x0, __m128 x1) {
+SIMD_TARGET_SSE4_1 static inline __m128 c32_mul_sse3(__m128 x0, __m128 x1) {
     // Vectorise complex multiplication
     // [3 2 1 0] -> [2 3 0 1]
     constexpr uint8_t SWAP_COMPONENT_MASK = 0b10110001;
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include "./fft_plan_cache.h"
+
+// Implemented once by each FFT backend and only used by the plan cache
+// NOTE: Planners are rarely thread safe so these are called with the planner mutex held
+std::unique_ptr<FFT_Plan> fft_backend_create_plan(
+    const size_t nb_fft, const FFT_Direction direction, const FFT_Plan_Rigor rigor);
+bool fft_backend_import_wisdom(const char* filename);
+bool fft_backend_export_wisdom(const char* filename);
+const char* fft_backend_get_name();
+
+std::mutex& fft_get_planner_mutex();
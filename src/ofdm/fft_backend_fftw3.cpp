@@ -0,0 +1,149 @@
+#include "./fft_backend.h"
+#include <assert.h>
+#include <stddef.h>
+#include <atomic>
+#include <complex>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <fftw3.h>
+#include "utility/span.h"
+#include "./fft_plan_cache.h"
+
+static unsigned get_planner_flags(const FFT_Plan_Rigor rigor) {
+    switch (rigor) {
+    case FFT_Plan_Rigor::MEASURE: return FFTW_MEASURE;
+    case FFT_Plan_Rigor::PATIENT: return FFTW_PATIENT;
+    case FFT_Plan_Rigor::ESTIMATE:
+    default:                      return FFTW_ESTIMATE;
+    }
+}
+
+static int get_fftw_sign(const FFT_Direction direction) {
+    return (direction == FFT_Direction::FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD;
+}
+
+class FFTW3_Plan: public FFT_Plan
+{
+private:
+    struct Many_Key {
+        size_t x_stride;
+        size_t y_stride;
+        size_t nb_transforms;
+        bool operator<(const Many_Key& other) const {
+            return std::tie(x_stride, y_stride, nb_transforms) <
+                   std::tie(other.x_stride, other.y_stride, other.nb_transforms);
+        }
+    };
+    const size_t m_nb_fft;
+    const int m_sign;
+    const unsigned m_flags;
+    fftwf_plan m_plan;
+    // Plans for many transforms are tied to their strides so each layout gets its own
+    std::mutex m_many_plans_mutex;
+    std::map<Many_Key, fftwf_plan> m_many_plans;
+    std::atomic<size_t> m_total_many_plans{0};
+public:
+    FFTW3_Plan(const size_t nb_fft, const int sign, const unsigned flags, fftwf_plan plan)
+    : m_nb_fft(nb_fft), m_sign(sign), m_flags(flags), m_plan(plan) {}
+    ~FFTW3_Plan() override {
+        auto lock = std::scoped_lock(fft_get_planner_mutex());
+        fftwf_destroy_plan(m_plan);
+        for (auto& [key, plan]: m_many_plans) {
+            if (plan != nullptr) fftwf_destroy_plan(plan);
+        }
+    }
+    size_t GetSize() const override { return m_nb_fft; }
+    void Execute(tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y) override {
+        assert(x.size() >= m_nb_fft);
+        assert(y.size() >= m_nb_fft);
+        // NOTE: FFTW3 doesn't modify the input of out of place transforms
+        fftwf_execute_dft(m_plan, (fftwf_complex*)x.data(), (fftwf_complex*)y.data());
+    }
+    void ExecuteMany(
+        tcb::span<const std::complex<float>> x, const size_t x_stride,
+        tcb::span<std::complex<float>> y, const size_t y_stride,
+        const size_t nb_transforms) override 
+    {
+        if (nb_transforms == 0) return;
+        if (nb_transforms == 1) {
+            Execute(x, y);
+            return;
+        }
+        assert(x.size() >= (nb_transforms-1)*x_stride + m_nb_fft);
+        assert(y.size() >= (nb_transforms-1)*y_stride + m_nb_fft);
+        auto plan = GetManyPlan({ x_stride, y_stride, nb_transforms });
+        // Fallback to single transforms if FFTW3 couldn't plan this layout
+        if (plan == nullptr) {
+            for (size_t i = 0; i < nb_transforms; i++) {
+                Execute(x.subspan(i*x_stride, m_nb_fft), y.subspan(i*y_stride, m_nb_fft));
+            }
+            return;
+        }
+        fftwf_execute_dft(plan, (fftwf_complex*)x.data(), (fftwf_complex*)y.data());
+    }
+    void PrepareMany(const size_t x_stride, const size_t y_stride, const size_t nb_transforms) override {
+        if (nb_transforms <= 1) return;
+        GetManyPlan({ x_stride, y_stride, nb_transforms });
+    }
+    size_t GetMemoryBytes() const override {
+        const size_t total_plans = 1u + m_total_many_plans.load(std::memory_order_relaxed);
+        return total_plans*m_nb_fft*sizeof(std::complex<float>);
+    }
+private:
+    fftwf_plan GetManyPlan(const Many_Key& key) {
+        auto lock = std::scoped_lock(m_many_plans_mutex);
+        auto res = m_many_plans.find(key);
+        if (res != m_many_plans.end()) {
+            return res->second;
+        }
+        auto planner_lock = std::scoped_lock(fft_get_planner_mutex());
+        const size_t nb_in = (key.nb_transforms-1)*key.x_stride + m_nb_fft;
+        const size_t nb_out = (key.nb_transforms-1)*key.y_stride + m_nb_fft;
+        fftwf_complex* buf_in = fftwf_alloc_complex(nb_in);
+        fftwf_complex* buf_out = fftwf_alloc_complex(nb_out);
+        const int n = int(m_nb_fft);
+        auto plan = fftwf_plan_many_dft(
+            1, &n, int(key.nb_transforms),
+            buf_in, nullptr, 1, int(key.x_stride),
+            buf_out, nullptr, 1, int(key.y_stride),
+            m_sign, m_flags);
+        fftwf_free(buf_in);
+        fftwf_free(buf_out);
+        // NOTE: Failed plans are kept so we don't try to plan this layout again
+        m_many_plans.insert({ key, plan });
+        if (plan != nullptr) m_total_many_plans.fetch_add(1, std::memory_order_relaxed);
+        return plan;
+    }
+};
+
+std::unique_ptr<FFT_Plan> fft_backend_create_plan(
+    const size_t nb_fft, const FFT_Direction direction, const FFT_Plan_Rigor rigor) 
+{
+    // Measuring overwrites the buffers so we plan with our own
+    // NOTE: These are allocated by FFTW3 so the plan is allowed to use its SIMD kernels
+    fftwf_complex* buf_in = fftwf_alloc_complex(nb_fft);
+    fftwf_complex* buf_out = fftwf_alloc_complex(nb_fft);
+    const int sign = get_fftw_sign(direction);
+    const unsigned flags = get_planner_flags(rigor);
+    auto plan = fftwf_plan_dft_1d(int(nb_fft), buf_in, buf_out, sign, flags);
+    fftwf_free(buf_in);
+    fftwf_free(buf_out);
+    if (plan == nullptr) {
+        return nullptr;
+    }
+    return std::make_unique<FFTW3_Plan>(nb_fft, sign, flags, plan);
+}
+
+bool fft_backend_import_wisdom(const char* filename) {
+    return fftwf_import_wisdom_from_filename(filename) != 0;
+}
+
+bool fft_backend_export_wisdom(const char* filename) {
+    return fftwf_export_wisdom_to_filename(filename) != 0;
+}
+
+const char* fft_backend_get_name() {
+    return "fftw3";
+}
@@ -0,0 +1,62 @@
+#include "./fft_backend.h"
+#include <assert.h>
+#include <stddef.h>
+#include <complex>
+#include <memory>
+#include <vector>
+#include <pocketfft_hdronly.h>
+#include "utility/span.h"
+#include "./fft_plan_cache.h"
+
+// PocketFFT is BSD licensed and header only
+// It has no planner to tune so the plan rigor and wisdom aren't used
+class PocketFFT_Plan: public FFT_Plan
+{
+private:
+    const size_t m_nb_fft;
+    const bool m_is_forward;
+public:
+    PocketFFT_Plan(const size_t nb_fft, const FFT_Direction direction)
+    : m_nb_fft(nb_fft), m_is_forward(direction == FFT_Direction::FORWARD) {}
+    size_t GetSize() const override { return m_nb_fft; }
+    void Execute(tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y) override {
+        ExecuteMany(x, m_nb_fft, y, m_nb_fft, 1);
+    }
+    // NOTE: The transforms of the blocks are vectorised together by PocketFFT
+    void ExecuteMany(
+        tcb::span<const std::complex<float>> x, const size_t x_stride,
+        tcb::span<std::complex<float>> y, const size_t y_stride,
+        const size_t nb_transforms) override 
+    {
+        if (nb_transforms == 0) return;
+        assert(x.size() >= (nb_transforms-1)*x_stride + m_nb_fft);
+        assert(y.size() >= (nb_transforms-1)*y_stride + m_nb_fft);
+        constexpr ptrdiff_t sample_stride = ptrdiff_t(sizeof(std::complex<float>));
+        const pocketfft::shape_t shape = { nb_transforms, m_nb_fft };
+        const pocketfft::stride_t stride_in = { ptrdiff_t(x_stride)*sample_stride, sample_stride };
+        const pocketfft::stride_t stride_out = { ptrdiff_t(y_stride)*sample_stride, sample_stride };
+        const pocketfft::shape_t axes = { 1 };
+        pocketfft::c2c(shape, stride_in, stride_out, axes, m_is_forward, x.data(), y.data(), 1.0f);
+    }
+};
+
+std::unique_ptr<FFT_Plan> fft_backend_create_plan(
+    const size_t nb_fft, const FFT_Direction direction, const FFT_Plan_Rigor rigor) 
+{
+    (void)rigor;
+    return std::make_unique<PocketFFT_Plan>(nb_fft, direction);
+}
+
+bool fft_backend_import_wisdom(const char* filename) {
+    (void)filename;
+    return true;
+}
+
+bool fft_backend_export_wisdom(const char* filename) {
+    (void)filename;
+    return true;
+}
+
+const char* fft_backend_get_name() {
+    return "pocketfft";
+}
@@ -0,0 +1,74 @@
+#include "./fft_plan_cache.h"
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include "./fft_backend.h"
+
+static std::atomic<int> g_fft_plan_rigor{int(FFT_Plan_Rigor::ESTIMATE)};
+
+std::mutex& fft_get_planner_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+const char* fft_get_backend_name() {
+    return fft_backend_get_name();
+}
+
+const char* fft_get_plan_rigor_name(const FFT_Plan_Rigor rigor) {
+    switch (rigor) {
+    case FFT_Plan_Rigor::ESTIMATE: return "estimate";
+    case FFT_Plan_Rigor::MEASURE:  return "measure";
+    case FFT_Plan_Rigor::PATIENT:  return "patient";
+    default:                       return "unknown";
+    }
+}
+
+bool fft_get_plan_rigor_from_name(const char* name, FFT_Plan_Rigor& rigor) {
+    for (int i = int(FFT_Plan_Rigor::ESTIMATE); i <= int(FFT_Plan_Rigor::PATIENT); i++) {
+        if (strcmp(name, fft_get_plan_rigor_name(FFT_Plan_Rigor(i))) == 0) {
+            rigor = FFT_Plan_Rigor(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void fft_set_plan_rigor(const FFT_Plan_Rigor rigor) {
+    g_fft_plan_rigor.store(int(rigor), std::memory_order_relaxed);
+}
+
+FFT_Plan_Rigor fft_get_plan_rigor() {
+    return FFT_Plan_Rigor(g_fft_plan_rigor.load(std::memory_order_relaxed));
+}
+
+bool fft_import_wisdom(const char* filename) {
+    auto lock = std::scoped_lock(fft_get_planner_mutex());
+    return fft_backend_import_wisdom(filename);
+}
+
+bool fft_export_wisdom(const char* filename) {
+    auto lock = std::scoped_lock(fft_get_planner_mutex());
+    return fft_backend_export_wisdom(filename);
+}
+
+std::shared_ptr<FFT_Plan> fft_get_plan(const size_t nb_fft, const FFT_Direction direction) {
+    using Plan_Key = std::tuple<size_t, FFT_Direction, FFT_Plan_Rigor>;
+    static std::map<Plan_Key, std::weak_ptr<FFT_Plan>> plans;
+
+    const auto rigor = fft_get_plan_rigor();
+    const auto key = Plan_Key{ nb_fft, direction, rigor };
+    auto lock = std::scoped_lock(fft_get_planner_mutex());
+    auto plan = plans[key].lock();
+    if (plan != nullptr) {
+        return plan;
+    }
+
+    plan = fft_backend_create_plan(nb_fft, direction, rigor);
+    plans[key] = plan;
+    return plan;
+}
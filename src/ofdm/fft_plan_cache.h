@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <complex>
+#include <memory>
+#include "utility/span.h"
+
+// How much time FFTW3 spends searching for the fastest plan
+// Measured plans are much faster to create if they are already in the loaded wisdom
+// NOTE: Backends that don't search for plans ignore this
+enum class FFT_Plan_Rigor: int {
+    ESTIMATE=0, MEASURE=1, PATIENT=2,
+};
+
+enum class FFT_Direction {
+    FORWARD, BACKWARD,
+};
+
+// Unnormalised transform of nb_fft samples given by the backend selected with OFDM_FFT_BACKEND
+// NOTE: Execute() is thread safe so a plan can be used by many threads at once
+//       Transforms are out of place and expect buffers aligned for SIMD
+class FFT_Plan
+{
+public:
+    virtual ~FFT_Plan() {}
+    virtual size_t GetSize() const = 0;
+    virtual void Execute(tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y) = 0;
+    // Transform of many blocks where block i starts at x[i*x_stride] and y[i*y_stride]
+    virtual void ExecuteMany(
+        tcb::span<const std::complex<float>> x, const size_t x_stride,
+        tcb::span<std::complex<float>> y, const size_t y_stride,
+        const size_t nb_transforms) = 0;
+    // Creates the plan ExecuteMany() uses for these strides ahead of time
+    // NOTE: Otherwise it is made on the first call which stalls that caller while it is measured
+    //       Backends that don't plan for many transforms ignore this
+    virtual void PrepareMany(const size_t x_stride, const size_t y_stride, const size_t nb_transforms) {}
+    // Estimate of the memory held by the backend for this plan and its plans for many transforms
+    // NOTE: Backends don't expose the size of their plans so this assumes a table of twiddles for each one
+    virtual size_t GetMemoryBytes() const { return GetSize()*sizeof(std::complex<float>); }
+};
+
+const char* fft_get_backend_name();
+
+const char* fft_get_plan_rigor_name(const FFT_Plan_Rigor rigor);
+// Returns false if the name doesn't match a rigor
+bool fft_get_plan_rigor_from_name(const char* name, FFT_Plan_Rigor& rigor);
+// Only plans created after this is called use the new rigor
+void fft_set_plan_rigor(const FFT_Plan_Rigor rigor);
+FFT_Plan_Rigor fft_get_plan_rigor();
+
+// Wisdom of previously measured plans is kept between runs in a file
+// Returns false if the file couldn't be read or written
+// NOTE: These always succeed for backends without wisdom since there is nothing to load or save
+bool fft_import_wisdom(const char* filename);
+bool fft_export_wisdom(const char* filename);
+
+// Plans of the same size, direction and rigor are shared until all their users are destroyed
+std::shared_ptr<FFT_Plan> fft_get_plan(const size_t nb_fft, const FFT_Direction direction);
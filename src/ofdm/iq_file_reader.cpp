@@ -0,0 +1,192 @@
+#include "./iq_file_reader.h"
+#include <string.h>
+#include <algorithm>
+#include "./dsp/convert_raw_iq.h"
+
+// Source: http://soundfile.sapp.org/doc/WaveFormat/
+constexpr uint16_t WAV_FORMAT_PCM = 0x0001;
+constexpr uint16_t WAV_FORMAT_IEEE_FLOAT = 0x0003;
+// The actual format is stored in the first 2 bytes of the sub format guid
+constexpr uint16_t WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+constexpr size_t WAV_FORMAT_MIN_SIZE = 16;
+constexpr size_t WAV_FORMAT_EXTENSIBLE_SIZE = 40;
+// Writers that stream a wav file leave the data size as 0 or the maximum if they can't seek back to patch it
+constexpr uint32_t WAV_DATA_SIZE_UNKNOWN = 0xFFFFFFFF;
+
+// All formats are scaled to the range of 8bit samples
+constexpr float SCALE_S16 = 1.0f/256.0f;
+constexpr float SCALE_F32 = 128.0f;
+
+static uint16_t read_u16(const uint8_t* x) {
+    return uint16_t(x[0]) | uint16_t(x[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* x) {
+    return uint32_t(x[0]) | (uint32_t(x[1]) << 8) | (uint32_t(x[2]) << 16) | (uint32_t(x[3]) << 24);
+}
+
+static size_t get_bytes_per_sample(const IQ_File_Format format) {
+    switch (format) {
+    case IQ_File_Format::U8:  return 2*sizeof(uint8_t);
+    case IQ_File_Format::S8:  return 2*sizeof(int8_t);
+    case IQ_File_Format::S16: return 2*sizeof(int16_t);
+    case IQ_File_Format::F32: return 2*sizeof(float);
+    default:                  return 2;
+    }
+}
+
+bool IQ_File_Reader::Open(const std::string& filename, const IQ_File_Format raw_format) {
+    Close();
+    if (!m_file.open(filename, MappedFile::Access_Pattern::SEQUENTIAL)) return false;
+    const auto file = m_file.get_bytes();
+    const bool is_riff = (file.size() >= 12) && (memcmp(file.data(), "RIFF", 4) == 0) && (memcmp(file.data()+8, "WAVE", 4) == 0);
+    if (is_riff) {
+        if (!ReadWavHeader(file)) {
+            Close();
+            return false;
+        }
+        m_is_wav = true;
+    } else {
+        m_format = raw_format;
+        m_data = file;
+    }
+    m_bytes_per_sample = get_bytes_per_sample(m_format);
+    return true;
+}
+
+void IQ_File_Reader::Close() {
+    m_file.close();
+    m_data = {};
+    m_format = IQ_File_Format::U8;
+    m_bytes_per_sample = get_bytes_per_sample(m_format);
+    m_sample_rate = 0;
+    m_is_wav = false;
+    m_cursor = 0;
+}
+
+bool IQ_File_Reader::ReadWavHeader(tcb::span<const uint8_t> file) {
+    bool is_format_found = false;
+    size_t offset = 12;
+    while (offset+8 <= file.size()) {
+        const uint8_t* chunk = file.data() + offset;
+        const uint32_t chunk_size = read_u32(chunk+4);
+        const size_t body_offset = offset+8;
+        const size_t body_size = std::min(size_t(chunk_size), file.size()-body_offset);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (body_size < WAV_FORMAT_MIN_SIZE) return false;
+            const uint8_t* body = file.data() + body_offset;
+            uint16_t audio_format = read_u16(body+0);
+            const uint16_t total_channels = read_u16(body+2);
+            m_sample_rate = read_u32(body+4);
+            const uint16_t bits_per_sample = read_u16(body+14);
+            if ((audio_format == WAV_FORMAT_EXTENSIBLE) && (body_size >= WAV_FORMAT_EXTENSIBLE_SIZE)) {
+                audio_format = read_u16(body+24);
+            }
+            // IQ is stored as a stereo pair
+            if (total_channels != 2) return false;
+            if ((audio_format == WAV_FORMAT_PCM) && (bits_per_sample == 8)) {
+                m_format = IQ_File_Format::U8;
+            } else if ((audio_format == WAV_FORMAT_PCM) && (bits_per_sample == 16)) {
+                m_format = IQ_File_Format::S16;
+            } else if ((audio_format == WAV_FORMAT_IEEE_FLOAT) && (bits_per_sample == 32)) {
+                m_format = IQ_File_Format::F32;
+            } else {
+                return false;
+            }
+            is_format_found = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!is_format_found) return false;
+            const bool is_unknown_size = (chunk_size == 0) || (chunk_size == WAV_DATA_SIZE_UNKNOWN);
+            m_data = file.subspan(body_offset, is_unknown_size ? (file.size()-body_offset) : body_size);
+            return true;
+        }
+        // chunks are padded to an even number of bytes
+        offset = body_offset + size_t(chunk_size) + (chunk_size & 1);
+    }
+    return false;
+}
+
+size_t IQ_File_Reader::Convert(const size_t offset, tcb::span<std::complex<float>> y) const {
+    const size_t total_samples = GetTotalSamples();
+    if (offset >= total_samples) return 0;
+    const size_t N = std::min(y.size(), total_samples-offset);
+    const uint8_t* x = m_data.data() + offset*m_bytes_per_sample;
+    y = y.first(N);
+    switch (m_format) {
+    case IQ_File_Format::U8:
+        convert_raw_iq_auto({ x, 2*N }, y);
+        break;
+    case IQ_File_Format::S8:
+        convert_raw_iq_auto({ reinterpret_cast<const int8_t*>(x), 2*N }, y);
+        break;
+    case IQ_File_Format::S16:
+        {
+            Raw_IQ_Correction correction;
+            correction.gain = { SCALE_S16, SCALE_S16 };
+            convert_raw_iq_auto({ reinterpret_cast<const int16_t*>(x), 2*N }, y, 0.0f, correction);
+        }
+        break;
+    case IQ_File_Format::F32:
+        // NOTE: Chunks before the data in a wav file can leave the floats unaligned so they are copied out
+        //       The compiler vectorises this into unaligned loads
+        for (size_t i = 0; i < N; i++) {
+            float v[2];
+            memcpy(v, x + i*sizeof(v), sizeof(v));
+            y[i] = std::complex<float>(v[0]*SCALE_F32, v[1]*SCALE_F32);
+        }
+        break;
+    }
+    return N;
+}
+
+size_t IQ_File_Reader::Read(tcb::span<std::complex<float>> y, const bool is_loop) {
+    const size_t total_samples = GetTotalSamples();
+    if (total_samples == 0) return 0;
+    size_t total_read = 0;
+    while (total_read < y.size()) {
+        if (m_cursor >= total_samples) {
+            if (!is_loop) break;
+            m_cursor = 0;
+        }
+        const size_t length = Convert(m_cursor, y.subspan(total_read));
+        m_cursor += length;
+        total_read += length;
+    }
+    return total_read;
+}
+
+tcb::span<const uint8_t> IQ_File_Reader::ReadBytes(const size_t max_samples, const bool is_loop) {
+    const size_t total_samples = GetTotalSamples();
+    if (m_cursor >= total_samples) {
+        if (!is_loop) return {};
+        m_cursor = 0;
+    }
+    const size_t length = std::min(max_samples, total_samples-m_cursor);
+    const auto data = m_data.subspan(m_cursor*m_bytes_per_sample, length*m_bytes_per_sample);
+    m_cursor += length;
+    return data;
+}
+
+const char* get_iq_file_format_name(const IQ_File_Format format) {
+    switch (format) {
+    case IQ_File_Format::U8:  return "u8";
+    case IQ_File_Format::S8:  return "s8";
+    case IQ_File_Format::S16: return "s16";
+    case IQ_File_Format::F32: return "f32";
+    default:                  return "unknown";
+    }
+}
+
+bool get_iq_file_format_from_name(const char* name, IQ_File_Format& format) {
+    const IQ_File_Format formats[] = {
+        IQ_File_Format::U8, IQ_File_Format::S8, IQ_File_Format::S16, IQ_File_Format::F32,
+    };
+    for (const auto f: formats) {
+        if (strcmp(name, get_iq_file_format_name(f)) == 0) {
+            format = f;
+            return true;
+        }
+    }
+    return false;
+}
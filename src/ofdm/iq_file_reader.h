@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <string>
+#include "utility/span.h"
+#include "utility/mapped_file.h"
+
+// Sample formats of interleaved IQ recordings
+enum class IQ_File_Format {
+    U8,     // rtl-sdr and 8bit wav files
+    S8,     // HackRF
+    S16,    // CS16 and 16bit wav files
+    F32,    // complex<float> and 32bit IEEE float wav files
+};
+
+// Memory mapped reader of a raw or wav IQ recording
+// The wav header is parsed once when opened and samples are converted straight out of the mapping
+// All formats are scaled to the range of 8bit samples so any recording can be given to the demodulator
+// NOTE: Convert() only reads from the mapping so multiple threads can convert different parts at once
+//       Read() and ReadBytes() share a single cursor and must only be called from one thread
+class IQ_File_Reader
+{
+private:
+    MappedFile m_file;
+    tcb::span<const uint8_t> m_data;
+    IQ_File_Format m_format = IQ_File_Format::U8;
+    size_t m_bytes_per_sample = 2;
+    uint32_t m_sample_rate = 0;
+    bool m_is_wav = false;
+    size_t m_cursor = 0;
+public:
+    IQ_File_Reader() {}
+    IQ_File_Reader(IQ_File_Reader&) = delete;
+    IQ_File_Reader(IQ_File_Reader&&) = delete;
+    IQ_File_Reader& operator=(IQ_File_Reader&) = delete;
+    IQ_File_Reader& operator=(IQ_File_Reader&&) = delete;
+    // Files starting with a RIFF/WAVE header use the format in their header otherwise raw_format is used
+    // Returns false if the file couldn't be mapped or has a wav header we can't read
+    bool Open(const std::string& filename, const IQ_File_Format raw_format=IQ_File_Format::U8);
+    void Close();
+    bool GetIsWav() const { return m_is_wav; }
+    IQ_File_Format GetFormat() const { return m_format; }
+    size_t GetBytesPerSample() const { return m_bytes_per_sample; }
+    // 0 if the file is raw
+    uint32_t GetSampleRate() const { return m_sample_rate; }
+    size_t GetTotalSamples() const { return m_data.size() / m_bytes_per_sample; }
+    // Samples in the file without the wav header and any trailing partial sample
+    tcb::span<const uint8_t> GetData() const { return m_data.first(GetTotalSamples()*m_bytes_per_sample); }
+    // Converts y.size() samples starting at offset. Returns the number of samples converted
+    size_t Convert(const size_t offset, tcb::span<std::complex<float>> y) const;
+    // Converts samples from the cursor. If looping then the cursor wraps to the start without any seeks
+    // Returns the number of samples read which is only less than y.size() at the end of a file that isn't looped
+    size_t Read(tcb::span<std::complex<float>> y, const bool is_loop=false);
+    // Returns up to max_samples samples of unconverted data from the cursor without copying
+    // The span never crosses the end of the file so it is empty only when the end is reached without looping
+    tcb::span<const uint8_t> ReadBytes(const size_t max_samples, const bool is_loop=false);
+    void Rewind() { m_cursor = 0; }
+private:
+    bool ReadWavHeader(tcb::span<const uint8_t> file);
+};
+
+const char* get_iq_file_format_name(const IQ_File_Format format);
+bool get_iq_file_format_from_name(const char* name, IQ_File_Format& format);
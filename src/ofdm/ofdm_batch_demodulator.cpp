@@ -0,0 +1,368 @@
+#include "./ofdm_batch_demodulator.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./ofdm_demodulator.h"
+#include "./ofdm_params.h"
+
+// Number of samples passed to OFDM_Demod::Process() at once
+constexpr size_t WORKER_BLOCK_SIZE = 65536;
+// Number of frames each worker scans at once during the coarse pass
+constexpr size_t NULL_SEARCH_CHUNK_FRAMES = 16;
+// Number of segments that can be demodulated ahead of the segment being published per worker
+constexpr size_t MAX_SEGMENTS_IN_FLIGHT_PER_WORKER = 2;
+
+struct OFDM_Batch_Demod::Worker {
+    std::unique_ptr<OFDM_Demod> demod;
+    std::vector<std::complex<float>> buffer;
+    // written to by the coordinator thread of the demodulator
+    std::vector<viterbi_bit_t>* out_bits = nullptr;
+    size_t total_frames = 0;
+    size_t max_frames = 0;
+};
+
+struct OFDM_Batch_Demod::Segment_Result {
+    std::vector<viterbi_bit_t> bits;
+    size_t total_frames = 0;
+    bool is_done = false;
+    // frequency offset at the end of the segment
+    bool is_synced = false;
+    float freq_coarse_offset = 0.0f;
+    float freq_fine_offset = 0.0f;
+};
+
+OFDM_Batch_Demod::OFDM_Batch_Demod(
+    const OFDM_Params& params,
+    const tcb::span<const std::complex<float>> prs_fft_ref,
+    const tcb::span<const int> carrier_mapper,
+    const size_t nb_workers,
+    const size_t frames_per_segment)
+:   m_params(params),
+    m_frames_per_segment(std::max(frames_per_segment, size_t(1)))
+{
+    m_total_frames_expected = 0;
+    m_total_frames_read = 0;
+    m_total_segments_desync = 0;
+
+    size_t total_workers = nb_workers;
+    if (total_workers == 0) {
+        total_workers = size_t(std::thread::hardware_concurrency());
+    }
+    total_workers = std::max(total_workers, size_t(1));
+
+    // NOTE: We create all demodulators on this thread since creating FFTW plans isn't thread safe
+    //       Parallelism comes from having many frames in flight so each demodulator uses one pipeline thread
+    for (size_t i = 0; i < total_workers; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->demod = std::make_unique<OFDM_Demod>(params, prs_fft_ref, carrier_mapper, 1);
+        worker->buffer.resize(WORKER_BLOCK_SIZE);
+        auto* worker_ptr = worker.get();
+        worker->demod->On_OFDM_Frame().Attach([worker_ptr](tcb::span<const viterbi_bit_t> bits) {
+            if (worker_ptr->out_bits == nullptr) return;
+            if (worker_ptr->total_frames >= worker_ptr->max_frames) return;
+            auto& out_bits = *(worker_ptr->out_bits);
+            out_bits.insert(out_bits.end(), bits.begin(), bits.end());
+            worker_ptr->total_frames++;
+        });
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+OFDM_Batch_Demod::~OFDM_Batch_Demod() = default;
+
+std::vector<size_t> OFDM_Batch_Demod::FindNullSymbols(const Sample_Reader& reader, const size_t total_samples) const {
+    // Clause 3.12.2 - Frame synchronisation using power detection
+    // We find all the null symbols using the L1 power of blocks of K samples
+    // Each worker scans a chunk of the recording and only keeps null symbols which start inside it
+    // Chunks are extended by one block at the start and a null symbol at the end
+    // so a null symbol crossing a chunk boundary is seen completely by the chunk that owns it
+    const size_t K = std::max(m_params.nb_null_period/8, size_t(1));
+    const size_t chunk_length = ((NULL_SEARCH_CHUNK_FRAMES*GetFramePeriod()) / K) * K;
+    const size_t chunk_overlap = m_params.nb_null_period + 2*K;
+    const size_t total_chunks = (total_samples + chunk_length - 1) / chunk_length;
+    // null symbol must be at least half as long as expected and at most twice as long
+    const size_t min_null_blocks = std::max(m_params.nb_null_period/(2*K), size_t(1));
+    const size_t max_null_blocks = (2*m_params.nb_null_period)/K;
+    const float thresh_null_start = m_cfg.null_l1_search.thresh_null_start;
+
+    std::vector<std::vector<size_t>> chunk_nulls(total_chunks);
+    std::atomic<size_t> next_chunk{0};
+    const auto scan_chunks = [&]() {
+        std::vector<std::complex<float>> buffer(WORKER_BLOCK_SIZE - WORKER_BLOCK_SIZE % K);
+        std::vector<float> block_l1;
+        while (true) {
+            const size_t chunk_index = next_chunk.fetch_add(1);
+            if (chunk_index >= total_chunks) break;
+
+            const size_t owned_start = chunk_index*chunk_length;
+            const size_t owned_end = std::min(owned_start + chunk_length, total_samples);
+            const size_t read_start = (owned_start >= K) ? (owned_start-K) : 0;
+            const size_t read_end = std::min(owned_end + chunk_overlap, total_samples);
+            const size_t total_blocks = (read_end-read_start)/K;
+
+            block_l1.resize(total_blocks);
+            for (size_t i = 0; i < total_blocks; ) {
+                const size_t nb_blocks = std::min(buffer.size()/K, total_blocks-i);
+                auto buf = tcb::span(buffer).first(nb_blocks*K);
+                reader(read_start + i*K, buf);
+                for (size_t j = 0; j < nb_blocks; j++) {
+                    float l1 = 0.0f;
+                    for (size_t k = 0; k < K; k++) {
+                        const auto& v = buf[j*K+k];
+                        l1 += std::abs(v.real()) + std::abs(v.imag());
+                    }
+                    block_l1[i+j] = l1;
+                }
+                i += nb_blocks;
+            }
+            if (total_blocks == 0) continue;
+
+            // NOTE: Null symbols are a small fraction of a frame so they barely affect the average
+            float l1_average = 0.0f;
+            for (const float l1: block_l1) l1_average += l1;
+            l1_average /= float(total_blocks);
+            const float l1_threshold = l1_average*thresh_null_start;
+
+            auto& nulls = chunk_nulls[chunk_index];
+            size_t run_start = 0;
+            size_t run_length = 0;
+            for (size_t i = 0; i <= total_blocks; i++) {
+                const bool is_null = (i < total_blocks) && (block_l1[i] < l1_threshold);
+                if (is_null) {
+                    if (run_length == 0) run_start = i;
+                    run_length++;
+                    continue;
+                }
+                if (run_length == 0) continue;
+                // ignore runs that are cut off by either end of the chunk unless it is the end of the recording
+                const bool is_cut_start = (run_start == 0) && (read_start > 0);
+                const bool is_cut_end = (i == total_blocks) && (read_end < total_samples);
+                const size_t null_start = read_start + run_start*K;
+                const bool is_owned = (null_start >= owned_start) && (null_start < owned_end);
+                const bool is_valid_length = (run_length >= min_null_blocks) && (run_length <= max_null_blocks);
+                if (!is_cut_start && !is_cut_end && is_owned && is_valid_length) {
+                    nulls.push_back(null_start);
+                }
+                run_length = 0;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const size_t total_threads = std::min(m_workers.size(), total_chunks);
+    for (size_t i = 1; i < total_threads; i++) {
+        threads.emplace_back(scan_chunks);
+    }
+    scan_chunks();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    std::vector<size_t> null_starts;
+    for (const auto& nulls: chunk_nulls) {
+        null_starts.insert(null_starts.end(), nulls.begin(), nulls.end());
+    }
+    return null_starts;
+}
+
+std::vector<OFDM_Batch_Demod::Segment> OFDM_Batch_Demod::CreateSegments(
+    const std::vector<size_t>& null_starts, const size_t total_samples) const
+{
+    const size_t frame_period = GetFramePeriod();
+    const size_t tolerance = m_params.nb_symbol_period;
+
+    // Remove spurious null symbols such as deep fades which occur within a frame
+    std::vector<size_t> nulls;
+    for (const size_t null_start: null_starts) {
+        if (!nulls.empty() && ((null_start - nulls.back()) < (frame_period - tolerance))) {
+            continue;
+        }
+        nulls.push_back(null_start);
+    }
+
+    // Each segment starts a null symbol early so the demodulator sees the signal power before the null symbol
+    // Each segment ends just after the null symbol of the next frame so the last frame is complete
+    // but the frame after it can't be started
+    const size_t lead_samples = m_params.nb_null_period;
+    const size_t tail_samples = m_params.nb_null_period + m_params.nb_symbol_period/2;
+    std::vector<Segment> segments;
+    size_t frame_start = 0;
+    size_t total_frames = 0;
+    const auto push_segment = [&](const size_t frame_end) {
+        if (total_frames == 0) return;
+        Segment segment;
+        segment.sample_start = (frame_start >= lead_samples) ? (frame_start-lead_samples) : 0;
+        segment.sample_end = std::min(frame_end + tail_samples, total_samples);
+        segment.total_frames = total_frames;
+        segments.push_back(segment);
+        total_frames = 0;
+    };
+    for (size_t i = 1; i < nulls.size(); i++) {
+        const size_t prev_null = nulls[i-1];
+        const size_t curr_null = nulls[i];
+        const size_t distance = curr_null - prev_null;
+        const bool is_frame = (distance + tolerance >= frame_period) && (distance <= frame_period + tolerance);
+        if (!is_frame) {
+            // the signal was lost so this segment can't continue across the gap
+            push_segment(prev_null);
+            continue;
+        }
+        if (total_frames == 0) {
+            frame_start = prev_null;
+        }
+        total_frames++;
+        if (total_frames == m_frames_per_segment) {
+            push_segment(curr_null);
+        }
+    }
+    if (!nulls.empty()) {
+        push_segment(nulls.back());
+    }
+    return segments;
+}
+
+void OFDM_Batch_Demod::ProcessSegment(
+    Worker& worker, const Sample_Reader& reader, const Segment& segment, Segment_Result& result)
+{
+    auto& demod = *(worker.demod.get());
+    const size_t frame_bits = demod.GetFrameDataBits().size();
+    result.bits.clear();
+    result.bits.reserve(segment.total_frames*frame_bits);
+    worker.out_bits = &result.bits;
+    worker.total_frames = 0;
+    worker.max_frames = segment.total_frames;
+
+    const int start_desync = demod.GetTotalFramesDesync();
+    for (size_t offset = segment.sample_start; offset < segment.sample_end; ) {
+        const size_t length = std::min(worker.buffer.size(), segment.sample_end-offset);
+        auto buf = tcb::span(worker.buffer).first(length);
+        reader(offset, buf);
+        demod.Process(buf);
+        offset += length;
+    }
+    demod.Flush();
+
+    worker.out_bits = nullptr;
+    result.total_frames = worker.total_frames;
+    result.is_synced = (demod.GetTotalFramesDesync() == start_desync) && (result.total_frames > 0);
+    result.freq_coarse_offset = demod.GetCoarseFrequencyOffset();
+    result.freq_fine_offset = demod.GetFineFrequencyOffset();
+}
+
+void OFDM_Batch_Demod::Process(const Sample_Reader& reader, const size_t total_samples) {
+    for (auto& worker: m_workers) {
+        worker->demod->GetConfig() = m_cfg;
+    }
+
+    const auto null_starts = FindNullSymbols(reader, total_samples);
+    const auto segments = CreateSegments(null_starts, total_samples);
+    const size_t total_segments = segments.size();
+    for (const auto& segment: segments) {
+        m_total_frames_expected += segment.total_frames;
+    }
+    if (total_segments == 0) return;
+
+    std::vector<Segment_Result> results(total_segments);
+    const size_t frame_bits = m_workers[0]->demod->GetFrameDataBits().size();
+    const auto publish_segment = [this, frame_bits](Segment_Result& result) {
+        for (size_t i = 0; i < result.total_frames; i++) {
+            m_obs_on_ofdm_frame.Notify(tcb::span(result.bits).subspan(i*frame_bits, frame_bits));
+        }
+        m_total_frames_read += result.total_frames;
+        if (!result.is_synced) {
+            m_total_segments_desync++;
+        }
+        result.bits.clear();
+        result.bits.shrink_to_fit();
+    };
+
+    // The first segment acquires the initial frequency offset for the rest of the recording
+    auto& first_worker = *(m_workers[0].get());
+    first_worker.demod->Reset();
+    ProcessSegment(first_worker, reader, segments[0], results[0]);
+    publish_segment(results[0]);
+    if (total_segments == 1) return;
+
+    std::mutex mutex_results;
+    std::condition_variable cv_results;
+    size_t next_segment = 1;
+    size_t next_publish_segment = 1;
+    // carry forward the frequency offset from the latest segment that stayed synchronised
+    size_t seed_segment = 0;
+    float seed_coarse_offset = results[0].freq_coarse_offset;
+    float seed_fine_offset = results[0].freq_fine_offset;
+    bool is_seeded = results[0].is_synced;
+    const size_t max_in_flight = MAX_SEGMENTS_IN_FLIGHT_PER_WORKER*m_workers.size();
+
+    const auto run_worker = [&](Worker& worker) {
+        while (true) {
+            size_t segment_index = 0;
+            bool is_worker_seeded = false;
+            float coarse_offset = 0.0f;
+            float fine_offset = 0.0f;
+            {
+                auto lock = std::unique_lock(mutex_results);
+                cv_results.wait(lock, [&]() { 
+                    return (next_segment >= total_segments) || (next_segment < (next_publish_segment + max_in_flight)); 
+                });
+                if (next_segment >= total_segments) break;
+                segment_index = next_segment++;
+                is_worker_seeded = is_seeded;
+                coarse_offset = seed_coarse_offset;
+                fine_offset = seed_fine_offset;
+            }
+
+            auto& result = results[segment_index];
+            worker.demod->Reset();
+            if (is_worker_seeded) {
+                worker.demod->SetFrequencyOffset(coarse_offset, fine_offset);
+            }
+            ProcessSegment(worker, reader, segments[segment_index], result);
+
+            {
+                auto lock = std::unique_lock(mutex_results);
+                result.is_done = true;
+                if (result.is_synced && (segment_index > seed_segment)) {
+                    seed_segment = segment_index;
+                    seed_coarse_offset = result.freq_coarse_offset;
+                    seed_fine_offset = result.freq_fine_offset;
+                    is_seeded = true;
+                }
+            }
+            cv_results.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto& worker: m_workers) {
+        threads.emplace_back(run_worker, std::ref(*(worker.get())));
+    }
+
+    // publish segments in order on this thread
+    for (size_t i = 1; i < total_segments; i++) {
+        {
+            auto lock = std::unique_lock(mutex_results);
+            cv_results.wait(lock, [&]() { return results[i].is_done; });
+        }
+        publish_segment(results[i]);
+        {
+            auto lock = std::unique_lock(mutex_results);
+            next_publish_segment = i+1;
+        }
+        cv_results.notify_all();
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "utility/observable.h"
+#include "utility/span.h"
+#include "viterbi_config.h"
+#include "./ofdm_demodulator.h"
+#include "./ofdm_params.h"
+
+// Demodulates a recording with many frames in flight for offline processing
+// 1. A coarse pass finds the null symbols of the whole recording from their L1 power
+// 2. The frames between the null symbols are split into segments of consecutive frames
+// 3. Segments are demodulated by independent OFDM_Demod workers
+//    Each segment is seeded with the frequency offset of the latest finished segment
+// NOTE: Frames are published in order on the thread that calls Process()
+class OFDM_Batch_Demod
+{
+public:
+    // Reads samples [offset, offset+buf.size()) of the recording into buf
+    // NOTE: This is called by all workers at once so it must be thread safe
+    using Sample_Reader = std::function<void(const size_t offset, tcb::span<std::complex<float>> buf)>;
+    struct Segment {
+        size_t sample_start;
+        size_t sample_end;
+        size_t total_frames;
+    };
+private:
+    struct Worker;
+    struct Segment_Result;
+    const OFDM_Params m_params;
+    const size_t m_frames_per_segment;
+    OFDM_Demod_Config m_cfg;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Observable<tcb::span<const viterbi_bit_t>> m_obs_on_ofdm_frame;
+    // statistics
+    size_t m_total_frames_expected;
+    size_t m_total_frames_read;
+    size_t m_total_segments_desync;
+public:
+    // nb_workers=0 uses one worker per core
+    OFDM_Batch_Demod(
+        const OFDM_Params& params,
+        const tcb::span<const std::complex<float>> prs_fft_ref,
+        const tcb::span<const int> carrier_mapper,
+        const size_t nb_workers=0,
+        const size_t frames_per_segment=16);
+    ~OFDM_Batch_Demod();
+    // workers use lambdas which take in the this pointer
+    OFDM_Batch_Demod(OFDM_Batch_Demod&) = delete;
+    OFDM_Batch_Demod(OFDM_Batch_Demod&&) = delete;
+    OFDM_Batch_Demod& operator=(OFDM_Batch_Demod&) = delete;
+    OFDM_Batch_Demod& operator=(OFDM_Batch_Demod&&) = delete;
+    // Demodulates the whole recording and blocks until all frames are published
+    void Process(const Sample_Reader& reader, const size_t total_samples);
+    // Coarse pass that returns the starting sample of each null symbol in ascending order
+    std::vector<size_t> FindNullSymbols(const Sample_Reader& reader, const size_t total_samples) const;
+    // Frames are only kept if the distance to the next null symbol is close to the frame period
+    std::vector<Segment> CreateSegments(const std::vector<size_t>& null_starts, const size_t total_samples) const;
+    // NOTE: This is applied to the workers when Process() is called
+    auto& GetConfig() { return m_cfg; }
+    const auto& GetConfig() const { return m_cfg; }
+    OFDM_Params GetOFDMParams() const { return m_params; }
+    size_t GetTotalWorkers() const { return m_workers.size(); }
+    size_t GetTotalFramesExpected() const { return m_total_frames_expected; }
+    size_t GetTotalFramesRead() const { return m_total_frames_read; }
+    size_t GetTotalSegmentsDesync() const { return m_total_segments_desync; }
+    auto& On_OFDM_Frame() { return m_obs_on_ofdm_frame; }
+private:
+    size_t GetFramePeriod() const { return m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period; }
+    void ProcessSegment(Worker& worker, const Sample_Reader& reader, const Segment& segment, Segment_Result& result);
+};
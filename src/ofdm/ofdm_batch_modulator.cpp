@@ -0,0 +1,210 @@
+#include "./ofdm_batch_modulator.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "utility/aligned_allocator.hpp"
+#include "utility/span.h"
+#include "./fft_plan_cache.h"
+#include "./ofdm_params.h"
+
+// Number of data symbols that are transformed together by a worker
+constexpr size_t SYMBOLS_PER_JOB = 8;
+constexpr size_t FFT_ALIGN_AMOUNT = 32;
+
+// Phase index i is the constellation point e^(j*i*π/4)
+constexpr float A = 0.70710678118654752f;
+static const std::complex<float> PHASE_TABLE[8] = {
+    { 1.0f, 0.0f}, { A, A}, {0.0f, 1.0f}, {-A, A},
+    {-1.0f, 0.0f}, {-A,-A}, {0.0f,-1.0f}, { A,-A},
+};
+// Each pair of bits rotates the carrier by {-3π/4, -π/4, π/4, 3π/4} (see OFDM_Modulator)
+constexpr uint8_t PHASE_STEP[4] = { 5, 7, 1, 3 };
+
+// Runs the worker on the calling thread and on total_workers-1 other threads
+template <typename F>
+static void run_on_workers(const size_t total_workers, F&& worker) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < total_workers; i++) {
+        threads.emplace_back([&worker]() { worker(); });
+    }
+    worker();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
+
+OFDM_Batch_Modulator::OFDM_Batch_Modulator(
+    const OFDM_Params& params,
+    tcb::span<const std::complex<float>> prs_fft_ref,
+    const size_t nb_workers)
+:   m_params(params),
+    m_frame_out_size(params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols),
+    m_data_in_size((params.nb_frame_symbols-1)*params.nb_data_carriers*2/8)
+{
+    m_total_workers = nb_workers;
+    if (m_total_workers == 0) {
+        m_total_workers = size_t(std::thread::hardware_concurrency());
+    }
+    m_total_workers = std::max(m_total_workers, size_t(1));
+
+    m_ifft_plan = fft_get_plan(m_params.nb_fft, FFT_Direction::BACKWARD);
+    // NOTE: We create the plans used by the workers here so they don't wait on each other to plan them
+    const size_t nb_data_symbols = m_params.nb_frame_symbols-1;
+    m_ifft_plan->PrepareMany(m_params.nb_fft, m_params.nb_symbol_period, std::min(SYMBOLS_PER_JOB, nb_data_symbols));
+    m_ifft_plan->PrepareMany(m_params.nb_fft, m_params.nb_symbol_period, nb_data_symbols % SYMBOLS_PER_JOB);
+
+    // create our time domain prs symbol with the cyclic prefix
+    m_prs_time_ref.resize(m_params.nb_symbol_period);
+    {
+        auto buf = tcb::span(m_prs_time_ref).subspan(m_params.nb_cyclic_prefix, m_params.nb_fft);
+        m_ifft_plan->Execute(prs_fft_ref, buf);
+        std::copy_n(m_prs_time_ref.begin()+m_params.nb_fft, m_params.nb_cyclic_prefix, m_prs_time_ref.begin());
+    }
+
+    // Data carriers are read as [-M,-1] then [1,M] which are the FFT bins [N-M,N-1] and [1,M]
+    const size_t M = m_params.nb_data_carriers/2;
+    const size_t N = m_params.nb_fft;
+    m_prs_phase.resize(m_params.nb_data_carriers);
+    for (size_t i = 0; i < m_params.nb_data_carriers; i++) {
+        const size_t bin = (i < M) ? (N-M+i) : (1+i-M);
+        const auto prs = prs_fft_ref[bin];
+        const long index = std::lround(std::atan2(prs.imag(), prs.real()) * 4.0f / float(M_PI)); // NOLINT
+        const uint8_t phase = uint8_t(index & 0b111);
+        if (std::abs(prs - PHASE_TABLE[phase]) > 1e-3f) {
+            throw std::runtime_error(fmt::format("PRS of carrier {} isn't a multiple of π/4", i));
+        }
+        m_prs_phase[i] = phase;
+    }
+}
+
+OFDM_Batch_Modulator::~OFDM_Batch_Modulator() = default;
+
+bool OFDM_Batch_Modulator::ProcessFrames(
+    tcb::span<std::complex<float>> frames_out,
+    tcb::span<const uint8_t> data_in)
+{
+    // invalid buffer sizes
+    if ((data_in.size() % m_data_in_size) != 0) {
+        return false;
+    }
+    const size_t nb_frames = data_in.size() / m_data_in_size;
+    if (frames_out.size() != nb_frames*m_frame_out_size) {
+        return false;
+    }
+    if (nb_frames == 0) {
+        return true;
+    }
+
+    const size_t K = m_params.nb_data_carriers;
+    const size_t nb_data_symbols = m_params.nb_frame_symbols-1;
+    const size_t nb_frame_phases = nb_data_symbols*K;
+    m_frame_phases.resize(nb_frames*nb_frame_phases);
+
+    // 1. Null symbol, PRS and differential encoding of each frame
+    {
+        std::atomic<size_t> next_frame{0};
+        run_on_workers(std::min(m_total_workers, nb_frames), [&]() {
+            while (true) {
+                const size_t i = next_frame.fetch_add(1);
+                if (i >= nb_frames) break;
+                auto frame_out = frames_out.subspan(i*m_frame_out_size, m_frame_out_size);
+                std::fill_n(frame_out.begin(), m_params.nb_null_period, std::complex<float>(0.0f, 0.0f));
+                std::copy(m_prs_time_ref.begin(), m_prs_time_ref.end(), frame_out.begin()+m_params.nb_null_period);
+                EncodeFramePhases(
+                    data_in.subspan(i*m_data_in_size, m_data_in_size),
+                    tcb::span(m_frame_phases).subspan(i*nb_frame_phases, nb_frame_phases));
+            }
+        });
+    }
+
+    // 2. Data symbols of all frames are independent so they are split into jobs
+    {
+        const size_t jobs_per_frame = (nb_data_symbols + SYMBOLS_PER_JOB - 1) / SYMBOLS_PER_JOB;
+        const size_t total_jobs = nb_frames*jobs_per_frame;
+        std::atomic<size_t> next_job{0};
+        run_on_workers(std::min(m_total_workers, total_jobs), [&]() {
+            // NOTE: Only the data carriers are written so the other bins stay zero
+            auto fft_buf = std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>>(
+                SYMBOLS_PER_JOB*m_params.nb_fft, std::complex<float>(0.0f, 0.0f),
+                AlignedAllocator<std::complex<float>>(FFT_ALIGN_AMOUNT));
+            while (true) {
+                const size_t job = next_job.fetch_add(1);
+                if (job >= total_jobs) break;
+                const size_t frame_index = job / jobs_per_frame;
+                const size_t symbol_start = (job % jobs_per_frame)*SYMBOLS_PER_JOB;
+                const size_t nb_symbols = std::min(SYMBOLS_PER_JOB, nb_data_symbols-symbol_start);
+                // account for the PRS (phase reference symbol)
+                const size_t sample_start =
+                    frame_index*m_frame_out_size + m_params.nb_null_period +
+                    (1+symbol_start)*m_params.nb_symbol_period;
+                CreateDataSymbols(
+                    tcb::span<const uint8_t>(m_frame_phases).subspan(frame_index*nb_frame_phases + symbol_start*K, nb_symbols*K),
+                    nb_symbols,
+                    frames_out.subspan(sample_start, nb_symbols*m_params.nb_symbol_period),
+                    fft_buf);
+            }
+        });
+    }
+
+    return true;
+}
+
+void OFDM_Batch_Modulator::EncodeFramePhases(tcb::span<const uint8_t> frame_data_in, tcb::span<uint8_t> frame_phases) {
+    // arg(z0*z1) = arg(z0) + arg(z1) so the differential encoding is a sum of phase indices
+    // NOTE: Each byte holds the 2bit symbols of 4 consecutive carriers
+    const size_t K = m_params.nb_data_carriers;
+    const size_t nb_sym_data_in = K/4;
+    const size_t nb_data_symbols = m_params.nb_frame_symbols-1;
+    const uint8_t* last_phase = m_prs_phase.data();
+    for (size_t i = 0; i < nb_data_symbols; i++) {
+        const uint8_t* sym_data_in = &frame_data_in[i*nb_sym_data_in];
+        uint8_t* curr_phase = &frame_phases[i*K];
+        for (size_t j = 0; j < nb_sym_data_in; j++) {
+            const uint8_t b = sym_data_in[j];
+            curr_phase[4*j+0] = uint8_t((last_phase[4*j+0] + PHASE_STEP[(b >> 0) & 0b11]) & 0b111);
+            curr_phase[4*j+1] = uint8_t((last_phase[4*j+1] + PHASE_STEP[(b >> 2) & 0b11]) & 0b111);
+            curr_phase[4*j+2] = uint8_t((last_phase[4*j+2] + PHASE_STEP[(b >> 4) & 0b11]) & 0b111);
+            curr_phase[4*j+3] = uint8_t((last_phase[4*j+3] + PHASE_STEP[(b >> 6) & 0b11]) & 0b111);
+        }
+        last_phase = curr_phase;
+    }
+}
+
+void OFDM_Batch_Modulator::CreateDataSymbols(
+    tcb::span<const uint8_t> symbol_phases, const size_t nb_symbols,
+    tcb::span<std::complex<float>> symbols_out,
+    tcb::span<std::complex<float>> fft_buf)
+{
+    const size_t K = m_params.nb_data_carriers;
+    const size_t M = K/2;
+    const size_t N = m_params.nb_fft;
+    const size_t nb_sym_out = m_params.nb_symbol_period;
+
+    // create fft for -F/2 <= f < 0 and 0 < f <= F/2
+    for (size_t i = 0; i < nb_symbols; i++) {
+        const uint8_t* phases = &symbol_phases[i*K];
+        auto bins = fft_buf.subspan(i*N, N);
+        for (size_t j = 0; j < M; j++) {
+            bins[N-M+j] = PHASE_TABLE[phases[j]];
+        }
+        for (size_t j = 0; j < M; j++) {
+            bins[1+j] = PHASE_TABLE[phases[M+j]];
+        }
+    }
+
+    // get ifft of symbols
+    m_ifft_plan->ExecuteMany(fft_buf, N, symbols_out.subspan(m_params.nb_cyclic_prefix), nb_sym_out, nb_symbols);
+
+    // create cyclic prefix
+    for (size_t i = 0; i < nb_symbols; i++) {
+        auto sym_out = symbols_out.subspan(i*nb_sym_out, nb_sym_out);
+        std::copy_n(sym_out.begin()+N, m_params.nb_cyclic_prefix, sym_out.begin());
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <memory>
+#include <vector>
+#include "utility/span.h"
+#include "./ofdm_params.h"
+
+class FFT_Plan;
+
+// Modulates many frames at once for generating test signals faster than realtime
+// 1. The DQPSK phase of each carrier is accumulated as an index into the 8 multiples of π/4
+//    This only uses byte additions so the serial differential encoding of each frame is cheap
+// 2. The data symbols of every frame are then independent and are mapped and transformed in parallel
+// NOTE: The output is the same as OFDM_Modulator within float rounding
+//       The phases of the PRS must be multiples of π/4 which is the case for DAB
+class OFDM_Batch_Modulator
+{
+private:
+    const OFDM_Params m_params;
+    const size_t m_frame_out_size;
+    const size_t m_data_in_size;
+    size_t m_total_workers;
+    std::shared_ptr<FFT_Plan> m_ifft_plan;
+    std::vector<std::complex<float>> m_prs_time_ref;
+    // phase index of the PRS for each data carrier in the order they are read from the data
+    std::vector<uint8_t> m_prs_phase;
+    // phase index of each data carrier for every data symbol of the frames being modulated
+    std::vector<uint8_t> m_frame_phases;
+public:
+    // nb_workers=0 uses one worker per core
+    OFDM_Batch_Modulator(
+        const OFDM_Params& params,
+        tcb::span<const std::complex<float>> prs_fft_ref,
+        const size_t nb_workers=0);
+    ~OFDM_Batch_Modulator();
+    OFDM_Batch_Modulator(OFDM_Batch_Modulator&) = delete;
+    OFDM_Batch_Modulator(OFDM_Batch_Modulator&&) = delete;
+    OFDM_Batch_Modulator& operator=(OFDM_Batch_Modulator&) = delete;
+    OFDM_Batch_Modulator& operator=(OFDM_Batch_Modulator&&) = delete;
+    // frames_out has N*GetFrameSize() samples and data_in has N*GetFrameDataSize() bytes for N frames
+    // Returns false if the buffer sizes don't match
+    // NOTE: This blocks until all N frames are modulated
+    bool ProcessFrames(
+        tcb::span<std::complex<float>> frames_out,
+        tcb::span<const uint8_t> data_in);
+    size_t GetFrameSize() const { return m_frame_out_size; }
+    size_t GetFrameDataSize() const { return m_data_in_size; }
+    size_t GetTotalWorkers() const { return m_total_workers; }
+    OFDM_Params GetOFDMParams() const { return m_params; }
+private:
+    void EncodeFramePhases(tcb::span<const uint8_t> frame_data_in, tcb::span<uint8_t> frame_phases);
+    void CreateDataSymbols(
+        tcb::span<const uint8_t> symbol_phases, const size_t nb_symbols,
+        tcb::span<std::complex<float>> symbols_out,
+        tcb::span<std::complex<float>> fft_buf);
+};
@@ -1,25 +1,43 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include "./ofdm_demodulator.h"
+#include <assert.h>
 #include <stddef.h>
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <complex>
+#include <cstring>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <optional>
 #include <thread>
-#include <fftw3.h>
+#include <type_traits>
+#include <vector>
 #include "detect_architecture.h"
 #include "simd_flags.h" // NOLINT
 #include "utility/joint_allocate.h"
+#include "utility/latency_trace.h"
+#include "utility/memory_policy.h"
+#include "utility/metrics.h"
 #include "utility/span.h"
+#include "utility/thread_affinity_platform.h"
 #include "viterbi_config.h"
 #include "./dsp/apply_pll.h"
+#include "./dsp/apply_pll_cyclic_prefix.h"
+#include "./dsp/apply_pll_q15.h"
+#include "./dsp/complex_conj_mul.h"
 #include "./dsp/complex_conj_mul_sum.h"
+#include "./dsp/convert_raw_iq.h"
+#include "./dsp/dqpsk_demapper.h"
+#include "./dsp/fft_q15.h"
+#include "./dsp/impulse_peak.h"
+#include "./dsp/l1_norm_decimate.h"
+#include "./dsp/quantise_q15.h"
+#include "./fft_plan_cache.h"
 #include "./ofdm_demodulator_threads.h"
 #include "./ofdm_params.h"
-
-#define PROFILE_ENABLE 1
 #include "./profiler.h"
 
 // NOTE: Determine correct alignment for FFTW3 buffers
@@ -48,28 +66,9 @@ constexpr float TWO_PI = float(M_PI) * 2.0f; // NOLINT
 // DOC: docs/DAB_implementation_in_SDR_detailed.pdf
 // NOTE: Unless specified otherwise all clauses referenced belong to the above documentation
 
-// Receive the real/imaginary component of our data carrier
-// Determine the bit value associated with it
-// Return the bit value as a soft decision bit 
-// - Hard decision bit: 0 or 1
-// - Soft decision bit: Between -A and A
-// We do this since our Viterbi decoder works with soft decision bits
-static inline 
-viterbi_bit_t convert_to_viterbi_bit(const float x) {
-    // Clause 3.4.2 - QPSK symbol mapper
-    // phi = (1-2*b0) + (1-2*b1)*1j
-    // x0 = 1-2*b0, x1 = 1-2*b1
-    // b = (1-x)/2
-
-    // NOTE: Phil Karn's viterbi decoder is configured so that b => b' : (0,1) => (-A,+A)
-    // Where b is the logical bit value, and b' is the value used for soft decision decoding
-    // b' = (2*b-1) * A 
-    // b' = (1-x-1)*A
-    // b' = -A*x
-    constexpr float scale = (float)(SOFT_DECISION_VITERBI_HIGH);
-    const float v = -x*scale;
-    return (viterbi_bit_t)(v);
-}
+// Fixed point level of the average L1 norm of the samples
+// NOTE: This leaves a headroom of about 20dB for the peaks of the OFDM symbols
+constexpr static float Q15_SIGNAL_LEVEL = 4096.0f;
 
 template <typename ... T>
 static void ApplyPLL(T... args) {
@@ -77,26 +76,120 @@ static void ApplyPLL(T... args) {
     apply_pll_auto(std::forward<T>(args)...);
 }
 
+// Tables derived from the PRS and carrier mapper which never change after construction
+struct OFDM_Demod_References {
+    // copies of the inputs so demodulators given the same ones can share these
+    std::vector<std::complex<float>> prs_fft_ref;
+    std::vector<int> carrier_mapper;
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> prs_fft_reference;
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> prs_time_reference;
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> prs_phase_reference;
+    std::vector<int> carrier_fft_index;
+    OFDM_Demod_References(const size_t nb_fft, const size_t nb_data_carriers)
+    :   prs_fft_reference(nb_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+        prs_time_reference(nb_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+        prs_phase_reference(nb_fft, AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+        carrier_fft_index(nb_data_carriers)
+    {}
+};
+
+// References are kept until all the demodulators using them are destroyed
+// NOTE: There are only ever a few distinct references (one per transmission mode) so a list is searched
+template <typename F>
+static std::shared_ptr<const OFDM_Demod_References> get_shared_references(
+    tcb::span<const std::complex<float>> prs_fft_ref, tcb::span<const int> carrier_mapper, F&& create)
+{
+    static std::mutex mutex;
+    static std::vector<std::weak_ptr<const OFDM_Demod_References>> cache;
+
+    auto lock = std::scoped_lock(mutex);
+    cache.erase(
+        std::remove_if(cache.begin(), cache.end(), [](const auto& entry) { return entry.expired(); }),
+        cache.end()
+    );
+    for (const auto& entry: cache) {
+        auto references = entry.lock();
+        if (references == nullptr) continue;
+        const bool is_match =
+            std::equal(prs_fft_ref.begin(), prs_fft_ref.end(), references->prs_fft_ref.begin(), references->prs_fft_ref.end()) &&
+            std::equal(carrier_mapper.begin(), carrier_mapper.end(), references->carrier_mapper.begin(), references->carrier_mapper.end());
+        if (is_match) return references;
+    }
+
+    auto references = create();
+    cache.push_back(references);
+    return references;
+}
+
 OFDM_Demod::OFDM_Demod(
     const OFDM_Params& params,
     const tcb::span<const std::complex<float>> prs_fft_ref, 
     const tcb::span<const int> carrier_mapper,
-    int nb_desired_threads)
+    int nb_desired_threads,
+    OFDM_Demod_Sync_Mode sync_mode,
+    const OFDM_Demod_Thread_Config& thread_config,
+    std::shared_ptr<OFDM_Demod_Executor> executor,
+    OFDM_Demod_Precision precision)
 :   m_params(params), 
+    m_precision(precision),
+    m_is_acquisition_seed_changed(false),
+    m_is_zero_copy_block(false),
+    m_inactive_symbol_views(params.nb_frame_symbols+1, nullptr),
+    m_active_symbol_views(params.nb_frame_symbols+1, nullptr),
+    m_thread_config(thread_config),
+    m_total_thread_config_errors(0),
+    m_total_thread_cpu_time_ns(0),
+    m_total_active_pipelines(0),
+    m_pipeline_utilisation(0.0f),
+    m_total_frames_since_pipeline_change(0),
+    m_executor(std::move(executor)),
+    m_is_inline(false),
+    m_job_total_remaining(0),
+    m_desired_symbol_mask(params.nb_frame_symbols-1, 1),
+    m_is_symbol_mask_changed(false),
+    m_active_symbol_mask(params.nb_frame_symbols-1, 1),
+    m_active_fft_mask(params.nb_frame_symbols+1, 1),
+    m_active_total_fft_symbols(params.nb_frame_symbols),
+    m_total_segments_published(0),
+    m_is_frame_ring_blocking(false),
+    m_is_tap_active(false),
     m_active_buffer(params, m_active_buffer_data, ALIGN_AMOUNT),
     m_inactive_buffer(params, m_inactive_buffer_data, ALIGN_AMOUNT),
+    m_active_raw_buffer(params, m_active_raw_buffer_data, ALIGN_AMOUNT),
+    m_inactive_raw_buffer(params, m_inactive_raw_buffer_data, ALIGN_AMOUNT),
     m_null_power_dip_buffer(m_null_power_dip_buffer_data),
-    m_correlation_time_buffer(m_correlation_time_buffer_data)
+    m_raw_null_power_dip_buffer(m_raw_null_power_dip_buffer_data),
+    m_correlation_time_buffer(m_correlation_time_buffer_data),
+    m_is_headless(false),
+    m_active_is_headless(false),
+    m_active_is_fused_symbols(false),
+    m_active_is_signal_quality(false),
+    m_carrier_error_data(AlignedAllocator<float>(ALIGN_AMOUNT)),
+    m_frame_fft_data(AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_headless_fft_data(AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT)),
+    m_frame_q15_fft_data(AlignedAllocator<Complex_Q15>(ALIGN_AMOUNT)),
+    m_headless_q15_fft_data(AlignedAllocator<Complex_Q15>(ALIGN_AMOUNT)),
+    m_fused_fft_input_data(AlignedAllocator<std::complex<float>>(ALIGN_AMOUNT))
 {
+    auto time_phase_start = std::chrono::steady_clock::now();
+    const auto get_phase_seconds = [&time_phase_start]() {
+        const auto time_now = std::chrono::steady_clock::now();
+        const float elapsed_seconds = std::chrono::duration<float>(time_now - time_phase_start).count();
+        time_phase_start = time_now;
+        return elapsed_seconds;
+    };
+
+    const bool is_q15 = (m_precision == OFDM_Demod_Precision::INT16);
     // NOTE: Allocating joint block for better memory locality as well as alignment requirements
     //       Alignment is required for FFTW3 to use SIMD instructions which increases performance
+    Memory_Policy memory_policy = m_thread_config.memory;
+    if (memory_policy.numa_node < 0) memory_policy.numa_node = m_thread_config.pipeline.numa_node;
     m_joint_data_block = AllocateJoint(
-        m_carrier_mapper,                 BufferParameters{ m_params.nb_data_carriers }, 
+        memory_policy,
         // Fine time correlation and coarse frequency correction
         m_null_power_dip_buffer_data,     BufferParameters{ m_params.nb_null_period },
+        m_raw_null_power_dip_buffer_data, BufferParameters{ m_params.nb_null_period },
         m_correlation_time_buffer_data,   BufferParameters{ m_params.nb_null_period + m_params.nb_symbol_period },
-        m_correlation_prs_fft_reference,  BufferParameters{ m_params.nb_fft, ALIGN_AMOUNT },
-        m_correlation_prs_time_reference, BufferParameters{ m_params.nb_fft, ALIGN_AMOUNT },
         m_correlation_impulse_response,   BufferParameters{ m_params.nb_fft, ALIGN_AMOUNT },
         m_correlation_frequency_response, BufferParameters{ m_params.nb_fft, ALIGN_AMOUNT },
         m_correlation_fft_buffer,         BufferParameters{ m_params.nb_fft, ALIGN_AMOUNT }, 
@@ -104,54 +197,149 @@ OFDM_Demod::OFDM_Demod(
         // Double buffer ingest so our reader thread isn't blocked and drops samples from rtl_sdr.exe
         m_active_buffer_data,             BufferParameters{ m_active_buffer.GetTotalBufferBytes(), m_active_buffer.GetAlignment() },
         m_inactive_buffer_data,           BufferParameters{ m_inactive_buffer.GetTotalBufferBytes(), m_inactive_buffer.GetAlignment() },
-        // Data structures to read all 76 symbols + NULL symbol and perform demodulation 
-        m_pipeline_fft_buffer,            BufferParameters{ (m_params.nb_frame_symbols+1)*m_params.nb_fft, ALIGN_AMOUNT },
-        m_pipeline_dqpsk_vec_buffer,      BufferParameters{ (m_params.nb_frame_symbols-1)*m_params.nb_fft, ALIGN_AMOUNT },
-        m_pipeline_out_bits,              BufferParameters{ (m_params.nb_frame_symbols-1)*m_params.nb_data_carriers*2 }
+        // 8bit samples are kept in their own double buffer until the pipeline threads convert them
+        m_active_raw_buffer_data,         BufferParameters{ m_active_raw_buffer.GetTotalBufferBytes(), m_active_raw_buffer.GetAlignment() },
+        m_inactive_raw_buffer_data,       BufferParameters{ m_inactive_raw_buffer.GetTotalBufferBytes(), m_inactive_raw_buffer.GetAlignment() },
+        // Data structures to demodulate all 76 symbols + NULL symbol 
+        // NOTE: The FFTs are allocated separately since headless demodulators only need a few of them
+        m_pipeline_out_bits,              BufferParameters{ (m_params.nb_frame_symbols-1)*m_params.nb_data_carriers*2 },
+        // Fixed point copies of the symbols which are only used with OFDM_Demod_Precision::INT16
+        m_pipeline_q15_symbols,           BufferParameters{ is_q15 ? (m_params.nb_frame_symbols+1)*m_params.nb_symbol_period : 0, ALIGN_AMOUNT }
     );
 
-    m_fft_plan = fftwf_plan_dft_1d((int)m_params.nb_fft, nullptr, nullptr, FFTW_FORWARD, FFTW_ESTIMATE);
-    m_ifft_plan = fftwf_plan_dft_1d((int)m_params.nb_fft, nullptr, nullptr, FFTW_BACKWARD, FFTW_ESTIMATE);
+    // Frames after the double buffer are queued in their own block since their number is only known at runtime
+    const size_t total_queued_frames = std::max(m_thread_config.total_ingest_frames, size_t(2)) - 2;
+    const auto get_aligned = [](const size_t x) { return ((x+ALIGN_AMOUNT-1) / ALIGN_AMOUNT) * ALIGN_AMOUNT; };
+    const size_t nb_buffer_bytes = m_active_buffer.GetTotalBufferBytes();
+    const size_t nb_raw_buffer_bytes = m_active_raw_buffer.GetTotalBufferBytes();
+    const size_t nb_frame_stride = get_aligned(nb_buffer_bytes) + get_aligned(nb_raw_buffer_bytes);
+    m_ingest_data_block = std::vector<uint8_t, PageAllocator<uint8_t>>(
+        total_queued_frames*nb_frame_stride, PageAllocator<uint8_t>(ALIGN_AMOUNT, memory_policy));
+    m_ingest_frames.resize(total_queued_frames);
+    for (size_t i = 0; i < total_queued_frames; i++) {
+        auto& frame = m_ingest_frames[i];
+        const auto frame_data = tcb::span<uint8_t>(m_ingest_data_block).subspan(i*nb_frame_stride, nb_frame_stride);
+        frame.buffer_data = frame_data.first(nb_buffer_bytes);
+        frame.raw_buffer_data = frame_data.subspan(get_aligned(nb_buffer_bytes), nb_raw_buffer_bytes);
+        frame.symbol_views.resize(m_params.nb_frame_symbols+1, nullptr);
+    }
+    m_ingest_head = 0;
+    m_ingest_total_queued = 0;
+    m_startup_times.allocate_seconds = get_phase_seconds();
+
+    m_fft_plan = fft_get_plan(m_params.nb_fft, FFT_Direction::FORWARD);
+    m_ifft_plan = fft_get_plan(m_params.nb_fft, FFT_Direction::BACKWARD);
+    if (is_q15) {
+        m_fft_q15_plan = std::make_unique<FFT_Q15_Plan>(m_params.nb_fft);
+    }
+    m_startup_times.fft_plans_seconds = get_phase_seconds();
+    m_active_q15_scale = 1.0f;
+    m_active_sample_rate_offset = 0.0f;
+    m_reader_capture_time = 0;
+    m_active_capture_time = 0;
 
     // Initial state of demodulator
     m_state = State::FINDING_NULL_POWER_DIP;
     m_total_frames_desync = 0;
+    m_total_frames_tracked = 0;
+    m_total_frames_overrun = 0;
     m_total_frames_read = 0;
     m_is_found_coarse_freq_offset = false;
     m_freq_coarse_offset = 0;
+    ResetCoarseFreqLock();
     m_freq_fine_offset = 0;
     m_fine_time_offset = 0;
+    m_is_frame_tracking = false;
+    m_total_tracking_misses = 0;
+    m_sample_rate_offset = 0.0f;
+    m_sample_rate_residual = 0.0f;
+    m_is_sample_rate_residual = false;
+    m_reset_total_frames_read = 0;
     m_is_null_start_found = false;
     m_is_null_end_found = false;
     m_signal_l1_average = 0;
+    ResetNullL1Window();
+    m_idle_last_frames_read = 0;
+    m_idle_unsynced_samples = 0;
+    m_idle_probe_offset = 0;
+    m_idle_reference_l1 = 0.0f;
+    m_idle_probe_l1_sum = 0.0f;
+    m_idle_probe_l1_min = 0.0f;
+    m_idle_probe_windows = 0;
+    m_total_idle_probes = 0;
+    m_total_idle_wakeups = 0;
+    m_input_format = Input_Format::C32;
+    m_active_format = Input_Format::C32;
+    m_inactive_raw_start = 0;
+    m_active_raw_start = 0;
+
+    m_references = get_shared_references(prs_fft_ref, carrier_mapper, [&]() {
+        return CreateReferences(prs_fft_ref, carrier_mapper);
+    });
+    m_correlation_prs_fft_reference = m_references->prs_fft_reference;
+    m_correlation_prs_time_reference = m_references->prs_time_reference;
+    m_correlation_prs_phase_reference = m_references->prs_phase_reference;
+    m_carrier_mapper = m_references->carrier_fft_index;
+    m_startup_times.references_seconds = get_phase_seconds();
+
+    CreateThreads(nb_desired_threads, sync_mode);
+    m_startup_times.threads_seconds = get_phase_seconds();
+}
+
+std::shared_ptr<const OFDM_Demod_References> OFDM_Demod::CreateReferences(
+    tcb::span<const std::complex<float>> prs_fft_ref, tcb::span<const int> carrier_mapper)
+{
+    auto references = std::make_shared<OFDM_Demod_References>(m_params.nb_fft, m_params.nb_data_carriers);
+    references->prs_fft_ref.assign(prs_fft_ref.begin(), prs_fft_ref.end());
+    references->carrier_mapper.assign(carrier_mapper.begin(), carrier_mapper.end());
 
     // Clause 3.12.1 - Fine time synchronisation
     // Correlation in time domain is the conjugate product in frequency domain
     for (size_t i = 0; i < m_params.nb_fft; i++) {
-        m_correlation_prs_fft_reference[i] = std::conj(prs_fft_ref[i]);
+        references->prs_fft_reference[i] = std::conj(prs_fft_ref[i]);
     }
 
     // Clause 3.13.2 - Coarse frequency synchronisation
     // Correlation in frequency domain is the conjugate product in time domain
-    CalculateRelativePhase(prs_fft_ref, m_correlation_prs_time_reference);
-    CalculateIFFT(m_correlation_prs_time_reference, m_correlation_prs_time_reference);
+    // NOTE: Our plans are out of place so the IFFT is written to a scratch buffer
+    CalculateRelativePhase(prs_fft_ref, m_correlation_fft_buffer);
+    CalculateIFFT(m_correlation_fft_buffer, m_correlation_ifft_buffer);
     for (size_t i = 0; i < m_params.nb_fft; i++) {
-        m_correlation_prs_time_reference[i] = std::conj(m_correlation_prs_time_reference[i]);
+        references->prs_time_reference[i] = std::conj(m_correlation_ifft_buffer[i]);
+        references->prs_phase_reference[i] = m_correlation_fft_buffer[i];
     }
 
+    // Clause 3.14.3 - Zero padding removal
     // Clause 3.16.1 - Frequency deinterleaving
-    std::copy_n(carrier_mapper.begin(), m_params.nb_data_carriers, m_carrier_mapper.begin());
+    // We store the FFT bin of each deinterleaved carrier so the demapper reads directly from the FFT
+    // Subcarriers [0,M-1] are the negative frequencies [-M,-1] and [M,2M-1] are the positive frequencies [1,M]
+    const int M = (int)m_params.nb_data_carriers/2;
+    const int N_fft = (int)m_params.nb_fft;
+    for (size_t i = 0; i < m_params.nb_data_carriers; i++) {
+        const int subcarrier_index = carrier_mapper[i];
+        const int frequency_index = (subcarrier_index < M) ? (subcarrier_index-M) : (subcarrier_index-M+1);
+        references->carrier_fft_index[i] = (N_fft+frequency_index) % N_fft;
+    }
 
-    CreateThreads(nb_desired_threads);
+    return references;
 }
 
-void OFDM_Demod::CreateThreads(int nb_desired_threads) {
+void OFDM_Demod::CreateThreads(int nb_desired_threads, OFDM_Demod_Sync_Mode sync_mode) {
     const int nb_syms = (int)m_params.nb_frame_symbols+1;
     const int total_system_threads = (int)std::thread::hardware_concurrency();
 
+    // Jobs of an executor are run on other threads so they need events which can wait
+    if (sync_mode == OFDM_Demod_Sync_Mode::INLINE) {
+        m_is_inline = (m_executor == nullptr);
+        if (!m_is_inline) sync_mode = OFDM_Demod_Sync_Mode::BLOCKING;
+    }
+
     int nb_threads = 0; 
+    // Splitting the frame between pipelines on one thread would only add overhead
+    if (m_is_inline) {
+        nb_threads = 1;
     // Manually set number of threads
-    if (nb_desired_threads > 0) {
+    } else if (nb_desired_threads > 0) {
         nb_threads = std::min(nb_syms, nb_desired_threads);
     // Automatically determine
     } else {
@@ -165,53 +353,125 @@ void OFDM_Demod::CreateThreads(int nb_desired_threads) {
     }
 
     // Setup our multithreaded processing pipeline
-    m_coordinator = std::make_unique<OFDM_Demod_Coordinator>();
-    {
-        int symbol_start = 0;    
-        for (int i = 0; i < nb_threads; i++) {
-            const bool is_last_thread = (i == (nb_threads-1));
+    m_coordinator = std::make_unique<OFDM_Demod_Coordinator>(sync_mode);
+    for (int i = 0; i < nb_threads; i++) {
+        m_pipelines.emplace_back(std::make_unique<OFDM_Demod_Pipeline>(0, 0, sync_mode));
+    }
+    SchedulePipelines(nb_threads);
+    // Plan the batched FFT of the independent symbols now instead of on the first frame
+    // NOTE: When fewer pipelines are used in adaptive mode their plans are made on the first frame they are used
+    for (auto& pipeline: m_pipelines) {
+        const int nb_pipeline_syms = int(pipeline->GetSymbolEnd()-pipeline->GetSymbolStart());
+        m_fft_plan->PrepareMany(
+            m_active_buffer.GetDataSymbolStride(), m_params.nb_fft, 
+            size_t(std::max(nb_pipeline_syms-1, 0)));
+    }
 
-            const int nb_syms_remain = (nb_syms-symbol_start);
-            const int nb_threads_remain = (nb_threads-i);
-            const int nb_syms_in_thread = (int)std::ceil((float)nb_syms_remain / (float)nb_threads_remain);
-            const int symbol_end = is_last_thread ? nb_syms : (symbol_start+nb_syms_in_thread);
-            m_pipelines.emplace_back(std::make_unique<OFDM_Demod_Pipeline>(
-                symbol_start, symbol_end
-            ));
-            symbol_start = symbol_end;
-        }
+    // The executor runs the pipelines as jobs which are submitted by the reader thread
+    if ((m_executor != nullptr) || m_is_inline) {
+        m_job_total_waiting_fft = std::make_unique<std::atomic<int>[]>(m_pipelines.size());
+        return;
     }
 
     // Create coordinator thread
     m_coordinator_thread = std::make_unique<std::thread>(
         [this]() {
             PROFILE_TAG_THREAD("OFDM_Demod::CoordinatorThread");
-            while (CoordinatorThread());
+            if (!apply_thread_affinity(m_thread_config.coordinator)) {
+                m_total_thread_config_errors++;
+            }
+            uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+            while (CoordinatorThread()) {
+                UpdateThreadCPUTime(cpu_time_ns);
+            }
         }
     );
 
     // Create pipeline threads
     for (size_t i = 0; i < m_pipelines.size(); i++) {
         auto& pipeline = *(m_pipelines[i].get());
-
-        // Some pipelines depend on data being processed in other pipelines
-        const size_t dependent_pipeline_index = i+1;
-        OFDM_Demod_Pipeline* dependent_pipeline = nullptr;
-        if (dependent_pipeline_index < m_pipelines.size()) {
-            dependent_pipeline = m_pipelines[dependent_pipeline_index].get();
-        }
-
         m_pipeline_threads.emplace_back(std::make_unique<std::thread>(
-            [this, &pipeline, dependent_pipeline]() {
+            [this, &pipeline, i]() {
                 PROFILE_TAG_THREAD("OFDM_Demod::PipelineThread");
-                PROFILE_TAG_DATA_THREAD(std::optional(InstrumentorThread::Descriptor{pipeline.GetSymbolStart(), pipeline.GetSymbolEnd()}));
-                while (PipelineThread(pipeline, dependent_pipeline));
+                if (!apply_thread_affinity(m_thread_config.pipeline, i)) {
+                    m_total_thread_config_errors++;
+                }
+                PROFILE_TAG_DATA_THREAD(std::optional(ProfilerThread::Descriptor{pipeline.GetSymbolStart(), pipeline.GetSymbolEnd()}));
+                uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+                while (PipelineThread(i)) {
+                    UpdateThreadCPUTime(cpu_time_ns);
+                }
             }
         ));
     }
 }
 
+// Split the symbols evenly between the first nb_active pipelines
+// Some pipelines depend on data being processed in the next pipeline
+// NOTE: This is only called when the pipelines are idle
+void OFDM_Demod::SchedulePipelines(const int nb_active) {
+    const int nb_syms = (int)m_params.nb_frame_symbols+1;
+    int symbol_start = 0;
+    for (int i = 0; i < nb_active; i++) {
+        const bool is_last_thread = (i == (nb_active-1));
+        const int nb_syms_remain = (nb_syms-symbol_start);
+        const int nb_threads_remain = (nb_active-i);
+        const int nb_syms_in_thread = (int)std::ceil((float)nb_syms_remain / (float)nb_threads_remain);
+        const int symbol_end = is_last_thread ? nb_syms : (symbol_start+nb_syms_in_thread);
+        auto* dependent = is_last_thread ? nullptr : m_pipelines[size_t(i+1)].get();
+        m_pipelines[size_t(i)]->SetSchedule(size_t(symbol_start), size_t(symbol_end), dependent);
+        symbol_start = symbol_end;
+    }
+    m_total_active_pipelines.store(nb_active, std::memory_order_relaxed);
+}
+
+// Grow or shrink the number of active pipelines so a frame takes the target fraction of its duration
+void OFDM_Demod::UpdateActivePipelines(const float frame_seconds) {
+    constexpr float DAB_SAMPLING_RATE = 2.048e6f;
+    const size_t nb_frame_samples = m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period;
+    const float frame_duration = float(nb_frame_samples) / DAB_SAMPLING_RATE;
+    const float utilisation = frame_seconds / frame_duration;
+    const float beta = m_cfg.pipeline.utilisation_beta;
+    float average = m_pipeline_utilisation.load(std::memory_order_relaxed);
+    // NOTE: The average restarts after a change since the old measurements are for a different split
+    average = (m_total_frames_since_pipeline_change == 0) ? utilisation : (beta*average + (1.0f-beta)*utilisation);
+    m_pipeline_utilisation.store(average, std::memory_order_relaxed);
+    m_total_frames_since_pipeline_change++;
+
+    const int nb_max = int(m_pipelines.size());
+    const int nb_active = m_total_active_pipelines.load(std::memory_order_relaxed);
+    int nb_desired = nb_active;
+    if (!m_cfg.pipeline.is_adaptive) {
+        nb_desired = nb_max;
+    } else if (m_total_frames_since_pipeline_change >= m_cfg.pipeline.min_frames_between_changes) {
+        // The symbols are split evenly so the time taken is about inversely proportional to the number of pipelines
+        const float target = m_cfg.pipeline.target_utilisation;
+        if ((average > target) && (nb_active < nb_max)) {
+            nb_desired = nb_active+1;
+        } else if ((nb_active > 1) && (average*float(nb_active)/float(nb_active-1) < target)) {
+            nb_desired = nb_active-1;
+        }
+    }
+
+    if (nb_desired == nb_active) return;
+    SchedulePipelines(nb_desired);
+    m_total_frames_since_pipeline_change = 0;
+}
+
+void OFDM_Demod::UpdateThreadCPUTime(uint64_t& last_cpu_time_ns) {
+    const uint64_t cpu_time_ns = get_thread_cpu_time_ns();
+    m_total_thread_cpu_time_ns.fetch_add(cpu_time_ns-last_cpu_time_ns, std::memory_order_relaxed);
+    last_cpu_time_ns = cpu_time_ns;
+}
+
 OFDM_Demod::~OFDM_Demod() {
+    // Inline frames are finished before Process() returns
+    if (m_is_inline) return;
+    // The jobs of the last frame use our buffers so they have to finish first
+    if (m_executor != nullptr) {
+        m_coordinator->WaitEnd();
+        return;
+    }
     // Stop coordinator first so pipelines can finish properly
     m_coordinator->Stop();
     m_coordinator_thread->join();
@@ -222,10 +482,6 @@ OFDM_Demod::~OFDM_Demod() {
     for (auto& pipeline_thread: m_pipeline_threads) {
         pipeline_thread->join();
     }
-
-    // fft/ifft buffers
-    fftwf_destroy_plan(m_fft_plan);
-    fftwf_destroy_plan(m_ifft_plan);
 }
 
 // Thread 1: Read frame data at start of frame
@@ -233,12 +489,75 @@ OFDM_Demod::~OFDM_Demod() {
 // Clause 3.12.2: Frame synchronisation
 // Clause 3.13.2 Integral frequency offset estimation
 void OFDM_Demod::Process(tcb::span<const std::complex<float>> buf) {
+    ProcessBlock(buf, Input_Format::C32);
+}
+
+void OFDM_Demod::ProcessZeroCopy(tcb::span<const std::complex<float>> buf) {
+    m_is_zero_copy_block = true;
+    ProcessBlock(buf, Input_Format::C32);
+    m_is_zero_copy_block = false;
+}
+
+size_t OFDM_Demod::GetZeroCopyRetainSamples() const {
+    // A symbol is referenced until the pipelines finish its frame which is after the next frame
+    // and every queued frame is read
+    const size_t nb_frame_samples = m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period;
+    return (2+m_ingest_frames.size())*nb_frame_samples;
+}
+
+void OFDM_Demod::Process(tcb::span<const RawIQ_u8> buf) {
+    ProcessBlock(buf, Input_Format::RAW_U8);
+}
+
+void OFDM_Demod::Process(tcb::span<const RawIQ_s8> buf) {
+    // NOTE: Signed samples share the buffers of unsigned samples and are only reinterpreted when converted
+    const auto* raw_buf = reinterpret_cast<const RawIQ_u8*>(buf.data());
+    ProcessBlock(tcb::span<const RawIQ_u8>{ raw_buf, buf.size() }, Input_Format::RAW_S8);
+}
+
+template <typename T>
+void OFDM_Demod::ProcessBlock(tcb::span<const T> buf, const Input_Format format) {
     PROFILE_TAG_THREAD("OFDM_Demod::ProcessThread");
-    PROFILE_ENABLE_TRACE_LOGGING(true);
-    PROFILE_ENABLE_TRACE_LOGGING_CONTINUOUS(true);
     PROFILE_BEGIN_FUNC();
 
-    UpdateSignalAverage(buf);
+    if (m_reader_thread_id != std::this_thread::get_id()) {
+        m_reader_thread_id = std::this_thread::get_id();
+        if (!apply_thread_affinity(m_thread_config.reader)) {
+            m_total_thread_config_errors++;
+        }
+    }
+
+    // A partially read frame can't be continued with samples of another format
+    if (m_input_format != format) {
+        m_input_format = format;
+        m_state = State::FINDING_NULL_POWER_DIP;
+        m_correlation_time_buffer.SetLength(0);
+        m_null_power_dip_buffer.SetLength(0);
+        m_raw_null_power_dip_buffer.SetLength(0);
+        m_is_null_start_found = false;
+        m_is_null_end_found = false;
+        ResetNullL1Window();
+        m_is_frame_tracking = false;
+        m_total_tracking_misses = 0;
+        m_is_sample_rate_residual = false;
+    }
+
+    // The signal being read is no longer the one we are synchronised to
+    if (m_is_acquisition_seed_changed.exchange(false, std::memory_order_acquire)) {
+        {
+            auto lock = std::scoped_lock(m_mutex_acquisition_seed);
+            m_acquisition_seed = m_desired_acquisition_seed;
+        }
+        Reset();
+        m_idle_unsynced_samples = 0;
+    }
+
+    m_reader_capture_time = get_latency_trace_block_time();
+    StartQueuedFrameIfIdle();
+    // The probes measure their own level so the skipped samples aren't read
+    if (m_state != State::IDLE_PROBING) {
+        UpdateSignalAverage(buf);
+    }
 
     const size_t N = buf.size();
     size_t curr_index = 0;
@@ -250,79 +569,235 @@ void OFDM_Demod::Process(tcb::span<const std::complex<float>> buf) {
 
         // Clause 3.12.2: Frame synchronisation
         case State::FINDING_NULL_POWER_DIP:
-            curr_index += FindNullPowerDip({block, N_remain});
+            curr_index += FindNullPowerDip<T>({block, N_remain});
             break;
         
         case State::READING_NULL_AND_PRS:
-            curr_index += ReadNullPRS({block, N_remain});
+            curr_index += ReadNullPRS<T>({block, N_remain});
             break;
         
         // Clause 3.13.2 Integral frequency offset estimation
         case State::RUNNING_COARSE_FREQ_SYNC:
-            curr_index += RunCoarseFreqSync({block, N_remain});
+            curr_index += RunCoarseFreqSync();
             break;
         
         // Clause 3.12.1: Symbol timing synchronisation
         case State::RUNNING_FINE_TIME_SYNC:
-            curr_index += RunFineTimeSync({block, N_remain});
+            curr_index += RunFineTimeSync();
             break;
         
         case State::READING_SYMBOLS:
-            curr_index += ReadSymbols({block, N_remain});
+            curr_index += ReadSymbols<T>({block, N_remain});
+            break;
+
+        case State::IDLE_PROBING:
+            curr_index += ProbeIdleSignal<T>({block, N_remain});
             break;
         }
     }
+    UpdateIdleDetector(N);
+    PublishStatus();
 }
 
 void OFDM_Demod::Reset() {
     PROFILE_BEGIN_FUNC();
     m_state = State::FINDING_NULL_POWER_DIP;
     m_correlation_time_buffer.SetLength(0);
+    m_null_power_dip_buffer.SetLength(0);
+    m_raw_null_power_dip_buffer.SetLength(0);
+    m_is_null_start_found = false;
+    m_is_null_end_found = false;
+    ResetNullL1Window();
     m_total_frames_desync++;
 
     // NOTE: We also reset fine frequency synchronisation since an incorrect value
     // can reduce performance of fine time synchronisation using the impulse response
     m_is_found_coarse_freq_offset = false;
     m_freq_coarse_offset = 0;
+    ResetCoarseFreqLock();
     m_freq_fine_offset = 0;
     m_fine_time_offset = 0;
+    m_is_frame_tracking = false;
+    m_total_tracking_misses = 0;
+    // NOTE: The sample rate offset belongs to the receiver's clock so it is kept for the next acquisition
+    m_is_sample_rate_residual = false;
+    m_reset_total_frames_read = m_total_frames_read.load(std::memory_order_relaxed);
+
+    // NOTE: Seeded offsets are treated as found so the first frame uses the slow coarse update
+    if (m_acquisition_seed.has_value()) {
+        const auto& seed = m_acquisition_seed.value();
+        m_is_found_coarse_freq_offset = true;
+        m_freq_coarse_offset = seed.coarse_freq_offset;
+        m_freq_fine_offset = seed.fine_freq_offset;
+        m_signal_l1_average = seed.signal_l1_average;
+    }
 }
 
-size_t OFDM_Demod::FindNullPowerDip(tcb::span<const std::complex<float>> buf) {
+void OFDM_Demod::Flush() {
     PROFILE_BEGIN_FUNC();
+    m_coordinator->WaitEnd();
+    while (m_ingest_total_queued > 0) {
+        StartQueuedFrame();
+        m_coordinator->WaitEnd();
+    }
+    // the end event is auto reset so we signal it again for the next frame
+    m_coordinator->SignalEnd();
+    PublishStatus();
+}
+
+void OFDM_Demod::SetFrequencyOffset(const float coarse_offset, const float fine_offset) {
+    m_freq_coarse_offset = coarse_offset;
+    m_is_found_coarse_freq_offset = true;
+    ResetCoarseFreqLock();
+    auto lock = std::scoped_lock(m_mutex_freq_fine_offset);
+    m_freq_fine_offset = fine_offset;
+}
+
+void OFDM_Demod::SetAcquisitionSeed(const std::optional<OFDM_Demod_Acquisition>& seed) {
+    auto lock = std::scoped_lock(m_mutex_acquisition_seed);
+    m_desired_acquisition_seed = seed;
+    m_is_acquisition_seed_changed.store(true, std::memory_order_release);
+}
+
+std::optional<OFDM_Demod_Acquisition> OFDM_Demod::GetAcquisition() const {
+    if (m_total_frames_read.load(std::memory_order_relaxed) == m_reset_total_frames_read) return std::nullopt;
+    OFDM_Demod_Acquisition acquisition;
+    acquisition.coarse_freq_offset = m_freq_coarse_offset;
+    acquisition.fine_freq_offset = m_freq_fine_offset;
+    acquisition.signal_l1_average = m_signal_l1_average;
+    return acquisition;
+}
+
+void OFDM_Demod::SetDataSymbolMask(tcb::span<const uint8_t> mask) {
+    auto lock = std::scoped_lock(m_mutex_symbol_mask);
+    const size_t N = std::min(mask.size(), m_desired_symbol_mask.size());
+    std::fill(m_desired_symbol_mask.begin(), m_desired_symbol_mask.end(), uint8_t(0));
+    std::copy_n(mask.begin(), N, m_desired_symbol_mask.begin());
+    m_is_symbol_mask_changed.store(true, std::memory_order_release);
+}
+
+void OFDM_Demod::SetTotalDataSymbols(const size_t nb_symbols) {
+    auto lock = std::scoped_lock(m_mutex_symbol_mask);
+    const size_t N = std::min(nb_symbols, m_desired_symbol_mask.size());
+    std::fill(m_desired_symbol_mask.begin(), m_desired_symbol_mask.end(), uint8_t(0));
+    std::fill_n(m_desired_symbol_mask.begin(), N, uint8_t(1));
+    m_is_symbol_mask_changed.store(true, std::memory_order_release);
+}
+
+bool OFDM_Demod::SetOutputSegments(tcb::span<const size_t> segment_symbols) {
+    const size_t nb_data_symbols = m_params.nb_frame_symbols-1;
+    size_t total_symbols = 0;
+    for (const size_t nb_symbols: segment_symbols) {
+        if (nb_symbols == 0) return false;
+        total_symbols += nb_symbols;
+    }
+    if (!segment_symbols.empty() && (total_symbols != nb_data_symbols)) return false;
+
+    m_segment_ends.clear();
+    m_symbol_segments.resize(segment_symbols.empty() ? 0 : nb_data_symbols);
+    m_segment_remaining = std::make_unique<std::atomic<int>[]>(segment_symbols.size());
+    size_t symbol_start = 0;
+    for (size_t i = 0; i < segment_symbols.size(); i++) {
+        const size_t symbol_end = symbol_start + segment_symbols[i];
+        std::fill(m_symbol_segments.begin()+ptrdiff_t(symbol_start), m_symbol_segments.begin()+ptrdiff_t(symbol_end), i);
+        m_segment_ends.push_back(symbol_end);
+        symbol_start = symbol_end;
+    }
+    return true;
+}
+
+void OFDM_Demod::UpdateSymbolMask() {
+    auto lock = std::scoped_lock(m_mutex_symbol_mask);
+    // Bits of symbols that are no longer demodulated would be left over from an older frame
+    const size_t nb_viterbi_bits = m_params.nb_data_carriers*2;
+    for (size_t i = 0; i < m_active_symbol_mask.size(); i++) {
+        if (!m_active_symbol_mask[i] || m_desired_symbol_mask[i]) continue;
+        auto unused_bits = m_pipeline_out_bits.subspan(i*nb_viterbi_bits, nb_viterbi_bits);
+        std::fill(unused_bits.begin(), unused_bits.end(), viterbi_bit_t(0));
+    }
+    m_active_symbol_mask = m_desired_symbol_mask;
+
+    // Data symbol i is the phase difference between the FFTs of symbols i and i+1 where 0 is the PRS
+    // The null symbol isn't used for demodulation so it is only transformed if every symbol is used
+    const bool is_all_symbols = std::all_of(
+        m_active_symbol_mask.begin(), m_active_symbol_mask.end(), 
+        [](const uint8_t x) { return x != 0; }
+    );
+    std::fill(m_active_fft_mask.begin(), m_active_fft_mask.end(), uint8_t(0));
+    for (size_t i = 0; i < m_active_symbol_mask.size(); i++) {
+        if (!m_active_symbol_mask[i]) continue;
+        m_active_fft_mask[i] = 1;
+        m_active_fft_mask[i+1] = 1;
+    }
+    m_active_fft_mask[m_params.nb_frame_symbols] = is_all_symbols ? 1 : 0;
+    m_active_total_fft_symbols = size_t(std::count(m_active_fft_mask.begin(), m_active_fft_mask.end()-1, uint8_t(1)));
+}
+
+template <typename T>
+size_t OFDM_Demod::FindNullPowerDip(tcb::span<const T> buf) {
+    PROFILE_BEGIN_FUNC();
+    METRICS_TIME_SCOPE("dab_ofdm_find_null_power_dip_seconds", "Time spent searching a block for the null symbol");
     // Clause 3.12.2 - Frame synchronisation using power detection
     // we run this if we dont have an initial estimate for the prs index
     // This can occur if:
     //      1. We just started the demodulator and need a quick estimate of OFDM start
     //      2. The PRS impulse response didn't have a sufficiently large peak
 
-    // We analyse the average power of the signal using blocks of size K
-    const int N = (int)buf.size();
-    const int K = (int)m_cfg.signal_l1.nb_samples;
-    const int M = N-K;
-
-    const float null_start_thresh = m_signal_l1_average * m_cfg.null_l1_search.thresh_null_start;
-    const float null_end_thresh = m_signal_l1_average * m_cfg.null_l1_search.thresh_null_end;
-
-    // if the loop doesn't exit then we copy all samples into circular buffer
-    int nb_read = N;
-    for (int i = 0; i < M; i+=K) {
-        auto* block = &buf[i];
-        const float l1_avg = CalculateL1Average({block, (size_t)K});
-        if (m_is_null_start_found) {
-            if (l1_avg > null_end_thresh) {
-                m_is_null_end_found = true;
-                nb_read = i+K;
-                break;
-            }
-        } else {
-            if (l1_avg < null_start_thresh) {
-                m_is_null_start_found = true;
-            }
+    // We analyse the average power of the signal using a moving window of K samples
+    // The window is advanced every D samples using the L1 sums of consecutive blocks
+    // NOTE: The running sum is kept between calls so dips across block boundaries are found
+    const size_t N = buf.size();
+    const size_t D = (size_t)std::max(m_cfg.null_l1_search.nb_decimate, 1);
+    const size_t W = std::max((size_t)m_cfg.signal_l1.nb_samples/D, size_t(1));
+    if (m_null_l1_window.size() != W) {
+        m_null_l1_window.resize(W);
+        ResetNullL1Window();
+    }
+
+    size_t nb_read = 0;
+    float block_sum = 0.0f;
+
+    // Complete the partial block from the previous call
+    if (m_null_l1_block_length > 0) {
+        const size_t nb_block = std::min(D-m_null_l1_block_length, N);
+        CalculateL1Sums(buf.first(nb_block), {&block_sum, 1});
+        m_null_l1_block_sum += block_sum;
+        m_null_l1_block_length += nb_block;
+        nb_read += nb_block;
+        if (m_null_l1_block_length == D) {
+            m_null_l1_block_length = 0;
+            UpdateNullL1Window(m_null_l1_block_sum);
+        }
+    }
+
+    // Calculate the sums of many blocks at once so they are vectorised
+    std::array<float, 128> block_sums;
+    while (!m_is_null_end_found && ((N-nb_read) >= D)) {
+        const size_t M = std::min((N-nb_read)/D, block_sums.size());
+        CalculateL1Sums(buf.subspan(nb_read, M*D), {block_sums.data(), M});
+        for (size_t i = 0; i < M; i++) {
+            nb_read += D;
+            if (UpdateNullL1Window(block_sums[i])) break;
         }
     }
 
-    m_null_power_dip_buffer.ConsumeBuffer({buf.data(), (size_t)nb_read}, true);
+    // Keep the remaining samples as a partial block
+    if (!m_is_null_end_found && (nb_read < N)) {
+        CalculateL1Sums(buf.subspan(nb_read), {&block_sum, 1});
+        m_null_l1_block_sum = block_sum;
+        m_null_l1_block_length = N-nb_read;
+        nb_read = N;
+    }
+
+    auto& null_power_dip_buffer = [this]() -> CircularBuffer<T>& {
+        if constexpr (std::is_same_v<T, RawIQ_u8>) {
+            return m_raw_null_power_dip_buffer;
+        } else {
+            return m_null_power_dip_buffer;
+        }
+    }();
+
+    null_power_dip_buffer.ConsumeBuffer({buf.data(), (size_t)nb_read}, true);
     if (!m_is_null_end_found) {
         return (size_t)nb_read;
     }
@@ -330,25 +805,45 @@ size_t OFDM_Demod::FindNullPowerDip(tcb::span<const std::complex<float>> buf) {
     // Copy null symbol into correlation buffer
     // This is done since our captured null symbol may actually contain parts of the PRS 
     // We do this so we can guarantee the full start of the PRS is attained after fine time sync
-    const size_t L = m_null_power_dip_buffer.Length();
-    const size_t start_index = m_null_power_dip_buffer.GetIndex();
-    for (size_t i = 0; i < L; i++) {
-        const size_t j = i+start_index;
-        m_correlation_time_buffer[i] = m_null_power_dip_buffer[j];
+    const size_t L = null_power_dip_buffer.Length();
+    const size_t start_index = null_power_dip_buffer.GetIndex();
+    if constexpr (std::is_same_v<T, RawIQ_u8>) {
+        // Convert the two contiguous halves of the circular buffer
+        auto src = tcb::span<const RawIQ_u8>(m_raw_null_power_dip_buffer_data);
+        auto dest = m_correlation_time_buffer_data.first(L);
+        const size_t nb_head = std::min(L, src.size()-start_index);
+        ConvertRawIQ(src.subspan(start_index, nb_head), dest.first(nb_head), m_input_format);
+        ConvertRawIQ(src.first(L-nb_head), dest.subspan(nb_head), m_input_format);
+    } else {
+        for (size_t i = 0; i < L; i++) {
+            const size_t j = i+start_index;
+            m_correlation_time_buffer[i] = m_null_power_dip_buffer[j];
+        }
     }
  
     m_is_null_start_found = false;
     m_is_null_end_found = false;
+    ResetNullL1Window();
     m_correlation_time_buffer.SetLength(L);
-    m_null_power_dip_buffer.SetLength(0);
+    null_power_dip_buffer.SetLength(0);
     m_state = State::READING_NULL_AND_PRS;
 
     return (size_t)nb_read;
 }
 
-size_t OFDM_Demod::ReadNullPRS(tcb::span<const std::complex<float>> buf) {
+template <typename T>
+size_t OFDM_Demod::ReadNullPRS(tcb::span<const T> buf) {
     PROFILE_BEGIN_FUNC();
-    const size_t nb_read = m_correlation_time_buffer.ConsumeBuffer(buf);
+    size_t nb_read = 0;
+    if constexpr (std::is_same_v<T, RawIQ_u8>) {
+        // Synchronisation needs the floating point samples so we convert them here
+        const size_t length = m_correlation_time_buffer.Length();
+        nb_read = std::min(buf.size(), m_correlation_time_buffer.Capacity()-length);
+        ConvertRawIQ(buf.first(nb_read), m_correlation_time_buffer_data.subspan(length, nb_read), m_input_format);
+        m_correlation_time_buffer.SetLength(length+nb_read);
+    } else {
+        nb_read = m_correlation_time_buffer.ConsumeBuffer(buf);
+    }
     if (!m_correlation_time_buffer.IsFull()) {
         return nb_read;
     }
@@ -357,8 +852,9 @@ size_t OFDM_Demod::ReadNullPRS(tcb::span<const std::complex<float>> buf) {
     return nb_read;
 }
 
-size_t OFDM_Demod::RunCoarseFreqSync(tcb::span<const std::complex<float>> buf) {
+size_t OFDM_Demod::RunCoarseFreqSync() {
     PROFILE_BEGIN_FUNC();
+    METRICS_TIME_SCOPE("dab_ofdm_coarse_freq_sync_seconds", "Time spent on coarse frequency synchronisation");
     // Clause: 3.13.2 Integral frequency offset estimation
     if (!m_cfg.sync.is_coarse_freq_correction) {
         m_freq_coarse_offset = 0;
@@ -366,6 +862,16 @@ size_t OFDM_Demod::RunCoarseFreqSync(tcb::span<const std::complex<float>> buf) {
         return 0;
     }
 
+    // When locked the offset only drifts slowly so it is checked every few frames
+    if (m_is_coarse_freq_locked) {
+        m_total_coarse_freq_frames_since_check++;
+        if (m_total_coarse_freq_frames_since_check < m_cfg.sync.coarse_freq_locked_check_interval) {
+            m_state = State::RUNNING_FINE_TIME_SYNC;
+            return 0;
+        }
+        m_total_coarse_freq_frames_since_check = 0;
+    }
+
     auto corr_time_buf = tcb::span(m_correlation_time_buffer);
     auto prs_sym = corr_time_buf.subspan(m_params.nb_null_period, m_params.nb_symbol_period);
 
@@ -379,30 +885,48 @@ size_t OFDM_Demod::RunCoarseFreqSync(tcb::span<const std::complex<float>> buf) {
     // Step 2: Get complex difference between consecutive bins
     CalculateRelativePhase(m_correlation_fft_buffer, m_correlation_fft_buffer);
 
-    // Step 3: Get IFFT so we can do correlation in frequency domain via product in time domain
-    CalculateIFFT(m_correlation_fft_buffer, m_correlation_ifft_buffer);
-
-    // Step 4: Conjugate product in time domain
-    //         NOTE: correlation_prs_time_reference is already the conjugate
-    for (size_t i = 0; i < m_params.nb_fft; i++) {
-        m_correlation_ifft_buffer[i] *= m_correlation_prs_time_reference[i];
-    }
-
-    // Step 5: Get FFT to get correlation in frequency domain
-    CalculateFFT(m_correlation_ifft_buffer, m_correlation_fft_buffer);
-
-    // Step 6: Get magnitude spectrum so we can find the correlation peak
-    CalculateMagnitude(m_correlation_fft_buffer, m_correlation_frequency_response);
-
-    // Step 7: Find the peak in our maximum coarse frequency error window
     // NOTE: A zero frequency error corresponds to a peak at nb_fft/2
     int max_carrier_offset = int(m_cfg.sync.max_coarse_freq_correction_norm * float(m_params.nb_fft));
     const int M = int(m_params.nb_fft/2);
     if (max_carrier_offset < 0) max_carrier_offset = 0;
     if (max_carrier_offset > M) max_carrier_offset = M;
-    int max_index = -max_carrier_offset;
+    int search_min = -max_carrier_offset;
+    int search_max = max_carrier_offset;
+
+    if (m_is_coarse_freq_locked) {
+        // Steps 3 to 6: Only correlate the bins next to the last peak and their neighbours for the lerp
+        search_min = std::max(m_coarse_freq_peak_index-1, -max_carrier_offset);
+        search_max = std::min(m_coarse_freq_peak_index+1, max_carrier_offset);
+        CalculateCoarseFrequencyResponse(
+            m_correlation_fft_buffer,
+            std::max(search_min-1, -max_carrier_offset), std::min(search_max+1, max_carrier_offset)
+        );
+    } else {
+        // Step 3: Get IFFT so we can do correlation in frequency domain via product in time domain
+        CalculateIFFT(m_correlation_fft_buffer, m_correlation_ifft_buffer);
+
+        // Step 4: Conjugate product in time domain
+        //         NOTE: correlation_prs_time_reference is already the conjugate
+        for (size_t i = 0; i < m_params.nb_fft; i++) {
+            m_correlation_ifft_buffer[i] *= m_correlation_prs_time_reference[i];
+        }
+
+        // Step 5: Get FFT to get correlation in frequency domain
+        CalculateFFT(m_correlation_ifft_buffer, m_correlation_fft_buffer);
+
+        // Step 6: Get magnitude spectrum so we can find the correlation peak
+        // NOTE: The bins outside of the search are only needed by debug views
+        if (m_is_tap_active.load(std::memory_order_relaxed)) {
+            CalculateMagnitude(m_correlation_fft_buffer, m_correlation_frequency_response, -M, M-1);
+        } else {
+            CalculateMagnitude(m_correlation_fft_buffer, m_correlation_frequency_response, search_min, std::min(search_max, M-1));
+        }
+    }
+
+    // Step 7: Find the peak in our maximum coarse frequency error window
+    int max_index = search_min;
     float max_value = m_correlation_frequency_response[max_index+M];
-    for (int i = -max_carrier_offset; i <= max_carrier_offset; i++) {
+    for (int i = search_min; i <= search_max; i++) {
         const int fft_index = i+M;
         if (fft_index == int(m_params.nb_fft)) continue;
         const float value = m_correlation_frequency_response[fft_index];
@@ -461,7 +985,21 @@ size_t OFDM_Demod::RunCoarseFreqSync(tcb::span<const std::complex<float>> buf) {
     m_freq_coarse_offset += delta;
     m_is_found_coarse_freq_offset = true;
 
-    // Step 11: Counter adjust the fine frequency offset
+    // Step 11: Lock once the peak has stayed put and go back to the full search if it moves
+    const bool is_peak_moved = m_is_coarse_freq_locked && (max_index != m_coarse_freq_peak_index);
+    m_coarse_freq_peak_index = max_index;
+    if (is_large_correction || is_peak_moved) {
+        m_is_coarse_freq_locked = false;
+        m_total_coarse_freq_stable_frames = 0;
+    } else if (!m_is_coarse_freq_locked && (m_cfg.sync.coarse_freq_lock_frames > 0)) {
+        m_total_coarse_freq_stable_frames++;
+        if (m_total_coarse_freq_stable_frames >= m_cfg.sync.coarse_freq_lock_frames) {
+            m_is_coarse_freq_locked = true;
+            m_total_coarse_freq_frames_since_check = 0;
+        }
+    }
+
+    // Step 12: Counter adjust the fine frequency offset
     // In a near locked state the coarse frequency offset may fluctuate alot if it lies between two FFT bins
     // By counter adjusting the fine frequency offset, the combined coarse and fine frequency offset will be stable
     UpdateFineFrequencyOffset(-delta);
@@ -470,8 +1008,9 @@ size_t OFDM_Demod::RunCoarseFreqSync(tcb::span<const std::complex<float>> buf) {
     return 0;
 }
 
-size_t OFDM_Demod::RunFineTimeSync(tcb::span<const std::complex<float>> buf) {
+size_t OFDM_Demod::RunFineTimeSync() {
     PROFILE_BEGIN_FUNC();
+    METRICS_TIME_SCOPE("dab_ofdm_fine_time_sync_seconds", "Time spent on fine time synchronisation");
     // Clause 3.12.1 - Symbol timing synchronisation
     auto corr_time_buf = tcb::span(m_correlation_time_buffer);
     auto corr_prs_buf = corr_time_buf.subspan(m_params.nb_null_period, m_params.nb_symbol_period);
@@ -488,92 +1027,390 @@ size_t OFDM_Demod::RunFineTimeSync(tcb::span<const std::complex<float>> buf) {
     for (size_t i = 0; i < m_params.nb_fft; i++) {
         m_correlation_fft_buffer[i] *= m_correlation_prs_fft_reference[i];
     }
+    // The fractional delay of the PRS is read from the cross spectrum before the IFFT is done
+    const float prs_delay = CalculatePRSDelay();
 
     // Get IFFT to get our correlation result
     CalculateIFFT(m_correlation_fft_buffer, m_correlation_ifft_buffer);
-    for (size_t i = 0; i < m_params.nb_fft; i++) {
-        const auto& v = m_correlation_ifft_buffer[i];
-        const float A = 20.0f*std::log10(std::abs(v));
-        m_correlation_impulse_response[i] = A;
-    }
 
     // Calculate if we have a valid impulse response
     // If the peak is at least X dB above the mean, then we use that as our PRS starting index
-    float impulse_avg = 0.0f;
-    float impulse_max_value = m_correlation_impulse_response[0];
-    int impulse_max_index = 0;
-    for (int i = 0; i < int(m_params.nb_fft); i++) {
-        const float peak_value = m_correlation_impulse_response[i];
-
-        // We expect that the correlation peak will at least be somewhere near where we expect it
-        // When we are still locking on, the impulse response may have many peaks due to frequency offsets
-        // This causes spurious desyncs when one of these other peaks are very far away
-        // Thus we weigh the value of the peak with its distance from the expected location
-        const int expected_peak_x = (int)m_params.nb_cyclic_prefix;
-        const int distance_from_expectation = std::abs(expected_peak_x-i);
-        const float norm_distance = (float)distance_from_expectation / (float)m_params.nb_symbol_period;
-        const float decay_weight = 1.0f - m_cfg.sync.impulse_peak_distance_probability;
-        const float probability = 1.0f - decay_weight * norm_distance;
-        const float weighted_peak_value = probability*peak_value;
-
-        impulse_avg += peak_value;
-        if (weighted_peak_value > impulse_max_value) {
-            impulse_max_value = weighted_peak_value;
-            impulse_max_index = i;
-        }
-    }
-    impulse_avg /= (float)m_params.nb_fft;
+    // We expect that the correlation peak will at least be somewhere near where we expect it
+    // When we are still locking on, the impulse response may have many peaks due to frequency offsets
+    // This causes spurious desyncs when one of these other peaks are very far away
+    // Thus we weigh the value of the peak with its distance from the expected location
+    // NOTE: The log magnitude, mean and weighted peak are found together in one vectorised pass
+    const float decay_weight = 1.0f - m_cfg.sync.impulse_peak_distance_probability;
+    const auto impulse_peak = find_impulse_peak_auto(
+        m_correlation_ifft_buffer, m_correlation_impulse_response,
+        (int)m_params.nb_cyclic_prefix, decay_weight, (float)m_params.nb_symbol_period);
+    const float impulse_avg = impulse_peak.mean;
+    float impulse_max_value = impulse_peak.value;
+    int impulse_max_index = impulse_peak.index;
+    // The search starts from the unweighted value at the start of the response
+    if (impulse_max_value <= m_correlation_impulse_response[0]) {
+        impulse_max_value = m_correlation_impulse_response[0];
+        impulse_max_index = 0;
+    }
 
     // If the main lobe is insufficiently powerful we do not have a valid impulse response
-    // This probably means we had a severe desync and should restart
-    if ((impulse_max_value - impulse_avg) < m_cfg.sync.impulse_peak_threshold_db) {
-        Reset();
-        return 0;
+    // This is usually a fade or burst of interference over the PRS if the previous frame was synchronised
+    // so we track the predicted start instead of losing the frame and the frequency lock to a full search
+    // Otherwise this probably means we had a severe desync and should restart
+    // The sample rate offset shifts the predicted start by a fixed amount every frame
+    const float predicted_delay = GetPredictedPRSDelay();
+    const bool is_weak_peak = (impulse_max_value - impulse_avg) < m_cfg.sync.impulse_peak_threshold_db;
+    if (is_weak_peak) {
+        if (!m_is_frame_tracking || (m_total_tracking_misses >= m_cfg.sync.max_tracking_misses)) {
+            Reset();
+            return 0;
+        }
+        const int expected_index = (int)m_params.nb_cyclic_prefix + (int)std::round(predicted_delay);
+        impulse_max_index = FindTrackingPeak(impulse_avg, expected_index);
+        m_total_frames_tracked++;
+    } else {
+        m_total_tracking_misses = 0;
     }
 
     // The PRS correlation lobe occurs just after the cyclic prefix
     // We actually want the index at the start of the cyclic prefix, so we adjust offset for that
     const int offset = impulse_max_index - (int)m_params.nb_cyclic_prefix;
+    // A weak PRS has a noisy phase slope so the predicted delay is used instead
+    UpdateSampleRateOffset(offset, is_weak_peak ? predicted_delay : prs_delay, !is_weak_peak);
     const int prs_start_index = (int)m_params.nb_null_period + offset;
     const int prs_length = (int)m_params.nb_symbol_period - offset;
     auto prs_buf = corr_time_buf.subspan(prs_start_index, prs_length);
     
     m_inactive_buffer.Reset();
     m_inactive_buffer.ConsumeBuffer(prs_buf);
+    std::fill(m_inactive_symbol_views.begin(), m_inactive_symbol_views.end(), nullptr);
+    // The PRS was already converted so 8bit samples are read in after it
+    m_inactive_raw_buffer.Reset();
+    m_inactive_raw_buffer.Skip(prs_buf.size());
+    m_inactive_raw_start = prs_buf.size();
 
     m_correlation_time_buffer.SetLength(0);
     m_fine_time_offset = offset;
+    m_is_frame_tracking = true;
     m_state = State::READING_SYMBOLS;
     return 0;
 }
 
-size_t OFDM_Demod::ReadSymbols(tcb::span<const std::complex<float>> buf) {
+// Returns the index of the impulse peak in a narrow window around where it is predicted to be
+// The frames are read back to back so the peak is predicted to be just after the cyclic prefix
+// plus the drift due to the sample rate offset
+// NOTE: A peak that isn't above the lower threshold counts as a miss and the predicted start is used
+int OFDM_Demod::FindTrackingPeak(const float impulse_avg, int expected_index) {
+    expected_index = std::clamp(expected_index, 0, int(m_params.nb_fft)-1);
+    const int window = std::max(m_cfg.sync.tracking_window, 0);
+    const int start = std::max(expected_index-window, 0);
+    const int end = std::min(expected_index+window, int(m_params.nb_fft)-1);
+    int max_index = expected_index;
+    float max_value = m_correlation_impulse_response[size_t(expected_index)];
+    for (int i = start; i <= end; i++) {
+        const float value = m_correlation_impulse_response[size_t(i)];
+        if (value > max_value) {
+            max_value = value;
+            max_index = i;
+        }
+    }
+    if ((max_value - impulse_avg) < m_cfg.sync.tracking_peak_threshold_db) {
+        m_total_tracking_misses++;
+        return expected_index;
+    }
+    m_total_tracking_misses = 0;
+    return max_index;
+}
+
+// Delay of the PRS from the phase slope across its carriers in samples relative to its expected start
+// Clause 3.12.1 - Symbol timing synchronisation
+// The cross spectrum of a PRS delayed by t is rotated by -2*pi*k*t/N at carrier k
+// so the sum over adjacent carriers has a phase of -2*pi*t/N regardless of any common phase
+// NOTE: Unlike the impulse peak this isn't quantised to whole samples
+float OFDM_Demod::CalculatePRSDelay() const {
+    const size_t N = m_params.nb_fft;
+    std::complex<float> slope = 0.0f;
+    // the unused carriers around DC and the edges of the spectrum are zero in the reference
+    for (size_t i = 0; i < N; i++) {
+        slope += m_correlation_fft_buffer[(i+1) % N] * std::conj(m_correlation_fft_buffer[i]);
+    }
+    const float delay = -std::atan2(slope.imag(), slope.real()) * float(N) / TWO_PI;
+    return delay - float(m_params.nb_cyclic_prefix);
+}
+
+// Frames are read back to back so the next PRS is expected to be delayed by
+// the fraction of a sample left over from the last one and the drift over one frame
+float OFDM_Demod::GetPredictedPRSDelay() const {
+    const float frame_length = float(m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period);
+    const float residual = m_is_sample_rate_residual ? m_sample_rate_residual : 0.0f;
+    return residual + m_sample_rate_offset*frame_length;
+}
+
+// Called after the PRS was synchronised with the delay that was measured or predicted for it
+// The drift since the last frame is its delay minus the fraction of a sample that wasn't corrected by offset
+void OFDM_Demod::UpdateSampleRateOffset(const int offset, const float delay, const bool is_measured) {
+    const auto& cfg = m_cfg.sync;
+    if (!cfg.is_sample_rate_correction) {
+        m_sample_rate_offset = 0.0f;
+    } else if (is_measured && m_is_sample_rate_residual) {
+        const float frame_length = float(m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period);
+        const float measured_offset = (delay - m_sample_rate_residual) / frame_length;
+        // a jump in the delay of the PRS is usually a different path of a multipath channel being picked
+        // so it is ignored instead of being treated as a change in the sampling clock
+        if (std::abs(measured_offset) <= cfg.max_sample_rate_offset) {
+            const float beta = cfg.sample_rate_update_beta;
+            m_sample_rate_offset += beta*(measured_offset - m_sample_rate_offset);
+        }
+    }
+    m_sample_rate_residual = delay - float(offset);
+    m_is_sample_rate_residual = true;
+}
+
+template <typename T>
+size_t OFDM_Demod::ReadSymbols(tcb::span<const T> buf) {
     PROFILE_BEGIN_FUNC();
-    const size_t nb_read = m_inactive_buffer.ConsumeBuffer(buf);
-    if (!m_inactive_buffer.IsFull()) {
+    METRICS_TIME_SCOPE("dab_ofdm_read_symbols_seconds", "Time spent copying a block into the frame buffer");
+    constexpr bool is_raw = std::is_same_v<T, RawIQ_u8>;
+    auto& inactive_buffer = [this]() -> OFDM_Frame_Buffer<T>& {
+        if constexpr (is_raw) {
+            return m_inactive_raw_buffer;
+        } else {
+            return m_inactive_buffer;
+        }
+    }();
+
+    size_t nb_read = 0;
+    if constexpr (is_raw) {
+        nb_read = inactive_buffer.ConsumeBuffer(buf);
+    } else {
+        nb_read = m_is_zero_copy_block ?
+            inactive_buffer.ConsumeBufferView(buf, m_inactive_symbol_views) :
+            inactive_buffer.ConsumeBuffer(buf);
+    }
+    if (!inactive_buffer.IsFull()) {
         return nb_read;
     }
 
     // Copy the null symbol so we can use it in the PRS correlation step
-    auto null_sym = m_inactive_buffer.GetNullSymbol();
+    auto null_sym = inactive_buffer.GetNullSymbol();
     m_correlation_time_buffer.SetLength(m_params.nb_null_period);
-    for (size_t i = 0; i < m_params.nb_null_period; i++) {
-        m_correlation_time_buffer[i] = null_sym[i];
+    if constexpr (is_raw) {
+        ConvertRawIQ(null_sym, m_correlation_time_buffer_data.first(m_params.nb_null_period), m_input_format);
+    } else {
+        const auto* null_view = m_inactive_symbol_views[m_params.nb_frame_symbols];
+        const auto* null_src = (null_view != nullptr) ? null_view : null_sym.data();
+        std::memcpy(m_correlation_time_buffer.data(), null_src, m_params.nb_null_period*sizeof(std::complex<float>));
     }
 
-    PROFILE_BEGIN(coordinator_wait);
-    m_coordinator->WaitEnd();
-    PROFILE_END(coordinator_wait);
+    // The frame is started right away if the pipelines are idle, otherwise it waits in the queue
+    // If the queue is full the reader either skips the frame or waits for the pipelines
+    // NOTE: Skipping a frame keeps synchronisation since the null symbol was already copied
+    const auto format = is_raw ? m_input_format : Input_Format::C32;
+    if ((m_ingest_total_queued == 0) && m_coordinator->IsEnded()) {
+        m_coordinator->WaitEnd();
+        StartInactiveFrame(format);
+    } else if (m_ingest_total_queued < m_ingest_frames.size()) {
+        QueueInactiveFrame(format);
+    } else if (m_thread_config.is_skip_ingest_overrun) {
+        m_total_frames_overrun++;
+    } else {
+        PROFILE_BEGIN(coordinator_wait);
+        m_coordinator->WaitEnd();
+        PROFILE_END(coordinator_wait);
+        if (m_ingest_total_queued == 0) {
+            StartInactiveFrame(format);
+        } else {
+            StartQueuedFrame();
+            QueueInactiveFrame(format);
+        }
+    }
+    m_inactive_buffer.Reset();
+    m_inactive_raw_buffer.Reset();
+    m_inactive_raw_start = 0;
+
+    m_state = State::READING_NULL_AND_PRS;
+    return nb_read;
+}
+
+// Called by the reader thread after the previous frame has ended
+template <typename T>
+size_t OFDM_Demod::ProbeIdleSignal(tcb::span<const T> buf) {
+    PROFILE_BEGIN_FUNC();
+    const size_t N = buf.size();
+    const size_t nb_frame_samples = m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period;
+    const size_t nb_interval = size_t(std::max(m_cfg.idle.probe_interval_frames, 1))*nb_frame_samples;
+    const size_t nb_probe = std::min(size_t(std::max(m_cfg.idle.probe_frames, 0.0f)*float(nb_frame_samples)), nb_interval);
+    const size_t K = (size_t)std::max(m_cfg.signal_l1.nb_samples, 1);
+    const size_t D = (size_t)std::max(m_cfg.idle.probe_decimate, 1);
+
+    // Skip the samples between probes
+    if (m_idle_probe_offset >= nb_probe) {
+        const size_t nb_skip = std::min(nb_interval-m_idle_probe_offset, N);
+        m_idle_probe_offset += nb_skip;
+        if (m_idle_probe_offset == nb_interval) {
+            m_idle_probe_offset = 0;
+        }
+        return nb_skip;
+    }
+
+    // Measure every D'th window of the probe
+    // NOTE: Windows split across blocks are skipped so the probe doesn't need to buffer samples
+    size_t nb_read = 0;
+    while ((nb_read < N) && (m_idle_probe_offset < nb_probe)) {
+        const size_t window_index = m_idle_probe_offset / K;
+        const size_t window_offset = m_idle_probe_offset % K;
+        const size_t nb_window = std::min({K-window_offset, nb_probe-m_idle_probe_offset, N-nb_read});
+        const bool is_measured = (window_offset == 0) && (nb_window == K) && ((window_index % D) == 0);
+        if (is_measured) {
+            const float l1_avg = CalculateL1Average(buf.subspan(nb_read, K));
+            m_idle_probe_l1_sum += l1_avg;
+            m_idle_probe_l1_min = (m_idle_probe_windows == 0) ? l1_avg : std::min(m_idle_probe_l1_min, l1_avg);
+            m_idle_probe_windows++;
+        }
+        nb_read += nb_window;
+        m_idle_probe_offset += nb_window;
+    }
+
+    if (m_idle_probe_offset == nb_probe) {
+        FinishIdleProbe();
+    }
+    return nb_read;
+}
+
+void OFDM_Demod::FinishIdleProbe() {
+    const int nb_windows = m_idle_probe_windows;
+    const float l1_avg = (nb_windows > 0) ? (m_idle_probe_l1_sum / float(nb_windows)) : 0.0f;
+    const float l1_min = m_idle_probe_l1_min;
+    m_idle_probe_l1_sum = 0.0f;
+    m_idle_probe_l1_min = 0.0f;
+    m_idle_probe_windows = 0;
+    if (nb_windows == 0) return;
+    m_total_idle_probes++;
+
+    // Clause 3.12.2 - The null symbol of a transmission is a dip in power that noise doesn't have
+    const bool is_null_power_dip = l1_min < (l1_avg * m_cfg.null_l1_search.thresh_null_start);
+    const bool is_level_rise = l1_avg > (m_idle_reference_l1 * m_cfg.idle.level_rise);
+    // The lowest level is kept as the noise floor so a slowly rising signal is still found
+    m_idle_reference_l1 = std::min(m_idle_reference_l1, l1_avg);
+    if (is_null_power_dip || is_level_rise) {
+        m_total_idle_wakeups++;
+        StopIdleProbing(l1_avg);
+    }
+}
+
+void OFDM_Demod::UpdateIdleDetector(const size_t nb_samples) {
+    // NOTE: The coordinator thread counts the frames so a demodulated frame is seen after the block that read it
+    const int total_frames_read = m_total_frames_read.load(std::memory_order_relaxed);
+    if (!m_cfg.idle.is_enabled || (total_frames_read != m_idle_last_frames_read)) {
+        m_idle_last_frames_read = total_frames_read;
+        m_idle_unsynced_samples = 0;
+        if (m_state == State::IDLE_PROBING) {
+            StopIdleProbing(m_signal_l1_average);
+        }
+        return;
+    }
+    if (m_state == State::IDLE_PROBING) return;
+
+    m_idle_unsynced_samples += nb_samples;
+    const size_t nb_frame_samples = m_params.nb_null_period + m_params.nb_frame_symbols*m_params.nb_symbol_period;
+    const size_t nb_idle_samples = size_t(std::max(m_cfg.idle.idle_after_frames, 1))*nb_frame_samples;
+    // Only the null power dip search is interrupted so a frame that is being read is never dropped
+    if ((m_idle_unsynced_samples >= nb_idle_samples) && (m_state == State::FINDING_NULL_POWER_DIP)) {
+        StartIdleProbing();
+    }
+}
+
+void OFDM_Demod::StartIdleProbing() {
+    m_state = State::IDLE_PROBING;
+    m_null_power_dip_buffer.SetLength(0);
+    m_raw_null_power_dip_buffer.SetLength(0);
+    m_is_null_start_found = false;
+    m_is_null_end_found = false;
+    ResetNullL1Window();
+    m_idle_reference_l1 = m_signal_l1_average;
+    m_idle_probe_offset = 0;
+    m_idle_probe_l1_sum = 0.0f;
+    m_idle_probe_l1_min = 0.0f;
+    m_idle_probe_windows = 0;
+}
+
+void OFDM_Demod::StopIdleProbing(const float signal_l1_average) {
+    // The level wasn't tracked while idle so the null power dip search starts from the probe's level
+    m_state = State::FINDING_NULL_POWER_DIP;
+    m_signal_l1_average = signal_l1_average;
+    m_idle_unsynced_samples = 0;
+    ResetNullL1Window();
+}
+
+void OFDM_Demod::StartInactiveFrame(const Input_Format format) {
+    PROFILE_BEGIN_FUNC();
+    // The previous frame is finished and this frame was synchronised so nothing else is writing the buffers
+    if (m_is_tap_active.load(std::memory_order_relaxed)) {
+        UpdateTap();
+    }
     // double buffer
     std::swap(m_inactive_buffer_data, m_active_buffer_data);
-    m_inactive_buffer.Reset();
+    std::swap(m_inactive_raw_buffer_data, m_active_raw_buffer_data);
+    std::swap(m_inactive_symbol_views, m_active_symbol_views);
+    m_active_format = format;
+    m_active_raw_start = m_inactive_raw_start;
+    // Average sample magnitude is mapped to a fixed level which leaves headroom for the peaks of the signal
+    m_active_q15_scale = Q15_SIGNAL_LEVEL / std::max(m_signal_l1_average, 1e-6f);
+    m_active_sample_rate_offset = m_sample_rate_offset;
+    m_active_capture_time = m_reader_capture_time;
     // launch all our worker threads
     PROFILE_BEGIN(coordinator_start);
-    m_coordinator->SignalStart();
+    StartFrame();
     PROFILE_END(coordinator_start);
+}
 
-    m_state = State::READING_NULL_AND_PRS;
-    return nb_read;
+// Called by the reader thread while the pipelines are busy
+void OFDM_Demod::QueueInactiveFrame(const Input_Format format) {
+    PROFILE_BEGIN_FUNC();
+    assert(m_ingest_total_queued < m_ingest_frames.size());
+    auto& frame = m_ingest_frames[(m_ingest_head + m_ingest_total_queued) % m_ingest_frames.size()];
+    // the free buffers of the entry are read into next
+    std::swap(m_inactive_buffer_data, frame.buffer_data);
+    std::swap(m_inactive_raw_buffer_data, frame.raw_buffer_data);
+    std::swap(m_inactive_symbol_views, frame.symbol_views);
+    frame.format = format;
+    frame.raw_start = m_inactive_raw_start;
+    frame.q15_scale = Q15_SIGNAL_LEVEL / std::max(m_signal_l1_average, 1e-6f);
+    frame.sample_rate_offset = m_sample_rate_offset;
+    frame.capture_time = m_reader_capture_time;
+    m_ingest_total_queued++;
+}
+
+// Called by the reader thread after the previous frame has ended
+void OFDM_Demod::StartQueuedFrame() {
+    PROFILE_BEGIN_FUNC();
+    assert(m_ingest_total_queued > 0);
+    if (m_is_tap_active.load(std::memory_order_relaxed)) {
+        UpdateTap();
+    }
+    // the entry keeps the buffers of the finished frame as its free buffers
+    auto& frame = m_ingest_frames[m_ingest_head];
+    std::swap(m_active_buffer_data, frame.buffer_data);
+    std::swap(m_active_raw_buffer_data, frame.raw_buffer_data);
+    std::swap(m_active_symbol_views, frame.symbol_views);
+    m_active_format = frame.format;
+    m_active_raw_start = frame.raw_start;
+    m_active_q15_scale = frame.q15_scale;
+    m_active_sample_rate_offset = frame.sample_rate_offset;
+    m_active_capture_time = frame.capture_time;
+    m_ingest_head = (m_ingest_head + 1) % m_ingest_frames.size();
+    m_ingest_total_queued--;
+    PROFILE_BEGIN(coordinator_start);
+    StartFrame();
+    PROFILE_END(coordinator_start);
+}
+
+// Queued frames are started when the reader is given more samples instead of by the coordinator
+// so only the reader thread touches the queue and the pipelines keep the same protocol as a double buffer
+void OFDM_Demod::StartQueuedFrameIfIdle() {
+    if ((m_ingest_total_queued == 0) || !m_coordinator->IsEnded()) return;
+    m_coordinator->WaitEnd();
+    StartQueuedFrame();
 }
 
 // Thread 2: Coordinate pipeline threads and combine fine time synchronisation results
@@ -589,53 +1426,219 @@ bool OFDM_Demod::CoordinatorThread() {
         return false;
     }
 
+    METRICS_TIME_SCOPE("dab_ofdm_frame_seconds", "Time from starting the pipelines on a frame to signalling it is demodulated");
+
+    // The pipelines read the mask after they are started so it is the same for the whole frame
+    if (m_is_symbol_mask_changed.exchange(false, std::memory_order_acquire)) {
+        UpdateSymbolMask();
+    }
+    UpdatePipelineBuffers();
+
+    // Only the active pipelines are started and the rest stay asleep
+    const auto pipelines = tcb::span(m_pipelines).first(size_t(m_total_active_pipelines.load(std::memory_order_relaxed)));
+    const auto time_start = std::chrono::steady_clock::now();
     PROFILE_BEGIN(pipeline_workers);
     {
         PROFILE_BEGIN(pipeline_start);
-        for (auto& pipeline: m_pipelines) {
+        for (auto& pipeline: pipelines) {
             pipeline->SignalStart();
         }
         PROFILE_END(pipeline_start);
 
         PROFILE_BEGIN(pipeline_wait_phase_error);
-        for (auto& pipeline: m_pipelines) {
+        for (auto& pipeline: pipelines) {
             pipeline->WaitPhaseError();
         }
         PROFILE_END(pipeline_wait_phase_error);
 
-        // Clause 3.13.1 - Fraction frequency offset estimation
-        PROFILE_BEGIN(calculate_phase_error);
-        float average_cyclic_error = 0;
-        for (const auto& pipeline: m_pipelines) {
-            const float cyclic_error = pipeline->GetAveragePhaseError();
-            average_cyclic_error += cyclic_error;
-        }
-        average_cyclic_error /= float(m_params.nb_frame_symbols);
-        // Calculate adjustments to fine frequency offset 
-        const float fine_freq_error = CalculateFineFrequencyError(average_cyclic_error);
-        const float beta = m_cfg.sync.fine_freq_update_beta;
-        const float delta = -beta*fine_freq_error;
-        UpdateFineFrequencyOffset(delta);
-        PROFILE_END(calculate_phase_error);
+        UpdatePipelinePhaseError(pipelines);
 
         PROFILE_BEGIN(pipeline_wait_end);
-        for (auto& pipeline: m_pipelines) {
+        for (auto& pipeline: pipelines) {
             pipeline->WaitEnd();
         }
         PROFILE_END(pipeline_wait_end);
-
-        PROFILE_BEGIN(coordinator_signal_end);
-        m_coordinator->SignalEnd();
-        PROFILE_END(coordinator_signal_end);
     }
     PROFILE_END(pipeline_workers);
-    m_total_frames_read++;
+    const auto time_end = std::chrono::steady_clock::now();
+    FinishFrame(std::chrono::duration<float>(time_end-time_start).count());
+    return true;
+}
+
+// Clause 3.13.1 - Fraction frequency offset estimation
+void OFDM_Demod::UpdatePipelinePhaseError(tcb::span<const std::unique_ptr<OFDM_Demod_Pipeline>> pipelines) {
+    PROFILE_BEGIN_FUNC();
+    float average_cyclic_error = 0;
+    for (const auto& pipeline: pipelines) {
+        const float cyclic_error = pipeline->GetAveragePhaseError();
+        average_cyclic_error += cyclic_error;
+    }
+    average_cyclic_error /= float(std::max(m_active_total_fft_symbols, size_t(1)));
+    // Calculate adjustments to fine frequency offset 
+    const float fine_freq_error = CalculateFineFrequencyError(average_cyclic_error);
+    const float beta = m_cfg.sync.fine_freq_update_beta;
+    const float delta = -beta*fine_freq_error;
+    UpdateFineFrequencyOffset(delta);
+}
+
+// Publish the demodulated frame and let the reader thread start the next one
+void OFDM_Demod::FinishFrame(const float frame_seconds) {
+    PROFILE_BEGIN_FUNC();
+    UpdateActivePipelines(frame_seconds);
+    UpdateSignalQuality();
+    m_total_frames_read.fetch_add(1, std::memory_order_relaxed);
+    const Latency_Trace_Scope latency_scope(m_active_capture_time);
+    LATENCY_TRACE_RECORD("dab_latency_ofdm_frame_seconds", "Time from capturing the samples of a frame to it being demodulated");
+    if (!m_segment_ends.empty()) {
+        PublishSegments(true);
+    }
+
+    if (m_frame_ring != nullptr) {
+        PROFILE_BEGIN(frame_ring_push);
+        if (m_is_frame_ring_blocking) {
+            m_frame_ring->push_blocking(m_pipeline_out_bits, m_active_capture_time);
+        } else {
+            m_frame_ring->try_push(m_pipeline_out_bits, m_active_capture_time);
+        }
+        PROFILE_END(frame_ring_push);
+    }
 
     PROFILE_BEGIN(obs_on_ofdm_frame);
     m_obs_on_ofdm_frame.Notify(m_pipeline_out_bits);
     PROFILE_END(obs_on_ofdm_frame);
+    m_obs_on_frame_time.Notify(frame_seconds);
 
-    return true;
+    // NOTE: We signal the end after publishing so that Flush() also waits for the observers
+    //       The next frame can't start until this thread loops around so this doesn't reduce throughput
+    PROFILE_BEGIN(coordinator_signal_end);
+    m_coordinator->SignalEnd();
+    PROFILE_END(coordinator_signal_end);
+}
+
+// Modulation error ratio of the frame from the decision error the demapper accumulated for each carrier
+// MER = sum(|ideal|^2) / sum(|error|^2) where the normalised ideal point has a power of 2
+void OFDM_Demod::UpdateSignalQuality() {
+    if (!m_active_is_signal_quality || m_carrier_error_data.empty()) return;
+    PROFILE_BEGIN_FUNC();
+    const size_t N = m_params.nb_data_carriers;
+    const int nb_symbols = int(std::count_if(
+        m_active_symbol_mask.begin(), m_active_symbol_mask.end(),
+        [](const auto is_active) { return is_active != 0; }));
+    if (nb_symbols == 0) return;
+
+    using Quality = OFDM_Demod_Signal_Quality;
+    auto quality = m_signal_quality.load();
+    quality.carrier_snr_histogram.fill(0);
+    // NOTE: Clamping the error ratio avoids taking the log of zero on an ideal signal
+    const float min_ratio = std::pow(10.0f, -Quality::MAX_DB/10.0f);
+    const float ideal_power = DQPSK_IDEAL_POWER*float(nb_symbols);
+    float total_error = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        float carrier_error = 0.0f;
+        for (size_t j = 0; j < m_pipelines.size(); j++) {
+            float& error = m_carrier_error_data[j*N + i];
+            carrier_error += error;
+            error = 0.0f;
+        }
+        total_error += carrier_error;
+        const float ratio = std::max(carrier_error/ideal_power, min_ratio);
+        const float snr_db = -10.0f*std::log10(ratio);
+        const size_t bin = std::min(size_t(snr_db/Quality::SNR_BIN_WIDTH_DB), Quality::TOTAL_SNR_BINS-1);
+        quality.carrier_snr_histogram[bin]++;
+    }
+    const float ratio = std::max(total_error/(ideal_power*float(N)), min_ratio);
+    quality.mer_db = -10.0f*std::log10(ratio);
+    quality.total_symbols = nb_symbols;
+    quality.total_frames++;
+    m_signal_quality.store(quality);
+}
+
+// Called by the reader thread once the previous frame has finished
+void OFDM_Demod::StartFrame() {
+    if ((m_executor == nullptr) && !m_is_inline) {
+        m_coordinator->SignalStart();
+        return;
+    }
+
+    // NOTE: The previous frame has finished so no job is reading the mask
+    if (m_is_symbol_mask_changed.exchange(false, std::memory_order_acquire)) {
+        UpdateSymbolMask();
+    }
+    UpdatePipelineBuffers();
+
+    const int nb_active = m_total_active_pipelines.load(std::memory_order_relaxed);
+    for (int i = 0; i < nb_active; i++) {
+        // The last DQPSK symbol of a pipeline needs its own FFTs and the first FFT of the next pipeline
+        m_job_total_waiting_fft[i].store(2, std::memory_order_relaxed);
+    }
+    m_job_total_remaining.store(nb_active, std::memory_order_relaxed);
+    m_job_time_start = std::chrono::steady_clock::now();
+    // The only pipeline has no dependencies so it runs straight through and finishes the frame
+    if (m_is_inline) {
+        PipelineJob(0);
+        return;
+    }
+    for (int i = 0; i < nb_active; i++) {
+        m_executor->Submit(OFDM_Demod_Job{ &OFDM_Demod::RunPipelineJob, this, size_t(i) });
+    }
+}
+
+void OFDM_Demod::RunPipelineJob(void* context, size_t index) {
+    static_cast<OFDM_Demod*>(context)->PipelineJob(index);
+}
+
+// Same as PipelineThread() except jobs never wait on each other
+// The FFT done dependency between adjacent pipelines is a counter per pipeline 
+// and whichever job satisfies it last calculates the dependent DQPSK symbol
+// The last job to finish does the work of the coordinator thread
+void OFDM_Demod::PipelineJob(const size_t index) {
+    PROFILE_BEGIN_FUNC();
+    const uint64_t cpu_time_start = get_thread_cpu_time_ns();
+    auto& pipeline = *(m_pipelines[index].get());
+    const auto satisfy_dependency = [this](const size_t i) {
+        if (m_job_total_waiting_fft[i].fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        const auto& dependency = *(m_pipelines[i].get());
+        const int symbol_end_dqpsk = std::max(
+            std::min((int)dependency.GetSymbolEnd(), (int)m_params.nb_frame_symbols-1), 
+            (int)dependency.GetSymbolStart());
+        const int symbol_dependent = std::max(symbol_end_dqpsk-1, (int)dependency.GetSymbolStart());
+        PROFILE_BEGIN(calculate_dependent_dqpsk);
+        CalculatePipelineDQPSK(i, symbol_dependent, symbol_end_dqpsk);
+        PROFILE_END(calculate_dependent_dqpsk);
+    };
+
+    {
+        METRICS_TIME_SCOPE("dab_ofdm_pipeline_seconds", "Time a pipeline spends demodulating its share of a frame");
+        const int symbol_start = (int)pipeline.GetSymbolStart();
+        const int symbol_end = (int)pipeline.GetSymbolEnd();
+        const int symbol_end_no_null = std::min(symbol_end, (int)m_params.nb_frame_symbols);
+        const int symbol_end_dqpsk = std::max(std::min(symbol_end, (int)m_params.nb_frame_symbols-1), symbol_start);
+        const bool is_dependent = pipeline.GetDependent() != nullptr;
+        const int symbol_dependent = is_dependent ? std::max(symbol_end_dqpsk-1, symbol_start) : symbol_end_dqpsk;
+
+        float phase_error = 0.0f;
+        if (!m_active_is_fused_symbols) {
+            CorrectPipelineSymbols(symbol_start, symbol_end);
+            phase_error = CalculatePipelinePhaseError(symbol_start, symbol_end_no_null);
+            CalculatePipelineFFT(index, symbol_start, std::min(symbol_start+1, symbol_end));
+        } else if (symbol_start < symbol_end) {
+            phase_error = CalculatePipelineFusedSymbol(index, symbol_start);
+        }
+        if (index > 0) satisfy_dependency(index-1);
+        phase_error += CalculatePipelineIndependent(index, symbol_start, symbol_end, symbol_dependent);
+        pipeline.SetAveragePhaseError(phase_error);
+        if (is_dependent) satisfy_dependency(index);
+    }
+
+    const uint64_t cpu_time_end = get_thread_cpu_time_ns();
+    m_total_thread_cpu_time_ns.fetch_add(cpu_time_end-cpu_time_start, std::memory_order_relaxed);
+    if (m_job_total_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    // NOTE: Nothing after this may access our members since the frame ends in FinishFrame()
+    const auto pipelines = tcb::span(m_pipelines).first(size_t(m_total_active_pipelines.load(std::memory_order_relaxed)));
+    UpdatePipelinePhaseError(pipelines);
+    const auto time_end = std::chrono::steady_clock::now();
+    FinishFrame(std::chrono::duration<float>(time_end-m_job_time_start).count());
 }
 
 // Thread 3xN: Process ofdm frame
@@ -647,13 +1650,9 @@ bool OFDM_Demod::CoordinatorThread() {
 // Clause 3.16: Data demapper
 // Clause 3.16.1: Frequency deinterleaving
 // Clause 3.16.2: QPSK symbol demapper
-bool OFDM_Demod::PipelineThread(OFDM_Demod_Pipeline& thread_data, OFDM_Demod_Pipeline* dependent_thread_data) {
+bool OFDM_Demod::PipelineThread(const size_t index) {
     PROFILE_BEGIN_FUNC();
-
-    const int symbol_start = (int)thread_data.GetSymbolStart();
-    const int symbol_end = (int)thread_data.GetSymbolEnd();
-    const int symbol_end_no_null = std::min(symbol_end, (int)m_params.nb_frame_symbols);
-    const int symbol_end_dqpsk = std::min(symbol_end, (int)m_params.nb_frame_symbols-1);
+    auto& thread_data = *(m_pipelines[index].get());
 
     PROFILE_BEGIN(pipeline_wait_start);
     thread_data.WaitStart();
@@ -663,106 +1662,400 @@ bool OFDM_Demod::PipelineThread(OFDM_Demod_Pipeline& thread_data, OFDM_Demod_Pip
         return false;
     }
 
+    // The symbols of each pipeline can change between frames (see SchedulePipelines)
+    OFDM_Demod_Pipeline* dependent_thread_data = thread_data.GetDependent();
+
+    METRICS_TIME_SCOPE("dab_ofdm_pipeline_seconds", "Time a pipeline spends demodulating its share of a frame");
+
+    const int symbol_start = (int)thread_data.GetSymbolStart();
+    const int symbol_end = (int)thread_data.GetSymbolEnd();
+    const int symbol_end_no_null = std::min(symbol_end, (int)m_params.nb_frame_symbols);
+    const int symbol_end_dqpsk = std::max(std::min(symbol_end, (int)m_params.nb_frame_symbols-1), symbol_start);
+
     PROFILE_BEGIN(data_processing);
 
-    // Fine and coarse frequency correction with PLL
+    // Fused pipelines correct and transform each of their symbols in one pass as they go
+    // NOTE: The phase error only changes the fine frequency offset of the next frame so it can be signalled last
+    const bool is_fused = m_active_is_fused_symbols;
+    float phase_error = 0.0f;
+    if (!is_fused) {
+        CorrectPipelineSymbols(symbol_start, symbol_end);
+
+        // Clause 3.13: Frequency offset estimation and correction
+        // Clause 3.13.1 - Fraction frequency offset estimation
+        // Get phase error using cyclic prefix (ignore null symbol)
+        phase_error = CalculatePipelinePhaseError(symbol_start, symbol_end_no_null);
+
+        // Signal to the coordinator thread our phase error
+        thread_data.SetAveragePhaseError(phase_error);
+        PROFILE_BEGIN(pipeline_signal_phase_error);
+        thread_data.SignalPhaseError();
+        PROFILE_END(pipeline_signal_phase_error);
+    }
+
+    // Calculate FFT and notify threads which need this result for DQPSK
+    // This way we don't hold up other threads waiting for these results
+    PROFILE_BEGIN(calculate_dependent_fft);
+    if (!is_fused) {
+        CalculatePipelineFFT(index, symbol_start, std::min(symbol_start+1, symbol_end));
+    } else if (symbol_start < symbol_end) {
+        phase_error = CalculatePipelineFusedSymbol(index, symbol_start);
+    }
+    PROFILE_END(calculate_dependent_fft);
+
+    PROFILE_BEGIN(pipeline_signal_fft);
+    thread_data.SignalFFT();
+    PROFILE_END(pipeline_signal_fft);
+
+    // These FFTs are only used by this thread for DQPSK 
+    // Get DQPSK result for last symbol in this thread 
+    // which is dependent on other threads finishing
+    // NOTE: We always wait for the dependent pipeline so its signal isn't carried over to the next frame
+    const int symbol_dependent = 
+        (dependent_thread_data != nullptr) ? std::max(symbol_end_dqpsk-1, symbol_start) : symbol_end_dqpsk;
+    phase_error += CalculatePipelineIndependent(index, symbol_start, symbol_end, symbol_dependent);
+    if (is_fused) {
+        thread_data.SetAveragePhaseError(phase_error);
+        PROFILE_BEGIN(pipeline_signal_phase_error);
+        thread_data.SignalPhaseError();
+        PROFILE_END(pipeline_signal_phase_error);
+    }
+
+    if (dependent_thread_data != nullptr) {
+        PROFILE_BEGIN(dependent_pipeline_wait_fft);
+        dependent_thread_data->WaitFFT();
+        PROFILE_END(dependent_pipeline_wait_fft);
+
+        PROFILE_BEGIN(calculate_dependent_dqpsk);
+        CalculatePipelineDQPSK(index, symbol_dependent, symbol_end_dqpsk);
+        PROFILE_END(calculate_dependent_dqpsk);
+    }
+
+    PROFILE_BEGIN(pipeline_signal_end);
+    thread_data.SignalEnd();
+    PROFILE_END(pipeline_signal_end);
+
+    return true;
+}
+
+// The 8bit samples after the PRS are converted here so the reader thread only copies them
+void OFDM_Demod::ConvertPipelineSymbols(const int start, const int end) {
+    const auto& fft_mask = m_active_fft_mask;
+    if (m_active_format != Input_Format::C32) {
+        PROFILE_BEGIN(convert_raw_iq);
+        const size_t period = m_params.nb_symbol_period;
+        for (int i = start; i < end; i++) {
+            if (!fft_mask[i]) continue;
+            const size_t sample_offset = size_t(i)*period;
+            const size_t raw_start = 
+                (m_active_raw_start > sample_offset) ? 
+                std::min(m_active_raw_start-sample_offset, period) : 0;
+            auto raw_buf = m_active_raw_buffer.GetDataSymbol(i).subspan(raw_start);
+            auto sym_buf = m_active_buffer.GetDataSymbol(i).subspan(raw_start);
+            ConvertRawIQ(raw_buf, sym_buf, m_active_format);
+        }
+        PROFILE_END(convert_raw_iq);
+    }
+}
+
+// Symbols that aren't in the mask are skipped (see SetDataSymbolMask)
+// Fine and coarse frequency correction with PLL
+void OFDM_Demod::CorrectPipelineSymbols(const int start, const int end) {
+    PROFILE_BEGIN_FUNC();
+    const auto& fft_mask = m_active_fft_mask;
+    ConvertPipelineSymbols(start, end);
+
     PROFILE_BEGIN(apply_pll);
     // NOTE: We create a local copy of the frequency offset since it
     //       can be changed in the reader thread due to coarse frequency correction
     const float frequency_offset = m_freq_coarse_offset + m_freq_fine_offset;
-    for (int i = symbol_start; i < symbol_end; i++) {
+    // NOTE: Symbols that weren't copied are read from the caller's samples into the frame buffer
+    for (int i = start; i < end; i++) {
+        if (!fft_mask[i]) continue;
         auto sym_buf = m_active_buffer.GetDataSymbol(i);
+        const auto* view = m_active_symbol_views[size_t(i)];
+        auto src_buf = (view != nullptr) ? tcb::span<const std::complex<float>>(view, sym_buf.size()) : sym_buf;
         const int sample_offset = i*(int)m_params.nb_symbol_period;
         const float dt_start = float(sample_offset) * frequency_offset;
-        ApplyPLL(sym_buf, sym_buf, frequency_offset, dt_start); 
+        if (m_precision == OFDM_Demod_Precision::INT16) {
+            auto q15_buf = GetPipelineQ15Symbol(i);
+            quantise_q15_auto(src_buf, q15_buf, m_active_q15_scale);
+            apply_pll_q15_auto(q15_buf, q15_buf, frequency_offset, dt_start);
+        } else {
+            ApplyPLL(src_buf, sym_buf, frequency_offset, dt_start); 
+        }
     }
     PROFILE_END(apply_pll);
+}
 
-    // Clause 3.13: Frequency offset estimation and correction
-    // Clause 3.13.1 - Fraction frequency offset estimation
-    // Get phase error using cyclic prefix (ignore null symbol)
-    PROFILE_BEGIN(calculate_phase_error);
+float OFDM_Demod::CalculatePipelinePhaseError(const int start, const int end) {
+    PROFILE_BEGIN_FUNC();
     float total_phase_error = 0.0f;
-    for (int i = symbol_start; i < symbol_end_no_null; i++) {
-        auto sym_buf = m_active_buffer.GetDataSymbol(i);
-        const float cyclic_error = CalculateCyclicPhaseError(sym_buf);
+    for (int i = start; i < end; i++) {
+        if (!m_active_fft_mask[i]) continue;
+        const float cyclic_error = 
+            (m_precision == OFDM_Demod_Precision::INT16) ?
+            CalculateCyclicPhaseError(GetPipelineQ15Symbol(i)) :
+            CalculateCyclicPhaseError(m_active_buffer.GetDataSymbol(i));
         total_phase_error += cyclic_error;
     }
-    thread_data.SetAveragePhaseError(total_phase_error);
-    PROFILE_END(calculate_phase_error);
+    return total_phase_error;
+}
 
-    // Signal to the coordinator thread our phase error
-    PROFILE_BEGIN(pipeline_signal_phase_error);
-    thread_data.SignalPhaseError();
-    PROFILE_END(pipeline_signal_phase_error);
+// Clause 3.14.2 - FFT
+// Calculate fft (include null symbol)
+// Each consecutive run of symbols in the mask is transformed together
+void OFDM_Demod::CalculatePipelineFFT(const size_t index, int start, const int end) {
+    PROFILE_BEGIN_FUNC();
+    // The symbols are evenly spaced in the frame buffer so they are transformed in one call
+    const auto calculate_fft = [this](int run_start, int run_end) {
+        const size_t nb_symbols = size_t(run_end-run_start);
+        const size_t stride = m_active_buffer.GetDataSymbolStride();
+        // Clause 3.14.1 - Cyclic prefix removal
+        auto sym_buf = m_active_buffer.GetDataSymbol(run_start);
+        auto data_buf = tcb::span<const std::complex<float>>(
+            sym_buf.data() + m_params.nb_cyclic_prefix, 
+            (nb_symbols-1)*stride + m_params.nb_fft);
+        auto fft_buf = m_pipeline_fft_buffer.subspan(run_start*m_params.nb_fft, nb_symbols*m_params.nb_fft);
+        PROFILE_BEGIN(calculate_fft_many);
+        m_fft_plan->ExecuteMany(data_buf, stride, fft_buf, m_params.nb_fft, nb_symbols);
+        PROFILE_END(calculate_fft_many);
+    };
 
-    // Clause 3.14.2 - FFT
-    // Calculate fft (include null symbol)
-    const auto calculate_fft = [this](int start, int end) {
+    const auto& fft_mask = m_active_fft_mask;
+    // Fixed point symbols are transformed one at a time
+    if (m_precision == OFDM_Demod_Precision::INT16) {
         for (int i = start; i < end; i++) {
-            auto sym_buf = m_active_buffer.GetDataSymbol(i);
-            // Clause 3.14.1 - Cyclic prefix removal
-            auto data_buf = sym_buf.subspan(m_params.nb_cyclic_prefix, m_params.nb_fft);
-            auto fft_buf = m_pipeline_fft_buffer.subspan(i*m_params.nb_fft, m_params.nb_fft);
-            CalculateFFT(data_buf, fft_buf);
+            if (!fft_mask[i]) continue;
+            PROFILE_BEGIN(calculate_fft_q15);
+            auto data_buf = GetPipelineQ15Symbol(i).subspan(m_params.nb_cyclic_prefix, m_params.nb_fft);
+            auto fft_buf = m_pipeline_q15_fft_buffer.subspan(GetPipelineFFTSlot(index, i)*m_params.nb_fft, m_params.nb_fft);
+            m_fft_q15_plan->Execute(data_buf, fft_buf);
+            PROFILE_END(calculate_fft_q15);
         }
-    };
-
-    // Calculate FFT and notify threads which need this result for DQPSK
-    // This way we don't hold up other threads waiting for these results
-    PROFILE_BEGIN(calculate_dependent_fft);
-    calculate_fft(symbol_start, symbol_start+1);
-    PROFILE_END(calculate_dependent_fft);
-
-    PROFILE_BEGIN(pipeline_signal_fft);
-    thread_data.SignalFFT();
-    PROFILE_END(pipeline_signal_fft);
+        return;
+    }
+    // Headless FFTs go into the slots of the pipeline one at a time
+    if (m_active_is_headless) {
+        for (int i = start; i < end; i++) {
+            if (!fft_mask[i]) continue;
+            auto sym_buf = m_active_buffer.GetDataSymbol(i).subspan(m_params.nb_cyclic_prefix, m_params.nb_fft);
+            auto fft_buf = m_pipeline_fft_buffer.subspan(GetPipelineFFTSlot(index, i)*m_params.nb_fft, m_params.nb_fft);
+            CalculateFFT(sym_buf, fft_buf);
+            CorrectPipelineSampleRate(index, i);
+        }
+        return;
+    }
+    while (start < end) {
+        if (!fft_mask[start]) {
+            start++;
+            continue;
+        }
+        int run_end = start+1;
+        while ((run_end < end) && fft_mask[run_end]) run_end++;
+        calculate_fft(start, run_end);
+        for (int i = start; i < run_end; i++) {
+            CorrectPipelineSampleRate(index, i);
+        }
+        start = run_end;
+    }
+}
 
-    // These FFTs are only used by this thread for DQPSK 
-    PROFILE_BEGIN(calculate_independent_fft);
-    calculate_fft(symbol_start+1, symbol_end);
-    PROFILE_END(calculate_independent_fft);
+// Clause 3.14.1 - Cyclic prefix removal
+// A sampling clock that is off by e stretches the frame so symbol i starts i*e*T samples after where it is cut
+// This delay rotates carrier k by -2*pi*k*delay/N which would otherwise be an error in the differential phase
+// that grows towards the edges of the spectrum
+// NOTE: The delay is small enough to stay within the cyclic prefix so only the phase slope is corrected
+void OFDM_Demod::CorrectPipelineSampleRate(const size_t index, const int symbol) {
+    const float sample_rate_offset = m_active_sample_rate_offset;
+    if (sample_rate_offset == 0.0f) return;
+    const size_t N = m_params.nb_fft;
+    const float delay = float(symbol)*float(m_params.nb_symbol_period)*sample_rate_offset;
+    const float phase_step = TWO_PI*delay/float(N);
+    auto fft_buf = m_pipeline_fft_buffer.subspan(GetPipelineFFTSlot(index, symbol)*N, N);
+    // the rotation of each carrier is stepped from the last one for both sides of DC
+    const auto step = std::complex<float>(std::cos(phase_step), std::sin(phase_step));
+    auto rotation = step;
+    const size_t nb_half_carriers = m_params.nb_data_carriers/2;
+    for (size_t k = 1; k <= nb_half_carriers; k++) {
+        fft_buf[k] *= rotation;
+        fft_buf[N-k] *= std::conj(rotation);
+        rotation *= step;
+    }
+}
 
-    // Clause 3.15 - Differential demodulator
-    // perform our differential QPSK decoding
-    const auto calculate_dqpsk = [this](int start, int end) {
-        const size_t nb_viterbi_bits = m_params.nb_data_carriers*2;
-        for (int i = start; i < end; i++) {
+// Clause 3.15 - Differential demodulator
+// Clause 3.16 - Data demapper
+// perform our differential QPSK decoding straight into the frequency deinterleaved soft bits
+void OFDM_Demod::CalculatePipelineDQPSK(const size_t index, const int start, const int end) {
+    const size_t nb_viterbi_bits = m_params.nb_data_carriers*2;
+    const int symbol_end = int(m_pipelines[index]->GetSymbolEnd());
+    // Each pipeline accumulates the decision error of its own symbols so they don't share a carrier error buffer
+    auto carrier_error = m_active_is_signal_quality ?
+        m_pipeline_carrier_error.subspan(index*m_params.nb_data_carriers, m_params.nb_data_carriers) :
+        tcb::span<float>{};
+    const bool is_segmented = !m_segment_ends.empty();
+    for (int i = start; i < end; i++) {
+        if (m_active_symbol_mask[i]) {
             PROFILE_BEGIN(calculate_dqpsk_symbol);
-            auto fft_buf_0 = m_pipeline_fft_buffer.subspan((i+0)*m_params.nb_fft, m_params.nb_fft);
-            auto fft_buf_1 = m_pipeline_fft_buffer.subspan((i+1)*m_params.nb_fft, m_params.nb_fft);
-            auto dqpsk_vec_buf = m_pipeline_dqpsk_vec_buffer.subspan(i*m_params.nb_data_carriers, m_params.nb_data_carriers);
             auto viterbi_bit_buf = m_pipeline_out_bits.subspan(i*nb_viterbi_bits, nb_viterbi_bits);
-            CalculateDQPSK(fft_buf_1, fft_buf_0, dqpsk_vec_buf);
-            CalculateViterbiBits(dqpsk_vec_buf, viterbi_bit_buf);
+            // The FFT after our last symbol belongs to the next pipeline
+            const size_t slot_0 = GetPipelineFFTSlot(index, i);
+            const size_t slot_1 = GetPipelineFFTSlot((i+1 < symbol_end) ? index : index+1, i+1);
+            // NOTE: The demapper normalises each carrier so the exponents of the fixed point FFTs aren't needed
+            if (m_precision == OFDM_Demod_Precision::INT16) {
+                auto fft_buf_0 = m_pipeline_q15_fft_buffer.subspan(slot_0*m_params.nb_fft, m_params.nb_fft);
+                auto fft_buf_1 = m_pipeline_q15_fft_buffer.subspan(slot_1*m_params.nb_fft, m_params.nb_fft);
+                dqpsk_demapper_auto(fft_buf_0, fft_buf_1, m_carrier_mapper, viterbi_bit_buf, carrier_error);
+            } else {
+                auto fft_buf_0 = m_pipeline_fft_buffer.subspan(slot_0*m_params.nb_fft, m_params.nb_fft);
+                auto fft_buf_1 = m_pipeline_fft_buffer.subspan(slot_1*m_params.nb_fft, m_params.nb_fft);
+                dqpsk_demapper_auto(fft_buf_0, fft_buf_1, m_carrier_mapper, viterbi_bit_buf, carrier_error);
+            }
         }
-    };
+        // NOTE: Skipped symbols still count towards their segment since their bits are erasures
+        if (is_segmented) FinishSegmentSymbol(i);
+    }
+}
 
-    // Get DQPSK result for last symbol in this thread 
-    // which is dependent on other threads finishing
-    if (dependent_thread_data != nullptr) {
-        PROFILE_BEGIN(calculate_independent_dqpsk);
-        calculate_dqpsk(symbol_start, symbol_end_dqpsk-1);
-        PROFILE_END(calculate_independent_dqpsk);
+// Every segment waits for all of its symbols again since the pipelines can be rescheduled between frames
+void OFDM_Demod::StartSegments() {
+    if (m_segment_ends.empty()) return;
+    size_t symbol_start = 0;
+    for (size_t i = 0; i < m_segment_ends.size(); i++) {
+        m_segment_remaining[i].store(int(m_segment_ends[i]-symbol_start), std::memory_order_relaxed);
+        symbol_start = m_segment_ends[i];
+    }
+    m_total_segments_published = 0;
+}
 
-        PROFILE_BEGIN(dependent_pipeline_wait_fft);
-        dependent_thread_data->WaitFFT();
-        PROFILE_END(dependent_pipeline_wait_fft);
+void OFDM_Demod::FinishSegmentSymbol(const int symbol) {
+    const size_t segment = m_symbol_segments[size_t(symbol)];
+    // NOTE: The acquire and release pairs with the other pipelines that demapped the rest of the segment
+    if (m_segment_remaining[segment].fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    PublishSegments(false);
+}
 
-        PROFILE_BEGIN(calculate_dependent_dqpsk);
-        calculate_dqpsk(symbol_end_dqpsk-1, symbol_end_dqpsk);
-        PROFILE_END(calculate_dependent_dqpsk);
-    } else {
+// Segments are published in order so one that finishes early waits for those before it
+void OFDM_Demod::PublishSegments(const bool is_frame_end) {
+    PROFILE_BEGIN_FUNC();
+    auto lock = std::scoped_lock(m_mutex_segments);
+    const Latency_Trace_Scope latency_scope(m_active_capture_time);
+    const size_t nb_viterbi_bits = m_params.nb_data_carriers*2;
+    while (m_total_segments_published < m_segment_ends.size()) {
+        const size_t segment = m_total_segments_published;
+        const bool is_done = m_segment_remaining[segment].load(std::memory_order_acquire) == 0;
+        if (!is_done && !is_frame_end) break;
+        const size_t symbol_start = (segment > 0) ? m_segment_ends[segment-1] : 0;
+        const size_t symbol_end = m_segment_ends[segment];
+        auto bits = m_pipeline_out_bits.subspan(symbol_start*nb_viterbi_bits, (symbol_end-symbol_start)*nb_viterbi_bits);
+        m_obs_on_ofdm_segment.Notify(segment, bits);
+        m_total_segments_published++;
+    }
+}
+
+// FFTs of the symbols after the first one of a pipeline and the DQPSK symbols [start,dqpsk_end) that only need these
+// Headless pipelines demap each symbol once the FFT after it is ready so only the last two FFTs are kept
+// Fused pipelines also correct each symbol just before its FFT and return the phase error of those symbols
+float OFDM_Demod::CalculatePipelineIndependent(const size_t index, const int start, const int end, const int dqpsk_end) {
+    if (!m_active_is_headless && !m_active_is_fused_symbols) {
+        PROFILE_BEGIN(calculate_independent_fft);
+        CalculatePipelineFFT(index, start+1, end);
+        PROFILE_END(calculate_independent_fft);
         PROFILE_BEGIN(calculate_independent_dqpsk);
-        calculate_dqpsk(symbol_start, symbol_end_dqpsk);
+        CalculatePipelineDQPSK(index, start, dqpsk_end);
         PROFILE_END(calculate_independent_dqpsk);
+        return 0.0f;
+    }
+    PROFILE_BEGIN(calculate_independent_symbols);
+    float phase_error = 0.0f;
+    for (int i = start+1; i < end; i++) {
+        if (m_active_is_fused_symbols) {
+            phase_error += CalculatePipelineFusedSymbol(index, i);
+        } else {
+            CalculatePipelineFFT(index, i, i+1);
+        }
+        if ((i-1) < dqpsk_end) CalculatePipelineDQPSK(index, i-1, i);
     }
+    PROFILE_END(calculate_independent_symbols);
+    return phase_error;
+}
 
-    PROFILE_BEGIN(pipeline_signal_end);
-    thread_data.SignalEnd();
-    PROFILE_END(pipeline_signal_end);
+// Corrects, transforms and returns the phase error of one symbol of a fused pipeline
+// Clause 3.13.1 - Fraction frequency offset estimation
+// Clause 3.14.1 - Cyclic prefix removal
+// The PLL, cyclic prefix correlation and prefix removal read the symbol once into the aligned FFT input of the pipeline
+// NOTE: Fixed point symbols are quantised first so they use the separate steps
+float OFDM_Demod::CalculatePipelineFusedSymbol(const size_t index, const int symbol) {
+    PROFILE_BEGIN_FUNC();
+    const int symbol_end_no_null = (int)m_params.nb_frame_symbols;
+    if (m_precision == OFDM_Demod_Precision::INT16) {
+        CorrectPipelineSymbols(symbol, symbol+1);
+        const float phase_error = CalculatePipelinePhaseError(symbol, std::min(symbol+1, symbol_end_no_null));
+        CalculatePipelineFFT(index, symbol, symbol+1);
+        return phase_error;
+    }
+    if (!m_active_fft_mask[symbol]) return 0.0f;
+    ConvertPipelineSymbols(symbol, symbol+1);
 
-    return true;
+    // NOTE: We create a local copy of the frequency offset since it
+    //       can be changed in the reader thread due to coarse frequency correction
+    const float frequency_offset = m_freq_coarse_offset + m_freq_fine_offset;
+    auto sym_buf = m_active_buffer.GetDataSymbol(symbol);
+    const auto* view = m_active_symbol_views[size_t(symbol)];
+    auto src_buf = (view != nullptr) ? tcb::span<const std::complex<float>>(view, sym_buf.size()) : sym_buf;
+    const int sample_offset = symbol*(int)m_params.nb_symbol_period;
+    const float dt_start = float(sample_offset) * frequency_offset;
+    auto fft_in = tcb::span(m_fused_fft_input_data).subspan(index*m_params.nb_fft, m_params.nb_fft);
+    PROFILE_BEGIN(apply_pll_cyclic_prefix);
+    const auto error_vec = apply_pll_cyclic_prefix_auto(
+        src_buf, fft_in, m_params.nb_cyclic_prefix, frequency_offset, dt_start);
+    PROFILE_END(apply_pll_cyclic_prefix);
+
+    auto fft_out = m_pipeline_fft_buffer.subspan(GetPipelineFFTSlot(index, symbol)*m_params.nb_fft, m_params.nb_fft);
+    CalculateFFT(fft_in, fft_out);
+    CorrectPipelineSampleRate(index, symbol);
+    // Ignore null symbol
+    if (symbol >= symbol_end_no_null) return 0.0f;
+    return std::atan2(error_vec.imag(), error_vec.real());
+}
+
+// Index of the FFT of a symbol in m_pipeline_fft_buffer or m_pipeline_q15_fft_buffer
+size_t OFDM_Demod::GetPipelineFFTSlot(const size_t index, const int symbol) const {
+    if (!m_active_is_headless) return size_t(symbol);
+    const int symbol_start = int(m_pipelines[index]->GetSymbolStart());
+    const size_t slot_start = index*3;
+    if (symbol == symbol_start) return slot_start;
+    return slot_start + 1 + size_t(symbol-symbol_start-1) % 2;
+}
+
+// Called at the start of each frame before the pipelines run
+void OFDM_Demod::UpdatePipelineBuffers() {
+    StartSegments();
+    m_active_is_headless = m_is_headless.load(std::memory_order_relaxed);
+    m_active_is_fused_symbols = m_cfg.pipeline.is_fused_symbols;
+    m_active_is_signal_quality = m_cfg.signal_quality.is_enabled;
+    if (m_active_is_signal_quality && m_carrier_error_data.empty()) {
+        m_carrier_error_data.resize(m_pipelines.size()*m_params.nb_data_carriers, 0.0f);
+        m_pipeline_carrier_error = m_carrier_error_data;
+    }
+    const bool is_q15 = (m_precision == OFDM_Demod_Precision::INT16);
+    const size_t total_slots = m_active_is_headless ? m_pipelines.size()*3 : (m_params.nb_frame_symbols+1);
+    auto& fft_data = m_active_is_headless ? m_headless_fft_data : m_frame_fft_data;
+    auto& q15_fft_data = m_active_is_headless ? m_headless_q15_fft_data : m_frame_q15_fft_data;
+    if (is_q15) {
+        if (q15_fft_data.empty()) q15_fft_data.resize(total_slots*m_params.nb_fft, Complex_Q15{});
+        m_pipeline_q15_fft_buffer = q15_fft_data;
+        m_pipeline_fft_buffer = {};
+        return;
+    }
+    if (fft_data.empty()) fft_data.resize(total_slots*m_params.nb_fft, std::complex<float>(0.0f, 0.0f));
+    m_pipeline_fft_buffer = fft_data;
+    const size_t total_fused_input = m_active_is_fused_symbols ? m_pipelines.size()*m_params.nb_fft : 0;
+    if (m_fused_fft_input_data.size() < total_fused_input) {
+        m_fused_fft_input_data.resize(total_fused_input, std::complex<float>(0.0f, 0.0f));
+    }
+    m_pipeline_q15_fft_buffer = {};
 }
 
 float OFDM_Demod::CalculateCyclicPhaseError(tcb::span<const std::complex<float>> sym) {
@@ -776,6 +2069,16 @@ float OFDM_Demod::CalculateCyclicPhaseError(tcb::span<const std::complex<float>>
     return std::atan2(error_vec.imag(), error_vec.real());
 }
 
+float OFDM_Demod::CalculateCyclicPhaseError(tcb::span<const Complex_Q15> sym) {
+    PROFILE_BEGIN_FUNC();
+    const size_t N = m_params.nb_cyclic_prefix;
+    const size_t M = m_params.nb_fft;
+    auto x0 = sym.subspan(M, N);
+    auto x1 = sym.subspan(0, N);
+    auto error_vec = complex_conj_mul_sum_auto(x0, x1);
+    return std::atan2(error_vec.imag(), error_vec.real());
+}
+
 float OFDM_Demod::CalculateFineFrequencyError(const float cyclic_phase_error) {
     PROFILE_BEGIN_FUNC();
     // Clause 3.13.1 - Fraction frequency offset estimation
@@ -839,63 +2142,222 @@ void OFDM_Demod::UpdateFineFrequencyOffset(const float delta) {
     m_freq_fine_offset = std::fmod(m_freq_fine_offset, fft_bin_wrap);
 }
 
-void OFDM_Demod::CalculateDQPSK(
-    tcb::span<const std::complex<float>> in0, 
-    tcb::span<const std::complex<float>> in1, 
-    tcb::span<std::complex<float>> out_vec)
-{
-    PROFILE_BEGIN_FUNC();
-    const int M = (int)m_params.nb_data_carriers/2;
-    const int N_fft = (int)m_params.nb_fft;
+void OFDM_Demod_Snapshot::GetFrameDataVec(const size_t symbol_index, tcb::span<std::complex<float>> out_vec) const {
+    const size_t M = params.nb_data_carriers/2;
+    const size_t N_fft = params.nb_fft;
+    assert(symbol_index < (params.nb_frame_symbols-1));
+    assert(out_vec.size() == params.nb_data_carriers);
+    if (frame_fft.empty()) {
+        std::fill(out_vec.begin(), out_vec.end(), std::complex<float>(0.0f, 0.0f));
+        return;
+    }
+
+    auto in0 = tcb::span<const std::complex<float>>(frame_fft).subspan((symbol_index+0)*N_fft, N_fft);
+    auto in1 = tcb::span<const std::complex<float>>(frame_fft).subspan((symbol_index+1)*N_fft, N_fft);
 
     // Clause 3.14.3 - Zero padding removal
     // We store the subcarriers that carry information
-    for (int i = -M, subcarrier_index = 0; i <= M; i++) {
-        // The DC bin carries no information
-        if (i == 0) {
-            continue;
-        }
-        const int fft_index = (N_fft+i) % N_fft;
+    // The negative subcarriers [-M,-1] and positive subcarriers [1,M] are contiguous in the FFT
+    // The DC bin carries no information
+    // Clause 3.15 - Differential demodulator
+    // arg(z1*~z0) = arg(z1)+arg(~z0) = arg(z1)-arg(z0)
+    complex_conj_mul_auto(in1.subspan(N_fft-M, M), in0.subspan(N_fft-M, M), out_vec.subspan(0, M));
+    complex_conj_mul_auto(in1.subspan(1, M), in0.subspan(1, M), out_vec.subspan(M, M));
+}
+
+// Downsampling is done here so a view only draws a fixed number of points however large the buffers are
+static void UpdateSnapshotPlots(OFDM_Demod_Snapshot& snapshot, const OFDM_Demod_Tap_Config& config) {
+    auto& plots = snapshot.plots;
+    const size_t total_points = config.plot_points;
+    if (total_points == 0) {
+        plots = {};
+        return;
+    }
 
-        // arg(z1*~z0) = arg(z1)+arg(~z0) = arg(z1)-arg(z0)
-        const auto phase_delta_vec = in1[fft_index] * std::conj(in0[fft_index]);
-        out_vec[subcarrier_index] = phase_delta_vec;
-        subcarrier_index++;
+    downsample_lttb(snapshot.impulse_response, total_points, plots.impulse_response);
+    downsample_min_max(snapshot.coarse_frequency_response, total_points, plots.coarse_frequency_response);
+    downsample_lttb(snapshot.correlation_time_buffer, false, total_points, plots.correlation_time_real);
+    downsample_lttb(snapshot.correlation_time_buffer, true, total_points, plots.correlation_time_imag);
+
+    const auto& params = snapshot.params;
+    if (snapshot.frame_fft.empty()) {
+        plots.symbol_spectrums.clear();
+        plots.constellation = {};
+        return;
+    }
+
+    const size_t N = params.nb_fft;
+    auto frame_fft = tcb::span<const std::complex<float>>(snapshot.frame_fft);
+    plots.symbol_spectrums.resize(params.nb_frame_symbols+1);
+    for (size_t i = 0; i < plots.symbol_spectrums.size(); i++) {
+        downsample_magnitude_spectrum(frame_fft.subspan(i*N, N), total_points, plots.symbol_spectrums[i]);
+    }
+
+    // the grid is sized by the average amplitude of the symbols that were demodulated
+    const size_t total_dqpsk_symbols = params.nb_frame_symbols-1;
+    auto data_vec = std::vector<std::complex<float>>(params.nb_data_carriers);
+    float amplitude_sum = 0.0f;
+    size_t total_amplitudes = 0;
+    for (size_t i = 0; i < total_dqpsk_symbols; i++) {
+        snapshot.GetFrameDataVec(i, data_vec);
+        for (const auto& x: data_vec) {
+            if (x == std::complex<float>(0.0f, 0.0f)) continue;
+            amplitude_sum += std::abs(x);
+            total_amplitudes++;
+        }
+    }
+    const float amplitude = (total_amplitudes > 0) ? (amplitude_sum/float(total_amplitudes)) : 0.0f;
+    reset_plot_density(config.plot_density_size, amplitude, plots.constellation);
+    for (size_t i = 0; i < total_dqpsk_symbols; i++) {
+        snapshot.GetFrameDataVec(i, data_vec);
+        accumulate_plot_density(data_vec, plots.constellation);
     }
 }
 
-void OFDM_Demod::CalculateViterbiBits(tcb::span<const std::complex<float>> vec_buf, tcb::span<viterbi_bit_t> bit_buf) {
-    PROFILE_BEGIN_FUNC();
-    const size_t N = m_params.nb_data_carriers;
+void OFDM_Demod::SetTap(const std::optional<OFDM_Demod_Tap_Config>& config) {
+    auto lock = std::scoped_lock(m_mutex_tap);
+    m_tap_config = config;
+    m_is_tap_active.store(config.has_value(), std::memory_order_relaxed);
+}
 
-    // Clause 3.16 - Data demapper
-    for (size_t i = 0; i < N; i++) {
-        // Clause 3.16.1 - Freuency deinterleaving
-        const size_t j = m_carrier_mapper[i];
-        const auto& vec = vec_buf[j];
+std::shared_ptr<const OFDM_Demod_Snapshot> OFDM_Demod::GetTapSnapshot() const {
+    auto lock = std::scoped_lock(m_mutex_tap);
+    return m_tap_front;
+}
+
+static size_t get_snapshot_memory_bytes(const std::shared_ptr<OFDM_Demod_Snapshot>& snapshot) {
+    if (snapshot == nullptr) return 0;
+    return 
+        sizeof(OFDM_Demod_Snapshot) +
+        get_memory_bytes(snapshot->impulse_response) + 
+        get_memory_bytes(snapshot->coarse_frequency_response) +
+        get_memory_bytes(snapshot->correlation_time_buffer) +
+        get_memory_bytes(snapshot->frame_fft) +
+        get_memory_bytes(snapshot->frame_bits) +
+        get_memory_bytes(snapshot->plots.symbol_spectrums);
+}
+
+Memory_Usage OFDM_Demod::GetMemoryUsage() const {
+    Memory_Usage usage("ofdm_demod", sizeof(OFDM_Demod));
+    // synchronisation buffers, double buffered frames and soft bits
+    usage.AddChild("joint_block", get_memory_bytes(m_joint_data_block));
+    {
+        size_t ingest_bytes = get_memory_bytes(m_ingest_data_block) + get_memory_bytes(m_ingest_frames);
+        for (const auto& frame: m_ingest_frames) ingest_bytes += get_memory_bytes(frame.symbol_views);
+        usage.AddChild("ingest_frames", ingest_bytes);
+    }
+    usage.AddChild("frame_fft",
+        get_memory_bytes(m_frame_fft_data) + get_memory_bytes(m_headless_fft_data) +
+        get_memory_bytes(m_frame_q15_fft_data) + get_memory_bytes(m_headless_q15_fft_data) +
+        get_memory_bytes(m_fused_fft_input_data));
+    if (!m_carrier_error_data.empty()) {
+        usage.AddChild("signal_quality", get_memory_bytes(m_carrier_error_data));
+    }
+    usage.AddChild("symbol_masks",
+        get_memory_bytes(m_null_l1_window) +
+        get_memory_bytes(m_inactive_symbol_views) + get_memory_bytes(m_active_symbol_views) +
+        get_memory_bytes(m_desired_symbol_mask) + get_memory_bytes(m_active_symbol_mask) + get_memory_bytes(m_active_fft_mask));
+    {
+        auto& fft_plans = usage.AddChild("fft_plans");
+        if (m_fft_plan) fft_plans.AddChild("fft", m_fft_plan->GetMemoryBytes());
+        if (m_ifft_plan) fft_plans.AddChild("ifft", m_ifft_plan->GetMemoryBytes());
+        if (m_fft_q15_plan) fft_plans.AddChild("fft_q15", m_fft_q15_plan->GetMemoryBytes());
+    }
+    usage.AddChild("pipelines", m_pipelines.size()*sizeof(OFDM_Demod_Pipeline));
+    if (m_frame_ring) {
+        usage.AddChild("frame_ring", m_frame_ring->get_memory_bytes());
+    }
+    {
+        auto lock = std::scoped_lock(m_mutex_tap);
+        const size_t tap_bytes = get_snapshot_memory_bytes(m_tap_front) + get_snapshot_memory_bytes(m_tap_back);
+        if (tap_bytes > 0) usage.AddChild("tap_snapshots", tap_bytes);
+    }
+    return usage;
+}
 
-        // const float A = std::abs(vec);
-        // NOTE: Use the L1 norm since it doesn't truncate like L2 norm
-        //       I.e. When real=imag, then we expect b0=A, b1=A
-        //            But with L2 norm, we get b0=0.707*A, b1=0.707*A
-        //                with L1 norm, we get b0=A, b1=A as expected
-        const float A = std::max(std::abs(vec.real()), std::abs(vec.imag()));
-        const auto norm_vec = vec / A;
+// Called by the reader thread which is the only writer of the status
+void OFDM_Demod::PublishStatus() {
+    Status status;
+    status.state = m_state;
+    status.signal_l1_average = m_signal_l1_average;
+    status.coarse_freq_offset = m_freq_coarse_offset;
+    {
+        auto lock = std::scoped_lock(m_mutex_freq_fine_offset);
+        status.fine_freq_offset = m_freq_fine_offset;
+    }
+    status.is_coarse_freq_locked = m_is_coarse_freq_locked;
+    status.fine_time_offset = m_fine_time_offset;
+    status.sample_rate_offset = m_sample_rate_offset;
+    status.total_frames_read = m_total_frames_read.load(std::memory_order_relaxed);
+    status.total_frames_desync = m_total_frames_desync;
+    status.total_frames_tracked = m_total_frames_tracked;
+    status.total_frames_overrun = m_total_frames_overrun;
+    status.total_frames_queued = int(m_ingest_total_queued);
+    status.total_idle_probes = m_total_idle_probes;
+    status.total_idle_wakeups = m_total_idle_wakeups;
+    m_status.store(status);
+}
 
-        // Clause 3.16.2 - QPSK symbol demapper
-        bit_buf[i]   = convert_to_viterbi_bit(+norm_vec.real());
-        bit_buf[i+N] = convert_to_viterbi_bit(-norm_vec.imag());
+// Called by the reader thread while no pipeline is running
+void OFDM_Demod::UpdateTap() {
+    PROFILE_BEGIN_FUNC();
+    OFDM_Demod_Tap_Config config;
+    {
+        auto lock = std::scoped_lock(m_mutex_tap);
+        if (!m_tap_config.has_value()) return;
+        config = m_tap_config.value();
+    }
+    const auto time_now = std::chrono::steady_clock::now();
+    const float elapsed_seconds = std::chrono::duration<float>(time_now - m_tap_last_time).count();
+    if ((m_tap_front != nullptr) && (elapsed_seconds < config.min_period_seconds)) return;
+    m_tap_last_time = time_now;
+
+    // A view can still hold the previous snapshot so it is only overwritten if we are the last owner
+    if ((m_tap_back == nullptr) || (m_tap_back.use_count() != 1)) {
+        m_tap_back = std::make_shared<OFDM_Demod_Snapshot>();
+    }
+    auto& snapshot = *m_tap_back;
+    snapshot.params = m_params;
+    snapshot.precision = m_precision;
+    snapshot.frame_index = m_total_frames_read.load(std::memory_order_relaxed);
+    snapshot.coarse_freq_offset = m_freq_coarse_offset;
+    snapshot.fine_freq_offset = m_freq_fine_offset;
+    snapshot.fine_time_offset = m_fine_time_offset;
+    snapshot.impulse_response.assign(m_correlation_impulse_response.begin(), m_correlation_impulse_response.end());
+    snapshot.coarse_frequency_response.assign(m_correlation_frequency_response.begin(), m_correlation_frequency_response.end());
+    snapshot.correlation_time_buffer.assign(m_correlation_time_buffer.begin(), m_correlation_time_buffer.end());
+    snapshot.frame_bits.assign(m_pipeline_out_bits.begin(), m_pipeline_out_bits.end());
+    // the plots are calculated from the FFTs of the snapshot even if the view doesn't want them
+    const bool is_plots = (config.plot_points > 0);
+    snapshot.frame_fft.clear();
+    if ((config.is_frame_fft || is_plots) && !m_active_is_headless) {
+        if (m_precision == OFDM_Demod_Precision::INT16) {
+            snapshot.frame_fft.resize(m_frame_q15_fft_data.size());
+            for (size_t i = 0; i < m_frame_q15_fft_data.size(); i++) {
+                const auto& x = m_frame_q15_fft_data[i];
+                snapshot.frame_fft[i] = std::complex<float>(float(x.re), float(x.im));
+            }
+        } else {
+            snapshot.frame_fft.assign(m_frame_fft_data.begin(), m_frame_fft_data.end());
+        }
+    }
+    UpdateSnapshotPlots(snapshot, config);
+    if (!config.is_frame_fft) {
+        snapshot.frame_fft.clear();
     }
+
+    auto lock = std::scoped_lock(m_mutex_tap);
+    std::swap(m_tap_front, m_tap_back);
 }
 
 void OFDM_Demod::CalculateFFT(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> fft_out) {
     PROFILE_BEGIN_FUNC();
-    fftwf_execute_dft(m_fft_plan, (fftwf_complex*)fft_in.data(), (fftwf_complex*)fft_out.data());
+    m_fft_plan->Execute(fft_in, fft_out);
 }
 
 void OFDM_Demod::CalculateIFFT(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> fft_out) {
     PROFILE_BEGIN_FUNC();
-    fftwf_execute_dft(m_ifft_plan, (fftwf_complex*)fft_in.data(), (fftwf_complex*)fft_out.data());
+    m_ifft_plan->Execute(fft_in, fft_out);
 }
 
 void OFDM_Demod::CalculateRelativePhase(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> arg_out) {
@@ -908,30 +2370,124 @@ void OFDM_Demod::CalculateRelativePhase(tcb::span<const std::complex<float>> fft
     arg_out[N-1] = {0,0};
 }
 
-void OFDM_Demod::CalculateMagnitude(tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf) {
+// Magnitude spectrum in dB of the carrier offsets [min_index,max_index] where a zero offset is at nb_fft/2
+void OFDM_Demod::CalculateMagnitude(
+    tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf, const int min_index, const int max_index)
+{
     PROFILE_BEGIN_FUNC();
-    const size_t N = m_params.nb_fft;
-    const size_t M = N/2;
-    for (size_t i = 0; i < N; i++) {
-        const size_t j = (i+M) % N;
+    const int N = int(m_params.nb_fft);
+    const int M = N/2;
+    assert((min_index >= -M) && (max_index < M));
+    for (int i = min_index; i <= max_index; i++) {
+        const size_t j = size_t((i+N) % N);
         const float x = 20.0f*std::log10(std::abs(fft_buf[j]));
-        mag_buf[i] = x;
+        mag_buf[size_t(i+M)] = x;
+    }
+}
+
+// Correlation of the relative phase with the reference for a range of carrier offsets
+// NOTE: This is the direct form of steps 3 to 6 which is cheaper when only a few offsets are needed
+void OFDM_Demod::CalculateCoarseFrequencyResponse(
+    tcb::span<const std::complex<float>> phase_buf, const int min_index, const int max_index)
+{
+    PROFILE_BEGIN_FUNC();
+    const int N = int(m_params.nb_fft);
+    const int M = N/2;
+    for (int i = min_index; i <= max_index; i++) {
+        const int fft_index = i+M;
+        if (fft_index == N) continue;
+        // circular shift of the received relative phase by the carrier offset
+        const size_t offset = size_t((i+N) % N);
+        const size_t length = size_t(N)-offset;
+        auto reference = tcb::span<const std::complex<float>>(m_correlation_prs_phase_reference);
+        auto sum = complex_conj_mul_sum_auto(phase_buf.subspan(offset, length), reference.first(length));
+        sum += complex_conj_mul_sum_auto(phase_buf.first(offset), reference.subspan(length));
+        // scale to match the unnormalised forward and inverse FFTs of the full search
+        sum *= float(N);
+        m_correlation_frequency_response[fft_index] = 20.0f*std::log10(std::abs(sum));
     }
 }
 
 float OFDM_Demod::CalculateL1Average(tcb::span<const std::complex<float>> block) {
     PROFILE_BEGIN_FUNC();
-    const size_t N = block.size();
-    float l1_avg = 0.0f;
-    for (size_t i = 0; i < N; i++) {
-        auto& v = block[i];
-        l1_avg += std::abs(v.real()) + std::abs(v.imag());
+    float l1_sum = 0.0f;
+    l1_norm_decimate_auto(block, {&l1_sum, 1});
+    return l1_sum / (float)block.size();
+}
+
+float OFDM_Demod::CalculateL1Average(tcb::span<const RawIQ_u8> block) {
+    PROFILE_BEGIN_FUNC();
+    float l1_sum = 0.0f;
+    CalculateL1Sums(block, {&l1_sum, 1});
+    return l1_sum / (float)block.size();
+}
+
+void OFDM_Demod::CalculateL1Sums(tcb::span<const std::complex<float>> x, tcb::span<float> y) {
+    l1_norm_decimate_auto(x, y);
+}
+
+// NOTE: The IQ correction is ignored since this is only compared against itself
+void OFDM_Demod::CalculateL1Sums(tcb::span<const RawIQ_u8> x, tcb::span<float> y) {
+    const auto* raw = reinterpret_cast<const uint8_t*>(x.data());
+    const size_t nb_bytes = 2*x.size();
+    if (m_input_format == Input_Format::RAW_S8) {
+        const auto* raw_s8 = reinterpret_cast<const int8_t*>(raw);
+        l1_norm_decimate_auto(tcb::span<const int8_t>{ raw_s8, nb_bytes }, y, m_cfg.raw_iq.bias_s8);
+    } else {
+        l1_norm_decimate_auto(tcb::span<const uint8_t>{ raw, nb_bytes }, y, m_cfg.raw_iq.bias_u8);
     }
-    l1_avg /= (float)N;
-    return l1_avg;
 }
 
-void OFDM_Demod::UpdateSignalAverage(tcb::span<const std::complex<float>> block) {
+void OFDM_Demod::ResetCoarseFreqLock() {
+    m_is_coarse_freq_locked = false;
+    m_coarse_freq_peak_index = 0;
+    m_total_coarse_freq_stable_frames = 0;
+    m_total_coarse_freq_frames_since_check = 0;
+}
+
+void OFDM_Demod::ResetNullL1Window() {
+    std::fill(m_null_l1_window.begin(), m_null_l1_window.end(), 0.0f);
+    m_null_l1_window_index = 0;
+    m_null_l1_window_length = 0;
+    m_null_l1_window_sum = 0.0f;
+    m_null_l1_block_sum = 0.0f;
+    m_null_l1_block_length = 0;
+}
+
+// Returns true once the end of the null power dip is found
+bool OFDM_Demod::UpdateNullL1Window(const float block_sum) {
+    const size_t W = m_null_l1_window.size();
+    m_null_l1_window_sum += block_sum - m_null_l1_window[m_null_l1_window_index];
+    m_null_l1_window[m_null_l1_window_index] = block_sum;
+    m_null_l1_window_index++;
+    if (m_null_l1_window_index == W) {
+        m_null_l1_window_index = 0;
+        // Recalculate the sum once per window so rounding errors don't accumulate
+        m_null_l1_window_sum = std::accumulate(m_null_l1_window.begin(), m_null_l1_window.end(), 0.0f);
+    }
+
+    // Wait until the window is filled
+    if (m_null_l1_window_length < W) {
+        m_null_l1_window_length++;
+        if (m_null_l1_window_length < W) return false;
+    }
+
+    const size_t D = (size_t)std::max(m_cfg.null_l1_search.nb_decimate, 1);
+    const float l1_avg = m_null_l1_window_sum / (float)(W*D);
+    if (m_is_null_start_found) {
+        if (l1_avg > m_signal_l1_average * m_cfg.null_l1_search.thresh_null_end) {
+            m_is_null_end_found = true;
+        }
+    } else {
+        if (l1_avg < m_signal_l1_average * m_cfg.null_l1_search.thresh_null_start) {
+            m_is_null_start_found = true;
+        }
+    }
+    return m_is_null_end_found;
+}
+
+template <typename T>
+void OFDM_Demod::UpdateSignalAverage(tcb::span<const T> block) {
     PROFILE_BEGIN_FUNC();
     const size_t N = block.size();
     const size_t K = (size_t)m_cfg.signal_l1.nb_samples;
@@ -948,3 +2504,15 @@ void OFDM_Demod::UpdateSignalAverage(tcb::span<const std::complex<float>> block)
             (1.0f-beta)*l1_avg;
     }
 }
+
+void OFDM_Demod::ConvertRawIQ(tcb::span<const RawIQ_u8> src, tcb::span<std::complex<float>> dest, const Input_Format format) {
+    PROFILE_BEGIN_FUNC();
+    const auto* raw_buf = reinterpret_cast<const uint8_t*>(src.data());
+    const size_t nb_bytes = src.size()*sizeof(RawIQ_u8);
+    if (format == Input_Format::RAW_S8) {
+        const auto* signed_buf = reinterpret_cast<const int8_t*>(raw_buf);
+        convert_raw_iq_auto({ signed_buf, nb_bytes }, dest, m_cfg.raw_iq.bias_s8, m_cfg.raw_iq.correction);
+    } else {
+        convert_raw_iq_auto({ raw_buf, nb_bytes }, dest, m_cfg.raw_iq.bias_u8, m_cfg.raw_iq.correction);
+    }
+}
@@ -2,24 +2,36 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <complex>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <vector>
 #include "utility/aligned_allocator.hpp"
+#include "utility/memory_usage.h"
 #include "utility/observable.h"
+#include "utility/page_allocator.h"
+#include "utility/seqlock.h"
 #include "utility/span.h"
+#include "utility/spsc_frame_ring.h"
 #include "viterbi_config.h"
 #include "./circular_buffer.h"
+#include "./dsp/convert_raw_iq.h"
+#include "./dsp/quantise_q15.h"
+#include "./ofdm_demodulator_threads.h"
 #include "./ofdm_frame_buffer.h"
 #include "./ofdm_params.h"
+#include "./plot_downsample.h"
 #include "./reconstruction_buffer.h"
 
-struct fftwf_plan_s;
+class FFT_Plan;
+class FFT_Q15_Plan;
+struct OFDM_Demod_References;
 
-class OFDM_Demod_Pipeline;
-class OFDM_Demod_Coordinator;
 
 struct OFDM_Demod_Config {
     struct {
@@ -30,6 +42,8 @@ struct OFDM_Demod_Config {
     struct {
         float thresh_null_start = 0.35f;
         float thresh_null_end = 0.75f;
+        // moving window of signal_l1.nb_samples is advanced every nb_decimate samples
+        int nb_decimate = 8;
     } null_l1_search;
     struct {
         // fine freq sync
@@ -38,10 +52,157 @@ struct OFDM_Demod_Config {
         bool is_coarse_freq_correction = true;
         float max_coarse_freq_correction_norm = 0.5f; // normalised to sampling frequency
         float coarse_freq_slow_beta = 0.1f;
+        // after this many frames without a large correction only the bins next to the peak are checked
+        int coarse_freq_lock_frames = 8; // 0 to always do the full search
+        int coarse_freq_locked_check_interval = 4; // frames between checks once locked
         // fine time sync
         float impulse_peak_threshold_db = 20.0f;
         float impulse_peak_distance_probability = 0.15f;
+        // frame tracking once a frame was synchronised since the next PRS is expected one frame later
+        // if its impulse peak is too weak the peak is searched for in a narrow window around the predicted start
+        // with a lower threshold, otherwise the predicted start is kept as is
+        // the null power dip search is only restarted after max_tracking_misses frames in a row without a peak
+        int max_tracking_misses = 3; // 0 to always restart the search
+        int tracking_window = 32; // samples either side of the predicted peak
+        float tracking_peak_threshold_db = 14.0f;
+        // sample rate offset of the receiver's clock from the drift of the PRS between frames
+        // the drift is the fine time offset plus the change in the phase slope across the carriers of the PRS
+        // each symbol is then rotated by the phase slope of its predicted drift within the frame
+        // NOTE: Only FLOAT32 precision compensates the symbols but both use it to predict tracked frames
+        bool is_sample_rate_correction = true;
+        float sample_rate_update_beta = 0.1f;
+        float max_sample_rate_offset = 200e-6f; // normalised to sampling frequency
     } sync;
+    // number of pipeline threads working on each frame
+    struct {
+        // threads are added or removed at frame boundaries so a frame is demodulated
+        // in about target_utilisation of its duration with the fewest threads
+        // NOTE: The threads created at construction are the upper limit
+        bool is_adaptive = false;
+        float target_utilisation = 0.5f;
+        float utilisation_beta = 0.8f;
+        int min_frames_between_changes = 8;
+        // each symbol is corrected, transformed and demapped before the next one so it stays in cache
+        // otherwise each step is done over all the symbols of the pipeline so the FFTs can be batched
+        // NOTE: This is applied from the next frame
+        bool is_fused_symbols = false;
+    } pipeline;
+    // decision error of each carrier which is summed by the DQPSK demapper while demapping
+    // NOTE: This is applied from the next frame
+    struct {
+        bool is_enabled = true;
+    } signal_quality;
+    // sparse probing of an empty block after too long without a demodulated frame
+    // only a short probe of every interval is measured and the rest of the samples are skipped
+    // within a probe the L1 average of every probe_decimate'th window of signal_l1.nb_samples is measured
+    // full acquisition resumes if a window dips below null_l1_search.thresh_null_start of the probe's average
+    // or the probe's average rises above level_rise times the lowest level measured while idle
+    // NOTE: Durations are in frames of the transmission mode, e.g. 0.1 frames is 9.6ms for mode I
+    //       The pipeline threads stay asleep since no frames are read
+    struct {
+        bool is_enabled = false;
+        int idle_after_frames = 100;
+        int probe_interval_frames = 10;
+        float probe_frames = 0.1f;
+        int probe_decimate = 4;
+        float level_rise = 2.0f;
+    } idle;
+    // conversion of 8bit samples to floats
+    struct {
+        float bias_u8 = 127.5f;
+        float bias_s8 = 0.0f;
+        Raw_IQ_Correction correction;
+    } raw_iq;
+};
+
+// Signal quality of the last frame from the decision error of the DQPSK demapper (see dqpsk_demapper_auto)
+// MER is the power of the ideal point over the mean error power of every demapped carrier
+// The SNR of each carrier is taken over the symbols of the frame and counted into bins of SNR_BIN_WIDTH_DB
+// NOTE: The error is measured after normalising by the largest component so noise alone is about 7.8dB
+struct OFDM_Demod_Signal_Quality {
+    static constexpr size_t TOTAL_SNR_BINS = 16;
+    static constexpr float SNR_BIN_WIDTH_DB = 2.0f;
+    static constexpr float MAX_DB = 60.0f;
+    float mer_db = 0.0f;
+    // bin i counts carriers in [i,i+1)*SNR_BIN_WIDTH_DB and the last bin includes everything above it
+    std::array<uint16_t, TOTAL_SNR_BINS> carrier_snr_histogram{};
+    int total_symbols = 0;
+    int total_frames = 0;
+};
+
+// Synchronisation of a previously received signal used to restart from when returning to it
+struct OFDM_Demod_Acquisition {
+    float coarse_freq_offset = 0.0f;
+    float fine_freq_offset = 0.0f;
+    float signal_l1_average = 0.0f;
+};
+
+// Time taken by each phase of constructing the demodulator
+// NOTE: FFT plans and references are shared by demodulators of the same size so only the first one builds them
+//       Demodulators can be constructed on separate threads since the shared caches are locked
+struct OFDM_Demod_Startup_Times {
+    float allocate_seconds = 0.0f;
+    float fft_plans_seconds = 0.0f;
+    float references_seconds = 0.0f;
+    float threads_seconds = 0.0f;
+    float GetTotalSeconds() const { return allocate_seconds + fft_plans_seconds + references_seconds + threads_seconds; }
+};
+
+// Arithmetic used by the pipelines to correct, transform and demap the data symbols
+// FLOAT32: Single precision floats throughout
+// INT16:   Symbols are quantised to 16bit fixed point after the PRS for targets without fast floats
+//          Synchronisation is still done in floats since it only runs on a few symbols per frame
+enum class OFDM_Demod_Precision {
+    FLOAT32,
+    INT16,
+};
+
+// What a debug view wants copied out of the demodulator (see OFDM_Demod::SetTap)
+struct OFDM_Demod_Tap_Config {
+    // snapshots are taken at most this often
+    float min_period_seconds = 0.1f;
+    // the FFT of every symbol is the largest part of a snapshot so views that don't need it can leave it out
+    bool is_frame_fft = true;
+    // the plots of a snapshot have about this many points so views don't draw every sample, 0 leaves them empty
+    size_t plot_points = 0;
+    // cells along each axis of the constellation density
+    size_t plot_density_size = 64;
+};
+
+// Copy of the internal buffers of the demodulator which a debug view can read while the demodulator keeps running
+// NOTE: The synchronisation buffers are from the NULL and PRS of the frame after the demodulated one
+//       since that frame is synchronised while the previous one is demodulated
+struct OFDM_Demod_Snapshot {
+    OFDM_Params params;
+    OFDM_Demod_Precision precision = OFDM_Demod_Precision::FLOAT32;
+    // total frames read when the snapshot was taken
+    int frame_index = 0;
+    float coarse_freq_offset = 0.0f;
+    float fine_freq_offset = 0.0f;
+    int fine_time_offset = 0;
+    std::vector<float> impulse_response;
+    // magnitude spectrum in dB where a zero frequency error is at nb_fft/2
+    // NOTE: Once the coarse frequency is locked only the bins next to the peak are updated
+    std::vector<float> coarse_frequency_response;
+    std::vector<std::complex<float>> correlation_time_buffer;
+    // FFT of every symbol including the null symbol, empty if headless or not requested
+    // NOTE: The fixed point FFTs are converted without their exponents so only their phase is meaningful
+    std::vector<std::complex<float>> frame_fft;
+    std::vector<viterbi_bit_t> frame_bits;
+    // Differential demodulated vectors of a data symbol in subcarrier order before frequency deinterleaving
+    // NOTE: These are calculated from frame_fft on request and are zero if it is empty
+    void GetFrameDataVec(const size_t symbol_index, tcb::span<std::complex<float>> out_vec) const;
+    // Downsampled by the reader thread if the tap has plot points
+    struct {
+        // magnitude spectrum in dB of every symbol with the null symbol last, empty if headless
+        std::vector<Plot_Envelope> symbol_spectrums;
+        Plot_Line impulse_response;
+        Plot_Envelope coarse_frequency_response;
+        Plot_Line correlation_time_real;
+        Plot_Line correlation_time_imag;
+        // differential demodulated vectors of every data symbol, empty if headless
+        Plot_Density constellation;
+    } plots;
 };
 
 class OFDM_Demod 
@@ -53,64 +214,241 @@ public:
         RUNNING_COARSE_FREQ_SYNC,
         RUNNING_FINE_TIME_SYNC,
         READING_SYMBOLS,
+        IDLE_PROBING,
+    };
+    // Synchronisation and statistics that any thread can read without racing the reader thread
+    struct Status {
+        State state = State::FINDING_NULL_POWER_DIP;
+        float signal_l1_average = 0.0f;
+        float coarse_freq_offset = 0.0f;
+        float fine_freq_offset = 0.0f;
+        bool is_coarse_freq_locked = false;
+        int fine_time_offset = 0;
+        float sample_rate_offset = 0.0f;
+        int total_frames_read = 0;
+        int total_frames_desync = 0;
+        int total_frames_tracked = 0;
+        int total_frames_overrun = 0;
+        int total_frames_queued = 0;
+        int total_idle_probes = 0;
+        int total_idle_wakeups = 0;
     };
 private:
+    enum class Input_Format {
+        C32, RAW_U8, RAW_S8,
+    };
+    // frame that was read while the pipelines were busy along with the state it is demodulated with
+    // NOTE: Entries which aren't queued hold free buffers which are swapped with the frame being read
+    struct Ingest_Frame {
+        tcb::span<uint8_t> buffer_data;
+        tcb::span<uint8_t> raw_buffer_data;
+        std::vector<const std::complex<float>*> symbol_views;
+        Input_Format format = Input_Format::C32;
+        size_t raw_start = 0;
+        float q15_scale = 1.0f;
+        float sample_rate_offset = 0.0f;
+        uint64_t capture_time = 0;
+    };
     OFDM_Demod_Config m_cfg;
     State m_state;
     const OFDM_Params m_params;
+    const OFDM_Demod_Precision m_precision;
     // statistics
-    int m_total_frames_read;
+    // incremented by the coordinator thread
+    std::atomic<int> m_total_frames_read;
     int m_total_frames_desync;
+    // frames whose impulse peak was too weak that were kept in sync by frame tracking
+    int m_total_frames_tracked;
+    // frames skipped because every ingest frame was in use
+    int m_total_frames_overrun;
+    // published by the reader thread after each block of samples
+    Seqlock<Status> m_status;
     // time and frequency correction
     std::mutex m_mutex_freq_fine_offset;
     bool m_is_found_coarse_freq_offset;
     float m_freq_coarse_offset;
+    bool m_is_coarse_freq_locked;
+    int m_coarse_freq_peak_index;
+    int m_total_coarse_freq_stable_frames;
+    int m_total_coarse_freq_frames_since_check;
     float m_freq_fine_offset;
     int m_fine_time_offset;
+    // the PRS of the next frame directly follows the frame being read
+    bool m_is_frame_tracking;
+    int m_total_tracking_misses;
+    // normalised sample rate offset and the fractional start of the next PRS relative to its predicted start
+    float m_sample_rate_offset;
+    float m_sample_rate_residual;
+    bool m_is_sample_rate_residual;
+    // restarting synchronisation from an earlier acquisition
+    std::mutex m_mutex_acquisition_seed;
+    std::optional<OFDM_Demod_Acquisition> m_desired_acquisition_seed;
+    std::atomic<bool> m_is_acquisition_seed_changed;
+    std::optional<OFDM_Demod_Acquisition> m_acquisition_seed;
+    int m_reset_total_frames_read;
     // null power dip search
     bool m_is_null_start_found;
     bool m_is_null_end_found;
     float m_signal_l1_average;
+    // moving L1 sum over blocks of samples for the null power dip search
+    std::vector<float> m_null_l1_window;
+    size_t m_null_l1_window_index;
+    size_t m_null_l1_window_length;
+    float m_null_l1_window_sum;
+    float m_null_l1_block_sum;
+    size_t m_null_l1_block_length;
+    // sparse probing while there is no signal (see OFDM_Demod_Config::idle)
+    int m_idle_last_frames_read;
+    size_t m_idle_unsynced_samples;
+    size_t m_idle_probe_offset;
+    float m_idle_reference_l1;
+    float m_idle_probe_l1_sum;
+    float m_idle_probe_l1_min;
+    int m_idle_probe_windows;
+    int m_total_idle_probes;
+    int m_total_idle_wakeups;
+    // 8bit samples are stored as is and converted by the pipeline threads
+    Input_Format m_input_format;
+    Input_Format m_active_format;
+    // number of samples at the start of the frame that were read as floats
+    size_t m_inactive_raw_start;
+    size_t m_active_raw_start;
+    // symbols read without copying are referenced in the caller's samples (nullptr if copied)
+    bool m_is_zero_copy_block;
+    std::vector<const std::complex<float>*> m_inactive_symbol_views;
+    std::vector<const std::complex<float>*> m_active_symbol_views;
     // fft
-    fftwf_plan_s* m_fft_plan;
-    fftwf_plan_s* m_ifft_plan;
+    std::shared_ptr<FFT_Plan> m_fft_plan;
+    std::shared_ptr<FFT_Plan> m_ifft_plan;
+    std::unique_ptr<FFT_Q15_Plan> m_fft_q15_plan;
+    // scale from samples to fixed point for the frame being demodulated
+    float m_active_q15_scale;
+    // sample rate offset the frame being demodulated is compensated with
+    float m_active_sample_rate_offset;
+    // capture time of the block being read and of the block that completed the frame being demodulated
+    // see "utility/latency_trace.h"
+    uint64_t m_reader_capture_time;
+    uint64_t m_active_capture_time;
     // threads
     std::unique_ptr<OFDM_Demod_Coordinator> m_coordinator;
     std::vector<std::unique_ptr<OFDM_Demod_Pipeline>> m_pipelines;
     std::unique_ptr<std::thread> m_coordinator_thread;
     std::vector<std::unique_ptr<std::thread>> m_pipeline_threads;
+    const OFDM_Demod_Thread_Config m_thread_config;
+    std::thread::id m_reader_thread_id;
+    std::atomic<int> m_total_thread_config_errors;
+    std::atomic<uint64_t> m_total_thread_cpu_time_ns;
+    OFDM_Demod_Startup_Times m_startup_times;
+    // pipelines after the first m_total_active_pipelines are idle
+    std::atomic<int> m_total_active_pipelines;
+    std::atomic<float> m_pipeline_utilisation;
+    int m_total_frames_since_pipeline_change;
+    // pipelines run as jobs on an external scheduler instead of our own threads (nullptr if unused)
+    std::shared_ptr<OFDM_Demod_Executor> m_executor;
+    // the single pipeline is run as a job by the thread calling Process() (see OFDM_Demod_Sync_Mode::INLINE)
+    bool m_is_inline;
+    // jobs that have to compute their FFTs before the last DQPSK symbol of each pipeline
+    std::unique_ptr<std::atomic<int>[]> m_job_total_waiting_fft;
+    std::atomic<int> m_job_total_remaining;
+    std::chrono::steady_clock::time_point m_job_time_start;
+    // data symbols after the PRS that are demodulated in each frame (non zero if used)
+    std::mutex m_mutex_symbol_mask;
+    std::vector<uint8_t> m_desired_symbol_mask;
+    std::atomic<bool> m_is_symbol_mask_changed;
+    // copy of the mask for the frame being demodulated along with the symbols that need an FFT
+    std::vector<uint8_t> m_active_symbol_mask;
+    std::vector<uint8_t> m_active_fft_mask;
+    size_t m_active_total_fft_symbols;
     // callback for when ofdm is completed
     Observable<tcb::span<const viterbi_bit_t>> m_obs_on_ofdm_frame;
+    Observable<float> m_obs_on_frame_time;
+    // segments of the frame published as soon as all of their data symbols are demapped (empty if disabled)
+    // the pipeline that demaps the last symbol of a segment publishes it along with any segments after it that are done
+    std::vector<size_t> m_segment_ends;
+    std::vector<size_t> m_symbol_segments;
+    std::unique_ptr<std::atomic<int>[]> m_segment_remaining;
+    std::mutex m_mutex_segments;
+    size_t m_total_segments_published;
+    Observable<size_t, tcb::span<const viterbi_bit_t>> m_obs_on_ofdm_segment;
+    // optional lock free handoff of frames to a consumer on another thread
+    std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> m_frame_ring;
+    bool m_is_frame_ring_blocking;
+    // snapshots for debug views which are double buffered so the back one is reused if no view holds it
+    mutable std::mutex m_mutex_tap;
+    std::optional<OFDM_Demod_Tap_Config> m_tap_config;
+    std::atomic<bool> m_is_tap_active;
+    std::chrono::steady_clock::time_point m_tap_last_time;
+    std::shared_ptr<OFDM_Demod_Snapshot> m_tap_front;
+    std::shared_ptr<OFDM_Demod_Snapshot> m_tap_back;
     // Joint memory allocation block
-    std::vector<uint8_t, AlignedAllocator<uint8_t>> m_joint_data_block;
+    std::vector<uint8_t, PageAllocator<uint8_t>> m_joint_data_block;
     // 1. pipeline reader double buffer
     OFDM_Frame_Buffer<std::complex<float>> m_active_buffer;
     OFDM_Frame_Buffer<std::complex<float>> m_inactive_buffer;
     tcb::span<uint8_t> m_active_buffer_data;
     tcb::span<uint8_t> m_inactive_buffer_data;
+    OFDM_Frame_Buffer<RawIQ_u8> m_active_raw_buffer;
+    OFDM_Frame_Buffer<RawIQ_u8> m_inactive_raw_buffer;
+    tcb::span<uint8_t> m_active_raw_buffer_data;
+    tcb::span<uint8_t> m_inactive_raw_buffer_data;
+    // ring of frames that are started in order once the pipelines finish the previous one
+    std::vector<uint8_t, PageAllocator<uint8_t>> m_ingest_data_block;
+    std::vector<Ingest_Frame> m_ingest_frames;
+    size_t m_ingest_head;
+    size_t m_ingest_total_queued;
     // 2. fine time and coarse frequency synchronisation using time/frequency correlation
     CircularBuffer<std::complex<float>> m_null_power_dip_buffer;
+    CircularBuffer<RawIQ_u8> m_raw_null_power_dip_buffer;
     ReconstructionBuffer<std::complex<float>> m_correlation_time_buffer;
     tcb::span<std::complex<float>>    m_null_power_dip_buffer_data;
+    tcb::span<RawIQ_u8>               m_raw_null_power_dip_buffer_data;
     tcb::span<std::complex<float>>    m_correlation_time_buffer_data;
     tcb::span<float>                  m_correlation_impulse_response;
     tcb::span<float>                  m_correlation_frequency_response;
     tcb::span<std::complex<float>>    m_correlation_fft_buffer;
     tcb::span<std::complex<float>>    m_correlation_ifft_buffer;
-    tcb::span<std::complex<float>>    m_correlation_prs_fft_reference;
-    tcb::span<std::complex<float>>    m_correlation_prs_time_reference;
+    // NOTE: The references are shared by every demodulator that was given the same PRS and carrier mapper
+    std::shared_ptr<const OFDM_Demod_References> m_references;
+    tcb::span<const std::complex<float>> m_correlation_prs_fft_reference;
+    tcb::span<const std::complex<float>> m_correlation_prs_time_reference;
+    tcb::span<const std::complex<float>> m_correlation_prs_phase_reference;
     // 3. pipeline demodulation
-    tcb::span<std::complex<float>>    m_pipeline_fft_buffer;
-    tcb::span<std::complex<float>>    m_pipeline_dqpsk_vec_buffer;
     tcb::span<viterbi_bit_t>          m_pipeline_out_bits;
-    // 4. carrier frequency deinterleaving
-    tcb::span<int> m_carrier_mapper;
+    // fixed point symbols (empty unless using OFDM_Demod_Precision::INT16)
+    tcb::span<Complex_Q15>            m_pipeline_q15_symbols;
+    // FFTs used by the pipelines on the current frame which point to either
+    // - every symbol of the frame so they can be inspected afterwards, see OFDM_Demod_Snapshot::frame_fft
+    // - three per pipeline when headless (its first symbol for the previous pipeline and two rolling symbols)
+    // NOTE: Each is allocated on the first frame that needs it and kept so readers never see it freed
+    std::atomic<bool> m_is_headless;
+    bool m_active_is_headless;
+    bool m_active_is_fused_symbols;
+    bool m_active_is_signal_quality;
+    // decision error of each carrier summed over the symbols of each pipeline
+    std::vector<float, AlignedAllocator<float>> m_carrier_error_data;
+    tcb::span<float> m_pipeline_carrier_error;
+    // published by the thread that finishes each frame
+    Seqlock<OFDM_Demod_Signal_Quality> m_signal_quality;
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> m_frame_fft_data;
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> m_headless_fft_data;
+    std::vector<Complex_Q15, AlignedAllocator<Complex_Q15>> m_frame_q15_fft_data;
+    std::vector<Complex_Q15, AlignedAllocator<Complex_Q15>> m_headless_q15_fft_data;
+    // corrected symbol without its cyclic prefix for each fused pipeline which is the input of its FFT
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> m_fused_fft_input_data;
+    tcb::span<std::complex<float>>    m_pipeline_fft_buffer;
+    tcb::span<Complex_Q15>            m_pipeline_q15_fft_buffer;
+    // 4. carrier frequency deinterleaving as the FFT bin of each carrier
+    tcb::span<const int> m_carrier_mapper;
 public:
     OFDM_Demod(
         const OFDM_Params& params, 
         const tcb::span<const std::complex<float>> prs_fft_ref, 
         const tcb::span<const int> carrier_mapper,
-        int nb_desired_threads=0);
+        int nb_desired_threads=0,
+        OFDM_Demod_Sync_Mode sync_mode=OFDM_Demod_Sync_Mode::BLOCKING,
+        const OFDM_Demod_Thread_Config& thread_config={},
+        std::shared_ptr<OFDM_Demod_Executor> executor=nullptr,
+        OFDM_Demod_Precision precision=OFDM_Demod_Precision::FLOAT32);
     ~OFDM_Demod();
     // threads use lambdas which take in the this pointer
     // therefore we disable move/copy semantics to preservce its memory location
@@ -118,51 +456,197 @@ public:
     OFDM_Demod(OFDM_Demod&&) = delete;
     OFDM_Demod& operator=(OFDM_Demod&) = delete;
     OFDM_Demod& operator=(OFDM_Demod&&) = delete;
+    // The capture time of the block is taken from a Latency_Trace_Scope around the call, otherwise it is now
+    // Frames carry the capture time of the block that completed them to On_OFDM_Frame() and the frame ring
     void Process(tcb::span<const std::complex<float>> block);
+    // 8bit samples are only copied by the calling thread and converted to floats by the pipeline threads
+    // NOTE: Changing the sample format restarts synchronisation
+    void Process(tcb::span<const RawIQ_u8> block);
+    void Process(tcb::span<const RawIQ_s8> block);
+    // Same as Process() except symbols are read straight from the block instead of being copied
+    // The caller should read into a ring of large aligned buffers so few symbols straddle two blocks
+    // NOTE: The block must stay valid and unmodified until GetZeroCopyRetainSamples() more samples
+    //       have been processed or Flush() has returned, whichever is first
+    //       This grows with OFDM_Demod_Thread_Config::total_ingest_frames since queued frames reference it too
+    void ProcessZeroCopy(tcb::span<const std::complex<float>> block);
+    size_t GetZeroCopyRetainSamples() const;
     void Reset();
+    // Blocks until the last frame that was read has been demodulated and published
+    // Queued frames are started one after another until none are left
+    void Flush();
+    // Seed the frequency offsets from an earlier estimate so the first frame uses the slow coarse update
+    // NOTE: This should only be called between calls to Process() after Reset()
+    void SetFrequencyOffset(const float coarse_offset, const float fine_offset);
+    // Restart synchronisation from an earlier acquisition, e.g. after retuning to a known ensemble
+    // Later desyncs also restart from the seed until it is changed, std::nullopt restarts from scratch
+    // NOTE: This is applied on the next call to Process() and can be called from any thread
+    void SetAcquisitionSeed(const std::optional<OFDM_Demod_Acquisition>& seed);
+    // Empty if no frame was demodulated since the last reset
+    std::optional<OFDM_Demod_Acquisition> GetAcquisition() const;
+    // Only demodulate the data symbols after the PRS whose entry in the mask is non zero
+    // The mask has one entry per data symbol and missing entries are treated as zero
+    // The soft bits of skipped symbols are set to 0 so they are decoded as erasures
+    // NOTE: This is applied from the next frame and can be called from any thread
+    void SetDataSymbolMask(tcb::span<const uint8_t> mask);
+    // Only demodulate the first nb_symbols data symbols after the PRS, e.g. the FIC when scanning
+    void SetTotalDataSymbols(const size_t nb_symbols);
+    // Headless demodulators don't keep the FFT of every symbol in the frame for the snapshots of a tap (see SetTap)
+    // Each pipeline demaps a symbol as soon as the FFT after it is ready so it only keeps a few FFTs which fit in cache
+    // NOTE: This is applied from the next frame and can be called from any thread
+    //       Call this before the first frame so the buffer for the whole frame is never allocated
+    void SetIsHeadless(const bool is_headless) { m_is_headless.store(is_headless, std::memory_order_relaxed); }
+    bool GetIsHeadless() const { return m_is_headless.load(std::memory_order_relaxed); }
 public:
     OFDM_Params GetOFDMParams() const { return m_params; }
     State GetState() const { return m_state; }
+    OFDM_Demod_Precision GetPrecision() const { return m_precision; }
     auto& GetConfig() { return m_cfg; }
     const auto& GetConfig() const { return m_cfg; }
     float GetSignalAverage() const { return m_signal_l1_average; }
     float GetFineFrequencyOffset() const { return m_freq_fine_offset; }
     float GetCoarseFrequencyOffset() const { return m_freq_coarse_offset; }
+    bool GetIsCoarseFrequencyLocked() const { return m_is_coarse_freq_locked; }
     float GetNetFrequencyOffset() const { return m_freq_fine_offset + m_freq_coarse_offset; }
     int GetFineTimeOffset() const { return m_fine_time_offset; }
-    int GetTotalFramesRead() const { return m_total_frames_read; }
+    // normalised to sampling frequency so multiply by 1e6 for ppm
+    float GetSampleRateOffset() const { return m_sample_rate_offset; }
+    int GetTotalFramesRead() const { return m_total_frames_read.load(std::memory_order_relaxed); }
     int GetTotalFramesDesync() const { return m_total_frames_desync; }
-    tcb::span<const std::complex<float>> GetFrameFFT() const { return m_pipeline_fft_buffer; }
-    tcb::span<const std::complex<float>> GetFrameDataVec() const { return m_pipeline_dqpsk_vec_buffer; }
+    int GetTotalFramesTracked() const { return m_total_frames_tracked; }
+    int GetTotalFramesOverrun() const { return m_total_frames_overrun; }
+    int GetTotalIdleProbes() const { return m_total_idle_probes; }
+    int GetTotalIdleWakeups() const { return m_total_idle_wakeups; }
+    // frames that were read and are waiting for the pipelines
+    int GetTotalFramesQueued() const { return int(m_ingest_total_queued); }
+    // The getters above are only safe on the thread calling Process() while this can be called from any thread
+    Status GetStatus() const { return m_status.load(); }
+    // Empty unless signal quality was measured (see OFDM_Demod_Config::signal_quality), this can be called from any thread
+    OFDM_Demod_Signal_Quality GetSignalQuality() const { return m_signal_quality.load(); }
+    // number of threads whose affinity or priority couldn't be applied
+    int GetTotalThreadConfigErrors() const { return m_total_thread_config_errors; }
+    int GetTotalPipelines() const { return int(m_pipelines.size()); }
+    int GetTotalActivePipelines() const { return m_total_active_pipelines.load(std::memory_order_relaxed); }
+    // Smoothed time taken to demodulate a frame as a fraction of its duration
+    float GetPipelineUtilisation() const { return m_pipeline_utilisation.load(std::memory_order_relaxed); }
+    // CPU time used by the coordinator and pipeline threads (or the jobs run by the executor)
+    // NOTE: This is updated once per frame and excludes the thread calling Process() unless it demodulates inline
+    uint64_t GetTotalThreadCPUTime() const { return m_total_thread_cpu_time_ns.load(std::memory_order_relaxed); }
+    const OFDM_Demod_Startup_Times& GetStartupTimes() const { return m_startup_times; }
     tcb::span<const viterbi_bit_t> GetFrameDataBits() const { return m_pipeline_out_bits; }
-    tcb::span<const float> GetImpulseResponse() const { return m_correlation_impulse_response; }
-    tcb::span<const float> GetCoarseFrequencyResponse() const { return m_correlation_frequency_response; }
-    tcb::span<const std::complex<float>> GetCorrelationTimeBuffer() const { return m_correlation_time_buffer; }
+    // Debug views read snapshots instead of the buffers that the threads of the demodulator are writing into
+    // A snapshot is only copied while a tap is set and at most once per period of the tap
+    // std::nullopt removes the tap so nothing is copied and the magnitude spectrum is only found where it is searched
+    // NOTE: These can be called from any thread
+    void SetTap(const std::optional<OFDM_Demod_Tap_Config>& config);
+    // nullptr until the first frame after a tap is set
+    std::shared_ptr<const OFDM_Demod_Snapshot> GetTapSnapshot() const;
+    // Observers are called inside a Latency_Trace_Scope with the capture time of the frame
     auto& On_OFDM_Frame() { return m_obs_on_ofdm_frame; }
+    // Seconds the pipelines took to demodulate each frame so a slow frame can be caught as it happens
+    // NOTE: This is notified by the coordinator thread after On_OFDM_Frame()
+    auto& On_Frame_Time() { return m_obs_on_frame_time; }
+    // Split each frame into segments of consecutive data symbols, e.g. the FIC and each CIF of a DAB frame
+    // A segment is published by On_OFDM_Segment() as soon as its symbols are demodulated instead of with the whole frame
+    // The symbols of every segment must add up to the data symbols of a frame, an empty list disables this
+    // NOTE: Set this before calling Process() since the pipelines publish the segments
+    bool SetOutputSegments(tcb::span<const size_t> segment_symbols);
+    // Index of the segment and its soft bits in order of the segments in the frame
+    // Every segment of a frame is published before On_OFDM_Frame() even if the symbols of a segment weren't demodulated
+    // NOTE: This is notified by whichever pipeline finishes the segment so observers should hand off any slow work
+    //       Observers are called inside a Latency_Trace_Scope with the capture time of the frame
+    auto& On_OFDM_Segment() { return m_obs_on_ofdm_segment; }
+    // NOTE: Set this before calling Process() since the coordinator thread publishes into it
+    // Frames are dropped if the ring is full unless is_blocking waits for the consumer (e.g. for file input)
+    void SetFrameRing(std::shared_ptr<SPSC_Frame_Ring<viterbi_bit_t>> frame_ring, const bool is_blocking=false) {
+        m_frame_ring = frame_ring;
+        m_is_frame_ring_blocking = is_blocking;
+    }
+    size_t GetTotalFramesDropped() const { return m_frame_ring ? m_frame_ring->get_total_dropped() : 0; }
+    // Breakdown of the buffers held by the demodulator
+    // NOTE: This is only safe on the thread calling Process()
+    //       FFT plans are shared by demodulators of the same size so each of them counts the plans it uses
+    Memory_Usage GetMemoryUsage() const;
 private:
-    size_t FindNullPowerDip(tcb::span<const std::complex<float>> buf);
-    size_t ReadNullPRS(tcb::span<const std::complex<float>> buf);
-    size_t RunCoarseFreqSync(tcb::span<const std::complex<float>> buf);
-    size_t RunFineTimeSync(tcb::span<const std::complex<float>> buf);
-    size_t ReadSymbols(tcb::span<const std::complex<float>> buf);
+    // T is either std::complex<float> or RawIQ_u8 for 8bit samples
+    template <typename T>
+    void ProcessBlock(tcb::span<const T> buf, const Input_Format format);
+    template <typename T>
+    size_t FindNullPowerDip(tcb::span<const T> buf);
+    template <typename T>
+    size_t ReadNullPRS(tcb::span<const T> buf);
+    size_t RunCoarseFreqSync();
+    size_t RunFineTimeSync();
+    int FindTrackingPeak(const float impulse_avg, int expected_index);
+    float CalculatePRSDelay() const;
+    float GetPredictedPRSDelay() const;
+    void UpdateSampleRateOffset(const int offset, const float delay, const bool is_measured);
+    template <typename T>
+    size_t ReadSymbols(tcb::span<const T> buf);
+    template <typename T>
+    size_t ProbeIdleSignal(tcb::span<const T> buf);
+    void UpdateIdleDetector(const size_t nb_samples);
+    void StartIdleProbing();
+    void StopIdleProbing(const float signal_l1_average);
+    void FinishIdleProbe();
+    void StartInactiveFrame(const Input_Format format);
+    void QueueInactiveFrame(const Input_Format format);
+    void StartQueuedFrame();
+    void StartQueuedFrameIfIdle();
 private:
-    void CreateThreads(int nb_desired_threads);
+    std::shared_ptr<const OFDM_Demod_References> CreateReferences(
+        tcb::span<const std::complex<float>> prs_fft_ref, tcb::span<const int> carrier_mapper);
+    void CreateThreads(int nb_desired_threads, OFDM_Demod_Sync_Mode sync_mode);
+    void UpdateThreadCPUTime(uint64_t& last_cpu_time_ns);
+    void UpdateSymbolMask();
     bool CoordinatorThread();
-    bool PipelineThread(OFDM_Demod_Pipeline& thread_data, OFDM_Demod_Pipeline* dependent_thread_data);
+    bool PipelineThread(const size_t index);
+    void SchedulePipelines(const int nb_active);
+    void UpdateActivePipelines(const float frame_seconds);
+    void StartFrame();
+    void FinishFrame(const float frame_seconds);
+    void UpdatePipelinePhaseError(tcb::span<const std::unique_ptr<OFDM_Demod_Pipeline>> pipelines);
+    void UpdatePipelineBuffers();
+    void StartSegments();
+    void FinishSegmentSymbol(const int symbol);
+    void PublishSegments(const bool is_frame_end);
+    void UpdateSignalQuality();
+    static void RunPipelineJob(void* context, size_t index);
+    void PipelineJob(const size_t index);
+    // Steps of a pipeline on its symbols [start,end) which are shared by the threads and jobs
+    void ConvertPipelineSymbols(const int start, const int end);
+    void CorrectPipelineSymbols(const int start, const int end);
+    float CalculatePipelinePhaseError(const int start, const int end);
+    void CalculatePipelineFFT(const size_t index, int start, const int end);
+    void CorrectPipelineSampleRate(const size_t index, const int symbol);
+    void CalculatePipelineDQPSK(const size_t index, const int start, const int end);
+    float CalculatePipelineIndependent(const size_t index, const int start, const int end, const int dqpsk_end);
+    float CalculatePipelineFusedSymbol(const size_t index, const int symbol);
+    size_t GetPipelineFFTSlot(const size_t index, const int symbol) const;
+    tcb::span<Complex_Q15> GetPipelineQ15Symbol(const int i) {
+        return m_pipeline_q15_symbols.subspan(size_t(i)*m_params.nb_symbol_period, m_params.nb_symbol_period);
+    }
 private:
     float CalculateTimeOffset(const size_t i, const float freq_offset);
     float CalculateCyclicPhaseError(tcb::span<const std::complex<float>> sym);
+    float CalculateCyclicPhaseError(tcb::span<const Complex_Q15> sym);
     float CalculateFineFrequencyError(const float cyclic_phase_error);
-    void CalculateDQPSK(
-        tcb::span<const std::complex<float>> in0, tcb::span<const std::complex<float>> in1, 
-        tcb::span<std::complex<float>> out_vec);
-    void CalculateViterbiBits(tcb::span<const std::complex<float>> vec_buf, tcb::span<viterbi_bit_t> bit_buf);
     void CalculateFFT(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> fft_out);
     void CalculateIFFT(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> fft_out);
     void CalculateRelativePhase(tcb::span<const std::complex<float>> fft_in, tcb::span<std::complex<float>> arg_out);
-    void CalculateMagnitude(tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf);
+    void CalculateMagnitude(tcb::span<const std::complex<float>> fft_buf, tcb::span<float> mag_buf, const int min_index, const int max_index);
+    void UpdateTap();
+    void PublishStatus();
+    void CalculateCoarseFrequencyResponse(tcb::span<const std::complex<float>> phase_buf, const int min_index, const int max_index);
     float CalculateL1Average(tcb::span<const std::complex<float>> block);
-    void UpdateSignalAverage(tcb::span<const std::complex<float>> block);
+    float CalculateL1Average(tcb::span<const RawIQ_u8> block);
+    void CalculateL1Sums(tcb::span<const std::complex<float>> x, tcb::span<float> y);
+    void CalculateL1Sums(tcb::span<const RawIQ_u8> x, tcb::span<float> y);
+    void ResetNullL1Window();
+    void ResetCoarseFreqLock();
+    bool UpdateNullL1Window(const float block_sum);
+    template <typename T>
+    void UpdateSignalAverage(tcb::span<const T> block);
+    void ConvertRawIQ(tcb::span<const RawIQ_u8> src, tcb::span<std::complex<float>> dest, const Input_Format format);
     void UpdateFineFrequencyOffset(const float delta);
 };
 
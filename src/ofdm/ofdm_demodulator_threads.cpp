@@ -1,18 +1,90 @@
 #include "./ofdm_demodulator_threads.h"
+#include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <mutex>
-
-#define PROFILE_ENABLE 1
+#include <thread>
+#include "detect_architecture.h"
 #include "./profiler.h"
 
+#if defined(__ARCH_X86__)
+#include <immintrin.h>
+static inline void cpu_relax() { _mm_pause(); }
+#elif defined(__ARCH_AARCH64__) && defined(_MSC_VER)
+#include <intrin.h>
+static inline void cpu_relax() { __yield(); }
+#elif defined(__ARCH_AARCH64__)
+static inline void cpu_relax() { __asm__ __volatile__("yield"); }
+#else
+static inline void cpu_relax() {}
+#endif
+
+// Number of spins before the waiting thread parks which is on the order of tens of microseconds
+// NOTE: Waits for the start of the next frame take longer than this so they park after a short spin
+constexpr int TOTAL_SPINS_BEFORE_PARK = 2048;
+
+// Event
+OFDM_Demod_Event::OFDM_Demod_Event(const OFDM_Demod_Sync_Mode mode, const bool is_signalled)
+: m_mode(mode), m_sequence(is_signalled ? 1 : 0), m_wait_sequence(0), m_is_parked(false)
+{
+    // Spinning on a single core only delays the thread that would signal us
+    const bool is_multicore = std::thread::hardware_concurrency() > 1;
+    m_total_spins = ((m_mode == OFDM_Demod_Sync_Mode::SPIN_PARK) && is_multicore) ? TOTAL_SPINS_BEFORE_PARK : 0;
+}
+
+void OFDM_Demod_Event::Signal() {
+    if (m_mode == OFDM_Demod_Sync_Mode::INLINE) {
+        m_sequence.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (m_mode == OFDM_Demod_Sync_Mode::BLOCKING) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_sequence.fetch_add(1, std::memory_order_release);
+        m_cv.notify_one();
+        return;
+    }
+
+    // NOTE: The increment and the parked check are sequentially consistent with the waiter's
+    //       parked store and its sequence check so a wakeup can't be lost
+    m_sequence.fetch_add(1, std::memory_order_seq_cst);
+    if (m_is_parked.load(std::memory_order_seq_cst)) {
+        auto lock = std::scoped_lock(m_mutex);
+        m_cv.notify_one();
+    }
+}
+
+void OFDM_Demod_Event::Wait() {
+    // The same thread signalled us beforehand so there is nothing to wait for
+    if (m_mode == OFDM_Demod_Sync_Mode::INLINE) {
+        assert(IsSignalled());
+        m_wait_sequence = m_sequence.load(std::memory_order_relaxed);
+        return;
+    }
+
+    for (int i = 0; i < m_total_spins; i++) {
+        if (IsSignalled()) {
+            m_wait_sequence = m_sequence.load(std::memory_order_acquire);
+            return;
+        }
+        cpu_relax();
+    }
+
+    auto lock = std::unique_lock(m_mutex);
+    m_is_parked.store(true, std::memory_order_seq_cst);
+    m_cv.wait(lock, [this]() { 
+        return m_sequence.load(std::memory_order_seq_cst) != m_wait_sequence; 
+    });
+    m_is_parked.store(false, std::memory_order_relaxed);
+    m_wait_sequence = m_sequence.load(std::memory_order_acquire);
+}
+
 // Pipeline thread
-OFDM_Demod_Pipeline::OFDM_Demod_Pipeline(const size_t start, const size_t end) 
-: m_symbol_start(start), m_symbol_end(end)
+OFDM_Demod_Pipeline::OFDM_Demod_Pipeline(const size_t start, const size_t end, const OFDM_Demod_Sync_Mode mode) 
+: m_symbol_start(start), m_symbol_end(end), m_dependent(nullptr),
+  m_event_start(mode), m_event_phase_error_done(mode), m_event_fft_done(mode), m_event_end(mode)
 {
-    m_is_start = false;
-    m_is_phase_error_done = false;
-    m_is_fft_done = false;
-    m_is_end = false;
     m_is_terminated = false;
     m_average_phase_error = 0.0f;
 }
@@ -29,84 +101,47 @@ void OFDM_Demod_Pipeline::Stop() {
 
 void OFDM_Demod_Pipeline::SignalStart() {
     PROFILE_BEGIN_FUNC();
-
-    PROFILE_BEGIN(lock_create);
-    auto lock = std::scoped_lock(m_mutex_start);
-    PROFILE_END(lock_create);
-
-    m_is_start = true;
-    PROFILE_BEGIN(cv_notify);
-    m_cv_start.notify_one();
+    m_event_start.Signal();
 }
 
 void OFDM_Demod_Pipeline::WaitStart() {
     PROFILE_BEGIN_FUNC();
     if (m_is_terminated) return;
-
-    PROFILE_BEGIN(lock_create);
-    auto lock = std::unique_lock(m_mutex_start);
-    PROFILE_END(lock_create);
-
-    PROFILE_BEGIN(cv_wait);
-    m_cv_start.wait(lock, [this]() { return m_is_start; });
-    m_is_start = false;
+    m_event_start.Wait();
 }
 
 void OFDM_Demod_Pipeline::SignalPhaseError() {
     PROFILE_BEGIN_FUNC();
-    auto lock = std::scoped_lock(m_mutex_phase_error_done);
-    m_is_phase_error_done = true;
-    m_cv_phase_error_done.notify_one();
+    m_event_phase_error_done.Signal();
 }
 
 void OFDM_Demod_Pipeline::WaitPhaseError() {
-    auto lock = std::unique_lock(m_mutex_phase_error_done);
-    m_cv_phase_error_done.wait(lock, [this]() { return m_is_phase_error_done; });
-    m_is_phase_error_done = false;
+    m_event_phase_error_done.Wait();
 }
 
 void OFDM_Demod_Pipeline::SignalFFT() {
-    auto lock = std::scoped_lock(m_mutex_fft_done);
-    m_is_fft_done = true;
-    m_cv_fft_done.notify_one();
+    m_event_fft_done.Signal();
 }
 
 void OFDM_Demod_Pipeline::WaitFFT() {
-    auto lock = std::unique_lock(m_mutex_fft_done);
-    m_cv_fft_done.wait(lock, [this]() { return m_is_fft_done; });
-    m_is_fft_done = false;
+    m_event_fft_done.Wait();
 }
 
 void OFDM_Demod_Pipeline::SignalEnd() {
     PROFILE_BEGIN_FUNC();
-
-    PROFILE_BEGIN(lock_create);
-    auto lock = std::scoped_lock(m_mutex_end);
-    PROFILE_END(lock_create);
-
-    m_is_end = true;
-    PROFILE_BEGIN(cv_notify);
-    m_cv_end.notify_one();
+    m_event_end.Signal();
 }
 
 void OFDM_Demod_Pipeline::WaitEnd() {
     PROFILE_BEGIN_FUNC();
-
-    PROFILE_BEGIN(lock_create);
-    auto lock = std::unique_lock(m_mutex_end);
-    PROFILE_END(lock_create);
-
-    PROFILE_BEGIN(cv_wait);
-    m_cv_end.wait(lock, [this]() { return m_is_end; });
-    m_is_end = false;
+    m_event_end.Wait();
 }
 
 // Coordinator thread
-OFDM_Demod_Coordinator::OFDM_Demod_Coordinator() {
-    m_is_start = false;
-    m_is_end = true;
+OFDM_Demod_Coordinator::OFDM_Demod_Coordinator(const OFDM_Demod_Sync_Mode mode) 
+: m_event_start(mode), m_event_end(mode, true)
+{
     m_is_terminated = false;
-    m_cv_end.notify_all();
 }
 
 OFDM_Demod_Coordinator::~OFDM_Demod_Coordinator() {
@@ -119,26 +154,18 @@ void OFDM_Demod_Coordinator::Stop() {
 }
 
 void OFDM_Demod_Coordinator::SignalStart() {
-    auto lock = std::scoped_lock(m_mutex_start);
-    m_is_start = true;
-    m_cv_start.notify_one();
+    m_event_start.Signal();
 }
 
 void OFDM_Demod_Coordinator::WaitStart() {
     if (m_is_terminated) return;
-    auto lock = std::unique_lock(m_mutex_start);
-    m_cv_start.wait(lock, [this]() { return m_is_start; });
-    m_is_start = false;
+    m_event_start.Wait();
 }
 
 void OFDM_Demod_Coordinator::SignalEnd() {
-    auto lock = std::scoped_lock(m_mutex_end);
-    m_is_end = true;
-    m_cv_end.notify_one();
+    m_event_end.Signal();
 }
 
 void OFDM_Demod_Coordinator::WaitEnd() {
-    auto lock = std::unique_lock(m_mutex_end);
-    m_cv_end.wait(lock, [this]() { return m_is_end; });
-    m_is_end = false;
-}
\ No newline at end of file
+    m_event_end.Wait();
+}
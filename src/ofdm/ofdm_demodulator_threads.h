@@ -1,38 +1,112 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include "utility/memory_policy.h"
+#include "utility/thread_affinity.h"
 
 // Helper classes to manage synchronisation between the OFDM demodulator pipeline threads
 // We have an coordinator thread to synchronise our pipeline threads
 
-class OFDM_Demod_Pipeline 
-{
-private:
-    const size_t m_symbol_start;
-    const size_t m_symbol_end;
-    float m_average_phase_error;
+// BLOCKING:  Every signal locks a mutex and wakes the waiting thread through a condition variable
+// SPIN_PARK: Signals only increment an atomic sequence counter 
+//            The waiting thread spins for a bounded time and only parks on the condition variable if it is still waiting
+//            This avoids the syscalls to sleep and wake threads when the wait is short
+// INLINE:    No threads are created and the thread calling OFDM_Demod::Process() demodulates each frame once it is read
+//            Events are only signalled and waited on by that thread so they are counters which never block
+//            This is for single core targets or batch workers which already run one demodulator per core
+//            NOTE: The frame uses one pipeline and an executor takes precedence over this mode
+enum class OFDM_Demod_Sync_Mode {
+    BLOCKING,
+    SPIN_PARK,
+    INLINE,
+};
 
-    bool m_is_start;
-    std::mutex m_mutex_start;
-    std::condition_variable m_cv_start;
+// Placement and priority of the threads and memory used by the demodulator
+struct OFDM_Demod_Thread_Config {
+    // thread that calls OFDM_Demod::Process() which is applied on its first call
+    Thread_Affinity reader;
+    Thread_Affinity coordinator;
+    // the index of each pipeline thread is used with Thread_Affinity::is_one_core_per_thread
+    Thread_Affinity pipeline;
+    // frames that can be held by the reader (2 is a double buffer)
+    // the frames after the first two are queued while the pipelines are still busy with an earlier frame
+    // which absorbs a pipeline that runs over a frame for a short time without blocking the reader
+    size_t total_ingest_frames = 2;
+    // if every frame is in use the newest frame is skipped instead of waiting on the pipelines
+    // NOTE: Enable this for live devices which drop samples if the reader blocks
+    //       Leave it disabled when reading faster than realtime (e.g. from a file) so no frames are lost
+    bool is_skip_ingest_overrun = false;
+    // joint block of the sample buffers and symbol data
+    // NOTE: If memory.numa_node is -1 the block is placed on the NUMA node of the pipeline threads
+    Memory_Policy memory;
+};
 
-    bool m_is_phase_error_done;
-    std::mutex m_mutex_phase_error_done;
-    std::condition_variable m_cv_phase_error_done;
+// Job of a frame that is run by an external scheduler
+// NOTE: This is trivially copyable so a scheduler can store it inline without allocating
+struct OFDM_Demod_Job {
+    void (*run)(void* context, size_t index) = nullptr;
+    void* context = nullptr;
+    size_t index = 0;
+    void operator()() const { run(context, index); }
+};
 
-    bool m_is_fft_done;
-    std::mutex m_mutex_fft_done;
-    std::condition_variable m_cv_fft_done;
+// Scheduler shared with other work (e.g. the radio thread pool) which runs the pipelines as jobs
+// The demodulator then creates no threads and submits one job per symbol range on each frame
+// NOTE: Submit() is only called by the thread calling OFDM_Demod::Process()
+//       Jobs never wait on each other so the scheduler can run them in any order on any thread
+class OFDM_Demod_Executor
+{
+public:
+    virtual ~OFDM_Demod_Executor() = default;
+    virtual void Submit(const OFDM_Demod_Job& job) = 0;
+};
 
-    bool m_is_end;
-    std::mutex m_mutex_end;
-    std::condition_variable m_cv_end;
+// Auto reset event which is signalled by one thread and waited on by another
+// NOTE: Multiple signals before a wait are collapsed into one
+class OFDM_Demod_Event
+{
+private:
+    const OFDM_Demod_Sync_Mode m_mode;
+    int m_total_spins;
+    // incremented on each signal
+    std::atomic<uint64_t> m_sequence;
+    // last sequence consumed by the waiting thread
+    uint64_t m_wait_sequence;
+    std::atomic<bool> m_is_parked;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+public:
+    explicit OFDM_Demod_Event(const OFDM_Demod_Sync_Mode mode, const bool is_signalled=false);
+    OFDM_Demod_Event(OFDM_Demod_Event&) = delete;
+    OFDM_Demod_Event(OFDM_Demod_Event&&) = delete;
+    OFDM_Demod_Event& operator=(OFDM_Demod_Event&) = delete;
+    OFDM_Demod_Event& operator=(OFDM_Demod_Event&&) = delete;
+    void Signal();
+    void Wait();
+    // True if Wait() would return without blocking
+    // NOTE: Only the waiting thread can call this since it doesn't consume the signal
+    bool IsSignalled() const { return m_sequence.load(std::memory_order_acquire) != m_wait_sequence; }
+};
 
-    bool m_is_terminated;
+class OFDM_Demod_Pipeline 
+{
+private:
+    size_t m_symbol_start;
+    size_t m_symbol_end;
+    // pipeline which demodulates the symbols after ours (nullptr if we are the last one)
+    OFDM_Demod_Pipeline* m_dependent;
+    float m_average_phase_error;
+    OFDM_Demod_Event m_event_start;
+    OFDM_Demod_Event m_event_phase_error_done;
+    OFDM_Demod_Event m_event_fft_done;
+    OFDM_Demod_Event m_event_end;
+    std::atomic<bool> m_is_terminated;
 public:
-    OFDM_Demod_Pipeline(const size_t start, const size_t end);
+    OFDM_Demod_Pipeline(const size_t start, const size_t end, const OFDM_Demod_Sync_Mode mode=OFDM_Demod_Sync_Mode::BLOCKING);
     ~OFDM_Demod_Pipeline();
     // This thread contains mutexes which we do not intend to copy/move
     OFDM_Demod_Pipeline(OFDM_Demod_Pipeline&) = delete;
@@ -41,6 +115,13 @@ public:
     OFDM_Demod_Pipeline& operator=(OFDM_Demod_Pipeline&&) = delete;
     size_t GetSymbolStart() const { return m_symbol_start; }
     size_t GetSymbolEnd() const { return m_symbol_end; }
+    OFDM_Demod_Pipeline* GetDependent() const { return m_dependent; }
+    // NOTE: This is called by the coordinator thread before SignalStart() so the pipeline sees it on that frame
+    void SetSchedule(const size_t start, const size_t end, OFDM_Demod_Pipeline* dependent) {
+        m_symbol_start = start;
+        m_symbol_end = end;
+        m_dependent = dependent;
+    }
     float GetAveragePhaseError() const { return m_average_phase_error; }
     void SetAveragePhaseError(const float error) { m_average_phase_error = error; }
     void Stop();
@@ -62,17 +143,11 @@ public:
 class OFDM_Demod_Coordinator 
 {
 private:
-    bool m_is_start;
-    std::mutex m_mutex_start;
-    std::condition_variable m_cv_start;
-
-    bool m_is_end;
-    std::mutex m_mutex_end;
-    std::condition_variable m_cv_end;
-
-    bool m_is_terminated;
+    OFDM_Demod_Event m_event_start;
+    OFDM_Demod_Event m_event_end;
+    std::atomic<bool> m_is_terminated;
 public:
-    OFDM_Demod_Coordinator();
+    explicit OFDM_Demod_Coordinator(const OFDM_Demod_Sync_Mode mode=OFDM_Demod_Sync_Mode::BLOCKING);
     ~OFDM_Demod_Coordinator();
     // This thread contains mutexes which we do not intend to copy/move
     OFDM_Demod_Coordinator(OFDM_Demod_Coordinator&) = delete;
@@ -84,6 +159,7 @@ public:
     // Called by reader thread
     void SignalStart();
     void WaitEnd();
+    bool IsEnded() const { return m_event_end.IsSignalled(); }
     // Called by coordinator thread
     // NOTE: WaitStart() exits early if the thread was terminated
     //       This needs to be checked by the waiting thread using IsStopped()
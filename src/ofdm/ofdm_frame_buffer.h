@@ -63,6 +63,11 @@ public:
         return m_align_size; 
     }
 
+    // Number of samples between the start of consecutive symbols
+    size_t GetDataSymbolStride() const {
+        return m_aligned_data_symbol_stride / sizeof(T);
+    }
+
     void Reset() {
         m_curr_symbol_index = 0;
         m_curr_symbol_samples = 0;
@@ -84,6 +89,48 @@ public:
         return nb_read;
     }
 
+    // Symbols which are entirely inside src are referenced instead of being copied
+    // views[i] is set to the start of symbol i in src, or nullptr if it was copied into this buffer
+    // NOTE: Only the symbols read in this call are updated
+    size_t ConsumeBufferView(tcb::span<const T> src, tcb::span<const T*> views) {
+        assert(!m_buf.empty());
+        assert(m_buf.size() == GetTotalBufferBytes());
+        assert(views.size() == (m_params.nb_frame_symbols+1));
+        size_t nb_read = 0;
+        while (!src.empty() && !IsFull()) {
+            const size_t nb_capacity =
+                (m_curr_symbol_index < m_params.nb_frame_symbols) ?
+                m_params.nb_symbol_period : m_params.nb_null_period;
+            size_t N = 0;
+            if ((m_curr_symbol_samples == 0) && (src.size() >= nb_capacity)) {
+                views[m_curr_symbol_index] = src.data();
+                N = nb_capacity;
+                m_curr_symbol_index++;
+            } else {
+                views[m_curr_symbol_index] = nullptr;
+                N = Consume(src);
+            }
+            nb_read += N;
+            src = src.subspan(N);
+        }
+        return nb_read;
+    }
+
+    // Advance through the frame without writing so another buffer can hold those samples
+    void Skip(size_t nb_samples) {
+        while ((nb_samples > 0) && !IsFull()) {
+            const size_t nb_capacity =
+                (m_curr_symbol_index < m_params.nb_frame_symbols) ?
+                m_params.nb_symbol_period : m_params.nb_null_period;
+            const size_t nb_required = nb_capacity-m_curr_symbol_samples;
+            const size_t nb_skip = (nb_samples > nb_required) ? nb_required : nb_samples;
+            m_curr_symbol_samples += nb_skip;
+            m_curr_symbol_index += (m_curr_symbol_samples / nb_capacity);
+            m_curr_symbol_samples = (m_curr_symbol_samples % nb_capacity);
+            nb_samples -= nb_skip;
+        }
+    }
+
     tcb::span<T> GetDataSymbol(const size_t index) {
         const size_t offset = index*m_aligned_data_symbol_stride + m_aligned_data_prefix_padding;
         auto* wr_buf = reinterpret_cast<T*>(&m_buf[offset]);
@@ -4,8 +4,8 @@
 #include <algorithm>
 #include <cmath>
 #include <complex>
-#include <fftw3.h>
 #include "utility/span.h"
+#include "./fft_plan_cache.h"
 #include "./ofdm_params.h"
 
 OFDM_Modulator::OFDM_Modulator(
@@ -15,7 +15,7 @@ OFDM_Modulator::OFDM_Modulator(
     m_frame_out_size(params.nb_null_period + params.nb_symbol_period*params.nb_frame_symbols),
     m_data_in_size((params.nb_frame_symbols-1)*params.nb_data_carriers*2/8)
 {
-    m_ifft_plan = fftwf_plan_dft_1d((int)m_params.nb_fft, nullptr, nullptr, FFTW_BACKWARD, FFTW_ESTIMATE);
+    m_ifft_plan = fft_get_plan(m_params.nb_fft, FFT_Direction::BACKWARD);
 
     // interleave the bits for a OFDM symbol containing N data carriers
     m_prs_fft_ref.resize(m_params.nb_fft);
@@ -41,11 +41,6 @@ OFDM_Modulator::OFDM_Modulator(
     }
 }
 
-OFDM_Modulator::~OFDM_Modulator() 
-{
-    fftwf_destroy_plan(m_ifft_plan);
-}
-
 bool OFDM_Modulator::ProcessBlock(
     tcb::span<std::complex<float>> frame_out_buf, 
     tcb::span<const uint8_t> data_in_buf)
@@ -159,8 +154,5 @@ void OFDM_Modulator::CalculateIFFT(
     tcb::span<const std::complex<float>> fft_in, 
     tcb::span<std::complex<float>> fft_out)
 {
-    fftwf_execute_dft(
-        m_ifft_plan, 
-        (fftwf_complex*)fft_in.data(),
-        (fftwf_complex*)fft_out.data());
+    m_ifft_plan->Execute(fft_in, fft_out);
 }
\ No newline at end of file
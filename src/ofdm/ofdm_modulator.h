@@ -1,18 +1,19 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <complex>
+#include <memory>
 #include <vector>
 #include "utility/span.h"
 #include "./ofdm_params.h"
 
-typedef struct fftwf_plan_s* fftwf_plan;                                      \
+class FFT_Plan;
 
 // simulate a OFDM transmitter using one of the DAB transmission modes
 // this will have a sampling rate of 2.048MHz
 class OFDM_Modulator 
 {
 private:
-    fftwf_plan m_ifft_plan;
+    std::shared_ptr<FFT_Plan> m_ifft_plan;
     const OFDM_Params m_params;
 
     const size_t m_frame_out_size;
@@ -28,7 +29,6 @@ public:
     OFDM_Modulator(
         const OFDM_Params& params, 
         tcb::span<const std::complex<float>> prs_fft_ref);
-    ~OFDM_Modulator();
     bool ProcessBlock(
         tcb::span<std::complex<float>> frame_out_buf, 
         tcb::span<const uint8_t> data_in_buf);
@@ -0,0 +1,114 @@
+#include "./parallel_frequency_shift.h"
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./dsp/apply_pll.h"
+
+// The pll kernels step the phase as dt_norm + i*freq_norm in single precision
+// so the phase is recomputed in double precision every block to keep it accurate within a chunk
+constexpr size_t PLL_BLOCK_SIZE = 4096;
+
+float get_frequency_shift_phase(const size_t offset, const float freq_norm, const float dt_norm) {
+    const double dt = double(dt_norm) + double(offset)*double(freq_norm);
+    return float(dt - std::round(dt));
+}
+
+static void apply_frequency_shift_chunk(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const size_t offset, const float freq_norm, const float dt_norm)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    for (size_t i = 0; i < N; i += PLL_BLOCK_SIZE) {
+        const size_t length = std::min(PLL_BLOCK_SIZE, N-i);
+        const float dt = get_frequency_shift_phase(offset+i, freq_norm, dt_norm);
+        apply_pll_auto(x.subspan(i, length), y.subspan(i, length), freq_norm, dt);
+    }
+}
+
+static size_t get_total_threads(const Parallel_Frequency_Shift_Config& config, const size_t total_chunks) {
+    size_t total_threads = config.total_threads;
+    if (total_threads == 0) total_threads = size_t(std::thread::hardware_concurrency());
+    return std::max(std::min(total_threads, total_chunks), size_t(1));
+}
+
+// Runs the worker on the calling thread and the extra threads
+template <typename F>
+static void run_workers(const size_t total_threads, F&& worker) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < total_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
+
+void apply_frequency_shift_parallel(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const float freq_norm, const float dt_norm,
+    const Parallel_Frequency_Shift_Config& config)
+{
+    assert(x.size() == y.size());
+    const size_t N = x.size();
+    const size_t chunk_size = std::max(config.chunk_size, size_t(1));
+    const size_t total_chunks = (N + chunk_size - 1) / chunk_size;
+    if (total_chunks == 0) return;
+
+    std::atomic<size_t> next_chunk{0};
+    auto worker = [&]() {
+        while (true) {
+            const size_t index = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (index >= total_chunks) break;
+            const size_t offset = index*chunk_size;
+            const size_t length = std::min(chunk_size, N-offset);
+            apply_frequency_shift_chunk(x.subspan(offset, length), y.subspan(offset, length), offset, freq_norm, dt_norm);
+        }
+    };
+    run_workers(get_total_threads(config, total_chunks), worker);
+}
+
+void apply_frequency_shift_parallel(
+    const Frequency_Shift_Reader& reader, const Frequency_Shift_Writer& writer, const size_t total_samples,
+    const float freq_norm, const float dt_norm,
+    const Parallel_Frequency_Shift_Config& config)
+{
+    const size_t chunk_size = std::max(config.chunk_size, size_t(1));
+    const size_t total_chunks = (total_samples + chunk_size - 1) / chunk_size;
+    if (total_chunks == 0) return;
+
+    std::atomic<size_t> next_chunk{0};
+    // chunks are written in order while the other threads keep mixing ahead
+    std::mutex mutex_write;
+    std::condition_variable cv_write;
+    size_t next_write = 0;
+    auto worker = [&]() {
+        std::vector<std::complex<float>> buf(chunk_size);
+        while (true) {
+            const size_t index = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (index >= total_chunks) break;
+            const size_t offset = index*chunk_size;
+            const size_t length = std::min(chunk_size, total_samples-offset);
+            auto chunk = tcb::span(buf).first(length);
+            reader(offset, chunk);
+            apply_frequency_shift_chunk(chunk, chunk, offset, freq_norm, dt_norm);
+            {
+                auto lock = std::unique_lock(mutex_write);
+                cv_write.wait(lock, [&]() { return next_write == index; });
+            }
+            writer(offset, chunk);
+            {
+                auto lock = std::unique_lock(mutex_write);
+                next_write++;
+            }
+            cv_write.notify_all();
+        }
+    };
+    run_workers(get_total_threads(config, total_chunks), worker);
+}
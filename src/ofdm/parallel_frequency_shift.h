@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <complex>
+#include <functional>
+#include "utility/span.h"
+
+// Frequency shifts a whole recording by splitting it into chunks that are mixed on all cores
+// The starting phase of each chunk is computed from its offset so the output is continuous across chunks
+// y[n] = x[n] * exp(j*2*pi*(dt_norm + n*freq_norm)) with freq_norm = frequency/sampling_rate
+struct Parallel_Frequency_Shift_Config {
+    // 0 uses one thread per core
+    size_t total_threads = 0;
+    // samples given to a thread at once
+    size_t chunk_size = size_t(1) << 18;
+};
+
+// Phase in cycles in [-0.5,+0.5] of the pll at a sample offset
+// NOTE: This is computed in double precision since offset*freq_norm loses precision as a float in long recordings
+float get_frequency_shift_phase(const size_t offset, const float freq_norm, const float dt_norm=0.0f);
+
+// x and y can be the same buffer
+void apply_frequency_shift_parallel(
+    tcb::span<const std::complex<float>> x, tcb::span<std::complex<float>> y,
+    const float freq_norm, const float dt_norm=0.0f,
+    const Parallel_Frequency_Shift_Config& config={}
+);
+
+// Reads samples [offset, offset+buf.size()) of the input into buf
+// NOTE: This is called by all threads at once so it must be thread safe
+using Frequency_Shift_Reader = std::function<void(const size_t offset, tcb::span<std::complex<float>> buf)>;
+// Receives the shifted samples [offset, offset+buf.size())
+// NOTE: This is called from the worker threads but only by one at a time and in order of offset
+using Frequency_Shift_Writer = std::function<void(const size_t offset, tcb::span<const std::complex<float>> buf)>;
+
+// Shifts a recording that doesn't fit in memory such as a mapped file
+void apply_frequency_shift_parallel(
+    const Frequency_Shift_Reader& reader, const Frequency_Shift_Writer& writer, const size_t total_samples,
+    const float freq_norm, const float dt_norm=0.0f,
+    const Parallel_Frequency_Shift_Config& config={}
+);
@@ -0,0 +1,151 @@
+#include "./plot_downsample.h"
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "utility/span.h"
+
+void downsample_min_max(tcb::span<const float> y, const size_t total_blocks, Plot_Envelope& out) {
+    const size_t N = y.size();
+    const size_t M = std::min(N, total_blocks);
+    out.x_scale = (M == 0) ? 1.0f : float(N)/float(M);
+    out.y_min.resize(M);
+    out.y_max.resize(M);
+    for (size_t i = 0; i < M; i++) {
+        const size_t start = (i*N)/M;
+        const size_t end = ((i+1)*N)/M;
+        const auto [min, max] = std::minmax_element(y.begin()+start, y.begin()+end);
+        out.y_min[i] = *min;
+        out.y_max[i] = *max;
+    }
+}
+
+void downsample_magnitude_spectrum(
+    tcb::span<const std::complex<float>> fft, const size_t total_blocks, Plot_Envelope& out,
+    const float scale)
+{
+    const size_t N = fft.size();
+    const size_t M = std::min(N, total_blocks);
+    const size_t H = N/2;
+    out.x_scale = (M == 0) ? 1.0f : float(N)/float(M);
+    out.y_min.resize(M);
+    out.y_max.resize(M);
+    // The extremes of the squared magnitude are found first so there are only two logarithms per block
+    const float power_scale = 0.5f*scale;
+    for (size_t i = 0; i < M; i++) {
+        const size_t start = (i*N)/M;
+        const size_t end = ((i+1)*N)/M;
+        float min_power = INFINITY;
+        float max_power = 0.0f;
+        for (size_t j = start; j < end; j++) {
+            // -F/2 <= f < 0 is in the upper half of the FFT
+            const size_t k = (j < H) ? (j+H) : (j-H);
+            const float power = std::norm(fft[k]);
+            min_power = std::min(min_power, power);
+            max_power = std::max(max_power, power);
+        }
+        out.y_min[i] = power_scale*std::log10(min_power);
+        out.y_max[i] = power_scale*std::log10(max_power);
+    }
+}
+
+template <typename F>
+static void downsample_lttb(const size_t N, F&& get_y, const size_t total_points, Plot_Line& out) {
+    // the first and last samples need at least one bucket between them
+    const size_t M = std::max(total_points, size_t(3));
+    if (N <= M) {
+        out.x.resize(N);
+        out.y.resize(N);
+        for (size_t i = 0; i < N; i++) {
+            out.x[i] = float(i);
+            out.y[i] = get_y(i);
+        }
+        return;
+    }
+
+    out.x.resize(M);
+    out.y.resize(M);
+    out.x[0] = 0.0f;
+    out.y[0] = get_y(0);
+    // The samples between the first and last are split into M-2 buckets
+    // Each bucket keeps the sample which makes the largest triangle with the previously kept sample
+    // and the average of the next bucket
+    const size_t total_buckets = M-2;
+    const auto get_bucket_start = [N, total_buckets](const size_t i) {
+        return 1 + (i*(N-2))/total_buckets;
+    };
+    size_t prev_index = 0;
+    for (size_t i = 0; i < total_buckets; i++) {
+        const size_t start = get_bucket_start(i);
+        const size_t end = get_bucket_start(i+1);
+        const size_t next_start = end;
+        const size_t next_end = (i+1 < total_buckets) ? get_bucket_start(i+2) : N;
+
+        float next_x = 0.0f;
+        float next_y = 0.0f;
+        for (size_t j = next_start; j < next_end; j++) {
+            next_x += float(j);
+            next_y += get_y(j);
+        }
+        const float next_scale = 1.0f/float(next_end-next_start);
+        next_x *= next_scale;
+        next_y *= next_scale;
+
+        const float prev_x = float(prev_index);
+        const float prev_y = get_y(prev_index);
+        size_t max_index = start;
+        float max_area = -1.0f;
+        for (size_t j = start; j < end; j++) {
+            // twice the area of the triangle
+            const float area = std::abs(
+                (prev_x-next_x)*(get_y(j)-prev_y) -
+                (prev_x-float(j))*(next_y-prev_y)
+            );
+            if (area > max_area) {
+                max_area = area;
+                max_index = j;
+            }
+        }
+        out.x[i+1] = float(max_index);
+        out.y[i+1] = get_y(max_index);
+        prev_index = max_index;
+    }
+    out.x[M-1] = float(N-1);
+    out.y[M-1] = get_y(N-1);
+}
+
+void downsample_lttb(tcb::span<const float> y, const size_t total_points, Plot_Line& out) {
+    downsample_lttb(y.size(), [y](const size_t i) { return y[i]; }, total_points, out);
+}
+
+void downsample_lttb(tcb::span<const std::complex<float>> y, const bool is_imag, const size_t total_points, Plot_Line& out) {
+    if (is_imag) {
+        downsample_lttb(y.size(), [y](const size_t i) { return y[i].imag(); }, total_points, out);
+    } else {
+        downsample_lttb(y.size(), [y](const size_t i) { return y[i].real(); }, total_points, out);
+    }
+}
+
+void reset_plot_density(const size_t size, const float amplitude, Plot_Density& out, const float range_scale) {
+    out.size = size;
+    out.range = (amplitude > 0.0f) ? (amplitude*range_scale) : 1.0f;
+    out.max_count = 0.0f;
+    out.counts.resize(size*size);
+    std::fill(out.counts.begin(), out.counts.end(), 0.0f);
+}
+
+void accumulate_plot_density(tcb::span<const std::complex<float>> points, Plot_Density& out) {
+    const size_t N = out.size;
+    if (N == 0) return;
+    const float scale = float(N)/(2.0f*out.range);
+    for (const auto& x: points) {
+        const float col = (x.real() + out.range)*scale;
+        // the top row is +range
+        const float row = (out.range - x.imag())*scale;
+        if ((col < 0.0f) || (row < 0.0f) || (col >= float(N)) || (row >= float(N))) continue;
+        float& count = out.counts[size_t(row)*N + size_t(col)];
+        count += 1.0f;
+        out.max_count = std::max(out.max_count, count);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <complex>
+#include <vector>
+#include "utility/span.h"
+
+// Fixed size buffers that a view can draw without going over every sample of the demodulator
+// These are filled outside of the GUI thread so rendering only costs the size of the plot
+
+// Minimum and maximum of each block of samples so narrow peaks and nulls of a spectrum stay visible
+// Block i starts at sample i*x_scale
+struct Plot_Envelope {
+    float x_scale = 1.0f;
+    std::vector<float> y_min;
+    std::vector<float> y_max;
+};
+
+// Samples of a time series picked with largest triangle three buckets (LTTB)
+// which keeps the shape of the series with far fewer points than it has
+struct Plot_Line {
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+// Counts of the points of a constellation in a grid of size*size cells over [-range,+range]
+// Stored row major from the top row so it can be drawn as a heatmap
+struct Plot_Density {
+    size_t size = 0;
+    float range = 0.0f;
+    float max_count = 0.0f;
+    std::vector<float> counts;
+};
+
+// y is split into total_blocks blocks of about the same length
+// If y is shorter than total_blocks each sample is its own block
+void downsample_min_max(tcb::span<const float> y, const size_t total_blocks, Plot_Envelope& out);
+// Magnitude spectrum in dB with zero frequency in the centre block
+// NOTE: This is the same layout as the magnitude spectrum that coarse frequency synchronisation searches
+void downsample_magnitude_spectrum(
+    tcb::span<const std::complex<float>> fft, const size_t total_blocks, Plot_Envelope& out,
+    const float scale=20.0f
+);
+// The first and last samples are always kept and x is the sample index
+// If y has no more than total_points samples it is copied as is
+void downsample_lttb(tcb::span<const float> y, const size_t total_points, Plot_Line& out);
+// Same as downsample_lttb on the real or imaginary part of each sample
+void downsample_lttb(tcb::span<const std::complex<float>> y, const bool is_imag, const size_t total_points, Plot_Line& out);
+
+// Clears the grid and sets its range to range_scale times the average amplitude of a fixed amplitude modulation
+// NOTE: An amplitude of 0 gives a range of 1
+void reset_plot_density(const size_t size, const float amplitude, Plot_Density& out, const float range_scale=2.0f);
+// Adds the points which are inside of the range to the grid
+void accumulate_plot_density(tcb::span<const std::complex<float>> points, Plot_Density& out);
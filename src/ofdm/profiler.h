@@ -1,231 +1,347 @@
 #pragma once
 
+// Scoped timers for the OFDM demodulator threads
+// Profiling is enabled by building with PROFILE_ENABLE=1 (cmake option OFDM_CORE_USE_PROFILER)
+// Otherwise the PROFILE_* macros compile to nothing
+// Hardware counters (cycles, instructions, cache and branch misses) can also be recorded for each scope
+// by calling Profiler::SetIsHardwareCounters() which tells memory bound stages apart from compute bound ones
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE 0
+#endif
+
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <thread>
-#include <unordered_map>
-#include <utility>
+#include <string>
 #include <vector>
+#include "./profiler_hw_counters.h"
 
 // Crossplatform pretty function
 #ifdef _MSC_VER
 #define __PRETTY_FUNCTION__ __FUNCSIG__
 #endif
 
-// Get time stamps
-static std::chrono::time_point<std::chrono::high_resolution_clock> GetNow() {
-    return std::chrono::high_resolution_clock::now();
-}
-
-static int64_t ConvertMillis(const std::chrono::time_point<std::chrono::high_resolution_clock>& time) {
-    return std::chrono::time_point_cast<std::chrono::milliseconds>(time).time_since_epoch().count();
-}
-
-static int64_t ConvertMicros(const std::chrono::time_point<std::chrono::high_resolution_clock>& time) {
-    return std::chrono::time_point_cast<std::chrono::microseconds>(time).time_since_epoch().count();
-}
-
-static int64_t ConvertNanos(const std::chrono::time_point<std::chrono::high_resolution_clock>& time) {
-    return std::chrono::time_point_cast<std::chrono::nanoseconds>(time).time_since_epoch().count();
-}
-
+// Times are in nanoseconds since the profiler was created
 struct ProfileResult
 {
     const char* name;
     int stack_index;
     int64_t start, end;
+    // zero if hardware counters weren't recorded for this scope
+    Profile_HW_Counter_Values counters{};
 };
 
-// Store stack trace for each thread
-class InstrumentorThread 
+// Events with the same name summed over the rings of every thread, see Profiler::GetStageSummaries()
+struct ProfileStageSummary
+{
+    const char* name = nullptr;
+    uint64_t total_calls = 0;
+    int64_t total_ns = 0;
+    Profile_HW_Counter_Values counters{};
+    uint64_t GetCounter(const Profile_HW_Counter counter) const { return counters[size_t(counter)]; }
+    // Misses per thousand instructions are comparable between stages that do different amounts of work
+    double GetPerKiloInstructions(const Profile_HW_Counter counter) const {
+        const uint64_t instructions = GetCounter(Profile_HW_Counter::INSTRUCTIONS);
+        return (instructions > 0) ? double(GetCounter(counter))*1e3/double(instructions) : 0.0;
+    }
+    double GetInstructionsPerCycle() const {
+        const uint64_t cycles = GetCounter(Profile_HW_Counter::CYCLES);
+        return (cycles > 0) ? double(GetCounter(Profile_HW_Counter::INSTRUCTIONS))/double(cycles) : 0.0;
+    }
+};
+
+// Events of a thread are written into a fixed size ring without locks
+// Readers can take a snapshot at any time while the thread keeps writing
+class ProfilerThread
 {
 public:
-    typedef std::vector<ProfileResult> profile_trace_t;
-    struct TraceLog {
-        int count = 0;
-        profile_trace_t trace;
-    };
-    typedef std::unordered_map<uint64_t, TraceLog> profile_trace_logger_t;
     struct Descriptor {
         size_t symbol_start = 0;
         size_t symbol_end = 0;
     };
+    static constexpr size_t TOTAL_EVENTS = 4096;
 private:
-    const char* m_label = "";
-    std::optional<Descriptor> m_data = std::nullopt;
-
-    // Log all traces with a unique hash
-    bool m_is_trace_logging = false;
-    // Log a single snapshot of the unique trace, or continuously update it
-    bool m_is_trace_logging_snapshot = true;
-
+    static_assert((TOTAL_EVENTS & (TOTAL_EVENTS-1)) == 0, "Total events must be a power of two");
+    // NOTE: Fields are relaxed atomics so a reader racing the writer gets a stale value instead of undefined behaviour
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int> stack_index{0};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> end{0};
+        std::array<std::atomic<uint64_t>, TOTAL_PROFILE_HW_COUNTERS> counters{};
+    };
+    const int m_index;
+    std::array<Event, TOTAL_EVENTS> m_events;
+    std::atomic<uint64_t> m_write_index{0};
+    // only accessed by the owning thread
     int m_stack_index = 0;
-    int m_results_length = 0;
-    profile_trace_t m_results;
-    profile_trace_t m_prev_results;
-
-    // Log all unique stack traces
-    // This is useful if the stack trace varies each call and we are interested 
-    // in profiling each of these possible variations
-    profile_trace_logger_t m_profiler_logger;
-
-    std::mutex m_mutex_prev_results;
-    std::mutex m_mutex_profiler_logger;
+    Profile_HW_Counter_Group m_hw_counters;
+    bool m_is_hw_counters_opened = false;
+    std::atomic<const char*> m_label{""};
+    std::atomic<bool> m_is_active{true};
+    // set once when a thread starts so this doesn't need to be lock free
+    std::optional<Descriptor> m_data = std::nullopt;
+    mutable std::mutex m_mutex_data;
 public:
-    InstrumentorThread() {
-        m_results.reserve(200);
-        m_prev_results.reserve(200);
-    }
+    explicit ProfilerThread(const int index): m_index(index) {}
+    int GetIndex() const { return m_index; }
 
-    std::pair<int,int> PushStackIndex() { 
-        m_stack_index++; 
-        m_results_length++;
-        m_results.resize(m_results_length);
-        return {m_stack_index-1, m_results_length-1};
+    int PushStackIndex() { return m_stack_index++; }
+    void WriteProfile(const ProfileResult& res) {
+        m_stack_index--;
+        const uint64_t index = m_write_index.load(std::memory_order_relaxed);
+        auto& event = m_events[index & (TOTAL_EVENTS-1)];
+        event.name.store(res.name, std::memory_order_relaxed);
+        event.stack_index.store(res.stack_index, std::memory_order_relaxed);
+        event.start.store(res.start, std::memory_order_relaxed);
+        event.end.store(res.end, std::memory_order_relaxed);
+        for (size_t i = 0; i < TOTAL_PROFILE_HW_COUNTERS; i++) {
+            event.counters[i].store(res.counters[i], std::memory_order_relaxed);
+        }
+        m_write_index.store(index+1, std::memory_order_release);
     }
 
-    void WriteProfile(ProfileResult&& res, int result_index) {
-        m_results[result_index] = res;
-        PopStackIndex();
+    // Copies the most recent events in the order they finished
+    // Events that were overwritten while being copied are left out
+    void GetSnapshot(std::vector<ProfileResult>& events) const {
+        events.clear();
+        const uint64_t write_index = m_write_index.load(std::memory_order_acquire);
+        const uint64_t read_index = (write_index > TOTAL_EVENTS) ? (write_index-TOTAL_EVENTS) : 0;
+        events.reserve(size_t(write_index-read_index));
+        for (uint64_t i = read_index; i < write_index; i++) {
+            const auto& event = m_events[i & (TOTAL_EVENTS-1)];
+            ProfileResult res {
+                event.name.load(std::memory_order_relaxed),
+                event.stack_index.load(std::memory_order_relaxed),
+                event.start.load(std::memory_order_relaxed),
+                event.end.load(std::memory_order_relaxed),
+            };
+            for (size_t j = 0; j < TOTAL_PROFILE_HW_COUNTERS; j++) {
+                res.counters[j] = event.counters[j].load(std::memory_order_relaxed);
+            }
+            events.push_back(res);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t new_write_index = m_write_index.load(std::memory_order_relaxed);
+        const uint64_t new_read_index = (new_write_index > TOTAL_EVENTS) ? (new_write_index-TOTAL_EVENTS) : 0;
+        if (new_read_index > read_index) {
+            const size_t total_overwritten = size_t(std::min(new_read_index-read_index, write_index-read_index));
+            events.erase(events.begin(), events.begin() + total_overwritten);
+        }
     }
 
-    auto& GetPrevTrace() { return m_prev_results; }
-    auto& GetPrevTraceMutex() { return m_mutex_prev_results; }
-    auto& GetTraceLogs() { return m_profiler_logger; }
-    auto& GetTraceLogsMutex() { return m_mutex_profiler_logger; }
+    // Only called by the owning thread which opens its counters the first time
+    // Returns false if the counters aren't supported or permitted
+    bool ReadHardwareCounters(Profile_HW_Counter_Values& values) {
+        if (!m_is_hw_counters_opened) {
+            m_is_hw_counters_opened = true;
+            m_hw_counters.Open();
+        }
+        return m_hw_counters.Read(values);
+    }
+    bool GetIsHardwareCountersOpen() const { return m_hw_counters.GetIsOpen(); }
 
-    const char* GetLabel() const { return m_label; }
-    void SetLabel(const char* _label) { m_label = _label; }
+    const char* GetLabel() const { return m_label.load(std::memory_order_relaxed); }
+    void SetLabel(const char* label) { m_label.store(label, std::memory_order_relaxed); }
 
-    void SetData(const std::optional<Descriptor>& data) { m_data = data; }
-    const auto& GetData() const { return m_data; }
+    void SetData(const std::optional<Descriptor>& data) {
+        auto lock = std::scoped_lock(m_mutex_data);
+        m_data = data;
+    }
+    std::optional<Descriptor> GetData() const {
+        auto lock = std::scoped_lock(m_mutex_data);
+        return m_data;
+    }
 
-    void SetIsLogTraces(bool _is_trace_logging) { m_is_trace_logging = _is_trace_logging; }
-    bool GetIsLogTraces() const { return m_is_trace_logging; }
+    // Rings of threads that have exited are given to new threads
+    bool GetIsActive() const { return m_is_active.load(std::memory_order_relaxed); }
+    // NOTE: Events of the previous thread are kept until they are overwritten
+    bool TryAcquire() {
+        bool is_active = false;
+        if (!m_is_active.compare_exchange_strong(is_active, true, std::memory_order_acquire)) return false;
+        m_label.store("", std::memory_order_relaxed);
+        SetData(std::nullopt);
+        return true;
+    }
+    // The counters belong to the thread so the next thread opens its own
+    void Release() {
+        m_hw_counters.Close();
+        m_is_hw_counters_opened = false;
+        m_is_active.store(false, std::memory_order_release);
+    }
+};
 
-    void SetIsLogTracesSnapshot(bool _is_snapshot) { m_is_trace_logging_snapshot = _is_snapshot; }
-    bool GetIsLogTracesSnapshot() const { return m_is_trace_logging_snapshot; }
+// Owns the event rings of every thread
+class Profiler
+{
+private:
+    std::vector<std::unique_ptr<ProfilerThread>> m_threads;
+    mutable std::mutex m_mutex_threads;
+    const std::chrono::steady_clock::time_point m_time_base;
+    std::atomic<bool> m_is_hw_counters{false};
+    std::atomic<int> m_total_hw_counter_errors{0};
 private:
-    int PopStackIndex() { 
-        m_stack_index--; 
-        if (m_stack_index == 0) {
-            UpdateResults();
+    Profiler(): m_time_base(std::chrono::steady_clock::now()) {}
+public:
+    static Profiler& Get() {
+        static Profiler instance;
+        return instance;
+    }
+    // Only the first call on each thread locks
+    ProfilerThread& GetThread() {
+        struct Handle {
+            ProfilerThread* thread = nullptr;
+            ~Handle() { if (thread != nullptr) thread->Release(); }
+        };
+        thread_local Handle handle;
+        if (handle.thread == nullptr) {
+            handle.thread = &AcquireThread();
         }
-
-        return m_stack_index;
-    }
-    void UpdateResults() {
-        if (m_is_trace_logging) {
-            auto lock = std::scoped_lock(m_mutex_profiler_logger);
-            const auto key = CalculateHash(m_results);
-            auto res = m_profiler_logger.find(key);
-            if (res == m_profiler_logger.end()) {
-                m_profiler_logger.insert({key, {1, m_results}});
-            } else {
-                res->second.count++;
-                // We continously update the unique trace
-                if (!m_is_trace_logging_snapshot) {
-                    res->second.trace = m_results;
+        return *handle.thread;
+    }
+    // Each scope reads the counters of its thread when it starts and stops (a syscall each on linux)
+    void SetIsHardwareCounters(const bool is_enabled) { m_is_hw_counters.store(is_enabled, std::memory_order_relaxed); }
+    bool GetIsHardwareCounters() const { return m_is_hw_counters.load(std::memory_order_relaxed); }
+    // Number of reads that failed because the counters couldn't be opened
+    int GetTotalHardwareCounterErrors() const { return m_total_hw_counter_errors.load(std::memory_order_relaxed); }
+    void OnHardwareCounterError() { m_total_hw_counter_errors.fetch_add(1, std::memory_order_relaxed); }
+    int64_t GetTimeNanos() const {
+        const auto dt = std::chrono::steady_clock::now() - m_time_base;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count();
+    }
+    // NOTE: Threads are never deleted so these stay valid
+    std::vector<ProfilerThread*> GetThreads() const {
+        auto lock = std::scoped_lock(m_mutex_threads);
+        std::vector<ProfilerThread*> threads;
+        threads.reserve(m_threads.size());
+        for (auto& thread: m_threads) threads.push_back(thread.get());
+        return threads;
+    }
+    // Per stage aggregate of the events that are still in the rings
+    // Scopes are grouped by name so the same stage across many threads is summed together
+    std::vector<ProfileStageSummary> GetStageSummaries() const {
+        std::vector<ProfileStageSummary> summaries;
+        std::vector<ProfileResult> events;
+        for (auto* thread: GetThreads()) {
+            thread->GetSnapshot(events);
+            for (const auto& event: events) {
+                if (event.name == nullptr) continue;
+                auto it = std::find_if(summaries.begin(), summaries.end(), [&event](const ProfileStageSummary& summary) {
+                    return (summary.name == event.name) || (strcmp(summary.name, event.name) == 0);
+                });
+                if (it == summaries.end()) {
+                    summaries.push_back({});
+                    it = summaries.end()-1;
+                    it->name = event.name;
                 }
+                it->total_calls++;
+                it->total_ns += event.end-event.start;
+                for (size_t i = 0; i < TOTAL_PROFILE_HW_COUNTERS; i++) it->counters[i] += event.counters[i];
             }
         }
-        {
-            auto lock = std::scoped_lock(m_mutex_prev_results);
-            std::swap(m_results, m_prev_results);
-            m_results_length = 0;
-        }
+        return summaries;
     }
-    uint64_t CalculateHash(const profile_trace_t& stack_trace) const {
-        uint64_t hash = 0;
-        hash = (hash >> 32) ^ (hash << 32) ^ stack_trace.size();
-        for (const auto& e: stack_trace) {
-            hash = (hash >> 32) ^ (hash << 32) ^ e.stack_index;
-            // if (e.stack_index >= 2) continue;
-            if (e.name != nullptr) {
-                for (const char* c = e.name; (*c) != 0; c++) {
-                    hash = (hash >> 8) ^ (hash << 8) ^ (uint64_t)(*c);
+    // Chrome trace event format which can be opened in chrome://tracing or https://ui.perfetto.dev
+    std::string ExportChromeTrace() const {
+        std::string out;
+        char buf[128];
+        out.append("{\"traceEvents\":[");
+        bool is_first = true;
+        std::vector<ProfileResult> events;
+        for (auto* thread: GetThreads()) {
+            snprintf(buf, sizeof(buf), "%s{\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+                is_first ? "" : ",", thread->GetIndex());
+            out.append(buf);
+            AppendJSONString(out, thread->GetLabel());
+            out.append("}}");
+            is_first = false;
+            thread->GetSnapshot(events);
+            for (const auto& event: events) {
+                if (event.name == nullptr) continue;
+                snprintf(buf, sizeof(buf), ",{\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                    thread->GetIndex(), double(event.start)*1e-3, double(event.end-event.start)*1e-3);
+                out.append(buf);
+                AppendJSONString(out, event.name);
+                if (event.counters[size_t(Profile_HW_Counter::CYCLES)] > 0) {
+                    snprintf(buf, sizeof(buf), 
+                        ",\"args\":{\"cycles\":%llu,\"instructions\":%llu,\"l1d_misses\":%llu,"
+                        "\"llc_misses\":%llu,\"branch_misses\":%llu}",
+                        (unsigned long long)event.counters[0], (unsigned long long)event.counters[1],
+                        (unsigned long long)event.counters[2], (unsigned long long)event.counters[3],
+                        (unsigned long long)event.counters[4]);
+                    out.append(buf);
                 }
+                out.append("}");
             }
         }
-        return hash;
+        out.append("]}");
+        return out;
     }
-};
-
-// Store instrumentation for each thread
-class Instrumentor
-{
 private:
-    std::unordered_map<std::thread::id, InstrumentorThread> m_threads;
-    std::vector<std::pair<std::thread::id, InstrumentorThread&>> m_threads_ref_list;
-    std::mutex m_mutex_threads_list;
-    int64_t m_base_dt;
-private:
-    Instrumentor()
-    {
-        m_threads_ref_list.reserve(100);
-        m_base_dt = ConvertMicros(GetNow());
-    }
-public:
-    InstrumentorThread& GetInstrumentorThread(std::thread::id id) {
-        auto lock = std::unique_lock(m_mutex_threads_list);
-        auto res = m_threads.find(id);
-        if (res == m_threads.end()) {
-            res = m_threads.try_emplace(id).first;
-            m_threads_ref_list.push_back({id, res->second});
+    ProfilerThread& AcquireThread() {
+        auto lock = std::scoped_lock(m_mutex_threads);
+        for (auto& thread: m_threads) {
+            if (thread->TryAcquire()) return *thread;
         }
-        return res->second;
+        m_threads.push_back(std::make_unique<ProfilerThread>(int(m_threads.size())));
+        return *m_threads.back();
     }
-    InstrumentorThread& GetInstrumentorThread(void) {
-        return GetInstrumentorThread(std::this_thread::get_id());
-    }
-    auto& GetMutexThreadsList() { return m_mutex_threads_list; }
-    auto& GetThreadsList() { return m_threads_ref_list; }
-    const auto& GetBase() { return m_base_dt; }
-    static Instrumentor& Get() {
-        static Instrumentor instance;
-        return instance;
+    static void AppendJSONString(std::string& out, const char* str) {
+        out.push_back('"');
+        for (const char* c = str; (*c) != 0; c++) {
+            if (((*c) == '"') || ((*c) == '\\')) out.push_back('\\');
+            out.push_back(*c);
+        }
+        out.push_back('"');
     }
 };
 
 // Scoped timer
+// NOTE: Counters are read after the start time and before the end time so they don't include the clock reads
 class InstrumentationTimer
 {
 private:
+    ProfilerThread& m_thread;
     const char* m_name;
-    bool m_is_stopped;
-    int m_stack_index;
-    int m_result_index;
-    std::chrono::time_point<std::chrono::high_resolution_clock> m_time_start;
-    InstrumentorThread* m_thread_ptr;
-    std::thread::id m_thread_id;
+    const int m_stack_index;
+    const int64_t m_time_start;
+    bool m_is_counters = false;
+    Profile_HW_Counter_Values m_counters_start;
+    bool m_is_stopped = false;
 public:
     explicit InstrumentationTimer(const char* name)
-    : m_name(name), m_is_stopped(false)
+    : m_thread(Profiler::Get().GetThread()), m_name(name),
+      m_stack_index(m_thread.PushStackIndex()), m_time_start(Profiler::Get().GetTimeNanos()) 
     {
-        m_thread_id = std::this_thread::get_id();
-        auto& thread = Instrumentor::Get().GetInstrumentorThread(m_thread_id);
-        m_thread_ptr = &thread;
-        auto res = m_thread_ptr->PushStackIndex();
-        m_stack_index = res.first;
-        m_result_index = res.second;
-        m_time_start = GetNow();
-    }
-
-    ~InstrumentationTimer() {
-        if (!m_is_stopped) {
-            Stop();
+        auto& profiler = Profiler::Get();
+        if (profiler.GetIsHardwareCounters()) {
+            m_is_counters = m_thread.ReadHardwareCounters(m_counters_start);
+            if (!m_is_counters) profiler.OnHardwareCounterError();
         }
     }
-
+    ~InstrumentationTimer() { Stop(); }
     void Stop() {
+        if (m_is_stopped) return;
         m_is_stopped = true;
-        auto time_end = GetNow();
-        auto dt_start = ConvertMicros(m_time_start) - Instrumentor::Get().GetBase();
-        auto dt_end = ConvertMicros(time_end) - Instrumentor::Get().GetBase();
-        m_thread_ptr->WriteProfile({ m_name, m_stack_index, dt_start, dt_end }, m_result_index);
+        ProfileResult res { m_name, m_stack_index, m_time_start, 0 };
+        if (m_is_counters) {
+            Profile_HW_Counter_Values counters_end;
+            if (m_thread.ReadHardwareCounters(counters_end)) {
+                for (size_t i = 0; i < TOTAL_PROFILE_HW_COUNTERS; i++) {
+                    res.counters[i] = counters_end[i]-m_counters_start[i];
+                }
+            }
+        }
+        res.end = Profiler::Get().GetTimeNanos();
+        m_thread.WriteProfile(res);
     }
 };
 
@@ -235,14 +351,10 @@ public:
 #define PROFILE_END(label) (void)0
 #define PROFILE_TAG_THREAD(label) (void)0
 #define PROFILE_TAG_DATA_THREAD(data) (void)0
-#define PROFILE_ENABLE_TRACE_LOGGING(is_log) (void)0
-#define PROFILE_ENABLE_TRACE_LOGGING_CONTINUOUS(is_continuous) (void)0
 #else
 #define PROFILE_BEGIN_FUNC() auto timer_func = InstrumentationTimer(__PRETTY_FUNCTION__)
 #define PROFILE_BEGIN(label) auto timer_##label = InstrumentationTimer(#label)
 #define PROFILE_END(label) timer_##label.Stop()
-#define PROFILE_TAG_THREAD(label) Instrumentor::Get().GetInstrumentorThread().SetLabel(label)
-#define PROFILE_TAG_DATA_THREAD(data) Instrumentor::Get().GetInstrumentorThread().SetData(data)
-#define PROFILE_ENABLE_TRACE_LOGGING(is_log) Instrumentor::Get().GetInstrumentorThread().SetIsLogTraces(is_log) 
-#define PROFILE_ENABLE_TRACE_LOGGING_CONTINUOUS(is_continuous) Instrumentor::Get().GetInstrumentorThread().SetIsLogTracesSnapshot(!is_continuous)
-#endif
\ No newline at end of file
+#define PROFILE_TAG_THREAD(label) Profiler::Get().GetThread().SetLabel(label)
+#define PROFILE_TAG_DATA_THREAD(data) Profiler::Get().GetThread().SetData(data)
+#endif
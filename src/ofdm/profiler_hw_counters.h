@@ -0,0 +1,146 @@
+#pragma once
+
+// Hardware performance counters of the calling thread for the profiler
+// Linux uses perf_event_open() which requires kernel.perf_event_paranoid <= 2 (user space only counting)
+// Other platforms and kernels that refuse the counters report them as unavailable
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+enum class Profile_HW_Counter: uint8_t {
+    CYCLES = 0,
+    INSTRUCTIONS = 1,
+    L1D_MISSES = 2,
+    LLC_MISSES = 3,
+    BRANCH_MISSES = 4,
+};
+
+constexpr size_t TOTAL_PROFILE_HW_COUNTERS = 5;
+using Profile_HW_Counter_Values = std::array<uint64_t, TOTAL_PROFILE_HW_COUNTERS>;
+
+// Counters are opened as one group so they are always scheduled together and can be read with one syscall
+// NOTE: Only the thread that opened the group is counted
+class Profile_HW_Counter_Group
+{
+private:
+    int m_fds[TOTAL_PROFILE_HW_COUNTERS];
+    uint64_t m_ids[TOTAL_PROFILE_HW_COUNTERS];
+    bool m_is_open = false;
+public:
+    Profile_HW_Counter_Group() {
+        for (auto& fd: m_fds) fd = -1;
+        for (auto& id: m_ids) id = 0;
+    }
+    ~Profile_HW_Counter_Group() { Close(); }
+    Profile_HW_Counter_Group(const Profile_HW_Counter_Group&) = delete;
+    Profile_HW_Counter_Group& operator=(const Profile_HW_Counter_Group&) = delete;
+    bool GetIsOpen() const { return m_is_open; }
+    // Counters the CPU doesn't have (e.g. inside some VMs) are left out and read as 0
+    // Returns false if the cycle counter which leads the group couldn't be opened
+    bool Open() {
+        Close();
+#if defined(__linux__)
+        for (size_t i = 0; i < TOTAL_PROFILE_HW_COUNTERS; i++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            SetEventType(Profile_HW_Counter(i), attr);
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            const int leader_fd = m_fds[0];
+            attr.disabled = (leader_fd < 0) ? 1 : 0;
+            const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd, 0);
+            if (fd < 0) {
+                if (i == 0) return false;
+                continue;
+            }
+            m_fds[i] = int(fd);
+            ioctl(m_fds[i], PERF_EVENT_IOC_ID, &m_ids[i]);
+        }
+        ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        m_is_open = true;
+        return true;
+#else
+        return false;
+#endif
+    }
+    void Close() {
+#if defined(__linux__)
+        for (auto& fd: m_fds) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+#endif
+        m_is_open = false;
+    }
+    // Running totals since the group was opened
+    // If the kernel had to multiplex the group with other events the values are scaled up to the enabled time
+    bool Read(Profile_HW_Counter_Values& values) const {
+        values.fill(0);
+        if (!m_is_open) return false;
+#if defined(__linux__)
+        struct {
+            uint64_t nr;
+            uint64_t time_enabled;
+            uint64_t time_running;
+            struct { uint64_t value; uint64_t id; } entries[TOTAL_PROFILE_HW_COUNTERS];
+        } data;
+        const ssize_t nb_read = read(m_fds[0], &data, sizeof(data));
+        if (nb_read <= 0) return false;
+        const double scale =
+            ((data.time_running > 0) && (data.time_running < data.time_enabled)) ?
+            double(data.time_enabled)/double(data.time_running) : 1.0;
+        const size_t N = std::min(size_t(data.nr), TOTAL_PROFILE_HW_COUNTERS);
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = 0; j < TOTAL_PROFILE_HW_COUNTERS; j++) {
+                if ((m_fds[j] < 0) || (m_ids[j] != data.entries[i].id)) continue;
+                values[j] = uint64_t(double(data.entries[i].value)*scale);
+                break;
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+private:
+#if defined(__linux__)
+    static void SetEventType(const Profile_HW_Counter counter, perf_event_attr& attr) {
+        switch (counter) {
+        case Profile_HW_Counter::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case Profile_HW_Counter::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case Profile_HW_Counter::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config =
+                uint64_t(PERF_COUNT_HW_CACHE_L1D) |
+                (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+                (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+            break;
+        case Profile_HW_Counter::LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case Profile_HW_Counter::BRANCH_MISSES:
+        default:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+    }
+#endif
+};
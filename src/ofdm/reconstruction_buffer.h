@@ -1,12 +1,15 @@
 #pragma once
 
 #include <stddef.h>
+#include <cstring>
+#include <type_traits>
 #include "utility/span.h"
 
 // reconstruct a block of size M from blocks of size N
 template <typename T>
 class ReconstructionBuffer 
 {
+    static_assert(std::is_trivially_copyable_v<T>, "ReconstructionBuffer copies with memcpy");
 private:
     tcb::span<T>& m_buf;
     size_t m_length;
@@ -18,9 +21,8 @@ public:
         const size_t N = src.size();
         const size_t N_required = Capacity()-m_length;
         const size_t nb_read = (N_required >= N) ? N : N_required;
-        auto wr_buf = m_buf.subspan(m_length, nb_read);
-        for (size_t i = 0; i < nb_read; i++) {
-            wr_buf[i] = src[i];
+        if (nb_read > 0) {
+            std::memcpy(&m_buf[m_length], src.data(), nb_read*sizeof(T));
         }
         m_length += nb_read;
         return nb_read;
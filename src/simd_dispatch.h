@@ -0,0 +1,260 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include "./detect_architecture.h"
+#include "./simd_flags.h" // NOLINT
+
+// Runtime selection of SIMD kernels so a single binary runs at full speed on every host
+// On x86 the kernels of every instruction set are compiled and the best one supported by the CPU is picked
+// The rest of the binary only requires the instruction sets given by the compiler flags
+// Scalable vector kernels (ARM SVE2 and RISC-V RVV) are only compiled when the compiler flags enable them
+// since their intrinsics can't be enabled per function on every compiler. They are vector length agnostic
+// so the same kernel uses the full width of any implementation, and NEON remains selectable on SVE2 hosts
+// Supported flags:
+// SIMD_DISABLE_RUNTIME_DISPATCH = only compile kernels allowed by the compiler flags
+// SIMD_RUNTIME_DISPATCH         = defined if kernels are selected at runtime
+// SIMD_COMPILE_<LEVEL>          = defined if kernels for an instruction set are compiled
+// SIMD_TARGET_<LEVEL>           = attribute that enables an instruction set for a kernel
+// SIMD_IGNORE_UNINITIALIZED_*   = wraps kernels which use intrinsics that have false compiler warnings
+
+#if defined(__ARCH_X86__) && !defined(SIMD_DISABLE_RUNTIME_DISPATCH)
+    #define SIMD_RUNTIME_DISPATCH
+#endif
+
+#if defined(SIMD_RUNTIME_DISPATCH) || defined(__SSE4_1__)
+    #define SIMD_COMPILE_SSE4_1
+#endif
+#if defined(SIMD_RUNTIME_DISPATCH) || defined(__AVX__)
+    #define SIMD_COMPILE_AVX
+#endif
+#if defined(SIMD_RUNTIME_DISPATCH) || defined(__AVX2__)
+    #define SIMD_COMPILE_AVX2
+#endif
+#if defined(SIMD_RUNTIME_DISPATCH) || (defined(__AVX512F__) && defined(__AVX512BW__))
+    #define SIMD_COMPILE_AVX512
+#endif
+#if defined(__SIMD_SVE2__)
+    #define SIMD_COMPILE_SVE2
+#endif
+#if defined(__SIMD_RVV__)
+    #define SIMD_COMPILE_RVV
+#endif
+// Carryless multiplication has its own CPUID flag and is checked with simd_is_pclmul_supported()
+#if defined(SIMD_RUNTIME_DISPATCH) || (defined(__PCLMUL__) && defined(__SSE4_1__))
+    #define SIMD_COMPILE_PCLMUL
+#endif
+
+// MSVC allows intrinsics for any instruction set without marking the function
+#if defined(SIMD_RUNTIME_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+    #define SIMD_TARGET_SSE4_1 __attribute__((target("sse4.1")))
+    #define SIMD_TARGET_AVX __attribute__((target("avx")))
+    #define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma")))
+    #define SIMD_TARGET_PCLMUL __attribute__((target("sse4.1,pclmul")))
+#else
+    #define SIMD_TARGET_SSE4_1
+    #define SIMD_TARGET_AVX
+    #define SIMD_TARGET_AVX2
+    #define SIMD_TARGET_AVX512
+    #define SIMD_TARGET_PCLMUL
+#endif
+
+// Enables an instruction set for all functions in a region
+// This is used for third party headers whose functions we can't mark individually
+#if defined(SIMD_RUNTIME_DISPATCH) && defined(__clang__)
+    #define SIMD_TARGET_PUSH_SSE4_1 _Pragma("clang attribute push (__attribute__((target(\"sse4.1\"))), apply_to=function)")
+    #define SIMD_TARGET_PUSH_AVX2 _Pragma("clang attribute push (__attribute__((target(\"avx2,fma\"))), apply_to=function)")
+    #define SIMD_TARGET_POP _Pragma("clang attribute pop")
+#elif defined(SIMD_RUNTIME_DISPATCH) && defined(__GNUC__)
+    #define SIMD_TARGET_PUSH_SSE4_1 _Pragma("GCC push_options") _Pragma("GCC target(\"sse4.1\")")
+    #define SIMD_TARGET_PUSH_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+    #define SIMD_TARGET_POP _Pragma("GCC pop_options")
+#else
+    #define SIMD_TARGET_PUSH_SSE4_1
+    #define SIMD_TARGET_PUSH_AVX2
+    #define SIMD_TARGET_POP
+#endif
+
+// GCC 12 reports a false uninitialised warning for intrinsics that are implemented with _mm*_undefined_*()
+// This occurs with most AVX512 intrinsics and the AVX2 gathers
+#if defined(__GNUC__) && !defined(__clang__)
+    #define SIMD_IGNORE_UNINITIALIZED_PUSH \
+        _Pragma("GCC diagnostic push") \
+        _Pragma("GCC diagnostic ignored \"-Wuninitialized\"") \
+        _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+    #define SIMD_IGNORE_UNINITIALIZED_POP _Pragma("GCC diagnostic pop")
+#else
+    #define SIMD_IGNORE_UNINITIALIZED_PUSH
+    #define SIMD_IGNORE_UNINITIALIZED_POP
+#endif
+
+#if defined(SIMD_RUNTIME_DISPATCH) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Ordered from least to most capable within each architecture
+enum class SIMD_Level: int {
+    SCALAR=0, SSE4_1=1, AVX=2, AVX2=3, AVX512=4, NEON=5, SVE2=6, RVV=7,
+};
+
+static inline const char* simd_get_level_name(const SIMD_Level level) {
+    switch (level) {
+    case SIMD_Level::SCALAR: return "scalar";
+    case SIMD_Level::SSE4_1: return "sse4.1";
+    case SIMD_Level::AVX:    return "avx";
+    case SIMD_Level::AVX2:   return "avx2";
+    case SIMD_Level::AVX512: return "avx512";
+    case SIMD_Level::NEON:   return "neon";
+    case SIMD_Level::SVE2:   return "sve2";
+    case SIMD_Level::RVV:    return "rvv";
+    default:                 return "unknown";
+    }
+}
+
+// Returns false if the name doesn't match a level
+static inline bool simd_get_level_from_name(const char* name, SIMD_Level& level) {
+    for (int i = int(SIMD_Level::SCALAR); i <= int(SIMD_Level::RVV); i++) {
+        if (strcmp(name, simd_get_level_name(SIMD_Level(i))) == 0) {
+            level = SIMD_Level(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Most capable level supported by the CPU and the kernels that were compiled
+static inline SIMD_Level simd_get_supported_level() {
+#if defined(SIMD_RUNTIME_DISPATCH) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool is_sse4_1 = (info[2] & (1 << 19)) != 0;
+    const bool is_fma = (info[2] & (1 << 12)) != 0;
+    const bool is_osxsave = (info[2] & (1 << 27)) != 0;
+    const bool is_avx = (info[2] & (1 << 28)) != 0;
+    // the OS must also save the AVX registers on a context switch
+    const unsigned long long xcr0 = is_osxsave ? _xgetbv(0) : 0;
+    const bool is_ymm_saved = (xcr0 & 0x06) == 0x06;
+    const bool is_zmm_saved = (xcr0 & 0xE6) == 0xE6;
+    bool is_avx2 = false;
+    bool is_avx512 = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        is_avx2 = (info[1] & (1 << 5)) != 0;
+        const bool is_avx512f = (info[1] & (1 << 16)) != 0;
+        const bool is_avx512dq = (info[1] & (1 << 17)) != 0;
+        const bool is_avx512bw = (info[1] & (1 << 30)) != 0;
+        const bool is_avx512vl = (info[1] & (1 << 31)) != 0;
+        is_avx512 = is_avx512f && is_avx512dq && is_avx512bw && is_avx512vl;
+    }
+    if (is_avx512 && is_avx2 && is_fma && is_zmm_saved) return SIMD_Level::AVX512;
+    if (is_avx2 && is_fma && is_ymm_saved) return SIMD_Level::AVX2;
+    if (is_avx && is_ymm_saved) return SIMD_Level::AVX;
+    if (is_sse4_1) return SIMD_Level::SSE4_1;
+    return SIMD_Level::SCALAR;
+#elif defined(SIMD_RUNTIME_DISPATCH)
+    __builtin_cpu_init();
+    const bool is_avx512 =
+        __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+    const bool is_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (is_avx512 && is_avx2) return SIMD_Level::AVX512;
+    if (is_avx2) return SIMD_Level::AVX2;
+    if (__builtin_cpu_supports("avx")) return SIMD_Level::AVX;
+    if (__builtin_cpu_supports("sse4.1")) return SIMD_Level::SSE4_1;
+    return SIMD_Level::SCALAR;
+#elif defined(__ARCH_X86__)
+    #if defined(SIMD_COMPILE_AVX512)
+    return SIMD_Level::AVX512;
+    #elif defined(SIMD_COMPILE_AVX2)
+    return SIMD_Level::AVX2;
+    #elif defined(SIMD_COMPILE_AVX)
+    return SIMD_Level::AVX;
+    #elif defined(SIMD_COMPILE_SSE4_1)
+    return SIMD_Level::SSE4_1;
+    #else
+    return SIMD_Level::SCALAR;
+    #endif
+#elif defined(__ARCH_AARCH64__)
+    // NEON is mandatory for aarch64
+    #if defined(SIMD_COMPILE_SVE2)
+    return SIMD_Level::SVE2;
+    #else
+    return SIMD_Level::NEON;
+    #endif
+#elif defined(__ARCH_RISCV__) && defined(SIMD_COMPILE_RVV)
+    return SIMD_Level::RVV;
+#else
+    return SIMD_Level::SCALAR;
+#endif
+}
+
+// Kernels for x86 are cumulative so a level uses a kernel if it has at least its instruction set
+// SVE2 is a superset of NEON so both kernels can run on an SVE2 host
+// Kernels of another architecture are never used
+static inline bool simd_is_level_at_least(const SIMD_Level level, const SIMD_Level minimum) {
+    switch (minimum) {
+    case SIMD_Level::SCALAR: return true;
+    case SIMD_Level::NEON:   return (level == SIMD_Level::NEON) || (level == SIMD_Level::SVE2);
+    case SIMD_Level::SVE2:   return level == SIMD_Level::SVE2;
+    case SIMD_Level::RVV:    return level == SIMD_Level::RVV;
+    default:                 return (int(level) >= int(minimum)) && (int(level) <= int(SIMD_Level::AVX512));
+    }
+}
+
+static inline bool simd_is_level_supported(const SIMD_Level level) {
+    return simd_is_level_at_least(simd_get_supported_level(), level);
+}
+
+// -1 if a level hasn't been selected yet
+inline std::atomic<int> g_simd_selected_level{-1};
+
+// Override the selected level, e.g. for benchmarking or to work around a faulty kernel
+// Returns false if the level isn't supported on this CPU
+// NOTE: This should be called before any kernels are used
+static inline bool simd_set_level(const SIMD_Level level) {
+    if (!simd_is_level_supported(level)) {
+        return false;
+    }
+    g_simd_selected_level.store(int(level), std::memory_order_relaxed);
+    return true;
+}
+
+// The selected level defaults to the most capable supported level
+// It can be overridden with the environment variable DAB_SIMD_LEVEL=<name>
+static inline SIMD_Level simd_get_level() {
+    int level = g_simd_selected_level.load(std::memory_order_relaxed);
+    if (level >= 0) {
+        return SIMD_Level(level);
+    }
+
+    SIMD_Level selected = simd_get_supported_level();
+    const char* env_level = getenv("DAB_SIMD_LEVEL"); // NOLINT
+    SIMD_Level override_level;
+    if ((env_level != nullptr) && simd_get_level_from_name(env_level, override_level)) {
+        if (simd_is_level_supported(override_level)) {
+            selected = override_level;
+        }
+    }
+    g_simd_selected_level.store(int(selected), std::memory_order_relaxed);
+    return selected;
+}
+
+// Carryless multiplication is supported by the CPU and the kernels were compiled
+static inline bool simd_is_pclmul_supported() {
+#if defined(SIMD_RUNTIME_DISPATCH) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) != 0;
+#elif defined(SIMD_RUNTIME_DISPATCH)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul");
+#elif defined(SIMD_COMPILE_PCLMUL)
+    return true;
+#else
+    return false;
+#endif
+}
@@ -35,5 +35,14 @@
     #endif
 #elif defined(__ARCH_AARCH64__)
     #define __SIMD_NEON__
+    // Scalable vectors are optional and only enabled by the compiler flags, e.g. -march=armv9-a
+    #if defined(__ARM_FEATURE_SVE2)
+        #define __SIMD_SVE2__
+    #endif
+#elif defined(__ARCH_RISCV__)
+    // Vector extension 1.0, e.g. -march=rv64gcv
+    #if defined(__riscv_vector)
+        #define __SIMD_RVV__
+    #endif
 #else
 #endif
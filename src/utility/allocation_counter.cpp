@@ -0,0 +1,92 @@
+// Replaces the global operator new and operator delete to update the counters in allocation_counter.h
+// Only link this into executables which check for allocations (e.g. dab_benchmarks)
+// since every allocation in the process pays for an extra thread local and atomic increment
+#include "./allocation_counter.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+static void* allocate(size_t nb_bytes) {
+    if (nb_bytes == 0) nb_bytes = 1;
+    allocation_counter_detail::on_allocate(nb_bytes);
+    return malloc(nb_bytes);
+}
+
+static void* allocate_aligned(size_t nb_bytes, const std::align_val_t align_val) {
+    const size_t alignment = size_t(align_val);
+    if (nb_bytes == 0) nb_bytes = 1;
+    allocation_counter_detail::on_allocate(nb_bytes);
+#if defined(_MSC_VER)
+    return _aligned_malloc(nb_bytes, alignment);
+#else
+    // aligned_alloc requires the size to be a multiple of the alignment
+    nb_bytes = ((nb_bytes + alignment - 1) / alignment) * alignment;
+    return aligned_alloc(alignment, nb_bytes);
+#endif
+}
+
+static void deallocate(void* ptr) {
+    if (ptr == nullptr) return;
+    allocation_counter_detail::on_free();
+    free(ptr);
+}
+
+static void deallocate_aligned(void* ptr) {
+    if (ptr == nullptr) return;
+    allocation_counter_detail::on_free();
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static const bool is_hooked = []() {
+    allocation_counter_detail::is_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}();
+
+void* operator new(size_t nb_bytes) {
+    void* ptr = allocate(nb_bytes);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t nb_bytes) {
+    void* ptr = allocate(nb_bytes);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t nb_bytes, const std::nothrow_t&) noexcept {
+    return allocate(nb_bytes);
+}
+
+void* operator new[](size_t nb_bytes, const std::nothrow_t&) noexcept {
+    return allocate(nb_bytes);
+}
+
+void* operator new(size_t nb_bytes, std::align_val_t alignment) {
+    void* ptr = allocate_aligned(nb_bytes, alignment);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t nb_bytes, std::align_val_t alignment) {
+    void* ptr = allocate_aligned(nb_bytes, alignment);
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { deallocate_aligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { deallocate_aligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { deallocate_aligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { deallocate_aligned(ptr); }
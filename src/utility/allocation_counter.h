@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Counts heap allocations so a steady state path can be checked to not allocate after it has warmed up
+// The counters are only updated if allocation_counter.cpp is linked into the executable
+// since it replaces the global operator new and operator delete
+// NOTE: Without the hooks every count stays at zero and get_is_allocation_counter_enabled() is false
+
+struct Allocation_Counts {
+    uint64_t nb_allocations = 0;
+    uint64_t nb_bytes = 0;
+    uint64_t nb_frees = 0;
+    Allocation_Counts operator-(const Allocation_Counts& other) const {
+        return { nb_allocations-other.nb_allocations, nb_bytes-other.nb_bytes, nb_frees-other.nb_frees };
+    }
+};
+
+namespace allocation_counter_detail {
+    // constant initialised so it can be used by operator new while a thread is starting
+    inline thread_local Allocation_Counts thread_counts;
+    inline std::atomic<uint64_t> process_allocations{0};
+    inline std::atomic<uint64_t> process_bytes{0};
+    inline std::atomic<uint64_t> process_frees{0};
+    inline std::atomic<bool> is_enabled{false};
+
+    inline void on_allocate(const size_t nb_bytes) {
+        thread_counts.nb_allocations++;
+        thread_counts.nb_bytes += uint64_t(nb_bytes);
+        process_allocations.fetch_add(1, std::memory_order_relaxed);
+        process_bytes.fetch_add(uint64_t(nb_bytes), std::memory_order_relaxed);
+    }
+
+    inline void on_free() {
+        thread_counts.nb_frees++;
+        process_frees.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline bool get_is_allocation_counter_enabled() {
+    return allocation_counter_detail::is_enabled.load(std::memory_order_relaxed);
+}
+
+// Allocations made by the calling thread since it started
+inline Allocation_Counts get_thread_allocation_counts() {
+    return allocation_counter_detail::thread_counts;
+}
+
+// Allocations made by every thread since the process started
+// NOTE: The fields are read one at a time so they may be off by a few if other threads are allocating
+inline Allocation_Counts get_process_allocation_counts() {
+    using namespace allocation_counter_detail;
+    return {
+        process_allocations.load(std::memory_order_relaxed),
+        process_bytes.load(std::memory_order_relaxed),
+        process_frees.load(std::memory_order_relaxed),
+    };
+}
+
+// Allocations made between construction and a call to get_*_counts()
+// e.g. Wrap the processing of a single frame to get the allocations per frame
+class Allocation_Scope
+{
+private:
+    const Allocation_Counts m_thread_start;
+    const Allocation_Counts m_process_start;
+public:
+    Allocation_Scope()
+    : m_thread_start(get_thread_allocation_counts()), m_process_start(get_process_allocation_counts()) {}
+    // Only the calling thread
+    Allocation_Counts get_thread_counts() const { return get_thread_allocation_counts() - m_thread_start; }
+    // Includes worker threads of the demodulator and thread pool
+    Allocation_Counts get_process_counts() const { return get_process_allocation_counts() - m_process_start; }
+};
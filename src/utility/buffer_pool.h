@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Pool of byte buffers grouped into power of two size classes
+// Buffers are handed out as move-only Pooled_Buffer objects which return their storage on destruction
+// The pool state is reference counted so buffers can safely outlive the pool (e.g. slideshows kept by a gui)
+class Buffer_Pool
+{
+public:
+    static constexpr size_t MIN_CLASS_BITS = 10;    // 1kB
+    static constexpr size_t MAX_CLASS_BITS = 21;    // 2MB
+    static constexpr size_t TOTAL_CLASSES = MAX_CLASS_BITS-MIN_CLASS_BITS+1;
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::vector<uint8_t>> free_lists[TOTAL_CLASSES];
+        size_t max_free_per_class;
+    };
+    std::shared_ptr<State> m_state;
+public:
+    class Buffer;
+    explicit Buffer_Pool(const size_t max_free_per_class=4) {
+        m_state = std::make_shared<State>();
+        m_state->max_free_per_class = max_free_per_class;
+    }
+    // Storage has a capacity of at least min_capacity and is initially empty
+    Buffer Acquire(const size_t min_capacity);
+    // Shared pool for subsystems that don't need their own
+    static Buffer_Pool& GetGlobal(void) {
+        static Buffer_Pool pool;
+        return pool;
+    }
+private:
+    // Returns TOTAL_CLASSES if the size is larger than the largest class
+    static size_t GetAcquireClass(const size_t min_capacity) {
+        size_t index = 0;
+        while ((index < TOTAL_CLASSES) && ((size_t(1) << (index+MIN_CLASS_BITS)) < min_capacity)) {
+            index++;
+        }
+        return index;
+    }
+    // Storage can grow past its acquired class so it is returned to the largest class it fully covers
+    static bool GetReleaseClass(const size_t capacity, size_t& index) {
+        if (capacity < (size_t(1) << MIN_CLASS_BITS)) return false;
+        // Don't hold onto oversized one-off allocations
+        if (capacity >= (size_t(1) << (MAX_CLASS_BITS+1))) return false;
+        index = 0;
+        while ((index+1 < TOTAL_CLASSES) && ((size_t(1) << (index+1+MIN_CLASS_BITS)) <= capacity)) {
+            index++;
+        }
+        return true;
+    }
+    static void Release(const std::shared_ptr<State>& state, std::vector<uint8_t>&& data) {
+        size_t index = 0;
+        if (!GetReleaseClass(data.capacity(), index)) return;
+        data.clear();
+        auto lock = std::scoped_lock(state->mutex);
+        auto& free_list = state->free_lists[index];
+        if (free_list.size() >= state->max_free_per_class) return;
+        free_list.push_back(std::move(data));
+    }
+};
+
+// Move-only owner of pooled storage
+class Buffer_Pool::Buffer
+{
+private:
+    std::vector<uint8_t> m_data;
+    std::shared_ptr<Buffer_Pool::State> m_state;
+public:
+    Buffer() = default;
+    Buffer(std::vector<uint8_t>&& data, std::shared_ptr<Buffer_Pool::State> state)
+    : m_data(std::move(data)), m_state(std::move(state)) {}
+    ~Buffer() { Reset(); }
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+    Buffer(Buffer&& other) noexcept
+    : m_data(std::move(other.m_data)), m_state(std::move(other.m_state)) {
+        other.m_data.clear();
+    }
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            m_data = std::move(other.m_data);
+            m_state = std::move(other.m_state);
+            other.m_data.clear();
+        }
+        return *this;
+    }
+    // Returns storage to the pool and leaves this buffer empty
+    void Reset(void) {
+        if (m_state != nullptr) {
+            Buffer_Pool::Release(m_state, std::move(m_data));
+            m_state = nullptr;
+        }
+        m_data = std::vector<uint8_t>();
+    }
+    // Growing past the capacity reallocates the storage like a std::vector
+    void resize(const size_t N) { m_data.resize(N); }
+    void clear(void) { m_data.clear(); }
+    uint8_t* data(void) { return m_data.data(); }
+    const uint8_t* data(void) const { return m_data.data(); }
+    size_t size(void) const { return m_data.size(); }
+    size_t capacity(void) const { return m_data.capacity(); }
+    bool empty(void) const { return m_data.empty(); }
+    uint8_t* begin(void) { return m_data.data(); }
+    uint8_t* end(void) { return m_data.data() + m_data.size(); }
+    const uint8_t* begin(void) const { return m_data.data(); }
+    const uint8_t* end(void) const { return m_data.data() + m_data.size(); }
+    uint8_t& operator[](const size_t i) { return m_data[i]; }
+    const uint8_t& operator[](const size_t i) const { return m_data[i]; }
+};
+
+using Pooled_Buffer = Buffer_Pool::Buffer;
+
+inline Pooled_Buffer Buffer_Pool::Acquire(const size_t min_capacity) {
+    const size_t index = GetAcquireClass(min_capacity);
+    std::vector<uint8_t> data;
+    if (index < TOTAL_CLASSES) {
+        auto lock = std::scoped_lock(m_state->mutex);
+        auto& free_list = m_state->free_lists[index];
+        if (!free_list.empty()) {
+            data = std::move(free_list.back());
+            free_list.pop_back();
+        }
+    }
+    if (data.capacity() < min_capacity) {
+        const size_t capacity = (index < TOTAL_CLASSES) ? (size_t(1) << (index+MIN_CLASS_BITS)) : min_capacity;
+        data.reserve(capacity);
+    }
+    return Pooled_Buffer(std::move(data), m_state);
+}
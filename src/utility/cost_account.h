@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+// Time spent by one consumer (e.g. a subchannel) split into the stages of decoding
+// The consumer is bound to the calling thread with Cost_Account_Scope and the stages are timed with COST_STAGE_SCOPE
+// so code shared by every consumer (e.g. MSC_Decoder) doesn't need to know who it is working for
+// NOTE: Stages on a thread without an account are not timed and cost nothing but a thread local read
+//       Stages must not be nested otherwise the inner stage is counted twice
+
+enum class Cost_Stage: uint8_t {
+    DEINTERLEAVE = 0,
+    VITERBI = 1,
+    // reed solomon of DAB+ superframes and packet mode FEC
+    OUTER_CODE = 2,
+    // audio codec
+    DECODE = 3,
+    // programme associated data (dynamic labels, MOT)
+    PAD = 4,
+};
+
+constexpr size_t TOTAL_COST_STAGES = 5;
+
+// Copy of an account at the time it was read
+struct Cost_Totals {
+    std::array<uint64_t, TOTAL_COST_STAGES> stage_ns{};
+    // time spent inside Cost_Account_Scope which includes time outside of the stages
+    uint64_t total_ns = 0;
+    uint64_t GetStage(const Cost_Stage stage) const { return stage_ns[size_t(stage)]; }
+    Cost_Totals operator-(const Cost_Totals& other) const {
+        Cost_Totals diff;
+        for (size_t i = 0; i < TOTAL_COST_STAGES; i++) diff.stage_ns[i] = stage_ns[i]-other.stage_ns[i];
+        diff.total_ns = total_ns-other.total_ns;
+        return diff;
+    }
+};
+
+class Cost_Account
+{
+private:
+    std::array<std::atomic<uint64_t>, TOTAL_COST_STAGES> m_stage_ns{};
+    std::atomic<uint64_t> m_total_ns{0};
+public:
+    void AddStage(const Cost_Stage stage, const uint64_t ns) {
+        m_stage_ns[size_t(stage)].fetch_add(ns, std::memory_order_relaxed);
+    }
+    void AddTotal(const uint64_t ns) { m_total_ns.fetch_add(ns, std::memory_order_relaxed); }
+    // NOTE: Fields are read one at a time so they may be off by a stage if the account is being written
+    Cost_Totals Load() const {
+        Cost_Totals totals;
+        for (size_t i = 0; i < TOTAL_COST_STAGES; i++) totals.stage_ns[i] = m_stage_ns[i].load(std::memory_order_relaxed);
+        totals.total_ns = m_total_ns.load(std::memory_order_relaxed);
+        return totals;
+    }
+};
+
+namespace cost_account_detail {
+    using clock = std::chrono::steady_clock;
+    inline thread_local Cost_Account* current_account = nullptr;
+    inline uint64_t get_elapsed_ns(const clock::time_point start) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+        return uint64_t(std::max(elapsed.count(), decltype(elapsed.count())(0)));
+    }
+}
+
+// Stages timed on this thread are added to the account until the scope ends
+// The lifetime of the scope is added to the account's total
+class Cost_Account_Scope
+{
+private:
+    Cost_Account* const m_prev_account;
+    Cost_Account& m_account;
+    const cost_account_detail::clock::time_point m_start;
+public:
+    explicit Cost_Account_Scope(Cost_Account& account)
+    : m_prev_account(cost_account_detail::current_account), m_account(account),
+      m_start(cost_account_detail::clock::now())
+    {
+        cost_account_detail::current_account = &m_account;
+    }
+    ~Cost_Account_Scope() {
+        m_account.AddTotal(cost_account_detail::get_elapsed_ns(m_start));
+        cost_account_detail::current_account = m_prev_account;
+    }
+    Cost_Account_Scope(const Cost_Account_Scope&) = delete;
+    Cost_Account_Scope& operator=(const Cost_Account_Scope&) = delete;
+};
+
+class Cost_Stage_Timer
+{
+private:
+    Cost_Account* const m_account;
+    const Cost_Stage m_stage;
+    cost_account_detail::clock::time_point m_start;
+public:
+    explicit Cost_Stage_Timer(const Cost_Stage stage)
+    : m_account(cost_account_detail::current_account), m_stage(stage) {
+        if (m_account != nullptr) m_start = cost_account_detail::clock::now();
+    }
+    ~Cost_Stage_Timer() {
+        if (m_account == nullptr) return;
+        m_account->AddStage(m_stage, cost_account_detail::get_elapsed_ns(m_start));
+    }
+    Cost_Stage_Timer(const Cost_Stage_Timer&) = delete;
+    Cost_Stage_Timer& operator=(const Cost_Stage_Timer&) = delete;
+};
+
+#define COST_CONCAT_IMPL(a, b) a##b
+#define COST_CONCAT(a, b) COST_CONCAT_IMPL(a, b)
+
+// Times the rest of the enclosing scope into a stage of the thread's current account
+#define COST_STAGE_SCOPE(stage) const Cost_Stage_Timer COST_CONCAT(_cost_stage_timer_, __LINE__)(stage)
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Type erased callable like std::function without heap allocation
+// Callables up to BUFFER_SIZE bytes (e.g. lambdas capturing a few pointers) are stored inline
+// NOTE: Larger callables fall back to the heap and the object is move only
+template <typename Signature, size_t BUFFER_SIZE=48>
+class Inline_Function;
+
+template <typename R, typename ... Args, size_t BUFFER_SIZE>
+class Inline_Function<R(Args...), BUFFER_SIZE>
+{
+private:
+    enum class Operation { MOVE, DESTROY };
+    using Invoker = R(*)(void*, Args...);
+    using Manager = void(*)(const Operation, void*, void*);
+    alignas(max_align_t) unsigned char m_buffer[BUFFER_SIZE];
+    Invoker m_invoker = nullptr;
+    Manager m_manager = nullptr;
+
+    template <typename F>
+    static constexpr bool is_inline = 
+        (sizeof(F) <= BUFFER_SIZE) && 
+        (alignof(F) <= alignof(max_align_t)) && 
+        std::is_nothrow_move_constructible_v<F>;
+public:
+    Inline_Function() = default;
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Inline_Function>>>
+    Inline_Function(F&& f) { // NOLINT: implicit conversion like std::function
+        using D = std::decay_t<F>;
+        if constexpr(is_inline<D>) {
+            new (m_buffer) D(std::forward<F>(f));
+            m_invoker = [](void* buffer, Args... args) -> R {
+                return (*std::launder(reinterpret_cast<D*>(buffer)))(std::forward<Args>(args)...);
+            };
+            m_manager = [](const Operation op, void* src, void* dst) {
+                auto* src_f = std::launder(reinterpret_cast<D*>(src));
+                if (op == Operation::MOVE) {
+                    new (dst) D(std::move(*src_f));
+                }
+                src_f->~D();
+            };
+        } else {
+            *reinterpret_cast<D**>(m_buffer) = new D(std::forward<F>(f));
+            m_invoker = [](void* buffer, Args... args) -> R {
+                return (**reinterpret_cast<D**>(buffer))(std::forward<Args>(args)...);
+            };
+            m_manager = [](const Operation op, void* src, void* dst) {
+                auto*& src_f = *reinterpret_cast<D**>(src);
+                if (op == Operation::MOVE) {
+                    *reinterpret_cast<D**>(dst) = src_f;
+                } else {
+                    delete src_f;
+                }
+                src_f = nullptr;
+            };
+        }
+    }
+    ~Inline_Function() { Reset(); }
+    Inline_Function(const Inline_Function&) = delete;
+    Inline_Function& operator=(const Inline_Function&) = delete;
+    Inline_Function(Inline_Function&& other) noexcept { MoveFrom(other); }
+    Inline_Function& operator=(Inline_Function&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+    R operator()(Args... args) const {
+        return m_invoker(const_cast<unsigned char*>(m_buffer), std::forward<Args>(args)...);
+    }
+    explicit operator bool() const { return m_invoker != nullptr; }
+    void Reset() {
+        if (m_manager != nullptr) {
+            m_manager(Operation::DESTROY, m_buffer, nullptr);
+        }
+        m_invoker = nullptr;
+        m_manager = nullptr;
+    }
+private:
+    void MoveFrom(Inline_Function& other) {
+        if (other.m_manager != nullptr) {
+            other.m_manager(Operation::MOVE, other.m_buffer, m_buffer);
+        }
+        m_invoker = other.m_invoker;
+        m_manager = other.m_manager;
+        other.m_invoker = nullptr;
+        other.m_manager = nullptr;
+    }
+};
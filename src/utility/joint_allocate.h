@@ -4,7 +4,8 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <vector>
-#include "./aligned_allocator.hpp"
+#include "./memory_policy.h"
+#include "./page_allocator.h"
 #include "./span.h"
 
 // Define the specification for each buffer inside the joint block
@@ -16,12 +17,12 @@ struct BufferParameters {
     : length(_length), alignment(_alignment) {}
 };
 
-static std::vector<uint8_t, AlignedAllocator<uint8_t>> AllocateJoint(size_t curr_size, size_t align_size) {
-    return std::vector<uint8_t, AlignedAllocator<uint8_t>>(curr_size, AlignedAllocator<uint8_t>(align_size));
+static std::vector<uint8_t, PageAllocator<uint8_t>> AllocateJoint(const Memory_Policy& policy, size_t curr_size, size_t align_size) {
+    return std::vector<uint8_t, PageAllocator<uint8_t>>(curr_size, PageAllocator<uint8_t>(align_size, policy));
 }
 
 template <typename T, typename ... Ts>
-static std::vector<uint8_t, AlignedAllocator<uint8_t>> AllocateJoint(size_t curr_joint_size, size_t joint_alignment, tcb::span<T>& buf, BufferParameters params, Ts&& ... args) {
+static std::vector<uint8_t, PageAllocator<uint8_t>> AllocateJoint(const Memory_Policy& policy, size_t curr_joint_size, size_t joint_alignment, tcb::span<T>& buf, BufferParameters params, Ts&& ... args) {
     // create padding so that next buffer has its alignment
     const auto align_elem_size = params.alignment ? params.alignment : sizeof(T);
     const size_t padded_joint_size = ((curr_joint_size+align_elem_size-1) / align_elem_size) * align_elem_size;
@@ -32,7 +33,7 @@ static std::vector<uint8_t, AlignedAllocator<uint8_t>> AllocateJoint(size_t curr
     // get offset into our aligned and padded block
     const size_t buf_size = params.length*sizeof(T);
     const size_t new_joint_size = padded_joint_size + buf_size;
-    auto data = AllocateJoint(new_joint_size, joint_alignment, args...);
+    auto data = AllocateJoint(policy, new_joint_size, joint_alignment, args...);
 
     const auto data_offset = tcb::span<uint8_t>(data).subspan(padded_joint_size, buf_size);
 
@@ -47,6 +48,12 @@ static std::vector<uint8_t, AlignedAllocator<uint8_t>> AllocateJoint(size_t curr
 
 // Recursive template for creating a jointly allocated block 
 template <typename T, typename ... Ts>
-static std::vector<uint8_t, AlignedAllocator<uint8_t>> AllocateJoint(tcb::span<T>& buf, BufferParameters params, Ts&& ... args) {
-    return AllocateJoint(0, 1, buf, params, args...);
-}
\ No newline at end of file
+static std::vector<uint8_t, PageAllocator<uint8_t>> AllocateJoint(tcb::span<T>& buf, BufferParameters params, Ts&& ... args) {
+    return AllocateJoint(Memory_Policy{}, 0, 1, buf, params, args...);
+}
+
+// Same as above but the pages of the block are allocated with a policy (e.g. huge pages or NUMA node)
+template <typename T, typename ... Ts>
+static std::vector<uint8_t, PageAllocator<uint8_t>> AllocateJoint(const Memory_Policy& policy, tcb::span<T>& buf, BufferParameters params, Ts&& ... args) {
+    return AllocateJoint(policy, 0, 1, buf, params, args...);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include "./metrics.h"
+
+// End to end latency from when IQ samples were captured to each stage that their frame reaches
+// The capture time of a frame is carried across threads by the demodulator, SPSC_Frame_Ring and BasicRadio
+// and is bound to the thread doing the work with Latency_Trace_Scope so decoders don't need to pass it around
+// Each stage records the time since capture into a histogram of Metrics_Registry with LATENCY_TRACE_RECORD
+// NOTE: A unit that spans several frames (e.g. a DAB+ super frame) has the capture time of the frame that completed it
+//       So the fixed delay of time interleaving (15 CIFs) and of filling a super frame isn't included
+// NOTE: Times are steady clock nanoseconds where 0 means the capture time is unknown and nothing is recorded
+
+namespace latency_trace_detail {
+    using clock = std::chrono::steady_clock;
+    inline thread_local uint64_t current_capture_time = 0;
+}
+
+static inline uint64_t get_latency_trace_time(const std::chrono::steady_clock::time_point time) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    return uint64_t(std::max<int64_t>(ns, 1));
+}
+
+static inline uint64_t get_latency_trace_now() {
+    return get_latency_trace_time(latency_trace_detail::clock::now());
+}
+
+// Capture time of the frame being worked on by this thread
+static inline uint64_t get_latency_trace_capture_time() {
+    return latency_trace_detail::current_capture_time;
+}
+
+// Capture time for a block of samples which is the caller's if it has one, otherwise now
+// Returns 0 while metrics are disabled so the clock isn't read
+static inline uint64_t get_latency_trace_block_time() {
+    if (!Metrics_Registry::Get().GetIsEnabled()) return 0;
+    const uint64_t capture_time = get_latency_trace_capture_time();
+    return (capture_time != 0) ? capture_time : get_latency_trace_now();
+}
+
+// Work done on this thread belongs to a frame with this capture time until the scope ends
+class Latency_Trace_Scope
+{
+private:
+    const uint64_t m_prev_capture_time;
+public:
+    explicit Latency_Trace_Scope(const uint64_t capture_time)
+    : m_prev_capture_time(latency_trace_detail::current_capture_time)
+    {
+        latency_trace_detail::current_capture_time = capture_time;
+    }
+    ~Latency_Trace_Scope() {
+        latency_trace_detail::current_capture_time = m_prev_capture_time;
+    }
+    Latency_Trace_Scope(const Latency_Trace_Scope&) = delete;
+    Latency_Trace_Scope& operator=(const Latency_Trace_Scope&) = delete;
+};
+
+static inline void record_latency_trace(Metrics_Histogram& histogram) {
+    const uint64_t capture_time = get_latency_trace_capture_time();
+    if ((capture_time == 0) || !Metrics_Registry::Get().GetIsEnabled()) return;
+    const uint64_t now = get_latency_trace_now();
+    histogram.Record((now > capture_time) ? (now - capture_time) : 0);
+}
+
+#define LATENCY_TRACE_CONCAT_IMPL(a, b) a##b
+#define LATENCY_TRACE_CONCAT(a, b) LATENCY_TRACE_CONCAT_IMPL(a, b)
+
+// Records the time since the capture of the current frame, the histogram is looked up once per call site
+#define LATENCY_TRACE_RECORD(name, help) do {\
+    static Metrics_Histogram& LATENCY_TRACE_CONCAT(_latency_histogram_, __LINE__) = Metrics_Registry::Get().GetHistogram(name, help);\
+    record_latency_trace(LATENCY_TRACE_CONCAT(_latency_histogram_, __LINE__));\
+} while (0)
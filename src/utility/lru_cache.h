@@ -1,98 +1,257 @@
 #pragma once
 
+#include <assert.h>
 #include <stddef.h>
-#include <list>
-#include <unordered_map>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <optional>
 #include <utility>
+#include <vector>
 
+// Fixed capacity least recently used cache
+// Nodes are preallocated and linked by index in an intrusive list ordered from most to least recently used
+// Keys are looked up in an open addressing table with linear probing, so inserting never allocates
+// NOTE: References to values stay valid until they are evicted/removed or the max size is changed
 template <typename K, typename T>
-class LRU_Cache 
+class LRU_Cache
 {
+public:
+    using value_type = std::pair<const K, T>;
 private:
-    typedef std::list<std::pair<const K,T>> list_t;
-    list_t m_lru_list;
-    std::unordered_map<K, typename list_t::iterator> m_cache;
-    size_t m_max_size;
+    using index_t = uint32_t;
+    static constexpr index_t NIL = ~index_t(0);
+    struct Node {
+        std::optional<value_type> value;
+        index_t prev = NIL;
+        index_t next = NIL;
+    };
+    std::vector<Node> m_nodes;
+    std::vector<index_t> m_table;
+    index_t m_head = NIL;
+    index_t m_tail = NIL;
+    index_t m_free = NIL;
+    size_t m_size = 0;
+    size_t m_max_size = 0;
+public:
+    template <typename U, typename V>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = V;
+        using difference_type = ptrdiff_t;
+        using pointer = V*;
+        using reference = V&;
+    private:
+        U* m_cache;
+        index_t m_index;
+    public:
+        Iterator(U* cache, index_t index): m_cache(cache), m_index(index) {}
+        reference operator*() const { return *(m_cache->m_nodes[m_index].value); }
+        pointer operator->() const { return &(*(m_cache->m_nodes[m_index].value)); }
+        Iterator& operator++() { m_index = m_cache->m_nodes[m_index].next; return *this; }
+        Iterator operator++(int) { auto it = *this; ++(*this); return it; }
+        // end() steps back to the least recently used entry
+        Iterator& operator--() { m_index = (m_index == NIL) ? m_cache->m_tail : m_cache->m_nodes[m_index].prev; return *this; }
+        Iterator operator--(int) { auto it = *this; --(*this); return it; }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+    };
+    using iterator = Iterator<LRU_Cache, value_type>;
+    using const_iterator = Iterator<const LRU_Cache, const value_type>;
 public:
     explicit LRU_Cache(size_t max_size=10) {
-       m_max_size = max_size; 
+        allocate(max_size);
     }
 
     size_t get_max_size(void) const {
         return m_max_size;
     }
 
+    // Least recently used entries past the new size are evicted
     void set_max_size(const size_t max_size) {
-        m_max_size = max_size;
-        remove_lru();
+        if (max_size == m_max_size) {
+            return;
+        }
+
+        auto old_nodes = std::move(m_nodes);
+        index_t old_last = m_head;
+        for (size_t i = 1; (old_last != NIL) && (i < max_size) && (old_nodes[old_last].next != NIL); i++) {
+            old_last = old_nodes[old_last].next;
+        }
+        allocate(max_size);
+
+        // reinsert the kept entries from least recently used so the order is preserved
+        for (index_t i = old_last; i != NIL; i = old_nodes[i].prev) {
+            auto& value = *(old_nodes[i].value);
+            insert_node(value.first, std::move(value.second));
+        }
+    }
+
+    size_t size(void) const {
+        return m_size;
     }
 
     T* find(const K& key) {
-        auto res = m_cache.find(key);
-        if (res == m_cache.end()) {
+        const index_t index = find_node(key);
+        if (index == NIL) {
             return nullptr;
         }
-
-        auto it = res->second;
-        promote(it);
-        return &it->second;
+        promote(index);
+        return &(m_nodes[index].value->second);
     }
 
     T& insert(K key, T&& val) {
-        auto res = m_cache.find(key);
-        if (res == m_cache.end()) {
-            remove_lru();
-            m_lru_list.push_front({key, val});
-            res = m_cache.insert({key, m_lru_list.begin()}).first; 
-        }
-        auto it = res->second;
-        promote(it);
-        return it->second;
+        return emplace(std::move(key), std::move(val));
     }
 
+    // Existing entries are promoted and left unchanged
     template <typename ... U>
     T& emplace(K key, U&& ... args) {
-        auto res = m_cache.find(key);
-        if (res == m_cache.end()) {
-            remove_lru();
-            // std::pair has the following constructor signature
-            m_lru_list.emplace_front(
-                std::piecewise_construct, 
-                std::forward_as_tuple(key), 
-                std::forward_as_tuple(std::forward<U>(args)...));
-            res = m_cache.insert({key, m_lru_list.begin()}).first; 
+        const index_t index = find_node(key);
+        if (index != NIL) {
+            promote(index);
+            return m_nodes[index].value->second;
         }
-        auto it = res->second;
-        promote(it);
-        return it->second;
+        return insert_node(key, std::forward<U>(args)...);
     }
 
-    auto begin() {
-        return m_lru_list.begin();
+    // Keeps the capacity so this doesn't allocate
+    void clear(void) {
+        for (auto& node: m_nodes) {
+            node.value.reset();
+        }
+        reset_links();
+        std::fill(m_table.begin(), m_table.end(), NIL);
     }
 
-    auto end() {
-        return m_lru_list.end();
+    bool remove(const K& key) {
+        const index_t index = find_node(key);
+        if (index == NIL) {
+            return false;
+        }
+        remove_node(index);
+        return true;
     }
+
+    iterator begin() { return iterator(this, m_head); }
+    iterator end() { return iterator(this, NIL); }
+    const_iterator begin() const { return const_iterator(this, m_head); }
+    const_iterator end() const { return const_iterator(this, NIL); }
 private:
-    // cull list elements past max size
-    void remove_lru(void) {
-        if (m_lru_list.size() <= m_max_size) {
-            return;
+    void allocate(size_t max_size) {
+        // a cache which can't hold anything isn't useful
+        max_size = (max_size > 0) ? max_size : 1;
+        m_max_size = max_size;
+        m_nodes = std::vector<Node>(max_size);
+        reset_links();
+
+        // keep load factor at or below 0.5 so probe sequences stay short
+        size_t table_size = 1;
+        while (table_size < 2*max_size) table_size <<= 1;
+        m_table.assign(table_size, NIL);
+    }
+
+    // all nodes are put on the free list
+    void reset_links(void) {
+        m_size = 0;
+        m_head = NIL;
+        m_tail = NIL;
+        const size_t N = m_nodes.size();
+        for (size_t i = 0; i < N; i++) {
+            m_nodes[i].prev = NIL;
+            m_nodes[i].next = (i+1 < N) ? index_t(i+1) : NIL;
+        }
+        m_free = 0;
+    }
+
+    size_t get_slot(const K& key) const {
+        // std::hash is the identity for integers so we mix it with fibonacci hashing
+        const uint64_t hash = uint64_t(std::hash<K>{}(key)) * 0x9E3779B97F4A7C15ull;
+        return size_t(hash >> 32) & (m_table.size()-1);
+    }
+
+    index_t find_node(const K& key) const {
+        const size_t mask = m_table.size()-1;
+        for (size_t slot = get_slot(key);; slot = (slot+1) & mask) {
+            const index_t index = m_table[slot];
+            if (index == NIL) return NIL;
+            if (m_nodes[index].value->first == key) return index;
         }
+    }
 
-        auto _start = m_lru_list.begin();
-        auto _end = m_lru_list.end();
-        std::advance(_start, m_max_size);
-        for (auto it = _start; it != _end; it++) {
-            auto key = it->first;
-            m_cache.erase(key);
+    template <typename ... U>
+    T& insert_node(const K& key, U&& ... args) {
+        if (m_size >= m_max_size) {
+            remove_node(m_tail);
         }
-        m_lru_list.erase(_start, _end);
+
+        const index_t index = m_free;
+        assert(index != NIL);
+        auto& node = m_nodes[index];
+        m_free = node.next;
+        node.value.emplace(
+            std::piecewise_construct,
+            std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<U>(args)...));
+        link_front(index);
+        m_size++;
+
+        const size_t mask = m_table.size()-1;
+        size_t slot = get_slot(key);
+        while (m_table[slot] != NIL) slot = (slot+1) & mask;
+        m_table[slot] = index;
+        return node.value->second;
+    }
+
+    void remove_node(const index_t index) {
+        // backward shift deletion keeps linear probing free of tombstones
+        const size_t mask = m_table.size()-1;
+        size_t slot = get_slot(m_nodes[index].value->first);
+        while (m_table[slot] != index) slot = (slot+1) & mask;
+        for (size_t next = (slot+1) & mask; m_table[next] != NIL; next = (next+1) & mask) {
+            const size_t ideal = get_slot(m_nodes[m_table[next]].value->first);
+            // move the entry back if its ideal slot doesn't lie cyclically within (slot, next]
+            const bool is_between = (slot <= next) ? ((slot < ideal) && (ideal <= next)) : ((slot < ideal) || (ideal <= next));
+            if (!is_between) {
+                m_table[slot] = m_table[next];
+                slot = next;
+            }
+        }
+        m_table[slot] = NIL;
+
+        unlink(index);
+        auto& node = m_nodes[index];
+        node.value.reset();
+        node.prev = NIL;
+        node.next = m_free;
+        m_free = index;
+        m_size--;
+    }
+
+    void link_front(const index_t index) {
+        auto& node = m_nodes[index];
+        node.prev = NIL;
+        node.next = m_head;
+        if (m_head != NIL) m_nodes[m_head].prev = index;
+        m_head = index;
+        if (m_tail == NIL) m_tail = index;
+    }
+
+    void unlink(const index_t index) {
+        auto& node = m_nodes[index];
+        if (node.prev != NIL) m_nodes[node.prev].next = node.next; else m_head = node.next;
+        if (node.next != NIL) m_nodes[node.next].prev = node.prev; else m_tail = node.prev;
+        node.prev = NIL;
+        node.next = NIL;
     }
 
     // move list element to the front
-    void promote(typename list_t::iterator& it) {
-        m_lru_list.splice(m_lru_list.begin(), m_lru_list, it);
+    void promote(const index_t index) {
+        if (index == m_head) return;
+        unlink(index);
+        link_front(index);
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "utility/span.h"
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only memory mapping of a whole file
+// The OS pages in the file on demand and can read ahead of sequential access
+class MappedFile
+{
+public:
+    enum class Access_Pattern { NORMAL, SEQUENTIAL, RANDOM };
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#if _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    // Returns false if the file couldn't be opened or mapped
+    // NOTE: Pipes and devices can't be mapped so they should be read with fread instead
+    //       An empty file is opened successfully but has no data
+    bool open(const std::string& filename, const Access_Pattern pattern=Access_Pattern::SEQUENTIAL) {
+        close();
+#if _WIN32
+        m_file = CreateFileA(
+            filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            (pattern == Access_Pattern::SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN :
+            (pattern == Access_Pattern::RANDOM) ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL,
+            nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        if (GetFileType(m_file) != FILE_TYPE_DISK) {
+            close();
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size)) {
+            close();
+            return false;
+        }
+        m_size = size_t(size.QuadPart);
+        if (m_size == 0) return true;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) {
+            close();
+            return false;
+        }
+        m_data = reinterpret_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr) {
+            close();
+            return false;
+        }
+#else
+        m_file = ::open(filename.c_str(), O_RDONLY);
+        if (m_file < 0) return false;
+        struct stat info;
+        if ((fstat(m_file, &info) != 0) || !S_ISREG(info.st_mode)) {
+            close();
+            return false;
+        }
+        m_size = size_t(info.st_size);
+        if (m_size == 0) return true;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+        if (data == MAP_FAILED) {
+            close();
+            return false;
+        }
+        m_data = reinterpret_cast<const uint8_t*>(data);
+        const int advice =
+            (pattern == Access_Pattern::SEQUENTIAL) ? MADV_SEQUENTIAL :
+            (pattern == Access_Pattern::RANDOM) ? MADV_RANDOM : MADV_NORMAL;
+        // NOTE: This is only a hint so we ignore failures
+        madvise(data, m_size, advice);
+#endif
+        return true;
+    }
+    void close() {
+#if _WIN32
+        if (m_data != nullptr) UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+        if (m_file >= 0) ::close(m_file);
+        m_file = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+    bool is_open() const {
+#if _WIN32
+        return m_file != INVALID_HANDLE_VALUE;
+#else
+        return m_file >= 0;
+#endif
+    }
+    size_t size() const { return m_size; }
+    tcb::span<const uint8_t> get_bytes() const { return { m_data, m_size }; }
+    // Whole elements of type T in the file, trailing bytes of a partial element are ignored
+    template <typename T>
+    tcb::span<const T> get_span() const {
+        return { reinterpret_cast<const T*>(m_data), m_size / sizeof(T) };
+    }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// How large long lived buffers (e.g. OFDM_Demod's joint block or the CIF history) are backed by memory
+// Applied by PageAllocator from "utility/page_allocator.h"
+// NOTE: Each part is best effort and is skipped if the OS refuses it (e.g. no huge pages reserved or no privileges)
+struct Memory_Policy {
+    // back buffers of at least 2MB with huge pages to reduce TLB misses
+    // linux: MAP_HUGETLB if pages are reserved, otherwise transparent huge pages through madvise
+    // windows: large pages which require the "Lock pages in memory" privilege
+    bool is_huge_pages = false;
+    // place the pages on this NUMA node, -1 for the node of the thread that first touches them
+    int numa_node = -1;
+    // lock the pages into RAM so realtime threads never page fault on them
+    // NOTE: This is limited by RLIMIT_MEMLOCK on linux and the working set size on windows
+    bool is_locked = false;
+    bool IsDefault() const {
+        return !is_huge_pages && (numa_node < 0) && !is_locked;
+    }
+    bool operator==(const Memory_Policy& other) const {
+        return (is_huge_pages == other.is_huge_pages) && (numa_node == other.numa_node) && (is_locked == other.is_locked);
+    }
+    bool operator!=(const Memory_Policy& other) const {
+        return !(*this == other);
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bytes held by a component broken down into a tree of the parts it owns
+// e.g. radio -> channels -> subchannel_1 -> msc_decoder -> viterbi
+// so the memory of an ensemble can be traced back to what is holding it
+// NOTE: This is the capacity of the buffers owned by each part along with estimates for library internals
+//       Allocator overhead, thread stacks and memory shared with other components (e.g. cached FFT plans) are approximate
+struct Memory_Usage {
+    std::string name;
+    // held directly by this node excluding its children
+    size_t bytes = 0;
+    std::vector<Memory_Usage> children;
+
+    Memory_Usage() = default;
+    explicit Memory_Usage(std::string _name, const size_t _bytes=0): name(std::move(_name)), bytes(_bytes) {}
+
+    // Returns the child so its own parts can be added
+    // NOTE: The reference is invalidated when another child is added
+    Memory_Usage& AddChild(std::string child_name, const size_t child_bytes=0) {
+        children.emplace_back(std::move(child_name), child_bytes);
+        return children.back();
+    }
+    void AddChild(Memory_Usage&& child) {
+        children.push_back(std::move(child));
+    }
+    // Includes the children
+    size_t GetTotalBytes() const {
+        size_t total = bytes;
+        for (const auto& child: children) total += child.GetTotalBytes();
+        return total;
+    }
+    // Returns nullptr if there isn't a child with that name
+    const Memory_Usage* FindChild(const std::string& child_name) const {
+        for (const auto& child: children) {
+            if (child.name == child_name) return &child;
+        }
+        return nullptr;
+    }
+    // One line per node with its total bytes, indented by its depth
+    std::string ToString(const size_t max_depth=SIZE_MAX) const {
+        std::string out;
+        AppendString(out, 0, max_depth);
+        return out;
+    }
+    std::string ToJSON() const {
+        std::string out;
+        AppendJSON(out);
+        return out;
+    }
+private:
+    void AppendString(std::string& out, const size_t depth, const size_t max_depth) const {
+        out.append(2*depth, ' ');
+        out.append(name);
+        out.append(": ");
+        out.append(std::to_string(GetTotalBytes()));
+        out.append("\n");
+        if (depth >= max_depth) return;
+        for (const auto& child: children) child.AppendString(out, depth+1, max_depth);
+    }
+    // NOTE: Names are identifiers chosen by the components so they aren't escaped
+    void AppendJSON(std::string& out) const {
+        out.append("{\"name\":\"");
+        out.append(name);
+        out.append("\",\"bytes\":");
+        out.append(std::to_string(bytes));
+        out.append(",\"total_bytes\":");
+        out.append(std::to_string(GetTotalBytes()));
+        out.append(",\"children\":[");
+        for (size_t i = 0; i < children.size(); i++) {
+            if (i > 0) out.append(",");
+            children[i].AppendJSON(out);
+        }
+        out.append("]}");
+    }
+};
+
+// Heap memory held by a container which is its capacity rather than its size
+template <typename T, typename A>
+inline size_t get_memory_bytes(const std::vector<T, A>& vec) {
+    return vec.capacity()*sizeof(T);
+}
+
+// NOTE: This is an estimate since each entry is a separately allocated node linked from its bucket
+template <typename K, typename T, typename H, typename E, typename A>
+inline size_t get_memory_bytes(const std::unordered_map<K, T, H, E, A>& map) {
+    using node_t = std::pair<std::pair<const K, T>, void*>;
+    return map.bucket_count()*sizeof(void*) + map.size()*sizeof(node_t);
+}
+
+inline size_t get_memory_bytes(const std::string& str) {
+    // NOTE: Short strings are stored inside the object without a heap allocation
+    static const size_t SMALL_STRING_CAPACITY = std::string().capacity();
+    return (str.capacity() > SMALL_STRING_CAPACITY) ? (str.capacity()+1u) : 0u;
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Process wide latency histograms and counters for the hot paths of the demodulator and decoders
+// Recording is lock free: each thread writes to one of several cache aligned shards with relaxed atomics
+// Readers pull a merged snapshot or an export in the Prometheus text format or as json
+// NOTE: Metrics are shared by every radio in the process and are never unregistered
+
+namespace metrics_detail {
+    constexpr size_t TOTAL_SHARDS = 16;
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // Threads are assigned shards round robin so recording threads rarely share a cache line
+    inline size_t get_thread_shard(void) {
+        static std::atomic<size_t> next_shard{0};
+        thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % TOTAL_SHARDS;
+        return shard;
+    }
+
+    inline void atomic_fetch_max(std::atomic<uint64_t>& dest, const uint64_t value) {
+        uint64_t prev = dest.load(std::memory_order_relaxed);
+        while ((prev < value) && !dest.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+    }
+
+    inline void append_format(std::string& out, const char* fmt, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        const int length = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (length <= 0) return;
+        out.append(buf, std::min(size_t(length), sizeof(buf)-1));
+    }
+}
+
+// Merged view of a histogram at the time it was read
+// NOTE: Shards are read one at a time so a snapshot taken while recording may be off by a few samples
+struct Metrics_Histogram_Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+    double GetMean(void) const {
+        return (count > 0) ? double(sum)/double(count) : 0.0;
+    }
+    // Upper bound of the bucket containing the percentile, p is between 0 and 1
+    uint64_t GetPercentile(const double p) const;
+};
+
+// Log linear histogram of unsigned values (nanoseconds for latencies)
+// Each power of two is split into 2^SUB_BITS linear buckets so the relative error stays below 12.5%
+class Metrics_Histogram
+{
+public:
+    static constexpr size_t SUB_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+    // Larger values (over 18 minutes in nanoseconds) are clamped into the last bucket
+    static constexpr size_t MAX_VALUE_BITS = 40;
+    static constexpr size_t TOTAL_BUCKETS = (MAX_VALUE_BITS-SUB_BITS+1)*SUB_BUCKETS;
+private:
+    struct alignas(metrics_detail::CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::array<std::atomic<uint64_t>, TOTAL_BUCKETS> buckets{};
+    };
+    std::array<Shard, metrics_detail::TOTAL_SHARDS> m_shards;
+public:
+    Metrics_Histogram() = default;
+    Metrics_Histogram(const Metrics_Histogram&) = delete;
+    Metrics_Histogram& operator=(const Metrics_Histogram&) = delete;
+
+    void Record(const uint64_t value) {
+        auto& shard = m_shards[metrics_detail::get_thread_shard()];
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+        shard.buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        metrics_detail::atomic_fetch_max(shard.max, value);
+    }
+
+    Metrics_Histogram_Snapshot GetSnapshot(void) const {
+        Metrics_Histogram_Snapshot snapshot;
+        snapshot.buckets.resize(TOTAL_BUCKETS, 0);
+        for (const auto& shard: m_shards) {
+            snapshot.count += shard.count.load(std::memory_order_relaxed);
+            snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+            snapshot.max = std::max(snapshot.max, shard.max.load(std::memory_order_relaxed));
+            for (size_t i = 0; i < TOTAL_BUCKETS; i++) {
+                snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        return snapshot;
+    }
+
+    // Concurrent recordings may survive a reset
+    void Reset(void) {
+        for (auto& shard: m_shards) {
+            shard.count.store(0, std::memory_order_relaxed);
+            shard.sum.store(0, std::memory_order_relaxed);
+            shard.max.store(0, std::memory_order_relaxed);
+            for (auto& bucket: shard.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static size_t GetBucketIndex(const uint64_t value) {
+        if (value < SUB_BUCKETS) return size_t(value);
+        if ((value >> MAX_VALUE_BITS) != 0) return TOTAL_BUCKETS-1;
+        size_t exponent = SUB_BITS;
+        while ((value >> (exponent+1)) != 0) exponent++;
+        const size_t shift = exponent-SUB_BITS;
+        const size_t sub = size_t(value >> shift) & (SUB_BUCKETS-1);
+        return (shift+1)*SUB_BUCKETS + sub;
+    }
+
+    static uint64_t GetBucketLowerBound(const size_t index) {
+        if (index < SUB_BUCKETS) return uint64_t(index);
+        const size_t shift = index/SUB_BUCKETS - 1;
+        const size_t sub = index % SUB_BUCKETS;
+        return uint64_t(SUB_BUCKETS + sub) << shift;
+    }
+
+    // Exclusive upper bound
+    static uint64_t GetBucketUpperBound(const size_t index) {
+        if (index < SUB_BUCKETS) return uint64_t(index+1);
+        const size_t shift = index/SUB_BUCKETS - 1;
+        return GetBucketLowerBound(index) + (uint64_t(1) << shift);
+    }
+};
+
+inline uint64_t Metrics_Histogram_Snapshot::GetPercentile(const double p) const {
+    if (count == 0) return 0;
+    const double clamped = std::clamp(p, 0.0, 1.0);
+    const uint64_t target = std::max(uint64_t(clamped*double(count) + 0.5), uint64_t(1));
+    uint64_t total = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        total += buckets[i];
+        if (total >= target) {
+            return std::min(Metrics_Histogram::GetBucketUpperBound(i)-1, max);
+        }
+    }
+    return max;
+}
+
+class Metrics_Counter
+{
+private:
+    struct alignas(metrics_detail::CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, metrics_detail::TOTAL_SHARDS> m_shards;
+public:
+    Metrics_Counter() = default;
+    Metrics_Counter(const Metrics_Counter&) = delete;
+    Metrics_Counter& operator=(const Metrics_Counter&) = delete;
+
+    void Add(const uint64_t value=1) {
+        m_shards[metrics_detail::get_thread_shard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t GetValue(void) const {
+        uint64_t total = 0;
+        for (const auto& shard: m_shards) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Reset(void) {
+        for (auto& shard: m_shards) {
+            shard.value.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Registration takes a lock but happens once per call site through METRICS_TIME_SCOPE
+// Returned references stay valid for the lifetime of the process
+class Metrics_Registry
+{
+private:
+    template <typename T>
+    struct Entry {
+        std::string name;
+        std::string help;
+        T metric;
+    };
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Entry<Metrics_Histogram>>> m_histograms;
+    std::vector<std::unique_ptr<Entry<Metrics_Counter>>> m_counters;
+    std::atomic<bool> m_is_enabled{true};
+public:
+    static Metrics_Registry& Get(void) {
+        static Metrics_Registry registry;
+        return registry;
+    }
+
+    // Latency histograms are recorded in nanoseconds and exported in seconds
+    // Names should follow the prometheus convention, e.g. "dab_fic_decode_seconds"
+    Metrics_Histogram& GetHistogram(std::string_view name, std::string_view help) {
+        return GetOrCreate(m_histograms, name, help);
+    }
+    Metrics_Counter& GetCounter(std::string_view name, std::string_view help) {
+        return GetOrCreate(m_counters, name, help);
+    }
+    // Tail of a histogram for reports, std::nullopt if nothing has recorded into it yet
+    std::optional<Metrics_Histogram_Snapshot> GetHistogramSnapshot(std::string_view name) {
+        auto lock = std::scoped_lock(m_mutex);
+        for (const auto& entry: m_histograms) {
+            if (entry->name == name) return entry->metric.GetSnapshot();
+        }
+        return std::nullopt;
+    }
+
+    // Disabled timers skip reading the clock
+    bool GetIsEnabled(void) const { return m_is_enabled.load(std::memory_order_relaxed); }
+    void SetIsEnabled(const bool is_enabled) { m_is_enabled.store(is_enabled, std::memory_order_relaxed); }
+
+    void Reset(void) {
+        auto lock = std::scoped_lock(m_mutex);
+        for (auto& entry: m_histograms) entry->metric.Reset();
+        for (auto& entry: m_counters) entry->metric.Reset();
+    }
+
+    std::string ExportPrometheus(void) {
+        // Bucket boundaries at powers of two line up with the histogram's buckets
+        // Export from 1us to 2^36ns (about 69s) to keep the output compact
+        constexpr size_t MIN_EXPORT_BITS = 10;
+        constexpr size_t MAX_EXPORT_BITS = 36;
+        std::string out;
+        auto lock = std::scoped_lock(m_mutex);
+        for (const auto& entry: m_counters) {
+            const char* name = entry->name.c_str();
+            metrics_detail::append_format(out, "# HELP %s %s\n", name, entry->help.c_str());
+            metrics_detail::append_format(out, "# TYPE %s counter\n", name);
+            metrics_detail::append_format(out, "%s %llu\n", name, (unsigned long long)entry->metric.GetValue());
+        }
+        for (const auto& entry: m_histograms) {
+            const char* name = entry->name.c_str();
+            const auto snapshot = entry->metric.GetSnapshot();
+            metrics_detail::append_format(out, "# HELP %s %s\n", name, entry->help.c_str());
+            metrics_detail::append_format(out, "# TYPE %s histogram\n", name);
+            uint64_t total = 0;
+            size_t index = 0;
+            for (size_t bits = MIN_EXPORT_BITS; bits <= MAX_EXPORT_BITS; bits++) {
+                const size_t end_index = Metrics_Histogram::GetBucketIndex(uint64_t(1) << bits);
+                for (; index < end_index; index++) total += snapshot.buckets[index];
+                const double le = double(uint64_t(1) << bits) * 1e-9;
+                metrics_detail::append_format(out, "%s_bucket{le=\"%.9g\"} %llu\n", name, le, (unsigned long long)total);
+            }
+            metrics_detail::append_format(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)snapshot.count);
+            metrics_detail::append_format(out, "%s_sum %.9g\n", name, double(snapshot.sum) * 1e-9);
+            metrics_detail::append_format(out, "%s_count %llu\n", name, (unsigned long long)snapshot.count);
+        }
+        return out;
+    }
+
+    // Latencies are given in nanoseconds
+    std::string ExportJSON(void) {
+        std::string out;
+        auto lock = std::scoped_lock(m_mutex);
+        out.append("{\"counters\":{");
+        for (size_t i = 0; i < m_counters.size(); i++) {
+            const auto& entry = m_counters[i];
+            metrics_detail::append_format(out, "%s\"%s\":%llu",
+                (i > 0) ? "," : "", entry->name.c_str(), (unsigned long long)entry->metric.GetValue());
+        }
+        out.append("},\"histograms\":{");
+        for (size_t i = 0; i < m_histograms.size(); i++) {
+            const auto& entry = m_histograms[i];
+            const auto snapshot = entry->metric.GetSnapshot();
+            metrics_detail::append_format(out,
+                "%s\"%s\":{\"count\":%llu,\"sum\":%llu,\"max\":%llu,\"mean\":%.1f,"
+                "\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu}",
+                (i > 0) ? "," : "", entry->name.c_str(),
+                (unsigned long long)snapshot.count, (unsigned long long)snapshot.sum,
+                (unsigned long long)snapshot.max, snapshot.GetMean(),
+                (unsigned long long)snapshot.GetPercentile(0.5), (unsigned long long)snapshot.GetPercentile(0.9),
+                (unsigned long long)snapshot.GetPercentile(0.99), (unsigned long long)snapshot.GetPercentile(0.999));
+        }
+        out.append("}}");
+        return out;
+    }
+private:
+    Metrics_Registry() = default;
+
+    template <typename T>
+    T& GetOrCreate(std::vector<std::unique_ptr<Entry<T>>>& entries, std::string_view name, std::string_view help) {
+        auto lock = std::scoped_lock(m_mutex);
+        for (auto& entry: entries) {
+            if (entry->name == name) return entry->metric;
+        }
+        auto entry = std::make_unique<Entry<T>>();
+        entry->name = std::string(name);
+        entry->help = std::string(help);
+        auto& metric = entry->metric;
+        entries.push_back(std::move(entry));
+        return metric;
+    }
+};
+
+// Records the lifetime of the scope into a histogram in nanoseconds
+class Metrics_Scoped_Timer
+{
+private:
+    using clock = std::chrono::steady_clock;
+    Metrics_Histogram* m_histogram;
+    clock::time_point m_start;
+public:
+    explicit Metrics_Scoped_Timer(Metrics_Histogram& histogram)
+    : m_histogram(Metrics_Registry::Get().GetIsEnabled() ? &histogram : nullptr) {
+        if (m_histogram != nullptr) m_start = clock::now();
+    }
+    ~Metrics_Scoped_Timer() {
+        if (m_histogram == nullptr) return;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start);
+        m_histogram->Record(uint64_t(std::max(elapsed.count(), decltype(elapsed.count())(0))));
+    }
+    Metrics_Scoped_Timer(const Metrics_Scoped_Timer&) = delete;
+    Metrics_Scoped_Timer& operator=(const Metrics_Scoped_Timer&) = delete;
+};
+
+#define METRICS_CONCAT_IMPL(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_IMPL(a, b)
+
+// Times the rest of the enclosing scope, the histogram is looked up once per call site
+#define METRICS_TIME_SCOPE(name, help) \
+    static Metrics_Histogram& METRICS_CONCAT(_metrics_histogram_, __LINE__) = Metrics_Registry::Get().GetHistogram(name, help);\
+    const Metrics_Scoped_Timer METRICS_CONCAT(_metrics_timer_, __LINE__)(METRICS_CONCAT(_metrics_histogram_, __LINE__))
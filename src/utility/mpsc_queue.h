@@ -0,0 +1,85 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// Bounded lock free multiple producer single consumer queue of objects
+// Each slot carries a sequence number so producers claim slots with a single compare and swap
+// and the consumer never waits on a producer that is still writing a later slot
+// If the consumer falls behind the producers drop the newest object and increment a counter
+// NOTE: T must be default constructible and move assignable
+template <typename T>
+class MPSC_Queue
+{
+private:
+    // avoid false sharing between producer and consumer indices
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    struct Slot {
+        // index+1 once written, index+total_slots once read and free for the next lap
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    const size_t m_total_slots;
+    std::unique_ptr<Slot[]> m_slots;
+    // indices are monotonically increasing and wrapped on access
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_write_index{0};
+    alignas(CACHE_LINE_SIZE) size_t m_read_index = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_total_dropped{0};
+public:
+    explicit MPSC_Queue(const size_t total_slots)
+    : m_total_slots(total_slots), m_slots(std::make_unique<Slot[]>(total_slots))
+    {
+        assert(m_total_slots > 0);
+        for (size_t i = 0; i < m_total_slots; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MPSC_Queue(MPSC_Queue&) = delete;
+    MPSC_Queue(MPSC_Queue&&) = delete;
+    MPSC_Queue& operator=(MPSC_Queue&) = delete;
+    MPSC_Queue& operator=(MPSC_Queue&&) = delete;
+
+    size_t get_total_slots() const { return m_total_slots; }
+    size_t get_total_dropped() const { return m_total_dropped.load(std::memory_order_relaxed); }
+
+    // Producer: any thread can push, value is left untouched if the queue is full
+    bool try_push(T&& value) {
+        size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        while (true) {
+            slot = &m_slots[write_index % m_total_slots];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto lag = intptr_t(sequence) - intptr_t(write_index);
+            if (lag == 0) {
+                if (m_write_index.compare_exchange_weak(write_index, write_index+1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                // slot still holds an object from the previous lap that hasn't been read
+                m_total_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                write_index = m_write_index.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(write_index+1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: only one thread can pop
+    // Objects are returned in the order producers claimed their slots
+    bool try_pop(T& value) {
+        Slot& slot = m_slots[m_read_index % m_total_slots];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != m_read_index+1) return false;
+        value = std::move(slot.value);
+        // release anything the moved from object still owns before the slot is reused
+        slot.value = T();
+        slot.sequence.store(m_read_index+m_total_slots, std::memory_order_release);
+        m_read_index++;
+        return true;
+    }
+};
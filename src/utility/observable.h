@@ -1,7 +1,11 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
 #include <functional>
 #include <vector>
+#include "./inline_function.h"
 
 template <typename ... T>
 class Observable 
@@ -19,4 +23,66 @@ public:
             o(args...);
         }
     }
-};
\ No newline at end of file
+};
+
+// Same as above except arguments are passed to every callback by const reference
+// Callbacks are stored inline so attaching them doesn't allocate
+// This is used on hot paths where the arguments are expensive to copy (e.g. MOT entities)
+template <typename ... T>
+class Ref_Observable
+{
+public:
+    using Observer = Inline_Function<void(const T&...)>;
+    // 0 is never a valid handle
+    using Handle = uint64_t;
+private:
+    struct Entry {
+        Handle handle;
+        Observer observer;
+    };
+    std::vector<Entry> m_observers;
+    Handle m_next_handle = 1;
+    int m_notify_depth = 0;
+    bool m_is_detach_pending = false;
+public:
+    template <typename F>
+    Handle Attach(F&& observer) {
+        const Handle handle = m_next_handle++;
+        m_observers.push_back({ handle, Observer(std::forward<F>(observer)) });
+        return handle;
+    }
+    // Callbacks can detach themselves or others while being notified
+    // NOTE: Attaching while being notified isn't allowed since it can move a running callback
+    void Detach(const Handle handle) {
+        auto it = std::find_if(m_observers.begin(), m_observers.end(), [handle](const auto& entry) {
+            return entry.handle == handle;
+        });
+        if (it == m_observers.end()) return;
+        if (m_notify_depth > 0) {
+            // Removed once the outermost Notify() finishes
+            it->handle = 0;
+            m_is_detach_pending = true;
+            return;
+        }
+        m_observers.erase(it);
+    }
+    size_t GetTotalObservers(void) const {
+        return size_t(std::count_if(m_observers.begin(), m_observers.end(), [](const auto& entry) { 
+            return entry.handle != 0; 
+        }));
+    }
+    void Notify(const T& ... args) {
+        m_notify_depth++;
+        for (const auto& entry: m_observers) {
+            if (entry.handle == 0) continue;
+            entry.observer(args...);
+        }
+        m_notify_depth--;
+        if ((m_notify_depth == 0) && m_is_detach_pending) {
+            m_is_detach_pending = false;
+            m_observers.erase(
+                std::remove_if(m_observers.begin(), m_observers.end(), [](const auto& entry) { return entry.handle == 0; }),
+                m_observers.end());
+        }
+    }
+};
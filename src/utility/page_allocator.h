@@ -0,0 +1,192 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <type_traits>
+#include "./memory_policy.h"
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+// Pages are allocated directly from the OS when a Memory_Policy is given
+// This bypasses the heap so the policy applies to the whole buffer and nothing else shares its pages
+constexpr static size_t PAGE_ALLOCATOR_HUGE_PAGE_SIZE = size_t(2) << 20;
+// mmap and VirtualAlloc always return blocks aligned to at least this
+constexpr static size_t PAGE_ALLOCATOR_MIN_ALIGNMENT = 4096;
+
+// Buffers smaller than a huge page wouldn't have fewer TLB misses so they use normal pages
+static inline bool get_is_huge_page_allocation(const size_t nb_bytes, const Memory_Policy& policy) {
+    return policy.is_huge_pages && (nb_bytes >= PAGE_ALLOCATOR_HUGE_PAGE_SIZE);
+}
+
+// Returns nullptr if the pages couldn't be allocated or page allocation isn't supported on this platform
+static inline void* allocate_pages(const size_t nb_bytes, const Memory_Policy& policy) {
+    const bool is_huge = get_is_huge_page_allocation(nb_bytes, policy);
+#if defined(_WIN32)
+    void* ptr = nullptr;
+    const DWORD alloc_flags = MEM_RESERVE | MEM_COMMIT;
+    const auto alloc = [&](const size_t size, const DWORD flags) -> void* {
+        if (policy.numa_node >= 0) {
+            return VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, flags, PAGE_READWRITE, DWORD(policy.numa_node));
+        }
+        return VirtualAlloc(nullptr, size, flags, PAGE_READWRITE);
+    };
+    const size_t large_page_size = GetLargePageMinimum();
+    if (is_huge && (large_page_size > 0)) {
+        // large pages are always locked so is_locked is already satisfied
+        const size_t size = ((nb_bytes + large_page_size - 1) / large_page_size) * large_page_size;
+        ptr = alloc(size, alloc_flags | MEM_LARGE_PAGES);
+        if (ptr != nullptr) return ptr;
+    }
+    ptr = alloc(nb_bytes, alloc_flags);
+    if ((ptr != nullptr) && policy.is_locked) {
+        VirtualLock(ptr, nb_bytes);
+    }
+    return ptr;
+#elif defined(__linux__)
+    void* ptr = MAP_FAILED;
+    size_t size = nb_bytes;
+    if (is_huge) {
+        size = ((nb_bytes + PAGE_ALLOCATOR_HUGE_PAGE_SIZE - 1) / PAGE_ALLOCATOR_HUGE_PAGE_SIZE) * PAGE_ALLOCATOR_HUGE_PAGE_SIZE;
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            // no huge pages are reserved so fall back to transparent huge pages
+            // over allocate so the block can be trimmed to start on a huge page boundary
+            const size_t total_size = size + PAGE_ALLOCATOR_HUGE_PAGE_SIZE;
+            void* base = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) return nullptr;
+            const auto base_addr = reinterpret_cast<uintptr_t>(base);
+            const uintptr_t addr = (base_addr + PAGE_ALLOCATOR_HUGE_PAGE_SIZE - 1) & ~uintptr_t(PAGE_ALLOCATOR_HUGE_PAGE_SIZE - 1);
+            const size_t head = size_t(addr - base_addr);
+            const size_t tail = total_size - head - size;
+            if (head > 0) munmap(base, head);
+            if (tail > 0) munmap(reinterpret_cast<void*>(addr + size), tail);
+            ptr = reinterpret_cast<void*>(addr);
+            madvise(ptr, size, MADV_HUGEPAGE);
+        }
+    } else {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return nullptr;
+    }
+    if (policy.numa_node >= 0) {
+        // avoid a dependency on libnuma by calling mbind directly
+        // MPOL_PREFERRED falls back to other nodes instead of failing if the node is out of memory
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        constexpr size_t BITS_PER_WORD = sizeof(unsigned long)*8;
+        constexpr size_t TOTAL_WORDS = 16;
+        unsigned long node_mask[TOTAL_WORDS] = {0};
+        const size_t node = size_t(policy.numa_node);
+        if (node < TOTAL_WORDS*BITS_PER_WORD) {
+            node_mask[node / BITS_PER_WORD] |= 1ul << (node % BITS_PER_WORD);
+            // NOTE: pages are only placed when first touched so this must happen before the buffer is written
+            syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_MODE, node_mask, TOTAL_WORDS*BITS_PER_WORD+1, 0);
+        }
+    }
+    if (policy.is_locked) {
+        mlock(ptr, size);
+    }
+    return ptr;
+#else
+    (void)nb_bytes;
+    (void)policy;
+    (void)is_huge;
+    return nullptr;
+#endif
+}
+
+// nb_bytes and policy must be the same as the call to allocate_pages()
+static inline void free_pages(void* ptr, const size_t nb_bytes, const Memory_Policy& policy) {
+    if (ptr == nullptr) return;
+#if defined(_WIN32)
+    (void)nb_bytes;
+    (void)policy;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#elif defined(__linux__)
+    size_t size = nb_bytes;
+    if (get_is_huge_page_allocation(nb_bytes, policy)) {
+        size = ((nb_bytes + PAGE_ALLOCATOR_HUGE_PAGE_SIZE - 1) / PAGE_ALLOCATOR_HUGE_PAGE_SIZE) * PAGE_ALLOCATOR_HUGE_PAGE_SIZE;
+    }
+    // munmap also unlocks the pages
+    munmap(ptr, size);
+#else
+    (void)ptr;
+    (void)nb_bytes;
+    (void)policy;
+#endif
+}
+
+// Same as AlignedAllocator but allocates whole pages with a Memory_Policy
+// A default policy or a platform without page allocation uses aligned operator new
+// NOTE: The policy is part of the allocator so a buffer is always freed the same way it was allocated
+template <typename T>
+class PageAllocator
+{
+public:
+    using value_type = T;
+    using is_always_equal = std::false_type;
+    using propagate_on_container_copy_assignment = std::false_type; // do not copy allocator when copying object
+    using propagate_on_container_move_assignment = std::true_type; // move allocator when moving object
+    using propagate_on_container_swap = std::true_type;
+    template <typename U>
+    struct rebind {
+        using other = PageAllocator<U>;
+    };
+    static constexpr size_t default_alignment = sizeof(std::size_t);
+private:
+    std::size_t m_alignment;
+    Memory_Policy m_policy;
+public:
+    explicit PageAllocator(std::size_t alignment=default_alignment, const Memory_Policy& policy={})
+    : m_alignment(alignment), m_policy(policy) {}
+    [[nodiscard]] T* allocate(std::size_t length) {
+        const size_t nb_bytes = length*sizeof(T);
+        if (get_is_pages()) {
+            void* ptr = allocate_pages(nb_bytes, m_policy);
+            if (ptr == nullptr) throw std::bad_alloc();
+            return reinterpret_cast<T*>(ptr);
+        }
+        return reinterpret_cast<T*>(operator new(nb_bytes, std::align_val_t(m_alignment)));
+    }
+    void deallocate(T* const ptr, std::size_t length) const {
+        assert(reinterpret_cast<uintptr_t>(ptr) % m_alignment == 0);
+        if (get_is_pages()) {
+            free_pages(ptr, length*sizeof(T), m_policy);
+            return;
+        }
+        operator delete(ptr, std::align_val_t(m_alignment));
+    }
+    bool operator==(const PageAllocator& other) const noexcept {
+        return (m_alignment == other.m_alignment) && (m_policy == other.m_policy);
+    }
+    bool operator!=(const PageAllocator& other) const noexcept {
+        return !(*this == other);
+    }
+    inline size_t get_alignment() const { return m_alignment; }
+    inline const Memory_Policy& get_policy() const { return m_policy; }
+    // cast between types
+    template <typename U>
+    explicit PageAllocator(const PageAllocator<U>& other): m_alignment(other.get_alignment()), m_policy(other.get_policy()) {}
+    template <typename U>
+    operator PageAllocator<U>() const { return PageAllocator<U>(m_alignment, m_policy); }
+private:
+    bool get_is_pages() const {
+#if defined(_WIN32) || defined(__linux__)
+        return !m_policy.IsDefault() && (m_alignment <= PAGE_ALLOCATOR_MIN_ALIGNMENT);
+#else
+        return false;
+#endif
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// Publishes a small value from one writer thread to any number of reader threads without locking
+// The writer never waits and readers retry if the value was being written while they copied it
+// NOTE: The value is copied as words of relaxed atomics so a torn read is discarded instead of being a data race
+template <typename T>
+class Seqlock
+{
+private:
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock can only publish trivially copyable values");
+    static constexpr size_t TOTAL_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    // odd while the writer is copying the value
+    std::atomic<uint32_t> m_sequence{0};
+    std::array<std::atomic<uint64_t>, TOTAL_WORDS> m_words{};
+public:
+    explicit Seqlock(const T& value={}) { store(value); }
+    Seqlock(Seqlock&) = delete;
+    Seqlock(Seqlock&&) = delete;
+    Seqlock& operator=(Seqlock&) = delete;
+    Seqlock& operator=(Seqlock&&) = delete;
+
+    // Writer: only one thread can call this
+    void store(const T& value) {
+        std::array<uint64_t, TOTAL_WORDS> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < TOTAL_WORDS; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence+2, std::memory_order_release);
+    }
+
+    // Readers: any thread can call this
+    T load() const {
+        std::array<uint64_t, TOTAL_WORDS> words{};
+        while (true) {
+            const uint32_t start = m_sequence.load(std::memory_order_acquire);
+            if ((start & 1u) != 0) continue;
+            for (size_t i = 0; i < TOTAL_WORDS; i++) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t end = m_sequence.load(std::memory_order_relaxed);
+            if (start == end) break;
+        }
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+    // Incremented by two each time a value is stored
+    uint32_t get_sequence() const { return m_sequence.load(std::memory_order_acquire); }
+};
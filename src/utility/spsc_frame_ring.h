@@ -0,0 +1,136 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "./aligned_allocator.hpp"
+#include "./span.h"
+
+// Bounded lock free single producer single consumer ring of fixed length frames
+// Each slot is preallocated so the producer and consumer exchange frames without allocating
+// If the consumer falls behind the producer drops the newest frame and increments a counter
+// Producers of sources that aren't realtime (e.g. files) can instead wait for a free slot so nothing is dropped
+// Each frame can carry a timestamp (e.g. the capture time from "utility/latency_trace.h") which is 0 if unused
+template <typename T>
+class SPSC_Frame_Ring
+{
+private:
+    // avoid false sharing between producer and consumer indices
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    const size_t m_frame_length;
+    const size_t m_total_slots;
+    std::vector<T, AlignedAllocator<T>> m_data;
+    std::vector<uint64_t> m_timestamps;
+    // indices are monotonically increasing and wrapped on access
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_write_index{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_read_index{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_total_dropped{0};
+    std::atomic<bool> m_is_closed{false};
+public:
+    SPSC_Frame_Ring(const size_t frame_length, const size_t total_slots)
+    :   m_frame_length(frame_length), m_total_slots(total_slots),
+        m_data(frame_length*total_slots, AlignedAllocator<T>(CACHE_LINE_SIZE)),
+        m_timestamps(total_slots, 0)
+    {
+        assert(m_frame_length > 0);
+        assert(m_total_slots > 0);
+    }
+    SPSC_Frame_Ring(SPSC_Frame_Ring&) = delete;
+    SPSC_Frame_Ring(SPSC_Frame_Ring&&) = delete;
+    SPSC_Frame_Ring& operator=(SPSC_Frame_Ring&) = delete;
+    SPSC_Frame_Ring& operator=(SPSC_Frame_Ring&&) = delete;
+
+    size_t get_frame_length() const { return m_frame_length; }
+    size_t get_total_slots() const { return m_total_slots; }
+    size_t get_total_dropped() const { return m_total_dropped.load(std::memory_order_relaxed); }
+    size_t get_memory_bytes() const { return m_data.capacity()*sizeof(T) + m_timestamps.capacity()*sizeof(uint64_t); }
+    size_t get_total_used() const {
+        const size_t read_index = m_read_index.load(std::memory_order_acquire);
+        const size_t write_index = m_write_index.load(std::memory_order_acquire);
+        return write_index - read_index;
+    }
+    bool is_empty() const { return get_total_used() == 0; }
+    bool is_full() const { return get_total_used() == m_total_slots; }
+    // Consumer: check is_closed() before acquire_read() so frames committed before close() aren't missed
+    bool is_closed() const { return m_is_closed.load(std::memory_order_acquire); }
+    void close() { m_is_closed.store(true, std::memory_order_release); }
+
+    // Producer: returns an empty span if there are no free slots
+    tcb::span<T> acquire_write() {
+        const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        const size_t read_index = m_read_index.load(std::memory_order_acquire);
+        if ((write_index - read_index) >= m_total_slots) {
+            return {};
+        }
+        return get_slot(write_index);
+    }
+    void commit_write(const uint64_t timestamp=0) {
+        const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        m_timestamps[write_index % m_total_slots] = timestamp;
+        m_write_index.store(write_index+1, std::memory_order_release);
+    }
+    // Producer: copy a frame into the next free slot, otherwise drop it
+    bool try_push(tcb::span<const T> frame, const uint64_t timestamp=0) {
+        assert(frame.size() == m_frame_length);
+        auto slot = acquire_write();
+        if (slot.empty()) {
+            m_total_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::memcpy(slot.data(), frame.data(), m_frame_length*sizeof(T));
+        commit_write(timestamp);
+        return true;
+    }
+
+    // Producer: wait until at least total_free slots are free so the consumer applies backpressure
+    // Returns false if the ring is closed while waiting
+    bool wait_for_free_slots(const size_t total_free=1) const {
+        constexpr auto POLL_PERIOD = std::chrono::milliseconds(1);
+        assert(total_free <= m_total_slots);
+        while ((m_total_slots - get_total_used()) < total_free) {
+            if (is_closed()) return false;
+            std::this_thread::sleep_for(POLL_PERIOD);
+        }
+        return true;
+    }
+    // Producer: copy a frame into the next free slot and wait for one if the ring is full
+    bool push_blocking(tcb::span<const T> frame, const uint64_t timestamp=0) {
+        if (!wait_for_free_slots(1)) {
+            m_total_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return try_push(frame, timestamp);
+    }
+
+    // Producer: count a frame that was dropped without offering it to the ring
+    void drop() { m_total_dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    // Consumer: returns an empty span if there are no frames available
+    tcb::span<const T> acquire_read() {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        const size_t write_index = m_write_index.load(std::memory_order_acquire);
+        if (read_index == write_index) {
+            return {};
+        }
+        return get_slot(read_index);
+    }
+    // Consumer: timestamp of the frame from acquire_read()
+    uint64_t get_read_timestamp() const {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        return m_timestamps[read_index % m_total_slots];
+    }
+    void release_read() {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        m_read_index.store(read_index+1, std::memory_order_release);
+    }
+private:
+    tcb::span<T> get_slot(const size_t index) {
+        const size_t slot = index % m_total_slots;
+        return tcb::span(m_data).subspan(slot*m_frame_length, m_frame_length);
+    }
+};
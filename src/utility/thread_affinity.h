@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Scheduling priority of a thread relative to the rest of the process
+// NOTE: HIGH and REALTIME usually require elevated privileges
+enum class Thread_Priority {
+    DEFAULT, LOW, HIGH, REALTIME,
+};
+
+// Placement of a thread or group of threads onto logical cores
+// Applied by the thread itself with apply_thread_affinity() from "utility/thread_affinity_platform.h"
+struct Thread_Affinity {
+    // logical cores the threads may run on, empty for any core
+    std::vector<int> cores;
+    // only use the logical cores of this NUMA node, -1 for any node
+    // NOTE: if cores is also given then only the cores that belong to this node are used
+    int numa_node = -1;
+    // pin each thread of the group to a single core from the list by its index
+    bool is_one_core_per_thread = false;
+    Thread_Priority priority = Thread_Priority::DEFAULT;
+    bool IsDefault() const {
+        return cores.empty() && (numa_node < 0) && (priority == Thread_Priority::DEFAULT);
+    }
+};
+
+// Parses a core list such as "0-3,8,10-11"
+// Returns false if the list is malformed
+static inline bool parse_thread_cores(const char* str, std::vector<int>& cores) {
+    cores.clear();
+    const char* curr = str;
+    while (*curr != '\0') {
+        char* end = nullptr;
+        const long start = strtol(curr, &end, 10);
+        if ((end == curr) || (start < 0)) return false;
+        long stop = start;
+        curr = end;
+        if (*curr == '-') {
+            curr++;
+            stop = strtol(curr, &end, 10);
+            if ((end == curr) || (stop < start)) return false;
+            curr = end;
+        }
+        for (long core = start; core <= stop; core++) {
+            cores.push_back(int(core));
+        }
+        if (*curr == ',') {
+            curr++;
+        } else if ((*curr != '\0') && (*curr != '\n')) {
+            return false;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+// Returns false if the name doesn't match a priority
+static inline bool parse_thread_priority(const char* name, Thread_Priority& priority) {
+    if (strcmp(name, "default") == 0)  { priority = Thread_Priority::DEFAULT;  return true; }
+    if (strcmp(name, "low") == 0)      { priority = Thread_Priority::LOW;      return true; }
+    if (strcmp(name, "high") == 0)     { priority = Thread_Priority::HIGH;     return true; }
+    if (strcmp(name, "realtime") == 0) { priority = Thread_Priority::REALTIME; return true; }
+    return false;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "./thread_affinity.h"
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+// Logical cores that belong to a NUMA node
+// Returns an empty list if the node doesn't exist or NUMA isn't supported
+static inline std::vector<int> get_numa_node_cores(const int numa_node) {
+    std::vector<int> cores;
+    if (numa_node < 0) return cores;
+#if defined(_WIN32)
+    GROUP_AFFINITY group_affinity;
+    if (!GetNumaNodeProcessorMaskEx(USHORT(numa_node), &group_affinity)) return cores;
+    for (int i = 0; i < 64; i++) {
+        if (group_affinity.Mask & (KAFFINITY(1) << i)) {
+            cores.push_back(int(group_affinity.Group)*64 + i);
+        }
+    }
+#elif defined(__linux__)
+    // avoid a dependency on libnuma by reading the node topology from sysfs
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numa_node);
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) return cores;
+    char line[1024] = {0};
+    const bool is_read = fgets(line, sizeof(line), fp) != nullptr;
+    fclose(fp);
+    if (!is_read || !parse_thread_cores(line, cores)) {
+        cores.clear();
+    }
+#endif
+    return cores;
+}
+
+// Logical cores that a thread of a group should run on
+static inline std::vector<int> get_thread_affinity_cores(const Thread_Affinity& affinity, const size_t thread_index=0) {
+    std::vector<int> cores = affinity.cores;
+    if (affinity.numa_node >= 0) {
+        const auto numa_cores = get_numa_node_cores(affinity.numa_node);
+        if (cores.empty()) {
+            cores = numa_cores;
+        } else {
+            cores.erase(
+                std::remove_if(cores.begin(), cores.end(), [&numa_cores](int core) {
+                    return std::find(numa_cores.begin(), numa_cores.end(), core) == numa_cores.end();
+                }),
+                cores.end()
+            );
+        }
+    }
+    if (affinity.is_one_core_per_thread && !cores.empty()) {
+        const int core = cores[thread_index % cores.size()];
+        cores = { core };
+    }
+    return cores;
+}
+
+static inline bool apply_thread_cores(const std::vector<int>& cores) {
+    if (cores.empty()) return true;
+#if defined(_WIN32)
+    // a thread can only run in one processor group so we use the group of the first core
+    GROUP_AFFINITY group_affinity;
+    ZeroMemory(&group_affinity, sizeof(group_affinity));
+    group_affinity.Group = WORD(cores[0] / 64);
+    for (const int core: cores) {
+        if ((core / 64) != int(group_affinity.Group)) continue;
+        group_affinity.Mask |= KAFFINITY(1) << (core % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &group_affinity, nullptr) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int core: cores) {
+        if (core >= CPU_SETSIZE) continue;
+        CPU_SET(core, &cpu_set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    // thread affinity isn't supported on this platform
+    return false;
+#endif
+}
+
+static inline bool apply_thread_priority(const Thread_Priority priority) {
+    if (priority == Thread_Priority::DEFAULT) return true;
+#if defined(_WIN32)
+    int win_priority = THREAD_PRIORITY_NORMAL;
+    switch (priority) {
+    case Thread_Priority::LOW:      win_priority = THREAD_PRIORITY_BELOW_NORMAL; break;
+    case Thread_Priority::HIGH:     win_priority = THREAD_PRIORITY_ABOVE_NORMAL; break;
+    case Thread_Priority::REALTIME: win_priority = THREAD_PRIORITY_TIME_CRITICAL; break;
+    default: break;
+    }
+    return SetThreadPriority(GetCurrentThread(), win_priority) != 0;
+#elif defined(__linux__)
+    if (priority == Thread_Priority::REALTIME) {
+        sched_param param;
+        param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+    // linux applies the nice value to a single thread if given its thread id
+    const int nice_value = (priority == Thread_Priority::HIGH) ? -10 : 10;
+    const auto thread_id = id_t(syscall(SYS_gettid));
+    return setpriority(PRIO_PROCESS, thread_id, nice_value) == 0;
+#else
+    return false;
+#endif
+}
+
+// Applies the placement and priority to the calling thread
+// Returns false if any part of it couldn't be applied, e.g. due to insufficient privileges
+static inline bool apply_thread_affinity(const Thread_Affinity& affinity, const size_t thread_index=0) {
+    if (affinity.IsDefault()) return true;
+    const auto cores = get_thread_affinity_cores(affinity, thread_index);
+    bool is_success = true;
+    if (!affinity.cores.empty() || (affinity.numa_node >= 0)) {
+        // no cores are left if the given cores aren't part of the NUMA node
+        is_success = !cores.empty() && apply_thread_cores(cores);
+    }
+    is_success = apply_thread_priority(affinity.priority) && is_success;
+    return is_success;
+}
+
+// CPU time used by the calling thread in nanoseconds
+// Returns 0 if this isn't supported on this platform
+static inline uint64_t get_thread_cpu_time_ns() {
+#if defined(_WIN32)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+    const auto to_u64 = [](const FILETIME& t) { return (uint64_t(t.dwHighDateTime) << 32) | uint64_t(t.dwLowDateTime); };
+    // NOTE: Windows counts in 100ns intervals
+    return (to_u64(kernel_time) + to_u64(user_time)) * 100;
+#elif defined(__linux__)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return uint64_t(ts.tv_sec)*1000000000ull + uint64_t(ts.tv_nsec);
+#else
+    return 0;
+#endif
+}
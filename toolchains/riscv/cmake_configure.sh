@@ -0,0 +1,3 @@
+#!/bin/sh
+export PKG_CONFIG_PATH=/usr/lib/riscv64-linux-gnu/pkgconfig
+cmake . -B build-riscv -G Ninja -DCMAKE_BUILD_TYPE=Release -DCMAKE_TOOLCHAIN_FILE=./toolchains/riscv/linux-gnu-toolchain.cmake "$@"
\ No newline at end of file
@@ -0,0 +1,9 @@
+#!/bin/sh
+sudo apt-get --yes install build-essential ninja-build
+# The RVV 1.0 intrinsics require gcc 14 or newer
+sudo apt-get --yes install qemu-user qemu-user-static gcc-14-riscv64-linux-gnu g++-14-riscv64-linux-gnu binutils-riscv64-linux-gnu
+sudo dpkg --add-architecture riscv64
+sudo cat ./toolchains/riscv/sources.list | sudo tee -a /etc/apt/sources.list
+sudo apt-get --yes update
+sudo apt-get --yes install libglfw3-dev:riscv64 libopengl-dev:riscv64
+sudo apt-get --yes install libportaudio2:riscv64 portaudio19-dev:riscv64 librtlsdr-dev:riscv64 libfftw3-dev:riscv64 libfftw3-single3:riscv64
\ No newline at end of file
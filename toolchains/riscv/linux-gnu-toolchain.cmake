@@ -0,0 +1,11 @@
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR riscv64)
+
+set(CMAKE_C_COMPILER   "/usr/bin/riscv64-linux-gnu-gcc-14")
+set(CMAKE_CXX_COMPILER "/usr/bin/riscv64-linux-gnu-g++-14")
+set(CMAKE_C_FLAGS_INIT   "-march=rv64gcv")
+set(CMAKE_CXX_FLAGS_INIT "-march=rv64gcv")
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
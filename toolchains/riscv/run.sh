@@ -0,0 +1,2 @@
+#!/bin/sh 
+QEMU_CPU=rv64,v=true,vlen=256,elen=64 qemu-riscv64 -L /usr/riscv64-linux-gnu "$@"
\ No newline at end of file